@@ -1947,6 +1947,14 @@ function test_mon_osd_pool_set()
       expect_false ceph osd pool set $TEST_POOL_GETSET $flag 2
   done
 
+  # every up osd advertises the feature chain replication needs
+  ceph osd pool set $TEST_POOL_GETSET chain_replication true
+  ceph osd pool get $TEST_POOL_GETSET chain_replication | grep "chain_replication: true"
+  ceph osd pool set $TEST_POOL_GETSET chain_replication 0
+  ceph osd pool get $TEST_POOL_GETSET chain_replication | grep "chain_replication: false"
+  expect_false ceph osd pool set $TEST_POOL_GETSET chain_replication 2
+  expect_false ceph osd pool set pool_erasure chain_replication true
+
   ceph osd pool get $TEST_POOL_GETSET scrub_min_interval | expect_false grep '.'
   ceph osd pool set $TEST_POOL_GETSET scrub_min_interval 123456
   ceph osd pool get $TEST_POOL_GETSET scrub_min_interval | grep 'scrub_min_interval: 123456'
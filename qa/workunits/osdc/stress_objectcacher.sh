@@ -24,5 +24,7 @@ do
 done
 
 ceph_test_objectcacher_stress --correctness-test > /dev/null 2>&1
+ceph_test_objectcacher_stress --partial-write-test > /dev/null 2>&1
+ceph_test_objectcacher_stress --flush-test > /dev/null 2>&1
 
 echo OK
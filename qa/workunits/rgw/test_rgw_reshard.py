@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+"""
+Reshard a bucket with rgw_reshard_online while clients keep writing,
+deleting and uploading parts, then check that the new index holds
+exactly the objects that should exist and that its stats add up.
+"""
+import io
+import json
+import os
+import socket
+import subprocess
+import sys
+
+import boto
+import boto.s3.connection
+
+
+USER = 'reshard_user'
+BUCKET = 'reshard-bucket'
+
+
+def admin(args, **kwargs):
+    cmd = ['radosgw-admin', '--rgw-reshard-online=true'] + args
+    print(' '.join(cmd))
+    return subprocess.check_output(cmd, **kwargs)
+
+
+def connect():
+    out = json.loads(admin(['user', 'create', '--uid', USER,
+                            '--display-name', USER]))
+    keys = out['keys'][0]
+    return boto.connect_s3(
+        aws_access_key_id=keys['access_key'],
+        aws_secret_access_key=keys['secret_key'],
+        host=os.environ.get('RGW_FQDN', socket.getfqdn()),
+        port=int(os.environ.get('RGW_PORT', 7280)),
+        is_secure=False,
+        calling_format=boto.s3.connection.OrdinaryCallingFormat())
+
+
+def put(bucket, name, expected):
+    bucket.new_key(name).set_contents_from_string(name)
+    expected.add(name)
+
+
+def delete(bucket, name, expected):
+    bucket.delete_key(name)
+    expected.discard(name)
+
+
+def num_objects():
+    stats = json.loads(admin(['bucket', 'stats', '--bucket', BUCKET]))
+    return sum(c['num_objects'] for c in stats['usage'].values())
+
+
+def main():
+    conn = connect()
+    bucket = conn.create_bucket(BUCKET)
+    expected = set()
+
+    # names that hash differently from their index key: escaped
+    # underscores and, below, multipart meta and parts
+    for i in range(500):
+        put(bucket, 'obj%d' % i, expected)
+        put(bucket, '_obj%d' % i, expected)
+    upload = bucket.initiate_multipart_upload('multi')
+    part = b'x' * (5 * 1024 * 1024)
+    upload.upload_part_from_file(io.BytesIO(part), 1)
+
+    reshard = subprocess.Popen(
+        ['radosgw-admin', '--rgw-reshard-online=true', 'bucket', 'reshard',
+         '--bucket', BUCKET, '--num-shards', '13'])
+
+    # keep the index busy for as long as the copy runs
+    i = 0
+    while reshard.poll() is None or i < 200:
+        put(bucket, 'new%d' % i, expected)
+        put(bucket, '_new%d' % i, expected)
+        delete(bucket, 'obj%d' % (i % 500), expected)
+        i += 1
+    if reshard.returncode != 0:
+        sys.exit('bucket reshard failed: %d' % reshard.returncode)
+
+    upload.upload_part_from_file(io.BytesIO(part), 2)
+    upload.complete_upload()
+    expected.add('multi')
+
+    listed = [k.name for k in bucket.list()]
+    assert len(listed) == len(set(listed)), 'duplicate entries in listing'
+    missing = expected - set(listed)
+    extra = set(listed) - expected
+    assert not missing, 'missing after reshard: %s' % sorted(missing)[:10]
+    assert not extra, 'unexpected after reshard: %s' % sorted(extra)[:10]
+    assert num_objects() == len(expected), \
+        'bucket stats %d != %d objects' % (num_objects(), len(expected))
+    assert not list(bucket.list_multipart_uploads()), \
+        'multipart upload left behind'
+
+    for k in bucket.list():
+        k.delete()
+    conn.delete_bucket(BUCKET)
+    admin(['user', 'rm', '--uid', USER])
+    print('OK')
+
+
+if __name__ == '__main__':
+    main()
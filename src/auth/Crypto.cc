@@ -11,6 +11,7 @@
  * 
  */
 
+#include <mutex>
 #include <sstream>
 #include "Crypto.h"
 #ifdef USE_CRYPTOPP
@@ -194,6 +195,15 @@ public:
     out.append((const char *)decryptedtext.c_str(), decryptedtext.length());
     return 0;
   }
+
+  int encrypt_first_block(const char *in, char *out) const {
+    // CBC: the first block is E(P0 ^ IV)
+    byte block[AES_BLOCK_LEN];
+    for (size_t i = 0; i < AES_BLOCK_LEN; i++)
+      block[i] = in[i] ^ CEPH_AES_IV[i];
+    enc_key->ProcessBlock(block, (byte*)out);
+    return 0;
+  }
 };
 
 #elif defined(USE_NSS)
@@ -261,13 +271,21 @@ class CryptoAESKeyHandler : public CryptoKeyHandler {
   PK11SymKey *key;
   SECItem *param;
 
+  // single-block context kept for signatures; NSS contexts are not
+  // thread safe, and a key is shared by a connection's reader and writer
+  PK11Context *ecb_ctx;
+  mutable std::mutex ecb_lock;
+
 public:
   CryptoAESKeyHandler()
     : mechanism(CKM_AES_CBC_PAD),
       slot(NULL),
       key(NULL),
-      param(NULL) {}
+      param(NULL),
+      ecb_ctx(NULL) {}
   ~CryptoAESKeyHandler() override {
+    if (ecb_ctx)
+      PK11_DestroyContext(ecb_ctx, PR_TRUE);
     SECITEM_FreeItem(param, PR_TRUE);
     if (key)
       PK11_FreeSymKey(key);
@@ -308,6 +326,14 @@ public:
       return -1;
     }
 
+    // optional; encrypt_first_block() falls back to encrypt() without it
+    SECItem noParams;
+    noParams.type = siBuffer;
+    noParams.data = NULL;
+    noParams.len = 0;
+    ecb_ctx = PK11_CreateContextBySymKey(CKM_AES_ECB, CKA_ENCRYPT, key,
+					 &noParams);
+
     return 0;
   }
 
@@ -319,6 +345,22 @@ public:
 	       bufferlist& out, std::string *error) const override {
     return nss_aes_operation(CKA_DECRYPT, mechanism, key, param, in, out, error);
   }
+
+  int encrypt_first_block(const char *in, char *out) const override {
+    if (!ecb_ctx)
+      return -EOPNOTSUPP;
+    // CBC: the first block is E(P0 ^ IV)
+    unsigned char block[AES_BLOCK_LEN];
+    for (size_t i = 0; i < AES_BLOCK_LEN; i++)
+      block[i] = in[i] ^ CEPH_AES_IV[i];
+    int written = 0;
+    std::lock_guard<std::mutex> l(ecb_lock);
+    SECStatus ret = PK11_CipherOp(ecb_ctx, (unsigned char*)out, &written,
+				  AES_BLOCK_LEN, block, AES_BLOCK_LEN);
+    if (ret != SECSuccess || written != AES_BLOCK_LEN)
+      return -EIO;
+    return 0;
+  }
 };
 
 #else
@@ -40,6 +40,19 @@ public:
 		       bufferlist& out, std::string *error) const = 0;
   virtual int decrypt(const bufferlist& in,
 		       bufferlist& out, std::string *error) const = 0;
+
+  static const size_t BLOCK_LEN = 16;
+  /**
+   * Encrypt BLOCK_LEN bytes into the first cipher block that encrypt()
+   * would produce for any input starting with them.  Message signatures
+   * only keep that block, so this skips padding, the remaining blocks
+   * and the buffer copies.
+   *
+   * @return -EOPNOTSUPP if the key has no such fast path
+   */
+  virtual int encrypt_first_block(const char *in, char *out) const {
+    return -EOPNOTSUPP;
+  }
 };
 
 /*
@@ -114,6 +127,10 @@ public:
     assert(ckh); // Bad key?
     return ckh->decrypt(in, out, error);
   }
+  int encrypt_first_block(const char *in, char *out) const {
+    assert(ckh); // Bad key?
+    return ckh->encrypt_first_block(in, out);
+  }
 
   void to_str(std::string& s) const;
 };
@@ -45,18 +45,34 @@ int CephxSessionHandler::_calc_signature(Message *m, uint64_t *psig)
     mswab<uint32_t>(header.crc), mswab<uint32_t>(footer.front_crc),
     mswab<uint32_t>(footer.middle_crc), mswab<uint32_t>(footer.data_crc)
   };
-  bufferlist bl_plaintext;
-  bl_plaintext.append(buffer::create_static(sizeof(sigblock), (char*)&sigblock));
+  // the signature is the start of the first cipher block, so encrypt just
+  // that block when the key allows it
+  static_assert(sizeof(sigblock) >= CryptoKeyHandler::BLOCK_LEN,
+		"signature block shorter than a cipher block");
+  char first_block[CryptoKeyHandler::BLOCK_LEN];
+  int r = key.encrypt_first_block((const char*)&sigblock, first_block);
+  if (r == 0) {
+    ceph_le64 sig;
+    memcpy(&sig, first_block, sizeof(sig));
+    *psig = sig;
+  } else if (r == -EOPNOTSUPP) {
+    bufferlist bl_plaintext;
+    bl_plaintext.append(buffer::create_static(sizeof(sigblock),
+					      (char*)&sigblock));
+
+    bufferlist bl_ciphertext;
+    if (key.encrypt(cct, bl_plaintext, bl_ciphertext, NULL) < 0) {
+      lderr(cct) << __func__ << " failed to encrypt signature block" << dendl;
+      return -1;
+    }
 
-  bufferlist bl_ciphertext;
-  if (key.encrypt(cct, bl_plaintext, bl_ciphertext, NULL) < 0) {
+    bufferlist::iterator ci = bl_ciphertext.begin();
+    ::decode(*psig, ci);
+  } else {
     lderr(cct) << __func__ << " failed to encrypt signature block" << dendl;
     return -1;
   }
 
-  bufferlist::iterator ci = bl_ciphertext.begin();
-  ::decode(*psig, ci);
-
   ldout(cct, 10) << __func__ << " seq " << m->get_seq()
 		 << " front_crc_ = " << footer.front_crc
 		 << " middle_crc = " << footer.middle_crc
@@ -480,6 +480,13 @@ void Client::_finish_init()
   plb.add_time_avg(l_c_reply, "reply", "Latency of receiving a reply on metadata request");
   plb.add_time_avg(l_c_lat, "lat", "Latency of processing a metadata request");
   plb.add_time_avg(l_c_wrlat, "wrlat", "Latency of a file data write operation");
+  plb.add_u64_counter(l_c_read_hit, "read_hit",
+		      "Buffered reads served from the object cache");
+  plb.add_u64_counter(l_c_read_miss, "read_miss",
+		      "Buffered reads that waited for OSD data");
+  plb.add_u64_counter(l_c_readahead, "readahead", "Readahead requests issued");
+  plb.add_u64_counter(l_c_readahead_bytes, "readahead_bytes",
+		      "Bytes requested by readahead");
   logger.reset(plb.create_perf_counters());
   cct->get_perfcounters_collection()->add(logger.get());
 
@@ -4186,7 +4193,10 @@ void Client::adjust_session_flushing_caps(Inode *in, MetaSession *old_s,  MetaSe
 /*
  * Flush all caps back to the MDS. Because the callers generally wait on the
  * result of this function (syncfs and umount cases), we set
- * CHECK_CAPS_SYNCHRONOUS on the last check_caps call.
+ * CHECK_CAPS_SYNCHRONOUS on the last check_caps call.  That only kicks the
+ * journal of the last inode's MDS, so every other session with flushes or
+ * unsafe requests in flight gets one mdlog flush as well, rather than
+ * leaving them to wait for the MDS tick.
  */
 void Client::flush_caps_sync()
 {
@@ -4214,6 +4224,12 @@ void Client::flush_caps_sync()
       flags |= CHECK_CAPS_SYNCHRONOUS;
     check_caps(in, flags);
   }
+
+  for (auto &q : mds_sessions) {
+    MetaSession *s = q.second;
+    if (!s->flushing_caps_tids.empty() || !s->unsafe_requests.empty())
+      flush_mdlog(s);
+  }
 }
 
 void Client::flush_caps(Inode *in, MetaSession *session, bool sync)
@@ -7543,6 +7559,22 @@ struct dentry_off_lt {
   }
 };
 
+bool Client::_readdir_should_refetch(Dir *dir,
+				     vector<Dentry*>::iterator pd, int caps)
+{
+  int threshold = cct->_conf->client_readdir_refetch_threshold;
+  if (threshold <= 0)
+    return false;
+  int stale = 0;
+  for (; pd != dir->readdir_cache.end(); ++pd) {
+    Dentry *dn = *pd;
+    if (dn->inode && !dn->inode->caps_issued_mask(caps) &&
+	++stale >= threshold)
+      return true;
+  }
+  return false;
+}
+
 int Client::_readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p,
 			      int caps, bool getref)
 {
@@ -7580,6 +7612,16 @@ int Client::_readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p,
       continue;
     }
 
+    // if several of the remaining entries lack the caps the caller
+    // wants, one readdir of the frag refreshes all of them; that beats
+    // a getattr round trip per entry
+    if (!dn->inode->caps_issued_mask(caps) &&
+	_readdir_should_refetch(dir, pd, caps)) {
+      ldout(cct, 10) << " entries from '" << dn->name << "' lack "
+		     << ccap_string(caps) << ", refetching frag" << dendl;
+      return -EAGAIN;
+    }
+
     int r = _getattr(dn->inode, caps, dirp->perms);
     if (r < 0)
       return r;
@@ -8584,7 +8626,11 @@ retry:
         unlock_fh_pos(f);
     return r;
   }
-  if (f->flags & O_DIRECT)
+  // large reads go straight to the OSDs, all objects in parallel,
+  // rather than being staged through the object cacher
+  if ((f->flags & O_DIRECT) ||
+      (conf->client_direct_read_min_bytes > 0 &&
+       size >= (uint64_t)conf->client_direct_read_min_bytes))
     have &= ~CEPH_CAP_FILE_CACHE;
 
   Mutex uninline_flock("Client::_read_uninline_data flock");
@@ -8632,8 +8678,8 @@ retry:
     if (r < 0)
       goto done;
   } else {
-    if (f->flags & O_DIRECT)
-      _flush_range(in, offset, size);
+    // no-op unless we have dirty buffers in the range
+    _flush_range(in, offset, size);
 
     bool checkeof = false;
     r = _read_sync(f, offset, size, bl, &checkeof);
@@ -8737,21 +8783,9 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
   Context *onfinish = new C_SafeCond(&flock, &cond, &done, &rvalue);
   r = objectcacher->file_read(&in->oset, &in->layout, in->snapid,
 			      off, len, bl, 0, onfinish);
-  if (r == 0) {
-    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
-    client_lock.Unlock();
-    flock.Lock();
-    while (!done)
-      cond.Wait(flock);
-    flock.Unlock();
-    client_lock.Lock();
-    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
-    r = rvalue;
-  } else {
-    // it was cached.
-    delete onfinish;
-  }
 
+  // Queue readahead before waiting on a miss so that it is in flight
+  // alongside the read the caller is blocked on.
   if(f->readahead.get_min_readahead_size() > 0) {
     pair<uint64_t, uint64_t> readahead_extent = f->readahead.update(off, len, in->size);
     if (readahead_extent.second > 0) {
@@ -8764,6 +8798,8 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
       if (r2 == 0) {
 	ldout(cct, 20) << "readahead initiated, c " << onfinish2 << dendl;
 	get_cap_ref(in, CEPH_CAP_FILE_RD | CEPH_CAP_FILE_CACHE);
+	logger->inc(l_c_readahead);
+	logger->inc(l_c_readahead_bytes, readahead_extent.second);
       } else {
 	ldout(cct, 20) << "readahead was no-op, already cached" << dendl;
 	delete onfinish2;
@@ -8771,6 +8807,23 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
     }
   }
 
+  if (r == 0) {
+    logger->inc(l_c_read_miss);
+    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
+    client_lock.Unlock();
+    flock.Lock();
+    while (!done)
+      cond.Wait(flock);
+    flock.Unlock();
+    client_lock.Lock();
+    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
+    r = rvalue;
+  } else {
+    // it was cached.
+    logger->inc(l_c_read_hit);
+    delete onfinish;
+  }
+
   return r;
 }
 
@@ -8937,6 +8990,28 @@ int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, in
 int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
                   const struct iovec *iov, int iovcnt)
 {
+  // copy into fresh buffer (since our write may be resub, async)
+  bufferlist bl;
+  if (buf) {
+    if (size > 0)
+      bl.append(buf, size);
+  } else if (iov){
+    for (int i = 0; i < iovcnt; i++) {
+      if (iov[i].iov_len > 0) {
+        bl.append((const char *)iov[i].iov_base, iov[i].iov_len);
+      }
+    }
+  }
+  return _write(f, offset, size, bl);
+}
+
+/*
+ * write a buffer the caller gave up; it is handed to the cache or the
+ * osd as is, without another copy.
+ */
+int Client::_write(Fh *f, int64_t offset, uint64_t size, bufferlist &bl)
+{
+  assert(bl.length() == size);
   if ((uint64_t)(offset+size) > mdsmap->get_max_filesize()) //too large!
     return -EFBIG;
 
@@ -8993,19 +9068,6 @@ int Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
     assert(in->inline_version > 0);
   }
 
-  // copy into fresh buffer (since our write may be resub, async)
-  bufferlist bl;
-  if (buf) {
-    if (size > 0)
-      bl.append(buf, size);
-  } else if (iov){
-    for (int i = 0; i < iovcnt; i++) {
-      if (iov[i].iov_len > 0) {
-        bl.append((const char *)iov[i].iov_base, iov[i].iov_len);
-      }
-    }
-  }
-
   utime_t lat;
   uint64_t totalwritten;
   int have;
@@ -9259,10 +9321,14 @@ int Client::_fsync(Inode *in, bool syncdataonly)
   ldout(cct, 3) << "_fsync on " << *in << " " << (syncdataonly ? "(dataonly)":"(data+metadata)") << dendl;
   
   if (cct->_conf->client_oc) {
-    object_cacher_completion = new C_SafeCond(&lock, &cond, &done, &r);
-    tmp_ref = in; // take a reference; C_SafeCond doesn't and _flush won't either
-    _flush(in, object_cacher_completion);
-    ldout(cct, 15) << "using return-valued form of _fsync" << dendl;
+    if (in->oset.dirty_or_tx) {
+      object_cacher_completion = new C_SafeCond(&lock, &cond, &done, &r);
+      tmp_ref = in; // take a reference; C_SafeCond doesn't and _flush won't either
+      _flush(in, object_cacher_completion);
+      ldout(cct, 15) << "using return-valued form of _fsync" << dendl;
+    } else {
+      ldout(cct, 10) << "no data needs to commit" << dendl;
+    }
   }
   
   if (!syncdataonly && in->dirty_caps) {
@@ -9275,6 +9341,8 @@ int Client::_fsync(Inode *in, bool syncdataonly)
     MetaRequest *req = in->unsafe_ops.back();
     ldout(cct, 15) << "waiting on unsafe requests, last tid " << req->get_tid() <<  dendl;
 
+    // don't leave the request to wait for the mds journal tick
+    flush_mdlog_sync();
     req->get();
     wait_on_list(req->waitfor_safe);
     put_request(req);
@@ -9289,7 +9357,7 @@ int Client::_fsync(Inode *in, bool syncdataonly)
     lock.Unlock();
     client_lock.Lock();
     ldout(cct, 15) << "got " << r << " from flush writeback" << dendl;
-  } else {
+  } else if (!cct->_conf->client_oc) {
     // FIXME: this can starve
     while (in->cap_refs[CEPH_CAP_FILE_BUFFER] > 0) {
       ldout(cct, 10) << "ino " << in->ino << " has " << in->cap_refs[CEPH_CAP_FILE_BUFFER]
@@ -11634,11 +11702,20 @@ int Client::_unlink(Inode *dir, const char *name, const UserPerm& perm)
   req->dentry_drop = CEPH_CAP_FILE_SHARED;
   req->dentry_unless = CEPH_CAP_FILE_EXCL;
 
-  res = _lookup(dir, name, 0, &otherin, perm);
-  if (res < 0)
-    goto fail;
-  req->set_other_inode(otherin.get());
-  req->other_inode_drop = CEPH_CAP_LINK_SHARED | CEPH_CAP_LINK_EXCL;
+  // Only resolve the target locally if we have something cached to
+  // resolve it from; otherwise we hold no caps on it through this name
+  // and a lookup would just add an MDS round trip before the unlink.
+  if (de->inode || de->lease_mds >= 0 ||
+      dir->caps_issued_mask(CEPH_CAP_FILE_SHARED)) {
+    res = _lookup(dir, name, 0, &otherin, perm);
+    if (res < 0)
+      goto fail;
+    req->set_other_inode(otherin.get());
+    req->other_inode_drop = CEPH_CAP_LINK_SHARED | CEPH_CAP_LINK_EXCL;
+  } else {
+    ldout(cct, 10) << "_unlink " << name << " not cached, skipping lookup"
+		   << dendl;
+  }
 
   req->set_inode(dir);
 
@@ -12414,6 +12491,22 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
   return r;
 }
 
+int Client::ll_write(Fh *fh, loff_t off, bufferlist &bl)
+{
+  Mutex::Locker lock(client_lock);
+  ldout(cct, 3) << "ll_write " << fh << " " << fh->inode->ino << " " << off <<
+    "~" << bl.length() << dendl;
+  tout(cct) << "ll_write" << std::endl;
+  tout(cct) << (unsigned long)fh << std::endl;
+  tout(cct) << off << std::endl;
+  tout(cct) << bl.length() << std::endl;
+
+  int r = _write(fh, off, bl.length(), bl);
+  ldout(cct, 3) << "ll_write " << fh << " " << off << "~" << bl.length()
+		<< " = " << r << dendl;
+  return r;
+}
+
 int Client::ll_flush(Fh *fh)
 {
   Mutex::Locker lock(client_lock);
@@ -81,6 +81,10 @@ enum {
   l_c_reply,
   l_c_lat,
   l_c_wrlat,
+  l_c_read_hit,
+  l_c_read_miss,
+  l_c_readahead,
+  l_c_readahead_bytes,
   l_c_last,
 };
 
@@ -744,6 +748,8 @@ private:
   void _readdir_next_frag(dir_result_t *dirp);
   void _readdir_rechoose_frag(dir_result_t *dirp);
   int _readdir_get_frag(dir_result_t *dirp);
+  bool _readdir_should_refetch(Dir *dir, vector<Dentry*>::iterator pd,
+			       int caps);
   int _readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p, int caps, bool getref);
   void _closedir(dir_result_t *dirp);
 
@@ -832,6 +838,7 @@ private:
   int _read(Fh *fh, int64_t offset, uint64_t size, bufferlist *bl);
   int _write(Fh *fh, int64_t offset, uint64_t size, const char *buf,
           const struct iovec *iov, int iovcnt);
+  int _write(Fh *fh, int64_t offset, uint64_t size, bufferlist &bl);
   int _preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write);
   int _flush(Fh *fh);
   int _fsync(Fh *fh, bool syncdataonly);
@@ -1210,6 +1217,7 @@ public:
 
   int ll_read(Fh *fh, loff_t off, loff_t len, bufferlist *bl);
   int ll_write(Fh *fh, loff_t off, loff_t len, const char *data);
+  int ll_write(Fh *fh, loff_t off, bufferlist &bl);
   loff_t ll_lseek(Fh *fh, loff_t offset, int whence);
   int ll_flush(Fh *fh);
   int ll_fsync(Fh *fh, bool syncdataonly);
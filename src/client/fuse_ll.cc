@@ -581,10 +581,32 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
-    fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+  if (r < 0) {
     fuse_reply_err(req, -r);
+    return;
+  }
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+  // hand the buffers to fuse as they are instead of flattening them;
+  // with splice enabled they are moved to the kernel through a pipe
+  if (bl.buffers().size() > 1) {
+    size_t n = bl.buffers().size();
+    std::vector<char> space(sizeof(fuse_bufvec) + (n - 1) * sizeof(fuse_buf));
+    fuse_bufvec *bufv = reinterpret_cast<fuse_bufvec*>(space.data());
+    bufv->count = n;
+    bufv->idx = 0;
+    bufv->off = 0;
+    size_t i = 0;
+    for (auto &p : bl.buffers()) {
+      fuse_buf &b = bufv->buf[i++];
+      memset(&b, 0, sizeof(b));
+      b.mem = const_cast<char*>(p.c_str());
+      b.size = p.length();
+    }
+    fuse_reply_data(req, bufv, FUSE_BUF_SPLICE_MOVE);
+    return;
+  }
+#endif
+  fuse_reply_buf(req, bl.c_str(), bl.length());
 }
 
 static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
@@ -599,6 +621,36 @@ static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
     fuse_reply_err(req, -r);
 }
 
+#if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
+static void fuse_ll_write_buf(fuse_req_t req, fuse_ino_t ino,
+			      struct fuse_bufvec *bufv, off_t off,
+			      struct fuse_file_info *fi)
+{
+  CephFuse::Handle *cfuse = fuse_ll_req_prepare(req);
+  Fh *fh = reinterpret_cast<Fh*>(fi->fh);
+
+  // pull the data (possibly spliced into a pipe) straight into the
+  // buffer the client keeps, so it is copied once
+  size_t size = fuse_buf_size(bufv);
+  bufferptr bp(buffer::create_page_aligned(size));
+  fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+  dst.buf[0].mem = bp.c_str();
+  ssize_t got = fuse_buf_copy(&dst, bufv, (fuse_buf_copy_flags)0);
+  if (got < 0) {
+    fuse_reply_err(req, -got);
+    return;
+  }
+  bp.set_length(got);
+  bufferlist bl;
+  bl.append(std::move(bp));
+  int r = cfuse->client->ll_write(fh, off, bl);
+  if (r >= 0)
+    fuse_reply_write(req, r);
+  else
+    fuse_reply_err(req, -r);
+}
+#endif
+
 static void fuse_ll_flush(fuse_req_t req, fuse_ino_t ino,
 			  struct fuse_file_info *fi)
 {
@@ -931,6 +983,15 @@ static void do_init(void *data, fuse_conn_info *conn)
   }
 #endif
 
+#ifdef FUSE_CAP_SPLICE_READ
+  if (client->cct->_conf->fuse_splice) {
+    if (conn->capable & FUSE_CAP_SPLICE_READ)
+      conn->want |= FUSE_CAP_SPLICE_READ;
+    if (conn->capable & FUSE_CAP_SPLICE_WRITE)
+      conn->want |= FUSE_CAP_SPLICE_WRITE;
+  }
+#endif
+
   if (cfuse->fd_on_success) {
     //cout << "fuse init signaling on fd " << fd_on_success << std::endl;
     // see Preforker::daemonize(), ceph-fuse's parent process expects a `-1`
@@ -995,7 +1056,7 @@ const static struct fuse_lowlevel_ops fuse_ll_oper = {
  poll: 0,
 #endif
 #if FUSE_VERSION >= FUSE_MAKE_VERSION(2, 9)
- write_buf: 0,
+ write_buf: fuse_ll_write_buf,
  retrieve_reply: 0,
  forget_multi: 0,
  flock: fuse_ll_flock,
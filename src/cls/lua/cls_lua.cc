@@ -3,8 +3,12 @@
  */
 #include <errno.h>
 #include <setjmp.h>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <lua.hpp>
 #include "include/types.h"
 #include "objclass/objclass.h"
@@ -825,6 +829,87 @@ static int unpack_json_command(lua_State *L, struct clslua_hctx *ctx,
   return 0;
 }
 
+/*
+ * Compiled chunk cache. Clients resend the same script on every call, so
+ * keep the bytecode of recently used scripts and skip the parser on a hit.
+ * Entries are keyed by the full script text and shared by every PG in the
+ * OSD. Only compiled code is shared: each call still runs in a fresh Lua
+ * state, so globals set by one call are never seen by another.
+ */
+#define CLSLUA_CHUNK_CACHE_MAX 128
+
+struct clslua_chunk {
+  std::shared_ptr<const std::string> bytecode;
+  std::list<const std::string*>::iterator lru_pos;
+};
+
+static std::mutex clslua_chunk_cache_lock;
+static std::unordered_map<std::string, clslua_chunk> clslua_chunk_cache;
+static std::list<const std::string*> clslua_chunk_lru; // most recent first
+
+static std::shared_ptr<const std::string> clslua_chunk_cache_get(
+    const std::string& script)
+{
+  std::lock_guard<std::mutex> l(clslua_chunk_cache_lock);
+  auto it = clslua_chunk_cache.find(script);
+  if (it == clslua_chunk_cache.end())
+    return nullptr;
+  clslua_chunk_lru.splice(clslua_chunk_lru.begin(), clslua_chunk_lru,
+      it->second.lru_pos);
+  return it->second.bytecode;
+}
+
+static void clslua_chunk_cache_put(const std::string& script,
+    std::shared_ptr<const std::string> bytecode)
+{
+  std::lock_guard<std::mutex> l(clslua_chunk_cache_lock);
+  auto r = clslua_chunk_cache.emplace(script, clslua_chunk());
+  if (!r.second)
+    return; /* raced with another compile of the same script */
+  r.first->second.bytecode = bytecode;
+  clslua_chunk_lru.push_front(&r.first->first);
+  r.first->second.lru_pos = clslua_chunk_lru.begin();
+
+  while (clslua_chunk_cache.size() > CLSLUA_CHUNK_CACHE_MAX) {
+    const std::string *victim = clslua_chunk_lru.back();
+    clslua_chunk_lru.pop_back();
+    clslua_chunk_cache.erase(*victim);
+  }
+}
+
+static int clslua_dump_writer(lua_State *L, const void *p, size_t sz, void *ud)
+{
+  std::string *out = static_cast<std::string *>(ud);
+  out->append(static_cast<const char *>(p), sz);
+  return 0;
+}
+
+/*
+ * Push the compiled script onto the stack, from the chunk cache if possible.
+ * Returns a Lua load status like luaL_loadstring.
+ */
+static int clslua_load_chunk(lua_State *L, const std::string& script)
+{
+  std::shared_ptr<const std::string> bytecode = clslua_chunk_cache_get(script);
+  if (bytecode)
+    return luaL_loadbufferx(L, bytecode->data(), bytecode->size(),
+        script.c_str(), "b");
+
+  int ret = luaL_loadstring(L, script.c_str());
+  if (ret)
+    return ret;
+
+  std::string *dumped = new std::string;
+  std::shared_ptr<const std::string> ref(dumped);
+#if LUA_VERSION_NUM >= 503
+  if (lua_dump(L, clslua_dump_writer, dumped, 0) == 0)
+#else
+  if (lua_dump(L, clslua_dump_writer, dumped) == 0)
+#endif
+    clslua_chunk_cache_put(script, ref);
+  return 0;
+}
+
 /*
  * Runs the script, and calls handler.
  */
@@ -898,7 +983,7 @@ static int clslua_eval(lua_State *L)
   lua_settable(L, LUA_REGISTRYINDEX);
 
   /* load and compile chunk */
-  if (luaL_loadstring(L, ctx->script.c_str()))
+  if (clslua_load_chunk(L, ctx->script))
     return lua_error(L);
 
   /* execute chunk */
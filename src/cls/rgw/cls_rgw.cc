@@ -380,6 +380,24 @@ static int read_bucket_header(cls_method_context_t hctx, struct rgw_bucket_dir_h
   return 0;
 }
 
+/*
+ * with a delimiter, return the common prefix that an object name rolls up
+ * into, or an empty string if it is listed on its own. names starting with
+ * '_' are escaped or namespaced in the index, so they are never rolled up.
+ */
+static string list_common_prefix(const string& name, const string& filter_prefix,
+                                 const string& delimiter)
+{
+  if (delimiter.empty() || name.empty() || name[0] == '_' ||
+      name.compare(0, filter_prefix.size(), filter_prefix) != 0)
+    return string();
+
+  size_t pos = name.find(delimiter, filter_prefix.size());
+  if (pos == string::npos)
+    return string();
+  return name.substr(0, pos + delimiter.size());
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   bufferlist::iterator iter = in->begin();
@@ -408,6 +426,11 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
   uint32_t left_to_read = op.num_entries;
   bool more;
 
+  /* a start inside a common prefix means the caller has seen it, so its
+   * settled keys are skipped */
+  string rolled_up = list_common_prefix(op.start_obj.name, op.filter_prefix,
+                                        op.delimiter);
+
   do {
     rc = get_obj_vals(hctx, start_key, op.filter_prefix, left_to_read, &keys, &more);
     if (rc < 0)
@@ -425,6 +448,13 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         break;
       }
 
+      cls_rgw_obj_key key;
+      uint64_t ver;
+      decode_list_index_key(kiter->first, &key, &ver);
+
+      start_key = kiter->first;
+      CLS_LOG(20, "start_key=%s len=%zu", start_key.c_str(), start_key.size());
+
       bufferlist& entrybl = kiter->second;
       bufferlist::iterator eiter = entrybl.begin();
       try {
@@ -434,13 +464,6 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         return -EINVAL;
       }
 
-      cls_rgw_obj_key key;
-      uint64_t ver;
-      decode_list_index_key(kiter->first, &key, &ver);
-
-      start_key = kiter->first;
-      CLS_LOG(20, "start_key=%s len=%zu", start_key.c_str(), start_key.size());
-
       if (!entry.is_valid()) {
         CLS_LOG(20, "entry %s[%s] is not valid\n", key.name.c_str(), key.instance.c_str());
         continue;
@@ -450,6 +473,31 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
         continue;
       }
+
+      /* the first settled entry under a common prefix stands for all of
+       * them, stripped to what the gateway needs to roll it up, and the
+       * other settled ones are skipped. unsettled entries, before or after
+       * it, are returned in full so the gateway can complete them */
+      bool settled = (entry.exists || entry.is_delete_marker()) &&
+                     entry.pending_map.empty();
+      if (settled && !rolled_up.empty() &&
+          key.name.compare(0, rolled_up.size(), rolled_up) == 0) {
+        continue;
+      }
+      string prefix = list_common_prefix(key.name, op.filter_prefix, op.delimiter);
+      if (!prefix.empty() && settled) {
+        struct rgw_bucket_dir_entry stripped;
+        stripped.key = entry.key;
+        stripped.ver = entry.ver;
+        stripped.exists = entry.exists;
+        stripped.index_ver = entry.index_ver;
+        stripped.flags = entry.flags;
+        stripped.versioned_epoch = entry.versioned_epoch;
+        entry = std::move(stripped);
+        rolled_up = prefix;
+        CLS_LOG(20, "rolling up prefix %s\n", prefix.c_str());
+      }
+
       if (m.size() < op.num_entries) {
         m[kiter->first] = entry;
       }
@@ -783,29 +831,20 @@ static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key, strin
   return 0;
 }
 
-int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+/*
+ * apply a single completion against the in-memory header; the caller
+ * writes the header back unless the op turned out to be a cancel
+ */
+static int complete_op(cls_method_context_t hctx, rgw_cls_obj_complete_op& op,
+                       struct rgw_bucket_dir_header& header, bool *cancelled)
 {
-  // decode request
-  rgw_cls_obj_complete_op op;
-  bufferlist::iterator iter = in->begin();
-  try {
-    ::decode(op, iter);
-  } catch (buffer::error& err) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
-    return -EINVAL;
-  }
   CLS_LOG(1, "rgw_bucket_complete_op(): request: op=%d name=%s instance=%s ver=%lu:%llu tag=%s\n",
           op.op, op.key.name.c_str(), op.key.instance.c_str(),
           (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
           op.tag.c_str());
 
-  struct rgw_bucket_dir_header header;
-  int rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
-    return -EINVAL;
-  }
-
+  *cancelled = false;
+  int rc;
   struct rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
@@ -847,6 +886,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 
   bufferlist op_bl;
   if (cancel) {
+    *cancelled = true;
     if (op.log_op && !header.syncstopped) {
       rc = log_index_operation(hctx, op.key, op.op, op.tag, entry.meta.mtime, entry.ver,
                                CLS_RGW_STATE_COMPLETE, header.ver, header.max_marker, op.bilog_flags, NULL, NULL, &op.zones_trace);
@@ -948,6 +988,75 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
   }
 
+  return 0;
+}
+
+int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_op op;
+  bufferlist::iterator iter = in->begin();
+  try {
+    ::decode(op, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  bool cancelled;
+  rc = complete_op(hctx, op, header, &cancelled);
+  if (rc < 0 || cancelled)
+    return rc;
+
+  return write_bucket_header(hctx, &header);
+}
+
+/*
+ * complete several index operations on this shard in a single call, so
+ * that they share one header update and one osd transaction.  An op that
+ * doesn't apply (unknown tag, entry already gone) is skipped, as it would
+ * have failed on its own without side effects; any other error fails the
+ * whole batch.  Entries are read back from the object, which doesn't see
+ * this call's own updates, so each op must name a different key.
+ */
+int rgw_bucket_complete_ops(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_ops op;
+  bufferlist::iterator iter = in->begin();
+  try {
+    ::decode(op, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  struct rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  for (auto& complete : op.ops) {
+    bool cancelled;
+    rc = complete_op(hctx, complete, header, &cancelled);
+    if (rc == -ENOENT || rc == -EINVAL) {
+      CLS_LOG(1, "rgw_bucket_complete_ops(): skipping name=%s instance=%s rc=%d\n",
+              complete.key.name.c_str(), complete.key.instance.c_str(), rc);
+      continue;
+    }
+    if (rc < 0)
+      return rc;
+  }
+
   return write_bucket_header(hctx, &header);
 }
 
@@ -3783,6 +3892,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bucket_update_stats;
   cls_method_handle_t h_rgw_bucket_prepare_op;
   cls_method_handle_t h_rgw_bucket_complete_op;
+  cls_method_handle_t h_rgw_bucket_complete_ops;
   cls_method_handle_t h_rgw_bucket_link_olh;
   cls_method_handle_t h_rgw_bucket_unlink_instance_op;
   cls_method_handle_t h_rgw_bucket_read_olh_log;
@@ -3832,6 +3942,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BUCKET_UPDATE_STATS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_update_stats, &h_rgw_bucket_update_stats);
   cls_register_cxx_method(h_class, RGW_BUCKET_PREPARE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_prepare_op, &h_rgw_bucket_prepare_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_op, &h_rgw_bucket_complete_op);
+  cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OPS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_ops, &h_rgw_bucket_complete_ops);
   cls_register_cxx_method(h_class, RGW_BUCKET_LINK_OLH, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_link_olh, &h_rgw_bucket_link_olh);
   cls_register_cxx_method(h_class, RGW_BUCKET_UNLINK_INSTANCE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_unlink_instance, &h_rgw_bucket_unlink_instance_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_READ_OLH_LOG, CLS_METHOD_RD, rgw_bucket_read_olh_log, &h_rgw_bucket_read_olh_log);
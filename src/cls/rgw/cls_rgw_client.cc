@@ -191,14 +191,25 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, string&
   o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OP, in);
 }
 
+void cls_rgw_bucket_complete_ops(ObjectWriteOperation& o,
+                                 const list<rgw_cls_obj_complete_op>& ops)
+{
+  bufferlist in;
+  struct rgw_cls_obj_complete_ops call;
+  call.ops = ops;
+  ::encode(call, in);
+  o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in);
+}
+
 static bool issue_bucket_list_op(librados::IoCtx& io_ctx,
     const string& oid, const cls_rgw_obj_key& start_obj, const string& filter_prefix,
-    uint32_t num_entries, bool list_versions, BucketIndexAioManager *manager,
-    struct rgw_cls_list_ret *pdata) {
+    const string& delimiter, uint32_t num_entries, bool list_versions,
+    BucketIndexAioManager *manager, struct rgw_cls_list_ret *pdata) {
   bufferlist in;
   struct rgw_cls_list_op call;
   call.start_obj = start_obj;
   call.filter_prefix = filter_prefix;
+  call.delimiter = delimiter;
   call.num_entries = num_entries;
   call.list_versions = list_versions;
   ::encode(call, in);
@@ -210,7 +221,7 @@ static bool issue_bucket_list_op(librados::IoCtx& io_ctx,
 
 int CLSRGWIssueBucketList::issue_op(int shard_id, const string& oid)
 {
-  return issue_bucket_list_op(io_ctx, oid, start_obj, filter_prefix, num_entries, list_versions, &manager, &result[shard_id]);
+  return issue_bucket_list_op(io_ctx, oid, start_obj, filter_prefix, delimiter, num_entries, list_versions, &manager, &result[shard_id]);
 }
 
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, list<string>& keep_attr_prefixes)
@@ -521,7 +532,7 @@ void cls_rgw_suggest_changes(ObjectWriteOperation& o, bufferlist& updates)
 int CLSRGWIssueGetDirHeader::issue_op(int shard_id, const string& oid)
 {
   cls_rgw_obj_key nokey;
-  return issue_bucket_list_op(io_ctx, oid, nokey, "", 0, false, &manager, &result[shard_id]);
+  return issue_bucket_list_op(io_ctx, oid, nokey, "", "", 0, false, &manager, &result[shard_id]);
 }
 
 static bool issue_resync_bi_log(librados::IoCtx& io_ctx, const string& oid, BucketIndexAioManager *manager)
@@ -318,6 +318,9 @@ void cls_rgw_bucket_complete_op(librados::ObjectWriteOperation& o, RGWModifyOp o
                                 rgw_bucket_dir_entry_meta& dir_meta,
 				list<cls_rgw_obj_key> *remove_objs, bool log_op,
                                 uint16_t bilog_op, rgw_zone_set *zones_trace);
+/* complete several ops on one index shard; each must name a different key */
+void cls_rgw_bucket_complete_ops(librados::ObjectWriteOperation& o,
+                                 const list<rgw_cls_obj_complete_op>& ops);
 
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, list<string>& keep_attr_prefixes);
 void cls_rgw_obj_store_pg_ver(librados::ObjectWriteOperation& o, const string& attr);
@@ -370,6 +373,7 @@ class CLSRGWIssueBucketList : public CLSRGWConcurrentIO {
   uint32_t num_entries;
   bool list_versions;
   map<int, rgw_cls_list_ret>& result;
+  string delimiter;
 protected:
   int issue_op(int shard_id, const string& oid) override;
 public:
@@ -378,9 +382,11 @@ public:
                         bool _list_versions,
                         map<int, string>& oids,
                         map<int, struct rgw_cls_list_ret>& list_results,
-                        uint32_t max_aio) :
+                        uint32_t max_aio,
+                        const string& _delimiter = string()) :
   CLSRGWConcurrentIO(io_ctx, oids, max_aio),
-  start_obj(_start_obj), filter_prefix(_filter_prefix), num_entries(_num_entries), list_versions(_list_versions), result(list_results) {}
+  start_obj(_start_obj), filter_prefix(_filter_prefix), num_entries(_num_entries), list_versions(_list_versions), result(list_results),
+  delimiter(_delimiter) {}
 };
 
 class CLSRGWIssueBILogList : public CLSRGWConcurrentIO {
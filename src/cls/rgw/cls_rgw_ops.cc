@@ -150,6 +150,31 @@ void rgw_cls_obj_complete_op::dump(Formatter *f) const
   ::encode_json("zones_trace", zones_trace, f);
 }
 
+void rgw_cls_obj_complete_ops::generate_test_instances(list<rgw_cls_obj_complete_ops*>& o)
+{
+  rgw_cls_obj_complete_ops *op = new rgw_cls_obj_complete_ops;
+  list<rgw_cls_obj_complete_op *> l;
+  rgw_cls_obj_complete_op::generate_test_instances(l);
+  for (auto i : l) {
+    op->ops.push_back(*i);
+    delete i;
+  }
+  o.push_back(op);
+
+  o.push_back(new rgw_cls_obj_complete_ops);
+}
+
+void rgw_cls_obj_complete_ops::dump(Formatter *f) const
+{
+  f->open_array_section("ops");
+  for (auto& op : ops) {
+    f->open_object_section("op");
+    op.dump(f);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void rgw_cls_link_olh_op::generate_test_instances(list<rgw_cls_link_olh_op*>& o)
 {
   rgw_cls_link_olh_op *op = new rgw_cls_link_olh_op;
@@ -290,6 +315,11 @@ void rgw_cls_list_op::generate_test_instances(list<rgw_cls_list_op*>& o)
   op->num_entries = 100;
   op->filter_prefix = "filter_prefix";
   o.push_back(op);
+  op = new rgw_cls_list_op;
+  op->num_entries = 100;
+  op->filter_prefix = "dir/";
+  op->delimiter = "/";
+  o.push_back(op);
   o.push_back(new rgw_cls_list_op);
 }
 
@@ -297,6 +327,7 @@ void rgw_cls_list_op::dump(Formatter *f) const
 {
   f->dump_string("start_obj", start_obj.name);
   f->dump_unsigned("num_entries", num_entries);
+  f->dump_string("delimiter", delimiter);
 }
 
 void rgw_cls_list_ret::generate_test_instances(list<rgw_cls_list_ret*>& o)
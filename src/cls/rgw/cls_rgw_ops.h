@@ -162,6 +162,25 @@ struct rgw_cls_obj_complete_op
 };
 WRITE_CLASS_ENCODER(rgw_cls_obj_complete_op)
 
+struct rgw_cls_obj_complete_ops
+{
+  list<rgw_cls_obj_complete_op> ops;
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(ops, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator &bl) {
+    DECODE_START(1, bl);
+    ::decode(ops, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<rgw_cls_obj_complete_ops*>& o);
+};
+WRITE_CLASS_ENCODER(rgw_cls_obj_complete_ops)
+
 struct rgw_cls_link_olh_op {
   cls_rgw_obj_key key;
   string olh_tag;
@@ -383,19 +402,23 @@ struct rgw_cls_list_op
   uint32_t num_entries;
   string filter_prefix;
   bool list_versions;
+  /* if set, keys sharing a common prefix (up to and including the delimiter
+   * after filter_prefix) are rolled up into a single stripped entry */
+  string delimiter;
 
   rgw_cls_list_op() : num_entries(0), list_versions(false) {}
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(5, 4, bl);
+    ENCODE_START(6, 4, bl);
     ::encode(num_entries, bl);
     ::encode(filter_prefix, bl);
     ::encode(start_obj, bl);
     ::encode(list_versions, bl);
+    ::encode(delimiter, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::iterator &bl) {
-    DECODE_START_LEGACY_COMPAT_LEN(5, 2, 2, bl);
+    DECODE_START_LEGACY_COMPAT_LEN(6, 2, 2, bl);
     if (struct_v < 4) {
       ::decode(start_obj.name, bl);
     }
@@ -406,6 +429,8 @@ struct rgw_cls_list_op
       ::decode(start_obj, bl);
     if (struct_v >= 5)
       ::decode(list_versions, bl);
+    if (struct_v >= 6)
+      ::decode(delimiter, bl);
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
@@ -4,6 +4,7 @@
 #ifndef CEPH_OS_BLUESTORE_CHECKSUMMER
 #define CEPH_OS_BLUESTORE_CHECKSUMMER
 
+#include "include/crc32c.h"
 #include "xxHash/xxhash.h"
 
 class Checksummer {
@@ -17,6 +18,10 @@ public:
     CSUM_CRC32C_8 = 6,  // low 8 bits of crc32c
     CSUM_MAX,
   };
+
+  /// max csum blocks handed to Alg::calc_multi() in one call
+  static const size_t MULTI_MAX = 64;
+
   static const char *get_csum_type_string(unsigned t) {
     switch (t) {
     case CSUM_NONE: return "none";
@@ -86,6 +91,23 @@ public:
       ) {
       return p.crc32c(len, init_value);
     }
+
+    static void calc_multi(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      size_t count,
+      const char *data,
+      value_t *out
+      ) {
+      uint32_t crc[MULTI_MAX];
+      assert(count <= MULTI_MAX);
+      ceph_crc32c_multi(init_value, (const unsigned char *)data, len, count,
+			crc);
+      for (size_t i = 0; i < count; ++i) {
+	out[i] = crc[i];
+      }
+    }
   };
 
   struct crc32c_16 {
@@ -107,6 +129,23 @@ public:
       ) {
       return p.crc32c(len, init_value) & 0xffff;
     }
+
+    static void calc_multi(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      size_t count,
+      const char *data,
+      value_t *out
+      ) {
+      uint32_t crc[MULTI_MAX];
+      assert(count <= MULTI_MAX);
+      ceph_crc32c_multi(init_value, (const unsigned char *)data, len, count,
+			crc);
+      for (size_t i = 0; i < count; ++i) {
+	out[i] = crc[i] & 0xffff;
+      }
+    }
   };
 
   struct crc32c_8 {
@@ -128,6 +167,23 @@ public:
       ) {
       return p.crc32c(len, init_value) & 0xff;
     }
+
+    static void calc_multi(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      size_t count,
+      const char *data,
+      value_t *out
+      ) {
+      uint32_t crc[MULTI_MAX];
+      assert(count <= MULTI_MAX);
+      ceph_crc32c_multi(init_value, (const unsigned char *)data, len, count,
+			crc);
+      for (size_t i = 0; i < count; ++i) {
+	out[i] = crc[i] & 0xff;
+      }
+    }
   };
 
   struct xxhash32 {
@@ -157,6 +213,20 @@ public:
       }
       return XXH32_digest(state);
     }
+
+    static void calc_multi(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      size_t count,
+      const char *data,
+      value_t *out
+      ) {
+      for (size_t i = 0; i < count; ++i) {
+	out[i] = XXH32(data, len, init_value);
+	data += len;
+      }
+    }
   };
 
   struct xxhash64 {
@@ -186,8 +256,45 @@ public:
       }
       return XXH64_digest(state);
     }
+
+    static void calc_multi(
+      state_t state,
+      init_value_t init_value,
+      size_t len,
+      size_t count,
+      const char *data,
+      value_t *out
+      ) {
+      for (size_t i = 0; i < count; ++i) {
+	out[i] = XXH64(data, len, init_value);
+	data += len;
+      }
+    }
   };
 
+  /**
+   * how many whole csum blocks can be taken from p without crossing
+   * a buffer boundary, capped at MULTI_MAX and the remaining length.
+   * Returns 0 if batching is not worth it.
+   */
+  static size_t get_multi_blocks(
+    size_t csum_block_size,
+    size_t length,
+    const bufferlist::const_iterator& p) {
+    if (length < csum_block_size * 2) {
+      return 0;
+    }
+    size_t n = std::min<size_t>(p.get_current_ptr().length(), length) /
+      csum_block_size;
+    if (n < 2) {
+      return 0;
+    }
+    if (n > MULTI_MAX) {
+      n = MULTI_MAX;
+    }
+    return n;
+  }
+
   template<class Alg>
   static int calculate(
     size_t csum_block_size,
@@ -221,9 +328,20 @@ public:
     typename Alg::value_t *pv =
       reinterpret_cast<typename Alg::value_t*>(csum_data->c_str());
     pv += offset / csum_block_size;
-    while (blocks--) {
+    while (blocks) {
+      size_t n = get_multi_blocks(csum_block_size,
+				  blocks * csum_block_size, p);
+      if (n) {
+	const char *data;
+	p.get_ptr_and_advance(n * csum_block_size, &data);
+	Alg::calc_multi(state, init_value, csum_block_size, n, data, pv);
+	pv += n;
+	blocks -= n;
+	continue;
+      }
       *pv = Alg::calc(state, init_value, csum_block_size, p);
       ++pv;
+      --blocks;
     }
     Alg::fini(&state);
     return 0;
@@ -249,7 +367,28 @@ public:
       reinterpret_cast<const typename Alg::value_t*>(csum_data.c_str());
     pv += offset / csum_block_size;
     size_t pos = offset;
+    typename Alg::value_t vals[MULTI_MAX];
     while (length > 0) {
+      // verify a run of blocks within one contiguous buffer in one go
+      size_t n = get_multi_blocks(csum_block_size, length, p);
+      if (n) {
+	const char *data;
+	p.get_ptr_and_advance(n * csum_block_size, &data);
+	Alg::calc_multi(state, -1, csum_block_size, n, data, vals);
+	for (size_t i = 0; i < n; ++i) {
+	  if (pv[i] != vals[i]) {
+	    if (bad_csum) {
+	      *bad_csum = vals[i];
+	    }
+	    Alg::fini(&state);
+	    return pos + i * csum_block_size;
+	  }
+	}
+	pv += n;
+	pos += n * csum_block_size;
+	length -= n * csum_block_size;
+	continue;
+      }
       typename Alg::value_t v = Alg::calc(state, -1, csum_block_size, p);
       if (*pv != v) {
 	if (bad_csum) {
@@ -110,3 +110,42 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+
+ShardedFinisher::ShardedFinisher(CephContext *cct, unsigned n,
+				 const string& name, const string& tn)
+{
+  assert(n > 0);
+  for (unsigned i = 0; i < n; ++i) {
+    ostringstream oss;
+    oss << name << "-" << i;
+    finishers.push_back(new Finisher(cct, oss.str(), tn));
+  }
+}
+
+ShardedFinisher::~ShardedFinisher()
+{
+  for (auto f : finishers) {
+    delete f;
+  }
+}
+
+void ShardedFinisher::start()
+{
+  for (auto f : finishers) {
+    f->start();
+  }
+}
+
+void ShardedFinisher::stop()
+{
+  for (auto f : finishers) {
+    f->stop();
+  }
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  for (auto f : finishers) {
+    f->wait_for_empty();
+  }
+}
@@ -163,6 +163,42 @@ class Finisher {
   }
 };
 
+/**
+ * A set of Finishers, each with its own thread.  Contexts are queued
+ * with an ordering key: those with the same key complete on the same
+ * thread, in order, while different keys complete in parallel, so one
+ * slow callback only holds up its own key.  Each shard is a named
+ * Finisher, so its queue depth shows up as finisher-<name>-<i>.
+ */
+class ShardedFinisher {
+  vector<Finisher*> finishers;
+
+public:
+  ShardedFinisher(CephContext *cct, unsigned n, const string& name,
+		  const string& tn);
+  ~ShardedFinisher();
+
+  unsigned size() const {
+    return finishers.size();
+  }
+  Finisher *get(uint64_t key) {
+    return finishers[key % finishers.size()];
+  }
+
+  void queue(uint64_t key, Context *c, int r = 0) {
+    get(key)->queue(c, r);
+  }
+  template <typename T>
+  void queue(uint64_t key, T& ls) {
+    get(key)->queue(ls);
+  }
+
+  void start();
+  void stop();
+  /// wait for every shard to drain
+  void wait_for_empty();
+};
+
 /// Context that is completed asynchronously on the supplied finisher.
 class C_OnFinisher : public Context {
   Context *con;
@@ -90,6 +90,16 @@ void Formatter::flush(bufferlist &bl)
   bl.append(os.str());
 }
 
+void Formatter::maybe_stream()
+{
+  if (!m_stream_sink || (size_t)get_len() < m_stream_min_chunk)
+    return;
+  bufferlist bl;
+  flush(bl);
+  if (bl.length())
+    m_stream_sink(bl);
+}
+
 void Formatter::dump_format(const char *name, const char *fmt, ...)
 {
   va_list ap;
@@ -131,6 +141,15 @@ void JSONFormatter::flush(std::ostream& os)
   m_ss.str("");
 }
 
+void JSONFormatter::flush(bufferlist &bl)
+{
+  // skip the intermediate stream; large dumps are copied once
+  finish_pending_string();
+  bl.append(m_ss.str());
+  m_ss.clear();
+  m_ss.str("");
+}
+
 void JSONFormatter::reset()
 {
   m_stack.clear();
@@ -239,6 +258,7 @@ void JSONFormatter::close_section()
   m_stack.pop_back();
   if (m_pretty && m_stack.empty())
     m_ss << "\n";
+  maybe_stream();
 }
 
 void JSONFormatter::finish_pending_string()
@@ -298,7 +318,9 @@ void JSONFormatter::dump_format_va(const char *name, const char *ns, bool quoted
 
 int JSONFormatter::get_len() const
 {
-  return m_ss.str().size();
+  // tellp() is not const, but does not change the stream; this avoids
+  // copying the whole buffered document
+  return const_cast<std::stringstream&>(m_ss).tellp();
 }
 
 void JSONFormatter::write_raw_data(const char *data)
@@ -401,6 +423,7 @@ void XMLFormatter::close_section()
   m_ss << "</" << section << ">";
   if (m_pretty)
     m_ss << "\n";
+  maybe_stream();
 }
 
 void XMLFormatter::dump_unsigned(const char *name, uint64_t u)
@@ -494,7 +517,7 @@ void XMLFormatter::dump_format_va(const char* name, const char *ns, bool quoted,
 
 int XMLFormatter::get_len() const
 {
-  return m_ss.str().size();
+  return const_cast<std::stringstream&>(m_ss).tellp();
 }
 
 void XMLFormatter::write_raw_data(const char *data)
@@ -7,6 +7,7 @@
 #include "include/buffer_fwd.h"
 
 #include <deque>
+#include <functional>
 #include <list>
 #include <vector>
 #include <stdarg.h>
@@ -38,9 +39,20 @@ namespace ceph {
     virtual ~Formatter();
 
     virtual void flush(std::ostream& os) = 0;
-    void flush(bufferlist &bl);
+    virtual void flush(bufferlist &bl);
     virtual void reset() = 0;
 
+    /**
+     * Stream output instead of buffering the whole document: whenever a
+     * section closes with at least min_chunk bytes pending, they are
+     * flushed to sink.  A final flush() returns whatever remains.
+     */
+    void set_stream_sink(std::function<void(bufferlist&)> sink,
+			 size_t min_chunk) {
+      m_stream_sink = std::move(sink);
+      m_stream_min_chunk = min_chunk;
+    }
+
     virtual void set_status(int status, const char* status_name) = 0;
     virtual void output_header() = 0;
     virtual void output_footer() = 0;
@@ -84,6 +96,14 @@ namespace ceph {
     {
       dump_string(name, s);
     }
+
+  protected:
+    /// pass pending output to the stream sink, if any, once it is big enough
+    void maybe_stream();
+
+  private:
+    std::function<void(bufferlist&)> m_stream_sink;
+    size_t m_stream_min_chunk = 0;
   };
 
   class JSONFormatter : public Formatter {
@@ -94,7 +114,7 @@ namespace ceph {
     void output_header() override {};
     void output_footer() override {};
     void flush(std::ostream& os) override;
-    using Formatter::flush; // don't hide Formatter::flush(bufferlist &bl)
+    void flush(bufferlist &bl) override;
     void reset() override;
     void open_array_section(const char *name) override;
     void open_array_section_in_ns(const char *name, const char *ns) override;
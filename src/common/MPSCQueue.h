@@ -0,0 +1,89 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_MPSCQUEUE_H
+#define CEPH_COMMON_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+/**
+ * MPSCQueue - lock-free multi-producer, single-consumer queue
+ *
+ * Producers push onto an atomic singly-linked stack with a CAS loop.
+ * The consumer takes the whole stack with a single exchange and walks
+ * it oldest-first, so items pushed by any one producer (and, more
+ * generally, items in their linearization order) are delivered in FIFO
+ * order.  Only one thread may call drain() at a time; callers are
+ * expected to provide that exclusion themselves (e.g., with the lock
+ * that protects whatever the items are drained into).
+ */
+template <typename T>
+class MPSCQueue {
+  struct Node {
+    T item;
+    Node *next = nullptr;
+    explicit Node(T&& i) : item(std::move(i)) {}
+  };
+  std::atomic<Node*> head = {nullptr};
+
+public:
+  MPSCQueue() = default;
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+  ~MPSCQueue() {
+    drain([](T&&) {});
+  }
+
+  /// push an item; returns true if the queue was empty before
+  bool push(T item) {
+    Node *n = new Node(std::move(item));
+    Node *old = head.load(std::memory_order_relaxed);
+    do {
+      n->next = old;
+    } while (!head.compare_exchange_weak(old, n,
+					 std::memory_order_seq_cst,
+					 std::memory_order_relaxed));
+    return old == nullptr;
+  }
+
+  /// note: seq_cst, so a consumer may publish that it is about to sleep
+  /// and then check empty() without missing a concurrent push()
+  bool empty() const {
+    return head.load() == nullptr;
+  }
+
+  /// hand every queued item to f, oldest first; returns number drained
+  template <typename F>
+  unsigned drain(F&& f) {
+    Node *n = head.exchange(nullptr, std::memory_order_acquire);
+    // reverse the stack into fifo order
+    Node *fifo = nullptr;
+    while (n) {
+      Node *next = n->next;
+      n->next = fifo;
+      fifo = n;
+      n = next;
+    }
+    unsigned count = 0;
+    while (fifo) {
+      Node *next = fifo->next;
+      f(std::move(fifo->item));
+      delete fifo;
+      fifo = next;
+      ++count;
+    }
+    return count;
+  }
+};
+
+#endif
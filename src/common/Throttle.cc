@@ -35,6 +35,7 @@ enum {
   l_throttle_put,
   l_throttle_put_sum,
   l_throttle_wait,
+  l_throttle_wait_hist,
   l_throttle_last,
 };
 
@@ -62,6 +63,26 @@ Throttle::Throttle(CephContext *cct, const std::string& n, int64_t m,
     b.add_u64_counter(l_throttle_put_sum, "put_sum", "Put data");
     b.add_time_avg(l_throttle_wait, "wait", "Waiting latency");
 
+    // wait in nanoseconds, amount requested, both on a log2 scale
+    PerfHistogramCommon::axis_config_d wait_axis_config{
+      "Wait (usec)",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      10000,                         ///< 10usec buckets
+      24,
+    };
+    PerfHistogramCommon::axis_config_d amount_axis_config{
+      "Amount requested",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      1,
+      32,
+    };
+    b.add_u64_counter_histogram(
+      l_throttle_wait_hist, "wait_histogram",
+      wait_axis_config, amount_axis_config,
+      "Histogram of blocked get wait + amount requested");
+
     logger = { b.create_perf_counters(), cct };
     cct->get_perfcounters_collection()->add(logger.get());
     logger->set(l_throttle_max, max);
@@ -93,8 +114,12 @@ bool Throttle::_wait(int64_t c, UNIQUE_LOCK_T(lock)& l)
   if (_should_wait(c) || !conds.empty()) { // always wait behind other waiters.
     {
       auto cv = conds.emplace(conds.end());
+      // a lockless put() that misses this increment must have dropped
+      // count before our predicate below reads it
+      ++waiters;
       auto w = make_scope_guard([this, cv]() {
 	  conds.erase(cv);
+	  --waiters;
 	});
       waited = true;
       ldout(cct, 2) << "_wait waiting..." << dendl;
@@ -105,7 +130,12 @@ bool Throttle::_wait(int64_t c, UNIQUE_LOCK_T(lock)& l)
 					    cv == conds.begin()); });
       ldout(cct, 2) << "_wait finished waiting" << dendl;
       if (logger) {
-	logger->tinc(l_throttle_wait, mono_clock::now() - start);
+	auto dur = mono_clock::now() - start;
+	logger->tinc(l_throttle_wait, dur);
+	logger->hinc(l_throttle_wait_hist,
+		     std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       dur).count(),
+		     c);
       }
     }
     // wake up the next guy
@@ -115,6 +145,19 @@ bool Throttle::_wait(int64_t c, UNIQUE_LOCK_T(lock)& l)
   return waited;
 }
 
+// take c slots without the lock if nobody is queued and they fit
+bool Throttle::_get_fast(int64_t c)
+{
+  unsigned cur = count;
+  while (!waiters) {
+    if (_should_wait(c, cur))
+      return false;
+    if (count.compare_exchange_weak(cur, cur + c))
+      return true;
+  }
+  return false;
+}
+
 bool Throttle::wait(int64_t m)
 {
   if (0 == max && 0 == m) {
@@ -137,10 +180,7 @@ int64_t Throttle::take(int64_t c)
   }
   assert(c >= 0);
   ldout(cct, 10) << "take " << c << dendl;
-  {
-    auto l = uniquely_lock(lock);
-    count += c;
-  }
+  count += c;
   if (logger) {
     logger->inc(l_throttle_take);
     logger->inc(l_throttle_take_sum, c);
@@ -161,7 +201,7 @@ bool Throttle::get(int64_t c, int64_t m)
     logger->inc(l_throttle_get_started);
   }
   bool waited = false;
-  {
+  if (m || !_get_fast(c)) {
     auto l = uniquely_lock(lock);
     if (m) {
       assert(m > 0);
@@ -188,17 +228,23 @@ bool Throttle::get_or_fail(int64_t c)
   }
 
   assert (c >= 0);
-  auto l = uniquely_lock(lock);
-  if (_should_wait(c) || !conds.empty()) {
+  bool got = _get_fast(c);
+  if (!got) {
+    auto l = uniquely_lock(lock);
+    if (!_should_wait(c) && conds.empty()) {
+      count += c;
+      got = true;
+    }
+  }
+  if (!got) {
     ldout(cct, 10) << "get_or_fail " << c << " failed" << dendl;
     if (logger) {
       logger->inc(l_throttle_get_or_fail_fail);
     }
     return false;
   } else {
-    ldout(cct, 10) << "get_or_fail " << c << " success (" << count.load()
-		   << " -> " << (count.load() + c) << ")" << dendl;
-    count += c;
+    ldout(cct, 10) << "get_or_fail " << c << " success (now "
+		   << count.load() << ")" << dendl;
     if (logger) {
       logger->inc(l_throttle_get_or_fail_success);
       logger->inc(l_throttle_get);
@@ -218,13 +264,16 @@ int64_t Throttle::put(int64_t c)
   assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.load() << " -> "
 		 << (count.load()-c) << ")" << dendl;
-  auto l = uniquely_lock(lock);
   if (c) {
-    if (!conds.empty())
-      conds.front().notify_one();
+    unsigned old = count.fetch_sub(c);
     // if count goes negative, we failed somewhere!
-    assert(static_cast<int64_t>(count) >= c);
-    count -= c;
+    assert(static_cast<int64_t>(old) >= c);
+    // only take the lock if someone may be sleeping on it; see _wait()
+    if (waiters) {
+      auto l = uniquely_lock(lock);
+      if (!conds.empty())
+	conds.front().notify_one();
+    }
     if (logger) {
       logger->inc(l_throttle_put);
       logger->inc(l_throttle_put_sum, c);
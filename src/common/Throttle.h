@@ -31,6 +31,7 @@ class Throttle {
   std::atomic<unsigned> count = { 0 }, max = { 0 };
   std::mutex lock;
   std::list<std::condition_variable> conds;
+  std::atomic<unsigned> waiters = { 0 };  ///< conds.size(), for the fast paths
   const bool use_perf;
 
 public:
@@ -39,16 +40,19 @@ public:
 
 private:
   void _reset_max(int64_t m);
-  bool _should_wait(int64_t c) const {
+  bool _should_wait(int64_t c, int64_t cur) const {
     int64_t m = max;
-    int64_t cur = count;
     return
       m &&
       ((c <= m && cur + c > m) || // normally stay under max
        (c >= m && cur > m));     // except for large c
   }
+  bool _should_wait(int64_t c) const {
+    return _should_wait(c, count);
+  }
 
   bool _wait(int64_t c, UNIQUE_LOCK_T(lock)& l);
+  bool _get_fast(int64_t c);
 
 public:
   /**
@@ -35,7 +35,7 @@ public:
 
 
 typedef std::multimap < utime_t, Context *> scheduled_map_t;
-typedef std::map < Context*, scheduled_map_t::iterator > event_lookup_map_t;
+typedef std::unordered_map < Context*, scheduled_map_t::iterator > event_lookup_map_t;
 
 SafeTimer::SafeTimer(CephContext *cct_, Mutex &l, bool safe_callbacks)
   : cct(cct_), lock(l),
@@ -91,7 +91,9 @@ void SafeTimer::timer_thread()
       events.erase(callback);
       schedule.erase(p);
       ldout(cct,10) << "timer_thread executing " << callback << dendl;
-      
+
+      // without safe callbacks only this one is taken off the schedule
+      // before dropping the lock, so that it can cancel the others
       if (!safe_callbacks)
 	lock.Unlock();
       callback->complete(0);
@@ -15,6 +15,8 @@
 #ifndef CEPH_TIMER_H
 #define CEPH_TIMER_H
 
+#include <unordered_map>
+
 #include "Cond.h"
 #include "Mutex.h"
 
@@ -36,7 +38,9 @@ class SafeTimer
   void _shutdown();
 
   std::multimap<utime_t, Context*> schedule;
-  std::map<Context*, std::multimap<utime_t, Context*>::iterator> events;
+  /// lookup for cancel_event(); hashed, as it is hit for every event
+  std::unordered_map<Context*,
+		     std::multimap<utime_t, Context*>::iterator> events;
   bool stopping;
 
   void dump(const char *caller = 0) const;
@@ -256,6 +256,8 @@ bool OpTracker::register_inflight_op(TrackedOp *i)
     sdata->ops_in_flight_sharded.push_back(*i);
     i->seq = current_seq;
   }
+  uint32_t rate = sample_rate;
+  i->sampled = rate <= 1 || current_seq % rate == 0;
   return true;
 }
 
@@ -275,7 +277,8 @@ void OpTracker::unregister_inflight_op(TrackedOp *i)
   i->_unregistered();
 
   RWLock::RLocker l(lock);
-  if (!tracking_enabled)
+  if (!tracking_enabled ||
+      (!i->sampled && i->get_duration() < history.get_slow_op_threshold()))
     delete i;
   else {
     i->state = TrackedOp::STATE_HISTORY;
@@ -361,6 +364,8 @@ bool OpTracker::check_ops_in_flight(std::vector<string> &warning_vector, int *sl
         // only those that have been shown will backoff
         i->warn_interval_multiplier *= 2;
       }
+      // keep the rest of a slow op's events even if it wasn't sampled
+      i->sampled = true;
       ++i;
     }
   }
@@ -406,7 +411,10 @@ void TrackedOp::mark_event_string(const string &event, utime_t stamp)
 
   {
     Mutex::Locker l(lock);
-    events.push_back(Event(stamp, event));
+    if (sampled || events.size() < 2)
+      events.push_back(Event(stamp, event));
+    else
+      events.back() = Event(stamp, event);
     current = events.back().c_str();
   }
   dout(6) << " seq: " << seq
@@ -424,7 +432,10 @@ void TrackedOp::mark_event(const char *event, utime_t stamp)
 
   {
     Mutex::Locker l(lock);
-    events.push_back(Event(stamp, event));
+    if (sampled || events.size() < 2)
+      events.push_back(Event(stamp, event));
+    else
+      events.back() = Event(stamp, event);
     current = event;
   }
   dout(6) << " seq: " << seq
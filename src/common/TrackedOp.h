@@ -58,6 +58,9 @@ public:
     history_slow_op_size = new_size;
     history_slow_op_threshold = new_threshold;
   }
+  uint32_t get_slow_op_threshold() const {
+    return history_slow_op_threshold;
+  }
 };
 
 struct ShardedTrackingData;
@@ -70,6 +73,7 @@ class OpTracker {
   float complaint_time;
   int log_threshold;
   bool tracking_enabled;
+  std::atomic<uint32_t> sample_rate = { 1 };  ///< keep events of 1 in N ops
   RWLock       lock;
 
 public:
@@ -90,6 +94,14 @@ public:
     RWLock::WLocker l(lock);
     tracking_enabled = enable;
   }
+  /**
+   * Record the full event list for only one in every @p rate ops.  The
+   * others keep just their initial and latest event, and only go into
+   * the op history if they turn out to be slow.
+   */
+  void set_sample_rate(uint32_t rate) {
+    sample_rate = rate;
+  }
   bool dump_ops_in_flight(Formatter *f, bool print_only_blocked = false, set<string> filters = {""});
   bool dump_historic_ops(Formatter *f, bool by_duration = false, set<string> filters = {""});
   bool dump_historic_slow_ops(Formatter *f, set<string> filters = {""});
@@ -188,6 +200,9 @@ protected:
 
   uint32_t warn_interval_multiplier = 1; //< limits output of a given op warning
 
+  /// record every event; otherwise only the latest one is kept
+  std::atomic<bool> sampled = {true};
+
   enum {
     STATE_UNTRACKED = 0,
     STATE_LIVE,
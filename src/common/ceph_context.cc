@@ -85,6 +85,7 @@ public:
   const char** get_tracked_conf_keys() const override {
     static const char *KEYS[] = {
       "mempool_debug",
+      "mempool_slab_pools",
       NULL
     };
     return KEYS;
@@ -95,6 +96,16 @@ public:
     if (changed.count("mempool_debug")) {
       mempool::set_debug_mode(cct->_conf->mempool_debug);
     }
+    if (changed.count("mempool_slab_pools")) {
+      std::list<std::string> names;
+      get_str_list(cct->_conf->mempool_slab_pools, names);
+      for (size_t i = 0; i < mempool::num_pools; ++i) {
+	auto ix = (mempool::pool_index_t)i;
+	bool slab = std::find(names.begin(), names.end(),
+			      mempool::get_pool_name(ix)) != names.end();
+	mempool::get_pool(ix).set_use_slab(slab);
+      }
+    }
   }
 
   // AdminSocketHook
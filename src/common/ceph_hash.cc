@@ -19,18 +19,13 @@
 		c = c - a;  c = c - b;  c = c ^ (b >> 15);	\
 	} while (0)
 
-unsigned ceph_str_hash_rjenkins(const char *str, unsigned length)
+/*
+ * mix the rest of a key into a, b, c: the remaining 12-byte blocks, then
+ * the last 11 bytes and the total length
+ */
+static inline __u32 rjenkins_finish(const unsigned char *k, __u32 len,
+				    __u32 length, __u32 a, __u32 b, __u32 c)
 {
-	const unsigned char *k = (const unsigned char *)str;
-	__u32 a, b, c;  /* the internal state */
-	__u32 len;      /* how many key bytes still need mixing */
-
-	/* Set up the internal state */
-	len = length;
-	a = 0x9e3779b9;      /* the golden ratio; an arbitrary value */
-	b = a;
-	c = 0;               /* variable initialization of internal state */
-
 	/* handle most of the key */
 	while (len >= 12) {
 		a = a + (k[0] + ((__u32)k[1] << 8) + ((__u32)k[2] << 16) +
@@ -77,6 +72,109 @@ unsigned ceph_str_hash_rjenkins(const char *str, unsigned length)
 	return c;
 }
 
+unsigned ceph_str_hash_rjenkins(const char *str, unsigned length)
+{
+	/* Set up the internal state */
+	__u32 a = 0x9e3779b9;      /* the golden ratio; an arbitrary value */
+	return rjenkins_finish((const unsigned char *)str, length, length,
+			       a, a, 0);
+}
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+/* mix() on four lanes at once */
+#define mix_x4(a, b, c)							\
+	do {								\
+		a = _mm_sub_epi32(a, b); a = _mm_sub_epi32(a, c);	\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 13));		\
+		b = _mm_sub_epi32(b, c); b = _mm_sub_epi32(b, a);	\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 8));		\
+		c = _mm_sub_epi32(c, a); c = _mm_sub_epi32(c, b);	\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 13));		\
+		a = _mm_sub_epi32(a, b); a = _mm_sub_epi32(a, c);	\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 12));		\
+		b = _mm_sub_epi32(b, c); b = _mm_sub_epi32(b, a);	\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 16));		\
+		c = _mm_sub_epi32(c, a); c = _mm_sub_epi32(c, b);	\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 5));		\
+		a = _mm_sub_epi32(a, b); a = _mm_sub_epi32(a, c);	\
+		a = _mm_xor_si128(a, _mm_srli_epi32(c, 3));		\
+		b = _mm_sub_epi32(b, c); b = _mm_sub_epi32(b, a);	\
+		b = _mm_xor_si128(b, _mm_slli_epi32(a, 10));		\
+		c = _mm_sub_epi32(c, a); c = _mm_sub_epi32(c, b);	\
+		c = _mm_xor_si128(c, _mm_srli_epi32(b, 15));		\
+	} while (0)
+
+static inline __u32 le32_at(const unsigned char *k)
+{
+	return k[0] + ((__u32)k[1] << 8) + ((__u32)k[2] << 16) +
+		((__u32)k[3] << 24);
+}
+
+/*
+ * hash four keys at a time.  the lanes share the 12-byte block loop for
+ * as many blocks as the shortest key has; each key's remaining blocks
+ * and tail are finished on its own.
+ */
+static unsigned rjenkins_x4(const char * const *strs, const unsigned *lens,
+			    unsigned *out, unsigned n)
+{
+	unsigned i;
+	for (i = 0; i + 4 <= n; i += 4) {
+		const unsigned char *k[4];
+		unsigned blocks = lens[i];
+		for (int l = 0; l < 4; l++) {
+			k[l] = (const unsigned char *)strs[i + l];
+			if (lens[i + l] < blocks)
+				blocks = lens[i + l];
+		}
+		blocks /= 12;
+
+		__m128i a = _mm_set1_epi32(0x9e3779b9);
+		__m128i b = a;
+		__m128i c = _mm_setzero_si128();
+		for (unsigned j = 0; j < blocks; j++) {
+			unsigned o = j * 12;
+			a = _mm_add_epi32(a, _mm_set_epi32(
+				le32_at(k[3] + o), le32_at(k[2] + o),
+				le32_at(k[1] + o), le32_at(k[0] + o)));
+			b = _mm_add_epi32(b, _mm_set_epi32(
+				le32_at(k[3] + o + 4), le32_at(k[2] + o + 4),
+				le32_at(k[1] + o + 4), le32_at(k[0] + o + 4)));
+			c = _mm_add_epi32(c, _mm_set_epi32(
+				le32_at(k[3] + o + 8), le32_at(k[2] + o + 8),
+				le32_at(k[1] + o + 8), le32_at(k[0] + o + 8)));
+			mix_x4(a, b, c);
+		}
+
+		__u32 va[4], vb[4], vc[4];
+		_mm_storeu_si128((__m128i *)va, a);
+		_mm_storeu_si128((__m128i *)vb, b);
+		_mm_storeu_si128((__m128i *)vc, c);
+		unsigned done = blocks * 12;
+		for (int l = 0; l < 4; l++)
+			out[i + l] = rjenkins_finish(k[l] + done,
+						     lens[i + l] - done,
+						     lens[i + l],
+						     va[l], vb[l], vc[l]);
+	}
+	return i;
+}
+#endif
+
+void ceph_str_hash_rjenkins_batch(const char * const *strs,
+				  const unsigned *lens, unsigned *out,
+				  unsigned n)
+{
+	unsigned i = 0;
+#if defined(__SSE2__)
+	i = rjenkins_x4(strs, lens, out, n);
+#endif
+	for (; i < n; i++)
+		out[i] = ceph_str_hash_rjenkins(strs[i], lens[i]);
+}
+
 /*
  * linux dcache hash
  */
@@ -104,6 +202,19 @@ unsigned ceph_str_hash(int type, const char *s, unsigned len)
 	}
 }
 
+void ceph_str_hash_batch(int type, const char * const *strs,
+			 const unsigned *lens, unsigned *out, unsigned n)
+{
+	switch (type) {
+	case CEPH_STR_HASH_RJENKINS:
+		ceph_str_hash_rjenkins_batch(strs, lens, out, n);
+		break;
+	default:
+		for (unsigned i = 0; i < n; i++)
+			out[i] = ceph_str_hash(type, strs[i], lens[i]);
+	}
+}
+
 const char *ceph_str_hash_name(int type)
 {
 	switch (type) {
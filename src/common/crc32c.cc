@@ -8,6 +8,7 @@
 #include "arch/ppc.h"
 #include "common/sctp_crc32.h"
 #include "common/crc32c_intel_fast.h"
+#include "common/crc32c_intel_multi.h"
 #include "common/crc32c_aarch64.h"
 #include "common/crc32c_ppc.h"
 
@@ -50,6 +51,34 @@ ceph_crc32c_func_t ceph_choose_crc32(void)
  */
 ceph_crc32c_func_t ceph_crc32c_func = ceph_choose_crc32();
 
+/*
+ * one buffer at a time with whatever ceph_crc32c_func we chose.
+ */
+static void ceph_crc32c_multi_generic(uint32_t crc, unsigned char const *data,
+				      unsigned length, unsigned count,
+				      uint32_t *out)
+{
+  while (count--) {
+    *out++ = ceph_crc32c(crc, data, length);
+    if (data)
+      data += length;
+  }
+}
+
+ceph_crc32c_multi_func_t ceph_choose_crc32_multi(void)
+{
+  ceph_arch_probe();
+
+#if defined(__x86_64__)
+  if (ceph_arch_intel_sse42) {
+    return ceph_crc32c_intel_multi;
+  }
+#endif
+  return ceph_crc32c_multi_generic;
+}
+
+ceph_crc32c_multi_func_t ceph_crc32c_multi_func = ceph_choose_crc32_multi();
+
 
 /*
  * Look: http://crcutil.googlecode.com/files/crc-doc.1.0.pdf
@@ -0,0 +1,79 @@
+#include "include/crc32c.h"
+#include "common/crc32c_intel_multi.h"
+
+#ifdef __x86_64__
+
+#include <string.h>
+#include <nmmintrin.h>
+
+/*
+ * The crc32 instruction has a latency of 3 cycles but a throughput of
+ * one per cycle, so a single stream leaves most of the unit idle.  When
+ * we have several independent buffers of the same length (e.g., the
+ * csum blocks of a blob) we can feed 4 of them through in lock step
+ * and keep the pipeline full.
+ */
+
+static inline uint64_t load_u64(unsigned char const *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+__attribute__((target("sse4.2")))
+static void crc32c_intel_multi_4(uint32_t crc, unsigned char const *data,
+				 unsigned length, uint32_t *out)
+{
+	unsigned char const *p0 = data;
+	unsigned char const *p1 = p0 + length;
+	unsigned char const *p2 = p1 + length;
+	unsigned char const *p3 = p2 + length;
+	uint64_t c0 = crc, c1 = crc, c2 = crc, c3 = crc;
+	unsigned words = length >> 3;
+	unsigned left = length & 7;
+
+	while (words--) {
+		c0 = _mm_crc32_u64(c0, load_u64(p0));
+		c1 = _mm_crc32_u64(c1, load_u64(p1));
+		c2 = _mm_crc32_u64(c2, load_u64(p2));
+		c3 = _mm_crc32_u64(c3, load_u64(p3));
+		p0 += 8;
+		p1 += 8;
+		p2 += 8;
+		p3 += 8;
+	}
+	while (left--) {
+		c0 = _mm_crc32_u8((uint32_t)c0, *p0++);
+		c1 = _mm_crc32_u8((uint32_t)c1, *p1++);
+		c2 = _mm_crc32_u8((uint32_t)c2, *p2++);
+		c3 = _mm_crc32_u8((uint32_t)c3, *p3++);
+	}
+	out[0] = (uint32_t)c0;
+	out[1] = (uint32_t)c1;
+	out[2] = (uint32_t)c2;
+	out[3] = (uint32_t)c3;
+}
+
+void ceph_crc32c_intel_multi(uint32_t crc, unsigned char const *data,
+			     unsigned length, unsigned count, uint32_t *out)
+{
+	if (!data) {
+		uint32_t v = ceph_crc32c(crc, NULL, length);
+		while (count--)
+			*out++ = v;
+		return;
+	}
+	while (count >= 4) {
+		crc32c_intel_multi_4(crc, data, length, out);
+		data += 4 * length;
+		out += 4;
+		count -= 4;
+	}
+	while (count--) {
+		*out++ = ceph_crc32c_func(crc, data, length);
+		data += length;
+	}
+}
+
+#endif
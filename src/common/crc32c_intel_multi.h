@@ -0,0 +1,30 @@
+#ifndef CEPH_COMMON_CRC32C_INTEL_MULTI_H
+#define CEPH_COMMON_CRC32C_INTEL_MULTI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __x86_64__
+
+extern void ceph_crc32c_intel_multi(uint32_t crc, unsigned char const *data,
+				    unsigned length, unsigned count,
+				    uint32_t *out);
+
+#else
+
+static inline void ceph_crc32c_intel_multi(uint32_t crc, unsigned char const *data,
+					   unsigned length, unsigned count,
+					   uint32_t *out)
+{
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -318,32 +318,17 @@ bool hobject_t::parse(const string &s)
   return true;
 }
 
-int cmp(const hobject_t& l, const hobject_t& r)
+int hobject_t::cmp_names(const hobject_t& l, const hobject_t& r)
 {
-  if (l.max < r.max)
-    return -1;
-  if (l.max > r.max)
-    return 1;
-  if (l.pool < r.pool)
-    return -1;
-  if (l.pool > r.pool)
-    return 1;
-  if (l.get_bitwise_key() < r.get_bitwise_key())
-    return -1;
-  if (l.get_bitwise_key() > r.get_bitwise_key())
-    return 1;
-  if (l.nspace < r.nspace)
-    return -1;
-  if (l.nspace > r.nspace)
-    return 1;
-  if (l.get_effective_key() < r.get_effective_key())
-    return -1;
-  if (l.get_effective_key() > r.get_effective_key())
-    return 1;
-  if (l.oid < r.oid)
-    return -1;
-  if (l.oid > r.oid)
-    return 1;
+  int c = l.nspace.compare(r.nspace);
+  if (c != 0)
+    return c < 0 ? -1 : 1;
+  c = l.get_effective_key().compare(r.get_effective_key());
+  if (c != 0)
+    return c < 0 ? -1 : 1;
+  c = l.oid.name.compare(r.oid.name);
+  if (c != 0)
+    return c < 0 ? -1 : 1;
   if (l.snap < r.snap)
     return -1;
   if (l.snap > r.snap)
@@ -572,22 +557,3 @@ bool ghobject_t::parse(const string& s)
   return true;
 }
 
-int cmp(const ghobject_t& l, const ghobject_t& r)
-{
-  if (l.max < r.max)
-    return -1;
-  if (l.max > r.max)
-    return 1;
-  if (l.shard_id < r.shard_id)
-    return -1;
-  if (l.shard_id > r.shard_id)
-    return 1;
-  int ret = cmp(l.hobj, r.hobj);
-  if (ret != 0)
-    return ret;
-  if (l.generation < r.generation)
-    return -1;
-  if (l.generation > r.generation)
-    return 1;
-  return 0;
-}
@@ -278,6 +278,8 @@ public:
   void decode(json_spirit::Value& v);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<hobject_t*>& o);
+  /// compare nspace, key, oid and snap; the tail of cmp()
+  static int cmp_names(const hobject_t& l, const hobject_t& r);
   friend int cmp(const hobject_t& l, const hobject_t& r);
   friend bool operator>(const hobject_t& l, const hobject_t& r) {
     return cmp(l, r) > 0;
@@ -300,8 +302,7 @@ WRITE_CLASS_ENCODER(hobject_t)
 namespace std {
   template<> struct hash<hobject_t> {
     size_t operator()(const hobject_t &r) const {
-      static rjhash<uint64_t> I;
-      return r.get_hash() ^ I(r.snap);
+      return r.get_hash() ^ rjhash<uint64_t>()(r.snap);
     }
   };
 } // namespace std
@@ -336,7 +337,24 @@ inline bool operator!=(const T&, const hobject_t &rhs) {
   return !rhs.is_max();
 }
 
-extern int cmp(const hobject_t& l, const hobject_t& r);
+/*
+ * Objects are ordered by max, pool, bitwise hash key, then the names.
+ * The leading fields are integers (the reversed hash is cached by
+ * build_hash_cache()) and decide almost every comparison in a sorted
+ * container, so they are compared inline; the names are only walked
+ * for objects that share a hash, once each.
+ */
+inline int cmp(const hobject_t& l, const hobject_t& r)
+{
+  if (l.max != r.max)
+    return l.max < r.max ? -1 : 1;
+  if (l.pool != r.pool)
+    return l.pool < r.pool ? -1 : 1;
+  uint64_t lk = l.get_bitwise_key(), rk = r.get_bitwise_key();
+  if (lk != rk)
+    return lk < rk ? -1 : 1;
+  return hobject_t::cmp_names(l, r);
+}
 template <typename T>
 static inline int cmp(const hobject_t &l, const T&) {
   static_assert(always_false<T>::value::value, "Do not compare to get_max()");
@@ -473,8 +491,7 @@ WRITE_CLASS_ENCODER(ghobject_t)
 namespace std {
   template<> struct hash<ghobject_t> {
     size_t operator()(const ghobject_t &r) const {
-      static rjhash<uint64_t> I;
-      return r.hobj.get_hash() ^ I(r.hobj.snap);
+      return r.hobj.get_hash() ^ rjhash<uint64_t>()(r.hobj.snap);
     }
   };
 } // namespace std
@@ -483,7 +500,19 @@ ostream& operator<<(ostream& out, const ghobject_t& o);
 
 WRITE_EQ_OPERATORS_4(ghobject_t, max, shard_id, hobj, generation)
 
-extern int cmp(const ghobject_t& l, const ghobject_t& r);
+inline int cmp(const ghobject_t& l, const ghobject_t& r)
+{
+  if (l.max != r.max)
+    return l.max < r.max ? -1 : 1;
+  if (l.shard_id != r.shard_id)
+    return l.shard_id < r.shard_id ? -1 : 1;
+  int ret = cmp(l.hobj, r.hobj);
+  if (ret != 0)
+    return ret;
+  if (l.generation != r.generation)
+    return l.generation < r.generation ? -1 : 1;
+  return 0;
+}
 
 
 #endif
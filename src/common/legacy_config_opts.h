@@ -107,6 +107,7 @@ OPTION(async_compressor_thread_suicide_timeout, OPT_INT)
 OPTION(plugin_crypto_accelerator, OPT_STR)
 
 OPTION(mempool_debug, OPT_BOOL)
+OPTION(mempool_slab_pools, OPT_STR) // pools using the per-thread slab cache
 
 
 
@@ -124,6 +125,13 @@ OPTION(ms_cluster_type, OPT_STR)   // messenger backend
 OPTION(ms_tcp_nodelay, OPT_BOOL)
 OPTION(ms_tcp_rcvbuf, OPT_INT)
 OPTION(ms_tcp_prefetch_max_size, OPT_INT) // max prefetch size, we limit this to avoid extra memcpy
+OPTION(ms_async_rx_buffer_pool_bytes, OPT_U64) // idle bytes each async worker keeps for message data
+OPTION(ms_async_busy_poll_us, OPT_U64) // poll for this long after the last event before blocking
+OPTION(ms_async_coalesce_max_bytes, OPT_U64) // max bytes of queued messages per send
+OPTION(ms_async_coalesce_delay_us, OPT_U64) // max delay of a send on a busy connection
+OPTION(ms_async_coalesce_min_rate, OPT_U64) // msgs/sec above which sends may be delayed
+OPTION(ms_tcp_zerocopy, OPT_BOOL) // send large messages with MSG_ZEROCOPY
+OPTION(ms_tcp_zerocopy_threshold, OPT_U64) // min bytes per send to use MSG_ZEROCOPY
 OPTION(ms_initial_backoff, OPT_DOUBLE)
 OPTION(ms_max_backoff, OPT_DOUBLE)
 OPTION(ms_crc_data, OPT_BOOL)
@@ -168,6 +176,8 @@ OPTION(ms_async_rdma_send_buffers, OPT_U32)
 //size of the receive buffer pool, 0 is unlimited
 OPTION(ms_async_rdma_receive_buffers, OPT_U32)
 // max number of wr in srq
+OPTION(ms_async_rdma_zero_copy_threshold, OPT_U64) // send buffers this large in place, 0 = always copy
+OPTION(ms_async_rdma_mr_cache_size, OPT_U64) // bytes kept registered for in-place sends
 OPTION(ms_async_rdma_receive_queue_len, OPT_U32)
 OPTION(ms_async_rdma_port_num, OPT_U32)
 OPTION(ms_async_rdma_polling_us, OPT_U32)
@@ -201,7 +211,9 @@ OPTION(mon_compact_on_trim, OPT_BOOL)       // compact (a prefix) when we trim o
 OPTION(mon_osd_cache_size, OPT_INT)  // the size of osdmaps cache, not to rely on underlying store's cache
 
 OPTION(mon_cpu_threads, OPT_INT)
+OPTION(mon_command_threads, OPT_INT)
 OPTION(mon_osd_mapping_pgs_per_chunk, OPT_INT)
+OPTION(mon_osd_mapping_incremental, OPT_BOOL) // only remap pools touched by an incremental
 OPTION(mon_osd_max_creating_pgs, OPT_INT)
 OPTION(mon_tick_interval, OPT_INT)
 OPTION(mon_session_timeout, OPT_INT)    // must send keepalive or subscribe
@@ -317,6 +329,7 @@ OPTION(mon_debug_no_require_bluestore_for_ec_overwrites, OPT_BOOL)
 OPTION(mon_debug_no_initial_persistent_features, OPT_BOOL)
 OPTION(mon_inject_transaction_delay_max, OPT_DOUBLE)      // seconds
 OPTION(mon_inject_transaction_delay_probability, OPT_DOUBLE) // range [0, 1]
+OPTION(mon_store_group_commit, OPT_BOOL) // merge queued store transactions into one write
 
 OPTION(mon_sync_provider_kill_at, OPT_INT)  // kill the sync provider at a specific point in the work flow
 OPTION(mon_sync_requester_kill_at, OPT_INT) // kill the sync requester at a specific point in the work flow
@@ -332,6 +345,7 @@ OPTION(paxos_stash_full_interval, OPT_INT)   // how often (in commits) to stash
 OPTION(paxos_max_join_drift, OPT_INT) // max paxos iterations before we must first sync the monitor stores
 OPTION(paxos_propose_interval, OPT_DOUBLE)  // gather updates for this long before proposing a map update
 OPTION(paxos_min_wait, OPT_DOUBLE)  // min time to gather updates for after period of inactivity
+OPTION(paxos_propose_backlog, OPT_INT) // queued updates that let the next proposal skip paxos_propose_interval
 OPTION(paxos_min, OPT_INT)       // minimum number of paxos states to keep around
 OPTION(paxos_trim_min, OPT_INT)  // number of extra proposals tolerated before trimming
 OPTION(paxos_trim_max, OPT_INT) // max number of extra proposals to trim at a time
@@ -369,6 +383,7 @@ OPTION(client_trace, OPT_STR)
 OPTION(client_readahead_min, OPT_LONGLONG)  // readahead at _least_ this much.
 OPTION(client_readahead_max_bytes, OPT_LONGLONG)  // default unlimited
 OPTION(client_readahead_max_periods, OPT_LONGLONG)  // as multiple of file layout period (object size * num stripes)
+OPTION(client_direct_read_min_bytes, OPT_LONGLONG)  // bypass the object cache for reads this large
 OPTION(client_reconnect_stale, OPT_BOOL)  // automatically reconnect stale session
 OPTION(client_snapdir, OPT_STR)
 OPTION(client_mountpoint, OPT_STR)
@@ -394,6 +409,7 @@ OPTION(client_metadata, OPT_STR)
 OPTION(client_acl_type, OPT_STR)
 OPTION(client_permissions, OPT_BOOL)
 OPTION(client_dirsize_rbytes, OPT_BOOL)
+OPTION(client_readdir_refetch_threshold, OPT_INT)
 
 // note: the max amount of "in flight" dirty data is roughly (max - target)
 OPTION(fuse_use_invalidate_cb, OPT_BOOL) // use fuse 2.8+ invalidate callback to keep page cache consistent
@@ -404,6 +420,7 @@ OPTION(fuse_big_writes, OPT_BOOL)
 OPTION(fuse_atomic_o_trunc, OPT_BOOL)
 OPTION(fuse_debug, OPT_BOOL)
 OPTION(fuse_multithreaded, OPT_BOOL)
+OPTION(fuse_splice, OPT_BOOL)
 OPTION(fuse_require_active_mds, OPT_BOOL) // if ceph_fuse requires active mds server
 OPTION(fuse_syncfs_on_mksnap, OPT_BOOL)
 OPTION(fuse_set_user_groups, OPT_BOOL) // if ceph_fuse fills in group lists or not
@@ -426,6 +443,10 @@ OPTION(objecter_completion_locks_per_session, OPT_U64) // num of completion lock
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL)   // suppress watch pings
 OPTION(objecter_retry_writes_after_first_reply, OPT_BOOL)   // ignore the first reply for each write, and resend the osd op instead
 OPTION(objecter_debug_inject_relock_delay, OPT_BOOL)
+OPTION(objecter_backoff_resend_burst, OPT_U32) // ops per pg resent at once after a backoff, 0 for all
+OPTION(objecter_backoff_resend_interval, OPT_FLOAT) // seconds between paced backoff resends
+OPTION(objecter_pg_mapping_cache, OPT_BOOL) // cache pg -> osd mappings per osdmap
+OPTION(objecter_mclock_service_tracker, OPT_BOOL) // send dmclock delta/rho with each op
 
 // Max number of deletes at once in a single Filer::purge call
 OPTION(filer_max_purge_ops, OPT_U32)
@@ -444,6 +465,8 @@ OPTION(mds_cache_mid, OPT_FLOAT)
 OPTION(mds_max_file_recover, OPT_U32)
 OPTION(mds_dir_max_commit_size, OPT_INT) // MB
 OPTION(mds_dir_keys_per_op, OPT_INT)
+OPTION(mds_dir_partial_fetch_min, OPT_U64)
+OPTION(mds_max_backtrace_writes, OPT_INT)
 OPTION(mds_decay_halflife, OPT_FLOAT)
 OPTION(mds_beacon_interval, OPT_FLOAT)
 OPTION(mds_beacon_grace, OPT_FLOAT)
@@ -495,6 +518,7 @@ OPTION(mds_bal_max, OPT_INT)
 OPTION(mds_bal_max_until, OPT_INT)
 OPTION(mds_bal_mode, OPT_INT)
 OPTION(mds_bal_min_rebalance, OPT_FLOAT)  // must be this much above average before we export anything
+OPTION(mds_bal_import_hold_time, OPT_FLOAT)  // don't re-export a subtree for this many seconds after importing it
 OPTION(mds_bal_min_start, OPT_FLOAT)      // if we need less than this, we don't do anything
 OPTION(mds_bal_need_min, OPT_FLOAT)       // take within this range of what we need
 OPTION(mds_bal_need_max, OPT_FLOAT)
@@ -677,10 +701,13 @@ OPTION(osd_max_markdown_period , OPT_INT)
 OPTION(osd_max_markdown_count, OPT_INT)
 
 OPTION(osd_peering_wq_threads, OPT_INT)
+OPTION(osd_load_pgs_threads, OPT_U64) // pgs loaded concurrently at startup
 OPTION(osd_peering_wq_batch_size, OPT_U64)
+OPTION(osd_peering_msg_coalesce_interval, OPT_DOUBLE) // seconds, 0 = no coalescing
 OPTION(osd_op_pq_max_tokens_per_priority, OPT_U64)
 OPTION(osd_op_pq_min_cost, OPT_U64)
 OPTION(osd_disk_threads, OPT_INT)
+OPTION(osd_async_read_threads, OPT_INT)
 OPTION(osd_disk_thread_ioprio_class, OPT_STR) // rt realtime be best effort idle
 OPTION(osd_disk_thread_ioprio_priority, OPT_INT) // 0-7
 OPTION(osd_recover_clone_overlap, OPT_BOOL)   // preserve clone_overlap during recovery/migration
@@ -690,6 +717,7 @@ OPTION(osd_op_num_threads_per_shard_ssd, OPT_INT)
 OPTION(osd_op_num_shards, OPT_INT)
 OPTION(osd_op_num_shards_hdd, OPT_INT)
 OPTION(osd_op_num_shards_ssd, OPT_INT)
+OPTION(osd_op_inline_dispatch, OPT_BOOL) // run ops on the messenger thread when the shard is idle
 
 // PrioritzedQueue (prio), Weighted Priority Queue (wpq ; default),
 // mclock_opclass, mclock_client, or debug_random. "mclock_opclass"
@@ -701,6 +729,7 @@ OPTION(osd_op_num_shards_ssd, OPT_INT)
 OPTION(osd_op_queue, OPT_STR)
 
 OPTION(osd_op_queue_cut_off, OPT_STR) // Min priority to go to strict queue. (low, high)
+OPTION(osd_op_queue_lockless_enqueue, OPT_BOOL) // enqueue to op shards without taking the shard lock
 
 // mClock priority queue parameters for five types of ops
 OPTION(osd_op_queue_mclock_client_op_res, OPT_DOUBLE)
@@ -725,6 +754,12 @@ OPTION(osd_ignore_stale_divergent_priors, OPT_BOOL) // do not assert on divergen
 // If set to true even after reading enough shards to
 // decode the object, any error will be reported.
 OPTION(osd_read_ec_check_for_errors, OPT_BOOL) // return error if any ec shard has an error
+OPTION(osd_ec_read_latency_aware, OPT_BOOL) // pick ec read shards by peer latency, hedge slow reads
+OPTION(osd_ec_read_slow_shard_ratio, OPT_DOUBLE)
+OPTION(osd_ec_read_hedge_quantile, OPT_DOUBLE)
+OPTION(osd_ec_read_hedge_min_delay, OPT_DOUBLE) // seconds
+OPTION(osd_ec_rmw_per_object_cache_invalidation, OPT_BOOL) // only block rmw on objects with in-flight uncached writes
+OPTION(osd_ec_partial_stripe_delta_writes, OPT_BOOL) // update parity from the change to the touched data chunks
 
 // Only use clone_overlap for recovery if there are fewer than
 // osd_recover_clone_overlap_limit entries in the overlap set
@@ -752,11 +787,15 @@ OPTION(osd_heartbeat_interval, OPT_INT)       // (seconds) how often we ping pee
 // This setting is read by the MONs and OSDs and has to be set to a equal value in both settings of the configuration
 OPTION(osd_heartbeat_grace, OPT_INT)
 OPTION(osd_heartbeat_min_peers, OPT_INT)     // minimum number of peers
+OPTION(osd_heartbeat_max_peers_per_host, OPT_INT) // max pg peers to ping on each remote host (0 = all)
 OPTION(osd_heartbeat_use_min_delay_socket, OPT_BOOL) // prio the heartbeat tcp socket and set dscp as CS6 on it if true
 OPTION(osd_heartbeat_min_size, OPT_INT) // the minimum size of OSD heartbeat messages to send
 
 // max number of parallel snap trims/pg
 OPTION(osd_pg_max_concurrent_snap_trims, OPT_U64)
+OPTION(osd_snap_trim_objects_per_txn, OPT_U64)
+OPTION(osd_snap_trim_max_ops_per_sec, OPT_U64)
+OPTION(osd_snap_trim_max_bytes_per_sec, OPT_U64)
 // max number of trimming pgs
 OPTION(osd_max_trimming_pgs, OPT_U64)
 
@@ -777,6 +816,11 @@ OPTION(osd_default_data_pool_replay_window, OPT_INT)
 OPTION(osd_auto_mark_unfound_lost, OPT_BOOL)
 OPTION(osd_recovery_delay_start, OPT_FLOAT)
 OPTION(osd_recovery_max_active, OPT_U64)
+OPTION(osd_recovery_auto_tune, OPT_BOOL) // steer recovery/backfill limits by client latency
+OPTION(osd_recovery_auto_tune_target_p99_ms, OPT_FLOAT)
+OPTION(osd_recovery_auto_tune_max_active, OPT_U64)
+OPTION(osd_recovery_auto_tune_max_backfills, OPT_U64)
+OPTION(osd_recovery_auto_tune_max_sleep, OPT_FLOAT)
 OPTION(osd_recovery_max_single_start, OPT_U64)
 OPTION(osd_recovery_max_chunk, OPT_U64)  // max size of push chunk
 OPTION(osd_recovery_max_omap_entries_per_chunk, OPT_U64) // max number of omap entries per chunk; 0 to disable limit
@@ -784,6 +828,8 @@ OPTION(osd_copyfrom_max_chunk, OPT_U64)   // max size of a COPYFROM chunk
 OPTION(osd_push_per_object_cost, OPT_U64)  // push cost per object
 OPTION(osd_max_push_cost, OPT_U64)  // max size of push message
 OPTION(osd_max_push_objects, OPT_U64)  // max objects in single push op
+OPTION(osd_backfill_small_object_size, OPT_U64) // backfill objects up to this size are batched
+OPTION(osd_backfill_small_object_batch, OPT_U64) // small objects backfilled per recovery op
 OPTION(osd_recovery_forget_lost_objects, OPT_BOOL)   // off for now
 OPTION(osd_max_scrubs, OPT_INT)
 OPTION(osd_scrub_during_recovery, OPT_BOOL) // Allow new scrubs to start while recovery is active on the OSD
@@ -797,6 +843,7 @@ OPTION(osd_scrub_backoff_ratio, OPT_DOUBLE)   // the probability to back off the
 OPTION(osd_scrub_chunk_min, OPT_INT)
 OPTION(osd_scrub_chunk_max, OPT_INT)
 OPTION(osd_scrub_sleep, OPT_FLOAT)   // sleep between [deep]scrub ops
+OPTION(osd_scrub_bandwidth_limit, OPT_U64) // bytes/sec read by deep scrub, 0 = unlimited
 OPTION(osd_scrub_auto_repair, OPT_BOOL)   // whether auto-repair inconsistencies upon deep-scrubbing
 OPTION(osd_scrub_auto_repair_num_errors, OPT_U32)   // only auto-repair when number of errors is below this threshold
 OPTION(osd_deep_scrub_interval, OPT_FLOAT) // once a week
@@ -811,6 +858,7 @@ OPTION(osd_check_for_log_corruption, OPT_BOOL)
 OPTION(osd_use_stale_snap, OPT_BOOL)
 OPTION(osd_rollback_to_cluster_snap, OPT_STR)
 OPTION(osd_default_notify_timeout, OPT_U32) // default notify timeout in seconds
+OPTION(osd_notify_share_payload_min_watchers, OPT_U64)
 OPTION(osd_kill_backfill_at, OPT_INT)
 
 // Bounds how infrequently a new map epoch will be persisted for a pg
@@ -848,16 +896,20 @@ OPTION(osd_debug_skip_full_check_in_recovery, OPT_BOOL)
 OPTION(osd_debug_random_push_read_error, OPT_DOUBLE)
 OPTION(osd_debug_verify_cached_snaps, OPT_BOOL)
 OPTION(osd_enable_op_tracker, OPT_BOOL) // enable/disable OSD op tracking
+OPTION(osd_op_tracker_sample_rate, OPT_U32) // keep full event history for 1 in N ops
 OPTION(osd_num_op_tracker_shard, OPT_U32) // The number of shards for holding the ops
 OPTION(osd_op_history_size, OPT_U32)    // Max number of completed ops to track
 OPTION(osd_op_history_duration, OPT_U32) // Oldest completed op to track
 OPTION(osd_op_history_slow_op_size, OPT_U32)           // Max number of slow ops to track
 OPTION(osd_op_history_slow_op_threshold, OPT_DOUBLE) // track the op if over this threshold
+OPTION(osd_client_io_stats, OPT_BOOL) // report per-client op stats to the mgr
+OPTION(osd_client_io_stats_max_entries, OPT_U64) // clients tracked per report period
 OPTION(osd_target_transaction_size, OPT_INT)     // to adjust various transactions that batch smaller items
 OPTION(osd_failsafe_full_ratio, OPT_FLOAT) // what % full makes an OSD "full" (failsafe)
 OPTION(osd_fast_fail_on_connection_refused, OPT_BOOL) // immediately mark OSDs as down once they refuse to accept connections
 
 OPTION(osd_pg_object_context_cache_count, OPT_INT)
+OPTION(osd_pg_snapset_context_cache_count, OPT_INT)
 OPTION(osd_tracing, OPT_BOOL) // true if LTTng-UST tracepoints should be enabled
 OPTION(osd_function_tracing, OPT_BOOL) // true if function instrumentation should use LTTng
 
@@ -902,6 +954,8 @@ OPTION(rocksdb_collect_compaction_stats, OPT_BOOL) //For rocksdb, this behavior
 OPTION(rocksdb_collect_extended_stats, OPT_BOOL) //For rocksdb, this behavior will be an overhead of 5%~10%, collected only rocksdb_perf is enabled.
 OPTION(rocksdb_collect_memory_stats, OPT_BOOL) //For rocksdb, this behavior will be an overhead of 5%~10%, collected only rocksdb_perf is enabled.
 OPTION(rocksdb_enable_rmrange, OPT_BOOL) // see https://github.com/facebook/rocksdb/blob/master/include/rocksdb/db.h#L253
+OPTION(rocksdb_iterator_readahead_after, OPT_U64)
+OPTION(rocksdb_iterator_readahead_size, OPT_U64)
 
 // rocksdb options that will be used for omap(if omap_backend is rocksdb)
 OPTION(filestore_rocksdb_options, OPT_STR)
@@ -963,6 +1017,8 @@ OPTION(osd_bench_duration, OPT_U32) // duration of 'osd bench', capped at 30s to
 
 OPTION(osd_blkin_trace_all, OPT_BOOL) // create a blkin trace for all osd requests
 OPTION(osdc_blkin_trace_all, OPT_BOOL) // create a blkin trace for all objecter requests
+OPTION(osd_blkin_trace_sample_rate, OPT_U64) // trace one in every N untraced osd requests
+OPTION(osdc_blkin_trace_sample_rate, OPT_U64) // trace one in every N untraced objecter requests
 
 OPTION(osd_discard_disconnected_ops, OPT_BOOL)
 
@@ -977,6 +1033,9 @@ OPTION(bdev_aio, OPT_BOOL)
 OPTION(bdev_aio_poll_ms, OPT_INT)  // milliseconds
 OPTION(bdev_aio_max_queue_depth, OPT_INT)
 OPTION(bdev_aio_reap_max, OPT_INT)
+OPTION(bdev_ioring, OPT_BOOL) // use io_uring instead of libaio
+OPTION(bdev_ioring_hipri, OPT_BOOL) // polled completion
+OPTION(bdev_ioring_sqthread_poll, OPT_BOOL) // kernel sq polling thread
 OPTION(bdev_block_size, OPT_INT)
 OPTION(bdev_debug_aio, OPT_BOOL)
 OPTION(bdev_debug_aio_suicide_timeout, OPT_FLOAT)
@@ -999,7 +1058,8 @@ OPTION(bluefs_min_flush_size, OPT_U64)  // ignore flush until its this big
 OPTION(bluefs_compact_log_sync, OPT_BOOL)  // sync or async log compaction?
 OPTION(bluefs_buffered_io, OPT_BOOL)
 OPTION(bluefs_sync_write, OPT_BOOL)
-OPTION(bluefs_allocator, OPT_STR)     // stupid | bitmap
+OPTION(bluefs_allocator, OPT_STR)     // stupid | bitmap | hbitmap
+OPTION(bluefs_db_hot_reserve_ratio, OPT_FLOAT)
 OPTION(bluefs_preextend_wal_files, OPT_BOOL)  // this *requires* that rocksdb has recycling enabled
 
 OPTION(bluestore_bluefs, OPT_BOOL)
@@ -1053,6 +1113,8 @@ OPTION(bluestore_compression_min_blob_size_ssd, OPT_U32)
 OPTION(bluestore_compression_max_blob_size, OPT_U32)
 OPTION(bluestore_compression_max_blob_size_hdd, OPT_U32)
 OPTION(bluestore_compression_max_blob_size_ssd, OPT_U32)
+OPTION(bluestore_compression_threads, OPT_INT)
+OPTION(bluestore_compression_dictionary_max_blob_size, OPT_U64)
 /*
  * Specifies minimum expected amount of saved allocation units
  * per single blob to enable compressed blobs garbage collection
@@ -1080,8 +1142,10 @@ OPTION(bluestore_extent_map_shard_target_size, OPT_U32)
 OPTION(bluestore_extent_map_shard_min_size, OPT_U32)
 OPTION(bluestore_extent_map_shard_target_size_slop, OPT_DOUBLE)
 OPTION(bluestore_extent_map_inline_shard_prealloc_size, OPT_U32)
+OPTION(bluestore_extent_map_inline_cache, OPT_BOOL) // keep encoded inline extent map in memory
 OPTION(bluestore_cache_trim_interval, OPT_DOUBLE)
 OPTION(bluestore_cache_trim_max_skip_pinned, OPT_U32) // skip this many onodes pinned in cache before we give up
+OPTION(bluestore_cache_onode_lockless_lookup, OPT_BOOL) // onode cache hits skip the cache shard lock
 OPTION(bluestore_cache_type, OPT_STR)   // lru, 2q
 OPTION(bluestore_2q_cache_kin_ratio, OPT_DOUBLE)    // kin page slot size / max page slot size
 OPTION(bluestore_2q_cache_kout_ratio, OPT_DOUBLE)   // number of kout page slot / total number of page slot
@@ -1092,19 +1156,25 @@ OPTION(bluestore_cache_meta_ratio, OPT_DOUBLE)
 OPTION(bluestore_cache_kv_ratio, OPT_DOUBLE)
 OPTION(bluestore_cache_kv_max, OPT_U64) // limit the maximum amount of cache for the kv store
 OPTION(bluestore_kvbackend, OPT_STR)
-OPTION(bluestore_allocator, OPT_STR)     // stupid | bitmap
+OPTION(bluestore_allocator, OPT_STR)     // stupid | bitmap | hbitmap
+OPTION(bluestore_alloc_snapshot, OPT_BOOL)
+OPTION(bluestore_deferred_replay_async, OPT_BOOL)
 OPTION(bluestore_freelist_blocks_per_key, OPT_INT)
 OPTION(bluestore_bitmapallocator_blocks_per_zone, OPT_INT) // must be power of 2 aligned, e.g., 512, 1024, 2048...
 OPTION(bluestore_bitmapallocator_span_size, OPT_INT) // must be power of 2 aligned, e.g., 512, 1024, 2048...
+OPTION(bluestore_hbitmap_cache_shards, OPT_U32)
+OPTION(bluestore_hbitmap_cache_refill_size, OPT_U64)
 OPTION(bluestore_max_deferred_txc, OPT_U64)
 OPTION(bluestore_rocksdb_options, OPT_STR)
 OPTION(bluestore_fsck_on_mount, OPT_BOOL)
 OPTION(bluestore_fsck_on_mount_deep, OPT_BOOL)
 OPTION(bluestore_fsck_on_umount, OPT_BOOL)
 OPTION(bluestore_fsck_on_umount_deep, OPT_BOOL)
+OPTION(bluestore_fsck_threads, OPT_INT)
 OPTION(bluestore_fsck_on_mkfs, OPT_BOOL)
 OPTION(bluestore_fsck_on_mkfs_deep, OPT_BOOL)
 OPTION(bluestore_sync_submit_transaction, OPT_BOOL) // submit kv txn in queueing thread (not kv_sync_thread)
+OPTION(bluestore_kv_sync_shards, OPT_U64) // number of kv_sync threads, partitioned by sequencer
 OPTION(bluestore_throttle_bytes, OPT_U64)
 OPTION(bluestore_throttle_deferred_bytes, OPT_U64)
 OPTION(bluestore_throttle_cost_per_io_hdd, OPT_U64)
@@ -1113,6 +1183,8 @@ OPTION(bluestore_throttle_cost_per_io, OPT_U64)
 OPTION(bluestore_deferred_batch_ops, OPT_U64)
 OPTION(bluestore_deferred_batch_ops_hdd, OPT_U64)
 OPTION(bluestore_deferred_batch_ops_ssd, OPT_U64)
+OPTION(bluestore_deferred_aggregate_max_bytes, OPT_U64) // merge deferred batches across sequencers up to this many bytes (0 = off)
+OPTION(bluestore_max_defer_interval, OPT_DOUBLE) // submit pending deferred io at least this often (seconds)
 OPTION(bluestore_nid_prealloc, OPT_INT)
 OPTION(bluestore_blobid_prealloc, OPT_U64)
 OPTION(bluestore_clone_cow, OPT_BOOL)  // do copy-on-write for clones
@@ -1127,6 +1199,7 @@ OPTION(bluestore_debug_prefragment_max, OPT_INT)
 OPTION(bluestore_debug_inject_read_err, OPT_BOOL)
 OPTION(bluestore_debug_randomize_serial_transaction, OPT_INT)
 OPTION(bluestore_debug_omit_block_device_write, OPT_BOOL)
+OPTION(bluestore_debug_omit_deferred_apply, OPT_BOOL)
 OPTION(bluestore_debug_fsck_abort, OPT_BOOL)
 OPTION(bluestore_debug_omit_kv_commit, OPT_BOOL)
 OPTION(bluestore_debug_permit_any_bdev_label, OPT_BOOL)
@@ -1144,6 +1217,7 @@ OPTION(kstore_sync_transaction, OPT_BOOL)
 OPTION(kstore_sync_submit_transaction, OPT_BOOL)
 OPTION(kstore_onode_map_size, OPT_U64)
 OPTION(kstore_default_stripe_size, OPT_INT)
+OPTION(kstore_stripe_cache_max, OPT_U64)
 
 OPTION(filestore_omap_backend, OPT_STR)
 OPTION(filestore_omap_backend_path, OPT_STR)
@@ -1304,6 +1378,7 @@ OPTION(fio_dir, OPT_STR) // fio data directory for fio-objectstore
 OPTION(rados_mon_op_timeout, OPT_DOUBLE) // how many seconds to wait for a response from the monitor before returning an error from a rados operation. 0 means no limit.
 OPTION(rados_osd_op_timeout, OPT_DOUBLE) // how many seconds to wait for a response from osds before returning an error from a rados operation. 0 means no limit.
 OPTION(rados_tracing, OPT_BOOL) // true if LTTng-UST tracepoints should be enabled
+OPTION(rados_striper_lock_lease, OPT_DOUBLE) // seconds a libradosstriper shared lock is leased for, 0 means one lock per operation
 
 OPTION(nss_db_path, OPT_STR) // path to nss db
 
@@ -1311,6 +1386,9 @@ OPTION(nss_db_path, OPT_STR) // path to nss db
 OPTION(rgw_max_chunk_size, OPT_INT)
 OPTION(rgw_put_obj_min_window_size, OPT_INT)
 OPTION(rgw_put_obj_max_window_size, OPT_INT)
+OPTION(rgw_put_obj_md5_thread_min_size, OPT_INT) // min put size to compute the md5 on a separate thread
+OPTION(rgw_compression_thread_min_size, OPT_INT) // min put size to compress on a separate thread
+OPTION(rgw_compression_max_ratio, OPT_DOUBLE) // store uncompressed if the first part compresses worse than this
 OPTION(rgw_max_put_size, OPT_U64)
 OPTION(rgw_max_put_param_size, OPT_U64) // max input size for PUT requests accepting json/xml params
 
@@ -1329,6 +1407,7 @@ OPTION(rgw_override_bucket_index_max_shards, OPT_U32)
  * Represents the maximum AIO pending requests for the bucket index object shards.
  */
 OPTION(rgw_bucket_index_max_aio, OPT_U32)
+OPTION(rgw_bucket_index_pipeline_prepare, OPT_BOOL) // write the object head while the index prepare is in flight
 
 /**
  * whether or not the quota/gc threads should be started
@@ -1342,6 +1421,8 @@ OPTION(rgw_data, OPT_STR)
 OPTION(rgw_enable_apis, OPT_STR)
 OPTION(rgw_cache_enabled, OPT_BOOL)   // rgw cache enabled
 OPTION(rgw_cache_lru_size, OPT_INT)   // num of entries in rgw cache
+OPTION(rgw_cache_shards, OPT_INT)     // num of lock stripes in rgw cache
+OPTION(rgw_cache_notify_batch, OPT_BOOL) // batch concurrent cache notifies
 OPTION(rgw_socket_path, OPT_STR)   // path to unix domain socket, if not specified, rgw will not run as external fcgi
 OPTION(rgw_host, OPT_STR)  // host for radosgw, can be an IP, default is 0.0.0.0
 OPTION(rgw_port, OPT_STR)  // port to listen, format as "8080" "5000", if not specified, rgw will not run external fcgi
@@ -1350,6 +1431,8 @@ OPTION(rgw_dns_s3website_name, OPT_STR) // hostname suffix on buckets for s3-web
 OPTION(rgw_content_length_compat, OPT_BOOL) // Check both HTTP_CONTENT_LENGTH and CONTENT_LENGTH in fcgi env
 OPTION(rgw_lifecycle_work_time, OPT_STR) //job process lc  at 00:00-06:00s
 OPTION(rgw_lc_lock_max_time, OPT_INT)  // total run time for a single lc processor work
+OPTION(rgw_lc_max_worker, OPT_INT) // number of lc worker threads
+OPTION(rgw_lc_max_wp_worker, OPT_INT) // number of objects of one listing page expired concurrently
 OPTION(rgw_lc_max_objs, OPT_INT)
 OPTION(rgw_lc_debug_interval, OPT_INT)  // Debug run interval, in seconds
 OPTION(rgw_script_uri, OPT_STR) // alternative value for SCRIPT_URI if not set in request
@@ -1385,6 +1468,7 @@ OPTION(rgw_healthcheck_disabling_path, OPT_STR) // path that existence causes th
 OPTION(rgw_s3_auth_use_rados, OPT_BOOL)  // should we try to use the internal credentials for s3?
 OPTION(rgw_s3_auth_use_keystone, OPT_BOOL)  // should we try to use keystone for s3?
 OPTION(rgw_s3_auth_aws4_force_boto2_compat, OPT_BOOL) // force aws4 auth boto2 compatibility
+OPTION(rgw_s3_auth_v4_signing_key_cache_size, OPT_INT) // max number of cached aws4 signing keys
 OPTION(rgw_barbican_url, OPT_STR)  // url for barbican server
 
 /* OpenLDAP-style LDAP parameter strings */
@@ -1412,6 +1496,7 @@ OPTION(rgw_remote_addr_param, OPT_STR)  // e.g. X-Forwarded-For, if you have a r
 OPTION(rgw_op_thread_timeout, OPT_INT)
 OPTION(rgw_op_thread_suicide_timeout, OPT_INT)
 OPTION(rgw_thread_pool_size, OPT_INT)
+OPTION(rgw_beast_io_threads, OPT_INT) // beast frontend socket i/o threads, 0 to process requests on them
 OPTION(rgw_num_control_oids, OPT_INT)
 OPTION(rgw_num_rados_handles, OPT_U32)
 OPTION(rgw_verify_ssl, OPT_BOOL) // should http_client try to verify ssl when sent https request
@@ -1428,10 +1513,11 @@ OPTION(rgw_verify_ssl, OPT_BOOL) // should http_client try to verify ssl when se
 OPTION(rgw_nfs_lru_lanes, OPT_INT)
 OPTION(rgw_nfs_lru_lane_hiwat, OPT_INT)
 OPTION(rgw_nfs_fhcache_partitions, OPT_INT)
-OPTION(rgw_nfs_fhcache_size, OPT_INT) /* 3*2017=6051 */
+OPTION(rgw_nfs_fhcache_size, OPT_INT) /* 13*2017=26221 */
 OPTION(rgw_nfs_namespace_expire_secs, OPT_INT) /* namespace invalidate
 						     * timer */
 OPTION(rgw_nfs_max_gc, OPT_INT) /* max gc events per cycle */
+OPTION(rgw_nfs_readahead_size, OPT_U64) /* sequential read prefetch */
 OPTION(rgw_nfs_write_completion_interval_s, OPT_INT) /* stateless (V3)
 							  * commit
 							  * delay */
@@ -1463,6 +1549,11 @@ OPTION(rgw_ops_log_data_backlog, OPT_INT) // max data backlog for ops log
 OPTION(rgw_fcgi_socket_backlog, OPT_INT) // socket  backlog for fcgi
 OPTION(rgw_usage_log_flush_threshold, OPT_INT) // threshold to flush pending log data
 OPTION(rgw_usage_log_tick_interval, OPT_INT) // flush pending log data every X seconds
+OPTION(rgw_usage_log_max_pending, OPT_INT) // flush inline past this many pending entries
+OPTION(rgw_ops_log_flush_interval, OPT_FLOAT) // write batched ops log every X seconds
+OPTION(rgw_ops_log_flush_bytes, OPT_U64) // flush an ops log shard early past this size
+OPTION(rgw_ops_log_max_pending_bytes, OPT_U64) // drop ops log entries past this backlog
+OPTION(rgw_ops_log_shards, OPT_U64) // number of ops log buffers
 OPTION(rgw_intent_log_object_name, OPT_STR)  // man date to see codes (a subset are supported)
 OPTION(rgw_intent_log_object_name_utc, OPT_BOOL)
 OPTION(rgw_init_timeout, OPT_INT) // time in seconds
@@ -1471,20 +1562,26 @@ OPTION(rgw_gc_max_objs, OPT_INT)
 OPTION(rgw_gc_obj_min_wait, OPT_INT)    // wait time before object may be handled by gc
 OPTION(rgw_gc_processor_max_time, OPT_INT)  // total run time for a single gc processor work
 OPTION(rgw_gc_processor_period, OPT_INT)  // gc processor cycle time
+OPTION(rgw_gc_max_concurrent_io, OPT_INT) // max tail object removals in flight
+OPTION(rgw_gc_max_trim_chunk, OPT_INT) // max tags removed from a gc shard in one op
 OPTION(rgw_s3_success_create_obj_status, OPT_INT) // alternative success status response for create-obj (0 - default)
 OPTION(rgw_resolve_cname, OPT_BOOL)  // should rgw try to resolve hostname as a dns cname record
 OPTION(rgw_obj_stripe_size, OPT_INT)
 OPTION(rgw_extended_http_attrs, OPT_STR) // list of extended attrs that can be set on objects (beyond the default)
 OPTION(rgw_exit_timeout_secs, OPT_INT) // how many seconds to wait for process to go down before exiting unconditionally
 OPTION(rgw_get_obj_window_size, OPT_INT) // window size in bytes for single get obj request
+OPTION(rgw_get_obj_max_window_size, OPT_INT) // max size the get obj window may grow to
 OPTION(rgw_get_obj_max_req_size, OPT_INT) // max length of a single get obj rados op
 OPTION(rgw_relaxed_s3_bucket_names, OPT_BOOL) // enable relaxed bucket name rules for US region buckets
 OPTION(rgw_defer_to_bucket_acls, OPT_STR) // if the user has bucket perms)
 OPTION(rgw_list_buckets_max_chunk, OPT_INT) // max buckets to retrieve in a single op when listing user buckets
+OPTION(rgw_formatter_stream_chunk_size, OPT_U64)
 OPTION(rgw_md_log_max_shards, OPT_INT) // max shards for metadata log
 OPTION(rgw_num_zone_opstate_shards, OPT_INT) // max shards for keeping inter-region copy progress info
 OPTION(rgw_opstate_ratelimit_sec, OPT_INT) // min time between opstate updates on a single upload (0 for disabling ratelimit)
 OPTION(rgw_curl_wait_timeout_ms, OPT_INT) // timeout for certain curl calls
+OPTION(rgw_curl_handle_cache_size, OPT_INT) // number of idle curl handles kept for reuse
+OPTION(rgw_data_sync_spawn_window_max, OPT_INT) // max concurrent sync operations per shard
 OPTION(rgw_copy_obj_progress, OPT_BOOL) // should dump progress during long copy operations?
 OPTION(rgw_copy_obj_progress_every_bytes, OPT_INT) // min bytes between copy progress output
 OPTION(rgw_obj_tombstone_cache_size, OPT_INT) // how many objects in tombstone cache, which is used in multi-zone sync to keep
@@ -1498,6 +1595,7 @@ OPTION(rgw_replica_log_obj_prefix, OPT_STR) //
 
 OPTION(rgw_bucket_quota_ttl, OPT_INT) // time for cached bucket stats to be cached within rgw instance
 OPTION(rgw_bucket_quota_soft_threshold, OPT_DOUBLE) // threshold from which we don't rely on cached info for quota decisions
+OPTION(rgw_quota_nonblocking_check, OPT_BOOL) // use cached quota stats and refresh them in the background
 OPTION(rgw_bucket_quota_cache_size, OPT_INT) // number of entries in bucket quota cache
 OPTION(rgw_bucket_default_quota_max_objects, OPT_INT) // number of objects allowed
 OPTION(rgw_bucket_default_quota_max_size, OPT_LONGLONG) // Max size of object in bytes
@@ -1575,6 +1673,9 @@ OPTION(rgw_crypt_s3_kms_encryption_keys, OPT_STR) // extra keys that may be used
                                                       // defined as map "key1=YmluCmJvb3N0CmJvb3N0LQ== key2=b3V0CnNyYwpUZXN0aW5nCg=="
 OPTION(rgw_crypt_suppress_logs, OPT_BOOL)   // suppress logs that might print customer key
 OPTION(rgw_list_bucket_min_readahead, OPT_INT) // minimum number of entries to read from rados for bucket listing
+OPTION(rgw_bucket_list_min_shard_entries, OPT_U64) // minimum number of entries to request per index shard when listing
+OPTION(rgw_bucket_list_server_delimiter, OPT_BOOL) // roll up common prefixes in the bucket index when listing with a delimiter
+OPTION(rgw_index_complete_batch_size, OPT_U64) // maximum number of index completions sent to a shard in one op
 
 OPTION(rgw_rest_getusage_op_compat, OPT_BOOL) // dump description of total stats for s3 GetUsage API
 
@@ -1605,6 +1706,7 @@ OPTION(rgw_swift_need_stats, OPT_BOOL) // option to enable stats on bucket listi
 /* resharding tunables */
 OPTION(rgw_reshard_num_logs, OPT_INT)
 OPTION(rgw_reshard_bucket_lock_duration, OPT_INT) // duration of lock on bucket obj during resharding
+OPTION(rgw_reshard_online, OPT_BOOL) // copy the index while writes continue, block only for the final catch up
 OPTION(rgw_dynamic_resharding, OPT_BOOL)
 OPTION(rgw_max_objs_per_shard, OPT_INT)
 OPTION(rgw_reshard_thread_interval, OPT_U32) // maximum time between rounds of reshard thread processing
@@ -301,6 +301,14 @@ namespace ceph {
       queue.add_request(std::move(item), cl, cost);
     }
 
+    // enqueue with the delta/rho a dmclock client tracked for us, so
+    // the client's reservation and limit hold across all servers
+    void enqueue_distributed(K cl, unsigned priority, unsigned cost, T item,
+			     const dmc::ReqParams& req_params) {
+      // priority is ignored
+      queue.add_request(std::move(item), cl, req_params, cost);
+    }
+
     void enqueue_front(K cl,
 		       unsigned priority,
 		       unsigned cost,
@@ -313,8 +321,18 @@ namespace ceph {
     }
 
     T dequeue() override final {
+      return dequeue(nullptr);
+    }
+
+    // also report the dmclock phase the item was scheduled in; strict
+    // and front items count as priority
+    T dequeue(dmc::PhaseType *phase) {
       assert(!empty());
 
+      if (phase) {
+	*phase = dmc::PhaseType::priority;
+      }
+
       if (!(high_queue.empty())) {
 	T ret = high_queue.rbegin()->second.front().second;
 	high_queue.rbegin()->second.pop_front();
@@ -333,6 +351,9 @@ namespace ceph {
       auto pr = queue.pull_request();
       assert(pr.is_retn());
       auto& retn = pr.get_retn();
+      if (phase) {
+	*phase = retn.phase;
+      }
       return *(retn.request);
     }
 
@@ -56,6 +56,68 @@ void mempool::set_debug_mode(bool d)
   debug_mode = d;
 }
 
+// --------------------------------------------------------------
+// slab
+
+namespace {
+
+// Per-thread free lists, one per size class.  A free item stores the
+// pointer to the next one in its first word.  Every item is a
+// new char[slab_class_size(cls)], so it can always go back to malloc.
+struct slab_cache_t {
+  void *head[mempool::slab_num_classes] = {};
+  size_t count[mempool::slab_num_classes] = {};
+  bool dead = false;
+
+  void trim() {
+    for (size_t cls = 0; cls < mempool::slab_num_classes; ++cls) {
+      while (head[cls]) {
+	void *p = head[cls];
+	head[cls] = *reinterpret_cast<void**>(p);
+	delete[] reinterpret_cast<char*>(p);
+      }
+      count[cls] = 0;
+    }
+  }
+  ~slab_cache_t() {
+    trim();
+    dead = true;
+  }
+};
+
+thread_local slab_cache_t slab_cache;
+
+} // anonymous namespace
+
+void *mempool::slab_alloc(size_t cls)
+{
+  slab_cache_t &c = slab_cache;
+  void *p = c.head[cls];
+  if (p) {
+    c.head[cls] = *reinterpret_cast<void**>(p);
+    --c.count[cls];
+    return p;
+  }
+  return new char[slab_class_size(cls)];
+}
+
+void mempool::slab_free(void *p, size_t cls)
+{
+  slab_cache_t &c = slab_cache;
+  if (c.dead || c.count[cls] >= slab_cache_max) {
+    delete[] reinterpret_cast<char*>(p);
+    return;
+  }
+  *reinterpret_cast<void**>(p) = c.head[cls];
+  c.head[cls] = p;
+  ++c.count[cls];
+}
+
+void mempool::slab_trim()
+{
+  slab_cache.trim();
+}
+
 // --------------------------------------------------------------
 // pool_t
 
@@ -17,6 +17,7 @@
  */
 #include "include/compat.h"
 #include <pthread.h>
+#include <random>
 #include "common/Cond.h"
 #include "obj_bencher.h"
 
@@ -216,6 +217,10 @@ int ObjBencher::aio_bench(
 
   if (concurrentios <= 0)
     return -EINVAL;
+  // the mix workload and sequential reads only make sense in one mode each
+  if ((OP_MIX == operation && !open_loop.rate) ||
+      (OP_SEQ_READ == operation && open_loop.rate))
+    return -EINVAL;
 
   int num_objects = 0;
   int r = 0;
@@ -226,7 +231,7 @@ int ObjBencher::aio_bench(
   const std::string run_name_meta = (run_name.empty() ? BENCH_LASTRUN_METADATA : run_name);
 
   //get data from previous write run, if available
-  if (operation != OP_WRITE) {
+  if (operation != OP_WRITE && operation != OP_MIX) {
     uint64_t prev_op_size, prev_object_size;
     r = fetch_bench_metadata(run_name_meta, &prev_op_size, &prev_object_size,
 			     &num_objects, &prevPid);
@@ -260,7 +265,12 @@ int ObjBencher::aio_bench(
   if (formatter)
     formatter->open_object_section("bench");
 
-  if (OP_WRITE == operation) {
+  if (open_loop.rate) {
+    r = open_loop_bench(operation, secondsToRun, concurrentios, num_objects,
+			prevPid, run_name_meta, max_objects);
+    if (r != 0) goto out;
+  }
+  else if (OP_WRITE == operation) {
     r = write_bench(secondsToRun, concurrentios, run_name_meta, max_objects);
     if (r != 0) goto out;
   }
@@ -273,7 +283,7 @@ int ObjBencher::aio_bench(
     if (r != 0) goto out;
   }
 
-  if (OP_WRITE == operation && cleanup) {
+  if ((OP_WRITE == operation || OP_MIX == operation) && cleanup) {
     r = fetch_bench_metadata(run_name_meta, &op_size, &object_size,
 			     &num_objects, &prevPid);
     if (r < 0) {
@@ -1081,6 +1091,324 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   return r;
 }
 
+static void dump_latency_percentiles(Formatter *f, ostream& os, const char *name,
+				     const bench_latency_histogram& h)
+{
+  static const double pcts[] = { 50, 90, 99, 99.9, 99.99 };
+  static const char *labels[] = { "p50", "p90", "p99", "p99.9", "p99.99" };
+  if (f) {
+    f->open_object_section(name);
+    f->dump_unsigned("count", h.count());
+    for (unsigned i = 0; i < sizeof(pcts) / sizeof(pcts[0]); ++i)
+      f->dump_format(labels[i], "%f", h.percentile(pcts[i]) / 1000000.0);
+    f->close_section();
+  } else {
+    os << name << " latency(s):";
+    for (unsigned i = 0; i < sizeof(pcts) / sizeof(pcts[0]); ++i)
+      os << " " << labels[i] << " " << h.percentile(pcts[i]) / 1000000.0;
+    os << std::endl;
+  }
+}
+
+/*
+ * Open-loop benchmark: ops arrive as a Poisson process at the target rate,
+ * whether or not earlier ops have completed, and latency is measured from
+ * the arrival time.  An op that arrives while concurrentios ops are in
+ * flight waits for a slot, and that wait counts toward its latency, so
+ * queueing inside the client is not hidden as it is in a closed loop.
+ */
+int ObjBencher::open_loop_bench(int operation, int secondsToRun,
+				int concurrentios, int num_objects, int prevPid,
+				const string& run_name_meta, unsigned max_objects)
+{
+  if (concurrentios <= 0 || !open_loop.rate)
+    return -EINVAL;
+
+  int read_percent = open_loop.read_percent;
+  if (operation == OP_WRITE)
+    read_percent = 0;
+  else if (operation == OP_RAND_READ)
+    read_percent = 100;
+  uint64_t min_size = open_loop.min_object_size ? open_loop.min_object_size : data.op_size;
+  uint64_t max_size = open_loop.max_object_size ? open_loop.max_object_size : data.op_size;
+  if (max_size < min_size)
+    max_size = min_size;
+
+  if (!formatter) {
+    out(cout) << "Issuing " << open_loop.rate << " ops/sec ("
+	      << read_percent << "% reads) with up to " << concurrentios
+	      << " in flight for up to " << secondsToRun << " seconds";
+    if (read_percent < 100)
+      cout << ", writing objects of " << min_size << " to " << max_size << " bytes";
+    cout << std::endl;
+  } else {
+    formatter->dump_unsigned("target_ops_per_sec", open_loop.rate);
+    formatter->dump_int("read_percent", read_percent);
+    formatter->dump_format("concurrent_ios", "%d", concurrentios);
+    formatter->dump_unsigned("min_object_size", min_size);
+    formatter->dump_unsigned("max_object_size", max_size);
+    formatter->dump_format("seconds_to_run", "%d", secondsToRun);
+  }
+
+  // written objects are slices of one buffer
+  bufferptr bp(max_size);
+  memset(bp.c_str(), 'z', max_size);
+  bufferlist contents;
+  contents.append(bp);
+
+  // objects a read may pick: (object number, length)
+  std::vector<std::pair<int, uint64_t> > readable;
+  if (operation == OP_RAND_READ) {
+    readable.reserve(num_objects);
+    for (int i = 0; i < num_objects; ++i)
+      readable.push_back(std::make_pair(i, data.op_size));
+  }
+
+  std::vector<bufferlist> bufs(concurrentios);
+  std::vector<utime_t> arrivals(concurrentios);
+  std::vector<bool> busy(concurrentios, false);
+  std::vector<bool> is_read(concurrentios, false);
+  std::vector<std::pair<int, uint64_t> > slot_obj(concurrentios);
+  std::vector<int> free_slots;
+  for (int i = concurrentios - 1; i >= 0; --i)
+    free_slots.push_back(i);
+
+  bench_latency_histogram all_hist, read_hist, write_hist;
+  double total_latency = 0;
+  uint64_t bytes_done = 0;
+  uint64_t delayed = 0;
+  double max_delay = 0;
+  int writes = 0;
+  int r = 0;
+  lock_cond lc(&lock);
+  utime_t runtime;
+  utime_t timePassed;
+  utime_t stop_time;
+  double next_arrival = 0;
+
+  std::mt19937_64 rng(ceph_clock_now().to_nsec());
+  std::exponential_distribution<double> interarrival(open_loop.rate);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::uniform_int_distribution<uint64_t> sizes(min_size, max_size);
+
+  r = completions_init(concurrentios);
+  if (r < 0)
+    return r;
+
+  pthread_t print_thread;
+  pthread_create(&print_thread, NULL, ObjBencher::status_printer, (void *)this);
+  ceph_pthread_setname(print_thread, "open_loop_stat");
+  lock.Lock();
+  data.finished = 0;
+  data.start_time = ceph_clock_now();
+  lock.Unlock();
+  runtime.set_from_double(secondsToRun);
+  stop_time = data.start_time + runtime;
+
+  lock.Lock();
+  while (true) {
+    // reap whatever has completed
+    std::vector<int> done;
+    for (int slot = 0; slot < concurrentios; ++slot) {
+      if (busy[slot] && completion_is_done(slot))
+	done.push_back(slot);
+    }
+    if (!done.empty()) {
+      lock.Unlock();
+      for (auto slot : done) {
+	completion_wait(slot);
+	r = completion_ret(slot);
+	utime_t now = ceph_clock_now();
+	release_completion(slot);
+	if (r < 0)
+	  goto ERR;
+	utime_t lat = now - arrivals[slot];
+	uint64_t usec = lat.to_nsec() / 1000;
+	all_hist.add(usec);
+	if (is_read[slot]) {
+	  read_hist.add(usec);
+	  bytes_done += r;
+	} else {
+	  write_hist.add(usec);
+	  bytes_done += slot_obj[slot].second;
+	}
+	bufs[slot].clear();
+	lock.Lock();
+	if (!is_read[slot])
+	  readable.push_back(slot_obj[slot]);
+	data.cur_latency = lat;
+	data.history.latency.push_back(data.cur_latency);
+	total_latency += data.cur_latency;
+	if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
+	if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+	++data.finished;
+	data.avg_latency = total_latency / data.finished;
+	--data.in_flight;
+	busy[slot] = false;
+	free_slots.push_back(slot);
+	lock.Unlock();
+      }
+      lock.Lock();
+      continue;
+    }
+
+    utime_t arrival = data.start_time;
+    arrival += next_arrival;
+    if (!secondsToRun || arrival >= stop_time ||
+	(max_objects && writes >= (int)max_objects))
+      break;
+    utime_t now = ceph_clock_now();
+    if (now < arrival) {
+      lc.cond.WaitInterval(lock, arrival - now);
+      continue;
+    }
+    if (free_slots.empty()) {
+      // the op is late; the wait shows up in its latency
+      lc.cond.Wait(lock);
+      continue;
+    }
+    int slot = free_slots.back();
+    free_slots.pop_back();
+    busy[slot] = true;
+    arrivals[slot] = arrival;
+    double delay = now - arrival;
+    if (delay > 0.001) {
+      ++delayed;
+      if (delay > max_delay)
+	max_delay = delay;
+    }
+    next_arrival += interarrival(rng);
+    is_read[slot] = !readable.empty() && percent(rng) < read_percent;
+    if (is_read[slot]) {
+      std::uniform_int_distribution<size_t> pick(0, readable.size() - 1);
+      slot_obj[slot] = readable[pick(rng)];
+    } else {
+      slot_obj[slot] = std::make_pair(writes++, sizes(rng));
+    }
+    ++data.started;
+    ++data.in_flight;
+    lock.Unlock();
+
+    r = create_completion(slot, _aio_cb, (void *)&lc);
+    if (r < 0)
+      goto ERR;
+    if (is_read[slot]) {
+      r = aio_read(generate_object_name(slot_obj[slot].first, prevPid), slot,
+		   &bufs[slot], slot_obj[slot].second, 0);
+    } else {
+      bufs[slot].substr_of(contents, 0, slot_obj[slot].second);
+      r = aio_write(generate_object_name(slot_obj[slot].first), slot,
+		    bufs[slot], slot_obj[slot].second, 0);
+    }
+    if (r < 0)
+      goto ERR;
+    lock.Lock();
+  }
+
+  // let the ops in flight finish
+  while (data.in_flight) {
+    bool found = false;
+    for (int slot = 0; slot < concurrentios; ++slot) {
+      if (!busy[slot] || !completion_is_done(slot))
+	continue;
+      found = true;
+      lock.Unlock();
+      completion_wait(slot);
+      r = completion_ret(slot);
+      utime_t now = ceph_clock_now();
+      release_completion(slot);
+      if (r < 0)
+	goto ERR;
+      utime_t lat = now - arrivals[slot];
+      uint64_t usec = lat.to_nsec() / 1000;
+      all_hist.add(usec);
+      if (is_read[slot]) {
+	read_hist.add(usec);
+	bytes_done += r;
+      } else {
+	write_hist.add(usec);
+	bytes_done += slot_obj[slot].second;
+      }
+      lock.Lock();
+      data.cur_latency = lat;
+      data.history.latency.push_back(data.cur_latency);
+      total_latency += data.cur_latency;
+      if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
+      if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
+      ++data.finished;
+      data.avg_latency = total_latency / data.finished;
+      --data.in_flight;
+      busy[slot] = false;
+    }
+    if (!found && data.in_flight)
+      lc.cond.Wait(lock);
+  }
+  timePassed = ceph_clock_now() - data.start_time;
+  data.done = true;
+  lock.Unlock();
+
+  pthread_join(print_thread, NULL);
+
+  double bandwidth;
+  bandwidth = ((double)bytes_done)/(double)timePassed;
+  bandwidth = bandwidth/(1024*1024); // we want it in MB/sec
+
+  if (!formatter) {
+    out(cout) << "Total time run:         " << timePassed << std::endl
+       << "Total ops made:         " << data.finished << std::endl
+       << "Total writes made:      " << writes << std::endl
+       << "Target IOPS:            " << open_loop.rate << std::endl
+       << "Average IOPS:           " << (int)(data.finished/timePassed) << std::endl
+       << "Bandwidth (MB/sec):     " << setprecision(6) << bandwidth << std::endl
+       << "Late ops:               " << delayed << std::endl
+       << "Max issue delay(s):     " << max_delay << std::endl
+       << "Average Latency(s):     " << data.avg_latency << std::endl
+       << "Stddev Latency(s):      " << vec_stddev(data.history.latency) << std::endl
+       << "Max latency(s):         " << data.max_latency << std::endl
+       << "Min latency(s):         " << data.min_latency << std::endl;
+  } else {
+    formatter->dump_format("total_time_run", "%f", (double)timePassed);
+    formatter->dump_format("total_ops_made", "%d", data.finished);
+    formatter->dump_format("total_writes_made", "%d", writes);
+    formatter->dump_format("average_iops", "%d", (int)(data.finished/timePassed));
+    formatter->dump_format("bandwidth", "%f", bandwidth);
+    formatter->dump_unsigned("late_ops", delayed);
+    formatter->dump_format("max_issue_delay", "%f", max_delay);
+    formatter->dump_format("average_latency", "%f", data.avg_latency);
+    formatter->dump_format("stddev_latency", "%f", vec_stddev(data.history.latency));
+    formatter->dump_format("max_latency", "%f", data.max_latency);
+    formatter->dump_format("min_latency", "%f", data.min_latency);
+    formatter->open_object_section("latency_percentiles");
+  }
+  dump_latency_percentiles(formatter, cout, "all", all_hist);
+  if (read_hist.count() && write_hist.count()) {
+    dump_latency_percentiles(formatter, cout, "read", read_hist);
+    dump_latency_percentiles(formatter, cout, "write", write_hist);
+  }
+  if (formatter)
+    formatter->close_section(); // latency_percentiles
+
+  if (writes) {
+    // write object size/number data for cleanup and read benchmarks
+    bufferlist b_write;
+    ::encode(max_size, b_write);
+    ::encode(writes, b_write);
+    ::encode(getpid(), b_write);
+    ::encode(max_size, b_write);
+    sync_write(run_name_meta, b_write, sizeof(int)*3);
+  }
+
+  completions_done();
+  return 0;
+
+ ERR:
+  lock.Lock();
+  data.done = 1;
+  lock.Unlock();
+  pthread_join(print_thread, NULL);
+  return r;
+}
+
 int ObjBencher::clean_up(const std::string& orig_prefix, int concurrentios, const std::string& run_name) {
   int r = 0;
   uint64_t op_size, object_size;
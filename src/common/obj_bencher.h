@@ -17,7 +17,10 @@
 
 #include "common/ceph_context.h"
 #include "common/Formatter.h"
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <vector>
 
 struct bench_interval_data {
   double min_bandwidth = DBL_MAX;
@@ -32,6 +35,81 @@ struct bench_history {
   vector<long> iops;
 };
 
+/*
+ * Latency histogram with a bounded relative error, in the manner of an
+ * HdrHistogram: values below 2^sub_bits are counted exactly, and each
+ * power of two above that is split into 2^(sub_bits-1) linear buckets,
+ * so any recorded value is off by less than 1/1024 of itself.
+ */
+class bench_latency_histogram {
+  static const unsigned sub_bits = 11;
+  std::vector<uint64_t> counts;
+  uint64_t total = 0;
+  uint64_t max_value = 0;
+
+  static unsigned bucket(uint64_t v) {
+    unsigned msb = 63 - __builtin_clzll(v | 1);
+    if (msb < sub_bits)
+      return v;
+    unsigned shift = msb - sub_bits + 1;
+    return (shift << (sub_bits - 1)) + (v >> shift);
+  }
+  // highest value that falls in bucket b
+  static uint64_t bucket_high(unsigned b) {
+    if (b < (1u << sub_bits))
+      return b;
+    unsigned shift = (b >> (sub_bits - 1)) - 1;
+    uint64_t m = b - (shift << (sub_bits - 1));
+    return ((m + 1) << shift) - 1;
+  }
+
+public:
+  /// record a latency, in microseconds
+  void add(uint64_t usec) {
+    unsigned b = bucket(usec);
+    if (b >= counts.size())
+      counts.resize(b + 1);
+    ++counts[b];
+    ++total;
+    if (usec > max_value)
+      max_value = usec;
+  }
+  uint64_t count() const {
+    return total;
+  }
+  void merge(const bench_latency_histogram& o) {
+    if (o.counts.size() > counts.size())
+      counts.resize(o.counts.size());
+    for (unsigned b = 0; b < o.counts.size(); ++b)
+      counts[b] += o.counts[b];
+    total += o.total;
+    max_value = std::max(max_value, o.max_value);
+  }
+  /// latency (usec) at or below which pct percent of the samples fall
+  uint64_t percentile(double pct) const {
+    if (!total)
+      return 0;
+    uint64_t target = (uint64_t)ceil(pct / 100.0 * total);
+    if (target < 1)
+      target = 1;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < counts.size(); ++b) {
+      seen += counts[b];
+      if (seen >= target)
+	return std::min(bucket_high(b), max_value);
+    }
+    return max_value;
+  }
+};
+
+// workload of an open-loop benchmark
+struct bench_open_loop {
+  uint64_t rate = 0;            // target ops/sec, arriving as a Poisson process; 0 for closed loop
+  int read_percent = 50;        // share of reads in the mix workload
+  uint64_t min_object_size = 0; // written object sizes are uniform in [min, max]
+  uint64_t max_object_size = 0;
+};
+
 struct bench_data {
   bool done; //is the benchmark is done
   uint64_t object_size; //the size of the objects
@@ -54,6 +132,7 @@ struct bench_data {
 const int OP_WRITE     = 1;
 const int OP_SEQ_READ  = 2;
 const int OP_RAND_READ = 3;
+const int OP_MIX       = 4; // open loop only: reads of the objects written so far
 
 // Object is composed of <oid,namespace>
 typedef std::pair<std::string, std::string> Object;
@@ -70,6 +149,7 @@ protected:
   static void *status_printer(void *bencher);
 
   struct bench_data data;
+  struct bench_open_loop open_loop;
 
   int fetch_bench_metadata(const std::string& metadata_file, uint64_t* op_size,
 			   uint64_t* object_size, int* num_objects, int* prevPid);
@@ -77,6 +157,9 @@ protected:
   int write_bench(int secondsToRun, int concurrentios, const string& run_name_meta, unsigned max_objects);
   int seq_read_bench(int secondsToRun, int num_objects, int concurrentios, int writePid, bool no_verify=false);
   int rand_read_bench(int secondsToRun, int num_objects, int concurrentios, int writePid, bool no_verify=false);
+  int open_loop_bench(int operation, int secondsToRun, int concurrentios,
+		      int num_objects, int prevPid, const string& run_name_meta,
+		      unsigned max_objects);
 
   int clean_up(int num_objects, int prevPid, int concurrentios);
   bool more_objects_matching_prefix(const std::string& prefix, std::list<Object>* name);
@@ -121,6 +204,10 @@ public:
   void set_outstream(ostream& os) {
     outstream = &os;
   }
+  /// issue ops at a target rate instead of keeping concurrentios in flight
+  void set_open_loop(const bench_open_loop& ol) {
+    open_loop = ol;
+  }
   int clean_up_slow(const std::string& prefix, int concurrentios);
 };
 
@@ -519,6 +519,11 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("mempool_slab_pools", Option::TYPE_STR, Option::LEVEL_DEV)
+    .set_default("")
+    .set_description("Mempools that recycle small items through per-thread slab caches")
+    .set_long_description("Comma separated list of mempool names.  Single items of up to 256 bytes allocated from these pools (map, set and list nodes) are rounded to a 16 byte size class and kept on a per-thread free list when freed, instead of returning to malloc."),
+
     Option("key", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -580,6 +585,65 @@ std::vector<Option> get_global_options() {
     .set_default(4096)
     .set_description(""),
 
+    Option("ms_async_rx_buffer_pool_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Idle bytes each async messenger worker keeps for receiving message data")
+    .set_long_description("If nonzero, message data segments of at least a page are read into a single recycled page-aligned buffer, placed so that its alignment matches the data offset in the message header.  Aligned writes can then be submitted to the block device without being copied into a new aligned buffer.  0 disables the pool.")
+    .add_see_also("ms_tcp_prefetch_max_size"),
+
+    Option("ms_async_busy_poll_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("How long async messenger workers keep polling for events before blocking")
+    .set_long_description("After handling an event a worker polls its event driver (and any registered pollers) without sleeping for this many microseconds, avoiding the wakeup latency of a blocking wait at the cost of a busy CPU.  The msgr_busy_poll_* perf counters show how much of that spinning found work.  0 always blocks.")
+    .add_see_also("ms_async_op_threads"),
+
+    Option("ms_async_coalesce_max_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64<<10)
+    .set_description("Maximum bytes of queued messages written to a connection with a single send")
+    .set_long_description("When further messages are already queued on an async messenger connection, they are appended and handed to the socket together, up to this many bytes.  0 sends every message separately.")
+    .add_see_also("ms_async_coalesce_delay_us"),
+
+    Option("ms_async_coalesce_delay_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("How long a busy connection may hold back a send to batch it with later messages")
+    .set_long_description("Only applies while the connection sends more than ms_async_coalesce_min_rate messages per second, so idle or lightly loaded connections see no added latency.  0 disables the delay.")
+    .add_see_also("ms_async_coalesce_max_bytes")
+    .add_see_also("ms_async_coalesce_min_rate"),
+
+    Option("ms_async_coalesce_min_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(20000)
+    .set_description("Messages per second above which a connection delays sends to coalesce them")
+    .add_see_also("ms_async_coalesce_delay_us"),
+
+    Option("ms_compression_algorithm", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("none")
+    .set_enum_allowed({"none", "snappy", "zlib", "zstd", "lz4"})
+    .set_description("Compress message data sent by the async messenger with this algorithm")
+    .set_long_description("Only the data payload of messages is compressed, and only to peers that can decompress it.  The receiving side must have the same compression plugin available.  Read at startup.")
+    .add_see_also("ms_compression_min_size")
+    .add_see_also("ms_compression_networks"),
+
+    Option("ms_compression_min_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8 << 10)
+    .set_description("Do not compress message data smaller than this many bytes"),
+
+    Option("ms_compression_networks", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("Only compress message data sent to peers in these networks")
+    .set_long_description("Comma separated list of networks in CIDR notation, e.g. the remote site of a stretched cluster.  Empty means every peer."),
+
+    Option("ms_tcp_zerocopy", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Send large messages with MSG_ZEROCOPY on the posix stack")
+    .set_long_description("The kernel transmits directly from message buffers instead of copying them into the socket buffer; the buffers stay referenced until the kernel reports completion on the socket error queue.  Requires Linux 4.14 or later; sockets that do not support it fall back to copying.")
+    .add_see_also("ms_tcp_zerocopy_threshold"),
+
+    Option("ms_tcp_zerocopy_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64<<10)
+    .set_description("Minimum pending bytes for a send to use MSG_ZEROCOPY")
+    .set_long_description("Page pinning and completion handling cost more than copying small writes, so smaller sends keep the copy path.")
+    .add_see_also("ms_tcp_zerocopy"),
+
     Option("ms_initial_backoff", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.2)
     .set_description(""),
@@ -739,6 +803,18 @@ std::vector<Option> get_global_options() {
     .set_default(32768)
     .set_description(""),
 
+    Option("ms_async_rdma_zero_copy_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Send buffers at least this large in place instead of copying them into registered tx chunks")
+    .set_long_description("The buffer memory is registered with the device and the registration is cached, see ms_async_rdma_mr_cache_size.  0 always copies.")
+    .add_see_also("ms_async_rdma_mr_cache_size"),
+
+    Option("ms_async_rdma_mr_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128<<20)
+    .set_description("Bytes of buffer memory kept registered for sending in place")
+    .set_long_description("Cached registrations keep their buffers allocated, so this also bounds the memory held by the cache.")
+    .add_see_also("ms_async_rdma_zero_copy_threshold"),
+
     Option("ms_async_rdma_receive_queue_len", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(4096)
     .set_description(""),
@@ -855,10 +931,22 @@ std::vector<Option> get_global_options() {
     .set_default(4)
     .set_description(""),
 
+    Option("mon_command_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_min(0)
+    .set_description("Threads used to format replies to read-only monitor commands")
+    .set_long_description("Commands such as 'osd dump' and 'osd tree' are formatted from a snapshot of committed state on these threads instead of under the monitor lock, so large outputs do not delay paxos or lease renewal.  0 formats them inline."),
+
     Option("mon_osd_mapping_pgs_per_chunk", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(4096)
     .set_description(""),
 
+    Option("mon_osd_mapping_incremental", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Only recompute pg mappings for pools touched by new osdmaps")
+    .set_long_description("When the osdmap changes only pool properties, pg_temp, primary_temp or upmap entries, recompute the precalculated pg mappings for the affected pools instead of every pool in the cluster.")
+    .add_see_also("mon_osd_mapping_pgs_per_chunk"),
+
     Option("mon_osd_max_creating_pgs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .set_description(""),
@@ -1307,6 +1395,11 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("mon_store_group_commit", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Merge queued monitor store transactions into a single write")
+    .set_long_description("Transactions queued while an earlier one is still being written to the monitor store are written together with one sync. Each one is still acknowledged only after it is durable."),
+
     Option("mon_sync_provider_kill_at", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
     .set_description(""),
@@ -1351,6 +1444,13 @@ std::vector<Option> get_global_options() {
     .set_default(0.05)
     .set_description(""),
 
+    Option("paxos_propose_backlog", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Requests queued behind a proposal that let the next one skip paxos_propose_interval (0 to disable)")
+    .set_long_description("When at least this many updates to a service had to wait for its previous proposal to commit, propose the next batch after paxos_min_wait instead of waiting out paxos_propose_interval.  The backlog already batches the updates, so this raises the rate at which e.g. osd failure and boot reports turn into new maps.")
+    .add_see_also("paxos_propose_interval")
+    .add_see_also("paxos_min_wait"),
+
     Option("paxos_min", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(500)
     .set_description(""),
@@ -1459,6 +1559,11 @@ std::vector<Option> get_global_options() {
     .set_default(65536)
     .set_description(""),
 
+    Option("mon_max_pool_compression_dictionary_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128 << 10)
+    .set_description("Largest compression dictionary a pool may have")
+    .set_long_description("Pool compression dictionaries are part of the OSDMap, so every client and daemon holds a copy."),
+
     Option("mon_pool_quota_warn_threshold", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description(""),
@@ -1511,6 +1616,36 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_backoff_resend_burst", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Ops per pg resent at once when an OSD releases a backoff (0 for all)")
+    .set_long_description("When an OSD unblocks a backoff, resend at most this many of the blocked ops right away and spread the rest out over objecter_backoff_resend_interval sized steps, so a pg that just finished peering is not hit by every client at once.")
+    .add_see_also("objecter_backoff_resend_interval"),
+
+    Option("objecter_backoff_resend_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.01)
+    .set_description("Seconds between paced resends after a backoff is released")
+    .set_long_description("Each step is delayed by this interval plus a random part of a window that doubles with every backoff the pg sent recently.")
+    .add_see_also("objecter_backoff_resend_burst"),
+
+    Option("objecter_pg_mapping_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Cache pg to osd mappings computed for the current osdmap")
+    .set_long_description("Keep the up and acting sets the objecter computed for each pg until an osdmap change may move the pg, so requests to the same pg skip the crush calculation."),
+
+    Option("objecter_replica_read_policy", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("primary")
+    .set_enum_allowed({"primary", "balance", "localize"})
+    .set_description("Where to send reads on replicated pools")
+    .set_long_description("'balance' spreads read-only ops over all acting osds, 'localize' sends them to the closest one according to crush_location.  A replica that cannot serve a read consistently bounces it back and the op is resent to the primary.  Only takes effect while every up osd is mimic or later; ops that set BALANCE_READS or LOCALIZE_READS themselves are unaffected.")
+    .add_see_also("crush_location"),
+
+    Option("objecter_mclock_service_tracker", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Track dmclock delta and rho per osd and send them with each op")
+    .set_long_description("With the osds running the mclock_client op queue, this lets each client's reservation and limit hold across the whole cluster rather than separately on every osd. The parameters are only sent to osds that are mimic or later.")
+    .add_see_also("osd_op_queue"),
+
     Option("filer_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -1583,6 +1718,11 @@ std::vector<Option> get_global_options() {
     .set_default(.02)
     .set_description(""),
 
+    Option("osd_agent_heat_sketch_width", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2048)
+    .set_description("Counters per row of the tiering agent's object heat sketch")
+    .set_long_description("The cache tiering agent estimates object temperature from a count-min sketch of HitSet accesses instead of probing each archived HitSet. Larger sketches reduce over-estimation from collisions at 16 bytes of memory per counter column per cache-tier PG. Zero disables the sketch."),
+
     Option("osd_uuid", Option::TYPE_UUID, Option::LEVEL_ADVANCED)
     .set_default(uuid_d())
     .set_description(""),
@@ -1761,11 +1901,20 @@ std::vector<Option> get_global_options() {
 
     Option("osd_tier_promote_max_objects_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(25)
-    .set_description(""),
+    .set_description("")
+    .set_long_description("Only used when osd_tier_promote_max_bytes_sec is 0."),
 
     Option("osd_tier_promote_max_bytes_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5 * 1024*1024)
-    .set_description(""),
+    .set_description("Byte budget per second for cache tier promotions")
+    .set_long_description("Promotions draw on a byte budget refilled at this rate, so small objects are not limited like large ones. Zero falls back to the osd_tier_promote_max_objects_sec rate.")
+    .add_see_also("osd_tier_promote_max_objects_sec"),
+
+    Option("osd_tier_recency_index_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32768)
+    .set_description("Slots in each cache tier PG's in-memory HitSet recency index")
+    .set_long_description("Promotion recency checks read a multi-generation bloom index of recent accesses instead of probing each archived HitSet. Each slot costs 2 bytes; larger indexes have fewer false positives. Zero disables the index.")
+    .add_see_also("osd_agent_heat_sketch_width"),
 
     Option("osd_tier_default_cache_mode", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("writeback")
@@ -1839,10 +1988,21 @@ std::vector<Option> get_global_options() {
     .set_default(2)
     .set_description(""),
 
+    Option("osd_load_pgs_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_description("Number of threads reading pg state from the store at OSD startup")
+    .set_long_description("Each pg's info, log and missing set are read independently when the OSD starts; this many of them are loaded concurrently. 0 or 1 loads them one at a time."),
+
     Option("osd_peering_wq_batch_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(20)
     .set_description(""),
 
+    Option("osd_peering_msg_coalesce_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Hold peering messages this many seconds to merge them per peer")
+    .set_long_description("When non-zero, the notifies, queries and infos generated by peering are held back for up to this long so that those for the same peer OSD and epoch go out as a single message.  0 sends them as soon as each peering batch is done.")
+    .add_see_also("osd_peering_wq_batch_size"),
+
     Option("osd_op_pq_max_tokens_per_priority", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(4194304)
     .set_description(""),
@@ -1855,6 +2015,18 @@ std::vector<Option> get_global_options() {
     .set_default(1)
     .set_description(""),
 
+    Option("osd_async_read_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_min(1)
+    .set_description("Number of threads serving deferred reads for replicated pools")
+    .add_see_also("osd_replicated_async_read_min_bytes"),
+
+    Option("osd_replicated_async_read_min_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Read extents of at least this size from replicated pools without holding the PG lock")
+    .set_long_description("Reads this large are issued from a separate thread pool while the op keeps its object read lock, so other ops on the same PG can proceed in the meantime.  0 disables.")
+    .add_see_also("osd_async_read_threads"),
+
     Option("osd_disk_thread_ioprio_class", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -1891,6 +2063,12 @@ std::vector<Option> get_global_options() {
     .set_default(8)
     .set_description(""),
 
+    Option("osd_op_inline_dispatch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Run client and replica ops to completion on the messenger thread when possible")
+    .set_long_description("If the op queue shard that owns the target PG is idle and the PG lock is uncontended, the op is processed directly by the messenger worker that received it instead of being queued for an op thread, saving the thread handoffs.  Ops that block (e.g., on store throttles) will stall that messenger worker while they do.")
+    .add_see_also("osd_op_num_shards"),
+
     Option("osd_op_queue", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("wpq")
     .set_enum_allowed( { "wpq", "prioritized", "mclock_opclass", "mclock_client", "debug_random" } )
@@ -1905,6 +2083,12 @@ std::vector<Option> get_global_options() {
     .set_long_description("the threshold between high priority ops that use strict priority ordering and low priority ops that use a fairness algorithm that may or may not incorporate priority")
     .add_see_also("osd_op_queue"),
 
+    Option("osd_op_queue_lockless_enqueue", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enqueue ops to the op queue shards without taking the shard lock")
+    .set_long_description("New items are pushed onto a lock-free list per shard and moved into the priority queue in batches by the shard's worker threads, which reduces lock contention between messenger and op threads.  Requeued items still take the shard lock.  Takes effect on OSD restart.")
+    .add_see_also("osd_op_queue"),
+
     Option("osd_op_queue_mclock_client_op_res", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(1000.0)
     .set_description("mclock reservation of client operator requests")
@@ -2213,6 +2397,39 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_read_latency_aware", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Pick EC read shards by observed peer latency and hedge slow reads")
+    .set_long_description("Client reads on EC pools go to the set of shards that answered fastest so far (see osd_ec_read_slow_shard_ratio), and if a read has not completed within the osd_ec_read_hedge_quantile sub read latency, the remaining shards are read too and the read completes as soon as enough shards have replied.  Late replies are dropped.  Does not apply to pools with fast_read, which always read every shard.")
+    .add_see_also("osd_ec_read_slow_shard_ratio")
+    .add_see_also("osd_ec_read_hedge_quantile")
+    .add_see_also("osd_ec_read_hedge_min_delay"),
+
+    Option("osd_ec_read_slow_shard_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(2.0)
+    .set_description("Read other EC shards (and decode) when a needed shard is this many times slower")
+    .add_see_also("osd_ec_read_latency_aware"),
+
+    Option("osd_ec_read_hedge_quantile", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.99)
+    .set_description("Sub read latency quantile after which an EC read also reads the remaining shards")
+    .add_see_also("osd_ec_read_latency_aware"),
+
+    Option("osd_ec_read_hedge_min_delay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.005)
+    .set_description("Minimum time (seconds) before an EC read reads the remaining shards")
+    .add_see_also("osd_ec_read_latency_aware"),
+
+    Option("osd_ec_rmw_per_object_cache_invalidation", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Only block EC read-modify-writes on objects touched by in-flight uncached writes")
+    .set_long_description("A write that bypasses the EC extent cache (e.g., a clone) invalidates the cache for the objects it writes.  When true, only later read-modify-writes on those objects wait for it to finish; when false, every read-modify-write on the PG waits until the pipeline drains."),
+
+    Option("osd_ec_partial_stripe_delta_writes", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Apply small EC overwrites as parity deltas")
+    .set_long_description("An overwrite that stays within one stripe and touches fewer than k data chunks reads only those data chunks and the coding chunks, updates the coding chunks from the difference between the old and new data, and writes only the touched chunks, instead of reading and re-encoding the whole stripe.  Only applies to pools with allow_ec_overwrites whose plugin supports parity deltas (jerasure reed_sol_van and reed_sol_r6_op, isa), and only while every shard of the object is available and no other write to it is in flight; other writes use the full stripe path."),
+
     Option("osd_recover_clone_overlap_limit", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -2297,6 +2514,13 @@ std::vector<Option> get_global_options() {
     .set_default(10)
     .set_description(""),
 
+    Option("osd_heartbeat_max_peers_per_host", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Maximum number of pg peers to heartbeat on each remote host")
+    .set_long_description("On hosts with many OSDs, most heartbeat peers sit on a few remote hosts. When set, an OSD only heartbeats this many of its pg peers on each remote host. It chooses them by hashing its own id with theirs, so each OSD is still watched by peers spread over the cluster. 0 means heartbeat every pg peer.")
+    .add_see_also("osd_heartbeat_min_peers")
+    .add_see_also("mon_osd_min_down_reporters"),
+
     Option("osd_heartbeat_use_min_delay_socket", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -2309,6 +2533,25 @@ std::vector<Option> get_global_options() {
     .set_default(2)
     .set_description(""),
 
+    Option("osd_snap_trim_objects_per_txn", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_min(1)
+    .set_description("Number of clones trimmed in a single replicated transaction")
+    .set_long_description("Each of the osd_pg_max_concurrent_snap_trims trim operations a PG keeps in flight removes up to this many clones, with their snapset updates and snap mapper keys, in one transaction.")
+    .add_see_also("osd_pg_max_concurrent_snap_trims"),
+
+    Option("osd_snap_trim_max_ops_per_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Limit on clones trimmed per second by all PGs of an OSD (0 for no limit)")
+    .add_see_also("osd_snap_trim_max_bytes_per_sec")
+    .add_see_also("osd_snap_trim_sleep"),
+
+    Option("osd_snap_trim_max_bytes_per_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Limit on clone bytes freed per second by snap trimming on an OSD (0 for no limit)")
+    .add_see_also("osd_snap_trim_max_ops_per_sec")
+    .add_see_also("osd_snap_trim_sleep"),
+
     Option("osd_max_trimming_pgs", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(2)
     .set_description(""),
@@ -2369,6 +2612,35 @@ std::vector<Option> get_global_options() {
     .set_default(3)
     .set_description(""),
 
+    Option("osd_recovery_auto_tune", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Adjust recovery and backfill limits to client op latency")
+    .set_long_description("Once a second the OSD compares the p99 latency of client ops against osd_recovery_auto_tune_target_p99_ms.  Above it, the number of active recovery ops is halved, and at one op a sleep between recovery ops is added and doubled; well below it or without client load, the sleep is removed and then ops are added one at a time.  Backfill reservations follow the recovery op count.  While enabled, this replaces osd_recovery_max_active, osd_max_backfills and osd_recovery_sleep.")
+    .add_see_also("osd_recovery_auto_tune_target_p99_ms")
+    .add_see_also("osd_recovery_auto_tune_max_active")
+    .add_see_also("osd_recovery_auto_tune_max_backfills")
+    .add_see_also("osd_recovery_auto_tune_max_sleep"),
+
+    Option("osd_recovery_auto_tune_target_p99_ms", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(50)
+    .set_min(1)
+    .set_description("Client op p99 latency (ms) that recovery auto-tuning keeps under"),
+
+    Option("osd_recovery_auto_tune_max_active", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Most active recovery ops recovery auto-tuning allows"),
+
+    Option("osd_recovery_auto_tune_max_backfills", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Most backfill reservations recovery auto-tuning allows"),
+
+    Option("osd_recovery_auto_tune_max_sleep", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.1)
+    .set_min(0)
+    .set_description("Longest sleep between recovery ops recovery auto-tuning adds"),
+
     Option("osd_recovery_max_single_start", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1)
     .set_description(""),
@@ -2397,6 +2669,19 @@ std::vector<Option> get_global_options() {
     .set_default(10)
     .set_description(""),
 
+    Option("osd_backfill_small_object_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64<<10)
+    .set_description("Objects at or below this size are batched during backfill")
+    .add_see_also("osd_backfill_small_object_batch"),
+
+    Option("osd_backfill_small_object_batch", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Number of small objects backfilled per recovery op")
+    .set_long_description("Backfill charges one recovery op (see osd_recovery_max_active) per this many objects no larger than osd_backfill_small_object_size, so that pools of many small objects fill each push message (bounded by osd_max_push_objects and osd_max_push_cost) and the replica applies them in a single transaction. 1 charges every object as its own op.")
+    .add_see_also("osd_backfill_small_object_size")
+    .add_see_also("osd_max_push_objects"),
+
     Option("osd_recovery_forget_lost_objects", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -2449,6 +2734,13 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description(""),
 
+    Option("osd_scrub_bandwidth_limit", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Maximum bytes per second read by deep scrub on this OSD")
+    .set_long_description("Object data read by deep scrub, on behalf of all pgs (primary and replica) on the OSD, is charged against a token bucket refilled at this rate.  When it is overdrawn the next scrub chunk waits until the budget is back, in the same way as osd_scrub_sleep.  0 disables the limit.")
+    .add_see_also("osd_scrub_sleep")
+    .add_see_also("osd_scrub_chunk_max"),
+
     Option("osd_scrub_auto_repair", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -2505,6 +2797,11 @@ std::vector<Option> get_global_options() {
     .set_default(30)
     .set_description(""),
 
+    Option("osd_notify_share_payload_min_watchers", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_description("Coalesce a fragmented notify payload into one buffer when it fans out to at least this many watchers")
+    .set_long_description("Each watcher gets its own notify message referencing the same payload; a single contiguous buffer lets its checksum be computed once and reused for every message. 0 disables."),
+
     Option("osd_kill_backfill_at", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
     .set_description(""),
@@ -2654,6 +2951,13 @@ std::vector<Option> get_global_options() {
     .set_default(32)
     .set_description(""),
 
+    Option("osd_op_tracker_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Record the full event history of one in this many ops")
+    .set_long_description("Ops that are not sampled keep only their initial and most recent event, and are kept in the op history only if they exceed osd_op_history_slow_op_threshold.  Ops that become slow while in flight record all of their remaining events.")
+    .add_see_also("osd_enable_op_tracker"),
+
     Option("osd_op_history_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(20)
     .set_description(""),
@@ -2670,6 +2974,18 @@ std::vector<Option> get_global_options() {
     .set_default(10.0)
     .set_description(""),
 
+    Option("osd_client_io_stats", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Report per-client op and byte counts to the mgr")
+    .set_long_description("Client ops are accounted per pool, client entity and rbd image, and the busiest ones are sent with each mgr report for 'ceph osd client io top'.")
+    .add_see_also("osd_client_io_stats_max_entries"),
+
+    Option("osd_client_io_stats_max_entries", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1024)
+    .set_description("Number of clients tracked per mgr report period")
+    .set_long_description("Beyond this many clients the least busy one is replaced, so only the heaviest clients are reported exactly.")
+    .add_see_also("osd_client_io_stats"),
+
     Option("osd_target_transaction_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(30)
     .set_description(""),
@@ -2686,6 +3002,16 @@ std::vector<Option> get_global_options() {
     .set_default(64)
     .set_description(""),
 
+    Option("osd_object_context_prefetch_attrs", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Read all of an object's xattrs at once when loading its object context")
+    .set_long_description("On an object context cache miss the OSD otherwise reads the object info, the snapset and, on erasure coded pools, the full xattr set separately."),
+
+    Option("osd_pg_snapset_context_cache_count", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("Number of unreferenced SnapSets each PG keeps decoded")
+    .set_long_description("A SnapSet is decoded from the head object's xattr when its object context is loaded.  Keeping recently released SnapSets around avoids decoding them again when the object context has been evicted from the cache, which matters for objects with many clones."),
+
     Option("osd_tracing", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -2825,7 +3151,22 @@ std::vector<Option> get_global_options() {
 
     Option("rocksdb_enable_rmrange", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
-    .set_description(""),
+    .set_description("Use range deletes to remove key ranges and prefixes")
+    .set_long_description("When enabled, removing a range of keys (e.g. all omap keys of an object) writes a single RocksDB range tombstone instead of one tombstone per key, which keeps later iteration over that part of the key space from stepping over millions of deleted keys."),
+
+    Option("rocksdb_iterator_readahead_after", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("Keys a bounded iterator steps over before it switches to readahead (0 to disable)"),
+
+    Option("rocksdb_iterator_readahead_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2 << 20)
+    .set_description("Readahead used by bounded iterators once they look like a long scan"),
+
+    Option("rocksdb_prefix_extractor_key_bytes", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(-1)
+    .set_description("Bytes of the key past the prefix used for prefix bloom filters (-1 = disabled)")
+    .set_long_description("When set, RocksDB extracts the kv prefix plus this many bytes of the key and adds them to the sst bloom filters, so that bounded scans of one object's keys can skip files that do not hold any.  8 matches the object id leading bluestore omap keys; 0 matches filestore's per-object omap prefixes.  Only applies to the default column family.")
+    .add_see_also("rocksdb_bloom_bits_per_key"),
 
     Option("rocksdb_bloom_bits_per_key", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(20)
@@ -2977,6 +3318,16 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_blkin_trace_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("create a blkin trace for one in every N osd requests that arrive without one")
+    .set_long_description("0 disables sampling.  Ignored when osd_blkin_trace_all is set."),
+
+    Option("osdc_blkin_trace_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("create a blkin trace for one in every N objecter requests that are not already traced")
+    .set_long_description("0 disables sampling.  Ignored when osdc_blkin_trace_all is set."),
+
     Option("osd_discard_disconnected_ops", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -3028,6 +3379,21 @@ std::vector<Option> get_global_options() {
     .set_default(16)
     .set_description(""),
 
+    Option("bdev_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Use io_uring instead of libaio for KernelDevice aio")
+    .set_long_description("Requires a build with liburing and a kernel that supports it; falls back to libaio if the ring cannot be set up.")
+    .add_see_also("bdev_ioring_hipri")
+    .add_see_also("bdev_ioring_sqthread_poll"),
+
+    Option("bdev_ioring_hipri", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Poll for io_uring completions instead of waiting for interrupts (NVMe)"),
+
+    Option("bdev_ioring_sqthread_poll", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Have a kernel thread poll the io_uring submission queue"),
+
     Option("bdev_block_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(4096)
     .set_description(""),
@@ -3092,10 +3458,20 @@ std::vector<Option> get_global_options() {
     .set_default("stupid")
     .set_description(""),
 
+    Option("bluefs_db_hot_reserve_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.1)
+    .set_description("Fraction of the db device kept for hot rocksdb files once it runs low")
+    .set_long_description("When a slow device is present and free space on the db device drops below this fraction of it, new files for the deepest rocksdb levels are placed on the slow device so the wal and the upper levels do not spill over to it.  0 disables."),
+
     Option("bluefs_preextend_wal_files", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
 
+    Option("bluefs_pmem_wal_byte_append", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Append WAL data to persistent memory devices without block padding")
+    .set_long_description("When the device backing a WAL extent is byte addressable persistent memory, write only the new bytes of each WAL append and persist them in place, instead of rewriting the partial tail block and padding it out to the block size.  This takes effect when the device is added to BlueFS."),
+
     Option("bluestore_bluefs", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .add_tag("mkfs")
@@ -3298,6 +3674,18 @@ std::vector<Option> get_global_options() {
     .set_safe()
     .set_description("Default value of bluestore_compression_max_blob_size for non-rotational (solid state) media"),
 
+    Option("bluestore_compression_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(0)
+    .set_description("Threads that compress the blobs of a large write in parallel")
+    .set_long_description("A write that is split into several compressed blobs has them compressed concurrently by this pool while the submitting thread helps and waits.  0 compresses every blob in the submitting thread."),
+
+    Option("bluestore_compression_dictionary_max_blob_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128 << 10)
+    .set_safe()
+    .set_description("Compress blobs up to this size with the pool's compression dictionary, if it has one")
+    .set_long_description("Dictionaries are set with 'ceph osd pool set-compression-dictionary' and help most with small blobs of similar content.  Larger blobs are compressed without the dictionary."),
+
     Option("bluestore_gc_enable_blob_threshold", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
     .set_safe()
@@ -3329,6 +3717,29 @@ std::vector<Option> get_global_options() {
     .set_description("Compression ratio required to store compressed data")
     .set_long_description("If we compress data and get less than this we discard the result and store the original uncompressed data."),
 
+    Option("bluestore_recompress_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Seconds between background recompression passes (0 = disabled)")
+    .set_long_description("When enabled, a background thread walks the objects of each PG collection and rewrites those whose data is fragmented into many small extents, or is stored uncompressed although the pool's compression mode would compress it, into large (compressed) blobs.  Objects rewritten this way are not considered again until they are next written.")
+    .add_see_also("bluestore_recompress_max_bytes_per_sec")
+    .add_see_also("bluestore_compression_mode"),
+
+    Option("bluestore_recompress_max_bytes_per_sec", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8*1024*1024)
+    .set_description("Max bytes per second of object data rewritten by background recompression"),
+
+    Option("bluestore_recompress_idle_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1024*1024)
+    .set_description("Only recompress while fewer than this many bytes of client transactions are in flight"),
+
+    Option("bluestore_recompress_min_extent_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32768)
+    .set_description("Rewrite objects whose average extent is smaller than this"),
+
+    Option("bluestore_recompress_cold_only", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(true)
+    .set_description("Only recompress objects whose onode is not cached, i.e. that have not been accessed recently"),
+
     Option("bluestore_extent_map_shard_max_size", Option::TYPE_UINT, Option::LEVEL_DEV)
     .set_default(1200)
     .set_description("Max size (bytes) for a single extent map shard before splitting"),
@@ -3349,6 +3760,11 @@ std::vector<Option> get_global_options() {
     .set_default(256)
     .set_description("Preallocated buffer for inline shards"),
 
+    Option("bluestore_extent_map_inline_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Keep the encoded copy of inline extent maps in memory")
+    .set_long_description("When disabled, the encoded form of an unsharded extent map is dropped once the onode has been decoded or persisted and is rebuilt on the next update.  This trades some CPU on overwrite for a smaller footprint per cached onode.  The decoded extents themselves are not affected; see bluestore_onode_mem_bytes for the full per-onode footprint."),
+
     Option("bluestore_cache_trim_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.2)
     .set_description("How frequently we trim the bluestore cache"),
@@ -3357,6 +3773,11 @@ std::vector<Option> get_global_options() {
     .set_default(64)
     .set_description("Max pinned cache entries we consider before giving up"),
 
+    Option("bluestore_cache_onode_lockless_lookup", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Serve onode cache hits without taking the cache shard lock")
+    .set_long_description("Onode lookups take only a per-collection shared lock and mark the onode as referenced; the LRU position is updated lazily when the cache is trimmed by the mempool thread instead of on every hit."),
+
     Option("bluestore_cache_type", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("2q")
     .set_enum_allowed({"2q", "lru"})
@@ -3395,6 +3816,29 @@ std::vector<Option> get_global_options() {
     .set_default(512*1024*1024)
     .set_description("Max memory (bytes) to devote to kv database (rocksdb)"),
 
+    Option("bluestore_cache_autotune", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Rebalance the cache between metadata, data and kv by their misses")
+    .set_long_description("Periodically move a chunk of bluestore_cache_size from the consumer (onode metadata, data buffers, kv block cache) that is missing least or has unused space to the full one that read the most bytes on cache misses.  The configured ratios are the starting point.  The kv block cache only reports misses with rocksdb_perf enabled; without it the kv cache can give up unused space but does not grow.")
+    .add_see_also("bluestore_cache_size")
+    .add_see_also("bluestore_cache_meta_ratio")
+    .add_see_also("bluestore_cache_kv_ratio"),
+
+    Option("bluestore_cache_autotune_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(5)
+    .set_description("Seconds between cache autotune rounds")
+    .add_see_also("bluestore_cache_autotune"),
+
+    Option("bluestore_cache_autotune_chunk_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.02)
+    .set_description("Fraction of the cache moved per autotune round")
+    .add_see_also("bluestore_cache_autotune"),
+
+    Option("bluestore_cache_autotune_min_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.05)
+    .set_description("Fraction of the cache autotuning leaves every consumer")
+    .add_see_also("bluestore_cache_autotune"),
+
     Option("bluestore_kvbackend", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("rocksdb")
     .add_tag("mkfs")
@@ -3402,9 +3846,19 @@ std::vector<Option> get_global_options() {
 
     Option("bluestore_allocator", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("stupid")
-    .set_enum_allowed({"bitmap", "stupid"})
+    .set_enum_allowed({"bitmap", "stupid", "hbitmap"})
     .set_description("Allocator policy"),
 
+    Option("bluestore_alloc_snapshot", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Save allocator state on clean umount and load it at the next mount")
+    .set_long_description("The next mount reads the saved free extents instead of scanning the whole freelist.  The snapshot is discarded as soon as it is read, so after a crash the freelist is scanned as usual.  Only the stupid allocator supports this."),
+
+    Option("bluestore_deferred_replay_async", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Finish deferred write replay in the background after mount")
+    .set_long_description("Mount returns once replayed writes are queued.  Object reads and new transactions wait for the replay to finish, but metadata access (e.g. loading PGs) can proceed."),
+
     Option("bluestore_freelist_blocks_per_key", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(128)
     .set_description("Block (and bits) per database key"),
@@ -3417,6 +3871,16 @@ std::vector<Option> get_global_options() {
     .set_default(1024)
     .set_description(""),
 
+    Option("bluestore_hbitmap_cache_shards", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(8)
+    .set_description("Number of per-thread free extent caches in the hbitmap allocator (0 to disable)")
+    .add_see_also("bluestore_hbitmap_cache_refill_size"),
+
+    Option("bluestore_hbitmap_cache_refill_size", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(1048576)
+    .set_description("Bytes the hbitmap allocator moves from its bitmap into a cache shard at a time")
+    .set_long_description("Only unhinted allocations smaller than this are served from the caches."),
+
     Option("bluestore_max_deferred_txc", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(32)
     .set_description("Max transactions with deferred writes that can accumulate before we force flush deferred writes"),
@@ -3425,6 +3889,12 @@ std::vector<Option> get_global_options() {
     .set_default("compression=kNoCompression,max_write_buffer_number=4,min_write_buffer_number_to_merge=1,recycle_log_file_num=4,write_buffer_size=268435456,writable_file_max_buffer_size=0,compaction_readahead_size=2097152")
     .set_description("Rocksdb options"),
 
+    Option("bluestore_rocksdb_cfs", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("Key prefixes to keep in their own rocksdb column families")
+    .set_long_description("Whitespace separated list of prefix=options, e.g. 'M=compaction_style=kCompactionStyleUniversal L=write_buffer_size=67108864'. Each prefix (O onodes, M omap, L deferred, B bitmap, S stat, ...) gets a column family that starts from bluestore_rocksdb_options and applies its own ';' separated rocksdb column family options, so its flushes and compactions do not rewrite the others. Column families are only created by mkfs; later, only the options of existing ones change.")
+    .add_see_also("bluestore_rocksdb_options"),
+
     Option("bluestore_fsck_on_mount", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description("Run fsck at mount"),
@@ -3437,6 +3907,11 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description("Run fsck at umount"),
 
+    Option("bluestore_fsck_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Number of threads fsck uses to walk the object keyspace"),
+
     Option("bluestore_fsck_on_umount_deep", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .set_description("Run deep fsck at umount"),
@@ -3453,6 +3928,12 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description("Try to submit metadata transaction to rocksdb in queuing thread context"),
 
+    Option("bluestore_kv_sync_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_description("Number of kv_sync threads committing metadata transactions")
+    .set_long_description("Transactions are partitioned across kv_sync threads by the hash of their sequencer (i.e., placement group), so ordering within a sequencer is preserved while independent sequencers commit to rocksdb in parallel.  The first thread also handles deferred write cleanup and bluefs balancing.")
+    .add_see_also("bluestore_sync_submit_transaction"),
+
     Option("bluestore_throttle_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(64*1024*1024)
     .set_safe()
@@ -3494,6 +3975,18 @@ std::vector<Option> get_global_options() {
     .set_safe()
     .set_description("Default bluestore_deferred_batch_ops for non-rotational (solid state) media"),
 
+    Option("bluestore_deferred_aggregate_max_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Merge pending deferred batches from different sequencers into one LBA-sorted submission of up to this many bytes")
+    .set_long_description("By default each OpSequencer submits its own deferred batch.  With many PGs those batches are small and scattered; when this is non-zero, batches that are ready at the same time are merged, sorted by device offset (coalescing adjacent writes) and submitted together.  0 disables aggregation.")
+    .add_see_also("bluestore_max_defer_interval"),
+
+    Option("bluestore_max_defer_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Submit pending deferred writes if none have been submitted for this many seconds")
+    .set_long_description("Bounds how long deferred writes can wait for a batch to fill up (see bluestore_deferred_batch_ops).  0 disables the time bound.")
+    .add_see_also("bluestore_deferred_batch_ops"),
+
     Option("bluestore_nid_prealloc", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(1024)
     .set_description("Number of unique object ids to preallocate at a time"),
@@ -3512,6 +4005,22 @@ std::vector<Option> get_global_options() {
     .set_safe()
     .set_description("Cache read results by default (unless hinted NOCACHE or WONTNEED)"),
 
+    Option("bluestore_read_coalesce_gap", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32768)
+    .set_description("Merge device reads separated by at most this many bytes")
+    .set_long_description("A read touching many blobs reads each extent separately.  Extents that are adjacent or closer than this on the device are read with a single io instead, reading through (and discarding) the gap between them.")
+    .add_see_also("bluestore_read_coalesce_max"),
+
+    Option("bluestore_read_coalesce_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1048576)
+    .set_description("Largest device read that merging extents may build")
+    .add_see_also("bluestore_read_coalesce_gap"),
+
+    Option("bluestore_readahead_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Bytes to read ahead into the cache for sequential reads (0 = disabled)")
+    .set_long_description("A read starting where the previous read of the same object ended, or hinted FADVISE_SEQUENTIAL, also reads up to this many bytes past its end into the buffer cache.  Reads hinted RANDOM, DONTNEED or NOCACHE never read ahead."),
+
     Option("bluestore_default_buffered_write", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_safe()
@@ -3553,6 +4062,10 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("bluestore_debug_omit_deferred_apply", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(false)
+    .set_description("Leave deferred writes unapplied and in the kv store, so the next mount must replay them"),
+
     Option("bluestore_debug_fsck_abort", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description(""),
@@ -3620,6 +4133,12 @@ std::vector<Option> get_global_options() {
     .set_default(65536)
     .set_description(""),
 
+    Option("kstore_stripe_cache_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_description("Committed data stripes kept cached per onode")
+    .set_long_description("Stripes written by uncommitted transactions are always cached; this bounds how many clean stripes each cached onode keeps once they commit, so reads and partial writes of small objects don't go back to the kv store.")
+    .add_see_also("kstore_onode_map_size"),
+
     // ---------------------
     // filestore
 
@@ -3708,8 +4227,13 @@ std::vector<Option> get_global_options() {
     .set_description(""),
 
     Option("filestore_omap_header_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
-    .set_default(1024)
-    .set_description(""),
+    .set_default(16384)
+    .set_description("Number of omap headers cached by DBObjectMap, across all shards"),
+
+    Option("filestore_omap_header_cache_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_description("Number of independently locked shards of the omap header cache")
+    .add_see_also("filestore_omap_header_cache_size"),
 
     Option("filestore_max_inline_xattr_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(0)
@@ -4035,6 +4559,12 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("rados_striper_lock_lease", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("duration (in seconds) of the shared locks libradosstriper takes on striped objects")
+    .set_long_description("When set, the shared lock taken on a striped object is kept as a lease and reused by later reads and writes of the same object for half of that duration, instead of being taken and released around every operation. After that the lease is renewed before it is used again. An operation during which the lease lapsed fails with ETIMEDOUT. Removal and truncation of the object by other clients wait for the lease to expire. 0 takes and releases the lock for each operation."),
+
     Option("nss_db_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -4155,6 +4685,32 @@ std::vector<Option> get_rgw_options() {
     .set_default(64 * 1024 * 1024)
     .set_description(""),
 
+    Option("rgw_put_obj_md5_thread_min_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(16 * 1024 * 1024)
+    .set_description("Smallest PUT whose MD5 is computed on a separate thread")
+    .set_long_description("Uploads with a known length of at least this many "
+        "bytes compute their ETag on a helper thread, overlapped with "
+        "receiving and writing the data.  At most "
+        "rgw_put_obj_max_window_size bytes wait to be hashed.  0 disables "
+        "this.")
+    .add_see_also("rgw_put_obj_max_window_size"),
+
+    Option("rgw_compression_thread_min_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(16 * 1024 * 1024)
+    .set_description("Smallest compressed PUT whose parts are compressed on a separate thread")
+    .set_long_description("Uploads with a known length of at least this many "
+        "bytes compress each part on a helper thread while the next part is "
+        "received and the previous one is written.  0 disables this."),
+
+    Option("rgw_compression_max_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.95)
+    .set_min_max(0.0, 1.0)
+    .set_description("Store objects uncompressed when their first part doesn't compress better than this ratio")
+    .set_long_description("The compressed size of an object's first part is "
+        "compared to its original size.  Above this ratio the whole object is "
+        "stored uncompressed, which saves compressing the remaining parts and "
+        "decompressing the object on every read.  1 always compresses."),
+
     Option("rgw_max_put_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5ULL*1024*1024*1024)
     .set_description(""),
@@ -4171,6 +4727,11 @@ std::vector<Option> get_rgw_options() {
     .set_default(8)
     .set_description(""),
 
+    Option("rgw_bucket_index_pipeline_prepare", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Write the object head while the bucket index prepare is in flight")
+    .set_long_description("Normally the bucket index shard is told about a write before the object head is written. With this set both are sent at once, saving a round trip per PUT that creates a new non-versioned object; overwrites keep the old order. The index completion still waits for the prepare, and if the prepare fails the newly created head is removed again."),
+
     Option("rgw_enable_quota_threads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -4199,6 +4760,24 @@ std::vector<Option> get_rgw_options() {
     .set_default(10000)
     .set_description(""),
 
+    Option("rgw_cache_shards", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Number of lock stripes the metadata cache is split into")
+    .set_long_description("Cache entries are hashed by name into this many "
+        "shards, each with its own lock and an equal part of "
+        "rgw_cache_lru_size.  Read at startup.")
+    .add_see_also("rgw_cache_lru_size"),
+
+    Option("rgw_cache_notify_batch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Send concurrent cache notifications as one notify")
+    .set_long_description("While a cache notification to a control object is "
+        "in flight, further notifications for the same control object are "
+        "queued and sent together once it completes.  Every gateway sharing "
+        "the zone must understand batched notifications before this is "
+        "enabled."),
+
     Option("rgw_socket_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -4231,6 +4810,22 @@ std::vector<Option> get_rgw_options() {
     .set_default(60)
     .set_description(""),
 
+    Option("rgw_lc_max_worker", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_min(1)
+    .set_description("Number of lifecycle worker threads")
+    .set_long_description("Every worker walks all lc shards and takes the "
+        "next bucket due from each, so up to this many buckets are "
+        "processed at the same time."),
+
+    Option("rgw_lc_max_wp_worker", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_min(1)
+    .set_description("Number of objects of one bucket listing page expired at the same time")
+    .set_long_description("The expirations are run on the async rados threads.")
+    .add_see_also("rgw_lc_max_worker")
+    .add_see_also("rgw_num_async_rados_threads"),
+
     Option("rgw_lc_max_objs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(32)
     .set_description(""),
@@ -4375,6 +4970,14 @@ std::vector<Option> get_rgw_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("rgw_s3_auth_v4_signing_key_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(10000)
+    .set_min(0)
+    .set_description("Max number of derived AWS v4 signing keys kept in memory")
+    .set_long_description("A signing key is derived from a secret key and the "
+        "date, region and service of a request. Caching it saves four HMAC "
+        "computations on every v4 authenticated request. 0 disables the cache."),
+
     Option("rgw_barbican_url", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -4443,6 +5046,17 @@ std::vector<Option> get_rgw_options() {
     .set_default(100)
     .set_description(""),
 
+    Option("rgw_beast_io_threads", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Number of socket i/o threads in the beast frontend")
+    .set_long_description("If nonzero, the beast frontend reads and parses "
+        "requests and waits on keep-alive connections with this many "
+        "threads, and hands parsed requests to rgw_thread_pool_size request "
+        "threads.  If zero, requests are processed on the i/o threads and "
+        "rgw_thread_pool_size of those are started.")
+    .add_see_also("rgw_thread_pool_size"),
+
     Option("rgw_num_control_oids", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(8)
     .set_description(""),
@@ -4456,7 +5070,7 @@ std::vector<Option> get_rgw_options() {
     .set_description(""),
 
     Option("rgw_nfs_lru_lanes", Option::TYPE_INT, Option::LEVEL_ADVANCED)
-    .set_default(5)
+    .set_default(13)
     .set_description(""),
 
     Option("rgw_nfs_lru_lane_hiwat", Option::TYPE_INT, Option::LEVEL_ADVANCED)
@@ -4464,7 +5078,7 @@ std::vector<Option> get_rgw_options() {
     .set_description(""),
 
     Option("rgw_nfs_fhcache_partitions", Option::TYPE_INT, Option::LEVEL_ADVANCED)
-    .set_default(3)
+    .set_default(13)
     .set_description(""),
 
     Option("rgw_nfs_fhcache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
@@ -4481,6 +5095,11 @@ std::vector<Option> get_rgw_options() {
     .set_min(1)
     .set_description(""),
 
+    Option("rgw_nfs_readahead_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4 << 20)
+    .set_description("Bytes fetched ahead for sequential reads of an NFS file handle")
+    .set_long_description("A read that continues where the previous one on the same handle ended fetches this much in one request and serves the following reads from it.  0 disables readahead."),
+
     Option("rgw_nfs_write_completion_interval_s", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -4594,6 +5213,30 @@ std::vector<Option> get_rgw_options() {
     .set_default(30)
     .set_description(""),
 
+    Option("rgw_usage_log_max_pending", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(16384)
+    .set_description("Usage log entries that may be pending before request threads flush inline")
+    .set_long_description("Crossing rgw_usage_log_flush_threshold only schedules a background flush. If the backlog keeps growing past this many entries, the request thread that adds the next entry writes the backlog itself, so usage data is never dropped.")
+    .add_see_also("rgw_usage_log_flush_threshold"),
+
+    Option("rgw_ops_log_flush_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_description("Seconds between batched writes of the ops log to rados"),
+
+    Option("rgw_ops_log_flush_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(256 << 10)
+    .set_description("Pending ops log bytes in a shard that trigger an early flush"),
+
+    Option("rgw_ops_log_max_pending_bytes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64 << 20)
+    .set_description("Maximum ops log bytes waiting to be written to rados")
+    .set_long_description("Entries that would grow the backlog past this limit are dropped and counted in the ops_log_dropped perf counter, so a slow log pool does not stall requests."),
+
+    Option("rgw_ops_log_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_min(1)
+    .set_description("Number of ops log buffers; request threads are spread across them by thread id"),
+
     Option("rgw_intent_log_object_name", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("%Y-%m-%d-%i-%n")
     .set_description(""),
@@ -4626,6 +5269,16 @@ std::vector<Option> get_rgw_options() {
     .set_default(3600)
     .set_description(""),
 
+    Option("rgw_gc_max_concurrent_io", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(10)
+    .set_min(1)
+    .set_description("Max number of tail object removals gc keeps in flight"),
+
+    Option("rgw_gc_max_trim_chunk", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Max number of tags removed from a gc shard in one op"),
+
     Option("rgw_s3_success_create_obj_status", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description(""),
@@ -4650,6 +5303,16 @@ std::vector<Option> get_rgw_options() {
     .set_default(16 << 20)
     .set_description(""),
 
+    Option("rgw_get_obj_max_window_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(64 << 20)
+    .set_description("Largest window of reads in flight for a single GET")
+    .set_long_description("A GET starts with rgw_get_obj_window_size bytes of "
+        "reads in flight and doubles the window, up to this size, whenever "
+        "it spent more time over the last window waiting for reads than "
+        "sending data to the client.  No larger than "
+        "rgw_get_obj_window_size disables the growth.")
+    .add_see_also("rgw_get_obj_window_size"),
+
     Option("rgw_get_obj_max_req_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(4 << 20)
     .set_description(""),
@@ -4666,6 +5329,11 @@ std::vector<Option> get_rgw_options() {
     .set_default(1000)
     .set_description(""),
 
+    Option("rgw_formatter_stream_chunk_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64 << 10)
+    .set_description("Send bucket listings to the client in chunks of this many bytes as they are formatted")
+    .set_long_description("0 buffers the whole listing and sends it at the end."),
+
     Option("rgw_md_log_max_shards", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(64)
     .set_description(""),
@@ -4682,6 +5350,23 @@ std::vector<Option> get_rgw_options() {
     .set_default(1000)
     .set_description(""),
 
+    Option("rgw_curl_handle_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_min(0)
+    .set_description("Number of idle curl handles kept for reuse")
+    .set_long_description("A reused curl handle keeps its connection to the "
+        "remote endpoint open, so requests to other zones don't have to connect "
+        "and negotiate ssl again. 0 disables the cache."),
+
+    Option("rgw_data_sync_spawn_window_max", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_min(1)
+    .set_description("Maximum number of concurrent sync operations per data sync shard or bucket shard")
+    .set_long_description("Each data sync shard and each bucket shard sync starts "
+        "with 20 concurrent operations. The window grows by one for every "
+        "operation that completes successfully, up to this value, and is halved "
+        "whenever an operation fails."),
+
     Option("rgw_copy_obj_progress", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -4722,6 +5407,18 @@ std::vector<Option> get_rgw_options() {
     .set_default(0.95)
     .set_description(""),
 
+    Option("rgw_quota_nonblocking_check", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Never fetch cached quota stats synchronously on the write path")
+    .set_long_description("Once a bucket or user has stats in the quota cache, "
+        "quota checks use them together with the changes made through this "
+        "gateway, and refresh them in the background. A refresh is started "
+        "right away when the stats cross rgw_bucket_quota_soft_threshold, "
+        "instead of fetching them before the write. When false, stale or "
+        "near-limit stats are fetched before the write is allowed.")
+    .add_see_also("rgw_bucket_quota_soft_threshold")
+    .add_see_also("rgw_bucket_quota_ttl"),
+
     Option("rgw_bucket_quota_cache_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10000)
     .set_description(""),
@@ -4874,6 +5571,11 @@ std::vector<Option> get_rgw_options() {
     .set_default(120)
     .set_description(""),
 
+    Option("rgw_reshard_online", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Copy the bucket index while writes continue when resharding")
+    .set_long_description("Instead of blocking writes to the bucket for the whole copy of its index, copy it while writes go on, replay the changes recorded in the bucket index log, and only block writes for the final replay before switching to the new bucket instance. Versioned buckets and buckets with their index log stopped are always resharded with writes blocked."),
+
     Option("rgw_crypt_require_ssl", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -4894,6 +5596,23 @@ std::vector<Option> get_rgw_options() {
     .set_default(1000)
     .set_description(""),
 
+    Option("rgw_bucket_list_min_shard_entries", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_description("Minimum number of entries to request from each bucket index shard per round of an ordered listing")
+    .set_long_description("Ordered listings of sharded buckets ask every shard for a window of about the requested number of entries divided by the number of shards (but no less than this), and only ask a shard for more once its window has been merged into the result."),
+
+    Option("rgw_index_complete_batch_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(128)
+    .set_min(1)
+    .set_description("Maximum number of bucket index completions sent to an index shard in one op")
+    .set_long_description("Multi-object deletes and lifecycle expiration gather the bucket index updates of the objects they remove, and send those landing on the same index shard together, up to this many per op."),
+
+    Option("rgw_bucket_list_server_delimiter", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Roll up common prefixes in the bucket index when listing with a delimiter")
+    .set_long_description("When a bucket is listed with a delimiter, ask the bucket index to return a single entry for each common prefix instead of every object below it. OSDs that do not support this return the full listing, which the gateway still rolls up itself."),
+
     Option("rgw_rest_getusage_op_compat", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -5051,6 +5770,12 @@ static std::vector<Option> get_rbd_options() {
     .set_default(true)
     .set_description("process AIO ops from a dispatch thread to prevent blocking"),
 
+    Option("rbd_non_blocking_aio_inline", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("dispatch AIO ops on the caller's thread when nothing could block them")
+    .set_long_description("With rbd_non_blocking_aio, send AIO ops straight from the caller's thread instead of the dispatch thread while the exclusive lock is held, no refresh or write-blocking operation is pending, nothing is queued ahead of them and no cache is enabled.")
+    .add_see_also("rbd_non_blocking_aio"),
+
     Option("rbd_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("whether to enable caching (writeback unless rbd_cache_max_dirty is 0)"),
@@ -5085,6 +5810,34 @@ static std::vector<Option> get_rbd_options() {
     .set_default(false)
     .set_description("whether to block writes to the cache before the aio_write call completes"),
 
+    Option("rbd_persistent_cache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("directory for the persistent read cache of read-only snapshots")
+    .set_long_description("When set, reads of images opened read-only at a snapshot (such as the parents of clones) are cached in a file in this directory, shared by all clients on the host that open the same snapshot. Empty disables the cache."),
+
+    Option("rbd_persistent_cache_block_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64 * 1024)
+    .set_min(4096)
+    .set_description("unit in which the persistent read cache stores data")
+    .add_see_also("rbd_persistent_cache_path"),
+
+    Option("rbd_persistent_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(10ULL << 30)
+    .set_description("maximum amount of data the persistent read cache keeps per snapshot")
+    .set_long_description("Once a snapshot's cache file holds this much data, the least recently used blocks are dropped to make room for new ones. Each process enforces the limit against the blocks it finds when opening the file and those it fills itself, so concurrent users of the same snapshot may briefly exceed it. 0 disables the limit.")
+    .add_see_also("rbd_persistent_cache_path"),
+
+    Option("rbd_write_log_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("directory for the local write-back log of writable images")
+    .set_long_description("When set, writes to images opened read-write are persisted to a log file in this directory (ideally on SSD or persistent memory) and acknowledged from there, then written back to the cluster in the background. Records are written back when the image is next opened on this host, so an image with an unflushed log must not be opened elsewhere. Empty disables the log."),
+
+    Option("rbd_write_log_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1ULL << 30)
+    .set_min(1ULL << 20)
+    .set_description("size of the local write-back log of each image")
+    .add_see_also("rbd_write_log_path"),
+
     Option("rbd_concurrent_management_ops", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_min(1)
@@ -5134,6 +5887,21 @@ static std::vector<Option> get_rbd_options() {
     .set_default(30)
     .set_description("number of seconds before maintenance request times out"),
 
+    Option("rbd_object_map_batch_updates", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("coalesce object map updates issued while another update is in flight")
+    .set_long_description("Updates queued behind an in-flight object map update are sent together once it completes, with contiguous updates to the same state merged into one ranged update."),
+
+    Option("rbd_object_map_premark_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("number of objects ahead of a sequential writer to mark as existing in the object map")
+    .set_long_description("When the first write to an object directly follows an existing object, also mark up to this many following nonexistent objects as existing, saving an object map update for each of them. Marked objects that are never written are reported as allocated by fast-diff and du. 0 disables."),
+
+    Option("rbd_server_side_copyup", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("have the OSDs copy parent objects for copy-up and flatten")
+    .set_long_description("When a clone object is copied up from a parent with the same object layout, copy the parent object OSD-to-OSD instead of reading it into the client and writing it back. Falls back to the client-side copy if the parent object does not exist."),
+
     Option("rbd_skip_partial_discard", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("when trying to discard a range inside an object, set to true to skip zeroing the range"),
@@ -5150,6 +5918,11 @@ static std::vector<Option> get_rbd_options() {
     .set_default(false)
     .set_description("create a blkin trace for all RBD requests"),
 
+    Option("rbd_blkin_trace_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("create a blkin trace for one in every N RBD requests")
+    .set_long_description("0 disables sampling.  Ignored when rbd_blkin_trace_all is set.  Like other rbd options it can be set per pool or per image."),
+
     Option("rbd_validate_pool", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("validate empty pools for RBD compatibility"),
@@ -5215,6 +5988,11 @@ static std::vector<Option> get_rbd_options() {
     .set_default(0)
     .set_description("maximum age (in seconds) for pending commits"),
 
+    Option("rbd_journal_object_max_in_flight_appends", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("maximum number of in-flight appends per journal object")
+    .set_long_description("Appends issued while the limit is reached are coalesced and sent as a single op once an in-flight append completes. 0 implies no limit."),
+
     Option("rbd_journal_pool", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("pool for journal objects"),
@@ -5226,6 +6004,12 @@ static std::vector<Option> get_rbd_options() {
     Option("rbd_journal_max_concurrent_object_sets", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description("maximum number of object sets a journal client can be behind before it is automatically unregistered"),
+
+    Option("rbd_journal_replay_max_concurrent_ios", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("maximum number of journal IO events to replay concurrently")
+    .set_long_description("Write, discard and writesame events that do not overlap an in-flight event are applied to the image concurrently, up to this limit. Flushes are ordered by librbd and all other events wait for in-flight events to complete. 1 replays events one at a time."),
   });
 }
 
@@ -5313,6 +6097,17 @@ std::vector<Option> get_mds_options() {
     .set_default(16384)
     .set_description(""),
 
+    Option("mds_max_backtrace_writes", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(256)
+    .set_min(1)
+    .set_description("maximum number of inode backtrace writes the MDS keeps in flight")
+    .set_long_description("Further writes wait in a queue; each inode has at most one write queued or in flight, and updates made in the meantime are folded into it."),
+
+    Option("mds_dir_partial_fetch_min", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(100000)
+    .set_description("minimum number of entries in a directory for a path lookup to load only the wanted dentry instead of the whole dirfrag")
+    .set_long_description("0 always loads whole dirfrags."),
+
     Option("mds_decay_halflife", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description(""),
@@ -5505,6 +6300,12 @@ std::vector<Option> get_mds_options() {
     .set_default(.1)
     .set_description(""),
 
+    Option("mds_bal_import_hold_time", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Seconds a newly imported subtree is kept before the balancer may export it again")
+    .set_long_description("Damps subtrees ping-ponging between ranks: the imported subtree's popularity is still settling, and exporting it straight back (or on to a third rank) freezes it again for no gain. 0 disables.")
+    .add_see_also("mds_bal_interval"),
+
     Option("mds_bal_min_start", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.2)
     .set_description(""),
@@ -5777,6 +6578,12 @@ std::vector<Option> get_mds_client_options() {
     .set_default(4)
     .set_description(""),
 
+    Option("client_direct_read_min_bytes", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Read directly from the OSDs when a read is at least this large")
+    .set_long_description("Reads of at least this many bytes bypass the object cache and are issued to all objects they span in parallel, as with O_DIRECT. Dirty cached data in the range is flushed first. 0 disables.")
+    .add_see_also("client_oc"),
+
     Option("client_reconnect_stale", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description(""),
@@ -5877,6 +6684,11 @@ std::vector<Option> get_mds_client_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("client_readdir_refetch_threshold", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_description("Refetch a cached directory from the MDS when this many entries lack the caps to stat them")
+    .set_long_description("When readdirplus walks a cached directory and this many of the remaining entries are missing the caps needed for the requested attributes, the client reads the directory again from the MDS. That fetches fresh attributes and caps for the whole chunk in one round trip, instead of one getattr per entry. 0 always uses per-entry getattr."),
+
     Option("fuse_use_invalidate_cb", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -5909,6 +6721,10 @@ std::vector<Option> get_mds_client_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("fuse_splice", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Move read and write data between the kernel and ceph-fuse with splice when the kernel supports it"),
+
     Option("fuse_require_active_mds", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
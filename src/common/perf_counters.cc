@@ -162,6 +162,39 @@ PerfCounters::~PerfCounters()
 {
 }
 
+// Each thread gets the next shard the first time it updates a sharded
+// counter, so up to num_shards threads never touch the same cacheline.
+static inline unsigned pick_shard()
+{
+  static std::atomic<unsigned> next_shard = { 0 };
+  static thread_local unsigned i =
+    next_shard.fetch_add(1, std::memory_order_relaxed) %
+    PerfCounters::num_shards;
+  return i;
+}
+
+static inline void add_to(PerfCounters::perf_counter_data_any_d& data,
+			  uint64_t amt)
+{
+  if (data.shards) {
+    PerfCounters::perf_counter_data_any_d::shard_t& s =
+      data.shards[pick_shard()];
+    if (data.type & PERFCOUNTER_LONGRUNAVG) {
+      s.avgcount++;
+      s.u64 += amt;
+      s.avgcount2++;
+    } else {
+      s.u64 += amt;
+    }
+  } else if (data.type & PERFCOUNTER_LONGRUNAVG) {
+    data.avgcount++;
+    data.u64 += amt;
+    data.avgcount2++;
+  } else {
+    data.u64 += amt;
+  }
+}
+
 void PerfCounters::inc(int idx, uint64_t amt)
 {
   if (!m_cct->_conf->perf)
@@ -172,13 +205,7 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt;
-    data.avgcount2++;
-  } else {
-    data.u64 += amt;
-  }
+  add_to(data, amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -192,7 +219,10 @@ void PerfCounters::dec(int idx, uint64_t amt)
   assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  if (data.shards)
+    data.shards[pick_shard()].u64 -= amt;
+  else
+    data.u64 -= amt;
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -208,6 +238,11 @@ void PerfCounters::set(int idx, uint64_t amt)
 
   ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
                              "perf counter atomic");
+  if (data.shards) {
+    for (unsigned i = 0; i < num_shards; ++i) {
+      data.shards[i].u64 = 0;
+    }
+  }
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount++;
     data.u64 = amt;
@@ -227,7 +262,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt, uint32_t avgcount)
@@ -240,13 +275,7 @@ void PerfCounters::tinc(int idx, utime_t amt, uint32_t avgcount)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.to_nsec();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.to_nsec();
-  }
+  add_to(data, amt.to_nsec());
 }
 
 void PerfCounters::tinc(int idx, ceph::timespan amt, uint32_t avgcount)
@@ -259,13 +288,7 @@ void PerfCounters::tinc(int idx, ceph::timespan amt, uint32_t avgcount)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.count();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.count();
-  }
+  add_to(data, amt.count());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -293,7 +316,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -436,7 +459,7 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         d->histogram->dump_formatted(f);
         f->close_section();
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -552,6 +575,12 @@ void PerfCountersBuilder::add_impl(
   data.prio = prio;
   data.type = (enum perfcounter_type_d)ty;
   data.histogram = std::move(histogram);
+  if (m_sharded && !data.histogram &&
+      (ty & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG))) {
+    data.shards.reset(
+      new PerfCounters::perf_counter_data_any_d::shard_t[
+	PerfCounters::num_shards]);
+  }
 }
 
 PerfCounters *PerfCountersBuilder::create_perf_counters()
@@ -83,7 +83,7 @@ public:
         description(other.description),
         nick(other.nick),
 	type(other.type),
-	u64(other.u64.load()) {
+	u64(other.read_u64()) {
       pair<uint64_t,uint64_t> a = other.read_avg();
       u64 = a.first;
       avgcount = a.second;
@@ -103,18 +103,47 @@ public:
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
 
+    // Counters and averages built with PerfCountersBuilder::set_sharded()
+    // are updated in a per-thread shard instead of u64/avgcount, and
+    // summed up when read.  Each shard is padded so that two shards
+    // never share a cacheline.
+    struct shard_t {
+      std::atomic<uint64_t> u64 = { 0 };
+      std::atomic<uint64_t> avgcount = { 0 };
+      std::atomic<uint64_t> avgcount2 = { 0 };
+      char __padding[128 - sizeof(std::atomic<uint64_t>)*3];
+    };
+    std::unique_ptr<shard_t[]> shards;
+
     void reset()
     {
       if (type != PERFCOUNTER_U64) {
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	if (shards) {
+	  for (unsigned i = 0; i < num_shards; ++i) {
+	    shards[i].u64 = 0;
+	    shards[i].avgcount = 0;
+	    shards[i].avgcount2 = 0;
+	  }
+	}
       }
       if (histogram) {
         histogram->reset();
       }
     }
 
+    uint64_t read_u64() const {
+      uint64_t sum = u64;
+      if (shards) {
+	for (unsigned i = 0; i < num_shards; ++i) {
+	  sum += shards[i].u64;
+	}
+      }
+      return sum;
+    }
+
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
     // without any intervening calls to inc, set, or tinc.
@@ -124,6 +153,17 @@ public:
 	count = avgcount;
 	sum = u64;
       } while (avgcount2 != count);
+      if (shards) {
+	for (unsigned i = 0; i < num_shards; ++i) {
+	  uint64_t ssum, scount;
+	  do {
+	    scount = shards[i].avgcount;
+	    ssum = shards[i].u64;
+	  } while (shards[i].avgcount2 != scount);
+	  sum += ssum;
+	  count += scount;
+	}
+      }
       return make_pair(sum, count);
     }
   };
@@ -144,6 +184,10 @@ public:
     }
   };
 
+  enum {
+    num_shards = 16
+  };
+
   ~PerfCounters();
 
   void inc(int idx, uint64_t v = 1);
@@ -313,6 +357,11 @@ public:
     const char* nick = NULL,
     int prio=0);
 
+  /// shard counters and averages added after this call across threads
+  void set_sharded(bool s) {
+    m_sharded = s;
+  }
+
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -322,6 +371,7 @@ private:
                 unique_ptr<PerfHistogram<>> histogram = nullptr);
 
   PerfCounters *m_perf_counters;
+  bool m_sharded = false;
 };
 
 class PerfCountersDeleter {
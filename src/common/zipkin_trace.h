@@ -72,6 +72,28 @@ class Trace {
 
 #endif // !WITH_BLKIN
 
+/**
+ * Head-based sampling for requests that did not arrive with a trace.
+ * Returns true for roughly one in every @rate calls, and never if @rate is
+ * 0.  The decision is made once where a request enters a layer; the trace
+ * info then travels with the request, so the layers below follow it without
+ * sampling again.  Uses a per-thread generator so the hot path takes no
+ * shared cache line.
+ */
+static inline bool ztrace_sample(uint64_t rate)
+{
+  if (rate <= 1)
+    return rate == 1;
+  static thread_local uint64_t state = 0;
+  if (!state)
+    state = reinterpret_cast<uintptr_t>(&state) | 1;
+  // xorshift64
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state % rate == 0;
+}
+
 static inline void encode(const blkin_trace_info& b, bufferlist& bl)
 {
   ::encode(b.trace_id, bl);
@@ -66,6 +66,13 @@ public:
   // alignment with decode methods
   virtual int decompress(ceph::bufferlist::iterator &p, size_t compressed_len, ceph::bufferlist &out) = 0;
 
+  // a compressor of the same algorithm primed with a dictionary, or null
+  // if the algorithm has none.  Its output can only be decompressed by a
+  // compressor primed with the same dictionary.
+  virtual CompressorRef with_dictionary(const ceph::bufferlist &dict) {
+    return CompressorRef();
+  }
+
   static CompressorRef create(CephContext *cct, const std::string &type);
   static CompressorRef create(CephContext *cct, int alg);
 
@@ -23,12 +23,49 @@
 #define COMPRESSION_LEVEL 5
 
 class ZstdCompressor : public Compressor {
+  // digested dictionary, if any
+  ZSTD_CDict *cdict = nullptr;
+  ZSTD_DDict *ddict = nullptr;
+
  public:
   ZstdCompressor() : Compressor(COMP_ALG_ZSTD, "zstd") {}
+  explicit ZstdCompressor(const bufferlist &dict)
+    : Compressor(COMP_ALG_ZSTD, "zstd") {
+    bufferlist d(dict);
+    cdict = ZSTD_createCDict(d.c_str(), d.length(), COMPRESSION_LEVEL);
+    ddict = ZSTD_createDDict(d.c_str(), d.length());
+  }
+  ~ZstdCompressor() override {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDDict(ddict);
+  }
+
+  CompressorRef with_dictionary(const bufferlist &dict) override {
+    auto c = std::make_shared<ZstdCompressor>(dict);
+    if (!c->cdict || !c->ddict) {
+      return CompressorRef();
+    }
+    return c;
+  }
 
   int compress(const bufferlist &src, bufferlist &dst) override {
     bufferptr outptr = buffer::create_page_aligned(
       ZSTD_compressBound(src.length()));
+    if (cdict) {
+      // dictionaries are for small inputs; compress them in one shot
+      bufferlist in(src);
+      ZSTD_CCtx *cctx = ZSTD_createCCtx();
+      size_t r = ZSTD_compress_usingCDict(cctx, outptr.c_str(),
+					  outptr.length(), in.c_str(),
+					  in.length(), cdict);
+      ZSTD_freeCCtx(cctx);
+      if (ZSTD_isError(r)) {
+	return -1;
+      }
+      ::encode((uint32_t)src.length(), dst);
+      dst.append(outptr, 0, r);
+      return 0;
+    }
     ZSTD_outBuffer_s outbuf;
     outbuf.dst = outptr.c_str();
     outbuf.size = outptr.length();
@@ -73,6 +110,20 @@ class ZstdCompressor : public Compressor {
     ::decode(dst_len, p);
 
     bufferptr dstptr(dst_len);
+    if (ddict) {
+      bufferlist in;
+      p.copy(compressed_len, in);
+      ZSTD_DCtx *dctx = ZSTD_createDCtx();
+      size_t r = ZSTD_decompress_usingDDict(dctx, dstptr.c_str(),
+					    dstptr.length(), in.c_str(),
+					    in.length(), ddict);
+      ZSTD_freeDCtx(dctx);
+      if (ZSTD_isError(r)) {
+	return -1;
+      }
+      dst.append(dstptr, 0, r);
+      return 0;
+    }
     ZSTD_outBuffer_s outbuf;
     outbuf.dst = dstptr.c_str();
     outbuf.size = dstptr.length();
@@ -7,6 +7,7 @@
 #include "include/ceph_features.h"
 
 #include <algorithm>
+#include <chrono>
 #include <stdlib.h>
 #include <boost/lexical_cast.hpp>
 // to workaround https://svn.boost.org/trac/boost/ticket/9501
@@ -550,6 +551,8 @@ int CrushTester::test()
       int objects_per_batch = num_objects / num_batches;
       int batch_min = min_x;
       int batch_max = min_x + objects_per_batch - 1;
+      std::chrono::steady_clock::duration mapping_time =
+        std::chrono::steady_clock::duration::zero();
 
       // get the total weight of the system
       int total_weight = 0;
@@ -603,6 +606,7 @@ int CrushTester::test()
 
         // create a vector to hold placement results temporarily 
         vector<int> temporary_per ( per.size() );
+        auto batch_start = std::chrono::steady_clock::now();
 
         for (int x = batch_min; x <= batch_max; x++) {
           // create a vector to hold the results of a CRUSH placement or RNG simulation
@@ -648,10 +652,20 @@ int CrushTester::test()
           }
         }
 
+        mapping_time += std::chrono::steady_clock::now() - batch_start;
         batch_min = batch_max + 1;
         batch_max = batch_min + objects_per_batch - 1;
       }
 
+      if (output_timing) {
+        double secs = std::chrono::duration<double>(mapping_time).count();
+        err << "rule " << r << " (" << crush.get_rule_name(r) << ") num_rep " << nr
+            << " mapped " << num_objects << " inputs in " << secs << "s";
+        if (secs > 0)
+          err << " (" << (uint64_t)(num_objects / secs) << " mappings/s)";
+        err << std::endl;
+      }
+
       for (unsigned i = 0; i < per.size(); i++)
         if (output_utilization && !output_statistics)
           err << "  device " << i
@@ -31,6 +31,7 @@ class CrushTester {
   bool output_mappings;
   bool output_bad_mappings;
   bool output_choose_tries;
+  bool output_timing;
 
   bool output_data_file;
   bool output_csv;
@@ -183,6 +184,7 @@ public:
       output_mappings(false),
       output_bad_mappings(false),
       output_choose_tries(false),
+      output_timing(false),
       output_data_file(false),
       output_csv(false),
       output_data_file_name("")
@@ -252,6 +254,13 @@ public:
     return output_choose_tries;
   }
 
+  void set_output_timing(bool b) {
+    output_timing = b;
+  }
+  bool get_output_timing() const {
+    return output_timing;
+  }
+
   void set_batches(int b) {
     num_batches = b;
   }
@@ -319,47 +319,61 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
   return arg->ids;
 }
 
+/*
+ * the item hashes are computed CRUSH_STRAW2_BATCH at a time so that
+ * crush_hash32_3_batch() can use vector lanes; the draws (and so the
+ * result) are the same as hashing one item at a time.
+ */
+#define CRUSH_STRAW2_BATCH 16
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
-	unsigned int i, high = 0;
+	unsigned int i, j, n, high = 0;
 	unsigned int u;
+	__u32 hashes[CRUSH_STRAW2_BATCH];
 	__s64 ln, draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
-                dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
-		if (weights[i]) {
-			u = crush_hash32_3(bucket->h.hash, x, ids[i], r);
-			u &= 0xffff;
-
-			/*
-			 * for some reason slightly less than 0x10000 produces
-			 * a slightly more accurate distribution... probably a
-			 * rounding effect.
-			 *
-			 * the natural log lookup table maps [0,0xffff]
-			 * (corresponding to real numbers [1/0x10000, 1] to
-			 * [0, 0xffffffffffff] (corresponding to real numbers
-			 * [-11.090355,0]).
-			 */
-			ln = crush_ln(u) - 0x1000000000000ll;
-
-			/*
-			 * divide by 16.16 fixed-point weight.  note
-			 * that the ln value is negative, so a larger
-			 * weight means a larger (less negative) value
-			 * for draw.
-			 */
-			draw = div64_s64(ln, weights[i]);
-		} else {
-			draw = S64_MIN;
-		}
+	for (j = 0; j < bucket->h.size; j += CRUSH_STRAW2_BATCH) {
+		n = bucket->h.size - j;
+		if (n > CRUSH_STRAW2_BATCH)
+			n = CRUSH_STRAW2_BATCH;
+		crush_hash32_3_batch(bucket->h.hash, x, ids + j, r, hashes, n);
+		for (i = j; i < j + n; i++) {
+			dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
+			if (weights[i]) {
+				u = hashes[i - j] & 0xffff;
+
+				/*
+				 * for some reason slightly less than 0x10000
+				 * produces a slightly more accurate
+				 * distribution... probably a rounding effect.
+				 *
+				 * the natural log lookup table maps
+				 * [0,0xffff] (corresponding to real numbers
+				 * [1/0x10000, 1] to [0, 0xffffffffffff]
+				 * (corresponding to real numbers
+				 * [-11.090355,0]).
+				 */
+				ln = crush_ln(u) - 0x1000000000000ll;
 
-		if (i == 0 || draw > high_draw) {
-			high = i;
-			high_draw = draw;
+				/*
+				 * divide by 16.16 fixed-point weight.  note
+				 * that the ln value is negative, so a larger
+				 * weight means a larger (less negative) value
+				 * for draw.
+				 */
+				draw = div64_s64(ln, weights[i]);
+			} else {
+				draw = S64_MIN;
+			}
+
+			if (i == 0 || draw > high_draw) {
+				high = i;
+				high_draw = draw;
+			}
 		}
 	}
 
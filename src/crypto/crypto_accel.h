@@ -33,5 +33,35 @@ class CryptoAccel {
   virtual bool cbc_decrypt(unsigned char* out, const unsigned char* in, size_t size,
                    const unsigned char (&iv)[AES_256_IVSIZE],
                    const unsigned char (&key)[AES_256_KEYSIZE]) = 0;
+
+  /**
+   * Transform size bytes as consecutive chunk_size pieces (the last one
+   * may be shorter), piece i chained from iv[i], all under the same key.
+   * Implementations can override these to expand the key only once.
+   */
+  virtual bool cbc_encrypt_chunks(unsigned char* out, const unsigned char* in,
+                   size_t size, size_t chunk_size,
+                   const unsigned char (*iv)[AES_256_IVSIZE],
+                   const unsigned char (&key)[AES_256_KEYSIZE]) {
+    for (size_t offset = 0, i = 0; offset < size; offset += chunk_size, ++i) {
+      size_t len = offset + chunk_size <= size ? chunk_size : size - offset;
+      if (!cbc_encrypt(out + offset, in + offset, len, iv[i], key)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  virtual bool cbc_decrypt_chunks(unsigned char* out, const unsigned char* in,
+                   size_t size, size_t chunk_size,
+                   const unsigned char (*iv)[AES_256_IVSIZE],
+                   const unsigned char (&key)[AES_256_KEYSIZE]) {
+    for (size_t offset = 0, i = 0; offset < size; offset += chunk_size, ++i) {
+      size_t len = offset + chunk_size <= size ? chunk_size : size - offset;
+      if (!cbc_decrypt(out + offset, in + offset, len, iv[i], key)) {
+        return false;
+      }
+    }
+    return true;
+  }
 };
 #endif
@@ -27,5 +27,13 @@ class ISALCryptoAccel : public CryptoAccel {
   bool cbc_decrypt(unsigned char* out, const unsigned char* in, size_t size,
                    const unsigned char (&iv)[AES_256_IVSIZE],
                    const unsigned char (&key)[AES_256_KEYSIZE]) override;
+  bool cbc_encrypt_chunks(unsigned char* out, const unsigned char* in,
+                   size_t size, size_t chunk_size,
+                   const unsigned char (*iv)[AES_256_IVSIZE],
+                   const unsigned char (&key)[AES_256_KEYSIZE]) override;
+  bool cbc_decrypt_chunks(unsigned char* out, const unsigned char* in,
+                   size_t size, size_t chunk_size,
+                   const unsigned char (*iv)[AES_256_IVSIZE],
+                   const unsigned char (&key)[AES_256_KEYSIZE]) override;
 };
 #endif
@@ -19,8 +19,10 @@
 #include <algorithm>
 
 #include "ErasureCode.h"
+#include "ErasureCodeRegion.h"
 
 #include "common/strtol.h"
+#include "include/assert.h"
 #include "include/buffer.h"
 #include "crush/CrushWrapper.h"
 #include "osd/osd_types.h"
@@ -320,3 +322,43 @@ int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
   }
   return r;
 }
+
+void ErasureCode::encode_delta(const bufferptr &old_data,
+			       const bufferptr &new_data,
+			       bufferptr *delta)
+{
+  // all the codes shipped here are linear over GF(2^w), for which the
+  // difference between two chunk contents is their xor
+  assert(old_data.length() == new_data.length());
+  unsigned length = old_data.length();
+  if (delta->length() != length)
+    *delta = buffer::create_aligned(length, SIMD_ALIGN);
+  const char *src[2] = { old_data.c_str(), new_data.c_str() };
+  ceph::ec_region::xor_regions(src, 2, delta->c_str(), length);
+}
+
+int ErasureCode::apply_delta(const map<int, bufferptr> &in,
+			     map<int, bufferptr> &out)
+{
+  return -EOPNOTSUPP;
+}
+
+int ErasureCode::check_delta(const map<int, bufferptr> &in,
+			     const map<int, bufferptr> &out) const
+{
+  if (in.empty() || out.empty())
+    return -EINVAL;
+  unsigned k = get_data_chunk_count();
+  unsigned length = in.begin()->second.length();
+  for (auto &i : in) {
+    if (i.first < 0 || (unsigned)i.first >= k ||
+	i.second.length() != length)
+      return -EINVAL;
+  }
+  for (auto &i : out) {
+    if ((unsigned)i.first < k || (unsigned)i.first >= get_chunk_count() ||
+	i.second.length() != length)
+      return -EINVAL;
+  }
+  return 0;
+}
@@ -446,6 +446,47 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Return true if the coding chunks can be updated in place from
+     * the change made to some data chunks, see **encode_delta** and
+     * **apply_delta**. This allows a small overwrite to read and
+     * write only the data chunk(s) it touches plus the coding chunks
+     * instead of re-encoding the whole stripe.
+     *
+     * @return **true** if **apply_delta** is implemented
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute in **delta** the difference between the **old_data**
+     * and **new_data** content of a data chunk (or of the same range
+     * within it). All three buffers must have the same length.
+     *
+     * @param [in] old_data previous content
+     * @param [in] new_data content about to be written
+     * @param [out] delta buffer receiving the difference
+     */
+    virtual void encode_delta(const bufferptr &old_data,
+			      const bufferptr &new_data,
+			      bufferptr *delta) = 0;
+
+    /**
+     * Update the coding chunks in **out** in place so that they
+     * reflect the data chunk deltas in **in**, as computed by
+     * **encode_delta**. Both maps are keyed by chunk index as seen by
+     * **encode_chunks**; **in** must only contain data chunks and
+     * **out** only coding chunks. All buffers must cover the same
+     * range and have the same length.
+     *
+     * Returns 0 on success.
+     *
+     * @param [in] in map data chunk indexes to deltas
+     * @param [in,out] out map coding chunk indexes to coding data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferptr> &in,
+			    std::map<int, bufferptr> &out) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
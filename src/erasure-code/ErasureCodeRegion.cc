@@ -0,0 +1,402 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <atomic>
+#include <string.h>
+
+#include "ErasureCodeRegion.h"
+
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC__ >= 5)
+#define EC_REGION_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define EC_REGION_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace ceph {
+namespace ec_region {
+
+// -----------------------------------------------------------------------------
+// GF(2^8) arithmetic, polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d)
+
+namespace {
+
+struct gf8_tables_t {
+  uint8_t log[256];
+  uint8_t exp[512];
+  gf8_tables_t() {
+    unsigned x = 1;
+    for (unsigned i = 0; i < 255; i++) {
+      exp[i] = exp[i + 255] = x;
+      log[x] = i;
+      x <<= 1;
+      if (x & 0x100)
+	x ^= 0x11d;
+    }
+    exp[510] = exp[255];
+    log[0] = 0;
+  }
+};
+
+const gf8_tables_t &gf8_tables()
+{
+  static const gf8_tables_t t;
+  return t;
+}
+
+/// split tables: c * b == lo[b & 15] ^ hi[b >> 4]
+void gf8_split_tables(uint8_t c, uint8_t *lo, uint8_t *hi)
+{
+  for (unsigned i = 0; i < 16; i++) {
+    lo[i] = gf8_mul(c, i);
+    hi[i] = gf8_mul(c, i << 4);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// portable kernels, also used for the tails of the vector ones
+
+void xor_generic(const char * const *src, unsigned n, char *dst,
+		 size_t off, size_t size)
+{
+  size_t i = off;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t acc, v;
+    memcpy(&acc, src[0] + i, sizeof(acc));
+    for (unsigned j = 1; j < n; j++) {
+      memcpy(&v, src[j] + i, sizeof(v));
+      acc ^= v;
+    }
+    memcpy(dst + i, &acc, sizeof(acc));
+  }
+  for (; i < size; i++) {
+    char acc = src[0][i];
+    for (unsigned j = 1; j < n; j++)
+      acc ^= src[j][i];
+    dst[i] = acc;
+  }
+}
+
+void gf8_mul_xor_generic(const char *src, const uint8_t *lo, const uint8_t *hi,
+			 char *dst, size_t off, size_t size)
+{
+  const uint8_t *s = (const uint8_t *)src;
+  uint8_t *d = (uint8_t *)dst;
+  for (size_t i = off; i < size; i++)
+    d[i] ^= lo[s[i] & 15] ^ hi[s[i] >> 4];
+}
+
+// -----------------------------------------------------------------------------
+// x86_64 kernels; they return how many bytes they handled
+
+#ifdef EC_REGION_X86
+
+size_t xor_sse2(const char * const *src, unsigned n, char *dst, size_t size)
+{
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i acc = _mm_loadu_si128((const __m128i *)(src[0] + i));
+    for (unsigned j = 1; j < n; j++)
+      acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i *)(src[j] + i)));
+    _mm_storeu_si128((__m128i *)(dst + i), acc);
+  }
+  return i;
+}
+
+__attribute__((target("ssse3")))
+size_t gf8_mul_xor_ssse3(const char *src, const uint8_t *lo, const uint8_t *hi,
+			 char *dst, size_t size)
+{
+  const __m128i tlo = _mm_loadu_si128((const __m128i *)lo);
+  const __m128i thi = _mm_loadu_si128((const __m128i *)hi);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i l = _mm_and_si128(s, mask);
+    __m128i h = _mm_and_si128(_mm_srli_epi64(s, 4), mask);
+    __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, l),
+			      _mm_shuffle_epi8(thi, h));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, p));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t xor_avx2(const char * const *src, unsigned n, char *dst, size_t size)
+{
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i acc = _mm256_loadu_si256((const __m256i *)(src[0] + i));
+    for (unsigned j = 1; j < n; j++)
+      acc = _mm256_xor_si256(
+	acc, _mm256_loadu_si256((const __m256i *)(src[j] + i)));
+    _mm256_storeu_si256((__m256i *)(dst + i), acc);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+size_t gf8_mul_xor_avx2(const char *src, const uint8_t *lo, const uint8_t *hi,
+			char *dst, size_t size)
+{
+  const __m256i tlo = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i *)lo));
+  const __m256i thi = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i *)hi));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i l = _mm256_and_si256(s, mask);
+    __m256i h = _mm256_and_si256(_mm256_srli_epi64(s, 4), mask);
+    __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, l),
+				 _mm256_shuffle_epi8(thi, h));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(d, p));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+size_t xor_avx512(const char * const *src, unsigned n, char *dst, size_t size)
+{
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m512i acc = _mm512_loadu_si512((const void *)(src[0] + i));
+    for (unsigned j = 1; j < n; j++)
+      acc = _mm512_xor_si512(acc, _mm512_loadu_si512((const void *)(src[j] + i)));
+    _mm512_storeu_si512((void *)(dst + i), acc);
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+size_t gf8_mul_xor_avx512(const char *src, const uint8_t *lo, const uint8_t *hi,
+			  char *dst, size_t size)
+{
+  const __m512i tlo = _mm512_broadcast_i32x4(
+    _mm_loadu_si128((const __m128i *)lo));
+  const __m512i thi = _mm512_broadcast_i32x4(
+    _mm_loadu_si128((const __m128i *)hi));
+  const __m512i mask = _mm512_set1_epi32(0x0f0f0f0f);
+  size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    __m512i s = _mm512_loadu_si512((const void *)(src + i));
+    __m512i l = _mm512_and_si512(s, mask);
+    __m512i h = _mm512_and_si512(_mm512_srli_epi64(s, 4), mask);
+    __m512i p = _mm512_xor_si512(_mm512_shuffle_epi8(tlo, l),
+				 _mm512_shuffle_epi8(thi, h));
+    __m512i d = _mm512_loadu_si512((const void *)(dst + i));
+    _mm512_storeu_si512((void *)(dst + i), _mm512_xor_si512(d, p));
+  }
+  return i;
+}
+
+#endif // EC_REGION_X86
+
+// -----------------------------------------------------------------------------
+// aarch64 kernels
+
+#ifdef EC_REGION_NEON
+
+size_t xor_neon(const char * const *src, unsigned n, char *dst, size_t size)
+{
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t acc = vld1q_u8((const uint8_t *)(src[0] + i));
+    for (unsigned j = 1; j < n; j++)
+      acc = veorq_u8(acc, vld1q_u8((const uint8_t *)(src[j] + i)));
+    vst1q_u8((uint8_t *)(dst + i), acc);
+  }
+  return i;
+}
+
+size_t gf8_mul_xor_neon(const char *src, const uint8_t *lo, const uint8_t *hi,
+			char *dst, size_t size)
+{
+  const uint8x16_t tlo = vld1q_u8(lo);
+  const uint8x16_t thi = vld1q_u8(hi);
+  const uint8x16_t mask = vdupq_n_u8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t s = vld1q_u8((const uint8_t *)(src + i));
+    uint8x16_t p = veorq_u8(vqtbl1q_u8(tlo, vandq_u8(s, mask)),
+			    vqtbl1q_u8(thi, vshrq_n_u8(s, 4)));
+    uint8x16_t d = vld1q_u8((const uint8_t *)(dst + i));
+    vst1q_u8((uint8_t *)(dst + i), veorq_u8(d, p));
+  }
+  return i;
+}
+
+#endif // EC_REGION_NEON
+
+// -----------------------------------------------------------------------------
+// dispatch
+
+bool cpu_supports(impl_t impl)
+{
+  switch (impl) {
+  case IMPL_GENERIC:
+    return true;
+#ifdef EC_REGION_X86
+  case IMPL_SSE:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+  case IMPL_AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  case IMPL_AVX512:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512bw");
+#endif
+#ifdef EC_REGION_NEON
+  case IMPL_NEON:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+impl_t detect()
+{
+  const impl_t order[] = { IMPL_AVX512, IMPL_AVX2, IMPL_SSE, IMPL_NEON };
+  for (auto i : order) {
+    if (cpu_supports(i))
+      return i;
+  }
+  return IMPL_GENERIC;
+}
+
+std::atomic<int> cur_impl = { -1 };
+
+} // anonymous namespace
+
+impl_t get_impl()
+{
+  int impl = cur_impl.load(std::memory_order_relaxed);
+  if (impl < 0) {
+    impl = detect();
+    cur_impl.store(impl, std::memory_order_relaxed);
+  }
+  return (impl_t)impl;
+}
+
+const char *get_impl_name(impl_t impl)
+{
+  switch (impl) {
+  case IMPL_GENERIC: return "generic";
+  case IMPL_SSE: return "sse";
+  case IMPL_AVX2: return "avx2";
+  case IMPL_AVX512: return "avx512";
+  case IMPL_NEON: return "neon";
+  default: return "unknown";
+  }
+}
+
+bool impl_supported(impl_t impl)
+{
+  return cpu_supports(impl);
+}
+
+bool set_impl(impl_t impl)
+{
+  if (!cpu_supports(impl))
+    return false;
+  cur_impl.store(impl, std::memory_order_relaxed);
+  return true;
+}
+
+uint8_t gf8_mul(uint8_t a, uint8_t b)
+{
+  if (a == 0 || b == 0)
+    return 0;
+  const gf8_tables_t &t = gf8_tables();
+  return t.exp[t.log[a] + t.log[b]];
+}
+
+void xor_regions(const char * const *src, unsigned n, char *dst, size_t size)
+{
+  if (n == 0 || size == 0)
+    return;
+  if (n == 1) {
+    if (src[0] != dst)
+      memmove(dst, src[0], size);
+    return;
+  }
+  size_t done = 0;
+  switch (get_impl()) {
+#ifdef EC_REGION_X86
+  case IMPL_AVX512:
+    done = xor_avx512(src, n, dst, size);
+    break;
+  case IMPL_AVX2:
+    done = xor_avx2(src, n, dst, size);
+    break;
+  case IMPL_SSE:
+    done = xor_sse2(src, n, dst, size);
+    break;
+#endif
+#ifdef EC_REGION_NEON
+  case IMPL_NEON:
+    done = xor_neon(src, n, dst, size);
+    break;
+#endif
+  default:
+    break;
+  }
+  xor_generic(src, n, dst, done, size);
+}
+
+void gf8_mul_xor(const char *src, uint8_t c, char *dst, size_t size)
+{
+  if (c == 0 || size == 0)
+    return;
+  if (c == 1) {
+    const char *s[2] = { dst, src };
+    xor_regions(s, 2, dst, size);
+    return;
+  }
+  uint8_t lo[16], hi[16];
+  gf8_split_tables(c, lo, hi);
+  size_t done = 0;
+  switch (get_impl()) {
+#ifdef EC_REGION_X86
+  case IMPL_AVX512:
+    done = gf8_mul_xor_avx512(src, lo, hi, dst, size);
+    break;
+  case IMPL_AVX2:
+    done = gf8_mul_xor_avx2(src, lo, hi, dst, size);
+    break;
+  case IMPL_SSE:
+    done = gf8_mul_xor_ssse3(src, lo, hi, dst, size);
+    break;
+#endif
+#ifdef EC_REGION_NEON
+  case IMPL_NEON:
+    done = gf8_mul_xor_neon(src, lo, hi, dst, size);
+    break;
+#endif
+  default:
+    break;
+  }
+  gf8_mul_xor_generic(src, lo, hi, dst, done, size);
+}
+
+} // namespace ec_region
+} // namespace ceph
@@ -0,0 +1,67 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_REGION_H
+#define CEPH_ERASURE_CODE_REGION_H
+
+/*! @file ErasureCodeRegion.h
+    @brief Region kernels shared by the erasure code plugins
+
+    XOR of whole regions and region multiply-accumulate in GF(2^8)
+    with the 0x11d polynomial used by both jerasure (w=8) and isa-l.
+    The implementation is picked at first use from what the CPU
+    supports (AVX-512, AVX2, SSSE3/SSE2 on x86_64, NEON on ARM) with a
+    portable fallback. Buffers need not be aligned, although aligned
+    buffers are faster.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ceph {
+  namespace ec_region {
+
+    enum impl_t {
+      IMPL_GENERIC = 0,
+      IMPL_SSE,      ///< SSE2 xor, SSSE3 multiply
+      IMPL_AVX2,
+      IMPL_AVX512,   ///< AVX-512F xor, AVX-512BW multiply
+      IMPL_NEON,
+      IMPL_MAX
+    };
+
+    /// dst = src[0] ^ ... ^ src[n-1], dst may be one of src
+    void xor_regions(const char * const *src, unsigned n,
+		     char *dst, size_t size);
+
+    /// dst ^= c * src in GF(2^8)
+    void gf8_mul_xor(const char *src, uint8_t c, char *dst, size_t size);
+
+    /// a * b in GF(2^8)
+    uint8_t gf8_mul(uint8_t a, uint8_t b);
+
+    /// implementation currently in use
+    impl_t get_impl();
+    const char *get_impl_name(impl_t impl);
+
+    /// true if the CPU can run **impl**
+    bool impl_supported(impl_t impl);
+
+    /**
+     * Force the implementation, for tests and benchmarks. Returns
+     * false and leaves the current one if **impl** is not supported.
+     */
+    bool set_impl(impl_t impl);
+  }
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include "common/debug.h"
 #include "ErasureCodeIsa.h"
 #include "xor_op.h"
+#include "erasure-code/ErasureCodeRegion.h"
 #include "include/assert.h"
 using namespace std;
 
@@ -123,7 +124,7 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
   if (m == 1)
     // single parity stripe
-    region_xor((unsigned char**) data, (unsigned char*) coding[0], k, blocksize);
+    ceph::ec_region::xor_regions(data, k, coding[0], blocksize);
   else
     ec_encode_data(blocksize, k, m, encode_tbls,
                    (unsigned char**) data, (unsigned char**) coding);
@@ -131,6 +132,36 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+int
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferptr> &in,
+                                   map<int, bufferptr> &out)
+{
+  int r = check_delta(in, out);
+  if (r < 0)
+    return r;
+  unsigned blocksize = in.begin()->second.length();
+  for (auto &c : out) {
+    unsigned char *coding = (unsigned char*) c.second.c_str();
+    for (auto &d : in) {
+      unsigned char *delta = (unsigned char*) d.second.c_str();
+      if (m == 1) {
+        // single parity stripe, see isa_encode
+        const char *src[2] = { (char*) coding, (char*) delta };
+        ceph::ec_region::xor_regions(src, 2, (char*) coding, blocksize);
+      } else {
+        // coding ^= coeff(row, d.first) * delta, using the row of the
+        // encoding table laid out by ec_init_tables
+        ec_encode_data_update(blocksize, k, 1, d.first,
+                              &encode_tbls[(c.first - k) * k * 32],
+                              delta, &coding);
+      }
+    }
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -197,7 +228,8 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
     assert(1 == nerrs);
     dout(20) << "isa_decode: reconstruct using region xor [" <<
       erasures[0] << "]" << dendl;
-    region_xor(recover_source, recover_target[0], k, blocksize);
+    ceph::ec_region::xor_regions((char**) recover_source, k,
+                                 (char*) recover_target[0], blocksize);
     return 0;
   }
 
@@ -210,7 +242,8 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
       erasures[0] << "]" << dendl;
     assert(1 == s);
     assert(k == r);
-    region_xor(recover_source, recover_target[0], k, blocksize);
+    ceph::ec_region::xor_regions((char**) recover_source, k,
+                                 (char*) recover_target[0], blocksize);
     return 0;
   }
 
@@ -134,6 +134,14 @@ public:
                           char **coding,
                           int blocksize) override;
 
+  bool supports_parity_delta() const override
+  {
+    return true;
+  }
+
+  int apply_delta(const std::map<int, bufferptr> &in,
+                  std::map<int, bufferptr> &out) override;
+
   virtual bool erasure_contains(int *erasures, int i);
 
   int isa_decode(int *erasures,
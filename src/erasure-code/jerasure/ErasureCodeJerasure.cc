@@ -17,6 +17,7 @@
 
 #include "common/debug.h"
 #include "ErasureCodeJerasure.h"
+#include "erasure-code/ErasureCodeRegion.h"
 
 using namespace std;
 
@@ -131,6 +132,85 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+int ErasureCodeJerasure::matrix_decode(int *matrix, int *erasures,
+				       char **data, char **coding,
+				       int blocksize)
+{
+  if (!decode_cache)
+    return jerasure_matrix_decode(k, m, w, matrix, 1,
+				  erasures, data, coding, blocksize);
+
+  // same steps as jerasure_matrix_decode() with row_k_ones set, except
+  // that the decoding matrix comes from the cache
+  int erased[k + m];
+  memset(erased, 0, sizeof(erased));
+  int erasures_count = 0;
+  for (int i = 0; erasures[i] != -1; i++) {
+    if (!erased[erasures[i]])
+      erasures_count++;
+    erased[erasures[i]] = 1;
+  }
+  if (erasures_count > m)
+    return -1;
+
+  int edd = 0;
+  int lastdrive = k;
+  for (int i = 0; i < k; i++) {
+    if (erased[i]) {
+      edd++;
+      lastdrive = i;
+    }
+  }
+  if (erased[k])
+    lastdrive = k;
+
+  ErasureCodeJerasureDecodeCache::EntryRef dm;
+  if (edd > 1 || (edd > 0 && erased[k])) {
+    string signature(technique);
+    signature += "/" + std::to_string(k) + "/" + std::to_string(m) + "/" +
+      std::to_string(w) + "/";
+    for (int i = 0; i < k + m; i++)
+      signature += erased[i] ? '1' : '0';
+    dm = decode_cache->get(signature);
+    if (!dm) {
+      ErasureCodeJerasureDecodeCache::Entry e;
+      e.decoding_matrix.resize(k * k);
+      e.dm_ids.resize(k);
+      if (jerasure_make_decoding_matrix(k, m, w, matrix, erased,
+					&e.decoding_matrix[0],
+					&e.dm_ids[0]) < 0)
+	return -1;
+      dm = decode_cache->put(signature, std::move(e));
+    }
+  }
+
+  // jerasure does not write through the matrix and id arguments
+  int *decoding_matrix = dm ? const_cast<int*>(&dm->decoding_matrix[0]) : NULL;
+  int *dm_ids = dm ? const_cast<int*>(&dm->dm_ids[0]) : NULL;
+  for (int i = 0; edd > 0 && i < lastdrive; i++) {
+    if (erased[i]) {
+      jerasure_matrix_dotprod(k, w, decoding_matrix + i * k, dm_ids, i,
+			      data, coding, blocksize);
+      edd--;
+    }
+  }
+  // a single lost data chunk is the xor of the others and the first
+  // coding chunk
+  if (edd > 0) {
+    int ids[k];
+    for (int i = 0; i < k; i++)
+      ids[i] = i < lastdrive ? i : i + 1;
+    jerasure_matrix_dotprod(k, w, matrix, ids, lastdrive,
+			    data, coding, blocksize);
+  }
+  for (int i = 0; i < m; i++) {
+    if (erased[k + i])
+      jerasure_matrix_dotprod(k, w, matrix + i * k, NULL, k + i,
+			      data, coding, blocksize);
+  }
+  return 0;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
@@ -146,6 +226,45 @@ bool ErasureCodeJerasure::is_prime(int value)
   return false;
 }
 
+int ErasureCodeJerasure::matrix_apply_delta(const int *matrix,
+					    const map<int, bufferptr> &in,
+					    map<int, bufferptr> &out)
+{
+  int r = check_delta(in, out);
+  if (r < 0)
+    return r;
+  unsigned blocksize = in.begin()->second.length();
+  for (auto &c : out) {
+    const int *row = &matrix[(c.first - k) * k];
+    char *coding = c.second.c_str();
+    for (auto &d : in) {
+      char *delta = const_cast<char*>(d.second.c_str());
+      int coef = row[d.first];
+      if (coef == 0)
+	continue;
+      if (coef == 1) {
+	const char *src[2] = { coding, delta };
+	ceph::ec_region::xor_regions(src, 2, coding, blocksize);
+	continue;
+      }
+      switch (w) {
+      case 8:
+	ceph::ec_region::gf8_mul_xor(delta, coef, coding, blocksize);
+	break;
+      case 16:
+	galois_w16_region_multiply(delta, coef, blocksize, coding, 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(delta, coef, blocksize, coding, 1);
+	break;
+      default:
+	return -EOPNOTSUPP;
+      }
+    }
+  }
+  return 0;
+}
+
 // 
 // ErasureCodeJerasureReedSolomonVandermonde
 //
@@ -161,8 +280,7 @@ int ErasureCodeJerasureReedSolomonVandermonde::jerasure_decode(int *erasures,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  return jerasure_matrix_decode(k, m, w, matrix, 1,
-				erasures, data, coding, blocksize);
+  return matrix_decode(matrix, erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureReedSolomonVandermonde::get_alignment() const
@@ -214,7 +332,7 @@ int ErasureCodeJerasureReedSolomonRAID6::jerasure_decode(int *erasures,
 							 char **coding,
 							 int blocksize)
 {
-  return jerasure_matrix_decode(k, m, w, matrix, 1, erasures, data, coding, blocksize);
+  return matrix_decode(matrix, erasures, data, coding, blocksize);
 }
 
 unsigned ErasureCodeJerasureReedSolomonRAID6::get_alignment() const
@@ -19,6 +19,7 @@
 #define CEPH_ERASURE_CODE_JERASURE_H
 
 #include "erasure-code/ErasureCode.h"
+#include "ErasureCodeJerasureDecodeCache.h"
 
 class ErasureCodeJerasure : public ErasureCode {
 public:
@@ -32,6 +33,8 @@ public:
   std::string rule_root;
   std::string rule_failure_domain;
   bool per_chunk_alignment;
+  // owned by the plugin; NULL means every decode inverts its matrix
+  ErasureCodeJerasureDecodeCache *decode_cache;
 
   explicit ErasureCodeJerasure(const char *_technique) :
     k(0),
@@ -41,7 +44,8 @@ public:
     w(0),
     DEFAULT_W("8"),
     technique(_technique),
-    per_chunk_alignment(false)
+    per_chunk_alignment(false),
+    decode_cache(NULL)
   {}
 
   ~ErasureCodeJerasure() override {}
@@ -75,8 +79,14 @@ public:
   virtual unsigned get_alignment() const = 0;
   virtual void prepare() = 0;
   static bool is_prime(int value);
+  int matrix_apply_delta(const int *matrix,
+			 const std::map<int, bufferptr> &in,
+			 std::map<int, bufferptr> &out);
 protected:
   virtual int parse(ErasureCodeProfile &profile, std::ostream *ss);
+  // jerasure_matrix_decode() with row_k_ones, reusing cached decoding matrices
+  int matrix_decode(int *matrix, int *erasures,
+		    char **data, char **coding, int blocksize);
 };
 
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
@@ -103,6 +113,13 @@ public:
                                char **data,
                                char **coding,
                                int blocksize) override;
+  bool supports_parity_delta() const override {
+    return true;
+  }
+  int apply_delta(const std::map<int, bufferptr> &in,
+		  std::map<int, bufferptr> &out) override {
+    return matrix_apply_delta(matrix, in, out);
+  }
   unsigned get_alignment() const override;
   void prepare() override;
 private:
@@ -132,6 +149,13 @@ public:
                                char **data,
                                char **coding,
                                int blocksize) override;
+  bool supports_parity_delta() const override {
+    return true;
+  }
+  int apply_delta(const std::map<int, bufferptr> &in,
+		  std::map<int, bufferptr> &out) override {
+    return matrix_apply_delta(matrix, in, out);
+  }
   unsigned get_alignment() const override;
   void prepare() override;
 private:
@@ -0,0 +1,49 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include "ErasureCodeJerasureDecodeCache.h"
+
+ErasureCodeJerasureDecodeCache::EntryRef
+ErasureCodeJerasureDecodeCache::get(const std::string &signature)
+{
+  Mutex::Locker l(lock);
+  auto p = entries.find(signature);
+  if (p == entries.end())
+    return EntryRef();
+  lru.splice(lru.begin(), lru, p->second.first);
+  return p->second.second;
+}
+
+ErasureCodeJerasureDecodeCache::EntryRef
+ErasureCodeJerasureDecodeCache::put(const std::string &signature, Entry &&e)
+{
+  Mutex::Locker l(lock);
+  auto p = entries.find(signature);
+  if (p != entries.end()) {
+    lru.splice(lru.begin(), lru, p->second.first);
+    return p->second.second;
+  }
+  if (entries.size() >= lru_length) {
+    entries.erase(lru.back());
+    lru.pop_back();
+  }
+  lru.push_front(signature);
+  EntryRef ref = std::make_shared<const Entry>(std::move(e));
+  entries[signature] = std::make_pair(lru.begin(), ref);
+  return ref;
+}
+
+unsigned ErasureCodeJerasureDecodeCache::size()
+{
+  Mutex::Locker l(lock);
+  return entries.size();
+}
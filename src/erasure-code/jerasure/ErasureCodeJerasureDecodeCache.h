@@ -0,0 +1,63 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_JERASURE_DECODE_CACHE_H
+#define CEPH_ERASURE_CODE_JERASURE_DECODE_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/Mutex.h"
+
+/**
+ * LRU cache of inverted decoding matrices, shared by every matrix
+ * technique instance created by the jerasure plugin.
+ *
+ * jerasure_matrix_decode() inverts a k*k matrix on every call.  The
+ * result only depends on the technique, (k, m, w) and which chunks are
+ * erased, so it is computed once per erasure signature and kept here.
+ * Entries are handed out as shared pointers so an eviction never pulls
+ * a matrix from under a decode that is still using it.
+ */
+class ErasureCodeJerasureDecodeCache {
+public:
+  // enough for every erasure pattern up to (12,4), like the isa cache
+  static const unsigned lru_length = 2516;
+
+  struct Entry {
+    std::vector<int> decoding_matrix; ///< k*k
+    std::vector<int> dm_ids;          ///< the k surviving chunks it reads
+  };
+  typedef std::shared_ptr<const Entry> EntryRef;
+
+  ErasureCodeJerasureDecodeCache() : lock("jerasure-decode-cache") {}
+
+  EntryRef get(const std::string &signature);
+  /// insert e unless another thread beat us to it; return the cached entry
+  EntryRef put(const std::string &signature, Entry &&e);
+
+  unsigned size();
+
+private:
+  typedef std::list<std::string> lru_list_t;
+  typedef std::map<std::string,
+		   std::pair<lru_list_t::iterator, EntryRef> > lru_map_t;
+
+  Mutex lock;
+  lru_list_t lru;   ///< most recently used first
+  lru_map_t entries;
+};
+
+#endif
@@ -61,6 +61,7 @@ int ErasureCodePluginJerasure::factory(const std::string& directory,
 	   << dendl;
       return -ENOENT;
     }
+    interface->decode_cache = &decode_cache;
     dout(20) << __func__ << ": " << profile << dendl;
     int r = interface->init(profile, ss);
     if (r) {
@@ -19,9 +19,12 @@
 #define CEPH_ERASURE_CODE_PLUGIN_JERASURE_H
 
 #include "erasure-code/ErasureCodePlugin.h"
+#include "ErasureCodeJerasureDecodeCache.h"
 
 class ErasureCodePluginJerasure : public ErasureCodePlugin {
 public:
+  ErasureCodeJerasureDecodeCache decode_cache;
+
   int factory(const std::string& directory,
 		      ErasureCodeProfile &profile,
 		      ErasureCodeInterfaceRef *erasure_code,
@@ -231,6 +231,7 @@ DEFINE_CEPH_FEATURE_DEPRECATED(63, 1, RESERVED_BROKEN, LUMINOUS) // client-facin
 	 CEPH_FEATURE_RESEND_ON_SPLIT |		\
 	 CEPH_FEATURE_RADOS_BACKOFF |		\
 	 CEPH_FEATURE_OSD_RECOVERY_DELETES | \
+	 CEPH_FEATURE_SERVER_MIMIC | \
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
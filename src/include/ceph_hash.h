@@ -8,6 +8,14 @@ extern unsigned ceph_str_hash_linux(const char *s, unsigned len);
 extern unsigned ceph_str_hash_rjenkins(const char *s, unsigned len);
 
 extern unsigned ceph_str_hash(int type, const char *s, unsigned len);
+
+/* out[i] = ceph_str_hash(type, strs[i], lens[i]) for i in [0, n) */
+extern void ceph_str_hash_rjenkins_batch(const char * const *strs,
+					 const unsigned *lens, unsigned *out,
+					 unsigned n);
+extern void ceph_str_hash_batch(int type, const char * const *strs,
+				const unsigned *lens, unsigned *out,
+				unsigned n);
 extern const char *ceph_str_hash_name(int type);
 extern bool ceph_str_hash_valid(int type);
 
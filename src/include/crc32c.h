@@ -8,6 +8,9 @@ extern "C" {
 #endif
 
 typedef uint32_t (*ceph_crc32c_func_t)(uint32_t crc, unsigned char const *data, unsigned length);
+typedef void (*ceph_crc32c_multi_func_t)(uint32_t crc, unsigned char const *data,
+					 unsigned length, unsigned count,
+					 uint32_t *out);
 
 /*
  * this is a static global with the chosen crc32c implementation for
@@ -17,6 +20,14 @@ extern ceph_crc32c_func_t ceph_crc32c_func;
 
 extern ceph_crc32c_func_t ceph_choose_crc32(void);
 
+/*
+ * likewise, the chosen implementation for computing the crc32c of
+ * several equal-length buffers at once.
+ */
+extern ceph_crc32c_multi_func_t ceph_crc32c_multi_func;
+
+extern ceph_crc32c_multi_func_t ceph_choose_crc32_multi(void);
+
 /**
  * calculate crc32c for data that is entirely 0 (ZERO)
  *
@@ -50,6 +61,27 @@ static inline uint32_t ceph_crc32c(uint32_t crc, unsigned char const *data, unsi
   return ceph_crc32c_func(crc, data, length);
 }
 
+/**
+ * calculate crc32c for count consecutive buffers of length bytes each
+ *
+ * Each buffer is seeded with the same initial value; out[i] receives
+ * the crc of data + i * length.  This is equivalent to calling
+ * ceph_crc32c() in a loop, but the implementation may interleave the
+ * buffers to make better use of the CPU.
+ *
+ * @param crc initial value for each buffer
+ * @param data pointer to count * length bytes (or NULL for zeros)
+ * @param length length of each buffer
+ * @param count number of buffers
+ * @param out array of count results
+ */
+static inline void ceph_crc32c_multi(uint32_t crc, unsigned char const *data,
+				     unsigned length, unsigned count,
+				     uint32_t *out)
+{
+  ceph_crc32c_multi_func(crc, data, length, count, out);
+}
+
 #ifdef __cplusplus
 }
 #endif
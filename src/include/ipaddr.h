@@ -14,4 +14,10 @@ const struct ifaddrs *find_ip_in_subnet(const struct ifaddrs *addrs,
 
 bool parse_network(const char *s, struct sockaddr_storage *network, unsigned int *prefix_len);
 
+/*
+  Check whether addr is in the subnet net/prefix_len.
+ */
+bool network_contains(const struct sockaddr *net, unsigned int prefix_len,
+		      const struct sockaddr *addr);
+
 #endif
@@ -142,6 +142,7 @@ class LRU {
   uint32_t lru_get_pintail() const { return lru_pintail.get_length(); }
   uint32_t lru_get_max() const { return lru_max; }
   uint32_t lru_get_num_pinned() const { return lru_num_pinned; }
+  bool lru_is_top(const LRUObject *o) const { return o->lru_list == &lru_top; }
 
   void lru_set_max(uint32_t m) { lru_max = m; }
   void lru_set_midpoint(float f) { lru_midpoint = f; }
@@ -169,6 +169,30 @@ enum pool_index_t {
 extern bool debug_mode;
 extern void set_debug_mode(bool d);
 
+// Optional slab backend for small single-item allocations (map, set and
+// list nodes).  Items are rounded up to a size class and recycled through
+// a per-thread free list instead of going back to malloc each time.
+// Every small item is allocated at its size class even when the pool
+// does not use the slab, so a pool may be switched at any time.
+enum {
+  slab_class_bits = 4,                       // 16 byte size classes
+  slab_max_size = 256,
+  slab_num_classes = slab_max_size >> slab_class_bits,
+  slab_cache_max = 256,                      // cached items per class
+};
+
+inline size_t slab_class(size_t size) {
+  return (size - 1) >> slab_class_bits;
+}
+inline size_t slab_class_size(size_t cls) {
+  return (cls + 1) << slab_class_bits;
+}
+
+void *slab_alloc(size_t cls);
+void slab_free(void *p, size_t cls);
+// release this thread's cached items to malloc
+void slab_trim();
+
 // --------------------------------------------------------------
 class pool_t;
 
@@ -226,6 +250,8 @@ class pool_t {
   mutable std::mutex lock;  // only used for types list
   std::unordered_map<const char *, type_t> type_map;
 
+  std::atomic<bool> slab = {false};
+
 public:
   //
   // How much this pool consumes. O(<num_shards>)
@@ -235,11 +261,21 @@ public:
 
   void adjust_count(ssize_t items, ssize_t bytes);
 
+  bool use_slab() const {
+    return slab.load(std::memory_order_relaxed);
+  }
+  void set_use_slab(bool s) {
+    slab.store(s, std::memory_order_relaxed);
+  }
+
   shard_t* pick_a_shard() {
-    // Dirt cheap, see:
-    //   http://fossies.org/dox/glibc-2.24/pthread__self_8c_source.html
-    size_t me = (size_t)pthread_self();
-    size_t i = (me >> 3) & ((1 << num_shard_bits) - 1);
+    // Each thread is handed the next shard the first time it gets here,
+    // so up to num_shards threads never share a shard's cacheline.
+    // Hashing pthread_self() mapped many threads to the same shard, as
+    // thread descriptors are allocated at widely aligned addresses.
+    static std::atomic<size_t> next_shard = {0};
+    static thread_local size_t i =
+      next_shard.fetch_add(1, std::memory_order_relaxed) & (num_shards - 1);
     return &shard[i];
   }
 
@@ -311,6 +347,13 @@ public:
     if (type) {
       type->items += n;
     }
+    if (n == 1 && total <= slab_max_size) {
+      size_t cls = slab_class(total);
+      if (pool->use_slab()) {
+	return reinterpret_cast<T*>(slab_alloc(cls));
+      }
+      return reinterpret_cast<T*>(new char[slab_class_size(cls)]);
+    }
     T* r = reinterpret_cast<T*>(new char[total]);
     return r;
   }
@@ -323,6 +366,10 @@ public:
     if (type) {
       type->items -= n;
     }
+    if (n == 1 && total <= slab_max_size && pool->use_slab()) {
+      slab_free(p, slab_class(total));
+      return;
+    }
     delete[] reinterpret_cast<char*>(p);
   }
 
@@ -120,6 +120,7 @@ struct ceph_msg_connect_reply {
 } __attribute__ ((packed));
 
 #define CEPH_MSG_CONNECT_LOSSY  1  /* messages i send may be safely dropped */
+#define CEPH_MSG_CONNECT_COMPRESS 2 /* i can receive compressed message data */
 
 
 /*
@@ -190,5 +191,12 @@ struct ceph_msg_footer {
 #define CEPH_MSG_FOOTER_NOCRC     (1<<1)   /* no data crc */
 #define CEPH_MSG_FOOTER_SIGNED	  (1<<2)   /* msg was signed */
 
+/*
+ * ceph_msg_header.reserved flags; only set if the peer sent
+ * CEPH_MSG_CONNECT_COMPRESS.  data_len is the compressed length, the
+ * crcs cover the uncompressed payloads.
+ */
+#define CEPH_MSG_HEADER_DATA_COMPRESSED (1<<0)   /* data payload compressed */
+
 
 #endif
@@ -952,6 +952,21 @@ namespace librados
 
     uint64_t get_last_version();
 
+    /**
+     * Asynchronously read from an object
+     *
+     * If *pbl already holds a buffer when the read is submitted, the
+     * messenger receives the data straight into it instead of into a
+     * buffer of its own.  The buffer must stay valid until the
+     * completion fires.
+     *
+     * @param oid the name of the object to read from
+     * @param c what to do when the read is complete
+     * @param pbl where to store the results
+     * @param len the number of bytes to read
+     * @param off the offset to start reading from in the object
+     * @returns 0 on success, negative error code on failure
+     */
     int aio_read(const std::string& oid, AioCompletion *c,
 		 bufferlist *pbl, size_t len, uint64_t off);
     /**
@@ -1106,6 +1121,24 @@ namespace librados
         ObjectWriteOperation *op, snap_t seq,
         std::vector<snap_t>& snaps,
         const blkin_trace_info *trace_info);
+    /**
+     * Schedule async write operations on many objects
+     *
+     * Each operation is sent to its object as with aio_operate(), but
+     * the operations are submitted grouped by target OSD and share a
+     * single completion.  Operations on the same object are submitted
+     * in the order given.  The object version is not reported.
+     *
+     * @param c what to do when all operations are complete and safe
+     * @param ops object names and the operations to perform on them
+     * @param flags flags to apply to every operation
+     * @returns 0 on success, negative error code on failure; the return
+     * value of c is 0 or the first error any of the operations hit
+     */
+    int aio_operate_batch(
+      AioCompletion *c,
+      const std::vector<std::pair<std::string, ObjectWriteOperation*> >& ops,
+      int flags = 0);
     int aio_operate(const std::string& oid, AioCompletion *c,
 		    ObjectReadOperation *op, bufferlist *pbl);
 
@@ -11,4 +11,23 @@
 # define MSG_MORE 0
 #endif
 
+/*
+ * MSG_ZEROCOPY appeared in Linux 4.14; older libc headers may lack the
+ * definitions even when the running kernel supports it.
+ */
+#ifdef __linux__
+# ifndef SO_ZEROCOPY
+#  define SO_ZEROCOPY 60
+# endif
+# ifndef MSG_ZEROCOPY
+#  define MSG_ZEROCOPY 0x4000000
+# endif
+# ifndef SO_EE_ORIGIN_ZEROCOPY
+#  define SO_EE_ORIGIN_ZEROCOPY 5
+# endif
+# ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#  define SO_EE_CODE_ZEROCOPY_COPIED 1
+# endif
+#endif
+
 #endif
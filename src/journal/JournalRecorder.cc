@@ -253,7 +253,8 @@ ObjectRecorderPtr JournalRecorder::create_object_recorder(
     object_number, lock, m_journal_metadata->get_work_queue(),
     m_journal_metadata->get_timer(), m_journal_metadata->get_timer_lock(),
     &m_object_handler, m_journal_metadata->get_order(), m_flush_interval,
-    m_flush_bytes, m_flush_age));
+    m_flush_bytes, m_flush_age,
+    m_journal_metadata->get_settings().max_in_flight_appends));
   return object_recorder;
 }
 
@@ -22,12 +22,14 @@ ObjectRecorder::ObjectRecorder(librados::IoCtx &ioctx, const std::string &oid,
                                ContextWQ *work_queue, SafeTimer &timer,
                                Mutex &timer_lock, Handler *handler,
                                uint8_t order, uint32_t flush_interval,
-                               uint64_t flush_bytes, double flush_age)
+                               uint64_t flush_bytes, double flush_age,
+                               uint64_t max_in_flight_appends)
   : RefCountedObject(NULL, 0), m_oid(oid), m_object_number(object_number),
     m_cct(NULL), m_op_work_queue(work_queue), m_timer(timer),
     m_timer_lock(timer_lock), m_handler(handler), m_order(order),
     m_soft_max_size(1 << m_order), m_flush_interval(flush_interval),
-    m_flush_bytes(flush_bytes), m_flush_age(flush_age), m_flush_handler(this),
+    m_flush_bytes(flush_bytes), m_flush_age(flush_age),
+    m_max_in_flight_appends(max_in_flight_appends), m_flush_handler(this),
     m_append_task(NULL), m_lock(lock), m_append_tid(0), m_pending_bytes(0),
     m_size(0), m_overflowed(false), m_object_closed(false),
     m_in_flight_flushes(false), m_aio_scheduled(false) {
@@ -275,6 +277,12 @@ void ObjectRecorder::handle_append_flushed(uint64_t tid, int r) {
 
     m_in_flight_appends.erase(iter);
     m_in_flight_flushes = true;
+
+    // send any appends that were held back by the in-flight limit as a
+    // single op
+    if (!m_pending_buffers.empty() && !m_aio_scheduled) {
+      schedule_send_appends();
+    }
     m_lock->Unlock();
   }
 
@@ -318,6 +326,12 @@ void ObjectRecorder::append_overflowed() {
                                   it->second.begin(), it->second.end());
   }
 
+  // appends held back by the in-flight limit were never sent
+  restart_append_buffers.splice(restart_append_buffers.end(),
+                                m_pending_buffers,
+                                m_pending_buffers.begin(),
+                                m_pending_buffers.end());
+
   restart_append_buffers.splice(restart_append_buffers.end(),
                                 m_append_buffers,
                                 m_append_buffers.begin(),
@@ -346,14 +360,27 @@ void ObjectRecorder::send_appends(AppendBuffers *append_buffers) {
 
   m_pending_buffers.splice(m_pending_buffers.end(), *append_buffers,
                            append_buffers->begin(), append_buffers->end());
-  if (!m_aio_scheduled) {
-    m_op_work_queue->queue(new FunctionContext([this] (int r) {
-        send_appends_aio();
-    }));
-    m_aio_scheduled = true;
+  if (!m_aio_scheduled && can_send_appends()) {
+    schedule_send_appends();
   }
 }
 
+bool ObjectRecorder::can_send_appends() const {
+  assert(m_lock->is_locked());
+  return (m_max_in_flight_appends == 0 ||
+          m_in_flight_tids.size() < m_max_in_flight_appends);
+}
+
+void ObjectRecorder::schedule_send_appends() {
+  assert(m_lock->is_locked());
+  assert(!m_aio_scheduled);
+
+  m_op_work_queue->queue(new FunctionContext([this] (int r) {
+      send_appends_aio();
+    }));
+  m_aio_scheduled = true;
+}
+
 void ObjectRecorder::send_appends_aio() {
   AppendBuffers *append_buffers;
   uint64_t append_tid;
@@ -399,12 +426,19 @@ void ObjectRecorder::send_appends_aio() {
       } else {
         m_lock->Unlock();
       }
-    } else {
+    } else if (can_send_appends()) {
       // additional pending items -- reschedule
       m_op_work_queue->queue(new FunctionContext([this] (int r) {
           send_appends_aio();
         }));
       m_lock->Unlock();
+    } else {
+      // in-flight limit reached -- pending items are coalesced and sent
+      // once an in-flight append completes
+      ldout(m_cct, 20) << __func__ << ": " << m_oid << " deferring "
+                       << m_pending_buffers.size() << " appends" << dendl;
+      m_aio_scheduled = false;
+      m_lock->Unlock();
     }
   }
 
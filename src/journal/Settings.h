@@ -13,6 +13,8 @@ struct Settings {
   uint64_t max_fetch_bytes = 0;       ///< 0 implies no limit
   uint64_t max_payload_bytes = 0;     ///< 0 implies object size limit
   int max_concurrent_object_sets = 0; ///< 0 implies no limit
+  uint64_t max_in_flight_appends = 0; ///< max in-flight appends per object,
+                                      ///< 0 implies no limit
   std::set<std::string> whitelisted_laggy_clients;
                                       ///< clients that mustn't be disconnected
 };
@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "KeyValueDB.h"
+#include "include/str_list.h"
 #ifdef WITH_LEVELDB
 #include "LevelDBStore.h"
 #endif
@@ -64,3 +65,18 @@ int KeyValueDB::test_init(const string& type, const string& dir)
   }
   return -EINVAL;
 }
+
+int KeyValueDB::parse_column_families(const string &s,
+				      vector<ColumnFamily> *cfs)
+{
+  list<string> items;
+  get_str_list(s, " \t", items);
+  for (auto& i : items) {
+    size_t pos = i.find('=');
+    if (pos == 0 || pos == string::npos) {
+      return -EINVAL;
+    }
+    cfs->emplace_back(i.substr(0, pos), i.substr(pos + 1));
+  }
+  return 0;
+}
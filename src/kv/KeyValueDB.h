@@ -8,6 +8,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <vector>
 #include "include/memory.h"
 #include <boost/scoped_ptr.hpp>
 #include "include/encoding.h"
@@ -117,10 +118,11 @@ public:
       const std::string &prefix ///< [in] Prefix by which to remove keys
       ) = 0;
 
+    /// Removes keys of prefix in [start, end)
     virtual void rm_range_keys(
       const string &prefix,    ///< [in] Prefix by which to remove keys
       const string &start,     ///< [in] The start bound of remove keys
-      const string &end        ///< [in] The start bound of remove keys
+      const string &end        ///< [in] The end bound (exclusive) of remove keys
       ) = 0;
 
     /// Merge value into key
@@ -141,9 +143,26 @@ public:
 
   /// test whether we can successfully initialize; may have side effects (e.g., create)
   static int test_init(const std::string& type, const std::string& dir);
+
+  /// a prefix kept in its own column family, with its own options
+  struct ColumnFamily {
+    std::string name;    ///< the prefix stored in this column family
+    std::string option;  ///< backend option string for it
+    ColumnFamily(const std::string &name, const std::string &option)
+      : name(name), option(option) {}
+  };
+  /// parse "name=options name2=options2 ..." into column families
+  static int parse_column_families(const std::string &s,
+				   std::vector<ColumnFamily> *cfs);
+
   virtual int init(string option_str="") = 0;
-  virtual int open(std::ostream &out) = 0;
-  virtual int create_and_open(std::ostream &out) = 0;
+  /// open an existing db; cfs supplies options for the column families
+  /// it was created with
+  virtual int open(std::ostream &out,
+		   const std::vector<ColumnFamily>& cfs = {}) = 0;
+  /// create the db if missing, giving each of cfs its own column family
+  virtual int create_and_open(std::ostream &out,
+			      const std::vector<ColumnFamily>& cfs = {}) = 0;
   virtual void close() { }
 
   virtual Transaction get_transaction() = 0;
@@ -227,17 +246,36 @@ public:
   typedef ceph::shared_ptr< WholeSpaceIteratorImpl > WholeSpaceIterator;
 
   class IteratorImpl : public GenericIteratorImpl {
+  public:
+    ~IteratorImpl() override { }
+    virtual int seek_to_last() = 0;
+    virtual int prev(bool validate=true) = 0;
+    virtual std::pair<std::string, std::string> raw_key() = 0;
+    virtual bufferptr value_as_ptr() {
+      bufferlist bl = value();
+      if (bl.length()) {
+        return *bl.buffers().begin();
+      } else {
+        return bufferptr();
+      }
+    }
+  };
+
+  typedef ceph::shared_ptr< IteratorImpl > Iterator;
+
+  /// iterates over one prefix of a WholeSpaceIterator
+  class PrefixIteratorImpl : public IteratorImpl {
     const std::string prefix;
     WholeSpaceIterator generic_iter;
   public:
-    IteratorImpl(const std::string &prefix, WholeSpaceIterator iter) :
+    PrefixIteratorImpl(const std::string &prefix, WholeSpaceIterator iter) :
       prefix(prefix), generic_iter(iter) { }
-    ~IteratorImpl() override { }
+    ~PrefixIteratorImpl() override { }
 
     int seek_to_first() override {
       return generic_iter->seek_to_first(prefix);
     }
-    int seek_to_last() {
+    int seek_to_last() override {
       return generic_iter->seek_to_last(prefix);
     }
     int upper_bound(const std::string &after) override {
@@ -263,7 +301,7 @@ public:
       }      
     }
     
-    int prev(bool validate=true) {
+    int prev(bool validate=true) override {
       if (validate) {
         if (valid())
           return generic_iter->prev();
@@ -275,13 +313,13 @@ public:
     std::string key() override {
       return generic_iter->key();
     }
-    std::pair<std::string, std::string> raw_key() {
+    std::pair<std::string, std::string> raw_key() override {
       return generic_iter->raw_key();
     }
     bufferlist value() override {
       return generic_iter->value();
     }
-    bufferptr value_as_ptr() {
+    bufferptr value_as_ptr() override {
       return generic_iter->value_as_ptr();
     }
     int status() override {
@@ -289,14 +327,25 @@ public:
     }
   };
 
-  typedef ceph::shared_ptr< IteratorImpl > Iterator;
-
+  /// iterate the whole db; with column families, only the prefixes
+  /// that share the default one
   WholeSpaceIterator get_iterator() {
     return _get_iterator();
   }
 
-  Iterator get_iterator(const std::string &prefix) {
-    return std::make_shared<IteratorImpl>(prefix, get_iterator());
+  virtual Iterator get_iterator(const std::string &prefix) {
+    return std::make_shared<PrefixIteratorImpl>(prefix, get_iterator());
+  }
+
+  /// iterate the keys of prefix in [lower, upper); an empty upper means
+  /// the end of the prefix.  Backends may use the bounds to stop at upper
+  /// without stepping over tombstones past it and to consult prefix
+  /// filters, so seeks must stay inside the range.  Callers should still
+  /// check keys against their own bounds.
+  virtual Iterator get_bounded_iterator(const std::string &prefix,
+					const std::string &lower,
+					const std::string &upper) {
+    return get_iterator(prefix);
   }
 
   virtual uint64_t get_estimated_size(std::map<std::string,uint64_t> &extra) = 0;
@@ -304,10 +353,28 @@ public:
     return -EOPNOTSUPP;
   }
 
+  /// set the cache size; an open db may resize its cache right away
   virtual int set_cache_size(uint64_t) {
     return -EOPNOTSUPP;
   }
 
+  struct CacheStats {
+    uint64_t capacity = 0;
+    uint64_t usage = 0;
+    uint64_t hits = 0;        ///< lookups since open, if counted
+    uint64_t misses = 0;
+    uint64_t item_bytes = 0;  ///< approx bytes read per miss
+  };
+  virtual int get_cache_stats(CacheStats *stats) {
+    return -EOPNOTSUPP;
+  }
+
+  /// sequence number of the last committed write; any commit, from any
+  /// user of the db, moves it forward
+  virtual int get_last_seq(uint64_t *seq) {
+    return -EOPNOTSUPP;
+  }
+
   virtual ~KeyValueDB() {}
 
   /// compact the underlying store
@@ -52,11 +52,11 @@ public:
   int init();
 
   /// Opens underlying db
-  int open(ostream &out) {
+  int open(ostream &out, const vector<ColumnFamily>& = {}) {
     return do_open(out, false);
   }
   /// Creates underlying db if missing and opens it
-  int create_and_open(ostream &out) {
+  int create_and_open(ostream &out, const vector<ColumnFamily>& = {}) {
     return do_open(out, true);
   }
 
@@ -173,12 +173,14 @@ public:
   static int _test_init(const string& dir);
   int init(string option_str="") override;
 
-  /// Opens underlying db
-  int open(ostream &out) override {
+  /// Opens underlying db; there are no column families, so every
+  /// prefix shares the one keyspace
+  int open(ostream &out, const vector<ColumnFamily>& = {}) override {
     return do_open(out, false);
   }
   /// Creates underlying db if missing and opens it
-  int create_and_open(ostream &out) override {
+  int create_and_open(ostream &out,
+		      const vector<ColumnFamily>& = {}) override {
     return do_open(out, true);
   }
 
@@ -122,8 +122,13 @@ public:
   int _init(bool format);
 
   int do_open(ostream &out, bool create);
-  int open(ostream &out) override { return do_open(out, false); }
-  int create_and_open(ostream &out) override { return do_open(out, true); }
+  int open(ostream &out, const vector<ColumnFamily>& = {}) override {
+    return do_open(out, false);
+  }
+  int create_and_open(ostream &out,
+		      const vector<ColumnFamily>& = {}) override {
+    return do_open(out, true);
+  }
 
   KeyValueDB::Transaction get_transaction() override {
     return std::shared_ptr<MDBTransactionImpl>(new MDBTransactionImpl(this));
@@ -18,6 +18,7 @@
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/utilities/convenience.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/slice_transform.h"
 using std::string;
 #include "common/perf_counters.h"
 #include "common/debug.h"
@@ -96,6 +97,69 @@ class RocksDBStore::MergeOperatorRouter : public rocksdb::AssociativeMergeOperat
 
 };
 
+//
+// Merge operator for a prefix in its own column family, whose keys
+// carry no prefix for the router above to match
+//
+class MergeOperatorLinker : public rocksdb::AssociativeMergeOperator {
+  std::shared_ptr<KeyValueDB::MergeOperator> mop;
+  string name;
+  public:
+  explicit MergeOperatorLinker(
+    const std::shared_ptr<KeyValueDB::MergeOperator> &o)
+    : mop(o), name(o->name()) {}
+
+  const char *Name() const override {
+    return name.c_str();
+  }
+
+  bool Merge(const rocksdb::Slice& key,
+	     const rocksdb::Slice* existing_value,
+	     const rocksdb::Slice& value,
+	     std::string* new_value,
+	     rocksdb::Logger* logger) const override {
+    if (existing_value) {
+      mop->merge(existing_value->data(), existing_value->size(),
+		 value.data(), value.size(),
+		 new_value);
+    } else {
+      mop->merge_nonexistent(value.data(), value.size(), new_value);
+    }
+    return true;
+  }
+};
+
+//
+// Prefix extractor keeping the kv prefix, its separator and the first
+// key_bytes bytes of the key (e.g. the object id of a bluestore omap
+// key), so that one object's keys share a prefix bloom entry
+//
+class PrefixExtractor : public rocksdb::SliceTransform {
+  size_t key_bytes;
+  string name;
+public:
+  explicit PrefixExtractor(size_t kb)
+    : key_bytes(kb), name("ceph.PrefixExtractor." + stringify(kb)) {}
+
+  const char *Name() const override {
+    return name.c_str();
+  }
+  rocksdb::Slice Transform(const rocksdb::Slice& key) const override {
+    const char *sep = static_cast<const char*>(
+      memchr(key.data(), 0, key.size()));
+    assert(sep);
+    return rocksdb::Slice(key.data(), sep - key.data() + 1 + key_bytes);
+  }
+  bool InDomain(const rocksdb::Slice& key) const override {
+    const char *sep = static_cast<const char*>(
+      memchr(key.data(), 0, key.size()));
+    return sep && (size_t)(sep - key.data()) + 1 + key_bytes <= key.size();
+  }
+  bool InRange(const rocksdb::Slice& dst) const override {
+    return false;
+  }
+};
+
 int RocksDBStore::set_merge_operator(
   const string& prefix,
   std::shared_ptr<KeyValueDB::MergeOperator> mop)
@@ -227,7 +291,8 @@ int RocksDBStore::init(string _options_str)
   return 0;
 }
 
-int RocksDBStore::create_and_open(ostream &out)
+int RocksDBStore::create_and_open(ostream &out,
+				  const vector<ColumnFamily>& cfs)
 {
   if (env) {
     unique_ptr<rocksdb::Directory> dir;
@@ -242,10 +307,38 @@ int RocksDBStore::create_and_open(ostream &out)
       return r;
     }
   }
-  return do_open(out, true);
+  return do_open(out, true, cfs);
+}
+
+int RocksDBStore::get_cf_options(const string& name, const string& option,
+				 const rocksdb::Options& base,
+				 rocksdb::ColumnFamilyOptions *cf_opt)
+{
+  *cf_opt = rocksdb::ColumnFamilyOptions(base);
+  // keys of a column family carry no prefix to extract
+  if (prefix_extractor && cf_opt->prefix_extractor == prefix_extractor)
+    cf_opt->prefix_extractor.reset();
+  if (option.length()) {
+    rocksdb::Status status =
+      rocksdb::GetColumnFamilyOptionsFromString(*cf_opt, option, cf_opt);
+    if (!status.ok()) {
+      derr << __func__ << " column family " << name << " options '"
+	   << option << "': " << status.ToString() << dendl;
+      return -EINVAL;
+    }
+  }
+  cf_opt->merge_operator.reset();
+  for (auto& p : merge_ops) {
+    if (p.first == name) {
+      cf_opt->merge_operator.reset(new MergeOperatorLinker(p.second));
+      break;
+    }
+  }
+  return 0;
 }
 
-int RocksDBStore::do_open(ostream &out, bool create_if_missing)
+int RocksDBStore::do_open(ostream &out, bool create_if_missing,
+			  const vector<ColumnFamily>& cfs)
 {
   rocksdb::Options opt;
   rocksdb::Status status;
@@ -352,6 +445,15 @@ int RocksDBStore::do_open(ostream &out, bool create_if_missing)
   bbt_opts.pin_l0_filter_and_index_blocks_in_cache = 
       g_conf->get_val<bool>("rocksdb_pin_l0_filter_and_index_blocks_in_cache");
 
+  int64_t prefix_key_bytes =
+    g_conf->get_val<int64_t>("rocksdb_prefix_extractor_key_bytes");
+  if (prefix_key_bytes >= 0) {
+    dout(10) << __func__ << " prefix extractor with " << prefix_key_bytes
+	     << " key bytes" << dendl;
+    prefix_extractor.reset(new PrefixExtractor(prefix_key_bytes));
+    opt.prefix_extractor = prefix_extractor;
+  }
+
   opt.table_factory.reset(rocksdb::NewBlockBasedTableFactory(bbt_opts));
   dout(10) << __func__ << " block size " << g_conf->rocksdb_block_size
            << ", block_cache size " << prettybyte_t(block_cache_size)
@@ -362,10 +464,79 @@ int RocksDBStore::do_open(ostream &out, bool create_if_missing)
 	   << dendl;
 
   opt.merge_operator.reset(new MergeOperatorRouter(*this));
-  status = rocksdb::DB::Open(opt, path, &db);
-  if (!status.ok()) {
-    derr << status.ToString() << dendl;
-    return -EINVAL;
+
+  // an existing db must be opened with every column family it has
+  std::vector<string> existing_cfs;
+  status = rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(opt), path,
+					   &existing_cfs);
+  if (!status.ok() || existing_cfs.size() <= 1) {
+    bool new_db = !status.ok();
+    status = rocksdb::DB::Open(opt, path, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+    // only a fresh db may move prefixes out of the default column
+    // family; doing it later would hide the keys already written
+    if (!cfs.empty() && !(new_db && create_if_missing)) {
+      dout(1) << __func__ << " not creating column families in an existing"
+	      << " db; all prefixes stay in the default one" << dendl;
+    } else {
+      for (auto& cf : cfs) {
+	rocksdb::ColumnFamilyOptions cf_opt;
+	int r = get_cf_options(cf.name, cf.option, opt, &cf_opt);
+	if (r < 0) {
+	  return r;
+	}
+	rocksdb::ColumnFamilyHandle *cf_handle;
+	status = db->CreateColumnFamily(cf_opt, cf.name, &cf_handle);
+	if (!status.ok()) {
+	  derr << __func__ << " create column family " << cf.name << ": "
+	       << status.ToString() << dendl;
+	  return -EINVAL;
+	}
+	dout(1) << __func__ << " created column family " << cf.name
+		<< " (" << cf.option << ")" << dendl;
+	cf_handles[cf.name] = cf_handle;
+      }
+    }
+  } else {
+    std::vector<rocksdb::ColumnFamilyDescriptor> descs;
+    for (auto& name : existing_cfs) {
+      if (name == rocksdb::kDefaultColumnFamilyName) {
+	descs.emplace_back(name, rocksdb::ColumnFamilyOptions(opt));
+	continue;
+      }
+      string option;
+      for (auto& cf : cfs) {
+	if (cf.name == name) {
+	  option = cf.option;
+	  break;
+	}
+      }
+      rocksdb::ColumnFamilyOptions cf_opt;
+      int r = get_cf_options(name, option, opt, &cf_opt);
+      if (r < 0) {
+	return r;
+      }
+      descs.emplace_back(name, cf_opt);
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    status = rocksdb::DB::Open(rocksdb::DBOptions(opt), path, descs,
+			       &handles, &db);
+    if (!status.ok()) {
+      derr << status.ToString() << dendl;
+      return -EINVAL;
+    }
+    for (unsigned i = 0; i < descs.size(); ++i) {
+      if (descs[i].name == rocksdb::kDefaultColumnFamilyName) {
+	// the db keeps its own default handle
+	delete handles[i];
+      } else {
+	dout(1) << __func__ << " column family " << descs[i].name << dendl;
+	cf_handles[descs[i].name] = handles[i];
+      }
+    }
   }
   
   PerfCountersBuilder plb(g_ceph_context, "rocksdb", l_rocksdb_first, l_rocksdb_last);
@@ -411,6 +582,11 @@ RocksDBStore::~RocksDBStore()
   close();
   delete logger;
 
+  for (auto& p : cf_handles) {
+    delete p.second;
+  }
+  cf_handles.clear();
+
   // Ensure db is destroyed before dependent db_cache and filterpolicy
   delete db;
   db = nullptr;
@@ -437,6 +613,41 @@ void RocksDBStore::close()
     cct->get_perfcounters_collection()->remove(logger);
 }
 
+int RocksDBStore::set_cache_size(uint64_t s)
+{
+  cache_size = s;
+  set_cache_flag = true;
+  if (db && bbt_opts.block_cache) {
+    // the row cache keeps the size it was opened with
+    uint64_t row_cache_size = cache_size * g_conf->rocksdb_cache_row_ratio;
+    uint64_t block_cache_size = cache_size - row_cache_size;
+    dout(10) << __func__ << " block_cache size "
+	     << prettybyte_t(block_cache_size) << dendl;
+    bbt_opts.block_cache->SetCapacity(block_cache_size);
+  }
+  return 0;
+}
+
+int RocksDBStore::get_cache_stats(CacheStats *stats)
+{
+  if (!bbt_opts.block_cache)
+    return -ENOENT;
+  stats->capacity = bbt_opts.block_cache->GetCapacity();
+  stats->usage = bbt_opts.block_cache->GetUsage();
+  if (dbstats) {
+    stats->hits = dbstats->getTickerCount(rocksdb::BLOCK_CACHE_HIT);
+    stats->misses = dbstats->getTickerCount(rocksdb::BLOCK_CACHE_MISS);
+  }
+  stats->item_bytes = bbt_opts.block_size;
+  return 0;
+}
+
+int RocksDBStore::get_last_seq(uint64_t *seq)
+{
+  *seq = db->GetLatestSequenceNumber();
+  return 0;
+}
+
 void RocksDBStore::split_stats(const std::string &s, char delim, std::vector<std::string> &elems) {
     std::stringstream ss;
     ss.str(s);
@@ -580,20 +791,23 @@ RocksDBStore::RocksDBTransactionImpl::RocksDBTransactionImpl(RocksDBStore *_db)
   db = _db;
 }
 
+// a null cf is the default column family
 static void put_bat(
   rocksdb::WriteBatch& bat, 
+  rocksdb::ColumnFamilyHandle *cf,
   const string &key, 
   const bufferlist &to_set_bl)
 {
   // bufferlist::c_str() is non-constant, so we can't call c_str()
   if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
-    bat.Put(rocksdb::Slice(key),
-	     rocksdb::Slice(to_set_bl.buffers().front().c_str(),
-			    to_set_bl.length()));
+    bat.Put(cf,
+	    rocksdb::Slice(key),
+	    rocksdb::Slice(to_set_bl.buffers().front().c_str(),
+			   to_set_bl.length()));
   } else {
     rocksdb::Slice key_slice(key);
     vector<rocksdb::Slice> value_slices(to_set_bl.buffers().size());
-    bat.Put(nullptr, rocksdb::SliceParts(&key_slice, 1),
+    bat.Put(cf, rocksdb::SliceParts(&key_slice, 1),
             prepare_sliceparts(to_set_bl, &value_slices));
   }
 }
@@ -603,9 +817,13 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  string key = combine_strings(prefix, k);
-
-  put_bat(bat, key, to_set_bl);
+  auto cf = db->get_cf_handle(prefix);
+  if (cf) {
+    put_bat(bat, cf, k, to_set_bl);
+  } else {
+    string key = combine_strings(prefix, k);
+    put_bat(bat, nullptr, key, to_set_bl);
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::set(
@@ -613,36 +831,66 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const char *k, size_t keylen,
   const bufferlist &to_set_bl)
 {
-  string key;
-  combine_strings(prefix, k, keylen, &key);
-
-  put_bat(bat, key, to_set_bl);
+  auto cf = db->get_cf_handle(prefix);
+  if (cf) {
+    string key(k, keylen);
+    put_bat(bat, cf, key, to_set_bl);
+  } else {
+    string key;
+    combine_strings(prefix, k, keylen, &key);
+    put_bat(bat, nullptr, key, to_set_bl);
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
-  bat.Delete(combine_strings(prefix, k));
+  auto cf = db->get_cf_handle(prefix);
+  if (cf) {
+    bat.Delete(cf, rocksdb::Slice(k));
+  } else {
+    bat.Delete(combine_strings(prefix, k));
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const char *k,
 						 size_t keylen)
 {
-  string key;
-  combine_strings(prefix, k, keylen, &key);
-  bat.Delete(key);
+  auto cf = db->get_cf_handle(prefix);
+  if (cf) {
+    bat.Delete(cf, rocksdb::Slice(k, keylen));
+  } else {
+    string key;
+    combine_strings(prefix, k, keylen, &key);
+    bat.Delete(key);
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 					                 const string &k)
 {
-  bat.SingleDelete(combine_strings(prefix, k));
+  auto cf = db->get_cf_handle(prefix);
+  if (cf) {
+    bat.SingleDelete(cf, rocksdb::Slice(k));
+  } else {
+    bat.SingleDelete(combine_strings(prefix, k));
+  }
 }
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
-  if (db->enable_rmrange) {
+  auto cf = db->get_cf_handle(prefix);
+  if (cf) {
+    // there is no key past the end of a column family to bound a
+    // DeleteRange with, so delete what is there
+    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    for (it->seek_to_first();
+	 it->valid();
+	 it->next()) {
+      bat.Delete(cf, rocksdb::Slice(it->key()));
+    }
+  } else if (db->enable_rmrange) {
     string endprefix = prefix;
     endprefix.push_back('\x01');
     bat.DeleteRange(combine_strings(prefix, string()),
@@ -661,8 +909,14 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
                                                          const string &start,
                                                          const string &end)
 {
+  auto cf = db->get_cf_handle(prefix);
   if (db->enable_rmrange) {
-    bat.DeleteRange(combine_strings(prefix, start), combine_strings(prefix, end));
+    if (cf) {
+      bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+    } else {
+      bat.DeleteRange(combine_strings(prefix, start),
+		      combine_strings(prefix, end));
+    }
   } else {
     auto it = db->get_iterator(prefix);
     it->lower_bound(start);
@@ -670,7 +924,11 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
       if (it->key() >= end) {
         break;
       }
-      bat.Delete(combine_strings(prefix, it->key()));
+      if (cf) {
+	bat.Delete(cf, rocksdb::Slice(it->key()));
+      } else {
+	bat.Delete(combine_strings(prefix, it->key()));
+      }
       it->next();
     }
   }
@@ -681,18 +939,20 @@ void RocksDBStore::RocksDBTransactionImpl::merge(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  string key = combine_strings(prefix, k);
+  auto cf = db->get_cf_handle(prefix);
+  string key = cf ? k : combine_strings(prefix, k);
 
   // bufferlist::c_str() is non-constant, so we can't call c_str()
   if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
-    bat.Merge(rocksdb::Slice(key),
-	       rocksdb::Slice(to_set_bl.buffers().front().c_str(),
-			    to_set_bl.length()));
+    bat.Merge(cf,
+	      rocksdb::Slice(key),
+	      rocksdb::Slice(to_set_bl.buffers().front().c_str(),
+			     to_set_bl.length()));
   } else {
     // make a copy
     rocksdb::Slice key_slice(key);
     vector<rocksdb::Slice> value_slices(to_set_bl.buffers().size());
-    bat.Merge(nullptr, rocksdb::SliceParts(&key_slice, 1),
+    bat.Merge(cf, rocksdb::SliceParts(&key_slice, 1),
               prepare_sliceparts(to_set_bl, &value_slices));
   }
 }
@@ -704,11 +964,17 @@ int RocksDBStore::get(
     std::map<string, bufferlist> *out)
 {
   utime_t start = ceph_clock_now();
+  auto cf = get_cf_handle(prefix);
   for (std::set<string>::const_iterator i = keys.begin();
        i != keys.end(); ++i) {
     std::string value;
-    std::string bound = combine_strings(prefix, *i);
-    auto status = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(bound), &value);
+    rocksdb::Status status;
+    if (cf) {
+      status = db->Get(rocksdb::ReadOptions(), cf, rocksdb::Slice(*i), &value);
+    } else {
+      std::string bound = combine_strings(prefix, *i);
+      status = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(bound), &value);
+    }
     if (status.ok()) {
       (*out)[*i].append(value);
     } else if (status.IsIOError()) {
@@ -732,8 +998,13 @@ int RocksDBStore::get(
   int r = 0;
   string value, k;
   rocksdb::Status s;
-  k = combine_strings(prefix, key);
-  s = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(k), &value);
+  auto cf = get_cf_handle(prefix);
+  if (cf) {
+    s = db->Get(rocksdb::ReadOptions(), cf, rocksdb::Slice(key), &value);
+  } else {
+    k = combine_strings(prefix, key);
+    s = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(k), &value);
+  }
   if (s.ok()) {
     out->append(value);
   } else if (s.IsNotFound()) {
@@ -757,9 +1028,15 @@ int RocksDBStore::get(
   utime_t start = ceph_clock_now();
   int r = 0;
   string value, k;
-  combine_strings(prefix, key, keylen, &k);
   rocksdb::Status s;
-  s = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(k), &value);
+  auto cf = get_cf_handle(prefix);
+  if (cf) {
+    s = db->Get(rocksdb::ReadOptions(), cf, rocksdb::Slice(key, keylen),
+		&value);
+  } else {
+    combine_strings(prefix, key, keylen, &k);
+    s = db->Get(rocksdb::ReadOptions(), rocksdb::Slice(k), &value);
+  }
   if (s.ok()) {
     out->append(value);
   } else if (s.IsNotFound()) {
@@ -798,6 +1075,9 @@ void RocksDBStore::compact()
   logger->inc(l_rocksdb_compact);
   rocksdb::CompactRangeOptions options;
   db->CompactRange(options, nullptr, nullptr);
+  for (auto& p : cf_handles) {
+    db->CompactRange(options, p.second, nullptr, nullptr);
+  }
 }
 
 
@@ -872,6 +1152,21 @@ bool RocksDBStore::check_omap_dir(string &omap_dir)
 void RocksDBStore::compact_range(const string& start, const string& end)
 {
   rocksdb::CompactRangeOptions options;
+  // ranges in a prefix with its own column family arrive as combined
+  // keys; an empty key there leaves that side of the range open
+  string prefix, kstart, kend;
+  rocksdb::ColumnFamilyHandle *cf = nullptr;
+  if (!cf_handles.empty() &&
+      split_key(start, &prefix, &kstart) == 0 &&
+      (cf = get_cf_handle(prefix)) != nullptr &&
+      split_key(end, nullptr, &kend) == 0) {
+    rocksdb::Slice cstart(kstart);
+    rocksdb::Slice cend(kend);
+    db->CompactRange(options, cf,
+		     kstart.empty() ? nullptr : &cstart,
+		     kend.empty() ? nullptr : &cend);
+    return;
+  }
   rocksdb::Slice cstart(start);
   rocksdb::Slice cend(end);
   db->CompactRange(options, &cstart, &cend);
@@ -937,6 +1232,8 @@ int RocksDBStore::RocksDBWholeSpaceIteratorImpl::next()
 {
   if (valid()) {
     dbiter->Next();
+    if (readahead)
+      readahead->next(&dbiter);
   }
   assert(!dbiter->status().IsIOError());
   return dbiter->status().ok() ? 0 : -1;
@@ -1007,7 +1304,169 @@ string RocksDBStore::past_prefix(const string &prefix)
 
 RocksDBStore::WholeSpaceIterator RocksDBStore::_get_iterator()
 {
+  // with a prefix extractor, seeks would otherwise skip sst files whose
+  // prefix filter misses the seek key's prefix
+  rocksdb::ReadOptions options;
+  options.total_order_seek = true;
   return std::make_shared<RocksDBWholeSpaceIteratorImpl>(
-        db->NewIterator(rocksdb::ReadOptions()));
+        db->NewIterator(options));
 }
 
+
+void RocksDBStore::IterateReadahead::next(rocksdb::Iterator **dbiter)
+{
+  if (!remaining || --remaining)
+    return;
+  if (!(*dbiter)->Valid())
+    return;
+  string key = (*dbiter)->key().ToString();
+  rocksdb::Iterator *it = cf ? db->NewIterator(options, cf) :
+    db->NewIterator(options);
+  it->Seek(rocksdb::Slice(key));
+  delete *dbiter;
+  *dbiter = it;
+}
+
+RocksDBStore::CFIteratorImpl::~CFIteratorImpl()
+{
+  delete dbiter;
+}
+int RocksDBStore::CFIteratorImpl::seek_to_first()
+{
+  dbiter->SeekToFirst();
+  assert(!dbiter->status().IsIOError());
+  return dbiter->status().ok() ? 0 : -1;
+}
+int RocksDBStore::CFIteratorImpl::seek_to_last()
+{
+  dbiter->SeekToLast();
+  assert(!dbiter->status().IsIOError());
+  return dbiter->status().ok() ? 0 : -1;
+}
+int RocksDBStore::CFIteratorImpl::upper_bound(const string &after)
+{
+  lower_bound(after);
+  if (valid() && dbiter->key() == rocksdb::Slice(after)) {
+    next();
+  }
+  return dbiter->status().ok() ? 0 : -1;
+}
+int RocksDBStore::CFIteratorImpl::lower_bound(const string &to)
+{
+  rocksdb::Slice slice_bound(to);
+  dbiter->Seek(slice_bound);
+  return dbiter->status().ok() ? 0 : -1;
+}
+bool RocksDBStore::CFIteratorImpl::valid()
+{
+  return dbiter->Valid();
+}
+int RocksDBStore::CFIteratorImpl::next(bool validate)
+{
+  if (!validate || valid()) {
+    dbiter->Next();
+    if (readahead)
+      readahead->next(&dbiter);
+  }
+  assert(!dbiter->status().IsIOError());
+  return dbiter->status().ok() ? 0 : -1;
+}
+int RocksDBStore::CFIteratorImpl::prev(bool validate)
+{
+  if (!validate || valid()) {
+    dbiter->Prev();
+  }
+  assert(!dbiter->status().IsIOError());
+  return dbiter->status().ok() ? 0 : -1;
+}
+string RocksDBStore::CFIteratorImpl::key()
+{
+  return dbiter->key().ToString();
+}
+pair<string,string> RocksDBStore::CFIteratorImpl::raw_key()
+{
+  return make_pair(prefix, key());
+}
+bufferlist RocksDBStore::CFIteratorImpl::value()
+{
+  return to_bufferlist(dbiter->value());
+}
+bufferptr RocksDBStore::CFIteratorImpl::value_as_ptr()
+{
+  rocksdb::Slice val = dbiter->value();
+  return bufferptr(val.data(), val.size());
+}
+int RocksDBStore::CFIteratorImpl::status()
+{
+  return dbiter->status().ok() ? 0 : -1;
+}
+
+KeyValueDB::Iterator RocksDBStore::get_iterator(const string& prefix)
+{
+  auto cf = get_cf_handle(prefix);
+  if (cf) {
+    rocksdb::ReadOptions options;
+    options.total_order_seek = true;
+    return std::make_shared<CFIteratorImpl>(
+      prefix, db->NewIterator(options, cf));
+  }
+  return KeyValueDB::get_iterator(prefix);
+}
+
+bool RocksDBStore::is_prefix_scan(const string& prefix,
+				  const string& lower,
+				  const string& upper)
+{
+  string lower_key = combine_strings(prefix, lower);
+  if (!prefix_extractor->InDomain(lower_key))
+    return false;
+  rocksdb::Slice p = prefix_extractor->Transform(lower_key);
+  if (upper.empty()) {
+    // the whole kv prefix, which is all the extractor keeps
+    return p.size() == prefix.size() + 1;
+  }
+  string upper_key = combine_strings(prefix, upper);
+  return prefix_extractor->InDomain(upper_key) &&
+    prefix_extractor->Transform(upper_key) == p;
+}
+
+KeyValueDB::Iterator RocksDBStore::get_bounded_iterator(const string& prefix,
+							const string& lower,
+							const string& upper)
+{
+  auto cf = get_cf_handle(prefix);
+  rocksdb::ReadOptions options;
+  IterateBoundRef bound;
+  if (cf) {
+    if (upper.length())
+      bound.reset(new IterateBound(upper));
+    options.total_order_seek = true;
+  } else {
+    bound.reset(new IterateBound(
+      upper.empty() ? past_prefix(prefix) : combine_strings(prefix, upper)));
+    if (prefix_extractor && is_prefix_scan(prefix, lower, upper)) {
+      options.prefix_same_as_start = true;
+    } else {
+      options.total_order_seek = true;
+    }
+  }
+  if (bound)
+    options.iterate_upper_bound = &bound->slice;
+  IterateReadaheadRef readahead;
+  if (cct->_conf->rocksdb_iterator_readahead_after &&
+      cct->_conf->rocksdb_iterator_readahead_size) {
+    rocksdb::ReadOptions ra_options = options;
+    ra_options.readahead_size = cct->_conf->rocksdb_iterator_readahead_size;
+    readahead.reset(new IterateReadahead(
+      db, cf, ra_options, cct->_conf->rocksdb_iterator_readahead_after));
+  }
+  if (cf) {
+    return std::make_shared<CFIteratorImpl>(
+      prefix, db->NewIterator(options, cf), std::move(bound),
+      std::move(readahead));
+  }
+  return std::make_shared<PrefixIteratorImpl>(
+    prefix,
+    std::make_shared<RocksDBWholeSpaceIteratorImpl>(
+      db->NewIterator(options), std::move(bound), std::move(readahead)));
+}
@@ -10,12 +10,14 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <unordered_map>
 #include <boost/scoped_ptr.hpp>
 #include "rocksdb/write_batch.h"
 #include "rocksdb/perf_context.h"
 #include "rocksdb/iostats_context.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/table.h"
+#include "rocksdb/options.h"
 #include <errno.h>
 #include "common/errno.h"
 #include "common/dout.h"
@@ -55,7 +57,10 @@ namespace rocksdb{
   class WriteBatch;
   class Iterator;
   class Logger;
+  class ColumnFamilyHandle;
+  class SliceTransform;
   struct Options;
+  struct ColumnFamilyOptions;
   struct BlockBasedTableOptions;
 }
 
@@ -78,8 +83,29 @@ class RocksDBStore : public KeyValueDB {
   uint64_t cache_size = 0;
   bool set_cache_flag = false;
 
+  /// prefixes that live in their own column family; keys in them are
+  /// stored without the prefix
+  std::unordered_map<std::string, rocksdb::ColumnFamilyHandle*> cf_handles;
+
+  /// set when rocksdb_prefix_extractor_key_bytes >= 0; lets bounded
+  /// iterators use prefix bloom filters (default column family only)
+  std::shared_ptr<const rocksdb::SliceTransform> prefix_extractor;
+  bool is_prefix_scan(const string& prefix, const string& lower,
+		      const string& upper);
+
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix) {
+    if (cf_handles.empty())
+      return nullptr;
+    auto p = cf_handles.find(prefix);
+    return p == cf_handles.end() ? nullptr : p->second;
+  }
+
   int submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Transaction t);
-  int do_open(ostream &out, bool create_if_missing);
+  int do_open(ostream &out, bool create_if_missing,
+	      const vector<ColumnFamily>& cfs);
+  int get_cf_options(const std::string& name, const std::string& option,
+		     const rocksdb::Options& base,
+		     rocksdb::ColumnFamilyOptions *cf_opt);
 
   // manage async compactions
   Mutex compact_queue_lock;
@@ -115,10 +141,19 @@ public:
   int init(string options_str) override;
   /// compact rocksdb for all keys with a given prefix
   void compact_prefix(const string& prefix) override {
-    compact_range(prefix, past_prefix(prefix));
+    if (get_cf_handle(prefix)) {
+      // an empty key bounds the whole column family
+      compact_range(prefix, string(), string());
+    } else {
+      compact_range(prefix, past_prefix(prefix));
+    }
   }
   void compact_prefix_async(const string& prefix) override {
-    compact_range_async(prefix, past_prefix(prefix));
+    if (get_cf_handle(prefix)) {
+      compact_range_async(prefix, string(), string());
+    } else {
+      compact_range_async(prefix, past_prefix(prefix));
+    }
   }
 
   void compact_range(const string& prefix, const string& start, const string& end) override {
@@ -147,12 +182,14 @@ public:
   ~RocksDBStore() override;
 
   static bool check_omap_dir(string &omap_dir);
-  /// Opens underlying db
-  int open(ostream &out) override {
-    return do_open(out, false);
+  /// Opens underlying db, with every column family it was created with
+  int open(ostream &out, const vector<ColumnFamily>& cfs = {}) override {
+    return do_open(out, false, cfs);
   }
-  /// Creates underlying db if missing and opens it
-  int create_and_open(ostream &out) override;
+  /// Creates underlying db if missing and opens it; cfs are only
+  /// created along with a new db
+  int create_and_open(ostream &out,
+		      const vector<ColumnFamily>& cfs = {}) override;
 
   void close() override;
 
@@ -246,6 +283,54 @@ public:
 
       num_seen++;
     }
+    rocksdb::Status PutCF(uint32_t column_family_id,
+			  const rocksdb::Slice& key,
+			  const rocksdb::Slice& value) override {
+      if (column_family_id == 0) {
+	Put(key, value);
+      } else {
+	seen += "\nPut( CF = " + std::to_string(column_family_id) + " key = "
+	  + pretty_binary_string(key.ToString())
+	  + " Value size = " + std::to_string(value.size()) + ")";
+	num_seen++;
+      }
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status DeleteCF(uint32_t column_family_id,
+			     const rocksdb::Slice& key) override {
+      if (column_family_id == 0) {
+	Delete(key);
+      } else {
+	seen += "\nDelete( CF = " + std::to_string(column_family_id) +
+	  " key = " + pretty_binary_string(key.ToString()) + ")";
+	num_seen++;
+      }
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status SingleDeleteCF(uint32_t column_family_id,
+				   const rocksdb::Slice& key) override {
+      if (column_family_id == 0) {
+	SingleDelete(key);
+      } else {
+	seen += "\nSingleDelete( CF = " + std::to_string(column_family_id) +
+	  " key = " + pretty_binary_string(key.ToString()) + ")";
+	num_seen++;
+      }
+      return rocksdb::Status::OK();
+    }
+    rocksdb::Status MergeCF(uint32_t column_family_id,
+			    const rocksdb::Slice& key,
+			    const rocksdb::Slice& value) override {
+      if (column_family_id == 0) {
+	Merge(key, value);
+      } else {
+	seen += "\nMerge( CF = " + std::to_string(column_family_id) +
+	  " key = " + pretty_binary_string(key.ToString()) +
+	  " Value size = " + std::to_string(value.size()) + ")";
+	num_seen++;
+      }
+      return rocksdb::Status::OK();
+    }
     bool Continue() override { return num_seen < 50; }
 
   };
@@ -312,13 +397,42 @@ public:
     bufferlist *out) override;
 
 
+  /// iterate_upper_bound of a bounded iterator, which has to outlive
+  /// the rocksdb iterator using it
+  struct IterateBound {
+    string key;
+    rocksdb::Slice slice;
+    explicit IterateBound(const string& k) : key(k), slice(key) { }
+  };
+  typedef std::unique_ptr<IterateBound> IterateBoundRef;
+
+  /// once a bounded iterator has stepped over enough keys to look like a
+  /// long scan, carry on from the current key with a readahead iterator.
+  /// Bounded ranges are ones the caller keeps stable (e.g. the omap of
+  /// an object it has flushed), so the newer view is harmless.
+  struct IterateReadahead {
+    rocksdb::DB *db;
+    rocksdb::ColumnFamilyHandle *cf;
+    rocksdb::ReadOptions options;  ///< with readahead_size set
+    uint64_t remaining;            ///< next() calls left before switching
+    IterateReadahead(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *cf,
+		     const rocksdb::ReadOptions& o, uint64_t after)
+      : db(db), cf(cf), options(o), remaining(after) { }
+    void next(rocksdb::Iterator **dbiter);
+  };
+  typedef std::unique_ptr<IterateReadahead> IterateReadaheadRef;
+
   class RocksDBWholeSpaceIteratorImpl :
     public KeyValueDB::WholeSpaceIteratorImpl {
   protected:
     rocksdb::Iterator *dbiter;
+    IterateBoundRef bound;
+    IterateReadaheadRef readahead;
   public:
-    explicit RocksDBWholeSpaceIteratorImpl(rocksdb::Iterator *iter) :
-      dbiter(iter) { }
+    explicit RocksDBWholeSpaceIteratorImpl(rocksdb::Iterator *iter,
+					   IterateBoundRef b = nullptr,
+					   IterateReadaheadRef r = nullptr) :
+      dbiter(iter), bound(std::move(b)), readahead(std::move(r)) { }
     //virtual ~RocksDBWholeSpaceIteratorImpl() { }
     ~RocksDBWholeSpaceIteratorImpl() override;
 
@@ -341,6 +455,41 @@ public:
     size_t value_size() override;
   };
 
+  /// iterates a prefix kept in its own column family
+  class CFIteratorImpl : public KeyValueDB::IteratorImpl {
+  protected:
+    string prefix;
+    rocksdb::Iterator *dbiter;
+    IterateBoundRef bound;
+    IterateReadaheadRef readahead;
+  public:
+    CFIteratorImpl(const string& p, rocksdb::Iterator *iter,
+		   IterateBoundRef b = nullptr,
+		   IterateReadaheadRef r = nullptr) :
+      prefix(p), dbiter(iter), bound(std::move(b)),
+      readahead(std::move(r)) { }
+    ~CFIteratorImpl() override;
+
+    int seek_to_first() override;
+    int seek_to_last() override;
+    int upper_bound(const string &after) override;
+    int lower_bound(const string &to) override;
+    bool valid() override;
+    int next(bool validate=true) override;
+    int prev(bool validate=true) override;
+    string key() override;
+    pair<string,string> raw_key() override;
+    bufferlist value() override;
+    bufferptr value_as_ptr() override;
+    int status() override;
+  };
+
+  using KeyValueDB::get_iterator;
+  Iterator get_iterator(const string& prefix) override;
+  Iterator get_bounded_iterator(const string& prefix,
+				const string& lower,
+				const string& upper) override;
+
   /// Utility
   static string combine_strings(const string &prefix, const string &value) {
     string out = prefix;
@@ -439,11 +588,9 @@ err:
     return total_size;
   }
 
-  int set_cache_size(uint64_t s) override {
-    cache_size = s;
-    set_cache_flag = true;
-    return 0;
-  }
+  int set_cache_size(uint64_t s) override;
+  int get_cache_stats(CacheStats *stats) override;
+  int get_last_seq(uint64_t *seq) override;
 
 protected:
   WholeSpaceIterator _get_iterator() override;
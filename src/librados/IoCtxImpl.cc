@@ -833,6 +833,83 @@ int librados::IoCtxImpl::aio_operate(const object_t& oid,
   return 0;
 }
 
+struct librados::IoCtxImpl::C_aio_BatchComplete {
+  Context *on_finish;
+  std::atomic<size_t> pending;
+  std::atomic<int> rval = {0};
+
+  C_aio_BatchComplete(Context *on_finish, size_t count)
+    : on_finish(on_finish), pending(count) {
+  }
+
+  void complete_op(int r) {
+    if (r < 0) {
+      int expected = 0;
+      rval.compare_exchange_strong(expected, r);
+    }
+    if (--pending == 0) {
+      on_finish->complete(rval);
+      delete this;
+    }
+  }
+};
+
+int librados::IoCtxImpl::aio_operate_batch(
+    const std::vector<std::pair<object_t, ::ObjectOperation*> >& ops,
+    AioCompletionImpl *c, const SnapContext& snap_context, int flags)
+{
+  FUNCTRACE();
+  auto ut = ceph::real_clock::now();
+  /* can't write to a snapshot */
+  if (snap_seq != CEPH_NOSNAP)
+    return -EROFS;
+
+  c->io = this;
+  queue_aio_write(c);
+
+  if (ops.empty()) {
+    Context *oncomplete = new C_aio_Complete(c);
+    oncomplete->complete(0);
+    return 0;
+  }
+
+  // submit the ops grouped by primary OSD (and PG within it) so that the
+  // messages for each OSD are queued back to back; the sort is stable so
+  // ops on the same object keep their order
+  std::vector<std::pair<std::pair<int, pg_t>, size_t> > order;
+  order.reserve(ops.size());
+  objecter->with_osdmap([&](const OSDMap& o) {
+      for (size_t i = 0; i < ops.size(); ++i) {
+	pg_t pgid;
+	int primary = -1;
+	if (o.object_locator_to_pg(ops[i].first, oloc, pgid) == 0) {
+	  o.pg_to_up_acting_osds(o.raw_pg_to_pg(pgid), nullptr, nullptr,
+				 nullptr, &primary);
+	}
+	order.push_back(std::make_pair(std::make_pair(primary, pgid), i));
+      }
+    });
+  std::stable_sort(order.begin(), order.end(),
+		   [](const std::pair<std::pair<int, pg_t>, size_t>& a,
+		      const std::pair<std::pair<int, pg_t>, size_t>& b) {
+		     return a.first < b.first;
+		   });
+
+  auto batch = new C_aio_BatchComplete(new C_aio_Complete(c), ops.size());
+  for (auto& it : order) {
+    auto& op = ops[it.second];
+    Context *oncomplete = new FunctionContext([batch](int r) {
+	batch->complete_op(r);
+      });
+    Objecter::Op *objecter_op = objecter->prepare_mutate_op(
+      op.first, oloc, *op.second, snap_context, ut, flags,
+      oncomplete, nullptr);
+    objecter->op_submit(objecter_op, &c->tid);
+  }
+
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  bufferlist *pbl, size_t len, uint64_t off,
 				  uint64_t snapid, const blkin_trace_info *info)
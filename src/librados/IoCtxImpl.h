@@ -159,6 +159,9 @@ struct librados::IoCtxImpl {
   int aio_operate(const object_t& oid, ::ObjectOperation *o,
 		  AioCompletionImpl *c, const SnapContext& snap_context,
 		  int flags, const blkin_trace_info *trace_info = nullptr);
+  int aio_operate_batch(
+      const std::vector<std::pair<object_t, ::ObjectOperation*> >& ops,
+      AioCompletionImpl *c, const SnapContext& snap_context, int flags);
   int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
 		       AioCompletionImpl *c, int flags, bufferlist *pbl, const blkin_trace_info *trace_info = nullptr);
 
@@ -178,6 +181,8 @@ struct librados::IoCtxImpl {
     void finish(int r) override;
   };
 
+  struct C_aio_BatchComplete;
+
   struct C_aio_Complete : public Context {
 #if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
     object_t oid;
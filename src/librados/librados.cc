@@ -1515,6 +1515,20 @@ int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				  translate_flags(flags));
 }
 
+int librados::IoCtx::aio_operate_batch(
+  AioCompletion *c,
+  const std::vector<std::pair<std::string, ObjectWriteOperation*> >& ops,
+  int flags)
+{
+  std::vector<std::pair<object_t, ::ObjectOperation*> > batch;
+  batch.reserve(ops.size());
+  for (auto& op : ops) {
+    batch.push_back(std::make_pair(object_t(op.first), &op.second->impl->o));
+  }
+  return io_ctx_impl->aio_operate_batch(batch, c->pc, io_ctx_impl->snapc,
+					translate_flags(flags));
+}
+
 int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				 librados::ObjectWriteOperation *o,
 				 snap_t snap_seq, std::vector<snap_t>& snaps)
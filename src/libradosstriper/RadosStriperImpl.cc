@@ -25,6 +25,7 @@
 #include "include/types.h"
 #include "include/uuid.h"
 #include "include/ceph_fs.h"
+#include "common/Clock.h"
 #include "common/dout.h"
 #include "common/strtol.h"
 #include "osdc/Striper.h"
@@ -138,8 +139,10 @@ struct CompletionData : RefCountedObject {
   libradosstriper::RadosStriperImpl *m_striper;
   /// striped object concerned by the write operation
   std::string m_soid;
-  /// shared lock to be released at completion
+  /// shared lock to be released at completion, empty if leased
   std::string m_lockCookie;
+  /// when the operation started under its lease, if leased
+  utime_t m_leaseStart;
   /// completion handler
   librados::IoCtxImpl::C_aio_Complete *m_ack;
 };
@@ -153,6 +156,8 @@ CompletionData::CompletionData
   RefCountedObject(striper->cct(), n),
   m_striper(striper), m_soid(soid), m_lockCookie(lockCookie), m_ack(0) {
   m_striper->get();
+  if (lockCookie.empty())
+    m_leaseStart = ceph_clock_now();
   if (userCompletion) {
     m_ack = new librados::IoCtxImpl::C_aio_Complete(userCompletion);
     userCompletion->io = striper->m_ioCtxImpl;
@@ -439,7 +444,18 @@ struct RadosRemoveCompletionData : RefCountedObject {
 
 libradosstriper::RadosStriperImpl::RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl) :
   m_refCnt(0),lock("RadosStriper Refcont", false, false), m_radosCluster(ioctx), m_ioCtx(ioctx), m_ioCtxImpl(ioctx_impl),
-  m_layout(default_file_layout) {}
+  m_layout(default_file_layout), m_leaseLock("RadosStriper Leases") {}
+
+libradosstriper::RadosStriperImpl::~RadosStriperImpl()
+{
+  // release the remaining leases. This may run from a rados callback, so
+  // do not wait for the unlocks
+  for (auto &lease : m_leases) {
+    librados::AioCompletion *c = librados::Rados::aio_create_completion();
+    aio_unlockObject(lease.first, lease.second.cookie, c);
+    c->release();
+  }
+}
 
 ///////////////////////// layout /////////////////////////////
 
@@ -624,6 +640,18 @@ static void rados_read_aio_unlock_complete(rados_striper_multi_completion_t c, v
 static void striper_read_aio_req_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<ReadCompletionData*>(arg);
+  if (cdata->m_lockCookie.empty()) {
+    // leased lock, nothing to unlock
+    libradosstriper::MultiAioCompletionImpl *comp =
+      reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
+    int rc = comp->rval;
+    if (rc >= 0)
+      rc = cdata->m_striper->checkLease(cdata->m_soid, cdata->m_leaseStart);
+    cdata->complete_read(rc);
+    cdata->complete_unlock(0);
+    cdata->put();
+    return;
+  }
   // launch the async unlocking of the object
   cdata->m_striper->aio_unlockObject(cdata->m_soid, cdata->m_lockCookie, cdata->m_unlockCompletion);
   // complete the read part in parallel
@@ -992,6 +1020,8 @@ int libradosstriper::RadosStriperImpl::aio_remove(const std::string& soid,
 						  librados::AioCompletionImpl *c,
 						  int flags)
 {
+  // our own lease would prevent us from taking the exclusive lock
+  releaseLease(soid);
   // the RemoveCompletionData object will lock the given soid for the duration
   // of the removal
   std::string lockCookie = getUUID();
@@ -1088,6 +1118,8 @@ int libradosstriper::RadosStriperImpl::internal_aio_remove(
 
 int libradosstriper::RadosStriperImpl::trunc(const std::string& soid, uint64_t size)
 {
+  // our own lease would prevent us from taking the exclusive lock
+  releaseLease(soid);
   // lock the object in exclusive mode
   std::string firstObjOid = getObjectId(soid, 0);
   librados::ObjectWriteOperation op;
@@ -1128,6 +1160,11 @@ std::string libradosstriper::RadosStriperImpl::getObjectId(const object_t& soid,
 void libradosstriper::RadosStriperImpl::unlockObject(const std::string& soid,
 						     const std::string& lockCookie)
 {
+  if (lockCookie.empty()) {
+    // leased lock
+    releaseLease(soid);
+    return;
+  }
   // unlock the shared lock on the first rados object
   std::string firstObjOid = getObjectId(soid, 0);
   m_ioCtx.unlock(firstObjOid, RADOS_LOCK_NAME, lockCookie);
@@ -1154,11 +1191,22 @@ static void rados_write_aio_unlock_complete(rados_striper_multi_completion_t c,
 static void striper_write_aio_req_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<WriteCompletionData*>(arg);
+  libradosstriper::MultiAioCompletionImpl *comp =
+    reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
+  if (cdata->m_lockCookie.empty()) {
+    // leased lock, nothing to unlock
+    int rc = comp->rval;
+    if (rc >= 0)
+      rc = cdata->m_striper->checkLease(cdata->m_soid, cdata->m_leaseStart);
+    cdata->complete_write(rc);
+    cdata->complete_unlock(0);
+    cdata->put();
+    cdata->put();
+    return;
+  }
   // launch the async unlocking of the object
   cdata->m_striper->aio_unlockObject(cdata->m_soid, cdata->m_lockCookie, cdata->m_unlockCompletion);
   // complete the write part in parallel
-  libradosstriper::MultiAioCompletionImpl *comp =
-    reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
   cdata->complete_write(comp->rval);
   cdata->put();
 }
@@ -1168,7 +1216,10 @@ static void striper_write_aio_req_safe(rados_striper_multi_completion_t c, void
   auto cdata = reinterpret_cast<WriteCompletionData*>(arg);
   libradosstriper::MultiAioCompletionImpl *comp =
     reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
-  cdata->safe(comp->rval);
+  int rc = comp->rval;
+  if (rc >= 0 && cdata->m_lockCookie.empty())
+    rc = cdata->m_striper->checkLease(cdata->m_soid, cdata->m_leaseStart);
+  cdata->safe(rc);
   cdata->put();
 }
 
@@ -1199,9 +1250,12 @@ int libradosstriper::RadosStriperImpl::write_in_open_object(const std::string& s
     c->wait_for_complete_and_cb();
     c->wait_for_safe_and_cb();
     // wait for the unlocking
-    unlock_completion->wait_for_complete();
+    if (!lockCookie.empty())
+      unlock_completion->wait_for_complete();
     // return result
     rc = c->get_return_value();
+    if (rc >= 0 && lockCookie.empty())
+      rc = checkLease(soid, cdata->m_leaseStart);
   }
   cdata->put();
   return rc;
@@ -1370,21 +1424,108 @@ int libradosstriper::RadosStriperImpl::internal_get_layout_and_size(
   return 0;
 }
 
-int libradosstriper::RadosStriperImpl::openStripedObjectForRead(
+int libradosstriper::RadosStriperImpl::lockStripedObjectShared(
   const std::string& soid,
-  ceph_file_layout *layout,
-  uint64_t *size,
   std::string *lockCookie)
 {
-  // take a lock the first rados object, if it exists and gets its size
-  // check, lock and size reading must be atomic and are thus done within a single operation
+  double lease = cct()->_conf->get_val<double>("rados_striper_lock_lease");
+  utime_t now = ceph_clock_now();
+  std::string cookie;
+  uint8_t flags = 0;
+  if (lease > 0) {
+    // reuse the lease while it is not about to expire, so that operations
+    // started under it normally complete before it does
+    Mutex::Locker locker(m_leaseLock);
+    auto it = m_leases.find(soid);
+    if (it != m_leases.end()) {
+      if (now + lease / 2 < it->second.expiry) {
+        lockCookie->clear();
+        return 0;
+      }
+      // renew the lease we hold rather than take a second lock
+      cookie = it->second.cookie;
+      flags = LOCK_FLAG_RENEW;
+    }
+  }
+  if (cookie.empty())
+    cookie = getUUID();
+  // check and lock must be atomic and are thus done within a single operation
   librados::ObjectWriteOperation op;
   op.assert_exists();
-  *lockCookie = getUUID();
   utime_t dur = utime_t();
-  rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur, 0);
+  if (lease > 0)
+    dur.set_from_double(lease);
+  rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, cookie, "Tag", "", dur, flags);
   std::string firstObjOid = getObjectId(soid, 0);
   int rc = m_ioCtx.operate(firstObjOid, &op);
+  if (rc) {
+    if (flags) {
+      // the lease could not be renewed, forget it
+      Mutex::Locker locker(m_leaseLock);
+      auto it = m_leases.find(soid);
+      if (it != m_leases.end() && it->second.cookie == cookie)
+        m_leases.erase(it);
+    }
+    return rc;
+  }
+  if (lease > 0) {
+    Mutex::Locker locker(m_leaseLock);
+    Lease &entry = m_leases[soid];
+    if (entry.cookie != cookie || entry.expiry <= now) {
+      // a new lease, or one that lapsed before it was renewed: the lock
+      // has only been held continuously from now on
+      entry.since = now;
+    }
+    entry.cookie = cookie;
+    entry.expiry = now + dur;
+    lockCookie->clear();
+  } else {
+    *lockCookie = cookie;
+  }
+  return 0;
+}
+
+int libradosstriper::RadosStriperImpl::checkLease(const std::string& soid,
+                                                  utime_t start)
+{
+  Mutex::Locker locker(m_leaseLock);
+  auto it = m_leases.find(soid);
+  if (it == m_leases.end() || start < it->second.since ||
+      ceph_clock_now() >= it->second.expiry) {
+    ldout(cct(), 1) << "lease on " << soid
+                    << " lapsed during the operation" << dendl;
+    return -ETIMEDOUT;
+  }
+  return 0;
+}
+
+void libradosstriper::RadosStriperImpl::releaseLease(const std::string& soid)
+{
+  std::string cookie;
+  {
+    Mutex::Locker locker(m_leaseLock);
+    auto it = m_leases.find(soid);
+    if (it == m_leases.end())
+      return;
+    cookie = it->second.cookie;
+    m_leases.erase(it);
+  }
+  // ops on the first object are ordered, so a subsequent lock request will
+  // find the lease released
+  librados::AioCompletion *c = librados::Rados::aio_create_completion();
+  aio_unlockObject(soid, cookie, c);
+  c->release();
+}
+
+int libradosstriper::RadosStriperImpl::openStripedObjectForRead(
+  const std::string& soid,
+  ceph_file_layout *layout,
+  uint64_t *size,
+  std::string *lockCookie)
+{
+  // take a lock the first rados object, if it exists and gets its size
+  int rc = lockStripedObjectShared(soid, lockCookie);
+  std::string firstObjOid = getObjectId(soid, 0);
   if (rc) {
     // error case (including -ENOENT)
     return rc;
@@ -1406,14 +1547,8 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForWrite(const std::stri
 								 bool isFileSizeAbsolute)
 {
   // take a lock the first rados object, if it exists
-  // check and lock must be atomic and are thus done within a single operation
-  librados::ObjectWriteOperation op;
-  op.assert_exists();
-  *lockCookie = getUUID();
-  utime_t dur = utime_t();
-  rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur, 0);
+  int rc = lockStripedObjectShared(soid, lockCookie);
   std::string firstObjOid = getObjectId(soid, 0);
-  int rc = m_ioCtx.operate(firstObjOid, &op);
   if (rc) {
     if (rc == -ENOENT) {
       // object does not exist, delegate to createEmptyStripedObject
@@ -15,6 +15,7 @@
 #ifndef CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 #define CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 
+#include <map>
 #include <string>
 
 #include "include/rados/librados.h"
@@ -26,6 +27,8 @@
 #include "librados/IoCtxImpl.h"
 #include "librados/AioCompletionImpl.h"
 #include "common/RefCountedObj.h"
+#include "common/Mutex.h"
+#include "include/utime.h"
 
 namespace libradosstriper {
 
@@ -51,7 +54,7 @@ struct RadosStriperImpl {
    */
   RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl);
   /// Destructor
-  ~RadosStriperImpl() {};
+  ~RadosStriperImpl();
 
   // configuration
   int setObjectLayoutStripeUnit(unsigned int stripe_unit);
@@ -131,6 +134,8 @@ struct RadosStriperImpl {
   std::string getObjectId(const object_t& soid, long long unsigned objectno);
 
   // opening and closing of striped objects
+  // an empty lockCookie denotes a leased lock (see rados_striper_lock_lease),
+  // which is only released by unlockObject, and only on error paths
   void unlockObject(const std::string& soid,
 		    const std::string& lockCookie);
   void aio_unlockObject(const std::string& soid,
@@ -174,6 +179,29 @@ struct RadosStriperImpl {
 			  MultiAioCompletionImplPtr multi_completion,
 			  int flags=0);
 
+  /**
+   * takes a shared lock on the first rados object of an existing striped
+   * object, or reuses a lease on it if rados_striper_lock_lease is set.
+   * lockCookie is left empty if the lock is leased, in which case it is not
+   * released at the end of the operation but expires on its own
+   * @return 0 if the lock was taken, -ENOENT if the object does not exist
+   */
+  int lockStripedObjectShared(const std::string& soid,
+			      std::string *lockCookie);
+
+  /**
+   * drops the lease on the given striped object, if any
+   */
+  void releaseLease(const std::string& soid);
+
+  /**
+   * checks that the lease on the given striped object has been held
+   * continuously since start, i.e. for the whole of an operation
+   * started under it
+   * @return 0 if so, -ETIMEDOUT if the lease lapsed or was dropped
+   */
+  int checkLease(const std::string& soid, utime_t start);
+
   /**
    * opens an existing striped object and takes a shared lock on it
    * @return 0 if everything is ok and the lock was taken. -errcode otherwise
@@ -269,6 +297,15 @@ struct RadosStriperImpl {
 
   // Default layout
   ceph_file_layout m_layout;
+
+  // shared locks leased across operations, per striped object
+  struct Lease {
+    std::string cookie;
+    utime_t since;   ///< held continuously from then on
+    utime_t expiry;
+  };
+  Mutex m_leaseLock;
+  std::map<std::string, Lease> m_leases;
 };
 }
 #endif
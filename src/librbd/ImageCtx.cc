@@ -24,6 +24,8 @@
 #include "librbd/operation/ResizeRequest.h"
 #include "librbd/Utils.h"
 #include "librbd/LibrbdWriteback.h"
+#include "librbd/cache/FileImageCache.h"
+#include "librbd/cache/WriteLogImageCache.h"
 #include "librbd/exclusive_lock/AutomaticPolicy.h"
 #include "librbd/exclusive_lock/StandardPolicy.h"
 #include "librbd/io/AioCompletion.h"
@@ -100,6 +102,18 @@ struct C_FlushCache : public Context {
   }
 };
 
+struct C_FlushImageCache : public Context {
+  ImageCtx *image_ctx;
+  Context *on_safe;
+
+  C_FlushImageCache(ImageCtx *_image_ctx, Context *_on_safe)
+    : image_ctx(_image_ctx), on_safe(_on_safe) {
+  }
+  void finish(int r) override {
+    image_ctx->image_cache->flush(on_safe);
+  }
+};
+
 struct C_ShutDownCache : public Context {
   ImageCtx *image_ctx;
   Context *on_finish;
@@ -313,6 +327,28 @@ struct C_InvalidateCache : public Context {
       object_cacher->start();
     }
 
+    if (read_only && !old_format &&
+        !cct->_conf->get_val<std::string>("rbd_persistent_cache_path").empty()) {
+      ldout(cct, 20) << "enabling persistent read cache..." << dendl;
+      image_cache = new cache::FileImageCache<ImageCtx>(*this);
+      C_SaferCond ctx;
+      image_cache->init(&ctx);
+      ctx.wait();
+    } else if (!read_only && !old_format &&
+               !cct->_conf->get_val<std::string>("rbd_write_log_path").empty()) {
+      ldout(cct, 20) << "enabling write log cache..." << dendl;
+      image_cache = new cache::WriteLogImageCache<ImageCtx>(*this);
+      C_SaferCond ctx;
+      image_cache->init(&ctx);
+      int r = ctx.wait();
+      if (r < 0) {
+        lderr(cct) << "failed to open write log, disabling: "
+                   << cpp_strerror(r) << dendl;
+        delete image_cache;
+        image_cache = nullptr;
+      }
+    }
+
     readahead.set_trigger_requests(readahead_trigger_requests);
     readahead.set_max_readahead_size(readahead_max_bytes);
   }
@@ -790,6 +826,24 @@ struct C_InvalidateCache : public Context {
   }
 
   void ImageCtx::shut_down_cache(Context *on_finish) {
+    if (image_cache != nullptr) {
+      // may still be writing back, so tear the object cacher down after
+      image_cache->shut_down(new FunctionContext(
+        [this, on_finish](int r) {
+          op_work_queue->queue(new FunctionContext(
+            [this, on_finish, r](int) {
+              delete image_cache;
+              image_cache = nullptr;
+              if (r < 0) {
+                lderr(cct) << "failed to shut down image cache: "
+                           << cpp_strerror(r) << dendl;
+              }
+              shut_down_cache(on_finish);
+            }), 0);
+        }));
+      return;
+    }
+
     if (object_cacher == NULL) {
       on_finish->complete(0);
       return;
@@ -906,6 +960,10 @@ struct C_InvalidateCache : public Context {
       // flush cache after completing all in-flight AIO ops
       on_safe = new C_FlushCache(this, on_safe);
     }
+    if (image_cache != nullptr) {
+      // the image cache writes back into the object cacher
+      on_safe = new C_FlushImageCache(this, on_safe);
+    }
     flush_async_operations(on_safe);
   }
 
@@ -967,6 +1025,7 @@ struct C_InvalidateCache : public Context {
     ldout(cct, 20) << __func__ << dendl;
     std::map<string, bool> configs = boost::assign::map_list_of(
         "rbd_non_blocking_aio", false)(
+        "rbd_non_blocking_aio_inline", false)(
         "rbd_cache", false)(
         "rbd_cache_writethrough_until_flush", false)(
         "rbd_cache_size", false)(
@@ -993,12 +1052,18 @@ struct C_InvalidateCache : public Context {
         "rbd_journal_object_flush_interval", false)(
         "rbd_journal_object_flush_bytes", false)(
         "rbd_journal_object_flush_age", false)(
+        "rbd_journal_object_max_in_flight_appends", false)(
         "rbd_journal_pool", false)(
         "rbd_journal_max_payload_bytes", false)(
         "rbd_journal_max_concurrent_object_sets", false)(
+        "rbd_journal_replay_max_concurrent_ios", false)(
+        "rbd_blkin_trace_sample_rate", false)(
         "rbd_mirroring_resync_after_disconnect", false)(
         "rbd_mirroring_replay_delay", false)(
-        "rbd_skip_partial_discard", false);
+        "rbd_skip_partial_discard", false)(
+        "rbd_server_side_copyup", false)(
+        "rbd_object_map_batch_updates", false)(
+        "rbd_object_map_premark_objects", false);
 
     md_config_t local_config_t;
     std::map<std::string, bufferlist> res;
@@ -1025,6 +1090,7 @@ struct C_InvalidateCache : public Context {
     } while (0);
 
     ASSIGN_OPTION(non_blocking_aio, bool);
+    ASSIGN_OPTION(non_blocking_aio_inline, bool);
     ASSIGN_OPTION(cache, bool);
     ASSIGN_OPTION(cache_writethrough_until_flush, bool);
     ASSIGN_OPTION(cache_size, int64_t);
@@ -1052,13 +1118,19 @@ struct C_InvalidateCache : public Context {
     ASSIGN_OPTION(journal_object_flush_interval, int64_t);
     ASSIGN_OPTION(journal_object_flush_bytes, int64_t);
     ASSIGN_OPTION(journal_object_flush_age, double);
+    ASSIGN_OPTION(journal_object_max_in_flight_appends, uint64_t);
     ASSIGN_OPTION(journal_pool, std::string);
     ASSIGN_OPTION(journal_max_payload_bytes, uint64_t);
     ASSIGN_OPTION(journal_max_concurrent_object_sets, int64_t);
+    ASSIGN_OPTION(journal_replay_max_concurrent_ios, uint64_t);
     ASSIGN_OPTION(mirroring_resync_after_disconnect, bool);
     ASSIGN_OPTION(mirroring_replay_delay, int64_t);
     ASSIGN_OPTION(skip_partial_discard, bool);
     ASSIGN_OPTION(blkin_trace_all, bool);
+    ASSIGN_OPTION(blkin_trace_sample_rate, uint64_t);
+    ASSIGN_OPTION(server_side_copyup, bool);
+    ASSIGN_OPTION(object_map_batch_updates, bool);
+    ASSIGN_OPTION(object_map_premark_objects, uint64_t);
   }
 
   ExclusiveLock<ImageCtx> *ImageCtx::create_exclusive_lock() {
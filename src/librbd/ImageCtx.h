@@ -163,6 +163,7 @@ namespace librbd {
     // Configuration
     static const string METADATA_CONF_PREFIX;
     bool non_blocking_aio;
+    bool non_blocking_aio_inline;
     bool cache;
     bool cache_writethrough_until_flush;
     uint64_t cache_size;
@@ -190,13 +191,19 @@ namespace librbd {
     int journal_object_flush_interval;
     uint64_t journal_object_flush_bytes;
     double journal_object_flush_age;
+    uint64_t journal_object_max_in_flight_appends;
     std::string journal_pool;
     uint32_t journal_max_payload_bytes;
     int journal_max_concurrent_object_sets;
+    uint64_t journal_replay_max_concurrent_ios;
     bool mirroring_resync_after_disconnect;
     int mirroring_replay_delay;
     bool skip_partial_discard;
     bool blkin_trace_all;
+    uint64_t blkin_trace_sample_rate;
+    bool server_side_copyup;
+    bool object_map_batch_updates;
+    uint64_t object_map_premark_objects;
 
     LibrbdAdminSocketHook *asok_hook;
 
@@ -205,6 +212,11 @@ namespace librbd {
 
     ZTracer::Endpoint trace_endpoint;
 
+    /// true if a new request should start a blkin trace
+    bool blkin_trace_sampled() const {
+      return blkin_trace_all || ztrace_sample(blkin_trace_sample_rate);
+    }
+
     static bool _filter_metadata_confs(const string &prefix, std::map<string, bool> &configs,
                                        const map<string, bufferlist> &pairs, map<string, bufferlist> *res);
 
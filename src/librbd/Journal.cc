@@ -1092,6 +1092,8 @@ void Journal<I>::create_journaler() {
   settings.max_payload_bytes = m_image_ctx.journal_max_payload_bytes;
   settings.max_concurrent_object_sets =
     m_image_ctx.journal_max_concurrent_object_sets;
+  settings.max_in_flight_appends =
+    m_image_ctx.journal_object_max_in_flight_appends;
   // TODO: a configurable filter to exclude certain peers from being
   // disconnected.
   settings.whitelisted_laggy_clients = {IMAGE_CLIENT_ID};
@@ -32,6 +32,20 @@
 
 namespace librbd {
 
+namespace {
+
+struct C_MergedUpdate : public Context {
+  std::list<Context *> contexts;
+
+  void finish(int r) override {
+    for (auto ctx : contexts) {
+      ctx->complete(r);
+    }
+  }
+};
+
+} // anonymous namespace
+
 template <typename I>
 ObjectMap<I>::ObjectMap(I &image_ctx, uint64_t snap_id)
   : m_image_ctx(image_ctx), m_snap_id(snap_id),
@@ -214,6 +228,103 @@ void ObjectMap<I>::aio_resize(uint64_t new_size, uint8_t default_object_state,
   req->send();
 }
 
+template <typename I>
+void ObjectMap<I>::queue_aio_update(UpdateOperation &&op) {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+
+  premark_update(&op);
+  if (!m_image_ctx.object_map_batch_updates || m_in_flight_updates == 0) {
+    detained_aio_update(std::move(op));
+    return;
+  }
+
+  // sent along with everything else queued once an in-flight update
+  // completes
+  ldout(m_image_ctx.cct, 20) << "queueing object map update: "
+                             << "start=" << op.start_object_no << ", "
+                             << "end=" << op.end_object_no << dendl;
+  m_pending_updates.push_back(std::move(op));
+}
+
+template <typename I>
+void ObjectMap<I>::send_pending_updates() {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+  if (m_pending_updates.empty()) {
+    return;
+  }
+
+  // merge runs of contiguous updates to the same state -- without
+  // reordering, so updates to the same object still apply in order
+  std::list<UpdateOperation> pending;
+  pending.swap(m_pending_updates);
+  std::list<UpdateOperation> batch;
+  C_MergedUpdate *merged = nullptr;
+  for (auto &op : pending) {
+    if (!batch.empty()) {
+      UpdateOperation &last = batch.back();
+      if (last.end_object_no == op.start_object_no &&
+          last.new_state == op.new_state &&
+          last.current_state == op.current_state) {
+        if (merged == nullptr) {
+          merged = new C_MergedUpdate();
+          merged->contexts.push_back(last.on_finish);
+          last.on_finish = merged;
+        }
+        merged->contexts.push_back(op.on_finish);
+        last.end_object_no = op.end_object_no;
+        continue;
+      }
+    }
+    merged = nullptr;
+    batch.push_back(std::move(op));
+  }
+
+  ldout(m_image_ctx.cct, 20) << "sending " << pending.size() << " queued "
+                             << "updates as " << batch.size() << dendl;
+  for (auto &op : batch) {
+    detained_aio_update(std::move(op));
+  }
+}
+
+template <typename I>
+void ObjectMap<I>::premark_update(UpdateOperation *op) {
+  assert(m_image_ctx.object_map_lock.is_wlocked());
+
+  // the first write to an object right after an existing one is most
+  // likely a sequential writer: mark the next few objects in the same
+  // update.  Spurious EXISTS states are safe, they only cost accuracy
+  // in fast-diff/du.
+  uint64_t count = m_image_ctx.object_map_premark_objects;
+  if (count == 0 || op->new_state != OBJECT_EXISTS || op->current_state ||
+      op->start_object_no == 0 ||
+      op->end_object_no != op->start_object_no + 1 ||
+      op->end_object_no >= m_object_map.size()) {
+    return;
+  }
+
+  uint8_t state = m_object_map[op->start_object_no - 1];
+  if (state != OBJECT_EXISTS) {
+    return;
+  }
+
+  uint64_t end_object_no = op->end_object_no;
+  while (end_object_no < m_object_map.size() &&
+         end_object_no - op->end_object_no < count) {
+    state = m_object_map[end_object_no];
+    if (state != OBJECT_NONEXISTENT) {
+      break;
+    }
+    ++end_object_no;
+  }
+
+  if (end_object_no != op->end_object_no) {
+    ldout(m_image_ctx.cct, 20) << "premarking objects " << op->end_object_no
+                               << "~" << end_object_no - op->end_object_no
+                               << dendl;
+    op->end_object_no = end_object_no;
+  }
+}
+
 template <typename I>
 void ObjectMap<I>::detained_aio_update(UpdateOperation &&op) {
   CephContext *cct = m_image_ctx.cct;
@@ -242,6 +353,7 @@ void ObjectMap<I>::detained_aio_update(UpdateOperation &&op) {
   }
 
   ldout(cct, 20) << "in-flight update cell: " << cell << dendl;
+  ++m_in_flight_updates;
   Context *on_finish = op.on_finish;
   Context *ctx = new FunctionContext([this, cell, on_finish](int r) {
       handle_detained_aio_update(cell, r, on_finish);
@@ -262,9 +374,12 @@ void ObjectMap<I>::handle_detained_aio_update(BlockGuardCell *cell, int r,
   {
     RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
     RWLock::WLocker object_map_locker(m_image_ctx.object_map_lock);
+    assert(m_in_flight_updates > 0);
+    --m_in_flight_updates;
     for (auto &op : block_ops) {
       detained_aio_update(std::move(op));
     }
+    send_pending_updates();
   }
 
   on_finish->complete(r);
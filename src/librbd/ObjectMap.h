@@ -10,6 +10,7 @@
 #include "common/bit_vector.hpp"
 #include "librbd/Utils.h"
 #include <boost/optional.hpp>
+#include <list>
 
 class Context;
 class RWLock;
@@ -85,7 +86,7 @@ public:
                                        new_state, current_state, parent_trace,
                                        util::create_context_callback<T, MF>(
                                          callback_object));
-      detained_aio_update(std::move(update_operation));
+      queue_aio_update(std::move(update_operation));
     } else {
       aio_update(snap_id, start_object_no, end_object_no, new_state,
                  current_state, parent_trace,
@@ -125,6 +126,13 @@ private:
 
   UpdateGuard *m_update_guard = nullptr;
 
+  uint32_t m_in_flight_updates = 0;
+  std::list<UpdateOperation> m_pending_updates;
+
+  void queue_aio_update(UpdateOperation &&update_operation);
+  void send_pending_updates();
+  void premark_update(UpdateOperation *update_operation);
+
   void detained_aio_update(UpdateOperation &&update_operation);
   void handle_detained_aio_update(BlockGuardCell *cell, int r,
                                   Context *on_finish);
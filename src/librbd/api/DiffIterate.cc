@@ -32,6 +32,12 @@ enum ObjectDiffState {
   OBJECT_DIFF_STATE_HOLE    = 2
 };
 
+typedef boost::tuple<uint64_t, size_t, bool> Diff;
+typedef std::list<Diff> Diffs;
+
+// extents reported per batch of object map results
+const size_t MAX_DIFF_EXTENTS = 1024;
+
 struct DiffContext {
   DiffIterate<>::Callback callback;
   void *callback_arg;
@@ -77,9 +83,6 @@ public:
   }
 
 protected:
-  typedef boost::tuple<uint64_t, size_t, bool> Diff;
-  typedef std::list<Diff> Diffs;
-
   void finish(int r) override {
     CephContext *cct = m_cct;
     if (r == 0 && m_snap_ret < 0) {
@@ -206,6 +209,56 @@ private:
   }
 };
 
+/**
+ * Extents known from the object map alone, reported in order with the
+ * list_snaps results.  Adjacent extents in the same state are merged.
+ */
+class C_DiffExtents : public Context {
+public:
+  C_DiffExtents(DiffContext &diff_context) : m_diff_context(diff_context) {
+  }
+
+  bool empty() const {
+    return m_diffs.empty();
+  }
+  size_t size() const {
+    return m_diffs.size();
+  }
+
+  void add(uint64_t offset, uint64_t length, bool exists) {
+    if (!m_diffs.empty()) {
+      Diff &last = m_diffs.back();
+      if (last.get<0>() + last.get<1>() == offset &&
+          last.get<2>() == exists) {
+        last.get<1>() += length;
+        return;
+      }
+    }
+    m_diffs.push_back(boost::make_tuple(offset, length, exists));
+  }
+
+  void send() {
+    C_OrderedThrottle *ctx = m_diff_context.throttle.start_op(this);
+    ctx->complete(0);
+  }
+
+protected:
+  void finish(int r) override {
+    for (auto &d : m_diffs) {
+      r = m_diff_context.callback(d.get<0>(), d.get<1>(), d.get<2>(),
+                                  m_diff_context.callback_arg);
+      if (r < 0) {
+        break;
+      }
+    }
+    m_diff_context.throttle.end_op(r);
+  }
+
+private:
+  DiffContext &m_diff_context;
+  Diffs m_diffs;
+};
+
 int simple_diff_cb(uint64_t off, size_t len, int exists, void *arg) {
   // it's possible for a discard to create a hole in the parent image -- ignore
   if (exists) {
@@ -290,7 +343,7 @@ int DiffIterate<I>::execute() {
   BitVector<2> object_diff_state;
   {
     RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
-    if (m_whole_object && (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
+    if ((m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
       r = diff_object_map(from_snap_id, end_snap_id, &object_diff_state);
       if (r < 0) {
         ldout(cct, 5) << "fast diff disabled" << dendl;
@@ -331,9 +384,15 @@ int DiffIterate<I>::execute() {
     }
   }
 
+  // unchanged objects can only be skipped if there is no parent data to
+  // report in their place
+  bool skip_unchanged = (m_whole_object || from_snap_id != 0 ||
+                         diff_context.parent_diff.empty());
+
   uint64_t period = m_image_ctx.get_stripe_period();
   uint64_t off = m_offset;
   uint64_t left = m_length;
+  C_DiffExtents *diff_extents = nullptr;
 
   while (left > 0) {
     uint64_t period_off = off - (off % period);
@@ -351,20 +410,41 @@ int DiffIterate<I>::execute() {
          p != object_extents.end(); ++p) {
       ldout(cct, 20) << "object " << p->first << dendl;
 
+      uint8_t diff_state = OBJECT_DIFF_STATE_UPDATED;
       if (fast_diff_enabled) {
-        const uint64_t object_no = p->second.front().objectno;
-        if (object_diff_state[object_no] != OBJECT_DIFF_STATE_NONE) {
-          bool updated = (object_diff_state[object_no] ==
-                            OBJECT_DIFF_STATE_UPDATED);
+        diff_state = object_diff_state[p->second.front().objectno];
+      }
+
+      if (fast_diff_enabled &&
+          ((diff_state == OBJECT_DIFF_STATE_NONE && skip_unchanged) ||
+           diff_state == OBJECT_DIFF_STATE_HOLE ||
+           (diff_state == OBJECT_DIFF_STATE_UPDATED && m_whole_object))) {
+        if (diff_state != OBJECT_DIFF_STATE_NONE) {
+          if (diff_extents == nullptr) {
+            diff_extents = new C_DiffExtents(diff_context);
+          }
+          bool updated = (diff_state == OBJECT_DIFF_STATE_UPDATED);
           for (std::vector<ObjectExtent>::iterator q = p->second.begin();
                q != p->second.end(); ++q) {
-            r = m_callback(off + q->offset, q->length, updated, m_callback_arg);
-            if (r < 0) {
+            diff_extents->add(off + q->offset, q->length, updated);
+          }
+          if (diff_extents->size() >= MAX_DIFF_EXTENTS) {
+            diff_extents->send();
+            diff_extents = nullptr;
+
+            if (diff_context.throttle.pending_error()) {
+              r = diff_context.throttle.wait_for_ret();
               return r;
             }
           }
         }
       } else {
+        // the object map doesn't tell which parts of the object changed
+        if (diff_extents != nullptr) {
+          diff_extents->send();
+          diff_extents = nullptr;
+        }
+
         C_DiffObject *diff_object = new C_DiffObject(m_image_ctx, head_ctx,
                                                      diff_context,
                                                      p->first.name, off,
@@ -382,6 +462,9 @@ int DiffIterate<I>::execute() {
     off += read_len;
   }
 
+  if (diff_extents != nullptr) {
+    diff_extents->send();
+  }
   r = diff_context.throttle.wait_for_ret();
   if (r < 0) {
     return r;
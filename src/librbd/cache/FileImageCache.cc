@@ -0,0 +1,466 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "FileImageCache.h"
+#include "include/buffer.h"
+#include "include/Context.h"
+#include "include/crc32c.h"
+#include "include/encoding.h"
+#include "include/rados.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "librbd/ImageCtx.h"
+#include <fcntl.h>
+#include <map>
+#include <set>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::FileImageCache: " << this << " " \
+                           <<  __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+namespace {
+
+const uint64_t INDEX_VALID = 1ULL << 63;
+
+} // anonymous namespace
+
+template <typename I>
+struct FileImageCache<I>::C_ReadRequest : public Context {
+  FileImageCache<I> *cache;
+  Extents image_extents;
+  bufferlist *bl;
+  int fadvise_flags;
+  Context *on_finish;
+
+  std::map<uint64_t, bufferlist> blocks;
+  std::set<uint64_t> miss_blocks;
+  bufferlist miss_bl;
+
+  C_ReadRequest(FileImageCache<I> *cache, Extents &&image_extents,
+                bufferlist *bl, int fadvise_flags, Context *on_finish)
+    : cache(cache), image_extents(std::move(image_extents)), bl(bl),
+      fadvise_flags(fadvise_flags), on_finish(on_finish) {
+  }
+
+  void finish(int r) override {
+    if (r < 0) {
+      on_finish->complete(r);
+      return;
+    }
+
+    CephContext *cct = cache->m_image_ctx.cct;
+    uint64_t expected = 0;
+    for (auto b : miss_blocks) {
+      expected += cache->get_block_length(b);
+    }
+    if (miss_bl.length() != expected) {
+      // should not happen, but don't cache (or return) misaligned data
+      lderr(cct) << "unexpected read length " << miss_bl.length()
+                 << " != " << expected << ", bypassing cache" << dendl;
+      cache->m_image_writeback.aio_read(std::move(image_extents), bl,
+                                        fadvise_flags, on_finish);
+      return;
+    }
+
+    uint64_t off = 0;
+    for (auto b : miss_blocks) {
+      uint64_t len = cache->get_block_length(b);
+      bufferlist &block_bl = blocks[b];
+      block_bl.substr_of(miss_bl, off, len);
+      off += len;
+      cache->write_block(b, block_bl);
+    }
+
+    uint64_t block_size = cache->m_block_size;
+    for (auto &extent : image_extents) {
+      uint64_t pos = extent.first;
+      uint64_t end = extent.first + extent.second;
+      while (pos < end) {
+        bufferlist &block_bl = blocks[pos / block_size];
+        uint64_t block_off = pos % block_size;
+        uint64_t len = MIN(end - pos, block_bl.length() - block_off);
+        bufferlist sub;
+        sub.substr_of(block_bl, block_off, len);
+        bl->claim_append(sub);
+        pos += len;
+      }
+    }
+    on_finish->complete(0);
+  }
+};
+
+template <typename I>
+FileImageCache<I>::FileImageCache(I &image_ctx)
+  : m_image_ctx(image_ctx), m_image_writeback(image_ctx),
+    m_block_size(image_ctx.cct->_conf->template get_val<uint64_t>(
+      "rbd_persistent_cache_block_size")),
+    m_max_blocks(image_ctx.cct->_conf->template get_val<uint64_t>(
+      "rbd_persistent_cache_size") / m_block_size),
+    m_lock("librbd::cache::FileImageCache::m_lock"),
+    m_snap_id(CEPH_NOSNAP) {
+}
+
+template <typename I>
+FileImageCache<I>::~FileImageCache() {
+  assert(m_fd < 0);
+}
+
+template <typename I>
+bool FileImageCache<I>::open_file() {
+  CephContext *cct = m_image_ctx.cct;
+
+  Mutex::Locker locker(m_lock);
+  {
+    RWLock::RLocker snap_locker(m_image_ctx.snap_lock);
+    if (m_fd >= 0) {
+      // the handle may have been switched to another snapshot since
+      return m_image_ctx.snap_id == m_snap_id;
+    }
+    if (m_disabled || m_image_ctx.snap_id == CEPH_NOSNAP) {
+      return false;
+    }
+    m_snap_id = m_image_ctx.snap_id;
+    m_size = m_image_ctx.get_image_size(m_snap_id);
+  }
+
+  std::string dir = cct->_conf->template get_val<std::string>(
+    "rbd_persistent_cache_path");
+  char name[64];
+  snprintf(name, sizeof(name), "/%lld.", (long long)m_image_ctx.data_ctx.get_id());
+  m_path = dir + name + m_image_ctx.id;
+  snprintf(name, sizeof(name), ".%llx.%llu", (unsigned long long)m_snap_id,
+           (unsigned long long)m_block_size);
+  m_path += name;
+
+  uint64_t num_blocks = (m_size + m_block_size - 1) / m_block_size;
+  m_data_offset = ROUND_UP_TO(num_blocks * sizeof(uint64_t), m_block_size);
+
+  int fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    m_disabled = true;
+    return false;
+  }
+
+  // other processes may be sizing the same file; only ever grow it
+  struct stat st;
+  int r = ::fstat(fd, &st);
+  if (r == 0 && (uint64_t)st.st_size < m_data_offset + m_size) {
+    r = ::ftruncate(fd, m_data_offset + m_size);
+  }
+  if (r < 0) {
+    r = -errno;
+    lderr(cct) << "failed to size " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    VOID_TEMP_FAILURE_RETRY(::close(fd));
+    m_disabled = true;
+    return false;
+  }
+
+  ldout(cct, 5) << "caching snap " << m_snap_id << " in " << m_path << dendl;
+  m_fd = fd;
+  if (m_max_blocks > 0) {
+    load_index(num_blocks);
+  }
+  return true;
+}
+
+template <typename I>
+void FileImageCache<I>::load_index(uint64_t num_blocks) {
+  assert(m_lock.is_locked());
+
+  // blocks filled by earlier openers count against the limit too; their
+  // order is unknown, so they go first in block order
+  const uint64_t batch = 8192;
+  std::vector<ceph_le64> entries(batch);
+  for (uint64_t b = 0; b < num_blocks; b += batch) {
+    uint64_t n = MIN(batch, num_blocks - b);
+    if (safe_pread_exact(m_fd, &entries[0], n * sizeof(ceph_le64),
+                         b * sizeof(ceph_le64)) < 0) {
+      break;
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+      if (entries[i] & INDEX_VALID) {
+        m_lru_blocks[b + i] = m_lru.insert(m_lru.end(), b + i);
+      }
+    }
+  }
+  while (m_lru.size() > m_max_blocks) {
+    evict_block();
+  }
+  ldout(m_image_ctx.cct, 10) << m_lru.size() << " blocks cached" << dendl;
+}
+
+template <typename I>
+void FileImageCache<I>::touch_block(uint64_t block) {
+  Mutex::Locker locker(m_lock);
+  auto it = m_lru_blocks.find(block);
+  if (it != m_lru_blocks.end()) {
+    m_lru.splice(m_lru.end(), m_lru, it->second);
+    return;
+  }
+  while (m_lru.size() >= m_max_blocks) {
+    evict_block();
+  }
+  m_lru_blocks[block] = m_lru.insert(m_lru.end(), block);
+}
+
+template <typename I>
+void FileImageCache<I>::evict_block() {
+  assert(m_lock.is_locked());
+  CephContext *cct = m_image_ctx.cct;
+
+  uint64_t block = m_lru.front();
+  m_lru.pop_front();
+  m_lru_blocks.erase(block);
+  ldout(cct, 20) << "block=" << block << dendl;
+
+  // clear the index entry first so that no reader trusts the data
+  // while it goes away
+  ceph_le64 entry;
+  entry = 0;
+  int r = safe_pwrite(m_fd, &entry, sizeof(entry), block * sizeof(entry));
+#ifdef FALLOC_FL_PUNCH_HOLE
+  if (r == 0 &&
+      ::fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  m_data_offset + block * m_block_size,
+                  get_block_length(block)) < 0) {
+    r = -errno;
+  }
+#endif
+  if (r < 0) {
+    ldout(cct, 5) << "failed to evict block " << block << ": "
+                  << cpp_strerror(r) << dendl;
+  }
+}
+
+template <typename I>
+uint64_t FileImageCache<I>::get_block_length(uint64_t block) const {
+  return MIN(m_block_size, m_size - block * m_block_size);
+}
+
+template <typename I>
+bool FileImageCache<I>::read_block(uint64_t block, bufferlist *bl) {
+  ceph_le64 entry;
+  if (safe_pread_exact(m_fd, &entry, sizeof(entry),
+                       block * sizeof(entry)) < 0 ||
+      (entry & INDEX_VALID) == 0) {
+    return false;
+  }
+
+  uint64_t len = get_block_length(block);
+  bufferptr bp = buffer::create(len);
+  if (safe_pread_exact(m_fd, bp.c_str(), len,
+                       m_data_offset + block * m_block_size) < 0 ||
+      ceph_crc32c(0, (const unsigned char *)bp.c_str(), len) !=
+        (uint32_t)entry) {
+    return false;
+  }
+  bl->push_back(std::move(bp));
+  if (m_max_blocks > 0) {
+    touch_block(block);
+  }
+  return true;
+}
+
+template <typename I>
+void FileImageCache<I>::write_block(uint64_t block, const bufferlist &bl) {
+  CephContext *cct = m_image_ctx.cct;
+
+  if (m_max_blocks > 0) {
+    touch_block(block);
+  }
+
+  // write the data first so that a reader can't pick up the index
+  // entry for data that isn't there yet; the crc catches the rest
+  ceph_le64 entry;
+  entry = INDEX_VALID | bl.crc32c(0);
+  int r = bl.write_fd(m_fd, m_data_offset + block * m_block_size);
+  if (r == 0) {
+    r = safe_pwrite(m_fd, &entry, sizeof(entry), block * sizeof(entry));
+  }
+  if (r < 0) {
+    ldout(cct, 5) << "failed to cache block " << block << ": "
+                  << cpp_strerror(r) << dendl;
+  }
+}
+
+template <typename I>
+void FileImageCache<I>::aio_read(Extents &&image_extents, bufferlist *bl,
+                                 int fadvise_flags, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  if (!open_file()) {
+    m_image_writeback.aio_read(std::move(image_extents), bl, fadvise_flags,
+                               on_finish);
+    return;
+  }
+
+  auto req = new C_ReadRequest(this, std::move(image_extents), bl,
+                               fadvise_flags, on_finish);
+  for (auto &extent : req->image_extents) {
+    if (extent.second == 0) {
+      continue;
+    }
+    uint64_t last = (extent.first + extent.second - 1) / m_block_size;
+    for (uint64_t b = extent.first / m_block_size; b <= last; ++b) {
+      if (req->blocks.count(b) || req->miss_blocks.count(b)) {
+        continue;
+      }
+      bufferlist block_bl;
+      if (read_block(b, &block_bl)) {
+        req->blocks[b].claim(block_bl);
+      } else {
+        req->miss_blocks.insert(b);
+      }
+    }
+  }
+
+  ldout(cct, 20) << req->blocks.size() << " hits, "
+                 << req->miss_blocks.size() << " misses" << dendl;
+  if (req->miss_blocks.empty()) {
+    req->complete(0);
+    return;
+  }
+
+  // fetch whole blocks, merging neighbours into one extent
+  Extents miss_extents;
+  for (auto b : req->miss_blocks) {
+    uint64_t off = b * m_block_size;
+    uint64_t len = get_block_length(b);
+    if (!miss_extents.empty() &&
+        miss_extents.back().first + miss_extents.back().second == off) {
+      miss_extents.back().second += len;
+    } else {
+      miss_extents.push_back({off, len});
+    }
+  }
+  m_image_writeback.aio_read(std::move(miss_extents), &req->miss_bl,
+                             fadvise_flags, req);
+}
+
+template <typename I>
+void FileImageCache<I>::aio_write(Extents &&image_extents,
+                                  bufferlist&& bl,
+                                  int fadvise_flags,
+                                  Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  // only the snapshot is cached, which writes never touch
+  m_image_writeback.aio_write(std::move(image_extents), std::move(bl),
+                              fadvise_flags, on_finish);
+}
+
+template <typename I>
+void FileImageCache<I>::aio_discard(uint64_t offset, uint64_t length,
+                                    bool skip_partial_discard,
+                                    Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  m_image_writeback.aio_discard(offset, length, skip_partial_discard,
+                                on_finish);
+}
+
+template <typename I>
+void FileImageCache<I>::aio_flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "on_finish=" << on_finish << dendl;
+
+  m_image_writeback.aio_flush(on_finish);
+}
+
+template <typename I>
+void FileImageCache<I>::aio_writesame(uint64_t offset, uint64_t length,
+                                      bufferlist&& bl, int fadvise_flags,
+                                      Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "data_len=" << bl.length() << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  m_image_writeback.aio_writesame(offset, length, std::move(bl), fadvise_flags,
+                                  on_finish);
+}
+
+template <typename I>
+void FileImageCache<I>::aio_compare_and_write(Extents &&image_extents,
+                                              bufferlist&& cmp_bl,
+                                              bufferlist&& bl,
+                                              uint64_t *mismatch_offset,
+                                              int fadvise_flags,
+                                              Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  m_image_writeback.aio_compare_and_write(
+    std::move(image_extents), std::move(cmp_bl), std::move(bl), mismatch_offset,
+    fadvise_flags, on_finish);
+}
+
+template <typename I>
+void FileImageCache<I>::init(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // the file is opened on first read, once the snapshot is known
+  on_finish->complete(0);
+}
+
+template <typename I>
+void FileImageCache<I>::shut_down(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  {
+    Mutex::Locker locker(m_lock);
+    if (m_fd >= 0) {
+      VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+      m_fd = -1;
+    }
+  }
+  on_finish->complete(0);
+}
+
+template <typename I>
+void FileImageCache<I>::invalidate(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // snapshot contents are immutable, so there is nothing to invalidate
+  on_finish->complete(0);
+}
+
+template <typename I>
+void FileImageCache<I>::flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // nothing dirty is ever held here.  ImageCtx::flush() gets here via
+  // C_FlushImageCache, so flushing the writeback (which itself calls
+  // ImageCtx::flush()) would never complete
+  on_finish->complete(0);
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::FileImageCache<librbd::ImageCtx>;
@@ -0,0 +1,100 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_FILE_IMAGE_CACHE
+#define CEPH_LIBRBD_CACHE_FILE_IMAGE_CACHE
+
+#include "ImageCache.h"
+#include "ImageWriteback.h"
+#include "common/Mutex.h"
+#include <list>
+#include <map>
+#include <string>
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+/**
+ * Persistent read cache for read-only snapshots (e.g. clone parents),
+ * kept in a local file under rbd_persistent_cache_path.
+ *
+ * Snapshot contents never change, so the file is keyed by pool, image id
+ * and snap id and can be shared by every process on the host that opens
+ * the same snapshot.  The file starts with an index of one 64-bit entry
+ * per rbd_persistent_cache_block_size block (valid bit + crc32c of the
+ * block), followed by the block data.  A block is only served if its
+ * contents match the indexed crc, so concurrent fillers and torn writes
+ * after a crash simply show up as misses.  Anything that is not a read of
+ * the snapshot the file was opened for passes straight through.
+ *
+ * At most rbd_persistent_cache_size bytes of blocks are kept: blocks
+ * found valid when the file is opened and those filled since are tracked
+ * in LRU order, and the least recently used one is dropped (index entry
+ * cleared, then its data punched out) to make room for a new one.
+ */
+template <typename ImageCtxT = librbd::ImageCtx>
+class FileImageCache : public ImageCache {
+public:
+  FileImageCache(ImageCtxT &image_ctx);
+  ~FileImageCache() override;
+
+  /// client AIO methods
+  void aio_read(Extents&& image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) override;
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) override;
+  void aio_discard(uint64_t offset, uint64_t length,
+                   bool skip_partial_discard, Context *on_finish) override;
+  void aio_flush(Context *on_finish) override;
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) override;
+  void aio_compare_and_write(Extents&& image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,int fadvise_flags,
+                             Context *on_finish) override;
+
+  /// internal state methods
+  void init(Context *on_finish) override;
+  void shut_down(Context *on_finish) override;
+
+  void invalidate(Context *on_finish) override;
+  void flush(Context *on_finish) override;
+
+private:
+  struct C_ReadRequest;
+
+  ImageCtxT &m_image_ctx;
+  ImageWriteback<ImageCtxT> m_image_writeback;
+  std::string m_path;
+  uint64_t m_block_size;
+  uint64_t m_max_blocks;     ///< 0 for no limit
+
+  Mutex m_lock;              ///< protects opening/closing m_fd and the LRU
+  int m_fd = -1;
+  bool m_disabled = false;   ///< failed to open the file, don't retry
+  uint64_t m_snap_id;        ///< snapshot the file was opened for
+  uint64_t m_size = 0;       ///< image size at m_snap_id
+  uint64_t m_data_offset = 0;
+
+  std::list<uint64_t> m_lru;  ///< cached blocks, least recently used first
+  std::map<uint64_t, std::list<uint64_t>::iterator> m_lru_blocks;
+
+  bool open_file();
+  void load_index(uint64_t num_blocks);
+  void touch_block(uint64_t block);
+  void evict_block();
+  uint64_t get_block_length(uint64_t block) const;
+  bool read_block(uint64_t block, ceph::bufferlist *bl);
+  void write_block(uint64_t block, const ceph::bufferlist &bl);
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::FileImageCache<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_FILE_IMAGE_CACHE
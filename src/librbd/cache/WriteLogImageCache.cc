@@ -0,0 +1,755 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "WriteLogImageCache.h"
+#include "include/Context.h"
+#include "include/crc32c.h"
+#include "include/intarith.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+#include "common/WorkQueue.h"
+#include "librbd/ExclusiveLock.h"
+#include "librbd/ImageCtx.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::WriteLogImageCache: " << this << " " \
+                           <<  __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+namespace {
+
+const uint64_t SUPERBLOCK_MAGIC = 0x726264776c6f6701ULL;
+const uint64_t RECORD_MAGIC = 0x726264776c726563ULL;
+
+/// records are aligned to this, and the first block holds the superblock
+const uint64_t LOG_ALIGN = 4096;
+const uint64_t LOG_START = LOG_ALIGN;
+
+struct superblock_t {
+  ceph_le64 magic;
+  ceph_le64 tail_seq;     ///< seq of the record at tail_offset
+  ceph_le64 tail_offset;
+  ceph_le32 crc;
+} __attribute__ ((packed));
+
+struct record_header_t {
+  ceph_le64 magic;
+  ceph_le64 seq;
+  ceph_le64 image_offset;
+  ceph_le32 length;
+  ceph_le32 crc;          ///< of the header up to here, then the data
+} __attribute__ ((packed));
+
+} // anonymous namespace
+
+template <typename I>
+struct WriteLogImageCache<I>::C_ReadRequest : public Context {
+  Extents image_extents;
+  std::list<LogEntry> overlays;   ///< in log order
+  bufferlist *bl;
+  Context *on_finish;
+  bufferlist read_bl;
+
+  C_ReadRequest(const Extents &image_extents, bufferlist *bl,
+                Context *on_finish)
+    : image_extents(image_extents), bl(bl), on_finish(on_finish) {
+  }
+
+  void finish(int r) override {
+    if (r < 0) {
+      on_finish->complete(r);
+      return;
+    }
+
+    uint64_t length = 0;
+    for (auto &extent : image_extents) {
+      length += extent.second;
+    }
+    bufferptr bp = buffer::create(length);
+    uint64_t read_len = MIN(length, (uint64_t)read_bl.length());
+    read_bl.copy(0, read_len, bp.c_str());
+    if (read_len < length) {
+      bp.zero(read_len, length - read_len);
+    }
+
+    // later records win, so apply them in log order
+    for (auto &entry : overlays) {
+      uint64_t entry_end = entry.image_offset + entry.bl.length();
+      uint64_t buffer_offset = 0;
+      for (auto &extent : image_extents) {
+        uint64_t start = MAX(extent.first, entry.image_offset);
+        uint64_t end = MIN(extent.first + extent.second, entry_end);
+        if (start < end) {
+          entry.bl.copy(start - entry.image_offset, end - start,
+                        bp.c_str() + buffer_offset + (start - extent.first));
+        }
+        buffer_offset += extent.second;
+      }
+    }
+
+    bl->push_back(std::move(bp));
+    on_finish->complete(0);
+  }
+};
+
+template <typename I>
+WriteLogImageCache<I>::WriteLogImageCache(ImageCtx &image_ctx)
+  : m_image_ctx(image_ctx), m_image_writeback(image_ctx),
+    m_log_size(image_ctx.cct->_conf->template get_val<uint64_t>(
+      "rbd_write_log_size")),
+    m_lock("librbd::cache::WriteLogImageCache::m_lock"),
+    m_head(LOG_START),
+    m_writeback_lock("librbd::cache::WriteLogImageCache::m_writeback_lock") {
+}
+
+template <typename I>
+WriteLogImageCache<I>::~WriteLogImageCache() {
+  if (m_fd >= 0) {
+    VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+  }
+}
+
+template <typename I>
+int WriteLogImageCache<I>::open_log() {
+  CephContext *cct = m_image_ctx.cct;
+
+  std::string dir = cct->_conf->template get_val<std::string>(
+    "rbd_write_log_path");
+  char name[32];
+  snprintf(name, sizeof(name), "/%lld.",
+           (long long)m_image_ctx.data_ctx.get_id());
+  m_path = dir + name + m_image_ctx.id + ".wlog";
+
+  m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (m_fd < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    return r;
+  }
+  return 0;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::write_superblock() {
+  assert(m_lock.is_locked());
+
+  superblock_t sb;
+  sb.magic = SUPERBLOCK_MAGIC;
+  sb.tail_seq = m_next_seq;
+  sb.tail_offset = m_head;
+  sb.crc = ceph_crc32c(0, (const unsigned char *)&sb,
+                       offsetof(superblock_t, crc));
+  int r = safe_pwrite(m_fd, &sb, sizeof(sb), 0);
+  if (r == 0 && ::fdatasync(m_fd) < 0) {
+    r = -errno;
+  }
+  return r;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::replay_log() {
+  CephContext *cct = m_image_ctx.cct;
+  Mutex::Locker locker(m_lock);
+
+  superblock_t sb;
+  int r = safe_pread(m_fd, &sb, sizeof(sb), 0);
+  if (r < 0) {
+    return r;
+  }
+  if ((size_t)r < sizeof(sb) || sb.magic != SUPERBLOCK_MAGIC ||
+      sb.crc != ceph_crc32c(0, (const unsigned char *)&sb,
+                            offsetof(superblock_t, crc))) {
+    ldout(cct, 5) << "initializing " << m_path << dendl;
+    m_head = LOG_START;
+    return write_superblock();
+  }
+
+  m_next_seq = sb.tail_seq;
+  m_writeback_seq = m_next_seq;
+  m_head = sb.tail_offset;
+  while (true) {
+    record_header_t h;
+    if (safe_pread_exact(m_fd, &h, sizeof(h), m_head) < 0 ||
+        h.magic != RECORD_MAGIC || h.seq != m_next_seq ||
+        m_head + ROUND_UP_TO(sizeof(h) + h.length, LOG_ALIGN) > m_log_size) {
+      break;
+    }
+    bufferptr bp = buffer::create(h.length);
+    if (safe_pread_exact(m_fd, bp.c_str(), h.length,
+                         m_head + sizeof(h)) < 0) {
+      break;
+    }
+    uint32_t crc = ceph_crc32c(0, (const unsigned char *)&h,
+                               offsetof(record_header_t, crc));
+    if (ceph_crc32c(crc, (const unsigned char *)bp.c_str(), h.length) !=
+          h.crc) {
+      break;
+    }
+
+    LogEntry &entry = m_entries[m_next_seq];
+    entry.image_offset = h.image_offset;
+    entry.bl.push_back(std::move(bp));
+    m_head += ROUND_UP_TO(sizeof(h) + h.length, LOG_ALIGN);
+    ++m_next_seq;
+  }
+
+  ldout(cct, 5) << "replayed " << m_entries.size() << " records from "
+                << m_path << dendl;
+  return 0;
+}
+
+template <typename I>
+uint64_t WriteLogImageCache<I>::get_record_length(
+    const Extents &image_extents) const {
+  uint64_t length = 0;
+  for (auto &extent : image_extents) {
+    length += ROUND_UP_TO(sizeof(record_header_t) + extent.second, LOG_ALIGN);
+  }
+  return length;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::reserve(const Extents &image_extents,
+                                   const bufferlist &bl, Context *on_finish,
+                                   uint64_t *seq, uint64_t *offset,
+                                   bufferlist *records) {
+  assert(m_lock.is_locked());
+
+  uint64_t length = get_record_length(image_extents);
+  if (m_head + length > m_log_size) {
+    return -ENOSPC;
+  }
+
+  *seq = m_next_seq;
+  *offset = m_head;
+  uint64_t bl_offset = 0;
+  for (auto &extent : image_extents) {
+    bufferlist data;
+    data.substr_of(bl, bl_offset, extent.second);
+    bl_offset += extent.second;
+
+    record_header_t h;
+    h.magic = RECORD_MAGIC;
+    h.seq = m_next_seq++;
+    h.image_offset = extent.first;
+    h.length = extent.second;
+    h.crc = data.crc32c(
+      ceph_crc32c(0, (const unsigned char *)&h,
+                  offsetof(record_header_t, crc)));
+    records->append((const char *)&h, sizeof(h));
+    records->append(data);
+    records->append_zero(ROUND_UP_TO(sizeof(h) + extent.second, LOG_ALIGN) -
+                         sizeof(h) - extent.second);
+  }
+  m_head += length;
+
+  Append &append = m_appends[*seq];
+  append.image_extents = image_extents;
+  append.bl = bl;
+  append.on_finish = on_finish;
+  return 0;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::write_records(uint64_t seq, uint64_t offset,
+                                          bufferlist &records) {
+  assert(!m_lock.is_locked_by_me());
+
+  int r = records.write_fd(m_fd, offset);
+  if (r == 0 && ::fdatasync(m_fd) < 0) {
+    r = -errno;
+  }
+  if (r < 0) {
+    lderr(m_image_ctx.cct) << "failed to append to " << m_path << ": "
+                           << cpp_strerror(r) << dendl;
+  }
+
+  Mutex::Locker locker(m_lock);
+  Append &append = m_appends[seq];
+  append.done = true;
+  append.r = r;
+  complete_appends();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::complete_appends() {
+  assert(m_lock.is_locked());
+
+  bool logged = false;
+  auto pos = m_deferred.begin();
+  while (!m_appends.empty() && m_appends.begin()->second.done) {
+    auto it = m_appends.begin();
+    uint64_t seq = it->first;
+    Append &append = it->second;
+    if (append.r < 0 && m_log_error == 0) {
+      m_log_error = append.r;
+    }
+
+    if (m_log_error < 0) {
+      // replay would stop at the failed record: write this one through
+      ldout(m_image_ctx.cct, 5) << "writing through seq=" << seq << dendl;
+      DeferredOp op;
+      op.image_extents = std::move(append.image_extents);
+      op.bl = std::move(append.bl);
+      op.on_finish = append.on_finish;
+      m_deferred.insert(pos, std::move(op));
+    } else {
+      uint64_t bl_offset = 0;
+      for (auto &extent : append.image_extents) {
+        LogEntry &entry = m_entries[seq++];
+        entry.image_offset = extent.first;
+        entry.bl.substr_of(append.bl, bl_offset, extent.second);
+        bl_offset += extent.second;
+      }
+      m_image_ctx.op_work_queue->queue(append.on_finish, 0);
+      logged = true;
+    }
+    m_appends.erase(it);
+  }
+
+  if (logged) {
+    queue_writeback();
+  }
+  if (m_appends.empty()) {
+    dispatch_deferred();
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::queue_writeback() {
+  assert(m_lock.is_locked());
+  if (m_writeback_queued) {
+    return;
+  }
+  m_writeback_queued = true;
+  m_image_ctx.op_work_queue->queue(new FunctionContext([this](int r) {
+      writeback_entries();
+    }), 0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::writeback_entries() {
+  CephContext *cct = m_image_ctx.cct;
+
+  RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
+  bool lock_owner = (m_image_ctx.exclusive_lock == nullptr ||
+                     m_image_ctx.exclusive_lock->is_lock_owner());
+
+  // issue in log order; RADOS keeps the order per object from here on
+  Mutex::Locker writeback_locker(m_writeback_lock);
+  std::map<uint64_t, LogEntry> entries;
+  {
+    Mutex::Locker locker(m_lock);
+    m_writeback_queued = false;
+    if (!lock_owner) {
+      // replayed records wait for this client to acquire the lock
+      if (!m_entries.empty()) {
+        ldout(cct, 5) << "not lock owner, keeping " << m_entries.size()
+                      << " records in the log" << dendl;
+      }
+      complete_flush_waiters();
+      return;
+    }
+    entries.insert(m_entries.lower_bound(m_writeback_seq), m_entries.end());
+    m_writeback_seq = m_next_seq;
+  }
+
+  for (auto &it : entries) {
+    uint64_t seq = it.first;
+    LogEntry &entry = it.second;
+    ldout(cct, 20) << "seq=" << seq << ", "
+                   << "image_offset=" << entry.image_offset << ", "
+                   << "length=" << entry.bl.length() << dendl;
+
+    Context *ctx = new FunctionContext([this, seq](int r) {
+        m_image_ctx.op_work_queue->queue(new FunctionContext(
+          [this, seq](int r) {
+            handle_writeback(seq, r);
+          }), r);
+      });
+    uint64_t length = entry.bl.length();
+    m_image_writeback.aio_write({{entry.image_offset, length}},
+                                std::move(entry.bl), 0, ctx);
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::handle_writeback(uint64_t seq, int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "seq=" << seq << ", r=" << r << dendl;
+
+  Mutex::Locker locker(m_lock);
+  if (r < 0) {
+    lderr(cct) << "failed to write back record " << seq << ": "
+               << cpp_strerror(r) << dendl;
+    m_writeback_error = r;
+  }
+  m_entries.erase(seq);
+  if (m_entries.empty()) {
+    dispatch_deferred();
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::maybe_drain() {
+  assert(m_lock.is_locked());
+  if (m_draining || !m_entries.empty() || !m_appends.empty()) {
+    return;
+  }
+  if (m_head == LOG_START) {
+    complete_flush_waiters();
+    return;
+  }
+  if (m_flush_waiters.empty() && m_deferred.empty() &&
+      m_head - LOG_START < m_log_size / 2) {
+    return;
+  }
+
+  // everything logged has been written back, but it may still be in
+  // the object cacher: flush that before forgetting the records
+  ldout(m_image_ctx.cct, 10) << dendl;
+  m_draining = true;
+  m_image_ctx.op_work_queue->queue(new FunctionContext([this](int r) {
+      Context *ctx = new FunctionContext([this](int r) {
+          m_image_ctx.op_work_queue->queue(new FunctionContext(
+            [this](int r) {
+              handle_drained(r);
+            }), r);
+        });
+      if (m_image_ctx.object_cacher != nullptr) {
+        m_image_ctx.flush_cache(ctx);
+      } else {
+        ctx->complete(0);
+      }
+    }), 0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::handle_drained(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  Mutex::Locker locker(m_lock);
+  m_draining = false;
+  if (r < 0) {
+    lderr(cct) << "failed to flush written back records: " << cpp_strerror(r)
+               << dendl;
+    m_writeback_error = r;
+    complete_flush_waiters();
+  } else if (m_entries.empty() && m_appends.empty()) {
+    m_head = LOG_START;
+    m_log_error = 0;
+    r = write_superblock();
+    if (r < 0) {
+      lderr(cct) << "failed to reset " << m_path << ": " << cpp_strerror(r)
+                 << dendl;
+      m_writeback_error = r;
+    }
+    complete_flush_waiters();
+  }
+  dispatch_deferred();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::complete_flush_waiters() {
+  assert(m_lock.is_locked());
+  if (m_flush_waiters.empty()) {
+    return;
+  }
+  int r = m_writeback_error;
+  m_writeback_error = 0;
+  for (auto ctx : m_flush_waiters) {
+    m_image_ctx.op_work_queue->queue(ctx, r);
+  }
+  m_flush_waiters.clear();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::dispatch_deferred() {
+  assert(m_lock.is_locked());
+  if (m_dispatching) {
+    // the running loop looks again once it retakes m_lock
+    return;
+  }
+  m_dispatching = true;
+
+  while (!m_deferred.empty()) {
+    DeferredOp &op = m_deferred.front();
+    bool drained = m_entries.empty() && m_appends.empty();
+    if (op.op != nullptr) {
+      if (!drained) {
+        break;
+      }
+      Context *ctx = op.op;
+      m_deferred.pop_front();
+      m_lock.Unlock();
+      ctx->complete(0);
+      m_lock.Lock();
+      continue;
+    }
+
+    if (m_log_error < 0) {
+      // write through, after everything logged before it
+      if (!drained) {
+        break;
+      }
+      Extents image_extents = std::move(op.image_extents);
+      bufferlist bl = std::move(op.bl);
+      Context *on_finish = op.on_finish;
+      m_deferred.pop_front();
+      m_lock.Unlock();
+      m_image_writeback.aio_write(std::move(image_extents), std::move(bl), 0,
+                                  on_finish);
+      m_lock.Lock();
+      continue;
+    }
+
+    uint64_t seq;
+    uint64_t offset;
+    bufferlist records;
+    int r = reserve(op.image_extents, op.bl, op.on_finish, &seq, &offset,
+                    &records);
+    if (r == -ENOSPC) {
+      break;
+    }
+    m_deferred.pop_front();
+    m_lock.Unlock();
+    write_records(seq, offset, records);
+    m_lock.Lock();
+  }
+
+  m_dispatching = false;
+  maybe_drain();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::defer_op(Context *op) {
+  assert(m_lock.is_locked());
+  DeferredOp deferred;
+  deferred.op = op;
+  m_deferred.push_back(std::move(deferred));
+  queue_writeback();
+  dispatch_deferred();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_read(Extents &&image_extents, bufferlist *bl,
+                                     int fadvise_flags, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  C_ReadRequest *req = nullptr;
+  {
+    Mutex::Locker locker(m_lock);
+    for (auto &it : m_entries) {
+      const LogEntry &entry = it.second;
+      uint64_t entry_end = entry.image_offset + entry.bl.length();
+      for (auto &extent : image_extents) {
+        if (extent.first < entry_end &&
+            entry.image_offset < extent.first + extent.second) {
+          if (req == nullptr) {
+            req = new C_ReadRequest(image_extents, bl, on_finish);
+          }
+          req->overlays.push_back(entry);
+          break;
+        }
+      }
+    }
+  }
+
+  if (req == nullptr) {
+    m_image_writeback.aio_read(std::move(image_extents), bl, fadvise_flags,
+                               on_finish);
+    return;
+  }
+
+  ldout(cct, 20) << "overlaying " << req->overlays.size() << " records"
+                 << dendl;
+  m_image_writeback.aio_read(std::move(image_extents), &req->read_bl,
+                             fadvise_flags, req);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_write(Extents &&image_extents,
+                                      bufferlist&& bl,
+                                      int fadvise_flags,
+                                      Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  uint64_t seq;
+  uint64_t offset;
+  bufferlist records;
+  {
+    Mutex::Locker locker(m_lock);
+    if (get_record_length(image_extents) > m_log_size - LOG_START) {
+      // can never fit in the log: write it through once drained
+      defer_op(new FunctionContext(
+        [this, image_extents, bl, fadvise_flags, on_finish](int r) mutable {
+          m_image_writeback.aio_write(std::move(image_extents),
+                                      std::move(bl), fadvise_flags,
+                                      on_finish);
+        }));
+      return;
+    }
+
+    int r = -ENOSPC;
+    if (m_deferred.empty() && m_log_error == 0) {
+      r = reserve(image_extents, bl, on_finish, &seq, &offset, &records);
+    }
+    if (r == -ENOSPC) {
+      // stays ordered behind anything already waiting
+      DeferredOp op;
+      op.image_extents = std::move(image_extents);
+      op.bl = std::move(bl);
+      op.on_finish = on_finish;
+      m_deferred.push_back(std::move(op));
+      queue_writeback();
+      dispatch_deferred();
+      return;
+    }
+  }
+
+  // acknowledged by complete_appends() once stable
+  write_records(seq, offset, records);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_discard(uint64_t offset, uint64_t length,
+                                        bool skip_partial_discard,
+                                        Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  Mutex::Locker locker(m_lock);
+  defer_op(new FunctionContext(
+    [this, offset, length, skip_partial_discard, on_finish](int r) {
+      m_image_writeback.aio_discard(offset, length, skip_partial_discard,
+                                    on_finish);
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "on_finish=" << on_finish << dendl;
+
+  // completed writes are already stable in the log
+  int r;
+  {
+    Mutex::Locker locker(m_lock);
+    r = m_writeback_error;
+    m_writeback_error = 0;
+  }
+  on_finish->complete(r);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_writesame(uint64_t offset, uint64_t length,
+                                          bufferlist&& bl, int fadvise_flags,
+                                          Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "data_len=" << bl.length() << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  Mutex::Locker locker(m_lock);
+  defer_op(new FunctionContext(
+    [this, offset, length, bl, fadvise_flags, on_finish](int r) mutable {
+      m_image_writeback.aio_writesame(offset, length, std::move(bl),
+                                      fadvise_flags, on_finish);
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_compare_and_write(Extents &&image_extents,
+                                                  bufferlist&& cmp_bl,
+                                                  bufferlist&& bl,
+                                                  uint64_t *mismatch_offset,
+                                                  int fadvise_flags,
+                                                  Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  Mutex::Locker locker(m_lock);
+  defer_op(new FunctionContext(
+    [this, image_extents, cmp_bl, bl, mismatch_offset, fadvise_flags,
+     on_finish](int r) mutable {
+      m_image_writeback.aio_compare_and_write(
+        std::move(image_extents), std::move(cmp_bl), std::move(bl),
+        mismatch_offset, fadvise_flags, on_finish);
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::init(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // replayed records are written back with the first write or flush,
+  // once the image is open and the lock is held
+  int r = open_log();
+  if (r == 0) {
+    r = replay_log();
+  }
+  on_finish->complete(r);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::shut_down(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  flush(new FunctionContext([this, on_finish](int r) {
+      {
+        Mutex::Locker locker(m_lock);
+        if (m_fd >= 0) {
+          VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+          m_fd = -1;
+        }
+      }
+      on_finish->complete(r);
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::invalidate(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // logged writes are acknowledged data, so write them back rather
+  // than dropping them
+  flush(on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // write back and reset the log so that nothing is replayed over
+  // writes made by the next lock owner
+  Mutex::Locker locker(m_lock);
+  m_flush_waiters.push_back(on_finish);
+  queue_writeback();
+  maybe_drain();
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::WriteLogImageCache<librbd::ImageCtx>;
@@ -0,0 +1,148 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
+#define CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
+
+#include "ImageCache.h"
+#include "ImageWriteback.h"
+#include "common/Mutex.h"
+#include "include/buffer.h"
+#include <list>
+#include <map>
+#include <string>
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+/**
+ * Write-back cache that persists writes to a local log file (on an SSD
+ * or pmem backed filesystem) under rbd_write_log_path and acknowledges
+ * them once the log record is stable, then writes them back to the
+ * image in log order in the background.
+ *
+ * Records still in the log when the image is opened again (after a
+ * crash) are replayed before anything else is written back, and reads
+ * overlapping records that have not been written back are patched with
+ * the logged data.  Discards, writesame and compare-and-write wait for
+ * the log to drain and then go straight to the image.  Once everything
+ * logged has been written back and flushed below, the log is reset to
+ * its start.
+ *
+ * Records are written and synced without m_lock held, so concurrent
+ * writes share the device; a write is acknowledged once it and every
+ * record before it are stable, so that replay never skips over a hole.
+ * If writing a record fails, it and any record after it are written
+ * through to the image instead, until the log is next reset.
+ *
+ * The log only lives on this host, so the image must be opened by a
+ * single writer (exclusive-lock); releasing the lock flushes the log.
+ */
+template <typename ImageCtxT = librbd::ImageCtx>
+class WriteLogImageCache : public ImageCache {
+public:
+  WriteLogImageCache(ImageCtx &image_ctx);
+  ~WriteLogImageCache() override;
+
+  /// client AIO methods
+  void aio_read(Extents&& image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) override;
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) override;
+  void aio_discard(uint64_t offset, uint64_t length,
+                   bool skip_partial_discard, Context *on_finish) override;
+  void aio_flush(Context *on_finish) override;
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) override;
+  void aio_compare_and_write(Extents&& image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,int fadvise_flags,
+                             Context *on_finish) override;
+
+  /// internal state methods
+  void init(Context *on_finish) override;
+  void shut_down(Context *on_finish) override;
+
+  void invalidate(Context *on_finish) override;
+  void flush(Context *on_finish) override;
+
+private:
+  struct C_ReadRequest;
+
+  struct LogEntry {
+    uint64_t image_offset;
+    ceph::bufferlist bl;
+  };
+
+  /// log space reserved for a write whose records are being written
+  struct Append {
+    Extents image_extents;
+    ceph::bufferlist bl;
+    Context *on_finish = nullptr;
+    bool done = false;
+    int r = 0;
+  };
+
+  /// a write waiting for log space, or an op waiting for the log to drain
+  struct DeferredOp {
+    Extents image_extents;
+    ceph::bufferlist bl;
+    Context *on_finish = nullptr;  ///< write: completed once logged
+    Context *op = nullptr;         ///< non-write: run once drained
+  };
+
+  ImageCtxT &m_image_ctx;
+  ImageWriteback<ImageCtxT> m_image_writeback;
+  std::string m_path;
+  uint64_t m_log_size;
+
+  Mutex m_lock;
+  int m_fd = -1;
+  uint64_t m_head;               ///< file offset of the next record
+  uint64_t m_next_seq = 1;
+  std::map<uint64_t, LogEntry> m_entries;  ///< logged, not yet written back
+  std::map<uint64_t, Append> m_appends;    ///< being logged, by first seq
+  int m_log_error = 0;           ///< an append failed: write through until reset
+  uint64_t m_writeback_seq = 0;  ///< entries below this have been issued
+  bool m_writeback_queued = false;
+  bool m_draining = false;       ///< flushing below before a log reset
+  bool m_dispatching = false;    ///< dispatch_deferred() is running
+  int m_writeback_error = 0;
+  std::list<DeferredOp> m_deferred;
+  std::list<Context*> m_flush_waiters;
+
+  /// serializes write back so that entries reach RADOS in log order
+  Mutex m_writeback_lock;
+
+  int open_log();
+  int replay_log();
+  int write_superblock();
+  uint64_t get_record_length(const Extents &image_extents) const;
+  int reserve(const Extents &image_extents, const ceph::bufferlist &bl,
+              Context *on_finish, uint64_t *seq, uint64_t *offset,
+              ceph::bufferlist *records);
+  void write_records(uint64_t seq, uint64_t offset,
+                     ceph::bufferlist &records);
+  void complete_appends();
+
+  void queue_writeback();
+  void writeback_entries();
+  void handle_writeback(uint64_t seq, int r);
+  void maybe_drain();
+  void handle_drained(int r);
+  void complete_flush_waiters();
+  void dispatch_deferred();
+
+  void defer_op(Context *op);
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::WriteLogImageCache<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
@@ -1906,7 +1906,7 @@ int validate_pool(IoCtx &io_ctx, CephContext *cct) {
     }
 
     ZTracer::Trace trace;
-    if (src->blkin_trace_all) {
+    if (src->blkin_trace_sampled()) {
       trace.init("copy", &src->trace_endpoint);
     }
 
@@ -2147,7 +2147,7 @@ int validate_pool(IoCtx &io_ctx, CephContext *cct) {
     uint64_t left = mylen;
 
     ZTracer::Trace trace;
-    if (ictx->blkin_trace_all) {
+    if (ictx->blkin_trace_sampled()) {
       trace.init("read_iterate", &ictx->trace_endpoint);
     }
 
@@ -6,6 +6,7 @@
 #include "common/dout.h"
 #include "common/errno.h"
 #include "common/Mutex.h"
+#include "common/WorkQueue.h"
 
 #include "librbd/AsyncObjectThrottle.h"
 #include "librbd/ExclusiveLock.h"
@@ -113,6 +114,10 @@ void CopyupRequest::complete_requests(int r) {
 }
 
 bool CopyupRequest::send_copyup() {
+  if (m_copy_from_parent) {
+    return send_copy_from_parent();
+  }
+
   bool add_copyup_op = !m_copyup_data.is_zero();
   bool copy_on_read = m_pending_requests.empty();
   if (!add_copyup_op && copy_on_read) {
@@ -190,6 +195,11 @@ bool CopyupRequest::send_copyup() {
 }
 
 bool CopyupRequest::is_copyup_required() {
+  if (m_copy_from_parent) {
+    // the parent data hasn't been looked at
+    return false;
+  }
+
   bool noop = true;
   for (const ObjectRequest<> *req : m_pending_requests) {
     if (!req->is_op_payload_empty()) {
@@ -201,7 +211,56 @@ bool CopyupRequest::is_copyup_required() {
   return (m_copyup_data.is_zero() && noop);
 }
 
+bool CopyupRequest::can_copy_from_parent() {
+  if (!m_ictx->server_side_copyup) {
+    return false;
+  }
+
+  RWLock::RLocker snap_locker(m_ictx->snap_lock);
+  RWLock::RLocker parent_locker(m_ictx->parent_lock);
+  ImageCtx *parent = m_ictx->parent;
+  if (parent == nullptr) {
+    return false;
+  }
+
+  // the child object must map onto the parent object of the same number
+  // and be covered by the parent overlap in full
+  const file_layout_t &layout = m_ictx->layout;
+  const file_layout_t &parent_layout = parent->layout;
+  if (layout.object_size != parent_layout.object_size ||
+      layout.stripe_unit != parent_layout.stripe_unit ||
+      layout.stripe_count != parent_layout.stripe_count ||
+      layout.stripe_count != 1) {
+    return false;
+  }
+
+  uint64_t object_size = m_ictx->get_object_size();
+  if (m_image_extents.size() != 1 ||
+      m_image_extents.front().first != m_object_no * object_size ||
+      m_image_extents.front().second != object_size) {
+    return false;
+  }
+
+  m_parent_oid = parent->get_object_name(m_object_no);
+  m_parent_data_ctx.dup(parent->data_ctx);
+  return true;
+}
+
 void CopyupRequest::send()
+{
+  if (can_copy_from_parent()) {
+    ldout(m_ictx->cct, 20) << "oid " << m_oid << ", copying from parent "
+                           << m_parent_oid << dendl;
+    m_copy_from_parent = true;
+    m_state = STATE_READ_FROM_PARENT;
+    m_ictx->op_work_queue->queue(util::create_context_callback(this), 0);
+    return;
+  }
+
+  send_read_from_parent();
+}
+
+void CopyupRequest::send_read_from_parent()
 {
   m_state = STATE_READ_FROM_PARENT;
   AioCompletion *comp = AioCompletion::create_and_start(
@@ -233,7 +292,9 @@ bool CopyupRequest::should_complete(int r)
   switch (m_state) {
   case STATE_READ_FROM_PARENT:
     ldout(cct, 20) << "READ_FROM_PARENT" << dendl;
-    remove_from_list();
+    if (!m_copy_from_parent && !m_removed_from_list) {
+      remove_from_list();
+    }
     if (r >= 0 || r == -ENOENT) {
       if (is_copyup_required()) {
         ldout(cct, 20) << "nop, skipping" << dendl;
@@ -269,6 +330,30 @@ bool CopyupRequest::should_complete(int r)
     }
     return (pending_copyups == 0);
 
+  case STATE_COPY_FROM_PARENT:
+    ldout(cct, 20) << "COPY_FROM_PARENT" << dendl;
+    // requests for this object keep joining until the copy is done
+    remove_from_list();
+    m_copy_from_parent = false;
+    if (r == -ENOENT) {
+      ldout(cct, 20) << "parent object doesn't exist, reading from parent"
+                     << dendl;
+      m_snap_ids.clear();
+      send_read_from_parent();
+      return false;
+    } else if (r < 0 && r != -EEXIST) {
+      lderr(cct) << "failed to copy from parent: " << cpp_strerror(r)
+                 << dendl;
+      return true;
+    }
+
+    // -EEXIST: another copyup got there first
+    if (m_pending_requests.empty()) {
+      return true;
+    }
+    send_pending_writes();
+    return false;
+
   default:
     lderr(cct) << "invalid state: " << m_state << dendl;
     assert(false);
@@ -277,9 +362,70 @@ bool CopyupRequest::should_complete(int r)
   return (r < 0);
 }
 
+bool CopyupRequest::send_copy_from_parent() {
+  ldout(m_ictx->cct, 20) << "oid " << m_oid << ", parent " << m_parent_oid
+                         << dendl;
+  m_state = STATE_COPY_FROM_PARENT;
+
+  // the exclusive create keeps a racing copyup from overwriting data
+  // written after this one completed; the empty snapshot context makes
+  // the copied data visible to all snapshots, like the copyup method
+  librados::ObjectWriteOperation copy_op;
+  copy_op.create(true);
+  copy_op.copy_from2(m_parent_oid, m_parent_data_ctx, 0,
+                     LIBRADOS_OP_FLAG_FADVISE_SEQUENTIAL |
+                       LIBRADOS_OP_FLAG_FADVISE_NOCACHE);
+
+  librados::Rados rados(m_ictx->data_ctx);
+  int r = rados.ioctx_create2(m_ictx->data_ctx.get_id(), m_data_ctx);
+  assert(r == 0);
+
+  std::vector<librados::snap_t> snaps;
+  librados::AioCompletion *comp = util::create_rados_callback(this);
+  r = m_data_ctx.aio_operate(
+    m_oid, comp, &copy_op, 0, snaps,
+    (m_trace.valid() ? m_trace.get_info() : nullptr));
+  assert(r == 0);
+  comp->release();
+  return false;
+}
+
+void CopyupRequest::send_pending_writes() {
+  ldout(m_ictx->cct, 20) << "oid " << m_oid << dendl;
+  m_state = STATE_COPYUP;
+
+  m_ictx->snap_lock.get_read();
+  ::SnapContext snapc = m_ictx->snapc;
+  m_ictx->snap_lock.put_read();
+
+  librados::ObjectWriteOperation write_op;
+  for (size_t i=0; i<m_pending_requests.size(); ++i) {
+    ObjectRequest<> *req = m_pending_requests[i];
+    ldout(m_ictx->cct, 20) << "add_copyup_ops " << req << dendl;
+    bool set_hints = (i == 0);
+    req->add_copyup_ops(&write_op, set_hints);
+  }
+  if (write_op.size() == 0) {
+    // e.g. flatten: the copy was all there was to do
+    m_pending_copyups++;
+    m_ictx->op_work_queue->queue(util::create_context_callback(this), 0);
+    return;
+  }
+
+  m_pending_copyups++;
+  std::vector<librados::snap_t> snaps(snapc.snaps.begin(), snapc.snaps.end());
+  librados::AioCompletion *comp = util::create_rados_callback(this);
+  int r = m_ictx->data_ctx.aio_operate(
+    m_oid, comp, &write_op, snapc.seq, snaps,
+    (m_trace.valid() ? m_trace.get_info() : nullptr));
+  assert(r == 0);
+  comp->release();
+}
+
 void CopyupRequest::remove_from_list()
 {
   Mutex::Locker l(m_ictx->copyup_list_lock);
+  m_removed_from_list = true;
 
   map<uint64_t, CopyupRequest*>::iterator it =
     m_ictx->copyup_list.find(m_object_no);
@@ -49,7 +49,8 @@ private:
    *              <start>
    *                 |
    *                 v
-   *    . . .STATE_READ_FROM_PARENT. . .
+   *    . . .STATE_READ_FROM_PARENT. . .   (skipped when copying from
+   *    . .          |                 .    the parent server-side)
    *    . .          |                 .
    *    . .          v                 .
    *    . .  STATE_OBJECT_MAP_HEAD     v (copy on read /
@@ -58,13 +59,19 @@ private:
    *    . .    STATE_OBJECT_MAP. . . . .
    *    . .          |
    *    . .          v
-   *    . . . . > STATE_COPYUP
-   *    .            |
-   *    .            v
-   *    . . . . > <finish>
+   *    . . . . > STATE_COPYUP . . . . . . > STATE_COPY_FROM_PARENT
+   *    .            |                            |
+   *    .            v                            v
+   *    . . . . > <finish> < . . . . . . STATE_COPYUP (pending writes)
    *
    * @endverbatim
    *
+   * With rbd_server_side_copyup, a copyup of a whole object whose layout
+   * matches the parent's has the OSD copy the parent object directly
+   * (STATE_COPY_FROM_PARENT) and only sends the pending writes once it
+   * is done.  If the parent object doesn't exist (e.g. its data lives
+   * in a grandparent) it falls back to reading from the parent.
+   *
    * The _OBJECT_MAP state is skipped if the object map isn't enabled or if
    * an object map update isn't required. The _COPYUP state is skipped if
    * no data was read from the parent *and* there are no additional ops.
@@ -73,7 +80,8 @@ private:
     STATE_READ_FROM_PARENT,
     STATE_OBJECT_MAP_HEAD, // only update the HEAD revision
     STATE_OBJECT_MAP,      // update HEAD+snaps (if any)
-    STATE_COPYUP
+    STATE_COPYUP,
+    STATE_COPY_FROM_PARENT
   };
 
   ImageCtx *m_ictx;
@@ -92,6 +100,11 @@ private:
   std::vector<uint64_t> m_snap_ids;
   librados::IoCtx m_data_ctx; // for empty SnapContext
 
+  bool m_copy_from_parent = false;
+  bool m_removed_from_list = false;
+  std::string m_parent_oid;
+  librados::IoCtx m_parent_data_ctx;
+
   void complete_requests(int r);
 
   bool should_complete(int r);
@@ -102,6 +115,11 @@ private:
   bool send_object_map();
   bool send_copyup();
   bool is_copyup_required();
+
+  bool can_copy_from_parent();
+  void send_read_from_parent();
+  bool send_copy_from_parent();
+  void send_pending_writes();
 };
 
 } // namespace io
@@ -200,7 +200,7 @@ void ImageRequestWQ<I>::aio_read(AioCompletion *c, uint64_t off, uint64_t len,
 				 bool native_async) {
   CephContext *cct = m_image_ctx.cct;
   ZTracer::Trace trace;
-  if (m_image_ctx.blkin_trace_all) {
+  if (m_image_ctx.blkin_trace_sampled()) {
     trace.init("wq: read", &m_image_ctx.trace_endpoint);
     trace.event("start");
   }
@@ -221,8 +221,8 @@ void ImageRequestWQ<I>::aio_read(AioCompletion *c, uint64_t off, uint64_t len,
   // if journaling is enabled -- we need to replay the journal because
   // it might contain an uncommitted write
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty() ||
-      require_lock_on_read()) {
+  if ((m_image_ctx.non_blocking_aio && !can_dispatch_inline(false)) ||
+      writes_blocked() || !writes_empty() || require_lock_on_read()) {
     queue(ImageRequest<I>::create_read_request(
             m_image_ctx, c, {{off, len}}, std::move(read_result), op_flags,
             trace));
@@ -241,7 +241,7 @@ void ImageRequestWQ<I>::aio_write(AioCompletion *c, uint64_t off, uint64_t len,
 				  bool native_async) {
   CephContext *cct = m_image_ctx.cct;
   ZTracer::Trace trace;
-  if (m_image_ctx.blkin_trace_all) {
+  if (m_image_ctx.blkin_trace_sampled()) {
     trace.init("wq: write", &m_image_ctx.trace_endpoint);
     trace.event("init");
   }
@@ -260,7 +260,8 @@ void ImageRequestWQ<I>::aio_write(AioCompletion *c, uint64_t off, uint64_t len,
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if ((m_image_ctx.non_blocking_aio && !can_dispatch_inline(true)) ||
+      writes_blocked()) {
     queue(ImageRequest<I>::create_write_request(
             m_image_ctx, c, {{off, len}}, std::move(bl), op_flags, trace));
   } else {
@@ -278,7 +279,7 @@ void ImageRequestWQ<I>::aio_discard(AioCompletion *c, uint64_t off,
 				    bool native_async) {
   CephContext *cct = m_image_ctx.cct;
   ZTracer::Trace trace;
-  if (m_image_ctx.blkin_trace_all) {
+  if (m_image_ctx.blkin_trace_sampled()) {
     trace.init("wq: discard", &m_image_ctx.trace_endpoint);
     trace.event("init");
   }
@@ -297,7 +298,8 @@ void ImageRequestWQ<I>::aio_discard(AioCompletion *c, uint64_t off,
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if ((m_image_ctx.non_blocking_aio && !can_dispatch_inline(true)) ||
+      writes_blocked()) {
     queue(ImageRequest<I>::create_discard_request(
             m_image_ctx, c, off, len, skip_partial_discard, trace));
   } else {
@@ -313,7 +315,7 @@ template <typename I>
 void ImageRequestWQ<I>::aio_flush(AioCompletion *c, bool native_async) {
   CephContext *cct = m_image_ctx.cct;
   ZTracer::Trace trace;
-  if (m_image_ctx.blkin_trace_all) {
+  if (m_image_ctx.blkin_trace_sampled()) {
     trace.init("wq: flush", &m_image_ctx.trace_endpoint);
     trace.event("init");
   }
@@ -331,7 +333,8 @@ void ImageRequestWQ<I>::aio_flush(AioCompletion *c, bool native_async) {
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty()) {
+  if ((m_image_ctx.non_blocking_aio && !can_dispatch_inline(false)) ||
+      writes_blocked() || !writes_empty()) {
     queue(ImageRequest<I>::create_flush_request(m_image_ctx, c, trace));
   } else {
     ImageRequest<I>::aio_flush(&m_image_ctx, c, trace);
@@ -346,7 +349,7 @@ void ImageRequestWQ<I>::aio_writesame(AioCompletion *c, uint64_t off,
 				      int op_flags, bool native_async) {
   CephContext *cct = m_image_ctx.cct;
   ZTracer::Trace trace;
-  if (m_image_ctx.blkin_trace_all) {
+  if (m_image_ctx.blkin_trace_sampled()) {
     trace.init("wq: writesame", &m_image_ctx.trace_endpoint);
     trace.event("init");
   }
@@ -366,7 +369,8 @@ void ImageRequestWQ<I>::aio_writesame(AioCompletion *c, uint64_t off,
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if ((m_image_ctx.non_blocking_aio && !can_dispatch_inline(true)) ||
+      writes_blocked()) {
     queue(ImageRequest<I>::create_writesame_request(
             m_image_ctx, c, off, len, std::move(bl), op_flags, trace));
   } else {
@@ -387,7 +391,7 @@ void ImageRequestWQ<I>::aio_compare_and_write(AioCompletion *c,
                                               int op_flags, bool native_async) {
   CephContext *cct = m_image_ctx.cct;
   ZTracer::Trace trace;
-  if (m_image_ctx.blkin_trace_all) {
+  if (m_image_ctx.blkin_trace_sampled()) {
     trace.init("wq: compare_and_write", &m_image_ctx.trace_endpoint);
     trace.event("init");
   }
@@ -406,7 +410,8 @@ void ImageRequestWQ<I>::aio_compare_and_write(AioCompletion *c,
   }
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
-  if (m_image_ctx.non_blocking_aio || writes_blocked()) {
+  if ((m_image_ctx.non_blocking_aio && !can_dispatch_inline(true)) ||
+      writes_blocked()) {
     queue(ImageRequest<I>::create_compare_and_write_request(
             m_image_ctx, c, {{off, len}}, std::move(cmp_bl), std::move(bl),
             mismatch_off, op_flags, trace));
@@ -427,15 +432,17 @@ void ImageRequestWQ<I>::shut_down(Context *on_shutdown) {
   {
     RWLock::WLocker locker(m_lock);
     assert(!m_shutdown);
+    m_on_shutdown = on_shutdown;
     m_shutdown = true;
 
     CephContext *cct = m_image_ctx.cct;
     ldout(cct, 5) << __func__ << ": in_flight=" << m_in_flight_ios.load()
                   << dendl;
     if (m_in_flight_ios > 0) {
-      m_on_shutdown = on_shutdown;
+      // the last in-flight IO completes the shut down
       return;
     }
+    m_on_shutdown = nullptr;
   }
 
   // ensure that all in-flight IO is flushed
@@ -458,7 +465,7 @@ void ImageRequestWQ<I>::block_writes(Context *on_blocked) {
     RWLock::WLocker locker(m_lock);
     ++m_write_blockers;
     ldout(cct, 5) << &m_image_ctx << ", " << "num="
-                  << m_write_blockers << dendl;
+                  << m_write_blockers.load() << dendl;
     if (!m_write_blocker_contexts.empty() || m_in_flight_writes > 0) {
       m_write_blocker_contexts.push_back(on_blocked);
       return;
@@ -480,7 +487,7 @@ void ImageRequestWQ<I>::unblock_writes() {
     --m_write_blockers;
 
     ldout(cct, 5) << &m_image_ctx << ", " << "num="
-                  << m_write_blockers << dendl;
+                  << m_write_blockers.load() << dendl;
     if (m_write_blockers == 0) {
       wake_up = true;
     }
@@ -620,7 +627,6 @@ void ImageRequestWQ<I>::process(ImageRequest<I> *req) {
 
 template <typename I>
 void ImageRequestWQ<I>::finish_queued_io(ImageRequest<I> *req) {
-  RWLock::RLocker locker(m_lock);
   if (req->is_write_op()) {
     assert(m_queued_writes > 0);
     m_queued_writes--;
@@ -649,36 +655,40 @@ void ImageRequestWQ<I>::finish_in_flight_write() {
 
 template <typename I>
 int ImageRequestWQ<I>::start_in_flight_io(AioCompletion *c) {
-  RWLock::RLocker locker(m_lock);
-
+  // count the IO before testing for shut down so that shut_down() either
+  // sees it in flight or we see the shut down -- no lock required
+  m_in_flight_ios++;
   if (m_shutdown) {
     CephContext *cct = m_image_ctx.cct;
     lderr(cct) << "IO received on closed image" << dendl;
 
     c->get();
     c->fail(-ESHUTDOWN);
+    finish_in_flight_io();
     return false;
   }
-
-  m_in_flight_ios++;
   return true;
 }
 
 template <typename I>
 void ImageRequestWQ<I>::finish_in_flight_io() {
+  if (--m_in_flight_ios > 0 || !m_shutdown) {
+    return;
+  }
+
   Context *on_shutdown;
   {
-    RWLock::RLocker locker(m_lock);
-    if (--m_in_flight_ios > 0 || !m_shutdown) {
-      return;
-    }
+    RWLock::WLocker locker(m_lock);
     on_shutdown = m_on_shutdown;
+    m_on_shutdown = nullptr;
+  }
+  if (on_shutdown == nullptr) {
+    // already completed by shut_down() or a racing IO
+    return;
   }
 
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 5) << "completing shut down" << dendl;
-
-  assert(on_shutdown != nullptr);
   m_image_ctx.flush(on_shutdown);
 }
 
@@ -691,6 +701,28 @@ void ImageRequestWQ<I>::fail_in_flight_io(int r, ImageRequest<I> *req) {
   finish_in_flight_io();
 }
 
+template <typename I>
+bool ImageRequestWQ<I>::can_dispatch_inline(bool write_op) const {
+  assert(m_image_ctx.owner_lock.is_locked());
+  if (!m_image_ctx.non_blocking_aio_inline) {
+    return false;
+  }
+
+  // anything that would stall the op (lock acquisition, refresh) or make
+  // the caller wait (cache throttling, local cache IO) goes through the
+  // dispatch thread, as does everything queued behind other ops
+  if (m_queued_writes > 0 || m_queued_reads > 0 || m_io_blockers > 0 ||
+      (write_op && m_require_lock_on_write) ||
+      (!write_op && m_require_lock_on_read)) {
+    return false;
+  }
+  if (m_image_ctx.object_cacher != nullptr ||
+      m_image_ctx.image_cache != nullptr) {
+    return false;
+  }
+  return !m_image_ctx.state->is_refresh_required();
+}
+
 template <typename I>
 bool ImageRequestWQ<I>::is_lock_required(bool write_op) const {
   assert(m_lock.is_locked());
@@ -59,7 +59,6 @@ public:
   void shut_down(Context *on_shutdown);
 
   inline bool writes_blocked() const {
-    RWLock::RLocker locker(m_lock);
     return (m_write_blockers > 0);
   }
 
@@ -83,26 +82,26 @@ private:
   ImageCtxT &m_image_ctx;
   mutable RWLock m_lock;
   Contexts m_write_blocker_contexts;
-  uint32_t m_write_blockers = 0;
-  bool m_require_lock_on_read = false;
-  bool m_require_lock_on_write = false;
+  std::atomic<uint32_t> m_write_blockers { 0 };
+  std::atomic<bool> m_require_lock_on_read { false };
+  std::atomic<bool> m_require_lock_on_write { false };
   std::atomic<unsigned> m_queued_reads { 0 };
   std::atomic<unsigned> m_queued_writes { 0 };
   std::atomic<unsigned> m_in_flight_ios { 0 };
   std::atomic<unsigned> m_in_flight_writes { 0 };
   std::atomic<unsigned> m_io_blockers { 0 };
 
-  bool m_shutdown = false;
+  // checked on every IO submission without m_lock
+  std::atomic<bool> m_shutdown { false };
   Context *m_on_shutdown = nullptr;
 
   bool is_lock_required(bool write_op) const;
+  bool can_dispatch_inline(bool write_op) const;
 
   inline bool require_lock_on_read() const {
-    RWLock::RLocker locker(m_lock);
     return m_require_lock_on_read;
   }
   inline bool writes_empty() const {
-    RWLock::RLocker locker(m_lock);
     return (m_queued_writes == 0);
   }
 
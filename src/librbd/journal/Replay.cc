@@ -28,6 +28,24 @@ static const uint64_t IN_FLIGHT_IO_HIGH_WATER_MARK(64);
 
 static NoOpProgressContext no_op_progress_callback;
 
+bool get_modify_extent(const EventEntry &event_entry, uint64_t *offset,
+                       uint64_t *length) {
+  if (auto event = boost::get<AioWriteEvent>(&event_entry.event)) {
+    *offset = event->offset;
+    *length = event->length;
+  } else if (auto event = boost::get<AioDiscardEvent>(&event_entry.event)) {
+    *offset = event->offset;
+    *length = event->length;
+  } else if (auto event = boost::get<AioWriteSameEvent>(
+               &event_entry.event)) {
+    *offset = event->offset;
+    *length = event->length;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 template <typename I, typename E>
 struct ExecuteOp : public Context {
   I &image_ctx;
@@ -184,6 +202,8 @@ Replay<I>::~Replay() {
   assert(m_aio_modify_safe_contexts.empty());
   assert(m_op_events.empty());
   assert(m_in_flight_op_events == 0);
+  assert(m_in_flight_parallel_aio == 0);
+  assert(m_blocked_on_ready == nullptr);
 }
 
 template <typename I>
@@ -214,6 +234,18 @@ void Replay<I>::process(const EventEntry &event_entry,
     return;
   }
 
+  {
+    Mutex::Locker locker(m_lock);
+    if (is_replay_blocked(event_entry)) {
+      ldout(cct, 20) << ": waiting for in-flight parallel events" << dendl;
+      assert(m_blocked_on_ready == nullptr);
+      m_blocked_event_entry = event_entry;
+      m_blocked_on_ready = on_ready;
+      m_blocked_on_safe = on_safe;
+      return;
+    }
+  }
+
   boost::apply_visitor(EventVisitor(this, on_ready, on_safe),
                        event_entry.event);
 }
@@ -258,6 +290,14 @@ void Replay<I>::shut_down(bool cancel_ops, Context *on_finish) {
       }
     }
 
+    if (m_blocked_on_ready != nullptr) {
+      ldout(cct, 5) << ": dropping blocked event" << dendl;
+      m_image_ctx.op_work_queue->queue(m_blocked_on_safe, -ESHUTDOWN);
+      m_blocked_on_ready->complete(0);
+      m_blocked_on_ready = nullptr;
+      m_blocked_on_safe = nullptr;
+    }
+
     assert(!m_shut_down);
     m_shut_down = true;
 
@@ -342,7 +382,8 @@ void Replay<I>::handle_event(const journal::AioDiscardEvent &event,
   auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
                                                io::AIO_TYPE_DISCARD,
                                                &flush_required,
-                                               {});
+                                               {}, event.offset,
+                                               event.length);
   if (aio_comp == nullptr) {
     return;
   }
@@ -372,7 +413,8 @@ void Replay<I>::handle_event(const journal::AioWriteEvent &event,
   auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
                                                io::AIO_TYPE_WRITE,
                                                &flush_required,
-                                               {});
+                                               {}, event.offset,
+                                               event.length);
   if (aio_comp == nullptr) {
     return;
   }
@@ -420,7 +462,8 @@ void Replay<I>::handle_event(const journal::AioWriteSameEvent &event,
   auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
                                                io::AIO_TYPE_WRITESAME,
                                                &flush_required,
-                                               {});
+                                               {}, event.offset,
+                                               event.length);
   if (aio_comp == nullptr) {
     return;
   }
@@ -856,7 +899,8 @@ void Replay<I>::handle_event(const journal::UnknownEvent &event,
 
 template <typename I>
 void Replay<I>::handle_aio_modify_complete(Context *on_ready, Context *on_safe,
-                                           int r, std::set<int> &filters) {
+                                           int r, std::set<int> &filters,
+                                           uint64_t offset, uint64_t length) {
   Mutex::Locker locker(m_lock);
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 20) << ": on_ready=" << on_ready << ", "
@@ -866,6 +910,43 @@ void Replay<I>::handle_aio_modify_complete(Context *on_ready, Context *on_safe,
     on_ready->complete(0);
   }
 
+  if (length > 0) {
+    assert(m_in_flight_parallel_aio > 0);
+    --m_in_flight_parallel_aio;
+    m_parallel_extents.erase(offset, length);
+
+    if (m_blocked_on_ready != nullptr &&
+        !is_replay_blocked(m_blocked_event_entry)) {
+      ldout(cct, 20) << ": resuming blocked event" << dendl;
+      EventEntry event_entry;
+      std::swap(event_entry, m_blocked_event_entry);
+      Context *blocked_on_ready = nullptr;
+      std::swap(blocked_on_ready, m_blocked_on_ready);
+      Context *blocked_on_safe = nullptr;
+      std::swap(blocked_on_safe, m_blocked_on_safe);
+      // tracked as an op event so that shut down waits for it
+      ++m_in_flight_op_events;
+      m_image_ctx.op_work_queue->queue(new FunctionContext(
+        [this, event_entry, blocked_on_ready, blocked_on_safe](int r) {
+          process(event_entry, blocked_on_ready, blocked_on_safe);
+
+          Context *on_flush = nullptr;
+          {
+            Mutex::Locker locker(m_lock);
+            assert(m_in_flight_op_events > 0);
+            --m_in_flight_op_events;
+            if (m_in_flight_op_events == 0 &&
+                (m_in_flight_aio_flush + m_in_flight_aio_modify) == 0) {
+              on_flush = m_flush_ctx;
+            }
+          }
+          if (on_flush != nullptr) {
+            m_image_ctx.op_work_queue->queue(on_flush, 0);
+          }
+        }), 0);
+    }
+  }
+
   if (filters.find(r) != filters.end())
     r = 0;
 
@@ -1042,7 +1123,8 @@ Replay<I>::create_aio_modify_completion(Context *on_ready,
                                         Context *on_safe,
                                         io::aio_type_t aio_type,
                                         bool *flush_required,
-                                        std::set<int> &&filters) {
+                                        std::set<int> &&filters,
+                                        uint64_t offset, uint64_t length) {
   Mutex::Locker locker(m_lock);
   CephContext *cct = m_image_ctx.cct;
   assert(m_on_aio_ready == nullptr);
@@ -1080,15 +1162,60 @@ Replay<I>::create_aio_modify_completion(Context *on_ready,
     std::swap(m_on_aio_ready, on_ready);
   }
 
+  // events that don't overlap any in-flight event can be applied
+  // concurrently: the next event is processed as soon as this one has
+  // been started (a later flush will wait for it)
+  Context *on_started = nullptr;
+  if (on_ready != nullptr && can_replay_in_parallel(offset, length)) {
+    ++m_in_flight_parallel_aio;
+    m_parallel_extents.insert(offset, length);
+    std::swap(on_started, on_ready);
+  } else {
+    length = 0;
+  }
+
   // when the modification is ACKed by librbd, we can process the next
   // event. when flushed, the completion of the next flush will fire the
   // on_safe callback
   auto aio_comp = io::AioCompletion::create_and_start<Context>(
-    new C_AioModifyComplete(this, on_ready, on_safe, std::move(filters)),
+    new C_AioModifyComplete(this, on_ready, on_safe, std::move(filters),
+                            offset, length),
     util::get_image_ctx(&m_image_ctx), aio_type);
+
+  if (on_started != nullptr) {
+    on_started->complete(0);
+  }
   return aio_comp;
 }
 
+template <typename I>
+bool Replay<I>::can_replay_in_parallel(uint64_t offset,
+                                       uint64_t length) const {
+  assert(m_lock.is_locked());
+  return (length > 0 &&
+          m_in_flight_parallel_aio + 1 <
+            m_image_ctx.journal_replay_max_concurrent_ios &&
+          !m_parallel_extents.intersects(offset, length));
+}
+
+template <typename I>
+bool Replay<I>::is_replay_blocked(const EventEntry &event_entry) const {
+  assert(m_lock.is_locked());
+  if (m_in_flight_parallel_aio == 0) {
+    return false;
+  }
+
+  uint64_t offset;
+  uint64_t length;
+  if (get_modify_extent(event_entry, &offset, &length)) {
+    return (length > 0 && m_parallel_extents.intersects(offset, length));
+  }
+
+  // flushes wait for all started IO within librbd -- every other event
+  // is a barrier for the in-flight parallel events
+  return (boost::get<AioFlushEvent>(&event_entry.event) == nullptr);
+}
+
 template <typename I>
 io::AioCompletion *Replay<I>::create_aio_flush_completion(Context *on_safe) {
   assert(m_lock.is_locked());
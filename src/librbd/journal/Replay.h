@@ -7,6 +7,7 @@
 #include "include/int_types.h"
 #include "include/buffer_fwd.h"
 #include "include/Context.h"
+#include "include/interval_set.h"
 #include "common/Mutex.h"
 #include "librbd/io/Types.h"
 #include "librbd/journal/Types.h"
@@ -78,13 +79,17 @@ private:
     Context *on_ready;
     Context *on_safe;
     std::set<int> filters;
+    uint64_t offset;
+    uint64_t length;  ///< non-zero if replayed in parallel
     C_AioModifyComplete(Replay *replay, Context *on_ready,
-                        Context *on_safe, std::set<int> &&filters)
+                        Context *on_safe, std::set<int> &&filters,
+                        uint64_t offset, uint64_t length)
       : replay(replay), on_ready(on_ready), on_safe(on_safe),
-        filters(std::move(filters)) {
+        filters(std::move(filters)), offset(offset), length(length) {
     }
     void finish(int r) override {
-      replay->handle_aio_modify_complete(on_ready, on_safe, r, filters);
+      replay->handle_aio_modify_complete(on_ready, on_safe, r, filters,
+                                         offset, length);
     }
   };
 
@@ -133,6 +138,18 @@ private:
   Context *m_flush_ctx = nullptr;
   Context *m_on_aio_ready = nullptr;
 
+  /// extents of AIO modify events that were reported ready before they
+  /// completed, so that later non-overlapping events can be replayed
+  /// concurrently
+  interval_set<uint64_t> m_parallel_extents;
+  uint64_t m_in_flight_parallel_aio = 0;
+
+  /// event waiting for an overlapping parallel event (or, for events
+  /// that act as a barrier, all parallel events) to complete
+  EventEntry m_blocked_event_entry;
+  Context *m_blocked_on_ready = nullptr;
+  Context *m_blocked_on_safe = nullptr;
+
   void handle_event(const AioDiscardEvent &event, Context *on_ready,
                     Context *on_safe);
   void handle_event(const AioWriteEvent &event, Context *on_ready,
@@ -177,7 +194,8 @@ private:
                     Context *on_safe);
 
   void handle_aio_modify_complete(Context *on_ready, Context *on_safe,
-                                  int r, std::set<int> &filters);
+                                  int r, std::set<int> &filters,
+                                  uint64_t offset, uint64_t length);
   void handle_aio_flush_complete(Context *on_flush_safe, Contexts &on_safe_ctxs,
                                  int r);
 
@@ -189,7 +207,11 @@ private:
                                                   Context *on_safe,
                                                   io::aio_type_t aio_type,
                                                   bool *flush_required,
-                                                  std::set<int> &&filters);
+                                                  std::set<int> &&filters,
+                                                  uint64_t offset = 0,
+                                                  uint64_t length = 0);
+  bool can_replay_in_parallel(uint64_t offset, uint64_t length) const;
+  bool is_replay_blocked(const EventEntry &event_entry) const;
   io::AioCompletion *create_aio_flush_completion(Context *on_safe);
   void handle_aio_completion(io::AioCompletion *aio_comp);
 
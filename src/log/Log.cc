@@ -43,7 +43,7 @@ Log::Log(SubsystemMap *s)
     m_subs(s),
     m_queue_mutex_holder(0),
     m_flush_mutex_holder(0),
-    m_new(), m_recent(),
+    m_recent(),
     m_fd(-1),
     m_uid(0),
     m_gid(0),
@@ -86,6 +86,13 @@ Log::~Log()
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
 
+  Entry *e = m_new.exchange(nullptr);
+  while (e) {
+    Entry *next = e->m_next;
+    delete e;
+    e = next;
+  }
+
   pthread_mutex_destroy(&m_queue_mutex);
   pthread_mutex_destroy(&m_flush_mutex);
   pthread_cond_destroy(&m_cond_loggers);
@@ -130,6 +137,13 @@ void Log::reopen_log_file()
 {
   pthread_mutex_lock(&m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
+
+  // whatever is queued belongs in the old file; it also has to go through
+  // _take_new so m_new_len (and any submitter blocked on it) sees it leave
+  EntryQueue t;
+  _take_new(&t);
+  _flush(&t, &m_recent, false);
+
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
   if (m_log_file.length()) {
@@ -205,18 +219,61 @@ void Log::stop_graylog()
 
 void Log::submit_entry(Entry *e)
 {
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
-
   if (m_inject_segv)
     *(volatile int *)(0) = 0xdead;
 
   // wait for flush to catch up
-  while (m_new.m_len > m_max_new)
-    pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
+  if (m_new_len.load(std::memory_order_relaxed) > m_max_new) {
+    pthread_mutex_lock(&m_queue_mutex);
+    m_queue_mutex_holder = pthread_self();
+    if (m_new_len > m_max_new)
+      ++m_blocked;
+    while (m_new_len > m_max_new)
+      pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
+    m_queue_mutex_holder = 0;
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
 
-  m_new.enqueue(e);
-  pthread_cond_signal(&m_cond_flusher);
+  ++m_queued;
+  ++m_new_len;
+  Entry *head = m_new.load(std::memory_order_relaxed);
+  do {
+    e->m_next = head;
+  } while (!m_new.compare_exchange_weak(head, e, std::memory_order_release,
+					std::memory_order_relaxed));
+
+  // only the submitter that makes the list non-empty wakes the flusher
+  if (!head) {
+    pthread_mutex_lock(&m_queue_mutex);
+    pthread_cond_signal(&m_cond_flusher);
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
+}
+
+void Log::_take_new(EntryQueue *t)
+{
+  // the list is newest first; reverse it into submission order
+  Entry *e = m_new.exchange(nullptr, std::memory_order_acquire);
+  Entry *prev = NULL;
+  int n = 0;
+  while (e) {
+    Entry *next = e->m_next;
+    e->m_next = prev;
+    prev = e;
+    e = next;
+    ++n;
+  }
+  while (prev) {
+    Entry *next = prev->m_next;
+    prev->m_next = NULL;
+    t->enqueue(prev);
+    prev = next;
+  }
+  m_new_len -= n;
+
+  pthread_mutex_lock(&m_queue_mutex);
+  m_queue_mutex_holder = pthread_self();
+  pthread_cond_broadcast(&m_cond_loggers);
   m_queue_mutex_holder = 0;
   pthread_mutex_unlock(&m_queue_mutex);
 }
@@ -264,13 +321,8 @@ void Log::flush()
 {
   pthread_mutex_lock(&m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
   EntryQueue t;
-  t.swap(m_new);
-  pthread_cond_broadcast(&m_cond_loggers);
-  m_queue_mutex_holder = 0;
-  pthread_mutex_unlock(&m_queue_mutex);
+  _take_new(&t);
   _flush(&t, &m_recent, false);
 
   // trim
@@ -377,14 +429,8 @@ void Log::dump_recent()
   pthread_mutex_lock(&m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
 
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
-
   EntryQueue t;
-  t.swap(m_new);
-
-  m_queue_mutex_holder = 0;
-  pthread_mutex_unlock(&m_queue_mutex);
+  _take_new(&t);
   _flush(&t, &m_recent, false);
 
   EntryQueue old;
@@ -408,6 +454,10 @@ void Log::dump_recent()
   _log_message(buf, true);
   sprintf(buf, "  max_new    %9d", m_max_new);
   _log_message(buf, true);
+  sprintf(buf, "  queued     %9llu", (unsigned long long)m_queued);
+  _log_message(buf, true);
+  sprintf(buf, "  blocked    %9llu", (unsigned long long)m_blocked);
+  _log_message(buf, true);
   sprintf(buf, "  log_file %s", m_log_file.c_str());
   _log_message(buf, true);
 
@@ -442,7 +492,7 @@ void *Log::entry()
   pthread_mutex_lock(&m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
   while (!m_stop) {
-    if (!m_new.empty()) {
+    if (m_new.load(std::memory_order_relaxed)) {
       m_queue_mutex_holder = 0;
       pthread_mutex_unlock(&m_queue_mutex);
       flush();
@@ -4,6 +4,8 @@
 #ifndef __CEPH_LOG_LOG_H
 #define __CEPH_LOG_LOG_H
 
+#include <atomic>
+
 #include "common/Thread.h"
 
 #include "EntryQueue.h"
@@ -29,7 +31,9 @@ class Log : private Thread
   pthread_t m_queue_mutex_holder;
   pthread_t m_flush_mutex_holder;
 
-  EntryQueue m_new;    ///< new entries
+  /// new entries, pushed without a lock, newest first
+  std::atomic<Entry*> m_new = {nullptr};
+  std::atomic<int> m_new_len = {0};
   EntryQueue m_recent; ///< recent (less new) entries we've already written at low detail
 
   std::string m_log_file;
@@ -51,8 +55,12 @@ class Log : private Thread
 
   bool m_inject_segv;
 
+  std::atomic<uint64_t> m_queued = {0};   ///< entries submitted
+  std::atomic<uint64_t> m_blocked = {0};  ///< submits that waited for flush
+
   void *entry() override;
 
+  void _take_new(EntryQueue *t);
   void _flush(EntryQueue *q, EntryQueue *requeue, bool crash);
 
   void _log_message(const char *s, bool crash);
@@ -86,6 +94,9 @@ public:
   Entry *create_entry(int level, int subsys, size_t* expected_size);
   void submit_entry(Entry *e);
 
+  uint64_t get_queued() const { return m_queued; }
+  uint64_t get_blocked() const { return m_blocked; }
+
   void start();
   void stop();
 
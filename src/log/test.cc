@@ -1,4 +1,8 @@
 #include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
 
 #include "log/Log.h"
 #include "common/Clock.h"
@@ -233,3 +237,74 @@ TEST(Log, LargeLog)
   log.flush();
   log.stop();
 }
+
+static int count_lines(const char *fn, const char *match)
+{
+  FILE *f = fopen(fn, "r");
+  if (!f)
+    return -1;
+  char buf[4096];
+  int n = 0;
+  while (fgets(buf, sizeof(buf), f))
+    if (strstr(buf, match))
+      ++n;
+  fclose(f);
+  return n;
+}
+
+TEST(Log, ReopenThenSubmit)
+{
+  SubsystemMap subs;
+  subs.add(1, "foo", 20, 10);
+  Log log(&subs);
+  // no flusher thread: whatever is queued stays queued until we flush,
+  // and a submitter that finds more than max_new queued blocks
+  log.set_max_new(10);
+  ::unlink("/tmp/rotate");
+  ::unlink("/tmp/rotate.1");
+  log.set_log_file("/tmp/rotate");
+  log.reopen_log_file();
+  for (int i = 0; i < 10; i++)
+    log.submit_entry(new Entry(ceph_clock_now(), pthread_self(), 10, 1,
+			       "before rotate"));
+
+  // what logrotate does
+  ASSERT_EQ(0, ::rename("/tmp/rotate", "/tmp/rotate.1"));
+  log.reopen_log_file();
+
+  for (int i = 0; i < 10; i++)
+    log.submit_entry(new Entry(ceph_clock_now(), pthread_self(), 10, 1,
+			       "after rotate"));
+  log.flush();
+
+  ASSERT_EQ(10, count_lines("/tmp/rotate.1", "before rotate"));
+  ASSERT_EQ(0, count_lines("/tmp/rotate.1", "after rotate"));
+  ASSERT_EQ(10, count_lines("/tmp/rotate", "after rotate"));
+  ASSERT_EQ(20u, log.get_queued());
+}
+
+TEST(Log, ManyThreads)
+{
+  SubsystemMap subs;
+  subs.add(1, "foo", 20, 10);
+  Log log(&subs);
+  log.set_max_new(10);
+  log.start();
+  log.set_log_file("/tmp/big");
+  log.reopen_log_file();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&] {
+	for (int i = 0; i < many / 8; i++) {
+	  Entry *e = new Entry(ceph_clock_now(), pthread_self(), 10, 1,
+			       "hello world");
+	  log.submit_entry(e);
+	}
+      });
+  }
+  for (auto& t : threads)
+    t.join();
+  log.flush();
+  ASSERT_EQ((uint64_t)(many / 8 * 8), log.get_queued());
+  log.stop();
+}
@@ -1533,29 +1533,93 @@ void CDir::fetch(MDSInternalContextBase *c, const std::set<dentry_key_t>& keys)
   _omap_fetch(c, keys);
 }
 
+class C_Dir_FetchedKey : public CDirContext {
+  std::string dname;
+  MDSInternalContextBase *fin;
+public:
+  C_Dir_FetchedKey(CDir *d, const std::string& dn, MDSInternalContextBase *f) :
+    CDirContext(d), dname(dn), fin(f) { }
+  void finish(int r) override {
+    CDentry *dn = dir->lookup(dname);
+    if (dir->is_complete() || !dir->is_auth() ||
+	(dn && !dn->get_linkage()->is_null())) {
+      fin->complete(r);
+      return;
+    }
+    // the name isn't on disk (or wasn't readable); only a full load
+    // can tell the caller it doesn't exist
+    dir->fetch(fin, dname);
+  }
+};
+
+/*
+ * load just one dentry of a large dirfrag.  if it turns out not to exist
+ * this falls back to loading the whole dirfrag, as fetch() would.
+ */
+void CDir::fetch_key(MDSInternalContextBase *c, const std::string& dname)
+{
+  dout(10) << "fetch_key " << dname << " on " << *this << dendl;
+  std::set<dentry_key_t> keys;
+  keys.insert(dentry_key_t(CEPH_NOSNAP, dname.c_str()));
+  fetch(new C_Dir_FetchedKey(this, dname, c), keys);
+}
+
 class C_IO_Dir_OMAP_FetchedMore : public CDirIOContext {
   MDSInternalContextBase *fin;
 public:
   bufferlist hdrbl;
-  bool more = false;
-  map<string, bufferlist> omap;      ///< carry-over from before
-  map<string, bufferlist> omap_more; ///< new batch
-  int ret;
+  map<string, bufferlist> omap;
   C_IO_Dir_OMAP_FetchedMore(CDir *d, MDSInternalContextBase *f) :
-    CDirIOContext(d), fin(f), ret(0) { }
-  void finish(int r) {
-    // merge results
-    if (omap.empty()) {
-      omap.swap(omap_more);
-    } else {
-      omap.insert(omap_more.begin(), omap_more.end());
+    CDirIOContext(d), fin(f) { }
+  void finish(int r) override {
+    dir->_omap_fetched(hdrbl, omap, !fin, r);
+    if (fin)
+      fin->complete(r);
+  }
+};
+
+/*
+ * Read the next batch of a large dirfrag.  This only touches its own
+ * buffers and the objecter, so batches are appended without mds_lock;
+ * the lock is taken once, by C_IO_Dir_OMAP_FetchedMore, after the last
+ * batch is in.
+ */
+class C_Dir_OMAP_ReadMore : public Context {
+  Objecter *objecter;
+  Finisher *finisher;
+  object_t oid;
+  object_locator_t oloc;
+  uint64_t max;
+  C_IO_Dir_OMAP_FetchedMore *done;
+  map<string, bufferlist> omap_more;
+  bool more = false;
+  int ret = 0;
+public:
+  C_Dir_OMAP_ReadMore(Objecter *o, Finisher *f, const object_t& oid,
+		      const object_locator_t& oloc, uint64_t max,
+		      C_IO_Dir_OMAP_FetchedMore *done) :
+    objecter(o), finisher(f), oid(oid), oloc(oloc), max(max), done(done) { }
+  void read() {
+    ObjectOperation rd;
+    rd.omap_get_vals(done->omap.rbegin()->first,
+		     "", /* filter prefix */
+		     max, &omap_more, &more, &ret);
+    objecter->read(oid, oloc, rd, CEPH_NOSNAP, NULL, 0,
+		   new C_OnFinisher(this, finisher));
+  }
+  void finish(int r) override {
+    if (r < 0) {
+      done->complete(r);
+      return;
     }
-    if (more) {
-      dir->_omap_fetch_more(hdrbl, omap, fin);
+    // keys come back in order, past everything we have
+    done->omap.insert(omap_more.begin(), omap_more.end());
+    if (more && !omap_more.empty()) {
+      C_Dir_OMAP_ReadMore *next = new C_Dir_OMAP_ReadMore(
+	objecter, finisher, oid, oloc, max, done);
+      next->read();
     } else {
-      dir->_omap_fetched(hdrbl, omap, !fin, r);
-      if (fin)
-	fin->complete(r);
+      done->complete(r);
     }
   }
 };
@@ -1626,20 +1690,14 @@ void CDir::_omap_fetch_more(
   MDSInternalContextBase *c)
 {
   // we have more omap keys to fetch!
-  object_t oid = get_ondisk_object();
   object_locator_t oloc(cache->mds->mdsmap->get_metadata_pool());
   C_IO_Dir_OMAP_FetchedMore *fin = new C_IO_Dir_OMAP_FetchedMore(this, c);
   fin->hdrbl.claim(hdrbl);
   fin->omap.swap(omap);
-  ObjectOperation rd;
-  rd.omap_get_vals(fin->omap.rbegin()->first,
-		   "", /* filter prefix */
-		   g_conf->mds_dir_keys_per_op,
-		   &fin->omap_more,
-		   &fin->more,
-		   &fin->ret);
-  cache->mds->objecter->read(oid, oloc, rd, CEPH_NOSNAP, NULL, 0,
-			     new C_OnFinisher(fin, cache->mds->finisher));
+  C_Dir_OMAP_ReadMore *rd = new C_Dir_OMAP_ReadMore(
+    cache->mds->objecter, cache->mds->finisher, get_ondisk_object(), oloc,
+    g_conf->mds_dir_keys_per_op, fin);
+  rd->read();
 }
 
 CDentry *CDir::_load_dentry(
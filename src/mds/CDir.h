@@ -592,6 +592,7 @@ private:
   void fetch(MDSInternalContextBase *c, bool ignore_authpinnability=false);
   void fetch(MDSInternalContextBase *c, const std::string& want_dn, bool ignore_authpinnability=false);
   void fetch(MDSInternalContextBase *c, const std::set<dentry_key_t>& keys);
+  void fetch_key(MDSInternalContextBase *c, const std::string& dname);
 protected:
   compact_set<string> wanted_items;
 
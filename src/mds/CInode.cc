@@ -1137,6 +1137,12 @@ struct C_IO_Inode_StoredBacktrace : public CInodeIOContext {
   }
 };
 
+/*
+ * Backtrace writes are coalesced per inode: while one is queued or in
+ * flight, further requests just wait, and changes made meanwhile go out
+ * in a single follow-up write.  At most mds_max_backtrace_writes are in
+ * flight across the cache; the rest wait in MDCache's queue.
+ */
 void CInode::store_backtrace(MDSInternalContextBase *fin, int op_prio)
 {
   dout(10) << "store_backtrace on " << *this << dendl;
@@ -1145,6 +1151,51 @@ void CInode::store_backtrace(MDSInternalContextBase *fin, int op_prio)
   if (op_prio < 0)
     op_prio = CEPH_MSG_PRIO_DEFAULT;
 
+  if (state_test(STATE_STORINGBACKTRACE) ||
+      state_test(STATE_QUEUEDBACKTRACE)) {
+    dout(10) << "store_backtrace already pending, waiting" << dendl;
+    if (fin)
+      add_waiter(WAIT_BACKTRACE, fin);
+    return;
+  }
+
+  if (!mdcache->can_write_backtrace()) {
+    dout(10) << "store_backtrace throttled, queueing" << dendl;
+    state_set(STATE_QUEUEDBACKTRACE);
+    auth_pin(this);
+    if (fin)
+      add_waiter(WAIT_BACKTRACE, fin);
+    mdcache->queue_backtrace_write(this, op_prio);
+    return;
+  }
+
+  _store_backtrace(fin, op_prio);
+}
+
+void CInode::_start_queued_backtrace(int op_prio)
+{
+  assert(state_test(STATE_QUEUEDBACKTRACE));
+  state_clear(STATE_QUEUEDBACKTRACE);
+  auth_unpin(this);
+
+  list<MDSInternalContextBase*> ls;
+  take_waiting(WAIT_BACKTRACE, ls);
+  if (!is_dirty_parent() || !is_auth()) {
+    // stored or handed off while we were queued
+    finish_contexts(g_ceph_context, ls, 0);
+    return;
+  }
+  _store_backtrace(new FunctionContext([ls](int r) mutable {
+	finish_contexts(g_ceph_context, ls, r);
+      }), op_prio);
+}
+
+void CInode::_store_backtrace(Context *fin, int op_prio)
+{
+  dout(10) << "_store_backtrace v " << inode.backtrace_version << " on "
+	   << *this << dendl;
+  state_set(STATE_STORINGBACKTRACE);
+  mdcache->backtrace_write_started();
   auth_pin(this);
 
   const int64_t pool = get_backtrace_pool();
@@ -1208,6 +1259,9 @@ void CInode::store_backtrace(MDSInternalContextBase *fin, int op_prio)
 
 void CInode::_stored_backtrace(int r, version_t v, Context *fin)
 {
+  state_clear(STATE_STORINGBACKTRACE);
+  mdcache->backtrace_write_finished();
+
   if (r == -ENOENT) {
     const int64_t pool = get_backtrace_pool();
     bool exists = mdcache->mds->objecter->with_osdmap(
@@ -1234,6 +1288,7 @@ void CInode::_stored_backtrace(int r, version_t v, Context *fin)
     mdcache->mds->handle_write_error(r);
     if (fin)
       fin->complete(r);
+    finish_waiting(WAIT_BACKTRACE, r);
     return;
   }
 
@@ -1244,6 +1299,27 @@ void CInode::_stored_backtrace(int r, version_t v, Context *fin)
     clear_dirty_parent();
   if (fin)
     fin->complete(0);
+
+  if (!is_waiter_for(WAIT_BACKTRACE))
+    return;
+  if (!is_dirty_parent() || !is_auth()) {
+    finish_waiting(WAIT_BACKTRACE, 0);
+    return;
+  }
+  // superseded while in flight; one more write covers everyone waiting
+  dout(10) << "_stored_backtrace superseded by v " << inode.backtrace_version
+	   << ", storing again" << dendl;
+  if (!mdcache->can_write_backtrace()) {
+    state_set(STATE_QUEUEDBACKTRACE);
+    auth_pin(this);
+    mdcache->queue_backtrace_write(this, CEPH_MSG_PRIO_DEFAULT);
+    return;
+  }
+  list<MDSInternalContextBase*> ls;
+  take_waiting(WAIT_BACKTRACE, ls);
+  _store_backtrace(new FunctionContext([ls](int r) mutable {
+	finish_contexts(g_ceph_context, ls, r);
+      }), CEPH_MSG_PRIO_DEFAULT);
 }
 
 void CInode::fetch_backtrace(Context *fin, bufferlist *backtrace)
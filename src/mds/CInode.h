@@ -201,6 +201,8 @@ class CInode : public MDSCacheObject, public InodeStoreBase, public Counter<CIno
   static const int STATE_MISSINGOBJS = (1<<20);
   static const int STATE_EVALSTALECAPS = (1<<21);
   static const int STATE_QUEUEDEXPORTPIN = (1<<22);
+  static const int STATE_STORINGBACKTRACE = (1<<23);
+  static const int STATE_QUEUEDBACKTRACE = (1<<24);
   // orphan inode needs notification of releasing reference
   static const int STATE_ORPHAN =	STATE_NOTIFYREF;
 
@@ -214,6 +216,7 @@ class CInode : public MDSCacheObject, public InodeStoreBase, public Counter<CIno
   static const uint64_t WAIT_FROZEN      = (1<<1);
   static const uint64_t WAIT_TRUNC       = (1<<2);
   static const uint64_t WAIT_FLOCK       = (1<<3);
+  static const uint64_t WAIT_BACKTRACE   = (1<<4);
   
   static const uint64_t WAIT_ANY_MASK	= (uint64_t)(-1);
 
@@ -749,7 +752,9 @@ public:
 
   void build_backtrace(int64_t pool, inode_backtrace_t& bt);
   void store_backtrace(MDSInternalContextBase *fin, int op_prio=-1);
+  void _store_backtrace(Context *fin, int op_prio);
   void _stored_backtrace(int r, version_t v, Context *fin);
+  void _start_queued_backtrace(int op_prio);
   void fetch_backtrace(Context *fin, bufferlist *backtrace);
 protected:
   /**
@@ -1024,7 +1029,7 @@ public:
 #endif
 		    << dendl;
 #ifdef MDS_REF_SET
-    assert(ref_map[by] > 0);
+    assert(get_num_ref(by) > 0);
 #endif
     assert(ref > 0);
   }
@@ -1035,7 +1040,7 @@ public:
 #endif
 		    << dendl;
 #ifdef MDS_REF_SET
-    assert(ref_map[by] >= 0);
+    assert(get_num_ref(by) >= 0);
 #endif
   }
   void first_get() override;
@@ -792,6 +792,15 @@ void MDBalancer::try_rebalance(balance_state_t& state)
     return;
   }
 
+  // forget imports that have been here long enough
+  double hold = g_conf->mds_bal_import_hold_time;
+  for (auto p = import_times.begin(); p != import_times.end(); ) {
+    if (hold <= 0 || (double)(rebalance_time - p->second) >= hold)
+      import_times.erase(p++);
+    else
+      ++p;
+  }
+
   // make a sorted list of my imports
   map<double,CDir*>    import_pop_map;
   multimap<mds_rank_t,CDir*>  import_from_map;
@@ -803,6 +812,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
        ++it) {
     CDir *im = *it;
     if (im->get_inode()->is_stray()) continue;
+    if (recently_imported(im)) continue;
 
     double pop = im->pop_auth_subtree.meta_load(rebalance_time, mds->mdcache->decayrate);
     if (g_conf->mds_bal_idle_threshold > 0 &&
@@ -914,6 +924,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 	 pot != candidates.end();
 	 ++pot) {
       if ((*pot)->get_inode()->is_stray()) continue;
+      if (recently_imported(*pot)) continue;
       find_exports(*pot, amount, exports, have, already_exporting);
       if (have > amount-MIN_OFFLOAD)
 	break;
@@ -1217,6 +1228,9 @@ void MDBalancer::add_import(CDir *dir, utime_t now)
 {
   dirfrag_load_vec_t subload = dir->pop_auth_subtree;
 
+  if (g_conf->mds_bal_import_hold_time > 0)
+    import_times[dir->dirfrag()] = now;
+
   while (true) {
     dir = dir->inode->get_parent_dir();
     if (!dir) break;
@@ -1226,6 +1240,16 @@ void MDBalancer::add_import(CDir *dir, utime_t now)
   }
 }
 
+bool MDBalancer::recently_imported(CDir *dir)
+{
+  auto p = import_times.find(dir->dirfrag());
+  if (p == import_times.end())
+    return false;
+  dout(10) << " imported " << (rebalance_time - p->second)
+	   << "s ago, holding " << *dir << dendl;
+  return true;
+}
+
 void MDBalancer::handle_mds_failure(mds_rank_t who)
 {
   if (0 == who) {
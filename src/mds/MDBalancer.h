@@ -99,6 +99,9 @@ private:
                     double& have,
                     set<CDir*>& already_exporting);
 
+  /// true if dir was imported within mds_bal_import_hold_time
+  bool recently_imported(CDir *dir);
+
   double try_match(balance_state_t &state,
                    mds_rank_t ex, double& maxex,
                    mds_rank_t im, double& maxim);
@@ -138,6 +141,10 @@ private:
   // dirfrags that already have one in flight.
   set<dirfrag_t>   split_pending, merge_pending;
 
+  // When subtrees were last imported, so that we do not immediately
+  // hand them on (or back) before their load has settled here.
+  map<dirfrag_t, utime_t> import_times;
+
   // per-epoch scatter/gathered info
   map<mds_rank_t, mds_load_t>  mds_load;
   map<mds_rank_t, double>       mds_meta_load;
@@ -8105,7 +8105,15 @@ int MDCache::path_traverse(MDRequestRef& mdr, Message *req, MDSInternalContextBa
 	// directory isn't complete; reload
         dout(7) << "traverse: incomplete dir contents for " << *cur << ", fetching" << dendl;
         touch_inode(cur);
-        curdir->fetch(_get_waiter(mdr, req, fin), path[depth]);
+        if (snapid == CEPH_NOSNAP &&
+	    g_conf->mds_dir_partial_fetch_min > 0 &&
+	    (uint64_t)cur->inode.dirstat.size() >=
+	      g_conf->mds_dir_partial_fetch_min) {
+	  // huge directory; load just the dentry we want
+	  curdir->fetch_key(_get_waiter(mdr, req, fin), path[depth]);
+	} else {
+	  curdir->fetch(_get_waiter(mdr, req, fin), path[depth]);
+	}
 	if (mds->logger) mds->logger->inc(l_mds_traverse_dir_fetch);
         return 1;
       }
@@ -9538,6 +9546,17 @@ void MDCache::scan_stray_dir(dirfrag_t next)
   }
 }
 
+void MDCache::backtrace_write_finished()
+{
+  assert(num_backtrace_writes > 0);
+  --num_backtrace_writes;
+  while (!backtrace_write_queue.empty() && can_write_backtrace()) {
+    auto p = backtrace_write_queue.front();
+    backtrace_write_queue.pop_front();
+    p.first->_start_queued_backtrace(p.second);
+  }
+}
+
 void MDCache::fetch_backtrace(inodeno_t ino, int64_t pool, bufferlist& bl, Context *fin)
 {
   object_t oid = CInode::get_object_name(ino, frag_t(), "");
@@ -980,6 +980,19 @@ public:
   void snaprealm_create(MDRequestRef& mdr, CInode *in);
   void _snaprealm_create_finish(MDRequestRef& mdr, MutationRef& mut, CInode *in);
 
+  // -- backtrace writes --
+  int num_backtrace_writes = 0;  ///< in flight
+  std::deque<std::pair<CInode*, int> > backtrace_write_queue; ///< inode, prio
+public:
+  bool can_write_backtrace() const {
+    return num_backtrace_writes < g_conf->mds_max_backtrace_writes;
+  }
+  void queue_backtrace_write(CInode *in, int op_prio) {
+    backtrace_write_queue.push_back(std::make_pair(in, op_prio));
+  }
+  void backtrace_write_started() { ++num_backtrace_writes; }
+  void backtrace_write_finished();
+
   // -- stray --
 public:
   void fetch_backtrace(inodeno_t ino, int64_t pool, bufferlist& bl, Context *fin);
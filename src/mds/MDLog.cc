@@ -75,6 +75,10 @@ void MDLog::create_logger()
   plb.add_time_avg(l_mdl_jlat, "jlat", "Journaler flush latency");
 
   plb.add_u64_counter(l_mdl_replayed, "replayed", "Events replayed");
+  plb.add_u64_counter(l_mdl_exwr, "exwr",
+      "Writes and flushes issued to expire segments");
+  plb.add_u64(l_mdl_seglag, "seglag",
+      "Segments over mds_log_max_segments not yet expiring");
 
   // logger
   logger = plb.create_perf_counters();
@@ -650,6 +654,11 @@ void MDLog::trim(int m)
     }
   }
 
+  uint64_t trimmable = segments.size() - expiring_segments.size() -
+    expired_segments.size();
+  logger->set(l_mdl_seglag,
+	      trimmable > max_segments ? trimmable - max_segments : 0);
+
   // discard expired segments and unlock submit_mutex
   _trim_expired_segments();
 }
@@ -731,6 +740,7 @@ void MDLog::try_expire(LogSegment *ls, int op_prio)
 
   if (gather_bld.has_subs()) {
     dout(5) << "try_expire expiring segment " << ls->seq << "/" << ls->offset << dendl;
+    logger->inc(l_mdl_exwr, gather_bld.num_subs_created());
     gather_bld.set_finisher(new C_MaybeExpiredSegment(this, ls, op_prio));
     gather_bld.activate();
   } else {
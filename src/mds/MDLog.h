@@ -35,6 +35,8 @@ enum {
   l_mdl_rdpos,
   l_mdl_jlat,
   l_mdl_replayed,
+  l_mdl_exwr,
+  l_mdl_seglag,
   l_mdl_last,
 };
 
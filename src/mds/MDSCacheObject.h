@@ -145,17 +145,19 @@ class MDSCacheObject {
 protected:
   __s32      ref;       // reference count
 #ifdef MDS_REF_SET
-  std::map<int,int> ref_map;
+  // only pins currently held; empty (and unallocated) when ref == 0
+  compact_map<int,int> ref_map;
 #endif
 
  public:
   int get_num_ref(int by = -1) const {
 #ifdef MDS_REF_SET
     if (by >= 0) {
-      if (ref_map.find(by) == ref_map.end()) {
+      auto p = ref_map.find(by);
+      if (p == ref_map.end()) {
 	return 0;
       } else {
-        return ref_map.find(by)->second;
+        return p->second;
       }
     }
 #endif
@@ -168,14 +170,15 @@ protected:
   virtual void last_put() {}
   virtual void bad_put(int by) {
 #ifdef MDS_REF_SET
-    assert(ref_map[by] > 0);
+    assert(get_num_ref(by) > 0);
 #endif
     assert(ref > 0);
   }
   virtual void _put() {}
   void put(int by) {
 #ifdef MDS_REF_SET
-    if (ref == 0 || ref_map[by] == 0) {
+    auto p = ref_map.find(by);
+    if (ref == 0 || p == ref_map.end()) {
 #else
     if (ref == 0) {
 #endif
@@ -183,7 +186,8 @@ protected:
     } else {
       ref--;
 #ifdef MDS_REF_SET
-      ref_map[by]--;
+      if (--p->second == 0)
+	ref_map.erase(p);
 #endif
       if (ref == 0)
 	last_put();
@@ -195,7 +199,7 @@ protected:
   virtual void first_get() {}
   virtual void bad_get(int by) {
 #ifdef MDS_REF_SET
-    assert(by < 0 || ref_map[by] == 0);
+    assert(by < 0 || get_num_ref(by) == 0);
 #endif
     ceph_abort();
   }
@@ -204,15 +208,13 @@ protected:
       first_get();
     ref++;
 #ifdef MDS_REF_SET
-    if (ref_map.find(by) == ref_map.end())
-      ref_map[by] = 0;
     ref_map[by]++;
 #endif
   }
 
   void print_pin_set(std::ostream& out) const {
 #ifdef MDS_REF_SET
-    std::map<int, int>::const_iterator it = ref_map.begin();
+    auto it = ref_map.begin();
     while (it != ref_map.end()) {
       out << " " << pin_name(it->first) << "=" << it->second;
       ++it;
@@ -945,6 +945,7 @@ void MDSRank::send_message_client_counted(Message *m, Connection *connection)
 void MDSRank::send_message_client_counted(Message *m, Session *session)
 {
   version_t seq = session->inc_push_seq();
+  session->push_msg_load.hit(ceph_clock_now(), mdcache->decayrate);
   dout(10) << "send_message_client_counted " << session->info.inst.name << " seq "
 	   << seq << " " << *m << dendl;
   if (session->connection) {
@@ -2053,6 +2054,9 @@ void MDSRankDispatcher::dump_sessions(const SessionFilter &filter, Formatter *f)
 
     f->dump_int("num_leases", s->leases.size());
     f->dump_int("num_caps", s->caps.size());
+    f->dump_unsigned("push_seq", s->get_push_seq());
+    f->dump_float("push_msg_load",
+		  s->push_msg_load.get(ceph_clock_now(), mdcache->decayrate));
 
     f->dump_string("state", s->get_state_name());
     f->dump_int("replay_requests", is_clientreplay() ? s->get_request_count() : 0);
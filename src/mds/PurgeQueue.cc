@@ -102,6 +102,10 @@ void PurgeQueue::create_logger()
   pcb.add_u64(l_pq_executing, "pq_executing", "Purge queue tasks in flight");
   pcb.add_u64_counter(l_pq_executed, "pq_executed", "Purge queue tasks executed", "purg",
       PerfCountersBuilder::PRIO_INTERESTING);
+  pcb.add_u64_counter(l_pq_executed_ops, "pq_executed_ops",
+      "Purge queue ops executed");
+  pcb.add_u64(l_pq_journal_bytes, "pq_journal_bytes",
+      "Purge queue journal bytes not yet consumed");
 
   logger.reset(pcb.create_perf_counters());
   g_ceph_context->get_perfcounters_collection()->add(logger.get());
@@ -276,17 +280,28 @@ uint32_t PurgeQueue::_calculate_ops(const PurgeItem &item) const
     // One for the root, plus any leaves
     ops_required = 1 + ls.size();
   } else {
-    // File, work out concurrent Filer::purge deletes
+    // File, work out concurrent Filer::purge deletes.  This must match
+    // what _execute_item() actually issues, or small files (the common
+    // case when purging a big tree) are charged double against
+    // max_purge_ops.
     const uint64_t num = (item.size > 0) ?
-      Striper::get_num_objects(item.layout, item.size) : 1;
+      Striper::get_num_objects(item.layout, item.size) : 0;
 
-    ops_required = MIN(num, g_conf->filer_max_purge_ops);
+    if (item.action == PurgeItem::TRUNCATE_FILE) {
+      // purge objects 1..num-1, zero the backtrace object 0
+      if (num > 1)
+        ops_required = MIN(num - 1, g_conf->filer_max_purge_ops);
+      ops_required += 1;
+    } else {
+      ops_required = MIN(num, g_conf->filer_max_purge_ops);
 
-    // Account for removing (or zeroing) backtrace
-    ops_required += 1;
+      // The backtrace object is object 0 of the file, so it only takes
+      // a separate remove if no data was purged or it lives in a
+      // namespace the data objects don't.
+      if (num == 0 || !item.layout.pool_ns.empty())
+        ops_required += 1;
 
-    // Account for deletions for old pools
-    if (item.action != PurgeItem::TRUNCATE_FILE) {
+      // Account for deletions for old pools
       ops_required += item.old_pools.size();
     }
   }
@@ -388,6 +403,8 @@ void PurgeQueue::_execute_item(
 
   in_flight[expire_to] = item;
   logger->set(l_pq_executing, in_flight.size());
+  logger->set(l_pq_journal_bytes,
+              journaler.get_write_pos() - journaler.get_read_pos());
   ops_in_flight += _calculate_ops(item);
   logger->set(l_pq_executing_ops, ops_in_flight);
 
@@ -503,8 +520,10 @@ void PurgeQueue::_execute_item_complete(
     dout(10) << "non-sequential completion, not expiring anything" << dendl;
   }
 
-  ops_in_flight -= _calculate_ops(iter->second);
+  const uint32_t ops = _calculate_ops(iter->second);
+  ops_in_flight -= ops;
   logger->set(l_pq_executing_ops, ops_in_flight);
+  logger->inc(l_pq_executed_ops, ops);
 
   dout(10) << "completed item for ino 0x" << std::hex << iter->second.ino
            << std::dec << dendl;
@@ -60,6 +60,8 @@ enum {
   l_pq_executing_ops,
   l_pq_executing,
   l_pq_executed,
+  l_pq_executed_ops,
+  l_pq_journal_bytes,
   l_pq_last
 };
 
@@ -207,6 +207,7 @@ public:
   xlist<Capability*> caps;     // inodes with caps; front=most recently used
   xlist<ClientLease*> leases;  // metadata leases to clients
   utime_t last_cap_renew;
+  DecayCounter push_msg_load;  // decaying count of counted (cap/lease) msgs sent
 
 public:
   version_t inc_push_seq() { return ++cap_push_seq; }
@@ -20,6 +20,7 @@
 #include "msg/Message.h"
 
 #include "common/perf_counters.h"
+#include "mgr/ClientIOStats.h"
 
 class PerfCounterType
 {
@@ -57,7 +58,7 @@ WRITE_CLASS_ENCODER(PerfCounterType)
 
 class MMgrReport : public Message
 {
-  static const int HEAD_VERSION = 4;
+  static const int HEAD_VERSION = 5;
   static const int COMPAT_VERSION = 1;
 
 public:
@@ -83,6 +84,9 @@ public:
   // for service registration
   boost::optional<std::map<std::string,std::string>> daemon_status;
 
+  // per-client op stats (OSDs only, when osd_client_io_stats is on)
+  boost::optional<client_io_report_t> client_io;
+
   void decode_payload() override
   {
     bufferlist::iterator p = payload.begin();
@@ -95,6 +99,8 @@ public:
       ::decode(service_name, p);
       ::decode(daemon_status, p);
     }
+    if (header.version >= 5)
+      ::decode(client_io, p);
   }
 
   void encode_payload(uint64_t features) override {
@@ -104,6 +110,7 @@ public:
     ::encode(undeclare_types, payload);
     ::encode(service_name, payload);
     ::encode(daemon_status, payload);
+    ::encode(client_io, payload);
   }
 
   const char *get_type_name() const override { return "mgrreport"; }
@@ -121,6 +128,9 @@ public:
     if (daemon_status) {
       out << " status=" << daemon_status->size();
     }
+    if (client_io) {
+      out << " client_io=" << client_io->stats.size();
+    }
     out << ")";
   }
 
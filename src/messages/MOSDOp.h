@@ -33,7 +33,7 @@ class OSD;
 
 class MOSDOp : public MOSDFastDispatchOp {
 
-  static const int HEAD_VERSION = 8;
+  static const int HEAD_VERSION = 9;
   static const int COMPAT_VERSION = 3;
 
 private:
@@ -62,6 +62,12 @@ private:
 
   osd_reqid_t reqid; // reqid explicitly set by sender
 
+  // dmclock distributed qos params; 0 if the client does not track them
+  uint32_t qos_delta = 0;
+  uint32_t qos_rho = 0;
+  // set by the osd if the op was dequeued in the reservation phase
+  bool qos_reservation = false;
+
 public:
   friend class MOSDOpReply;
 
@@ -79,6 +85,16 @@ public:
   void set_spg(spg_t p) {
     pgid = p;
   }
+  void set_qos_params(uint32_t delta, uint32_t rho) {
+    qos_delta = delta;
+    qos_rho = rho;
+  }
+  void set_qos_reservation(bool r) {
+    qos_reservation = r;
+  }
+  bool get_qos_reservation() const {
+    return qos_reservation;
+  }
 
   // Fields decoded in partial decoding
   pg_t get_pg() const {
@@ -101,6 +117,18 @@ public:
     assert(!partial_decode_needed);
     return flags;
   }
+  bool has_qos_params() const {
+    assert(!partial_decode_needed);
+    return qos_delta != 0;
+  }
+  uint32_t get_qos_delta() const {
+    assert(!partial_decode_needed);
+    return qos_delta;
+  }
+  uint32_t get_qos_rho() const {
+    assert(!partial_decode_needed);
+    return qos_rho;
+  }
   osd_reqid_t get_reqid() const {
     assert(!partial_decode_needed);
     if (reqid.name != entity_name_t() || reqid.tid != 0) {
@@ -354,14 +382,20 @@ struct ceph_osd_request_head {
       ::encode(features, payload);
     } else {
       // latest v8 encoding with hobject_t hash separate from pgid, no
-      // reassert version
-      header.version = HEAD_VERSION;
+      // reassert version; v9 adds the dmclock qos params.  Peers that
+      // predate mimic can't decode v9, so they get v8 without them.
+      bool qos = qos_delta && HAVE_FEATURE(features, SERVER_MIMIC);
+      header.version = qos ? HEAD_VERSION : 8;
       ::encode(pgid, payload);
       ::encode(hobj.get_hash(), payload);
       ::encode(osdmap_epoch, payload);
       ::encode(flags, payload);
       ::encode(reqid, payload);
       encode_trace(payload, features);
+      if (qos) {
+	::encode(qos_delta, payload);
+	::encode(qos_rho, payload);
+      }
 
       // -- above decoded up front; below decoded post-dispatch thread --
 
@@ -389,7 +423,7 @@ struct ceph_osd_request_head {
     p = payload.begin();
 
     // Always keep here the newest version of decoding order/rule
-    if (header.version == HEAD_VERSION) {
+    if (header.version >= 8) {
       ::decode(pgid, p);      // actual pgid
       uint32_t hash;
       ::decode(hash, p); // raw hash value
@@ -398,6 +432,10 @@ struct ceph_osd_request_head {
       ::decode(flags, p);
       ::decode(reqid, p);
       decode_trace(p);
+      if (header.version >= 9) {
+	::decode(qos_delta, p);
+	::decode(qos_rho, p);
+      }
     } else if (header.version == 7) {
       ::decode(pgid.pgid, p);      // raw pgid
       hobj.set_hash(pgid.pgid.ps());
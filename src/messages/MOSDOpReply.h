@@ -32,7 +32,7 @@
 
 class MOSDOpReply : public Message {
 
-  static const int HEAD_VERSION = 8;
+  static const int HEAD_VERSION = 9;
   static const int COMPAT_VERSION = 2;
 
   object_t oid;
@@ -47,6 +47,7 @@ class MOSDOpReply : public Message {
   int32_t retry_attempt = -1;
   bool do_redirect;
   request_redirect_t redirect;
+  bool qos_reservation = false;  // served in the dmclock reservation phase
 
 public:
   const object_t& get_oid() const { return oid; }
@@ -94,6 +95,8 @@ public:
   const request_redirect_t& get_redirect() const { return redirect; }
   bool is_redirect_reply() const { return do_redirect; }
 
+  bool get_qos_reservation() const { return qos_reservation; }
+
   void add_flags(int f) { flags |= f; }
 
   void claim_op_out_data(vector<OSDOp>& o) {
@@ -141,6 +144,7 @@ public:
     user_version = 0;
     retry_attempt = req->get_retry_attempt();
     do_redirect = false;
+    qos_reservation = req->get_qos_reservation();
 
     // zero out ops payload_len and possibly out data
     for (unsigned i = 0; i < ops.size(); i++) {
@@ -205,6 +209,7 @@ public:
         }
       }
       encode_trace(payload, features);
+      ::encode(qos_reservation, payload);
     }
   }
   void decode_payload() override {
@@ -237,6 +242,7 @@ public:
       if (do_redirect)
 	::decode(redirect, p);
       decode_trace(p);
+      ::decode(qos_reservation, p);
     } else if (header.version < 2) {
       ceph_osd_reply_head head;
       ::decode(head, p);
@@ -299,6 +305,9 @@ public:
       if (header.version >= 8) {
         decode_trace(p);
       }
+      if (header.version >= 9) {
+	::decode(qos_reservation, p);
+      }
     }
   }
 
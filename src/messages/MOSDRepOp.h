@@ -24,7 +24,7 @@
 
 class MOSDRepOp : public MOSDFastDispatchOp {
 
-  static const int HEAD_VERSION = 2;
+  static const int HEAD_VERSION = 3;
   static const int COMPAT_VERSION = 1;
 
 public:
@@ -63,6 +63,9 @@ public:
   /// non-empty if this transaction involves a hit_set history update
   boost::optional<pg_hit_set_history_t> updated_hit_set_history;
 
+  /// chain replication: replicas still to receive this op, in order
+  vector<pg_shard_t> forward_to;
+
   epoch_t get_map_epoch() const override {
     return map_epoch;
   }
@@ -109,6 +112,8 @@ public:
     ::decode(from, p);
     ::decode(updated_hit_set_history, p);
     ::decode(pg_roll_forward_to, p);
+    if (header.version >= 3)
+      ::decode(forward_to, p);
     final_decode_needed = false;
   }
 
@@ -135,6 +140,8 @@ public:
     ::encode(from, payload);
     ::encode(updated_hit_set_history, payload);
     ::encode(pg_roll_forward_to, payload);
+    if (header.version >= 3)
+      ::encode(forward_to, payload);
   }
 
   MOSDRepOp()
@@ -168,6 +175,8 @@ public:
       out << " " << poid << " v " << version;
       if (updated_hit_set_history)
         out << ", has_updated_hit_set_history";
+      if (!forward_to.empty())
+        out << " fwd " << forward_to;
     }
     out << ")";
   }
@@ -0,0 +1,263 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#ifndef CEPH_MGR_CLIENTIOSTATS_H
+#define CEPH_MGR_CLIENTIOSTATS_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "common/Clock.h"
+#include "common/Formatter.h"
+#include "common/Mutex.h"
+#include "include/encoding.h"
+#include "include/utime.h"
+#include "msg/msg_types.h"
+
+/**
+ * Who an op is accounted to: the issuing client within a pool, and the
+ * rbd image when the object is an rbd data object.
+ */
+struct client_io_key_t {
+  int64_t pool = -1;
+  entity_name_t client;
+  std::string image;   ///< rbd image id, or empty
+
+  client_io_key_t() {}
+  client_io_key_t(int64_t pool, const entity_name_t &client,
+		  const std::string &oid)
+    : pool(pool), client(client) {
+    // rbd_data.<id>.<objectno> or rbd_data.<pool>.<id>.<objectno>
+    static const char prefix[] = "rbd_data.";
+    static const size_t plen = sizeof(prefix) - 1;
+    if (oid.compare(0, plen, prefix) == 0) {
+      size_t dot = oid.rfind('.');
+      if (dot > plen)
+	image = oid.substr(plen, dot - plen);
+    }
+  }
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(pool, bl);
+    ::encode(client, bl);
+    ::encode(image, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator &p) {
+    DECODE_START(1, p);
+    ::decode(pool, p);
+    ::decode(client, p);
+    ::decode(image, p);
+    DECODE_FINISH(p);
+  }
+  void dump(Formatter *f) const {
+    f->dump_int("pool", pool);
+    f->dump_stream("client") << client;
+    f->dump_string("image", image);
+  }
+};
+WRITE_CLASS_ENCODER(client_io_key_t)
+
+inline bool operator<(const client_io_key_t &l, const client_io_key_t &r) {
+  if (l.pool != r.pool)
+    return l.pool < r.pool;
+  if (l.client != r.client)
+    return l.client < r.client;
+  return l.image < r.image;
+}
+
+inline std::ostream& operator<<(std::ostream &out, const client_io_key_t &k) {
+  out << k.pool << '/' << k.client;
+  if (!k.image.empty())
+    out << '/' << k.image;
+  return out;
+}
+
+struct client_io_stat_t {
+  uint64_t ops = 0;
+  uint64_t rd_bytes = 0;
+  uint64_t wr_bytes = 0;
+  uint64_t lat_sum_ns = 0;
+  /// sketch weight that may belong to other keys (0 if the counts are exact)
+  uint64_t error = 0;
+
+  void add(const client_io_stat_t &o) {
+    ops += o.ops;
+    rd_bytes += o.rd_bytes;
+    wr_bytes += o.wr_bytes;
+    lat_sum_ns += o.lat_sum_ns;
+    error += o.error;
+  }
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(ops, bl);
+    ::encode(rd_bytes, bl);
+    ::encode(wr_bytes, bl);
+    ::encode(lat_sum_ns, bl);
+    ::encode(error, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator &p) {
+    DECODE_START(1, p);
+    ::decode(ops, p);
+    ::decode(rd_bytes, p);
+    ::decode(wr_bytes, p);
+    ::decode(lat_sum_ns, p);
+    ::decode(error, p);
+    DECODE_FINISH(p);
+  }
+};
+WRITE_CLASS_ENCODER(client_io_stat_t)
+
+/// per-client stats an OSD gathered over one report period
+struct client_io_report_t {
+  utime_t period;
+  std::map<client_io_key_t, client_io_stat_t> stats;
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(period, bl);
+    ::encode(stats, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator &p) {
+    DECODE_START(1, p);
+    ::decode(period, p);
+    ::decode(stats, p);
+    DECODE_FINISH(p);
+  }
+};
+WRITE_CLASS_ENCODER(client_io_report_t)
+
+/**
+ * ClientIOSketch
+ *
+ * Space-saving heavy hitter sketch: at most capacity keys are tracked.
+ * A new key replaces the lightest one and inherits its weight as error,
+ * so any key heavier than total_weight / capacity is always present and
+ * the heaviest keys are ranked correctly.  An op weighs one plus one per
+ * 64KB moved, so bulk streams rank next to small-op storms.
+ */
+class ClientIOSketch {
+  struct Entry {
+    client_io_stat_t stat;
+    uint64_t weight = 0;
+  };
+
+  size_t capacity;
+  std::map<client_io_key_t, Entry> entries;
+  std::set<std::pair<uint64_t, const client_io_key_t*>> by_weight;
+
+public:
+  explicit ClientIOSketch(size_t capacity) : capacity(capacity) {}
+
+  size_t size() const { return entries.size(); }
+
+  void add(const client_io_key_t &key, uint64_t rd_bytes, uint64_t wr_bytes,
+	   uint64_t lat_ns) {
+    if (capacity == 0)
+      return;
+    const uint64_t w = 1 + ((rd_bytes + wr_bytes) >> 16);
+    auto p = entries.find(key);
+    if (p != entries.end()) {
+      by_weight.erase(std::make_pair(p->second.weight, &p->first));
+    } else {
+      uint64_t base = 0;
+      if (entries.size() >= capacity) {
+	auto victim = by_weight.begin();
+	base = victim->first;
+	entries.erase(*victim->second);
+	by_weight.erase(victim);
+      }
+      p = entries.emplace(key, Entry()).first;
+      p->second.weight = base;
+      p->second.stat.error = base;
+    }
+    Entry &e = p->second;
+    e.weight += w;
+    e.stat.ops++;
+    e.stat.rd_bytes += rd_bytes;
+    e.stat.wr_bytes += wr_bytes;
+    e.stat.lat_sum_ns += lat_ns;
+    by_weight.insert(std::make_pair(e.weight, &p->first));
+  }
+
+  void dump_stats(std::map<client_io_key_t, client_io_stat_t> *out) const {
+    for (auto &p : entries)
+      (*out)[p.first].add(p.second.stat);
+  }
+};
+
+/**
+ * ClientIOCollector
+ *
+ * OSD side: sketches striped by key so concurrent op threads rarely
+ * contend.  Each key lives in exactly one stripe, so a report is the
+ * plain union of the stripes.
+ */
+class ClientIOCollector {
+  static const unsigned num_stripes = 8;
+
+  struct Stripe {
+    Mutex lock;
+    std::unique_ptr<ClientIOSketch> sketch;
+    Stripe() : lock("ClientIOCollector::Stripe::lock") {}
+  };
+
+  Stripe stripes[num_stripes];
+  Mutex since_lock;
+  utime_t since;
+
+  static size_t stripe_capacity(size_t capacity) {
+    return (capacity + num_stripes - 1) / num_stripes;
+  }
+
+public:
+  explicit ClientIOCollector(size_t capacity)
+    : since_lock("ClientIOCollector::since_lock"),
+      since(ceph_clock_now()) {
+    for (auto &s : stripes)
+      s.sketch.reset(new ClientIOSketch(stripe_capacity(capacity)));
+  }
+
+  void add(const client_io_key_t &key, uint64_t rd_bytes, uint64_t wr_bytes,
+	   uint64_t lat_ns) {
+    size_t h = std::hash<entity_name_t>()(key.client) ^
+      std::hash<std::string>()(key.image);
+    Stripe &s = stripes[h % num_stripes];
+    Mutex::Locker l(s.lock);
+    s.sketch->add(key, rd_bytes, wr_bytes, lat_ns);
+  }
+
+  /// move everything gathered since the last call into r and start over
+  void swap_out(client_io_report_t *r, utime_t now, size_t capacity) {
+    {
+      Mutex::Locker l(since_lock);
+      r->period = now - since;
+      since = now;
+    }
+    for (auto &s : stripes) {
+      std::unique_ptr<ClientIOSketch> old(
+	new ClientIOSketch(stripe_capacity(capacity)));
+      {
+	Mutex::Locker l(s.lock);
+	old.swap(s.sketch);
+      }
+      old->dump_stats(&r->stats);
+    }
+  }
+};
+
+#endif // CEPH_MGR_CLIENTIOSTATS_H
@@ -14,6 +14,7 @@
 #include "DaemonServer.h"
 
 #include "include/str_list.h"
+#include "include/stringify.h"
 #include "auth/RotatingKeyRing.h"
 #include "json_spirit/json_spirit_writer.h"
 
@@ -29,6 +30,7 @@
 #include "messages/MOSDScrub.h"
 #include "messages/MOSDForceRecovery.h"
 #include "common/errno.h"
+#include "common/TextTable.h"
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_mgr
@@ -404,6 +406,8 @@ bool DaemonServer::handle_report(MMgrReport *m)
   {
     Mutex::Locker l(daemon->lock);
     daemon_counters.update(m);
+    daemon->client_io = std::move(m->client_io);
+    daemon->client_io_stamp = ceph_clock_now();
   }
   // if there are any schema updates, notify the python modules
   if (!m->declare_types.empty() || !m->undeclare_types.empty()) {
@@ -925,6 +929,124 @@ bool DaemonServer::handle_command(MCommand *m)
       });
     cmdctx->reply(r, "");
     return true;
+  } else if (prefix == "osd client io top") {
+    string by;
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "by", by, string("ops"));
+    int64_t count;
+    cmd_getval(g_ceph_context, cmdctx->cmdmap, "count", count, int64_t(10));
+
+    // a client's ops are spread over many OSDs, each reporting over its
+    // own period, so sum per-OSD rates rather than raw counts
+    struct client_rate_t {
+      double ops = 0, rd_bytes = 0, wr_bytes = 0;
+      uint64_t total_ops = 0, lat_sum_ns = 0;
+      bool approx = false;
+      double avg_lat_ms() const {
+	return total_ops ? (double)lat_sum_ns / total_ops / 1000000.0 : 0;
+      }
+    };
+    map<client_io_key_t, client_rate_t> rates;
+    unsigned reporting = 0;
+    utime_t cutoff = ceph_clock_now();
+    cutoff -= g_conf->mgr_stats_period * 3.0;
+    for (auto& p : daemon_state.get_by_service("osd")) {
+      auto& daemon = p.second;
+      Mutex::Locker l(daemon->lock);
+      if (!daemon->client_io || daemon->client_io_stamp < cutoff)
+	continue;
+      ++reporting;
+      double period = daemon->client_io->period;
+      if (period <= 0)
+	continue;
+      for (auto& q : daemon->client_io->stats) {
+	auto& r = rates[q.first];
+	r.ops += q.second.ops / period;
+	r.rd_bytes += q.second.rd_bytes / period;
+	r.wr_bytes += q.second.wr_bytes / period;
+	r.total_ops += q.second.ops;
+	r.lat_sum_ns += q.second.lat_sum_ns;
+	r.approx |= q.second.error > 0;
+      }
+    }
+
+    typedef map<client_io_key_t, client_rate_t>::value_type entry_t;
+    vector<const entry_t*> top;
+    top.reserve(rates.size());
+    for (auto& p : rates)
+      top.push_back(&p);
+    std::function<double(const client_rate_t&)> metric;
+    if (by == "bytes") {
+      metric = [](const client_rate_t& r) { return r.rd_bytes + r.wr_bytes; };
+    } else if (by == "latency") {
+      metric = [](const client_rate_t& r) { return r.avg_lat_ms(); };
+    } else {
+      metric = [](const client_rate_t& r) { return r.ops; };
+    }
+    size_t n = std::min<size_t>(count, top.size());
+    std::partial_sort(top.begin(), top.begin() + n, top.end(),
+		      [&](const entry_t *a, const entry_t *b) {
+			return metric(a->second) > metric(b->second);
+		      });
+    top.resize(n);
+
+    map<int64_t,string> pool_names;
+    cluster_state.with_osdmap([&](const OSDMap& osdmap) {
+	for (auto p : top) {
+	  if (osdmap.have_pg_pool(p->first.pool))
+	    pool_names[p->first.pool] = osdmap.get_pool_name(p->first.pool);
+	}
+      });
+
+    if (f) {
+      f->open_object_section("client_io");
+      f->dump_unsigned("reporting_osds", reporting);
+      f->open_array_section("clients");
+      for (auto p : top) {
+	f->open_object_section("client");
+	p->first.dump(f.get());
+	f->dump_string("pool_name", pool_names[p->first.pool]);
+	f->dump_float("ops_per_sec", p->second.ops);
+	f->dump_float("rd_bytes_per_sec", p->second.rd_bytes);
+	f->dump_float("wr_bytes_per_sec", p->second.wr_bytes);
+	f->dump_float("avg_latency_ms", p->second.avg_lat_ms());
+	f->dump_bool("approx", p->second.approx);
+	f->close_section();
+      }
+      f->close_section();
+      f->close_section();
+      f->flush(cmdctx->odata);
+    } else {
+      TextTable tbl;
+      tbl.define_column("POOL", TextTable::LEFT, TextTable::LEFT);
+      tbl.define_column("CLIENT", TextTable::LEFT, TextTable::LEFT);
+      tbl.define_column("IMAGE", TextTable::LEFT, TextTable::LEFT);
+      tbl.define_column("OPS/s", TextTable::LEFT, TextTable::RIGHT);
+      tbl.define_column("RD/s", TextTable::LEFT, TextTable::RIGHT);
+      tbl.define_column("WR/s", TextTable::LEFT, TextTable::RIGHT);
+      tbl.define_column("LAT(ms)", TextTable::LEFT, TextTable::RIGHT);
+      for (auto p : top) {
+	std::ostringstream client;
+	client << p->first.client;
+	if (p->second.approx)
+	  client << '*';
+	tbl << pool_names[p->first.pool]
+	    << client.str()
+	    << p->first.image
+	    << (uint64_t)p->second.ops
+	    << prettybyte_t((uint64_t)p->second.rd_bytes)
+	    << prettybyte_t((uint64_t)p->second.wr_bytes)
+	    << p->second.avg_lat_ms()
+	    << TextTable::endrow;
+      }
+      cmdctx->odata.append(stringify(tbl));
+      if (reporting == 0)
+	ss << "no OSD is reporting client stats; set osd_client_io_stats";
+      else if (any_of(top.begin(), top.end(),
+		      [](const entry_t *p) { return p->second.approx; }))
+	ss << "* counts may include other clients' ops";
+    }
+    cmdctx->reply(0, ss);
+    return true;
   } else if (prefix == "osd safe-to-destroy") {
     vector<string> ids;
     cmd_getval(g_ceph_context, cmdctx->cmdmap, "ids", ids);
@@ -127,14 +127,24 @@ void DaemonPerfCounters::update(MMgrReport *report)
   for (const auto &t : report->undeclare_types) {
     declared_types.erase(t);
   }
+  if (!report->declare_types.empty() ||
+      !report->undeclare_types.empty() ||
+      decode_order.size() != declared_types.size()) {
+    decode_order.clear();
+    decode_order.reserve(declared_types.size());
+    for (const auto &t_path : declared_types) {
+      decode_order.push_back(std::make_pair(&types.at(t_path),
+					    &instances[t_path]));
+    }
+  }
 
   const auto now = ceph_clock_now();
 
   // Parse packed data according to declared set of types
   bufferlist::iterator p = report->packed.begin();
   DECODE_START(1, p);
-  for (const auto &t_path : declared_types) {
-    const auto &t = types.at(t_path);
+  for (const auto &i : decode_order) {
+    const auto &t = *i.first;
     uint64_t val = 0;
     uint64_t avgcount = 0;
     uint64_t avgcount2 = 0;
@@ -145,7 +155,7 @@ void DaemonPerfCounters::update(MMgrReport *report)
       ::decode(avgcount2, p);
     }
     // TODO: interface for insertion of avgs
-    instances[t_path].push(now, val);
+    i.second->push(now, val);
   }
   DECODE_FINISH(p);
 }
@@ -18,6 +18,7 @@
 #include <string>
 #include <memory>
 #include <set>
+#include <vector>
 #include <boost/circular_buffer.hpp>
 
 #include "common/Mutex.h"
@@ -80,12 +81,19 @@ class DaemonPerfCounters
   // inside DaemonServer instead of stashing session-ish state here?
   std::set<std::string> declared_types;
 
+  // declared_types in order, resolved to their type and instance so
+  // that update() does not look each counter up by path.  Rebuilt
+  // whenever the schema changes.
+  std::vector<std::pair<const PerfCounterType*, PerfCounterInstance*>>
+    decode_order;
+
   void update(MMgrReport *report);
 
   void clear()
   {
     instances.clear();
     declared_types.clear();
+    decode_order.clear();
   }
 };
 
@@ -113,6 +121,10 @@ class DaemonState
   // The perf counters received in MMgrReport messages
   DaemonPerfCounters perf_counters;
 
+  // Per-client op stats from the latest report, if the daemon sent any
+  boost::optional<client_io_report_t> client_io;
+  utime_t client_io_stamp;
+
   DaemonState(PerfCounterTypes &types_)
     : perf_counters(types_)
   {
@@ -228,20 +228,21 @@ void MgrClient::send_report()
         const PerfCountersCollection::CounterMap &by_path)
   {
     ENCODE_START(1, 1, report->packed);
-    for (auto p = session->declared.begin(); p != session->declared.end(); ) {
-      if (by_path.count(*p) == 0) {
-	report->undeclare_types.push_back(*p);
-	ldout(cct,20) << __func__ << " undeclare " << *p << dendl;
-	p = session->declared.erase(p);
-      } else {
-	++p;
-      }
-    }
+    // by_path and declared are both sorted by path: walk them together
+    // instead of looking every counter up in the other
+    auto d = session->declared.begin();
     for (const auto &i : by_path) {
       auto& path = i.first;
       auto& data = *(i.second);
 
-      if (session->declared.count(path) == 0) {
+      while (d != session->declared.end() && *d < path) {
+	report->undeclare_types.push_back(*d);
+	ldout(cct,20) << __func__ << " undeclare " << *d << dendl;
+	d = session->declared.erase(d);
+      }
+      if (d != session->declared.end() && *d == path) {
+	++d;
+      } else {
 	ldout(cct,20) << __func__ << " declare " << path << dendl;
 	PerfCounterType type;
 	type.path = path;
@@ -253,15 +254,23 @@ void MgrClient::send_report()
 	}
 	type.type = data.type;
 	report->declare_types.push_back(std::move(type));
-	session->declared.insert(path);
+	session->declared.insert(d, path);
       }
 
-      ::encode(static_cast<uint64_t>(data.u64), report->packed);
       if (data.type & PERFCOUNTER_LONGRUNAVG) {
-        ::encode(static_cast<uint64_t>(data.avgcount), report->packed);
-        ::encode(static_cast<uint64_t>(data.avgcount2), report->packed);
+        std::pair<uint64_t,uint64_t> a = data.read_avg();
+        ::encode(a.first, report->packed);
+        ::encode(a.second, report->packed);
+        ::encode(a.second, report->packed);
+      } else {
+        ::encode(data.read_u64(), report->packed);
       }
     }
+    while (d != session->declared.end()) {
+      report->undeclare_types.push_back(*d);
+      ldout(cct,20) << __func__ << " undeclare " << *d << dendl;
+      d = session->declared.erase(d);
+    }
     ENCODE_FINISH(report->packed);
 
     ldout(cct, 20) << by_path.size() << " counters, of which "
@@ -282,6 +291,13 @@ void MgrClient::send_report()
     daemon_dirty_status = false;
   }
 
+  if (client_io_cb) {
+    client_io_report_t client_io;
+    if (client_io_cb(&client_io)) {
+      report->client_io = std::move(client_io);
+    }
+  }
+
   session->con->send_message(report);
 
   if (stats_period != 0) {
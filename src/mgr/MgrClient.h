@@ -28,6 +28,7 @@ class MMgrConfigure;
 class Messenger;
 class MCommandReply;
 class MPGStats;
+struct client_io_report_t;
 
 class MgrSessionState
 {
@@ -72,6 +73,10 @@ protected:
   // our reports (hook for use by OSD)
   std::function<MPGStats*()> pgstats_cb;
 
+  // If provided, use this to fill in per-client op stats for our
+  // reports; returns false if there is nothing to send (hook for OSD)
+  std::function<bool(client_io_report_t*)> client_io_cb;
+
   // for service registration and beacon
   bool service_daemon = false;
   bool daemon_dirty_status = false;
@@ -108,6 +113,12 @@ public:
     pgstats_cb = cb_;
   }
 
+  void set_client_io_cb(std::function<bool(client_io_report_t*)> cb_)
+  {
+    Mutex::Locker l(lock);
+    client_io_cb = cb_;
+  }
+
   int start_command(const vector<string>& cmd, const bufferlist& inbl,
 		    bufferlist *outbl, string *outs,
 		    Context *onfinish);
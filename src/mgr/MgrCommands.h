@@ -68,6 +68,11 @@ COMMAND("osd perf", \
         "osd", \
         "r", \
         "cli,rest")
+COMMAND("osd client io top " \
+	"name=by,type=CephChoices,strings=ops|bytes|latency,req=false " \
+	"name=count,type=CephInt,range=1,req=false", \
+	"show the busiest clients by ops/s, bytes/s or mean latency " \
+	"(needs osd_client_io_stats)", "osd", "r", "cli,rest")
 COMMAND("osd df " \
 	"name=output_method,type=CephChoices,strings=plain|tree,req=false", \
 	"show OSD utilization", "osd", "r", "cli,rest")
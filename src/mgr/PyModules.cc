@@ -15,6 +15,8 @@
 #include "PyState.h"
 #include "Gil.h"
 
+#include <algorithm>
+
 #include "common/errno.h"
 #include "include/stringify.h"
 
@@ -765,6 +767,90 @@ PyObject* PyModules::get_perf_schema_python(
   return f.get();
 }
 
+/*
+ * Latest value of every perf counter of every daemon, already in the
+ * Prometheus text exposition format.  Built without the GIL and
+ * without creating a Python object per value, so a scrape of a large
+ * cluster does not stall the other modules.
+ */
+PyObject* PyModules::get_perf_counters_expfmt_python(
+    const std::string &handle)
+{
+  struct metric_t {
+    std::string name;   ///< path with illegal characters replaced
+    const char *type;
+    std::string description;
+    std::string samples;
+  };
+  std::map<std::string, metric_t> metrics;
+  std::string out;
+
+  PyThreadState *tstate = PyEval_SaveThread();
+  {
+    Mutex::Locker l(lock);
+
+    auto states = daemon_state.get_all();
+    for (const auto &statepair : states) {
+      const auto &key = statepair.first;
+      auto state = statepair.second;
+      const std::string daemon = key.first + "." + key.second;
+      Mutex::Locker l2(state->lock);
+
+      for (const auto &i : state->perf_counters.decode_order) {
+	const PerfCounterType &type = *i.first;
+	const char *mtype;
+	// no histograms; averages only carry their sum here, so they
+	// are reported as counters
+	switch (type.type & ~PERFCOUNTER_U64) {
+	case 0:
+	  mtype = "gauge";
+	  break;
+	case PERFCOUNTER_LONGRUNAVG:
+	case PERFCOUNTER_COUNTER:
+	  mtype = "counter";
+	  break;
+	default:
+	  continue;
+	}
+	const auto &data = i.second->get_data();
+	uint64_t v = data.empty() ? 0 : data.back().v;
+
+	auto p = metrics.find(type.path);
+	if (p == metrics.end()) {
+	  p = metrics.insert(std::make_pair(type.path, metric_t())).first;
+	  p->second.name = type.path;
+	  std::replace(p->second.name.begin(), p->second.name.end(), '.', '_');
+	  std::replace(p->second.name.begin(), p->second.name.end(), '-', '_');
+	  p->second.type = mtype;
+	  p->second.description = type.description;
+	}
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+	auto &samples = p->second.samples;
+	samples += "\n";
+	samples += p->second.name;
+	samples += "{daemon=\"";
+	samples += daemon;
+	samples += "\"} ";
+	samples += buf;
+      }
+    }
+  }
+
+  for (const auto &i : metrics) {
+    const auto &m = i.second;
+    out += "\n# HELP " + m.name + " " + m.description;
+    out += "\n# TYPE " + m.name + " " + m.type;
+    out += m.samples;
+  }
+  out += "\n";
+  dout(20) << __func__ << " " << metrics.size() << " metrics, "
+	   << out.size() << " bytes" << dendl;
+  PyEval_RestoreThread(tstate);
+
+  return PyString_FromStringAndSize(out.data(), out.size());
+}
+
 PyObject *PyModules::get_context()
 {
   PyThreadState *tstate = PyEval_SaveThread();
@@ -82,6 +82,7 @@ public:
      const std::string &handle,
      const std::string svc_type,
      const std::string &svc_id);
+  PyObject *get_perf_counters_expfmt_python(const std::string &handle);
   PyObject *get_context();
 
   std::map<std::string, std::string> config_cache;
@@ -452,6 +452,17 @@ get_perf_schema(PyObject *self, PyObject *args)
   return global_handle->get_perf_schema_python(handle, type_str, svc_id);
 }
 
+static PyObject*
+get_perf_counters_expfmt(PyObject *self, PyObject *args)
+{
+  char *handle = nullptr;
+  if (!PyArg_ParseTuple(args, "s:get_perf_counters_expfmt", &handle)) {
+    return nullptr;
+  }
+
+  return global_handle->get_perf_counters_expfmt_python(handle);
+}
+
 PyMethodDef CephStateMethods[] = {
     {"get", ceph_state_get, METH_VARARGS,
      "Get a cluster object"},
@@ -477,6 +488,8 @@ PyMethodDef CephStateMethods[] = {
       "Get a performance counter"},
     {"get_perf_schema", get_perf_schema, METH_VARARGS,
       "Get the performance counter schema"},
+    {"get_perf_counters_expfmt", get_perf_counters_expfmt, METH_VARARGS,
+      "Get the latest performance counters in Prometheus text format"},
     {"log", ceph_log, METH_VARARGS,
      "Emit a (local) log message"},
     {"get_version", ceph_get_version, METH_VARARGS,
@@ -135,6 +135,8 @@ Monitor::Monitor(CephContext* cct_, string nm, MonitorDBStore *s,
   timer(cct_, lock),
   finisher(cct_, "mon_finisher", "fin"),
   cpu_tp(cct, "Monitor::cpu_tp", "cpu_tp", g_conf->mon_cpu_threads),
+  cmd_tp(cct, "Monitor::cmd_tp", "cmd_tp", g_conf->mon_command_threads),
+  cmd_wq("mon_cmd_wq", 0, &cmd_tp),
   has_ever_joined(false),
   logger(NULL), cluster_logger(NULL), cluster_logger_registered(false),
   monmap(map),
@@ -787,6 +789,7 @@ int Monitor::init()
   new_tick();
 
   cpu_tp.start();
+  cmd_tp.start();
 
   // i'm ready!
   messenger->add_dispatcher_tail(this);
@@ -900,6 +903,9 @@ void Monitor::shutdown()
   mgr_client.shutdown();
 
   lock.Unlock();
+  // queued command replies take the lock to send
+  cmd_tp.drain();
+  cmd_tp.stop();
   finisher.wait_for_empty();
   finisher.stop();
   lock.Lock();
@@ -3657,6 +3663,24 @@ void Monitor::reply_command(MonOpRequestRef op, int rc, const string &rs,
   send_reply(op, reply);
 }
 
+bool Monitor::queue_readonly_command(MonOpRequestRef op, version_t version,
+				     ReadOnlyCommandFn&& fn)
+{
+  if (cmd_tp.get_num_threads() == 0)
+    return false;
+  op->mark_event("queued for cmd_tp");
+  cmd_wq.queue(make_gen_lambda_context<ThreadPool::TPHandle&>(
+    [this, op, version, fn](ThreadPool::TPHandle&) {
+      op->mark_event("formatting reply");
+      string rs;
+      bufferlist rdata;
+      int r = fn(&rs, &rdata);
+      Mutex::Locker l(lock);
+      reply_command(op, r, rs, rdata, version);
+    }).release());
+  return true;
+}
+
 
 // ------------------------
 // request/reply routing
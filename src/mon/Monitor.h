@@ -137,6 +137,8 @@ public:
   SafeTimer timer;
   Finisher finisher;
   ThreadPool cpu_tp;  ///< threadpool for CPU intensive work
+  ThreadPool cmd_tp;  ///< threadpool for formatting read-only command replies
+  GenContextWQ cmd_wq;
   
   /// true if we have ever joined a quorum.  if false, we are either a
   /// new cluster, a newly joining monitor, or a just-upgraded
@@ -761,6 +763,17 @@ public:
   void reply_command(MonOpRequestRef op, int rc, const string &rs, version_t version);
   void reply_command(MonOpRequestRef op, int rc, const string &rs, bufferlist& rdata, version_t version);
 
+  /// builds a reply from a private snapshot; must not touch monitor state
+  typedef std::function<int(string *rs, bufferlist *rdata)> ReadOnlyCommandFn;
+  /**
+   * Run fn on cmd_tp and reply to op (as of version) when it completes,
+   * so that formatting large outputs does not hold the monitor lock.
+   *
+   * @return false if offloading is disabled; the caller should reply inline
+   */
+  bool queue_readonly_command(MonOpRequestRef op, version_t version,
+			      ReadOnlyCommandFn&& fn);
+
 
   void handle_probe(MonOpRequestRef op);
   /**
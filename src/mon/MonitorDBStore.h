@@ -26,12 +26,24 @@
 #include "include/assert.h"
 #include "common/Formatter.h"
 #include "common/Finisher.h"
+#include "common/Mutex.h"
 #include "common/errno.h"
+#include "common/perf_counters.h"
 #include "common/debug.h"
 #include "common/safe_io.h"
 
 #define dout_context g_ceph_context
 
+enum {
+  l_mon_store_first = 45900,
+  l_mon_store_apply,
+  l_mon_store_apply_lat,
+  l_mon_store_commit,
+  l_mon_store_commit_lat,
+  l_mon_store_commit_txns,
+  l_mon_store_last,
+};
+
 class MonitorDBStore
 {
   string path;
@@ -260,9 +272,17 @@ class MonitorDBStore
     }
   };
 
-  int apply_transaction(MonitorDBStore::TransactionRef t) {
-    KeyValueDB::Transaction dbt = db->get_transaction();
+private:
+  /// transactions queued for the next group commit
+  Mutex group_lock;
+  list<pair<TransactionRef, Context*> > group_pending;
+  bool group_queued;
+
+  PerfCounters *logger;
 
+  void _append_transaction(MonitorDBStore::TransactionRef t,
+			   KeyValueDB::Transaction dbt,
+			   list<pair<string, pair<string,string> > > *compact) {
     if (do_dump) {
       if (!g_conf->mon_debug_dump_json) {
         bufferlist bl;
@@ -275,7 +295,6 @@ class MonitorDBStore
       }
     }
 
-    list<pair<string, pair<string,string> > > compact;
     for (list<Op>::const_iterator it = t->ops.begin();
 	 it != t->ops.end();
 	 ++it) {
@@ -288,7 +307,7 @@ class MonitorDBStore
 	dbt->rmkey(op.prefix, op.key);
 	break;
       case Transaction::OP_COMPACT:
-	compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
+	compact->push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
 	break;
       default:
 	derr << __func__ << " unknown op type " << op.type << dendl;
@@ -296,6 +315,10 @@ class MonitorDBStore
 	break;
       }
     }
+  }
+
+  int _submit_transaction(KeyValueDB::Transaction dbt,
+			  list<pair<string, pair<string,string> > >& compact) {
     int r = db->submit_transaction_sync(dbt);
     if (r >= 0) {
       while (!compact.empty()) {
@@ -312,6 +335,74 @@ class MonitorDBStore
     return r;
   }
 
+  static void _inject_transaction_delay() {
+    /* The store serializes writes.  Each transaction is handled
+     * sequentially by the io_work Finisher.  If a transaction takes longer
+     * to apply its state to permanent storage, then no other transaction
+     * will be handled meanwhile.
+     *
+     * We will now randomly inject random delays.  We can safely sleep prior
+     * to applying the transaction as it won't break the model.
+     */
+    double delay_prob = g_conf->mon_inject_transaction_delay_probability;
+    if (delay_prob && (rand() % 10000 < delay_prob * 10000.0)) {
+      utime_t delay;
+      double delay_max = g_conf->mon_inject_transaction_delay_max;
+      delay.set_from_double(delay_max * (double)(rand() % 10000) / 10000.0);
+      lsubdout(g_ceph_context, mon, 1)
+        << "apply_transaction will be delayed for " << delay
+        << " seconds" << dendl;
+      delay.sleep();
+    }
+  }
+
+  /**
+   * Write everything queued so far as a single KeyValueDB transaction,
+   * i.e. one sync, then complete each caller in queue order.  Ops are
+   * applied in the order they were queued, so a later transaction
+   * still overrides an earlier one touching the same key.
+   */
+  void _group_commit() {
+    list<pair<TransactionRef, Context*> > ls;
+    {
+      Mutex::Locker l(group_lock);
+      ls.swap(group_pending);
+      group_queued = false;
+    }
+    if (ls.empty())
+      return;
+
+    utime_t start = ceph_clock_now();
+    KeyValueDB::Transaction dbt = db->get_transaction();
+    list<pair<string, pair<string,string> > > compact;
+    for (auto& p : ls) {
+      _append_transaction(p.first, dbt, &compact);
+    }
+    int r = _submit_transaction(dbt, compact);
+    if (logger) {
+      logger->inc(l_mon_store_commit);
+      logger->inc(l_mon_store_commit_txns, ls.size());
+      logger->tinc(l_mon_store_commit_lat, ceph_clock_now() - start);
+    }
+    for (auto& p : ls) {
+      p.second->complete(r);
+    }
+  }
+
+public:
+  int apply_transaction(MonitorDBStore::TransactionRef t) {
+    utime_t start = ceph_clock_now();
+    KeyValueDB::Transaction dbt = db->get_transaction();
+    list<pair<string, pair<string,string> > > compact;
+    _append_transaction(t, dbt, &compact);
+    int r = _submit_transaction(dbt, compact);
+    if (logger) {
+      logger->inc(l_mon_store_apply);
+      logger->tinc(l_mon_store_apply_lat, ceph_clock_now() - start);
+    }
+    return r;
+  }
+
   struct C_DoTransaction : public Context {
     MonitorDBStore *store;
     MonitorDBStore::TransactionRef t;
@@ -321,38 +412,43 @@ class MonitorDBStore
       : store(s), t(t), oncommit(f)
     {}
     void finish(int r) override {
-      /* The store serializes writes.  Each transaction is handled
-       * sequentially by the io_work Finisher.  If a transaction takes longer
-       * to apply its state to permanent storage, then no other transaction
-       * will be handled meanwhile.
-       *
-       * We will now randomly inject random delays.  We can safely sleep prior
-       * to applying the transaction as it won't break the model.
-       */
-      double delay_prob = g_conf->mon_inject_transaction_delay_probability;
-      if (delay_prob && (rand() % 10000 < delay_prob * 10000.0)) {
-        utime_t delay;
-        double delay_max = g_conf->mon_inject_transaction_delay_max;
-        delay.set_from_double(delay_max * (double)(rand() % 10000) / 10000.0);
-        lsubdout(g_ceph_context, mon, 1)
-          << "apply_transaction will be delayed for " << delay
-          << " seconds" << dendl;
-        delay.sleep();
-      }
+      _inject_transaction_delay();
       int ret = store->apply_transaction(t);
       oncommit->complete(ret);
     }
   };
 
+  struct C_DoGroupCommit : public Context {
+    MonitorDBStore *store;
+    explicit C_DoGroupCommit(MonitorDBStore *s) : store(s) {}
+    void finish(int r) override {
+      _inject_transaction_delay();
+      store->_group_commit();
+    }
+  };
+
   /**
    * queue transaction
    *
    * Queue a transaction to commit asynchronously.  Trigger a context
    * on completion (without any locks held).
+   *
+   * With mon_store_group_commit, transactions queued while an earlier
+   * one is still being written are merged into a single write, and a
+   * context is only triggered once its transaction is durable.
    */
   void queue_transaction(MonitorDBStore::TransactionRef t,
 			 Context *oncommit) {
-    io_work.queue(new C_DoTransaction(this, t, oncommit));
+    if (!g_conf->mon_store_group_commit) {
+      io_work.queue(new C_DoTransaction(this, t, oncommit));
+      return;
+    }
+    Mutex::Locker l(group_lock);
+    group_pending.push_back(make_pair(t, oncommit));
+    if (!group_queued) {
+      group_queued = true;
+      io_work.queue(new C_DoGroupCommit(this));
+    }
   }
 
   /**
@@ -640,6 +736,7 @@ class MonitorDBStore
     r = db->open(out);
     if (r < 0)
       return r;
+    _create_logger();
     io_work.start();
     is_open = true;
     return 0;
@@ -659,6 +756,7 @@ class MonitorDBStore
     r = db->create_and_open(out);
     if (r < 0)
       return r;
+    _create_logger();
     io_work.start();
     is_open = true;
     return 0;
@@ -668,9 +766,31 @@ class MonitorDBStore
     // there should be no work queued!
     io_work.stop();
     is_open = false;
+    if (logger) {
+      g_ceph_context->get_perfcounters_collection()->remove(logger);
+      delete logger;
+      logger = nullptr;
+    }
     db.reset(NULL);
   }
 
+  void _create_logger() {
+    PerfCountersBuilder b(g_ceph_context, "mon_store",
+			  l_mon_store_first, l_mon_store_last);
+    b.add_u64_counter(l_mon_store_apply, "apply",
+		      "Synchronous transactions applied");
+    b.add_time_avg(l_mon_store_apply_lat, "apply_latency",
+		   "Synchronous transaction apply latency");
+    b.add_u64_counter(l_mon_store_commit, "commit",
+		      "Group commits written");
+    b.add_time_avg(l_mon_store_commit_lat, "commit_latency",
+		   "Group commit write latency");
+    b.add_u64_counter(l_mon_store_commit_txns, "commit_txns",
+		      "Queued transactions written by group commits");
+    logger = b.create_perf_counters();
+    g_ceph_context->get_perfcounters_collection()->add(logger);
+  }
+
   void compact() {
     db->compact();
   }
@@ -741,7 +861,10 @@ class MonitorDBStore
       dump_fd_binary(-1),
       dump_fmt(true),
       io_work(g_ceph_context, "monstore", "fn_monstore"),
-      is_open(false) {
+      is_open(false),
+      group_lock("MonitorDBStore::group_lock"),
+      group_queued(false),
+      logger(nullptr) {
   }
   ~MonitorDBStore() {
     assert(!is_open);
@@ -340,6 +340,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     assert(latest_bl.length() != 0);
     dout(7) << __func__ << " loading latest full map e" << latest_full << dendl;
     osdmap.decode(latest_bl);
+    mapping_full_epoch = osdmap.get_epoch();
   }
 
   if (mon->monmap->get_required_features().contains_all(
@@ -382,6 +383,14 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     err = osdmap.apply_incremental(inc);
     assert(err == 0);
 
+    // remember which pools' mappings this epoch may have changed
+    set<int64_t> changed_pools;
+    if (inc.get_affected_pools(&changed_pools)) {
+      mapping_changed_pools[osdmap.epoch].swap(changed_pools);
+    } else {
+      mapping_full_epoch = osdmap.epoch;
+    }
+
     if (!t)
       t.reset(new MonitorDBStore::Transaction);
 
@@ -414,6 +423,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 	     << dendl;
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	mapping_full_epoch = osdmap.epoch;
       }
     } else {
       assert(!inc.have_crc);
@@ -512,8 +522,17 @@ void OSDMonitor::start_mapping()
   }
   if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
-    mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf->mon_osd_mapping_pgs_per_chunk);
+    set<int64_t> pools;
+    if (_get_mapping_changed_pools(&pools)) {
+      dout(10) << __func__ << " remapping pools " << pools << " since e"
+	       << mapping.get_epoch() << dendl;
+      mapping_job = mapping.start_update(osdmap, mapper,
+					 g_conf->mon_osd_mapping_pgs_per_chunk,
+					 pools);
+    } else {
+      mapping_job = mapping.start_update(osdmap, mapper,
+					 g_conf->mon_osd_mapping_pgs_per_chunk);
+    }
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
 	     << " at " << fin->start << dendl;
     mapping_job->set_finish_event(fin);
@@ -523,6 +542,29 @@ void OSDMonitor::start_mapping()
   }
 }
 
+bool OSDMonitor::_get_mapping_changed_pools(set<int64_t> *pools)
+{
+  epoch_t from = mapping.get_epoch();
+  // forget the epochs the mapping already reflects
+  mapping_changed_pools.erase(mapping_changed_pools.begin(),
+			      mapping_changed_pools.upper_bound(from));
+  if (!g_conf->mon_osd_mapping_incremental ||
+      from == 0 ||
+      from > osdmap.get_epoch() ||
+      mapping_full_epoch > from) {
+    return false;
+  }
+  for (epoch_t e = from + 1; e <= osdmap.get_epoch(); ++e) {
+    auto p = mapping_changed_pools.find(e);
+    if (p == mapping_changed_pools.end()) {
+      // we did not see this incremental
+      return false;
+    }
+    pools->insert(p->second.begin(), p->second.end());
+  }
+  return true;
+}
+
 void OSDMonitor::update_msgr_features()
 {
   set<int> types;
@@ -2164,6 +2206,16 @@ bool OSDMonitor::preprocess_boot(MonOpRequestRef op)
     goto ignore;
   }
 
+  if (osdmap.require_osd_release >= CEPH_RELEASE_MIMIC &&
+      !HAVE_FEATURE(m->osd_features, SERVER_MIMIC)) {
+    mon->clog->info() << "disallowing boot of OSD "
+		      << m->get_orig_source_inst()
+		      << " because the osdmap requires"
+		      << " CEPH_FEATURE_SERVER_MIMIC"
+		      << " but the osd lacks CEPH_FEATURE_SERVER_MIMIC";
+    goto ignore;
+  }
+
   if (osdmap.test_flag(CEPH_OSDMAP_SORTBITWISE) &&
       !(m->osd_features & CEPH_FEATURE_OSD_BITWISE_HOBJ_SORT)) {
     mon->clog->info() << "disallowing boot of OSD "
@@ -2194,6 +2246,18 @@ bool OSDMonitor::preprocess_boot(MonOpRequestRef op)
     }
   }
 
+  if (any_of(osdmap.get_pools().begin(),
+	     osdmap.get_pools().end(),
+	     [](const std::pair<int64_t,pg_pool_t>& pool)
+	     { return pool.second.has_flag(pg_pool_t::FLAG_CHAIN_REPLICATION); }) &&
+      !HAVE_FEATURE(m->osd_features, SERVER_MIMIC)) {
+    mon->clog->info() << "disallowing boot of OSD "
+		      << m->get_orig_source_inst()
+		      << " because one or more pools use chain replication"
+		      << " and the osd lacks CEPH_FEATURE_SERVER_MIMIC";
+    goto ignore;
+  }
+
   // make sure upgrades stop at luminous
   if (HAVE_FEATURE(m->osd_features, SERVER_MIMIC) &&
       osdmap.require_osd_release < CEPH_RELEASE_LUMINOUS) {
@@ -3847,7 +3911,7 @@ namespace {
     SIZE, MIN_SIZE, CRASH_REPLAY_INTERVAL,
     PG_NUM, PGP_NUM, CRUSH_RULE, HASHPSPOOL,
     NODELETE, NOPGCHANGE, NOSIZECHANGE,
-    WRITE_FADVISE_DONTNEED, NOSCRUB, NODEEP_SCRUB,
+    WRITE_FADVISE_DONTNEED, NOSCRUB, NODEEP_SCRUB, CHAIN_REPLICATION,
     HIT_SET_TYPE, HIT_SET_PERIOD, HIT_SET_COUNT, HIT_SET_FPP,
     USE_GMT_HITSET, AUID, TARGET_MAX_OBJECTS, TARGET_MAX_BYTES,
     CACHE_TARGET_DIRTY_RATIO, CACHE_TARGET_DIRTY_HIGH_RATIO,
@@ -3875,6 +3939,70 @@ namespace {
 }
 
 
+// "osd dump" and "osd tree" only read the given map, so they can be
+// formatted off the monitor lock from a decoded copy.
+static int format_osdmap_command(const OSDMap& osdmap, const string& prefix,
+				 const map<string, cmd_vartype>& cmdmap,
+				 Formatter *f, stringstream *ss,
+				 bufferlist *rdata)
+{
+  stringstream ds;
+  if (prefix == "osd dump") {
+    if (f) {
+      f->open_object_section("osdmap");
+      osdmap.dump(f);
+      f->close_section();
+      f->flush(*rdata);
+    } else {
+      osdmap.print(ds);
+    }
+  } else if (prefix == "osd tree") {
+    vector<string> states;
+    cmd_getval(g_ceph_context, cmdmap, "states", states);
+    unsigned filter = 0;
+    for (auto& s : states) {
+      if (s == "up") {
+	filter |= OSDMap::DUMP_UP;
+      } else if (s == "down") {
+	filter |= OSDMap::DUMP_DOWN;
+      } else if (s == "in") {
+	filter |= OSDMap::DUMP_IN;
+      } else if (s == "out") {
+	filter |= OSDMap::DUMP_OUT;
+      } else if (s == "destroyed") {
+	filter |= OSDMap::DUMP_DESTROYED;
+      } else {
+	*ss << "unrecognized state '" << s << "'";
+	return -EINVAL;
+      }
+    }
+    if ((filter & (OSDMap::DUMP_IN|OSDMap::DUMP_OUT)) ==
+	(OSDMap::DUMP_IN|OSDMap::DUMP_OUT)) {
+      *ss << "cannot specify both 'in' and 'out'";
+      return -EINVAL;
+    }
+    if (((filter & (OSDMap::DUMP_UP|OSDMap::DUMP_DOWN)) ==
+	 (OSDMap::DUMP_UP|OSDMap::DUMP_DOWN)) ||
+	((filter & (OSDMap::DUMP_UP|OSDMap::DUMP_DESTROYED)) ==
+	 (OSDMap::DUMP_UP|OSDMap::DUMP_DESTROYED)) ||
+	((filter & (OSDMap::DUMP_DOWN|OSDMap::DUMP_DESTROYED)) ==
+	 (OSDMap::DUMP_DOWN|OSDMap::DUMP_DESTROYED))) {
+      *ss << "can specify only one of 'up', 'down' and 'destroyed'";
+      return -EINVAL;
+    }
+    if (f) {
+      f->open_object_section("tree");
+      osdmap.print_tree(f, NULL, filter);
+      f->close_section();
+      f->flush(*rdata);
+    } else {
+      osdmap.print_tree(NULL, &ds, filter);
+    }
+  }
+  rdata->append(ds);
+  return 0;
+}
+
 bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 {
   op->mark_osdmon_event(__func__);
@@ -3938,6 +4066,23 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
     assert(err == 0);
     assert(osdmap_bl.length());
 
+    if ((prefix == "osd dump" || prefix == "osd tree") &&
+	mon->queue_readonly_command(
+	  op, get_last_committed(),
+	  [osdmap_bl, prefix, cmdmap, format](string *rs, bufferlist *rdata) {
+	    // the committed full map is our snapshot
+	    bufferlist bl(osdmap_bl);
+	    OSDMap m;
+	    m.decode(bl);
+	    boost::scoped_ptr<Formatter> f(Formatter::create(format));
+	    stringstream ss;
+	    int r = format_osdmap_command(m, prefix, cmdmap, f.get(), &ss, rdata);
+	    getline(ss, *rs);
+	    return r;
+	  })) {
+      return true;
+    }
+
     OSDMap *p;
     if (epoch == osdmap.get_epoch()) {
       p = &osdmap;
@@ -3952,19 +4097,8 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       }
     });
 
-    if (prefix == "osd dump") {
-      stringstream ds;
-      if (f) {
-	f->open_object_section("osdmap");
-	p->dump(f.get());
-	f->close_section();
-	f->flush(ds);
-      } else {
-	p->print(ds);
-      }
-      rdata.append(ds);
-      if (!f)
-	ds << " ";
+    if (prefix == "osd dump" || prefix == "osd tree") {
+      r = format_osdmap_command(*p, prefix, cmdmap, f.get(), &ss, &rdata);
     } else if (prefix == "osd ls") {
       if (f) {
 	f->open_array_section("osds");
@@ -3987,52 +4121,6 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	}
       }
       rdata.append(ds);
-    } else if (prefix == "osd tree") {
-      vector<string> states;
-      cmd_getval(g_ceph_context, cmdmap, "states", states);
-      unsigned filter = 0;
-      for (auto& s : states) {
-	if (s == "up") {
-	  filter |= OSDMap::DUMP_UP;
-	} else if (s == "down") {
-	  filter |= OSDMap::DUMP_DOWN;
-	} else if (s == "in") {
-	  filter |= OSDMap::DUMP_IN;
-	} else if (s == "out") {
-	  filter |= OSDMap::DUMP_OUT;
-	} else if (s == "destroyed") {
-	  filter |= OSDMap::DUMP_DESTROYED;
-	} else {
-	  ss << "unrecognized state '" << s << "'";
-	  r = -EINVAL;
-	  goto reply;
-	}
-      }
-      if ((filter & (OSDMap::DUMP_IN|OSDMap::DUMP_OUT)) ==
-	  (OSDMap::DUMP_IN|OSDMap::DUMP_OUT)) {
-        ss << "cannot specify both 'in' and 'out'";
-        r = -EINVAL;
-        goto reply;
-      }
-      if (((filter & (OSDMap::DUMP_UP|OSDMap::DUMP_DOWN)) ==
-	   (OSDMap::DUMP_UP|OSDMap::DUMP_DOWN)) ||
-           ((filter & (OSDMap::DUMP_UP|OSDMap::DUMP_DESTROYED)) ==
-           (OSDMap::DUMP_UP|OSDMap::DUMP_DESTROYED)) ||
-           ((filter & (OSDMap::DUMP_DOWN|OSDMap::DUMP_DESTROYED)) ==
-           (OSDMap::DUMP_DOWN|OSDMap::DUMP_DESTROYED))) {
-	ss << "can specify only one of 'up', 'down' and 'destroyed'";
-	r = -EINVAL;
-	goto reply;
-      }
-      if (f) {
-	f->open_object_section("tree");
-	p->print_tree(f.get(), NULL, filter);
-	f->close_section();
-	f->flush(ds);
-      } else {
-	p->print_tree(NULL, &ds, filter);
-      }
-      rdata.append(ds);
     } else if (prefix == "osd getmap") {
       rdata.append(osdmap_bl);
       ss << "got osdmap epoch " << p->get_epoch();
@@ -4450,6 +4538,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       {"hashpspool", HASHPSPOOL}, {"nodelete", NODELETE},
       {"nopgchange", NOPGCHANGE}, {"nosizechange", NOSIZECHANGE},
       {"noscrub", NOSCRUB}, {"nodeep-scrub", NODEEP_SCRUB},
+      {"chain_replication", CHAIN_REPLICATION},
       {"write_fadvise_dontneed", WRITE_FADVISE_DONTNEED},
       {"hit_set_type", HIT_SET_TYPE}, {"hit_set_period", HIT_SET_PERIOD},
       {"hit_set_count", HIT_SET_COUNT}, {"hit_set_fpp", HIT_SET_FPP},
@@ -4589,6 +4678,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case WRITE_FADVISE_DONTNEED:
 	  case NOSCRUB:
 	  case NODEEP_SCRUB:
+	  case CHAIN_REPLICATION:
 	    f->dump_string(i->first.c_str(),
 			   p->has_flag(pg_pool_t::get_flag_by_name(i->first)) ?
 			   "true" : "false");
@@ -4815,6 +4905,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case WRITE_FADVISE_DONTNEED:
 	  case NOSCRUB:
 	  case NODEEP_SCRUB:
+	  case CHAIN_REPLICATION:
 	    for (i = ALL_CHOICES.begin(); i != ALL_CHOICES.end(); ++i) {
 	      if (i->second == *it)
 		break;
@@ -6118,6 +6209,24 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
       ss << "expecting value 'true' or '1'";
       return -EINVAL;
     }
+  } else if (var == "chain_replication") {
+    if (!p.is_replicated()) {
+      ss << "chain replication is only supported for replicated pools";
+      return -EINVAL;
+    }
+    if (val == "true" || (interr.empty() && n == 1)) {
+      // replicas must know to forward; boot keeps older osds out after
+      if (!HAVE_FEATURE(osdmap.get_up_osd_features(), SERVER_MIMIC)) {
+	ss << "not all OSDs support chain replication.";
+	return -EINVAL;
+      }
+      p.set_flag(pg_pool_t::FLAG_CHAIN_REPLICATION);
+    } else if (val == "false" || (interr.empty() && n == 0)) {
+      p.unset_flag(pg_pool_t::FLAG_CHAIN_REPLICATION);
+    } else {
+      ss << "expecting value 'true', 'false', '0', or '1'";
+      return -EINVAL;
+    }
   } else if (var == "allow_ec_overwrites") {
     if (!p.is_erasure()) {
       ss << "ec overwrites can only be enabled for an erasure coded pool";
@@ -8759,6 +8868,12 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
 	err = -EPERM;
 	goto reply;
       }
+    } else if (rel == CEPH_RELEASE_MIMIC) {
+      if (!HAVE_FEATURE(osdmap.get_up_osd_features(), SERVER_MIMIC)) {
+	ss << "not all up OSDs have CEPH_FEATURE_SERVER_MIMIC feature";
+	err = -EPERM;
+	goto reply;
+      }
     } else {
       ss << "not supported for this release yet";
       err = -EPERM;
@@ -10764,6 +10879,40 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
     wait_for_finished_proposal(op, new Monitor::C_Command(mon, op, 0, rs,
 					      get_last_committed() + 1));
     return true;
+  } else if (prefix == "osd pool set-compression-dictionary") {
+    string poolstr;
+    cmd_getval(g_ceph_context, cmdmap, "pool", poolstr);
+    int64_t pool_id = osdmap.lookup_pg_pool_name(poolstr);
+    if (pool_id < 0) {
+      ss << "unrecognized pool '" << poolstr << "'";
+      err = -ENOENT;
+      goto reply;
+    }
+
+    // the dictionary travels with every copy of the osdmap
+    bufferlist dict = m->get_data();
+    uint64_t max_size =
+      g_conf->get_val<uint64_t>("mon_max_pool_compression_dictionary_size");
+    if (dict.length() > max_size) {
+      ss << "dictionary is " << dict.length() << " bytes, more than "
+	 << "mon_max_pool_compression_dictionary_size " << max_size;
+      err = -E2BIG;
+      goto reply;
+    }
+
+    pg_pool_t *pi = pending_inc.get_new_pool(pool_id, osdmap.get_pg_pool(pool_id));
+    if (dict.length()) {
+      pi->opts.set(pool_opts_t::COMPRESSION_DICTIONARY, dict.to_str());
+      ss << "set " << dict.length() << " byte compression dictionary for pool "
+	 << poolstr;
+    } else {
+      pi->opts.unset(pool_opts_t::COMPRESSION_DICTIONARY);
+      ss << "removed compression dictionary of pool " << poolstr;
+    }
+    rs = ss.str();
+    wait_for_finished_proposal(op, new Monitor::C_Command(mon, op, 0, rs,
+					      get_last_committed() + 1));
+    return true;
   } else if (prefix == "osd pool application enable" ||
              prefix == "osd pool application disable" ||
              prefix == "osd pool application set" ||
@@ -11349,7 +11498,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap mappings for this pool
-  for (auto& p : osdmap.pg_upmap) {
+  for (auto& p : *osdmap.pg_upmap) {
     if (p.first.pool() == (uint64_t)pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap "
@@ -11358,7 +11507,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap_items mappings for this pool
-  for (auto& p : osdmap.pg_upmap_items) {
+  for (auto& p : *osdmap.pg_upmap_items) {
     if (p.first.pool() == (uint64_t)pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_items " << p.first
@@ -229,6 +229,11 @@ private:
   ParallelPGMapper mapper;                        ///< for background pg work
   OSDMapMapping mapping;                          ///< pg <-> osd mappings
   unique_ptr<ParallelPGMapper::Job> mapping_job;  ///< background mapping job
+  /// epoch -> pools whose mappings it may have changed
+  map<epoch_t,set<int64_t>> mapping_changed_pools;
+  epoch_t mapping_full_epoch = 0;  ///< last epoch that may move any pg
+  /// pools to remap to catch mapping up to osdmap; false if all of them
+  bool _get_mapping_changed_pools(set<int64_t> *pools);
   void start_mapping();
 
   void update_logger();
@@ -1269,6 +1269,7 @@ void PGMap::calc_stats()
   osd_sum = osd_stat_t();
   num_pg_by_state.clear();
   num_pg_by_osd.clear();
+  unhealthy_pgs.clear();
 
   for (auto p = pg_stat.begin();
        p != pg_stat.end();
@@ -1367,6 +1368,24 @@ void PGMap::remove_osd(int osd)
   }
 }
 
+bool PGMap::is_unhealthy_state(uint32_t state)
+{
+  // must cover every state get_health_checks() responds to
+  const uint32_t bad = PG_STATE_INCONSISTENT |
+    PG_STATE_INCOMPLETE |
+    PG_STATE_REPAIR |
+    PG_STATE_SNAPTRIM_ERROR |
+    PG_STATE_BACKFILL_TOOFULL |
+    PG_STATE_RECOVERY_TOOFULL |
+    PG_STATE_DEGRADED |
+    PG_STATE_DOWN |
+    PG_STATE_PEERING |
+    PG_STATE_UNDERSIZED |
+    PG_STATE_STALE;
+  const uint32_t good = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  return (state & bad) || (state & good) != good;
+}
+
 void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
                         bool sameosds)
 {
@@ -1391,6 +1410,9 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s,
   if (s.state == 0) {
     ++num_pg_unknown;
   }
+  if (is_unhealthy_state(s.state)) {
+    unhealthy_pgs.insert(pgid);
+  }
 
   if (sameosds)
     return;
@@ -1452,6 +1474,9 @@ void PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
   if (s.state == 0) {
     --num_pg_unknown;
   }
+  if (is_unhealthy_state(s.state)) {
+    unhealthy_pgs.erase(pgid);
+  }
 
   if (sameosds)
     return;
@@ -2717,11 +2742,14 @@ void PGMap::get_health_checks(
   }
 
   utime_t cutoff = now - utime_t(cct->_conf->mon_pg_stuck_threshold, 0);
-  // Loop over all PGs, if there are any possibly-unhealthy states in there
+  // Loop over the possibly-unhealthy PGs, if there are any states in there
   if (!possible_responses.empty()) {
-    for (const auto& i : pg_stat) {
-      const auto &pg_id = i.first;
-      const auto &pg_info = i.second;
+    dout(20) << __func__ << " checking " << unhealthy_pgs.size() << "/"
+	     << pg_stat.size() << " pgs" << dendl;
+    for (const auto& pg_id : unhealthy_pgs) {
+      auto i = pg_stat.find(pg_id);
+      assert(i != pg_stat.end());
+      const auto &pg_info = i->second;
 
       for (const auto &j : state_to_response) {
         const auto &pg_response_state = j.first;
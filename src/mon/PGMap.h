@@ -350,6 +350,12 @@ public:
   mempool::pgmap::set<pg_t> creating_pgs;
   mempool::pgmap::map<int,map<epoch_t,set<pg_t> > > creating_pgs_by_osd_epoch;
 
+  /// pgs get_health_checks() has to look at: not active+clean, or
+  /// flagged with a state it reports on.  Kept up to date by
+  /// stat_pg_add/sub so the check does not walk every pg_stat entry.
+  mempool::pgmap::set<pg_t> unhealthy_pgs;
+  static bool is_unhealthy_state(uint32_t state);
+
   // Bits that use to be enum StuckPG
   static const int STUCK_INACTIVE = (1<<0);
   static const int STUCK_UNCLEAN = (1<<1);
@@ -170,6 +170,13 @@ bool PaxosService::should_propose(double& delay)
   // simple default policy: quick startup, then some damping.
   if (get_last_committed() <= 1) {
     delay = 0.0;
+  } else if (g_conf->paxos_propose_backlog > 0 &&
+	     proposal_backlog >= (size_t)g_conf->paxos_propose_backlog) {
+    // updates are already piling up behind each commit, so they batch
+    // by themselves; waiting out the full interval only delays them
+    dout(10) << __func__ << " backlog of " << proposal_backlog
+	     << ", proposing after paxos_min_wait" << dendl;
+    delay = (double)g_conf->paxos_min_wait;
   } else {
     utime_t now = ceph_clock_now();
     if ((now - paxos->last_commit_time) > g_conf->paxos_propose_interval)
@@ -343,6 +350,7 @@ void PaxosService::_active()
   // wake up anyone who came in while we were proposing.  note that
   // anyone waiting for the previous proposal to commit is no longer
   // on this list; it is on Paxos's.
+  proposal_backlog = waiting_for_finished_proposal.size();
   finish_contexts(g_ceph_context, waiting_for_finished_proposal, 0);
 
   if (mon->is_leader())
@@ -55,6 +55,12 @@ class PaxosService {
 
   bool need_immediate_propose = false;
 
+  /**
+   * Number of requests that queued up behind our last proposal and
+   * were retried when it committed.
+   */
+  size_t proposal_backlog = 0;
+
 protected:
   /**
    * Services implementing us used to depend on the Paxos version, back when
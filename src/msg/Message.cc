@@ -894,7 +894,9 @@ void Message::decode_trace(bufferlist::iterator &p, bool create)
     trace.init(get_type_name(), endpoint, &info, true);
     trace.event("decoded trace");
   } else if (create || (msgr->get_myname().is_osd() &&
-                        msgr->cct->_conf->osd_blkin_trace_all)) {
+                        (msgr->cct->_conf->osd_blkin_trace_all ||
+                         ztrace_sample(
+                           msgr->cct->_conf->osd_blkin_trace_sample_rate)))) {
     // create a trace even if we didn't get one on the wire
     trace.init(get_type_name(), endpoint);
     trace.event("created trace");
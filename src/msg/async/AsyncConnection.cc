@@ -97,6 +97,16 @@ class C_tick_wakeup : public EventCallback {
   }
 };
 
+class C_coalesce_flush : public EventCallback {
+  AsyncConnectionRef conn;
+
+ public:
+  explicit C_coalesce_flush(AsyncConnectionRef c): conn(c) {}
+  void do_request(int id) override {
+    conn->handle_coalesce_flush();
+  }
+};
+
 static void alloc_aligned_buffer(bufferlist& data, unsigned len, unsigned off)
 {
   // create a buffer to read into that matches the data alignment
@@ -137,6 +147,7 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, DispatchQu
   write_handler = new C_handle_write(this);
   wakeup_handler = new C_time_wakeup(this);
   tick_handler = new C_tick_wakeup(this);
+  coalesce_handler = new C_coalesce_flush(this);
   memset(msgvec, 0, sizeof(msgvec));
   // double recv_max_prefetch see "read_until"
   recv_buf = new char[2*recv_max_prefetch];
@@ -204,6 +215,15 @@ ssize_t AsyncConnection::_try_send(bool more)
   }
 
   assert(center->in_thread());
+  if (coalesce_timer_id) {
+    // everything pending goes out now
+    center->delete_time_event(coalesce_timer_id);
+    coalesce_timer_id = 0;
+  }
+  if (coalesce_msgs) {
+    logger->hinc(l_msgr_send_batch_hist, coalesce_msgs, outcoming_bl.length());
+    coalesce_msgs = 0;
+  }
   ssize_t r = cs.send(outcoming_bl, more);
   if (r < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " send error: " << cpp_strerror(r) << dendl;
@@ -606,18 +626,35 @@ void AsyncConnection::process()
           // read data
           unsigned data_len = le32_to_cpu(current_header.data_len);
           unsigned data_off = le32_to_cpu(current_header.data_off);
-          if (data_len) {
+          bool compressed = current_header.reserved &
+            CEPH_MSG_HEADER_DATA_COMPRESSED;
+          data_rx_version = 0;
+          if (data_len && compressed) {
+            // decompressed into a fresh buffer later; don't fill a posted
+            // rx buffer with compressed bytes
+            data_buf.push_back(buffer::create(data_len));
+            data_blp = data_buf.begin();
+          } else if (data_len) {
             // get a buffer
+            Connection::lock.Lock();
             map<ceph_tid_t,pair<bufferlist,int> >::iterator p = rx_buffers.find(current_header.tid);
             if (p != rx_buffers.end()) {
               ldout(async_msgr->cct,10) << __func__ << " seleting rx buffer v " << p->second.second
                                   << " at offset " << data_off
                                   << " len " << p->second.first.length() << dendl;
               data_buf = p->second.first;
+              data_rx_version = p->second.second;
+            }
+            Connection::lock.Unlock();
+            if (data_rx_version) {
               // make sure it's big enough
               if (data_buf.length() < data_len)
                 data_buf.push_back(buffer::create(data_len - data_buf.length()));
               data_blp = data_buf.begin();
+            } else if (data_len >= CEPH_PAGE_SIZE && worker->rx_buffer_pool &&
+                       worker->rx_buffer_pool->get(data_len, data_off, &data_buf)) {
+              ldout(async_msgr->cct,20) << __func__ << " using pooled rx buffer at offset " << data_off << dendl;
+              data_blp = data_buf.begin();
             } else {
               ldout(async_msgr->cct,20) << __func__ << " allocating new rx buffer at offset " << data_off << dendl;
               alloc_aligned_buffer(data_buf, data_len, data_off);
@@ -634,7 +671,29 @@ void AsyncConnection::process()
           while (msg_left > 0) {
             bufferptr bp = data_blp.get_current_ptr();
             unsigned read = MIN(bp.length(), msg_left);
-            r = read_until(read, bp.c_str());
+            if (data_rx_version) {
+              // the posted buffer belongs to the caller; hold the lock while
+              // reading into it so that a revoke waits for us, and move the
+              // rest of the message into our own buffer once it is revoked
+              Mutex::Locker l(Connection::lock);
+              map<ceph_tid_t,pair<bufferlist,int> >::iterator p = rx_buffers.find(current_header.tid);
+              if (p == rx_buffers.end() || p->second.second != data_rx_version) {
+                ldout(async_msgr->cct, 10) << __func__ << " rx buffer v " << data_rx_version
+                                           << " revoked, " << msg_left << " bytes left" << dendl;
+                bufferptr nbp = buffer::create(msg_left);
+                if (state_offset)
+                  memcpy(nbp.c_str(), bp.c_str(), state_offset);
+                data_buf.clear();
+                data_buf.push_back(nbp);
+                data_blp = data_buf.begin();
+                bp = nbp;
+                read = msg_left;
+                data_rx_version = 0;
+              }
+              r = read_until(read, bp.c_str());
+            } else {
+              r = read_until(read, bp.c_str());
+            }
             if (r < 0) {
               ldout(async_msgr->cct, 1) << __func__ << " read data error " << dendl;
               goto fail;
@@ -690,6 +749,11 @@ void AsyncConnection::process()
             goto fail;
           }
 
+          if (current_header.reserved & CEPH_MSG_HEADER_DATA_COMPRESSED) {
+            if (decompress_data() < 0)
+              goto fail;
+          }
+
           ldout(async_msgr->cct, 20) << __func__ << " got " << front.length() << " + " << middle.length()
                               << " + " << data.length() << " byte message" << dendl;
           Message *message = decode_message(async_msgr->cct, async_msgr->crcflags, current_header, footer,
@@ -1042,7 +1106,7 @@ ssize_t AsyncConnection::_process_connection()
           ldout(async_msgr->cct, 10) << __func__ <<  " connect_msg.authorizer_len="
                                      << connect_msg.authorizer_len << " protocol="
                                      << connect_msg.authorizer_protocol << dendl;
-        connect_msg.flags = 0;
+        connect_msg.flags = CEPH_MSG_CONNECT_COMPRESS;
         if (policy.lossy)
           connect_msg.flags |= CEPH_MSG_CONNECT_LOSSY;  // this is fyi, actually, server decides!
         bl.append((char*)&connect_msg, sizeof(connect_msg));
@@ -1174,6 +1238,7 @@ ssize_t AsyncConnection::_process_connection()
         connect_seq += 1;
         assert(connect_seq == connect_reply.connect_seq);
         backoff = utime_t();
+        peer_decompresses = connect_reply.flags & CEPH_MSG_CONNECT_COMPRESS;
         set_features((uint64_t)connect_reply.features & (uint64_t)connect_msg.features);
         ldout(async_msgr->cct, 10) << __func__ << " connect success " << connect_seq
                                    << ", lossy = " << policy.lossy << ", features "
@@ -1794,11 +1859,12 @@ ssize_t AsyncConnection::handle_connect_msg(ceph_msg_connect &connect, bufferlis
   reply.features = policy.features_supported;
   reply.global_seq = async_msgr->get_global_seq();
   reply.connect_seq = connect_seq;
-  reply.flags = 0;
+  reply.flags = CEPH_MSG_CONNECT_COMPRESS;
   reply.authorizer_len = authorizer_reply.length();
   if (policy.lossy)
     reply.flags = reply.flags | CEPH_MSG_CONNECT_LOSSY;
 
+  peer_decompresses = connect.flags & CEPH_MSG_CONNECT_COMPRESS;
   set_features((uint64_t)reply.features & (uint64_t)connect.features);
   ldout(async_msgr->cct, 10) << __func__ << " accept features " << get_features() << dendl;
 
@@ -2064,6 +2130,7 @@ void AsyncConnection::fault()
   replacing = false;
   is_reset_from_peer = false;
   outcoming_bl.clear();
+  coalesce_msgs = 0;
   if (!once_ready && !is_queued() &&
       state >=STATE_ACCEPTING && state <= STATE_ACCEPTING_WAIT_CONNECT_MSG_AUTH) {
     ldout(async_msgr->cct, 10) << __func__ << " with nothing to send and in the half "
@@ -2182,7 +2249,87 @@ void AsyncConnection::prepare_send_message(uint64_t features, Message *m, buffer
 
   bl.append(m->get_payload());
   bl.append(m->get_middle());
-  bl.append(m->get_data());
+  if (!compress_data(m, bl))
+    bl.append(m->get_data());
+}
+
+/*
+ * Compressed data is sent as the compression algorithm (u8), the raw
+ * length (u32) and the compressed bytes.  The header's data_len is the
+ * length on the wire; the crcs computed by Message::encode() still cover
+ * the raw data, so the receiver checks them after decompressing.
+ */
+bool AsyncConnection::compress_data(Message *m, bufferlist &bl)
+{
+  ceph_msg_header& header = m->get_header();
+  header.reserved = header.reserved & ~CEPH_MSG_HEADER_DATA_COMPRESSED;
+  if (!peer_decompresses)
+    return false;
+  const bufferlist& data = m->get_data();
+  CompressorRef c = async_msgr->get_data_compressor(get_peer_addr(),
+						    data.length());
+  if (!c)
+    return false;
+
+  utime_t start = ceph_clock_now();
+  bufferlist out, compressed;
+  ::encode((__u8)c->get_type(), out);
+  ::encode((uint32_t)data.length(), out);
+  int r = c->compress(data, compressed);
+  logger->tinc(l_msgr_send_compress_time, ceph_clock_now() - start);
+  if (r < 0 || out.length() + compressed.length() >= data.length()) {
+    ldout(async_msgr->cct, 20) << __func__ << " not compressing " << m
+			       << " data " << data.length() << " r=" << r
+			       << dendl;
+    return false;
+  }
+  out.claim_append(compressed);
+  logger->inc(l_msgr_send_compressed_messages);
+  logger->inc(l_msgr_send_compress_raw_bytes, data.length());
+  logger->inc(l_msgr_send_compress_bytes, out.length());
+  ldout(async_msgr->cct, 20) << __func__ << " " << m << " data "
+			     << data.length() << " -> " << out.length() << dendl;
+
+  header.data_len = out.length();
+  header.reserved = header.reserved | CEPH_MSG_HEADER_DATA_COMPRESSED;
+  bl.claim_append(out);
+  return true;
+}
+
+int AsyncConnection::decompress_data()
+{
+  utime_t start = ceph_clock_now();
+  __u8 alg;
+  uint32_t raw_len;
+  bufferlist::iterator p = data.begin();
+  try {
+    ::decode(alg, p);
+    ::decode(raw_len, p);
+  } catch (buffer::error& e) {
+    ldout(async_msgr->cct, 1) << __func__ << " bad compressed data header"
+			      << dendl;
+    return -EIO;
+  }
+  CompressorRef c = async_msgr->get_data_decompressor(alg);
+  if (!c) {
+    ldout(async_msgr->cct, 0) << __func__ << " no compression plugin for "
+			      << Compressor::get_comp_alg_name(alg) << dendl;
+    return -EOPNOTSUPP;
+  }
+  bufferlist raw;
+  int r = c->decompress(p, data.length() - p.get_off(), raw);
+  if (r < 0 || raw.length() != raw_len) {
+    ldout(async_msgr->cct, 1) << __func__ << " failed to decompress "
+			      << data.length() << " bytes with "
+			      << c->get_type_name() << " r=" << r << dendl;
+    return -EIO;
+  }
+  logger->tinc(l_msgr_recv_decompress_time, ceph_clock_now() - start);
+
+  data.swap(raw);
+  current_header.data_len = raw_len;
+  current_header.reserved = current_header.reserved & ~CEPH_MSG_HEADER_DATA_COMPRESSED;
+  return 0;
 }
 
 ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
@@ -2268,8 +2415,16 @@ ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
   ldout(async_msgr->cct, 20) << __func__ << " sending " << m->get_seq()
                              << " " << m << dendl;
   ssize_t total_send_size = outcoming_bl.length();
-  ssize_t rc = _try_send(more);
-  if (rc < 0) {
+  ++coalesce_msgs;
+  ssize_t rc;
+  if (_coalesce_write(more)) {
+    logger->inc(l_msgr_send_coalesced);
+    logger->inc(l_msgr_send_bytes, total_send_size - original_bl_len);
+    ldout(async_msgr->cct, 20) << __func__ << " deferring send of " << m
+                               << ", " << total_send_size << " bytes pending"
+                               << dendl;
+    rc = 0;
+  } else if ((rc = _try_send(more)) < 0) {
     ldout(async_msgr->cct, 1) << __func__ << " error sending " << m << ", "
                               << cpp_strerror(rc) << dendl;
   } else if (rc == 0) {
@@ -2288,6 +2443,52 @@ ssize_t AsyncConnection::write_message(Message *m, bufferlist& bl, bool more)
   return rc;
 }
 
+/*
+ * Decide whether the message just appended to outcoming_bl can wait for
+ * the ones after it.  If more messages are queued they are always
+ * written with a single send, up to ms_async_coalesce_max_bytes.  When
+ * the queue has drained but this connection has recently been sending
+ * more than ms_async_coalesce_min_rate messages per second, the send is
+ * delayed by up to ms_async_coalesce_delay_us so that messages queued
+ * meanwhile share the syscall; at lower rates it goes out immediately.
+ */
+bool AsyncConnection::_coalesce_write(bool more)
+{
+  const md_config_t *conf = async_msgr->cct->_conf;
+  ++send_rate_msgs;
+  if (!conf->ms_async_coalesce_max_bytes ||
+      outcoming_bl.length() >= conf->ms_async_coalesce_max_bytes)
+    return false;
+  if (more || coalesce_timer_id)
+    return true;
+  if (!conf->ms_async_coalesce_delay_us)
+    return false;
+
+  auto now = ceph::mono_clock::now();
+  auto elapsed = now - send_rate_stamp;
+  if (elapsed >= std::chrono::milliseconds(10)) {
+    send_rate_high = send_rate_msgs >=
+      conf->ms_async_coalesce_min_rate *
+      std::chrono::duration<double>(elapsed).count();
+    send_rate_msgs = 0;
+    send_rate_stamp = now;
+  }
+  if (!send_rate_high)
+    return false;
+
+  coalesce_timer_id = center->create_time_event(
+    conf->ms_async_coalesce_delay_us, coalesce_handler);
+  return true;
+}
+
+void AsyncConnection::handle_coalesce_flush()
+{
+  ldout(async_msgr->cct, 20) << __func__ << " " << coalesce_msgs
+                             << " messages pending" << dendl;
+  coalesce_timer_id = 0;
+  handle_write();
+}
+
 void AsyncConnection::reset_recv_state()
 {
   // clean up state internal variables and states
@@ -2480,8 +2681,10 @@ void AsyncConnection::handle_write()
       ldout(async_msgr->cct, 10) << __func__ << " try send msg ack, acked " << left << " messages" << dendl;
       ack_left -= left;
       left = ack_left;
-      r = _try_send(left);
-    } else if (is_queued()) {
+      // a pending coalesce flush sends the ack along with the messages
+      if (!coalesce_timer_id)
+        r = _try_send(left);
+    } else if (is_queued() && !coalesce_timer_id) {
       r = _try_send();
     }
 
@@ -60,6 +60,8 @@ class AsyncConnection : public Connection {
   ssize_t _try_send(bool more=false);
   ssize_t _send(Message *m);
   void prepare_send_message(uint64_t features, Message *m, bufferlist &bl);
+  bool compress_data(Message *m, bufferlist &bl);
+  int decompress_data();
   ssize_t read_until(unsigned needed, char *p);
   ssize_t _process_connection();
   void _connect();
@@ -106,6 +108,10 @@ class AsyncConnection : public Connection {
       center->delete_time_event(last_tick_id);
       last_tick_id = 0;
     }
+    if (coalesce_timer_id) {
+      center->delete_time_event(coalesce_timer_id);
+      coalesce_timer_id = 0;
+    }
     if (cs) {
       center->delete_file_event(cs.fd(), EVENT_READABLE|EVENT_WRITABLE);
       cs.shutdown();
@@ -308,6 +314,14 @@ class AsyncConnection : public Connection {
   bufferlist outcoming_bl;
   bool open_write = false;
 
+  // outgoing message coalescing, only used in own thread
+  unsigned coalesce_msgs = 0;       ///< messages in outcoming_bl since the last send
+  uint64_t coalesce_timer_id = 0;   ///< pending delayed flush
+  ceph::mono_time send_rate_stamp;  ///< start of the current rate window
+  unsigned send_rate_msgs = 0;      ///< messages written in the window
+  bool send_rate_high = false;      ///< last window exceeded ms_async_coalesce_min_rate
+  bool _coalesce_write(bool more);
+
   std::mutex write_lock;
   enum class WriteStatus {
     NOWRITE,
@@ -326,6 +340,7 @@ class AsyncConnection : public Connection {
   EventCallbackRef write_handler;
   EventCallbackRef wakeup_handler;
   EventCallbackRef tick_handler;
+  EventCallbackRef coalesce_handler;
   struct iovec msgvec[ASYNC_IOV_MAX];
   char *recv_buf;
   uint32_t recv_max_prefetch;
@@ -346,6 +361,9 @@ class AsyncConnection : public Connection {
   ceph_msg_header current_header;
   bufferlist data_buf;
   bufferlist::iterator data_blp;
+  int data_rx_version = 0;  ///< posted rx buffer being read into, 0 if none
+  /// peer sent CEPH_MSG_CONNECT_COMPRESS; set with the connection features
+  std::atomic<bool> peer_decompresses = { false };
   bufferlist front, middle, data;
   ceph_msg_connect connect_msg;
   // Connecting state
@@ -376,6 +394,7 @@ class AsyncConnection : public Connection {
  public:
   // used by eventcallback
   void handle_write();
+  void handle_coalesce_flush();
   void process();
   void wakeup_from(uint64_t id);
   void tick(uint64_t id);
@@ -394,6 +413,7 @@ class AsyncConnection : public Connection {
     delete write_handler;
     delete wakeup_handler;
     delete tick_handler;
+    delete coalesce_handler;
     if (delay_state) {
       delete delay_state;
       delay_state = NULL;
@@ -24,6 +24,8 @@
 #include "common/config.h"
 #include "common/Timer.h"
 #include "common/errno.h"
+#include "include/ipaddr.h"
+#include "include/str_list.h"
 
 #include "messages/MOSDOp.h"
 #include "messages/MOSDOpReply.h"
@@ -249,7 +251,7 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
     lock("AsyncMessenger::lock"),
     nonce(_nonce), need_addr(true), did_bind(false),
     global_seq(0), deleted_lock("AsyncMessenger::deleted_lock"),
-    cluster_protocol(0), stopped(true)
+    cluster_protocol(0), compress_min_size(0), stopped(true)
 {
   std::string transport_type = "posix";
   if (type.find("rdma") != std::string::npos)
@@ -272,6 +274,7 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
     processor_num = stack->get_num_worker();
   for (unsigned i = 0; i < processor_num; ++i)
     processors.push_back(new Processor(this, stack->get_worker(i), cct));
+  init_compression();
 }
 
 /**
@@ -287,6 +290,63 @@ AsyncMessenger::~AsyncMessenger()
     delete p;
 }
 
+void AsyncMessenger::init_compression()
+{
+  string alg = cct->_conf->get_val<string>("ms_compression_algorithm");
+  if (alg == "none")
+    return;
+  data_compressor = Compressor::create(cct, alg);
+  if (!data_compressor) {
+    lderr(cct) << __func__ << " compression plugin " << alg
+	       << " not available, sending uncompressed" << dendl;
+    return;
+  }
+  compress_min_size = cct->_conf->get_val<uint64_t>("ms_compression_min_size");
+
+  list<string> nets;
+  get_str_list(cct->_conf->get_val<string>("ms_compression_networks"), nets);
+  for (auto& n : nets) {
+    sockaddr_storage net;
+    unsigned prefix_len;
+    if (!parse_network(n.c_str(), &net, &prefix_len)) {
+      lderr(cct) << __func__ << " unable to parse network " << n
+		 << " in ms_compression_networks" << dendl;
+      continue;
+    }
+    compress_networks.push_back(make_pair(net, prefix_len));
+  }
+  ldout(cct, 1) << __func__ << " compressing message data with " << alg
+		<< " for payloads >= " << compress_min_size << " bytes" << dendl;
+}
+
+CompressorRef AsyncMessenger::get_data_compressor(const entity_addr_t& peer,
+						   uint64_t len)
+{
+  if (!data_compressor || len < compress_min_size)
+    return CompressorRef();
+  if (compress_networks.empty())
+    return data_compressor;
+  for (auto& n : compress_networks) {
+    if (network_contains((const sockaddr*)&n.first, n.second,
+			 peer.get_sockaddr()))
+      return data_compressor;
+  }
+  return CompressorRef();
+}
+
+CompressorRef AsyncMessenger::get_data_decompressor(int alg)
+{
+  if (data_compressor && data_compressor->get_type() == alg)
+    return data_compressor;
+  std::lock_guard<std::mutex> l(decompressors_lock);
+  auto p = decompressors.find(alg);
+  if (p != decompressors.end())
+    return p->second;
+  CompressorRef c = Compressor::create(cct, alg);
+  decompressors[alg] = c;
+  return c;
+}
+
 void AsyncMessenger::ready()
 {
   ldout(cct,10) << __func__ << " " << get_myaddr() << dendl;
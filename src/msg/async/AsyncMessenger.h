@@ -33,6 +33,7 @@ using namespace std;
 
 #include "msg/SimplePolicyMessenger.h"
 #include "msg/DispatchQueue.h"
+#include "compressor/Compressor.h"
 #include "include/assert.h"
 #include "AsyncConnection.h"
 #include "Event.h"
@@ -298,6 +299,15 @@ private:
   /// internal cluster protocol version, if any, for talking to entities of the same type.
   int cluster_protocol;
 
+  // on-wire data compression; the policy is read once at startup
+  CompressorRef data_compressor;  ///< null if ms_compression_algorithm is none
+  uint64_t compress_min_size;
+  std::vector<std::pair<sockaddr_storage, unsigned>> compress_networks;
+  std::mutex decompressors_lock;
+  std::map<int, CompressorRef> decompressors;
+
+  void init_compression();
+
   Cond  stop_cond;
   bool stopped;
 
@@ -410,6 +420,15 @@ public:
    */
   int get_proto_version(int peer_type, bool connect) const;
 
+  /**
+   * Get the compressor for a data payload of len bytes sent to peer.
+   *
+   * @return null if the data should be sent uncompressed
+   */
+  CompressorRef get_data_compressor(const entity_addr_t& peer, uint64_t len);
+  /// get a compressor that decompresses alg, or null if unavailable
+  CompressorRef get_data_decompressor(int alg);
+
   /**
    * Fill in the address and peer type for the local connection, which
    * is used for delivering messages back to ourself.
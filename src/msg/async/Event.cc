@@ -106,6 +106,7 @@ int EventCenter::init(int n, unsigned i, const std::string &t)
 
   type = t;
   idx = i;
+  busy_poll = std::chrono::microseconds(cct->_conf->ms_async_busy_poll_us);
 
   if (t == "dpdk") {
 #ifdef HAVE_DPDK
@@ -314,8 +315,8 @@ void EventCenter::delete_time_event(uint64_t id)
 
 void EventCenter::wakeup()
 {
-  // No need to wake up since we never sleep
-  if (!pollers.empty() || !driver->need_wakeup())
+  // No need to wake up since we never sleep, or are not sleeping now
+  if (!pollers.empty() || !driver->need_wakeup() || busy_polling.load())
     return ;
 
   ldout(cct, 20) << __func__ << dendl;
@@ -364,6 +365,13 @@ int EventCenter::process_events(int timeout_microseconds,  ceph::timespan *worki
 
   auto it = time_events.begin();
   bool blocking = pollers.empty() && !external_num_events.load();
+  if (busy_poll != ceph::timespan::zero() && pollers.empty()) {
+    bool spin = ceph::mono_clock::now() - last_work < busy_poll;
+    busy_polling.store(spin);
+    // recheck: an external event queued before the store may have
+    // skipped the wakeup
+    blocking = !spin && !external_num_events.load();
+  }
   // If exists external events or poller, don't block
   if (!blocking) {
     if (it != time_events.end() && now >= it->first)
@@ -442,6 +450,8 @@ int EventCenter::process_events(int timeout_microseconds,  ceph::timespan *worki
       numevents += pollers[i]->poll();
   }
 
+  if (busy_poll != ceph::timespan::zero() && numevents)
+    last_work = ceph::mono_clock::now();
   if (working_dur)
     *working_dur = ceph::mono_clock::now() - working_start;
   return numevents;
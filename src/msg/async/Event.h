@@ -175,6 +175,12 @@ class EventCenter {
   unsigned idx;
   AssociatedCenters *global_centers = nullptr;
 
+  // busy polling: keep polling the driver without blocking for
+  // busy_poll after the last event, see ms_async_busy_poll_us
+  ceph::timespan busy_poll = ceph::timespan::zero();
+  ceph::mono_time last_work;
+  std::atomic<bool> busy_polling = {false};  ///< last wait did not block
+
   int process_time_events();
   FileEvent *_get_file_event(int fd) {
     assert(fd < nevent);
@@ -205,6 +211,10 @@ class EventCenter {
   void delete_time_event(uint64_t id);
   int process_events(int timeout_microseconds, ceph::timespan *working_dur = nullptr);
   void wakeup();
+  /// true if the last process_events() polled instead of blocking
+  bool is_busy_polling() const {
+    return busy_polling.load(std::memory_order_relaxed);
+  }
 
   // Used by external thread
   void dispatch_event_external(EventCallbackRef e);
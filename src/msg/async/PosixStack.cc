@@ -19,12 +19,17 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
 
 #include <algorithm>
+#include <deque>
 
 #include "PosixStack.h"
 
 #include "include/buffer.h"
+#include "include/interval_set.h"
 #include "include/str_list.h"
 #include "include/sock_compat.h"
 #include "common/errno.h"
@@ -37,6 +42,7 @@
 #define dout_prefix *_dout << "PosixStack "
 
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
+  CephContext *cct;
   NetHandler &handler;
   int _fd;
   entity_addr_t sa;
@@ -47,9 +53,25 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   bool sigpipe_unblock;
 #endif
 
+  // MSG_ZEROCOPY: the kernel numbers each zerocopy sendmsg() that
+  // queued data and reports ranges of completed ids on the error
+  // queue.  Until then the pages are still referenced by the skbs, so
+  // the sent buffers are kept in zc_pending.
+  uint64_t zc_threshold = 0;  ///< min bytes to send zerocopy, 0 = off
+  bool zc_enabled = false;    ///< SO_ZEROCOPY set on _fd
+  uint64_t zc_sent = 0;       ///< zerocopy sendmsg() ids issued
+  uint64_t zc_done = 0;       ///< all ids below this have completed
+  interval_set<uint64_t> zc_completed;  ///< completed ids above zc_done
+  std::deque<std::pair<uint64_t, bufferlist> > zc_pending; ///< (ids issued, sent buffers)
+
  public:
-  explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+  explicit PosixConnectedSocketImpl(CephContext *c, NetHandler &h, const entity_addr_t &sa, int f, bool connected)
+      : cct(c), handler(h), _fd(f), sa(sa), connected(connected) {
+#ifdef __linux__
+    if (cct->_conf->ms_tcp_zerocopy)
+      zc_threshold = std::max<uint64_t>(1, cct->_conf->ms_tcp_zerocopy_threshold);
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -71,6 +93,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    // completions on the error queue wake us up as readable
+    if (!zc_pending.empty())
+      reap_zerocopy();
     ssize_t r = ::read(_fd, buf, len);
     if (r < 0)
       r = -errno;
@@ -139,9 +164,77 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   #endif  /* !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE) */
   }
 
+#ifdef __linux__
+  bool enable_zerocopy() {
+    if (zc_enabled)
+      return true;
+    int one = 1;
+    if (::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+      int r = errno;
+      ldout(cct, 1) << __func__ << " SO_ZEROCOPY not supported on fd " << _fd
+		    << ": " << cpp_strerror(r) << dendl;
+      zc_threshold = 0;
+      return false;
+    }
+    zc_enabled = true;
+    return true;
+  }
+
+  void reap_zerocopy() {
+    while (true) {
+      char control[128];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      int r = ::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+      if (r < 0) {
+	if (errno == EINTR)
+	  continue;
+	break;
+      }
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm;
+	   cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+	  continue;
+	struct sock_extended_err *ee = (struct sock_extended_err *)CMSG_DATA(cm);
+	if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+	  continue;
+	// [ee_info, ee_data] are the low 32 bits of the completed ids
+	uint64_t lo = zc_done + (uint32_t)(ee->ee_info - (uint32_t)zc_done);
+	uint64_t len = (uint64_t)(uint32_t)(ee->ee_data - ee->ee_info) + 1;
+	zc_completed.union_insert(lo, len);
+	if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+	  // e.g. loopback or a device without scatter-gather; the copy
+	  // path is cheaper than pinning pages for nothing
+	  ldout(cct, 10) << __func__ << " kernel copied zerocopy sends on fd "
+			 << _fd << ", disabling" << dendl;
+	  zc_threshold = 0;
+	}
+      }
+    }
+    while (!zc_completed.empty() && zc_completed.range_start() <= zc_done) {
+      uint64_t end = zc_completed.range_end();
+      zc_completed.erase(zc_completed.range_start(),
+			 end - zc_completed.range_start());
+      zc_done = std::max(zc_done, end);
+    }
+    while (!zc_pending.empty() && zc_pending.front().first <= zc_done)
+      zc_pending.pop_front();
+  }
+#else
+  bool enable_zerocopy() {
+    return false;
+  }
+  void reap_zerocopy() {}
+#endif
+
   // return the sent length
   // < 0 means error occured
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  // each successful MSG_ZEROCOPY call increments *zc_calls
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    int flags, uint64_t *zc_calls)
   {
     suppress_sigpipe();
 
@@ -149,9 +242,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     while (1) {
       ssize_t r;
   #if defined(MSG_NOSIGNAL)
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL | (more ? MSG_MORE : 0));
   #else
-      r = ::sendmsg(fd, &msg, (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, flags | (more ? MSG_MORE : 0));
   #endif /* defined(MSG_NOSIGNAL) */
 
       if (r < 0) {
@@ -159,10 +252,20 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
           continue;
         } else if (errno == EAGAIN) {
           break;
+#ifdef __linux__
+        } else if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+          // out of optmem for pinned pages, copy instead
+          flags &= ~MSG_ZEROCOPY;
+          continue;
+#endif
         }
         return -errno;
       }
 
+#ifdef __linux__
+      if (r > 0 && (flags & MSG_ZEROCOPY))
+        ++*zc_calls;
+#endif
       sent += r;
       if (len == sent) break;
 
@@ -184,6 +287,15 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(bufferlist &bl, bool more) override {
+    if (!zc_pending.empty())
+      reap_zerocopy();
+    int flags = 0;
+#ifdef __linux__
+    if (zc_threshold && bl.length() >= zc_threshold && enable_zerocopy())
+      flags = MSG_ZEROCOPY;
+#endif
+    uint64_t zc_start = zc_sent;
+
     size_t sent_bytes = 0;
     std::list<bufferptr>::const_iterator pb = bl.buffers().begin();
     uint64_t left_pbrs = bl.buffers().size();
@@ -205,7 +317,8 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         size--;
       }
 
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, flags,
+			     &zc_sent);
       if (r < 0)
         return r;
 
@@ -218,12 +331,14 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 
     if (sent_bytes) {
       bufferlist swapped;
-      if (sent_bytes < bl.length()) {
+      if (sent_bytes < bl.length())
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
-        bl.swap(swapped);
-      } else {
-        bl.clear();
+      if (zc_sent != zc_start) {
+        // bl now holds what was sent; keep it until the kernel is done
+        zc_pending.push_back(std::make_pair(zc_sent, bufferlist()));
+        zc_pending.back().second.claim(bl);
       }
+      bl.swap(swapped);
     }
 
     return static_cast<ssize_t>(sent_bytes);
@@ -232,6 +347,16 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     ::shutdown(_fd, SHUT_RDWR);
   }
   void close() override {
+#ifdef __linux__
+    if (!zc_pending.empty())
+      reap_zerocopy();
+    if (!zc_pending.empty()) {
+      // the buffers are released with us but the kernel may still be
+      // sending from them; reset the connection instead of flushing
+      struct linger l = { 1, 0 };
+      ::setsockopt(_fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+    }
+#endif
     ::close(_fd);
   }
   int fd() const override {
@@ -283,7 +408,7 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(w->cct, handler, *out, sd, true));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -351,7 +476,7 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(cct, net, addr, sd, !opts.nonblock)));
   return 0;
 }
 
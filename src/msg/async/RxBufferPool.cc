@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "RxBufferPool.h"
+#include "Stack.h"
+#include "common/deleter.h"
+#include "common/perf_counters.h"
+#include "include/assert.h"
+
+RxBufferPool::~RxBufferPool()
+{
+  for (unsigned c = 0; c < NUM_CLASSES; ++c) {
+    for (auto p : free_list[c]) {
+      ::free(p);
+    }
+    returned[c].drain([](char *&&p) { ::free(p); });
+  }
+}
+
+void RxBufferPool::put(unsigned c, char *p)
+{
+  uint64_t size = class_size(c);
+  if (cached.fetch_add(size) + size > max_cached) {
+    cached -= size;
+    ::free(p);
+    return;
+  }
+  returned[c].push(p);
+}
+
+bool RxBufferPool::get(unsigned len, unsigned data_off, bufferlist *bl)
+{
+  unsigned head = data_off & ~CEPH_PAGE_MASK;
+  uint64_t need = (uint64_t)head + len;
+  unsigned c = 0;
+  while (c < NUM_CLASSES && class_size(c) < need) {
+    ++c;
+  }
+  if (c == NUM_CLASSES) {
+    return false;
+  }
+  uint64_t size = class_size(c);
+
+  char *p = nullptr;
+  if (free_list[c].empty()) {
+    returned[c].drain([this, c](char *&&p) { free_list[c].push_back(p); });
+  }
+  if (!free_list[c].empty()) {
+    p = free_list[c].back();
+    free_list[c].pop_back();
+    cached -= size;
+    if (logger) {
+      logger->inc(l_msgr_rx_buffer_pool_hit);
+    }
+  } else {
+    int r = ::posix_memalign((void**)(void*)&p, CEPH_PAGE_SIZE, size);
+    if (r) {
+      throw std::bad_alloc();
+    }
+    if (logger) {
+      logger->inc(l_msgr_rx_buffer_pool_miss);
+    }
+  }
+
+  std::shared_ptr<RxBufferPool> pool = shared_from_this();
+  bufferptr bp(buffer::claim_buffer(
+		 size, p, make_deleter([pool, c, p]() { pool->put(c, p); })));
+  bp.set_offset(head);
+  bp.set_length(len);
+  bl->push_back(std::move(bp));
+  return true;
+}
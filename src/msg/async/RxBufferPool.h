@@ -0,0 +1,70 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_ASYNC_RXBUFFERPOOL_H
+#define CEPH_MSG_ASYNC_RXBUFFERPOOL_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "include/buffer.h"
+#include "common/MPSCQueue.h"
+
+class PerfCounters;
+
+/**
+ * RxBufferPool - recycled page-aligned buffers for message data
+ *
+ * Each Worker owns one pool and is the only thread that allocates from
+ * it.  Buffers are handed out as bufferptrs whose deleter returns the
+ * memory to the pool, from whatever thread drops the last reference;
+ * those returns go through a lock-free list that the owner drains when
+ * its local free list runs dry.  Buffers come in power-of-two page
+ * multiples, and the pool keeps at most max_cached idle bytes.
+ *
+ * The pool is reference counted by its outstanding buffers, so it may
+ * outlive its Worker.
+ */
+class RxBufferPool : public std::enable_shared_from_this<RxBufferPool> {
+  static const unsigned NUM_CLASSES = 11;  ///< one page .. 1024 pages
+
+  PerfCounters *logger;
+  const uint64_t max_cached;
+  std::atomic<uint64_t> cached = {0};  ///< idle bytes held by the pool
+
+  std::vector<char*> free_list[NUM_CLASSES];  ///< owner thread only
+  MPSCQueue<char*> returned[NUM_CLASSES];     ///< pushed by any thread
+
+  static uint64_t class_size(unsigned c) {
+    return (uint64_t)CEPH_PAGE_SIZE << c;
+  }
+  void put(unsigned c, char *p);
+
+public:
+  RxBufferPool(PerfCounters *l, uint64_t max_cached)
+    : logger(l), max_cached(max_cached) {}
+  ~RxBufferPool();
+
+  /**
+   * append a buffer for len bytes of data to bl
+   *
+   * The data is placed so that its offset within a page matches
+   * data_off, i.e. page-aligned file offsets land at page-aligned
+   * addresses and the whole payload stays a single contiguous ptr.
+   *
+   * @return false if the request is too large for the pool
+   */
+  bool get(unsigned len, unsigned data_off, ceph::bufferlist *bl);
+};
+
+#endif
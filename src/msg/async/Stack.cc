@@ -48,6 +48,7 @@ std::function<void ()> NetworkStack::add_thread(unsigned i)
         ldout(cct, 30) << __func__ << " calling event process" << dendl;
 
         ceph::timespan dur;
+        auto start = ceph::mono_clock::now();
         int r = w->center.process_events(EventMaxWaitUs, &dur);
         if (r < 0) {
           ldout(cct, 20) << __func__ << " process events failed: "
@@ -55,6 +56,15 @@ std::function<void ()> NetworkStack::add_thread(unsigned i)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        if (w->center.is_busy_polling()) {
+          if (r > 0) {
+            w->perf_logger->inc(l_msgr_busy_poll_hit);
+          } else {
+            w->perf_logger->inc(l_msgr_busy_poll_miss);
+            w->perf_logger->tinc(l_msgr_busy_poll_idle_time,
+                                 ceph::mono_clock::now() - start);
+          }
+        }
       }
       w->reset();
       w->destroy();
@@ -22,6 +22,7 @@
 #include "common/simple_spin.h"
 #include "msg/msg_types.h"
 #include "msg/async/Event.h"
+#include "msg/async/RxBufferPool.h"
 
 class Worker;
 class ConnectedSocketImpl {
@@ -199,6 +200,22 @@ enum {
   l_msgr_running_recv_time,
   l_msgr_running_fast_dispatch_time,
 
+  l_msgr_rx_buffer_pool_hit,
+  l_msgr_rx_buffer_pool_miss,
+
+  l_msgr_send_coalesced,
+  l_msgr_send_batch_hist,
+
+  l_msgr_busy_poll_hit,
+  l_msgr_busy_poll_miss,
+  l_msgr_busy_poll_idle_time,
+
+  l_msgr_send_compressed_messages,
+  l_msgr_send_compress_raw_bytes,
+  l_msgr_send_compress_bytes,
+  l_msgr_send_compress_time,
+  l_msgr_recv_decompress_time,
+
   l_msgr_last,
 };
 
@@ -216,6 +233,8 @@ class Worker {
 
   std::atomic_uint references;
   EventCenter center;
+  /// page-aligned buffers for message data; null if disabled
+  std::shared_ptr<RxBufferPool> rx_buffer_pool;
 
   Worker(const Worker&) = delete;
   Worker& operator=(const Worker&) = delete;
@@ -239,10 +258,49 @@ class Worker {
     plb.add_time(l_msgr_running_recv_time, "msgr_running_recv_time", "The total time of message receiving");
     plb.add_time(l_msgr_running_fast_dispatch_time, "msgr_running_fast_dispatch_time", "The total time of fast dispatch");
 
+    plb.add_u64_counter(l_msgr_rx_buffer_pool_hit, "msgr_rx_buffer_pool_hit", "Message data buffers reused from the rx pool");
+    plb.add_u64_counter(l_msgr_rx_buffer_pool_miss, "msgr_rx_buffer_pool_miss", "Message data buffers newly allocated by the rx pool");
+
+    PerfHistogramCommon::axis_config_d batch_msgs_axis{
+      "Messages",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      1,
+      12,
+    };
+    PerfHistogramCommon::axis_config_d batch_bytes_axis{
+      "Bytes",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      512,
+      16,
+    };
+    plb.add_u64_counter(l_msgr_send_coalesced, "msgr_send_coalesced", "Messages whose send was deferred to batch them with later ones");
+    plb.add_u64_counter_histogram(l_msgr_send_batch_hist, "msgr_send_batch_histogram",
+                                  batch_msgs_axis, batch_bytes_axis,
+                                  "Histogram of messages and bytes handed to the socket per send");
+
+    plb.add_u64_counter(l_msgr_busy_poll_hit, "msgr_busy_poll_hit", "Busy polls that found events");
+    plb.add_u64_counter(l_msgr_busy_poll_miss, "msgr_busy_poll_miss", "Busy polls that found nothing");
+    plb.add_time(l_msgr_busy_poll_idle_time, "msgr_busy_poll_idle_time", "The total time spent busy polling without finding events");
+
+    plb.add_u64_counter(l_msgr_send_compressed_messages, "msgr_send_compressed_messages", "Messages sent with compressed data");
+    plb.add_u64_counter(l_msgr_send_compress_raw_bytes, "msgr_send_compress_raw_bytes", "Message data bytes before compression");
+    plb.add_u64_counter(l_msgr_send_compress_bytes, "msgr_send_compress_bytes", "Message data bytes after compression");
+    plb.add_time(l_msgr_send_compress_time, "msgr_send_compress_time", "The total time spent compressing message data");
+    plb.add_time(l_msgr_recv_decompress_time, "msgr_recv_decompress_time", "The total time spent decompressing message data");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
+
+    if (cct->_conf->ms_async_rx_buffer_pool_bytes) {
+      rx_buffer_pool = std::make_shared<RxBufferPool>(
+	perf_logger, cct->_conf->ms_async_rx_buffer_pool_bytes);
+    }
   }
   virtual ~Worker() {
+    // outstanding buffers keep the pool alive, but not our counters
+    rx_buffer_pool.reset();
     if (perf_logger) {
       cct->get_perfcounters_collection()->remove(perf_logger);
       delete perf_logger;
@@ -693,8 +693,85 @@ void Infiniband::MemoryManager::RxAllocator::free(char * const block)
   manager->free(m);
 }
 
+Infiniband::MemoryManager::MRCache::MRCache(CephContext *c, ProtectionDomain *p,
+					    uint64_t max)
+  : cct(c), pd(p), max_bytes(max), lock("Infiniband::MemoryManager::MRCache::lock")
+{
+}
+
+Infiniband::MemoryManager::MRCache::~MRCache()
+{
+  Mutex::Locker l(lock);
+  while (!by_addr.empty())
+    _remove(by_addr.begin()->second);
+}
+
+void Infiniband::MemoryManager::MRCache::_remove(Entry *e)
+{
+  assert(!e->inflight);
+  lru.erase(e->lru);
+  by_addr.erase(e->bp.raw_c_str());
+  by_mr.erase(e->mr);
+  bytes -= e->bp.raw_length();
+  ibv_dereg_mr(e->mr);
+  delete e;
+}
+
+void Infiniband::MemoryManager::MRCache::_trim()
+{
+  while (bytes > max_bytes && !lru.empty())
+    _remove(lru.front());
+}
+
+ibv_mr *Infiniband::MemoryManager::MRCache::get(const bufferptr &bp, bool *hit)
+{
+  Mutex::Locker l(lock);
+  Entry *e;
+  auto p = by_addr.find(bp.raw_c_str());
+  if (p != by_addr.end()) {
+    e = p->second;
+    *hit = true;
+  } else {
+    *hit = false;
+    if (bp.raw_length() > max_bytes)
+      return nullptr;
+    ibv_mr *mr = ibv_reg_mr(pd->pd, (void*)bp.raw_c_str(), bp.raw_length(),
+			    IBV_ACCESS_LOCAL_WRITE);
+    if (!mr) {
+      lderr(cct) << __func__ << " failed to register " << bp.raw_length()
+		 << " bytes: " << cpp_strerror(errno) << dendl;
+      return nullptr;
+    }
+    e = new Entry;
+    e->bp = bp;
+    e->mr = mr;
+    by_addr[bp.raw_c_str()] = e;
+    by_mr[mr] = e;
+    bytes += bp.raw_length();
+    e->lru = lru.insert(lru.end(), e);
+    _trim();
+  }
+  if (!e->inflight++)
+    lru.erase(e->lru);
+  return e->mr;
+}
+
+void Infiniband::MemoryManager::MRCache::put(ibv_mr *mr)
+{
+  Mutex::Locker l(lock);
+  auto p = by_mr.find(mr);
+  assert(p != by_mr.end());
+  Entry *e = p->second;
+  assert(e->inflight);
+  if (!--e->inflight) {
+    e->lru = lru.insert(lru.end(), e);
+    _trim();
+  }
+}
+
 Infiniband::MemoryManager::MemoryManager(CephContext *c, Device *d, ProtectionDomain *p)
-  : cct(c), device(d), pd(p),
+  : cct(c), mr_cache(c, p, c->_conf->ms_async_rdma_mr_cache_size),
+    device(d), pd(p),
     rxbuf_pool(sizeof(Chunk) + c->_conf->ms_async_rdma_buffer_size, 
                c->_conf->ms_async_rdma_receive_buffers > 0 ?
                   // if possible make initial pool size 2 * receive_queue_len
@@ -873,7 +950,10 @@ void Infiniband::init()
 
   srq = create_shared_receive_queue(rx_queue_len, MAX_SHARED_RX_SGE_COUNT);
 
-  post_chunks_to_srq(rx_queue_len); //add to srq
+  int r = post_chunks_to_srq(rx_queue_len); //add to srq
+  if (r < (int)rx_queue_len)
+    lderr(cct) << __func__ << " only " << r << " of " << rx_queue_len
+	       << " receive buffers available" << dendl;
 }
 
 Infiniband::~Infiniband()
@@ -932,17 +1012,30 @@ Infiniband::QueuePair* Infiniband::create_queue_pair(CephContext *cct, Completio
   return qp;
 }
 
-void Infiniband::post_chunks_to_srq(int num)
+/*
+ * Returns how many buffers were posted, which is less than num when the
+ * rx pool has reached ms_async_rdma_receive_buffers.
+ */
+int Infiniband::post_chunks_to_srq(int num)
 {
   int ret, i = 0;
+  if (num <= 0)
+    return 0;
   ibv_sge isge[num];
   Chunk *chunk;
   ibv_recv_wr rx_work_request[num];
 
   while (i < num) {
     chunk = get_memory_manager()->get_rx_buffer();
-
-    assert (chunk != NULL);
+    if (!chunk) {
+      ldout(cct, 1) << __func__ << " out of rx buffers, requested " << num
+		    << " got " << i << dendl;
+      if (i == 0)
+	return 0;
+      // rx_work_request[i-1].next was set to &rx_work_request[i]
+      rx_work_request[i-1].next = 0;
+      break;
+    }
 
     isge[i].addr = reinterpret_cast<uint64_t>(chunk->data);
     isge[i].length = chunk->bytes;
@@ -962,6 +1055,7 @@ void Infiniband::post_chunks_to_srq(int num)
   ibv_recv_wr *badworkrequest;
   ret = ibv_post_srq_recv(srq, &rx_work_request[0], &badworkrequest);
   assert(ret == 0);
+  return i;
 }
 
 Infiniband::CompletionChannel* Infiniband::create_comp_channel(CephContext *c)
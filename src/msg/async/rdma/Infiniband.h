@@ -23,11 +23,14 @@
 
 #include <infiniband/verbs.h>
 
+#include <list>
+#include <map>
 #include <string>
 #include <vector>
 
 #include <infiniband/verbs.h>
 
+#include "include/buffer.h"
 #include "include/int_types.h"
 #include "include/page.h"
 #include "common/debug.h"
@@ -136,6 +139,8 @@ enum {
   l_msgr_rdma_inflight_tx_chunks,
   l_msgr_rdma_rx_bufs_in_use,
   l_msgr_rdma_rx_bufs_total,
+  l_msgr_rdma_rx_no_mem,
+  l_msgr_rdma_tx_no_mem_conns,
 
   l_msgr_rdma_tx_total_wc,
   l_msgr_rdma_tx_total_wc_errors,
@@ -169,6 +174,9 @@ enum {
   l_msgr_rdma_rx_chunks,
   l_msgr_rdma_rx_bytes,
   l_msgr_rdma_pending_sent_conns,
+  l_msgr_rdma_tx_zero_copy_chunks,
+  l_msgr_rdma_tx_zero_copy_bytes,
+  l_msgr_rdma_tx_mr_cache_miss,
 
   l_msgr_rdma_last,
 };
@@ -271,6 +279,41 @@ class Infiniband {
       }
     };
 
+    /**
+     * Registrations of buffers sent in place instead of being copied
+     * into tx chunks.  An entry covers a whole buffer::raw and holds a
+     * reference to it, so the memory cannot be freed and reused under
+     * a live MR.  Idle entries are deregistered least recently used
+     * first once more than max_bytes are registered.
+     */
+    class MRCache {
+      struct Entry {
+        bufferptr bp;               ///< pins the raw
+        ibv_mr *mr;
+        unsigned inflight = 0;      ///< sends posted from this MR
+        std::list<Entry*>::iterator lru;  ///< valid if !inflight
+      };
+      CephContext *cct;
+      ProtectionDomain *pd;
+      uint64_t max_bytes;
+      Mutex lock;
+      uint64_t bytes = 0;
+      std::map<const char*, Entry*> by_addr;
+      std::map<ibv_mr*, Entry*> by_mr;
+      std::list<Entry*> lru;        ///< idle entries, oldest first
+
+      void _trim();
+      void _remove(Entry *e);
+     public:
+      MRCache(CephContext *c, ProtectionDomain *p, uint64_t max);
+      ~MRCache();
+
+      /// MR covering **bp** for one send, or NULL if it cannot be registered
+      ibv_mr *get(const bufferptr &bp, bool *hit);
+      /// the send posted from **mr** has completed
+      void put(ibv_mr *mr);
+    };
+
     MemoryManager(CephContext *c, Device *d, ProtectionDomain *p);
     ~MemoryManager();
 
@@ -297,6 +340,7 @@ class Infiniband {
     }
 
     CephContext  *cct;
+    MRCache mr_cache;
    private:
     // TODO: Cluster -> TxPool txbuf_pool
     // chunk layout fix
@@ -454,7 +498,7 @@ class Infiniband {
   typedef MemoryManager::Chunk Chunk;
   QueuePair* create_queue_pair(CephContext *c, CompletionQueue*, CompletionQueue*, ibv_qp_type type);
   ibv_srq* create_shared_receive_queue(uint32_t max_wr, uint32_t max_sge);
-  void  post_chunks_to_srq(int);
+  int post_chunks_to_srq(int);
   void post_chunk_to_pool(Chunk* chunk) {
     get_memory_manager()->release_rx_buffer(chunk);
   }
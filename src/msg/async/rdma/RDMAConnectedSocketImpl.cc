@@ -478,22 +478,44 @@ ssize_t RDMAConnectedSocketImpl::submit(bool more)
     return total_copied;
   };
 
+  // large buffers are sent in place through a cached registration
+  const uint64_t zero_copy_min = cct->_conf->ms_async_rdma_zero_copy_threshold;
   std::vector<Chunk*> tx_buffers;
   std::list<bufferptr>::const_iterator it = pending_bl.buffers().begin();
   std::list<bufferptr>::const_iterator copy_it = it;
   unsigned total = 0;
   unsigned need_reserve_bytes = 0;
   while (it != pending_bl.buffers().end()) {
-    if (infiniband->is_tx_buffer(it->raw_c_str())) {
+    bool in_tx_pool = infiniband->is_tx_buffer(it->raw_c_str());
+    ibv_mr *mr = nullptr;
+    if (!in_tx_pool && zero_copy_min && it->length() >= zero_copy_min) {
+      bool hit;
+      mr = infiniband->get_memory_manager()->mr_cache.get(*it, &hit);
+      if (!hit)
+        worker->perf_logger->inc(l_msgr_rdma_tx_mr_cache_miss);
+    }
+    if (in_tx_pool || mr) {
       if (need_reserve_bytes) {
         unsigned copied = fill_tx_via_copy(tx_buffers, need_reserve_bytes, copy_it, it);
         total += copied;
-        if (copied < need_reserve_bytes)
+        if (copied < need_reserve_bytes) {
+          if (mr)
+            infiniband->get_memory_manager()->mr_cache.put(mr);
           goto sending;
+        }
         need_reserve_bytes = 0;
       }
       assert(copy_it == it);
-      tx_buffers.push_back(infiniband->get_tx_chunk_by_buffer(it->raw_c_str()));
+      if (mr) {
+        Chunk *c = new Chunk(mr, it->length(), const_cast<char*>(it->c_str()));
+        c->set_offset(it->length());
+        tx_buffers.push_back(c);
+        ++dispatcher->inflight;
+        worker->perf_logger->inc(l_msgr_rdma_tx_zero_copy_chunks);
+        worker->perf_logger->inc(l_msgr_rdma_tx_zero_copy_bytes, it->length());
+      } else {
+        tx_buffers.push_back(infiniband->get_tx_chunk_by_buffer(it->raw_c_str()));
+      }
       total += it->length();
       ++copy_it;
     } else {
@@ -548,6 +570,9 @@ int RDMAConnectedSocketImpl::post_work_request(std::vector<Chunk*> &tx_buffers)
     ldout(cct, 25) << __func__ << " sending buffer: " << *current_buffer << " length: " << isge[current_sge].length  << dendl;
 
     iswr[current_swr].wr_id = reinterpret_cast<uint64_t>(*current_buffer);
+    // tag chunks sent in place from a cached MR, see handle_tx_event
+    if (!infiniband->is_tx_buffer((*current_buffer)->buffer))
+      iswr[current_swr].wr_id |= 1;
     iswr[current_swr].next = NULL;
     iswr[current_swr].sg_list = &isge[current_sge];
     iswr[current_swr].num_sge = 1;
@@ -569,11 +594,22 @@ int RDMAConnectedSocketImpl::post_work_request(std::vector<Chunk*> &tx_buffers)
 
   ibv_send_wr *bad_tx_work_request;
   if (ibv_post_send(qp->get_qp(), iswr, &bad_tx_work_request)) {
+    int r = -errno;
     ldout(cct, 1) << __func__ << " failed to send data"
                   << " (most probably should be peer not ready): "
-                  << cpp_strerror(errno) << dendl;
+                  << cpp_strerror(r) << dendl;
     worker->perf_logger->inc(l_msgr_rdma_tx_failed);
-    return -errno;
+    // requests from bad_tx_work_request on were not posted and will
+    // never complete; release the in-place ones
+    for (ibv_send_wr *wr = bad_tx_work_request; wr; wr = wr->next) {
+      if (wr->wr_id & 1) {
+        Chunk *c = reinterpret_cast<Chunk*>(wr->wr_id & ~1ull);
+        infiniband->get_memory_manager()->mr_cache.put(c->mr);
+        delete c;
+        --dispatcher->inflight;
+      }
+    }
+    return r;
   }
   worker->perf_logger->inc(l_msgr_rdma_tx_chunks, tx_buffers.size());
   ldout(cct, 20) << __func__ << " qp state is " << Infiniband::qp_state_string(qp->get_state()) << dendl;
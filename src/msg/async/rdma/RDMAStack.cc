@@ -52,6 +52,8 @@ RDMADispatcher::RDMADispatcher(CephContext* c, RDMAStack* s)
   plb.add_u64_counter(l_msgr_rdma_inflight_tx_chunks, "inflight_tx_chunks", "The number of inflight tx chunks");
   plb.add_u64_counter(l_msgr_rdma_rx_bufs_in_use, "rx_bufs_in_use", "The number of rx buffers that are holding data and being processed");
   plb.add_u64_counter(l_msgr_rdma_rx_bufs_total, "rx_bufs_total", "The total number of rx buffers");
+  plb.add_u64_counter(l_msgr_rdma_rx_no_mem, "rx_no_mem", "The number of rx buffers that could not be posted to the srq");
+  plb.add_u64_counter(l_msgr_rdma_tx_no_mem_conns, "tx_no_mem", "The number of times a connection waited for free tx chunks");
 
   plb.add_u64_counter(l_msgr_rdma_tx_total_wc, "tx_total_wc", "The number of tx work comletions");
   plb.add_u64_counter(l_msgr_rdma_tx_total_wc_errors, "tx_total_wc_errors", "The number of tx errors");
@@ -158,6 +160,8 @@ void RDMADispatcher::post_chunk_to_pool(Chunk* chunk) {
   Mutex::Locker l(lock);
   get_stack()->get_infiniband().post_chunk_to_pool(chunk);
   perf_logger->dec(l_msgr_rdma_rx_bufs_in_use);
+  if (rx_deficit)
+    rx_deficit -= get_stack()->get_infiniband().post_chunks_to_srq(rx_deficit);
 }
 
 void RDMADispatcher::polling()
@@ -189,7 +193,13 @@ void RDMADispatcher::polling()
       perf_logger->inc(l_msgr_rdma_rx_bufs_in_use, rx_ret);
 
       Mutex::Locker l(lock);//make sure connected socket alive when pass wc
-      get_stack()->get_infiniband().post_chunks_to_srq(rx_ret);
+      // replenish the srq; whatever the rx pool cannot provide now is
+      // posted as buffers are returned (see post_chunk_to_pool)
+      unsigned want = rx_ret + rx_deficit;
+      unsigned posted = get_stack()->get_infiniband().post_chunks_to_srq(want);
+      if (want - posted > rx_deficit)
+        perf_logger->inc(l_msgr_rdma_rx_no_mem, want - posted - rx_deficit);
+      rx_deficit = want - posted;
       for (int i = 0; i < rx_ret; ++i) {
         ibv_wc* response = &wc[i];
         Chunk* chunk = reinterpret_cast<Chunk *>(response->wr_id);
@@ -346,7 +356,8 @@ void RDMADispatcher::handle_tx_event(ibv_wc *cqe, int n)
 
   for (int i = 0; i < n; ++i) {
     ibv_wc* response = &cqe[i];
-    Chunk* chunk = reinterpret_cast<Chunk *>(response->wr_id);
+    bool zero_copy = response->wr_id & 1;
+    Chunk* chunk = reinterpret_cast<Chunk *>(response->wr_id & ~1ull);
     ldout(cct, 25) << __func__ << " QP: " << response->qp_num
                    << " len: " << response->byte_len << " , addr:" << chunk
                    << " " << get_stack()->get_infiniband().wc_status_to_string(response->status) << dendl;
@@ -380,7 +391,12 @@ void RDMADispatcher::handle_tx_event(ibv_wc *cqe, int n)
 
     //TX completion may come either from regular send message or from 'fin' message.
     //In the case of 'fin' wr_id points to the QueuePair.
-    if (get_stack()->get_infiniband().get_memory_manager()->is_tx_buffer(chunk->buffer)) {
+    if (zero_copy) {
+      // sent in place from a bufferptr, release its registration
+      get_stack()->get_infiniband().get_memory_manager()->mr_cache.put(chunk->mr);
+      delete chunk;
+      --inflight;
+    } else if (get_stack()->get_infiniband().get_memory_manager()->is_tx_buffer(chunk->buffer)) {
       tx_chunks.push_back(chunk);
     } else if (reinterpret_cast<QueuePair*>(response->wr_id)->get_local_qp_number() == response->qp_num ) {
       ldout(cct, 1) << __func__ << " sending of the disconnect msg completed" << dendl;
@@ -433,6 +449,9 @@ RDMAWorker::RDMAWorker(CephContext *c, unsigned i)
   plb.add_u64_counter(l_msgr_rdma_rx_chunks, "rx_chunks", "The number of rx chunks transmitted");
   plb.add_u64_counter(l_msgr_rdma_rx_bytes, "rx_bytes", "The bytes of rx chunks transmitted");
   plb.add_u64_counter(l_msgr_rdma_pending_sent_conns, "pending_sent_conns", "The count of pending sent conns");
+  plb.add_u64_counter(l_msgr_rdma_tx_zero_copy_chunks, "tx_zero_copy_chunks", "The number of buffers sent in place without copying");
+  plb.add_u64_counter(l_msgr_rdma_tx_zero_copy_bytes, "tx_zero_copy_bytes", "The bytes sent in place without copying");
+  plb.add_u64_counter(l_msgr_rdma_tx_mr_cache_miss, "tx_mr_cache_miss", "The number of buffers registered for sending in place");
 
   perf_logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perf_logger);
@@ -495,6 +514,8 @@ int RDMAWorker::get_reged_mem(RDMAConnectedSocketImpl *o, std::vector<Chunk*> &c
   if (got >= bytes)
     return r;
 
+  stack->get_dispatcher().perf_logger->inc(l_msgr_rdma_tx_no_mem_conns);
+
   if (o) {
     if (!o->is_pending()) {
       pending_sent_conns.push_back(o);
@@ -47,7 +47,8 @@ class RDMADispatcher {
   bool done = false;
   std::atomic<uint64_t> num_dead_queue_pair = {0};
   std::atomic<uint64_t> num_qp_conn = {0};
-  Mutex lock; // protect `qp_conns`, `dead_queue_pairs`
+  Mutex lock; // protect `qp_conns`, `dead_queue_pairs`, `rx_deficit`
+  unsigned rx_deficit = 0;  ///< srq entries waiting for free rx buffers
   // qp_num -> InfRcConnection
   // The main usage of `qp_conns` is looking up connection by qp_num,
   // so the lifecycle of element in `qp_conns` is the lifecycle of qp.
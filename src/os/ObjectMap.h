@@ -156,6 +156,12 @@ public:
 
   virtual void compact() {}
 
+  /// Collect this thread's updates into one kv transaction, until end_batch
+  virtual void begin_batch() {}
+
+  /// Submit the updates collected since begin_batch
+  virtual int end_batch() { return 0; }
+
   typedef KeyValueDB::GenericIteratorImpl ObjectMapIteratorImpl;
   typedef ceph::shared_ptr<ObjectMapIteratorImpl> ObjectMapIterator;
   virtual ObjectMapIterator get_iterator(const ghobject_t &oid) {
@@ -202,3 +202,31 @@ int ObjectStore::queue_transactions(
   return queue_transactions(osr, tls, _onreadable, _oncommit,
 			    onreadable_sync, op);
 }
+
+int ObjectStore::data_digest(
+  CollectionHandle &c,
+  const ghobject_t& oid,
+  uint64_t stride,
+  uint32_t seed,
+  uint32_t *digest,
+  uint64_t *size,
+  uint32_t op_flags)
+{
+  assert(stride > 0);
+  uint32_t crc = seed;
+  uint64_t pos = 0;
+  while (true) {
+    bufferlist bl;
+    int r = read(c, oid, pos, stride, bl, op_flags);
+    if (r < 0)
+      return r;
+    if (r == 0)
+      break;
+    crc = bl.crc32c(crc);
+    pos += bl.length();
+  }
+  *digest = crc;
+  if (size)
+    *size = pos;
+  return 0;
+}
@@ -1751,6 +1751,34 @@ public:
      return fiemap(c->get_cid(), oid, offset, len, destmap);
    }
 
+  /**
+   * data_digest -- crc32c of the whole object data
+   *
+   * Reads the object in pieces of at most stride bytes and returns the
+   * crc32c of its data with the given seed, as deep scrub needs it.
+   * A store that verifies its own crc32c checksums on the read path
+   * may derive the digest from them instead of hashing the data again.
+   * A store that can should keep the object from changing while the
+   * digest is derived, so that digest and size describe one version.
+   *
+   * @param c collection for object
+   * @param oid oid of object
+   * @param stride maximum number of bytes read at a time
+   * @param seed crc32c seed
+   * @param digest [out] crc32c of the object data
+   * @param size [out] number of bytes digested, if not null
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @returns 0 on success, negative error code on failure.
+   */
+  virtual int data_digest(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t stride,
+    uint32_t seed,
+    uint32_t *digest,
+    uint64_t *size = nullptr,
+    uint32_t op_flags = 0);
+
   /**
    * getattr -- get an xattr of an object
    *
@@ -1906,6 +1934,20 @@ public:
     return collection_list(c->get_cid(), start, end, max, ls, next);
   }
 
+  /**
+   * hint that each of a batch of objects is about to be accessed
+   *
+   * Typically called with the result of a collection_list before a
+   * stat/getattr/read of each object.  Stores that cache per-object
+   * metadata may load all of it in one pass instead of looking each
+   * object up separately.  Objects that do not exist are ignored.
+   *
+   * @param c collection
+   * @param oids objects, ideally in collection_list order
+   */
+  virtual void prefetch_objects(CollectionHandle &c,
+				const vector<ghobject_t>& oids) {}
+
 
   /// OMAP
   /// Get omap contents
@@ -12,6 +12,7 @@
 #ifndef CEPH_OS_BLUESTORE_ALLOCATOR_H
 #define CEPH_OS_BLUESTORE_ALLOCATOR_H
 
+#include <functional>
 #include <ostream>
 #include "include/assert.h"
 #include "os/bluestore/bluestore_types.h"
@@ -48,6 +49,12 @@ public:
 
   virtual void dump() = 0;
 
+  /// call f for each free extent; false if not supported
+  virtual bool enumerate_free(
+    std::function<void(uint64_t offset, uint64_t length)> f) {
+    return false;
+  }
+
   virtual void init_add_free(uint64_t offset, uint64_t length) = 0;
   virtual void init_rm_free(uint64_t offset, uint64_t length) = 0;
 
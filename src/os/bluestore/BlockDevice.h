@@ -104,6 +104,8 @@ public:
   static BlockDevice *create(
     CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv);
   virtual bool supported_bdev_label() { return true; }
+  /// true if writes of any offset and length are persisted in place
+  virtual bool is_byte_addressable() const { return false; }
   virtual bool is_rotational() { return rotational; }
 
   virtual void aio_submit(IOContext *ioc) = 0;
@@ -28,6 +28,7 @@ MEMPOOL_DEFINE_OBJECT_FACTORY(BlueFS::FileLock, bluefs_file_lock, bluefs);
 BlueFS::BlueFS(CephContext* cct)
   : cct(cct),
     bdev(MAX_BDEV),
+    bdev_byte_append(MAX_BDEV, false),
     ioc(MAX_BDEV),
     block_all(MAX_BDEV),
     block_total(MAX_BDEV, 0)
@@ -96,6 +97,39 @@ void BlueFS::_init_logger()
   b.add_u64_counter(l_bluefs_bytes_written_sst, "bytes_written_sst",
 		    "Bytes written to SSTs", "sst",
 		    PerfCountersBuilder::PRIO_CRITICAL);
+  b.add_time_avg(l_bluefs_fsync_lat, "fsync_lat",
+		 "Average latency of file fsync");
+
+  // latency in nanoseconds, log2 buckets starting at 100us
+  PerfHistogramCommon::axis_config_d fsync_lat_axis{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    100000,
+    32,
+  };
+  PerfHistogramCommon::axis_config_d fsync_bytes_axis{
+    "Flushed size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    4096,
+    32,
+  };
+  b.add_u64_counter_histogram(
+    l_bluefs_fsync_lat_bytes_hist, "fsync_latency_bytes_histogram",
+    fsync_lat_axis, fsync_bytes_axis,
+    "Histogram of file fsync latency + bytes flushed");
+  b.add_time_avg(l_bluefs_compact_lock_lat, "compact_lock_lat",
+		 "Average time BlueFS lock is held by a log compaction");
+  b.add_u64_counter(l_bluefs_spillover_hot_bytes, "spillover_hot_bytes",
+		    "Bytes of hot files placed on the slow device because "
+		    "the faster one was full");
+  b.add_u64_counter(l_bluefs_spillover_cold_bytes, "spillover_cold_bytes",
+		    "Bytes of cold files placed on the slow device because "
+		    "the faster one was full");
+  b.add_u64_counter(l_bluefs_cold_files_to_slow, "cold_files_to_slow",
+		    "Cold files placed directly on the slow device to keep "
+		    "db space for hot files");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -144,6 +178,13 @@ int BlueFS::add_block_device(unsigned id, const string& path)
 	  << " size " << pretty_si_t(b->get_size()) << "B" << dendl;
   bdev[id] = b;
   ioc[id] = new IOContext(cct, NULL);
+  // latched here so a running writer never switches modes mid-file
+  bdev_byte_append[id] = b->is_byte_addressable() &&
+    cct->_conf->get_val<bool>("bluefs_pmem_wal_byte_append");
+  if (bdev_byte_append[id]) {
+    dout(1) << __func__ << " bdev " << id
+	    << " is byte addressable, appending WAL without padding" << dendl;
+  }
   return 0;
 }
 
@@ -1100,6 +1141,7 @@ void BlueFS::_compact_log_dump_metadata(bluefs_transaction_t *t)
 void BlueFS::_compact_log_sync()
 {
   dout(10) << __func__ << dendl;
+  ceph::mono_time start = ceph::mono_clock::now();
   File *log_file = log_writer->file.get();
 
   // clear out log (be careful who calls us!!!)
@@ -1155,6 +1197,7 @@ void BlueFS::_compact_log_sync()
   }
 
   logger->inc(l_bluefs_log_compactions);
+  logger->tinc(l_bluefs_compact_lock_lat, ceph::mono_clock::now() - start);
 }
 
 /*
@@ -1163,13 +1206,16 @@ void BlueFS::_compact_log_sync()
  * old extent(s) won't be written to, and reflect everything to compact.
  * New events will be written to the new region that we'll keep.
  *
- * 2. While still holding the lock, encode a bufferlist that dumps all of the
- * in-memory fnodes and names.  This will become the new beginning of the
- * log.  The last event will jump to the log continuation extent from #1.
+ * 2. While still holding the lock, snapshot all of the in-memory fnodes
+ * and names into a transaction and allocate space for it.  This will
+ * become the new beginning of the log.  The last event will jump to the
+ * log continuation extent from #1.
  *
- * 3. Queue a write to a new extent for the new beginnging of the log.
+ * 3. Drop the lock, then encode the snapshot and write it to the new
+ * extent.  Nothing else touches new_log, and its extents were fully
+ * allocated in #2, so this needs no shared state.
  *
- * 4. Drop lock and wait
+ * 4. Wait for the write to be stable, still without the lock.
  *
  * 5. Retake the lock.
  *
@@ -1182,6 +1228,8 @@ void BlueFS::_compact_log_sync()
 void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
 {
   dout(10) << __func__ << dendl;
+  ceph::mono_time lock_start = ceph::mono_clock::now();
+  ceph::timespan lock_held = ceph::timespan::zero();
   File *log_file = log_writer->file.get();
   assert(!new_log);
   assert(!new_log_writer);
@@ -1207,7 +1255,10 @@ void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
 
   flush_bdev();  // FIXME?
 
+  // the log flush drops the lock while it waits; do not count that.
+  lock_held += ceph::mono_clock::now() - lock_start;
   _flush_and_sync_log(l, 0, old_log_jump_to);
+  lock_start = ceph::mono_clock::now();
 
   // 2. prepare compacted log
   bluefs_transaction_t t;
@@ -1220,10 +1271,6 @@ void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
                                 cct->_conf->bluefs_alloc_size);
   t.op_jump(log_seq, new_log_jump_to);
 
-  bufferlist bl;
-  ::encode(t, bl);
-  _pad_bl(bl);
-
   dout(10) << __func__ << " new_log_jump_to 0x" << std::hex << new_log_jump_to
 	   << std::dec << dendl;
 
@@ -1235,12 +1282,20 @@ void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
   assert(r == 0);
   new_log->fnode.recalc_allocated();
   new_log_writer = _create_writer(new_log);
-  new_log_writer->append(bl);
 
-  // 3. flush
+  // 3. encode and flush.  new_log_writer being set keeps _flush_and_sync_log
+  // from growing the log fnode under us, and since new_log is ino 0 with
+  // all of its space allocated _flush_range will not dirty it.
+  lock_held += ceph::mono_clock::now() - lock_start;
+  lock.unlock();
+
+  bufferlist bl;
+  ::encode(t, bl);
+  _pad_bl(bl);
+  assert(bl.length() <= new_log_jump_to);
+  new_log_writer->append(bl);
   r = _flush(new_log_writer, true);
   assert(r == 0);
-  lock.unlock();
 
   // 4. wait
   dout(10) << __func__ << " waiting for compacted log to sync" << dendl;
@@ -1253,6 +1308,7 @@ void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
 
   // 5. retake lock
   lock.lock();
+  lock_start = ceph::mono_clock::now();
 
   // 6. update our log fnode
   // discard first old_log_jump_to extents
@@ -1299,9 +1355,11 @@ void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
   ++super.version;
   _write_super();
 
+  lock_held += ceph::mono_clock::now() - lock_start;
   lock.unlock();
   flush_bdev();
   lock.lock();
+  lock_start = ceph::mono_clock::now();
 
   // 8. release old space
   dout(10) << __func__ << " release old log extents " << old_extents << dendl;
@@ -1322,6 +1380,8 @@ void BlueFS::_compact_log_async(std::unique_lock<std::mutex>& l)
 
   dout(10) << __func__ << " log extents " << log_file->fnode.extents << dendl;
   logger->inc(l_bluefs_log_compactions);
+  lock_held += ceph::mono_clock::now() - lock_start;
+  logger->tinc(l_bluefs_compact_lock_lat, lock_held);
 }
 
 void BlueFS::_pad_bl(bufferlist& bl)
@@ -1495,9 +1555,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
     // we should never run out of log space here; see the min runway check
     // in _flush_and_sync_log.
     assert(h->file->fnode.ino != 1);
-    int r = _allocate(h->file->fnode.prefer_bdev,
-		      offset + length - allocated,
-		      &h->file->fnode.extents);
+    int r = _allocate_file(h->file, offset + length - allocated);
     if (r < 0) {
       derr << __func__ << " allocated: 0x" << std::hex << allocated
            << " offset: 0x" << offset << " length: 0x" << length << std::dec
@@ -1559,7 +1617,10 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   dout(20) << __func__ << " in " << *p << " x_off 0x"
            << std::hex << x_off << std::dec << dendl;
 
-  unsigned partial = x_off & ~super.block_mask();
+  // on a byte addressable WAL device we append exactly the new bytes, so
+  // there is no partial block to rewrite in front of them.
+  bool byte_append = h->writer_type == WRITER_WAL && bdev_byte_append[p->bdev];
+  unsigned partial = byte_append ? 0 : x_off & ~super.block_mask();
   bufferlist bl;
   if (partial) {
     dout(20) << __func__ << " using partial tail 0x"
@@ -1611,7 +1672,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
     bufferlist t;
     t.substr_of(bl, bloff, x_len);
     unsigned tail = x_len & ~super.block_mask();
-    if (tail) {
+    if (tail && !(h->writer_type == WRITER_WAL && bdev_byte_append[p->bdev])) {
       size_t zlen = super.block_size - tail;
       dout(20) << __func__ << " caching tail of 0x"
                << std::hex << tail
@@ -1754,6 +1815,8 @@ int BlueFS::_truncate(FileWriter *h, uint64_t offset)
 int BlueFS::_fsync(FileWriter *h, std::unique_lock<std::mutex>& l)
 {
   dout(10) << __func__ << " " << h << " " << h->file->fnode << dendl;
+  ceph::mono_time start = ceph::mono_clock::now();
+  uint64_t bytes = h->get_effective_write_pos() - h->pos;
   int r = _flush(h, true);
   if (r < 0)
      return r;
@@ -1769,6 +1832,11 @@ int BlueFS::_fsync(FileWriter *h, std::unique_lock<std::mutex>& l)
     assert(h->file->dirty_seq == 0 ||  // cleaned
 	   h->file->dirty_seq > s);    // or redirtied by someone else
   }
+  ceph::timespan lat = ceph::mono_clock::now() - start;
+  logger->tinc(l_bluefs_fsync_lat, lat);
+  logger->hinc(l_bluefs_fsync_lat_bytes_hist,
+	       std::chrono::duration_cast<std::chrono::nanoseconds>(lat).count(),
+	       bytes);
   return 0;
 }
 
@@ -1865,6 +1933,61 @@ int BlueFS::_allocate(uint8_t id, uint64_t len,
   return 0;
 }
 
+int BlueFS::_allocate_file(FileRef f, uint64_t len)
+{
+  auto& extents = f->fnode.extents;
+  size_t n = extents.size();
+  uint64_t tail = n ? extents.back().length : 0;
+  int r = _allocate(f->fnode.prefer_bdev, len, &extents);
+  if (r < 0 || f->fnode.prefer_bdev == BDEV_SLOW)
+    return r;
+
+  // anything that landed on the slow device spilled over from a full
+  // faster one.  the first new extent may have been merged into the old
+  // last one.
+  uint64_t spilled = 0;
+  for (size_t i = n ? n - 1 : 0; i < extents.size(); ++i) {
+    if (extents[i].bdev == BDEV_SLOW)
+      spilled += extents[i].length - (i + 1 == n ? tail : 0);
+  }
+  if (spilled) {
+    dout(10) << __func__ << " " << (f->cold ? "cold" : "hot") << " file "
+	     << f->fnode.ino << " spilled 0x" << std::hex << spilled
+	     << std::dec << " to slow device" << dendl;
+    logger->inc(f->cold ? l_bluefs_spillover_cold_bytes :
+		l_bluefs_spillover_hot_bytes, spilled);
+  }
+  return 0;
+}
+
+void BlueFS::set_cold(FileWriter *h)
+{
+  std::lock_guard<std::mutex> l(lock);
+  FileRef f = h->file;
+  f->cold = true;
+
+  // once the db device runs low, keep what is left of it for hot data
+  // (wal, L0 and the first levels) and put new cold files on the slow
+  // device instead of letting hot ones spill there later.  only files
+  // with nothing allocated yet are redirected; existing extents stay put
+  // until rocksdb compacts the file away.
+  if (f->fnode.prefer_bdev != BDEV_DB ||
+      !bdev[BDEV_SLOW] || !alloc[BDEV_DB] ||
+      f->fnode.get_allocated())
+    return;
+  uint64_t reserve = block_total[BDEV_DB] *
+    cct->_conf->bluefs_db_hot_reserve_ratio;
+  uint64_t avail = alloc[BDEV_DB]->get_free();
+  if (avail >= reserve)
+    return;
+  dout(10) << __func__ << " file " << f->fnode.ino << " db free 0x"
+	   << std::hex << avail << " < reserve 0x" << reserve << std::dec
+	   << ", placing on slow device" << dendl;
+  f->fnode.prefer_bdev = BDEV_SLOW;
+  log_t.op_file_update(f->fnode);
+  logger->inc(l_bluefs_cold_files_to_slow);
+}
+
 int BlueFS::_preallocate(FileRef f, uint64_t off, uint64_t len)
 {
   dout(10) << __func__ << " file " << f->fnode << " 0x"
@@ -1877,7 +2000,7 @@ int BlueFS::_preallocate(FileRef f, uint64_t off, uint64_t len)
   uint64_t allocated = f->fnode.get_allocated();
   if (off + len > allocated) {
     uint64_t want = off + len - allocated;
-    int r = _allocate(f->fnode.prefer_bdev, want, &f->fnode.extents);
+    int r = _allocate_file(f, want);
     if (r < 0)
       return r;
     f->fnode.recalc_allocated();
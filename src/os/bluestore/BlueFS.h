@@ -35,6 +35,12 @@ enum {
   l_bluefs_files_written_sst,
   l_bluefs_bytes_written_wal,
   l_bluefs_bytes_written_sst,
+  l_bluefs_fsync_lat,
+  l_bluefs_fsync_lat_bytes_hist,
+  l_bluefs_compact_lock_lat,
+  l_bluefs_spillover_hot_bytes,
+  l_bluefs_spillover_cold_bytes,
+  l_bluefs_cold_files_to_slow,
   l_bluefs_last,
 };
 
@@ -60,6 +66,7 @@ public:
     uint64_t dirty_seq;
     bool locked;
     bool deleted;
+    bool cold;    ///< long-lived data (deep sst level); not persisted
     boost::intrusive::list_member_hook<> dirty_item;
 
     std::atomic_int num_readers, num_writers;
@@ -71,6 +78,7 @@ public:
 	dirty_seq(0),
 	locked(false),
 	deleted(false),
+	cold(false),
 	num_readers(0),
 	num_writers(0),
 	num_reading(0)
@@ -249,6 +257,7 @@ private:
    *  BDEV_SLOW db.slow/ - a big, slow device, to spill over to as BDEV_DB fills
    */
   vector<BlockDevice*> bdev;                  ///< block devices we can use
+  vector<bool> bdev_byte_append;              ///< append WAL bytes unpadded
   vector<IOContext*> ioc;                     ///< IOContexts for bdevs
   vector<interval_set<uint64_t> > block_all;  ///< extents in bdev we own
   vector<uint64_t> block_total;               ///< sum of block_all
@@ -269,6 +278,7 @@ private:
 
   int _allocate(uint8_t bdev, uint64_t len,
 		mempool::bluefs::vector<bluefs_extent_t> *ev);
+  int _allocate_file(FileRef f, uint64_t len);
   int _flush_range(FileWriter *h, uint64_t offset, uint64_t length);
   int _flush(FileWriter *h, bool force);
   int _fsync(FileWriter *h, std::unique_lock<std::mutex>& l);
@@ -435,6 +445,9 @@ public:
     return _truncate(h, offset);
   }
 
+  /// mark a newly created file as holding long-lived (cold) data
+  void set_cold(FileWriter *h);
+
 };
 
 #endif
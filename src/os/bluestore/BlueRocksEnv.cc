@@ -5,6 +5,7 @@
 #include "BlueFS.h"
 #include "include/stringify.h"
 #include "kv/RocksDBStore.h"
+#include "rocksdb/version.h"
 
 rocksdb::Status err_to_status(int r)
 {
@@ -211,6 +212,17 @@ class BlueRocksWritableFile : public rocksdb::WritableFile {
     return rocksdb::Status::OK();
   }
 
+#if ROCKSDB_MAJOR > 5 || (ROCKSDB_MAJOR == 5 && ROCKSDB_MINOR >= 10)
+  // rocksdb derives the hint from the output level of flushes and
+  // compactions; the deepest levels hold most of the data and are the
+  // least likely to be rewritten soon.
+  void SetWriteLifeTimeHint(rocksdb::Env::WriteLifeTimeHint hint) override {
+    rocksdb::WritableFile::SetWriteLifeTimeHint(hint);
+    if (hint == rocksdb::Env::WLTH_EXTREME)
+      fs->set_cold(h);
+  }
+#endif
+
   // true if Sync() and Fsync() are safe to call concurrently with Append()
   // and Flush().
   bool IsSyncThreadSafe() const override {
@@ -16,6 +16,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <thread>
 
 #include "include/cpp-btree/btree_set.h"
 
@@ -66,6 +67,8 @@ const string PREFIX_OMAP = "M";    // u64 + keyname -> value
 const string PREFIX_DEFERRED = "L";  // id -> deferred_transaction_t
 const string PREFIX_ALLOC = "B";   // u64 offset -> u64 length (freelist)
 const string PREFIX_SHARED_BLOB = "X"; // u64 offset -> shared_blob_t
+const string PREFIX_COMPRESSION_DICT = "Z"; // u32 id -> dictionary
+const string PREFIX_ALLOC_SNAPSHOT = "A"; // u64 chunk -> free extents
 
 // write a label in the first block.  always use this size.  note that
 // bluefs makes a matching assumption about the location of its
@@ -892,10 +895,26 @@ void BlueStore::LRUCache::_trim(uint64_t onode_max, uint64_t buffer_max)
   --p;
   int skipped = 0;
   int max_skipped = g_conf->bluestore_cache_trim_max_skip_pinned;
+  int requeued = 0;
+  int max_requeued = onode_lru.size();
   while (num > 0) {
     Onode *o = &*p;
     int refs = o->nref.load();
+    if (refs == 1 && o->lru_referenced.exchange(false) &&
+	p != onode_lru.begin() && ++requeued <= max_requeued) {
+      // hit by a lockless lookup since the last pass; touch it now
+      dout(30) << __func__ << "  requeue " << o->oid << dendl;
+      onode_lru.erase(p--);
+      onode_lru.push_front(*o);
+      continue;
+    }
+    o->get();  // paranoia
+    if (refs == 1 && !o->c->onode_map.try_remove(o)) {
+      // raced with a lockless lookup
+      refs = std::max(2, o->nref.load() - 1);
+    }
     if (refs > 1) {
+      o->put();
       dout(20) << __func__ << "  " << o->oid << " has " << refs
 	       << " refs, skipping" << dendl;
       if (++skipped >= max_skipped) {
@@ -919,8 +938,6 @@ void BlueStore::LRUCache::_trim(uint64_t onode_max, uint64_t buffer_max)
       onode_lru.erase(p);
       assert(num == 1);
     }
-    o->get();  // paranoia
-    o->c->onode_map.remove(o->oid);
     o->put();
     --num;
   }
@@ -1188,11 +1205,27 @@ void BlueStore::TwoQCache::_trim(uint64_t onode_max, uint64_t buffer_max)
   --p;
   int skipped = 0;
   int max_skipped = g_conf->bluestore_cache_trim_max_skip_pinned;
+  int requeued = 0;
+  int max_requeued = onode_lru.size();
   while (num > 0) {
     Onode *o = &*p;
     dout(20) << __func__ << " considering " << o << dendl;
     int refs = o->nref.load();
+    if (refs == 1 && o->lru_referenced.exchange(false) &&
+	p != onode_lru.begin() && ++requeued <= max_requeued) {
+      // hit by a lockless lookup since the last pass; touch it now
+      dout(30) << __func__ << " requeue " << o->oid << dendl;
+      onode_lru.erase(p--);
+      onode_lru.push_front(*o);
+      continue;
+    }
+    o->get();  // paranoia
+    if (refs == 1 && !o->c->onode_map.try_remove(o)) {
+      // raced with a lockless lookup
+      refs = std::max(2, o->nref.load() - 1);
+    }
     if (refs > 1) {
+      o->put();
       dout(20) << __func__ << "  " << o->oid << " has " << refs
 	       << " refs; skipping" << dendl;
       if (++skipped >= max_skipped) {
@@ -1216,8 +1249,6 @@ void BlueStore::TwoQCache::_trim(uint64_t onode_max, uint64_t buffer_max)
       onode_lru.erase(p);
       assert(num == 1);
     }
-    o->get();  // paranoia
-    o->c->onode_map.remove(o->oid);
     o->put();
     --num;
   }
@@ -1511,6 +1542,7 @@ void BlueStore::BufferSpace::split(Cache* cache, size_t pos, BlueStore::BufferSp
 BlueStore::OnodeRef BlueStore::OnodeSpace::add(const ghobject_t& oid, OnodeRef o)
 {
   std::lock_guard<std::recursive_mutex> l(cache->lock);
+  RWLock::WLocker sl(lock);
   auto p = onode_map.find(oid);
   if (p != onode_map.end()) {
     ldout(cache->cct, 30) << __func__ << " " << oid << " " << o
@@ -1530,7 +1562,20 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
   OnodeRef o;
   bool hit = false;
 
-  {
+  if (cache->cct->_conf->bluestore_cache_onode_lockless_lookup) {
+    // lru position is fixed up lazily by _trim
+    RWLock::RLocker sl(lock);
+    auto p = onode_map.find(oid);
+    if (p == onode_map.end()) {
+      ldout(cache->cct, 30) << __func__ << " " << oid << " miss" << dendl;
+    } else {
+      ldout(cache->cct, 30) << __func__ << " " << oid << " hit " << p->second
+			    << dendl;
+      o = p->second;
+      o->lru_referenced = true;
+      hit = true;
+    }
+  } else {
     std::lock_guard<std::recursive_mutex> l(cache->lock);
     ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.find(oid);
     if (p == onode_map.end()) {
@@ -1552,9 +1597,21 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
   return o;
 }
 
+bool BlueStore::OnodeSpace::try_remove(Onode *o)
+{
+  RWLock::WLocker l(lock);
+  // the map and our caller each hold a ref
+  if (o->nref.load() > 2) {
+    return false;
+  }
+  onode_map.erase(o->oid);
+  return true;
+}
+
 void BlueStore::OnodeSpace::clear()
 {
   std::lock_guard<std::recursive_mutex> l(cache->lock);
+  RWLock::WLocker sl(lock);
   ldout(cache->cct, 10) << __func__ << dendl;
   for (auto &p : onode_map) {
     cache->_rm_onode(p.second);
@@ -1564,7 +1621,7 @@ void BlueStore::OnodeSpace::clear()
 
 bool BlueStore::OnodeSpace::empty()
 {
-  std::lock_guard<std::recursive_mutex> l(cache->lock);
+  RWLock::RLocker l(lock);
   return onode_map.empty();
 }
 
@@ -1575,6 +1632,7 @@ void BlueStore::OnodeSpace::rename(
   const mempool::bluestore_cache_other::string& new_okey)
 {
   std::lock_guard<std::recursive_mutex> l(cache->lock);
+  RWLock::WLocker sl(lock);
   ldout(cache->cct, 30) << __func__ << " " << old_oid << " -> " << new_oid
 			<< dendl;
   ceph::unordered_map<ghobject_t,OnodeRef>::iterator po, pn;
@@ -1605,7 +1663,7 @@ void BlueStore::OnodeSpace::rename(
 
 bool BlueStore::OnodeSpace::map_any(std::function<bool(OnodeRef)> f)
 {
-  std::lock_guard<std::recursive_mutex> l(cache->lock);
+  RWLock::RLocker l(lock);
   ldout(cache->cct, 20) << __func__ << dendl;
   for (auto& i : onode_map) {
     if (f(i.second)) {
@@ -2941,6 +2999,36 @@ BlueStore::BlobRef BlueStore::ExtentMap::split_blob(
 #undef dout_prefix
 #define dout_prefix *_dout << "bluestore.onode(" << this << ")." << __func__ << " "
 
+BlueStore::Onode* BlueStore::Onode::decode(
+  Collection *c,
+  const ghobject_t& oid,
+  const mempool::bluestore_cache_other::string& key,
+  const bufferlist& v)
+{
+  BlueStore *store = c->store;
+  Onode *on = new Onode(c, oid, key);
+  on->exists = true;
+  bufferptr::iterator p = v.front().begin_deep();
+  on->onode.decode(p);
+
+  // initialize extent_map
+  on->extent_map.decode_spanning_blobs(p);
+  if (on->onode.extent_map_shards.empty()) {
+    denc(on->extent_map.inline_bl, p);
+    on->extent_map.decode_some(on->extent_map.inline_bl);
+    if (!store->cct->_conf->bluestore_extent_map_inline_cache) {
+      store->logger->inc(l_bluestore_extent_map_inline_released,
+			 on->extent_map.inline_bl.length());
+      on->extent_map.inline_bl.clear();
+    }
+  } else {
+    on->extent_map.init_shards(false, false);
+    // drop the preallocated inline buffer; it is never used when sharded
+    on->extent_map.inline_bl.clear();
+  }
+  return on;
+}
+
 void BlueStore::Onode::flush()
 {
   if (flushing_count.load()) {
@@ -3227,19 +3315,7 @@ BlueStore::OnodeRef BlueStore::Collection::get_onode(
   } else {
     // loaded
     assert(r >= 0);
-    on = new Onode(this, oid, key);
-    on->exists = true;
-    bufferptr::iterator p = v.front().begin_deep();
-    on->onode.decode(p);
-
-    // initialize extent_map
-    on->extent_map.decode_spanning_blobs(p);
-    if (on->onode.extent_map_shards.empty()) {
-      denc(on->extent_map.inline_bl, p);
-      on->extent_map.decode_some(on->extent_map.inline_bl);
-    } else {
-      on->extent_map.init_shards(false, false);
-    }
+    on = Onode::decode(this, oid, key, v);
   }
   o.reset(on);
   return onode_map.add(oid, o);
@@ -3254,6 +3330,8 @@ void BlueStore::Collection::split_cache(
   std::lock(cache->lock, dest->cache->lock);
   std::lock_guard<std::recursive_mutex> l(cache->lock, std::adopt_lock);
   std::lock_guard<std::recursive_mutex> l2(dest->cache->lock, std::adopt_lock);
+  RWLock::WLocker sl(onode_map.lock);
+  RWLock::WLocker sl2(dest->onode_map.lock);
 
   int destbits = dest->cnode.bits;
   spg_t destpg;
@@ -3318,6 +3396,9 @@ void BlueStore::Collection::split_cache(
 
 // =======================================================
 
+#undef dout_prefix
+#define dout_prefix *_dout << "bluestore.MempoolThread(" << this << ") "
+
 void *BlueStore::MempoolThread::entry()
 {
   Mutex::Locker l(lock);
@@ -3345,6 +3426,16 @@ void *BlueStore::MempoolThread::entry()
 	      bytes_per_onode);
     }
 
+    if (store->cct->_conf->get_val<bool>("bluestore_cache_autotune")) {
+      utime_t now = ceph_clock_now();
+      if (now >= next_tune) {
+	_tune_cache(meta_bytes, bytes_per_onode);
+	next_tune = now;
+	next_tune += store->cct->_conf->get_val<double>(
+	  "bluestore_cache_autotune_interval");
+      }
+    }
+
     store->_update_cache_logger();
 
     utime_t wait;
@@ -3355,6 +3446,227 @@ void *BlueStore::MempoolThread::entry()
   return NULL;
 }
 
+/*
+ * Move cache between onode metadata, buffers and the kv block cache.
+ * Each round, the consumer that is full and read the most bytes on
+ * misses takes one chunk from the consumer with the most unused target
+ * or, if none has any, from the one that missed least.
+ */
+void BlueStore::MempoolThread::_tune_cache(uint64_t meta_bytes,
+					   float bytes_per_onode)
+{
+  CephContext *cct = store->cct;
+  enum { META, DATA, KV, NUM };
+  static const char *names[NUM] = { "meta", "data", "kv" };
+
+  // missed bytes since the last round; -1 if the consumer can't tell
+  int64_t missed[NUM] = { -1, -1, -1 };
+  uint64_t used[NUM] = { meta_bytes,
+			 mempool::bluestore_cache_data::allocated_bytes(),
+			 0 };
+  bool first = next_tune.is_zero();
+
+  uint64_t onode_misses = store->logger->get(l_bluestore_onode_misses);
+  uint64_t buffer_miss_bytes =
+    store->logger->get(l_bluestore_buffer_miss_bytes);
+  missed[META] = (onode_misses - last_onode_misses) * bytes_per_onode;
+  missed[DATA] = buffer_miss_bytes - last_buffer_miss_bytes;
+  last_onode_misses = onode_misses;
+  last_buffer_miss_bytes = buffer_miss_bytes;
+
+  KeyValueDB::CacheStats kv;
+  bool have_kv = store->db->get_cache_stats(&kv) == 0;
+  if (have_kv) {
+    used[KV] = kv.usage;
+    if (kv.hits || kv.misses) {
+      // only counted with rocksdb_perf
+      missed[KV] = (kv.misses - last_kv_misses) * kv.item_bytes;
+      last_kv_misses = kv.misses;
+    }
+  }
+  if (first) {
+    return;
+  }
+
+  uint64_t total = store->cache_size;
+  uint64_t chunk = total *
+    cct->_conf->get_val<double>("bluestore_cache_autotune_chunk_ratio");
+  uint64_t min_target = total *
+    cct->_conf->get_val<double>("bluestore_cache_autotune_min_ratio");
+  uint64_t target[NUM] = {
+    (uint64_t)(total * store->cache_meta_ratio),
+    (uint64_t)(total * store->cache_data_ratio),
+    (uint64_t)(total * store->cache_kv_ratio)
+  };
+  int num = have_kv ? NUM : KV;
+  if (!chunk) {
+    return;
+  }
+
+  int taker = -1;
+  for (int i = 0; i < num; ++i) {
+    bool full = used[i] * 10 >= target[i] * 9;
+    if (full && missed[i] > 0 &&
+	(taker < 0 || missed[i] > missed[taker])) {
+      taker = i;
+    }
+  }
+  if (taker < 0) {
+    return;
+  }
+  if (taker == KV && cct->_conf->bluestore_cache_kv_max > 0 &&
+      target[KV] + chunk > cct->_conf->bluestore_cache_kv_max) {
+    ldout(cct, 20) << __func__ << " kv at bluestore_cache_kv_max" << dendl;
+    return;
+  }
+
+  int donor = -1;
+  for (int i = 0; i < num; ++i) {
+    if (i == taker || target[i] < min_target + chunk ||
+	target[i] < used[i] + chunk) {
+      continue;
+    }
+    if (donor < 0 || target[i] - used[i] > target[donor] - used[donor]) {
+      donor = i;
+    }
+  }
+  if (donor < 0) {
+    for (int i = 0; i < num; ++i) {
+      if (i == taker || target[i] < min_target + chunk || missed[i] < 0 ||
+	  missed[i] * 2 > missed[taker]) {
+	continue;
+      }
+      if (donor < 0 || missed[i] < missed[donor]) {
+	donor = i;
+      }
+    }
+  }
+  if (donor < 0) {
+    return;
+  }
+
+  target[taker] += chunk;
+  target[donor] -= chunk;
+  ldout(cct, 10) << __func__ << " " << pretty_si_t(chunk) << " from "
+		 << names[donor] << " (missed " << missed[donor] << ")"
+		 << " to " << names[taker] << " (missed " << missed[taker]
+		 << "); targets meta " << pretty_si_t(target[META])
+		 << " data " << pretty_si_t(target[DATA])
+		 << " kv " << pretty_si_t(target[KV]) << dendl;
+  store->cache_meta_ratio = (double)target[META] / (double)total;
+  store->cache_data_ratio = (double)target[DATA] / (double)total;
+  store->cache_kv_ratio = (double)target[KV] / (double)total;
+  if (taker == KV || donor == KV) {
+    store->db->set_cache_size(target[KV]);
+  }
+}
+
+// RecompressThread
+
+#undef dout_prefix
+#define dout_prefix *_dout << "bluestore.RecompressThread(" << this << ") "
+
+void *BlueStore::RecompressThread::entry()
+{
+  CephContext *cct = store->cct;
+  Mutex::Locker l(lock);
+  while (!stop) {
+    double interval =
+      cct->_conf->get_val<double>("bluestore_recompress_interval");
+    if (interval <= 0) {
+      cids.clear();
+      cond.WaitInterval(lock, utime_t(1, 0));
+      continue;
+    }
+    // don't start rewriting objects under a background deferred replay
+    if (store->deferred_replay_pending) {
+      cond.WaitInterval(lock, utime_t(0, 100000000));
+      continue;
+    }
+
+    CollectionRef c;
+    vector<ghobject_t> ls;
+    if (!_next_batch(&c, &ls)) {
+      utime_t wait;
+      wait.set_from_double(interval);
+      cond.WaitInterval(lock, wait);
+      if (!stop) {
+	_start_pass();
+      }
+      continue;
+    }
+
+    for (auto& oid : ls) {
+      // stay out of the way of client io
+      uint64_t idle =
+	cct->_conf->get_val<uint64_t>("bluestore_recompress_idle_bytes");
+      while (!stop &&
+	     (uint64_t)store->throttle_bytes.get_current() > idle) {
+	cond.WaitInterval(lock, utime_t(0, 100000000));
+      }
+      if (stop) {
+	break;
+      }
+
+      uint64_t bytes = 0;
+      lock.Unlock();
+      int r = store->_recompress_object(c, oid, &bytes);
+      lock.Lock();
+      if (r < 0) {
+	ldout(cct, 10) << __func__ << " " << c->cid << " " << oid
+		       << " got " << cpp_strerror(r) << dendl;
+      }
+
+      uint64_t rate =
+	cct->_conf->get_val<uint64_t>("bluestore_recompress_max_bytes_per_sec");
+      if (bytes && rate && !stop) {
+	utime_t wait;
+	wait.set_from_double((double)bytes / (double)rate);
+	cond.WaitInterval(lock, wait);
+      }
+    }
+  }
+  stop = false;
+  return NULL;
+}
+
+void BlueStore::RecompressThread::_start_pass()
+{
+  cids.clear();
+  pos = ghobject_t();
+  RWLock::RLocker l(store->coll_lock);
+  for (auto& p : store->coll_map) {
+    if (p.first.is_pg()) {
+      cids.push_back(p.first);
+    }
+  }
+  ldout(store->cct, 10) << __func__ << " " << cids.size() << " collections"
+			<< dendl;
+}
+
+bool BlueStore::RecompressThread::_next_batch(CollectionRef *pc,
+					      vector<ghobject_t> *ls)
+{
+  while (!cids.empty()) {
+    CollectionRef c = store->_get_collection(cids.back());
+    if (c) {
+      RWLock::RLocker l(c->lock);
+      ghobject_t next;
+      if (c->exists &&
+	  store->_collection_list(c.get(), pos, ghobject_t::get_max(), 16,
+				  ls, &next) >= 0 &&
+	  !ls->empty()) {
+	pos = next;
+	*pc = c;
+	return true;
+      }
+    }
+    cids.pop_back();
+    pos = ghobject_t();
+  }
+  return false;
+}
+
 // =======================================================
 
 // OmapIteratorImpl
@@ -3479,7 +3791,13 @@ BlueStore::BlueStore(CephContext *cct, const string& path)
 		       cct->_conf->bluestore_throttle_deferred_bytes),
     kv_sync_thread(this),
     kv_finalize_thread(this),
-    mempool_thread(this)
+    deferred_replay_thread(this),
+    mempool_thread(this),
+    recompress_thread(this),
+    compress_tp(cct, "BlueStore::compress_tp", "bstore_compr",
+		cct->_conf->bluestore_compression_threads,
+		"bluestore_compression_threads"),
+    compress_wq("bstore_compress_wq", 0, &compress_tp)
 {
   _init_logger();
   cct->_conf->add_observer(this);
@@ -3497,9 +3815,15 @@ BlueStore::BlueStore(CephContext *cct,
 		       cct->_conf->bluestore_throttle_deferred_bytes),
     kv_sync_thread(this),
     kv_finalize_thread(this),
+    deferred_replay_thread(this),
     min_alloc_size(_min_alloc_size),
     min_alloc_size_order(ctz(_min_alloc_size)),
-    mempool_thread(this)
+    mempool_thread(this),
+    recompress_thread(this),
+    compress_tp(cct, "BlueStore::compress_tp", "bstore_compr",
+		cct->_conf->bluestore_compression_threads,
+		"bluestore_compression_threads"),
+    compress_wq("bstore_compress_wq", 0, &compress_tp)
 {
   _init_logger();
   cct->_conf->add_observer(this);
@@ -3508,11 +3832,6 @@ BlueStore::BlueStore(CephContext *cct,
 
 BlueStore::~BlueStore()
 {
-  for (auto f : finishers) {
-    delete f;
-  }
-  finishers.clear();
-
   cct->_conf->remove_observer(this);
   _shutdown_logger();
   assert(!mounted);
@@ -3775,6 +4094,7 @@ void BlueStore::_init_logger()
 {
   PerfCountersBuilder b(cct, "bluestore",
                         l_bluestore_first, l_bluestore_last);
+  b.set_sharded(true);
   b.add_time_avg(l_bluestore_kv_flush_lat, "kv_flush_lat",
 		 "Average kv_thread flush latency",
 		 "fl_l", PerfCountersBuilder::PRIO_INTERESTING);
@@ -3818,16 +4138,48 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_read_lat, "read_lat",
 		 "Average read latency",
 		 "r_l", PerfCountersBuilder::PRIO_CRITICAL);
+
+  // latency in nanoseconds, size in bytes, both on a log2 scale
+  PerfHistogramCommon::axis_config_d lat_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    100000,                          ///< 100usec buckets
+    32,
+  };
+  PerfHistogramCommon::axis_config_d size_axis_config{
+    "Request size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    512,                             ///< 512 byte buckets
+    32,
+  };
+  b.add_u64_counter_histogram(
+    l_bluestore_read_lat_bytes_hist, "read_lat_bytes_histogram",
+    lat_axis_config, size_axis_config,
+    "Histogram of read latency + bytes read");
+  b.add_u64_counter_histogram(
+    l_bluestore_commit_lat_bytes_hist, "commit_lat_bytes_histogram",
+    lat_axis_config, size_axis_config,
+    "Histogram of transaction commit latency + bytes written");
   b.add_time_avg(l_bluestore_read_onode_meta_lat, "read_onode_meta_lat",
     "Average read onode metadata latency");
   b.add_time_avg(l_bluestore_read_wait_aio_lat, "read_wait_aio_lat",
     "Average read latency");
+  b.add_u64_counter(l_bluestore_read_coalesced_ios, "read_coalesced_ios",
+    "Device reads saved by merging nearby extents");
+  b.add_u64_counter(l_bluestore_readahead_bytes, "readahead_bytes",
+    "Bytes read ahead of sequential readers");
   b.add_time_avg(l_bluestore_compress_lat, "compress_lat",
     "Average compress latency");
   b.add_time_avg(l_bluestore_decompress_lat, "decompress_lat",
     "Average decompress latency");
   b.add_time_avg(l_bluestore_csum_lat, "csum_lat",
     "Average checksum latency");
+  b.add_u64_counter(l_bluestore_digest_csum_bytes, "digest_csum_bytes",
+    "Object data digested from stored checksums");
+  b.add_u64_counter(l_bluestore_digest_hash_bytes, "digest_hash_bytes",
+    "Object data digested by hashing it");
   b.add_u64_counter(l_bluestore_compress_success_count, "compress_success_count",
     "Sum for beneficial compress ops");
   b.add_u64_counter(l_bluestore_compress_rejected_count, "compress_rejected_count",
@@ -3838,6 +4190,8 @@ void BlueStore::_init_logger()
 		    "Sum for deferred write op");
   b.add_u64_counter(l_bluestore_deferred_write_bytes, "deferred_write_bytes",
 		    "Sum for deferred write bytes", "def");
+  b.add_u64_counter(l_bluestore_deferred_write_merged, "deferred_write_merged",
+		    "Deferred batches merged into another sequencer's submission");
   b.add_u64_counter(l_bluestore_write_penalty_read_ops, "write_penalty_read_ops",
 		    "Sum for write penalty read ops");
   b.add_u64(l_bluestore_allocated, "bluestore_allocated",
@@ -3857,6 +4211,8 @@ void BlueStore::_init_logger()
 		    "Sum for onode-lookups hit in the cache");
   b.add_u64_counter(l_bluestore_onode_misses, "bluestore_onode_misses",
 		    "Sum for onode-lookups missed in the cache");
+  b.add_u64_counter(l_bluestore_onode_prefetched, "bluestore_onode_prefetched",
+		    "Sum for onodes loaded by prefetch_objects");
   b.add_u64_counter(l_bluestore_onode_shard_hits, "bluestore_onode_shard_hits",
 		    "Sum for onode-shard lookups hit in the cache");
   b.add_u64_counter(l_bluestore_onode_shard_misses,
@@ -3908,6 +4264,46 @@ void BlueStore::_init_logger()
   b.add_u64_counter(l_bluestore_gc_merged, "bluestore_gc_merged",
 		    "Sum for extents that have been merged due to garbage "
 		    "collection");
+  b.add_u64_avg(l_bluestore_extent_map_inline_bytes,
+		"bluestore_extent_map_inline_bytes",
+		"Encoded size of inline extent maps written");
+  b.add_u64_counter(l_bluestore_extent_map_inline_released,
+		    "bluestore_extent_map_inline_released",
+		    "Bytes of cached inline extent map encodings released");
+  b.add_u64(l_bluestore_onode_mem_bytes, "bluestore_onode_mem_bytes",
+	    "Average memory per cached onode, including its extent map");
+  b.add_u64(l_bluestore_cache_meta_target, "bluestore_cache_meta_target",
+	    "Cache bytes targeted at onode metadata");
+  b.add_u64(l_bluestore_cache_meta_bytes, "bluestore_cache_meta_bytes",
+	    "Cache bytes used by onode metadata");
+  b.add_u64(l_bluestore_cache_data_target, "bluestore_cache_data_target",
+	    "Cache bytes targeted at object data buffers");
+  b.add_u64(l_bluestore_cache_data_bytes, "bluestore_cache_data_bytes",
+	    "Cache bytes used by object data buffers");
+  b.add_u64(l_bluestore_cache_kv_target, "bluestore_cache_kv_target",
+	    "Cache bytes targeted at the kv store");
+  b.add_u64(l_bluestore_cache_kv_bytes, "bluestore_cache_kv_bytes",
+	    "Block cache bytes used by the kv store");
+  b.add_u64_counter(l_bluestore_recompress_scanned,
+		    "bluestore_recompress_scanned",
+		    "Objects examined by background recompression");
+  b.add_u64_counter(l_bluestore_recompress_objects,
+		    "bluestore_recompress_objects",
+		    "Objects rewritten by background recompression");
+  b.add_u64_counter(l_bluestore_recompress_bytes,
+		    "bluestore_recompress_bytes",
+		    "Bytes of object data rewritten by background recompression");
+  b.add_u64_counter(l_bluestore_recompress_saved_bytes,
+		    "bluestore_recompress_saved_bytes",
+		    "Allocated bytes released by background recompression");
+  b.add_time_avg(l_bluestore_recompress_lat, "bluestore_recompress_lat",
+		 "Average time to rewrite an object during recompression");
+  b.add_u64_counter(l_bluestore_alloc_snapshot_loaded,
+		    "bluestore_alloc_snapshot_loaded",
+		    "Mounts that loaded the allocator from a snapshot");
+  b.add_u64_counter(l_bluestore_alloc_snapshot_rejected,
+		    "bluestore_alloc_snapshot_rejected",
+		    "Mounts that found a stale or mismatched allocator snapshot");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -4259,7 +4655,35 @@ int BlueStore::_open_alloc()
   uint64_t num = 0, bytes = 0;
 
   dout(1) << __func__ << " opening allocation metadata" << dendl;
+
+  // a snapshot saved by a clean umount is only good for one mount: drop
+  // it before anything can allocate, whether or not we use it.
+  vector<pair<uint64_t,uint64_t>> snapshot;
+  int r = _read_alloc_snapshot(&snapshot, &bytes);
+  if (r != -ENOENT) {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rmkey(PREFIX_SUPER, "alloc_snapshot");
+    t->rmkey(PREFIX_SUPER, "alloc_snapshot_seq");
+    t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+    db->submit_transaction_sync(t);
+  }
+  if (r == 0) {
+    logger->inc(l_bluestore_alloc_snapshot_loaded);
+    for (auto& e : snapshot) {
+      alloc->init_add_free(e.first, e.second);
+    }
+    num = snapshot.size();
+    // the snapshot already excludes bluefs_extents
+    dout(1) << __func__ << " loaded " << pretty_si_t(bytes)
+	    << " in " << num << " extents from snapshot" << dendl;
+    return 0;
+  }
+  if (r != -ENOENT) {
+    logger->inc(l_bluestore_alloc_snapshot_rejected);
+  }
+
   // initialize from freelist
+  bytes = 0;
   fm->enumerate_reset();
   uint64_t offset, length;
   while (fm->enumerate_next(&offset, &length)) {
@@ -4282,6 +4706,176 @@ int BlueStore::_open_alloc()
   return 0;
 }
 
+/*
+ * The allocator snapshot is a header in PREFIX_SUPER describing the
+ * device and bluefs_extents it was taken against, plus the free extents
+ * in chunks under PREFIX_ALLOC_SNAPSHOT.  It is rejected unless all of
+ * it matches the store being mounted.
+ *
+ * Anything that commits to the kv store after the snapshot (a crashed
+ * or kv-only mount, ceph-kvstore-tool, ceph-bluestore-tool) may have
+ * changed the freelist, so the snapshot also records the kv sequence
+ * number it expects to find at the next mount and is ignored if the
+ * sequence has moved on.
+ */
+static const unsigned alloc_snapshot_chunk_extents = 65536;
+
+int BlueStore::_read_alloc_snapshot(
+  vector<pair<uint64_t,uint64_t>> *extents,
+  uint64_t *bytes)
+{
+  bufferlist bl;
+  int r = db->get(PREFIX_SUPER, "alloc_snapshot", &bl);
+  if (r < 0)
+    return -ENOENT;
+
+  uint64_t dev_size, alloc_unit, num_extents, total;
+  interval_set<uint64_t> snap_bluefs_extents;
+  try {
+    auto p = bl.begin();
+    ::decode(dev_size, p);
+    ::decode(alloc_unit, p);
+    ::decode(snap_bluefs_extents, p);
+    ::decode(num_extents, p);
+    ::decode(total, p);
+  } catch (buffer::error& e) {
+    derr << __func__ << " failed to decode snapshot header" << dendl;
+    return -EIO;
+  }
+  if (!cct->_conf->bluestore_alloc_snapshot) {
+    return -EINVAL;
+  }
+  if (dev_size != bdev->get_size() ||
+      alloc_unit != min_alloc_size ||
+      !(snap_bluefs_extents == bluefs_extents)) {
+    dout(1) << __func__ << " snapshot does not match this store, ignoring"
+	    << dendl;
+    return -EINVAL;
+  }
+
+  uint64_t seq = 0, expected_seq = 0;
+  bufferlist seq_bl;
+  if (db->get_last_seq(&seq) < 0 ||
+      db->get(PREFIX_SUPER, "alloc_snapshot_seq", &seq_bl) < 0) {
+    dout(1) << __func__ << " snapshot has no kv sequence, ignoring" << dendl;
+    return -EINVAL;
+  }
+  try {
+    auto p = seq_bl.begin();
+    ::decode(expected_seq, p);
+  } catch (buffer::error& e) {
+    derr << __func__ << " failed to decode snapshot sequence" << dendl;
+    return -EIO;
+  }
+  if (seq != expected_seq) {
+    dout(1) << __func__ << " kv sequence " << seq << " != " << expected_seq
+	    << ", store was modified after the snapshot, ignoring" << dendl;
+    return -EINVAL;
+  }
+
+  extents->reserve(num_extents);
+  *bytes = 0;
+  KeyValueDB::Iterator it = db->get_iterator(PREFIX_ALLOC_SNAPSHOT);
+  for (it->lower_bound(string()); it->valid(); it->next()) {
+    bufferlist v = it->value();
+    try {
+      auto p = v.begin();
+      uint32_t n;
+      ::decode(n, p);
+      while (n--) {
+	uint64_t offset, length;
+	::decode(offset, p);
+	::decode(length, p);
+	extents->emplace_back(offset, length);
+	*bytes += length;
+      }
+    } catch (buffer::error& e) {
+      derr << __func__ << " failed to decode snapshot chunk" << dendl;
+      return -EIO;
+    }
+  }
+  if (extents->size() != num_extents || *bytes != total) {
+    derr << __func__ << " snapshot is incomplete, ignoring" << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+void BlueStore::_write_alloc_snapshot()
+{
+  if (!cct->_conf->bluestore_alloc_snapshot)
+    return;
+
+  uint64_t seq;
+  if (db->get_last_seq(&seq) < 0) {
+    dout(10) << __func__ << " kv backend has no sequence, not saving" << dendl;
+    return;
+  }
+
+  KeyValueDB::Transaction t = db->get_transaction();
+  uint64_t num = 0, bytes = 0, chunk = 0;
+  bufferlist chunk_bl;
+  uint32_t chunk_n = 0;
+  auto flush_chunk = [&]() {
+    bufferlist bl;
+    ::encode(chunk_n, bl);
+    bl.claim_append(chunk_bl);
+    string key;
+    _key_encode_u64(chunk++, &key);
+    t->set(PREFIX_ALLOC_SNAPSHOT, key, bl);
+    chunk_n = 0;
+  };
+  bool supported = alloc->enumerate_free(
+    [&](uint64_t offset, uint64_t length) {
+      ::encode(offset, chunk_bl);
+      ::encode(length, chunk_bl);
+      ++num;
+      bytes += length;
+      if (++chunk_n == alloc_snapshot_chunk_extents)
+	flush_chunk();
+    });
+  if (!supported) {
+    dout(10) << __func__ << " allocator " << cct->_conf->bluestore_allocator
+	     << " cannot be snapshotted" << dendl;
+    return;
+  }
+  if (chunk_n)
+    flush_chunk();
+
+  bufferlist bl;
+  ::encode(bdev->get_size(), bl);
+  ::encode(min_alloc_size, bl);
+  ::encode(bluefs_extents, bl);
+  ::encode(num, bl);
+  ::encode(bytes, bl);
+  t->set(PREFIX_SUPER, "alloc_snapshot", bl);
+  db->submit_transaction_sync(t);
+
+  // a single-key commit moves the sequence on by exactly one, so record
+  // where it will stand once this one lands.  If it ends up anywhere else
+  // the snapshot could never be trusted; take it back out.
+  db->get_last_seq(&seq);
+  bufferlist seq_bl;
+  ::encode(seq + 1, seq_bl);
+  t = db->get_transaction();
+  t->set(PREFIX_SUPER, "alloc_snapshot_seq", seq_bl);
+  db->submit_transaction_sync(t);
+  uint64_t now_seq = 0;
+  db->get_last_seq(&now_seq);
+  if (now_seq != seq + 1) {
+    dout(1) << __func__ << " kv sequence " << now_seq << " != " << seq + 1
+	    << ", dropping snapshot" << dendl;
+    t = db->get_transaction();
+    t->rmkey(PREFIX_SUPER, "alloc_snapshot");
+    t->rmkey(PREFIX_SUPER, "alloc_snapshot_seq");
+    t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+    db->submit_transaction_sync(t);
+    return;
+  }
+  dout(1) << __func__ << " saved " << pretty_si_t(bytes) << " in " << num
+	  << " extents at kv sequence " << now_seq << dendl;
+}
+
 void BlueStore::_close_alloc()
 {
   assert(alloc);
@@ -4685,13 +5279,23 @@ int BlueStore::_open_db(bool create)
 
   db->set_cache_size(cache_size * cache_kv_ratio);
 
-  if (kv_backend == "rocksdb")
+  vector<KeyValueDB::ColumnFamily> cfs;
+  if (kv_backend == "rocksdb") {
     options = cct->_conf->bluestore_rocksdb_options;
+    r = KeyValueDB::parse_column_families(
+      cct->_conf->get_val<std::string>("bluestore_rocksdb_cfs"), &cfs);
+    if (r < 0) {
+      derr << __func__ << " invalid bluestore_rocksdb_cfs '"
+	   << cct->_conf->get_val<std::string>("bluestore_rocksdb_cfs")
+	   << "'" << dendl;
+      cfs.clear();
+    }
+  }
   db->init(options);
   if (create)
-    r = db->create_and_open(err);
+    r = db->create_and_open(err, cfs);
   else
-    r = db->open(err);
+    r = db->open(err, cfs);
   if (r) {
     derr << __func__ << " erroring opening db: " << err.str() << dendl;
     if (bluefs) {
@@ -5344,12 +5948,13 @@ int BlueStore::_mount(bool kv_only)
 
   _kv_start();
 
-  r = _deferred_replay();
+  r = _deferred_replay(cct->_conf->bluestore_deferred_replay_async);
   if (r < 0)
     goto out_stop;
 
   mempool_thread.init();
-
+  recompress_thread.init();
+  compress_tp.start();
 
   mounted = true;
   return 0;
@@ -5378,9 +5983,17 @@ int BlueStore::umount()
   assert(mounted);
   dout(1) << __func__ << dendl;
 
+  if (deferred_replay_thread.is_started()) {
+    deferred_replay_thread.join();
+  }
+  recompress_thread.shutdown();
+
   _osr_drain_all();
   _osr_unregister_all();
 
+  compress_tp.drain();
+  compress_tp.stop();
+
   mempool_thread.shutdown();
 
   dout(20) << __func__ << " stopping kv thread" << dendl;
@@ -5390,6 +6003,7 @@ int BlueStore::umount()
   dout(20) << __func__ << " closing" << dendl;
 
   mounted = false;
+  _write_alloc_snapshot();
   _close_alloc();
   _close_fm();
   _close_db();
@@ -5485,6 +6099,23 @@ int BlueStore::fsck(bool deep)
     bool compressed;
   };
   mempool::bluestore_fsck::map<uint64_t,sb_info_t> sb_info;
+  std::mutex sb_info_lock;
+  std::mutex used_blocks_lock;  ///< serializes used_blocks updates
+
+  // per-thread results of the object walk, merged afterwards
+  struct fsck_worker_t {
+    int errors = 0;
+    uint64_t_btree_t used_nids;
+    uint64_t_btree_t used_omap_head;
+    store_statfs_t statfs;
+    uint64_t num_objects = 0;
+    uint64_t num_extents = 0;
+    uint64_t num_blobs = 0;
+    uint64_t num_spanning_blobs = 0;
+    uint64_t num_sharded_objects = 0;
+    uint64_t num_object_shards = 0;
+  };
+  std::atomic<bool> aborted = {false};
 
   uint64_t num_objects = 0;
   uint64_t num_extents = 0;
@@ -5575,293 +6206,368 @@ int BlueStore::fsck(bool deep)
   expected_statfs.total = actual_statfs.total;
   expected_statfs.available = actual_statfs.available;
 
-  // walk PREFIX_OBJ
-  dout(1) << __func__ << " walking object keyspace" << dendl;
-  it = db->get_iterator(PREFIX_OBJ);
-  if (it) {
-    CollectionRef c;
-    spg_t pgid;
-    mempool::bluestore_fsck::list<string> expecting_shards;
-    for (it->lower_bound(string()); it->valid(); it->next()) {
-      if (g_conf->bluestore_debug_fsck_abort) {
-	goto out_scan;
-      }
-      dout(30) << " key " << pretty_binary_string(it->key()) << dendl;
-      if (is_extent_shard_key(it->key())) {
-	while (!expecting_shards.empty() &&
-	       expecting_shards.front() < it->key()) {
-	  derr << __func__ << " error: missing shard key "
-	       << pretty_binary_string(expecting_shards.front())
-	       << dendl;
-	  ++errors;
-	  expecting_shards.pop_front();
-	}
-	if (!expecting_shards.empty() &&
-	    expecting_shards.front() == it->key()) {
-	  // all good
-	  expecting_shards.pop_front();
-	  continue;
+  // walk PREFIX_OBJ, one key range per worker
+  {
+    auto walk_objects = [&](const string& from, const string& to,
+			    fsck_worker_t& w) {
+      KeyValueDB::Iterator it = db->get_iterator(PREFIX_OBJ);
+      if (!it)
+	return;
+      CollectionRef c;
+      spg_t pgid;
+      mempool::bluestore_fsck::list<string> expecting_shards;
+      for (it->lower_bound(from);
+	   it->valid() && (to.empty() || it->key() < to);
+	   it->next()) {
+	if (g_conf->bluestore_debug_fsck_abort) {
+	  aborted = true;
+	  return;
 	}
+	dout(30) << " key " << pretty_binary_string(it->key()) << dendl;
+	if (is_extent_shard_key(it->key())) {
+	  while (!expecting_shards.empty() &&
+		 expecting_shards.front() < it->key()) {
+	    derr << __func__ << " error: missing shard key "
+		 << pretty_binary_string(expecting_shards.front())
+		 << dendl;
+	    ++w.errors;
+	    expecting_shards.pop_front();
+	  }
+	  if (!expecting_shards.empty() &&
+	      expecting_shards.front() == it->key()) {
+	    // all good
+	    expecting_shards.pop_front();
+	    continue;
+	  }
 
-        uint32_t offset;
-        string okey;
-        get_key_extent_shard(it->key(), &okey, &offset);
-        derr << __func__ << " error: stray shard 0x" << std::hex << offset
-	     << std::dec << dendl;
-        if (expecting_shards.empty()) {
-          derr << __func__ << " error: " << pretty_binary_string(it->key())
-               << " is unexpected" << dendl;
-          ++errors;
-          continue;
-        }
-	while (expecting_shards.front() > it->key()) {
-	  derr << __func__ << " error:   saw " << pretty_binary_string(it->key())
-	       << dendl;
-	  derr << __func__ << " error:   exp "
-	       << pretty_binary_string(expecting_shards.front()) << dendl;
-	  ++errors;
-	  expecting_shards.pop_front();
+	  uint32_t offset;
+	  string okey;
+	  get_key_extent_shard(it->key(), &okey, &offset);
+	  derr << __func__ << " error: stray shard 0x" << std::hex << offset
+	       << std::dec << dendl;
 	  if (expecting_shards.empty()) {
-	    break;
+	    derr << __func__ << " error: " << pretty_binary_string(it->key())
+		 << " is unexpected" << dendl;
+	    ++w.errors;
+	    continue;
 	  }
-	}
-	continue;
-      }
-
-      ghobject_t oid;
-      int r = get_key_object(it->key(), &oid);
-      if (r < 0) {
-        derr << __func__ << " error: bad object key "
-             << pretty_binary_string(it->key()) << dendl;
-	++errors;
-	continue;
-      }
-      if (!c ||
-	  oid.shard_id != pgid.shard ||
-	  oid.hobj.pool != (int64_t)pgid.pool() ||
-	  !c->contains(oid)) {
-	c = nullptr;
-	for (ceph::unordered_map<coll_t, CollectionRef>::iterator p =
-	       coll_map.begin();
-	     p != coll_map.end();
-	     ++p) {
-	  if (p->second->contains(oid)) {
-	    c = p->second;
-	    break;
+	  while (expecting_shards.front() > it->key()) {
+	    derr << __func__ << " error:   saw " << pretty_binary_string(it->key())
+		 << dendl;
+	    derr << __func__ << " error:   exp "
+		 << pretty_binary_string(expecting_shards.front()) << dendl;
+	    ++w.errors;
+	    expecting_shards.pop_front();
+	    if (expecting_shards.empty()) {
+	      break;
+	    }
 	  }
+	  continue;
 	}
-	if (!c) {
-          derr << __func__ << " error: stray object " << oid
-               << " not owned by any collection" << dendl;
-	  ++errors;
+
+	ghobject_t oid;
+	int r = get_key_object(it->key(), &oid);
+	if (r < 0) {
+	  derr << __func__ << " error: bad object key "
+	       << pretty_binary_string(it->key()) << dendl;
+	  ++w.errors;
 	  continue;
 	}
-	c->cid.is_pg(&pgid);
-	dout(20) << __func__ << "  collection " << c->cid << dendl;
-      }
+	if (!c ||
+	    oid.shard_id != pgid.shard ||
+	    oid.hobj.pool != (int64_t)pgid.pool() ||
+	    !c->contains(oid)) {
+	  c = nullptr;
+	  for (ceph::unordered_map<coll_t, CollectionRef>::iterator p =
+		 coll_map.begin();
+	       p != coll_map.end();
+	       ++p) {
+	    if (p->second->contains(oid)) {
+	      c = p->second;
+	      break;
+	    }
+	  }
+	  if (!c) {
+	    derr << __func__ << " error: stray object " << oid
+		 << " not owned by any collection" << dendl;
+	    ++w.errors;
+	    continue;
+	  }
+	  c->cid.is_pg(&pgid);
+	  dout(20) << __func__ << "  collection " << c->cid << dendl;
+	}
 
-      if (!expecting_shards.empty()) {
-	for (auto &k : expecting_shards) {
-	  derr << __func__ << " error: missing shard key "
-	       << pretty_binary_string(k) << dendl;
+	if (!expecting_shards.empty()) {
+	  for (auto &k : expecting_shards) {
+	    derr << __func__ << " error: missing shard key "
+		 << pretty_binary_string(k) << dendl;
+	  }
+	  ++w.errors;
+	  expecting_shards.clear();
 	}
-	++errors;
-	expecting_shards.clear();
-      }
 
-      dout(10) << __func__ << "  " << oid << dendl;
-      RWLock::RLocker l(c->lock);
-      OnodeRef o = c->get_onode(oid, false);
-      if (o->onode.nid) {
-	if (o->onode.nid > nid_max) {
-	  derr << __func__ << " error: " << oid << " nid " << o->onode.nid
-	       << " > nid_max " << nid_max << dendl;
-	  ++errors;
+	dout(10) << __func__ << "  " << oid << dendl;
+	RWLock::RLocker l(c->lock);
+	OnodeRef o = c->get_onode(oid, false);
+	if (o->onode.nid) {
+	  if (o->onode.nid > nid_max) {
+	    derr << __func__ << " error: " << oid << " nid " << o->onode.nid
+		 << " > nid_max " << nid_max << dendl;
+	    ++w.errors;
+	  }
+	  if (w.used_nids.count(o->onode.nid)) {
+	    derr << __func__ << " error: " << oid << " nid " << o->onode.nid
+		 << " already in use" << dendl;
+	    ++w.errors;
+	    continue; // go for next object
+	  }
+	  w.used_nids.insert(o->onode.nid);
 	}
-	if (used_nids.count(o->onode.nid)) {
-	  derr << __func__ << " error: " << oid << " nid " << o->onode.nid
-	       << " already in use" << dendl;
-	  ++errors;
-	  continue; // go for next object
+	++w.num_objects;
+	w.num_spanning_blobs += o->extent_map.spanning_blob_map.size();
+	o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
+	_dump_onode(o, 30);
+	// shards
+	if (!o->extent_map.shards.empty()) {
+	  ++w.num_sharded_objects;
+	  w.num_object_shards += o->extent_map.shards.size();
 	}
-	used_nids.insert(o->onode.nid);
-      }
-      ++num_objects;
-      num_spanning_blobs += o->extent_map.spanning_blob_map.size();
-      o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
-      _dump_onode(o, 30);
-      // shards
-      if (!o->extent_map.shards.empty()) {
-	++num_sharded_objects;
-	num_object_shards += o->extent_map.shards.size();
-      }
-      for (auto& s : o->extent_map.shards) {
-	dout(20) << __func__ << "    shard " << *s.shard_info << dendl;
-	expecting_shards.push_back(string());
-	get_extent_shard_key(o->key, s.shard_info->offset,
-			     &expecting_shards.back());
-	if (s.shard_info->offset >= o->onode.size) {
-	  derr << __func__ << " error: " << oid << " shard 0x" << std::hex
-	       << s.shard_info->offset << " past EOF at 0x" << o->onode.size
-	       << std::dec << dendl;
-	  ++errors;
+	for (auto& s : o->extent_map.shards) {
+	  dout(20) << __func__ << "    shard " << *s.shard_info << dendl;
+	  expecting_shards.push_back(string());
+	  get_extent_shard_key(o->key, s.shard_info->offset,
+			       &expecting_shards.back());
+	  if (s.shard_info->offset >= o->onode.size) {
+	    derr << __func__ << " error: " << oid << " shard 0x" << std::hex
+		 << s.shard_info->offset << " past EOF at 0x" << o->onode.size
+		 << std::dec << dendl;
+	    ++w.errors;
+	  }
 	}
-      }
-      // lextents
-      map<BlobRef,bluestore_blob_t::unused_t> referenced;
-      uint64_t pos = 0;
-      mempool::bluestore_fsck::map<BlobRef,
-				   bluestore_blob_use_tracker_t> ref_map;
-      for (auto& l : o->extent_map.extent_map) {
-	dout(20) << __func__ << "    " << l << dendl;
-	if (l.logical_offset < pos) {
-	  derr << __func__ << " error: " << oid << " lextent at 0x"
-	       << std::hex << l.logical_offset
-	       << " overlaps with the previous, which ends at 0x" << pos
-	       << std::dec << dendl;
-	  ++errors;
-	}
-	if (o->extent_map.spans_shard(l.logical_offset, l.length)) {
-	  derr << __func__ << " error: " << oid << " lextent at 0x"
-	       << std::hex << l.logical_offset << "~" << l.length
-	       << " spans a shard boundary"
-	       << std::dec << dendl;
-	  ++errors;
-	}
-	pos = l.logical_offset + l.length;
-	expected_statfs.stored += l.length;
-	assert(l.blob);
-	const bluestore_blob_t& blob = l.blob->get_blob();
-
-        auto& ref = ref_map[l.blob];
-        if (ref.is_empty()) {
-          uint32_t min_release_size = blob.get_release_size(min_alloc_size);
-          uint32_t l = blob.get_logical_length();
-          ref.init(l, min_release_size);
-        }
-	ref.get(
-	  l.blob_offset, 
-	  l.length);
-	++num_extents;
-	if (blob.has_unused()) {
-	  auto p = referenced.find(l.blob);
-	  bluestore_blob_t::unused_t *pu;
-	  if (p == referenced.end()) {
-	    pu = &referenced[l.blob];
-	  } else {
-	    pu = &p->second;
+	// lextents
+	map<BlobRef,bluestore_blob_t::unused_t> referenced;
+	uint64_t pos = 0;
+	mempool::bluestore_fsck::map<BlobRef,
+				     bluestore_blob_use_tracker_t> ref_map;
+	for (auto& l : o->extent_map.extent_map) {
+	  dout(20) << __func__ << "    " << l << dendl;
+	  if (l.logical_offset < pos) {
+	    derr << __func__ << " error: " << oid << " lextent at 0x"
+		 << std::hex << l.logical_offset
+		 << " overlaps with the previous, which ends at 0x" << pos
+		 << std::dec << dendl;
+	    ++w.errors;
+	  }
+	  if (o->extent_map.spans_shard(l.logical_offset, l.length)) {
+	    derr << __func__ << " error: " << oid << " lextent at 0x"
+		 << std::hex << l.logical_offset << "~" << l.length
+		 << " spans a shard boundary"
+		 << std::dec << dendl;
+	    ++w.errors;
+	  }
+	  pos = l.logical_offset + l.length;
+	  w.statfs.stored += l.length;
+	  assert(l.blob);
+	  const bluestore_blob_t& blob = l.blob->get_blob();
+
+	  auto& ref = ref_map[l.blob];
+	  if (ref.is_empty()) {
+	    uint32_t min_release_size = blob.get_release_size(min_alloc_size);
+	    uint32_t l = blob.get_logical_length();
+	    ref.init(l, min_release_size);
 	  }
-	  uint64_t blob_len = blob.get_logical_length();
-	  assert((blob_len % (sizeof(*pu)*8)) == 0);
-	  assert(l.blob_offset + l.length <= blob_len);
-	  uint64_t chunk_size = blob_len / (sizeof(*pu)*8);
-	  uint64_t start = l.blob_offset / chunk_size;
-	  uint64_t end =
-	    ROUND_UP_TO(l.blob_offset + l.length, chunk_size) / chunk_size;
-	  for (auto i = start; i < end; ++i) {
-	    (*pu) |= (1u << i);
+	  ref.get(
+	    l.blob_offset, 
+	    l.length);
+	  ++w.num_extents;
+	  if (blob.has_unused()) {
+	    auto p = referenced.find(l.blob);
+	    bluestore_blob_t::unused_t *pu;
+	    if (p == referenced.end()) {
+	      pu = &referenced[l.blob];
+	    } else {
+	      pu = &p->second;
+	    }
+	    uint64_t blob_len = blob.get_logical_length();
+	    assert((blob_len % (sizeof(*pu)*8)) == 0);
+	    assert(l.blob_offset + l.length <= blob_len);
+	    uint64_t chunk_size = blob_len / (sizeof(*pu)*8);
+	    uint64_t start = l.blob_offset / chunk_size;
+	    uint64_t end =
+	      ROUND_UP_TO(l.blob_offset + l.length, chunk_size) / chunk_size;
+	    for (auto i = start; i < end; ++i) {
+	      (*pu) |= (1u << i);
+	    }
 	  }
 	}
-      }
-      for (auto &i : referenced) {
-	dout(20) << __func__ << "  referenced 0x" << std::hex << i.second
-		 << std::dec << " for " << *i.first << dendl;
-	const bluestore_blob_t& blob = i.first->get_blob();
-	if (i.second & blob.unused) {
-	  derr << __func__ << " error: " << oid << " blob claims unused 0x"
-	       << std::hex << blob.unused
-	       << " but extents reference 0x" << i.second
-	       << " on blob " << *i.first << dendl;
-	  ++errors;
+	for (auto &i : referenced) {
+	  dout(20) << __func__ << "  referenced 0x" << std::hex << i.second
+		   << std::dec << " for " << *i.first << dendl;
+	  const bluestore_blob_t& blob = i.first->get_blob();
+	  if (i.second & blob.unused) {
+	    derr << __func__ << " error: " << oid << " blob claims unused 0x"
+		 << std::hex << blob.unused
+		 << " but extents reference 0x" << i.second
+		 << " on blob " << *i.first << dendl;
+	    ++w.errors;
+	  }
+	  if (blob.has_csum()) {
+	    uint64_t blob_len = blob.get_logical_length();
+	    uint64_t unused_chunk_size = blob_len / (sizeof(blob.unused)*8);
+	    unsigned csum_count = blob.get_csum_count();
+	    unsigned csum_chunk_size = blob.get_csum_chunk_size();
+	    for (unsigned p = 0; p < csum_count; ++p) {
+	      unsigned pos = p * csum_chunk_size;
+	      unsigned firstbit = pos / unused_chunk_size;    // [firstbit,lastbit]
+	      unsigned lastbit = (pos + csum_chunk_size - 1) / unused_chunk_size;
+	      unsigned mask = 1u << firstbit;
+	      for (unsigned b = firstbit + 1; b <= lastbit; ++b) {
+		mask |= 1u << b;
+	      }
+	      if ((blob.unused & mask) == mask) {
+		// this csum chunk region is marked unused
+		if (blob.get_csum_item(p) != 0) {
+		  derr << __func__ << " error: " << oid
+		       << " blob claims csum chunk 0x" << std::hex << pos
+		       << "~" << csum_chunk_size
+		       << " is unused (mask 0x" << mask << " of unused 0x"
+		       << blob.unused << ") but csum is non-zero 0x"
+		       << blob.get_csum_item(p) << std::dec << " on blob "
+		       << *i.first << dendl;
+		  ++w.errors;
+		}
+	      }
+	    }
+	  }
 	}
-	if (blob.has_csum()) {
-	  uint64_t blob_len = blob.get_logical_length();
-	  uint64_t unused_chunk_size = blob_len / (sizeof(blob.unused)*8);
-	  unsigned csum_count = blob.get_csum_count();
-	  unsigned csum_chunk_size = blob.get_csum_chunk_size();
-	  for (unsigned p = 0; p < csum_count; ++p) {
-	    unsigned pos = p * csum_chunk_size;
-	    unsigned firstbit = pos / unused_chunk_size;    // [firstbit,lastbit]
-	    unsigned lastbit = (pos + csum_chunk_size - 1) / unused_chunk_size;
-	    unsigned mask = 1u << firstbit;
-	    for (unsigned b = firstbit + 1; b <= lastbit; ++b) {
-	      mask |= 1u << b;
+	for (auto &i : ref_map) {
+	  ++w.num_blobs;
+	  const bluestore_blob_t& blob = i.first->get_blob();
+	  bool equal = i.first->get_blob_use_tracker().equal(i.second);
+	  if (!equal) {
+	    derr << __func__ << " error: " << oid << " blob " << *i.first
+		 << " doesn't match expected ref_map " << i.second << dendl;
+	    ++w.errors;
+	  }
+	  if (blob.is_compressed()) {
+	    w.statfs.compressed += blob.get_compressed_payload_length();
+	    w.statfs.compressed_original += 
+	      i.first->get_referenced_bytes();
+	  }
+	  if (blob.is_shared()) {
+	    if (i.first->shared_blob->get_sbid() > blobid_max) {
+	      derr << __func__ << " error: " << oid << " blob " << blob
+		   << " sbid " << i.first->shared_blob->get_sbid() << " > blobid_max "
+		   << blobid_max << dendl;
+	      ++w.errors;
+	    } else if (i.first->shared_blob->get_sbid() == 0) {
+	      derr << __func__ << " error: " << oid << " blob " << blob
+		   << " marked as shared but has uninitialized sbid"
+		   << dendl;
+	      ++w.errors;
 	    }
-	    if ((blob.unused & mask) == mask) {
-	      // this csum chunk region is marked unused
-	      if (blob.get_csum_item(p) != 0) {
-		derr << __func__ << " error: " << oid
-		     << " blob claims csum chunk 0x" << std::hex << pos
-		     << "~" << csum_chunk_size
-		     << " is unused (mask 0x" << mask << " of unused 0x"
-		     << blob.unused << ") but csum is non-zero 0x"
-		     << blob.get_csum_item(p) << std::dec << " on blob "
-		     << *i.first << dendl;
-		++errors;
+	    std::lock_guard<std::mutex> sl(sb_info_lock);
+	    sb_info_t& sbi = sb_info[i.first->shared_blob->get_sbid()];
+	    sbi.sb = i.first->shared_blob;
+	    sbi.oids.push_back(oid);
+	    sbi.compressed = blob.is_compressed();
+	    for (auto e : blob.get_extents()) {
+	      if (e.is_valid()) {
+		sbi.ref_map.get(e.offset, e.length);
 	      }
 	    }
+	  } else {
+	    std::lock_guard<std::mutex> ul(used_blocks_lock);
+	    w.errors += _fsck_check_extents(oid, blob.get_extents(),
+					    blob.is_compressed(),
+					    used_blocks,
+					    w.statfs);
 	  }
 	}
-      }
-      for (auto &i : ref_map) {
-	++num_blobs;
-	const bluestore_blob_t& blob = i.first->get_blob();
-	bool equal = i.first->get_blob_use_tracker().equal(i.second);
-	if (!equal) {
-	  derr << __func__ << " error: " << oid << " blob " << *i.first
-	       << " doesn't match expected ref_map " << i.second << dendl;
-	  ++errors;
-	}
-	if (blob.is_compressed()) {
-	  expected_statfs.compressed += blob.get_compressed_payload_length();
-	  expected_statfs.compressed_original += 
-	    i.first->get_referenced_bytes();
+	if (deep) {
+	  bufferlist bl;
+	  int r = _do_read(c.get(), o, 0, o->onode.size, bl, 0);
+	  if (r < 0) {
+	    ++w.errors;
+	    derr << __func__ << " error: " << oid << " error during read: "
+		 << cpp_strerror(r) << dendl;
+	  }
 	}
-	if (blob.is_shared()) {
-	  if (i.first->shared_blob->get_sbid() > blobid_max) {
-	    derr << __func__ << " error: " << oid << " blob " << blob
-		 << " sbid " << i.first->shared_blob->get_sbid() << " > blobid_max "
-		 << blobid_max << dendl;
-	    ++errors;
-	  } else if (i.first->shared_blob->get_sbid() == 0) {
-            derr << __func__ << " error: " << oid << " blob " << blob
-                 << " marked as shared but has uninitialized sbid"
-                 << dendl;
-            ++errors;
-          }
-	  sb_info_t& sbi = sb_info[i.first->shared_blob->get_sbid()];
-	  sbi.sb = i.first->shared_blob;
-	  sbi.oids.push_back(oid);
-	  sbi.compressed = blob.is_compressed();
-	  for (auto e : blob.get_extents()) {
-	    if (e.is_valid()) {
-	      sbi.ref_map.get(e.offset, e.length);
-	    }
+	// omap
+	if (o->onode.has_omap()) {
+	  if (w.used_omap_head.count(o->onode.nid)) {
+	    derr << __func__ << " error: " << oid << " omap_head " << o->onode.nid
+		 << " already in use" << dendl;
+	    ++w.errors;
+	  } else {
+	    w.used_omap_head.insert(o->onode.nid);
 	  }
-	} else {
-	  errors += _fsck_check_extents(oid, blob.get_extents(),
-					blob.is_compressed(),
-					used_blocks,
-					expected_statfs);
-        }
+	}
       }
-      if (deep) {
-	bufferlist bl;
-	int r = _do_read(c.get(), o, 0, o->onode.size, bl, 0);
-	if (r < 0) {
+    };
+
+    // split the keyspace at collection boundaries
+    vector<string> bounds;
+    for (auto& p : coll_map) {
+      string temp_start, temp_end, start, end;
+      get_coll_key_range(p.first, p.second->cnode.bits,
+			 &temp_start, &temp_end, &start, &end);
+      bounds.push_back(start);
+      bounds.push_back(temp_start);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    unsigned n = std::max<int64_t>(1, cct->_conf->bluestore_fsck_threads);
+    n = std::min<size_t>(n, bounds.size() + 1);
+    vector<string> ranges(1);  // ranges[i] .. ranges[i+1]; "" is open
+    for (unsigned i = 1; i < n; ++i) {
+      ranges.push_back(bounds[i * bounds.size() / n]);
+    }
+    ranges.push_back(string());
+
+    dout(1) << __func__ << " walking object keyspace with " << n
+	    << " threads" << dendl;
+    vector<fsck_worker_t> workers(n);
+    vector<std::thread> threads;
+    for (unsigned i = 1; i < n; ++i) {
+      threads.emplace_back([&, i] {
+	  walk_objects(ranges[i], ranges[i + 1], workers[i]);
+	});
+    }
+    walk_objects(ranges[0], ranges[1], workers[0]);
+    for (auto& t : threads) {
+      t.join();
+    }
+    if (aborted) {
+      goto out_scan;
+    }
+
+    for (auto& w : workers) {
+      errors += w.errors;
+      num_objects += w.num_objects;
+      num_extents += w.num_extents;
+      num_blobs += w.num_blobs;
+      num_spanning_blobs += w.num_spanning_blobs;
+      num_sharded_objects += w.num_sharded_objects;
+      num_object_shards += w.num_object_shards;
+      expected_statfs.allocated += w.statfs.allocated;
+      expected_statfs.stored += w.statfs.stored;
+      expected_statfs.compressed += w.statfs.compressed;
+      expected_statfs.compressed_allocated += w.statfs.compressed_allocated;
+      expected_statfs.compressed_original += w.statfs.compressed_original;
+      // nids and omap heads must also be unique across ranges
+      for (auto nid : w.used_nids) {
+	if (!used_nids.insert(nid).second) {
+	  derr << __func__ << " error: nid " << nid << " already in use"
+	       << dendl;
 	  ++errors;
-	  derr << __func__ << " error: " << oid << " error during read: "
-	       << cpp_strerror(r) << dendl;
 	}
       }
-      // omap
-      if (o->onode.has_omap()) {
-	if (used_omap_head.count(o->onode.nid)) {
-	  derr << __func__ << " error: " << oid << " omap_head " << o->onode.nid
+      for (auto nid : w.used_omap_head) {
+	if (!used_omap_head.insert(nid).second) {
+	  derr << __func__ << " error: omap_head " << nid
 	       << " already in use" << dendl;
 	  ++errors;
-	} else {
-	  used_omap_head.insert(o->onode.nid);
 	}
       }
     }
@@ -6159,6 +6865,23 @@ void BlueStore::_update_cache_logger()
   logger->set(l_bluestore_blobs, num_blobs);
   logger->set(l_bluestore_buffers, num_buffers);
   logger->set(l_bluestore_buffer_bytes, num_buffer_bytes);
+  if (num_onodes) {
+    logger->set(l_bluestore_onode_mem_bytes,
+		(mempool::bluestore_cache_onode::allocated_bytes() +
+		 mempool::bluestore_cache_other::allocated_bytes()) / num_onodes);
+  }
+  logger->set(l_bluestore_cache_meta_target, cache_size * cache_meta_ratio);
+  logger->set(l_bluestore_cache_meta_bytes,
+	      mempool::bluestore_cache_onode::allocated_bytes() +
+	      mempool::bluestore_cache_other::allocated_bytes());
+  logger->set(l_bluestore_cache_data_target, cache_size * cache_data_ratio);
+  logger->set(l_bluestore_cache_data_bytes,
+	      mempool::bluestore_cache_data::allocated_bytes());
+  logger->set(l_bluestore_cache_kv_target, cache_size * cache_kv_ratio);
+  KeyValueDB::CacheStats kv;
+  if (db && db->get_cache_stats(&kv) == 0) {
+    logger->set(l_bluestore_cache_kv_bytes, kv.usage);
+  }
 }
 
 // ---------------
@@ -6248,8 +6971,14 @@ int BlueStore::set_collection_opts(
   dout(15) << __func__ << " " << cid << " options " << opts << dendl;
   if (!c->exists)
     return -ENOENT;
+  uint32_t dict_id = 0;
+  string dict;
+  if (opts.get(pool_opts_t::COMPRESSION_DICTIONARY, &dict) && !dict.empty()) {
+    dict_id = _register_compression_dict(dict);
+  }
   RWLock::WLocker l(c->lock);
   c->pool_opts = opts;
+  c->compression_dict_id = dict_id;
   return 0;
 }
 
@@ -6314,10 +7043,129 @@ int BlueStore::read(
   dout(10) << __func__ << " " << cid << " " << oid
 	   << " 0x" << std::hex << offset << "~" << length << std::dec
 	   << " = " << r << dendl;
-  logger->tinc(l_bluestore_read_lat, ceph_clock_now() - start);
+  utime_t lat = ceph_clock_now() - start;
+  logger->tinc(l_bluestore_read_lat, lat);
+  logger->hinc(l_bluestore_read_lat_bytes_hist, lat.to_nsec(), bl.length());
   return r;
 }
 
+int BlueStore::data_digest(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t stride,
+  uint32_t seed,
+  uint32_t *digest,
+  uint64_t *size_out,
+  uint32_t op_flags)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " " << oid
+	   << " stride 0x" << std::hex << stride << std::dec << dendl;
+  assert(stride > 0);
+  if (_debug_data_eio(oid)) {
+    derr << __func__ << " " << c->cid << " " << oid << " INJECT EIO" << dendl;
+    return -EIO;
+  }
+
+  uint32_t crc = seed;
+  uint64_t from_csum = 0, size;
+  {
+    // the collection lock keeps writers out from the size lookup to the
+    // last csum folded in, so the digest covers one version of the data
+    RWLock::RLocker l(c->lock);
+    if (!c->exists)
+      return -ENOENT;
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists)
+      return -ENOENT;
+    size = o->onode.size;
+    for (uint64_t offset = 0; offset < size; offset += stride) {
+      // _do_read verifies the blob checksums of whatever it reads from
+      // disk, so the data matches the csums we fold in below
+      bufferlist bl;
+      int r = _do_read(c, o, offset, MIN(stride, size - offset), bl, op_flags);
+      if (r < 0) {
+	dout(10) << __func__ << " " << c->get_cid() << " " << oid
+		 << " read 0x" << std::hex << offset << std::dec
+		 << " = " << r << dendl;
+	return r;
+      }
+      from_csum += _digest_range(o, offset, bl, &crc);
+    }
+  }
+  logger->inc(l_bluestore_digest_csum_bytes, from_csum);
+  logger->inc(l_bluestore_digest_hash_bytes, size - from_csum);
+  dout(10) << __func__ << " " << c->get_cid() << " " << oid
+	   << " size 0x" << std::hex << size << " from csum 0x" << from_csum
+	   << " = 0x" << crc << std::dec << dendl;
+  *digest = crc;
+  if (size_out)
+    *size_out = size;
+  return 0;
+}
+
+/*
+ * Fold [offset, offset + bl.length()) into *crc.  The crc32c of a
+ * chunk D of n bytes with seed s is a linear function of s and D:
+ *
+ *   crc(s, D) = crc(s, 0^n) ^ crc(-1, D) ^ crc(-1, 0^n)
+ *
+ * and crc(-1, D) is exactly what an uncompressed blob with
+ * CSUM_CRC32C stores for each csum chunk, so every chunk that lies
+ * entirely within one lextent costs a table lookup instead of a pass
+ * over the data. Holes hash as zeros; everything else is hashed from
+ * bl.  Returns the number of bytes taken from stored checksums.
+ */
+uint64_t BlueStore::_digest_range(
+  OnodeRef& o,
+  uint64_t offset,
+  const bufferlist& bl,
+  uint32_t *crc)
+{
+  uint64_t end = offset + bl.length();
+  uint64_t pos = offset;
+  uint64_t from_csum = 0;
+  auto p = bl.begin();
+  auto lp = o->extent_map.seek_lextent(offset);
+  auto lend = o->extent_map.extent_map.end();
+  while (pos < end) {
+    while (lp != lend && lp->logical_end() <= pos)
+      ++lp;
+    if (lp == lend || lp->logical_offset > pos) {
+      // hole
+      uint64_t l = (lp == lend ? end : MIN(end, lp->logical_offset)) - pos;
+      *crc = ceph_crc32c(*crc, NULL, l);
+      p.advance(l);
+      pos += l;
+      continue;
+    }
+    const bluestore_blob_t& b = lp->blob->get_blob();
+    uint64_t le_end = MIN(end, lp->logical_end());
+    uint64_t l = le_end - pos;
+    if (b.csum_type == Checksummer::CSUM_CRC32C && !b.is_compressed()) {
+      uint64_t chunk = b.get_csum_chunk_size();
+      uint64_t b_off = lp->blob_offset + pos - lp->logical_offset;
+      if (b_off % chunk == 0 && pos + chunk <= le_end) {
+	uint32_t zero_crc = ceph_crc32c(-1, NULL, chunk);
+	uint64_t n = (le_end - pos) / chunk;
+	for (uint64_t i = 0; i < n; ++i) {
+	  *crc = ceph_crc32c(*crc, NULL, chunk) ^
+	    (uint32_t)b.get_csum_item(b_off / chunk + i) ^ zero_crc;
+	}
+	p.advance(n * chunk);
+	pos += n * chunk;
+	from_csum += n * chunk;
+	continue;
+      }
+      // hash up to the next csum chunk boundary
+      l = MIN(l, chunk - b_off % chunk);
+    }
+    *crc = p.crc32c(l, *crc);
+    pos += l;
+  }
+  return from_csum;
+}
+
 // --------------------------------------------------------
 // intermediate data structures used while reading
 struct region_t {
@@ -6348,6 +7196,28 @@ struct region_t {
 typedef list<region_t> regions2read_t;
 typedef map<BlueStore::BlobRef, regions2read_t> blobs2read_t;
 
+// a device extent backing a region (or a whole compressed blob)
+struct read_piece_t {
+  uint64_t offset;
+  uint64_t length;
+  bufferlist *dest;   ///< appended to in the order pieces are added
+  bufferlist bl;
+
+  read_piece_t(uint64_t o, uint64_t l, bufferlist *d)
+    : offset(o), length(l), dest(d) {}
+};
+
+// one device io covering a run of pieces sorted by offset
+struct read_io_t {
+  uint64_t offset;
+  uint64_t length;
+  size_t first, last;
+  bufferlist bl;
+
+  read_io_t(uint64_t o, uint64_t l, size_t f)
+    : offset(o), length(l), first(f), last(f + 1) {}
+};
+
 int BlueStore::_do_read(
   Collection *c,
   OnodeRef o,
@@ -6359,6 +7229,10 @@ int BlueStore::_do_read(
   FUNCTRACE();
   int r = 0;
 
+  // every data read (read, data_digest, fsck, recompression) comes
+  // through here; none may see blocks a background replay hasn't rewritten
+  _wait_deferred_replay();
+
   dout(20) << __func__ << " 0x" << std::hex << offset << "~" << length
            << " size 0x" << o->onode.size << " (" << std::dec
            << o->onode.size << ")" << dendl;
@@ -6385,8 +7259,31 @@ int BlueStore::_do_read(
     length = o->onode.size - offset;
   }
 
+  // read ahead of sequential readers, into the cache
+  uint64_t read_length = length;
+  uint64_t readahead = cct->_conf->get_val<uint64_t>("bluestore_readahead_size");
+  if (readahead &&
+      (op_flags & (CEPH_OSD_OP_FLAG_FADVISE_RANDOM |
+		   CEPH_OSD_OP_FLAG_FADVISE_DONTNEED |
+		   CEPH_OSD_OP_FLAG_FADVISE_NOCACHE)) == 0 &&
+      ((op_flags & CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL) ||
+       offset == o->readahead_next)) {
+    read_length += std::min<uint64_t>(readahead,
+				      o->onode.size - (offset + length));
+    if (read_length > length) {
+      dout(20) << __func__ << " readahead 0x" << std::hex
+	       << (offset + length) << "~" << (read_length - length)
+	       << std::dec << dendl;
+      logger->inc(l_bluestore_readahead_bytes, read_length - length);
+      buffered = true;
+    }
+  }
+  if ((op_flags & CEPH_OSD_OP_FLAG_FADVISE_RANDOM) == 0) {
+    o->readahead_next = offset + length;
+  }
+
   utime_t start = ceph_clock_now();
-  o->extent_map.fault_range(db, offset, length);
+  o->extent_map.fault_range(db, offset, read_length);
   logger->tinc(l_bluestore_read_onode_meta_lat, ceph_clock_now() - start);
   _dump_onode(o);
 
@@ -6394,9 +7291,8 @@ int BlueStore::_do_read(
 
   // build blob-wise list to of stuff read (that isn't cached)
   blobs2read_t blobs2read;
-  unsigned left = length;
+  unsigned left = read_length;
   uint64_t pos = offset;
-  unsigned num_regions = 0;
   auto lp = o->extent_map.seek_lextent(offset);
   while (left > 0 && lp != o->extent_map.extent_map.end()) {
     if (pos < lp->logical_offset) {
@@ -6442,7 +7338,6 @@ int BlueStore::_do_read(
 	dout(30) << __func__ << "    will read 0x" << std::hex << pos << ": 0x"
 		 << b_off << "~" << l << std::dec << dendl;
 	blobs2read[bptr].emplace_back(region_t(pos, b_off, l));
-	++num_regions;
       }
       pos += l;
       b_off += l;
@@ -6452,12 +7347,13 @@ int BlueStore::_do_read(
     ++lp;
   }
 
-  // read raw blob data.  use aio if we have >1 blobs to read.
+  // read raw blob data.  gather the device extents of every blob
+  // first, then read physically adjacent or nearby ones with one io.
   start = ceph_clock_now(); // for the sake of simplicity 
                                     // measure the whole block below.
                                     // The error isn't that much...
   vector<bufferlist> compressed_blob_bls;
-  IOContext ioc(cct, NULL);
+  vector<read_piece_t> pieces;
   for (auto& p : blobs2read) {
     BlobRef bptr = p.first;
     dout(20) << __func__ << "  blob " << *bptr << std::hex
@@ -6473,15 +7369,7 @@ int BlueStore::_do_read(
       r = bptr->get_blob().map(
 	0, bptr->get_blob().get_ondisk_length(),
 	[&](uint64_t offset, uint64_t length) {
-	  int r;
-	  // use aio if there are more regions to read than those in this blob
-	  if (num_regions > p.second.size()) {
-	    r = bdev->aio_read(offset, length, &bl, &ioc);
-	  } else {
-	    r = bdev->read(offset, length, &bl, &ioc, false);
-	  }
-	  if (r < 0)
-            return r;
+	  pieces.emplace_back(offset, length, &bl);
           return 0;
 	});
         assert(r == 0);
@@ -6507,31 +7395,83 @@ int BlueStore::_do_read(
 		 << " reading 0x" << reg.r_off << "~" << r_len << std::dec
 		 << dendl;
 
-	// read it
 	r = bptr->get_blob().map(
 	  reg.r_off, r_len,
 	  [&](uint64_t offset, uint64_t length) {
-	    int r;
-	    // use aio if there is more than one region to read
-	    if (num_regions > 1) {
-	      r = bdev->aio_read(offset, length, &reg.bl, &ioc);
-	    } else {
-	      r = bdev->read(offset, length, &reg.bl, &ioc, false);
-	    }
-	    if (r < 0)
-              return r;
+	    pieces.emplace_back(offset, length, &reg.bl);
             return 0;
 	  });
 	assert(r == 0);
-	assert(reg.bl.length() == r_len);
       }
     }
   }
+
+  // merge pieces no more than bluestore_read_coalesce_gap apart,
+  // reading through the gaps
+  uint64_t coalesce_gap =
+    cct->_conf->get_val<uint64_t>("bluestore_read_coalesce_gap");
+  uint64_t coalesce_max =
+    cct->_conf->get_val<uint64_t>("bluestore_read_coalesce_max");
+  vector<read_piece_t*> sorted;
+  sorted.reserve(pieces.size());
+  for (auto& pc : pieces) {
+    sorted.push_back(&pc);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+	    [](const read_piece_t *a, const read_piece_t *b) {
+	      return a->offset < b->offset;
+	    });
+  vector<read_io_t> ios;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    read_piece_t *pc = sorted[i];
+    if (!ios.empty()) {
+      read_io_t& io = ios.back();
+      uint64_t end = std::max(io.offset + io.length, pc->offset + pc->length);
+      if (pc->offset <= io.offset + io.length + coalesce_gap &&
+	  end - io.offset <= coalesce_max) {
+	io.length = end - io.offset;
+	io.last = i + 1;
+	continue;
+      }
+    }
+    ios.emplace_back(pc->offset, pc->length, i);
+  }
+  if (ios.size() < pieces.size()) {
+    logger->inc(l_bluestore_read_coalesced_ios, pieces.size() - ios.size());
+  }
+
+  IOContext ioc(cct, NULL);
+  for (auto& io : ios) {
+    dout(20) << __func__ << "  read 0x" << std::hex << io.offset << "~"
+	     << io.length << std::dec << " for " << (io.last - io.first)
+	     << " pieces" << dendl;
+    // use aio if there is more than one io
+    if (ios.size() > 1) {
+      r = bdev->aio_read(io.offset, io.length, &io.bl, &ioc);
+    } else {
+      r = bdev->read(io.offset, io.length, &io.bl, &ioc, false);
+    }
+    assert(r == 0);
+  }
   if (ioc.has_pending_aios()) {
     bdev->aio_submit(&ioc);
     dout(20) << __func__ << " waiting for aio" << dendl;
     ioc.aio_wait();
   }
+  for (auto& io : ios) {
+    assert(io.bl.length() == io.length);
+    for (size_t i = io.first; i < io.last; ++i) {
+      read_piece_t *pc = sorted[i];
+      pc->bl.substr_of(io.bl, pc->offset - io.offset, pc->length);
+      if (buffered && io.last - io.first > 1) {
+	// don't let the cache pin the gaps read through
+	pc->bl.rebuild();
+      }
+    }
+  }
+  for (auto& pc : pieces) {
+    pc.dest->claim_append(pc.bl);
+  }
   logger->tinc(l_bluestore_read_wait_aio_lat, ceph_clock_now() - start);
 
   // enumerate and decompress desired blobs
@@ -6583,7 +7523,7 @@ int BlueStore::_do_read(
   auto pr = ready_regions.begin();
   auto pr_end = ready_regions.end();
   pos = 0;
-  while (pos < length) {
+  while (pos < read_length) {
     if (pr != pr_end && pr->first == pos + offset) {
       dout(30) << __func__ << " assemble 0x" << std::hex << pos
 	       << ": data from 0x" << pr->first << "~" << pr->second.length()
@@ -6592,7 +7532,7 @@ int BlueStore::_do_read(
       bl.claim_append(pr->second);
       ++pr;
     } else {
-      uint64_t l = length - pos;
+      uint64_t l = read_length - pos;
       if (pr != pr_end) {
         assert(pr->first > pos + offset);
 	l = pr->first - (pos + offset);
@@ -6604,9 +7544,15 @@ int BlueStore::_do_read(
       pos += l;
     }
   }
-  assert(bl.length() == length);
-  assert(pos == length);
+  assert(bl.length() == read_length);
+  assert(pos == read_length);
   assert(pr == pr_end);
+  if (read_length > length) {
+    // drop the readahead, which is in the cache now
+    bufferlist t;
+    t.substr_of(bl, 0, length);
+    bl.swap(t);
+  }
   r = bl.length();
   return r;
 }
@@ -6659,7 +7605,9 @@ int BlueStore::_decompress(bufferlist& source, bufferlist* result)
   ::decode(chdr, i);
   int alg = int(chdr.type);
   CompressorRef cp = compressor;
-  if (!cp || (int)cp->get_type() != alg) {
+  if (chdr.dict_id) {
+    cp = _get_dict_compressor(alg, chdr.dict_id);
+  } else if (!cp || (int)cp->get_type() != alg) {
     cp = Compressor::create(cct, alg);
   }
 
@@ -6679,6 +7627,75 @@ int BlueStore::_decompress(bufferlist& source, bufferlist* result)
   return r;
 }
 
+uint32_t BlueStore::_register_compression_dict(const string& dict)
+{
+  bufferlist bl;
+  bl.append(dict);
+  uint32_t id = bl.crc32c(-1);
+  if (id == 0) {
+    id = 1;  // 0 means no dictionary
+  }
+  std::lock_guard<std::mutex> l(compression_dict_lock);
+  auto p = compression_dicts.find(id);
+  if (p != compression_dicts.end()) {
+    return p->second.contents_equal(bl) ? id : 0;
+  }
+
+  // store it before any blob can refer to it
+  string key;
+  _key_encode_u32(id, &key);
+  bufferlist stored;
+  if (db->get(PREFIX_COMPRESSION_DICT, key, &stored) >= 0) {
+    if (!stored.contents_equal(bl)) {
+      derr << __func__ << " dictionary id 0x" << std::hex << id << std::dec
+	   << " collides with a stored dictionary; not using it" << dendl;
+      compression_dicts[id] = stored;
+      return 0;
+    }
+  } else {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->set(PREFIX_COMPRESSION_DICT, key, bl);
+    db->submit_transaction_sync(t);
+    dout(1) << __func__ << " stored compression dictionary 0x" << std::hex
+	    << id << std::dec << " (" << bl.length() << " bytes)" << dendl;
+  }
+  compression_dicts[id] = bl;
+  return id;
+}
+
+CompressorRef BlueStore::_get_dict_compressor(int alg, uint32_t id)
+{
+  std::lock_guard<std::mutex> l(compression_dict_lock);
+  auto key = make_pair(alg, id);
+  auto p = dict_compressors.find(key);
+  if (p != dict_compressors.end()) {
+    return p->second;
+  }
+  auto q = compression_dicts.find(id);
+  if (q == compression_dicts.end()) {
+    string k;
+    _key_encode_u32(id, &k);
+    bufferlist bl;
+    if (db->get(PREFIX_COMPRESSION_DICT, k, &bl) < 0) {
+      derr << __func__ << " missing compression dictionary 0x" << std::hex
+	   << id << std::dec << dendl;
+      return CompressorRef();
+    }
+    q = compression_dicts.emplace(id, bl).first;
+  }
+  CompressorRef c = Compressor::create(cct, alg);
+  if (c) {
+    c = c->with_dictionary(q->second);
+  }
+  if (!c) {
+    // remember that, so writes fall back to plain compression quietly
+    derr << __func__ << " " << Compressor::get_comp_alg_name(alg)
+	 << " can't use compression dictionaries" << dendl;
+  }
+  dict_compressors[key] = c;
+  return c;
+}
+
 // this stores fiemap into interval_set, other variations
 // use it internally
 int BlueStore::_fiemap(
@@ -6978,6 +7995,67 @@ int BlueStore::collection_list(
   return r;
 }
 
+void BlueStore::prefetch_objects(
+  CollectionHandle &c_, const vector<ghobject_t>& oids)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->cid << " " << oids.size() << " objects"
+	   << dendl;
+  RWLock::RLocker l(c->lock);
+  if (!c->exists) {
+    return;
+  }
+
+  // keys of the onodes we don't have yet, in kv order
+  vector<pair<mempool::bluestore_cache_other::string, const ghobject_t*>> keys;
+  keys.reserve(oids.size());
+  for (auto& oid : oids) {
+    if (!c->contains(oid) || c->onode_map.lookup(oid)) {
+      continue;
+    }
+    keys.emplace_back();
+    get_object_key(cct, oid, &keys.back().first);
+    keys.back().second = &oid;
+  }
+  if (keys.empty()) {
+    return;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // one sweep: step forward over whatever lies between consecutive
+  // onodes (extent shards, objects we already have) and only seek when
+  // the next key is further away
+  string lower(keys.front().first.c_str(), keys.front().first.size());
+  string upper(keys.back().first.c_str(), keys.back().first.size());
+  upper.push_back(0);  // just past the last key
+  KeyValueDB::Iterator it = db->get_bounded_iterator(PREFIX_OBJ, lower, upper);
+  it->lower_bound(lower);
+  unsigned loaded = 0;
+  for (auto& k : keys) {
+    string key(k.first.c_str(), k.first.size());
+    int steps = 0;
+    while (it->valid() && it->key() < key) {
+      if (++steps > 8) {
+	it->lower_bound(key);
+	break;
+      }
+      it->next();
+    }
+    if (!it->valid()) {
+      break;
+    }
+    if (it->key() != key) {
+      continue;  // gone
+    }
+    OnodeRef o(Onode::decode(c, *k.second, k.first, it->value()));
+    c->onode_map.add(*k.second, o);
+    ++loaded;
+  }
+  logger->inc(l_bluestore_onode_prefetched, loaded);
+  dout(10) << __func__ << " " << c->cid << " loaded " << loaded << " of "
+	   << keys.size() << " onodes" << dendl;
+}
+
 int BlueStore::_collection_list(
   Collection *c, const ghobject_t& start, const ghobject_t& end, int max,
   vector<ghobject_t> *ls, ghobject_t *pnext)
@@ -7125,10 +8203,10 @@ int BlueStore::omap_get(
     goto out;
   o->flush();
   {
-    KeyValueDB::Iterator it = db->get_iterator(PREFIX_OMAP);
     string head, tail;
     get_omap_header(o->onode.nid, &head);
     get_omap_tail(o->onode.nid, &tail);
+    KeyValueDB::Iterator it = db->get_bounded_iterator(PREFIX_OMAP, head, tail);
     it->lower_bound(head);
     while (it->valid()) {
       if (it->key() == head) {
@@ -7235,10 +8313,10 @@ int BlueStore::omap_get_keys(
     goto out;
   o->flush();
   {
-    KeyValueDB::Iterator it = db->get_iterator(PREFIX_OMAP);
     string head, tail;
     get_omap_key(o->onode.nid, string(), &head);
     get_omap_tail(o->onode.nid, &tail);
+    KeyValueDB::Iterator it = db->get_bounded_iterator(PREFIX_OMAP, head, tail);
     it->lower_bound(head);
     while (it->valid()) {
       if (it->key() >= tail) {
@@ -7399,7 +8477,10 @@ ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
   }
   o->flush();
   dout(10) << __func__ << " has_omap = " << (int)o->onode.has_omap() <<dendl;
-  KeyValueDB::Iterator it = db->get_iterator(PREFIX_OMAP);
+  string head, tail;
+  get_omap_header(o->onode.nid, &head);
+  get_omap_tail(o->onode.nid, &tail);
+  KeyValueDB::Iterator it = db->get_bounded_iterator(PREFIX_OMAP, head, tail);
   return ObjectMap::ObjectMapIterator(new OmapIteratorImpl(c, o, it));
 }
 
@@ -7692,6 +8773,8 @@ void BlueStore::_txc_state_proc(TransContext *txc)
   while (true) {
     dout(10) << __func__ << " txc " << txc
 	     << " " << txc->get_state_name() << dendl;
+    if (txc->trace)
+      txc->trace.event(txc->get_state_name());
     switch (txc->state) {
     case TransContext::STATE_PREPARE:
       txc->log_state_latency(logger, l_bluestore_state_prepare_lat);
@@ -7743,7 +8826,18 @@ void BlueStore::_txc_state_proc(TransContext *txc)
 	  _txc_applied_kv(txc);
 	}
       }
-      {
+      if (KVSyncShard *shard = _get_kv_sync_shard(txc)) {
+	std::lock_guard<std::mutex> l(shard->lock);
+	shard->queue.push_back(txc);
+	shard->cond.notify_one();
+	if (txc->state != TransContext::STATE_KV_SUBMITTED) {
+	  shard->queue_unsubmitted.push_back(txc);
+	  ++txc->osr->kv_committing_serially;
+	}
+	if (txc->had_ios)
+	  shard->ios++;
+	shard->throttle_costs += txc->cost;
+      } else {
 	std::lock_guard<std::mutex> l(kv_lock);
 	kv_queue.push_back(txc);
 	kv_cond.notify_one();
@@ -7883,6 +8977,16 @@ void BlueStore::_txc_write_nodes(TransContext *txc, KeyValueDB::Transaction t)
 	     << dendl;
     t->set(PREFIX_OBJ, o->key.c_str(), o->key.size(), bl);
     o->flushing_count++;
+
+    if (o->onode.extent_map_shards.empty()) {
+      logger->inc(l_bluestore_extent_map_inline_bytes, extent_part);
+      if (!cct->_conf->bluestore_extent_map_inline_cache) {
+	// empty => dirty; update() re-encodes on the next write
+	logger->inc(l_bluestore_extent_map_inline_released,
+		    o->extent_map.inline_bl.length());
+	o->extent_map.inline_bl.clear();
+      }
+    }
   }
 
   // objects we modified but didn't affect the onode
@@ -7998,19 +9102,23 @@ void BlueStore::_txc_committed_kv(TransContext *txc)
     txc->onreadable_sync->complete(0);
     txc->onreadable_sync = NULL;
   }
-  unsigned n = txc->osr->parent->shard_hint.hash_to_shard(m_finisher_num);
+  // the parent Sequencer may be gone (zombie osr)
+  unsigned n = txc->osr->parent ?
+    txc->osr->parent->shard_hint.hash_to_shard(m_finisher_num) : 0;
   if (txc->oncommit) {
-    logger->tinc(l_bluestore_commit_lat, ceph_clock_now() - txc->start);
-    finishers[n]->queue(txc->oncommit);
+    utime_t lat = ceph_clock_now() - txc->start;
+    logger->tinc(l_bluestore_commit_lat, lat);
+    logger->hinc(l_bluestore_commit_lat_bytes_hist, lat.to_nsec(), txc->bytes);
+    finishers->queue(n, txc->oncommit);
     txc->oncommit = NULL;
   }
   if (txc->onreadable) {
-    finishers[n]->queue(txc->onreadable);
+    finishers->queue(n, txc->onreadable);
     txc->onreadable = NULL;
   }
 
   if (!txc->oncommits.empty()) {
-    finishers[n]->queue(txc->oncommits);
+    finishers->queue(n, txc->oncommits);
   }
 }
 
@@ -8208,18 +9316,20 @@ void BlueStore::_kv_start()
 
   assert(m_finisher_num != 0);
 
-  for (int i = 0; i < m_finisher_num; ++i) {
-    ostringstream oss;
-    oss << "finisher-" << i;
-    Finisher *f = new Finisher(cct, oss.str(), "finisher");
-    finishers.push_back(f);
-  }
-
-  for (auto f : finishers) {
-    f->start();
-  }
+  finishers.reset(new ShardedFinisher(cct, m_finisher_num, "finisher",
+				     "finisher"));
+  finishers->start();
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
+
+  assert(kv_sync_shards.empty());
+  for (unsigned i = 1; i < cct->_conf->bluestore_kv_sync_shards; ++i) {
+    KVSyncShard *shard = new KVSyncShard(this, i);
+    ostringstream oss;
+    oss << "bstore_kv_sync" << i;
+    shard->create(oss.str().c_str());
+    kv_sync_shards.push_back(shard);
+  }
 }
 
 void BlueStore::_kv_stop()
@@ -8241,6 +9351,19 @@ void BlueStore::_kv_stop()
     kv_finalize_stop = true;
     kv_finalize_cond.notify_all();
   }
+  for (auto shard : kv_sync_shards) {
+    std::unique_lock<std::mutex> l(shard->lock);
+    while (!shard->started) {
+      shard->cond.wait(l);
+    }
+    shard->stop = true;
+    shard->cond.notify_all();
+  }
+  for (auto shard : kv_sync_shards) {
+    shard->join();
+    delete shard;
+  }
+  kv_sync_shards.clear();
   kv_sync_thread.join();
   kv_finalize_thread.join();
   {
@@ -8252,10 +9375,8 @@ void BlueStore::_kv_stop()
     kv_finalize_stop = false;
   }
   dout(10) << __func__ << " stopping finishers" << dendl;
-  for (auto f : finishers) {
-    f->wait_for_empty();
-    f->stop();
-  }
+  finishers->wait_for_empty();
+  finishers->stop();
   dout(10) << __func__ << " stopped" << dendl;
 }
 
@@ -8340,8 +9461,12 @@ void BlueStore::_kv_sync_thread()
       // case where we are approaching the max and the case we passed
       // it.  in either case, we increase the max in the earlier txn
       // we submit.
+      // with multiple kv_sync shards the other shards race with us, so
+      // the update is done out of band instead (see _kv_sync_update_max).
       uint64_t new_nid_max = 0, new_blobid_max = 0;
-      if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
+      if (!kv_sync_shards.empty()) {
+	_kv_sync_update_max();
+      } else if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
 	KeyValueDB::Transaction t =
 	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
 	new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
@@ -8350,7 +9475,8 @@ void BlueStore::_kv_sync_thread()
 	t->set(PREFIX_SUPER, "nid_max", bl);
 	dout(10) << __func__ << " new_nid_max " << new_nid_max << dendl;
       }
-      if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
+      if (kv_sync_shards.empty() &&
+	  blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
 	KeyValueDB::Transaction t =
 	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
 	new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
@@ -8424,6 +9550,9 @@ void BlueStore::_kv_sync_thread()
 	    _txc_finalize_kv(&txc, synct);
 	  }
 	  // cleanup the deferred
+	  if (cct->_conf->bluestore_debug_omit_deferred_apply) {
+	    continue;  // leave it for replay, as if we had crashed
+	  }
 	  string key;
 	  get_deferred_key(wt.seq, &key);
 	  synct->rm_single_key(PREFIX_DEFERRED, key);
@@ -8506,6 +9635,166 @@ void BlueStore::_kv_sync_thread()
   kv_sync_started = false;
 }
 
+BlueStore::KVSyncShard *BlueStore::_get_kv_sync_shard(TransContext *txc)
+{
+  unsigned n = txc->osr->kv_sync_shard;
+  if (n == 0 || n > kv_sync_shards.size()) {
+    return nullptr;
+  }
+  return kv_sync_shards[n - 1];
+}
+
+void BlueStore::_kv_sync_update_max()
+{
+  // Bump {nid,blobid}_max in a transaction of its own.  We submit it
+  // (in rocksdb's log order) before any txc that may use the new range,
+  // and the sync that makes such a txc durable makes this one durable
+  // too, so it is safe to publish the new max right away.  The lock
+  // keeps the persisted values monotonic across shards.
+  std::lock_guard<std::mutex> l(kv_max_lock);
+  KeyValueDB::Transaction t;
+  uint64_t new_nid_max = 0, new_blobid_max = 0;
+  if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
+    t = db->get_transaction();
+    new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
+    bufferlist bl;
+    ::encode(new_nid_max, bl);
+    t->set(PREFIX_SUPER, "nid_max", bl);
+    dout(10) << __func__ << " new_nid_max " << new_nid_max << dendl;
+  }
+  if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
+    if (!t) {
+      t = db->get_transaction();
+    }
+    new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
+    bufferlist bl;
+    ::encode(new_blobid_max, bl);
+    t->set(PREFIX_SUPER, "blobid_max", bl);
+    dout(10) << __func__ << " new_blobid_max " << new_blobid_max << dendl;
+  }
+  if (!t) {
+    return;
+  }
+  int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 : db->submit_transaction(t);
+  assert(r == 0);
+  if (new_nid_max) {
+    nid_max = new_nid_max;
+    dout(10) << __func__ << " nid_max now " << nid_max << dendl;
+  }
+  if (new_blobid_max) {
+    blobid_max = new_blobid_max;
+    dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
+  }
+}
+
+void BlueStore::_kv_sync_shard_thread(KVSyncShard *shard)
+{
+  dout(10) << __func__ << " " << shard->id << " start" << dendl;
+  deque<TransContext*> kv_committing;
+  std::unique_lock<std::mutex> l(shard->lock);
+  assert(!shard->started);
+  shard->started = true;
+  shard->cond.notify_all();
+  while (true) {
+    assert(kv_committing.empty());
+    if (shard->queue.empty()) {
+      if (shard->stop)
+	break;
+      dout(20) << __func__ << " " << shard->id << " sleep" << dendl;
+      shard->cond.wait(l);
+      dout(20) << __func__ << " " << shard->id << " wake" << dendl;
+      continue;
+    }
+
+    deque<TransContext*> kv_submitting;
+    dout(20) << __func__ << " " << shard->id
+	     << " committing " << shard->queue.size()
+	     << " submitting " << shard->queue_unsubmitted.size() << dendl;
+    kv_committing.swap(shard->queue);
+    kv_submitting.swap(shard->queue_unsubmitted);
+    uint64_t aios = shard->ios;
+    uint64_t costs = shard->throttle_costs;
+    shard->ios = 0;
+    shard->throttle_costs = 0;
+    utime_t start = ceph_clock_now();
+    l.unlock();
+
+    dout(30) << __func__ << " committing " << kv_committing << dendl;
+    dout(30) << __func__ << " submitting " << kv_submitting << dendl;
+
+    // deferred ios are the business of shard 0; we only need to make
+    // sure our own aios are stable before their metadata commits.  if
+    // bluefs shares the data device its commit will flush it for us.
+    if (aios || !bluefs_single_shared_device || !bluefs) {
+      dout(20) << __func__ << " num_aios=" << aios << ", flushing" << dendl;
+      bdev->flush();
+    }
+    utime_t after_flush = ceph_clock_now();
+
+    _kv_sync_update_max();
+
+    for (auto txc : kv_committing) {
+      txc->log_state_latency(logger, l_bluestore_state_kv_queued_lat);
+      if (txc->state == TransContext::STATE_KV_QUEUED) {
+	int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 : db->submit_transaction(txc->t);
+	assert(r == 0);
+	_txc_applied_kv(txc);
+	--txc->osr->kv_committing_serially;
+	txc->state = TransContext::STATE_KV_SUBMITTED;
+	if (txc->osr->kv_submitted_waiters) {
+	  std::lock_guard<std::mutex> l(txc->osr->qlock);
+	  if (txc->osr->_is_all_kv_submitted()) {
+	    txc->osr->qcond.notify_all();
+	  }
+	}
+      } else {
+	assert(txc->state == TransContext::STATE_KV_SUBMITTED);
+      }
+      if (txc->had_ios) {
+	--txc->osr->txc_with_unstable_io;
+      }
+    }
+
+    // see _kv_sync_thread
+    throttle_bytes.put(costs);
+
+    KeyValueDB::Transaction synct = db->get_transaction();
+    int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 : db->submit_transaction_sync(synct);
+    assert(r == 0);
+
+    {
+      utime_t finish = ceph_clock_now();
+      utime_t dur_flush = after_flush - start;
+      utime_t dur_kv = finish - after_flush;
+      dout(20) << __func__ << " " << shard->id
+	       << " committed " << kv_committing.size()
+	       << " in " << (finish - start)
+	       << " (" << dur_flush << " flush + " << dur_kv << " kv commit)"
+	       << dendl;
+      logger->tinc(l_bluestore_kv_flush_lat, dur_flush);
+      logger->tinc(l_bluestore_kv_commit_lat, dur_kv);
+      logger->tinc(l_bluestore_kv_lat, finish - start);
+    }
+
+    // finalize inline; the shared kv_finalize_thread would just put
+    // the single serialization point back.
+    while (!kv_committing.empty()) {
+      TransContext *txc = kv_committing.front();
+      assert(txc->state == TransContext::STATE_KV_SUBMITTED);
+      _txc_state_proc(txc);
+      kv_committing.pop_front();
+    }
+
+    if (!deferred_aggressive && _deferred_should_submit()) {
+      deferred_try_submit();
+    }
+
+    l.lock();
+  }
+  dout(10) << __func__ << " " << shard->id << " finish" << dendl;
+  shard->started = false;
+}
+
 void BlueStore::_kv_finalize_thread()
 {
   deque<TransContext*> kv_committed;
@@ -8522,8 +9811,22 @@ void BlueStore::_kv_finalize_thread()
 	deferred_stable_to_finalize.empty()) {
       if (kv_finalize_stop)
 	break;
+      double interval = cct->_conf->bluestore_max_defer_interval;
       dout(20) << __func__ << " sleep" << dendl;
-      kv_finalize_cond.wait(l);
+      if (interval > 0 && deferred_queue_size > 0) {
+	// nothing else may come along to flush a partial deferred batch
+	auto r = kv_finalize_cond.wait_for(
+	  l, ceph::make_timespan(interval));
+	if (r == std::cv_status::timeout && !deferred_aggressive) {
+	  l.unlock();
+	  if (_deferred_should_submit()) {
+	    deferred_try_submit();
+	  }
+	  l.lock();
+	}
+      } else {
+	kv_finalize_cond.wait(l);
+      }
       dout(20) << __func__ << " wake" << dendl;
     } else {
       kv_committed.swap(kv_committing_to_finalize);
@@ -8550,11 +9853,8 @@ void BlueStore::_kv_finalize_thread()
       }
       deferred_stable.clear();
 
-      if (!deferred_aggressive) {
-	if (deferred_queue_size >= deferred_batch_ops.load() ||
-	    throttle_deferred_bytes.past_midpoint()) {
-	  deferred_try_submit();
-	}
+      if (!deferred_aggressive && _deferred_should_submit()) {
+	deferred_try_submit();
       }
 
       // this is as good a place as any ...
@@ -8608,6 +9908,21 @@ void BlueStore::_deferred_queue(TransContext *txc)
   }
 }
 
+bool BlueStore::_deferred_should_submit()
+{
+  if (deferred_queue_size >= deferred_batch_ops.load() ||
+      throttle_deferred_bytes.past_midpoint()) {
+    return true;
+  }
+  double interval = cct->_conf->bluestore_max_defer_interval;
+  if (interval > 0 && deferred_queue_size > 0) {
+    std::lock_guard<std::mutex> l(deferred_lock);
+    return ceph::mono_clock::now() - deferred_last_submit >=
+      ceph::make_timespan(interval);
+  }
+  return false;
+}
+
 void BlueStore::deferred_try_submit()
 {
   dout(20) << __func__ << " " << deferred_queue.size() << " osrs, "
@@ -8618,66 +9933,132 @@ void BlueStore::deferred_try_submit()
   for (auto& osr : deferred_queue) {
     osrs.push_back(&osr);
   }
+  uint64_t max_bytes = cct->_conf->bluestore_deferred_aggregate_max_bytes;
+  if (!max_bytes) {
+    for (auto& osr : osrs) {
+      if (osr->deferred_pending && !osr->deferred_running) {
+	_deferred_submit_unlock(osr.get());
+	deferred_lock.lock();
+      }
+    }
+    return;
+  }
+
+  // merge ready batches into groups of up to max_bytes.  a batch that
+  // overlaps one already in the group goes out on its own, as it would
+  // have without aggregation.
+  vector<OpSequencer*> group;
+  interval_set<uint64_t> group_extents;
+  uint64_t group_bytes = 0;
   for (auto& osr : osrs) {
-    if (osr->deferred_pending && !osr->deferred_running) {
+    if (!osr->deferred_pending || osr->deferred_running) {
+      continue;
+    }
+    DeferredBatch *b = osr->deferred_pending;
+    interval_set<uint64_t> extents;
+    for (auto& i : b->iomap) {
+      extents.insert(i.first, i.second.bl.length());
+    }
+    uint64_t bytes = extents.size();
+    interval_set<uint64_t> overlap;
+    overlap.intersection_of(extents, group_extents);
+    if (!overlap.empty()) {
       _deferred_submit_unlock(osr.get());
       deferred_lock.lock();
+      continue;
     }
+    if (!group.empty() && group_bytes + bytes > max_bytes) {
+      _deferred_submit_unlock(group);
+      deferred_lock.lock();
+      group.clear();
+      group_extents.clear();
+      group_bytes = 0;
+    }
+    group.push_back(osr.get());
+    group_extents.insert(extents);
+    group_bytes += bytes;
+  }
+  if (!group.empty()) {
+    _deferred_submit_unlock(group);
+    deferred_lock.lock();
   }
 }
 
-void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
+void BlueStore::_deferred_submit_unlock(const vector<OpSequencer*>& osrs)
 {
-  dout(10) << __func__ << " osr " << osr
-	   << " " << osr->deferred_pending->iomap.size() << " ios pending "
-	   << dendl;
-  assert(osr->deferred_pending);
-  assert(!osr->deferred_running);
-
+  assert(!osrs.empty());
+  OpSequencer *osr = osrs.front();
   auto b = osr->deferred_pending;
-  deferred_queue_size -= b->seq_bytes.size();
-  assert(deferred_queue_size >= 0);
-
-  osr->deferred_running = osr->deferred_pending;
-  osr->deferred_pending = nullptr;
+  assert(b);
+  assert(b->merged.empty());
+
+  // all but the first batch ride on the first batch's ioc; merge their
+  // ios into one map so we write them out in LBA order.
+  map<uint64_t,DeferredBatch::deferred_io*> ios;
+  for (auto o : osrs) {
+    dout(10) << __func__ << " osr " << o
+	     << " " << o->deferred_pending->iomap.size() << " ios pending "
+	     << dendl;
+    assert(o->deferred_pending);
+    assert(!o->deferred_running);
+    DeferredBatch *ob = o->deferred_pending;
+    deferred_queue_size -= ob->seq_bytes.size();
+    assert(deferred_queue_size >= 0);
+    for (auto& i : ob->iomap) {
+      ios[i.first] = &i.second;
+    }
+    o->deferred_running = o->deferred_pending;
+    o->deferred_pending = nullptr;
+    if (o != osr) {
+      b->merged.push_back(o);
+      logger->inc(l_bluestore_deferred_write_merged);
+    }
+  }
+  deferred_last_submit = ceph::mono_clock::now();
 
   uint64_t start = 0, pos = 0;
   bufferlist bl;
-  auto i = b->iomap.begin();
+  auto i = ios.begin();
   while (true) {
-    if (i == b->iomap.end() || i->first != pos) {
+    if (i == ios.end() || i->first != pos) {
       if (bl.length()) {
 	dout(20) << __func__ << " write 0x" << std::hex
 		 << start << "~" << bl.length()
 		 << " crc " << bl.crc32c(-1) << std::dec << dendl;
-	if (!g_conf->bluestore_debug_omit_block_device_write) {
+	if (!g_conf->bluestore_debug_omit_block_device_write &&
+	    !g_conf->bluestore_debug_omit_deferred_apply) {
 	  logger->inc(l_bluestore_deferred_write_ops);
 	  logger->inc(l_bluestore_deferred_write_bytes, bl.length());
 	  int r = bdev->aio_write(start, bl, &b->ioc, false);
 	  assert(r == 0);
 	}
       }
-      if (i == b->iomap.end()) {
+      if (i == ios.end()) {
 	break;
       }
       start = 0;
       pos = i->first;
       bl.clear();
     }
-    dout(20) << __func__ << "   seq " << i->second.seq << " 0x"
-	     << std::hex << pos << "~" << i->second.bl.length() << std::dec
+    dout(20) << __func__ << "   seq " << i->second->seq << " 0x"
+	     << std::hex << pos << "~" << i->second->bl.length() << std::dec
 	     << dendl;
     if (!bl.length()) {
       start = pos;
     }
-    pos += i->second.bl.length();
-    bl.claim_append(i->second.bl);
+    pos += i->second->bl.length();
+    bl.claim_append(i->second->bl);
     ++i;
   }
 
   // demote to deferred_submit_lock, then drop that too
   std::lock_guard<std::mutex> l(deferred_submit_lock);
   deferred_lock.unlock();
+  if (!b->ioc.has_pending_aios()) {
+    // every write was omitted (debug); no aio will call us back
+    b->aio_finish(this);
+    return;
+  }
   bdev->aio_submit(&b->ioc);
 }
 
@@ -8696,7 +10077,7 @@ void BlueStore::_deferred_aio_finish(OpSequencer *osr)
       deferred_queue.erase(q);
     } else if (deferred_aggressive) {
       dout(20) << __func__ << " queuing async deferred_try_submit" << dendl;
-      finishers[0]->queue(new FunctionContext([&](int) {
+      finishers->queue(0, new FunctionContext([&](int) {
 	    deferred_try_submit();
 	  }));
     }
@@ -8724,7 +10105,7 @@ void BlueStore::_deferred_aio_finish(OpSequencer *osr)
   }
 }
 
-int BlueStore::_deferred_replay()
+int BlueStore::_deferred_replay(bool async)
 {
   dout(10) << __func__ << " start" << dendl;
   OpSequencerRef osr = new OpSequencer(cct, this);
@@ -8753,11 +10134,31 @@ int BlueStore::_deferred_replay()
     _txc_state_proc(txc);
   }
  out:
+  deferred_replay_osr = osr;
+  deferred_replay_count = count;
+  if (async && r == 0 && count > 0) {
+    // let mount return; data access waits in _wait_deferred_replay()
+    dout(10) << __func__ << " queued " << count
+	     << " events, finishing in background" << dendl;
+    deferred_replay_pending = true;
+    deferred_replay_thread.create("bstore_replay");
+    return 0;
+  }
+  _deferred_replay_finish();
+  return r;
+}
+
+void BlueStore::_deferred_replay_finish()
+{
   dout(20) << __func__ << " draining osr" << dendl;
   _osr_drain_all();
-  osr->discard();
-  dout(10) << __func__ << " completed " << count << " events" << dendl;
-  return r;
+  deferred_replay_osr->discard();
+  deferred_replay_osr.reset();
+  dout(10) << __func__ << " completed " << deferred_replay_count << " events"
+	   << dendl;
+  std::lock_guard<std::mutex> l(deferred_replay_lock);
+  deferred_replay_pending = false;
+  deferred_replay_cond.notify_all();
 }
 
 // ---------------------------
@@ -8776,6 +10177,8 @@ int BlueStore::queue_transactions(
   ObjectStore::Transaction::collect_contexts(
     tls, &onreadable, &ondisk, &onreadable_sync);
 
+  _wait_deferred_replay();
+
   if (cct->_conf->objectstore_blackhole) {
     dout(0) << __func__ << " objectstore_blackhole = TRUE, dropping transaction"
 	    << dendl;
@@ -8794,6 +10197,8 @@ int BlueStore::queue_transactions(
   } else {
     osr = new OpSequencer(cct, this);
     osr->parent = posr;
+    osr->kv_sync_shard =
+      posr->shard_hint.hash_to_shard(kv_sync_shards.size() + 1);
     posr->p = osr;
     dout(10) << __func__ << " new " << osr << " " << *osr << dendl;
   }
@@ -8803,6 +10208,10 @@ int BlueStore::queue_transactions(
   txc->onreadable = onreadable;
   txc->onreadable_sync = onreadable_sync;
   txc->oncommit = ondisk;
+  if (op && op->pg_trace) {
+    op->store_trace.init("bluestore op", &trace_endpoint, &op->pg_trace);
+    txc->trace = op->store_trace;
+  }
 
   for (vector<Transaction>::iterator p = tls.begin(); p != tls.end(); ++p) {
     (*p).set_osr(osr);
@@ -8812,8 +10221,30 @@ int BlueStore::queue_transactions(
   _txc_calc_cost(txc);
 
   _txc_write_nodes(txc, txc->t);
+  _txc_journal_deferred(txc);
+  _txc_finalize_kv(txc, txc->t);
+  if (handle)
+    handle->suspend_tp_timeout();
+
+  utime_t tstart = ceph_clock_now();
+  _txc_throttle(txc);
+  utime_t tend = ceph_clock_now();
+
+  if (handle)
+    handle->reset_tp_timeout();
+
+  logger->inc(l_bluestore_txc);
 
-  // journal deferred items
+  // execute (start)
+  _txc_state_proc(txc);
+
+  logger->tinc(l_bluestore_submit_lat, ceph_clock_now() - start);
+  logger->tinc(l_bluestore_throttle_lat, tend - tstart);
+  return 0;
+}
+
+void BlueStore::_txc_journal_deferred(TransContext *txc)
+{
   if (txc->deferred_txn) {
     txc->deferred_txn->seq = ++deferred_seq;
     bufferlist bl;
@@ -8822,12 +10253,10 @@ int BlueStore::queue_transactions(
     get_deferred_key(txc->deferred_txn->seq, &key);
     txc->t->set(PREFIX_DEFERRED, key, bl);
   }
+}
 
-  _txc_finalize_kv(txc, txc->t);
-  if (handle)
-    handle->suspend_tp_timeout();
-
-  utime_t tstart = ceph_clock_now();
+void BlueStore::_txc_throttle(TransContext *txc)
+{
   throttle_bytes.get(txc->cost);
   if (txc->deferred_txn) {
     // ensure we do not block here because of deferred writes
@@ -8840,19 +10269,6 @@ int BlueStore::queue_transactions(
       --deferred_aggressive;
    }
   }
-  utime_t tend = ceph_clock_now();
-
-  if (handle)
-    handle->reset_tp_timeout();
-
-  logger->inc(l_bluestore_txc);
-
-  // execute (start)
-  _txc_state_proc(txc);
-
-  logger->tinc(l_bluestore_submit_lat, ceph_clock_now() - start);
-  logger->tinc(l_bluestore_throttle_lat, tend - tstart);
-  return 0;
 }
 
 void BlueStore::_txc_aio_submit(TransContext *txc)
@@ -8971,6 +10387,9 @@ void BlueStore::_txc_add_transaction(TransContext *txc, Transaction *t)
 
     // object operations
     RWLock::WLocker l(c->lock);
+    if (c->osr != txc->osr) {
+      c->osr = txc->osr;
+    }
     OnodeRef &o = ovec[op->oid];
     if (!o) {
       ghobject_t oid = i.get_oid(op->oid);
@@ -9509,7 +10928,7 @@ void BlueStore::_do_write_small(
 	  if (head_read) {
 	    bufferlist head_bl;
 	    int r = _do_read(c.get(), o, offset - head_pad - head_read, head_read,
-			     head_bl, 0);
+			     head_bl, CEPH_OSD_OP_FLAG_FADVISE_RANDOM);
 	    assert(r >= 0 && r <= (int)head_read);
 	    size_t zlen = head_read - r;
 	    if (zlen) {
@@ -9522,7 +10941,7 @@ void BlueStore::_do_write_small(
 	  if (tail_read) {
 	    bufferlist tail_bl;
 	    int r = _do_read(c.get(), o, offset + length + tail_pad, tail_read,
-			     tail_bl, 0);
+			     tail_bl, CEPH_OSD_OP_FLAG_FADVISE_RANDOM);
 	    assert(r >= 0 && r <= (int)tail_read);
 	    size_t zlen = tail_read - r;
 	    if (zlen) {
@@ -9753,6 +11172,76 @@ void BlueStore::_do_write_big(
   }
 }
 
+void BlueStore::_compress_writes(
+  CompressorRef c,
+  CompressorRef dc,
+  uint64_t dict_max_blob_size,
+  WriteContext *wctx,
+  vector<bufferlist> *compressed)
+{
+  // blobs are claimed one at a time by the calling thread and by up to
+  // compress_tp's worth of helpers, so a write with a single eligible
+  // blob, or an idle pool, costs no more than compressing inline.
+  struct Job {
+    struct Item {
+      Compressor *c;
+      const bufferlist *in;
+      bufferlist *out;
+    };
+    CompressorRef c, dc;
+    vector<Item> items;
+    std::atomic<size_t> next = {0};
+    std::mutex lock;
+    std::condition_variable cond;
+    size_t done = 0;
+  };
+  auto job = std::make_shared<Job>();
+  job->c = c;
+  job->dc = dc;
+  compressed->resize(wctx->writes.size());
+  for (size_t i = 0; i < wctx->writes.size(); ++i) {
+    auto& wi = wctx->writes[i];
+    if (wi.blob_length > min_alloc_size) {
+      Compressor *ic = dc && wi.blob_length <= dict_max_blob_size ?
+	dc.get() : c.get();
+      job->items.push_back(Job::Item{ic, &wi.bl, &(*compressed)[i]});
+    }
+  }
+  if (job->items.empty()) {
+    return;
+  }
+
+  PerfCounters *l = logger;
+  auto work = [job, l]() {
+    size_t n = 0;
+    for (size_t i = job->next++; i < job->items.size(); i = job->next++) {
+      utime_t start = ceph_clock_now();
+      auto& item = job->items[i];
+      int r = item.c->compress(*item.in, *item.out);
+      assert(r == 0);
+      l->tinc(l_bluestore_compress_lat, ceph_clock_now() - start);
+      ++n;
+    }
+    if (n) {
+      std::lock_guard<std::mutex> lk(job->lock);
+      job->done += n;
+      if (job->done == job->items.size())
+	job->cond.notify_all();
+    }
+  };
+  size_t helpers = std::min<size_t>(compress_tp.get_num_threads(),
+				    job->items.size() - 1);
+  dout(20) << __func__ << " " << job->items.size() << " blobs, "
+	   << helpers << " helpers" << dendl;
+  for (size_t i = 0; i < helpers; ++i) {
+    compress_wq.queue(make_gen_lambda_context<ThreadPool::TPHandle&>(
+      [work](ThreadPool::TPHandle&) { work(); }).release());
+  }
+  work();
+  std::unique_lock<std::mutex> lk(job->lock);
+  job->cond.wait(lk, [&] { return job->done == job->items.size(); });
+}
+
 int BlueStore::_do_alloc_write(
   TransContext *txc,
   CollectionRef coll,
@@ -9822,7 +11311,21 @@ int BlueStore::_do_alloc_write(
     }
   );
 
-  for (auto& wi : wctx->writes) {
+  // small blobs are compressed with the pool's dictionary, if it has one
+  CompressorRef dc;
+  uint64_t dict_max_blob_size = 0;
+  if (c && coll->compression_dict_id) {
+    dc = _get_dict_compressor(c->get_type(), coll->compression_dict_id);
+    dict_max_blob_size = cct->_conf->bluestore_compression_dictionary_max_blob_size;
+  }
+
+  vector<bufferlist> compressed_bls;
+  if (c) {
+    _compress_writes(c, dc, dict_max_blob_size, wctx, &compressed_bls);
+  }
+
+  for (size_t i = 0; i < wctx->writes.size(); ++i) {
+    auto& wi = wctx->writes[i];
     BlobRef b = wi.b;
     bluestore_blob_t& dblob = b->dirty_blob();
     uint64_t b_off = wi.b_off;
@@ -9833,19 +11336,15 @@ int BlueStore::_do_alloc_write(
     bufferlist compressed_bl;
     bool compressed = false;
     if(c && wi.blob_length > min_alloc_size) {
-
-      utime_t start = ceph_clock_now();
-
-      // compress
       assert(b_off == 0);
       assert(wi.blob_length == l->length());
       bluestore_compression_header_t chdr;
       chdr.type = c->get_type();
+      if (dc && wi.blob_length <= dict_max_blob_size) {
+	chdr.dict_id = coll->compression_dict_id;
+      }
       // FIXME: memory alignment here is bad
-      bufferlist t;
-
-      r = c->compress(*l, t);
-      assert(r == 0);
+      bufferlist& t = compressed_bls[i];
 
       chdr.length = t.length();
       ::encode(chdr, compressed_bl);
@@ -9883,8 +11382,6 @@ int BlueStore::_do_alloc_write(
                  << std::dec << dendl;
         logger->inc(l_bluestore_compress_rejected_count);
       }
-      logger->tinc(l_bluestore_compress_lat,
-		   ceph_clock_now() - start);
     }
     if (!compressed && wi.new_blob) {
       // initialize newly created blob only
@@ -10218,7 +11715,8 @@ int BlueStore::_do_gc(
        it != extents_to_collect.end();
        ++it) {
     bufferlist bl;
-    int r = _do_read(c.get(), o, it->offset, it->length, bl, 0);
+    int r = _do_read(c.get(), o, it->offset, it->length, bl,
+		     CEPH_OSD_OP_FLAG_FADVISE_RANDOM);
     assert(r == (int)it->length);
 
     o->extent_map.fault_range(db, it->offset, it->length);
@@ -10246,6 +11744,241 @@ int BlueStore::_do_gc(
   return 0;
 }
 
+bool BlueStore::_recompress_wanted(
+  CollectionRef& c,
+  OnodeRef o,
+  WriteContext *wctx)
+{
+  uint64_t size = o->onode.size;
+  if (o->onode.has_flag(bluestore_onode_t::FLAG_RECOMPRESSED) ||
+      size < min_alloc_size * 2 ||
+      size > cct->_conf->bluestore_throttle_bytes) {
+    return false;
+  }
+
+  _choose_write_options(c, o, CEPH_OSD_OP_FLAG_FADVISE_DONTNEED, wctx);
+  // cold data: aim for the largest blobs we are allowed
+  if (wctx->compress) {
+    wctx->target_blob_size = select_option(
+      "compression_max_blob_size",
+      comp_max_blob_size.load(),
+      [&]() {
+	int val;
+	if (c->pool_opts.get(pool_opts_t::COMPRESSION_MAX_BLOB_SIZE, &val)) {
+	  return boost::optional<uint64_t>((uint64_t)val);
+	}
+	return boost::optional<uint64_t>();
+      }
+    );
+    if (wctx->target_blob_size < min_alloc_size * 2) {
+      wctx->target_blob_size = min_alloc_size * 2;
+    }
+  }
+  uint64_t max_bsize = max_blob_size.load();
+  if (wctx->target_blob_size == 0 || wctx->target_blob_size > max_bsize) {
+    wctx->target_blob_size = max_bsize;
+  }
+
+  o->extent_map.fault_range(db, 0, size);
+  unsigned extents = 0;
+  uint64_t uncompressed = 0;
+  for (auto& e : o->extent_map.extent_map) {
+    const bluestore_blob_t& b = e.blob->get_blob();
+    if (b.is_shared()) {
+      // cloned data; rewriting it would only un-share it
+      return false;
+    }
+    ++extents;
+    if (!b.is_compressed()) {
+      uncompressed += e.length;
+    }
+  }
+  if (!extents) {
+    return false;
+  }
+  bool fragmented = extents > 1 &&
+    size / extents < cct->_conf->get_val<uint64_t>(
+      "bluestore_recompress_min_extent_size");
+  bool compressible = wctx->compress && uncompressed >= min_alloc_size * 2;
+  dout(20) << __func__ << " " << o->oid << " size 0x" << std::hex << size
+	   << " uncompressed 0x" << uncompressed << std::dec
+	   << " extents " << extents
+	   << " fragmented " << fragmented
+	   << " compressible " << compressible << dendl;
+  return fragmented || compressible;
+}
+
+int BlueStore::_do_recompress(
+  TransContext *txc,
+  CollectionRef& c,
+  OnodeRef o,
+  WriteContext *wctx,
+  map<uint64_t,bufferlist>& data,
+  int64_t *saved)
+{
+  assert(!data.empty());
+  auto allocated = [&]() {
+    set<Blob*> seen;
+    uint64_t n = 0;
+    for (auto& e : o->extent_map.extent_map) {
+      if (seen.insert(e.blob.get()).second) {
+	n += e.blob->get_blob().get_ondisk_length();
+      }
+    }
+    return n;
+  };
+  uint64_t before = allocated();
+
+  for (auto& p : data) {
+    uint64_t length = p.second.length();
+    o->extent_map.fault_range(db, p.first, length);
+    _do_write_data(txc, c, o, p.first, length, p.second, wctx);
+  }
+
+  int r = _do_alloc_write(txc, c, o, wctx);
+  if (r < 0) {
+    derr << __func__ << " _do_alloc_write failed with " << cpp_strerror(r)
+	 << dendl;
+    return r;
+  }
+  _wctx_finish(txc, c, o, wctx);
+
+  uint64_t start = data.begin()->first;
+  uint64_t end = data.rbegin()->first + data.rbegin()->second.length();
+  o->extent_map.compress_extent_map(start, end - start);
+  o->extent_map.dirty_range(start, end - start);
+  o->onode.set_flag(bluestore_onode_t::FLAG_RECOMPRESSED);
+
+  *saved = (int64_t)before - (int64_t)allocated();
+  return 0;
+}
+
+int BlueStore::_recompress_object(
+  CollectionRef& c,
+  const ghobject_t& oid,
+  uint64_t *bytes)
+{
+  utime_t start = ceph_clock_now();
+  logger->inc(l_bluestore_recompress_scanned);
+
+  // read under the read lock so client reads aren't held up by our io,
+  // then take the write lock and only rewrite if nothing has been queued
+  // on the collection's sequencer in between
+  OnodeRef o;
+  WriteContext wctx;
+  map<uint64_t,bufferlist> data;
+  uint64_t seq;
+  {
+    RWLock::RLocker l(c->lock);
+    if (!c->exists || !c->osr || c->osr->zombie) {
+      return 0;
+    }
+    // ops are applied under c->lock but their onodes are encoded after
+    // it is dropped; don't touch anything a client txc may be encoding.
+    if (c->osr->has_preparing()) {
+      dout(20) << __func__ << " " << c->cid << " busy" << dendl;
+      return 0;
+    }
+    seq = c->osr->get_last_seq();
+    if (cct->_conf->get_val<bool>("bluestore_recompress_cold_only") &&
+	c->onode_map.lookup(oid)) {
+      return 0;
+    }
+    o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      return 0;
+    }
+    if (!_recompress_wanted(c, o, &wctx)) {
+      return 0;
+    }
+    if (alloc->get_free() < o->onode.size * 2) {
+      dout(10) << __func__ << " low on space, skipping " << oid << dendl;
+      return 0;
+    }
+
+    dout(10) << __func__ << " " << c->cid << " " << oid << " size 0x"
+	     << std::hex << o->onode.size << std::dec << dendl;
+
+    // read each run of contiguous extents, leaving holes alone
+    uint64_t run_start = 0, run_end = 0;
+    auto read_run = [&]() {
+      if (run_end == run_start) {
+	return 0;
+      }
+      bufferlist& bl = data[run_start];
+      int r = _do_read(c.get(), o, run_start, run_end - run_start, bl,
+		       CEPH_OSD_OP_FLAG_FADVISE_RANDOM |
+		       CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
+      return r < 0 ? r : 0;
+    };
+    for (auto& e : o->extent_map.extent_map) {
+      if (e.logical_offset != run_end) {
+	int r = read_run();
+	if (r < 0) {
+	  return r;
+	}
+	run_start = e.logical_offset;
+      }
+      run_end = e.logical_end();
+    }
+    int r = read_run();
+    if (r < 0) {
+      return r;
+    }
+  }
+
+  TransContext *txc = nullptr;
+  int64_t saved = 0;
+  int r;
+  {
+    RWLock::WLocker l(c->lock);
+    if (!c->exists || c->osr->zombie || c->osr->has_preparing() ||
+	c->osr->get_last_seq() != seq ||
+	c->onode_map.lookup(oid) != o || !o->exists) {
+      dout(20) << __func__ << " " << c->cid << " " << oid
+	       << " changed while reading, skipping" << dendl;
+      return 0;
+    }
+
+    txc = _txc_create(c->osr.get());
+    r = _do_recompress(txc, c, o, &wctx, data, &saved);
+    if (r < 0) {
+      // nothing was allocated, but the cached extent map has been
+      // rewritten; drop the onode so that it is reloaded from disk and
+      // let the empty txc go through
+      derr << __func__ << " " << c->cid << " " << oid << " failed: "
+	   << cpp_strerror(r) << dendl;
+      c->onode_map.remove(oid);
+    } else {
+      for (auto& p : data) {
+	*bytes += p.second.length();
+      }
+      txc->write_onode(o);
+      txc->bytes = *bytes;
+    }
+    _txc_calc_cost(txc);
+    _txc_write_nodes(txc, txc->t);
+  }
+  _txc_journal_deferred(txc);
+  _txc_finalize_kv(txc, txc->t);
+  _txc_throttle(txc);
+  logger->inc(l_bluestore_txc);
+  _txc_state_proc(txc);
+  if (r < 0) {
+    return r;
+  }
+
+  logger->inc(l_bluestore_recompress_objects);
+  logger->inc(l_bluestore_recompress_bytes, *bytes);
+  if (saved > 0) {
+    logger->inc(l_bluestore_recompress_saved_bytes, saved);
+  }
+  logger->tinc(l_bluestore_recompress_lat, ceph_clock_now() - start);
+  dout(10) << __func__ << " " << c->cid << " " << oid << " rewrote 0x"
+	   << std::hex << *bytes << std::dec << " saved " << saved << dendl;
+  return 0;
+}
+
 int BlueStore::_do_write(
   TransContext *txc,
   CollectionRef& c,
@@ -10273,6 +12006,9 @@ int BlueStore::_do_write(
 
   uint64_t end = offset + length;
 
+  // new data; background recompression may want to look at it again
+  o->onode.clear_flag(bluestore_onode_t::FLAG_RECOMPRESSED);
+
   GarbageCollector gc(c->store->cct);
   int64_t benefit;
   auto dirty_start = offset;
@@ -10653,21 +12389,12 @@ int BlueStore::_rmattrs(TransContext *txc,
 
 void BlueStore::_do_omap_clear(TransContext *txc, uint64_t id)
 {
-  KeyValueDB::Iterator it = db->get_iterator(PREFIX_OMAP);
   string prefix, tail;
   get_omap_header(id, &prefix);
   get_omap_tail(id, &tail);
-  it->lower_bound(prefix);
-  while (it->valid()) {
-    if (it->key() >= tail) {
-      dout(30) << __func__ << "  stop at " << pretty_binary_string(tail)
-	       << dendl;
-      break;
-    }
-    txc->t->rmkey(PREFIX_OMAP, it->key());
-    dout(30) << __func__ << "  rm " << pretty_binary_string(it->key()) << dendl;
-    it->next();
-  }
+  dout(30) << __func__ << "  rm " << pretty_binary_string(prefix)
+	   << " to " << pretty_binary_string(tail) << dendl;
+  txc->t->rm_range_keys(PREFIX_OMAP, prefix, tail);
 }
 
 int BlueStore::_omap_clear(TransContext *txc,
@@ -10781,27 +12508,17 @@ int BlueStore::_omap_rmkey_range(TransContext *txc,
 				 const string& first, const string& last)
 {
   dout(15) << __func__ << " " << c->cid << " " << o->oid << dendl;
-  KeyValueDB::Iterator it;
   string key_first, key_last;
   int r = 0;
   if (!o->onode.has_omap()) {
     goto out;
   }
   o->flush();
-  it = db->get_iterator(PREFIX_OMAP);
   get_omap_key(o->onode.nid, first, &key_first);
   get_omap_key(o->onode.nid, last, &key_last);
-  it->lower_bound(key_first);
-  while (it->valid()) {
-    if (it->key() >= key_last) {
-      dout(30) << __func__ << "  stop at " << pretty_binary_string(key_last)
-	       << dendl;
-      break;
-    }
-    txc->t->rmkey(PREFIX_OMAP, it->key());
-    dout(30) << __func__ << "  rm " << pretty_binary_string(it->key()) << dendl;
-    it->next();
-  }
+  dout(30) << __func__ << "  rm " << pretty_binary_string(key_first)
+	   << " to " << pretty_binary_string(key_last) << dendl;
+  txc->t->rm_range_keys(PREFIX_OMAP, key_first, key_last);
   txc->note_modified_object(o);
 
  out:
@@ -10880,10 +12597,10 @@ int BlueStore::_clone(TransContext *txc,
     if (!newo->onode.has_omap()) {
       newo->onode.set_omap_flag();
     }
-    KeyValueDB::Iterator it = db->get_iterator(PREFIX_OMAP);
     string head, tail;
     get_omap_header(oldo->onode.nid, &head);
     get_omap_tail(oldo->onode.nid, &tail);
+    KeyValueDB::Iterator it = db->get_bounded_iterator(PREFIX_OMAP, head, tail);
     it->lower_bound(head);
     while (it->valid()) {
       if (it->key() >= tail) {
@@ -34,6 +34,7 @@
 #include "include/memory.h"
 #include "include/mempool.h"
 #include "common/Finisher.h"
+#include "common/WorkQueue.h"
 #include "common/perf_counters.h"
 #include "compressor/Compressor.h"
 #include "os/ObjectStore.h"
@@ -41,6 +42,7 @@
 #include "bluestore_types.h"
 #include "BlockDevice.h"
 #include "common/EventTrace.h"
+#include "common/zipkin_trace.h"
 
 class Allocator;
 class FreelistManager;
@@ -75,16 +77,23 @@ enum {
   l_bluestore_submit_lat,
   l_bluestore_commit_lat,
   l_bluestore_read_lat,
+  l_bluestore_read_lat_bytes_hist,
+  l_bluestore_commit_lat_bytes_hist,
   l_bluestore_read_onode_meta_lat,
   l_bluestore_read_wait_aio_lat,
+  l_bluestore_read_coalesced_ios,
+  l_bluestore_readahead_bytes,
   l_bluestore_compress_lat,
   l_bluestore_decompress_lat,
   l_bluestore_csum_lat,
+  l_bluestore_digest_csum_bytes,
+  l_bluestore_digest_hash_bytes,
   l_bluestore_compress_success_count,
   l_bluestore_compress_rejected_count,
   l_bluestore_write_pad_bytes,
   l_bluestore_deferred_write_ops,
   l_bluestore_deferred_write_bytes,
+  l_bluestore_deferred_write_merged,
   l_bluestore_write_penalty_read_ops,
   l_bluestore_allocated,
   l_bluestore_stored,
@@ -94,6 +103,7 @@ enum {
   l_bluestore_onodes,
   l_bluestore_onode_hits,
   l_bluestore_onode_misses,
+  l_bluestore_onode_prefetched,
   l_bluestore_onode_shard_hits,
   l_bluestore_onode_shard_misses,
   l_bluestore_extents,
@@ -116,6 +126,22 @@ enum {
   l_bluestore_blob_split,
   l_bluestore_extent_compress,
   l_bluestore_gc_merged,
+  l_bluestore_extent_map_inline_bytes,
+  l_bluestore_extent_map_inline_released,
+  l_bluestore_onode_mem_bytes,
+  l_bluestore_cache_meta_target,
+  l_bluestore_cache_meta_bytes,
+  l_bluestore_cache_data_target,
+  l_bluestore_cache_data_bytes,
+  l_bluestore_cache_kv_target,
+  l_bluestore_cache_kv_bytes,
+  l_bluestore_recompress_scanned,
+  l_bluestore_recompress_objects,
+  l_bluestore_recompress_bytes,
+  l_bluestore_recompress_saved_bytes,
+  l_bluestore_recompress_lat,
+  l_bluestore_alloc_snapshot_loaded,
+  l_bluestore_alloc_snapshot_rejected,
   l_bluestore_last
 };
 
@@ -694,6 +720,8 @@ public:
       return blob_start() < o || blob_end() > o + l;
     }
   };
+  /// stays a node-based set: split_blob() and punch_hole() insert and
+  /// erase extents while iterating, which a flat array would invalidate
   typedef boost::intrusive::set<Extent> extent_map_t;
 
 
@@ -1004,6 +1032,8 @@ public:
     mempool::bluestore_cache_other::string key;
 
     boost::intrusive::list_member_hook<> lru_item;
+    /// hit since the last trim pass (lockless lookup defers lru touch)
+    std::atomic<bool> lru_referenced = {false};
 
     bluestore_onode_t onode;  ///< metadata stored as value in kv store
     bool exists;              ///< true if object logically exists
@@ -1016,6 +1046,9 @@ public:
     std::mutex flush_lock;  ///< protect flush_txns
     std::condition_variable flush_cond;   ///< wait here for uncommitted txns
 
+    /// end of the last read; a read starting here is sequential
+    std::atomic<uint64_t> readahead_next = {0};
+
     Onode(Collection *c, const ghobject_t& o,
 	  const mempool::bluestore_cache_other::string& k)
       : nref(0),
@@ -1026,6 +1059,12 @@ public:
 	extent_map(this) {
     }
 
+    /// decode an onode loaded from its PREFIX_OBJ key
+    static Onode* decode(Collection *c,
+			 const ghobject_t& oid,
+			 const mempool::bluestore_cache_other::string& key,
+			 const bufferlist& v);
+
     void flush();
     void get() {
       ++nref;
@@ -1296,13 +1335,16 @@ public:
   private:
     Cache *cache;
 
+    /// protect onode_map; writers also hold cache->lock (taken first)
+    RWLock lock;
+
     /// forward lookups
     mempool::bluestore_cache_other::unordered_map<ghobject_t,OnodeRef> onode_map;
 
     friend class Collection; // for split_cache()
 
   public:
-    OnodeSpace(Cache *c) : cache(c) {}
+    OnodeSpace(Cache *c) : cache(c), lock("BlueStore::OnodeSpace::lock") {}
     ~OnodeSpace() {
       clear();
     }
@@ -1310,8 +1352,11 @@ public:
     OnodeRef add(const ghobject_t& oid, OnodeRef o);
     OnodeRef lookup(const ghobject_t& o);
     void remove(const ghobject_t& oid) {
+      RWLock::WLocker l(lock);
       onode_map.erase(oid);
     }
+    /// remove o unless someone other than the map and the caller holds a ref
+    bool try_remove(Onode *o);
     void rename(OnodeRef& o, const ghobject_t& old_oid,
 		const ghobject_t& new_oid,
 		const mempool::bluestore_cache_other::string& new_okey);
@@ -1322,6 +1367,9 @@ public:
     bool map_any(std::function<bool(OnodeRef)> f);
   };
 
+  class OpSequencer;
+  typedef boost::intrusive_ptr<OpSequencer> OpSequencerRef;
+
   struct Collection : public CollectionImpl {
     BlueStore *store;
     Cache *cache;       ///< our cache shard
@@ -1339,6 +1387,10 @@ public:
 
     //pool options
     pool_opts_t pool_opts;
+    uint32_t compression_dict_id = 0;  ///< pool's compression dictionary, if any
+
+    /// sequencer of the last txc to modify us (protected by lock)
+    OpSequencerRef osr;
 
     OnodeRef get_onode(const ghobject_t& oid, bool create);
 
@@ -1403,9 +1455,6 @@ public:
     }
   };
 
-  class OpSequencer;
-  typedef boost::intrusive_ptr<OpSequencer> OpSequencerRef;
-
   struct volatile_statfs{
     enum {
       STATFS_ALLOCATED = 0,
@@ -1560,6 +1609,8 @@ public:
     utime_t start;
     utime_t last_stamp;
 
+    ZTracer::Trace trace;  ///< child of the op's pg trace, if it has one
+
     uint64_t last_nid = 0;     ///< if non-zero, highest new nid we allocated
     uint64_t last_blobid = 0;  ///< if non-zero, highest new blobid we allocated
 
@@ -1607,6 +1658,8 @@ public:
 
   struct DeferredBatch : public AioContext {
     OpSequencer *osr;
+    /// sequencers whose batches were merged into our ioc
+    vector<OpSequencer*> merged;
     struct deferred_io {
       bufferlist bl;    ///< data
       uint64_t seq;     ///< deferred transaction seq
@@ -1629,7 +1682,13 @@ public:
 		       bufferlist::const_iterator& p);
 
     void aio_finish(BlueStore *store) override {
+      // we may be consumed (and freed) once our own osr is finished
+      vector<OpSequencer*> m;
+      m.swap(merged);
       store->_deferred_aio_finish(osr);
+      for (auto o : m) {
+	store->_deferred_aio_finish(o);
+      }
     }
   };
 
@@ -1661,6 +1720,8 @@ public:
 
     std::atomic_int kv_submitted_waiters = {0};
 
+    unsigned kv_sync_shard = 0;  ///< kv_sync shard that commits our txcs
+
     std::atomic_bool registered = {true}; ///< registered in BlueStore's osr_set
     std::atomic_bool zombie = {false};    ///< owning Sequencer has gone away
 
@@ -1704,6 +1765,22 @@ public:
       q.push_back(*txc);
     }
 
+    uint64_t get_last_seq() {
+      std::lock_guard<std::mutex> l(qlock);
+      return last_seq;
+    }
+
+    /// true if a txc is between _txc_create and _txc_state_proc
+    bool has_preparing() {
+      std::lock_guard<std::mutex> l(qlock);
+      for (auto& txc : q) {
+	if (txc.state == TransContext::STATE_PREPARE) {
+	  return true;
+	}
+      }
+      return false;
+    }
+
     void drain() {
       std::unique_lock<std::mutex> l(qlock);
       while (!q.empty())
@@ -1780,6 +1857,34 @@ public:
       return NULL;
     }
   };
+  struct DeferredReplayThread : public Thread {
+    BlueStore *store;
+    explicit DeferredReplayThread(BlueStore *s) : store(s) {}
+    void *entry() override {
+      store->_deferred_replay_finish();
+      return NULL;
+    }
+  };
+
+  /// an additional kv_sync thread, used when bluestore_kv_sync_shards > 1
+  struct KVSyncShard : public Thread {
+    BlueStore *store;
+    unsigned id;
+    std::mutex lock;
+    std::condition_variable cond;
+    bool started = false;
+    bool stop = false;
+    deque<TransContext*> queue;             ///< ready, already submitted
+    deque<TransContext*> queue_unsubmitted; ///< ready, need submit by us
+    uint64_t ios = 0;
+    uint64_t throttle_costs = 0;
+
+    KVSyncShard(BlueStore *s, unsigned i) : store(s), id(i) {}
+    void *entry() override {
+      store->_kv_sync_shard_thread(this);
+      return NULL;
+    }
+  };
 
   struct DBHistogram {
     struct value_dist {
@@ -1845,10 +1950,11 @@ private:
   std::atomic<uint64_t> deferred_seq = {0};
   deferred_osr_queue_t deferred_queue; ///< osr's with deferred io pending
   int deferred_queue_size = 0;         ///< num txc's queued across all osrs
+  ceph::mono_time deferred_last_submit; ///< protected by deferred_lock
   atomic_int deferred_aggressive = {0}; ///< aggressive wakeup of kv thread
 
   int m_finisher_num = 1;
-  vector<Finisher*> finishers;
+  std::unique_ptr<ShardedFinisher> finishers;
 
   KVSyncThread kv_sync_thread;
   std::mutex kv_lock;
@@ -1869,8 +1975,22 @@ private:
   deque<TransContext*> kv_committing_to_finalize;   ///< pending finalization
   deque<DeferredBatch*> deferred_stable_to_finalize; ///< pending finalization
 
+  /// finishes deferred replay in the background after mount
+  DeferredReplayThread deferred_replay_thread;
+  std::mutex deferred_replay_lock;
+  std::condition_variable deferred_replay_cond;
+  std::atomic<bool> deferred_replay_pending = {false};
+  OpSequencerRef deferred_replay_osr;
+  int deferred_replay_count = 0;
+
+  /// kv_sync shards 1..n-1; shard 0 is kv_sync_thread itself
+  vector<KVSyncShard*> kv_sync_shards;
+  std::mutex kv_max_lock;  ///< serialize {nid,blobid}_max updates across shards
+
   PerfCounters *logger = nullptr;
 
+  ZTracer::Endpoint trace_endpoint {"0.0.0.0", 0, "BlueStore"};
+
   std::mutex reap_lock;
   list<CollectionRef> removed_collections;
 
@@ -1909,6 +2029,12 @@ private:
   std::atomic<uint64_t> comp_min_blob_size = {0};
   std::atomic<uint64_t> comp_max_blob_size = {0};
 
+  /// pool compression dictionaries, stored under PREFIX_COMPRESSION_DICT
+  /// by id; blobs compressed with one record its id
+  std::mutex compression_dict_lock;
+  map<uint32_t, bufferlist> compression_dicts;
+  map<pair<int,uint32_t>, CompressorRef> dict_compressors; ///< (alg, id)
+
   std::atomic<uint64_t> max_blob_size = {0};  ///< maximum blob size
 
   uint64_t kv_ios = 0;
@@ -1928,6 +2054,13 @@ private:
     Cond cond;
     Mutex lock;
     bool stop = false;
+
+    // cache autotuning; miss totals as of the last round
+    utime_t next_tune;
+    uint64_t last_onode_misses = 0;
+    uint64_t last_buffer_miss_bytes = 0;
+    uint64_t last_kv_misses = 0;
+    void _tune_cache(uint64_t meta_bytes, float bytes_per_onode);
   public:
     explicit MempoolThread(BlueStore *s)
       : store(s),
@@ -1935,6 +2068,7 @@ private:
     void *entry() override;
     void init() {
       assert(stop == false);
+      next_tune = utime_t();
       create("bstore_mempool");
     }
     void shutdown() {
@@ -1946,6 +2080,42 @@ private:
     }
   } mempool_thread;
 
+  struct RecompressThread : public Thread {
+    BlueStore *store;
+    Cond cond;
+    Mutex lock;
+    bool stop = false;
+
+    // scan position: pg collections left in this pass, and where to
+    // resume listing the last one
+    vector<coll_t> cids;
+    ghobject_t pos;
+
+    void _start_pass();
+    bool _next_batch(CollectionRef *c, vector<ghobject_t> *ls);
+  public:
+    explicit RecompressThread(BlueStore *s)
+      : store(s),
+	lock("BlueStore::RecompressThread::lock") {}
+    void *entry() override;
+    void init() {
+      assert(stop == false);
+      cids.clear();
+      pos = ghobject_t();
+      create("bstore_recomp");
+    }
+    void shutdown() {
+      lock.Lock();
+      stop = true;
+      cond.Signal();
+      lock.Unlock();
+      join();
+    }
+  } recompress_thread;
+
+  ThreadPool compress_tp;  ///< compresses the blobs of large writes in parallel
+  GenContextWQ compress_wq;
+
   // --------------------------------------------------------
   // private methods
 
@@ -1971,6 +2141,9 @@ private:
   void _close_fm();
   int _open_alloc();
   void _close_alloc();
+  int _read_alloc_snapshot(
+    vector<pair<uint64_t,uint64_t>> *extents, uint64_t *bytes);
+  void _write_alloc_snapshot();
   int _open_collections(int *errors=0);
   void _close_collections();
 
@@ -2010,6 +2183,8 @@ private:
   void _txc_add_transaction(TransContext *txc, Transaction *t);
   void _txc_calc_cost(TransContext *txc);
   void _txc_write_nodes(TransContext *txc, KeyValueDB::Transaction t);
+  void _txc_journal_deferred(TransContext *txc);
+  void _txc_throttle(TransContext *txc);
   void _txc_state_proc(TransContext *txc);
   void _txc_aio_submit(TransContext *txc);
 public:
@@ -2031,14 +2206,30 @@ private:
   void _kv_start();
   void _kv_stop();
   void _kv_sync_thread();
+  void _kv_sync_shard_thread(KVSyncShard *shard);
+  KVSyncShard *_get_kv_sync_shard(TransContext *txc);
+  void _kv_sync_update_max();
   void _kv_finalize_thread();
 
   bluestore_deferred_op_t *_get_deferred_op(TransContext *txc, OnodeRef o);
   void _deferred_queue(TransContext *txc);
   void deferred_try_submit();
-  void _deferred_submit_unlock(OpSequencer *osr);
+  bool _deferred_should_submit();
+  void _deferred_submit_unlock(OpSequencer *osr) {
+    _deferred_submit_unlock(vector<OpSequencer*>(1, osr));
+  }
+  void _deferred_submit_unlock(const vector<OpSequencer*>& osrs);
   void _deferred_aio_finish(OpSequencer *osr);
-  int _deferred_replay();
+  int _deferred_replay(bool async = false);
+  void _deferred_replay_finish();
+  /// block data access until a background deferred replay completes
+  void _wait_deferred_replay() {
+    if (!deferred_replay_pending)
+      return;
+    std::unique_lock<std::mutex> l(deferred_replay_lock);
+    while (deferred_replay_pending)
+      deferred_replay_cond.wait(l);
+  }
 
 public:
   using mempool_dynamic_bitset =
@@ -2142,6 +2333,12 @@ public:
     *pdb = db;
     return 0;
   }
+  void stop_kv_only() {
+    _close_db();
+    _close_bdev();
+    _close_fsid();
+    _close_path();
+  }
 
   int fsck(bool deep) override;
 
@@ -2219,8 +2416,18 @@ public:
     size_t len,
     bufferlist& bl,
     uint32_t op_flags = 0);
+  int data_digest(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t stride,
+    uint32_t seed,
+    uint32_t *digest,
+    uint64_t *size = nullptr,
+    uint32_t op_flags = 0) override;
 
 private:
+  uint64_t _digest_range(OnodeRef& o, uint64_t offset, const bufferlist& bl,
+			 uint32_t *crc);
   int _fiemap(CollectionHandle &c_, const ghobject_t& oid,
  	     uint64_t offset, size_t len, interval_set<uint64_t>& destset);
 public:
@@ -2262,6 +2469,8 @@ public:
 		      const ghobject_t& end,
 		      int max,
 		      vector<ghobject_t> *ls, ghobject_t *next) override;
+  void prefetch_objects(CollectionHandle &c,
+			const vector<ghobject_t>& oids) override;
 
   int omap_get(
     const coll_t& cid,                ///< [in] Collection containing oid
@@ -2426,6 +2635,8 @@ private:
     const bufferlist& bl,
     uint64_t logical_offset) const;
   int _decompress(bufferlist& source, bufferlist* result);
+  uint32_t _register_compression_dict(const string& dict);
+  CompressorRef _get_dict_compressor(int alg, uint32_t id);
 
 
   // --------------------------------------------------------
@@ -2523,6 +2734,12 @@ private:
     uint64_t offset, uint64_t length,
     bufferlist::iterator& blp,
     WriteContext *wctx);
+  void _compress_writes(
+    CompressorRef c,
+    CompressorRef dc,
+    uint64_t dict_max_blob_size,
+    WriteContext *wctx,
+    vector<bufferlist> *compressed);
   int _do_alloc_write(
     TransContext *txc,
     CollectionRef c,
@@ -2553,6 +2770,19 @@ private:
                              uint32_t fadvise_flags,
                              WriteContext *wctx);
 
+  bool _recompress_wanted(CollectionRef& c,
+			  OnodeRef o,
+			  WriteContext *wctx);
+  int _do_recompress(TransContext *txc,
+		     CollectionRef& c,
+		     OnodeRef o,
+		     WriteContext *wctx,
+		     map<uint64_t,bufferlist>& data,
+		     int64_t *saved);
+  int _recompress_object(CollectionRef& c,
+			 const ghobject_t& oid,
+			 uint64_t *bytes);
+
   int _do_gc(TransContext *txc,
              CollectionRef& c,
              OnodeRef o,
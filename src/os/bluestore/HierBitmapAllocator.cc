@@ -0,0 +1,485 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <thread>
+
+#include "HierBitmapAllocator.h"
+#include "bluestore_types.h"
+#include "common/debug.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef dout_prefix
+#define dout_prefix *_dout << "hbitmapalloc 0x" << this << " "
+
+static const uint64_t BITS = 64;
+
+static inline uint64_t div_up(uint64_t a, uint64_t b)
+{
+  return (a + b - 1) / b;
+}
+
+HierBitmapAllocator::HierBitmapAllocator(CephContext* cct,
+					 int64_t device_size,
+					 int64_t block_size)
+  : cct(cct),
+    block_size(block_size),
+    num_blocks(device_size / block_size),
+    caches(cct->_conf->bluestore_hbitmap_cache_shards),
+    cache_refill(cct->_conf->bluestore_hbitmap_cache_refill_size -
+		 cct->_conf->bluestore_hbitmap_cache_refill_size % block_size)
+{
+  assert(block_size > 0);
+  l0.resize(div_up(num_blocks, BITS), 0);
+  l1.resize(div_up(l0.size(), BITS), 0);
+  l2.resize(div_up(l1.size(), BITS), 0);
+  if (cache_refill < (uint64_t)block_size) {
+    caches.clear();
+  }
+  dout(10) << __func__ << " size 0x" << std::hex << device_size
+	   << " block_size 0x" << block_size << std::dec
+	   << " blocks " << num_blocks
+	   << " bitmap bytes " << (l0.size() + l1.size() + l2.size()) * 8
+	   << " cache shards " << caches.size() << dendl;
+}
+
+HierBitmapAllocator::~HierBitmapAllocator()
+{
+}
+
+void HierBitmapAllocator::_mark_free(uint64_t b, uint64_t n)
+{
+  uint64_t end = b + n;
+  assert(end <= num_blocks);
+  while (b < end) {
+    uint64_t w = b / BITS;
+    uint64_t bit = b % BITS;
+    uint64_t cnt = std::min(BITS - bit, end - b);
+    uint64_t mask = cnt == BITS ? ~0ull : ((1ull << cnt) - 1) << bit;
+    assert((l0[w] & mask) == 0);
+    l0[w] |= mask;
+    l1[w / BITS] |= 1ull << (w % BITS);
+    l2[w / BITS / BITS] |= 1ull << ((w / BITS) % BITS);
+    b += cnt;
+  }
+}
+
+void HierBitmapAllocator::_mark_used(uint64_t b, uint64_t n)
+{
+  uint64_t end = b + n;
+  assert(end <= num_blocks);
+  while (b < end) {
+    uint64_t w = b / BITS;
+    uint64_t bit = b % BITS;
+    uint64_t cnt = std::min(BITS - bit, end - b);
+    uint64_t mask = cnt == BITS ? ~0ull : ((1ull << cnt) - 1) << bit;
+    assert((l0[w] & mask) == mask);
+    l0[w] &= ~mask;
+    if (!l0[w]) {
+      uint64_t i1 = w / BITS;
+      l1[i1] &= ~(1ull << (w % BITS));
+      if (!l1[i1]) {
+	l2[i1 / BITS] &= ~(1ull << (i1 % BITS));
+      }
+    }
+    b += cnt;
+  }
+}
+
+/// first l0 word in [w, wend) with a free block, or -1
+int64_t HierBitmapAllocator::_next_free_word(uint64_t w, uint64_t wend)
+{
+  while (w < wend) {
+    uint64_t i1 = w / BITS;
+    uint64_t i2 = i1 / BITS;
+    uint64_t b2 = l2[i2] & (~0ull << (i1 % BITS));
+    if (!b2) {
+      w = (i2 + 1) * BITS * BITS;
+      continue;
+    }
+    uint64_t j1 = i2 * BITS + __builtin_ctzll(b2);
+    if (j1 > i1) {
+      w = j1 * BITS;
+      i1 = j1;
+    }
+    uint64_t b1 = l1[i1] & (~0ull << (w % BITS));
+    if (!b1) {
+      w = (i1 + 1) * BITS;
+      continue;
+    }
+    w = i1 * BITS + __builtin_ctzll(b1);
+    return w < wend ? (int64_t)w : -1;
+  }
+  return -1;
+}
+
+/// number of free blocks starting at b, up to max
+uint64_t HierBitmapAllocator::_free_run(uint64_t b, uint64_t max)
+{
+  uint64_t n = 0;
+  while (n < max && b < num_blocks) {
+    uint64_t bit = b % BITS;
+    uint64_t used = ~l0[b / BITS] >> bit;
+    if (!used) {
+      // bits past num_blocks are never set, so this stays in bounds
+      n += BITS - bit;
+      b += BITS - bit;
+      continue;
+    }
+    n += __builtin_ctzll(used);
+    break;
+  }
+  return std::min(n, max);
+}
+
+/// take a run starting in [start, end), aligned to and at least unit
+/// blocks, at most max blocks.  returns its length (0 if none).
+uint64_t HierBitmapAllocator::_take_run(uint64_t start, uint64_t end,
+					uint64_t unit, uint64_t max,
+					uint64_t *off)
+{
+  uint64_t wend = div_up(end, BITS);
+  uint64_t b = start;
+  while (b < end) {
+    int64_t w = _next_free_word(b / BITS, wend);
+    if (w < 0) {
+      return 0;
+    }
+    uint64_t bits = l0[w];
+    if ((uint64_t)w == b / BITS) {
+      bits &= ~0ull << (b % BITS);
+    }
+    if (!bits) {
+      b = (w + 1) * BITS;
+      continue;
+    }
+    b = w * BITS + __builtin_ctzll(bits);
+    b = div_up(b, unit) * unit;
+    if (b >= end) {
+      return 0;
+    }
+    uint64_t n = _free_run(b, max);
+    if (n >= unit) {
+      n -= n % unit;
+      _mark_used(b, n);
+      *off = b;
+      return n;
+    }
+    b += n + 1;
+  }
+  return 0;
+}
+
+/// if b is free, back up to the start of its free run (bounded)
+uint64_t HierBitmapAllocator::_rewind(uint64_t b)
+{
+  if (b >= num_blocks || !(l0[b / BITS] & (1ull << (b % BITS)))) {
+    return b;
+  }
+  uint64_t limit = b > BITS * BITS ? b - BITS * BITS : 0;
+  while (b > limit && (l0[(b - 1) / BITS] & (1ull << ((b - 1) % BITS)))) {
+    --b;
+  }
+  return b;
+}
+
+uint64_t HierBitmapAllocator::_take_run_wrap(uint64_t cursor, uint64_t unit,
+					     uint64_t max, uint64_t *off)
+{
+  uint64_t n = _take_run(cursor, num_blocks, unit, max, off);
+  if (!n && cursor) {
+    n = _take_run(0, cursor, unit, max, off);
+  }
+  return n;
+}
+
+uint64_t HierBitmapAllocator::_allocate(
+  uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+  int64_t hint, ExtentList *block_list)
+{
+  uint64_t unit = alloc_unit / block_size;
+  // unhinted allocations resume where the last one ended; take what
+  // was freed just behind the cursor along with what follows it.
+  uint64_t cursor = hint ? (hint / block_size) % num_blocks :
+    _rewind(last_alloc);
+  uint64_t got = 0;
+  while (got < want_size) {
+    uint64_t want = std::max(alloc_unit,
+			     std::min(max_alloc_size, want_size - got));
+    // AllocExtent lengths are 32 bits
+    want = std::min<uint64_t>(want, 0xffffffffull - 0xffffffffull % alloc_unit);
+    uint64_t off;
+    uint64_t n = _take_run_wrap(cursor, unit, div_up(want, block_size), &off);
+    if (!n) {
+      break;
+    }
+    dout(30) << __func__ << " got 0x" << std::hex << off * block_size
+	     << "~" << n * block_size << std::dec << dendl;
+    block_list->add_extents(off * block_size, n * block_size);
+    got += n * block_size;
+    cursor = off + n < num_blocks ? off + n : 0;
+  }
+  last_alloc = cursor;
+  return got;
+}
+
+HierBitmapAllocator::CacheShard& HierBitmapAllocator::_get_cache()
+{
+  size_t h = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return caches[h % caches.size()];
+}
+
+uint64_t HierBitmapAllocator::_cache_take(
+  CacheShard& c, uint64_t want_size, uint64_t alloc_unit,
+  uint64_t max_alloc_size, ExtentList *block_list)
+{
+  uint64_t got = 0;
+  auto p = c.extents.begin();
+  while (got < want_size && p != c.extents.end()) {
+    uint64_t skew = p->offset % alloc_unit;
+    if (skew) {
+      skew = alloc_unit - skew;
+    }
+    if (p->length < skew + alloc_unit) {
+      ++p;
+      continue;
+    }
+    uint64_t want = std::max(alloc_unit,
+			     std::min(max_alloc_size, want_size - got));
+    uint64_t avail = p->length - skew;
+    uint64_t take = std::min(avail - avail % alloc_unit,
+			     div_up(want, alloc_unit) * alloc_unit);
+    uint64_t off = p->offset + skew;
+    dout(30) << __func__ << " got 0x" << std::hex << off << "~" << take
+	     << std::dec << " from cache" << dendl;
+    block_list->add_extents(off, take);
+    got += take;
+
+    uint64_t tail_off = off + take;
+    uint64_t tail_len = p->end() - tail_off;
+    if (skew) {
+      p->length = skew;
+      ++p;
+      if (tail_len) {
+	p = c.extents.insert(p, AllocExtent(tail_off, tail_len));
+      }
+    } else if (tail_len) {
+      p->offset = tail_off;
+      p->length = tail_len;
+    } else {
+      p = c.extents.erase(p);
+    }
+  }
+  return got;
+}
+
+void HierBitmapAllocator::_flush_cache(CacheShard& c)
+{
+  // caller holds c.lock
+  if (c.extents.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> l(lock);
+  for (auto& e : c.extents) {
+    _mark_free(e.offset / block_size, e.length / block_size);
+  }
+  c.extents.clear();
+}
+
+void HierBitmapAllocator::flush_caches()
+{
+  for (auto& c : caches) {
+    std::lock_guard<std::mutex> cl(c.lock);
+    _flush_cache(c);
+  }
+}
+
+int HierBitmapAllocator::reserve(uint64_t need)
+{
+  int64_t r = num_reserved.load();
+  do {
+    if ((int64_t)need > num_free.load() - r) {
+      dout(10) << __func__ << " need 0x" << std::hex << need
+	       << " num_free 0x" << num_free.load()
+	       << " num_reserved 0x" << r << std::dec << " ENOSPC" << dendl;
+      return -ENOSPC;
+    }
+  } while (!num_reserved.compare_exchange_weak(r, r + need));
+  return 0;
+}
+
+void HierBitmapAllocator::unreserve(uint64_t unused)
+{
+  int64_t r = num_reserved.fetch_sub(unused);
+  assert(r >= (int64_t)unused);
+}
+
+int64_t HierBitmapAllocator::allocate(
+  uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+  int64_t hint, mempool::bluestore_alloc::vector<AllocExtent> *extents)
+{
+  assert(alloc_unit);
+  assert(alloc_unit % block_size == 0);
+  if (max_alloc_size == 0) {
+    max_alloc_size = want_size;
+  }
+  assert(max_alloc_size >= alloc_unit);
+  dout(10) << __func__ << " want_size 0x" << std::hex << want_size
+	   << " alloc_unit 0x" << alloc_unit
+	   << " max_alloc_size 0x" << max_alloc_size
+	   << " hint 0x" << hint << std::dec << dendl;
+  if (!num_blocks) {
+    return -ENOSPC;
+  }
+
+  ExtentList block_list = ExtentList(extents, 1, max_alloc_size);
+  uint64_t got = 0;
+
+  if (!hint && !caches.empty() && want_size < cache_refill) {
+    CacheShard& c = _get_cache();
+    std::lock_guard<std::mutex> cl(c.lock);
+    got = _cache_take(c, want_size, alloc_unit, max_alloc_size, &block_list);
+    if (got < want_size) {
+      uint64_t off, n;
+      {
+	std::lock_guard<std::mutex> l(lock);
+	n = _take_run_wrap(_rewind(last_alloc), alloc_unit / block_size,
+			   cache_refill / block_size, &off);
+	if (n) {
+	  last_alloc = off + n < num_blocks ? off + n : 0;
+	}
+      }
+      if (n) {
+	dout(20) << __func__ << " refill 0x" << std::hex << off * block_size
+		 << "~" << n * block_size << std::dec << dendl;
+	c.extents.push_back(AllocExtent(off * block_size, n * block_size));
+	got += _cache_take(c, want_size - got, alloc_unit, max_alloc_size,
+			   &block_list);
+      }
+    }
+    if (c.extents.size() > 16) {
+      // mostly unaligned leftovers; let the bitmap merge them back
+      _flush_cache(c);
+    }
+  }
+
+  if (got < want_size) {
+    {
+      std::lock_guard<std::mutex> l(lock);
+      got += _allocate(want_size - got, alloc_unit, max_alloc_size, hint,
+		       &block_list);
+    }
+    if (got < want_size && !caches.empty()) {
+      dout(20) << __func__ << " short by 0x" << std::hex << want_size - got
+	       << std::dec << ", flushing caches" << dendl;
+      flush_caches();
+      std::lock_guard<std::mutex> l(lock);
+      got += _allocate(want_size - got, alloc_unit, max_alloc_size, hint,
+		       &block_list);
+    }
+  }
+
+  if (got == 0) {
+    return -ENOSPC;
+  }
+  num_free -= got;
+  num_reserved -= got;
+  assert(num_free >= 0);
+  assert(num_reserved >= 0);
+  return got;
+}
+
+void HierBitmapAllocator::release(
+  uint64_t offset, uint64_t length)
+{
+  dout(10) << __func__ << " 0x" << std::hex << offset << "~" << length
+	   << std::dec << dendl;
+  assert(offset % block_size == 0);
+  assert(length % block_size == 0);
+  {
+    std::lock_guard<std::mutex> l(lock);
+    _mark_free(offset / block_size, length / block_size);
+  }
+  num_free += length;
+}
+
+uint64_t HierBitmapAllocator::get_free()
+{
+  return num_free;
+}
+
+void HierBitmapAllocator::dump()
+{
+  for (unsigned i = 0; i < caches.size(); ++i) {
+    std::lock_guard<std::mutex> cl(caches[i].lock);
+    dout(0) << __func__ << " cache " << i << ": "
+	    << caches[i].extents.size() << " extents" << dendl;
+    for (auto& e : caches[i].extents) {
+      dout(0) << __func__ << "  0x" << std::hex << e.offset << "~"
+	      << e.length << std::dec << dendl;
+    }
+  }
+  std::lock_guard<std::mutex> l(lock);
+  uint64_t b = 0;
+  uint64_t extents = 0;
+  while (b < num_blocks) {
+    int64_t w = _next_free_word(b / BITS, l0.size());
+    if (w < 0) {
+      break;
+    }
+    b = std::max(b, (uint64_t)w * BITS);
+    uint64_t bits = l0[w] & (~0ull << (b % BITS));
+    if (!bits) {
+      b = (w + 1) * BITS;
+      continue;
+    }
+    b = w * BITS + __builtin_ctzll(bits);
+    uint64_t n = _free_run(b, num_blocks - b);
+    dout(0) << __func__ << "  0x" << std::hex << b * block_size << "~"
+	    << n * block_size << std::dec << dendl;
+    ++extents;
+    b += n;
+  }
+  dout(0) << __func__ << " " << extents << " free extents in bitmap, 0x"
+	  << std::hex << num_free.load() << std::dec << " bytes free" << dendl;
+}
+
+void HierBitmapAllocator::init_add_free(uint64_t offset, uint64_t length)
+{
+  dout(10) << __func__ << " 0x" << std::hex << offset << "~" << length
+	   << std::dec << dendl;
+  uint64_t b = div_up(offset, block_size);
+  uint64_t e = std::min((offset + length) / block_size, num_blocks);
+  if (b >= e) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> l(lock);
+    _mark_free(b, e - b);
+  }
+  num_free += (e - b) * block_size;
+}
+
+void HierBitmapAllocator::init_rm_free(uint64_t offset, uint64_t length)
+{
+  dout(10) << __func__ << " 0x" << std::hex << offset << "~" << length
+	   << std::dec << dendl;
+  flush_caches();
+  uint64_t b = div_up(offset, block_size);
+  uint64_t e = std::min((offset + length) / block_size, num_blocks);
+  if (b >= e) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> l(lock);
+    _mark_used(b, e - b);
+  }
+  num_free -= (e - b) * block_size;
+  assert(num_free >= 0);
+}
+
+void HierBitmapAllocator::shutdown()
+{
+  dout(1) << __func__ << dendl;
+  flush_caches();
+}
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OS_BLUESTORE_HIERBITMAPALLOCATOR_H
+#define CEPH_OS_BLUESTORE_HIERBITMAPALLOCATOR_H
+
+#include <atomic>
+#include <mutex>
+
+#include "Allocator.h"
+#include "os/bluestore/bluestore_types.h"
+#include "include/mempool.h"
+
+/*
+ * Allocator over a three level bitmap.  l0 has one bit per block (set
+ * means free); each l1 bit says whether an l0 word has any free block,
+ * and each l2 bit whether an l1 word is non-zero, so finding free space
+ * skips 4096 (l1 word) or 262144 (l2 word) used blocks at a time and
+ * memory is fixed at ~1 bit per block regardless of fragmentation.
+ *
+ * Unhinted allocations are first served from a small set of cache
+ * shards (picked by thread) holding free extents carved out of the
+ * bitmap in bluestore_hbitmap_cache_refill_size chunks, so concurrent
+ * small allocations do not all serialize on the bitmap lock.  Cached
+ * space is still counted as free and is returned to the bitmap when the
+ * bitmap alone cannot satisfy a request.
+ */
+class HierBitmapAllocator : public Allocator {
+  CephContext* cct;
+
+  typedef mempool::bluestore_alloc::vector<uint64_t> slot_vector_t;
+
+  uint64_t block_size;
+  uint64_t num_blocks;
+
+  std::mutex lock;          ///< protects the bitmap levels and last_alloc
+  slot_vector_t l0;
+  slot_vector_t l1;
+  slot_vector_t l2;
+  uint64_t last_alloc = 0;  ///< block cursor for unhinted allocations
+
+  std::atomic<int64_t> num_free = {0};     ///< bytes, including cached
+  std::atomic<int64_t> num_reserved = {0}; ///< bytes
+
+  struct CacheShard {
+    std::mutex lock;
+    mempool::bluestore_alloc::vector<AllocExtent> extents;
+  };
+  vector<CacheShard> caches;
+  uint64_t cache_refill;    ///< bytes to carve out per refill
+
+  void _mark_free(uint64_t b, uint64_t n);
+  void _mark_used(uint64_t b, uint64_t n);
+  int64_t _next_free_word(uint64_t w, uint64_t wend);
+  uint64_t _free_run(uint64_t b, uint64_t max);
+  uint64_t _take_run(uint64_t start, uint64_t end, uint64_t unit,
+		     uint64_t max, uint64_t *off);
+  uint64_t _rewind(uint64_t b);
+  uint64_t _take_run_wrap(uint64_t cursor, uint64_t unit, uint64_t max,
+			  uint64_t *off);
+  uint64_t _allocate(uint64_t want_size, uint64_t alloc_unit,
+		     uint64_t max_alloc_size, int64_t hint,
+		     ExtentList *block_list);
+
+  CacheShard& _get_cache();
+  uint64_t _cache_take(CacheShard& c, uint64_t want_size, uint64_t alloc_unit,
+		       uint64_t max_alloc_size, ExtentList *block_list);
+  void _flush_cache(CacheShard& c);
+  void flush_caches();
+
+public:
+  HierBitmapAllocator(CephContext* cct, int64_t device_size,
+		      int64_t block_size);
+  ~HierBitmapAllocator() override;
+
+  int reserve(uint64_t need) override;
+  void unreserve(uint64_t unused) override;
+
+  int64_t allocate(
+    uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+    int64_t hint, mempool::bluestore_alloc::vector<AllocExtent> *extents) override;
+
+  void release(
+    uint64_t offset, uint64_t length) override;
+
+  uint64_t get_free() override;
+
+  void dump() override;
+
+  void init_add_free(uint64_t offset, uint64_t length) override;
+  void init_rm_free(uint64_t offset, uint64_t length) override;
+
+  void shutdown() override;
+};
+
+#endif
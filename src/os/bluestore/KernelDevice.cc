@@ -306,7 +306,23 @@ int KernelDevice::_aio_start()
 {
   if (aio) {
     dout(10) << __func__ << dendl;
-    int r = aio_queue.init();
+    int r = -EOPNOTSUPP;
+#ifdef HAVE_LIBURING
+    if (cct->_conf->bdev_ioring) {
+      r = aio_queue.init_uring(fd_direct,
+			       cct->_conf->bdev_ioring_sqthread_poll,
+			       cct->_conf->bdev_ioring_hipri);
+      if (r < 0) {
+	derr << __func__ << " io_uring setup failed: " << cpp_strerror(r)
+	     << "; falling back to libaio" << dendl;
+      } else {
+	dout(1) << __func__ << " using io_uring" << dendl;
+      }
+    }
+#endif
+    if (r < 0) {
+      r = aio_queue.init();
+    }
     if (r < 0) {
       if (r == -EAGAIN) {
 	derr << __func__ << " io_setup(2) failed with EAGAIN; "
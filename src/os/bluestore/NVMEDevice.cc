@@ -25,13 +25,12 @@
 #include <chrono>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <thread>
 #include <xmmintrin.h>
 
 #include <spdk/nvme.h>
 
-#include <rte_lcore.h>
-
 #include "include/stringify.h"
 #include "include/types.h"
 #include "include/compat.h"
@@ -54,8 +53,6 @@ static constexpr uint32_t data_buffer_size = 8192;
 
 static constexpr uint16_t inline_segment_num = 32;
 
-static thread_local int queue_id = -1;
-
 enum {
   l_bluestore_nvmedevice_first = 632430,
   l_bluestore_nvmedevice_aio_write_lat,
@@ -67,17 +64,12 @@ enum {
   l_bluestore_nvmedevice_queue_ops,
   l_bluestore_nvmedevice_polling_lat,
   l_bluestore_nvmedevice_buffer_alloc_failed,
+  l_bluestore_nvmedevice_qpair_full,
   l_bluestore_nvmedevice_last
 };
 
 static void io_complete(void *t, const struct spdk_nvme_cpl *completion);
 
-int dpdk_thread_adaptor(void *f)
-{
-  (*static_cast<std::function<void ()>*>(f))();
-  return 0;
-}
-
 struct IOSegment {
   uint32_t len;
   void *addr;
@@ -85,12 +77,21 @@ struct IOSegment {
 
 struct IORequest {
   uint16_t cur_seg_idx = 0;
-  uint16_t nseg;
+  uint16_t nseg = 0;
   uint32_t cur_seg_left = 0;
   void *inline_segs[inline_segment_num];
   void **extra_segs = nullptr;
 };
 
+/**
+ * one nvme io queue pair and its dma buffers.
+ *
+ * Each thread submitting io gets a queue of its own, so submission takes
+ * no lock and the submitting thread polls its own completions inline
+ * before aio_submit returns.  Once the controller runs out of io queue
+ * pairs, the remaining threads fall back to one shared queue that is
+ * serialized by @lock.
+ */
 class SharedDriverQueueData {
   SharedDriverData *driver;
   spdk_nvme_ctrlr *ctrlr;
@@ -98,48 +99,40 @@ class SharedDriverQueueData {
   std::string sn;
   uint64_t block_size;
   uint32_t sector_size;
-  uint32_t core_id;
-  uint32_t queueid;
   struct spdk_nvme_qpair *qpair;
-  std::function<void ()> run_func;
+  bool shared;
+  std::mutex lock;
 
-  bool aio_stop = false;
-  void _aio_thread();
   int alloc_buf_from_pool(Task *t, bool write);
 
-  std::atomic_bool queue_empty;
-  Mutex queue_lock;
-  Cond queue_cond;
-  std::queue<Task*> task_queue;
-
-  Mutex flush_lock;
-  Cond flush_cond;
-  std::atomic_int flush_waiters;
-  std::set<uint64_t> flush_waiter_seqs;
-
   public:
-    std::atomic_ulong completed_op_seq, queue_op_seq;
+    uint32_t current_queue_depth = 0;
     std::vector<void*> data_buf_mempool;
     PerfCounters *logger = nullptr;
 
     SharedDriverQueueData(SharedDriverData *driver, spdk_nvme_ctrlr *c, spdk_nvme_ns *ns, uint64_t block_size,
-                          const std::string &sn_tag, uint32_t sector_size, uint32_t core, uint32_t queue_id)
+                          const std::string &sn_tag, uint32_t sector_size, bool shared)
       : driver(driver),
         ctrlr(c),
         ns(ns),
 	sn(sn_tag),
         block_size(block_size),
         sector_size(sector_size),
-        core_id(core),
-        queueid(queue_id),
-        run_func([this]() { _aio_thread(); }),
-        queue_empty(false),
-        queue_lock("NVMEDevice::queue_lock"),
-        flush_lock("NVMEDevice::flush_lock"),
-        flush_waiters(0),
-        completed_op_seq(0), queue_op_seq(0) {
+        shared(shared) {
 
     qpair = spdk_nvme_ctrlr_alloc_io_qpair(ctrlr, NULL, SPDK_NVME_QPRIO_URGENT);
+    if (!qpair)
+      return;
+
+    for (uint16_t i = 0; i < data_buffer_default_num; i++) {
+      void *b = spdk_dma_zmalloc(data_buffer_size, CEPH_PAGE_SIZE, NULL);
+      if (!b) {
+        derr << __func__ << " failed to create memory pool for nvme data buffer" << dendl;
+        assert(b);
+      }
+      data_buf_mempool.push_back(b);
+    }
+
     PerfCountersBuilder b(g_ceph_context, string("NVMEDevice-AIOThread-"+stringify(this)),
                           l_bluestore_nvmedevice_first, l_bluestore_nvmedevice_last);
     b.add_time_avg(l_bluestore_nvmedevice_aio_write_lat, "aio_write_lat", "Average write completing latency");
@@ -151,67 +144,32 @@ class SharedDriverQueueData {
     b.add_time_avg(l_bluestore_nvmedevice_read_queue_lat, "read_queue_lat", "Average queue read request latency");
     b.add_time_avg(l_bluestore_nvmedevice_flush_queue_lat, "flush_queue_lat", "Average queue flush request latency");
     b.add_u64_counter(l_bluestore_nvmedevice_buffer_alloc_failed, "buffer_alloc_failed", "Alloc data buffer failed count");
+    b.add_u64_counter(l_bluestore_nvmedevice_qpair_full, "qpair_full", "Submissions retried because the queue pair was full");
     logger = b.create_perf_counters();
     g_ceph_context->get_perfcounters_collection()->add(logger);
-   }
-
-   void queue_task(Task *t, uint64_t ops = 1) {
-    queue_op_seq += ops;
-    Mutex::Locker l(queue_lock);
-    task_queue.push(t);
-    if (queue_empty.load()) {
-      queue_empty = false;
-      queue_cond.Signal();
-    }
-  }
-
-  void flush_wait() {
-    uint64_t cur_seq = queue_op_seq.load();
-    uint64_t left = cur_seq - completed_op_seq.load();
-    if (cur_seq > completed_op_seq) {
-      // TODO: this may contains read op
-      dout(10) << __func__ << " existed inflight ops " << left << dendl;
-      Mutex::Locker l(flush_lock);
-      ++flush_waiters;
-      flush_waiter_seqs.insert(cur_seq);
-      while (cur_seq > completed_op_seq.load()) {
-       flush_cond.Wait(flush_lock);
-      }
-      flush_waiter_seqs.erase(cur_seq);
-      --flush_waiters;
-    }
   }
 
-  void start() {
-    int r = rte_eal_remote_launch(dpdk_thread_adaptor, static_cast<void*>(&run_func),
-                                  core_id);
-    assert(r == 0);
-
-  }
+  bool is_valid() const { return qpair != nullptr; }
+  SharedDriverData *get_driver() { return driver; }
 
-  void stop() {
-    {
-      Mutex::Locker l(queue_lock);
-      aio_stop = true;
-      queue_cond.Signal();
-    }
-    int r = rte_eal_wait_lcore(core_id);
-    assert(r == 0);
-    aio_stop = false;
-  }
+  /// submit the task chain @t and poll until every op on this queue is done
+  void aio_handle(Task *t);
 
   ~SharedDriverQueueData() {
-    g_ceph_context->get_perfcounters_collection()->remove(logger);
-    if (!qpair) {
-      spdk_nvme_ctrlr_free_io_qpair(qpair); 
+    if (logger) {
+      g_ceph_context->get_perfcounters_collection()->remove(logger);
+      delete logger;
+    }
+    if (qpair) {
+      spdk_nvme_ctrlr_free_io_qpair(qpair);
     }
-    delete logger;
+    for (auto b : data_buf_mempool)
+      spdk_dma_free(b);
   }
 };
 
 class SharedDriverData {
   unsigned id;
-  uint32_t core_id;
 
   std::string sn;
   spdk_nvme_ctrlr *ctrlr;
@@ -219,17 +177,10 @@ class SharedDriverData {
   uint64_t block_size = 0;
   uint32_t sector_size = 0;
   uint64_t size = 0;
-  uint32_t queue_number;
-  std::vector<SharedDriverQueueData*> queues;
 
-  void _aio_start() {
-     for (auto &&it : queues)
-	      it->start();
-  }
-  void _aio_stop() {
-      for (auto &&it : queues)
-	      it->stop();
-  }
+  std::mutex lock;
+  std::vector<SharedDriverQueueData*> queues;
+  SharedDriverQueueData *shared_queue = nullptr;
 
   public:
   std::vector<NVMEDevice*> registered_devices;
@@ -239,46 +190,40 @@ class SharedDriverData {
         sn(sn_tag),
         ctrlr(c),
         ns(ns) {
-    int i;
     sector_size = spdk_nvme_ns_get_sector_size(ns);
     block_size = std::max(CEPH_PAGE_SIZE, sector_size);
     size = ((uint64_t)sector_size) * spdk_nvme_ns_get_num_sectors(ns);
 
-    RTE_LCORE_FOREACH_SLAVE(i) {
-      queues.push_back(new SharedDriverQueueData(this, ctrlr, ns, block_size, sn, sector_size, i, queue_number++));
-   }
-
-   _aio_start();
+    // reserve the fallback queue up front so that later threads always
+    // have somewhere to go once the per-thread queue pairs run out
+    shared_queue = new SharedDriverQueueData(this, ctrlr, ns, block_size, sn,
+                                             sector_size, true);
+    assert(shared_queue->is_valid());
   }
 
   bool is_equal(const string &tag) const { return sn == tag; }
   ~SharedDriverData() {
     for (auto p : queues) {
       delete p;
-   }
+    }
+    delete shared_queue;
   }
 
-  SharedDriverQueueData *get_queue(uint32_t i) {
-	return queues.at(i%queue_number);
-  }
+  SharedDriverQueueData *get_queue();
 
   void register_device(NVMEDevice *device) {
-    // in case of registered_devices, we stop thread now.
-    // Because release is really a rare case, we could bear this
-    _aio_stop();
+    std::lock_guard<std::mutex> l(lock);
     registered_devices.push_back(device);
-    _aio_start();
   }
 
   void remove_device(NVMEDevice *device) {
-    _aio_stop();
+    std::lock_guard<std::mutex> l(lock);
     std::vector<NVMEDevice*> new_devices;
     for (auto &&it : registered_devices) {
       if (it != device)
         new_devices.push_back(it);
     }
     registered_devices.swap(new_devices);
-    _aio_start();
   }
 
   uint64_t get_block_size() {
@@ -289,6 +234,32 @@ class SharedDriverData {
   }
 };
 
+// queue of the calling thread; drivers are never torn down while the
+// process runs, so the cached pointer stays valid for the thread lifetime
+static thread_local SharedDriverQueueData *queue_t = nullptr;
+
+SharedDriverQueueData *SharedDriverData::get_queue()
+{
+  if (queue_t && queue_t->get_driver() == this)
+    return queue_t;
+
+  std::lock_guard<std::mutex> l(lock);
+  SharedDriverQueueData *q = new SharedDriverQueueData(
+    this, ctrlr, ns, block_size, sn, sector_size, false);
+  if (q->is_valid()) {
+    queues.push_back(q);
+    dout(10) << __func__ << " allocated queue pair " << queues.size()
+             << " for thread " << ceph_gettid() << dendl;
+  } else {
+    delete q;
+    q = shared_queue;
+    dout(1) << __func__ << " out of io queue pairs, thread " << ceph_gettid()
+            << " shares the fallback queue" << dendl;
+  }
+  queue_t = q;
+  return q;
+}
+
 struct Task {
   NVMEDevice *device;
   IOContext *ctx = nullptr;
@@ -301,8 +272,6 @@ struct Task {
   int64_t return_code;
   ceph::coarse_real_clock::time_point start;
   IORequest io_request;
-  std::mutex lock;
-  std::condition_variable cond;
   SharedDriverQueueData *queue;
   Task(NVMEDevice *dev, IOCommand c, uint64_t off, uint64_t l, int64_t rc = 0)
     : device(dev), command(c), offset(off), len(l),
@@ -315,7 +284,8 @@ struct Task {
     if (io_request.extra_segs) {
       for (uint16_t i = 0; i < io_request.nseg; i++)
         queue_data->data_buf_mempool.push_back(io_request.extra_segs[i]);
-      delete io_request.extra_segs;
+      delete[] io_request.extra_segs;
+      io_request.extra_segs = nullptr;
     } else if (io_request.nseg) {
       for (uint16_t i = 0; i < io_request.nseg; i++)
         queue_data->data_buf_mempool.push_back(io_request.inline_segs[i]);
@@ -337,16 +307,6 @@ struct Task {
       copied += need_copy;
     }
   }
-
-  void io_wait() {
-    std::unique_lock<std::mutex> l(lock);
-    cond.wait(l);
-  }
-
-  void io_wake() {
-    std::lock_guard<std::mutex> l(lock);
-    cond.notify_all();
-  }
 };
 
 static void data_buf_reset_sgl(void *cb_arg, uint32_t sgl_offset)
@@ -437,34 +397,33 @@ int SharedDriverQueueData::alloc_buf_from_pool(Task *t, bool write)
   return 0;
 }
 
-void SharedDriverQueueData::_aio_thread()
+void SharedDriverQueueData::aio_handle(Task *t)
 {
-  dout(1) << __func__ << " start" << dendl;
+  dout(20) << __func__ << " start" << dendl;
 
-  if (data_buf_mempool.empty()) {
-    for (uint16_t i = 0; i < data_buffer_default_num; i++) {
-      void *b = spdk_dma_zmalloc(data_buffer_size, CEPH_PAGE_SIZE, NULL);
-      if (!b) {
-        derr << __func__ << " failed to create memory pool for nvme data buffer" << dendl;
-        assert(b);
-      }
-      data_buf_mempool.push_back(b);
-    }
-  }
+  std::unique_lock<std::mutex> l(lock, std::defer_lock);
+  if (shared)
+    l.lock();
 
-  Task *t = nullptr;
   int r = 0;
   uint64_t lba_off, lba_count;
+  uint32_t max_io_completion = g_conf->bluestore_spdk_max_io_completion;
 
   ceph::coarse_real_clock::time_point cur, start
     = ceph::coarse_real_clock::now();
-  while (true) {
-    bool inflight = queue_op_seq.load() - completed_op_seq.load();
+  // we only wait for the queue to drain rather than for the callers ioc:
+  // the completion callback may hand the ioc to another thread that frees
+  // it, so it must not be touched once its last op completes.
+  while (t || current_queue_depth) {
  again:
     dout(40) << __func__ << " polling" << dendl;
-    if (inflight) {
-      if (!spdk_nvme_qpair_process_completions(qpair, g_conf->bluestore_spdk_max_io_completion)) {
-        dout(30) << __func__ << " idle, have a pause" << dendl;
+    if (current_queue_depth) {
+      r = spdk_nvme_qpair_process_completions(qpair, max_io_completion);
+      if (r < 0) {
+        derr << __func__ << " failed to process completions: "
+             << cpp_strerror(r) << dendl;
+        ceph_abort();
+      } else if (r == 0) {
         _mm_pause();
       }
     }
@@ -486,7 +445,11 @@ void SharedDriverQueueData::_aio_thread()
           r = spdk_nvme_ns_cmd_writev(
               ns, qpair, lba_off, lba_count, io_complete, t, 0,
               data_buf_reset_sgl, data_buf_next_sge);
-          if (r < 0) {
+          if (r == -ENOMEM) {
+            t->release_segs(this);
+            logger->inc(l_bluestore_nvmedevice_qpair_full);
+            goto again;
+          } else if (r < 0) {
             derr << __func__ << " failed to do write command" << dendl;
             t->ctx->nvme_task_first = t->ctx->nvme_task_last = nullptr;
             t->release_segs(this);
@@ -510,7 +473,11 @@ void SharedDriverQueueData::_aio_thread()
           r = spdk_nvme_ns_cmd_readv(
               ns, qpair, lba_off, lba_count, io_complete, t, 0,
               data_buf_reset_sgl, data_buf_next_sge);
-          if (r < 0) {
+          if (r == -ENOMEM) {
+            t->release_segs(this);
+            logger->inc(l_bluestore_nvmedevice_qpair_full);
+            goto again;
+          } else if (r < 0) {
             derr << __func__ << " failed to read" << dendl;
             t->release_segs(this);
             delete t;
@@ -526,7 +493,10 @@ void SharedDriverQueueData::_aio_thread()
         {
           dout(20) << __func__ << " flush command issueed " << dendl;
           r = spdk_nvme_ns_cmd_flush(ns, qpair, io_complete, t);
-          if (r < 0) {
+          if (r == -ENOMEM) {
+            logger->inc(l_bluestore_nvmedevice_qpair_full);
+            goto again;
+          } else if (r < 0) {
             derr << __func__ << " failed to flush" << dendl;
             t->release_segs(this);
             delete t;
@@ -539,47 +509,14 @@ void SharedDriverQueueData::_aio_thread()
           break;
         }
       }
-    }
-
-    if (!queue_empty.load()) {
-      Mutex::Locker l(queue_lock);
-      if (!task_queue.empty()) {
-        t = task_queue.front();
-        task_queue.pop();
-        logger->set(l_bluestore_nvmedevice_queue_ops, task_queue.size());
-      }
-      if (!t)
-        queue_empty = true;
-    } else {
-      if (flush_waiters.load()) {
-        Mutex::Locker l(flush_lock);
-        if (*flush_waiter_seqs.begin() <= completed_op_seq.load())
-          flush_cond.Signal();
-      }
-
-      if (!inflight) {
-        // be careful, here we need to let each thread reap its own, currently it is done
-        // by only one dedicatd dpdk thread
-        if(!queueid) {
-          for (auto &&it : driver->registered_devices)
-            it->reap_ioc();
-        }
-
-        Mutex::Locker l(queue_lock);
-        if (queue_empty.load()) {
-	  cur = ceph::coarse_real_clock::now();
-          auto dur = std::chrono::duration_cast<std::chrono::nanoseconds>(cur - start);
-          logger->tinc(l_bluestore_nvmedevice_polling_lat, dur);
-          if (aio_stop)
-            break;
-          queue_cond.Wait(queue_lock);
-          start = ceph::coarse_real_clock::now();
-        }
-      }
+      ++current_queue_depth;
+      logger->set(l_bluestore_nvmedevice_queue_ops, current_queue_depth);
     }
   }
-  assert(data_buf_mempool.size() == data_buffer_default_num);
-  dout(1) << __func__ << " end" << dendl;
+  cur = ceph::coarse_real_clock::now();
+  auto dur = std::chrono::duration_cast<std::chrono::nanoseconds>(cur - start);
+  logger->tinc(l_bluestore_nvmedevice_polling_lat, dur);
+  dout(20) << __func__ << " end" << dendl;
 }
 
 #define dout_subsys ceph_subsys_bdev
@@ -724,10 +661,11 @@ int NVMEManager::try_get(const string &sn_tag, SharedDriverData **driver)
     }
   }
 
-  // at least two cores are needed for using spdk
-  if (core_num < 2) {
+  // io is submitted and polled by the calling threads, the coremask only
+  // needs to hold the core of the spdk master thread
+  if (core_num < 1) {
     r = -ENOENT;
-    derr << __func__ << " invalid spdk coremask, at least two cores are needed: "
+    derr << __func__ << " invalid spdk coremask, at least one core is needed: "
          << cpp_strerror(r) << dendl;
     return r;
   }
@@ -800,14 +738,14 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
 
   assert(queue != NULL);
   assert(ctx != NULL);
-  ++queue->completed_op_seq;
+  --queue->current_queue_depth;
   auto dur = std::chrono::duration_cast<std::chrono::nanoseconds>(
       ceph::coarse_real_clock::now() - task->start);
   if (task->command == IOCommand::WRITE_COMMAND) {
     queue->logger->tinc(l_bluestore_nvmedevice_aio_write_lat, dur);
     assert(!spdk_nvme_cpl_is_error(completion));
     dout(20) << __func__ << " write/zero op successfully, left "
-             << queue->queue_op_seq - queue->completed_op_seq << dendl;
+             << queue->current_queue_depth << dendl;
     // check waiting count before doing callback (which may
     // destroy this ioc).
     if (ctx->priv) {
@@ -821,12 +759,12 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
     delete task;
   } else if (task->command == IOCommand::READ_COMMAND) {
     queue->logger->tinc(l_bluestore_nvmedevice_read_lat, dur);
-    assert(!spdk_nvme_cpl_is_error(completion));
     dout(20) << __func__ << " read op successfully" << dendl;
-    task->fill_cb();
-    task->release_segs(queue);
     // read submitted by AIO
     if(!task->return_code) {
+      assert(!spdk_nvme_cpl_is_error(completion));
+      task->fill_cb();
+      task->release_segs(queue);
       if (ctx->priv) {
 	if (!--ctx->num_running) {
           task->device->aio_callback(task->device->aio_callback_priv, ctx->priv);
@@ -836,10 +774,18 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
       }
       delete task;
     } else {
-      task->return_code = 0;
-      if (!--ctx->num_running) {
-        task->io_wake();
+      // synchronous read; the submitter polls inline and picks up the
+      // result once aio_handle returns
+      if (spdk_nvme_cpl_is_error(completion)) {
+        derr << __func__ << " read failed at " << task->offset << "~"
+             << task->len << dendl;
+        task->return_code = -EIO;
+      } else {
+        task->fill_cb();
+        task->return_code = 0;
       }
+      task->release_segs(queue);
+      --ctx->num_running;
     }
   } else {
     assert(task->command == IOCommand::FLUSH_COMMAND);
@@ -847,6 +793,7 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
     queue->logger->tinc(l_bluestore_nvmedevice_flush_lat, dur);
     dout(20) << __func__ << " flush op successfully" << dendl;
     task->return_code = 0;
+    --ctx->num_running;
   }
 }
 
@@ -949,15 +896,20 @@ int NVMEDevice::flush()
   dout(10) << __func__ << " start" << dendl;
   auto start = ceph::coarse_real_clock::now();
 
-  if(queue_id == -1)
-    queue_id = ceph_gettid();
-  SharedDriverQueueData *queue = driver->get_queue(queue_id);
-  assert(queue != NULL);
-  queue->flush_wait();
+  // writes are polled to completion before aio_submit returns, so all
+  // that is left is to push them out of the controller's volatile cache
+  IOContext ioc(cct, nullptr);
+  Task *t = new Task(this, IOCommand::FLUSH_COMMAND, 0, 0, 1);
+  t->ctx = &ioc;
+  ++ioc.num_running;
+  SharedDriverQueueData *queue = driver->get_queue();
+  queue->aio_handle(t);
+  int r = t->return_code;
+  delete t;
   auto dur = std::chrono::duration_cast<std::chrono::nanoseconds>(
       ceph::coarse_real_clock::now() - start);
   queue->logger->tinc(l_bluestore_nvmedevice_flush_lat, dur);
-  return 0;
+  return r;
 }
 
 void NVMEDevice::aio_submit(IOContext *ioc)
@@ -972,10 +924,9 @@ void NVMEDevice::aio_submit(IOContext *ioc)
     ioc->num_pending -= pending;
     assert(ioc->num_pending.load() == 0);  // we should be only thread doing this
     // Only need to push the first entry
-  if(queue_id == -1)
-    queue_id = ceph_gettid();
-    driver->get_queue(queue_id)->queue_task(t, pending);
     ioc->nvme_task_first = ioc->nvme_task_last = nullptr;
+    driver->get_queue()->aio_handle(t);
+    reap_ioc();
   }
 }
 
@@ -1000,22 +951,17 @@ int NVMEDevice::aio_write(
   // we can reduce this copy
   t->write_bl = std::move(bl);
 
-  if (buffered) {
-    // Only need to push the first entry
-    if(queue_id == -1)
-      queue_id = ceph_gettid();
-    driver->get_queue(queue_id)->queue_task(t);
-  } else {
-    t->ctx = ioc;
-    Task *first = static_cast<Task*>(ioc->nvme_task_first);
-    Task *last = static_cast<Task*>(ioc->nvme_task_last);
-    if (last)
-      last->next = t;
-    if (!first)
-      ioc->nvme_task_first = t;
-    ioc->nvme_task_last = t;
-    ++ioc->num_pending;
-  }
+  // there is no page cache in front of the device, so buffered writes
+  // take the same path as direct ones
+  t->ctx = ioc;
+  Task *first = static_cast<Task*>(ioc->nvme_task_first);
+  Task *last = static_cast<Task*>(ioc->nvme_task_last);
+  if (last)
+    last->next = t;
+  if (!first)
+    ioc->nvme_task_first = t;
+  ioc->nvme_task_last = t;
+  ++ioc->num_pending;
 
   dout(5) << __func__ << " " << off << "~" << len << dendl;
 
@@ -1027,6 +973,7 @@ int NVMEDevice::write(uint64_t off, bufferlist &bl, bool buffered)
   // FIXME: there is presumably a more efficient way to do this...
   IOContext ioc(cct, NULL);
   aio_write(off, bl, &ioc, buffered);
+  aio_submit(&ioc);
   ioc.aio_wait();
   return 0;
 }
@@ -1051,13 +998,8 @@ int NVMEDevice::read(uint64_t off, uint64_t len, bufferlist *pbl,
     t->copy_to_buf(buf, 0, t->len);
   };
   ++ioc->num_running;
-  if(queue_id == -1)
-    queue_id = ceph_gettid();
-  driver->get_queue(queue_id)->queue_task(t);
+  driver->get_queue()->aio_handle(t);
 
-  while(t->return_code > 0) {
-    t->io_wait();
-  }
   pbl->push_back(std::move(p));
   r = t->return_code;
   delete t;
@@ -1117,18 +1059,12 @@ int NVMEDevice::read_random(uint64_t off, uint64_t len, char *buf, bool buffered
     t->copy_to_buf(buf, off-t->offset, len);
   };
   ++ioc.num_running;
-  if(queue_id == -1)
-    queue_id = ceph_gettid();
-  driver->get_queue(queue_id)->queue_task(t);
+  driver->get_queue()->aio_handle(t);
 
-  while(t->return_code > 0) {
-    t->io_wait();
-  }
   r = t->return_code;
   delete t;
   return r;
 }
-
 int NVMEDevice::invalidate_cache(uint64_t off, uint64_t len)
 {
   dout(5) << __func__ << " " << off << "~" << len << dendl;
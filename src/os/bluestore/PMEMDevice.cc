@@ -233,15 +233,18 @@ int PMEMDevice::write(uint64_t off, bufferlist& bl, bool buffered)
     return 0;
   }
 
+  // copy every segment without draining and fence once at the end, so a
+  // fragmented bufferlist costs a single drain instead of one per piece
   bufferlist::iterator p = bl.begin();
-  uint32_t off1 = off;
+  uint64_t off1 = off;
   while (len) {
     const char *data;
     uint32_t l = p.get_ptr_and_advance(len, &data);
-    pmem_memcpy_persist(addr + off1, data, l);
+    pmem_memcpy_nodrain(addr + off1, data, l);
     len -= l;
     off1 += l;
   }
+  pmem_drain();
 
   return 0;
 }
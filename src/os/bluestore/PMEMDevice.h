@@ -38,6 +38,7 @@ class PMEMDevice : public BlockDevice {
 public:
   PMEMDevice(CephContext *cct, aio_callback_t cb, void *cbpriv);
 
+  bool is_byte_addressable() const override { return true; }
 
   void aio_submit(IOContext *ioc) override;
 
@@ -271,6 +271,18 @@ void StupidAllocator::dump()
   }
 }
 
+bool StupidAllocator::enumerate_free(
+  std::function<void(uint64_t offset, uint64_t length)> f)
+{
+  std::lock_guard<std::mutex> l(lock);
+  for (unsigned bin = 0; bin < free.size(); ++bin) {
+    for (auto p = free[bin].begin(); p != free[bin].end(); ++p) {
+      f(p.get_start(), p.get_len());
+    }
+  }
+  return true;
+}
+
 void StupidAllocator::init_add_free(uint64_t offset, uint64_t length)
 {
   std::lock_guard<std::mutex> l(lock);
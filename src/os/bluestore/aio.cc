@@ -33,6 +33,11 @@ int aio_queue_t::submit_batch(aio_iter begin, aio_iter end,
 			      uint16_t aios_size, void *priv, 
 			      int *retries)
 {
+#ifdef HAVE_LIBURING
+  if (use_uring) {
+    return _submit_batch_uring(begin, end, priv, retries);
+  }
+#endif
   // 2^16 * 125us = ~8 seconds, so max sleep is ~16 seconds
   int attempts = 16;
   int delay = 125;
@@ -63,6 +68,11 @@ int aio_queue_t::submit_batch(aio_iter begin, aio_iter end,
 
 int aio_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
 {
+#ifdef HAVE_LIBURING
+  if (use_uring) {
+    return _get_next_completed_uring(timeout_ms, paio, max);
+  }
+#endif
   io_event event[max];
   struct timespec t = {
     timeout_ms / 1000,
@@ -81,4 +91,120 @@ int aio_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
   return r;
 }
 
+#ifdef HAVE_LIBURING
+
+int aio_queue_t::init_uring(int fd, bool sqpoll, bool hipri)
+{
+  assert(ctx == 0);
+  assert(!use_uring);
+  unsigned flags = 0;
+  if (sqpoll)
+    flags |= IORING_SETUP_SQPOLL;
+  if (hipri)
+    flags |= IORING_SETUP_IOPOLL;
+  int r = io_uring_queue_init(max_iodepth, &ring, flags);
+  if (r < 0)
+    return r;
+  // without EXT_ARG, waiting with a timeout consumes an sqe, which would
+  // race with submitters on other threads.
+  if (!(ring.features & IORING_FEAT_EXT_ARG)) {
+    io_uring_queue_exit(&ring);
+    return -EOPNOTSUPP;
+  }
+  r = io_uring_register_files(&ring, &fd, 1);
+  if (r == 0) {
+    ring_fd = fd;
+  } else if (sqpoll) {
+    // older kernels only allow fixed files with sq polling
+    io_uring_queue_exit(&ring);
+    return r;
+  }
+  use_uring = true;
+  return 0;
+}
+
+int aio_queue_t::_submit_batch_uring(aio_iter begin, aio_iter end,
+				     void *priv, int *retries)
+{
+  // 2^16 * 125us = ~8 seconds, so max sleep is ~16 seconds
+  int attempts = 16;
+  int delay = 125;
+  int pos = 0;
+
+  std::lock_guard<std::mutex> l(sq_lock);
+  for (aio_iter cur = begin; cur != end; ++cur) {
+    cur->priv = priv;
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+    while (!sqe) {
+      // sq is full; push out what we have and try again
+      int r = io_uring_submit(&ring);
+      if (r < 0 && r != -EAGAIN && r != -EBUSY)
+	return r;
+      if (r <= 0) {
+	if (attempts-- <= 0)
+	  return -EAGAIN;
+	usleep(delay);
+	delay *= 2;
+	(*retries)++;
+      }
+      sqe = io_uring_get_sqe(&ring);
+    }
+    if (cur->iocb.aio_lio_opcode == IO_CMD_PWRITEV) {
+      io_uring_prep_writev(sqe, cur->fd, &cur->iov[0], cur->iov.size(),
+			   cur->offset);
+    } else {
+      assert(cur->iocb.aio_lio_opcode == IO_CMD_PREAD);
+      io_uring_prep_read(sqe, cur->fd, cur->iocb.u.c.buf, cur->length,
+			 cur->offset);
+    }
+    if (cur->fd == ring_fd) {
+      sqe->fd = 0;
+      sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    io_uring_sqe_set_data(sqe, &*cur);
+    ++pos;
+  }
+  while (true) {
+    int r = io_uring_submit(&ring);
+    if (r == -EAGAIN || r == -EBUSY) {
+      if (attempts-- > 0) {
+	usleep(delay);
+	delay *= 2;
+	(*retries)++;
+	continue;
+      }
+    }
+    if (r < 0)
+      return r;
+    break;
+  }
+  return pos;
+}
+
+int aio_queue_t::_get_next_completed_uring(int timeout_ms, aio_t **paio,
+					   int max)
+{
+  struct __kernel_timespec t = {
+    timeout_ms / 1000,
+    (timeout_ms % 1000) * 1000 * 1000
+  };
+  struct io_uring_cqe *cqe = nullptr;
+  int r = io_uring_wait_cqe_timeout(&ring, &cqe, &t);
+  if (r == -ETIME || r == -EINTR)
+    return 0;
+  if (r < 0)
+    return r;
+
+  int n = 0;
+  while (n < max && io_uring_peek_cqe(&ring, &cqe) == 0 && cqe) {
+    paio[n] = static_cast<aio_t*>(io_uring_cqe_get_data(cqe));
+    paio[n]->rval = cqe->res;
+    io_uring_cqe_seen(&ring, cqe);
+    ++n;
+  }
+  return n;
+}
+
+#endif // HAVE_LIBURING
+
 #endif
@@ -6,6 +6,10 @@
 #include "acconfig.h"
 #ifdef HAVE_LIBAIO
 # include <libaio.h>
+#ifdef HAVE_LIBURING
+# include <liburing.h>
+# include <mutex>
+#endif
 
 #include <boost/intrusive/list.hpp>
 #include <boost/container/small_vector.hpp>
@@ -55,6 +59,12 @@ typedef boost::intrusive::list<
 struct aio_queue_t {
   int max_iodepth;
   io_context_t ctx;
+#ifdef HAVE_LIBURING
+  bool use_uring = false;
+  struct io_uring ring;
+  int ring_fd = -1;     ///< fd registered as fixed file 0, or -1
+  std::mutex sq_lock;   ///< the sq is single producer; serialize submitters
+#endif
 
   typedef list<aio_t>::iterator aio_iter;
 
@@ -77,7 +87,18 @@ struct aio_queue_t {
     }
     return r;
   }
+#ifdef HAVE_LIBURING
+  /// set up an io_uring instead of a libaio context; fd is registered
+  int init_uring(int fd, bool sqpoll, bool hipri);
+#endif
   void shutdown() {
+#ifdef HAVE_LIBURING
+    if (use_uring) {
+      io_uring_queue_exit(&ring);
+      use_uring = false;
+      ring_fd = -1;
+    }
+#endif
     if (ctx) {
       int r = io_destroy(ctx);
       assert(r == 0);
@@ -89,6 +110,13 @@ struct aio_queue_t {
   int submit_batch(aio_iter begin, aio_iter end, uint16_t aios_size, 
 		   void *priv, int *retries);
   int get_next_completed(int timeout_ms, aio_t **paio, int max);
+
+private:
+#ifdef HAVE_LIBURING
+  int _submit_batch_uring(aio_iter begin, aio_iter end, void *priv,
+			  int *retries);
+  int _get_next_completed_uring(int timeout_ms, aio_t **paio, int max);
+#endif
 };
 
 #endif
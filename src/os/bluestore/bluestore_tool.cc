@@ -72,6 +72,7 @@ int main(int argc, char **argv)
   string path;
   string action;
   bool fsck_deep = false;
+  int fsck_threads = 0;
   po::options_description po_options("Options");
   po_options.add_options()
     ("help,h", "produce help message")
@@ -79,6 +80,8 @@ int main(int argc, char **argv)
     ("out-dir", po::value<string>(&out_dir), "output directory")
     ("dev", po::value<vector<string>>(&devs), "device(s)")
     ("deep", po::value<bool>(&fsck_deep), "deep fsck (read all data)")
+    ("threads", po::value<int>(&fsck_threads),
+     "threads used to check objects (bluestore_fsck_threads)")
     ;
   po::options_description po_positional("Positional options");
   po_positional.add_options()
@@ -166,6 +169,11 @@ int main(int argc, char **argv)
   if (action == "fsck" ||
       action == "fsck-deep") {
     validate_path(cct.get(), path, false);
+    if (fsck_threads > 0) {
+      cct->_conf->set_val_or_die("bluestore_fsck_threads",
+				 stringify(fsck_threads));
+      cct->_conf->apply_changes(NULL);
+    }
     BlueStore bluestore(cct.get(), path);
     int r = bluestore.fsck(fsck_deep);
     if (r < 0) {
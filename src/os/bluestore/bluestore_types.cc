@@ -1126,6 +1126,7 @@ void bluestore_compression_header_t::dump(Formatter *f) const
 {
   f->dump_unsigned("type", type);
   f->dump_unsigned("length", length);
+  f->dump_unsigned("dict_id", dict_id);
 }
 
 void bluestore_compression_header_t::generate_test_instances(
@@ -1134,4 +1135,7 @@ void bluestore_compression_header_t::generate_test_instances(
   o.push_back(new bluestore_compression_header_t);
   o.push_back(new bluestore_compression_header_t(1));
   o.back()->length = 1234;
+  o.push_back(new bluestore_compression_header_t(3));
+  o.back()->length = 567;
+  o.back()->dict_id = 0x1234abcd;
 }
@@ -951,6 +951,7 @@ struct bluestore_onode_t {
 
   enum {
     FLAG_OMAP = 1,
+    FLAG_RECOMPRESSED = 2,  ///< rewritten by recompression, not written since
   };
 
   string get_flags_string() const {
@@ -958,6 +959,11 @@ struct bluestore_onode_t {
     if (flags & FLAG_OMAP) {
       s = "omap";
     }
+    if (flags & FLAG_RECOMPRESSED) {
+      if (s.length())
+	s += '+';
+      s += "recompressed";
+    }
     return s;
   }
 
@@ -1051,15 +1057,19 @@ WRITE_CLASS_DENC(bluestore_deferred_transaction_t)
 struct bluestore_compression_header_t {
   uint8_t type = Compressor::COMP_ALG_NONE;
   uint32_t length = 0;
+  uint32_t dict_id = 0;  ///< compression dictionary used, if nonzero
 
   bluestore_compression_header_t() {}
   bluestore_compression_header_t(uint8_t _type)
     : type(_type) {}
 
   DENC(bluestore_compression_header_t, v, p) {
-    DENC_START(1, 1, p);
+    DENC_START(2, 1, p);
     denc(v.type, p);
     denc(v.length, p);
+    if (struct_v >= 2) {
+      denc(v.dict_id, p);
+    }
     DENC_FINISH(p);
   }
   void dump(Formatter *f) const;
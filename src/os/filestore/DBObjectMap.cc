@@ -57,6 +57,7 @@ static void append_escaped(const string &in, string *out)
 
 int DBObjectMap::check(std::ostream &out, bool repair)
 {
+  flush_batch();
   int errors = 0;
   bool repaired = false;
   map<uint64_t, uint64_t> parent_to_num_children;
@@ -273,7 +274,9 @@ int DBObjectMap::DBObjectMapIteratorImpl::init()
     }
     parent_iter = std::make_shared<DBObjectMapIteratorImpl>(map, parent);
   }
-  key_iter = map->db->get_iterator(map->user_prefix(header));
+  // never steps back, so it can be bounded to this header's keys
+  key_iter = map->db->get_bounded_iterator(map->user_prefix(header),
+					   string(), string());
   assert(key_iter);
   complete_iter = map->db->get_iterator(map->complete_prefix(header));
   assert(complete_iter);
@@ -286,6 +289,7 @@ int DBObjectMap::DBObjectMapIteratorImpl::init()
 ObjectMap::ObjectMapIterator DBObjectMap::get_iterator(
   const ghobject_t &oid)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -505,8 +509,10 @@ int DBObjectMap::set_keys(const ghobject_t &oid,
 			  const map<string, bufferlist> &set,
 			  const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
-  MapHeaderLock hl(this, oid);
+  Batch *b = _get_batch();
+  MapHeaderLock hl(this, oid, b);
+  // only after the lock, which may have to submit the batch
+  KeyValueDB::Transaction t = _get_transaction(b);
   Header header = lookup_create_map_header(hl, oid, t);
   if (!header)
     return -EINVAL;
@@ -515,22 +521,23 @@ int DBObjectMap::set_keys(const ghobject_t &oid,
 
   t->set(user_prefix(header), set);
 
-  return db->submit_transaction(t);
+  return _submit_transaction(b, t);
 }
 
 int DBObjectMap::set_header(const ghobject_t &oid,
 			    const bufferlist &bl,
 			    const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
-  MapHeaderLock hl(this, oid);
+  Batch *b = _get_batch();
+  MapHeaderLock hl(this, oid, b);
+  KeyValueDB::Transaction t = _get_transaction(b);
   Header header = lookup_create_map_header(hl, oid, t);
   if (!header)
     return -EINVAL;
   if (check_spos(oid, header, spos))
     return 0;
   _set_header(header, bl, t);
-  return db->submit_transaction(t);
+  return _submit_transaction(b, t);
 }
 
 void DBObjectMap::_set_header(Header header, const bufferlist &bl,
@@ -544,6 +551,7 @@ void DBObjectMap::_set_header(Header header, const bufferlist &bl,
 int DBObjectMap::get_header(const ghobject_t &oid,
 			    bufferlist *bl)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header) {
@@ -579,8 +587,9 @@ int DBObjectMap::_get_header(Header header,
 int DBObjectMap::clear(const ghobject_t &oid,
 		       const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
-  MapHeaderLock hl(this, oid);
+  Batch *b = _get_batch();
+  MapHeaderLock hl(this, oid, b);
+  KeyValueDB::Transaction t = _get_transaction(b);
   Header header = lookup_map_header(hl, oid);
   if (!header)
     return -ENOENT;
@@ -592,7 +601,7 @@ int DBObjectMap::clear(const ghobject_t &oid,
   int r = _clear(header, t);
   if (r < 0)
     return r;
-  return db->submit_transaction(t);
+  return _submit_transaction(b, t);
 }
 
 int DBObjectMap::_clear(Header header,
@@ -633,19 +642,21 @@ int DBObjectMap::rm_keys(const ghobject_t &oid,
 			 const set<string> &to_clear,
 			 const SequencerPosition *spos)
 {
-  MapHeaderLock hl(this, oid);
+  Batch *b = _get_batch();
+  MapHeaderLock hl(this, oid, b);
   Header header = lookup_map_header(hl, oid);
   if (!header)
     return -ENOENT;
-  KeyValueDB::Transaction t = db->get_transaction();
+  KeyValueDB::Transaction t = _get_transaction(b);
   if (check_spos(oid, header, spos))
     return 0;
   t->rmkeys(user_prefix(header), to_clear);
   if (!header->parent) {
-    return db->submit_transaction(t);
+    return _submit_transaction(b, t);
   }
 
   assert(state.v < 3);
+  assert(!b);
 
   {
     // We only get here for legacy (v2) stores
@@ -678,6 +689,7 @@ int DBObjectMap::rm_keys(const ghobject_t &oid,
 int DBObjectMap::clear_keys_header(const ghobject_t &oid,
 				   const SequencerPosition *spos)
 {
+  flush_batch();
   KeyValueDB::Transaction t = db->get_transaction();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
@@ -716,6 +728,7 @@ int DBObjectMap::get(const ghobject_t &oid,
 		     bufferlist *_header,
 		     map<string, bufferlist> *out)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -733,6 +746,7 @@ int DBObjectMap::get(const ghobject_t &oid,
 int DBObjectMap::get_keys(const ghobject_t &oid,
 			  set<string> *keys)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -772,6 +786,7 @@ int DBObjectMap::get_values(const ghobject_t &oid,
 			    const set<string> &keys,
 			    map<string, bufferlist> *out)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -783,6 +798,7 @@ int DBObjectMap::check_keys(const ghobject_t &oid,
 			    const set<string> &keys,
 			    set<string> *out)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -794,6 +810,7 @@ int DBObjectMap::get_xattrs(const ghobject_t &oid,
 			    const set<string> &to_get,
 			    map<string, bufferlist> *out)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -804,6 +821,7 @@ int DBObjectMap::get_xattrs(const ghobject_t &oid,
 int DBObjectMap::get_all_xattrs(const ghobject_t &oid,
 				set<string> *out)
 {
+  flush_batch();
   MapHeaderLock hl(this, oid);
   Header header = lookup_map_header(hl, oid);
   if (!header)
@@ -820,30 +838,32 @@ int DBObjectMap::set_xattrs(const ghobject_t &oid,
 			    const map<string, bufferlist> &to_set,
 			    const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
-  MapHeaderLock hl(this, oid);
+  Batch *b = _get_batch();
+  MapHeaderLock hl(this, oid, b);
+  KeyValueDB::Transaction t = _get_transaction(b);
   Header header = lookup_create_map_header(hl, oid, t);
   if (!header)
     return -EINVAL;
   if (check_spos(oid, header, spos))
     return 0;
   t->set(xattr_prefix(header), to_set);
-  return db->submit_transaction(t);
+  return _submit_transaction(b, t);
 }
 
 int DBObjectMap::remove_xattrs(const ghobject_t &oid,
 			       const set<string> &to_remove,
 			       const SequencerPosition *spos)
 {
-  KeyValueDB::Transaction t = db->get_transaction();
-  MapHeaderLock hl(this, oid);
+  Batch *b = _get_batch();
+  MapHeaderLock hl(this, oid, b);
+  KeyValueDB::Transaction t = _get_transaction(b);
   Header header = lookup_map_header(hl, oid);
   if (!header)
     return -ENOENT;
   if (check_spos(oid, header, spos))
     return 0;
   t->rmkeys(xattr_prefix(header), to_remove);
-  return db->submit_transaction(t);
+  return _submit_transaction(b, t);
 }
 
 // ONLY USED FOR TESTING
@@ -857,6 +877,7 @@ int DBObjectMap::legacy_clone(const ghobject_t &oid,
   if (oid == target)
     return 0;
 
+  flush_batch();
   MapHeaderLock _l1(this, std::min(oid, target));
   MapHeaderLock _l2(this, std::max(oid, target));
   MapHeaderLock *lsource, *ltarget;
@@ -913,6 +934,7 @@ int DBObjectMap::clone(const ghobject_t &oid,
   if (oid == target)
     return 0;
 
+  flush_batch();
   MapHeaderLock _l1(this, std::min(oid, target));
   MapHeaderLock _l2(this, std::max(oid, target));
   MapHeaderLock *lsource, *ltarget;
@@ -1076,6 +1098,7 @@ int DBObjectMap::init(bool do_upgrade)
 
 int DBObjectMap::sync(const ghobject_t *oid,
 		      const SequencerPosition *spos) {
+  flush_batch();
   KeyValueDB::Transaction t = db->get_transaction();
   if (oid) {
     assert(spos);
@@ -1123,16 +1146,28 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
 {
   assert(l.get_locked() == oid);
 
-  _Header *header = new _Header();
-  {
-    Mutex::Locker l(cache_lock);
-    if (caches.lookup(oid, header)) {
+  // updates still sitting in our batch are not in the kv store yet, and
+  // the cache may have dropped them
+  Batch *b = _get_batch();
+  if (b) {
+    auto p = b->headers.find(oid);
+    if (p != b->headers.end()) {
+      if (!p->second)
+	return Header();
+      _Header *header = new _Header(*p->second);
       assert(!in_use.count(header->seq));
       in_use.insert(header->seq);
       return Header(header, RemoveOnDelete(this));
     }
   }
 
+  _Header *header = new _Header();
+  if (get_cache(oid).lookup(oid, header)) {
+    assert(!in_use.count(header->seq));
+    in_use.insert(header->seq);
+    return Header(header, RemoveOnDelete(this));
+  }
+
   bufferlist out;
   int r = db->get(HOBJECT_TO_SEQ, map_header_key(oid), &out);
   if (r < 0 || out.length()==0) {
@@ -1144,10 +1179,7 @@ DBObjectMap::Header DBObjectMap::_lookup_map_header(
   bufferlist::iterator iter = out.begin();
 
   ret->decode(iter);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, *ret);
-  }
+  get_cache(oid).add(oid, *ret);
 
   assert(!in_use.count(header->seq));
   in_use.insert(header->seq);
@@ -1250,10 +1282,10 @@ void DBObjectMap::remove_map_header(
   set<string> to_remove;
   to_remove.insert(map_header_key(oid));
   t->rmkeys(HOBJECT_TO_SEQ, to_remove);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.clear(oid);
-  }
+  get_cache(oid).clear(oid);
+  Batch *b = _get_batch();
+  if (b && t == b->t)
+    b->headers[oid] = boost::none;
 }
 
 void DBObjectMap::set_map_header(
@@ -1268,10 +1300,10 @@ void DBObjectMap::set_map_header(
   map<string, bufferlist> to_set;
   header.encode(to_set[map_header_key(oid)]);
   t->set(HOBJECT_TO_SEQ, to_set);
-  {
-    Mutex::Locker l(cache_lock);
-    caches.add(oid, header);
-  }
+  get_cache(oid).add(oid, header);
+  Batch *b = _get_batch();
+  if (b && t == b->t)
+    b->headers[oid] = header;
 }
 
 bool DBObjectMap::check_spos(const ghobject_t &oid,
@@ -1297,6 +1329,7 @@ bool DBObjectMap::check_spos(const ghobject_t &oid,
 
 int DBObjectMap::list_objects(vector<ghobject_t> *out)
 {
+  flush_batch();
   KeyValueDB::Iterator iter = db->get_iterator(HOBJECT_TO_SEQ);
   for (iter->seek_to_first(); iter->valid(); iter->next()) {
     bufferlist bl = iter->value();
@@ -1310,6 +1343,7 @@ int DBObjectMap::list_objects(vector<ghobject_t> *out)
 
 int DBObjectMap::list_object_headers(vector<_Header> *out)
 {
+  flush_batch();
   int error = 0;
   KeyValueDB::Iterator iter = db->get_iterator(HOBJECT_TO_SEQ);
   for (iter->seek_to_first(); iter->valid(); iter->next()) {
@@ -1353,6 +1387,7 @@ int DBObjectMap::rename(const ghobject_t &from,
   if (from == to)
     return 0;
 
+  flush_batch();
   MapHeaderLock _l1(this, std::min(from, to));
   MapHeaderLock _l2(this, std::max(from, to));
   MapHeaderLock *lsource, *ltarget;
@@ -1386,3 +1421,89 @@ int DBObjectMap::rename(const ghobject_t &from,
 
   return db->submit_transaction(t);
 }
+
+// ------------------------------------
+// batching
+
+static thread_local DBObjectMap::Batch *omap_batch = nullptr;
+
+DBObjectMap::Batch *DBObjectMap::_get_batch()
+{
+  if (!omap_batch || omap_batch->owner != this)
+    return nullptr;
+  // legacy stores may have parent headers, whose updates read back
+  // from the kv store
+  if (state.v < 3)
+    return nullptr;
+  return omap_batch;
+}
+
+void DBObjectMap::_batch_lock(Batch *b, const ghobject_t &oid)
+{
+  header_lock.Lock();
+  if (b->locked.count(oid)) {
+    header_lock.Unlock();
+    return;
+  }
+  if (map_header_in_use.count(oid) && !b->locked.empty()) {
+    // never wait for another object while holding ours, or two batches
+    // could deadlock; give everything up first
+    header_lock.Unlock();
+    _submit_batch(b);
+    header_lock.Lock();
+  }
+  while (map_header_in_use.count(oid))
+    map_header_cond.Wait(header_lock);
+  map_header_in_use.insert(oid);
+  b->locked.insert(oid);
+  header_lock.Unlock();
+}
+
+void DBObjectMap::_submit_batch(Batch *b)
+{
+  if (b->t) {
+    dout(20) << __func__ << " " << b->locked.size() << " objects" << dendl;
+    int r = db->submit_transaction(b->t);
+    if (r < 0 && !b->r)
+      b->r = r;
+    b->t.reset();
+  }
+  b->headers.clear();
+  if (!b->locked.empty()) {
+    Mutex::Locker l(header_lock);
+    for (auto &oid : b->locked) {
+      assert(map_header_in_use.count(oid));
+      map_header_in_use.erase(oid);
+    }
+    map_header_cond.SignalAll();
+    b->locked.clear();
+  }
+}
+
+void DBObjectMap::flush_batch()
+{
+  if (omap_batch && omap_batch->owner == this)
+    _submit_batch(omap_batch);
+}
+
+void DBObjectMap::begin_batch()
+{
+  if (omap_batch) {
+    assert(omap_batch->owner == this);
+    ++omap_batch->depth;
+    return;
+  }
+  omap_batch = new Batch(this);
+}
+
+int DBObjectMap::end_batch()
+{
+  assert(omap_batch && omap_batch->owner == this);
+  if (--omap_batch->depth)
+    return 0;
+  _submit_batch(omap_batch);
+  int r = omap_batch->r;
+  delete omap_batch;
+  omap_batch = nullptr;
+  return r;
+}
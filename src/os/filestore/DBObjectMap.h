@@ -72,13 +72,19 @@ public:
   set<uint64_t> in_use;
   set<ghobject_t> map_header_in_use;
 
+  struct Batch;
+
   /**
    * Takes the map_header_in_use entry in constructor, releases in
    * destructor
+   *
+   * When taken on behalf of an open batch, the entry is instead held by
+   * the batch until it is submitted.
    */
   class MapHeaderLock {
     DBObjectMap *db;
     boost::optional<ghobject_t> locked;
+    Batch *batch = nullptr;
 
     MapHeaderLock(const MapHeaderLock &);
     MapHeaderLock &operator=(const MapHeaderLock &);
@@ -90,6 +96,17 @@ public:
 	db->map_header_cond.Wait(db->header_lock);
       db->map_header_in_use.insert(*locked);
     }
+    MapHeaderLock(DBObjectMap *db, const ghobject_t &oid, Batch *batch)
+      : db(db), locked(oid), batch(batch) {
+      if (batch) {
+	db->_batch_lock(batch, oid);
+	return;
+      }
+      Mutex::Locker l(db->header_lock);
+      while (db->map_header_in_use.count(*locked))
+	db->map_header_cond.Wait(db->header_lock);
+      db->map_header_in_use.insert(*locked);
+    }
 
     const ghobject_t &get_locked() const {
       assert(locked);
@@ -106,7 +123,7 @@ public:
     }
 
     ~MapHeaderLock() {
-      if (locked) {
+      if (locked && !batch) {
 	Mutex::Locker l(db->header_lock);
 	assert(db->map_header_in_use.count(*locked));
 	db->map_header_cond.Signal();
@@ -116,10 +133,16 @@ public:
   };
 
   DBObjectMap(CephContext* cct, KeyValueDB *db)
-    : ObjectMap(cct), db(db), header_lock("DBOBjectMap"),
-      cache_lock("DBObjectMap::CacheLock"),
-      caches(cct->_conf->filestore_omap_header_cache_size)
-    {}
+    : ObjectMap(cct), db(db), header_lock("DBOBjectMap") {
+    uint64_t shards = cct->_conf->get_val<uint64_t>(
+      "filestore_omap_header_cache_shards");
+    if (shards < 1)
+      shards = 1;
+    size_t shard_size = MAX(1, cct->_conf->filestore_omap_header_cache_size /
+			       (int64_t)shards);
+    for (uint64_t i = 0; i < shards; ++i)
+      caches.emplace_back(new SimpleLRU<ghobject_t, _Header>(shard_size));
+  }
 
   int set_keys(
     const ghobject_t &oid,
@@ -246,6 +269,9 @@ public:
 
   ObjectMapIterator get_iterator(const ghobject_t &oid) override;
 
+  void begin_batch() override;
+  int end_batch() override;
+
   static const string USER_PREFIX;
   static const string XATTR_PREFIX;
   static const string SYS_PREFIX;
@@ -344,6 +370,25 @@ public:
     _Header() : seq(0), parent(0), num_children(1) {}
   };
 
+  /**
+   * Updates made by one thread between begin_batch() and end_batch()
+   *
+   * Only write-only operations on stores without parent headers (v3)
+   * are batched; every other operation submits the batch first.  The
+   * batch keeps the MapHeaderLock of every object it touched, so nobody
+   * else can read a header from the kv store before it lands there.
+   */
+  struct Batch {
+    DBObjectMap *owner;
+    unsigned depth = 1;
+    int r = 0;                          ///< first submit error
+    KeyValueDB::Transaction t;          ///< lazily created
+    set<ghobject_t> locked;
+    /// headers set (or removed, if empty) in t
+    map<ghobject_t, boost::optional<_Header> > headers;
+    explicit Batch(DBObjectMap *owner) : owner(owner) {}
+  };
+
   /// String munging (public for testing)
   static string ghobject_key(const ghobject_t &oid);
   static string ghobject_key_v0(coll_t c, const ghobject_t &oid);
@@ -352,8 +397,34 @@ public:
 private:
   /// Implicit lock on Header->seq
   typedef ceph::shared_ptr<_Header> Header;
-  Mutex cache_lock;
-  SimpleLRU<ghobject_t, _Header> caches;
+
+  /// map header cache, sharded to spread lock contention; each shard
+  /// locks itself
+  vector<std::unique_ptr<SimpleLRU<ghobject_t, _Header> > > caches;
+  SimpleLRU<ghobject_t, _Header> &get_cache(const ghobject_t &oid) {
+    // objects in a pg share the low hash bits, shard on the high ones
+    return *caches[(oid.hobj.get_hash() >> 16) % caches.size()];
+  }
+
+  /// this thread's batch, if it may be used for an update
+  Batch *_get_batch();
+  /// transaction to record an update in: the batch's, or a fresh one
+  KeyValueDB::Transaction _get_transaction(Batch *b) {
+    if (!b)
+      return db->get_transaction();
+    if (!b->t)
+      b->t = db->get_transaction();
+    return b->t;
+  }
+  int _submit_transaction(Batch *b, KeyValueDB::Transaction t) {
+    return b ? 0 : db->submit_transaction(t);
+  }
+  /// take the map header lock for oid into the batch
+  void _batch_lock(Batch *b, const ghobject_t &oid);
+  /// submit the batch's updates and drop its locks, it stays open
+  void _submit_batch(Batch *b);
+  /// submit this thread's batch, if any, ahead of an unbatched operation
+  void flush_batch();
 
   string map_header_key(const ghobject_t &oid);
   string header_key(uint64_t seq);
@@ -2196,6 +2196,7 @@ int FileStore::queue_transactions(Sequencer *posr, vector<Transaction>& tls,
 
     uint64_t op_num = submit_manager.op_submit_start();
     o->op = op_num;
+    apply_manager.op_queued(op_num);
     trace.keyval("opnum", op_num);
 
     if (m_filestore_do_dump)
@@ -2244,6 +2245,7 @@ int FileStore::queue_transactions(Sequencer *posr, vector<Transaction>& tls,
 
     uint64_t op_num = submit_manager.op_submit_start();
     o->op = op_num;
+    apply_manager.op_queued(op_num);
 
     if (m_filestore_do_dump)
       dump_transactions(o->tls, o->op, osr);
@@ -2334,6 +2336,8 @@ int FileStore::_do_transactions(
 {
   int trans_num = 0;
 
+  // land all omap updates of this op in one kv transaction
+  object_map->begin_batch();
   for (vector<Transaction>::iterator p = tls.begin();
        p != tls.end();
        ++p, trans_num++) {
@@ -2341,6 +2345,11 @@ int FileStore::_do_transactions(
     if (handle)
       handle->reset_tp_timeout();
   }
+  int r = object_map->end_batch();
+  if (r < 0) {
+    derr << __FUNC__ << ": omap batch submit error " << cpp_strerror(r) << dendl;
+    assert(0 == "unexpected error submitting omap batch");
+  }
 
   return 0;
 }
@@ -3994,8 +4003,12 @@ void FileStore::sync_entry()
     fin.swap(sync_waiters);
     lock.Unlock();
 
-    op_tp.pause();
-    if (apply_manager.commit_start()) {
+    // only a checkpoint needs applies quiesced; otherwise commit whatever
+    // prefix of ops is already applied and let op_tp keep going.
+    bool quiesce = backend->can_checkpoint();
+    if (quiesce)
+      op_tp.pause();
+    if (apply_manager.commit_start(quiesce)) {
       utime_t start = ceph_clock_now();
       uint64_t cp = apply_manager.get_committing_seq();
 
@@ -4049,7 +4062,6 @@ void FileStore::sync_entry()
 	}
       } else {
 	apply_manager.commit_started();
-	op_tp.unpause();
 
 	int err = object_map->sync();
 	if (err < 0) {
@@ -4116,7 +4128,7 @@ void FileStore::sync_entry()
 	Mutex::Locker lock(sync_entry_timeo_lock);
 	timer.cancel_event(sync_entry_timeo);
       }
-    } else {
+    } else if (quiesce) {
       op_tp.unpause();
     }
 
@@ -120,6 +120,14 @@ int JournalingObjectStore::journal_replay(uint64_t fs_op_seq)
 
 // ------------------------------------
 
+void JournalingObjectStore::ApplyManager::op_queued(uint64_t op)
+{
+  Mutex::Locker l(apply_lock);
+  dout(10) << "op_queued " << op << dendl;
+  assert(op > committed_seq);
+  pending_ops.insert(op);
+}
+
 uint64_t JournalingObjectStore::ApplyManager::op_apply_start(uint64_t op)
 {
   Mutex::Locker l(apply_lock);
@@ -132,6 +140,8 @@ uint64_t JournalingObjectStore::ApplyManager::op_apply_start(uint64_t op)
   assert(!blocked);
   assert(op > committed_seq);
   open_ops++;
+  // ops applied inline (trailing journal, replay) are not queued first
+  pending_ops.insert(op);
   return op;
 }
 
@@ -143,6 +153,7 @@ void JournalingObjectStore::ApplyManager::op_apply_finish(uint64_t op)
 	   << MAX(op, max_applied_seq) << dendl;
   --open_ops;
   assert(open_ops >= 0);
+  pending_ops.erase(op);
 
   // signal a blocked commit_start
   if (blocked) {
@@ -150,8 +161,8 @@ void JournalingObjectStore::ApplyManager::op_apply_finish(uint64_t op)
   }
 
   // there can be multiple applies in flight; track the max value we
-  // note.  note that we can't _read_ this value and learn anything
-  // meaningful unless/until we've quiesced all in-flight applies.
+  // note.  on its own this says nothing about older ops that may still
+  // be queued, see _get_applied_seq().
   if (op > max_applied_seq)
     max_applied_seq = op;
 }
@@ -186,35 +197,44 @@ void JournalingObjectStore::ApplyManager::add_waiter(uint64_t op, Context *c)
   commit_waiters[op].push_back(c);
 }
 
-bool JournalingObjectStore::ApplyManager::commit_start()
+bool JournalingObjectStore::ApplyManager::commit_start(bool quiesce)
 {
   bool ret = false;
 
   {
     Mutex::Locker l(apply_lock);
     dout(10) << "commit_start max_applied_seq " << max_applied_seq
-	     << ", open_ops " << open_ops << dendl;
-    blocked = true;
-    while (open_ops > 0) {
-      dout(10) << "commit_start waiting for " << open_ops
-	       << " open ops to drain" << dendl;
-      blocked_cond.Wait(apply_lock);
+	     << ", open_ops " << open_ops << ", pending_ops "
+	     << pending_ops.size() << (quiesce ? ", quiescing" : "") << dendl;
+    if (quiesce) {
+      // a checkpoint captures the fs as it is, so nothing may be half
+      // applied when it is taken
+      blocked = true;
+      while (open_ops > 0) {
+	dout(10) << "commit_start waiting for " << open_ops
+		 << " open ops to drain" << dendl;
+	blocked_cond.Wait(apply_lock);
+      }
+      assert(open_ops == 0);
+      dout(10) << "commit_start blocked, all open_ops have completed" << dendl;
     }
-    assert(open_ops == 0);
-    dout(10) << "commit_start blocked, all open_ops have completed" << dendl;
     {
+      // without a checkpoint, ops past the applied seq keep applying while
+      // we sync; replay guards make re-applying them from the journal safe.
+      uint64_t applied_seq = _get_applied_seq();
       Mutex::Locker l(com_lock);
-      if (max_applied_seq == committed_seq) {
+      assert(applied_seq >= committed_seq);
+      if (applied_seq == committed_seq) {
 	dout(10) << "commit_start nothing to do" << dendl;
 	blocked = false;
-	assert(commit_waiters.empty());
+	blocked_cond.Signal();
 	goto out;
       }
 
-      committing_seq = max_applied_seq;
+      committing_seq = applied_seq;
 
       dout(10) << "commit_start committing " << committing_seq
-	       << ", still blocked" << dendl;
+	       << (quiesce ? ", still blocked" : "") << dendl;
     }
   }
   ret = true;
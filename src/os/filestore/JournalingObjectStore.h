@@ -58,6 +58,14 @@ protected:
     Cond blocked_cond;
     int open_ops;
     uint64_t max_applied_seq;
+    set<uint64_t> pending_ops;  ///< queued or applying, not yet applied
+
+    /// highest seq such that it and every op before it have been applied
+    uint64_t _get_applied_seq() const {
+      if (pending_ops.empty())
+	return max_applied_seq;
+      return MIN(max_applied_seq, *pending_ops.begin() - 1);
+    }
 
     Mutex com_lock;
     map<version_t, vector<Context*> > commit_waiters;
@@ -75,14 +83,16 @@ protected:
     void reset() {
       assert(open_ops == 0);
       assert(blocked == false);
+      assert(pending_ops.empty());
       max_applied_seq = 0;
       committing_seq = 0;
       committed_seq = 0;
     }
     void add_waiter(uint64_t, Context*);
+    void op_queued(uint64_t op);
     uint64_t op_apply_start(uint64_t op);
     void op_apply_finish(uint64_t op);
-    bool commit_start();
+    bool commit_start(bool quiesce);
     void commit_started();
     void commit_finish();
     bool is_committing() {
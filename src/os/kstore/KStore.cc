@@ -662,6 +662,12 @@ void KStore::_init_logger()
   b.add_time_avg(l_kstore_state_kv_done_lat, "state_kv_done_lat", "Average kv_done state latency");
   b.add_time_avg(l_kstore_state_finishing_lat, "state_finishing_lat", "Average finishing state latency");
   b.add_time_avg(l_kstore_state_done_lat, "state_done_lat", "Average done state latency");
+  b.add_u64_counter(l_kstore_stripe_cache_hit, "stripe_cache_hit",
+		    "Stripe reads served from the onode stripe cache");
+  b.add_u64_counter(l_kstore_stripe_cache_miss, "stripe_cache_miss",
+		    "Stripe reads from the kv store");
+  b.add_u64_counter(l_kstore_stripe_write_coalesced, "stripe_write_coalesced",
+		    "Stripe updates folded into an earlier update in the same transaction");
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -1227,8 +1233,6 @@ int KStore::_do_read(
     goto out;
   }
 
-  o->flush();
-
   stripe_off = offset % stripe_size;
   while (length > 0) {
     bufferlist stripe;
@@ -1988,6 +1992,12 @@ void KStore::_txc_finalize(OpSequencer *osr, TransContext *txc)
     std::lock_guard<std::mutex> l((*p)->flush_lock);
     (*p)->flush_txns.insert(txc);
   }
+
+  // write out the final version of each stripe
+  for (auto& p : txc->dirty_stripes) {
+    if (p.second.write)
+      txc->t->set(PREFIX_DATA, p.second.key, p.second.bl);
+  }
 }
 
 void KStore::_txc_finish_kv(TransContext *txc)
@@ -2030,10 +2040,22 @@ void KStore::_txc_finish(TransContext *txc)
     (*p)->flush_txns.erase(txc);
     if ((*p)->flush_txns.empty()) {
       (*p)->flush_cond.notify_all();
-      (*p)->clear_pending_stripes();
     }
   }
 
+  // committed stripes are now clean; keep a few of them cached
+  OnodeRef last;
+  for (auto& p : txc->dirty_stripes) {
+    const OnodeRef& o = p.first.first;
+    o->unpin_stripe(p.first.second);
+    if (last && last != o)
+      last->trim_stripes(cct->_conf->kstore_stripe_cache_max);
+    last = o;
+  }
+  if (last)
+    last->trim_stripes(cct->_conf->kstore_stripe_cache_max);
+  txc->dirty_stripes.clear();
+
   // clear out refs
   txc->onodes.clear();
 
@@ -2582,32 +2604,62 @@ void KStore::_dump_onode(OnodeRef o)
 
 void KStore::_do_read_stripe(OnodeRef o, uint64_t offset, bufferlist *pbl)
 {
-  map<uint64_t,bufferlist>::iterator p = o->pending_stripes.find(offset);
-  if (p == o->pending_stripes.end()) {
-    string key;
-    get_data_key(o->onode.nid, offset, &key);
-    db->get(PREFIX_DATA, key, pbl);
-    o->pending_stripes[offset] = *pbl;
-  } else {
-    *pbl = p->second;
+  {
+    std::lock_guard<std::mutex> l(o->stripe_lock);
+    auto p = o->stripes.find(offset);
+    if (p != o->stripes.end()) {
+      *pbl = p->second.bl;
+      logger->inc(l_kstore_stripe_cache_hit);
+      return;
+    }
+  }
+  // anything written since the last commit is in the cache, so the kv
+  // store is current for this stripe
+  string key;
+  get_data_key(o->onode.nid, offset, &key);
+  db->get(PREFIX_DATA, key, pbl);
+  logger->inc(l_kstore_stripe_cache_miss);
+  std::lock_guard<std::mutex> l(o->stripe_lock);
+  if (o->stripes.size() < cct->_conf->kstore_stripe_cache_max) {
+    auto r = o->stripes.insert(make_pair(offset, Onode::Stripe()));
+    if (r.second)
+      r.first->second.bl = *pbl;
   }
 }
 
+KStore::TransContext::DirtyStripe& KStore::_dirty_stripe(
+  TransContext *txc, OnodeRef o, uint64_t offset, const bufferlist& bl)
+{
+  auto r = txc->dirty_stripes.insert(
+    make_pair(make_pair(o, offset), TransContext::DirtyStripe()));
+  {
+    std::lock_guard<std::mutex> l(o->stripe_lock);
+    Onode::Stripe& s = o->stripes[offset];
+    s.bl = bl;
+    if (r.second)
+      ++s.pins;  // until txc commits
+  }
+  if (!r.second)
+    logger->inc(l_kstore_stripe_write_coalesced);
+  auto& d = r.first->second;
+  get_data_key(o->onode.nid, offset, &d.key);
+  return d;
+}
+
 void KStore::_do_write_stripe(TransContext *txc, OnodeRef o,
 			      uint64_t offset, bufferlist& bl)
 {
-  o->pending_stripes[offset] = bl;
-  string key;
-  get_data_key(o->onode.nid, offset, &key);
-  txc->t->set(PREFIX_DATA, key, bl);
+  auto& d = _dirty_stripe(txc, o, offset, bl);
+  d.bl = bl;
+  d.write = true;
 }
 
 void KStore::_do_remove_stripe(TransContext *txc, OnodeRef o, uint64_t offset)
 {
-  o->pending_stripes.erase(offset);
-  string key;
-  get_data_key(o->onode.nid, offset, &key);
-  txc->t->rmkey(PREFIX_DATA, key);
+  auto& d = _dirty_stripe(txc, o, offset, bufferlist());
+  d.bl.clear();
+  d.write = false;
+  txc->t->rmkey(PREFIX_DATA, d.key);
 }
 
 int KStore::_do_write(TransContext *txc,
@@ -45,6 +45,9 @@ enum {
   l_kstore_state_kv_done_lat,
   l_kstore_state_finishing_lat,
   l_kstore_state_done_lat,
+  l_kstore_stripe_cache_hit,
+  l_kstore_stripe_cache_miss,
+  l_kstore_stripe_write_coalesced,
   l_kstore_last
 };
 
@@ -75,7 +78,14 @@ public:
     uint64_t tail_offset;
     bufferlist tail_bl;
 
-    map<uint64_t,bufferlist> pending_stripes;  ///< unwritten stripes
+    /// a cached stripe; an empty bl means the stripe has no data
+    struct Stripe {
+      bufferlist bl;
+      int pins = 0;  ///< uncommitted txcs that wrote or removed it
+    };
+    std::mutex stripe_lock;  ///< protect stripes
+    /// stripes written by uncommitted txcs (pinned) plus a few clean ones
+    map<uint64_t,Stripe> stripes;
 
     Onode(CephContext* cct, const ghobject_t& o, const string& k)
       : cct(cct),
@@ -100,8 +110,27 @@ public:
       tail_offset = 0;
       tail_bl.clear();
     }
-    void clear_pending_stripes() {
-      pending_stripes.clear();
+    void unpin_stripe(uint64_t offset) {
+      std::lock_guard<std::mutex> l(stripe_lock);
+      auto p = stripes.find(offset);
+      assert(p != stripes.end() && p->second.pins > 0);
+      --p->second.pins;
+    }
+    /// drop committed stripes beyond the first max clean ones
+    void trim_stripes(unsigned max) {
+      std::lock_guard<std::mutex> l(stripe_lock);
+      unsigned kept = 0;
+      for (auto p = stripes.begin(); p != stripes.end(); ) {
+	if (p->second.pins == 0 &&
+	    (p->second.bl.length() == 0 || kept >= max)) {
+	  // committed, so the kv store has the same data
+	  p = stripes.erase(p);
+	} else {
+	  if (p->second.pins == 0)
+	    ++kept;
+	  ++p;
+	}
+      }
     }
   };
   typedef boost::intrusive_ptr<Onode> OnodeRef;
@@ -231,6 +260,15 @@ public:
     list<Context*> oncommits;  ///< more commit completions
     list<CollectionRef> removed_collections; ///< colls we removed
 
+    /// a stripe written or removed by this txc
+    struct DirtyStripe {
+      string key;         ///< data key as of the last update
+      bufferlist bl;
+      bool write = false; ///< set at finalize; removes are issued at once
+    };
+    /// each stripe is set once at finalize, however often it was written
+    map<pair<OnodeRef,uint64_t>,DirtyStripe> dirty_stripes;
+
     CollectionRef first_collection;  ///< first referenced collection
     utime_t start;
     explicit TransContext(OpSequencer *o)
@@ -396,6 +434,9 @@ private:
   void _do_write_stripe(TransContext *txc, OnodeRef o,
 			uint64_t offset, bufferlist& bl);
   void _do_remove_stripe(TransContext *txc, OnodeRef o, uint64_t offset);
+  TransContext::DirtyStripe& _dirty_stripe(TransContext *txc, OnodeRef o,
+					   uint64_t offset,
+					   const bufferlist& bl);
 
   int _collection_list(
     Collection *c, const ghobject_t& start, const ghobject_t& end,
@@ -521,9 +521,11 @@ int MemStore::omap_get(
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  std::lock_guard<std::mutex> lock(o->omap_mutex);
-  *header = o->omap_header;
-  *out = o->omap;
+  {
+    std::lock_guard<std::mutex> lock(o->omap_mutex);
+    *header = o->omap_header;
+  }
+  o->omap.copy_to(out);
   return 0;
 }
 
@@ -561,11 +563,11 @@ int MemStore::omap_get_keys(
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  std::lock_guard<std::mutex> lock(o->omap_mutex);
-  for (map<string,bufferlist>::iterator p = o->omap.begin();
-       p != o->omap.end();
-       ++p)
-    keys->insert(p->first);
+  auto hint = keys->end();
+  o->omap.for_each([&](const string &key, const bufferlist&) {
+      hint = keys->insert(hint, key);
+      ++hint;
+    });
   return 0;
 }
 
@@ -584,13 +586,12 @@ int MemStore::omap_get_values(
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  std::lock_guard<std::mutex> lock(o->omap_mutex);
   for (set<string>::const_iterator p = keys.begin();
        p != keys.end();
        ++p) {
-    map<string,bufferlist>::iterator q = o->omap.find(*p);
-    if (q != o->omap.end())
-      out->insert(*q);
+    bufferlist value;
+    if (o->omap.get(*p, &value))
+      out->insert(make_pair(*p, value));
   }
   return 0;
 }
@@ -610,56 +611,56 @@ int MemStore::omap_check_keys(
   ObjectRef o = c->get_object(oid);
   if (!o)
     return -ENOENT;
-  std::lock_guard<std::mutex> lock(o->omap_mutex);
   for (set<string>::const_iterator p = keys.begin();
        p != keys.end();
        ++p) {
-    map<string,bufferlist>::iterator q = o->omap.find(*p);
-    if (q != o->omap.end())
+    if (o->omap.contains(*p))
       out->insert(*p);
   }
   return 0;
 }
 
+// the iterator holds a copy of the current entry and re-seeks past its key
+// on next(), so it stays valid across concurrent omap updates
 class MemStore::OmapIteratorImpl : public ObjectMap::ObjectMapIteratorImpl {
   CollectionRef c;
   ObjectRef o;
-  map<string,bufferlist>::iterator it;
+  bool is_valid;
+  string cur_key;
+  bufferlist cur_value;
 public:
   OmapIteratorImpl(CollectionRef c, ObjectRef o)
-    : c(c), o(o), it(o->omap.begin()) {}
+    : c(c), o(o) {
+    seek_to_first();
+  }
 
   int seek_to_first() override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    it = o->omap.begin();
+    is_valid = o->omap.first(&cur_key, &cur_value);
     return 0;
   }
   int upper_bound(const string &after) override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    it = o->omap.upper_bound(after);
+    is_valid = o->omap.upper_bound(after, &cur_key, &cur_value);
     return 0;
   }
   int lower_bound(const string &to) override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    it = o->omap.lower_bound(to);
+    is_valid = o->omap.lower_bound(to, &cur_key, &cur_value);
     return 0;
   }
   bool valid() override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    return it != o->omap.end();
+    return is_valid;
   }
   int next(bool validate=true) override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    ++it;
+    string prev;
+    prev.swap(cur_key);
+    cur_value.clear();
+    is_valid = o->omap.upper_bound(prev, &cur_key, &cur_value);
     return 0;
   }
   string key() override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    return it->first;
+    return cur_key;
   }
   bufferlist value() override {
-    std::lock_guard<std::mutex>(o->omap_mutex);
-    return it->second;
+    return cur_value;
   }
   int status() override {
     return 0;
@@ -1231,7 +1232,8 @@ int MemStore::_clone(const coll_t& cid, const ghobject_t& oldoid,
   std::lock(ox_lock, nx_lock, oo_lock, no_lock);
 
   no->omap_header = oo->omap_header;
-  no->omap = oo->omap;
+  no->omap.assign(oo->omap);
+  no->omap.reclaim();
   no->xattr = oo->xattr;
   return 0;
 }
@@ -1276,6 +1278,7 @@ int MemStore::_omap_clear(const coll_t& cid, const ghobject_t &oid)
     return -ENOENT;
   std::lock_guard<std::mutex> lock(o->omap_mutex);
   o->omap.clear();
+  o->omap.reclaim();
   o->omap_header.clear();
   return 0;
 }
@@ -1297,9 +1300,12 @@ int MemStore::_omap_setkeys(const coll_t& cid, const ghobject_t &oid,
   ::decode(num, p);
   while (num--) {
     string key;
+    bufferlist value;
     ::decode(key, p);
-    ::decode(o->omap[key], p);
+    ::decode(value, p);
+    o->omap.set(key, std::move(value));
   }
+  o->omap.reclaim();
   return 0;
 }
 
@@ -1323,6 +1329,7 @@ int MemStore::_omap_rmkeys(const coll_t& cid, const ghobject_t &oid,
     ::decode(key, p);
     o->omap.erase(key);
   }
+  o->omap.reclaim();
   return 0;
 }
 
@@ -1339,9 +1346,8 @@ int MemStore::_omap_rmkeyrange(const coll_t& cid, const ghobject_t &oid,
   if (!o)
     return -ENOENT;
   std::lock_guard<std::mutex> lock(o->omap_mutex);
-  map<string,bufferlist>::iterator p = o->omap.lower_bound(first);
-  map<string,bufferlist>::iterator e = o->omap.lower_bound(last);
-  o->omap.erase(p, e);
+  o->omap.erase_range(first, last);
+  o->omap.reclaim();
   return 0;
 }
 
@@ -1584,7 +1590,7 @@ int BufferlistObject::truncate(uint64_t size)
 
 struct MemStore::PageSetObject : public Object {
   PageSet data;
-  uint64_t data_len;
+  std::atomic<uint64_t> data_len;
 #if defined(__GLIBCXX__)
   // use a thread-local vector for the pages returned by PageSet, so we
   // can avoid allocations in read/write()
@@ -1603,14 +1609,16 @@ struct MemStore::PageSetObject : public Object {
 
   void encode(bufferlist& bl) const override {
     ENCODE_START(1, 1, bl);
-    ::encode(data_len, bl);
+    ::encode(data_len.load(), bl);
     data.encode(bl);
     encode_base(bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::iterator& p) override {
     DECODE_START(1, p);
-    ::decode(data_len, p);
+    uint64_t len;
+    ::decode(len, p);
+    data_len = len;
     data.decode(p);
     decode_base(p);
     DECODE_FINISH(p);
@@ -27,16 +27,17 @@
 #include "common/RWLock.h"
 #include "os/ObjectStore.h"
 #include "PageSet.h"
+#include "SkipMap.h"
 #include "include/assert.h"
 
 class MemStore : public ObjectStore {
 public:
   struct Object : public RefCountedObject {
     std::mutex xattr_mutex;
-    std::mutex omap_mutex;
+    std::mutex omap_mutex; ///< serializes omap writers; guards omap_header
     map<string,bufferptr> xattr;
     bufferlist omap_header;
-    map<string,bufferlist> omap;
+    SkipMap<string,bufferlist> omap; ///< lock-free for readers
 
     typedef boost::intrusive_ptr<Object> Ref;
     friend void intrusive_ptr_add_ref(Object *o) { o->get(); }
@@ -56,12 +57,12 @@ public:
     void encode_base(bufferlist& bl) const {
       ::encode(xattr, bl);
       ::encode(omap_header, bl);
-      ::encode(omap, bl);
+      omap.encode(bl);
     }
     void decode_base(bufferlist::iterator& p) {
       ::decode(xattr, p);
       ::decode(omap_header, p);
-      ::decode(omap, p);
+      omap.decode(p);
     }
 
     void dump(Formatter *f) const {
@@ -80,14 +81,12 @@ public:
       f->close_section();
 
       f->open_array_section("omap");
-      for (map<string,bufferlist>::const_iterator p = omap.begin();
-	   p != omap.end();
-	   ++p) {
-	f->open_object_section("pair");
-	f->dump_string("key", p->first);
-	f->dump_int("length", p->second.length());
-	f->close_section();
-      }
+      omap.for_each([f](const string &key, const bufferlist &value) {
+	  f->open_object_section("pair");
+	  f->dump_string("key", key);
+	  f->dump_int("length", value.length());
+	  f->close_section();
+	});
       f->close_section();
     }
   };
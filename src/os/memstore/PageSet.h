@@ -18,18 +18,16 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
-#include <mutex>
 #include <vector>
-#include <boost/intrusive/avl_set.hpp>
 #include <boost/intrusive_ptr.hpp>
 
 #include "include/encoding.h"
-#include "include/Spinlock.h"
+#include "include/intarith.h"
+#include "ReadEpoch.h"
 
 
 struct Page {
   char *const data;
-  boost::intrusive::avl_set_member_hook<> hook;
   uint64_t offset;
 
   // avoid RefCountedObject because it has a virtual destructor
@@ -41,18 +39,6 @@ struct Page {
   friend void intrusive_ptr_add_ref(Page *p) { p->get(); }
   friend void intrusive_ptr_release(Page *p) { p->put(); }
 
-  // key-value comparison functor for avl
-  struct Less {
-    bool operator()(uint64_t offset, const Page &page) const {
-      return offset < page.offset;
-    }
-    bool operator()(const Page &page, uint64_t offset) const {
-      return page.offset < offset;
-    }
-    bool operator()(const Page &lhs, const Page &rhs) const {
-      return lhs.offset < rhs.offset;
-    }
-  };
   void encode(bufferlist &bl, size_t page_size) const {
     bl.append(buffer::copy(data, page_size));
     ::encode(offset, bl);
@@ -84,145 +70,235 @@ struct Page {
   }
 };
 
+/**
+ * PageSet
+ *
+ * Pages are indexed by offset / page_size in a radix tree whose slots are
+ * atomic pointers, so lookups and allocations never take a lock:
+ * allocations publish new nodes and pages with compare-and-swap, and the
+ * tree grows by swapping in a taller root.  Interior nodes are never freed
+ * before the PageSet itself.  The tree holds one reference on each page;
+ * free_pages_after() unlinks pages and drops that reference only after
+ * every concurrent lookup that could still see them has finished, so
+ * readers may safely take their own references.
+ */
 class PageSet {
  public:
   // alloc_range() and get_range() return page refs in a vector
   typedef std::vector<Page::Ref> page_vector;
 
  private:
-  // store pages in a boost intrusive avl_set
-  typedef Page::Less page_cmp;
-  typedef boost::intrusive::member_hook<Page,
-          boost::intrusive::avl_set_member_hook<>,
-          &Page::hook> member_option;
-  typedef boost::intrusive::avl_set<Page,
-          boost::intrusive::compare<page_cmp>, member_option> page_set;
+  static const unsigned node_bits = 6;
+  static const unsigned node_size = 1 << node_bits;
+  static const uint64_t node_mask = node_size - 1;
 
-  typedef typename page_set::iterator iterator;
+  struct Node {
+    const unsigned shift; ///< index bits below this node; 0 for leaves
+    std::atomic<void*> slots[node_size]; ///< child Nodes, or Pages in leaves
 
-  page_set pages;
-  uint64_t page_size;
+    explicit Node(unsigned shift) : shift(shift) {
+      for (auto &s : slots)
+        s.store(nullptr, std::memory_order_relaxed);
+    }
+    ~Node() {
+      for (auto &s : slots) {
+        void *p = s.load(std::memory_order_relaxed);
+        if (!p)
+          continue;
+        if (shift)
+          delete static_cast<Node*>(p);
+        else
+          static_cast<Page*>(p)->put();
+      }
+    }
+    bool covers(uint64_t index) const {
+      return (index >> shift) < node_size;
+    }
+  };
 
-  typedef Spinlock lock_type;
-  lock_type mutex;
+  std::atomic<Node*> root;
+  std::atomic<size_t> npages;
+  uint64_t page_size;
+  unsigned page_shift;
+  mutable ReadEpoch epoch;
+
+  // return the root, growing the tree until it covers the given index
+  Node *grow(uint64_t index) {
+    Node *r = root.load(std::memory_order_acquire);
+    while (!r || !r->covers(index)) {
+      Node *n = new Node(r ? r->shift + node_bits : 0);
+      if (r)
+        n->slots[0].store(r, std::memory_order_relaxed);
+      if (root.compare_exchange_strong(r, n, std::memory_order_acq_rel)) {
+        r = n;
+      } else {
+        n->slots[0].store(nullptr, std::memory_order_relaxed);
+        delete n;
+      }
+    }
+    return r;
+  }
 
-  void free_pages(iterator cur, iterator end) {
-    while (cur != end) {
-      Page *page = &*cur;
-      cur = pages.erase(cur);
-      page->put();
+  // return the leaf slot for the given index, creating interior nodes
+  std::atomic<void*> *get_slot(uint64_t index) {
+    Node *n = grow(index);
+    while (n->shift) {
+      auto &slot = n->slots[(index >> n->shift) & node_mask];
+      void *child = slot.load(std::memory_order_acquire);
+      if (!child) {
+        Node *c = new Node(n->shift - node_bits);
+        if (slot.compare_exchange_strong(child, c, std::memory_order_acq_rel))
+          child = c;
+        else
+          delete c;
+      }
+      n = static_cast<Node*>(child);
     }
+    return &n->slots[index & node_mask];
   }
 
-  int count_pages(uint64_t offset, uint64_t len) const {
-    // count the overlapping pages
-    int count = 0;
-    if (offset % page_size) {
-      count++;
-      size_t rem = page_size - offset % page_size;
-      len = len <= rem ? 0 : len - rem;
+  // call f(slot, page) for every page with index in [first,last], in order
+  template <typename Func>
+  static void visit(Node *n, uint64_t base, uint64_t first, uint64_t last,
+                    Func &&f) {
+    const uint64_t lo = first > base ? (first - base) >> n->shift : 0;
+    const uint64_t hi = std::min(node_mask, (last - base) >> n->shift);
+    for (uint64_t i = lo; i <= hi; i++) {
+      void *p = n->slots[i].load(std::memory_order_acquire);
+      if (!p)
+        continue;
+      if (n->shift)
+        visit(static_cast<Node*>(p), base + (i << n->shift), first, last, f);
+      else
+        f(n->slots[i], static_cast<Page*>(p));
     }
-    count += len / page_size;
-    if (len % page_size)
-      count++;
-    return count;
+  }
+  template <typename Func>
+  void visit(uint64_t first, uint64_t last, Func &&f) const {
+    Node *r = root.load(std::memory_order_acquire);
+    if (r && first <= last)
+      visit(r, 0, first, last, f);
   }
 
  public:
-  explicit PageSet(size_t page_size) : page_size(page_size) {}
+  explicit PageSet(size_t page_size)
+    : root(nullptr), npages(0), page_size(page_size),
+      page_shift(ctz(page_size)) {
+    assert((page_size & (page_size - 1)) == 0);
+  }
   PageSet(PageSet &&rhs)
-    : pages(std::move(rhs.pages)), page_size(rhs.page_size) {}
+    : root(rhs.root.exchange(nullptr)), npages(rhs.npages.exchange(0)),
+      page_size(rhs.page_size), page_shift(rhs.page_shift) {}
   ~PageSet() {
-    free_pages(pages.begin(), pages.end());
+    delete root.load();
   }
 
   // disable copy
   PageSet(const PageSet&) = delete;
   const PageSet& operator=(const PageSet&) = delete;
 
-  bool empty() const { return pages.empty(); }
-  size_t size() const { return pages.size(); }
+  bool empty() const { return npages == 0; }
+  size_t size() const { return npages; }
   size_t get_page_size() const { return page_size; }
 
   // allocate all pages that intersect the range [offset,length)
   void alloc_range(uint64_t offset, uint64_t length, page_vector &range) {
-    // loop in reverse so we can provide hints to avl_set::insert_check()
-    //	and get O(1) insertions after the first
-    uint64_t position = offset + length - 1;
-
-    range.resize(count_pages(offset, length));
-    auto out = range.rbegin();
-
-    std::lock_guard<lock_type> lock(mutex);
-    iterator cur = pages.end();
-    while (length) {
-      const uint64_t page_offset = position & ~(page_size-1);
-
-      typename page_set::insert_commit_data commit;
-      auto insert = pages.insert_check(cur, page_offset, page_cmp(), commit);
-      if (insert.second) {
+    range.clear();
+    if (!length)
+      return;
+    const uint64_t first = offset >> page_shift;
+    const uint64_t last = (offset + length - 1) >> page_shift;
+    range.reserve(last - first + 1);
+
+    ReadEpoch::Guard guard(epoch);
+    for (uint64_t index = first; index <= last; index++) {
+      auto slot = get_slot(index);
+      void *existing = slot->load(std::memory_order_acquire);
+      if (!existing) {
+        const uint64_t page_offset = index << page_shift;
         auto page = Page::create(page_size, page_offset);
-        cur = pages.insert_commit(*page, commit);
 
         // assume that the caller will write to the range [offset,length),
         //  so we only need to zero memory outside of this range
 
         // zero end of page past offset + length
-        if (offset + length < page->offset + page_size)
-          std::fill(page->data + offset + length - page->offset,
+        if (offset + length < page_offset + page_size)
+          std::fill(page->data + offset + length - page_offset,
                     page->data + page_size, 0);
         // zero front of page between page_offset and offset
-        if (offset > page->offset)
-          std::fill(page->data, page->data + offset - page->offset, 0);
-      } else { // exists
-        cur = insert.first;
+        if (offset > page_offset)
+          std::fill(page->data, page->data + offset - page_offset, 0);
+
+        // the tree owns the initial reference from create()
+        if (slot->compare_exchange_strong(existing, page.get(),
+                                          std::memory_order_acq_rel)) {
+          ++npages;
+          range.push_back(std::move(page));
+          continue;
+        }
+        // lost the race; drop the initial reference and use the winner's
+        page->put();
       }
-      // add a reference to output vector
-      out->reset(&*cur);
-      ++out;
-
-      auto c = std::min(length, (position & (page_size-1)) + 1);
-      position -= c;
-      length -= c;
+      range.push_back(static_cast<Page*>(existing));
     }
-    // make sure we sized the vector correctly
-    assert(out == range.rend());
   }
 
   // return all allocated pages that intersect the range [offset,length)
   void get_range(uint64_t offset, uint64_t length, page_vector &range) {
-    auto cur = pages.lower_bound(offset & ~(page_size-1), page_cmp());
-    while (cur != pages.end() && cur->offset < offset + length)
-      range.push_back(&*cur++);
+    if (!length)
+      return;
+    ReadEpoch::Guard guard(epoch);
+    visit(offset >> page_shift, (offset + length - 1) >> page_shift,
+          [&range](std::atomic<void*>&, Page *page) {
+            range.push_back(page);
+          });
   }
 
   void free_pages_after(uint64_t offset) {
-    std::lock_guard<lock_type> lock(mutex);
-    auto cur = pages.lower_bound(offset & ~(page_size-1), page_cmp());
-    if (cur == pages.end())
+    // pages that begin at or after offset
+    const uint64_t first = (offset + page_size - 1) >> page_shift;
+    std::vector<Page*> unlinked;
+    visit(first, UINT64_MAX, [&unlinked](std::atomic<void*> &slot, Page*) {
+        void *p = slot.exchange(nullptr, std::memory_order_acq_rel);
+        if (p)
+          unlinked.push_back(static_cast<Page*>(p));
+      });
+    if (unlinked.empty())
       return;
-    if (cur->offset < offset)
-      cur++;
-    free_pages(cur, pages.end());
+    npages -= unlinked.size();
+    // wait for lookups that may have found these pages to take their refs
+    epoch.synchronize();
+    for (auto page : unlinked)
+      page->put();
   }
 
   void encode(bufferlist &bl) const {
+    std::vector<Page::Ref> pages;
+    {
+      ReadEpoch::Guard guard(epoch);
+      visit(0, UINT64_MAX, [&pages](std::atomic<void*>&, Page *page) {
+          pages.push_back(page);
+        });
+    }
     ::encode(page_size, bl);
     unsigned count = pages.size();
     ::encode(count, bl);
     for (auto p = pages.rbegin(); p != pages.rend(); ++p)
-      p->encode(bl, page_size);
+      (*p)->encode(bl, page_size);
   }
   void decode(bufferlist::iterator &p) {
     assert(empty());
     ::decode(page_size, p);
+    page_shift = ctz(page_size);
     unsigned count;
     ::decode(count, p);
-    auto cur = pages.end();
     for (unsigned i = 0; i < count; i++) {
       auto page = Page::create(page_size);
       page->decode(p, page_size);
-      cur = pages.insert_before(cur, *page);
+      auto slot = get_slot(page->offset >> page_shift);
+      assert(!slot->load());
+      slot->store(page.get(), std::memory_order_release);
+      ++npages;
     }
   }
 };
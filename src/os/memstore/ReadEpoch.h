@@ -0,0 +1,74 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.	See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MEMSTORE_READEPOCH_H
+#define CEPH_MEMSTORE_READEPOCH_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/**
+ * ReadEpoch
+ *
+ * Read-side critical sections for the lock-free MemStore containers.
+ * Readers bracket each traversal with a Guard; a writer that has unlinked
+ * memory calls synchronize() before freeing it, which waits out every
+ * reader that entered before the unlink.  Readers that enter afterwards
+ * can no longer reach the unlinked memory, so they are not waited for.
+ */
+class ReadEpoch {
+  std::atomic<unsigned> epoch;
+  std::atomic<unsigned> readers[2];
+  std::mutex sync_mutex; ///< serializes epoch flips
+
+  unsigned enter() {
+    while (true) {
+      const unsigned e = epoch.load() & 1;
+      ++readers[e];
+      // a writer may have flipped the epoch before we registered; back out
+      // and join the new one so it doesn't wait on us
+      if ((epoch.load() & 1) == e)
+	return e;
+      --readers[e];
+    }
+  }
+  void exit(unsigned e) {
+    --readers[e];
+  }
+
+public:
+  ReadEpoch() : epoch(0) {
+    readers[0] = 0;
+    readers[1] = 0;
+  }
+  ReadEpoch(const ReadEpoch&) = delete;
+  ReadEpoch& operator=(const ReadEpoch&) = delete;
+
+  class Guard {
+    ReadEpoch &re;
+    const unsigned e;
+  public:
+    explicit Guard(ReadEpoch &re) : re(re), e(re.enter()) {}
+    ~Guard() { re.exit(e); }
+  };
+
+  /// wait for readers that may still see memory unlinked before this call
+  void synchronize() {
+    std::lock_guard<std::mutex> l(sync_mutex);
+    const unsigned old = epoch.fetch_add(1) & 1;
+    while (readers[old].load())
+      std::this_thread::yield();
+  }
+};
+
+#endif // CEPH_MEMSTORE_READEPOCH_H
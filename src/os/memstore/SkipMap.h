@@ -0,0 +1,277 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.	See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MEMSTORE_SKIPMAP_H
+#define CEPH_MEMSTORE_SKIPMAP_H
+
+#include <atomic>
+#include <map>
+#include <new>
+#include <vector>
+
+#include "include/encoding.h"
+#include "ReadEpoch.h"
+
+/**
+ * SkipMap
+ *
+ * An ordered map for one writer and any number of lock-free readers.
+ * Mutations must be serialized by the caller; lookups and scans never
+ * block and return copies of keys and values.  Values are immutable once
+ * published: overwriting a key swaps in a new value.  Unlinked nodes and
+ * replaced values are retired, and freed by reclaim() once no reader can
+ * still reach them, so the writer should call reclaim() at the end of each
+ * update.  A reader may observe an update that is still in progress.
+ */
+template <typename K, typename V>
+class SkipMap {
+  static const int max_height = 16;
+
+  struct Node {
+    const K key;
+    std::atomic<V*> value;
+    const int height;
+
+    Node(const K &key, V *value, int height)
+      : key(key), value(value), height(height) {}
+
+    // the tower of next pointers is allocated right after the node
+    std::atomic<Node*> *next() {
+      return reinterpret_cast<std::atomic<Node*>*>(this + 1);
+    }
+
+    static Node *create(const K &key, V *value, int height) {
+      void *mem = ::operator new(sizeof(Node) +
+				 height * sizeof(std::atomic<Node*>));
+      Node *n = new (mem) Node(key, value, height);
+      for (int i = 0; i < height; i++)
+	new (&n->next()[i]) std::atomic<Node*>(nullptr);
+      return n;
+    }
+    static void destroy(Node *n) {
+      delete n->value.load(std::memory_order_relaxed);
+      n->~Node();
+      ::operator delete(n);
+    }
+  };
+
+  Node *const head;
+  std::atomic<int> height;     ///< levels in use
+  std::atomic<size_t> count;
+  uint64_t rand_state;         ///< writer only
+  std::vector<Node*> retired_nodes;
+  std::vector<V*> retired_values;
+  mutable ReadEpoch epoch;
+
+  int random_height() {
+    // xorshift64; each level is kept with probability 1/4
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    int h = 1;
+    for (uint64_t r = rand_state; h < max_height && (r & 3) == 0; r >>= 2)
+      h++;
+    return h;
+  }
+
+  // first node with key >= k (or > k if strict), from any thread
+  Node *seek(const K &k, bool strict) const {
+    Node *x = head;
+    for (int l = height.load(std::memory_order_acquire) - 1; l >= 0; l--) {
+      while (true) {
+	Node *n = x->next()[l].load(std::memory_order_acquire);
+	if (!n || (strict ? k < n->key : !(n->key < k)))
+	  break;
+	x = n;
+      }
+    }
+    return x->next()[0].load(std::memory_order_acquire);
+  }
+
+  // fill preds with the last node before k at each level; writer only
+  Node *find_preds(const K &k, Node **preds) {
+    Node *x = head;
+    for (int l = max_height - 1; l >= 0; l--) {
+      while (true) {
+	Node *n = x->next()[l].load(std::memory_order_relaxed);
+	if (!n || !(n->key < k))
+	  break;
+	x = n;
+      }
+      preds[l] = x;
+    }
+    return x->next()[0].load(std::memory_order_relaxed);
+  }
+
+  void unlink(Node *n, Node **preds) {
+    for (int l = n->height - 1; l >= 0; l--)
+      preds[l]->next()[l].store(n->next()[l].load(std::memory_order_relaxed),
+				std::memory_order_release);
+    retired_nodes.push_back(n);
+    --count;
+  }
+
+  static bool copy_out(Node *n, K *key, V *value) {
+    if (!n)
+      return false;
+    if (key)
+      *key = n->key;
+    if (value)
+      *value = *n->value.load(std::memory_order_acquire);
+    return true;
+  }
+
+public:
+  SkipMap()
+    : head(Node::create(K(), nullptr, max_height)), height(1), count(0),
+      rand_state(0x9e3779b97f4a7c15ull) {}
+  ~SkipMap() {
+    reclaim();
+    Node *n = head;
+    while (n) {
+      Node *next = n->next()[0].load(std::memory_order_relaxed);
+      Node::destroy(n);
+      n = next;
+    }
+  }
+  SkipMap(const SkipMap&) = delete;
+  SkipMap& operator=(const SkipMap&) = delete;
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  // -- readers --
+
+  bool get(const K &k, V *value) const {
+    ReadEpoch::Guard guard(epoch);
+    Node *n = seek(k, false);
+    if (!n || k < n->key)
+      return false;
+    return copy_out(n, nullptr, value);
+  }
+  bool contains(const K &k) const {
+    return get(k, nullptr);
+  }
+  /// copy out the first entry with key >= k
+  bool lower_bound(const K &k, K *key, V *value) const {
+    ReadEpoch::Guard guard(epoch);
+    return copy_out(seek(k, false), key, value);
+  }
+  /// copy out the first entry with key > k
+  bool upper_bound(const K &k, K *key, V *value) const {
+    ReadEpoch::Guard guard(epoch);
+    return copy_out(seek(k, true), key, value);
+  }
+  bool first(K *key, V *value) const {
+    ReadEpoch::Guard guard(epoch);
+    return copy_out(head->next()[0].load(std::memory_order_acquire),
+		    key, value);
+  }
+  /// call f(key, value) for each entry in order
+  template <typename Func>
+  void for_each(Func &&f) const {
+    ReadEpoch::Guard guard(epoch);
+    for (Node *n = head->next()[0].load(std::memory_order_acquire); n;
+	 n = n->next()[0].load(std::memory_order_acquire))
+      f(n->key, *n->value.load(std::memory_order_acquire));
+  }
+  void copy_to(std::map<K,V> *out) const {
+    auto hint = out->end();
+    for_each([&](const K &k, const V &v) {
+	hint = out->emplace_hint(hint, k, v);
+	++hint;
+      });
+  }
+
+  // -- writer --
+
+  void set(const K &k, V &&value) {
+    Node *preds[max_height];
+    Node *n = find_preds(k, preds);
+    V *v = new V(std::move(value));
+    if (n && !(k < n->key)) {
+      retired_values.push_back(n->value.exchange(v, std::memory_order_acq_rel));
+      return;
+    }
+    const int h = random_height();
+    n = Node::create(k, v, h);
+    for (int l = 0; l < h; l++)
+      n->next()[l].store(preds[l]->next()[l].load(std::memory_order_relaxed),
+			 std::memory_order_relaxed);
+    // link bottom-up so the node is in the full list before the express lanes
+    for (int l = 0; l < h; l++)
+      preds[l]->next()[l].store(n, std::memory_order_release);
+    if (h > height.load(std::memory_order_relaxed))
+      height.store(h, std::memory_order_release);
+    ++count;
+  }
+  void erase(const K &k) {
+    Node *preds[max_height];
+    Node *n = find_preds(k, preds);
+    if (n && !(k < n->key))
+      unlink(n, preds);
+  }
+  /// erase keys in [first, last)
+  void erase_range(const K &first, const K &last) {
+    Node *preds[max_height];
+    Node *n = find_preds(first, preds);
+    while (n && n->key < last) {
+      unlink(n, preds);
+      n = preds[0]->next()[0].load(std::memory_order_relaxed);
+    }
+  }
+  void clear() {
+    Node *n = head->next()[0].load(std::memory_order_relaxed);
+    for (int l = 0; l < max_height; l++)
+      head->next()[l].store(nullptr, std::memory_order_release);
+    for (; n; n = n->next()[0].load(std::memory_order_relaxed))
+      retired_nodes.push_back(n);
+    count = 0;
+  }
+  void assign(const SkipMap &other) {
+    clear();
+    other.for_each([this](const K &k, const V &v) {
+	V copy(v);
+	set(k, std::move(copy));
+      });
+  }
+
+  /// free retired nodes and values once concurrent readers are done
+  void reclaim() {
+    if (retired_nodes.empty() && retired_values.empty())
+      return;
+    epoch.synchronize();
+    for (auto n : retired_nodes)
+      Node::destroy(n);
+    for (auto v : retired_values)
+      delete v;
+    retired_nodes.clear();
+    retired_values.clear();
+  }
+
+  // encoded like a std::map<K,V>
+  void encode(bufferlist &bl) const {
+    std::map<K,V> m;
+    copy_to(&m);
+    ::encode(m, bl);
+  }
+  void decode(bufferlist::iterator &p) {
+    std::map<K,V> m;
+    ::decode(m, p);
+    clear();
+    for (auto &i : m)
+      set(i.first, std::move(i.second));
+    reclaim();
+  }
+};
+
+#endif // CEPH_MEMSTORE_SKIPMAP_H
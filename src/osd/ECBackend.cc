@@ -40,15 +40,14 @@ struct ECRecoveryHandle : public PGBackend::RecoveryHandle {
 };
 
 ostream &operator<<(ostream &lhs, const ECBackend::pipeline_state_t &rhs) {
-  switch (rhs.pipeline_state) {
-  case ECBackend::pipeline_state_t::CACHE_VALID:
+  if (rhs.uncached.empty())
     return lhs << "CACHE_VALID";
-  case ECBackend::pipeline_state_t::CACHE_INVALID:
-    return lhs << "CACHE_INVALID";
-  default:
-    assert(0 == "invalid pipeline state");
-  }
-  return lhs; // unreachable
+  lhs << "CACHE_INVALID(";
+  if (rhs.per_object)
+    lhs << rhs.uncached;
+  else
+    lhs << rhs.uncached.begin()->second;
+  return lhs << ")";
 }
 
 static ostream &operator<<(ostream &lhs, const map<pg_shard_t, bufferlist> &rhs)
@@ -1184,11 +1183,20 @@ void ECBackend::handle_sub_read_reply(
 
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
+  auto sent = rop.sent.find(from);
+  if (sent != rop.sent.end()) {
+    read_latency.add(
+      from.osd,
+      std::chrono::duration<double>(ceph::mono_clock::now() - sent->second).count());
+    rop.sent.erase(sent);
+  }
   unsigned is_complete = 0;
-  // For redundant reads check for completion as each shard comes in,
-  // or in a non-recovery read check for completion once all the shards read.
+  // For redundant or hedged reads check for completion as each shard comes
+  // in, or in a non-recovery read check for completion once all the shards
+  // read.
   // TODO: It would be nice if recovery could send more reads too
-  if (rop.do_redundant_reads || (!rop.for_recovery && rop.in_progress.empty())) {
+  if (rop.do_redundant_reads || rop.hedged ||
+      (!rop.for_recovery && rop.in_progress.empty())) {
     for (map<hobject_t, read_result_t>::const_iterator iter =
         rop.complete.begin();
       iter != rop.complete.end();
@@ -1268,6 +1276,20 @@ void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
       reqiter->second.cb = NULL;
     }
   }
+  // forget about the sub reads still outstanding; their replies will be
+  // dropped in handle_sub_read_reply
+  for (auto &&i : rop.in_progress) {
+    auto siter = shard_to_read_map.find(i);
+    if (siter != shard_to_read_map.end()) {
+      siter->second.erase(rop.tid);
+      if (siter->second.empty())
+	shard_to_read_map.erase(siter);
+    }
+  }
+  if (!rop.in_progress.empty()) {
+    dout(20) << __func__ << " canceled " << rop.in_progress
+	     << " for tid " << rop.tid << dendl;
+  }
   tid_to_read_map.erase(rop.tid);
 }
 
@@ -1400,6 +1422,8 @@ void ECBackend::on_change()
   tid_to_read_map.clear();
   in_progress_client_reads.clear();
   shard_to_read_map.clear();
+  // the acting set may have changed; start over with the new peers
+  read_latency.clear();
   clear_recovery_state();
 }
 
@@ -1556,7 +1580,9 @@ int ECBackend::get_min_avail_to_read_shards(
 
   if (do_redundant_reads) {
       need.swap(have);
-  } 
+  } else if (!for_recovery && cct->_conf->osd_ec_read_latency_aware) {
+    maybe_pick_fast_shards(want, shards, &need);
+  }
 
   if (!to_read)
     return 0;
@@ -1570,6 +1596,105 @@ int ECBackend::get_min_avail_to_read_shards(
   return 0;
 }
 
+void ECBackend::maybe_pick_fast_shards(
+  const set<int> &want,
+  const map<shard_id_t, pg_shard_t> &shards,
+  set<int> *need)
+{
+  if (!read_latency.get_samples())
+    return;
+
+  // shards we have not heard from yet are assumed to be as fast as the
+  // fastest one, so that they get probed
+  double slowest = 0;
+  for (auto i : *need) {
+    auto p = shards.find(shard_id_t(i));
+    assert(p != shards.end());
+    slowest = std::max(slowest, read_latency.get(p->second.osd));
+  }
+  if (slowest == 0)
+    return;
+
+  vector<pair<double, int>> by_lat;
+  for (auto &&p : shards) {
+    by_lat.push_back(make_pair(read_latency.get(p.second.osd),
+			       (int)p.first));
+  }
+  std::sort(by_lat.begin(), by_lat.end());
+
+  // smallest prefix of the fastest shards we can decode want from
+  set<int> avail, alt;
+  double alt_slowest = 0;
+  for (auto &&p : by_lat) {
+    avail.insert(p.second);
+    alt_slowest = p.first;
+    alt.clear();
+    if (avail.size() >= ec_impl->get_data_chunk_count() &&
+	ec_impl->minimum_to_decode(want, avail, &alt) == 0)
+      break;
+  }
+  if (alt.empty() || alt == *need)
+    return;
+
+  // only pay for a decode if it avoids a markedly slower shard
+  if (slowest > alt_slowest * cct->_conf->osd_ec_read_slow_shard_ratio) {
+    dout(10) << __func__ << " reading " << alt << " (slowest "
+	     << alt_slowest << "s) instead of " << *need
+	     << " (slowest " << slowest << "s)" << dendl;
+    need->swap(alt);
+  }
+}
+
+void ECBackend::schedule_read_hedge(ReadOp &rop)
+{
+  double delay = std::max(
+    read_latency.get_quantile(cct->_conf->osd_ec_read_hedge_quantile),
+    cct->_conf->osd_ec_read_hedge_min_delay);
+  dout(20) << __func__ << " tid " << rop.tid << " in " << delay << "s"
+	   << dendl;
+  ceph_tid_t tid = rop.tid;
+  get_parent()->schedule_event_after(
+    delay,
+    new FunctionContext([this, tid](int r) {
+	hedge_read_op(tid);
+      }));
+}
+
+void ECBackend::hedge_read_op(ceph_tid_t tid)
+{
+  auto iter = tid_to_read_map.find(tid);
+  if (iter == tid_to_read_map.end())
+    return;
+  ReadOp &rop = iter->second;
+  if (rop.hedged || rop.in_progress.empty())
+    return;
+
+  // each shard gets at most one sub read per tid, so skip shards this op
+  // already talks to for some other object
+  map<hobject_t, set<pg_shard_t>> extra;
+  for (auto &&i : rop.to_read) {
+    set<int> already_read;
+    for (auto &&j : rop.obj_to_source[i.first])
+      already_read.insert(j.shard);
+    set<pg_shard_t> shards;
+    if (get_remaining_shards(i.first, already_read, &shards) < 0)
+      continue;
+    for (auto &&j : shards) {
+      if (!rop.source_to_obj.count(j))
+	extra[i.first].insert(j);
+    }
+  }
+  if (extra.empty()) {
+    dout(20) << __func__ << " tid " << tid << " no more shards to read"
+	     << dendl;
+    return;
+  }
+  dout(10) << __func__ << " tid " << tid << " still waiting on "
+	   << rop.in_progress << ", also reading " << extra << dendl;
+  rop.hedged = true;
+  do_read_op(rop, &extra);
+}
+
 int ECBackend::get_remaining_shards(
   const hobject_t &hoid,
   const set<int> &avail,
@@ -1629,9 +1754,14 @@ void ECBackend::start_read_op(
     op.trace.event("start ec read");
   }
   do_read_op(op);
+  if (!for_recovery && !do_redundant_reads &&
+      cct->_conf->osd_ec_read_latency_aware) {
+    schedule_read_hedge(op);
+  }
 }
 
-void ECBackend::do_read_op(ReadOp &op)
+void ECBackend::do_read_op(ReadOp &op,
+			   const map<hobject_t, set<pg_shard_t>> *extra)
 {
   int priority = op.priority;
   ceph_tid_t tid = op.tid;
@@ -1642,9 +1772,18 @@ void ECBackend::do_read_op(ReadOp &op)
   for (map<hobject_t, read_request_t>::iterator i = op.to_read.begin();
        i != op.to_read.end();
        ++i) {
+    // with extra, only read the given (additional) shards for each object
+    const set<pg_shard_t> *need = &(i->second.need);
     bool need_attrs = i->second.want_attrs;
-    for (set<pg_shard_t>::const_iterator j = i->second.need.begin();
-	 j != i->second.need.end();
+    if (extra) {
+      auto p = extra->find(i->first);
+      if (p == extra->end() || p->second.empty())
+	continue;
+      need = &(p->second);
+      need_attrs = need_attrs && !op.complete[i->first].attrs;
+    }
+    for (set<pg_shard_t>::const_iterator j = need->begin();
+	 j != need->end();
 	 ++j) {
       if (need_attrs) {
 	messages[*j].attrs_to_read.insert(i->first);
@@ -1659,8 +1798,8 @@ void ECBackend::do_read_op(ReadOp &op)
 	 ++j) {
       pair<uint64_t, uint64_t> chunk_off_len =
 	sinfo.aligned_offset_len_to_chunk(make_pair(j->get<0>(), j->get<1>()));
-      for (set<pg_shard_t>::const_iterator k = i->second.need.begin();
-	   k != i->second.need.end();
+      for (set<pg_shard_t>::const_iterator k = need->begin();
+	   k != need->end();
 	   ++k) {
 	messages[*k].to_read[i->first].push_back(
 	  boost::make_tuple(
@@ -1672,10 +1811,13 @@ void ECBackend::do_read_op(ReadOp &op)
     }
   }
 
+  ceph::mono_time now = ceph::mono_clock::now();
   for (map<pg_shard_t, ECSubRead>::iterator i = messages.begin();
        i != messages.end();
        ++i) {
+    assert(!op.in_progress.count(i->first));
     op.in_progress.insert(i->first);
+    op.sent[i->first] = now;
     shard_to_read_map[i->first].insert(op.tid);
     i->second.tid = tid;
     MOSDECSubOpRead *msg = new MOSDECSubOpRead;
@@ -1785,7 +1927,9 @@ bool ECBackend::try_state_to_reads()
     return false;
 
   Op *op = &(waiting_state.front());
-  if (op->requires_rmw() && pipeline_state.cache_invalid()) {
+  pipeline_state.set_per_object(
+    cct->_conf->osd_ec_rmw_per_object_cache_invalidation);
+  if (op->requires_rmw() && pipeline_state.cache_invalid(*op)) {
     assert(get_parent()->get_pool().allows_ecoverwrites());
     dout(20) << __func__ << ": blocking " << *op
 	     << " because it requires an rmw and the cache is invalid "
@@ -1797,10 +1941,17 @@ bool ECBackend::try_state_to_reads()
   if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
 	     << dendl;
-    pipeline_state.invalidate();
+    op->using_cache = false;
+  } else if (plan_delta_write(op)) {
+    // the cache only holds whole stripes, which this op never sees
+    dout(20) << __func__ << ": parity delta write, invalidating cache"
+	     << " after this op" << dendl;
     op->using_cache = false;
   } else {
-    op->using_cache = pipeline_state.caching_enabled();
+    op->using_cache = pipeline_state.caching_enabled(*op);
+  }
+  if (!op->using_cache) {
+    pipeline_state.invalidate(*op);
   }
 
   waiting_state.pop_front();
@@ -1841,19 +1992,151 @@ bool ECBackend::try_state_to_reads()
 
   if (!op->remote_read.empty()) {
     assert(get_parent()->get_pool().allows_ecoverwrites());
-    objects_read_async_no_cache(
-      op->remote_read,
-      [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
-	for (auto &&i: results) {
-	  op->remote_read_result.emplace(i.first, i.second.second);
-	}
-	check_ops();
-      });
+    if (op->plan.deltas.empty()) {
+      read_for_rmw(op);
+    } else {
+      read_delta_chunks(op);
+    }
+  }
+
+  return true;
+}
+
+void ECBackend::read_for_rmw(Op *op)
+{
+  objects_read_async_no_cache(
+    op->remote_read,
+    [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+      for (auto &&i: results) {
+	op->remote_read_result.emplace(i.first, i.second.second);
+      }
+      check_ops();
+    });
+}
+
+bool ECBackend::plan_delta_write(Op *op)
+{
+  if (!op->requires_rmw() ||
+      !op->plan.t ||
+      !cct->_conf->osd_ec_partial_stripe_delta_writes ||
+      !ec_impl->supports_parity_delta() ||
+      !ec_impl->get_chunk_mapping().empty())
+    return false;
+
+  const hobject_t &hoid = op->plan.to_read.begin()->first;
+  ECTransaction::DeltaWrite delta;
+  if (!ECTransaction::get_delta_write(sinfo, op->plan, hoid, &delta))
+    return false;
+
+  // every old chunk must be read from the shard that holds it
+  set<int> have;
+  for (auto &&i : get_parent()->get_acting_shards()) {
+    if (!get_parent()->get_shard_missing(i).is_missing(hoid))
+      have.insert(i.shard);
   }
+  if (have.size() != ec_impl->get_chunk_count())
+    return false;
 
+  // and must already include every earlier write to the object.  the
+  // extent cache would paper over that for a full stripe read, but not
+  // for the coding chunks
+  for (auto l : { &waiting_reads, &waiting_commit }) {
+    for (auto &&i : *l) {
+      if (i.plan.will_write.count(hoid))
+	return false;
+    }
+  }
+
+  dout(20) << __func__ << ": " << hoid << " data chunks "
+	   << delta.data_chunks << " of stripe " << delta.stripe_off
+	   << dendl;
+  op->plan.deltas[hoid] = std::move(delta);
   return true;
 }
 
+struct DeltaReadCompleter :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ECBackend::Op *op;
+  DeltaReadCompleter(ECBackend *ec, ECBackend::Op *op) : ec(ec), op(op) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ec->handle_delta_read(op, in.second);
+  }
+};
+
+void ECBackend::read_delta_chunks(Op *op)
+{
+  assert(op->plan.deltas.size() == 1);
+  const hobject_t &hoid = op->plan.deltas.begin()->first;
+  const ECTransaction::DeltaWrite &delta = op->plan.deltas.begin()->second;
+
+  set<pg_shard_t> need;
+  for (auto &&i : get_parent()->get_acting_shards()) {
+    if ((unsigned)i.shard >= ec_impl->get_data_chunk_count() ||
+	delta.data_chunks.count(i.shard))
+      need.insert(i);
+  }
+  list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+  to_read.push_back(
+    boost::make_tuple(delta.stripe_off, sinfo.get_stripe_width(), 0));
+  map<hobject_t, read_request_t> for_read_op;
+  for_read_op.insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	to_read,
+	need,
+	false,
+	new DeltaReadCompleter(this, op))));
+
+  // read exactly these shards: like recovery, wait for all of them
+  // rather than decoding from whichever k answer first
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    for_read_op,
+    op->client_op,
+    false, true);
+}
+
+void ECBackend::handle_delta_read(Op *op, read_result_t &res)
+{
+  assert(op->plan.deltas.size() == 1);
+  const hobject_t &hoid = op->plan.deltas.begin()->first;
+  ECTransaction::DeltaWrite &delta = op->plan.deltas.begin()->second;
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+
+  bool ok = res.r == 0 && res.errors.empty() && res.returned.size() == 1;
+  if (ok) {
+    for (auto &&i : res.returned.front().get<2>()) {
+      if (i.second.length() != chunk_size) {
+	ok = false;
+	break;
+      }
+      delta.old_chunks[i.first.shard].claim(i.second);
+    }
+    ok = ok && delta.old_chunks.size() ==
+      delta.data_chunks.size() + ec_impl->get_coding_chunk_count();
+  }
+  if (!ok) {
+    dout(10) << __func__ << ": " << hoid << " r=" << res.r
+	     << " errors " << res.errors
+	     << ", falling back to a full stripe read" << dendl;
+    op->plan.deltas.clear();
+    read_for_rmw(op);
+    return;
+  }
+
+  extent_map old_data;
+  for (auto i : delta.data_chunks) {
+    old_data.insert(
+      delta.stripe_off + i * chunk_size,
+      chunk_size,
+      delta.old_chunks[i]);
+  }
+  op->remote_read_result.emplace(hoid, std::move(old_data));
+  check_ops();
+}
+
 bool ECBackend::try_reads_to_commit()
 {
   if (waiting_reads.empty())
@@ -1930,7 +2213,9 @@ bool ECBackend::try_reads_to_commit()
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  assert(written_set == op->plan.will_write);
+  if (op->plan.deltas.empty()) {
+    assert(written_set == op->plan.will_write);
+  }
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
@@ -2050,6 +2335,11 @@ bool ECBackend::try_finish_rmw()
 
   if (op->using_cache) {
     cache.release_write_pin(op->pin);
+  } else {
+    pipeline_state.release(*op);
+    dout(20) << __func__ << ": pipeline_state now "
+	     << pipeline_state
+	     << dendl;
   }
   tid_to_op_map.erase(op->tid);
 
@@ -2387,7 +2677,7 @@ void ECBackend::be_deep_scrub(
   uint32_t seed,
   ScrubMap::object &o,
   ThreadPool::TPHandle &handle) {
-  bufferhash h(-1); // we always used -1
+  uint32_t digest = -1; // we always used -1
   int r;
   uint64_t stride = cct->_conf->osd_deep_scrub_stride;
   if (stride % sinfo.get_chunk_size())
@@ -2396,27 +2686,17 @@ void ECBackend::be_deep_scrub(
 
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL | CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
 
-  while (true) {
-    bufferlist bl;
-    handle.reset_tp_timeout();
-    r = store->read(
-      ch,
-      ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-      pos,
-      stride, bl,
-      fadvise_flags);
-    if (r < 0)
-      break;
-    if (bl.length() % sinfo.get_chunk_size()) {
-      r = -EIO;
-      break;
-    }
-    pos += r;
-    h << bl;
-    if ((unsigned)r < stride)
-      break;
-  }
+  handle.reset_tp_timeout();
+  // the shard size comes from the same pass as the digest, not from the
+  // earlier stat, so both describe the data that was actually read
+  r = store->data_digest(
+    ch,
+    ghobject_t(
+      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+    stride, -1, &digest, &pos,
+    fadvise_flags);
+  if (r >= 0 && pos % sinfo.get_chunk_size())
+    r = -EIO;
 
   if (r == -EIO) {
     dout(0) << "_scan_list  " << poid << " got "
@@ -2440,7 +2720,7 @@ void ECBackend::be_deep_scrub(
 	return;
       }
 
-      if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != h.digest()) {
+      if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != digest) {
 	dout(0) << "_scan_list  " << poid << " got incorrect hash on read" << dendl;
 	o.ec_hash_mismatch = true;
 	return;
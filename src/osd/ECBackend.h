@@ -390,6 +390,8 @@ public:
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+    map<pg_shard_t, ceph::mono_time> sent;  ///< when each sub read was sent
+    bool hedged = false;  ///< extra shards were read after a timeout
 
     ReadOp(
       int priority,
@@ -423,13 +425,28 @@ public:
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   map<ceph_tid_t, ReadOp> tid_to_read_map;
   map<pg_shard_t, set<ceph_tid_t> > shard_to_read_map;
+
+  /**
+   * With osd_ec_read_latency_aware, client reads go to the shards that
+   * answered fastest so far, and if the read has not completed within
+   * the osd_ec_read_hedge_quantile latency, the remaining shards are
+   * read as well and whichever replies first are decoded.
+   */
+  ECUtil::read_latency_t read_latency;
+  void maybe_pick_fast_shards(
+    const set<int> &want,
+    const map<shard_id_t, pg_shard_t> &shards,
+    set<int> *need);
+  void schedule_read_hedge(ReadOp &rop);
+  void hedge_read_op(ceph_tid_t tid);
   void start_read_op(
     int priority,
     map<hobject_t, read_request_t> &to_read,
     OpRequestRef op,
     bool do_redundant_reads, bool for_recovery);
 
-  void do_read_op(ReadOp &rop);
+  void do_read_op(ReadOp &rop,
+		  const map<hobject_t, set<pg_shard_t>> *extra = nullptr);
   int send_all_remaining_reads(
     const hobject_t &hoid,
     ReadOp &rop);
@@ -522,6 +539,14 @@ public:
    * at waiting_state blocks all writes behind it as well (same for
    * other states).
    *
+   * A write which cannot use the extent cache (invalidates_cache(), or
+   * any write admitted while its objects are uncached) leaves the cache
+   * for the objects it writes stale until it completes.  pipeline_state
+   * counts such in-flight writes per object, and an rmw is only held at
+   * waiting_state while one of its objects has a non-zero count.  With
+   * osd_ec_rmw_per_object_cache_invalidation=false all objects share a
+   * single count, i.e. any uncached write blocks every rmw on the PG.
+   *
    * Future work: We can break this up into a per-object pipeline
    * (almost).  First, provide an ordering token to submit_transaction
    * and require that all operations within a single transaction take
@@ -537,22 +562,41 @@ public:
    * submit the operation.  That's probably going to be the hard part.
    */
   class pipeline_state_t {
-    enum {
-      CACHE_VALID = 0,
-      CACHE_INVALID = 1
-    } pipeline_state = CACHE_VALID;
+    bool per_object = true;
+    map<hobject_t, unsigned> uncached;  ///< in-flight uncached writes
+    const hobject_t &key(const hobject_t &hoid) const {
+      static const hobject_t all;
+      return per_object ? hoid : all;
+    }
   public:
-    bool caching_enabled() const {
-      return pipeline_state == CACHE_VALID;
+    void set_per_object(bool v) {
+      if (uncached.empty())
+	per_object = v;
     }
-    bool cache_invalid() const {
-      return !caching_enabled();
+    bool caching_enabled(const Op &op) const {
+      for (auto &&i : op.plan.will_write) {
+	if (uncached.count(key(i.first)))
+	  return false;
+      }
+      return true;
+    }
+    bool cache_invalid(const Op &op) const {
+      return !caching_enabled(op);
     }
-    void invalidate() {
-      pipeline_state = CACHE_INVALID;
+    void invalidate(const Op &op) {
+      for (auto &&i : op.plan.will_write)
+	++uncached[key(i.first)];
+    }
+    void release(const Op &op) {
+      for (auto &&i : op.plan.will_write) {
+	auto p = uncached.find(key(i.first));
+	assert(p != uncached.end());
+	if (--p->second == 0)
+	  uncached.erase(p);
+      }
     }
     void clear() {
-      pipeline_state = CACHE_VALID;
+      uncached.clear();
     }
     friend ostream &operator<<(ostream &lhs, const pipeline_state_t &rhs);
   } pipeline_state;
@@ -564,6 +608,11 @@ public:
   eversion_t completed_to;
   eversion_t committed_to;
   void start_rmw(Op *op, PGTransactionUPtr &&t);
+  void read_for_rmw(Op *op);
+  /// if op can be a parity delta write, record it in op->plan.deltas
+  bool plan_delta_write(Op *op);
+  void read_delta_chunks(Op *op);
+  void handle_delta_read(Op *op, read_result_t &res);
   bool try_state_to_reads();
   bool try_reads_to_commit();
   bool try_finish_rmw();
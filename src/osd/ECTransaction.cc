@@ -82,6 +82,76 @@ void encode_and_write(
   }
 }
 
+void delta_and_write(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const ECTransaction::DeltaWrite &delta,
+  uint64_t offset,
+  bufferlist bl,
+  uint32_t flags,
+  extent_map &written,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  assert(offset == delta.stripe_off + *delta.data_chunks.begin() * chunk_size);
+  assert(bl.length() == delta.data_chunks.size() * chunk_size);
+
+  auto contiguous = [&](const bufferlist &in) {
+    assert(in.length() == chunk_size);
+    bufferptr p = buffer::create_page_aligned(chunk_size);
+    in.copy(0, chunk_size, p.c_str());
+    return p;
+  };
+
+  map<int, bufferlist> new_chunks;
+  map<int, bufferptr> deltas;
+  unsigned pos = 0;
+  for (auto i : delta.data_chunks) {
+    auto old = delta.old_chunks.find(i);
+    assert(old != delta.old_chunks.end());
+    bufferlist &chunk = new_chunks[i];
+    chunk.substr_of(bl, pos, chunk_size);
+    pos += chunk_size;
+    ecimpl->encode_delta(contiguous(old->second), contiguous(chunk),
+			 &deltas[i]);
+  }
+  map<int, bufferptr> coding;
+  for (unsigned i = ecimpl->get_data_chunk_count();
+       i < ecimpl->get_chunk_count();
+       ++i) {
+    auto old = delta.old_chunks.find(i);
+    assert(old != delta.old_chunks.end());
+    coding[i] = contiguous(old->second);
+  }
+  int r = ecimpl->apply_delta(deltas, coding);
+  assert(r == 0);
+  for (auto &&i : coding) {
+    new_chunks[i.first].append(i.second);
+  }
+
+  written.insert(offset, bl.length(), bl);
+
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " data chunks " << delta.data_chunks
+		     << " of stripe " << delta.stripe_off
+		     << dendl;
+
+  for (auto &&i : *transactions) {
+    auto chunk = new_chunks.find(i.first);
+    if (chunk == new_chunks.end())
+      continue;  // a data chunk this write leaves alone
+    i.second.write(
+      coll_t(spg_t(pgid, i.first)),
+      ghobject_t(oid, ghobject_t::NO_GEN, i.first),
+      sinfo.aligned_logical_offset_to_chunk_offset(delta.stripe_off),
+      chunk_size,
+      chunk->second,
+      flags);
+  }
+}
+
 bool ECTransaction::requires_overwrite(
   uint64_t prev_size,
   const PGTransaction::ObjectOperation &op) {
@@ -95,6 +165,55 @@ bool ECTransaction::requires_overwrite(
       (op.truncate->first < prev_size)));
 }
 
+bool ECTransaction::get_delta_write(
+  const ECUtil::stripe_info_t &sinfo,
+  const WritePlan &plan,
+  const hobject_t &oid,
+  DeltaWrite *delta)
+{
+  assert(plan.t);
+  auto &op_map = plan.t->op_map;
+  if (op_map.size() != 1 || op_map.begin()->first != oid)
+    return false;
+  auto &op = op_map.begin()->second;
+  if (!op.is_none() || op.truncate || op.buffer_updates.empty())
+    return false;
+
+  // a partial overwrite of a single stripe reads and rewrites just it
+  auto riter = plan.to_read.find(oid);
+  auto witer = plan.will_write.find(oid);
+  if (riter == plan.to_read.end() ||
+      witer == plan.will_write.end() ||
+      !(riter->second == witer->second) ||
+      riter->second.num_intervals() != 1 ||
+      riter->second.size() != (int64_t)sinfo.get_stripe_width())
+    return false;
+  uint64_t stripe_off = riter->second.range_start();
+
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  set<int> chunks;
+  for (auto &&extent: op.buffer_updates) {
+    using BufferUpdate = PGTransaction::ObjectOperation::BufferUpdate;
+    if (boost::get<BufferUpdate::CloneRange>(&(extent.get_val())))
+      return false;
+    if (extent.get_off() < stripe_off ||
+	extent.get_off() + extent.get_len() >
+	stripe_off + sinfo.get_stripe_width())
+      return false;
+    uint64_t off = extent.get_off() - stripe_off;
+    uint64_t end = off + extent.get_len();
+    for (uint64_t c = off / chunk_size; c * chunk_size < end; ++c)
+      chunks.insert(c);
+  }
+  if (chunks.size() >= sinfo.get_stripe_width() / chunk_size ||
+      (unsigned)(*chunks.rbegin() - *chunks.begin() + 1) != chunks.size())
+    return false;
+
+  delta->stripe_off = stripe_off;
+  delta->data_chunks.swap(chunks);
+  return true;
+}
+
 void ECTransaction::generate_transactions(
   WritePlan &plan,
   ErasureCodeInterfaceRef &ecimpl,
@@ -545,15 +664,26 @@ void ECTransaction::generate_transactions(
       ldpp_dout(dpp, 20) << __func__ << ": to_overwrite: "
 			 << to_overwrite
 			 << dendl;
+      auto diter = plan.deltas.find(oid);
+      if (diter != plan.deltas.end()) {
+	assert(to_overwrite.ext_count() == 1);
+      }
       for (auto &&extent: to_overwrite) {
 	assert(extent.get_off() + extent.get_len() <= append_after);
-	assert(sinfo.logical_offset_is_stripe_aligned(extent.get_off()));
-	assert(sinfo.logical_offset_is_stripe_aligned(extent.get_len()));
+	uint64_t stripe_off = extent.get_off();
+	uint64_t stripe_len = extent.get_len();
+	if (diter != plan.deltas.end()) {
+	  // a delta write covers part of one stripe; roll back all of it
+	  stripe_off = diter->second.stripe_off;
+	  stripe_len = sinfo.get_stripe_width();
+	}
+	assert(sinfo.logical_offset_is_stripe_aligned(stripe_off));
+	assert(sinfo.logical_offset_is_stripe_aligned(stripe_len));
 	if (entry) {
 	  uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
-	    extent.get_off());
+	    stripe_off);
 	  uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
-	    extent.get_len());
+	    stripe_len);
 	  ldpp_dout(dpp, 20) << __func__ << ": overwriting "
 			     << restore_from << "~" << restore_len
 			     << dendl;
@@ -575,6 +705,21 @@ void ECTransaction::generate_transactions(
 	      restore_from);
 	  }
 	}
+	if (diter != plan.deltas.end()) {
+	  delta_and_write(
+	    pgid,
+	    oid,
+	    sinfo,
+	    ecimpl,
+	    diter->second,
+	    extent.get_off(),
+	    extent.get_val(),
+	    fadvise_flags,
+	    written,
+	    transactions,
+	    dpp);
+	  continue;
+	}
 	encode_and_write(
 	  pgid,
 	  oid,
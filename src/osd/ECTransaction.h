@@ -23,6 +23,13 @@
 #include "ExtentCache.h"
 
 namespace ECTransaction {
+  /// an overwrite within one stripe, applied as a parity delta
+  struct DeltaWrite {
+    uint64_t stripe_off = 0;
+    set<int> data_chunks;             ///< contiguous, fewer than k
+    map<int, bufferlist> old_chunks;  ///< data_chunks and every coding chunk
+  };
+
   struct WritePlan {
     PGTransactionUPtr t;
     bool invalidates_cache = false; // Yes, both are possible
@@ -30,12 +37,28 @@ namespace ECTransaction {
     map<hobject_t,extent_set> will_write; // superset of to_read
 
     map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /// set by the backend if it reads old chunks instead of to_read
+    map<hobject_t,DeltaWrite> deltas;
   };
 
   bool requires_overwrite(
     uint64_t prev_size,
     const PGTransaction::ObjectOperation &op);
 
+  /**
+   * get_delta_write
+   *
+   * Returns true if plan's only change to oid is an overwrite of part
+   * of a single stripe touching fewer than k contiguous data chunks,
+   * and fills in the stripe and chunks (not old_chunks) in *delta.
+   */
+  bool get_delta_write(
+    const ECUtil::stripe_info_t &sinfo,
+    const WritePlan &plan,
+    const hobject_t &oid,
+    DeltaWrite *delta);
+
   template <typename F>
   WritePlan get_write_plan(
     const ECUtil::stripe_info_t &sinfo,
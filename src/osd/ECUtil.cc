@@ -213,3 +213,44 @@ const string &ECUtil::get_hinfo_key()
 {
   return HINFO_KEY;
 }
+
+void ECUtil::read_latency_t::add(int osd, double lat)
+{
+  auto p = osd_lat.find(osd);
+  if (p == osd_lat.end())
+    osd_lat[osd] = lat;
+  else
+    p->second = p->second * (1.0 - alpha) + lat * alpha;
+
+  uint64_t usec = lat > 0 ? (uint64_t)(lat * 1000000.0) : 0;
+  unsigned b = 0;
+  while (usec > 1 && b < NUM_BUCKETS - 1) {
+    usec >>= 1;
+    ++b;
+  }
+  ++hist[b];
+  if (++samples >= max_samples) {
+    samples = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+      hist[i] >>= 1;
+      samples += hist[i];
+    }
+  }
+}
+
+double ECUtil::read_latency_t::get_quantile(double q) const
+{
+  if (!samples)
+    return 0;
+  uint64_t want = (uint64_t)(q * samples);
+  if (want >= samples)
+    want = samples - 1;
+  uint64_t seen = 0;
+  unsigned b = 0;
+  for (; b < NUM_BUCKETS - 1; ++b) {
+    seen += hist[b];
+    if (seen > want)
+      break;
+  }
+  return (double)(1ull << (b + 1)) / 1000000.0;
+}
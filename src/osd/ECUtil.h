@@ -164,6 +164,41 @@ public:
 
 typedef ceph::shared_ptr<HashInfo> HashInfoRef;
 
+/**
+ * Sub read latency seen from each peer osd, plus a log2 histogram of
+ * all of them for quantile estimates.  Latencies are in seconds.  The
+ * histogram is halved every max_samples samples so it follows the
+ * recent past.
+ */
+class read_latency_t {
+  static const unsigned NUM_BUCKETS = 32;  ///< bucket b: [2^b, 2^(b+1)) usec
+  std::map<int, double> osd_lat;           ///< osd -> ewma
+  uint32_t hist[NUM_BUCKETS] = {0};
+  uint32_t samples = 0;
+  double alpha;
+  uint32_t max_samples;
+public:
+  explicit read_latency_t(double alpha = 0.1, uint32_t max_samples = 4096)
+    : alpha(alpha), max_samples(max_samples) {}
+  void add(int osd, double lat);
+  /// ewma for osd, or 0 if we have not heard from it yet
+  double get(int osd) const {
+    auto p = osd_lat.find(osd);
+    return p == osd_lat.end() ? 0 : p->second;
+  }
+  uint32_t get_samples() const {
+    return samples;
+  }
+  /// upper bound of the bucket holding quantile q, or 0 if no samples
+  double get_quantile(double q) const;
+  void clear() {
+    osd_lat.clear();
+    for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+      hist[i] = 0;
+    samples = 0;
+  }
+};
+
 bool is_hinfo_key_string(const std::string &key);
 const std::string &get_hinfo_key();
 
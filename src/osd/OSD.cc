@@ -217,7 +217,10 @@ OSDService::OSDService(OSD *osd) :
   peering_wq(osd->peering_wq),
   recovery_gen_wq("recovery_gen_wq", cct->_conf->osd_recovery_thread_timeout,
 		  &osd->disk_tp),
+  async_read_wq("async_read_wq", cct->_conf->osd_op_thread_timeout,
+		&osd->read_tp),
   class_handler(osd->class_handler),
+  client_io_stats(cct->_conf->osd_client_io_stats_max_entries),
   pg_epoch_lock("OSDService::pg_epoch_lock"),
   publish_lock("OSDService::publish_lock"),
   pre_publish_lock("OSDService::pre_publish_lock"),
@@ -255,9 +258,14 @@ OSDService::OSDService(OSD *osd) :
   snap_sleep_lock("OSDService::snap_sleep_lock"),
   snap_sleep_timer(
     osd->client_messenger->cct, snap_sleep_lock, false /* relax locking */),
+  snap_trim_budget_lock("OSDService::snap_trim_budget_lock"),
   scrub_sleep_lock("OSDService::scrub_sleep_lock"),
   scrub_sleep_timer(
     osd->client_messenger->cct, scrub_sleep_lock, false /* relax locking */),
+  scrub_bw_lock("OSDService::scrub_bw_lock"),
+  pg_event_lock("OSDService::pg_event_lock"),
+  pg_event_timer(
+    osd->client_messenger->cct, pg_event_lock, false /* relax locking */),
   snap_reserver(&reserver_finisher,
 		cct->_conf->osd_max_trimming_pgs),
   recovery_lock("OSDService::recovery_lock"),
@@ -401,6 +409,102 @@ void OSDService::_maybe_split_pgid(OSDMapRef old_map,
   }
 }
 
+void OSDService::_refill_scrub_bw(uint64_t rate)
+{
+  assert(scrub_bw_lock.is_locked());
+  auto now = ceph::mono_clock::now();
+  if (scrub_bw_stamp != ceph::mono_time()) {
+    double elapsed = std::chrono::duration<double>(now - scrub_bw_stamp).count();
+    // allow bursts of up to one second worth of reads
+    scrub_bw_tokens = std::min<double>(scrub_bw_tokens + elapsed * rate, rate);
+  } else {
+    scrub_bw_tokens = rate;
+  }
+  scrub_bw_stamp = now;
+}
+
+void OSDService::charge_scrub_bytes(uint64_t bytes)
+{
+  logger->inc(l_osd_scrub_read_bytes, bytes);
+  uint64_t rate = cct->_conf->get_val<uint64_t>("osd_scrub_bandwidth_limit");
+  if (!rate)
+    return;
+  Mutex::Locker l(scrub_bw_lock);
+  _refill_scrub_bw(rate);
+  scrub_bw_tokens -= bytes;
+}
+
+double OSDService::get_scrub_bw_delay()
+{
+  uint64_t rate = cct->_conf->get_val<uint64_t>("osd_scrub_bandwidth_limit");
+  if (!rate)
+    return 0;
+  Mutex::Locker l(scrub_bw_lock);
+  _refill_scrub_bw(rate);
+  if (scrub_bw_tokens >= 0)
+    return 0;
+  logger->inc(l_osd_scrub_bw_throttle);
+  return -scrub_bw_tokens / rate;
+}
+
+void OSDService::_refill_snap_trim_budget(uint64_t op_rate,
+					  uint64_t byte_rate)
+{
+  assert(snap_trim_budget_lock.is_locked());
+  auto now = ceph::mono_clock::now();
+  if (snap_trim_budget_stamp != ceph::mono_time()) {
+    double elapsed = std::chrono::duration<double>(
+      now - snap_trim_budget_stamp).count();
+    // allow bursts of up to one second worth of trimming
+    snap_trim_op_tokens = std::min<double>(
+      snap_trim_op_tokens + elapsed * op_rate, op_rate);
+    snap_trim_byte_tokens = std::min<double>(
+      snap_trim_byte_tokens + elapsed * byte_rate, byte_rate);
+  } else {
+    snap_trim_op_tokens = op_rate;
+    snap_trim_byte_tokens = byte_rate;
+  }
+  snap_trim_budget_stamp = now;
+}
+
+void OSDService::charge_snap_trim(uint64_t objects, uint64_t bytes)
+{
+  logger->inc(l_osd_snap_trim_objects, objects);
+  logger->inc(l_osd_snap_trim_bytes, bytes);
+  uint64_t op_rate = cct->_conf->get_val<uint64_t>(
+    "osd_snap_trim_max_ops_per_sec");
+  uint64_t byte_rate = cct->_conf->get_val<uint64_t>(
+    "osd_snap_trim_max_bytes_per_sec");
+  if (!op_rate && !byte_rate)
+    return;
+  Mutex::Locker l(snap_trim_budget_lock);
+  _refill_snap_trim_budget(op_rate, byte_rate);
+  if (op_rate)
+    snap_trim_op_tokens -= objects;
+  if (byte_rate)
+    snap_trim_byte_tokens -= bytes;
+}
+
+double OSDService::get_snap_trim_delay()
+{
+  uint64_t op_rate = cct->_conf->get_val<uint64_t>(
+    "osd_snap_trim_max_ops_per_sec");
+  uint64_t byte_rate = cct->_conf->get_val<uint64_t>(
+    "osd_snap_trim_max_bytes_per_sec");
+  if (!op_rate && !byte_rate)
+    return 0;
+  Mutex::Locker l(snap_trim_budget_lock);
+  _refill_snap_trim_budget(op_rate, byte_rate);
+  double delay = 0;
+  if (op_rate && snap_trim_op_tokens < 0)
+    delay = -snap_trim_op_tokens / op_rate;
+  if (byte_rate && snap_trim_byte_tokens < 0)
+    delay = std::max(delay, -snap_trim_byte_tokens / byte_rate);
+  if (delay > 0)
+    logger->inc(l_osd_snap_trim_throttle);
+  return delay;
+}
+
 void OSDService::init_splits_between(spg_t pgid,
 				     OSDMapRef frommap,
 				     OSDMapRef tomap)
@@ -545,6 +649,11 @@ void OSDService::shutdown()
     scrub_sleep_timer.shutdown();
   }
 
+  {
+    Mutex::Locker l(pg_event_lock);
+    pg_event_timer.shutdown();
+  }
+
   osdmap = OSDMapRef();
   next_osdmap = OSDMapRef();
 }
@@ -562,6 +671,7 @@ void OSDService::init()
   agent_timer.init();
   snap_sleep_timer.init();
   scrub_sleep_timer.init();
+  pg_event_timer.init();
 
   agent_thread.create("osd_srv_agent");
 
@@ -743,6 +853,20 @@ void OSDService::promote_throttle_recalibrate()
   // set hard limits for this interval to mitigate stampedes
   promote_max_objects = target_obj_sec * OSD::OSD_TICK_INTERVAL * 2;
   promote_max_bytes = target_bytes_sec * OSD::OSD_TICK_INTERVAL * 2;
+
+  // with a byte target, promotions draw on a budget refilled at that rate
+  // (bursting up to the per-interval limit) instead of the object-count
+  // probability above
+  if (target_bytes_sec) {
+    if (obj)
+      promote_est_bytes = MAX(bytes / obj, 4096ull);
+    int64_t budget = promote_budget_bytes.fetch_add(target_bytes_sec * dur) +
+      target_bytes_sec * dur;
+    if (budget > (int64_t)promote_max_bytes)
+      promote_budget_bytes = promote_max_bytes;
+  }
+  dout(10) << __func__ << "  byte budget " << promote_budget_bytes
+	   << ", est " << pretty_si_t(promote_est_bytes) << "B/promote" << dendl;
 }
 
 // -------------------------------------
@@ -1688,7 +1812,9 @@ void OSDService::queue_for_snap_trim(PG *pg)
       pg->info.pgid,
       PGQueueable(
 	PGSnapTrim(pg->get_osdmap()->get_epoch()),
-	cct->_conf->osd_snap_trim_cost,
+	// the work item trims up to a transaction's worth of clones
+	cct->_conf->osd_snap_trim_cost *
+	  cct->_conf->get_val<uint64_t>("osd_snap_trim_objects_per_txn"),
 	cct->_conf->osd_snap_trim_priority,
 	ceph_clock_now(),
 	entity_inst_t(),
@@ -1881,6 +2007,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   tick_timer(cct, osd_lock),
   tick_timer_lock("OSD::tick_timer_lock"),
   tick_timer_without_osd_lock(cct, tick_timer_lock),
+  peering_msg_lock("OSD::peering_msg_lock"),
+  peering_msg_timer(cct, peering_msg_lock),
   authorize_handler_cluster_registry(new AuthAuthorizeHandlerRegistry(cct,
 								      cct->_conf->auth_supported.empty() ?
 								      cct->_conf->auth_cluster_required :
@@ -1911,6 +2039,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   osd_op_tp(cct, "OSD::osd_op_tp", "tp_osd_tp",
 	    get_num_op_threads()),
   disk_tp(cct, "OSD::disk_tp", "tp_osd_disk", cct->_conf->osd_disk_threads, "osd_disk_threads"),
+  read_tp(cct, "OSD::read_tp", "tp_osd_read", cct->_conf->osd_async_read_threads,
+	  "osd_async_read_threads"),
   command_tp(cct, "OSD::command_tp", "tp_osd_cmd",  1),
   session_waiting_lock("OSD::session_waiting_lock"),
   heartbeat_lock("OSD::heartbeat_lock"),
@@ -1970,6 +2100,7 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_sample_rate(cct->_conf->osd_op_tracker_sample_rate);
 #ifdef WITH_BLKIN
   std::stringstream ss;
   ss << "osd." << whoami;
@@ -2157,6 +2288,11 @@ will start to track new ops received afterwards.";
     f->close_section(); //watchers
   } else if (admin_command == "dump_reservations") {
     f->open_object_section("reservations");
+    if (cct->_conf->osd_recovery_auto_tune) {
+      f->open_object_section("recovery_auto_tune");
+      service.recovery_controller.dump(f);
+      f->close_section();
+    }
     f->open_object_section("local_reservations");
     service.local_reserver.dump(f);
     f->close_section();
@@ -2358,6 +2494,8 @@ int OSD::get_num_op_threads()
 
 float OSD::get_osd_recovery_sleep()
 {
+  if (cct->_conf->osd_recovery_auto_tune)
+    return service.recovery_controller.get_sleep();
   if (cct->_conf->osd_recovery_sleep)
     return cct->_conf->osd_recovery_sleep;
   if (!store_is_rotational && !journal_is_rotational)
@@ -2377,6 +2515,7 @@ int OSD::init()
 
   tick_timer.init();
   tick_timer_without_osd_lock.init();
+  peering_msg_timer.init();
   service.recovery_request_timer.init();
   service.recovery_sleep_timer.init();
 
@@ -2592,6 +2731,12 @@ int OSD::init()
 
       return m;
   });
+  mgrc.set_client_io_cb([this](client_io_report_t *r) {
+      // always swap, so re-enabling starts a fresh period
+      service.client_io_stats.swap_out(
+	r, ceph_clock_now(), cct->_conf->osd_client_io_stats_max_entries);
+      return cct->_conf->osd_client_io_stats;
+  });
 
   mgrc.init();
   client_messenger->add_dispatcher_head(&mgrc);
@@ -2603,9 +2748,12 @@ int OSD::init()
   peering_tp.start();
   osd_op_tp.start();
   disk_tp.start();
+  read_tp.start();
   command_tp.start();
 
   set_disk_tp_priority();
+  if (cct->_conf->osd_recovery_auto_tune)
+    service.reset_recovery_limits();
 
   // start the heartbeat
   heartbeat_thread.create("osd_srv_heartbt");
@@ -2930,6 +3078,8 @@ void OSD::create_logger()
   dout(10) << "create_logger" << dendl;
 
   PerfCountersBuilder osd_plb(cct, "osd", l_osd_first, l_osd_last);
+  // updated by every op worker thread
+  osd_plb.set_sharded(true);
 
   // Latency axis configuration for op histograms, values are in nanoseconds
   PerfHistogramCommon::axis_config_d op_hist_x_axis_config{
@@ -3041,6 +3191,18 @@ void OSD::create_logger()
     "Latency of IO before calling queue(before really queue into ShardedOpWq)"); // client io before queue op_wq latency
   osd_plb.add_time_avg(l_osd_op_before_dequeue_op_lat, "op_before_dequeue_op_lat",
     "Latency of IO before calling dequeue_op(already dequeued and get PG lock)"); // client io before dequeue_op latency
+  osd_plb.add_u64_counter(
+    l_osd_op_inline, "op_inline",
+    "Operations processed on the messenger thread, bypassing the op queue");
+  osd_plb.add_time_avg(
+    l_osd_op_w_local_commit_lat, "op_w_local_commit_latency",
+    "Latency from submitting a replicated write to its local commit");
+  osd_plb.add_time_avg(
+    l_osd_op_w_repop_lat, "op_w_repop_latency",
+    "Latency from submitting a replicated write to each replica's commit reply");
+  osd_plb.add_time_avg(
+    l_osd_op_w_all_commit_lat, "op_w_all_commit_latency",
+    "Latency from submitting a replicated write to its commit on all replicas");
 
   osd_plb.add_u64_counter(
     l_osd_sop, "subop", "Suboperations");
@@ -3184,8 +3346,40 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_peering_notify, "peering_notify_sent", "MOSDPGNotify messages sent");
+  osd_plb.add_u64_counter(
+    l_osd_peering_query, "peering_query_sent", "MOSDPGQuery messages sent");
+  osd_plb.add_u64_counter(
+    l_osd_peering_info, "peering_info_sent", "MOSDPGInfo messages sent");
+  osd_plb.add_u64_counter(
+    l_osd_peering_pgs, "peering_pgs_sent",
+    "PG notifies, queries and infos carried by peering messages");
+  osd_plb.add_u64_counter(
+    l_osd_peering_coalesced, "peering_coalesced",
+    "Peering contexts held back to be merged with later ones");
+
+  osd_plb.add_u64_counter(
+    l_osd_scrub_read_bytes, "scrub_read_bytes",
+    "Object data read by deep scrub");
+  osd_plb.add_u64_counter(
+    l_osd_scrub_bw_throttle, "scrub_bw_throttle",
+    "Scrub chunks delayed by osd_scrub_bandwidth_limit");
+
+  osd_plb.add_u64_counter(
+    l_osd_snap_trim_objects, "snap_trim_objects",
+    "Clones trimmed or updated by the snap trimmer");
+  osd_plb.add_u64_counter(
+    l_osd_snap_trim_bytes, "snap_trim_bytes",
+    "Clone bytes freed by the snap trimmer");
+  osd_plb.add_u64_counter(
+    l_osd_snap_trim_throttle, "snap_trim_throttle",
+    "Snap trim batches delayed by osd_snap_trim_max_{ops,bytes}_per_sec");
+
   logger = osd_plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
+
+  op_shardedwq.create_loggers();
 }
 
 void OSD::create_recoverystate_perf()
@@ -3342,6 +3536,11 @@ int OSD::shutdown()
   command_tp.stop();
   dout(10) << "command tp stopped" << dendl;
 
+  // deferred reads hand their completions to disk_tp
+  read_tp.drain();
+  read_tp.stop();
+  dout(10) << "read tp stopped" << dendl;
+
   disk_tp.drain();
   disk_tp.stop();
   dout(10) << "disk tp paused (new)" << dendl;
@@ -3360,6 +3559,16 @@ int OSD::shutdown()
     tick_timer_without_osd_lock.shutdown();
   }
 
+  {
+    Mutex::Locker l(peering_msg_lock);
+    peering_msg_timer.shutdown();
+    peering_msg_flush = nullptr;
+    pending_notifies.clear();
+    pending_queries.clear();
+    pending_infos.clear();
+    peering_msg_map = OSDMapRef();
+  }
+
   // note unmount epoch
   dout(10) << "noting clean unmount in epoch " << osdmap->get_epoch() << dendl;
   superblock.mounted = service.get_boot_epoch();
@@ -3881,6 +4090,119 @@ PG *OSD::_lookup_lock_pg_with_map_lock_held(spg_t pgid)
   return pg;
 }
 
+struct LoadPGWQ : public ThreadPool::WorkQueueVal<spg_t> {
+  OSD *osd;
+  std::atomic<bool> *has_upgraded;
+  list<spg_t> pgids;
+  LoadPGWQ(OSD *o, std::atomic<bool> *u, ThreadPool *tp)
+    : ThreadPool::WorkQueueVal<spg_t>("OSD::LoadPGWQ", 0, 0, tp),
+      osd(o), has_upgraded(u) {}
+  void _enqueue(spg_t pgid) override {
+    pgids.push_back(pgid);
+  }
+  void _enqueue_front(spg_t pgid) override {
+    pgids.push_front(pgid);
+  }
+  bool _empty() override {
+    return pgids.empty();
+  }
+  spg_t _dequeue() override {
+    spg_t pgid = pgids.front();
+    pgids.pop_front();
+    return pgid;
+  }
+  void _process(spg_t pgid, ThreadPool::TPHandle &) override {
+    osd->_load_pg(pgid, has_upgraded);
+  }
+};
+
+void OSD::_load_pg(spg_t pgid, std::atomic<bool> *has_upgraded)
+{
+  dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
+  bufferlist bl;
+  epoch_t map_epoch = 0;
+  int r = PG::peek_map_epoch(store, pgid, &map_epoch, &bl);
+  if (r < 0) {
+    derr << __func__ << " unable to peek at " << pgid << " metadata, skipping"
+	 << dendl;
+    return;
+  }
+
+  PG *pg = NULL;
+  if (map_epoch > 0) {
+    OSDMapRef pgosdmap = service.try_get_map(map_epoch);
+    if (!pgosdmap) {
+      if (!osdmap->have_pg_pool(pgid.pool())) {
+	derr << __func__ << ": could not find map for epoch " << map_epoch
+	     << " on pg " << pgid << ", but the pool is not present in the "
+	     << "current map, so this is probably a result of bug 10617.  "
+	     << "Skipping the pg for now, you can use ceph-objectstore-tool "
+	     << "to clean it up later." << dendl;
+	return;
+      } else {
+	derr << __func__ << ": have pgid " << pgid << " at epoch "
+	     << map_epoch << ", but missing map.  Crashing."
+	     << dendl;
+	assert(0 == "Missing map in load_pgs");
+      }
+    }
+    pg = _open_lock_pg(pgosdmap, pgid);
+  } else {
+    pg = _open_lock_pg(osdmap, pgid);
+  }
+  // there can be no waiters here, so we don't call wake_pg_waiters
+
+  pg->ch = store->open_collection(pg->coll);
+
+  // read pg state, log
+  pg->read_state(store, bl);
+
+  if (pg->must_upgrade()) {
+    if (!pg->can_upgrade()) {
+      derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
+	   << " an older version first." << dendl;
+      assert(0 == "PG too old to upgrade");
+    }
+    if (!has_upgraded->exchange(true)) {
+      derr << "PGs are upgrading" << dendl;
+    }
+    dout(10) << "PG " << pg->info.pgid
+	     << " must upgrade..." << dendl;
+    pg->upgrade(store);
+  }
+
+  service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
+
+  // generate state for PG's current mapping
+  int primary, up_primary;
+  vector<int> acting, up;
+  pg->get_osdmap()->pg_to_up_acting_osds(
+    pgid.pgid, &up, &up_primary, &acting, &primary);
+  pg->init_primary_up_acting(
+    up,
+    acting,
+    up_primary,
+    primary);
+  int role = OSDMap::calc_pg_role(whoami, pg->acting);
+  if (pg->pool.info.is_replicated() || role == pg->pg_whoami.shard)
+    pg->set_role(role);
+  else
+    pg->set_role(-1);
+
+  pg->reg_next_scrub();
+
+  PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
+  pg->handle_loaded(&rctx);
+
+  dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
+  if (pg->pg_log.is_dirty()) {
+    ObjectStore::Transaction t;
+    pg->write_if_dirty(t);
+    store->apply_transaction(pg->osr.get(), std::move(t));
+  }
+  pg->unlock();
+}
+
 void OSD::load_pgs()
 {
   assert(osd_lock.is_locked());
@@ -3896,8 +4218,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  bool has_upgraded = false;
-
+  vector<spg_t> pgids;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -3920,90 +4241,27 @@ void OSD::load_pgs()
       continue;
     }
 
-    dout(10) << "pgid " << pgid << " coll " << coll_t(pgid) << dendl;
-    bufferlist bl;
-    epoch_t map_epoch = 0;
-    int r = PG::peek_map_epoch(store, pgid, &map_epoch, &bl);
-    if (r < 0) {
-      derr << __func__ << " unable to peek at " << pgid << " metadata, skipping"
-	   << dendl;
-      continue;
-    }
-
-    PG *pg = NULL;
-    if (map_epoch > 0) {
-      OSDMapRef pgosdmap = service.try_get_map(map_epoch);
-      if (!pgosdmap) {
-	if (!osdmap->have_pg_pool(pgid.pool())) {
-	  derr << __func__ << ": could not find map for epoch " << map_epoch
-	       << " on pg " << pgid << ", but the pool is not present in the "
-	       << "current map, so this is probably a result of bug 10617.  "
-	       << "Skipping the pg for now, you can use ceph-objectstore-tool "
-	       << "to clean it up later." << dendl;
-	  continue;
-	} else {
-	  derr << __func__ << ": have pgid " << pgid << " at epoch "
-	       << map_epoch << ", but missing map.  Crashing."
-	       << dendl;
-	  assert(0 == "Missing map in load_pgs");
-	}
-      }
-      pg = _open_lock_pg(pgosdmap, pgid);
-    } else {
-      pg = _open_lock_pg(osdmap, pgid);
-    }
-    // there can be no waiters here, so we don't call wake_pg_waiters
-
-    pg->ch = store->open_collection(pg->coll);
-
-    // read pg state, log
-    pg->read_state(store, bl);
-
-    if (pg->must_upgrade()) {
-      if (!pg->can_upgrade()) {
-	derr << "PG needs upgrade, but on-disk data is too old; upgrade to"
-	     << " an older version first." << dendl;
-	assert(0 == "PG too old to upgrade");
-      }
-      if (!has_upgraded) {
-	derr << "PGs are upgrading" << dendl;
-	has_upgraded = true;
-      }
-      dout(10) << "PG " << pg->info.pgid
-	       << " must upgrade..." << dendl;
-      pg->upgrade(store);
-    }
-
-    service.init_splits_between(pg->info.pgid, pg->get_osdmap(), osdmap);
-
-    // generate state for PG's current mapping
-    int primary, up_primary;
-    vector<int> acting, up;
-    pg->get_osdmap()->pg_to_up_acting_osds(
-      pgid.pgid, &up, &up_primary, &acting, &primary);
-    pg->init_primary_up_acting(
-      up,
-      acting,
-      up_primary,
-      primary);
-    int role = OSDMap::calc_pg_role(whoami, pg->acting);
-    if (pg->pool.info.is_replicated() || role == pg->pg_whoami.shard)
-      pg->set_role(role);
-    else
-      pg->set_role(-1);
-
-    pg->reg_next_scrub();
-
-    PG::RecoveryCtx rctx(0, 0, 0, 0, 0, 0);
-    pg->handle_loaded(&rctx);
-
-    dout(10) << "load_pgs loaded " << *pg << " " << pg->pg_log.get_log() << dendl;
-    if (pg->pg_log.is_dirty()) {
-      ObjectStore::Transaction t;
-      pg->write_if_dirty(t);
-      store->apply_transaction(pg->osr.get(), std::move(t));
-    }
-    pg->unlock();
+    pgids.push_back(pgid);
+  }
+
+  std::atomic<bool> has_upgraded = { false };
+  unsigned num_threads = std::min<uint64_t>(
+    cct->_conf->get_val<uint64_t>("osd_load_pgs_threads"), pgids.size());
+  if (num_threads > 1) {
+    // reading the info, log and missing set of each pg is independent
+    // store i/o; overlap it across a temporary pool
+    dout(10) << __func__ << " loading " << pgids.size() << " pgs with "
+	     << num_threads << " threads" << dendl;
+    ThreadPool tp(cct, "OSD::load_pgs", "tp_osd_load", num_threads);
+    LoadPGWQ wq(this, &has_upgraded, &tp);
+    tp.start();
+    for (auto& pgid : pgids)
+      wq.queue(pgid);
+    wq.drain();
+    tp.stop();
+  } else {
+    for (auto& pgid : pgids)
+      _load_pg(pgid, &has_upgraded);
   }
   {
     RWLock::RLocker l(pg_map_lock);
@@ -4617,6 +4875,46 @@ void OSD::need_heartbeat_peer_update()
   heartbeat_set_peers_need_update();
 }
 
+/*
+ * On dense hosts most pg peers share a handful of remote hosts.  If
+ * osd_heartbeat_max_peers_per_host is set, ping only that many of the
+ * pg peers on each remote host.  Which ones is picked by hashing our
+ * id with theirs, so every osd on a host is still watched by a spread
+ * of peers across the cluster rather than by the same few.
+ */
+void OSD::_limit_heartbeat_peers_per_host(set<int> *peers)
+{
+  int max = cct->_conf->osd_heartbeat_max_peers_per_host;
+  if (max <= 0 || peers->empty())
+    return;
+
+  int my_host = 0;
+  osdmap->crush->get_immediate_parent_id(whoami, &my_host);
+  map<int, vector<pair<uint32_t,int>>> by_host;
+  for (auto p : *peers) {
+    int host = 0;
+    if (osdmap->crush->get_immediate_parent_id(p, &host) < 0 ||
+	host == my_host) {
+      continue;  // always ping local peers and ones we cannot place
+    }
+    by_host[host].push_back(
+      make_pair(crush_hash32_2(CRUSH_HASH_RJENKINS1, whoami, p), p));
+  }
+  unsigned removed = 0;
+  for (auto& h : by_host) {
+    auto& v = h.second;
+    if ((int)v.size() <= max)
+      continue;
+    std::sort(v.begin(), v.end());
+    for (unsigned i = max; i < v.size(); ++i) {
+      peers->erase(v[i].second);
+      ++removed;
+    }
+  }
+  dout(10) << __func__ << " dropped " << removed << " pg peers, "
+	   << peers->size() << " left" << dendl;
+}
+
 void OSD::maybe_update_heartbeat_peers()
 {
   assert(osd_lock.is_locked());
@@ -4648,25 +4946,31 @@ void OSD::maybe_update_heartbeat_peers()
 
   // build heartbeat from set
   if (is_active()) {
-    RWLock::RLocker l(pg_map_lock);
-    for (ceph::unordered_map<spg_t, PG*>::iterator i = pg_map.begin();
-	 i != pg_map.end();
-	 ++i) {
-      PG *pg = i->second;
-      pg->heartbeat_peer_lock.Lock();
-      dout(20) << i->first << " heartbeat_peers " << pg->heartbeat_peers << dendl;
-      for (set<int>::iterator p = pg->heartbeat_peers.begin();
-	   p != pg->heartbeat_peers.end();
-	   ++p)
-	if (osdmap->is_up(*p))
-	  _add_heartbeat_peer(*p);
-      for (set<int>::iterator p = pg->probe_targets.begin();
-	   p != pg->probe_targets.end();
-	   ++p)
-	if (osdmap->is_up(*p))
-	  _add_heartbeat_peer(*p);
-      pg->heartbeat_peer_lock.Unlock();
+    set<int> pg_peers;
+    {
+      RWLock::RLocker l(pg_map_lock);
+      for (ceph::unordered_map<spg_t, PG*>::iterator i = pg_map.begin();
+	   i != pg_map.end();
+	   ++i) {
+	PG *pg = i->second;
+	pg->heartbeat_peer_lock.Lock();
+	dout(20) << i->first << " heartbeat_peers " << pg->heartbeat_peers << dendl;
+	for (set<int>::iterator p = pg->heartbeat_peers.begin();
+	     p != pg->heartbeat_peers.end();
+	     ++p)
+	  if (osdmap->is_up(*p))
+	    pg_peers.insert(*p);
+	for (set<int>::iterator p = pg->probe_targets.begin();
+	     p != pg->probe_targets.end();
+	     ++p)
+	  if (osdmap->is_up(*p))
+	    pg_peers.insert(*p);
+	pg->heartbeat_peer_lock.Unlock();
+      }
     }
+    _limit_heartbeat_peers_per_host(&pg_peers);
+    for (auto p : pg_peers)
+      _add_heartbeat_peer(p);
   }
 
   // include next and previous up osds to ensure we have a fully-connected set
@@ -5110,6 +5414,8 @@ void OSD::tick_without_osd_lock()
   logger->set(l_osd_cached_crc_adjusted, buffer::get_cached_crc_adjusted());
   logger->set(l_osd_missed_crc, buffer::get_missed_crc());
 
+  service.tune_recovery_limits();
+
   // osd_lock is not being held, which means the OSD state
   // might change when doing the monitor report
   if (is_active() || is_waiting_for_healthy()) {
@@ -6953,11 +7259,13 @@ void OSD::ms_fast_dispatch(Message *m)
 
   if (m->get_connection()->has_features(CEPH_FEATUREMASK_RESEND_ON_SPLIT) ||
       m->get_type() != CEPH_MSG_OSD_OP) {
-    // queue it directly
-    enqueue_op(
-      static_cast<MOSDFastDispatchOp*>(m)->get_spg(),
-      op,
-      static_cast<MOSDFastDispatchOp*>(m)->get_map_epoch());
+    spg_t pgid = static_cast<MOSDFastDispatchOp*>(m)->get_spg();
+    epoch_t epoch = static_cast<MOSDFastDispatchOp*>(m)->get_map_epoch();
+    if (!cct->_conf->osd_op_inline_dispatch ||
+	!dispatch_op_inline(pgid, op, epoch)) {
+      // queue it directly
+      enqueue_op(pgid, op, epoch);
+    }
   } else {
     // legacy client, and this is an MOSDOp (the *only* fast dispatch
     // message that didn't have an explicit spg_t); we need to map
@@ -7669,10 +7977,17 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-        bool got = get_map_bl(e - 1, obl);
-        assert(got);
-	o->decode(obl);
+	// start from the cached previous map if we have it; decoding a
+	// full map is expensive on large clusters
+	OSDMapRef prev = service.try_get_map(e - 1);
+	if (prev) {
+	  o->deepish_copy_from(*prev);
+	} else {
+	  bufferlist obl;
+	  bool got = get_map_bl(e - 1, obl);
+	  assert(got);
+	  o->decode(obl);
+	}
       }
 
       OSDMap::Incremental inc;
@@ -8611,9 +8926,15 @@ void OSD::dispatch_context(PG::RecoveryCtx &ctx, PG *pg, OSDMapRef curmap,
 {
   if (service.get_osdmap()->is_up(whoami) &&
       is_active()) {
-    do_notifies(*ctx.notify_list, curmap);
-    do_queries(*ctx.query_map, curmap);
-    do_infos(*ctx.info_map, curmap);
+    double interval = cct->_conf->get_val<double>(
+      "osd_peering_msg_coalesce_interval");
+    if (interval > 0) {
+      queue_peering_msgs(ctx, curmap, interval);
+    } else {
+      do_notifies(*ctx.notify_list, curmap);
+      do_queries(*ctx.query_map, curmap);
+      do_infos(*ctx.info_map, curmap);
+    }
   }
   delete ctx.notify_list;
   delete ctx.query_map;
@@ -8670,6 +8991,8 @@ void OSD::do_notifies(
     MOSDPGNotify *m = new MOSDPGNotify(curmap->get_epoch(),
 				       it->second);
     con->send_message(m);
+    logger->inc(l_osd_peering_notify);
+    logger->inc(l_osd_peering_pgs, it->second.size());
   }
 }
 
@@ -8699,6 +9022,8 @@ void OSD::do_queries(map<int, map<spg_t,pg_query_t> >& query_map,
 	    << " on " << pit->second.size() << " PGs" << dendl;
     MOSDPGQuery *m = new MOSDPGQuery(curmap->get_epoch(), pit->second);
     con->send_message(m);
+    logger->inc(l_osd_peering_query);
+    logger->inc(l_osd_peering_pgs, pit->second.size());
   }
 }
 
@@ -8733,10 +9058,85 @@ void OSD::do_infos(map<int,
     MOSDPGInfo *m = new MOSDPGInfo(curmap->get_epoch());
     m->pg_list = p->second;
     con->send_message(m);
+    logger->inc(l_osd_peering_info);
+    logger->inc(l_osd_peering_pgs, p->second.size());
   }
   info_map.clear();
 }
 
+/** queue_peering_msgs
+ * Merge the notifies, queries and infos of a RecoveryCtx into the
+ * pending per-peer batches instead of sending them right away.  The
+ * batches go out when the flush timer fires, when a context for a
+ * different epoch comes along, or when a pg is queried twice.
+ */
+void OSD::queue_peering_msgs(PG::RecoveryCtx &ctx, OSDMapRef curmap,
+			     double interval)
+{
+  Mutex::Locker l(peering_msg_lock);
+  if (peering_msg_map &&
+      peering_msg_map->get_epoch() != curmap->get_epoch()) {
+    // messages carry the epoch they were generated in
+    _flush_peering_msgs();
+  }
+  // only one query per pg fits in a message
+  bool requeried = false;
+  for (auto p = ctx.query_map->begin();
+       p != ctx.query_map->end() && !requeried;
+       ++p) {
+    auto q = pending_queries.find(p->first);
+    if (q == pending_queries.end())
+      continue;
+    for (auto& i : p->second) {
+      if (q->second.count(i.first)) {
+	requeried = true;
+	break;
+      }
+    }
+  }
+  if (requeried)
+    _flush_peering_msgs();
+  peering_msg_map = curmap;
+  for (auto& p : *ctx.notify_list) {
+    auto& v = pending_notifies[p.first];
+    v.insert(v.end(), p.second.begin(), p.second.end());
+  }
+  for (auto& p : *ctx.query_map) {
+    pending_queries[p.first].insert(p.second.begin(), p.second.end());
+  }
+  for (auto& p : *ctx.info_map) {
+    auto& v = pending_infos[p.first];
+    v.insert(v.end(), p.second.begin(), p.second.end());
+  }
+  logger->inc(l_osd_peering_coalesced);
+  if (!peering_msg_flush) {
+    peering_msg_flush = new FunctionContext([this](int r) {
+	assert(peering_msg_lock.is_locked());
+	peering_msg_flush = nullptr;
+	_flush_peering_msgs();
+      });
+    peering_msg_timer.add_event_after(interval, peering_msg_flush);
+  }
+}
+
+void OSD::_flush_peering_msgs()
+{
+  assert(peering_msg_lock.is_locked());
+  if (!peering_msg_map)
+    return;
+  dout(20) << __func__ << " epoch " << peering_msg_map->get_epoch()
+	   << " notify " << pending_notifies.size()
+	   << " query " << pending_queries.size()
+	   << " info " << pending_infos.size() << " peers" << dendl;
+  do_notifies(pending_notifies, peering_msg_map);
+  do_queries(pending_queries, peering_msg_map);
+  do_infos(pending_infos, peering_msg_map);
+  pending_notifies.clear();
+  pending_queries.clear();
+  pending_infos.clear();
+  peering_msg_map = OSDMapRef();
+}
+
 
 /** PGNotify
  * from non-primary to primary
@@ -9260,7 +9660,7 @@ bool OSDService::_recover_now(uint64_t *available_pushes)
     return false;
   }
 
-  uint64_t max = cct->_conf->osd_recovery_max_active;
+  uint64_t max = get_recovery_max_active();
   if (max <= recovery_ops_active + recovery_ops_reserved) {
     dout(15) << __func__ << " active " << recovery_ops_active
 	     << " + reserved " << recovery_ops_reserved
@@ -9275,6 +9675,53 @@ bool OSDService::_recover_now(uint64_t *available_pushes)
 }
 
 
+RecoveryController::Params OSDService::get_recovery_tune_params() const
+{
+  RecoveryController::Params p;
+  p.target_p99_ms = cct->_conf->osd_recovery_auto_tune_target_p99_ms;
+  p.max_active = cct->_conf->osd_recovery_auto_tune_max_active;
+  p.max_backfills = cct->_conf->osd_recovery_auto_tune_max_backfills;
+  p.max_sleep = cct->_conf->osd_recovery_auto_tune_max_sleep;
+  return p;
+}
+
+void OSDService::reset_recovery_limits()
+{
+  unsigned backfills;
+  {
+    Mutex::Locker l(recovery_lock);
+    if (cct->_conf->osd_recovery_auto_tune) {
+      recovery_controller.reset(get_recovery_tune_params());
+      backfills = recovery_controller.get_max_backfills();
+    } else {
+      backfills = cct->_conf->osd_max_backfills;
+    }
+    _maybe_queue_recovery();
+  }
+  local_reserver.set_max(backfills);
+  remote_reserver.set_max(backfills);
+}
+
+void OSDService::tune_recovery_limits()
+{
+  if (!cct->_conf->osd_recovery_auto_tune)
+    return;
+  unsigned backfills;
+  {
+    Mutex::Locker l(recovery_lock);
+    if (!recovery_controller.update(get_recovery_tune_params()))
+      return;
+    backfills = recovery_controller.get_max_backfills();
+    dout(10) << __func__ << " recovery max_active "
+	     << recovery_controller.get_max_active()
+	     << " max_backfills " << backfills
+	     << " sleep " << recovery_controller.get_sleep() << dendl;
+    _maybe_queue_recovery();
+  }
+  local_reserver.set_max(backfills);
+  remote_reserver.set_max(backfills);
+}
+
 void OSDService::adjust_pg_priorities(const vector<PGRef>& pgs, int newflags)
 {
   if (!pgs.size() || !(newflags & (OFR_BACKFILL | OFR_RECOVERY)))
@@ -9437,7 +9884,7 @@ void OSDService::start_recovery_op(PG *pg, const hobject_t& soid)
   Mutex::Locker l(recovery_lock);
   dout(10) << "start_recovery_op " << *pg << " " << soid
 	   << " (" << recovery_ops_active << "/"
-	   << cct->_conf->osd_recovery_max_active << " rops)"
+	   << get_recovery_max_active() << " rops)"
 	   << dendl;
   recovery_ops_active++;
 
@@ -9453,7 +9900,7 @@ void OSDService::finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue)
   Mutex::Locker l(recovery_lock);
   dout(10) << "finish_recovery_op " << *pg << " " << soid
 	   << " dequeue=" << dequeue
-	   << " (" << recovery_ops_active << "/" << cct->_conf->osd_recovery_max_active << " rops)"
+	   << " (" << recovery_ops_active << "/" << get_recovery_max_active() << " rops)"
 	   << dendl;
 
   // adjust count
@@ -9505,6 +9952,16 @@ void OSD::enqueue_op(spg_t pg, OpRequestRef& op, epoch_t epoch)
 }
 
 
+bool OSD::dispatch_op_inline(spg_t pg, OpRequestRef& op, epoch_t epoch)
+{
+  pair<spg_t, PGQueueable> item(pg, PGQueueable(op, epoch));
+  if (!op_shardedwq.try_process_inline(item)) {
+    return false;
+  }
+  dout(15) << "dispatch_op_inline " << op << dendl;
+  logger->inc(l_osd_op_inline);
+  return true;
+}
 
 /*
  * NOTE: dequeue called in worker thread, with pg lock
@@ -9635,6 +10092,7 @@ const char** OSD::get_tracked_conf_keys() const
 {
   static const char* KEYS[] = {
     "osd_max_backfills",
+    "osd_recovery_auto_tune",
     "osd_min_recovery_priority",
     "osd_max_trimming_pgs",
     "osd_op_complaint_time",
@@ -9644,6 +10102,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_slow_op_size",
     "osd_op_history_slow_op_threshold",
     "osd_enable_op_tracker",
+    "osd_op_tracker_sample_rate",
     "osd_map_cache_size",
     "osd_map_max_advance",
     "osd_pg_epoch_persisted_max_stale",
@@ -9673,7 +10132,10 @@ const char** OSD::get_tracked_conf_keys() const
 void OSD::handle_conf_change(const struct md_config_t *conf,
 			     const std::set <std::string> &changed)
 {
-  if (changed.count("osd_max_backfills")) {
+  if (changed.count("osd_recovery_auto_tune")) {
+    service.reset_recovery_limits();
+  } else if (changed.count("osd_max_backfills") &&
+	     !cct->_conf->osd_recovery_auto_tune) {
     service.local_reserver.set_max(cct->_conf->osd_max_backfills);
     service.remote_reserver.set_max(cct->_conf->osd_max_backfills);
   }
@@ -9702,6 +10164,9 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
+  if (changed.count("osd_op_tracker_sample_rate")) {
+    op_tracker.set_sample_rate(cct->_conf->osd_op_tracker_sample_rate);
+  }
   if (changed.count("osd_disk_thread_ioprio_class") ||
       changed.count("osd_disk_thread_ioprio_priority")) {
     set_disk_tp_priority();
@@ -10034,6 +10499,26 @@ void OSD::PeeringWQ::_dequeue(list<PG*> *out) {
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq "
 
+void OSD::ShardedOpWQ::create_loggers()
+{
+  for (uint32_t i = 0; i < num_shards; i++) {
+    ShardData *sdata = shard_list[i];
+    assert(!sdata->logger);
+    char name[32] = {0};
+    snprintf(name, sizeof(name), "osd_op_shard-%d", i);
+    PerfCountersBuilder plb(osd->cct, name, l_osd_shard_first,
+			    l_osd_shard_last);
+    plb.add_time_avg(l_osd_shard_enqueue_lat, "enqueue_lat",
+		     "Time to enqueue an item in this shard");
+    plb.add_time_avg(l_osd_shard_dequeue_lat, "dequeue_lat",
+		     "Time from taking the shard lock to dequeuing an item");
+    plb.add_u64_counter(l_osd_shard_drained, "lockless_drained",
+			"Items moved from the lock-free enqueue list");
+    sdata->logger = plb.create_perf_counters();
+    osd->cct->get_perfcounters_collection()->add(sdata->logger);
+  }
+}
+
 void OSD::ShardedOpWQ::wake_pg_waiters(spg_t pgid)
 {
   uint32_t shard_index = pgid.hash_to_shard(shard_list.size());
@@ -10148,7 +10633,9 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   assert(NULL != sdata);
 
   // peek at spg_t
+  auto start = ceph::mono_clock::now();
   sdata->sdata_op_ordering_lock.Lock();
+  sdata->_drain_incoming(osd->op_prio_cutoff);
   if (sdata->pqueue->empty()) {
     dout(20) << __func__ << " empty q, waiting" << dendl;
     // optimistically sleep a moment; maybe another work item will come along.
@@ -10156,16 +10643,27 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
       osd->cct->_conf->threadpool_default_timeout, 0);
     sdata->sdata_lock.Lock();
     sdata->sdata_op_ordering_lock.Unlock();
-    sdata->sdata_cond.WaitInterval(sdata->sdata_lock,
-      utime_t(osd->cct->_conf->threadpool_empty_queue_max_wait, 0));
+    // lockless enqueuers only signal if they see us waiting
+    ++sdata->waiters;
+    if (sdata->incoming.empty()) {
+      sdata->sdata_cond.WaitInterval(sdata->sdata_lock,
+	utime_t(osd->cct->_conf->threadpool_empty_queue_max_wait, 0));
+    }
+    --sdata->waiters;
     sdata->sdata_lock.Unlock();
+    start = ceph::mono_clock::now();
     sdata->sdata_op_ordering_lock.Lock();
+    sdata->_drain_incoming(osd->op_prio_cutoff);
     if (sdata->pqueue->empty()) {
       sdata->sdata_op_ordering_lock.Unlock();
       return;
     }
   }
   pair<spg_t, PGQueueable> item = sdata->pqueue->dequeue();
+  if (sdata->logger) {
+    sdata->logger->tinc(l_osd_shard_dequeue_lat,
+			ceph::mono_clock::now() - start);
+  }
   if (osd->is_stopping()) {
     sdata->sdata_op_ordering_lock.Unlock();
     return;    // OSD shutdown, discard.
@@ -10345,19 +10843,32 @@ void OSD::ShardedOpWQ::_enqueue(pair<spg_t, PGQueueable> item) {
 
   ShardData* sdata = shard_list[shard_index];
   assert (NULL != sdata);
-  unsigned priority = item.second.get_priority();
-  unsigned cost = item.second.get_cost();
-  sdata->sdata_op_ordering_lock.Lock();
-
+  auto start = ceph::mono_clock::now();
   dout(20) << __func__ << " " << item.first << " " << item.second << dendl;
-  if (priority >= osd->op_prio_cutoff)
-    sdata->pqueue->enqueue_strict(
-      item.second.get_owner(), priority, item);
-  else
-    sdata->pqueue->enqueue(
-      item.second.get_owner(),
-      priority, cost, item);
+
+  if (lockless_enqueue) {
+    // the shard's _process threads move this into pqueue, in order,
+    // the next time they take the ordering lock
+    sdata->incoming.push(std::move(item));
+    if (sdata->logger) {
+      sdata->logger->tinc(l_osd_shard_enqueue_lat,
+			  ceph::mono_clock::now() - start);
+    }
+    if (sdata->waiters) {
+      sdata->sdata_lock.Lock();
+      sdata->sdata_cond.SignalOne();
+      sdata->sdata_lock.Unlock();
+    }
+    return;
+  }
+
+  sdata->sdata_op_ordering_lock.Lock();
+  sdata->_enqueue(item, osd->op_prio_cutoff);
   sdata->sdata_op_ordering_lock.Unlock();
+  if (sdata->logger) {
+    sdata->logger->tinc(l_osd_shard_enqueue_lat,
+			ceph::mono_clock::now() - start);
+  }
 
   sdata->sdata_lock.Lock();
   sdata->sdata_cond.SignalOne();
@@ -10365,6 +10876,60 @@ void OSD::ShardedOpWQ::_enqueue(pair<spg_t, PGQueueable> item) {
 
 }
 
+bool OSD::ShardedOpWQ::try_process_inline(pair<spg_t, PGQueueable>& item)
+{
+  uint32_t shard_index = item.first.hash_to_shard(shard_list.size());
+  ShardData* sdata = shard_list[shard_index];
+  assert (NULL != sdata);
+  PGRef pg;
+  {
+    Mutex::Locker l(sdata->sdata_op_ordering_lock);
+    // only when nothing at all is queued on this shard can we be sure
+    // that no earlier item for this pg is waiting behind us.
+    if (sdata->inline_running || !sdata->pqueue->empty() ||
+	!sdata->incoming.empty() || osd->is_stopping()) {
+      return false;
+    }
+    auto p = sdata->pg_slots.find(item.first);
+    if (p == sdata->pg_slots.end()) {
+      return false;
+    }
+    auto& slot = p->second;
+    if (!slot.pg || slot.waiting_for_pg || slot.num_running ||
+	!slot.to_process.empty()) {
+      return false;
+    }
+    // never block a messenger thread on the pg lock
+    if (!slot.pg->try_lock()) {
+      return false;
+    }
+    pg = slot.pg;
+    sdata->inline_running = true;
+    if (!sdata->inline_hb) {
+      char name[32] = {0};
+      snprintf(name, sizeof(name), "%s.%d", "OSD::ShardedOpWQ::inline",
+	       shard_index);
+      sdata->inline_hb = osd->cct->get_heartbeat_map()->add_worker(
+	name, pthread_self());
+    } else {
+      sdata->inline_hb->thread_id = pthread_self();
+    }
+  }
+
+  dout(20) << __func__ << " " << item.first << " item " << item.second
+	   << " pg " << pg << dendl;
+  ThreadPool::TPHandle tp_handle(osd->cct, sdata->inline_hb, timeout_interval,
+				 suicide_interval);
+  tp_handle.reset_tp_timeout();
+  item.second.run(osd, pg, tp_handle);
+  pg->unlock();
+  osd->cct->get_heartbeat_map()->clear_timeout(sdata->inline_hb);
+
+  Mutex::Locker l(sdata->sdata_op_ordering_lock);
+  sdata->inline_running = false;
+  return true;
+}
+
 void OSD::ShardedOpWQ::_enqueue_front(pair<spg_t, PGQueueable> item)
 {
   uint32_t shard_index = item.first.hash_to_shard(shard_list.size());
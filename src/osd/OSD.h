@@ -27,6 +27,7 @@
 #include "common/ceph_context.h"
 #include "common/zipkin_trace.h"
 
+#include "mgr/ClientIOStats.h"
 #include "mgr/MgrClient.h"
 
 #include "os/ObjectStore.h"
@@ -41,6 +42,7 @@
 #include "Session.h"
 
 #include "osd/PGQueueable.h"
+#include "osd/RecoveryController.h"
 
 #include <atomic>
 #include <map>
@@ -55,6 +57,7 @@ using namespace std;
 #include "common/sharedptr_registry.hpp"
 #include "common/WeightedPriorityQueue.h"
 #include "common/PrioritizedQueue.h"
+#include "common/MPSCQueue.h"
 #include "osd/mClockOpClassQueue.h"
 #include "osd/mClockClientQueue.h"
 #include "messages/MOSDOp.h"
@@ -96,6 +99,10 @@ enum {
 
   l_osd_op_before_queue_op_lat,
   l_osd_op_before_dequeue_op_lat,
+  l_osd_op_inline,
+  l_osd_op_w_local_commit_lat,
+  l_osd_op_w_repop_lat,
+  l_osd_op_w_all_commit_lat,
 
   l_osd_sop,
   l_osd_sop_inb,
@@ -177,6 +184,19 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_peering_notify,
+  l_osd_peering_query,
+  l_osd_peering_info,
+  l_osd_peering_pgs,
+  l_osd_peering_coalesced,
+
+  l_osd_scrub_read_bytes,
+  l_osd_scrub_bw_throttle,
+
+  l_osd_snap_trim_objects,
+  l_osd_snap_trim_bytes,
+  l_osd_snap_trim_throttle,
+
   l_osd_last,
 };
 
@@ -217,6 +237,15 @@ enum {
   rs_last,
 };
 
+// per-shard ShardedOpWQ perf counters
+enum {
+  l_osd_shard_first = 20100,
+  l_osd_shard_enqueue_lat,
+  l_osd_shard_dequeue_lat,
+  l_osd_shard_drained,
+  l_osd_shard_last,
+};
+
 class Messenger;
 class Message;
 class MonClient;
@@ -235,6 +264,7 @@ class AuthAuthorizeHandlerRegistry;
 class TestOpsSocketHook;
 struct C_CompleteSplits;
 struct C_OpenPGs;
+struct LoadPGWQ;
 class LogChannel;
 class CephContext;
 typedef ceph::shared_ptr<ObjectStore::Sequencer> SequencerRef;
@@ -365,8 +395,12 @@ public:
   MonClient   *&monc;
   ThreadPool::BatchWorkQueue<PG> &peering_wq;
   GenContextWQ recovery_gen_wq;
+  GenContextWQ async_read_wq;
   ClassHandler  *&class_handler;
 
+  // per-client op stats for the mgr; fed only if osd_client_io_stats
+  ClientIOCollector client_io_stats;
+
   void enqueue_back(spg_t pgid, PGQueueable qi);
   void enqueue_front(spg_t pgid, PGQueueable qi);
 
@@ -778,11 +812,22 @@ private:
   PromoteCounter promote_counter;
   utime_t last_recalibrate;
   unsigned long promote_max_objects, promote_max_bytes;
+  /// byte budget, refilled each tick at osd_tier_promote_max_bytes_sec
+  std::atomic<int64_t> promote_budget_bytes{0};
+  /// what a promotion is charged up front, before its size is known
+  std::atomic<uint64_t> promote_est_bytes{4 << 20};
 
 public:
   bool promote_throttle() {
     // NOTE: lockless!  we rely on the probability being a single word.
     promote_counter.attempt();
+    if (promote_max_bytes) {
+      // spend the byte budget; promote_finish() charges the real size
+      if (promote_budget_bytes <= 0)
+	return true;  // yes throttle
+      promote_budget_bytes -= promote_est_bytes;
+      return false;
+    }
     if ((unsigned)rand() % 1000 > promote_probability_millis)
       return true;  // yes throttle (no promote)
     if (promote_max_objects &&
@@ -795,6 +840,8 @@ public:
   }
   void promote_finish(uint64_t bytes) {
     promote_counter.finish(bytes);
+    if (promote_max_bytes)
+      promote_budget_bytes += (int64_t)promote_est_bytes - (int64_t)bytes;
   }
   void promote_throttle_recalibrate();
 
@@ -853,9 +900,49 @@ public:
   Mutex snap_sleep_lock;
   SafeTimer snap_sleep_timer;
 
+  // -- snap trim budget --
+private:
+  Mutex snap_trim_budget_lock;
+  double snap_trim_op_tokens = 0;   ///< clones we may still trim, < 0 if overdrawn
+  double snap_trim_byte_tokens = 0; ///< clone bytes we may still free
+  ceph::mono_time snap_trim_budget_stamp;
+  void _refill_snap_trim_budget(uint64_t op_rate, uint64_t byte_rate);
+public:
+  /// account trimmed clones against osd_snap_trim_max_{ops,bytes}_per_sec
+  void charge_snap_trim(uint64_t objects, uint64_t bytes);
+  /// seconds until the snap trim budget is no longer overdrawn
+  double get_snap_trim_delay();
+
   Mutex scrub_sleep_lock;
   SafeTimer scrub_sleep_timer;
 
+  // -- scrub bandwidth --
+private:
+  Mutex scrub_bw_lock;
+  double scrub_bw_tokens = 0;   ///< bytes scrub may still read, < 0 if overdrawn
+  ceph::mono_time scrub_bw_stamp;
+  void _refill_scrub_bw(uint64_t rate);
+public:
+  /// account bytes read by scrub against osd_scrub_bandwidth_limit
+  void charge_scrub_bytes(uint64_t bytes);
+  /// seconds until the scrub bandwidth budget is no longer overdrawn
+  double get_scrub_bw_delay();
+
+  Mutex pg_event_lock;
+  SafeTimer pg_event_timer;   ///< @see PGBackend::Listener::schedule_event_after
+  /// hand a timer event to the pg's op shard, which takes the pg lock
+  void queue_pg_event(const PGTimedEvent &ev) {
+    enqueue_back(
+      ev.pg->get_pgid(),
+      PGQueueable(
+	ev,
+	0,
+	cct->_conf->osd_client_op_priority,
+	ceph_clock_now(),
+	entity_inst_t(),
+	ev.epoch_queued));
+  }
+
   AsyncReserver<spg_t> snap_reserver;
   void queue_for_snap_trim(PG *pg);
 
@@ -964,6 +1051,19 @@ public:
 
   void adjust_pg_priorities(const vector<PGRef>& pgs, int newflags);
 
+  // -- recovery auto-tuning --
+  RecoveryController recovery_controller;
+  RecoveryController::Params get_recovery_tune_params() const;
+  /// apply osd_recovery_auto_tune being switched on or off
+  void reset_recovery_limits();
+  /// feed back client latency into the recovery limits; from tick
+  void tune_recovery_limits();
+  uint64_t get_recovery_max_active() const {
+    if (cct->_conf->osd_recovery_auto_tune)
+      return recovery_controller.get_max_active();
+    return cct->_conf->osd_recovery_max_active;
+  }
+
   // osd map cache (past osd maps)
   Mutex map_cache_lock;
   SharedLRU<epoch_t, const OSDMap> map_cache;
@@ -1190,6 +1290,16 @@ class OSD : public Dispatcher,
   // Tick timer for those stuff that do not need osd_lock
   Mutex tick_timer_lock;
   SafeTimer tick_timer_without_osd_lock;
+
+  // peering messages held back for osd_peering_msg_coalesce_interval so
+  // that several RecoveryCtx worth go out as one message per peer
+  Mutex peering_msg_lock;
+  SafeTimer peering_msg_timer;  // safe timer (peering_msg_lock)
+  OSDMapRef peering_msg_map;    ///< epoch the pending messages are for
+  map<int, vector<pair<pg_notify_t, PastIntervals> > > pending_notifies;
+  map<int, map<spg_t, pg_query_t> > pending_queries;
+  map<int, vector<pair<pg_notify_t, PastIntervals> > > pending_infos;
+  Context *peering_msg_flush = nullptr;
 public:
   // config observer bits
   const char** get_tracked_conf_keys() const override;
@@ -1379,6 +1489,7 @@ private:
   ThreadPool peering_tp;
   ShardedThreadPool osd_op_tp;
   ThreadPool disk_tp;
+  ThreadPool read_tp;
   ThreadPool command_tp;
 
   void set_disk_tp_priority();
@@ -1504,6 +1615,7 @@ private:
   void _remove_heartbeat_peer(int p);
   bool heartbeat_reset(Connection *con);
   void maybe_update_heartbeat_peers();
+  void _limit_heartbeat_peers_per_host(set<int> *peers);
   void reset_heartbeat_peers();
   bool heartbeat_peers_need_update() {
     return heartbeat_need_update.load();
@@ -1589,6 +1701,7 @@ private:
   TestOpsSocketHook *test_ops_hook;
   friend struct C_CompleteSplits;
   friend struct C_OpenPGs;
+  friend struct LoadPGWQ;
 
   // -- op queue --
   enum class io_queue {
@@ -1656,6 +1769,42 @@ private:
       /// priority queue
       std::unique_ptr<OpQueue< pair<spg_t, PGQueueable>, entity_inst_t>> pqueue;
 
+      /// lock-free enqueue path (osd_op_queue_lockless_enqueue); items
+      /// are moved into pqueue in batches by _drain_incoming()
+      MPSCQueue<pair<spg_t, PGQueueable>> incoming;
+      /// _process threads sleeping on sdata_cond
+      std::atomic<unsigned> waiters = {0};
+
+      PerfCounters *logger = nullptr;
+
+      /// true while a messenger thread runs an item from this shard inline
+      bool inline_running = false;
+      /// heartbeat handle used by whichever thread is running inline
+      heartbeat_handle_d *inline_hb = nullptr;
+
+      void _enqueue(pair<spg_t, PGQueueable> item, unsigned cutoff) {
+	unsigned priority = item.second.get_priority();
+	unsigned cost = item.second.get_cost();
+	if (priority >= cutoff)
+	  pqueue->enqueue_strict(
+	    item.second.get_owner(), priority, item);
+	else
+	  pqueue->enqueue(
+	    item.second.get_owner(),
+	    priority, cost, item);
+      }
+
+      /// move items from incoming to pqueue; sdata_op_ordering_lock held
+      void _drain_incoming(unsigned cutoff) {
+	assert(sdata_op_ordering_lock.is_locked_by_me());
+	unsigned n = incoming.drain([&](pair<spg_t, PGQueueable>&& item) {
+	    _enqueue(std::move(item), cutoff);
+	  });
+	if (n && logger) {
+	  logger->inc(l_osd_shard_drained, n);
+	}
+      }
+
       void _enqueue_front(pair<spg_t, PGQueueable> item, unsigned cutoff) {
 	unsigned priority = item.second.get_priority();
 	unsigned cost = item.second.get_cost();
@@ -1699,6 +1848,7 @@ private:
     vector<ShardData*> shard_list;
     OSD *osd;
     uint32_t num_shards;
+    const bool lockless_enqueue;
 
   public:
     ShardedOpWQ(uint32_t pnum_shards,
@@ -1708,7 +1858,8 @@ private:
 		ShardedThreadPool* tp)
       : ShardedThreadPool::ShardedWQ<pair<spg_t,PGQueueable>>(ti, si, tp),
         osd(o),
-        num_shards(pnum_shards) {
+        num_shards(pnum_shards),
+        lockless_enqueue(o->cct->_conf->osd_op_queue_lockless_enqueue) {
       for (uint32_t i = 0; i < num_shards; i++) {
 	char lock_name[32] = {0};
 	snprintf(lock_name, sizeof(lock_name), "%s.%d", "OSD:ShardedOpWQ:", i);
@@ -1724,11 +1875,23 @@ private:
     }
     ~ShardedOpWQ() override {
       while (!shard_list.empty()) {
+	if (shard_list.back()->logger) {
+	  osd->cct->get_perfcounters_collection()->remove(
+	    shard_list.back()->logger);
+	  delete shard_list.back()->logger;
+	}
+	if (shard_list.back()->inline_hb) {
+	  osd->cct->get_heartbeat_map()->remove_worker(
+	    shard_list.back()->inline_hb);
+	}
 	delete shard_list.back();
 	shard_list.pop_back();
       }
     }
 
+    /// register per-shard perf counters
+    void create_loggers();
+
     /// wake any pg waiters after a PG is created/instantiated
     void wake_pg_waiters(spg_t pgid);
 
@@ -1749,6 +1912,9 @@ private:
 
     /// requeue an old item (at the front of the line)
     void _enqueue_front(pair <spg_t, PGQueueable> item) override;
+
+    /// run item on the calling thread if its shard and pg are idle
+    bool try_process_inline(pair <spg_t, PGQueueable>& item);
       
     void return_waiting_threads() override {
       for(uint32_t i = 0; i < num_shards; i++) {
@@ -1767,6 +1933,7 @@ private:
 	snprintf(lock_name, sizeof(lock_name), "%s%d", "OSD:ShardedOpWQ:", i);
 	assert (NULL != sdata);
 	sdata->sdata_op_ordering_lock.Lock();
+	sdata->_drain_incoming(osd->op_prio_cutoff);
 	f->open_object_section(lock_name);
 	sdata->pqueue->dump(f);
 	f->close_section();
@@ -1807,12 +1974,14 @@ private:
       ShardData* sdata = shard_list[shard_index];
       assert(NULL != sdata);
       Mutex::Locker l(sdata->sdata_op_ordering_lock);
-      return sdata->pqueue->empty();
+      return sdata->pqueue->empty() && sdata->incoming.empty();
     }
   } op_shardedwq;
 
 
   void enqueue_op(spg_t pg, OpRequestRef& op, epoch_t epoch);
+  /// process op on the calling (messenger) thread; false if it must queue
+  bool dispatch_op_inline(spg_t pg, OpRequestRef& op, epoch_t epoch);
   void dequeue_op(
     PGRef pg, OpRequestRef op,
     ThreadPool::TPHandle &handle);
@@ -1992,6 +2161,7 @@ protected:
     PG::CephPeeringEvtRef evt);
   
   void load_pgs();
+  void _load_pg(spg_t pgid, std::atomic<bool> *has_upgraded);
   void build_past_intervals_parallel();
 
   /// build initial pg history and intervals on create
@@ -2149,6 +2319,9 @@ protected:
   void do_infos(map<int,
 		    vector<pair<pg_notify_t, PastIntervals> > >& info_map,
 		OSDMapRef map);
+  void queue_peering_msgs(PG::RecoveryCtx &ctx, OSDMapRef curmap,
+			  double interval);
+  void _flush_peering_msgs();
 
   bool require_mon_peer(const Message *m);
   bool require_mon_or_mgr_peer(const Message *m);
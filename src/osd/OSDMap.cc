@@ -196,6 +196,36 @@ int OSDMap::Incremental::identify_osd(uuid_d u) const
   return -1;
 }
 
+bool OSDMap::Incremental::get_affected_pools(set<int64_t> *pools) const
+{
+  // anything that can move pgs in every pool
+  if (fullmap.length() || crush.length() ||
+      new_max_osd >= 0 ||
+      !new_up_client.empty() ||
+      !new_state.empty() ||
+      !new_weight.empty() ||
+      !new_primary_affinity.empty())
+    return false;
+
+  for (auto &p : new_pools)
+    pools->insert(p.first);
+  for (auto p : old_pools)
+    pools->insert(p);
+  for (auto &p : new_pg_temp)
+    pools->insert(p.first.pool());
+  for (auto &p : new_primary_temp)
+    pools->insert(p.first.pool());
+  for (auto &p : new_pg_upmap)
+    pools->insert(p.first.pool());
+  for (auto &p : new_pg_upmap_items)
+    pools->insert(p.first.pool());
+  for (auto &p : old_pg_upmap)
+    pools->insert(p.pool());
+  for (auto &p : old_pg_upmap_items)
+    pools->insert(p.pool());
+  return true;
+}
+
 int OSDMap::Incremental::propagate_snaps_to_tiers(CephContext *cct,
 						  const OSDMap& osdmap)
 {
@@ -1318,7 +1348,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
   }
   mask |= CEPH_FEATURES_CRUSH;
 
-  if (!pg_upmap.empty() || !pg_upmap_items.empty())
+  if (!pg_upmap->empty() || !pg_upmap_items->empty())
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
 
@@ -1503,6 +1533,19 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   if (o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
+
+  // do upmaps match?
+  if (o->pg_upmap->size() == n->pg_upmap->size() &&
+      *o->pg_upmap == *n->pg_upmap)
+    n->pg_upmap = o->pg_upmap;
+  if (o->pg_upmap_items->size() == n->pg_upmap_items->size() &&
+      *o->pg_upmap_items == *n->pg_upmap_items)
+    n->pg_upmap_items = o->pg_upmap_items;
+
+  // does primary affinity match?
+  if (o->osd_primary_affinity && n->osd_primary_affinity &&
+      *o->osd_primary_affinity == *n->osd_primary_affinity)
+    n->osd_primary_affinity = o->osd_primary_affinity;
 }
 
 void OSDMap::clean_temps(CephContext *cct,
@@ -1752,16 +1795,16 @@ int OSDMap::apply_incremental(const Incremental &inc)
   }
 
   for (auto& p : inc.new_pg_upmap) {
-    pg_upmap[p.first] = p.second;
+    (*pg_upmap)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap) {
-    pg_upmap.erase(pg);
+    pg_upmap->erase(pg);
   }
   for (auto& p : inc.new_pg_upmap_items) {
-    pg_upmap_items[p.first] = p.second;
+    (*pg_upmap_items)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap_items) {
-    pg_upmap_items.erase(pg);
+    pg_upmap_items->erase(pg);
   }
 
   // blacklist
@@ -1842,6 +1885,25 @@ int OSDMap::map_to_pg(
   return 0;
 }
 
+int OSDMap::map_to_pgs(
+  int64_t poolid,
+  const vector<string>& names,
+  const string& nspace,
+  vector<pg_t> *pgs) const
+{
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  if (!pool)
+    return -ENOENT;
+  vector<uint32_t> ps;
+  pool->hash_keys(names, nspace, &ps);
+  pgs->clear();
+  pgs->reserve(ps.size());
+  for (auto p : ps) {
+    pgs->push_back(pg_t(p, poolid));
+  }
+  return 0;
+}
+
 int OSDMap::object_locator_to_pg(
   const object_t& oid, const object_locator_t& loc, pg_t &pg) const
 {
@@ -1924,8 +1986,8 @@ int OSDMap::_pick_primary(const vector<int>& osds) const
 void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) const
 {
   pg_t pg = pi.raw_pg_to_pg(raw_pg);
-  auto p = pg_upmap.find(pg);
-  if (p != pg_upmap.end()) {
+  auto p = pg_upmap->find(pg);
+  if (p != pg_upmap->end()) {
     // make sure targets aren't marked out
     for (auto osd : p->second) {
       if (osd != CRUSH_ITEM_NONE && osd < max_osd && osd_weight[osd] == 0) {
@@ -1937,8 +1999,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
     // continue to check and apply pg_upmap_items if any
   }
 
-  auto q = pg_upmap_items.find(pg);
-  if (q != pg_upmap_items.end()) {
+  auto q = pg_upmap_items->find(pg);
+  if (q != pg_upmap_items->end()) {
     for (auto& i : *raw) {
       for (auto& r : q->second) {
         if (r.first != i) {
@@ -2378,11 +2440,11 @@ void OSDMap::encode(bufferlist& bl, uint64_t features) const
     ::encode(erasure_code_profiles, bl);
 
     if (v >= 4) {
-      ::encode(pg_upmap, bl);
-      ::encode(pg_upmap_items, bl);
+      ::encode(*pg_upmap, bl);
+      ::encode(*pg_upmap_items, bl);
     } else {
-      assert(pg_upmap.empty());
-      assert(pg_upmap_items.empty());
+      assert(pg_upmap->empty());
+      assert(pg_upmap_items->empty());
     }
     if (v >= 6) {
       ::encode(crush_version, bl);
@@ -2646,11 +2708,11 @@ void OSDMap::decode(bufferlist::iterator& bl)
       erasure_code_profiles.clear();
     }
     if (struct_v >= 4) {
-      ::decode(pg_upmap, bl);
-      ::decode(pg_upmap_items, bl);
+      ::decode(*pg_upmap, bl);
+      ::decode(*pg_upmap_items, bl);
     } else {
-      pg_upmap.clear();
-      pg_upmap_items.clear();
+      pg_upmap->clear();
+      pg_upmap_items->clear();
     }
     if (struct_v >= 6) {
       ::decode(crush_version, bl);
@@ -2843,7 +2905,7 @@ void OSDMap::dump(Formatter *f) const
   f->close_section();
 
   f->open_array_section("pg_upmap");
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("osds");
@@ -2855,7 +2917,7 @@ void OSDMap::dump(Formatter *f) const
   }
   f->close_section();
   f->open_array_section("pg_upmap_items");
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("mappings");
@@ -3028,10 +3090,10 @@ void OSDMap::print(ostream& out) const
   }
   out << std::endl;
 
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     out << "pg_upmap " << p.first << " " << p.second << "\n";
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     out << "pg_upmap_items " << p.first << " " << p.second << "\n";
   }
 
@@ -3677,7 +3739,7 @@ int OSDMap::clean_pg_upmaps(
 {
   ldout(cct, 10) << __func__ << dendl;
   int changed = 0;
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     vector<int> raw;
     int primary;
     pg_to_raw_osds(p.first, &raw, &primary);
@@ -3688,7 +3750,7 @@ int OSDMap::clean_pg_upmaps(
       ++changed;
     }
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     vector<int> raw;
     int primary;
     pg_to_raw_osds(p.first, &raw, &primary);
@@ -3778,55 +3840,78 @@ int OSDMap::calc_pg_upmaps(
   float start_deviation = 0;
   float end_deviation = 0;
   int num_changed = 0;
-  while (true) {
-    map<int,set<pg_t>> pgs_by_osd;
-    int total_pgs = 0;
-    float osd_weight_total = 0;
-    map<int,float> osd_weight;
-    for (auto& i : pools) {
-      if (!only_pools.empty() && !only_pools.count(i.first))
-	continue;
-      for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps) {
-	pg_t pg(ps, i.first);
-	vector<int> up;
-	tmp.pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
-	for (auto osd : up) {
-	  if (osd != CRUSH_ITEM_NONE)
-	    pgs_by_osd[osd].insert(pg);
-	}
-      }
-      total_pgs += i.second.get_size() * i.second.get_pg_num();
-
-      map<int,float> pmap;
-      int ruleno = tmp.crush->find_rule(i.second.get_crush_rule(),
-					i.second.get_type(),
-					i.second.get_size());
-      tmp.crush->get_rule_weight_osd_map(ruleno, &pmap);
-      ldout(cct,30) << __func__ << " pool " << i.first << " ruleno " << ruleno << dendl;
-      for (auto p : pmap) {
-	osd_weight[p.first] += p.second;
-	osd_weight_total += p.second;
+
+  // Map every pg once up front.  Each change below only touches the
+  // upmap of a single pg, so afterwards we just move that pg between the
+  // per-osd sets instead of remapping the whole cluster again.
+  map<int,set<pg_t>> pgs_by_osd;
+  int total_pgs = 0;
+  float osd_weight_total = 0;
+  map<int,float> osd_weight;
+  for (auto& i : pools) {
+    if (!only_pools.empty() && !only_pools.count(i.first))
+      continue;
+    for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps) {
+      pg_t pg(ps, i.first);
+      vector<int> up;
+      tmp.pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
+      for (auto osd : up) {
+	if (osd != CRUSH_ITEM_NONE)
+	  pgs_by_osd[osd].insert(pg);
       }
     }
-    for (auto& i : osd_weight) {
-      int pgs = 0;
-      auto p = pgs_by_osd.find(i.first);
-      if (p != pgs_by_osd.end())
-	pgs = p->second.size();
-      else
-	pgs_by_osd.emplace(i.first, set<pg_t>());
-      ldout(cct, 20) << " osd." << i.first << " weight " << i.second
-		     << " pgs " << pgs << dendl;
+    total_pgs += i.second.get_size() * i.second.get_pg_num();
+
+    map<int,float> pmap;
+    int ruleno = tmp.crush->find_rule(i.second.get_crush_rule(),
+				      i.second.get_type(),
+				      i.second.get_size());
+    tmp.crush->get_rule_weight_osd_map(ruleno, &pmap);
+    ldout(cct,30) << __func__ << " pool " << i.first << " ruleno " << ruleno << dendl;
+    for (auto p : pmap) {
+      osd_weight[p.first] += p.second;
+      osd_weight_total += p.second;
     }
+  }
+  for (auto& i : osd_weight) {
+    int pgs = 0;
+    auto p = pgs_by_osd.find(i.first);
+    if (p != pgs_by_osd.end())
+      pgs = p->second.size();
+    else
+      pgs_by_osd.emplace(i.first, set<pg_t>());
+    ldout(cct, 20) << " osd." << i.first << " weight " << i.second
+		   << " pgs " << pgs << dendl;
+  }
 
-    if (osd_weight_total == 0) {
-      lderr(cct) << __func__ << " abort due to osd_weight_total == 0" << dendl;
-      break;
+  if (osd_weight_total == 0) {
+    lderr(cct) << __func__ << " abort due to osd_weight_total == 0" << dendl;
+    return 0;
+  }
+  float pgs_per_weight = total_pgs / osd_weight_total;
+  ldout(cct, 10) << " osd_weight_total " << osd_weight_total << dendl;
+  ldout(cct, 10) << " pgs_per_weight " << pgs_per_weight << dendl;
+
+  // move pg to its new osds after its upmap changed in tmp
+  auto remap_pg = [&](pg_t pg, const vector<int>& before) {
+    for (auto osd : before) {
+      if (osd == CRUSH_ITEM_NONE)
+	continue;
+      auto p = pgs_by_osd.find(osd);
+      p->second.erase(pg);
+      // a full remap would not list an unweighted osd without pgs
+      if (p->second.empty() && !osd_weight.count(osd))
+	pgs_by_osd.erase(p);
+    }
+    vector<int> up;
+    tmp.pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
+    for (auto osd : up) {
+      if (osd != CRUSH_ITEM_NONE)
+	pgs_by_osd[osd].insert(pg);
     }
-    float pgs_per_weight = total_pgs / osd_weight_total;
-    ldout(cct, 10) << " osd_weight_total " << osd_weight_total << dendl;
-    ldout(cct, 10) << " pgs_per_weight " << pgs_per_weight << dendl;
+  };
 
+  while (true) {
     // osd deviation
     float total_deviation = 0;
     map<int,float> osd_deviation;       // osd, deviation(pgs)
@@ -3890,28 +3975,33 @@ int OSDMap::calc_pg_upmaps(
 
       // look for remaps we can un-remap
       for (auto pg : pgs) {
-	auto p = tmp.pg_upmap_items.find(pg);
-	if (p != tmp.pg_upmap_items.end()) {
+	auto p = tmp.pg_upmap_items->find(pg);
+	if (p != tmp.pg_upmap_items->end()) {
 	  for (auto q : p->second) {
 	    if (q.second == osd) {
-	      ldout(cct, 10) << "  dropping pg_upmap_items " << pg
-			     << " " << p->second << dendl;
-	      tmp.pg_upmap_items.erase(p);
-	      pending_inc->old_pg_upmap_items.insert(pg);
-	      ++num_changed;
 	      restart = true;
+	      break;
 	    }
 	  }
 	}
-	if (restart)
+	if (restart) {
+	  ldout(cct, 10) << "  dropping pg_upmap_items " << pg
+			 << " " << p->second << dendl;
+	  vector<int> before;
+	  tmp.pg_to_up_acting_osds(pg, &before, nullptr, nullptr, nullptr);
+	  tmp.pg_upmap_items->erase(p);
+	  pending_inc->old_pg_upmap_items.insert(pg);
+	  ++num_changed;
+	  remap_pg(pg, before);
 	  break;
+	}
       } // pg loop
       if (restart)
 	break;
 
       for (auto pg : pgs) {
-	if (tmp.pg_upmap.count(pg) ||
-	    tmp.pg_upmap_items.count(pg)) {
+	if (tmp.pg_upmap->count(pg) ||
+	    tmp.pg_upmap_items->count(pg)) {
 	  ldout(cct, 20) << "  already remapped " << pg << dendl;
 	  continue;
 	}
@@ -3925,7 +4015,9 @@ int OSDMap::calc_pg_upmaps(
 	  continue;
 	}
 	assert(orig != out);
-	auto& rmi = tmp.pg_upmap_items[pg];
+	vector<int> before;
+	tmp.pg_to_up_acting_osds(pg, &before, nullptr, nullptr, nullptr);
+	auto& rmi = (*tmp.pg_upmap_items)[pg];
 	for (unsigned i = 0; i < out.size(); ++i) {
 	  if (orig[i] != out[i]) {
 	    rmi.push_back(make_pair(orig[i], out[i]));
@@ -3933,6 +4025,7 @@ int OSDMap::calc_pg_upmaps(
 	}
 	pending_inc->new_pg_upmap_items[pg] = rmi;
 	ldout(cct, 10) << "  " << pg << " pg_upmap_items " << rmi << dendl;
+	remap_pg(pg, before);
 	restart = true;
 	++num_changed;
 	break;
@@ -420,6 +420,14 @@ public:
     int get_net_marked_down(const OSDMap *previous) const;
     int identify_osd(uuid_d u) const;
 
+    /**
+     * Collect the pools whose pg mappings may change when this
+     * incremental is applied.  Returns false if the change may affect
+     * every pool (crush, osd state, weights, ...), in which case
+     * **pools** is not meaningful.
+     */
+    bool get_affected_pools(set<int64_t> *pools) const;
+
     void encode_client_old(bufferlist& bl) const;
     void encode_classic(bufferlist& bl, uint64_t features) const;
     void encode(bufferlist& bl, uint64_t features=CEPH_FEATURES_ALL) const;
@@ -524,8 +532,9 @@ private:
   ceph::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
+  // shared with other cached epochs by dedup() while unchanged
+  ceph::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>> pg_upmap; ///< remap pg
+  ceph::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>>> pg_upmap_items; ///< remap osds in up set
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,string> pool_name;
@@ -577,6 +586,8 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>>()),
+	     pg_upmap_items(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>>>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
@@ -597,6 +608,8 @@ public:
     primary_temp.reset(new mempool::osdmap::map<pg_t,int32_t>(*o.primary_temp));
     pg_temp.reset(new PGTempMap(*o.pg_temp));
     osd_uuid.reset(new mempool::osdmap::vector<uuid_d>(*o.osd_uuid));
+    pg_upmap.reset(new mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>(*o.pg_upmap));
+    pg_upmap_items.reset(new mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>>(*o.pg_upmap_items));
 
     if (o.osd_primary_affinity)
       osd_primary_affinity.reset(new mempool::osdmap::vector<__u32>(*o.osd_primary_affinity));
@@ -678,6 +691,9 @@ public:
   unsigned get_num_pg_temp() const {
     return pg_temp->size();
   }
+  unsigned get_num_pg_upmaps() const {
+    return pg_upmap->size() + pg_upmap_items->size();
+  }
 
   int get_flags() const { return flags; }
   bool test_flag(int f) const { return flags & f; }
@@ -1004,6 +1020,12 @@ public:
     const string& key,
     const string& nspace,
     pg_t *pg) const;
+  /// map_to_pg() for many object names in one pool and namespace
+  int map_to_pgs(
+    int64_t pool,
+    const vector<string>& names,
+    const string& nspace,
+    vector<pg_t> *pgs) const;
   int object_locator_to_pg(const object_t& oid, const object_locator_t& loc,
 			   pg_t &pg) const;
   pg_t object_locator_to_pg(const object_t& oid,
@@ -13,7 +13,8 @@ MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
 
 // ensure that we have a PoolMappings for each pool and that
 // the dimensions (pg_num and size) match up.
-void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
+void OSDMapMapping::_init_mappings(const OSDMap& osdmap,
+				   std::set<int64_t> *reset)
 {
   num_pgs = 0;
   auto q = pools.begin();
@@ -36,6 +37,9 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
     }
     pools.emplace(p.first, PoolMapping(p.second.get_size(),
 				       p.second.get_pg_num()));
+    if (reset) {
+      reset->insert(p.first);
+    }
   }
   pools.erase(q, pools.end());
   assert(pools.size() == osdmap.get_pools().size());
@@ -155,10 +159,14 @@ void ParallelPGMapper::WQ::_process(Item *i, ThreadPool::TPHandle &h)
 
 void ParallelPGMapper::queue(
   Job *job,
-  unsigned pgs_per_item)
+  unsigned pgs_per_item,
+  const std::set<int64_t> *pools)
 {
   bool any = false;
   for (auto& p : job->osdmap->get_pools()) {
+    if (pools && pools->count(p.first) == 0) {
+      continue;
+    }
     for (unsigned ps = 0; ps < p.second.get_pg_num(); ps += pgs_per_item) {
       unsigned ps_end = MIN(ps + pgs_per_item, p.second.get_pg_num());
       job->start_one();
@@ -168,5 +176,12 @@ void ParallelPGMapper::queue(
       any = true;
     }
   }
-  assert(any);
+  if (!any) {
+    // nothing to recompute; finish the job right away
+    assert(pools);
+    ldout(cct, 20) << __func__ << " " << job << " no pools, completing"
+		   << dendl;
+    job->start_one();
+    job->finish_one();
+  }
 }
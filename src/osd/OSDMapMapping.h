@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
 #include "common/WorkQueue.h"
@@ -155,9 +156,11 @@ public:
     : cct(cct),
       wq(this, tp) {}
 
+  /// queue **job** over all pools, or only over **pools** if given
   void queue(
     Job *job,
-    unsigned pgs_per_item);
+    unsigned pgs_per_item,
+    const std::set<int64_t> *pools = nullptr);
 
   void drain() {
     wq.drain();
@@ -243,10 +246,11 @@ private:
   mempool::osdmap_mapping::vector<
     mempool::osdmap_mapping::vector<pg_t>> acting_rmap;  // osd -> pg
   //unused: mempool::osdmap_mapping::vector<std::vector<pg_t>> up_rmap;  // osd -> pg
-  epoch_t epoch;
+  epoch_t epoch = 0;
   uint64_t num_pgs = 0;
 
-  void _init_mappings(const OSDMap& osdmap);
+  void _init_mappings(const OSDMap& osdmap,
+		      std::set<int64_t> *reset = nullptr);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
@@ -254,8 +258,8 @@ private:
 
   void _build_rmap(const OSDMap& osdmap);
 
-  void _start(const OSDMap& osdmap) {
-    _init_mappings(osdmap);
+  void _start(const OSDMap& osdmap, std::set<int64_t> *reset = nullptr) {
+    _init_mappings(osdmap, reset);
   }
   void _finish(const OSDMap& osdmap);
 
@@ -265,10 +269,18 @@ private:
 
   struct MappingJob : public ParallelPGMapper::Job {
     OSDMapMapping *mapping;
+    std::set<int64_t> only_pools;  ///< pools to recompute, if not all
     MappingJob(const OSDMap *osdmap, OSDMapMapping *m)
       : Job(osdmap), mapping(m) {
       mapping->_start(*osdmap);
     }
+    MappingJob(const OSDMap *osdmap, OSDMapMapping *m,
+	       const std::set<int64_t>& changed)
+      : Job(osdmap), mapping(m), only_pools(changed) {
+      // pools whose dimensions changed start out empty and must be
+      // recomputed too
+      mapping->_start(*osdmap, &only_pools);
+    }
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -312,6 +324,21 @@ public:
     return job;
   }
 
+  /**
+   * Like start_update(), but only recompute the pgs in **pools**.  The
+   * caller must know that no other pool's mapping changed since
+   * get_epoch().
+   */
+  std::unique_ptr<MappingJob> start_update(
+    const OSDMap& map,
+    ParallelPGMapper& mapper,
+    unsigned pgs_per_item,
+    const std::set<int64_t>& pools) {
+    std::unique_ptr<MappingJob> job(new MappingJob(&map, this, pools));
+    mapper.queue(job.get(), pgs_per_item, &job->only_pools);
+    return job;
+  }
+
   epoch_t get_epoch() const {
     return epoch;
   }
@@ -368,6 +368,17 @@ void PG::lock(bool no_lockdep) const
   dout(30) << "lock" << dendl;
 }
 
+bool PG::try_lock() const
+{
+  if (!_lock.TryLock())
+    return false;
+  assert(!dirty_info);
+  assert(!dirty_big_info);
+
+  dout(30) << "try_lock" << dendl;
+  return true;
+}
+
 std::string PG::gen_prefix() const
 {
   stringstream out;
@@ -3383,47 +3394,61 @@ void PG::update_snap_map(
   const vector<pg_log_entry_t> &log_entries,
   ObjectStore::Transaction &t)
 {
+  // clone deletions (a batched snap trim) are looked up and removed
+  // together, in order with the other updates
+  vector<hobject_t> to_remove;
+  auto flush_removes = [&]() {
+    if (to_remove.empty())
+      return;
+    OSDriver::OSTransaction _t(osdriver.get_transaction(&t));
+    int r = to_remove.size() == 1 ?
+      snap_mapper.remove_oid(to_remove.front(), &_t) :
+      snap_mapper.remove_oids(to_remove, &_t);
+    assert(r == 0);
+    to_remove.clear();
+  };
   for (vector<pg_log_entry_t>::const_iterator i = log_entries.begin();
        i != log_entries.end();
        ++i) {
+    if (i->soid.snap >= CEPH_MAXSNAP)
+      continue; // heads and snapdirs are not in the snap mapper
+    if (i->is_delete()) {
+      to_remove.push_back(i->soid);
+      continue;
+    }
+    flush_removes();
     OSDriver::OSTransaction _t(osdriver.get_transaction(&t));
-    if (i->soid.snap < CEPH_MAXSNAP) {
-      if (i->is_delete()) {
-	int r = snap_mapper.remove_oid(
+    if (i->is_update()) {
+      assert(i->snaps.length() > 0);
+      vector<snapid_t> snaps;
+      bufferlist snapbl = i->snaps;
+      bufferlist::iterator p = snapbl.begin();
+      try {
+	::decode(snaps, p);
+      } catch (...) {
+	snaps.clear();
+      }
+      set<snapid_t> _snaps(snaps.begin(), snaps.end());
+
+      if (i->is_clone() || i->is_promote()) {
+	snap_mapper.add_oid(
 	  i->soid,
+	  _snaps,
+	  &_t);
+      } else if (i->is_modify()) {
+	assert(i->is_modify());
+	int r = snap_mapper.update_snaps(
+	  i->soid,
+	  _snaps,
+	  0,
 	  &_t);
 	assert(r == 0);
-      } else if (i->is_update()) {
-	assert(i->snaps.length() > 0);
-	vector<snapid_t> snaps;
-	bufferlist snapbl = i->snaps;
-	bufferlist::iterator p = snapbl.begin();
-	try {
-	  ::decode(snaps, p);
-	} catch (...) {
-	  snaps.clear();
-	}
-	set<snapid_t> _snaps(snaps.begin(), snaps.end());
-
-	if (i->is_clone() || i->is_promote()) {
-	  snap_mapper.add_oid(
-	    i->soid,
-	    _snaps,
-	    &_t);
-	} else if (i->is_modify()) {
-	  assert(i->is_modify());
-	  int r = snap_mapper.update_snaps(
-	    i->soid,
-	    _snaps,
-	    0,
-	    &_t);
-	  assert(r == 0);
-	} else {
-	  assert(i->is_clean());
-	}
+      } else {
+	assert(i->is_clean());
       }
     }
   }
+  flush_removes();
 }
 
 /**
@@ -4169,6 +4194,16 @@ int PG::build_scrub_map_chunk(
 
 
   get_pgbackend()->be_scan_list(map, ls, deep, seed, handle);
+  if (deep) {
+    // shallow scrub only stats, deep scrub reads every object in full
+    uint64_t bytes = 0;
+    for (auto& p : ls) {
+      auto o = map.objects.find(p);
+      if (o != map.objects.end())
+	bytes += o->second.size;
+    }
+    osd->charge_scrub_bytes(bytes);
+  }
   _scan_rollback_obs(rollback_obs, handle);
   _scan_snaps(map);
   _repair_oinfo_oid(map);
@@ -4323,12 +4358,19 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (cct->_conf->osd_scrub_sleep > 0 &&
-      (scrubber.state == PG::Scrubber::NEW_CHUNK ||
+  double scrub_sleep = 0;
+  if ((scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
-       scrubber.needs_sleep) {
+      scrubber.needs_sleep) {
+    // wait for the configured sleep, or longer if the osd is over its
+    // scrub bandwidth budget
+    scrub_sleep = std::max<double>(cct->_conf->osd_scrub_sleep,
+				   osd->get_scrub_bw_delay());
+  }
+  if (scrub_sleep > 0) {
     ceph_assert(!scrubber.sleeping);
-    dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping" << dendl;
+    dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping "
+	     << scrub_sleep << dendl;
 
     // Do an async sleep so we don't block the op queue
     OSDService *osds = osd;
@@ -4356,7 +4398,7 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
           pg->unlock();
         });
     Mutex::Locker l(osd->scrub_sleep_lock);
-    osd->scrub_sleep_timer.add_event_after(cct->_conf->osd_scrub_sleep,
+    osd->scrub_sleep_timer.add_event_after(scrub_sleep,
                                            scrub_requeue_callback);
     scrubber.sleeping = true;
     scrubber.sleep_start = ceph_clock_now();
@@ -407,6 +407,17 @@ int PGBackend::objects_list_range(
   return r;
 }
 
+void PGBackend::objects_prefetch(const vector<hobject_t> &ls)
+{
+  vector<ghobject_t> oids;
+  oids.reserve(ls.size());
+  for (auto& hoid : ls) {
+    oids.push_back(
+      ghobject_t(hoid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard));
+  }
+  store->prefetch_objects(ch, oids);
+}
+
 int PGBackend::objects_get_attr(
   const hobject_t &hoid,
   const string &attr,
@@ -577,6 +588,7 @@ void PGBackend::be_scan_list(
 {
   dout(10) << __func__ << " scanning " << ls.size() << " objects"
            << (deep ? " deeply" : "") << dendl;
+  objects_prefetch(ls);
   int i = 0;
   for (vector<hobject_t>::const_iterator p = ls.begin();
        p != ls.end();
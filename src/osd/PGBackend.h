@@ -246,6 +246,16 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
      virtual void schedule_recovery_work(
        GenContext<ThreadPool::TPHandle&> *c) = 0;
 
+     /// run c on the async read pool, without the pg lock
+     virtual void schedule_read_work(
+       GenContext<ThreadPool::TPHandle&> *c) = 0;
+
+     /// complete c with the pg locked after delay seconds, or just
+     /// delete it if the pg has been reset or removed in the meantime
+     virtual void schedule_event_after(
+       double delay,
+       Context *c) = 0;
+
      virtual pg_shard_t whoami_shard() const = 0;
      int whoami() const {
        return whoami_shard().osd;
@@ -528,6 +538,9 @@ typedef ceph::shared_ptr<const OSDMap> OSDMapRef;
      vector<hobject_t> *ls,
      vector<ghobject_t> *gen_obs=0);
 
+   /// hint that each of ls is about to be looked at
+   void objects_prefetch(const vector<hobject_t> &ls);
+
    int objects_get_attr(
      const hobject_t &hoid,
      const string &attr,
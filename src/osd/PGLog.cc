@@ -48,7 +48,7 @@ void PGLog::IndexedLog::trim(
   eversion_t s,
   set<eversion_t> *trimmed,
   set<string>* trimmed_dups,
-  bool* dirty_dups)
+  eversion_t *write_from_dups)
 {
   if (complete_to != log.end() &&
       complete_to->version <= s) {
@@ -76,7 +76,11 @@ void PGLog::IndexedLog::trim(
 
     // add to dup list
     if (e.version.version >= earliest_dup_version) {
-      if (dirty_dups) *dirty_dups = true;
+      if (write_from_dups != nullptr && *write_from_dups > e.version) {
+	generic_dout(20) << "updating write_from_dups from " << *write_from_dups
+			 << " to " << e.version << dendl;
+	*write_from_dups = e.version;
+      }
       dups.push_back(pg_log_dup_t(e));
       index(dups.back());
       for (const auto& extra : e.extra_reqids) {
@@ -164,7 +168,7 @@ void PGLog::trim(
     assert(trim_to <= info.last_complete);
 
     dout(10) << "trim " << log << " to " << trim_to << dendl;
-    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &dirty_dups);
+    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &write_from_dups);
     info.log_tail = log.tail;
   }
 }
@@ -572,6 +576,8 @@ void PGLog::write_log_and_missing(
 	     << ", writeout_from: " << writeout_from
 	     << ", trimmed: " << trimmed
 	     << ", trimmed_dups: " << trimmed_dups
+	     << ", dirty_dups: " << dirty_dups
+	     << ", write_from_dups: " << write_from_dups
 	     << ", clear_divergent_priors: " << clear_divergent_priors
 	     << dendl;
     _write_log_and_missing(
@@ -586,6 +592,7 @@ void PGLog::write_log_and_missing(
       require_rollback,
       clear_divergent_priors,
       dirty_dups,
+      write_from_dups,
       &rebuilt_missing_with_deletes,
       (pg_log_debug ? &log_keys_debug : nullptr));
     undirty();
@@ -632,7 +639,8 @@ void PGLog::write_log_and_missing(
     set<eversion_t>(),
     set<string>(),
     missing,
-    true, require_rollback, false, dirty_dups, rebuilt_missing_with_deletes, nullptr);
+    true, require_rollback, false, dirty_dups, eversion_t::max(),
+    rebuilt_missing_with_deletes, nullptr);
 }
 
 // static
@@ -758,6 +766,7 @@ void PGLog::_write_log_and_missing(
   bool require_rollback,
   bool clear_divergent_priors,
   bool dirty_dups,
+  eversion_t write_from_dups,
   bool *rebuilt_missing_with_deletes, // in/out param
   set<string> *log_keys_debug
   ) {
@@ -829,6 +838,16 @@ void PGLog::_write_log_and_missing(
       ::encode(entry, bl);
       (*km)[entry.get_key_name()].claim(bl);
     }
+  } else if (write_from_dups != eversion_t::max()) {
+    // dups appended by trim since the last write; the older ones are
+    // already on disk and those trimmed since are in trimmed_dups
+    for (auto p = log.dups.rbegin();
+	 p != log.dups.rend() && p->version >= write_from_dups;
+	 ++p) {
+      bufferlist bl;
+      ::encode(*p, bl);
+      (*km)[p->get_key_name()].claim(bl);
+    }
   }
 
   if (clear_divergent_priors) {
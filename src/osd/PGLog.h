@@ -538,7 +538,7 @@ public:
       eversion_t s,
       set<eversion_t> *trimmed,
       set<string>* trimmed_dups,
-      bool* dirty_dups);
+      eversion_t *write_from_dups);
 
     ostream& print(ostream& out) const;
   }; // IndexedLog
@@ -555,12 +555,13 @@ protected:
   eversion_t writeout_from;    ///< must writout keys >= writeout_from
   set<eversion_t> trimmed;     ///< must clear keys in trimmed
   set<string> trimmed_dups;    ///< must clear keys in trimmed_dups
+  eversion_t write_from_dups;  ///< must write out dups >= write_from_dups
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
   bool touched_log;
   bool clear_divergent_priors;
-  bool dirty_dups; /// log.dups is updated
+  bool dirty_dups; /// log.dups is updated, rewrite all of them
   bool rebuilt_missing_with_deletes = false;
 
   void mark_dirty_to(eversion_t to) {
@@ -585,6 +586,7 @@ public:
       !missing.is_clean() ||
       !(trimmed_dups.empty()) ||
       dirty_dups ||
+      (write_from_dups != eversion_t::max()) ||
       rebuilt_missing_with_deletes;
   }
   void mark_log_for_rewrite() {
@@ -625,6 +627,7 @@ protected:
     check();
     missing.flush();
     dirty_dups = false;
+    write_from_dups = eversion_t::max();
   }
 public:
 
@@ -633,6 +636,7 @@ public:
     prefix_provider(dpp),
     dirty_from(eversion_t::max()),
     writeout_from(eversion_t::max()),
+    write_from_dups(eversion_t::max()),
     cct(cct),
     pg_log_debug(!(cct && !(cct->_conf->osd_debug_pg_log_writeout))),
     touched_log(false),
@@ -1228,6 +1232,7 @@ public:
     bool require_rollback,
     bool clear_divergent_priors,
     bool dirty_dups,
+    eversion_t write_from_dups,
     bool *rebuilt_missing_with_deletes,
     set<string> *log_keys_debug
     );
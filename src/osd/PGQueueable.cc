@@ -33,3 +33,14 @@ void PGQueueable::RunVis::operator()(const PGScrub &op) {
 void PGQueueable::RunVis::operator()(const PGRecovery &op) {
   osd->do_recovery(pg.get(), op.epoch_queued, op.reserved_pushes, handle);
 }
+
+void PGQueueable::RunVis::operator()(const PGTimedEvent &op) {
+  Context *c = op.release();
+  if (!c)
+    return;
+  if (pg != op.pg || pg->pg_has_reset_since(op.epoch_queued)) {
+    delete c;
+  } else {
+    c->complete(0);
+  }
+}
@@ -53,13 +53,37 @@ struct PGRecovery {
   }
 };
 
+/// a Context to complete with the pg locked.  it is deleted without
+/// running if the item is dropped or the pg has been reset since.
+struct PGTimedEvent {
+  struct Holder {
+    Context *c;
+    explicit Holder(Context *c) : c(c) {}
+    ~Holder() { delete c; }
+  };
+  epoch_t epoch_queued;
+  PGRef pg;  ///< the instance that asked for it
+  std::shared_ptr<Holder> holder;
+  PGTimedEvent(epoch_t e, PG *pg, Context *c)
+    : epoch_queued(e), pg(pg), holder(std::make_shared<Holder>(c)) {}
+  Context *release() const {
+    Context *c = holder->c;
+    holder->c = nullptr;
+    return c;
+  }
+  ostream &operator<<(ostream &rhs) {
+    return rhs << "PGTimedEvent";
+  }
+};
+
 
 class PGQueueable {
   typedef boost::variant<
     OpRequestRef,
     PGSnapTrim,
     PGScrub,
-    PGRecovery
+    PGRecovery,
+    PGTimedEvent
     > QVariant;
   QVariant qvariant;
   int cost;
@@ -78,6 +102,7 @@ class PGQueueable {
     void operator()(const PGSnapTrim &op);
     void operator()(const PGScrub &op);
     void operator()(const PGRecovery &op);
+    void operator()(const PGTimedEvent &op);
   }; // struct RunVis
 
   struct StringifyVis : public boost::static_visitor<std::string> {
@@ -93,6 +118,9 @@ class PGQueueable {
     std::string operator()(const PGRecovery &op) {
       return "PGRecovery";
     }
+    std::string operator()(const PGTimedEvent &op) {
+      return "PGTimedEvent";
+    }
   };
 
   friend ostream& operator<<(ostream& out, const PGQueueable& q) {
@@ -126,6 +154,11 @@ public:
     const entity_inst_t &owner, epoch_t e)
     : qvariant(op), cost(cost), priority(priority), start_time(start_time),
       owner(owner), map_epoch(e) {}
+  PGQueueable(
+    const PGTimedEvent &op, int cost, unsigned priority, utime_t start_time,
+    const entity_inst_t &owner, epoch_t e)
+    : qvariant(op), cost(cost), priority(priority), start_time(start_time),
+      owner(owner), map_epoch(e) {}
 
   const boost::optional<OpRequestRef> maybe_get_op() const {
     const OpRequestRef *op = boost::get<OpRequestRef>(&qvariant);
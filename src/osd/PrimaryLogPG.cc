@@ -186,17 +186,22 @@ class PrimaryLogPG::C_PG_ObjectContext : public Context {
 
 class PrimaryLogPG::C_OSD_OndiskWriteUnlock : public Context {
   ObjectContextRef obc, obc2, obc3;
+  vector<ObjectContextRef> more;
   public:
   C_OSD_OndiskWriteUnlock(
     ObjectContextRef o,
     ObjectContextRef o2 = ObjectContextRef(),
-    ObjectContextRef o3 = ObjectContextRef()) : obc(o), obc2(o2), obc3(o3) {}
+    ObjectContextRef o3 = ObjectContextRef(),
+    const vector<ObjectContextRef>& m = vector<ObjectContextRef>())
+    : obc(o), obc2(o2), obc3(o3), more(m) {}
   void finish(int r) override {
     obc->ondisk_write_unlock();
     if (obc2)
       obc2->ondisk_write_unlock();
     if (obc3)
       obc3->ondisk_write_unlock();
+    for (auto& o : more)
+      o->ondisk_write_unlock();
   }
 };
 
@@ -510,6 +515,38 @@ void PrimaryLogPG::schedule_recovery_work(
   osd->recovery_gen_wq.queue(c);
 }
 
+bool PrimaryLogPG::can_serve_replica_read(const hobject_t &oid)
+{
+  auto p = pg_log.get_log().objects.find(oid);
+  if (p == pg_log.get_log().objects.end())
+    return true;
+  // the primary tells us what is committed on every replica through the
+  // roll forward point it ships with each repop
+  const eversion_t &v = p->second->version;
+  return v <= last_update_applied && v <= pg_log.get_can_rollback_to();
+}
+
+void PrimaryLogPG::schedule_read_work(
+  GenContext<ThreadPool::TPHandle&> *c)
+{
+  osd->async_read_wq.queue(c);
+}
+
+void PrimaryLogPG::schedule_event_after(
+  double delay,
+  Context *c)
+{
+  // the timer thread is shared by every pg, so it must not wait for a
+  // pg lock; the op shard takes it.  c is freed if the event never runs.
+  OSDService *osds = osd;
+  PGTimedEvent ev(get_osdmap()->get_epoch(), this, c);
+  auto cb = new FunctionContext([osds, ev](int r) {
+      osds->queue_pg_event(ev);
+    });
+  Mutex::Locker l(osd->pg_event_lock);
+  osd->pg_event_timer.add_event_after(delay, cb);
+}
+
 void PrimaryLogPG::send_message_osd_cluster(
   int peer, Message *m, epoch_t from_epoch)
 {
@@ -1901,6 +1938,11 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
       osd->handle_misdirected_op(this, op);
       return;
     }
+    if (!is_primary() && !pool.info.is_replicated()) {
+      // an ec shard only holds part of the object
+      osd->handle_misdirected_op(this, op);
+      return;
+    }
   } else {
     // normal case; must be primary
     if (!is_primary()) {
@@ -2123,6 +2165,15 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
   hobject_t missing_oid;
   const hobject_t& oid = m->get_hobj();
 
+  if (!is_primary() &&
+      !(can_serve_replica_read(head) &&
+	(oid == head || can_serve_replica_read(oid)))) {
+    dout(10) << __func__ << ": " << oid << " has updates that may not be"
+	     << " applied or committed everywhere, bouncing to primary" << dendl;
+    osd->reply_op_error(op, -EAGAIN);
+    return;
+  }
+
   // io blocked on obc?
   if (!m->has_flag(CEPH_OSD_FLAG_FLUSH) &&
       maybe_await_blocked_snapset(oid, op)) {
@@ -2172,6 +2223,8 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
         in_hit_set = true;
     }
     if (!op->hitset_inserted) {
+      if (agent_state && !hit_set->contains(oid))
+	agent_state->hit_set_access(oid);
       hit_set->insert(oid);
       op->hitset_inserted = true;
       if (hit_set->is_full() ||
@@ -2673,7 +2726,13 @@ bool PrimaryLogPG::maybe_promote(ObjectContextRef obc,
   default:
     {
       unsigned count = (int)in_hit_set;
-      if (count) {
+      const RecencyIndex& recent = agent_state->recent;
+      if (count && !recent.empty() &&
+	  recent.get_generations() + 1 >= recency) {
+	// one lookup in the recency index covers all archived hit sets
+	const hobject_t& oid = obc.get() ? obc->obs.oi.soid : missing_oid;
+	count += recent.archived_run(oid.get_hash());
+      } else if (count) {
 	// Check if in other hit sets
 	const hobject_t& oid = obc.get() ? obc->obs.oi.soid : missing_oid;
 	for (map<time_t,HitSetRef>::reverse_iterator itor =
@@ -3449,6 +3508,15 @@ void PrimaryLogPG::log_op_stats(OpContext *ctx)
   } else
     ceph_abort();
 
+  if (cct->_conf->osd_recovery_auto_tune) {
+    osd->recovery_controller.record_client_op(latency);
+  }
+  if (cct->_conf->osd_client_io_stats) {
+    osd->client_io_stats.add(
+      client_io_key_t(info.pgid.pool(), m->get_source(), m->get_oid().name),
+      outb, inb, latency.to_nsec());
+  }
+
   dout(15) << "log_op_stats " << *m
 	   << " inb " << inb
 	   << " outb " << outb
@@ -3663,7 +3731,6 @@ void PrimaryLogPG::do_backfill_remove(OpRequestRef op)
 int PrimaryLogPG::trim_object(
   bool first, const hobject_t &coid, PrimaryLogPG::OpContextUPtr *ctxp)
 {
-  *ctxp = NULL;
   // load clone info
   bufferlist bl;
   ObjectContextRef obc = get_object_context(coid, false, NULL);
@@ -3733,28 +3800,39 @@ int PrimaryLogPG::trim_object(
     }
   }
 
-  OpContextUPtr ctx = simple_opc_create(obc);
-  ctx->snapset_obc = snapset_obc;
-
-  if (!ctx->lock_manager.get_snaptrimmer_write(
+  ObcLockManager lock_manager;
+  if (!lock_manager.get_snaptrimmer_write(
 	coid,
 	obc,
 	first)) {
-    close_op_ctx(ctx.release());
     dout(10) << __func__ << ": Unable to get a wlock on " << coid << dendl;
     return -ENOLCK;
   }
 
-  if (!ctx->lock_manager.get_snaptrimmer_write(
+  if (!lock_manager.get_snaptrimmer_write(
 	snapoid,
 	snapset_obc,
 	first)) {
-    close_op_ctx(ctx.release());
     dout(10) << __func__ << ": Unable to get a wlock on " << snapoid << dendl;
+    // nobody can have queued on the clone while we held the pg lock
+    bool requeue_recovery = false, requeue_snaptrim = false;
+    lock_manager.put_locks(nullptr, &requeue_recovery, &requeue_snaptrim);
     return -ENOLCK;
   }
 
-  ctx->at_version = get_next_version();
+  OpContext *ctx = ctxp->get();
+  if (!ctx) {
+    ctxp->reset(simple_opc_create(obc).release());
+    ctx = ctxp->get();
+    ctx->snapset_obc = snapset_obc;
+    ctx->at_version = get_next_version();
+  } else {
+    // batched with the clones trimmed before it
+    ctx->extra_obcs.push_back(obc);
+    ctx->extra_obcs.push_back(snapset_obc);
+    ctx->at_version.version++;
+  }
+  ctx->lock_manager.splice(std::move(lock_manager));
 
   PGTransaction *t = ctx->op_t.get();
  
@@ -3809,7 +3887,7 @@ int PrimaryLogPG::trim_object(
 	pg_log_entry_t::DELETE,
 	coid,
 	ctx->at_version,
-	ctx->obs->oi.version,
+	obc->obs.oi.version,
 	0,
 	osd_reqid_t(),
 	ctx->mtime,
@@ -3879,7 +3957,7 @@ int PrimaryLogPG::trim_object(
 	pg_log_entry_t::DELETE,
 	snapoid,
 	ctx->at_version,
-	ctx->snapset_obc->obs.oi.version,
+	snapset_obc->obs.oi.version,
 	0,
 	osd_reqid_t(),
 	ctx->mtime,
@@ -3887,7 +3965,7 @@ int PrimaryLogPG::trim_object(
       );
     if (snapoid.is_head()) {
       derr << "removing snap head" << dendl;
-      object_info_t& oi = ctx->snapset_obc->obs.oi;
+      object_info_t& oi = snapset_obc->obs.oi;
       ctx->delta_stats.num_objects--;
       if (oi.is_dirty()) {
 	ctx->delta_stats.num_objects_dirty--;
@@ -3902,8 +3980,8 @@ int PrimaryLogPG::trim_object(
 	ctx->delta_stats.num_objects_pinned--;
       }
     }
-    ctx->snapset_obc->obs.exists = false;
-    ctx->snapset_obc->obs.oi = object_info_t(snapoid);
+    snapset_obc->obs.exists = false;
+    snapset_obc->obs.oi = object_info_t(snapoid);
     t->remove(snapoid);
   } else {
     dout(10) << coid << " filtering snapset on " << snapoid << dendl;
@@ -3915,16 +3993,16 @@ int PrimaryLogPG::trim_object(
 	pg_log_entry_t::MODIFY,
 	snapoid,
 	ctx->at_version,
-	ctx->snapset_obc->obs.oi.version,
+	snapset_obc->obs.oi.version,
 	0,
 	osd_reqid_t(),
 	ctx->mtime,
 	0)
       );
 
-    ctx->snapset_obc->obs.oi.prior_version =
-      ctx->snapset_obc->obs.oi.version;
-    ctx->snapset_obc->obs.oi.version = ctx->at_version;
+    snapset_obc->obs.oi.prior_version =
+      snapset_obc->obs.oi.version;
+    snapset_obc->obs.oi.version = ctx->at_version;
 
     map <string, bufferlist> attrs;
     bl.clear();
@@ -3932,13 +4010,12 @@ int PrimaryLogPG::trim_object(
     attrs[SS_ATTR].claim(bl);
 
     bl.clear();
-    ::encode(ctx->snapset_obc->obs.oi, bl,
+    ::encode(snapset_obc->obs.oi, bl,
 	     get_osdmap()->get_features(CEPH_ENTITY_TYPE_OSD, nullptr));
     attrs[OI_ATTR].claim(bl);
     t->setattrs(snapoid, attrs);
   }
 
-  *ctxp = std::move(ctx);
   return 0;
 }
 
@@ -4803,7 +4880,8 @@ int PrimaryLogPG::do_read(OpContext *ctx, OSDOp& osd_op) {
     // read size was trimmed to zero and it is expected to do nothing
     // a read operation of 0 bytes does *not* do nothing, this is why
     // the trimmed_read boolean is needed
-  } else if (pool.info.require_rollback()) {
+  } else if (pool.info.require_rollback() ||
+	     use_async_read(op.extent.length)) {
     boost::optional<uint32_t> maybe_crc;
     // If there is a data digest and it is possible we are reading
     // entire object, pass the digest.  FillInVerifyExtent will
@@ -7354,6 +7432,13 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
        ++p) {
     dout(10) << "do_osd_op_effects, notify " << *p << dendl;
     ConnectionRef conn(ctx->op->get_req()->get_connection());
+    // every watcher's MWatchNotify references the same payload buffers; make
+    // them one contiguous buffer so its crc is computed once and cached
+    // rather than once per watcher
+    uint64_t share_min = cct->_conf->osd_notify_share_payload_min_watchers;
+    if (share_min && ctx->obc->watchers.size() >= share_min &&
+	p->bl.get_num_buffers() > 1)
+      p->bl.rebuild();
     NotifyRef notif(
       Notify::makeNotifyRef(
 	conn,
@@ -7381,13 +7466,21 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
       dout(10) << "notify_ack " << make_pair(p->watch_cookie.get(), p->notify_id) << dendl;
     else
       dout(10) << "notify_ack " << make_pair("NULL", p->notify_id) << dendl;
+    if (p->watch_cookie) {
+      // watchers are keyed by (cookie, entity); no need to scan them all
+      auto i = ctx->obc->watchers.find(
+	make_pair(p->watch_cookie.get(), entity));
+      if (i != ctx->obc->watchers.end()) {
+	dout(10) << "acking notify on watch " << i->first << dendl;
+	i->second->notify_ack(p->notify_id, p->reply_bl);
+      }
+      continue;
+    }
     for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
 	   ctx->obc->watchers.begin();
 	 i != ctx->obc->watchers.end();
 	 ++i) {
       if (i->first.second != entity) continue;
-      if (p->watch_cookie &&
-	  p->watch_cookie.get() != i->first.first) continue;
       dout(10) << "acking notify on watch " << i->first << dendl;
       i->second->notify_ack(p->notify_id, p->reply_bl);
     }
@@ -9317,13 +9410,18 @@ void PrimaryLogPG::issue_repop(RepGather *repop, OpContext *ctx)
     unlock_snapset_obc = true;
     ctx->op_t->add_obc(ctx->snapset_obc);
   }
+  for (auto& obc : ctx->extra_obcs) {
+    obc->ondisk_write_lock();
+    ctx->op_t->add_obc(obc);
+  }
 
   Context *on_all_commit = new C_OSD_RepopCommit(this, repop);
   Context *on_all_applied = new C_OSD_RepopApplied(this, repop);
   Context *onapplied_sync = new C_OSD_OndiskWriteUnlock(
     ctx->obc,
     ctx->clone_obc,
-    unlock_snapset_obc ? ctx->snapset_obc : ObjectContextRef());
+    unlock_snapset_obc ? ctx->snapset_obc : ObjectContextRef(),
+    ctx->extra_obcs);
   if (!(ctx->log.empty())) {
     assert(ctx->at_version >= projected_last_update);
     projected_last_update = ctx->at_version;
@@ -9779,11 +9877,30 @@ ObjectContextRef PrimaryLogPG::get_object_context(
     dout(10) << __func__ << ": obc NOT found in cache: " << soid << dendl;
     // check disk
     bufferlist bv;
+    int r = 0;
+    // if we'd otherwise go back to the store for the snapset or, on EC
+    // pools, for the full attr set, fetch everything in one go instead
+    map<string, bufferlist> prefetched;
+    bool prefetched_ss = false;
+    if (!attrs &&
+	cct->_conf->get_val<bool>("osd_object_context_prefetch_attrs") &&
+	(pool.info.require_rollback() ||
+	 (soid.has_snapset() && !have_snapset_context(soid)))) {
+      r = pgbackend->objects_get_attrs(soid, &prefetched);
+      if (r >= 0 && prefetched.count(OI_ATTR)) {
+	attrs = &prefetched;
+	prefetched_ss = prefetched.count(SS_ATTR) &&
+	  !have_snapset_context(soid);
+      } else if (r >= 0) {
+	r = 0;
+      }
+    }
     if (attrs) {
       assert(attrs->count(OI_ATTR));
       bv = attrs->find(OI_ATTR)->second;
     } else {
-      int r = pgbackend->objects_get_attr(soid, OI_ATTR, &bv);
+      if (r >= 0)
+	r = pgbackend->objects_get_attr(soid, OI_ATTR, &bv);
       if (r < 0) {
 	if (!can_create) {
 	  dout(10) << __func__ << ": no obc for soid "
@@ -9826,9 +9943,10 @@ ObjectContextRef PrimaryLogPG::get_object_context(
     obc->obs.oi = oi;
     obc->obs.exists = true;
 
-    obc->ssc = get_snapset_context(
-      soid, true,
-      soid.has_snapset() ? attrs : 0);
+    const map<string, bufferlist> *ss_attrs = 0;
+    if (soid.has_snapset() && (attrs != &prefetched || prefetched_ss))
+      ss_attrs = attrs;
+    obc->ssc = get_snapset_context(soid, true, ss_attrs);
 
     if (is_active())
       populate_obc_watchers(obc);
@@ -10208,6 +10326,18 @@ SnapSetContext *PrimaryLogPG::get_snapset_context(
   SnapSetContext *ssc;
   map<hobject_t, SnapSetContext*>::iterator p = snapset_contexts.find(
     oid.get_snapdir());
+  if (p != snapset_contexts.end() && p->second->cached) {
+    ssc = p->second;
+    snapset_context_lru.erase(ssc->lru_pos);
+    ssc->cached = false;
+    if (attrs) {
+      // the caller has the on-disk attrs (e.g. recovery); prefer those
+      // over what we kept from before
+      snapset_contexts.erase(p);
+      delete ssc;
+      p = snapset_contexts.end();
+    }
+  }
   if (p != snapset_contexts.end()) {
     if (can_create || p->second->exists) {
       ssc = p->second;
@@ -10256,12 +10386,33 @@ void PrimaryLogPG::put_snapset_context(SnapSetContext *ssc)
   Mutex::Locker l(snapset_contexts_lock);
   --ssc->ref;
   if (ssc->ref == 0) {
+    size_t max = cct->_conf->osd_pg_snapset_context_cache_count;
+    if (ssc->registered && ssc->exists && max > 0) {
+      // keep it decoded in case the object is touched again soon
+      ssc->cached = true;
+      ssc->lru_pos = snapset_context_lru.insert(snapset_context_lru.begin(),
+						ssc);
+      _trim_snapset_context_lru(max);
+      return;
+    }
     if (ssc->registered)
       snapset_contexts.erase(ssc->oid);
     delete ssc;
   }
 }
 
+void PrimaryLogPG::_trim_snapset_context_lru(size_t max)
+{
+  assert(snapset_contexts_lock.is_locked());
+  while (snapset_context_lru.size() > max) {
+    SnapSetContext *ssc = snapset_context_lru.back();
+    snapset_context_lru.pop_back();
+    assert(ssc->cached && ssc->ref == 0);
+    snapset_contexts.erase(ssc->oid);
+    delete ssc;
+  }
+}
+
 /** pull - request object from a peer
  */
 
@@ -10964,6 +11115,7 @@ void PrimaryLogPG::on_shutdown()
 
   context_registry_on_change();
   object_contexts.clear();
+  clear_snapset_context_lru();
 
   clear_async_reads();
 
@@ -11137,6 +11289,7 @@ void PrimaryLogPG::on_change(ObjectStore::Transaction *t)
   // NOTE: we actually assert that all currently live references are dead
   // by the time the flush for the next interval completes.
   object_contexts.clear();
+  clear_snapset_context_lru();
 
   // should have been cleared above by finishing all of the degraded objects
   assert(objects_blocked_on_degraded_snap.empty());
@@ -11899,6 +12052,12 @@ uint64_t PrimaryLogPG::recover_backfill(
   vector<boost::tuple<hobject_t, eversion_t, pg_shard_t> > to_remove;
   set<hobject_t> add_to_stat;
 
+  // small objects share a recovery op so that they fill push messages
+  const uint64_t small_size = cct->_conf->osd_backfill_small_object_size;
+  const uint64_t small_batch =
+    std::max<uint64_t>(1, cct->_conf->osd_backfill_small_object_batch);
+  uint64_t small_pushes = 0;
+
   for (set<pg_shard_t>::iterator i = backfill_targets.begin();
        i != backfill_targets.end();
        ++i) {
@@ -12094,7 +12253,10 @@ uint64_t PrimaryLogPG::recover_backfill(
 	    dout(0) << __func__ << " Error " << r << " trying to backfill " << backfill_info.begin << dendl;
 	    break;
 	  }
-	  ops++;
+	  if (small_batch == 1 ||
+	      obc->obs.oi.size > small_size ||
+	      (small_pushes++ % small_batch) == 0)
+	    ops++;
 	} else {
 	  *work_started = true;
 	  dout(20) << "backfill blocking on " << backfill_info.begin
@@ -12386,6 +12548,7 @@ void PrimaryLogPG::scan_range(
   assert(r >= 0);
   dout(10) << " got " << ls.size() << " items, next " << bi->end << dendl;
   dout(20) << ls << dendl;
+  pgbackend->objects_prefetch(ls);
 
   for (vector<hobject_t>::iterator p = ls.begin(); p != ls.end(); ++p) {
     handle.reset_tp_timeout();
@@ -12698,6 +12861,12 @@ void PrimaryLogPG::hit_set_persist()
   dout(20) << __func__ << " archive " << oid << dendl;
 
   if (agent_state) {
+    // age the heat sketch like the HitSet grades; without a grade decay,
+    // let accesses fade out over roughly one HitSet window
+    double decay = pool.info.hit_set_grade_decay_rate ?
+      1.0 - pool.info.hit_set_grade_decay_rate / 100.0 :
+      1.0 - 1.0 / MAX(1u, pool.info.hit_set_count);
+    agent_state->hit_set_archived(decay);
     agent_state->add_hit_set(new_hset.begin, hit_set);
     uint32_t size = agent_state->hit_set_map.size();
     if (size >= pool.info.hit_set_count) {
@@ -12835,6 +13004,10 @@ void PrimaryLogPG::agent_setup()
       info.pgid.pgid,
       rand()));
     agent_state->start = agent_state->position;
+    agent_state->heat.init(
+      cct->_conf->get_val<uint64_t>("osd_agent_heat_sketch_width"));
+    agent_state->recent.init(
+      cct->_conf->get_val<uint64_t>("osd_tier_recency_index_size"));
 
     dout(10) << __func__ << " allocated new state, position "
 	     << agent_state->position << dendl;
@@ -12903,7 +13076,7 @@ bool PrimaryLogPG::agent_work(int start_max, int agent_flush_quota)
 					  &ls, &next);
   assert(r >= 0);
   dout(20) << __func__ << " got " << ls.size() << " objects" << dendl;
-  int started = 0;
+  vector<ObjectContextRef> candidates;
   for (vector<hobject_t>::iterator p = ls.begin();
        p != ls.end();
        ++p) {
@@ -12958,19 +13131,52 @@ bool PrimaryLogPG::agent_work(int start_max, int agent_flush_quota)
       continue;
     }
 
-    if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE &&
-	agent_maybe_evict(obc, false))
-      ++started;
-    else if (agent_state->flush_mode != TierAgentState::FLUSH_MODE_IDLE &&
-             agent_flush_quota > 0 && agent_maybe_flush(obc)) {
-      ++started;
-      --agent_flush_quota;
+    candidates.push_back(obc);
+  }
+
+  // treat the listing as a sample: spend the eviction budget on its
+  // coldest clean objects first, then flush dirty objects in listing order
+  int started = 0;
+  vector<bool> examined(candidates.size(), false);
+  if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE) {
+    vector<pair<int,unsigned> > by_temp;  // (temp, candidate index)
+    for (unsigned i = 0; i < candidates.size(); ++i) {
+      if (candidates[i]->obs.oi.is_dirty())
+	continue;
+      int temp = 0;
+      if (hit_set)
+	agent_estimate_temp(candidates[i]->obs.oi.soid, &temp);
+      by_temp.push_back(make_pair(temp, i));
+    }
+    std::stable_sort(by_temp.begin(), by_temp.end());
+    for (auto& t : by_temp) {
+      if (started >= start_max)
+	break;
+      examined[t.second] = true;
+      if (agent_maybe_evict(candidates[t.second], false))
+	++started;
     }
-    if (started >= start_max) {
-      // If finishing early, set "next" to the next object
-      if (++p != ls.end())
-	next = *p;
-      break;
+  }
+  if (agent_state->flush_mode != TierAgentState::FLUSH_MODE_IDLE) {
+    for (unsigned i = 0;
+	 i < candidates.size() && started < start_max && agent_flush_quota > 0;
+	 ++i) {
+      if (examined[i])
+	continue;
+      examined[i] = true;
+      if (agent_maybe_flush(candidates[i])) {
+	++started;
+	--agent_flush_quota;
+      }
+    }
+  }
+  if (started >= start_max) {
+    // If finishing early, resume from the first object we didn't get to
+    for (unsigned i = 0; i < candidates.size(); ++i) {
+      if (!examined[i]) {
+	next = candidates[i]->obs.oi.soid;
+	break;
+      }
     }
   }
 
@@ -13499,6 +13705,12 @@ void PrimaryLogPG::agent_estimate_temp(const hobject_t& oid, int *temp)
   assert(hit_set);
   assert(temp);
   *temp = 0;
+  if (!agent_state->heat.empty() &&
+      agent_state->heat_intervals >= pool.info.hit_set_count) {
+    *temp = MIN(agent_state->heat.estimate(oid.get_hash()),
+		(uint32_t)INT_MAX);
+    return;
+  }
   if (hit_set->contains(oid))
     *temp = 1000000;
   unsigned i = 0;
@@ -14220,8 +14432,10 @@ void PrimaryLogPG::_scrub_finish()
     share_pg_info();
   }
   // Clear object context cache to get repair information
-  if (repair)
+  if (repair) {
     object_contexts.clear();
+    clear_snapset_context_lru();
+  }
 }
 
 bool PrimaryLogPG::check_osdmap_full(const set<pg_shard_t> &missing_on)
@@ -14398,7 +14612,9 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   ldout(pg->cct, 10) << "AwaitAsyncWork: trimming snap " << snap_to_trim << dendl;
 
   vector<hobject_t> to_trim;
-  unsigned max = pg->cct->_conf->osd_pg_max_concurrent_snap_trims;
+  unsigned per_txn = std::max<uint64_t>(
+    1, pg->cct->_conf->get_val<uint64_t>("osd_snap_trim_objects_per_txn"));
+  unsigned max = pg->cct->_conf->osd_pg_max_concurrent_snap_trims * per_txn;
   to_trim.reserve(max);
   int r = pg->snap_mapper.get_next_objects_to_trim(
     snap_to_trim,
@@ -14433,11 +14649,44 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   }
   assert(!to_trim.empty());
 
+  // clones are trimmed per_txn at a time, each batch in one repop
+  OpContextUPtr ctx;
+  set<hobject_t> batch;
+  set<hobject_t> batch_heads;
+  auto submit_batch = [&]() {
+    for (auto &object : batch)
+      in_flight.insert(object);
+    ctx->register_on_success(
+      [pg, batch, &in_flight]() {
+	for (auto &object : batch) {
+	  assert(in_flight.find(object) != in_flight.end());
+	  in_flight.erase(object);
+	}
+	if (in_flight.empty()) {
+	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
+	    pg->snap_trimmer_machine.process_event(Reset());
+	  } else {
+	    pg->snap_trimmer_machine.process_event(RepopsComplete());
+	  }
+	}
+      });
+    pg->osd->charge_snap_trim(
+      batch.size(),
+      ctx->delta_stats.num_bytes < 0 ? -ctx->delta_stats.num_bytes : 0);
+    pg->simple_opc_submit(std::move(ctx));
+    batch.clear();
+    batch_heads.clear();
+  };
+
   for (auto &&object: to_trim) {
+    // a transaction updates each snapset only once
+    if (batch_heads.count(object.get_head()))
+      submit_batch();
+
     // Get next
     ldout(pg->cct, 10) << "AwaitAsyncWork react trimming " << object << dendl;
-    OpContextUPtr ctx;
-    int error = pg->trim_object(in_flight.empty(), object, &ctx);
+    int error = pg->trim_object(in_flight.empty() && batch.empty(), object,
+				&ctx);
     if (error) {
       if (error == -ENOLCK) {
 	ldout(pg->cct, 10) << "could not get write lock on obj "
@@ -14446,6 +14695,8 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
 	pg->state_set(PG_STATE_SNAPTRIM_ERROR);
 	ldout(pg->cct, 10) << "Snaptrim error=" << error << dendl;
       }
+      if (!batch.empty())
+	submit_batch();
       if (!in_flight.empty()) {
 	ldout(pg->cct, 10) << "letting the ones we already started finish" << dendl;
 	return transit< WaitRepops >();
@@ -14459,22 +14710,13 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
       }
     }
 
-    in_flight.insert(object);
-    ctx->register_on_success(
-      [pg, object, &in_flight]() {
-	assert(in_flight.find(object) != in_flight.end());
-	in_flight.erase(object);
-	if (in_flight.empty()) {
-	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
-	    pg->snap_trimmer_machine.process_event(Reset());
-	  } else {
-	    pg->snap_trimmer_machine.process_event(RepopsComplete());
-	  }
-	}
-      });
-
-    pg->simple_opc_submit(std::move(ctx));
+    batch.insert(object);
+    batch_heads.insert(object.get_head());
+    if (batch.size() >= per_txn)
+      submit_batch();
   }
+  if (!batch.empty())
+    submit_batch();
 
   return transit< WaitRepops >();
 }
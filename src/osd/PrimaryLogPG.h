@@ -430,6 +430,16 @@ public:
 
   void schedule_recovery_work(
     GenContext<ThreadPool::TPHandle&> *c) override;
+  void schedule_read_work(
+    GenContext<ThreadPool::TPHandle&> *c) override;
+
+  /// true if a replica can read oid without seeing a write that might
+  /// not survive or that the primary has already acked
+  bool can_serve_replica_read(const hobject_t &oid);
+
+  void schedule_event_after(
+    double delay,
+    Context *c) override;
 
   pg_shard_t whoami_shard() const override {
     return pg_whoami;
@@ -537,6 +547,7 @@ public:
     ObjectContextRef obc;
     ObjectContextRef clone_obc;    // if we created a clone
     ObjectContextRef snapset_obc;  // if we created/deleted a snapdir
+    vector<ObjectContextRef> extra_obcs; // other objects in a multi-object op (snap trim)
 
     // FIXME: we may want to kill this msgr hint off at some point!
     boost::optional<int> data_off = boost::none;
@@ -940,6 +951,8 @@ protected:
   SharedLRU<hobject_t, ObjectContext> object_contexts;
   // map from oid.snapdir() to SnapSetContext *
   map<hobject_t, SnapSetContext*> snapset_contexts;
+  // unreferenced but still registered SnapSetContexts, most recent first
+  list<SnapSetContext*> snapset_context_lru;
   Mutex snapset_contexts_lock;
 
   // debug order that client ops are applied
@@ -994,6 +1007,15 @@ protected:
     }
   }
   void put_snapset_context(SnapSetContext *ssc);
+  bool have_snapset_context(const hobject_t& oid) {
+    Mutex::Locker l(snapset_contexts_lock);
+    return snapset_contexts.count(oid.get_snapdir());
+  }
+  void _trim_snapset_context_lru(size_t max);
+  void clear_snapset_context_lru() {
+    Mutex::Locker l(snapset_contexts_lock);
+    _trim_snapset_context_lru(0);
+  }
 
   map<hobject_t, ObjectContextRef> recovering;
 
@@ -1338,6 +1360,12 @@ protected:
   friend class C_ExtentCmpRead;
 
   int do_read(OpContext *ctx, OSDOp& osd_op);
+  /// true if a replicated pool read this long should not hold the pg lock
+  bool use_async_read(uint64_t length) const {
+    uint64_t min = cct->_conf->get_val<uint64_t>(
+      "osd_replicated_async_read_min_bytes");
+    return min && length >= min;
+  }
   int do_sparse_read(OpContext *ctx, OSDOp& osd_op);
   int do_writesame(OpContext *ctx, OSDOp& osd_op);
 
@@ -1396,6 +1424,7 @@ public:
 
   void handle_backoff(OpRequestRef& op);
 
+  /// trim coid into *ctxp, starting a new context if it is empty
   int trim_object(bool first, const hobject_t &coid, OpContextUPtr *ctxp);
   void snap_trimmer(epoch_t e) override;
   void kick_snap_trim() override;
@@ -1550,11 +1579,12 @@ private:
 	}
       };
       auto *pg = context< SnapTrimmer >().pg;
-      if (pg->cct->_conf->osd_snap_trim_sleep > 0) {
+      double delay = std::max(pg->cct->_conf->osd_snap_trim_sleep,
+			      pg->osd->get_snap_trim_delay());
+      if (delay > 0) {
 	wakeup = new OnTimer{pg, pg->get_osdmap()->get_epoch()};
 	Mutex::Locker l(pg->osd->snap_sleep_lock);
-	pg->osd->snap_sleep_timer.add_event_after(
-	  pg->cct->_conf->osd_snap_trim_sleep, wakeup);
+	pg->osd->snap_sleep_timer.add_event_after(delay, wakeup);
       } else {
 	post_event(SnapTrimTimerReady());
       }
@@ -0,0 +1,108 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+
+#include "RecoveryController.h"
+
+// first sleep step once recovery is down to a single op
+static const double min_sleep = 0.01;
+
+RecoveryController::RecoveryController()
+  : max_active(1), max_backfills(1), sleep(0), last_p99_ms(0), last_ops(0)
+{
+  for (unsigned b = 0; b < num_buckets; ++b) {
+    buckets[b] = 0;
+    last[b] = 0;
+  }
+}
+
+void RecoveryController::reset(const Params &p)
+{
+  for (unsigned b = 0; b < num_buckets; ++b)
+    last[b] = buckets[b].load(std::memory_order_relaxed);
+  ticks_waiting = 0;
+  max_active = std::max(1u, p.max_active);
+  max_backfills = std::max(1u, p.max_backfills);
+  sleep = 0;
+  last_p99_ms = 0;
+  last_ops = 0;
+}
+
+bool RecoveryController::update(const Params &p)
+{
+  uint64_t delta[num_buckets];
+  uint64_t ops = 0;
+  for (unsigned b = 0; b < num_buckets; ++b) {
+    delta[b] = buckets[b].load(std::memory_order_relaxed) - last[b];
+    ops += delta[b];
+  }
+  // a handful of ops says little about the p99; wait for more unless
+  // the client load is that light for a while
+  if (ops > 0 && ops < min_samples && ++ticks_waiting < min_samples_ticks)
+    return false;
+  for (unsigned b = 0; b < num_buckets; ++b)
+    last[b] += delta[b];
+  ticks_waiting = 0;
+
+  double p99_ms = 0;
+  if (ops) {
+    // walk down from the slowest bucket to the one holding the p99 op,
+    // and interpolate within it
+    uint64_t above = ops / 100;
+    unsigned b = num_buckets - 1;
+    while (b > 0 && delta[b] <= above) {
+      above -= delta[b];
+      --b;
+    }
+    double lo = bucket_floor(b);
+    double hi = bucket_floor(b + 1);
+    double frac = delta[b] ? (double)above / delta[b] : 0;
+    p99_ms = (hi - (hi - lo) * frac) / 1000.0;
+  }
+  last_p99_ms = p99_ms;
+  last_ops = ops;
+
+  unsigned active = std::min(max_active.load(), std::max(1u, p.max_active));
+  double s = std::min(sleep.load(), p.max_sleep);
+  if (ops && p99_ms > p.target_p99_ms) {
+    if (active > 1)
+      active /= 2;
+    else
+      s = std::min(p.max_sleep, s > 0 ? s * 2 : min_sleep);
+  } else if (!ops || p99_ms < p.target_p99_ms * 0.8) {
+    if (s > 0)
+      s = s / 2 < min_sleep ? 0 : s / 2;
+    else if (active < p.max_active)
+      ++active;
+  }
+  unsigned ceil_active = std::max(1u, p.max_active);
+  unsigned backfills = std::max(
+    1u, (std::max(1u, p.max_backfills) * active + ceil_active - 1) /
+    ceil_active);
+
+  bool changed = active != max_active || backfills != max_backfills ||
+    s != sleep;
+  max_active = active;
+  max_backfills = backfills;
+  sleep = s;
+  return changed;
+}
+
+void RecoveryController::dump(Formatter *f) const
+{
+  f->dump_unsigned("max_active", max_active);
+  f->dump_unsigned("max_backfills", max_backfills);
+  f->dump_float("sleep", sleep);
+  f->dump_float("client_p99_ms", last_p99_ms);
+  f->dump_unsigned("client_ops", last_ops);
+}
@@ -0,0 +1,95 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_RECOVERYCONTROLLER_H
+#define CEPH_OSD_RECOVERYCONTROLLER_H
+
+#include <atomic>
+
+#include "common/Formatter.h"
+#include "include/utime.h"
+
+/**
+ * RecoveryController
+ *
+ * Feedback control of recovery/backfill throttles from client latency.
+ * Op threads record each client op's latency into a log-scale histogram;
+ * once per tick update() takes the p99 of the ops seen since the last
+ * decision and adjusts the limits AIMD style: over the target halves
+ * the active recovery ops, and at one op adds (then doubles) a sleep
+ * between recovery ops; comfortably under the target or with no client
+ * load it first removes the sleep, then adds one op at a time.  The
+ * backfill slot count follows the recovery op count proportionally.
+ */
+class RecoveryController {
+public:
+  struct Params {
+    double target_p99_ms = 50;   ///< client latency to stay under
+    unsigned max_active = 16;    ///< ceiling for recovery ops
+    unsigned max_backfills = 4;  ///< ceiling for backfill reservations
+    double max_sleep = 0.1;      ///< ceiling for inter-op recovery sleep
+  };
+
+  /// ops wanted before deciding, unless idle or min_samples_ticks passed
+  static const uint64_t min_samples = 20;
+  static const unsigned min_samples_ticks = 5;
+
+private:
+  // latency buckets in us: four per power of two, so a p99 is known to
+  // within 25%, which is good enough to steer by
+  static const unsigned num_buckets = 128;
+  std::atomic<uint64_t> buckets[num_buckets];
+  uint64_t last[num_buckets];   ///< bucket counts at the last decision
+  unsigned ticks_waiting = 0;
+
+  std::atomic<unsigned> max_active;
+  std::atomic<unsigned> max_backfills;
+  std::atomic<double> sleep;
+  std::atomic<double> last_p99_ms;
+  std::atomic<uint64_t> last_ops;
+
+public:
+  RecoveryController();
+
+  static unsigned bucket_of(uint64_t us) {
+    if (us < 4)
+      return us;
+    unsigned msb = 63 - __builtin_clzll(us);
+    unsigned b = 4 * (msb - 1) + ((us >> (msb - 2)) & 3);
+    return b < num_buckets ? b : num_buckets - 1;
+  }
+  /// smallest latency (us) in bucket b
+  static uint64_t bucket_floor(unsigned b) {
+    if (b < 4)
+      return b;
+    return (uint64_t)(4 + b % 4) << (b / 4 - 1);
+  }
+
+  void record_client_op(utime_t latency) {
+    buckets[bucket_of(latency.to_nsec() / 1000)].fetch_add(
+      1, std::memory_order_relaxed);
+  }
+
+  /// start over from the ceilings, e.g. when tuning is switched on
+  void reset(const Params &p);
+
+  /// decide on new limits; returns true if any of them changed
+  bool update(const Params &p);
+
+  unsigned get_max_active() const { return max_active; }
+  unsigned get_max_backfills() const { return max_backfills; }
+  double get_sleep() const { return sleep; }
+
+  void dump(Formatter *f) const;
+};
+
+#endif // CEPH_OSD_RECOVERYCONTROLLER_H
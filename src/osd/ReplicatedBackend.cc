@@ -262,7 +262,10 @@ void ReplicatedBackend::on_change()
     if (i->second.on_applied)
       delete i->second.on_applied;
   }
+  async_reads.clear();
   clear_recovery_state();
+  chain_mode = CHAIN_UNDECIDED;
+  replication_chain.clear();
 }
 
 void ReplicatedBackend::on_flushed()
@@ -279,18 +282,88 @@ int ReplicatedBackend::objects_read_sync(
   return store->read(ch, ghobject_t(hoid), off, len, *bl, op_flags);
 }
 
-struct AsyncReadCallback : public GenContext<ThreadPool::TPHandle&> {
-  int r;
-  Context *c;
-  AsyncReadCallback(int r, Context *c) : r(r), c(c) {}
+struct ReplicatedBackend::AsyncRead {
+  list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
+	    pair<bufferlist*, Context*> > > to_read;
+  vector<bufferlist> bls;
+  vector<int> rs;
+  Context *on_complete;
+  bool done;
+
+  AsyncRead(const list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
+			    pair<bufferlist*, Context*> > > &to_read,
+	    Context *on_complete)
+    : to_read(to_read), bls(to_read.size()), rs(to_read.size(), 0),
+      on_complete(on_complete), done(false) {}
+  ~AsyncRead() {
+    for (auto &i : to_read)
+      delete i.second.second;
+    delete on_complete;
+  }
+
+  void complete() {
+    int r = 0;
+    unsigned n = 0;
+    for (auto i = to_read.begin(); i != to_read.end() && r >= 0; ++i, ++n) {
+      i->second.first->claim_append(bls[n]);
+      if (i->second.second) {
+	i->second.second->complete(rs[n]);
+	i->second.second = nullptr;
+      }
+      if (rs[n] < 0)
+	r = rs[n];
+    }
+    on_complete->complete(r);
+    on_complete = nullptr;
+  }
+};
+
+// runs on the async read pool without the pg lock; the results are only
+// handed to the caller's buffers by the blessed completion
+struct C_ReplicatedAsyncRead : public GenContext<ThreadPool::TPHandle&> {
+  ObjectStore *store;
+  ObjectStore::CollectionHandle ch;
+  ghobject_t oid;
+  ReplicatedBackend::AsyncReadRef read;
+  PGBackend::Listener *parent;
+  GenContext<ThreadPool::TPHandle&> *on_done;
+  C_ReplicatedAsyncRead(ObjectStore *store, ObjectStore::CollectionHandle ch,
+			const hobject_t &hoid,
+			ReplicatedBackend::AsyncReadRef read,
+			PGBackend::Listener *parent,
+			GenContext<ThreadPool::TPHandle&> *on_done)
+    : store(store), ch(ch), oid(hoid), read(read), parent(parent),
+      on_done(on_done) {}
   void finish(ThreadPool::TPHandle&) override {
-    c->complete(r);
-    c = NULL;
+    unsigned n = 0;
+    for (auto &i : read->to_read) {
+      read->rs[n] = store->read(ch, oid, i.first.get<0>(), i.first.get<1>(),
+				read->bls[n], i.first.get<2>());
+      if (read->rs[n] < 0)
+	break;
+      ++n;
+    }
+    // on_done holds a pg ref, so the pg is still around to queue it
+    parent->schedule_recovery_work(on_done);
+    on_done = nullptr;
   }
-  ~AsyncReadCallback() override {
-    delete c;
+  ~C_ReplicatedAsyncRead() override {
+    delete on_done;
   }
 };
+
+struct C_ReplicatedAsyncReadDone : public GenContext<ThreadPool::TPHandle&> {
+  ReplicatedBackend *pg;
+  ReplicatedBackend::AsyncReadRef read;
+  C_ReplicatedAsyncReadDone(ReplicatedBackend *pg,
+			    ReplicatedBackend::AsyncReadRef read)
+    : pg(pg), read(read) {}
+  void finish(ThreadPool::TPHandle&) override {
+    read->done = true;
+    pg->finish_async_reads();
+  }
+};
+
 void ReplicatedBackend::objects_read_async(
   const hobject_t &hoid,
   const list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
@@ -301,26 +374,25 @@ void ReplicatedBackend::objects_read_async(
   // There is no fast read implementation for replication backend yet
   assert(!fast_read);
 
-  int r = 0;
-  for (list<pair<boost::tuple<uint64_t, uint64_t, uint32_t>,
-		 pair<bufferlist*, Context*> > >::const_iterator i =
-	   to_read.begin();
-       i != to_read.end() && r >= 0;
-       ++i) {
-    int _r = store->read(ch, ghobject_t(hoid), i->first.get<0>(),
-			 i->first.get<1>(), *(i->second.first),
-			 i->first.get<2>());
-    if (i->second.second) {
-      get_parent()->schedule_recovery_work(
-	get_parent()->bless_gencontext(
-	  new AsyncReadCallback(_r, i->second.second)));
-    }
-    if (_r < 0)
-      r = _r;
+  AsyncReadRef read(std::make_shared<AsyncRead>(to_read, on_complete));
+  async_reads.push_back(read);
+  dout(20) << __func__ << " " << hoid << " " << to_read.size()
+	   << " extents, " << async_reads.size() << " in flight" << dendl;
+  get_parent()->schedule_read_work(
+    new C_ReplicatedAsyncRead(
+      store, ch, hoid, read, get_parent(),
+      get_parent()->bless_gencontext(
+	new C_ReplicatedAsyncReadDone(this, read))));
+}
+
+void ReplicatedBackend::finish_async_reads()
+{
+  // callers expect their reads back in the order they were issued
+  while (!async_reads.empty() && async_reads.front()->done) {
+    AsyncReadRef read = async_reads.front();
+    async_reads.pop_front();
+    read->complete();
   }
-  get_parent()->schedule_recovery_work(
-    get_parent()->bless_gencontext(
-      new AsyncReadCallback(r, on_complete)));
 }
 
 class C_OSD_OnOpCommit : public Context {
@@ -618,8 +690,13 @@ void ReplicatedBackend::op_commit(
   }
 
   op->waiting_for_commit.erase(get_parent()->whoami_shard());
+  utime_t now = ceph_clock_now();
+  get_parent()->get_logger()->tinc(l_osd_op_w_local_commit_lat,
+				   now - op->start);
 
   if (op->waiting_for_commit.empty()) {
+    get_parent()->get_logger()->tinc(l_osd_op_w_all_commit_lat,
+				     now - op->start);
     op->on_commit->complete(0);
     op->on_commit = 0;
   }
@@ -665,6 +742,8 @@ void ReplicatedBackend::do_repop_reply(OpRequestRef op)
     if (r->ack_type & CEPH_OSD_FLAG_ONDISK) {
       assert(ip_op.waiting_for_commit.count(from));
       ip_op.waiting_for_commit.erase(from);
+      get_parent()->get_logger()->tinc(l_osd_op_w_repop_lat,
+				       ceph_clock_now() - ip_op.start);
       if (ip_op.op) {
         ostringstream ss;
         ss << "sub_op_commit_rec from " << from;
@@ -693,6 +772,8 @@ void ReplicatedBackend::do_repop_reply(OpRequestRef op)
     }
     if (ip_op.waiting_for_commit.empty() &&
         ip_op.on_commit) {
+      get_parent()->get_logger()->tinc(l_osd_op_w_all_commit_lat,
+				       ceph_clock_now() - ip_op.start);
       ip_op.on_commit->complete(0);
       ip_op.on_commit= 0;
     }
@@ -711,36 +792,27 @@ void ReplicatedBackend::be_deep_scrub(
 {
   dout(10) << __func__ << " " << poid << " seed " 
 	   << std::hex << seed << std::dec << dendl;
-  bufferhash h(seed), oh(seed);
+  bufferhash oh(seed);
   bufferlist bl, hdrbl;
   int r;
-  __u64 pos = 0;
+  uint32_t digest = seed;
 
   uint32_t fadvise_flags = CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL | CEPH_OSD_OP_FLAG_FADVISE_DONTNEED;
 
-  while (true) {
-    handle.reset_tp_timeout();
-    r = store->read(
-	  ch,
-	  ghobject_t(
-	    poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-	  pos,
-	  cct->_conf->osd_deep_scrub_stride, bl,
-	  fadvise_flags);
-    if (r <= 0)
-      break;
-
-    h << bl;
-    pos += bl.length();
-    bl.clear();
-  }
+  handle.reset_tp_timeout();
+  r = store->data_digest(
+    ch,
+    ghobject_t(
+      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+    cct->_conf->osd_deep_scrub_stride, seed, &digest, nullptr,
+    fadvise_flags);
   if (r == -EIO) {
     dout(25) << __func__ << "  " << poid << " got "
 	     << r << " on read, read_error" << dendl;
     o.read_error = true;
     return;
   }
-  o.digest = h.digest();
+  o.digest = digest;
   o.digest_present = true;
 
   bl.clear();
@@ -971,9 +1043,11 @@ Message * ReplicatedBackend::generate_subop(
   eversion_t pg_roll_forward_to,
   hobject_t new_temp_oid,
   hobject_t discard_temp_oid,
-  const vector<pg_log_entry_t> &log_entries,
+  const bufferlist &log_bl,
   boost::optional<pg_hit_set_history_t> &hset_hist,
-  ObjectStore::Transaction &op_t,
+  const bufferlist &txn_bl,
+  const bufferlist &empty_txn_bl,
+  uint32_t data_off,
   pg_shard_t peer,
   const pg_info_t &pinfo)
 {
@@ -994,14 +1068,13 @@ Message * ReplicatedBackend::generate_subop(
 	     << " beyond MAX(last_backfill_started "
 	     << ", pinfo.last_backfill "
 	     << pinfo.last_backfill << ")" << dendl;
-    ObjectStore::Transaction t;
-    ::encode(t, wr->get_data());
+    wr->set_data(empty_txn_bl);
   } else {
-    ::encode(op_t, wr->get_data());
-    wr->get_header().data_off = op_t.get_data_alignment();
+    wr->set_data(txn_bl);
+    wr->get_header().data_off = data_off;
   }
 
-  ::encode(log_entries, wr->logbl);
+  wr->logbl = log_bl;
 
   if (pinfo.is_incomplete())
     wr->pg_stats = pinfo.stats;  // reflects backfill progress
@@ -1034,20 +1107,52 @@ void ReplicatedBackend::issue_op(
   if (op->op)
     op->op->pg_trace.event("issue replication ops");
 
+  // Encode the transaction and log entries once for all replicas.  The
+  // messages share the same buffers, so only the per-peer front differs
+  // and the data crc computed for the first message is served from the
+  // buffer crc cache for the others.
+  bufferlist txn_bl, empty_txn_bl, log_bl;
+  uint32_t data_off = 0;
   if (parent->get_actingbackfill_shards().size() > 1) {
-    ostringstream ss;
-    set<pg_shard_t> replicas = parent->get_actingbackfill_shards();
-    replicas.erase(parent->whoami_shard());
-    ss << "waiting for subops from " << replicas;
-    if (op->op)
-      op->op->mark_sub_op_sent(ss.str());
+    ::encode(op_t, txn_bl);
+    data_off = op_t.get_data_alignment();
+    ObjectStore::Transaction empty;
+    ::encode(empty, empty_txn_bl);
+    ::encode(log_entries, log_bl);
+  }
+
+  // with chain replication only the head of the chain hears from us; each
+  // replica passes the op on to the next one and acks to us directly
+  if (chain_mode == CHAIN_UNDECIDED) {
+    replication_chain.clear();
+    if (get_parent()->get_pool().has_flag(
+	  pg_pool_t::FLAG_CHAIN_REPLICATION) &&
+	build_replication_chain(parent->whoami_shard(),
+				parent->get_actingbackfill_shards(),
+				parent->get_backfill_shards(),
+				parent->get_shard_info(),
+				&replication_chain)) {
+      chain_mode = CHAIN_ON;
+    } else {
+      chain_mode = CHAIN_OFF;
+    }
+    dout(10) << __func__ << " chain replication "
+	     << (chain_mode == CHAIN_ON ? "on" : "off") << " for this interval"
+	     << dendl;
   }
+  const bool chained = chain_mode == CHAIN_ON;
+  const vector<pg_shard_t> &chain = replication_chain;
+
   for (set<pg_shard_t>::const_iterator i =
 	 parent->get_actingbackfill_shards().begin();
        i != parent->get_actingbackfill_shards().end();
        ++i) {
     if (*i == parent->whoami_shard()) continue;
     pg_shard_t peer = *i;
+    if (chained) {
+      if (peer != chain.front())
+	continue;
+    }
     const pg_info_t &pinfo = parent->get_shard_info().find(peer)->second;
 
     Message *wr;
@@ -1060,16 +1165,93 @@ void ReplicatedBackend::issue_op(
       pg_roll_forward_to,
       new_temp_oid,
       discard_temp_oid,
-      log_entries,
+      log_bl,
       hset_hist,
-      op_t,
+      txn_bl,
+      empty_txn_bl,
+      data_off,
       peer,
       pinfo);
+    if (chained) {
+      static_cast<MOSDRepOp*>(wr)->forward_to.assign(
+	chain.begin() + 1, chain.end());
+    }
     if (op->op)
       wr->trace.init("replicated op", nullptr, &op->op->pg_trace);
     get_parent()->send_message_osd_cluster(
       peer.osd, wr, get_osdmap()->get_epoch());
   }
+
+  // the event string is only for op tracking; build it once the replicas
+  // are already working on the op
+  if (op->op && parent->get_actingbackfill_shards().size() > 1) {
+    ostringstream ss;
+    set<pg_shard_t> replicas = parent->get_actingbackfill_shards();
+    replicas.erase(parent->whoami_shard());
+    ss << "waiting for subops from " << replicas;
+    op->op->mark_sub_op_sent(ss.str());
+  }
+}
+
+bool ReplicatedBackend::build_replication_chain(
+  pg_shard_t whoami,
+  const set<pg_shard_t> &actingbackfill,
+  const set<pg_shard_t> &backfill,
+  const map<pg_shard_t, pg_info_t> &shard_info,
+  vector<pg_shard_t> *chain)
+{
+  if (!backfill.empty())
+    return false;
+  for (auto &peer : actingbackfill) {
+    if (peer == whoami)
+      continue;
+    auto p = shard_info.find(peer);
+    if (p == shard_info.end() || p->second.is_incomplete()) {
+      chain->clear();
+      return false;
+    }
+    chain->push_back(peer);
+  }
+  if (chain->size() < 2) {
+    chain->clear();
+    return false;
+  }
+  return true;
+}
+
+MOSDRepOp *ReplicatedBackend::make_forwarded_repop(const MOSDRepOp *m)
+{
+  pg_shard_t next = m->forward_to.front();
+  MOSDRepOp *wr = new MOSDRepOp(
+    m->reqid, m->from,
+    spg_t(m->pgid.pgid, next.shard),
+    m->poid, m->acks_wanted,
+    m->map_epoch, m->min_epoch,
+    m->get_tid(), m->version);
+  wr->set_data(m->get_data());
+  wr->get_header().data_off = m->get_header().data_off;
+  wr->logbl = m->logbl;
+  wr->pg_stats = m->pg_stats;
+  wr->pg_trim_to = m->pg_trim_to;
+  wr->pg_roll_forward_to = m->pg_roll_forward_to;
+  wr->new_temp_oid = m->new_temp_oid;
+  wr->discard_temp_oid = m->discard_temp_oid;
+  wr->updated_hit_set_history = m->updated_hit_set_history;
+  wr->forward_to.assign(m->forward_to.begin() + 1, m->forward_to.end());
+  return wr;
+}
+
+void ReplicatedBackend::forward_repop(OpRequestRef op)
+{
+  const MOSDRepOp *m = static_cast<const MOSDRepOp *>(op->get_req());
+  pg_shard_t next = m->forward_to.front();
+  dout(20) << __func__ << " " << m->poid << " v " << m->version
+	   << " to " << next << dendl;
+
+  MOSDRepOp *wr = make_forwarded_repop(m);
+  wr->trace.init("replicated op", nullptr, &op->pg_trace);
+  get_parent()->send_message_osd_cluster(
+    next.osd, wr, get_osdmap()->get_epoch());
 }
 
 // sub op modify
@@ -1094,10 +1276,15 @@ void ReplicatedBackend::do_repop(OpRequestRef op)
   // we better not be missing this.
   assert(!parent->get_log().get_missing().is_missing(soid));
 
-  int ackerosd = m->get_source().num();
+  // acks always go to the primary, which may not be who sent us the op
+  // under chain replication
+  int ackerosd = m->from.osd;
 
   op->mark_started();
 
+  if (!m->forward_to.empty())
+    forward_repop(op);
+
   RepModifyRef rm(std::make_shared<RepModify>());
   rm->op = op;
   rm->ackerosd = ackerosd;
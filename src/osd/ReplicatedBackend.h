@@ -20,6 +20,7 @@
 #include "include/memory.h"
 
 struct C_ReplicatedBackend_OnPullComplete;
+class MOSDRepOp;
 class ReplicatedBackend : public PGBackend {
   struct RPGHandle : public PGBackend::RecoveryHandle {
     map<pg_shard_t, vector<PushOp> > pushes;
@@ -68,6 +69,20 @@ public:
 
   void on_change() override;
   void clear_recovery_state() override;
+
+  /**
+   * Order the peers into a replication chain.  Every peer must take the
+   * same full transaction and stats, so there is no chain while any of
+   * them is a backfill target or incomplete, or with fewer than two.
+   */
+  static bool build_replication_chain(
+    pg_shard_t whoami,
+    const set<pg_shard_t> &actingbackfill,
+    const set<pg_shard_t> &backfill,
+    const map<pg_shard_t, pg_info_t> &shard_info,
+    vector<pg_shard_t> *chain);
+  /// the copy of a chained repop that m's receiver passes down the chain
+  static MOSDRepOp *make_forwarded_repop(const MOSDRepOp *m);
   void on_flushed() override;
 
   class RPCRecPred : public IsPGRecoverablePredicate {
@@ -161,6 +176,14 @@ public:
                bool fast_read = false) override;
 
 private:
+  // async reads run off the pg lock and complete in submission order
+  struct AsyncRead;
+  typedef ceph::shared_ptr<AsyncRead> AsyncReadRef;
+  list<AsyncReadRef> async_reads;
+  void finish_async_reads();
+  friend struct C_ReplicatedAsyncRead;
+  friend struct C_ReplicatedAsyncReadDone;
+
   // push
   struct PushInfo {
     ObjectRecoveryProgress recovery_progress;
@@ -337,17 +360,32 @@ private:
     Context *on_applied;
     OpRequestRef op;
     eversion_t v;
+    utime_t start;  ///< when the transaction was submitted
     InProgressOp(
       ceph_tid_t tid, Context *on_commit, Context *on_applied,
       OpRequestRef op, eversion_t v)
       : tid(tid), on_commit(on_commit), on_applied(on_applied),
-	op(op), v(v) {}
+	op(op), v(v), start(ceph_clock_now()) {}
     bool done() const {
       return waiting_for_commit.empty() &&
 	waiting_for_applied.empty();
     }
   };
   map<ceph_tid_t, InProgressOp> in_progress_ops;
+
+  /**
+   * Chain replication is decided once per interval, on the first write
+   * after peering, and only reset by on_change().  Switching mid-interval
+   * would let a fanned-out op overtake an earlier chained one on its way
+   * to the tail replica, which would then see log entries out of order.
+   */
+  enum {
+    CHAIN_UNDECIDED,
+    CHAIN_OFF,
+    CHAIN_ON,
+  } chain_mode = CHAIN_UNDECIDED;
+  vector<pg_shard_t> replication_chain;
+
 public:
   friend class C_OSD_OnOpCommit;
   friend class C_OSD_OnOpApplied;
@@ -385,9 +423,11 @@ private:
     eversion_t pg_roll_forward_to,
     hobject_t new_temp_oid,
     hobject_t discard_temp_oid,
-    const vector<pg_log_entry_t> &log_entries,
+    const bufferlist &log_bl,
     boost::optional<pg_hit_set_history_t> &hset_history,
-    ObjectStore::Transaction &op_t,
+    const bufferlist &txn_bl,
+    const bufferlist &empty_txn_bl,
+    uint32_t data_off,
     pg_shard_t peer,
     const pg_info_t &pinfo);
   void issue_op(
@@ -403,6 +443,7 @@ private:
     boost::optional<pg_hit_set_history_t> &hset_history,
     InProgressOp *op,
     ObjectStore::Transaction &op_t);
+  void forward_repop(OpRequestRef op);
   void op_applied(InProgressOp *op);
   void op_commit(InProgressOp *op);
   void do_repop_reply(OpRequestRef op);
@@ -345,6 +345,41 @@ int SnapMapper::_remove_oid(
   return 0;
 }
 
+int SnapMapper::remove_oids(
+  const vector<hobject_t> &oids,
+  MapCacher::Transaction<std::string, bufferlist> *t)
+{
+  dout(20) << __func__ << " " << oids << dendl;
+  set<string> keys;
+  for (auto &oid : oids) {
+    assert(check(oid));
+    keys.insert(to_object_key(oid));
+  }
+  map<string, bufferlist> got;
+  int r = backend.get_keys(keys, &got);
+  if (r < 0)
+    return r;
+  if (got.size() != keys.size())
+    return -ENOENT;
+
+  set<string> to_remove = keys;
+  for (auto &i : got) {
+    object_snaps out;
+    bufferlist::iterator bp = i.second.begin();
+    ::decode(out, bp);
+    assert(!out.snaps.empty());
+    for (auto &snap : out.snaps)
+      to_remove.insert(to_raw_key(make_pair(snap, out.oid)));
+  }
+  if (g_conf->subsys.should_gather(ceph_subsys_osd, 20)) {
+    for (auto& i : to_remove) {
+      dout(20) << __func__ << " rm " << i << dendl;
+    }
+  }
+  backend.remove_keys(to_remove, t);
+  return 0;
+}
+
 int SnapMapper::get_snaps(
   const hobject_t &oid,
   std::set<snapid_t> *snaps)
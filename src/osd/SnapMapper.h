@@ -225,6 +225,12 @@ public:
     MapCacher::Transaction<std::string, bufferlist> *t ///< [out] transaction
     ); ///< @return error, -ENOENT if the object is not mapped
 
+  /// Remove mappings for several oids, reading their snaps in one go
+  int remove_oids(
+    const std::vector<hobject_t> &oids, ///< [in] oids to remove
+    MapCacher::Transaction<std::string, bufferlist> *t ///< [out] transaction
+    ); ///< @return error, -ENOENT if any object is not mapped
+
   /// Get snaps for oid
   int get_snaps(
     const hobject_t &oid,     ///< [in] oid to get snaps for
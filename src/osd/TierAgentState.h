@@ -14,6 +14,124 @@
 #ifndef CEPH_OSD_TIERAGENT_H
 #define CEPH_OSD_TIERAGENT_H
 
+/**
+ * count-min sketch of object temperature
+ *
+ * Accesses are added at full weight while the current HitSet is open; each
+ * time a HitSet is archived every counter is decayed, so the estimate for an
+ * object approximates the graded sum over archived HitSets with a single
+ * lookup instead of probing every HitSet.
+ */
+class HeatSketch {
+  static const unsigned depth = 4;
+  unsigned width = 0;
+  vector<uint32_t> counters; ///< depth rows of width counters
+
+  unsigned slot(unsigned row, uint32_t hash) const {
+    static const uint64_t seeds[depth] = {
+      0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+      0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull };
+    return row * width + (((uint64_t)hash * seeds[row]) >> 32) % width;
+  }
+
+public:
+  void init(unsigned w) {
+    width = w;
+    counters.assign((size_t)depth * width, 0);
+  }
+  bool empty() const {
+    return counters.empty();
+  }
+  void clear() {
+    std::fill(counters.begin(), counters.end(), 0);
+  }
+
+  void add(uint32_t hash, uint32_t weight) {
+    if (empty())
+      return;
+    for (unsigned r = 0; r < depth; ++r) {
+      uint32_t &c = counters[slot(r, hash)];
+      c = c > UINT32_MAX - weight ? UINT32_MAX : c + weight;
+    }
+  }
+  uint32_t estimate(uint32_t hash) const {
+    if (empty())
+      return 0;
+    uint32_t v = UINT32_MAX;
+    for (unsigned r = 0; r < depth; ++r)
+      v = std::min(v, counters[slot(r, hash)]);
+    return v;
+  }
+  /// scale every counter by factor (0..1)
+  void decay(double factor) {
+    for (auto &c : counters)
+      c = c * factor;
+  }
+};
+
+/**
+ * multi-generation bloom index of recent accesses
+ *
+ * Bit g of each slot belongs to generation g: 0 is the open HitSet and g
+ * the g-th most recently archived one.  Archiving shifts every slot up one
+ * generation, so asking how many recent HitSets saw an object is a few
+ * slot reads instead of a probe of every archived HitSet.
+ */
+class RecencyIndex {
+  static const unsigned hashes = 3;
+  vector<uint16_t> slots;
+  unsigned generations = 0;  ///< archived generations held
+
+  unsigned slot(unsigned i, uint32_t hash) const {
+    static const uint64_t seeds[hashes] = {
+      0xff51afd7ed558ccdull, 0xc4ceb9fe1a85ec53ull, 0x9e3779b97f4a7c15ull };
+    return (((uint64_t)hash * seeds[i]) >> 32) % slots.size();
+  }
+
+public:
+  static const unsigned max_generations = 15;  ///< archived, plus current
+
+  void init(unsigned size) {
+    slots.assign(size, 0);
+    generations = 0;
+  }
+  bool empty() const {
+    return slots.empty();
+  }
+  void clear() {
+    std::fill(slots.begin(), slots.end(), 0);
+    generations = 0;
+  }
+  unsigned get_generations() const {
+    return generations;
+  }
+
+  void add(uint32_t hash) {
+    if (empty())
+      return;
+    for (unsigned i = 0; i < hashes; ++i)
+      slots[slot(i, hash)] |= 1;
+  }
+  void archive() {
+    for (auto &s : slots)
+      s <<= 1;
+    if (generations < max_generations)
+      ++generations;
+  }
+  /// number of consecutive most recent archived generations that saw hash
+  unsigned archived_run(uint32_t hash) const {
+    if (empty())
+      return 0;
+    unsigned m = 0xffff;
+    for (unsigned i = 0; i < hashes; ++i)
+      m &= slots[slot(i, hash)];
+    unsigned run = 0;
+    for (m >>= 1; (m & 1) && run < generations; m >>= 1)
+      ++run;
+    return run;
+  }
+};
+
 struct TierAgentState {
   /// current position iterating across pool
   hobject_t position;
@@ -29,6 +147,13 @@ struct TierAgentState {
   /// past HitSet(s) (not current)
   map<time_t,HitSetRef> hit_set_map;
 
+  /// decayed access counts; trusted once it has seen a full HitSet window
+  HeatSketch heat;
+  unsigned heat_intervals;  ///< HitSets archived into heat
+
+  /// which recent HitSets saw an object, for promotion recency checks
+  RecencyIndex recent;
+
   /// a few recent things we've seen that are clean
   list<hobject_t> recent_clean;
 
@@ -74,6 +199,7 @@ struct TierAgentState {
     : started(0),
       delaying(false),
       hist_age(0),
+      heat_intervals(0),
       flush_mode(FLUSH_MODE_IDLE),
       evict_mode(EVICT_MODE_IDLE),
       evict_effort(0)
@@ -101,6 +227,21 @@ struct TierAgentState {
   /// discard all open hit sets
   void discard_hit_sets() {
     hit_set_map.clear();
+    heat.clear();
+    heat_intervals = 0;
+    recent.clear();
+  }
+
+  /// first access to an object in the current HitSet
+  void hit_set_access(const hobject_t& oid) {
+    heat.add(oid.get_hash(), 1000000);
+    recent.add(oid.get_hash());
+  }
+  /// the current HitSet was archived
+  void hit_set_archived(double decay) {
+    heat.decay(decay);
+    ++heat_intervals;
+    recent.archive();
   }
 
   void dump(Formatter *f) const {
@@ -108,6 +249,7 @@ struct TierAgentState {
     f->dump_string("evict_mode", get_evict_mode_name());
     f->dump_unsigned("evict_effort", evict_effort);
     f->dump_stream("position") << position;
+    f->dump_unsigned("heat_intervals", heat_intervals);
     f->open_object_section("temp_hist");
     temp_hist.dump(f);
     f->close_section();
@@ -17,6 +17,7 @@
 
 #include "osd/mClockClientQueue.h"
 #include "common/dout.h"
+#include "messages/MOSDOp.h"
 
 
 namespace dmc = crimson::dmclock;
@@ -118,6 +119,16 @@ namespace ceph {
     }
   }
 
+  // the op's MOSDOp if it is a client op, else nullptr
+  MOSDOp *mClockClientQueue::get_client_op(const Request& request) {
+    const OpRequestRef *op = boost::get<OpRequestRef>(&request.second.get_variant());
+    if (!op ||
+	(*op)->get_req()->get_type() != CEPH_MSG_OSD_OP) {
+      return nullptr;
+    }
+    return static_cast<MOSDOp*>((*op)->get_nonconst_req());
+  }
+
   mClockClientQueue::InnerClient
   inline mClockClientQueue::get_inner_client(const Client& cl,
 				      const Request& request) {
@@ -147,7 +158,16 @@ namespace ceph {
 					 unsigned priority,
 					 unsigned cost,
 					 Request item) {
-    queue.enqueue(get_inner_client(cl, item), priority, cost, item);
+    // clients that track dmclock delta/rho send them along, so their
+    // reservation and limit apply across all the osds they talk to
+    MOSDOp *m = get_client_op(item);
+    if (m && m->has_qos_params()) {
+      dmc::ReqParams req_params(m->get_qos_delta(), m->get_qos_rho());
+      queue.enqueue_distributed(get_inner_client(cl, item), priority, cost,
+				item, req_params);
+    } else {
+      queue.enqueue(get_inner_client(cl, item), priority, cost, item);
+    }
   }
 
   // Enqueue the op in the front of the regular queue
@@ -160,6 +180,16 @@ namespace ceph {
 
   // Return an op to be dispatched
   inline Request mClockClientQueue::dequeue() {
-    return queue.dequeue();
+    dmc::PhaseType phase;
+    Request ret = queue.dequeue(&phase);
+    // tell the client which phase served it; its ServiceTracker
+    // turns that into the rho it sends to the other osds
+    if (phase == dmc::PhaseType::reservation) {
+      MOSDOp *m = get_client_op(ret);
+      if (m) {
+	m->set_qos_reservation(true);
+      }
+    }
+    return ret;
   }
 } // namespace ceph
@@ -26,6 +26,9 @@
 #include "common/mClockPriorityQueue.h"
 
 
+class MOSDOp;
+
+
 namespace ceph {
 
   using Request = std::pair<spg_t, PGQueueable>;
@@ -135,12 +138,18 @@ namespace ceph {
       osd_op_type_t operator()(const PGRecovery& o) const {
         return osd_op_type_t::bg_recovery;
       }
+
+      osd_op_type_t operator()(const PGTimedEvent& o) const {
+        // follow-up work the osd does for an op it is already serving
+        return osd_op_type_t::osd_subop;
+      }
     }; // class pg_queueable_visitor_t
 
     static pg_queueable_visitor_t pg_queueable_visitor;
 
     osd_op_type_t get_osd_op_type(const Request& request);
     InnerClient get_inner_client(const Client& cl, const Request& request);
+    static MOSDOp *get_client_op(const Request& request);
   }; // class mClockClientAdapter
 
 } // namespace ceph
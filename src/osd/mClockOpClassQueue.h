@@ -143,6 +143,11 @@ namespace ceph {
       osd_op_type_t operator()(const PGRecovery& o) const {
         return osd_op_type_t::bg_recovery;
       }
+
+      osd_op_type_t operator()(const PGTimedEvent& o) const {
+        // follow-up work the osd does for an op it is already serving
+        return osd_op_type_t::osd_subop;
+      }
     }; // class pg_queueable_visitor_t
 
     static pg_queueable_visitor_t pg_queueable_visitor;
@@ -20,9 +20,11 @@ struct SnapSetContext {
   int ref;
   bool registered : 1;
   bool exists : 1;
+  bool cached : 1;  ///< unreferenced, kept decoded in the PG's snapset LRU
+  list<SnapSetContext*>::iterator lru_pos;
 
   explicit SnapSetContext(const hobject_t& o) :
-    oid(o), ref(0), registered(false), exists(true) { }
+    oid(o), ref(0), registered(false), exists(true), cached(false) { }
 };
 
 struct ObjectContext;
@@ -476,6 +478,15 @@ public:
     }
   }
 
+  /// take over the locks held by other
+  void splice(ObcLockManager &&other) {
+    for (auto& p : other.locks) {
+      assert(locks.find(p.first) == locks.end());
+      locks.insert(p);
+    }
+    other.locks.clear();
+  }
+
   void put_locks(
     list<pair<hobject_t, list<OpRequestRef> > > *to_requeue,
     bool *requeue_recovery,
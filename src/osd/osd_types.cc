@@ -1070,6 +1070,11 @@ void pool_opts_t::dump(Formatter* f) const
     }
     boost::apply_visitor(pool_opts_dumper_t(name, f), j->second);
   }
+  // the dictionary is binary and not in opt_mapping; just show its size
+  std::string dict;
+  if (get(COMPRESSION_DICTIONARY, &dict)) {
+    f->dump_unsigned("compression_dictionary_bytes", dict.size());
+  }
 }
 
 class pool_opts_encoder_t : public boost::static_visitor<>
@@ -1374,6 +1379,30 @@ uint32_t pg_pool_t::hash_key(const string& key, const string& ns) const
   return ceph_str_hash(object_hash, &buf[0], len);
 }
 
+void pg_pool_t::hash_keys(const vector<string>& keys, const string& ns,
+			  vector<uint32_t> *hashes) const
+{
+  vector<string> prefixed;
+  if (!ns.empty()) {
+    prefixed.reserve(keys.size());
+    for (auto& key : keys) {
+      prefixed.push_back(ns);
+      prefixed.back().push_back('\037');
+      prefixed.back().append(key);
+    }
+  }
+  const vector<string>& k = ns.empty() ? keys : prefixed;
+  vector<const char*> strs(k.size());
+  vector<unsigned> lens(k.size());
+  for (size_t i = 0; i < k.size(); ++i) {
+    strs[i] = k[i].data();
+    lens[i] = k[i].length();
+  }
+  hashes->resize(k.size());
+  ceph_str_hash_batch(object_hash, strs.data(), lens.data(), hashes->data(),
+		      k.size());
+}
+
 uint32_t pg_pool_t::raw_hash_to_pg(uint32_t v) const
 {
   return ceph_stable_mod(v, pg_num, pg_num_mask);
@@ -1049,6 +1049,7 @@ public:
     CSUM_TYPE,
     CSUM_MAX_BLOCK,
     CSUM_MIN_BLOCK,
+    COMPRESSION_DICTIONARY,  ///< binary; set with 'osd pool set-compression-dictionary'
   };
 
   enum type_t {
@@ -1147,6 +1148,7 @@ struct pg_pool_t {
     FLAG_WRITE_FADVISE_DONTNEED = 1<<7, // write mode with LIBRADOS_OP_FLAG_FADVISE_DONTNEED
     FLAG_NOSCRUB = 1<<8, // block periodic scrub
     FLAG_NODEEP_SCRUB = 1<<9, // block periodic deep-scrub
+    FLAG_CHAIN_REPLICATION = 1<<10, // replicate writes along a chain of replicas
   };
 
   static const char *get_flag_name(int f) {
@@ -1161,6 +1163,7 @@ struct pg_pool_t {
     case FLAG_WRITE_FADVISE_DONTNEED: return "write_fadvise_dontneed";
     case FLAG_NOSCRUB: return "noscrub";
     case FLAG_NODEEP_SCRUB: return "nodeep-scrub";
+    case FLAG_CHAIN_REPLICATION: return "chain_replication";
     default: return "???";
     }
   }
@@ -1199,6 +1202,8 @@ struct pg_pool_t {
       return FLAG_NOSCRUB;
     if (name == "nodeep-scrub")
       return FLAG_NODEEP_SCRUB;
+    if (name == "chain_replication")
+      return FLAG_CHAIN_REPLICATION;
     return 0;
   }
 
@@ -1563,6 +1568,9 @@ public:
 
   /// hash a object name+namespace key to a hash position
   uint32_t hash_key(const string& key, const string& ns) const;
+  /// hash_key() for many keys in one namespace
+  void hash_keys(const vector<string>& keys, const string& ns,
+		 vector<uint32_t> *hashes) const;
 
   /// round a hash position down to a pg num
   uint32_t raw_hash_to_pg(uint32_t v) const;
@@ -228,6 +228,23 @@ void ObjectCacher::Object::try_merge_bh(BufferHead *bh)
     merge_left(bh, p->second);
 }
 
+/*
+ * a write that covers only part of a clean bh may take over the whole bh
+ * instead of splitting it, as long as that at most doubles the bytes
+ * written back.  this keeps small writes from chopping cached data into
+ * ever smaller bhs.  journaled writes keep their exact extents.
+ */
+bool ObjectCacher::Object::can_absorb(BufferHead *bh, loff_t overlap,
+				      ceph_tid_t tid) const
+{
+  return tid == 0 &&
+    bh->is_clean() &&
+    bh->get_journal_tid() == 0 &&
+    bh->bl.length() == (uint64_t)bh->length() &&
+    bh->waitfor_read.empty() &&
+    bh->length() - overlap <= overlap;
+}
+
 /*
  * count bytes we have cached in given range
  */
@@ -449,23 +466,31 @@ ObjectCacher::BufferHead *ObjectCacher::Object::map_write(ObjectExtent &ex,
         assert(final == 0);
         if (cur + max >= bh->end()) {
           // we want right bit (one splice)
-          final = split(bh, cur);   // just split it, take right half.
+          if (can_absorb(bh, bh->end() - cur, tid)) {
+            final = bh;   // take it all, clean head included
+          } else {
+            final = split(bh, cur);   // just split it, take right half.
+            ++p;
+            assert(p->second == final);
+          }
           replace_journal_tid(final, tid);
-          ++p;
-          assert(p->second == final);
         } else {
           // we want middle bit (two splices)
-          final = split(bh, cur);
-          ++p;
-          assert(p->second == final);
-          split(final, cur+max);
+          if (can_absorb(bh, max, tid)) {
+            final = bh;
+          } else {
+            final = split(bh, cur);
+            ++p;
+            assert(p->second == final);
+            split(final, cur+max);
+          }
           replace_journal_tid(final, tid);
         }
       } else {
         assert(p->first == cur);
         if (bh->length() <= max) {
           // whole bufferhead, piece of cake.
-        } else {
+        } else if (!can_absorb(bh, max, tid)) {
           // we want left bit (one splice)
           split(bh, cur + max);        // just split
         }
@@ -623,7 +648,7 @@ ObjectCacher::ObjectCacher(CephContext *cct_, string name,
     trace_endpoint("ObjectCacher"),
     flush_set_callback(flush_callback),
     flush_set_callback_arg(flush_callback_arg),
-    last_read_tid(0), flusher_stop(false), flusher_thread(this),finisher(cct),
+    last_read_tid(0), lru_touch_seq(0), flusher_stop(false), flusher_thread(this),finisher(cct),
     stat_clean(0), stat_zero(0), stat_dirty(0), stat_rx(0), stat_tx(0),
     stat_missing(0), stat_error(0), stat_dirty_waiting(0), reads_outstanding(0)
 {
@@ -944,8 +969,14 @@ void ObjectCacher::bh_read_finish(int64_t poolid, sobject_t oid,
   read_cond.Signal();
 }
 
+/*
+ * write out the aged dirty bhs of bh's object along with bh, in offset
+ * order, so the object gets one scattered write (or a sorted run of
+ * writes if the handler can't scatter) instead of lru-ordered pieces.
+ */
 void ObjectCacher::bh_write_adjacencies(BufferHead *bh, ceph::real_time cutoff,
-					int64_t *max_amount, int *max_count)
+					int64_t *max_amount, int *max_count,
+					const ZTracer::Trace &parent_trace)
 {
   list<BufferHead*> blist;
 
@@ -988,7 +1019,12 @@ void ObjectCacher::bh_write_adjacencies(BufferHead *bh, ceph::real_time cutoff,
   if (max_amount)
     *max_amount -= total_len;
 
-  bh_write_scattered(blist);
+  if (scattered_write) {
+    bh_write_scattered(blist);
+  } else {
+    for (auto obh : blist)
+      bh_write(obh, parent_trace);
+  }
 }
 
 class ObjectCacher::C_WriteCommit : public Context {
@@ -1238,12 +1274,8 @@ void ObjectCacher::flush(ZTracer::Trace *trace, loff_t amount)
     if (!bh) break;
     if (bh->last_write > cutoff) break;
 
-    if (scattered_write) {
-      bh_write_adjacencies(bh, cutoff, amount > 0 ? &left : NULL, NULL);
-    } else {
-      left -= bh->length();
-      bh_write(bh, *trace);
-    }
+    bh_write_adjacencies(bh, cutoff, amount > 0 ? &left : NULL, NULL,
+			 *trace);
   }
 }
 
@@ -1695,7 +1727,15 @@ int ObjectCacher::writex(OSDWrite *wr, ObjectSet *oset, Context *onfreespace,
     //  - there is one contiguous bh
     //  - the buffer frags need not be (and almost certainly aren't)
     // note: i assume striping is monotonic... no jumps backwards, ever!
+    //  - the bh may extend past the write if it absorbed a clean bh;
+    //    that data is at the end of its buffer
     loff_t opos = ex_it->offset;
+    bufferlist tail;
+    loff_t tail_len = bh->end() - (loff_t)(ex_it->offset + ex_it->length);
+    if (tail_len > 0) {
+      assert(bh->bl.length() >= (uint64_t)tail_len);
+      tail.substr_of(bh->bl, bh->bl.length() - tail_len, tail_len);
+    }
     for (vector<pair<uint64_t, uint64_t> >::iterator f_it
 	   = ex_it->buffer_extents.begin();
 	 f_it != ex_it->buffer_extents.end();
@@ -1703,7 +1743,7 @@ int ObjectCacher::writex(OSDWrite *wr, ObjectSet *oset, Context *onfreespace,
       ldout(cct, 10) << "writex writing " << f_it->first << "~"
 		     << f_it->second << " into " << *bh << " at " << opos
 		     << dendl;
-      uint64_t bhoff = bh->start() - opos;
+      uint64_t bhoff = opos - bh->start();
       assert(f_it->second <= bh->length() - bhoff);
 
       // get the frag we're mapping in
@@ -1720,6 +1760,7 @@ int ObjectCacher::writex(OSDWrite *wr, ObjectSet *oset, Context *onfreespace,
 
       opos += f_it->second;
     }
+    bh->bl.claim_append(tail);
 
     // ok, now bh is dirty.
     mark_dirty(bh);
@@ -1887,9 +1928,14 @@ void ObjectCacher::flusher_entry()
 		     << target_dirty << ", flushing some dirty bhs" << dendl;
       flush(&trace, actual - target_dirty);
     } else {
-      // check tail of lru for old dirty items
+      // check tail of lru for old dirty items.  past half the target,
+      // younger items go too, so writeback ramps up before writers
+      // have to block on the target.
       ceph::real_time cutoff = ceph::real_clock::now();
-      cutoff -= max_dirty_age;
+      if (actual > 0 && (uint64_t) actual > target_dirty / 2)
+	cutoff -= max_dirty_age / 2;
+      else
+	cutoff -= max_dirty_age;
       BufferHead *bh = 0;
       int max = MAX_FLUSH_UNDER_LOCK;
       while ((bh = static_cast<BufferHead*>(bh_lru_dirty.
@@ -1897,12 +1943,7 @@ void ObjectCacher::flusher_entry()
 	     bh->last_write <= cutoff &&
 	     max > 0) {
 	ldout(cct, 10) << "flusher flushing aged dirty bh " << *bh << dendl;
-	if (scattered_write) {
-	  bh_write_adjacencies(bh, cutoff, NULL, &max);
-        } else {
-	  bh_write(bh, trace);
-	  --max;
-	}
+	bh_write_adjacencies(bh, cutoff, NULL, &max, trace);
       }
       if (!max) {
 	// back off the lock to avoid starving other threads
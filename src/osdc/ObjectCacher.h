@@ -129,6 +129,7 @@ class ObjectCacher {
     SnapContext snapc;
     ceph_tid_t journal_tid;
     int error; // holds return value for failed reads
+    uint64_t lru_touched;  // lru_touch_seq at the last relink
 
     map<loff_t, list<Context*> > waitfor_read;
 
@@ -142,7 +143,8 @@ class ObjectCacher {
       last_write_tid(0),
       last_read_tid(0),
       journal_tid(0),
-      error(0) {
+      error(0),
+      lru_touched(0) {
       ex.start = ex.length = 0;
     }
 
@@ -250,6 +252,7 @@ class ObjectCacher {
     ceph_tid_t last_commit_tid; // last update commited.
 
     int dirty_or_tx;
+    uint64_t lru_touched;  // lru_touch_seq at the last relink
 
     map< ceph_tid_t, list<Context*> > waitfor_commit;
     xlist<C_ReadFinish*> reads;
@@ -265,7 +268,7 @@ class ObjectCacher {
       truncate_size(ts), truncate_seq(tq),
       complete(false), exists(true),
       last_write_tid(0), last_commit_tid(0),
-      dirty_or_tx(0) {
+      dirty_or_tx(0), lru_touched(0) {
       // add to set
       os->objects.push_back(&set_item);
     }
@@ -342,6 +345,7 @@ class ObjectCacher {
     BufferHead *split(BufferHead *bh, loff_t off);
     void merge_left(BufferHead *left, BufferHead *right);
     void try_merge_bh(BufferHead *bh);
+    bool can_absorb(BufferHead *bh, loff_t overlap, ceph_tid_t tid) const;
 
     bool is_cached(loff_t off, loff_t len) const;
     bool include_all_cached_data(loff_t off, loff_t len);
@@ -419,6 +423,7 @@ class ObjectCacher {
   set<BufferHead*, BufferHead::ptr_lt> dirty_or_tx_bh;
   LRU   bh_lru_dirty, bh_lru_rest;
   LRU   ob_lru;
+  uint64_t lru_touch_seq;
 
   Cond flusher_cond;
   bool flusher_stop;
@@ -472,18 +477,28 @@ class ObjectCacher {
   loff_t get_stat_clean() const { return stat_clean; }
   loff_t get_stat_zero() const { return stat_zero; }
 
+  // hits on a hot buffer or object only relink it once it has dropped
+  // out of the most recently touched quarter of its lru
+  bool lru_touch_lazy(LRU &lru, LRUObject *o, uint64_t *touched) {
+    ++lru_touch_seq;
+    if (*touched && lru.lru_is_top(o) &&
+	lru_touch_seq - *touched < lru.lru_get_size() / 4)
+      return false;
+    *touched = lru_touch_seq;
+    return lru.lru_touch(o);
+  }
   void touch_bh(BufferHead *bh) {
     if (bh->is_dirty())
-      bh_lru_dirty.lru_touch(bh);
+      lru_touch_lazy(bh_lru_dirty, bh, &bh->lru_touched);
     else
-      bh_lru_rest.lru_touch(bh);
+      lru_touch_lazy(bh_lru_rest, bh, &bh->lru_touched);
 
     bh->set_dontneed(false);
     bh->set_nocache(false);
     touch_ob(bh->ob);
   }
   void touch_ob(Object *ob) {
-    ob_lru.lru_touch(ob);
+    lru_touch_lazy(ob_lru, ob, &ob->lru_touched);
   }
   void bottouch_ob(Object *ob) {
     ob_lru.lru_bottouch(ob);
@@ -527,7 +542,8 @@ class ObjectCacher {
   void bh_write(BufferHead *bh, const ZTracer::Trace &parent_trace);
   void bh_write_scattered(list<BufferHead*>& blist);
   void bh_write_adjacencies(BufferHead *bh, ceph::real_time cutoff,
-			    int64_t *amount, int *max_count);
+			    int64_t *amount, int *max_count,
+			    const ZTracer::Trace &parent_trace);
 
   void trim();
   void flush(ZTracer::Trace *trace, loff_t amount=0);
@@ -143,6 +143,15 @@ enum {
   l_osdc_osdop_omap_rd,
   l_osdc_osdop_omap_del,
 
+  l_osdc_pg_mapping_hit,
+  l_osdc_pg_mapping_miss,
+
+  l_osdc_backoff_block,
+  l_osdc_backoff_unblock,
+  l_osdc_backoff_time,
+  l_osdc_backoff_paced,
+  l_osdc_backoff_pace_wait,
+
   l_osdc_last,
 };
 
@@ -151,6 +160,7 @@ enum {
 
 static const char *config_keys[] = {
   "crush_location",
+  "objecter_replica_read_policy",
   NULL
 };
 
@@ -222,6 +232,9 @@ void Objecter::handle_conf_change(const struct md_config_t *conf,
   if (changed.count("crush_location")) {
     update_crush_location();
   }
+  if (changed.count("objecter_replica_read_policy")) {
+    update_replica_read_policy();
+  }
 }
 
 void Objecter::update_crush_location()
@@ -230,6 +243,17 @@ void Objecter::update_crush_location()
   crush_location = cct->crush_location.get_location();
 }
 
+void Objecter::update_replica_read_policy()
+{
+  string policy = cct->_conf->get_val<string>("objecter_replica_read_policy");
+  if (policy == "balance")
+    replica_read_flags = CEPH_OSD_FLAG_BALANCE_READS;
+  else if (policy == "localize")
+    replica_read_flags = CEPH_OSD_FLAG_LOCALIZE_READS;
+  else
+    replica_read_flags = 0;
+}
+
 // messages ------------------------------
 
 /*
@@ -365,6 +389,22 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_osdop_omap_del, "omap_del",
 			"OSD OMAP delete operations");
 
+    pcb.add_u64_counter(l_osdc_pg_mapping_hit, "pg_mapping_hit",
+			"PG mapping cache hits");
+    pcb.add_u64_counter(l_osdc_pg_mapping_miss, "pg_mapping_miss",
+			"PG mapping cache misses");
+
+    pcb.add_u64_counter(l_osdc_backoff_block, "backoff_block",
+			"Backoffs received from OSDs");
+    pcb.add_u64_counter(l_osdc_backoff_unblock, "backoff_unblock",
+			"Backoffs released by OSDs");
+    pcb.add_time_avg(l_osdc_backoff_time, "backoff_time",
+		     "Time a backoff blocked a range of objects");
+    pcb.add_u64_counter(l_osdc_backoff_paced, "backoff_paced",
+			"Ops whose resend after a backoff was delayed by pacing");
+    pcb.add_time_avg(l_osdc_backoff_pace_wait, "backoff_pace_wait",
+		     "Time paced ops waited after the backoff was released");
+
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -384,6 +424,7 @@ void Objecter::init()
   }
 
   update_crush_location();
+  update_replica_read_policy();
 
   cct->_conf->add_observer(this);
 
@@ -1182,6 +1223,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 			<< dendl;
 	  OSDMap::Incremental inc(m->incremental_maps[e]);
 	  osdmap->apply_incremental(inc);
+	  _prune_pg_mappings(&inc);
 
           emit_blacklist_events(inc);
 
@@ -1195,6 +1237,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
           emit_blacklist_events(*osdmap, *new_osdmap);
 
           osdmap = new_osdmap;
+	  _prune_pg_mappings(nullptr);
 
 	  logger->inc(l_osdc_map_full);
 	}
@@ -1251,6 +1294,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	ldout(cct, 3) << "handle_osd_map decoding full epoch "
 		      << m->get_last() << dendl;
 	osdmap->decode(m->maps[m->get_last()]);
+	_prune_pg_mappings(nullptr);
 
 	_scan_requests(homeless_session, false, false, NULL,
 		       need_resend, need_resend_linger,
@@ -1836,6 +1880,7 @@ void Objecter::close_session(OSDSession *s)
     logger->inc(l_osdc_osd_session_close);
   }
   OSDSession::unique_lock sl(s->lock);
+  _cancel_backoff_pacing(s);
 
   std::list<LingerOp*> homeless_lingers;
   std::list<CommandOp*> homeless_commands;
@@ -2039,6 +2084,7 @@ void Objecter::_kick_requests(OSDSession *session,
   // clear backoffs
   session->backoffs.clear();
   session->backoffs_by_id.clear();
+  _cancel_backoff_pacing(session);
 
   // resend ops
   map<ceph_tid_t,Op*> resend;  // resend in tid order
@@ -2468,8 +2514,9 @@ void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid)
 
   _session_op_assign(s, op);
 
+  ConnectionRef con;
   if (need_send) {
-    _send_op(op, m);
+    m = _prepare_send_op(op, m, &con);
   }
 
   // Last chance to touch Op here, after giving up session lock it can
@@ -2483,6 +2530,13 @@ void Objecter::_op_submit(Op *op, shunique_lock& sul, ceph_tid_t *ptid)
   op = NULL;
 
   sl.unlock();
+
+  // Send without the session lock so that submitters to the same osd
+  // do not serialize on the messenger.  We still hold rwlock, so the
+  // session cannot be reopened on a new connection under us.
+  if (need_send && m) {
+    con->send_message(m);
+  }
   put_session(s);
 
   ldout(cct, 5) << num_in_flight << " in flight" << dendl;
@@ -2818,8 +2872,26 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
   unsigned pg_num = pi->get_pg_num();
   int up_primary, acting_primary;
   vector<int> up, acting;
-  osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
-			       &acting, &acting_primary);
+  if (cct->_conf->objecter_pg_mapping_cache) {
+    pg_t mpgid(ceph_stable_mod(pgid.ps(), pg_num, pi->get_pg_num_mask()),
+	       pgid.pool());
+    pg_mapping_t pm;
+    if (_lookup_pg_mapping(mpgid, &pm)) {
+      logger->inc(l_osdc_pg_mapping_hit);
+    } else {
+      logger->inc(l_osdc_pg_mapping_miss);
+      osdmap->pg_to_up_acting_osds(mpgid, &pm.up, &pm.up_primary,
+				   &pm.acting, &pm.acting_primary);
+      _update_pg_mapping(mpgid, pg_num, pm);
+    }
+    up.swap(pm.up);
+    acting.swap(pm.acting);
+    up_primary = pm.up_primary;
+    acting_primary = pm.acting_primary;
+  } else {
+    osdmap->pg_to_up_acting_osds(pgid, &up, &up_primary,
+				 &acting, &acting_primary);
+  }
   bool sort_bitwise = osdmap->test_flag(CEPH_OSDMAP_SORTBITWISE);
   bool recovery_deletes = osdmap->test_flag(CEPH_OSDMAP_RECOVERY_DELETES);
   unsigned prev_seed = ceph_stable_mod(pgid.ps(), t->pg_num, t->pg_num_mask);
@@ -2888,6 +2960,18 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
     } else {
       int osd;
       bool read = is_read && !is_write;
+      const int replica_read_mask = CEPH_OSD_FLAG_BALANCE_READS |
+	CEPH_OSD_FLAG_LOCALIZE_READS;
+      if (!read || !pi->is_replicated() || t->force_primary_read) {
+	// ec shards can't serve reads on their own
+	read = false;
+      } else if (!(t->flags & replica_read_mask) && replica_read_flags &&
+		 HAVE_FEATURE(osdmap->get_up_osd_features(), SERVER_MIMIC)) {
+	// pre-mimic osds serve replica reads without checking that the
+	// object is committed and applied everywhere, rather than bouncing
+	// them back with -EAGAIN
+	t->flags |= replica_read_flags;
+      }
       if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
 	int p = rand() % acting.size();
 	if (p)
@@ -2934,6 +3018,46 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
   return RECALC_OP_TARGET_NO_ACTION;
 }
 
+bool Objecter::_lookup_pg_mapping(pg_t pgid, pg_mapping_t *m)
+{
+  std::lock_guard<std::mutex> l(pg_mapping_lock);
+  auto p = pg_mappings.find(pgid.pool());
+  if (p == pg_mappings.end() || pgid.ps() >= p->second.size() ||
+      !p->second[pgid.ps()].valid) {
+    return false;
+  }
+  *m = p->second[pgid.ps()];
+  return true;
+}
+
+void Objecter::_update_pg_mapping(pg_t pgid, unsigned pg_num,
+				  const pg_mapping_t& m)
+{
+  // rwlock is locked, so osdmap (and pg_num) cannot change under us
+  std::lock_guard<std::mutex> l(pg_mapping_lock);
+  auto& v = pg_mappings[pgid.pool()];
+  if (v.size() != pg_num) {
+    v.clear();
+    v.resize(pg_num);
+  }
+  v[pgid.ps()] = m;
+  v[pgid.ps()].valid = true;
+}
+
+void Objecter::_prune_pg_mappings(const OSDMap::Incremental *inc)
+{
+  // rwlock is write-locked
+  std::lock_guard<std::mutex> l(pg_mapping_lock);
+  set<int64_t> pools;
+  if (!inc || !inc->get_affected_pools(&pools)) {
+    pg_mappings.clear();
+    return;
+  }
+  for (auto pool : pools) {
+    pg_mappings.erase(pool);
+  }
+}
+
 int Objecter::_map_session(op_target_t *target, OSDSession **s,
 			   shunique_lock& sul)
 {
@@ -3157,7 +3281,9 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
   m->set_mtime(op->mtime);
   m->set_retry_attempt(op->attempts++);
 
-  if (!op->trace.valid() && cct->_conf->osdc_blkin_trace_all) {
+  if (!op->trace.valid() &&
+      (cct->_conf->osdc_blkin_trace_all ||
+       ztrace_sample(cct->_conf->osdc_blkin_trace_sample_rate))) {
     op->trace.init("op", &trace_endpoint);
   }
 
@@ -3170,6 +3296,11 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
     m->set_reqid(op->reqid);
   }
 
+  if (qos_tracker && op->target.osd >= 0) {
+    auto qp = qos_tracker->get_req_params(op->target.osd);
+    m->set_qos_params(qp.delta, qp.rho);
+  }
+
   logger->inc(l_osdc_op_send);
   logger->inc(l_osdc_op_send_bytes, m->get_data().length());
 
@@ -3177,6 +3308,17 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
 }
 
 void Objecter::_send_op(Op *op, MOSDOp *m)
+{
+  // rwlock is locked
+  // op->session->lock is locked
+  ConnectionRef con;
+  m = _prepare_send_op(op, m, &con);
+  if (m) {
+    con->send_message(m);
+  }
+}
+
+MOSDOp *Objecter::_prepare_send_op(Op *op, MOSDOp *m, ConnectionRef *pcon)
 {
   // rwlock is locked
   // op->session->lock is locked
@@ -3200,7 +3342,10 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
 	ldout(cct, 10) << __func__ << " backoff " << op->target.actual_pgid
 		       << " id " << q->second.id << " on " << hoid
 		       << ", queuing " << op << " tid " << op->tid << dendl;
-	return;
+	if (m) {
+	  m->put();
+	}
+	return nullptr;
       }
     }
   }
@@ -3247,7 +3392,72 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
   if (op->trace.valid()) {
     m->trace.init("op msg", nullptr, &op->trace);
   }
-  op->session->con->send_message(m);
+  *pcon = con;
+  return m;
+}
+
+void Objecter::_schedule_backoff_resend(OSDSession *s, spg_t pgid,
+					BackoffPacing& bp)
+{
+  // s->lock is locked
+  double interval = cct->_conf->objecter_backoff_resend_interval;
+  // spread clients over a window that doubles with every backoff the
+  // pg sent us recently
+  double window = interval * (1 << MIN(bp.blocks ? bp.blocks - 1 : 0, 10));
+  double delay = interval + window * (rand() / (double)RAND_MAX);
+  bp.window_end = ceph::mono_clock::now() +
+    ceph::make_timespan(delay + window);
+  ldout(cct, 20) << __func__ << " " << pgid << " " << bp.ops.size()
+		 << " ops, blocks " << bp.blocks << ", next in " << delay
+		 << "s" << dendl;
+  get_session(s);
+  bp.timer_event = timer.add_event(
+    ceph::make_timespan(delay),
+    [this, s, pgid]() {
+      _backoff_resend(s, pgid);
+    });
+}
+
+void Objecter::_backoff_resend(OSDSession *s, spg_t pgid)
+{
+  shunique_lock sul(rwlock, ceph::acquire_shared);
+  OSDSession::unique_lock sl(s->lock);
+  auto p = s->backoff_pacing.find(pgid);
+  if (initialized && p != s->backoff_pacing.end() && p->second.timer_event) {
+    BackoffPacing& bp = p->second;
+    bp.timer_event = 0;
+    auto now = ceph::mono_clock::now();
+    unsigned n = MAX(cct->_conf->objecter_backoff_resend_burst, 1u);
+    while (n && !bp.ops.empty()) {
+      auto q = s->ops.find(bp.ops.front().first);
+      // skip ops that completed or were resent some other way
+      if (q != s->ops.end() &&
+	  q->second->attempts == bp.ops.front().second &&
+	  q->second->target.actual_pgid == pgid) {
+	logger->tinc(l_osdc_backoff_pace_wait, now - bp.unblocked);
+	_send_op(q->second);
+	--n;
+      }
+      bp.ops.pop_front();
+    }
+    if (!bp.ops.empty()) {
+      _schedule_backoff_resend(s, pgid, bp);
+    }
+  }
+  sl.unlock();
+  put_session(s);
+}
+
+void Objecter::_cancel_backoff_pacing(OSDSession *s)
+{
+  // s->lock is locked
+  for (auto& p : s->backoff_pacing) {
+    if (p.second.timer_event && timer.cancel_event(p.second.timer_event)) {
+      put_session(s);
+    }
+  }
+  // a callback already running will find nothing to do
+  s->backoff_pacing.clear();
 }
 
 int Objecter::calc_op_budget(Op *op)
@@ -3333,6 +3543,12 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
+  if (qos_tracker) {
+    qos_tracker->track_resp(s->osd, m->get_qos_reservation() ?
+			    crimson::dmclock::PhaseType::reservation :
+			    crimson::dmclock::PhaseType::priority);
+  }
+
   OSDSession::unique_lock sl(s->lock);
 
   map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
@@ -3424,6 +3640,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     op->tid = 0;
     op->target.flags &= ~(CEPH_OSD_FLAG_BALANCE_READS |
 			  CEPH_OSD_FLAG_LOCALIZE_READS);
+    op->target.force_primary_read = true;
     op->target.pgid = pg_t();
     _op_submit(op, sul, NULL);
     m->put();
@@ -3550,6 +3767,18 @@ void Objecter::handle_osd_backoff(MOSDBackoff *m)
       b.id = m->id;
       b.begin = m->begin;
       b.end = m->end;
+      b.stamp = ceph::mono_clock::now();
+      logger->inc(l_osdc_backoff_block);
+
+      if (cct->_conf->objecter_backoff_resend_burst) {
+	// a pg that keeps backing us off gets a wider resend window
+	BackoffPacing& bp = s->backoff_pacing[m->pgid];
+	if (b.stamp < bp.window_end) {
+	  ++bp.blocks;
+	} else {
+	  bp.blocks = 1;
+	}
+      }
 
       // ack with original backoff's epoch so that the osd can discard this if
       // there was a pg split.
@@ -3580,6 +3809,9 @@ void Objecter::handle_osd_backoff(MOSDBackoff *m)
 		       << " id " << b->id
 		       << " [" << b->begin << "," << b->end
 		       << ")" << dendl;
+	auto now = ceph::mono_clock::now();
+	logger->inc(l_osdc_backoff_unblock);
+	logger->tinc(l_osdc_backoff_time, now - b->stamp);
 	auto spgp = s->backoffs.find(b->pgid);
 	assert(spgp != s->backoffs.end());
 	spgp->second.erase(b->begin);
@@ -3588,17 +3820,36 @@ void Objecter::handle_osd_backoff(MOSDBackoff *m)
 	}
 	s->backoffs_by_id.erase(p);
 
-	// check for any ops to resend
+	// check for any ops to resend.  with pacing enabled only the
+	// first burst goes out now; the rest are spread out so that the
+	// pg is not hit by every blocked op of every client at once.
+	unsigned burst = cct->_conf->objecter_backoff_resend_burst;
+	unsigned sent = 0;
+	BackoffPacing *bp = nullptr;
 	for (auto& q : s->ops) {
 	  if (q.second->target.actual_pgid == m->pgid) {
 	    int r = q.second->target.contained_by(m->begin, m->end);
 	    ldout(cct, 20) << __func__ <<  " contained_by " << r << " on "
 			   << q.second->target.get_hobj() << dendl;
-	    if (r) {
+	    if (!r) {
+	      continue;
+	    }
+	    if (!burst || sent < burst) {
 	      _send_op(q.second);
+	      ++sent;
+	      continue;
 	    }
+	    if (!bp) {
+	      bp = &s->backoff_pacing[m->pgid];
+	      bp->unblocked = now;
+	    }
+	    bp->ops.push_back(make_pair(q.first, q.second->attempts));
+	    logger->inc(l_osdc_backoff_paced);
 	  }
 	}
+	if (bp && !bp->ops.empty() && !bp->timer_event) {
+	  _schedule_backoff_resend(s, m->pgid, *bp);
+	}
       } else {
 	lderr(cct) << __func__ << " " << m->pgid << " id " << m->id
 		   << " unblock on ["
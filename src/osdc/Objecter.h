@@ -37,6 +37,8 @@
 #include "common/shunique_lock.h"
 #include "common/zipkin_trace.h"
 
+#include "dmclock/src/dmclock_client.h"
+
 #include "messages/MOSDOp.h"
 #include "osd/OSDMap.h"
 
@@ -1191,6 +1193,8 @@ private:
 public:
   using Dispatcher::cct;
   std::multimap<string,string> crush_location;
+  /// BALANCE_READS/LOCALIZE_READS flag from objecter_replica_read_policy
+  std::atomic<int> replica_read_flags{0};
 
   std::atomic<bool> initialized{false};
 
@@ -1210,6 +1214,19 @@ private:
   bool blacklist_events_enabled;
   std::set<entity_addr_t> blacklist_events;
 
+  // pg -> up/acting cache for the current osdmap (objecter_pg_mapping_cache)
+  struct pg_mapping_t {
+    bool valid = false;
+    std::vector<int> up, acting;
+    int up_primary = -1, acting_primary = -1;
+  };
+  std::mutex pg_mapping_lock;
+  std::map<int64_t, std::vector<pg_mapping_t>> pg_mappings; ///< pool -> ps
+  bool _lookup_pg_mapping(pg_t pgid, pg_mapping_t *m);
+  void _update_pg_mapping(pg_t pgid, unsigned pg_num, const pg_mapping_t& m);
+  /// drop cached mappings the incremental may change, or all of them
+  void _prune_pg_mappings(const OSDMap::Incremental *inc);
+
 public:
   void maybe_request_map();
 
@@ -1235,6 +1252,7 @@ private:
   void start_tick();
   void tick();
   void update_crush_location();
+  void update_replica_read_policy();
 
   class RequestStateHook;
 
@@ -1280,6 +1298,7 @@ public:
     bool recovery_deletes = false; ///< whether the deletes are performed during recovery instead of peering
 
     bool used_replica = false;
+    bool force_primary_read = false; ///< a replica bounced this op
     bool paused = false;
 
     int osd = -1;      ///< the final target osd, or -1
@@ -1800,6 +1819,16 @@ public:
     spg_t pgid;
     uint64_t id;
     hobject_t begin, end;
+    ceph::mono_time stamp;  ///< when we were blocked
+  };
+
+  /// resends released by a backoff unblock that we are spreading out
+  struct BackoffPacing {
+    unsigned blocks = 0;          ///< recent backoffs on this pg
+    ceph::mono_time window_end;   ///< a block before this counts as recent
+    ceph::mono_time unblocked;    ///< when the queued ops were released
+    std::list<std::pair<ceph_tid_t,int>> ops;  ///< (tid, attempts) to resend
+    uint64_t timer_event = 0;
   };
 
   struct OSDSession : public RefCountedObject {
@@ -1817,6 +1846,7 @@ public:
     // backoffs
     map<spg_t,map<hobject_t,OSDBackoff>> backoffs;
     map<uint64_t,OSDBackoff*> backoffs_by_id;
+    map<spg_t,BackoffPacing> backoff_pacing;
 
     int osd;
     int incarnation;
@@ -1879,6 +1909,11 @@ public:
 
   MOSDOp *_prepare_osd_op(Op *op);
   void _send_op(Op *op, MOSDOp *m = NULL);
+  void _schedule_backoff_resend(OSDSession *s, spg_t pgid, BackoffPacing& bp);
+  void _backoff_resend(OSDSession *s, spg_t pgid);
+  void _cancel_backoff_pacing(OSDSession *s);
+  /// do everything _send_op() does short of sending; nullptr if backed off
+  MOSDOp *_prepare_send_op(Op *op, MOSDOp *m, ConnectionRef *pcon);
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
   void finish_op(OSDSession *session, ceph_tid_t tid);
@@ -2012,7 +2047,11 @@ private:
     op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
     epoch_barrier(0),
     retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply)
-  { }
+  {
+    if (cct->_conf->objecter_mclock_service_tracker) {
+      qos_tracker.reset(new crimson::dmclock::ServiceTracker<int>());
+    }
+  }
   ~Objecter() override;
 
   void init();
@@ -3038,6 +3077,8 @@ public:
 private:
   epoch_t epoch_barrier;
   bool retry_writes_after_first_reply;
+  // dmclock delta/rho per osd (objecter_mclock_service_tracker)
+  std::unique_ptr<crimson::dmclock::ServiceTracker<int>> qos_tracker;
 public:
   void set_epoch_barrier(epoch_t epoch);
 
@@ -16,6 +16,7 @@
 
 #include "include/types.h"
 #include "include/buffer.h"
+#include "include/intarith.h"
 #include "osd/OSDMap.h"
 
 #include "common/config.h"
@@ -26,6 +27,50 @@
 #define dout_prefix *_dout << "striper "
 
 
+namespace {
+  /*
+   * a layout divisor resolved once per mapping: layouts almost always use
+   * power of two units and counts, and those turn into shifts and masks
+   * instead of 64-bit divisions on every extent.
+   */
+  struct StripeDivisor {
+    uint64_t d;
+    int shift;
+    explicit StripeDivisor(uint64_t d)
+      : d(d), shift(d && (d & (d - 1)) == 0 ? (int)ctz(d) : -1) {}
+    uint64_t div(uint64_t n) const {
+      return shift >= 0 ? n >> shift : n / d;
+    }
+    uint64_t mod(uint64_t n) const {
+      return shift >= 0 ? n & (d - 1) : n % d;
+    }
+  };
+
+  struct StripeMap {
+    StripeDivisor su;
+    StripeDivisor stripe_count;
+    StripeDivisor stripes_per_object;
+
+    StripeMap(uint64_t su, uint64_t stripe_count, uint64_t object_size)
+      : su(su), stripe_count(stripe_count),
+	stripes_per_object(object_size / su) {}
+
+    // map a file offset to its object, offset in the object, and the
+    // bytes left in its stripe unit
+    void map(uint64_t off, uint64_t *objectno, uint64_t *x_offset,
+	     uint64_t *max) const {
+      uint64_t blockno = su.div(off);
+      uint64_t stripeno = stripe_count.div(blockno);
+      uint64_t stripepos = stripe_count.mod(blockno);
+      uint64_t objectsetno = stripes_per_object.div(stripeno);
+      uint64_t block_off = su.mod(off);
+      *objectno = objectsetno * stripe_count.d + stripepos;
+      *x_offset = stripes_per_object.mod(stripeno) * su.d + block_off;
+      *max = su.d - block_off;
+    }
+  };
+}
+
 void Striper::file_to_extents(CephContext *cct, const char *object_format,
 			      const file_layout_t *layout,
 			      uint64_t offset, uint64_t len,
@@ -33,6 +78,36 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
 			      vector<ObjectExtent>& extents,
 			      uint64_t buffer_offset)
 {
+  assert(len > 0);
+  __u32 su = layout->stripe_count == 1 ? layout->object_size :
+    layout->stripe_unit;
+  assert(su > 0);
+
+  // a range within one stripe unit is always a single object extent;
+  // build it in place instead of going through the per-object map
+  if (offset % su + len <= su) {
+    ldout(cct, 10) << "file_to_extents " << offset << "~" << len
+		   << " format " << object_format << " (single)" << dendl;
+    assert(layout->object_size >= layout->stripe_unit);
+    StripeMap sm(su, layout->stripe_count, layout->object_size);
+    uint64_t objectno, x_offset, max;
+    sm.map(offset, &objectno, &x_offset, &max);
+
+    char buf[strlen(object_format) + 32];
+    snprintf(buf, sizeof(buf), object_format, (long long unsigned)objectno);
+
+    extents.emplace_back(object_t(buf), objectno, x_offset, len,
+			 object_truncate_size(cct, layout, objectno,
+					      trunc_size));
+    ObjectExtent& ex = extents.back();
+    ex.oloc = OSDMap::file_to_object_locator(*layout);
+    ex.buffer_extents.reserve(1);
+    ex.buffer_extents.push_back(make_pair(buffer_offset, len));
+    ldout(cct, 15) << "file_to_extents  " << ex << " in " << ex.oloc
+		   << dendl;
+    return;
+  }
+
   map<object_t,vector<ObjectExtent> > object_extents;
   file_to_extents(cct, object_format, layout, offset, len, trunc_size,
 		  object_extents, buffer_offset);
@@ -66,47 +141,34 @@ void Striper::file_to_extents(
     ldout(cct, 20) << " sc is one, reset su to os" << dendl;
     su = object_size;
   }
-  uint64_t stripes_per_object = object_size / su;
+  StripeMap sm(su, stripe_count, object_size);
   ldout(cct, 20) << " su " << su << " sc " << stripe_count << " os "
-		 << object_size << " stripes_per_object " << stripes_per_object
-		 << dendl;
+		 << object_size << " stripes_per_object "
+		 << sm.stripes_per_object.d << dendl;
+
+  const object_locator_t oloc = OSDMap::file_to_object_locator(*layout);
+  char buf[strlen(object_format) + 32];
 
   uint64_t cur = offset;
   uint64_t left = len;
   while (left > 0) {
     // layout into objects
-    uint64_t blockno = cur / su; // which block
-    // which horizontal stripe (Y)
-    uint64_t stripeno = blockno / stripe_count;
-    // which object in the object set (X)
-    uint64_t stripepos = blockno % stripe_count;
-    // which object set
-    uint64_t objectsetno = stripeno / stripes_per_object;
-    // object id
-    uint64_t objectno = objectsetno * stripe_count + stripepos;
+    uint64_t objectno, x_offset, max;
+    sm.map(cur, &objectno, &x_offset, &max);
 
     // find oid, extent
-    char buf[strlen(object_format) + 32];
     snprintf(buf, sizeof(buf), object_format, (long long unsigned)objectno);
     object_t oid = buf;
 
     // map range into object
-    uint64_t block_start = (stripeno % stripes_per_object) * su;
-    uint64_t block_off = cur % su;
-    uint64_t max = su - block_off;
-
-    uint64_t x_offset = block_start + block_off;
     uint64_t x_len;
     if (left > max)
       x_len = max;
     else
       x_len = left;
 
-    ldout(cct, 20) << " off " << cur << " blockno " << blockno << " stripeno "
-		   << stripeno << " stripepos " << stripepos << " objectsetno "
-		   << objectsetno << " objectno " << objectno
-		   << " block_start " << block_start << " block_off "
-		   << block_off << " " << x_offset << "~" << x_len
+    ldout(cct, 20) << " off " << cur << " objectno " << objectno
+		   << " " << x_offset << "~" << x_len
 		   << dendl;
 
     ObjectExtent *ex = 0;
@@ -116,7 +178,7 @@ void Striper::file_to_extents(
       ex = &exv.back();
       ex->oid = oid;
       ex->objectno = objectno;
-      ex->oloc = OSDMap::file_to_object_locator(*layout);
+      ex->oloc = oloc;
 
       ex->offset = x_offset;
       ex->length = x_len;
@@ -149,14 +211,14 @@ void Striper::assimilate_extents(
   vector<ObjectExtent>& extents)
 {
   // make final list
-  for (map<object_t, vector<ObjectExtent> >::iterator it
-	 = object_extents.begin();
-       it != object_extents.end();
-       ++it) {
-    for (vector<ObjectExtent>::iterator p = it->second.begin();
-	 p != it->second.end();
-	 ++p) {
-      extents.push_back(*p);
+  size_t n = 0;
+  for (auto& p : object_extents) {
+    n += p.second.size();
+  }
+  extents.reserve(extents.size() + n);
+  for (auto& p : object_extents) {
+    for (auto& ex : p.second) {
+      extents.push_back(std::move(ex));
     }
   }
 }
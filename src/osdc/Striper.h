@@ -54,6 +54,7 @@ class CephContext;
       file_to_extents(cct, buf, layout, offset, len, trunc_size, extents);
     }
 
+    /// flatten per-object extents into a list; object_extents is consumed
     static void assimilate_extents(
       map<object_t, vector<ObjectExtent> >& object_extents,
       vector<ObjectExtent>& extents);
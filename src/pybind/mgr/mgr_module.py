@@ -135,6 +135,17 @@ class MgrModule(object):
         """
         return ceph_state.get_counter(self._handle, svc_type, svc_name, path)
 
+    def get_perf_counters_expfmt(self):
+        """
+        Fetch the latest value of every perf counter of every service,
+        formatted as Prometheus text exposition.  Much cheaper than
+        calling ``get_counter`` for each counter, as no Python object
+        is created per value.
+
+        :return: str
+        """
+        return ceph_state.get_perf_counters_expfmt(self._handle)
+
     def list_servers(self):
         """
         Like ``get_server``, but instead of returning information
@@ -2150,6 +2150,8 @@ static void get_data_sync_status(const string& source_zone, list<string>& status
       derr << "ERROR: failed to fetch next positions (" << cpp_strerror(-ret) << ")" << dendl;
     } else {
       ceph::real_time oldest;
+      auto now = ceph::real_clock::now();
+      stringstream lag;
       for (auto iter : master_pos) {
         rgw_datalog_shard_data& shard_data = iter.second;
 
@@ -2160,12 +2162,19 @@ static void get_data_sync_status(const string& source_zone, list<string>& status
           } else if (!ceph::real_clock::is_zero(entry.timestamp) && entry.timestamp < oldest) {
             oldest = entry.timestamp;
           }
+          if (!ceph::real_clock::is_zero(entry.timestamp)) {
+            auto secs = std::chrono::duration_cast<std::chrono::seconds>(now - entry.timestamp);
+            lag << " " << iter.first << ":" << std::max<int64_t>(secs.count(), 0) << "s";
+          }
         }
       }
 
       if (!ceph::real_clock::is_zero(oldest)) {
         push_ss(ss, status, tab) << "oldest incremental change not applied: " << oldest;
       }
+      if (!lag.str().empty()) {
+        push_ss(ss, status, tab) << "shard lag (shard:seconds):" << lag.str();
+      }
     }
   }
 
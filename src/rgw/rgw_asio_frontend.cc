@@ -2,6 +2,8 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -69,8 +71,11 @@ void Pauser::wait()
 
 using tcp = boost::asio::ip::tcp;
 
-// coroutine to handle a client connection to completion
+// coroutine to handle a client connection to completion. if
+// request_service is given, requests are processed on its threads while
+// the coroutine yields, otherwise they're processed inline
 static void handle_connection(RGWProcessEnv& env, tcp::socket socket,
+                              boost::asio::io_service* request_service,
                               boost::asio::yield_context yield)
 {
   auto cct = env.store->ctx();
@@ -106,20 +111,43 @@ static void handle_connection(RGWProcessEnv& env, tcp::socket socket,
     }
 
     // process the request
-    RGWRequest req{env.store->get_new_req_id()};
-
-    rgw::asio::ClientIO real_client{socket, parser, buffer};
-
-    auto real_client_io = rgw::io::add_reordering(
-                            rgw::io::add_buffering(cct,
-                              rgw::io::add_chunking(
-                                rgw::io::add_conlen_controlling(
-                                  &real_client))));
-    RGWRestfulIO client(cct, &real_client_io);
-    process_request(env.store, env.rest, &req, env.uri_prefix,
-                    *env.auth_registry, &client, env.olog);
+    bool conn_close = false;
+    auto process = [&] {
+      RGWRequest req{env.store->get_new_req_id()};
+
+      rgw::asio::ClientIO real_client{socket, parser, buffer};
+
+      auto real_client_io = rgw::io::add_reordering(
+                              rgw::io::add_buffering(cct,
+                                rgw::io::add_chunking(
+                                  rgw::io::add_conlen_controlling(
+                                    &real_client))));
+      RGWRestfulIO client(cct, &real_client_io);
+      process_request(env.store, env.rest, &req, env.uri_prefix,
+                      *env.auth_registry, &client, env.olog);
+      conn_close = real_client.get_conn_close();
+    };
+
+    if (!request_service) {
+      process();
+    } else {
+      // the socket is only used by the request thread until it posts the
+      // completion back to an i/o thread, which resumes this coroutine
+      using handler_type = boost::asio::handler_type<
+          boost::asio::yield_context, void(boost::system::error_code)>::type;
+      handler_type handler(yield[ec]);
+      boost::asio::async_result<handler_type> result(handler);
+      auto& service = socket.get_io_service();
+      // keep service.run() from returning while the request is out
+      boost::asio::io_service::work work(service);
+      request_service->post([&] {
+        process();
+        service.post(std::bind(handler, boost::system::error_code{}));
+      });
+      result.get();
+    }
 
-    if (real_client.get_conn_close()) {
+    if (conn_close) {
       return;
     }
   }
@@ -133,6 +161,14 @@ class AsioFrontend {
   tcp::socket peer_socket;
 
   std::vector<std::thread> threads;
+
+  // with rgw_beast_io_threads, the threads above only do socket i/o and
+  // requests are processed by these, so that idle keep-alive connections
+  // and slow clients don't tie up a request thread
+  boost::asio::io_service request_service;
+  std::unique_ptr<boost::asio::io_service::work> request_work;
+  std::vector<std::thread> request_threads;
+
   Pauser pauser;
   std::atomic<bool> going_down{false};
 
@@ -188,10 +224,12 @@ void AsioFrontend::accept(boost::system::error_code ec)
     throw ec;
   }
   auto socket = std::move(peer_socket);
+  auto rservice = request_work ? &request_service : nullptr;
   // spawn a coroutine to handle the connection
   boost::asio::spawn(service,
                      [&] (boost::asio::yield_context yield) {
-                       handle_connection(env, std::move(socket), yield);
+                       handle_connection(env, std::move(socket), rservice,
+                                         yield);
                      });
   acceptor.async_accept(peer_socket,
                         [this] (boost::system::error_code ec) {
@@ -202,9 +240,22 @@ void AsioFrontend::accept(boost::system::error_code ec)
 int AsioFrontend::run()
 {
   auto cct = ctx();
-  const int thread_count = cct->_conf->rgw_thread_pool_size;
+  const int io_threads = cct->_conf->rgw_beast_io_threads;
+  const int thread_count = io_threads > 0 ? io_threads :
+                           cct->_conf->rgw_thread_pool_size;
   threads.reserve(thread_count);
 
+  if (io_threads > 0) {
+    const int request_count = cct->_conf->rgw_thread_pool_size;
+    ldout(cct, 4) << "frontend spawning " << request_count
+        << " request threads" << dendl;
+    request_work.reset(new boost::asio::io_service::work(request_service));
+    request_threads.reserve(request_count);
+    for (int i = 0; i < request_count; i++) {
+      request_threads.emplace_back([=] { request_service.run(); });
+    }
+  }
+
   ldout(cct, 4) << "frontend spawning " << thread_count << " threads" << dendl;
 
   for (int i = 0; i < thread_count; i++) {
@@ -240,6 +291,11 @@ void AsioFrontend::join()
   for (auto& thread : threads) {
     thread.join();
   }
+  // no connection is left to hand out requests
+  request_work.reset();
+  for (auto& thread : request_threads) {
+    thread.join();
+  }
   ldout(ctx(), 4) << "frontend done" << dendl;
 }
 
@@ -2,7 +2,9 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <algorithm>
+#include <list>
 #include <map>
+#include <mutex>
 #include <iterator>
 #include <string>
 #include <vector>
@@ -731,6 +733,58 @@ transform_secret_key(const boost::string_view& secret_access_key)
   return secret_key_utf8;
 }
 
+/*
+ * the v4 signing key depends only on the secret key and on the date, region
+ * and service of the credential scope, so a client keeps using the same one
+ * for a whole day. derived keys are kept in a small sharded lru to skip the
+ * four hmacs on most requests.
+ */
+class V4SigningKeyCache {
+  static constexpr size_t SHARDS = 16;
+
+  struct shard {
+    std::mutex lock;
+    std::list<std::string> lru;
+    std::map<std::string,
+             std::pair<sha256_digest_t, std::list<std::string>::iterator>> keys;
+  } shards[SHARDS];
+
+  shard& get_shard(const std::string& key) {
+    return shards[std::hash<std::string>()(key) % SHARDS];
+  }
+
+public:
+  bool find(const std::string& key, sha256_digest_t& signing_key) {
+    shard& sh = get_shard(key);
+    std::lock_guard<std::mutex> l(sh.lock);
+    auto iter = sh.keys.find(key);
+    if (iter == sh.keys.end()) {
+      return false;
+    }
+    sh.lru.splice(sh.lru.begin(), sh.lru, iter->second.second);
+    signing_key = iter->second.first;
+    return true;
+  }
+
+  void add(const std::string& key, const sha256_digest_t& signing_key,
+           const size_t max) {
+    const size_t shard_max = (max + SHARDS - 1) / SHARDS;
+    shard& sh = get_shard(key);
+    std::lock_guard<std::mutex> l(sh.lock);
+    if (sh.keys.find(key) != sh.keys.end()) {
+      return;
+    }
+    sh.lru.push_front(key);
+    sh.keys.emplace(key, std::make_pair(signing_key, sh.lru.begin()));
+    while (sh.lru.size() > shard_max) {
+      sh.keys.erase(sh.lru.back());
+      sh.lru.pop_back();
+    }
+  }
+};
+
+static V4SigningKeyCache v4_signing_keys;
+
 /*
  * calculate the SigningKey of AWS auth version 4
  */
@@ -742,6 +796,30 @@ get_v4_signing_key(CephContext* const cct,
   boost::string_view date, region, service;
   std::tie(date, region, service) = parse_cred_scope(credential_scope);
 
+  const size_t cache_size = std::max<int64_t>(
+    cct->_conf->rgw_s3_auth_v4_signing_key_cache_size, 0);
+  std::string cache_key;
+  if (cache_size > 0) {
+    cache_key.reserve(secret_access_key.size() + date.size() +
+                      region.size() + service.size() + 3);
+    cache_key.append(secret_access_key.data(), secret_access_key.size());
+    cache_key.push_back('\0');
+    cache_key.append(date.data(), date.size());
+    cache_key.push_back('/');
+    cache_key.append(region.data(), region.size());
+    cache_key.push_back('/');
+    cache_key.append(service.data(), service.size());
+
+    sha256_digest_t signing_key;
+    if (v4_signing_keys.find(cache_key, signing_key)) {
+      if (perfcounter) perfcounter->inc(l_rgw_s3_signing_key_cache_hit);
+      ldout(cct, 10) << "signing_k = " << buf_to_hex(signing_key).data()
+                     << " (cached)" << dendl;
+      return signing_key;
+    }
+    if (perfcounter) perfcounter->inc(l_rgw_s3_signing_key_cache_miss);
+  }
+
   const auto utfed_sec_key = transform_secret_key(secret_access_key);
   const auto date_k = calc_hmac_sha256(utfed_sec_key, date);
   const auto region_k = calc_hmac_sha256(date_k, region);
@@ -756,6 +834,10 @@ get_v4_signing_key(CephContext* const cct,
   ldout(cct, 10) << "service_k = " << buf_to_hex(service_k).data() << dendl;
   ldout(cct, 10) << "signing_k = " << buf_to_hex(signing_key).data() << dendl;
 
+  if (cache_size > 0) {
+    v4_signing_keys.add(cache_key, signing_key, cache_size);
+  }
+
   return signing_key;
 }
 
@@ -492,7 +492,8 @@ static bool bucket_object_check_filter(const string& oid)
   return rgw_obj_key::oid_to_key_in_ns(oid, &key, ns);
 }
 
-int rgw_remove_object(RGWRados *store, RGWBucketInfo& bucket_info, rgw_bucket& bucket, rgw_obj_key& key)
+int rgw_remove_object(RGWRados *store, RGWBucketInfo& bucket_info, rgw_bucket& bucket, rgw_obj_key& key,
+                      RGWRados::IndexCompleteBatch *index_batch)
 {
   RGWObjectCtx rctx(store);
 
@@ -502,7 +503,8 @@ int rgw_remove_object(RGWRados *store, RGWBucketInfo& bucket_info, rgw_bucket& b
 
   rgw_obj obj(bucket, key);
 
-  return store->delete_obj(rctx, bucket_info, obj, bucket_info.versioning_status());
+  return store->delete_obj(rctx, bucket_info, obj, bucket_info.versioning_status(),
+                           0, real_time(), nullptr, index_batch);
 }
 
 int rgw_remove_bucket(RGWRados *store, rgw_bucket& bucket, bool delete_children)
@@ -5,12 +5,55 @@
 
 #include <errno.h>
 
+#include "include/ceph_hash.h"
+
 #define dout_subsys ceph_subsys_rgw
 
 using namespace std;
 
+void ObjectCache::set_ctx(CephContext *_cct)
+{
+  cct = _cct;
+
+  unsigned num_shards = std::max<int64_t>(cct->_conf->rgw_cache_shards, 1);
+  shards.clear();
+  for (unsigned i = 0; i < num_shards; ++i) {
+    shards.emplace_back(new ObjectCacheShard);
+  }
+  lru_max = std::max<unsigned long>(cct->_conf->rgw_cache_lru_size / num_shards, 1);
+  lru_window = lru_max / 2;
+}
+
+ObjectCacheShard& ObjectCache::get_shard(const string& name)
+{
+  assert(!shards.empty());
+  uint32_t h = ceph_str_hash_linux(name.c_str(), name.size());
+  return *shards[h % shards.size()];
+}
+
+void ObjectCache::lock_all()
+{
+  for (auto& shard : shards) {
+    shard->lock.get_write();
+  }
+}
+
+void ObjectCache::unlock_all()
+{
+  for (auto& shard : shards) {
+    shard->lock.unlock();
+  }
+}
+
 int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
 {
+  if (shards.empty()) {
+    return -ENOENT;
+  }
+
+  ObjectCacheShard& shard = get_shard(name);
+  std::map<string, ObjectCacheEntry>& cache_map = shard.cache_map;
+  RWLock& lock = shard.lock;
   RWLock::RLocker l(lock);
 
   if (!enabled) {
@@ -26,8 +69,8 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter
+  if (shard.lru_counter - entry->lru_promotion_ts > lru_window) {
+    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << shard.lru_counter
                    << " promotion_ts=" << entry->lru_promotion_ts << dendl;
     lock.unlock();
     lock.get_write(); /* promote lock to writer */
@@ -42,8 +85,8 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
     entry = &iter->second;
     /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
+    if (shard.lru_counter - entry->lru_promotion_ts > lru_window) {
+      touch_lru(shard, name, *entry, iter->second.lru_iter);
     }
   }
 
@@ -71,8 +114,31 @@ int ObjectCache::get(string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cac
 
 bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry)
 {
-  RWLock::WLocker l(lock);
+  if (shards.empty()) {
+    return false;
+  }
+
+  /* the entries may live in different shards, take them in shard order */
+  std::set<ObjectCacheShard *> locked;
+  for (auto cache_info : cache_info_entries) {
+    locked.insert(&get_shard(cache_info->cache_locator));
+  }
+  std::vector<ObjectCacheShard *> ordered;
+  for (auto& shard : shards) {
+    if (locked.count(shard.get())) {
+      shard->lock.get_write();
+      ordered.push_back(shard.get());
+    }
+  }
+  bool ret = do_chain_cache_entry(cache_info_entries, chained_entry);
+  for (auto shard : ordered) {
+    shard->lock.unlock();
+  }
+  return ret;
+}
 
+bool ObjectCache::do_chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry)
+{
   if (!enabled) {
     return false;
   }
@@ -86,6 +152,7 @@ bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_ent
     rgw_cache_entry_info *cache_info = *citer;
 
     ldout(cct, 10) << "chain_cache_entry: cache_locator=" << cache_info->cache_locator << dendl;
+    std::map<string, ObjectCacheEntry>& cache_map = get_shard(cache_info->cache_locator).cache_map;
     map<string, ObjectCacheEntry>::iterator iter = cache_map.find(cache_info->cache_locator);
     if (iter == cache_map.end()) {
       ldout(cct, 20) << "chain_cache_entry: couldn't find cache locator" << dendl;
@@ -118,7 +185,13 @@ bool ObjectCache::chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_ent
 
 void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  RWLock::WLocker l(lock);
+  if (shards.empty()) {
+    return;
+  }
+
+  ObjectCacheShard& shard = get_shard(name);
+  std::map<string, ObjectCacheEntry>& cache_map = shard.cache_map;
+  RWLock::WLocker l(shard.lock);
 
   if (!enabled) {
     return;
@@ -129,7 +202,7 @@ void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info
   map<string, ObjectCacheEntry>::iterator iter = cache_map.find(name);
   if (iter == cache_map.end()) {
     ObjectCacheEntry entry;
-    entry.lru_iter = lru.end();
+    entry.lru_iter = shard.lru.end();
     cache_map.insert(pair<string, ObjectCacheEntry>(name, entry));
     iter = cache_map.find(name);
   }
@@ -145,7 +218,7 @@ void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(name, entry, entry.lru_iter);
+  touch_lru(shard, name, entry, entry.lru_iter);
 
   target.status = info.status;
 
@@ -195,7 +268,13 @@ void ObjectCache::put(string& name, ObjectCacheInfo& info, rgw_cache_entry_info
 
 void ObjectCache::remove(string& name)
 {
-  RWLock::WLocker l(lock);
+  if (shards.empty()) {
+    return;
+  }
+
+  ObjectCacheShard& shard = get_shard(name);
+  std::map<string, ObjectCacheEntry>& cache_map = shard.cache_map;
+  RWLock::WLocker l(shard.lock);
 
   if (!enabled) {
     return;
@@ -214,13 +293,16 @@ void ObjectCache::remove(string& name)
     chained_cache->invalidate(iiter->second);
   }
 
-  remove_lru(name, iter->second.lru_iter);
+  remove_lru(shard, name, iter->second.lru_iter);
   cache_map.erase(iter);
 }
 
-void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter)
+void ObjectCache::touch_lru(ObjectCacheShard& shard, string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
+  std::list<string>& lru = shard.lru;
+  std::map<string, ObjectCacheEntry>& cache_map = shard.cache_map;
+
+  while (shard.lru_size > lru_max) {
     list<string>::iterator iter = lru.begin();
     if ((*iter).compare(name) == 0) {
       /*
@@ -234,12 +316,12 @@ void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<str
     if (map_iter != cache_map.end())
       cache_map.erase(map_iter);
     lru.pop_front();
-    lru_size--;
+    shard.lru_size--;
   }
 
   if (lru_iter == lru.end()) {
     lru.push_back(name);
-    lru_size++;
+    shard.lru_size++;
     lru_iter--;
     ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
@@ -250,54 +332,60 @@ void ObjectCache::touch_lru(string& name, ObjectCacheEntry& entry, std::list<str
     --lru_iter;
   }
 
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  shard.lru_counter++;
+  entry.lru_promotion_ts = shard.lru_counter;
 }
 
-void ObjectCache::remove_lru(string& name, std::list<string>::iterator& lru_iter)
+void ObjectCache::remove_lru(ObjectCacheShard& shard, string& name, std::list<string>::iterator& lru_iter)
 {
-  if (lru_iter == lru.end())
+  if (lru_iter == shard.lru.end())
     return;
 
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  shard.lru.erase(lru_iter);
+  shard.lru_size--;
+  lru_iter = shard.lru.end();
 }
 
 void ObjectCache::set_enabled(bool status)
 {
-  RWLock::WLocker l(lock);
+  lock_all();
 
   enabled = status;
 
   if (!enabled) {
     do_invalidate_all();
   }
+
+  unlock_all();
 }
 
 void ObjectCache::invalidate_all()
 {
-  RWLock::WLocker l(lock);
+  lock_all();
 
   do_invalidate_all();
+
+  unlock_all();
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
+  for (auto& shard : shards) {
+    shard->cache_map.clear();
+    shard->lru.clear();
 
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+    shard->lru_size = 0;
+    shard->lru_counter = 0;
+  }
 
+  RWLock::RLocker l(chain_lock);
   for (list<RGWChainedCache *>::iterator iter = chained_cache.begin(); iter != chained_cache.end(); ++iter) {
     (*iter)->invalidate_all();
   }
 }
 
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  RWLock::WLocker l(lock);
+  RWLock::WLocker l(chain_lock);
   chained_cache.push_back(cache);
 }
 
@@ -7,14 +7,20 @@
 #include "rgw_rados.h"
 #include <string>
 #include <map>
+#include <memory>
+#include <set>
+#include <vector>
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/assert.h"
 #include "common/RWLock.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
 
 enum {
   UPDATE_OBJ,
   REMOVE_OBJ,
+  BATCH_OBJ,   // followed by an encoded RGWCacheNotifyBatch
 };
 
 #define CACHE_FLAG_DATA           0x01
@@ -124,6 +130,27 @@ struct RGWCacheNotifyInfo {
 };
 WRITE_CLASS_ENCODER(RGWCacheNotifyInfo)
 
+/*
+ * several notifications for the same control object sent as one notify;
+ * only understood by gateways that know about BATCH_OBJ, see
+ * rgw_cache_notify_batch
+ */
+struct RGWCacheNotifyBatch {
+  list<RGWCacheNotifyInfo> entries;
+
+  void encode(bufferlist& obl) const {
+    ENCODE_START(1, 1, obl);
+    ::encode(entries, obl);
+    ENCODE_FINISH(obl);
+  }
+  void decode(bufferlist::iterator& ibl) {
+    DECODE_START(1, ibl);
+    ::decode(entries, ibl);
+    DECODE_FINISH(ibl);
+  }
+};
+WRITE_CLASS_ENCODER(RGWCacheNotifyBatch)
+
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
   std::list<string>::iterator lru_iter;
@@ -134,32 +161,48 @@ struct ObjectCacheEntry {
   ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
 };
 
-class ObjectCache {
+/**
+ * One lock stripe of the ObjectCache: entries hash to a shard by name and
+ * each shard keeps its own map, lru and lock, so that lookups of different
+ * objects don't serialize on a single lock.
+ */
+struct ObjectCacheShard {
   std::map<string, ObjectCacheEntry> cache_map;
   std::list<string> lru;
   unsigned long lru_size;
   unsigned long lru_counter;
-  unsigned long lru_window;
   RWLock lock;
+
+  ObjectCacheShard() : lru_size(0), lru_counter(0),
+                       lock("ObjectCacheShard", true, false) { }
+};
+
+class ObjectCache {
+  std::vector<std::unique_ptr<ObjectCacheShard> > shards;
+  unsigned long lru_max;    // per shard
+  unsigned long lru_window; // per shard
   CephContext *cct;
 
+  RWLock chain_lock;
   list<RGWChainedCache *> chained_cache;
 
-  bool enabled;
+  bool enabled; // protected by all the shard locks
+
+  ObjectCacheShard& get_shard(const string& name);
+  void lock_all();
+  void unlock_all();
 
-  void touch_lru(string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
-  void remove_lru(string& name, std::list<string>::iterator& lru_iter);
+  void touch_lru(ObjectCacheShard& shard, string& name, ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter);
+  void remove_lru(ObjectCacheShard& shard, string& name, std::list<string>::iterator& lru_iter);
 
+  bool do_chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry);
   void do_invalidate_all();
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  ObjectCache() : lru_max(0), lru_window(0), cct(NULL), chain_lock("ObjectCache::chain_lock"), enabled(false) { }
   int get(std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   void put(std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
   void remove(std::string& name);
-  void set_ctx(CephContext *_cct) {
-    cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
-  }
+  void set_ctx(CephContext *_cct);
   bool chain_cache_entry(list<rgw_cache_entry_info *>& cache_info_entries, RGWChainedCache::Entry *chained_entry);
 
   void set_enabled(bool status);
@@ -173,6 +216,33 @@ class RGWCache  : public T
 {
   ObjectCache cache;
 
+  struct NotifyWaiter {
+    RGWCacheNotifyInfo *info;
+    int r;
+    bool done;
+
+    NotifyWaiter(RGWCacheNotifyInfo *_info) : info(_info), r(0), done(false) {}
+  };
+
+  /*
+   * notifications queued for one control object: whoever finds no notify
+   * in flight sends everything queued so far, the others wait for it
+   */
+  struct NotifyBatch {
+    Mutex lock;
+    Cond cond;
+    bool sending;
+    list<NotifyWaiter *> pending;
+
+    NotifyBatch() : lock("RGWCache::NotifyBatch", false, false), sending(false) {}
+  };
+
+  Mutex notify_batches_lock;
+  map<string, std::unique_ptr<NotifyBatch> > notify_batches;
+
+  int distribute_batched(const string& normal_name, RGWCacheNotifyInfo& info);
+  int handle_notify(RGWCacheNotifyInfo& info);
+
   int list_objects_raw_init(rgw_pool& pool, RGWAccessHandle *handle) {
     return T::list_objects_raw_init(pool, handle);
   }
@@ -216,7 +286,7 @@ class RGWCache  : public T
     cache.set_enabled(state);
   }
 public:
-  RGWCache() {}
+  RGWCache() : notify_batches_lock("RGWCache::notify_batches_lock") {}
 
   void register_chained_cache(RGWChainedCache *cc) override {
     cache.chain_cache(cc);
@@ -528,30 +598,81 @@ int RGWCache<T>::distribute_cache(const string& normal_name, rgw_raw_obj& obj, O
 
   info.obj_info = obj_info;
   info.obj = obj;
+  if (T::cct->_conf->rgw_cache_notify_batch) {
+    return distribute_batched(normal_name, info);
+  }
   bufferlist bl;
   ::encode(info, bl);
   return T::distribute(normal_name, bl);
 }
 
 template <class T>
-int RGWCache<T>::watch_cb(uint64_t notify_id,
-			  uint64_t cookie,
-			  uint64_t notifier_id,
-			  bufferlist& bl)
+int RGWCache<T>::distribute_batched(const string& normal_name, RGWCacheNotifyInfo& info)
 {
-  RGWCacheNotifyInfo info;
+  string notify_oid;
+  T::pick_control_oid(normal_name, notify_oid);
+
+  NotifyBatch *batch;
+  {
+    Mutex::Locker l(notify_batches_lock);
+    std::unique_ptr<NotifyBatch>& b = notify_batches[notify_oid];
+    if (!b) {
+      b.reset(new NotifyBatch);
+    }
+    batch = b.get();
+  }
+
+  /*
+   * we only return once a notify carrying our entry has been acked, same
+   * as when sending it on its own, so that other gateways have seen the
+   * change before the caller goes on
+   */
+  NotifyWaiter waiter(&info);
+  Mutex::Locker l(batch->lock);
+  batch->pending.push_back(&waiter);
+  while (!waiter.done) {
+    if (batch->sending) {
+      batch->cond.Wait(batch->lock);
+      continue;
+    }
 
-  try {
-    bufferlist::iterator iter = bl.begin();
-    ::decode(info, iter);
-  } catch (buffer::end_of_buffer& err) {
-    mydout(0) << "ERROR: got bad notification" << dendl;
-    return -EIO;
-  } catch (buffer::error& err) {
-    mydout(0) << "ERROR: buffer::error" << dendl;
-    return -EIO;
+    list<NotifyWaiter *> waiters;
+    waiters.swap(batch->pending);
+    batch->sending = true;
+    batch->lock.Unlock();
+
+    bufferlist bl;
+    if (waiters.size() == 1) {
+      ::encode(*waiters.front()->info, bl);
+    } else {
+      RGWCacheNotifyInfo header;
+      header.op = BATCH_OBJ;
+      RGWCacheNotifyBatch entries;
+      for (auto w : waiters) {
+        entries.entries.push_back(std::move(*w->info));
+      }
+      ::encode(header, bl);
+      ::encode(entries, bl);
+      mydout(20) << "distributing " << waiters.size()
+                 << " cache notifications to " << notify_oid << dendl;
+    }
+    int r = T::distribute(normal_name, bl);
+
+    batch->lock.Lock();
+    for (auto w : waiters) {
+      w->r = r;
+      w->done = true;
+    }
+    batch->sending = false;
+    batch->cond.SignalAll();
   }
 
+  return waiter.r;
+}
+
+template <class T>
+int RGWCache<T>::handle_notify(RGWCacheNotifyInfo& info)
+{
   rgw_pool pool;
   string oid;
   normalize_pool_and_obj(info.obj.pool, info.obj.oid, pool, oid);
@@ -572,4 +693,41 @@ int RGWCache<T>::watch_cb(uint64_t notify_id,
   return 0;
 }
 
+template <class T>
+int RGWCache<T>::watch_cb(uint64_t notify_id,
+			  uint64_t cookie,
+			  uint64_t notifier_id,
+			  bufferlist& bl)
+{
+  RGWCacheNotifyInfo info;
+  RGWCacheNotifyBatch batch;
+
+  try {
+    bufferlist::iterator iter = bl.begin();
+    ::decode(info, iter);
+    if (info.op == BATCH_OBJ) {
+      ::decode(batch, iter);
+    }
+  } catch (buffer::end_of_buffer& err) {
+    mydout(0) << "ERROR: got bad notification" << dendl;
+    return -EIO;
+  } catch (buffer::error& err) {
+    mydout(0) << "ERROR: buffer::error" << dendl;
+    return -EIO;
+  }
+
+  if (info.op != BATCH_OBJ) {
+    return handle_notify(info);
+  }
+
+  int ret = 0;
+  for (auto& entry : batch.entries) {
+    int r = handle_notify(entry);
+    if (r < 0) {
+      ret = r;
+    }
+  }
+  return ret;
+}
+
 #endif
@@ -143,6 +143,30 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_put_b, "put_b", "Size of puts");
   plb.add_time_avg(l_rgw_put_lat, "put_initial_lat", "Put latency");
 
+  // latency in nanoseconds, object size in bytes, both on a log2 scale
+  PerfHistogramCommon::axis_config_d lat_axis_config{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    100000,                          ///< 100usec buckets
+    32,
+  };
+  PerfHistogramCommon::axis_config_d size_axis_config{
+    "Request size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    512,                             ///< 512 byte buckets
+    32,
+  };
+  plb.add_u64_counter_histogram(
+    l_rgw_get_lat_bytes_hist, "get_lat_bytes_histogram",
+    lat_axis_config, size_axis_config,
+    "Histogram of complete get latency + bytes sent");
+  plb.add_u64_counter_histogram(
+    l_rgw_put_lat_bytes_hist, "put_lat_bytes_histogram",
+    lat_axis_config, size_axis_config,
+    "Histogram of complete put latency + bytes received");
+
   plb.add_u64(l_rgw_qlen, "qlen", "Queue length");
   plb.add_u64(l_rgw_qactive, "qactive", "Active requests queue");
 
@@ -152,6 +176,23 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
+  plb.add_u64_counter(l_rgw_s3_signing_key_cache_hit, "s3_signing_key_cache_hit", "AWS v4 signing key cache hits");
+  plb.add_u64_counter(l_rgw_s3_signing_key_cache_miss, "s3_signing_key_cache_miss", "AWS v4 signing key cache miss");
+
+  plb.add_u64_counter(l_rgw_gc_retire_object, "gc_retire_object", "GC object removals");
+  plb.add_u64(l_rgw_gc_shards_behind, "gc_shards_behind", "GC shards left with expired entries by the last round");
+
+  plb.add_u64_counter(l_rgw_lc_expire_current, "lc_expire_current", "Lifecycle current expiration");
+  plb.add_u64_counter(l_rgw_lc_expire_noncurrent, "lc_expire_noncurrent", "Lifecycle non-current expiration");
+  plb.add_u64_counter(l_rgw_lc_expire_dm, "lc_expire_dm", "Lifecycle delete-marker expiration");
+  plb.add_u64_counter(l_rgw_lc_abort_mpu, "lc_abort_mpu", "Lifecycle abort multipart upload");
+
+  plb.add_u64_counter(l_rgw_ops_log_queued, "ops_log_queued", "Ops log entries queued for rados");
+  plb.add_u64_counter(l_rgw_ops_log_dropped, "ops_log_dropped", "Ops log entries dropped because the backlog was full");
+  plb.add_u64_counter(l_rgw_ops_log_writes, "ops_log_writes", "Batched ops log appends to rados");
+  plb.add_u64_counter(l_rgw_usage_log_flush, "usage_log_flush", "Usage log flushes");
+  plb.add_u64_counter(l_rgw_usage_log_inline_flush, "usage_log_inline_flush", "Usage log flushes done by a request thread because the backlog was full");
+
   perfcounter = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perfcounter);
   return 0;
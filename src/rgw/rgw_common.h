@@ -242,10 +242,12 @@ enum {
   l_rgw_get,
   l_rgw_get_b,
   l_rgw_get_lat,
+  l_rgw_get_lat_bytes_hist,
 
   l_rgw_put,
   l_rgw_put_b,
   l_rgw_put_lat,
+  l_rgw_put_lat_bytes_hist,
 
   l_rgw_qlen,
   l_rgw_qactive,
@@ -256,6 +258,23 @@ enum {
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
+  l_rgw_s3_signing_key_cache_hit,
+  l_rgw_s3_signing_key_cache_miss,
+
+  l_rgw_gc_retire_object,
+  l_rgw_gc_shards_behind,
+
+  l_rgw_lc_expire_current,
+  l_rgw_lc_expire_noncurrent,
+  l_rgw_lc_expire_dm,
+  l_rgw_lc_abort_mpu,
+
+  l_rgw_ops_log_queued,
+  l_rgw_ops_log_dropped,
+  l_rgw_ops_log_writes,
+  l_rgw_usage_log_flush,
+  l_rgw_usage_log_inline_flush,
+
   l_rgw_last,
 };
 
@@ -4,44 +4,233 @@
 
 #include "rgw_compression.h"
 
+#include <deque>
+
+#include "common/Cond.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
+
 #define dout_subsys ceph_subsys_rgw
 
 //------------RGWPutObj_Compress---------------
 
+class RGWPutObj_Compress::Worker : public Thread {
+  struct Block {
+    bufferlist data;
+    off_t ofs;
+    int r{0};
+    bool done{false};
+  };
+
+  CompressorRef compressor;
+  Mutex lock;
+  Cond cond;
+  std::deque<std::shared_ptr<Block>> blocks; /* all queued blocks, in order */
+  std::deque<std::shared_ptr<Block>> todo;
+  bool stopping{false};
+
+  void *entry() override {
+    Mutex::Locker l(lock);
+    for (;;) {
+      if (todo.empty()) {
+        if (stopping) {
+          break;
+        }
+        cond.Wait(lock);
+        continue;
+      }
+      auto b = todo.front();
+      todo.pop_front();
+      lock.Unlock();
+
+      bufferlist out;
+      int r = compressor->compress(b->data, out);
+
+      lock.Lock();
+      b->data.swap(out);
+      b->r = r;
+      b->done = true;
+      cond.SignalAll();
+    }
+    return nullptr;
+  }
+
+public:
+  explicit Worker(CompressorRef compressor)
+    : compressor(compressor), lock("RGWPutObj_Compress::Worker::lock") {}
+  ~Worker() override {
+    if (is_started()) {
+      lock.Lock();
+      stopping = true;
+      cond.SignalAll();
+      lock.Unlock();
+      join();
+    }
+  }
+
+  void queue(bufferlist& bl, off_t ofs) {
+    auto b = std::make_shared<Block>();
+    b->data.claim(bl);
+    b->ofs = ofs;
+    Mutex::Locker l(lock);
+    blocks.push_back(b);
+    todo.push_back(b);
+    cond.SignalAll();
+  }
+
+  size_t size() {
+    Mutex::Locker l(lock);
+    return blocks.size();
+  }
+
+  /* waits for the oldest queued block to be compressed */
+  int pop(bufferlist& out, off_t *ofs) {
+    Mutex::Locker l(lock);
+    assert(!blocks.empty());
+    auto b = blocks.front();
+    while (!b->done) {
+      cond.Wait(lock);
+    }
+    blocks.pop_front();
+    out.claim(b->data);
+    *ofs = b->ofs;
+    return b->r;
+  }
+};
+
+RGWPutObj_Compress::RGWPutObj_Compress(CephContext* cct_,
+                                       CompressorRef compressor,
+                                       RGWPutObjDataProcessor* next,
+                                       bool pipelined)
+  : RGWPutObj_Filter(next), cct(cct_), compressor(compressor),
+    pipelined(pipelined)
+{
+}
+
+RGWPutObj_Compress::~RGWPutObj_Compress()
+{
+}
+
+/*
+ * the first part decides whether the object is stored compressed. data that
+ * doesn't shrink below rgw_compression_max_ratio of its size is stored as
+ * is, so the remaining parts aren't compressed and reads don't need to
+ * decompress it.
+ */
+int RGWPutObj_Compress::compress_first(bufferlist& bl, off_t ofs, bufferlist& out)
+{
+  int cr = compressor->compress(bl, out);
+  if (cr < 0) {
+    ldout(cct, 5) << "Compression failed with exit code " << cr
+        << " for first part, storing uncompressed" << dendl;
+    compressed = false;
+    out.claim(bl);
+    return 0;
+  }
+
+  const double max_ratio = cct->_conf->rgw_compression_max_ratio;
+  if (out.length() > bl.length() * max_ratio) {
+    ldout(cct, 10) << "first part compressed from " << bl.length() << " to "
+        << out.length() << " bytes, storing uncompressed" << dendl;
+    compressed = false;
+    out.claim(bl);
+    return 0;
+  }
+
+  compressed = true;
+  add_block(ofs, out);
+  return 0;
+}
+
+void RGWPutObj_Compress::add_block(off_t ofs, const bufferlist& out)
+{
+  compression_block newbl;
+  size_t bs = blocks.size();
+  newbl.old_ofs = ofs;
+  newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
+  newbl.len = out.length();
+  blocks.push_back(newbl);
+}
+
+/*
+ * passes compressed parts on to the next processor, oldest first, until no
+ * more than drain_target of them are waiting. returns after every part that
+ * produced a write, so that the caller can throttle it.
+ */
+int RGWPutObj_Compress::pipeline(off_t ofs, void **phandle, rgw_raw_obj *pobj, bool *again)
+{
+  for (;;) {
+    bufferlist out;
+    off_t out_ofs = ofs;
+    if (!next_again) {
+      if (worker->size() > drain_target) {
+        int cr = worker->pop(out, &out_ofs);
+        if (cr < 0) {
+          lderr(cct) << "Compression failed with exit code " << cr
+              << " for next part, compression process failed" << dendl;
+          return -EIO;
+        }
+        add_block(out_ofs, out);
+      } else if (flushing) {
+        flushing = false;
+      } else {
+        *phandle = nullptr;
+        *again = false;
+        return 0;
+      }
+    }
+    int r = next->handle_data(out, out_ofs, phandle, pobj, &next_again);
+    if (r < 0) {
+      return r;
+    }
+    bool more = next_again || worker->size() > drain_target || flushing;
+    if (*phandle || !more) {
+      *again = more;
+      return r;
+    }
+  }
+}
+
 int RGWPutObj_Compress::handle_data(bufferlist& bl, off_t ofs, void **phandle, rgw_raw_obj *pobj, bool *again)
 {
+  if (worker) {
+    if (!*again) {
+      if (bl.length() > 0) {
+        ldout(cct, 10) << "Compression for rgw is enabled, queue part " << bl.length() << dendl;
+        worker->queue(bl, ofs);
+        /* keep one part compressing while the next one is received */
+        drain_target = 1;
+      } else {
+        drain_target = 0;
+        flushing = true;
+      }
+    }
+    return pipeline(ofs, phandle, pobj, again);
+  }
+
   bufferlist in_bl;
   if (*again) {
     return next->handle_data(in_bl, ofs, phandle, pobj, again);
   }
   if (bl.length() > 0) {
     // compression stuff
-    if ((ofs > 0 && compressed) ||                                // if previous part was compressed
-        (ofs == 0)) {                                             // or it's the first part
+    if (ofs == 0) {
+      ldout(cct, 10) << "Compression for rgw is enabled, compress part " << bl.length() << dendl;
+      compress_first(bl, ofs, in_bl);
+    } else if (compressed && pipelined) {
+      worker.reset(new Worker(compressor));
+      worker->create("rgw_compress");
+      return handle_data(bl, ofs, phandle, pobj, again);
+    } else if (compressed) {
       ldout(cct, 10) << "Compression for rgw is enabled, compress part " << bl.length() << dendl;
       int cr = compressor->compress(bl, in_bl);
       if (cr < 0) {
-        if (ofs > 0) {
-          lderr(cct) << "Compression failed with exit code " << cr
-              << " for next part, compression process failed" << dendl;
-          return -EIO;
-        }
-        compressed = false;
-        ldout(cct, 5) << "Compression failed with exit code " << cr
-            << " for first part, storing uncompressed" << dendl;
-        in_bl.claim(bl);
-      } else {
-        compressed = true;
-    
-        compression_block newbl;
-        size_t bs = blocks.size();
-        newbl.old_ofs = ofs;
-        newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
-        newbl.len = in_bl.length();
-        blocks.push_back(newbl);
+        lderr(cct) << "Compression failed with exit code " << cr
+            << " for next part, compression process failed" << dendl;
+        return -EIO;
       }
+      add_block(ofs, in_bl);
     } else {
-      compressed = false;
       in_bl.claim(bl);
     }
     // end of compression stuff
@@ -4,6 +4,7 @@
 #ifndef CEPH_RGW_COMPRESSION_H
 #define CEPH_RGW_COMPRESSION_H
 
+#include <memory>
 #include <vector>
 
 #include "compressor/Compressor.h"
@@ -33,15 +34,27 @@ public:
 
 class RGWPutObj_Compress : public RGWPutObj_Filter
 {
+  /* compresses the parts after the first one on its own thread */
+  class Worker;
+
   CephContext* cct;
   bool compressed{false};
   CompressorRef compressor;
   std::vector<compression_block> blocks;
+
+  bool pipelined;
+  std::unique_ptr<Worker> worker;
+  size_t drain_target{0};
+  bool flushing{false};
+  bool next_again{false};
+
+  int compress_first(bufferlist& bl, off_t ofs, bufferlist& out);
+  void add_block(off_t ofs, const bufferlist& out);
+  int pipeline(off_t ofs, void **phandle, rgw_raw_obj *pobj, bool *again);
 public:
   RGWPutObj_Compress(CephContext* cct_, CompressorRef compressor,
-                     RGWPutObjDataProcessor* next)
-    : RGWPutObj_Filter(next), cct(cct_), compressor(compressor) {}
-  ~RGWPutObj_Compress() override{}
+                     RGWPutObjDataProcessor* next, bool pipelined = false);
+  ~RGWPutObj_Compress() override;
   int handle_data(bufferlist& bl, off_t ofs, void **phandle, rgw_raw_obj *pobj, bool *again) override;
 
   bool is_compressed() { return compressed; }
@@ -4,6 +4,7 @@
 
 // re-include our assert to clobber the system one; fix dout:
 #include "include/assert.h"
+#include "include/demangle.h"
 
 #include <boost/asio/yield.hpp>
 
@@ -192,7 +193,9 @@ int RGWCoroutinesStack::operate(RGWCoroutinesEnv *_env)
   RGWCoroutine *op = *pos;
   op->stack = this;
   ldout(cct, 20) << *op << ": operate()" << dendl;
+  auto start = ceph::mono_clock::now();
   int r = op->operate();
+  ops_mgr->account_op(op, ceph::mono_clock::now() - start);
   if (r < 0) {
     ldout(cct, 20) << *op << ": operate() returned r=" << r << dendl;
   }
@@ -639,7 +642,34 @@ RGWAioCompletionNotifier *RGWCoroutinesManager::create_completion_notifier(RGWCo
   return cn;
 }
 
+void RGWCoroutinesManager::account_op(const RGWCoroutine *op, ceph::timespan t)
+{
+  std::lock_guard<std::mutex> l(stats_lock);
+  op_stats& st = stats[std::type_index(typeid(*op))];
+  ++st.count;
+  st.total += t;
+  if (t > st.max) {
+    st.max = t;
+  }
+}
+
 void RGWCoroutinesManager::dump(Formatter *f) const {
+  {
+    std::lock_guard<std::mutex> l(stats_lock);
+    f->open_array_section("op_stats");
+    for (auto& i : stats) {
+      auto& st = i.second;
+      f->open_object_section("op");
+      ::encode_json("type", ceph_demangle(i.first.name()), f);
+      ::encode_json("count", st.count, f);
+      ::encode_json("total_usec", (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(st.total).count(), f);
+      ::encode_json("avg_usec", (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(st.total).count() / st.count, f);
+      ::encode_json("max_usec", (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(st.max).count(), f);
+      f->close_section();
+    }
+    f->close_section();
+  }
+
   RWLock::RLocker rl(lock);
 
   f->open_array_section("run_contexts");
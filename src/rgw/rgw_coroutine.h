@@ -23,6 +23,8 @@
 #include <boost/asio/coroutine.hpp>
 
 #include <atomic>
+#include <mutex>
+#include <typeindex>
 
 #define RGW_ASYNC_OPS_MGR_WINDOW 100
 
@@ -515,6 +517,18 @@ class RGWCoroutinesManager {
 
   RWLock lock;
 
+  /*
+   * cpu time spent in operate() per coroutine type, to find which coroutines
+   * keep the manager's thread busy. dumped with the coroutines stack state.
+   */
+  struct op_stats {
+    uint64_t count{0};
+    ceph::timespan total{0};
+    ceph::timespan max{0};
+  };
+  mutable std::mutex stats_lock;
+  map<std::type_index, op_stats> stats;
+
   void handle_unblocked_stack(set<RGWCoroutinesStack *>& context_stacks, list<RGWCoroutinesStack *>& scheduled_stacks, RGWCoroutinesStack *stack, int *waiting_count);
 protected:
   RGWCompletionManager *completion_mgr;
@@ -558,6 +572,8 @@ public:
   void schedule(RGWCoroutinesEnv *env, RGWCoroutinesStack *stack);
   RGWCoroutinesStack *allocate_stack();
 
+  void account_op(const RGWCoroutine *op, ceph::timespan t);
+
   virtual string get_id();
   void dump(Formatter *f) const;
 };
@@ -356,32 +356,33 @@ public:
                      const unsigned char (&key)[AES_256_KEYSIZE],
                      bool encrypt)
   {
-    static std::atomic<bool> failed_to_get_crypto(false);
-    CryptoAccelRef crypto_accel;
-    if (! failed_to_get_crypto.load())
-    {
-      crypto_accel = get_crypto_accel(cct);
-      if (!crypto_accel)
-        failed_to_get_crypto = true;
+    /* the accelerator is stateless, look it up once rather than going
+     * through the plugin registry for every transform */
+    static const CryptoAccelRef crypto_accel = get_crypto_accel(cct);
+    if (crypto_accel != nullptr) {
+      /* hand all the chunks over at once so the key is only expanded once */
+      size_t chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+      std::unique_ptr<unsigned char[][AES_256_IVSIZE]> ivs(
+          new unsigned char[chunks][AES_256_IVSIZE]);
+      for (size_t i = 0; i < chunks; i++) {
+        prepare_iv(ivs[i], stream_offset + i * CHUNK_SIZE);
+      }
+      if (encrypt) {
+        return crypto_accel->cbc_encrypt_chunks(out, in, size, CHUNK_SIZE,
+                                                ivs.get(), key);
+      } else {
+        return crypto_accel->cbc_decrypt_chunks(out, in, size, CHUNK_SIZE,
+                                                ivs.get(), key);
+      }
     }
     bool result = true;
     unsigned char iv[AES_256_IVSIZE];
     for (size_t offset = 0; result && (offset < size); offset += CHUNK_SIZE) {
       size_t process_size = offset + CHUNK_SIZE <= size ? CHUNK_SIZE : size - offset;
       prepare_iv(iv, stream_offset + offset);
-      if (crypto_accel != nullptr) {
-        if (encrypt) {
-          result = crypto_accel->cbc_encrypt(out + offset, in + offset,
-                                             process_size, iv, key);
-        } else {
-          result = crypto_accel->cbc_decrypt(out + offset, in + offset,
-                                             process_size, iv, key);
-        }
-      } else {
-        result = cbc_transform(
-            out + offset, in + offset, process_size,
-            iv, key, encrypt);
-      }
+      result = cbc_transform(
+          out + offset, in + offset, process_size,
+          iv, key, encrypt);
     }
     return result;
   }
@@ -1018,6 +1018,36 @@ public:
 };
 
 #define BUCKET_SHARD_SYNC_SPAWN_WINDOW 20
+
+/*
+ * number of sync operations a shard keeps in flight. starts at the given
+ * value, grows by one every time spawned operations complete cleanly, up to
+ * rgw_data_sync_spawn_window_max, and is halved when one of them fails, so
+ * that a slow or overloaded source zone gets fewer concurrent requests.
+ */
+class RGWSyncSpawnWindow {
+  CephContext *cct;
+  int window;
+
+public:
+  RGWSyncSpawnWindow(CephContext *_cct, int initial) : cct(_cct), window(initial) {}
+
+  void update(bool failed) {
+    int max = std::max<int64_t>(cct->_conf->rgw_data_sync_spawn_window_max, 1);
+    if (failed) {
+      window = std::max(window / 2, 1);
+    } else if (window < max) {
+      ++window;
+    }
+    if (window > max) {
+      window = max;
+    }
+  }
+
+  int get() const {
+    return window;
+  }
+};
 #define DATA_SYNC_MAX_ERR_ENTRIES 10
 
 class RGWDataSyncShardCR : public RGWCoroutine {
@@ -1056,7 +1086,7 @@ class RGWDataSyncShardCR : public RGWCoroutine {
 
   int total_entries;
 
-  int spawn_window;
+  RGWSyncSpawnWindow spawn_window;
 
   bool *reset_backoff;
 
@@ -1090,7 +1120,7 @@ public:
 						      shard_id(_shard_id),
 						      sync_marker(_marker),
                                                       marker_tracker(NULL), truncated(false), inc_lock("RGWDataSyncShardCR::inc_lock"),
-                                                      total_entries(0), spawn_window(BUCKET_SHARD_SYNC_SPAWN_WINDOW), reset_backoff(NULL),
+                                                      total_entries(0), spawn_window(_sync_env->cct, BUCKET_SHARD_SYNC_SPAWN_WINDOW), reset_backoff(NULL),
                                                       lease_cr(nullptr), lease_stack(nullptr), error_repo(nullptr), max_error_entries(DATA_SYNC_MAX_ERR_ENTRIES),
                                                       retry_backoff_secs(RETRY_BACKOFF_SECS_DEFAULT) {
     set_description() << "data sync shard source_zone=" << sync_env->source_zone << " shard_id=" << shard_id;
@@ -1329,17 +1359,20 @@ public:
               }
             }
 	  }
-          while ((int)num_spawned() > spawn_window) {
+          while ((int)num_spawned() > spawn_window.get()) {
             set_status() << "num_spawned() > spawn_window";
             yield wait_for_child();
             int ret;
+            bool failed = false;
             while (collect(&ret, lease_stack.get())) {
               if (ret < 0) {
                 ldout(sync_env->cct, 0) << "ERROR: a sync operation returned error" << dendl;
                 /* we have reported this error */
+                failed = true;
               }
               /* not waiting for child here */
             }
+            spawn_window.update(failed);
           }
 	}
 	ldout(sync_env->cct, 20) << __func__ << ":" << __LINE__ << ": shard_id=" << shard_id << " datalog_marker=" << datalog_marker << " sync_marker.marker=" << sync_marker.marker << dendl;
@@ -2320,6 +2353,8 @@ class RGWBucketShardFullSyncCR : public RGWCoroutine {
 
   int sync_status{0};
 
+  RGWSyncSpawnWindow spawn_window{sync_env->cct, BUCKET_SYNC_SPAWN_WINDOW};
+
   const string& status_oid;
 
   RGWDataSyncDebugLogger logger;
@@ -2385,17 +2420,20 @@ int RGWBucketShardFullSyncCR::operate()
                                  entry->key, &marker_tracker, zones_trace),
                       false);
         }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > (size_t)spawn_window.get()) {
           yield wait_for_child();
           bool again = true;
+          bool failed = false;
           while (again) {
             again = collect(&ret, nullptr);
             if (ret < 0) {
               ldout(sync_env->cct, 0) << "ERROR: a sync operation returned error" << dendl;
               sync_status = ret;
               /* we have reported this error */
+              failed = true;
             }
           }
+          spawn_window.update(failed);
         }
       }
     } while (list_result.is_truncated && sync_status == 0);
@@ -2468,6 +2506,8 @@ class RGWBucketShardIncrementalSyncCR : public RGWCoroutine {
   int sync_status{0};
   bool syncstopped{false};
 
+  RGWSyncSpawnWindow spawn_window{sync_env->cct, BUCKET_SYNC_SPAWN_WINDOW};
+
 public:
   RGWBucketShardIncrementalSyncCR(RGWDataSyncEnv *_sync_env,
                                   const rgw_bucket_shard& bs,
@@ -2649,19 +2689,22 @@ int RGWBucketShardIncrementalSyncCR::operate()
                   false);
           }
         // }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > (size_t)spawn_window.get()) {
           set_status() << "num_spawned() > spawn_window";
           yield wait_for_child();
           bool again = true;
+          bool failed = false;
           while (again) {
             again = collect(&ret, nullptr);
             if (ret < 0) {
               ldout(sync_env->cct, 0) << "ERROR: a sync operation returned error" << dendl;
               sync_status = ret;
               /* we have reported this error */
+              failed = true;
             }
             /* not waiting for child here */
           }
+          spawn_window.update(failed);
         }
       }
     } while (!list_result.empty() && sync_status == 0);
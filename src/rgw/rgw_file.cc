@@ -246,15 +246,43 @@ namespace rgw {
     if (rgw_fh->deleted())
       return -ESTALE;
 
-    RGWReadRequest req(get_context(), get_user(), rgw_fh, offset, length,
-		       buffer);
+    /* sequential reads are served from the handle's readahead window,
+     * which is filled with one larger request instead of one round trip
+     * per NFS read */
+    if (rgw_fh->readahead_read(offset, length, bytes_read, buffer))
+      return 0;
+
+    uint64_t ra_size = get_context()->_conf->rgw_nfs_readahead_size;
+    buffer::ptr ra_bp;
+    size_t want = length;
+    void* dest = buffer;
+    if (ra_size > length && rgw_fh->readahead_wanted(offset)) {
+      uint64_t size = rgw_fh->get_size();
+      if (size > offset + length) {
+	want = std::min(ra_size, size - offset);
+	ra_bp = buffer::create(want);
+	dest = ra_bp.c_str();
+      }
+    }
+
+    RGWReadRequest req(get_context(), get_user(), rgw_fh, offset, want,
+		       dest);
 
     int rc = rgwlib.get_fe()->execute_req(&req);
     if ((rc == 0) &&
 	(req.get_ret() == 0)) {
       lock_guard(rgw_fh->mtx);
       rgw_fh->set_atime(real_clock::to_timespec(real_clock::now()));
-      *bytes_read = req.nread;
+      if (dest != buffer) {
+	*bytes_read = std::min(length, req.nread);
+	memcpy(buffer, dest, *bytes_read);
+	if (req.nread > *bytes_read)
+	  rgw_fh->readahead_fill(offset, ra_bp, req.nread);
+	rgw_fh->readahead_note(offset + *bytes_read);
+      } else {
+	*bytes_read = req.nread;
+	rgw_fh->readahead_note(offset + req.nread);
+      }
     }
 
     return rc;
@@ -1105,6 +1133,9 @@ namespace rgw {
     if (! f)
       return -EISDIR;
 
+    /* readers must not see data from before this write */
+    drop_readahead();
+
     if (deleted()) {
       lsubdout(fs->get_context(), rgw, 5)
 	<< __func__
@@ -1229,6 +1260,7 @@ namespace rgw {
     lock_guard guard(mtx);
 
     int rc = write_finish(FLAG_LOCKED);
+    drop_readahead();
 
     flags &= ~FLAG_OPEN;
     flags &= ~FLAG_STATELESS_OPEN;
@@ -1241,6 +1273,66 @@ namespace rgw {
     delete write_req;
   }
 
+  void RGWFileHandle::drop_readahead()
+  {
+    file* f = get<file>(&variant_type);
+    if (f) {
+      f->ra_buf = buffer::ptr();
+      f->ra_next = 0;
+    }
+  }
+
+  bool RGWFileHandle::readahead_read(uint64_t off, size_t len, size_t* nread,
+				     void* buffer)
+  {
+    lock_guard guard(mtx);
+    file* f = get<file>(&variant_type);
+    if (! f || ! f->ra_buf.length())
+      return false;
+    uint64_t ra_end = f->ra_off + f->ra_buf.length();
+    if (off < f->ra_off || off >= ra_end)
+      return false;
+    /* a read running past the window is only served from it at EOF */
+    if ((off + len > ra_end) && (ra_end < state.size))
+      return false;
+    size_t n = std::min(uint64_t(len), ra_end - off);
+    memcpy(buffer, f->ra_buf.c_str() + (off - f->ra_off), n);
+    *nread = n;
+    f->ra_next = off + n;
+    if (f->ra_next == ra_end) {
+      /* consumed; the next sequential read refills it */
+      f->ra_buf = buffer::ptr();
+    }
+    state.atime = real_clock::to_timespec(real_clock::now());
+    return true;
+  }
+
+  bool RGWFileHandle::readahead_wanted(uint64_t off)
+  {
+    lock_guard guard(mtx);
+    file* f = get<file>(&variant_type);
+    return f && ! f->write_req && (off == f->ra_next);
+  }
+
+  void RGWFileHandle::readahead_fill(uint64_t off, buffer::ptr& bp,
+				     size_t len)
+  {
+    lock_guard guard(mtx);
+    file* f = get<file>(&variant_type);
+    if (! f || f->write_req)
+      return;
+    f->ra_off = off;
+    f->ra_buf = buffer::ptr(bp, 0, len);
+  }
+
+  void RGWFileHandle::readahead_note(uint64_t end)
+  {
+    lock_guard guard(mtx);
+    file* f = get<file>(&variant_type);
+    if (f)
+      f->ra_next = end;
+  }
+
   void RGWFileHandle::clear_state()
   {
     directory* d = get<directory>(&variant_type);
@@ -213,7 +213,11 @@ namespace rgw {
 
     struct file {
       RGWWriteRequest* write_req;
-      file() : write_req(nullptr) {}
+      /* sequential read detection and readahead window */
+      uint64_t ra_next; /* offset a sequential read would start at */
+      uint64_t ra_off;  /* object offset of ra_buf */
+      buffer::ptr ra_buf;
+      file() : write_req(nullptr), ra_next(0), ra_off(0) {}
       ~file();
     };
 
@@ -229,6 +233,7 @@ namespace rgw {
     };
 
     void clear_state();
+    void drop_readahead(); /* LOCKED */
 
     boost::variant<file, directory> variant_type;
 
@@ -550,11 +555,20 @@ namespace rgw {
 	  flags |= FLAG_STATELESS_OPEN;
 	}
 	flags |= FLAG_OPEN;
+	/* close-to-open: don't serve data read before this open */
+	drop_readahead();
 	return 0;
       }
       return -EPERM;
     }
 
+    /* readahead (callers hold no lock) */
+    bool readahead_read(uint64_t off, size_t len, size_t* nread,
+			void* buffer);
+    bool readahead_wanted(uint64_t off);
+    void readahead_fill(uint64_t off, buffer::ptr& bp, size_t len);
+    void readahead_note(uint64_t end);
+
     int readdir(rgw_readdir_cb rcb, void *cb_arg, uint64_t *offset, bool *eof,
 		uint32_t flags);
     int write(uint64_t off, size_t len, size_t *nbytes, void *buffer);
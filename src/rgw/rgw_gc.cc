@@ -7,8 +7,12 @@
 #include "cls/refcount/cls_refcount_client.h"
 #include "cls/lock/cls_lock_client.h"
 #include "auth/Crypto.h"
+#include "common/errno.h"
 
+#include <deque>
 #include <list>
+#include <map>
+#include <vector>
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rgw
@@ -88,6 +92,13 @@ int RGWGC::remove(int index, const std::list<string>& tags)
   return store->gc_operate(obj_names[index], &op);
 }
 
+int RGWGC::remove(int index, const std::list<string>& tags, AioCompletion *c)
+{
+  ObjectWriteOperation op;
+  cls_rgw_gc_remove(op, tags);
+  return store->gc_pool_ctx.aio_operate(obj_names[index], c, &op);
+}
+
 int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std::list<cls_rgw_gc_obj_info>& result, bool *truncated)
 {
   result.clear();
@@ -128,11 +139,208 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
   return 0;
 }
 
-int RGWGC::process(int index, int max_secs)
+/*
+ * Keeps up to rgw_gc_max_concurrent_io tail object deletions in flight for
+ * a gc round, across all the shards it processes. A chain's tag is only
+ * queued for removal from its gc shard once every object of the chain is
+ * gone, and tags are removed rgw_gc_max_trim_chunk at a time.
+ */
+class RGWGCIOManager {
+  CephContext *cct;
+  RGWGC *gc;
+  RGWRados *store;
+
+  struct IO {
+    enum Type {
+      TailIO = 0,
+      IndexIO = 1,
+    } type;
+    librados::AioCompletion *c;
+    int index;
+    string tag; /* TailIO only */
+  };
+
+  struct TagState {
+    int pending = 0;
+    bool scheduled = false; /* all the chain's ios were sent */
+    bool failed = false;
+  };
+
+  std::deque<IO> ios;
+  std::map<string, TagState> tags;
+  std::vector<std::list<string> > remove_tags;
+  std::map<string, IoCtx> pool_ctxs;
+  size_t max_aio;
+  size_t max_trim_chunk;
+
+  void handle_next_completion();
+  void finish_tag(int index, const string& tag);
+  void flush_remove_tags(int index);
+
+public:
+  RGWGCIOManager(CephContext *_cct, RGWGC *_gc, RGWRados *_store, int max_objs)
+    : cct(_cct), gc(_gc), store(_store), remove_tags(max_objs),
+      max_aio(std::max<int64_t>(cct->_conf->rgw_gc_max_concurrent_io, 1)),
+      max_trim_chunk(std::max<int64_t>(cct->_conf->rgw_gc_max_trim_chunk, 1)) {}
+
+  ~RGWGCIOManager() {
+    for (auto& io : ios) {
+      io.c->wait_for_complete();
+      io.c->release();
+    }
+  }
+
+  IoCtx *get_pool_ctx(const string& pool);
+  void schedule_io(IoCtx *ctx, const string& oid, ObjectWriteOperation *op,
+                   int index, const string& tag);
+  void tag_failed(const string& tag) {
+    tags[tag].failed = true;
+  }
+  void chain_scheduled(int index, const string& tag);
+  void drain();
+};
+
+IoCtx *RGWGCIOManager::get_pool_ctx(const string& pool)
+{
+  auto iter = pool_ctxs.find(pool);
+  if (iter != pool_ctxs.end()) {
+    return &iter->second;
+  }
+  IoCtx ctx;
+  int ret = rgw_init_ioctx(store->get_rados_handle(), pool, ctx);
+  if (ret < 0) {
+    dout(0) << "ERROR: failed to create ioctx pool=" << pool << dendl;
+    return nullptr;
+  }
+  return &pool_ctxs.emplace(pool, std::move(ctx)).first->second;
+}
+
+void RGWGCIOManager::schedule_io(IoCtx *ctx, const string& oid,
+                                 ObjectWriteOperation *op,
+                                 int index, const string& tag)
+{
+  while (ios.size() >= max_aio) {
+    handle_next_completion();
+  }
+
+  TagState& state = tags[tag];
+  librados::AioCompletion *c = librados::Rados::aio_create_completion(nullptr, nullptr, nullptr);
+  int ret = ctx->aio_operate(oid, c, op);
+  if (ret < 0) {
+    c->release();
+    dout(0) << "failed to remove " << oid << ": " << cpp_strerror(-ret) << dendl;
+    state.failed = true;
+    return;
+  }
+  state.pending++;
+  ios.push_back(IO{IO::TailIO, c, index, tag});
+}
+
+void RGWGCIOManager::chain_scheduled(int index, const string& tag)
+{
+  auto iter = tags.find(tag);
+  if (iter == tags.end()) {
+    /* empty chain */
+    remove_tags[index].push_back(tag);
+    if (remove_tags[index].size() >= max_trim_chunk) {
+      flush_remove_tags(index);
+    }
+    return;
+  }
+  iter->second.scheduled = true;
+  if (iter->second.pending == 0) {
+    finish_tag(index, tag);
+  }
+}
+
+void RGWGCIOManager::handle_next_completion()
+{
+  assert(!ios.empty());
+  IO io = ios.front();
+  ios.pop_front();
+
+  io.c->wait_for_complete();
+  int ret = io.c->get_return_value();
+  io.c->release();
+
+  if (io.type == IO::IndexIO) {
+    if (ret < 0) {
+      dout(0) << "WARNING: failed to remove tags on gc shard index="
+              << io.index << " ret=" << ret << dendl;
+    }
+    return;
+  }
+
+  if (ret == -ENOENT) {
+    ret = 0;
+  }
+  TagState& state = tags[io.tag];
+  if (ret < 0) {
+    dout(0) << "failed to remove tail object of tag " << io.tag
+            << " ret=" << ret << dendl;
+    state.failed = true;
+  } else if (perfcounter) {
+    perfcounter->inc(l_rgw_gc_retire_object);
+  }
+  if (--state.pending == 0 && state.scheduled) {
+    finish_tag(io.index, io.tag);
+  }
+}
+
+void RGWGCIOManager::finish_tag(int index, const string& tag)
+{
+  auto iter = tags.find(tag);
+  assert(iter != tags.end());
+  bool failed = iter->second.failed;
+  tags.erase(iter);
+  if (failed) {
+    /* leave the entry, it'll be retried on a later round */
+    return;
+  }
+  remove_tags[index].push_back(tag);
+  if (remove_tags[index].size() >= max_trim_chunk) {
+    flush_remove_tags(index);
+  }
+}
+
+void RGWGCIOManager::flush_remove_tags(int index)
+{
+  std::list<string>& rt = remove_tags[index];
+  if (rt.empty()) {
+    return;
+  }
+  librados::AioCompletion *c = librados::Rados::aio_create_completion(nullptr, nullptr, nullptr);
+  int ret = gc->remove(index, rt, c);
+  if (ret < 0) {
+    c->release();
+    dout(0) << "WARNING: failed to remove tags on gc shard index="
+            << index << " ret=" << ret << dendl;
+  } else {
+    ios.push_back(IO{IO::IndexIO, c, index, string()});
+  }
+  rt.clear();
+}
+
+void RGWGCIOManager::drain()
+{
+  while (!ios.empty()) {
+    handle_next_completion();
+  }
+  for (size_t i = 0; i < remove_tags.size(); i++) {
+    flush_remove_tags(i);
+  }
+  while (!ios.empty()) {
+    handle_next_completion();
+  }
+}
+
+int RGWGC::process(int index, int max_secs, RGWGCIOManager& io_manager,
+                   bool *behind)
 {
   rados::cls::lock::Lock l(gc_index_lock_name);
   utime_t end = ceph_clock_now();
-  std::list<string> remove_tags;
+
+  *behind = false;
 
   /* max_secs should be greater than zero. We don't want a zero max_secs
    * to be translated as no timeout, since we'd then need to break the
@@ -156,7 +364,6 @@ int RGWGC::process(int index, int max_secs)
   string marker;
   string next_marker;
   bool truncated;
-  IoCtx *ctx = new IoCtx;
   do {
     int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
@@ -168,31 +375,27 @@ int RGWGC::process(int index, int max_secs)
     if (ret < 0)
       goto done;
 
-    string last_pool;
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
-      bool remove_tag;
       cls_rgw_gc_obj_info& info = *iter;
       std::list<cls_rgw_obj>::iterator liter;
       cls_rgw_obj_chain& chain = info.chain;
 
       utime_t now = ceph_clock_now();
-      if (now >= end)
+      if (now >= end) {
+        *behind = true;
         goto done;
+      }
 
-      remove_tag = true;
       for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
         cls_rgw_obj& obj = *liter;
 
-        if (obj.pool != last_pool) {
-          delete ctx;
-          ctx = new IoCtx;
-	  ret = rgw_init_ioctx(store->get_rados_handle(), obj.pool, *ctx);
-	  if (ret < 0) {
-	    dout(0) << "ERROR: failed to create ioctx pool=" << obj.pool << dendl;
-	    continue;
-	  }
-          last_pool = obj.pool;
+        IoCtx *ctx = io_manager.get_pool_ctx(obj.pool);
+        if (!ctx) {
+          /* the tag is left in place, as one of its objects couldn't be
+           * removed */
+          io_manager.tag_failed(info.tag);
+          continue;
         }
 
         ctx->locator_set_key(obj.loc);
@@ -202,37 +405,18 @@ int RGWGC::process(int index, int max_secs)
 	dout(5) << "gc::process: removing " << obj.pool << ":" << obj.key.name << dendl;
 	ObjectWriteOperation op;
 	cls_refcount_put(op, info.tag, true);
-        ret = ctx->operate(oid, &op);
-	if (ret == -ENOENT)
-	  ret = 0;
-        if (ret < 0) {
-          remove_tag = false;
-          dout(0) << "failed to remove " << obj.pool << ":" << oid << "@" << obj.loc << dendl;
-        }
+        io_manager.schedule_io(ctx, oid, &op, index, info.tag);
 
         if (going_down()) // leave early, even if tag isn't removed, it's ok
           goto done;
       }
-      if (remove_tag) {
-        remove_tags.push_back(info.tag);
-#define MAX_REMOVE_CHUNK 16
-        if (remove_tags.size() > MAX_REMOVE_CHUNK) {
-          RGWGC::remove(index, remove_tags);
-          remove_tags.clear();
-        }
-      }
-    }
-    if (!remove_tags.empty()) {
-      RGWGC::remove(index, remove_tags);
-      remove_tags.clear();
+      io_manager.chain_scheduled(index, info.tag);
     }
+    marker = next_marker;
   } while (truncated);
 
 done:
-  if (!remove_tags.empty())
-    RGWGC::remove(index, remove_tags);
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
-  delete ctx;
   return 0;
 }
 
@@ -245,14 +429,26 @@ int RGWGC::process()
   if (ret < 0)
     return ret;
 
+  RGWGCIOManager io_manager(cct, this, store, max_objs);
+
+  uint64_t shards_behind = 0;
   for (int i = 0; i < max_objs; i++) {
     int index = (i + start) % max_objs;
-    ret = process(index, max_secs);
+    bool behind = false;
+    ret = process(index, max_secs, io_manager, &behind);
     if (ret < 0)
-      return ret;
+      break;
+    if (behind)
+      shards_behind++;
   }
 
-  return 0;
+  io_manager.drain();
+
+  if (perfcounter) {
+    perfcounter->set(l_rgw_gc_shards_behind, shards_behind);
+  }
+
+  return ret < 0 ? ret : 0;
 }
 
 bool RGWGC::going_down()
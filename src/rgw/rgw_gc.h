@@ -16,6 +16,8 @@
 
 #include <atomic>
 
+class RGWGCIOManager;
+
 class RGWGC {
   CephContext *cct;
   RGWRados *store;
@@ -49,13 +51,15 @@ public:
   int send_chain(cls_rgw_obj_chain& chain, const string& tag, bool sync);
   int defer_chain(const string& tag, bool sync);
   int remove(int index, const std::list<string>& tags);
+  int remove(int index, const std::list<string>& tags, librados::AioCompletion *c);
 
   void initialize(CephContext *_cct, RGWRados *_store);
   void finalize();
 
   int list(int *index, string& marker, uint32_t max, bool expired_only, std::list<cls_rgw_gc_obj_info>& result, bool *truncated);
   void list_init(int *index) { *index = 0; }
-  int process(int index, int process_max_secs);
+  int process(int index, int process_max_secs, RGWGCIOManager& io_manager,
+              bool *behind);
   int process();
 
   bool going_down();
@@ -17,10 +17,81 @@
 #include "rgw_coroutine.h"
 
 #include <atomic>
+#include <deque>
+#include <mutex>
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rgw
 
+/*
+ * curl easy handles are kept for reuse once a request is done with them.
+ * a reused handle keeps its connection, dns and ssl session caches, so the
+ * next request to the same endpoint doesn't have to connect again. handles
+ * idle for longer than MAXIDLE are dropped, as are the ones past
+ * rgw_curl_handle_cache_size.
+ */
+class RGWCurlHandles {
+  static constexpr std::chrono::seconds MAXIDLE{30};
+
+  std::mutex lock;
+  /* most recently released first */
+  std::deque<std::pair<CURL *, ceph::coarse_mono_time> > handles;
+
+public:
+  CURL *get() {
+    auto now = ceph::coarse_mono_clock::now();
+    std::unique_lock<std::mutex> l(lock);
+    while (!handles.empty()) {
+      auto h = handles.front();
+      handles.pop_front();
+      if (now - h.second < MAXIDLE) {
+        return h.first;
+      }
+      l.unlock();
+      curl_easy_cleanup(h.first);
+      l.lock();
+    }
+    l.unlock();
+    return curl_easy_init();
+  }
+
+  void release(CURL *h) {
+    curl_easy_reset(h);
+    auto now = ceph::coarse_mono_clock::now();
+    size_t max = std::max<int64_t>(g_ceph_context->_conf->rgw_curl_handle_cache_size, 0);
+    list<CURL *> expired;
+    {
+      std::lock_guard<std::mutex> l(lock);
+      handles.emplace_front(h, now);
+      while (handles.size() > max ||
+             (!handles.empty() && now - handles.back().second >= MAXIDLE)) {
+        expired.push_back(handles.back().first);
+        handles.pop_back();
+      }
+    }
+    for (auto e : expired) {
+      curl_easy_cleanup(e);
+    }
+  }
+
+  void cleanup() {
+    std::lock_guard<std::mutex> l(lock);
+    for (auto& h : handles) {
+      curl_easy_cleanup(h.first);
+    }
+    handles.clear();
+  }
+};
+
+constexpr std::chrono::seconds RGWCurlHandles::MAXIDLE;
+
+static RGWCurlHandles curl_handles;
+
+void rgw_http_client_cleanup()
+{
+  curl_handles.cleanup();
+}
+
 struct rgw_http_req_data : public RefCountedObject {
   CURL *easy_handle;
   curl_slist *h;
@@ -53,7 +124,7 @@ struct rgw_http_req_data : public RefCountedObject {
     Mutex::Locker l(lock);
     ret = r;
     if (easy_handle)
-      curl_easy_cleanup(easy_handle);
+      curl_handles.release(easy_handle);
 
     if (h)
       curl_slist_free_all(h);
@@ -251,7 +322,7 @@ int RGWHTTPClient::process(const char *method, const char *url)
   last_method = (method ? method : "");
   last_url = (url ? url : "");
 
-  curl_handle = curl_easy_init();
+  curl_handle = curl_handles.get();
 
   dout(20) << "sending request to " << url << dendl;
 
@@ -289,7 +360,7 @@ int RGWHTTPClient::process(const char *method, const char *url)
     ret = -EINVAL;
   }
   curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_status);
-  curl_easy_cleanup(curl_handle);
+  curl_handles.release(curl_handle);
   curl_slist_free_all(h);
 
   return ret;
@@ -322,7 +393,7 @@ int RGWHTTPClient::init_request(const char *method, const char *url, rgw_http_re
 
   CURL *easy_handle;
 
-  easy_handle = curl_easy_init();
+  easy_handle = curl_handles.get();
 
   req_data->easy_handle = easy_handle;
 
@@ -664,16 +735,29 @@ void RGWHTTPManager::_complete_request(rgw_http_req_data *req_data)
 
 void RGWHTTPManager::finish_request(rgw_http_req_data *req_data, int ret)
 {
+  detach_handle(req_data);
   req_data->finish(ret);
   complete_request(req_data);
 }
 
 void RGWHTTPManager::_finish_request(rgw_http_req_data *req_data, int ret)
 {
+  detach_handle(req_data);
   req_data->finish(ret);
   _complete_request(req_data);
 }
 
+/*
+ * the easy handle is going back to the handle cache, it must not be attached
+ * to the multi handle anymore. removing a handle that isn't attached is a noop.
+ */
+void RGWHTTPManager::detach_handle(rgw_http_req_data *req_data)
+{
+  if (req_data->easy_handle) {
+    curl_multi_remove_handle((CURLM *)multi_handle, req_data->easy_handle);
+  }
+}
+
 /*
  * hook request to the curl multi handle
  */
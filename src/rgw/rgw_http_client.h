@@ -240,6 +240,7 @@ class RGWHTTPManager {
   void unlink_request(rgw_http_req_data *req_data);
   void finish_request(rgw_http_req_data *req_data, int r);
   void _finish_request(rgw_http_req_data *req_data, int r);
+  void detach_handle(rgw_http_req_data *req_data);
   int link_request(rgw_http_req_data *req_data);
 
   void manage_pending_requests();
@@ -275,4 +276,7 @@ public:
   int complete_requests();
 };
 
+/* free the curl handles kept for reuse; call before curl_global_cleanup() */
+void rgw_http_client_cleanup();
+
 #endif
@@ -404,32 +404,34 @@ int TokenEnvelope::parse(CephContext* const cct,
 bool TokenCache::find(const std::string& token_id,
                       rgw::keystone::TokenEnvelope& token)
 {
-  Mutex::Locker l(lock);
-  return find_locked(token_id, token);
+  shard& sh = get_shard(token_id);
+  Mutex::Locker l(sh.lock);
+  return find_locked(sh, token_id, token);
 }
 
-bool TokenCache::find_locked(const std::string& token_id,
+bool TokenCache::find_locked(shard& sh,
+                             const std::string& token_id,
                              rgw::keystone::TokenEnvelope& token)
 {
-  assert(lock.is_locked_by_me());
-  map<string, token_entry>::iterator iter = tokens.find(token_id);
-  if (iter == tokens.end()) {
+  assert(sh.lock.is_locked_by_me());
+  map<string, token_entry>::iterator iter = sh.tokens.find(token_id);
+  if (iter == sh.tokens.end()) {
     if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_miss);
     return false;
   }
 
   token_entry& entry = iter->second;
-  tokens_lru.erase(entry.lru_iter);
+  sh.tokens_lru.erase(entry.lru_iter);
 
   if (entry.token.expired()) {
-    tokens.erase(iter);
-    if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
+    sh.tokens.erase(iter);
+    if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_miss);
     return false;
   }
   token = entry.token;
 
-  tokens_lru.push_front(token_id);
-  entry.lru_iter = tokens_lru.begin();
+  sh.tokens_lru.push_front(token_id);
+  entry.lru_iter = sh.tokens_lru.begin();
 
   if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
 
@@ -438,76 +440,95 @@ bool TokenCache::find_locked(const std::string& token_id,
 
 bool TokenCache::find_admin(rgw::keystone::TokenEnvelope& token)
 {
-  Mutex::Locker l(lock);
+  std::string token_id;
+  {
+    Mutex::Locker l(ids_lock);
+    token_id = admin_token_id;
+  }
 
-  return find_locked(admin_token_id, token);
+  return find(token_id, token);
 }
 
 bool TokenCache::find_barbican(rgw::keystone::TokenEnvelope& token)
 {
-  Mutex::Locker l(lock);
+  std::string token_id;
+  {
+    Mutex::Locker l(ids_lock);
+    token_id = barbican_token_id;
+  }
 
-  return find_locked(barbican_token_id, token);
+  return find(token_id, token);
 }
 
 void TokenCache::add(const std::string& token_id,
                      const rgw::keystone::TokenEnvelope& token)
 {
-  Mutex::Locker l(lock);
-  add_locked(token_id, token);
+  shard& sh = get_shard(token_id);
+  Mutex::Locker l(sh.lock);
+  add_locked(sh, token_id, token);
 }
 
-void TokenCache::add_locked(const std::string& token_id,
+void TokenCache::add_locked(shard& sh,
+                            const std::string& token_id,
                             const rgw::keystone::TokenEnvelope& token)
 {
-  assert(lock.is_locked_by_me());
-  map<string, token_entry>::iterator iter = tokens.find(token_id);
-  if (iter != tokens.end()) {
+  assert(sh.lock.is_locked_by_me());
+  map<string, token_entry>::iterator iter = sh.tokens.find(token_id);
+  if (iter != sh.tokens.end()) {
     token_entry& e = iter->second;
-    tokens_lru.erase(e.lru_iter);
+    sh.tokens_lru.erase(e.lru_iter);
   }
 
-  tokens_lru.push_front(token_id);
-  token_entry& entry = tokens[token_id];
+  sh.tokens_lru.push_front(token_id);
+  token_entry& entry = sh.tokens[token_id];
   entry.token = token;
-  entry.lru_iter = tokens_lru.begin();
+  entry.lru_iter = sh.tokens_lru.begin();
 
-  while (tokens_lru.size() > max) {
-    list<string>::reverse_iterator riter = tokens_lru.rbegin();
-    iter = tokens.find(*riter);
-    assert(iter != tokens.end());
-    tokens.erase(iter);
-    tokens_lru.pop_back();
+  while (sh.tokens_lru.size() > max) {
+    list<string>::reverse_iterator riter = sh.tokens_lru.rbegin();
+    iter = sh.tokens.find(*riter);
+    assert(iter != sh.tokens.end());
+    sh.tokens.erase(iter);
+    sh.tokens_lru.pop_back();
   }
 }
 
 void TokenCache::add_admin(const rgw::keystone::TokenEnvelope& token)
 {
-  Mutex::Locker l(lock);
+  std::string token_id;
+  rgw_get_token_id(token.token.id, token_id);
+  {
+    Mutex::Locker l(ids_lock);
+    admin_token_id = token_id;
+  }
 
-  rgw_get_token_id(token.token.id, admin_token_id);
-  add_locked(admin_token_id, token);
+  add(token_id, token);
 }
 
 void TokenCache::add_barbican(const rgw::keystone::TokenEnvelope& token)
 {
-  Mutex::Locker l(lock);
+  std::string token_id;
+  rgw_get_token_id(token.token.id, token_id);
+  {
+    Mutex::Locker l(ids_lock);
+    barbican_token_id = token_id;
+  }
 
-  rgw_get_token_id(token.token.id, barbican_token_id);
-  add_locked(barbican_token_id, token);
+  add(token_id, token);
 }
 
 void TokenCache::invalidate(const std::string& token_id)
 {
-  Mutex::Locker l(lock);
-  map<string, token_entry>::iterator iter = tokens.find(token_id);
-  if (iter == tokens.end())
+  shard& sh = get_shard(token_id);
+  Mutex::Locker l(sh.lock);
+  map<string, token_entry>::iterator iter = sh.tokens.find(token_id);
+  if (iter == sh.tokens.end())
     return;
 
   ldout(cct, 20) << "invalidating revoked token id=" << token_id << dendl;
   token_entry& e = iter->second;
-  tokens_lru.erase(e.lru_iter);
-  tokens.erase(iter);
+  sh.tokens_lru.erase(e.lru_iter);
+  sh.tokens.erase(iter);
 }
 
 int TokenCache::RevokeThread::check_revoked()
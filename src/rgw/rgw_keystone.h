@@ -248,20 +248,32 @@ class TokenCache {
 
   const boost::intrusive_ptr<CephContext> cct;
 
+  /* tokens are spread over independently locked shards, each one bounded
+   * to its part of rgw_keystone_token_cache_size, so that lookups from
+   * many tenants don't all serialize on one lock. */
+  static constexpr size_t SHARDS = 16;
+
+  struct shard {
+    Mutex lock{"rgw::keystone::TokenCache::shard"};
+    std::map<std::string, token_entry> tokens;
+    std::list<std::string> tokens_lru;
+  } shards[SHARDS];
+
+  Mutex ids_lock;
   std::string admin_token_id;
   std::string barbican_token_id;
-  std::map<std::string, token_entry> tokens;
-  std::list<std::string> tokens_lru;
-
-  Mutex lock;
 
   const size_t max;
 
+  shard& get_shard(const std::string& token_id) {
+    return shards[std::hash<std::string>()(token_id) % SHARDS];
+  }
+
   TokenCache(const rgw::keystone::Config& config)
     : revocator(g_ceph_context, this, config),
       cct(g_ceph_context),
-      lock("rgw::keystone::TokenCache"),
-      max(cct->_conf->rgw_keystone_token_cache_size) {
+      ids_lock("rgw::keystone::TokenCache::ids_lock"),
+      max((cct->_conf->rgw_keystone_token_cache_size + SHARDS - 1) / SHARDS) {
     /* revocation logic needs to be smarter, but meanwhile,
      *  make it optional.
      * see http://tracker.ceph.com/issues/9493
@@ -311,8 +323,8 @@ public:
   void invalidate(const std::string& token_id);
   bool going_down() const;
 private:
-  void add_locked(const std::string& token_id, const TokenEnvelope& token);
-  bool find_locked(const std::string& token_id, TokenEnvelope& token);
+  void add_locked(shard& sh, const std::string& token_id, const TokenEnvelope& token);
+  bool find_locked(shard& sh, const std::string& token_id, TokenEnvelope& token);
 
 };
 
@@ -1,6 +1,7 @@
 #include <string.h>
 #include <iostream>
 #include <map>
+#include <vector>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
@@ -12,7 +13,10 @@
 #include "cls/lock/cls_lock_client.h"
 #include "rgw_common.h"
 #include "rgw_bucket.h"
+#include "rgw_coroutine.h"
+#include "rgw_cr_rados.h"
 #include "rgw_lc.h"
+#include "rgw_sync.h"
 
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rgw
@@ -249,15 +253,17 @@ bool RGWLC::obj_has_expired(double timediff, int days)
   return (timediff >= cmp);
 }
 
-int RGWLC::remove_expired_obj(RGWBucketInfo& bucket_info, rgw_obj_key obj_key, bool remove_indeed)
+int RGWLC::remove_expired_obj(RGWBucketInfo& bucket_info, rgw_obj_key obj_key, bool remove_indeed,
+                              RGWRados::IndexCompleteBatch *index_batch)
 {
   if (remove_indeed) {
-    return rgw_remove_object(store, bucket_info, bucket_info.bucket, obj_key);
+    return rgw_remove_object(store, bucket_info, bucket_info.bucket, obj_key, index_batch);
   } else {
     obj_key.instance.clear();
     RGWObjectCtx rctx(store);
     rgw_obj obj(bucket_info.bucket, obj_key);
-    return store->delete_obj(rctx, bucket_info, obj, bucket_info.versioning_status());
+    return store->delete_obj(rctx, bucket_info, obj, bucket_info.versioning_status(),
+                             0, real_time(), nullptr, index_batch);
   }
 }
 
@@ -302,6 +308,9 @@ int RGWLC::handle_multipart_expiration(RGWRados::Bucket *target, const map<strin
             ldout(cct, 0) << "ERROR: abort_multipart_upload failed, ret=" << ret <<dendl;
             return ret;
           }
+          if (ret == 0 && perfcounter) {
+            perfcounter->inc(l_rgw_lc_abort_mpu);
+          }
         }
       }
     } while(is_truncated);
@@ -309,6 +318,115 @@ int RGWLC::handle_multipart_expiration(RGWRados::Bucket *target, const map<strin
   return 0;
 }
 
+int RGWLC::expire_current_obj(RGWBucketInfo& bucket_info, const rgw_bucket_dir_entry& dirent,
+                              RGWRados::IndexCompleteBatch *index_batch)
+{
+  rgw_obj_key key(dirent.key);
+  RGWObjectCtx rctx(store);
+  rgw_obj obj(bucket_info.bucket, key);
+  RGWObjState *state;
+  int ret = store->get_obj_state(&rctx, bucket_info, obj, &state, false);
+  if (ret < 0) {
+    return ret;
+  }
+  if (state->mtime != dirent.meta.mtime)//Check mtime again to avoid delete a recently update object as much as possible
+    return 0;
+  ret = remove_expired_obj(bucket_info, dirent.key, true, index_batch);
+  if (ret < 0) {
+    ldout(cct, 0) << "ERROR: remove_expired_obj " << dendl;
+  } else {
+    ldout(cct, 10) << "DELETED:" << bucket_info.bucket.name << ":" << key << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_expire_current);
+    }
+  }
+  return 0;
+}
+
+class RGWAsyncLCExpireObj : public RGWAsyncRadosRequest {
+  RGWLC *lc;
+  RGWBucketInfo bucket_info;
+  rgw_bucket_dir_entry dirent;
+  RGWRados::IndexCompleteBatch *index_batch;
+protected:
+  int _send_request() override {
+    return lc->expire_current_obj(bucket_info, dirent, index_batch);
+  }
+public:
+  RGWAsyncLCExpireObj(RGWCoroutine *caller, RGWAioCompletionNotifier *cn, RGWLC *_lc,
+                      const RGWBucketInfo& _bucket_info, const rgw_bucket_dir_entry& _dirent,
+                      RGWRados::IndexCompleteBatch *_index_batch)
+    : RGWAsyncRadosRequest(caller, cn), lc(_lc), bucket_info(_bucket_info),
+      dirent(_dirent), index_batch(_index_batch) {}
+};
+
+class LCExpireObjCR : public RGWSimpleCoroutine {
+  RGWLC *lc;
+  RGWAsyncRadosProcessor *async_rados;
+  const RGWBucketInfo& bucket_info;
+  const rgw_bucket_dir_entry& dirent;
+  RGWRados::IndexCompleteBatch *index_batch;
+  RGWAsyncLCExpireObj *req{nullptr};
+
+public:
+  LCExpireObjCR(CephContext *_cct, RGWLC *_lc, RGWAsyncRadosProcessor *_async_rados,
+                const RGWBucketInfo& _bucket_info, const rgw_bucket_dir_entry& _dirent,
+                RGWRados::IndexCompleteBatch *_index_batch)
+    : RGWSimpleCoroutine(_cct), lc(_lc), async_rados(_async_rados),
+      bucket_info(_bucket_info), dirent(_dirent), index_batch(_index_batch) {}
+  ~LCExpireObjCR() override {
+    request_cleanup();
+  }
+
+  void request_cleanup() override {
+    if (req) {
+      req->finish();
+      req = nullptr;
+    }
+  }
+
+  int send_request() override {
+    req = new RGWAsyncLCExpireObj(this, stack->create_completion_notifier(), lc,
+                                  bucket_info, dirent, index_batch);
+    async_rados->queue(req);
+    return 0;
+  }
+
+  int request_complete() override {
+    return req->get_ret_status();
+  }
+};
+
+/* expires the current objects of one listing page, up to max_concurrent
+ * at a time */
+class LCExpirePageCR : public RGWShardCollectCR {
+  RGWLC *lc;
+  RGWAsyncRadosProcessor *async_rados;
+  const RGWBucketInfo& bucket_info;
+  const vector<rgw_bucket_dir_entry *>& entries;
+  RGWRados::IndexCompleteBatch *index_batch;
+  size_t next{0};
+
+public:
+  LCExpirePageCR(CephContext *_cct, RGWLC *_lc, RGWAsyncRadosProcessor *_async_rados,
+                 const RGWBucketInfo& _bucket_info,
+                 const vector<rgw_bucket_dir_entry *>& _entries,
+                 RGWRados::IndexCompleteBatch *_index_batch, int max_concurrent)
+    : RGWShardCollectCR(_cct, std::max(max_concurrent, 1)),
+      lc(_lc), async_rados(_async_rados), bucket_info(_bucket_info),
+      entries(_entries), index_batch(_index_batch) {}
+
+  bool spawn_next() override {
+    if (next >= entries.size()) {
+      return false;
+    }
+    spawn(new LCExpireObjCR(cct, lc, async_rados, bucket_info, *entries[next],
+                            index_batch), false);
+    ++next;
+    return true;
+  }
+};
+
 int RGWLC::bucket_lc_process(string& shard_id)
 {
   RGWLifecycleConfiguration  config(cct);
@@ -353,6 +471,10 @@ int RGWLC::bucket_lc_process(string& shard_id)
   map<string, lc_op>& prefix_map = config.get_prefix_map();
   list_op.params.list_versions = bucket_info.versioned();
   if (!bucket_info.versioned()) {
+    /* expiration here doesn't depend on the order we see the objects in,
+     * so let the listing avoid merging the index shards */
+    list_op.params.allow_unordered = true;
+    RGWCoroutinesManager crs(cct, store->get_cr_registry());
     for(auto prefix_iter = prefix_map.begin(); prefix_iter != prefix_map.end(); ++prefix_iter) {
       if (!prefix_iter->second.status || 
         (prefix_iter->second.expiration <=0 && prefix_iter->second.expiration_date == boost::none)) {
@@ -363,6 +485,7 @@ int RGWLC::bucket_lc_process(string& shard_id)
         continue;
       }
       list_op.params.prefix = prefix_iter->first;
+      list_op.next_marker = rgw_obj_key();
       do {
         objs.clear();
         list_op.params.marker = list_op.get_next_marker();
@@ -376,13 +499,14 @@ int RGWLC::bucket_lc_process(string& shard_id)
         }
         
         utime_t now = ceph_clock_now();
-        bool is_expired;
+        vector<rgw_bucket_dir_entry *> expired;
         for (auto obj_iter = objs.begin(); obj_iter != objs.end(); ++obj_iter) {
           rgw_obj_key key(obj_iter->key);
 
           if (!key.ns.empty()) {
             continue;
           }
+          bool is_expired;
           if (prefix_iter->second.expiration_date != boost::none) {
             //we have checked it before
             is_expired = true;
@@ -390,23 +514,20 @@ int RGWLC::bucket_lc_process(string& shard_id)
             is_expired = obj_has_expired(now - ceph::real_clock::to_time_t(obj_iter->meta.mtime), prefix_iter->second.expiration);
           }
           if (is_expired) {
-            RGWObjectCtx rctx(store);
-            rgw_obj obj(bucket_info.bucket, key);
-            RGWObjState *state;
-            int ret = store->get_obj_state(&rctx, bucket_info, obj, &state, false);
-            if (ret < 0) {
-              return ret;
-            }
-            if (state->mtime != obj_iter->meta.mtime)//Check mtime again to avoid delete a recently update object as much as possible
-              continue;
-            ret = remove_expired_obj(bucket_info, obj_iter->key, true);
-            if (ret < 0) {
-              ldout(cct, 0) << "ERROR: remove_expired_obj " << dendl;
-            } else {
-              ldout(cct, 10) << "DELETED:" << bucket_name << ":" << key << dendl;
-            }
+            expired.push_back(&*obj_iter);
           }
         }
+
+        /* the objects are independent of each other, expire them in
+         * parallel on the async rados threads */
+        RGWRados::IndexCompleteBatch index_batch(store, bucket_info);
+        ret = crs.run(new LCExpirePageCR(cct, this, store->get_async_rados(), bucket_info,
+                                         expired, &index_batch,
+                                         cct->_conf->rgw_lc_max_wp_worker));
+        index_batch.flush();
+        if (ret < 0) {
+          return ret;
+        }
       } while (is_truncated);
     }
   } else {
@@ -507,6 +628,15 @@ int RGWLC::bucket_lc_process(string& shard_id)
               ldout(cct, 0) << "ERROR: remove_expired_obj " << dendl;
             } else {
               ldout(cct, 10) << "DELETED:" << bucket_name << ":" << obj_iter->key << dendl;
+              if (perfcounter) {
+                if (!obj_iter->is_current()) {
+                  perfcounter->inc(l_rgw_lc_expire_noncurrent);
+                } else if (obj_iter->is_delete_marker()) {
+                  perfcounter->inc(l_rgw_lc_expire_dm);
+                } else {
+                  perfcounter->inc(l_rgw_lc_expire_current);
+                }
+              }
             }
           }
         }
@@ -678,19 +808,28 @@ exit:
 
 void RGWLC::start_processor()
 {
-  worker = new LCWorker(cct, this);
-  worker->create("lifecycle_thr");
+  /* every worker walks all lc shards; the shard lock hands each of them
+   * the next bucket in turn, so up to rgw_lc_max_worker buckets are
+   * processed at the same time */
+  int max_workers = std::max<int>(cct->_conf->rgw_lc_max_worker, 1);
+  for (int i = 0; i < max_workers; i++) {
+    LCWorker *worker = new LCWorker(cct, this);
+    char name[16];
+    snprintf(name, sizeof(name), "lifecycle_thr_%d", i);
+    worker->create(name);
+    workers.push_back(worker);
+  }
 }
 
 void RGWLC::stop_processor()
 {
   down_flag = true;
-  if (worker) {
+  for (auto worker : workers) {
     worker->stop();
     worker->join();
+    delete worker;
   }
-  delete worker;
-  worker = NULL;
+  workers.clear();
 }
 
 void RGWLC::LCWorker::stop()
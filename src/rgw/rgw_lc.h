@@ -290,8 +290,8 @@ class RGWLC {
   };
   
   public:
-  LCWorker *worker;
-  RGWLC() : cct(NULL), store(NULL), worker(NULL) {}
+  vector<LCWorker*> workers;
+  RGWLC() : cct(NULL), store(NULL) {}
   ~RGWLC() {
     stop_processor();
     finalize();
@@ -307,12 +307,15 @@ class RGWLC {
   int bucket_lc_prepare(int index);
   int bucket_lc_process(string& shard_id);
   int bucket_lc_post(int index, int max_lock_sec, pair<string, int >& entry, int& result);
+  int expire_current_obj(RGWBucketInfo& bucket_info, const rgw_bucket_dir_entry& dirent,
+                         RGWRados::IndexCompleteBatch *index_batch);
   bool going_down();
   void start_processor();
   void stop_processor();
 
   private:
-  int remove_expired_obj(RGWBucketInfo& bucket_info, rgw_obj_key obj_key, bool remove_indeed = true);
+  int remove_expired_obj(RGWBucketInfo& bucket_info, rgw_obj_key obj_key, bool remove_indeed = true,
+                         RGWRados::IndexCompleteBatch *index_batch = nullptr);
   bool obj_has_expired(double timediff, int days);
   int handle_multipart_expiration(RGWRados::Bucket *target, const map<string, lc_op>& prefix_map);
 };
@@ -11,6 +11,81 @@
 
 #define dout_subsys ceph_subsys_rgw
 
+const char *RGWLoadGenStats::op_name(int op)
+{
+  switch (op) {
+  case OP_GET: return "get";
+  case OP_PUT: return "put";
+  case OP_LIST: return "list";
+  case OP_DELETE: return "delete";
+  }
+  return "???";
+}
+
+unsigned RGWLoadGenStats::bucket_of(uint64_t usec)
+{
+  if (usec < 4)
+    return usec;
+  unsigned msb = 63 - __builtin_clzll(usec);
+  return (msb - 1) * 4 + ((usec >> (msb - 2)) & 3);
+}
+
+uint64_t RGWLoadGenStats::bucket_upper(unsigned b)
+{
+  if (b < 4)
+    return b + 1;
+  unsigned msb = b / 4 + 1;
+  return (uint64_t)(4 + b % 4 + 1) << (msb - 2);
+}
+
+uint64_t RGWLoadGenStats::percentile(const Op& o, double p)
+{
+  uint64_t total = o.count;
+  if (!total)
+    return 0;
+  uint64_t want = std::max<uint64_t>(1, total * p);
+  uint64_t seen = 0;
+  for (unsigned b = 0; b < NUM_BUCKETS; b++) {
+    seen += o.hist[b];
+    if (seen >= want)
+      return bucket_upper(b);
+  }
+  return bucket_upper(NUM_BUCKETS - 1);
+}
+
+void RGWLoadGenStats::add(int op, uint64_t usec, int http_status)
+{
+  Op& o = ops[op];
+  ++o.count;
+  o.total_usec += usec;
+  ++o.hist[std::min(bucket_of(usec), NUM_BUCKETS - 1)];
+  if (http_status == 404)
+    ++o.misses;
+  else if (http_status >= 400)
+    ++o.errors;
+}
+
+void RGWLoadGenStats::dump(CephContext *cct, double elapsed) const
+{
+  for (int i = 0; i < OP_MAX; i++) {
+    const Op& o = ops[i];
+    uint64_t count = o.count;
+    if (!count)
+      continue;
+    ldout(cct, 0) << "loadgen " << op_name(i)
+		  << ": ops=" << count
+		  << " ops/s=" << (elapsed > 0 ? count / elapsed : 0)
+		  << " errors=" << o.errors
+		  << " misses=" << o.misses
+		  << " avg_us=" << o.total_usec / count
+		  << " p50_us=" << percentile(o, .5)
+		  << " p90_us=" << percentile(o, .9)
+		  << " p99_us=" << percentile(o, .99)
+		  << " p999_us=" << percentile(o, .999)
+		  << dendl;
+  }
+}
+
 void RGWLoadGenRequestEnv::set_date(utime_t& tm)
 {
   date_str = rgw_to_asctime(tm);
@@ -101,6 +176,7 @@ void RGWLoadGenIO::init_env(CephContext *cct)
 size_t RGWLoadGenIO::send_status(const int status,
                                  const char* const status_name)
 {
+  this->status = status;
   return 0;
 }
 
@@ -4,6 +4,7 @@
 #ifndef CEPH_RGW_LOADGEN_H
 #define CEPH_RGW_LOADGEN_H
 
+#include <atomic>
 #include <map>
 #include <string>
 
@@ -30,6 +31,46 @@ struct RGWLoadGenRequestEnv {
   int sign(RGWAccessKey& access_key);
 };
 
+/* per-op latency and outcome accounting for the loadgen bench mode */
+class RGWLoadGenStats {
+public:
+  enum {
+    OP_GET,
+    OP_PUT,
+    OP_LIST,
+    OP_DELETE,
+    OP_MAX
+  };
+
+  static const char *op_name(int op);
+
+  void add(int op, uint64_t usec, int http_status);
+  void dump(CephContext *cct, double elapsed) const;
+
+private:
+  /* four sub-buckets per power of two, so percentiles are within 25% */
+  static constexpr unsigned NUM_BUCKETS = 256;
+
+  struct Op {
+    std::atomic<uint64_t> count = { 0 };
+    std::atomic<uint64_t> errors = { 0 };
+    std::atomic<uint64_t> misses = { 0 }; /* 404 */
+    std::atomic<uint64_t> total_usec = { 0 };
+    std::atomic<uint64_t> hist[NUM_BUCKETS];
+
+    Op() {
+      for (auto& h : hist)
+	h = 0;
+    }
+  };
+
+  Op ops[OP_MAX];
+
+  static unsigned bucket_of(uint64_t usec);
+  static uint64_t bucket_upper(unsigned b);
+  static uint64_t percentile(const Op& o, double p);
+};
+
 /* XXX does RGWLoadGenIO actually want to perform stream/HTTP I/O,
  * or (e.g) are these NOOPs? */
 class RGWLoadGenIO : public rgw::io::RestfulClient
@@ -37,6 +78,7 @@ class RGWLoadGenIO : public rgw::io::RestfulClient
   uint64_t left_to_read;
   RGWLoadGenRequestEnv* req;
   RGWEnv env;
+  int status;
 
   void init_env(CephContext *cct) override;
   size_t read_data(char *buf, size_t len);
@@ -45,7 +87,12 @@ class RGWLoadGenIO : public rgw::io::RestfulClient
 public:
   explicit RGWLoadGenIO(RGWLoadGenRequestEnv* const req)
     : left_to_read(0),
-      req(req) {
+      req(req),
+      status(0) {
+  }
+
+  int get_status() const {
+    return status;
   }
 
   size_t send_status(int status, const char *status_name) override;
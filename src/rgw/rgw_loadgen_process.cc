@@ -4,6 +4,7 @@
 #include "common/errno.h"
 #include "common/Throttle.h"
 #include "common/WorkQueue.h"
+#include "include/str_list.h"
 
 #include "rgw_rados.h"
 #include "rgw_rest.h"
@@ -14,6 +15,8 @@
 #include "rgw_client_io.h"
 
 #include <atomic>
+#include <cmath>
+#include <random>
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -28,6 +31,15 @@ void RGWLoadGenProcess::run()
 {
   m_tp.start(); /* start thread pool */
 
+  string mode;
+  conf->get_val("mode", "", &mode);
+  if (mode == "bench") {
+    run_bench();
+    m_tp.stop();
+    signal_shutdown();
+    return;
+  }
+
   int i;
 
   int num_objs;
@@ -102,13 +114,158 @@ done:
   signal_shutdown();
 } /* RGWLoadGenProcess::run() */
 
+/*
+ * Benchmark mode: prefill num_objs objects spread over num_buckets buckets,
+ * then issue a random mix of requests against them through the regular
+ * process_request() path, and report throughput and latency percentiles
+ * per op.  Parameters (frontend config):
+ *
+ *   op_mix=get:70,put:20,list:5,delete:5   relative op weights
+ *   duration=<secs>                        run time (default 60)
+ *   ops=<n>                                stop after n ops instead
+ *   obj_size=<bytes>, obj_size_max=<bytes> object size range
+ *   size_dist=uniform|log                  distribution over that range
+ *
+ * Deleted objects are not recreated, so later gets and deletes of them
+ * count as misses (404), not errors.
+ */
+void RGWLoadGenProcess::run_bench()
+{
+  int num_objs, num_buckets, duration, total_ops, obj_size, obj_size_max;
+  string op_mix, size_dist;
+  conf->get_val("num_objs", 1000, &num_objs);
+  conf->get_val("num_buckets", 1, &num_buckets);
+  conf->get_val("duration", 60, &duration);
+  conf->get_val("ops", 0, &total_ops);
+  conf->get_val("obj_size", 4096, &obj_size);
+  conf->get_val("obj_size_max", obj_size, &obj_size_max);
+  conf->get_val("op_mix", "get:70,put:20,list:5,delete:5", &op_mix);
+  conf->get_val("size_dist", "uniform", &size_dist);
+
+  if (num_objs < 1 || num_buckets < 1 || obj_size < 0 ||
+      obj_size_max < obj_size) {
+    derr << "ERROR: loadgen bench: bad num_objs/num_buckets/obj_size"
+	 << dendl;
+    return;
+  }
+
+  /* parse the op mix into cumulative weights */
+  int weights[RGWLoadGenStats::OP_MAX] = { 0 };
+  list<string> mix;
+  get_str_list(op_mix, ",", mix);
+  for (auto& m : mix) {
+    size_t pos = m.find(':');
+    string name = m.substr(0, pos);
+    int w = pos == string::npos ? 1 : atoi(m.c_str() + pos + 1);
+    int op;
+    for (op = 0; op < RGWLoadGenStats::OP_MAX; op++) {
+      if (name == RGWLoadGenStats::op_name(op))
+	break;
+    }
+    if (op == RGWLoadGenStats::OP_MAX || w < 0) {
+      derr << "ERROR: loadgen bench: bad op_mix entry '" << m << "'" << dendl;
+      return;
+    }
+    weights[op] = w;
+  }
+  int weight_total = 0;
+  for (auto& w : weights) {
+    weight_total += w;
+    w = weight_total;
+  }
+  if (!weight_total) {
+    derr << "ERROR: loadgen bench: empty op_mix" << dendl;
+    return;
+  }
+
+  std::mt19937_64 rng(ceph_clock_now().to_nsec());
+  auto next_size = [&]() -> int {
+    if (obj_size_max == obj_size)
+      return obj_size;
+    if (size_dist == "log") {
+      std::uniform_real_distribution<double> d(log(obj_size + 1),
+					       log(obj_size_max + 1));
+      return std::min<int>(obj_size_max, exp(d(rng)) - 1);
+    }
+    std::uniform_int_distribution<int> d(obj_size, obj_size_max);
+    return d(rng);
+  };
+
+  std::atomic<bool> failed = { false };
+  vector<string> buckets(num_buckets);
+  for (auto& bucket : buckets) {
+    bucket = "/loadgen";
+    append_rand_alpha(NULL, bucket, bucket, 16);
+    gen_request("PUT", bucket, 0, &failed);
+  }
+  checkpoint();
+  if (failed) {
+    derr << "ERROR: bucket creation failed" << dendl;
+    return;
+  }
+
+  vector<string> objs(num_objs);
+  for (int i = 0; i < num_objs; i++) {
+    char buf[16 + 1];
+    gen_rand_alphanumeric(NULL, buf, sizeof(buf));
+    buf[16] = '\0';
+    objs[i] = buckets[i % num_buckets] + "/" + buf;
+    gen_request("PUT", objs[i], next_size(), &failed);
+  }
+  checkpoint();
+  if (failed) {
+    derr << "ERROR: object prefill failed" << dendl;
+  } else {
+    dout(0) << "loadgen bench: " << num_objs << " objects in "
+	    << num_buckets << " buckets, op_mix " << op_mix << dendl;
+
+    std::uniform_int_distribution<int> pick_op(0, weight_total - 1);
+    std::uniform_int_distribution<int> pick_obj(0, num_objs - 1);
+    std::uniform_int_distribution<int> pick_bucket(0, num_buckets - 1);
+    utime_t start = ceph_clock_now();
+    utime_t end = start + utime_t(duration, 0);
+    for (int n = 0; total_ops ? n < total_ops : ceph_clock_now() < end; n++) {
+      int r = pick_op(rng);
+      int op = 0;
+      while (r >= weights[op])
+	op++;
+      switch (op) {
+      case RGWLoadGenStats::OP_GET:
+	gen_request("GET", objs[pick_obj(rng)], 0, nullptr, op);
+	break;
+      case RGWLoadGenStats::OP_PUT:
+	gen_request("PUT", objs[pick_obj(rng)], next_size(), nullptr, op);
+	break;
+      case RGWLoadGenStats::OP_LIST:
+	gen_request("GET", buckets[pick_bucket(rng)], 0, nullptr, op);
+	break;
+      case RGWLoadGenStats::OP_DELETE:
+	gen_request("DELETE", objs[pick_obj(rng)], 0, nullptr, op);
+	break;
+      }
+    }
+    checkpoint();
+    stats.dump(cct, ceph_clock_now() - start);
+  }
+
+  for (auto& obj : objs) {
+    gen_request("DELETE", obj, 0, nullptr);
+  }
+  checkpoint();
+  for (auto& bucket : buckets) {
+    gen_request("DELETE", bucket, 0, nullptr);
+  }
+  checkpoint();
+} /* RGWLoadGenProcess::run_bench() */
+
 void RGWLoadGenProcess::gen_request(const string& method,
 				    const string& resource,
-				    int content_length, std::atomic<bool>* fail_flag)
+				    int content_length, std::atomic<bool>* fail_flag,
+				    int op)
 {
   RGWLoadGenRequest* req =
     new RGWLoadGenRequest(store->get_new_req_id(), method, resource,
-			  content_length, fail_flag);
+			  content_length, fail_flag, op);
   dout(10) << "allocated request req=" << hex << req << dec << dendl;
   req_throttle.get(1);
   req_wq.queue(req);
@@ -135,6 +292,10 @@ void RGWLoadGenProcess::handle_request(RGWRequest* r)
 
   int ret = process_request(store, rest, req, uri_prefix,
                             *auth_registry, &client_io, olog);
+  if (req->op >= 0) {
+    stats.add(req->op, (ceph_clock_now() - tm).to_nsec() / 1000,
+	      real_client_io.get_status());
+  }
   if (ret < 0) {
     /* we don't really care about return code */
     dout(20) << "process_request() returned " << ret << dendl;
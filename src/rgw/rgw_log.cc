@@ -1,11 +1,15 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
 
+#include <atomic>
+#include <thread>
+
 #include "common/Clock.h"
 #include "common/Timer.h"
 #include "common/utf8.h"
 #include "common/OutputDataSocket.h"
 #include "common/Formatter.h"
+#include "common/errno.h"
 
 #include "rgw_bucket.h"
 #include "rgw_log.h"
@@ -104,12 +108,33 @@ class UsageLogger {
     }
   };
 
+  class C_UsageLogFlush : public Context {
+    UsageLogger *logger;
+  public:
+    explicit C_UsageLogFlush(UsageLogger *_l) : logger(_l) {}
+    void finish(int r) override {
+      logger->flush_scheduled = false;
+      logger->flush();
+    }
+  };
+
+  std::atomic<bool> flush_scheduled;
+
   void set_timer() {
     timer.add_event_after(cct->_conf->rgw_usage_log_tick_interval, new C_UsageLogTimeout(this));
   }
+
+  /* hand the flush to the timer thread so the request doesn't wait on it */
+  void schedule_flush() {
+    bool expected = false;
+    if (flush_scheduled.compare_exchange_strong(expected, true)) {
+      Mutex::Locker l(timer_lock);
+      timer.add_event_after(0, new C_UsageLogFlush(this));
+    }
+  }
 public:
 
-  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), lock("UsageLogger"), num_entries(0), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
+  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), lock("UsageLogger"), num_entries(0), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock), flush_scheduled(false) {
     timer.init();
     Mutex::Locker l(timer_lock);
     set_timer();
@@ -141,10 +166,16 @@ public:
     if (account)
       num_entries++;
     bool need_flush = (num_entries > cct->_conf->rgw_usage_log_flush_threshold);
+    bool backlogged = (num_entries > cct->_conf->rgw_usage_log_max_pending);
     lock.Unlock();
-    if (need_flush) {
+    if (backlogged) {
+      /* the background flush can't keep up; push back on the request
+       * rather than lose usage data */
       Mutex::Locker l(timer_lock);
+      perfcounter->inc(l_rgw_usage_log_inline_flush);
       flush();
+    } else if (need_flush) {
+      schedule_flush();
     }
   }
 
@@ -163,19 +194,171 @@ public:
     num_entries = 0;
     lock.Unlock();
 
+    if (old_map.empty())
+      return;
+    perfcounter->inc(l_rgw_usage_log_flush);
     store->log_usage(old_map);
   }
 };
 
 static UsageLogger *usage_logger = NULL;
 
+/* ops log writer
+ *
+ * Request threads append encoded entries to one of several shard buffers,
+ * picked by thread id so that concurrent requests rarely share a lock.
+ * Entries for the same log object are coalesced, and the timer thread
+ * writes each object's batch with a single append.  Once the backlog
+ * reaches rgw_ops_log_max_pending_bytes new entries are dropped.
+ */
+class OpsLogWriter {
+  CephContext *cct;
+  RGWRados *store;
+
+  struct Shard {
+    Mutex lock;
+    map<string, bufferlist> pending; // log object name -> entries
+    uint64_t bytes;
+    Shard() : lock("OpsLogWriter::Shard::lock"), bytes(0) {}
+  };
+  std::unique_ptr<Shard[]> shards;
+  size_t num_shards;
+  std::atomic<uint64_t> pending_bytes;
+
+  Mutex timer_lock;
+  SafeTimer timer;
+  std::atomic<bool> flush_scheduled;
+
+  class C_Tick : public Context {
+    OpsLogWriter *writer;
+  public:
+    explicit C_Tick(OpsLogWriter *_w) : writer(_w) {}
+    void finish(int r) override {
+      writer->flush();
+      writer->set_timer();
+    }
+  };
+
+  class C_Flush : public Context {
+    OpsLogWriter *writer;
+  public:
+    explicit C_Flush(OpsLogWriter *_w) : writer(_w) {}
+    void finish(int r) override {
+      writer->flush_scheduled = false;
+      writer->flush();
+    }
+  };
+
+  void set_timer() {
+    timer.add_event_after(cct->_conf->rgw_ops_log_flush_interval, new C_Tick(this));
+  }
+
+  void schedule_flush() {
+    bool expected = false;
+    if (flush_scheduled.compare_exchange_strong(expected, true)) {
+      Mutex::Locker l(timer_lock);
+      timer.add_event_after(0, new C_Flush(this));
+    }
+  }
+
+  int write(const string& oid, bufferlist& bl) {
+    rgw_raw_obj obj(store->get_zone_params().log_pool, oid);
+    int ret = store->append_async(obj, bl.length(), bl);
+    if (ret == -ENOENT) {
+      ret = store->create_pool(store->get_zone_params().log_pool);
+      if (ret < 0)
+        return ret;
+      // retry
+      ret = store->append_async(obj, bl.length(), bl);
+    }
+    return ret;
+  }
+
+public:
+  OpsLogWriter(CephContext *_cct, RGWRados *_store)
+    : cct(_cct), store(_store),
+      num_shards(std::max<uint64_t>(1, cct->_conf->rgw_ops_log_shards)),
+      pending_bytes(0),
+      timer_lock("OpsLogWriter::timer_lock"), timer(cct, timer_lock),
+      flush_scheduled(false) {
+    shards.reset(new Shard[num_shards]);
+    timer.init();
+    Mutex::Locker l(timer_lock);
+    set_timer();
+  }
+
+  ~OpsLogWriter() {
+    Mutex::Locker l(timer_lock);
+    flush();
+    timer.cancel_all_events();
+    timer.shutdown();
+  }
+
+  /* returns false if the entry was dropped */
+  bool queue(const string& oid, bufferlist& bl) {
+    uint64_t len = bl.length();
+    // account for the entry before a flush can see it, so that flush()
+    // never subtracts bytes that were not added yet
+    if (pending_bytes.fetch_add(len) + len >
+        cct->_conf->rgw_ops_log_max_pending_bytes) {
+      pending_bytes -= len;
+      perfcounter->inc(l_rgw_ops_log_dropped);
+      return false;
+    }
+    Shard& shard = shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % num_shards];
+    shard.lock.Lock();
+    shard.pending[oid].claim_append(bl);
+    shard.bytes += len;
+    bool need_flush = (shard.bytes >= cct->_conf->rgw_ops_log_flush_bytes);
+    shard.lock.Unlock();
+    perfcounter->inc(l_rgw_ops_log_queued);
+    if (need_flush) {
+      schedule_flush();
+    }
+    return true;
+  }
+
+  void flush() {
+    map<string, bufferlist> batch;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < num_shards; i++) {
+      Shard& shard = shards[i];
+      map<string, bufferlist> m;
+      shard.lock.Lock();
+      m.swap(shard.pending);
+      bytes += shard.bytes;
+      shard.bytes = 0;
+      shard.lock.Unlock();
+      for (auto& p : m) {
+        batch[p.first].claim_append(p.second);
+      }
+    }
+    for (auto& p : batch) {
+      int ret = write(p.first, p.second);
+      if (ret < 0) {
+        ldout(cct, 0) << "ERROR: failed to write ops log object " << p.first
+                      << ": " << cpp_strerror(-ret) << dendl;
+        continue;
+      }
+      perfcounter->inc(l_rgw_ops_log_writes);
+    }
+    pending_bytes -= bytes;
+  }
+};
+
+static OpsLogWriter *ops_log_writer = NULL;
+
 void rgw_log_usage_init(CephContext *cct, RGWRados *store)
 {
   usage_logger = new UsageLogger(cct, store);
+  if (cct->_conf->rgw_enable_ops_log && cct->_conf->rgw_ops_log_rados)
+    ops_log_writer = new OpsLogWriter(cct, store);
 }
 
 void rgw_log_usage_finalize()
 {
+  delete ops_log_writer;
+  ops_log_writer = NULL;
   delete usage_logger;
   usage_logger = NULL;
 }
@@ -405,15 +588,21 @@ int rgw_log_op(RGWRados *store, RGWREST* const rest, struct req_state *s,
     string oid = render_log_object_name(s->cct->_conf->rgw_log_object_name, &bdt,
 				        s->bucket.bucket_id, entry.bucket);
 
-    rgw_raw_obj obj(store->get_zone_params().log_pool, oid);
+    if (ops_log_writer) {
+      if (!ops_log_writer->queue(oid, bl)) {
+        ldout(s->cct, 10) << "ops log backlog full, dropped entry" << dendl;
+      }
+    } else {
+      rgw_raw_obj obj(store->get_zone_params().log_pool, oid);
 
-    ret = store->append_async(obj, bl.length(), bl);
-    if (ret == -ENOENT) {
-      ret = store->create_pool(store->get_zone_params().log_pool);
-      if (ret < 0)
-        goto done;
-      // retry
       ret = store->append_async(obj, bl.length(), bl);
+      if (ret == -ENOENT) {
+        ret = store->create_pool(store->get_zone_params().log_pool);
+        if (ret < 0)
+          goto done;
+        // retry
+        ret = store->append_async(obj, bl.length(), bl);
+      }
     }
   }
 
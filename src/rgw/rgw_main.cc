@@ -50,6 +50,7 @@
 #include "rgw_log.h"
 #include "rgw_tools.h"
 #include "rgw_resolve.h"
+#include "rgw_http_client.h"
 
 #include "rgw_request.h"
 #include "rgw_process.h"
@@ -610,6 +611,7 @@ int main(int argc, const char **argv)
 
   rgw_tools_cleanup();
   rgw_shutdown_resolver();
+  rgw_http_client_cleanup();
   curl_global_cleanup();
 
   rgw_perf_stop(g_ceph_context);
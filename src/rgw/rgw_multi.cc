@@ -141,14 +141,20 @@ int list_multipart_parts(RGWRados *store, RGWBucketInfo& bucket_info, CephContex
     }
     if (sorted_omap ||
       (int)info.num > marker) {
-      parts[info.num] = info;
       last_num = info.num;
+      parts[info.num] = std::move(info);
     }
   }
 
   if (sorted_omap) {
     if (truncated)
       *truncated = (iter != parts_map.end());
+  } else if ((int)parts.size() <= num_parts) {
+    /* everything fits; no need to rebuild */
+    if (!parts.empty())
+      last_num = parts.rbegin()->first;
+    if (truncated)
+      *truncated = false;
   } else {
     /* rebuild a map with only num_parts entries */
 
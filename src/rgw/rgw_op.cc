@@ -15,6 +15,9 @@
 #include <boost/utility/string_view.hpp>
 
 #include "common/Clock.h"
+#include "common/Cond.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
 #include "common/armor.h"
 #include "common/backport14.h"
 #include "common/errno.h"
@@ -1746,6 +1749,8 @@ void RGWGetObj::execute()
   if (op_ret < 0) {
     goto done_err;
   }
+  perfcounter->hinc(l_rgw_get_lat_bytes_hist,
+		    (ceph_clock_now() - start_time).to_nsec(), total_len);
   return;
 
 done_err:
@@ -2247,6 +2252,7 @@ void RGWListBucket::execute()
   list_op.params.marker = marker;
   list_op.params.end_marker = end_marker;
   list_op.params.list_versions = list_versions;
+  list_op.params.allow_unordered = allow_unordered;
 
   op_ret = list_op.list_objects(max, &objs, &common_prefixes, &is_truncated);
   if (op_ret >= 0) {
@@ -3111,6 +3117,86 @@ void RGWPutObj::pre_exec()
   rgw_bucket_object_pre_exec(s);
 }
 
+namespace {
+
+/* hashes a PUT body on its own thread, so that computing the ETag of one
+ * chunk overlaps with receiving the next one and writing it out. queued
+ * chunks share their buffers with the writes, at most max_queued bytes
+ * of them are held back */
+class PutObjMD5Thread : public Thread {
+  MD5& hash;
+  const uint64_t max_queued;
+  Mutex lock;
+  Cond cond;
+  list<bufferlist> queue;
+  uint64_t queued{0};
+  bool stopping{false};
+  ceph::timespan wait_time{ceph::timespan::zero()};
+
+  void *entry() override {
+    Mutex::Locker l(lock);
+    for (;;) {
+      if (queue.empty()) {
+        if (stopping) {
+          break;
+        }
+        cond.Wait(lock);
+        continue;
+      }
+      bufferlist bl;
+      bl.swap(queue.front());
+      queue.pop_front();
+      lock.Unlock();
+
+      for (const auto& p : bl.buffers()) {
+        hash.Update((const byte *)p.c_str(), p.length());
+      }
+
+      lock.Lock();
+      queued -= bl.length();
+      cond.SignalAll();
+    }
+    return nullptr;
+  }
+
+public:
+  PutObjMD5Thread(MD5& hash, uint64_t max_queued)
+    : hash(hash), max_queued(max_queued), lock("PutObjMD5Thread::lock") {}
+  ~PutObjMD5Thread() override {
+    finish();
+  }
+
+  void queue_data(const bufferlist& bl) {
+    Mutex::Locker l(lock);
+    auto start = ceph::mono_clock::now();
+    while (queued > 0 && queued + bl.length() > max_queued) {
+      cond.Wait(lock);
+    }
+    wait_time += ceph::mono_clock::now() - start;
+    queue.push_back(bl);
+    queued += bl.length();
+    cond.SignalAll();
+  }
+
+  /* waits for everything queued to be hashed */
+  void finish() {
+    if (!is_started()) {
+      return;
+    }
+    lock.Lock();
+    stopping = true;
+    cond.SignalAll();
+    lock.Unlock();
+    join();
+  }
+
+  ceph::timespan get_wait_time() const {
+    return wait_time;
+  }
+};
+
+} // anonymous namespace
+
 class RGWPutObj_CB : public RGWGetDataCB
 {
   RGWPutObj *op;
@@ -3237,6 +3323,8 @@ void RGWPutObj::execute()
   char calc_md5[CEPH_CRYPTO_MD5_DIGESTSIZE * 2 + 1];
   unsigned char m[CEPH_CRYPTO_MD5_DIGESTSIZE];
   MD5 hash;
+  std::unique_ptr<PutObjMD5Thread> md5_thread;
+  ceph::timespan client_wait = ceph::timespan::zero();
   bufferlist bl, aclbl, bs;
   int len;
   map<string, string>::iterator iter;
@@ -3351,18 +3439,31 @@ void RGWPutObj::execute()
         ldout(s->cct, 1) << "Cannot load plugin for compression type "
             << compression_type << dendl;
       } else {
-        compressor.emplace(s->cct, plugin, filter);
+        const bool pipelined = !chunked_upload &&
+          s->cct->_conf->rgw_compression_thread_min_size > 0 &&
+          s->content_length >= s->cct->_conf->rgw_compression_thread_min_size;
+        compressor.emplace(s->cct, plugin, filter, pipelined);
         filter = &*compressor;
       }
     }
   }
 
+  if (need_calc_md5 && !chunked_upload && !copy_source &&
+      s->cct->_conf->rgw_put_obj_md5_thread_min_size > 0 &&
+      s->content_length >= s->cct->_conf->rgw_put_obj_md5_thread_min_size) {
+    md5_thread.reset(new PutObjMD5Thread(hash,
+                       s->cct->_conf->rgw_put_obj_max_window_size));
+    md5_thread->create("rgw_put_md5");
+  }
+
   do {
     bufferlist data;
     if (fst > lst)
       break;
     if (!copy_source) {
+      auto start = ceph::mono_clock::now();
       len = get_data(data);
+      client_wait += ceph::mono_clock::now() - start;
     } else {
       uint64_t cur_lst = min(fst + s->cct->_conf->rgw_max_chunk_size - 1, lst);
       op_ret = get_data(fst, cur_lst, data);
@@ -3377,7 +3478,9 @@ void RGWPutObj::execute()
       goto done;
     }
 
-    if (need_calc_md5) {
+    if (md5_thread) {
+      md5_thread->queue_data(data);
+    } else if (need_calc_md5) {
       hash.Update((const byte *)data.c_str(), data.length());
     }
 
@@ -3434,7 +3537,10 @@ void RGWPutObj::execute()
         filter = encrypt.get();
       } else {
         if (compressor) {
-          compressor.emplace(s->cct, plugin, filter);
+          const bool pipelined = !chunked_upload &&
+            s->cct->_conf->rgw_compression_thread_min_size > 0 &&
+            s->content_length >= s->cct->_conf->rgw_compression_thread_min_size;
+          compressor.emplace(s->cct, plugin, filter, pipelined);
           filter = &*compressor;
         }
       }
@@ -3455,6 +3561,17 @@ void RGWPutObj::execute()
     }
   }
 
+  if (md5_thread) {
+    md5_thread->finish();
+  }
+  ldout(s->cct, 10) << "put pipeline: bytes=" << ofs
+                    << " client_wait=" << client_wait
+                    << " write_stalls=" << processor->get_stalls()
+                    << " write_stall_time=" << processor->get_stall_time()
+                    << " md5_wait=" << (md5_thread ? md5_thread->get_wait_time() :
+                                        ceph::timespan::zero())
+                    << dendl;
+
   if (!chunked_upload && ofs != s->content_length) {
     op_ret = -ERR_REQUEST_TIMEOUT;
     goto done;
@@ -3569,8 +3686,11 @@ void RGWPutObj::execute()
 
 done:
   dispose_processor(processor);
-  perfcounter->tinc(l_rgw_put_lat,
-		    (ceph_clock_now() - s->time));
+  utime_t lat = ceph_clock_now() - s->time;
+  perfcounter->tinc(l_rgw_put_lat, lat);
+  if (op_ret >= 0) {
+    perfcounter->hinc(l_rgw_put_lat_bytes_hist, lat.to_nsec(), s->obj_size);
+  }
 }
 
 int RGWPostObj::verify_permission()
@@ -5264,7 +5384,12 @@ void RGWCompleteMultipart::execute()
 
   int total_parts = 0;
   int handled_parts = 0;
-  int max_parts = 1000;
+  /* read the part entries in as few omap batches as possible: the client
+   * already told us how many parts there are (bounded by
+   * rgw_multipart_part_upload_limit).  with smaller batches, uploads with
+   * old-style upload ids or gaps in the part numbers re-read the whole
+   * omap for every batch. */
+  int max_parts = std::max<int>(1000, parts->parts.size());
   int marker = 0;
   bool truncated;
   RGWCompressionInfo cs_info;
@@ -5674,6 +5799,18 @@ void RGWDeleteMultiObj::execute()
     goto done;
   }
 
+  {
+  /* the index completions go out in batches, so the results are only
+   * known once the batch has been flushed */
+  struct del_result {
+    rgw_obj_key key;
+    rgw_obj obj;
+    bool delete_marker;
+    string version_id;
+    int ret;
+  };
+  list<del_result> results;
+  RGWRados::IndexCompleteBatch index_batch(store, s->bucket_info);
   for (iter = multi_delete->objects.begin();
         iter != multi_delete->objects.end() && num_processed < max_to_delete;
         ++iter, num_processed++) {
@@ -5687,7 +5824,7 @@ void RGWDeleteMultiObj::execute()
 				   obj);
       if ((e == Effect::Deny) ||
 	  (e == Effect::Pass && !acl_allowed)) {
-	send_partial_response(*iter, false, "", -EACCES);
+	results.push_back(del_result{*iter, obj, false, "", -EACCES});
 	continue;
       }
     }
@@ -5700,14 +5837,23 @@ void RGWDeleteMultiObj::execute()
     del_op.params.bucket_owner = s->bucket_owner.get_id();
     del_op.params.versioning_status = s->bucket_info.versioning_status();
     del_op.params.obj_owner = s->owner;
+    del_op.params.index_batch = &index_batch;
 
     op_ret = del_op.delete_obj();
     if (op_ret == -ENOENT) {
       op_ret = 0;
     }
 
-    send_partial_response(*iter, del_op.result.delete_marker,
-			  del_op.result.version_id, op_ret);
+    results.push_back(del_result{*iter, obj, del_op.result.delete_marker,
+                                 del_op.result.version_id, op_ret});
+  }
+  index_batch.flush();
+  for (auto& r : results) {
+    if (r.ret == 0) {
+      r.ret = index_batch.result(r.obj);
+    }
+    send_partial_response(r.key, r.delete_marker, r.version_id, r.ret);
+  }
   }
 
   /*  set the return code to zero, errors at this point will be
@@ -11,6 +11,7 @@
 #include "rgw_user.h"
 #include "rgw_op.h"
 #include "rgw_rest.h"
+#include "rgw_loadgen.h"
 
 #include "include/assert.h"
 
@@ -176,6 +177,9 @@ public:
 
 class RGWLoadGenProcess : public RGWProcess {
   RGWAccessKey access_key;
+  RGWLoadGenStats stats;
+
+  void run_bench();
 public:
   RGWLoadGenProcess(CephContext* cct, RGWProcessEnv* pe, int num_threads,
 		  RGWFrontendConfig* _conf) :
@@ -184,7 +188,8 @@ public:
   void checkpoint();
   void handle_request(RGWRequest* req) override;
   void gen_request(const string& method, const string& resource,
-		  int content_length, std::atomic<bool>* fail_flag);
+		  int content_length, std::atomic<bool>* fail_flag,
+		  int op = -1);
 
   void set_access_key(RGWAccessKey& key) { access_key = key; }
 };
@@ -61,6 +61,19 @@ protected:
     }
   };
 
+  /* a failed async refresh is retried on the next stats lookup */
+  class StatsAsyncRetry : public lru_map<T, RGWQuotaCacheStats>::UpdateContext {
+  public:
+    bool update(RGWQuotaCacheStats *entry) override {
+      if (entry->async_refresh_time.sec() != 0)
+        return false;
+
+      entry->async_refresh_time = ceph_clock_now();
+
+      return true;
+    }
+  };
+
   virtual int fetch_stats_from_storage(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats) = 0;
 
   virtual bool map_find(const rgw_user& user, const rgw_bucket& bucket, RGWQuotaCacheStats& qs) = 0;
@@ -152,6 +165,8 @@ int RGWQuotaCache<T>::async_refresh(const rgw_user& user, const rgw_bucket& buck
   if (ret < 0) {
     async_refcount->put();
     handler->drop_reference();
+    StatsAsyncRetry retry;
+    map_find_and_update(user, bucket, &retry);
     return ret;
   }
 
@@ -163,6 +178,9 @@ void RGWQuotaCache<T>::async_refresh_fail(const rgw_user& user, rgw_bucket& buck
 {
   ldout(store->ctx(), 20) << "async stats refresh response for bucket=" << bucket << dendl;
 
+  StatsAsyncRetry retry;
+  map_find_and_update(user, bucket, &retry);
+
   async_refcount->put();
 }
 
@@ -197,7 +215,15 @@ int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket,
   RGWQuotaCacheStats qs;
   utime_t now = ceph_clock_now();
   if (map_find(user, bucket, qs)) {
-    if (qs.async_refresh_time.sec() > 0 && now >= qs.async_refresh_time) {
+    /*
+     * in nonblocking mode the cached stats, which include the changes done
+     * through this gateway, are always used. stats that are getting close to
+     * the limit are refreshed in the background right away instead.
+     */
+    const bool nonblocking = store->ctx()->_conf->rgw_quota_nonblocking_check;
+    const bool usable = can_use_cached_stats(quota, qs.stats);
+    if (qs.async_refresh_time.sec() > 0 &&
+        (now >= qs.async_refresh_time || (nonblocking && !usable))) {
       int r = async_refresh(user, bucket, qs);
       if (r < 0) {
         ldout(store->ctx(), 0) << "ERROR: quota async refresh returned ret=" << r << dendl;
@@ -206,8 +232,8 @@ int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket,
       }
     }
 
-    if (can_use_cached_stats(quota, qs.stats) && qs.expiration >
-	ceph_clock_now()) {
+    if (nonblocking ||
+        (usable && qs.expiration > ceph_clock_now())) {
       stats = qs.stats;
       return 0;
     }
@@ -2560,7 +2560,12 @@ int RGWPutObjProcessor_Aio::throttle_data(void *handle, const rgw_raw_obj& obj,
 
   /* now throttle. Note that need_to_wait should only affect the first IO operation */
   if (pending_size > window_size || _wait) {
+    auto start = ceph::mono_clock::now();
     int r = wait_pending_front();
+    if (!_wait) {
+      stalls++;
+      stall_time += ceph::mono_clock::now() - start;
+    }
     if (r < 0)
       return r;
   }
@@ -5545,6 +5550,15 @@ int RGWRados::Bucket::List::list_objects(int64_t max,
                                          map<string, bool> *common_prefixes,
                                          bool *is_truncated)
 {
+  if (params.allow_unordered) {
+    // common prefixes can't be rolled up without seeing keys in order
+    if (!params.delim.empty())
+      return -EINVAL;
+    if (common_prefixes)
+      common_prefixes->clear();
+    return list_objects_unordered(max, result, is_truncated);
+  }
+
   RGWRados *store = target->get_store();
   CephContext *cct = store->ctx();
   int shard_id = target->get_shard_id();
@@ -5596,6 +5610,12 @@ int RGWRados::Bucket::List::list_objects(int64_t max,
     }
   }
   
+  /* let the index roll up common prefixes, unless a filter might reject
+   * the entry it would keep for one */
+  string server_delim;
+  if (!params.filter && cct->_conf->rgw_bucket_list_server_delimiter)
+    server_delim = params.delim;
+
   string skip_after_delim;
   while (truncated && count <= max) {
     if (skip_after_delim > cur_marker.name) {
@@ -5605,7 +5625,7 @@ int RGWRados::Bucket::List::list_objects(int64_t max,
     std::map<string, rgw_bucket_dir_entry> ent_map;
     int r = store->cls_bucket_list(target->get_bucket_info(), shard_id, cur_marker, cur_prefix,
                                    read_ahead + 1 - count, params.list_versions, ent_map,
-                                   &truncated, &cur_marker);
+                                   &truncated, &cur_marker, NULL, server_delim);
     if (r < 0)
       return r;
 
@@ -5707,6 +5727,90 @@ done:
   return 0;
 }
 
+/**
+ * Like list_objects() without a delimiter, but return entries in index
+ * shard order rather than sorted, which lets a sharded bucket be listed
+ * one shard at a time.  The marker is the last key returned.
+ */
+int RGWRados::Bucket::List::list_objects_unordered(int64_t max,
+                                                   vector<rgw_bucket_dir_entry> *result,
+                                                   bool *is_truncated)
+{
+  RGWRados *store = target->get_store();
+  CephContext *cct = store->ctx();
+  int shard_id = target->get_shard_id();
+
+  int count = 0;
+  bool truncated = true;
+
+  result->clear();
+
+  rgw_obj_key marker_obj(params.marker.name, params.marker.instance, params.ns);
+  rgw_obj_index_key cur_marker;
+  marker_obj.get_index_key(&cur_marker);
+
+  rgw_obj_key end_marker_obj(params.end_marker.name, params.end_marker.instance,
+                             params.ns);
+  rgw_obj_index_key cur_end_marker;
+  end_marker_obj.get_index_key(&cur_end_marker);
+  const bool cur_end_marker_valid = !params.end_marker.empty();
+
+  rgw_obj_key prefix_obj(params.prefix);
+  prefix_obj.ns = params.ns;
+  string cur_prefix = prefix_obj.get_index_key_name();
+
+  while (truncated && count < max) {
+    std::vector<rgw_bucket_dir_entry> ent_list;
+    int r = store->cls_bucket_list_unordered(target->get_bucket_info(), shard_id,
+                                             cur_marker, cur_prefix, max - count,
+                                             params.list_versions, ent_list,
+                                             &truncated, &cur_marker);
+    if (r < 0)
+      return r;
+
+    for (auto& entry : ent_list) {
+      rgw_obj_index_key index_key = entry.key;
+      rgw_obj_key obj(index_key);
+
+      params.marker = index_key;
+      next_marker = index_key;
+
+      bool valid = rgw_obj_key::parse_raw_oid(index_key.name, &obj);
+      if (!valid) {
+        ldout(cct, 0) << "ERROR: could not parse object name: " << obj.name << dendl;
+        continue;
+      }
+
+      if (!params.list_versions && !entry.is_visible()) {
+        continue;
+      }
+
+      if (params.enforce_ns && obj.ns != params.ns) {
+        continue;
+      }
+
+      // keys are not sorted, so skip past the end marker instead of stopping
+      if (cur_end_marker_valid && cur_end_marker <= index_key) {
+        continue;
+      }
+
+      if (params.filter && !params.filter->filter(obj.name, index_key.name))
+        continue;
+
+      if (params.prefix.size() && (obj.name.compare(0, params.prefix.size(), params.prefix) != 0))
+        continue;
+
+      result->emplace_back(std::move(entry));
+      count++;
+    }
+  }
+
+  if (is_truncated)
+    *is_truncated = truncated;
+
+  return 0;
+}
+
 /**
  * create a rados pool, associated meta info
  * returns 0 on success, -ERR# otherwise.
@@ -6951,13 +7055,49 @@ int RGWRados::Object::Write::_do_write_meta(uint64_t size, uint64_t accounted_si
     index_op->set_bilog_flags(RGW_BILOG_FLAG_VERSIONED_OP);
   }
 
+  /* with rgw_bucket_index_pipeline_prepare the index prepare is in flight
+   * while the head is written.  That is only done when the head is
+   * created exclusively, so that a failed prepare can be undone by
+   * removing it again; overwrites and versioned ops (which update the
+   * olh right after) keep the old order */
+  bool pipelined_prepare = false;
   if (!index_op->is_prepared()) {
-    r = index_op->prepare(CLS_RGW_OP_ADD, &state->write_tag);
+    pipelined_prepare = (store->ctx()->_conf->rgw_bucket_index_pipeline_prepare &&
+                         !versioned_op && reset_obj && state->is_atomic && !state->exists);
+    if (pipelined_prepare) {
+      r = index_op->prepare_async(CLS_RGW_OP_ADD, &state->write_tag);
+    } else {
+      r = index_op->prepare(CLS_RGW_OP_ADD, &state->write_tag);
+    }
     if (r < 0)
       return r;
   }
 
   r = ref.ioctx.operate(ref.oid, &op);
+  if (pipelined_prepare) {
+    int ret = index_op->wait_prepare();
+    if (ret < 0) {
+      ldout(store->ctx(), 0) << "ERROR: bucket index prepare for " << obj
+                             << " returned ret=" << ret << " (head write returned r="
+                             << r << ")" << dendl;
+      if (r >= 0) {
+        /* the head didn't exist before, remove it again unless it was
+         * replaced in the meantime */
+        ObjectWriteOperation rm_op;
+        bufferlist tag_bl;
+        tag_bl.append(state->write_tag.c_str(), state->write_tag.size() + 1);
+        rm_op.cmpxattr(RGW_ATTR_ID_TAG, LIBRADOS_CMPXATTR_OP_EQ, tag_bl);
+        rm_op.remove();
+        r = ref.ioctx.operate(ref.oid, &rm_op);
+        if (r < 0 && r != -ECANCELED && r != -ENOENT) {
+          ldout(store->ctx(), 0) << "ERROR: failed to remove head of " << obj
+                                 << " after failed index prepare: r=" << r << dendl;
+        }
+        target->invalidate_state();
+      }
+      return ret;
+    }
+  }
   if (r < 0) { /* we can expect to get -ECANCELED if object was replaced under,
                 or -ENOENT if was removed, or -EEXIST if it did not exist
                 before and now it does */
@@ -8872,6 +9012,7 @@ int RGWRados::Object::Delete::delete_obj()
   
   index_op.set_zones_trace(params.zones_trace);
   index_op.set_bilog_flags(params.bilog_flags);
+  index_op.set_complete_batch(params.index_batch);
 
 
   r = index_op.prepare(CLS_RGW_OP_DEL, &state->write_tag);
@@ -8927,7 +9068,8 @@ int RGWRados::delete_obj(RGWObjectCtx& obj_ctx,
                          int versioning_status,
                          uint16_t bilog_flags,
                          const real_time& expiration_time,
-                         rgw_zone_set *zones_trace)
+                         rgw_zone_set *zones_trace,
+                         IndexCompleteBatch *index_batch)
 {
   RGWRados::Object del_target(this, bucket_info, obj_ctx, obj);
   RGWRados::Object::Delete del_op(&del_target);
@@ -8937,6 +9079,7 @@ int RGWRados::delete_obj(RGWObjectCtx& obj_ctx,
   del_op.params.bilog_flags = bilog_flags;
   del_op.params.expiration_time = expiration_time;
   del_op.params.zones_trace = zones_trace;
+  del_op.params.index_batch = index_batch;
 
   return del_op.delete_obj();
 }
@@ -9976,6 +10119,66 @@ int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op, const string *write_t
   return 0;
 }
 
+int RGWRados::Bucket::UpdateIndex::prepare_async(RGWModifyOp op, const string *write_tag)
+{
+  if (blind) {
+    return 0;
+  }
+  RGWRados *store = target->get_store();
+
+  if (write_tag && write_tag->length()) {
+    optag = string(write_tag->c_str(), write_tag->length());
+  } else {
+    if (optag.empty()) {
+      append_rand_alpha(store->ctx(), optag, optag, 32);
+    }
+  }
+
+  BucketShard *bs;
+  int r = get_bucket_shard(&bs);
+  if (r < 0) {
+    ldout(store->ctx(), 5) << "failed to get BucketShard object: ret=" << r << dendl;
+    return r;
+  }
+
+  assert(!prepare_completion);
+  prepare_completion = librados::Rados::aio_create_completion(nullptr, nullptr, nullptr);
+  prepare_op = op;
+  r = store->cls_obj_prepare_op_async(*bs, op, optag, obj, bilog_flags, zones_trace,
+                                      prepare_completion);
+  if (r < 0) {
+    prepare_completion->release();
+    prepare_completion = nullptr;
+    return r;
+  }
+  prepared = true;
+
+  return 0;
+}
+
+int RGWRados::Bucket::UpdateIndex::wait_prepare()
+{
+  if (!prepare_completion) {
+    return 0;
+  }
+
+  prepare_completion->wait_for_safe();
+  int r = prepare_completion->get_return_value();
+  prepare_completion->release();
+  prepare_completion = nullptr;
+
+  if (r == -ERR_BUSY_RESHARDING) {
+    /* take the synchronous path, which waits for the reshard and retries
+     * against the new bucket instance */
+    prepared = false;
+    return prepare(prepare_op, nullptr);
+  }
+  if (r < 0) {
+    prepared = false;
+  }
+  return r;
+}
+
 int RGWRados::Bucket::UpdateIndex::complete(int64_t poolid, uint64_t epoch,
                                             uint64_t size, uint64_t accounted_size,
                                             ceph::real_time& ut, const string& etag,
@@ -9990,7 +10193,12 @@ int RGWRados::Bucket::UpdateIndex::complete(int64_t poolid, uint64_t epoch,
   RGWRados *store = target->get_store();
   BucketShard *bs;
 
-  int ret = get_bucket_shard(&bs);
+  int ret = wait_prepare();
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = get_bucket_shard(&bs);
   if (ret < 0) {
     ldout(store->ctx(), 5) << "failed to get BucketShard object: ret=" << ret << dendl;
     return ret;
@@ -10038,15 +10246,22 @@ int RGWRados::Bucket::UpdateIndex::complete_del(int64_t poolid, uint64_t epoch,
   RGWRados *store = target->get_store();
   BucketShard *bs;
 
-  int ret = get_bucket_shard(&bs);
+  int ret = wait_prepare();
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = get_bucket_shard(&bs);
   if (ret < 0) {
     ldout(store->ctx(), 5) << "failed to get BucketShard object: ret=" << ret << dendl;
     return ret;
   }
 
-  ret = store->cls_obj_complete_del(*bs, optag, poolid, epoch, obj, removed_mtime, remove_objs, bilog_flags, zones_trace);
+  ret = store->cls_obj_complete_del(*bs, optag, poolid, epoch, obj, removed_mtime, remove_objs, bilog_flags, zones_trace,
+                                    complete_batch);
 
-  if (target->bucket_info.datasync_flag_enabled()) {
+  /* a batch adds the data log entry once it has sent the completion */
+  if (!complete_batch && target->bucket_info.datasync_flag_enabled()) {
     int r = store->data_log->add_entry(bs->bucket, bs->shard_id);
     if (r < 0) {
       lderr(store->ctx()) << "ERROR: failed writing data log" << dendl;
@@ -10065,6 +10280,9 @@ int RGWRados::Bucket::UpdateIndex::cancel()
   RGWRados *store = target->get_store();
   BucketShard *bs;
 
+  /* the cancel must not overtake the prepare */
+  wait_prepare();
+
   int ret = guard_reshard(&bs, [&](BucketShard *bs) -> int { 
     return store->cls_obj_complete_cancel(*bs, optag, obj, bilog_flags, zones_trace);
   });
@@ -10293,13 +10511,45 @@ struct get_obj_data : public RefCountedObject {
   Throttle throttle;
   list<bufferlist> read_list;
 
+  /* the window starts at rgw_get_obj_window_size and grows up to
+   * rgw_get_obj_max_window_size while we spend more time waiting for reads
+   * to come back than sending data to the client. only touched by the
+   * thread iterating over the object */
+  uint64_t max_window;
+  uint64_t round_issued = 0;
+  ceph::timespan read_wait = ceph::timespan::zero();
+  ceph::timespan client_wait = ceph::timespan::zero();
+
   explicit get_obj_data(CephContext *_cct)
     : cct(_cct),
       rados(NULL), ctx(NULL),
       total_read(0), lock("get_obj_data"), data_lock("get_obj_data::data_lock"),
       client_cb(NULL),
-      throttle(cct, "get_obj_data", cct->_conf->rgw_get_obj_window_size, false) {}
+      throttle(cct, "get_obj_data", cct->_conf->rgw_get_obj_window_size, false),
+      max_window(std::max<int64_t>(cct->_conf->rgw_get_obj_max_window_size,
+                                   cct->_conf->rgw_get_obj_window_size)) {}
   ~get_obj_data() override { } 
+
+  void throttle_get(off_t len) {
+    auto start = ceph::mono_clock::now();
+    throttle.get(len);
+    read_wait += ceph::mono_clock::now() - start;
+
+    round_issued += len;
+    uint64_t window = throttle.get_max();
+    if (round_issued < window) {
+      return;
+    }
+    /* a full window went out since we last looked; if the client kept up
+     * better than the reads did, more reads in flight will help */
+    if (read_wait > client_wait && window < max_window) {
+      window = std::min(window * 2, max_window);
+      ldout(cct, 20) << "get_obj_data: growing read window to " << window << dendl;
+      throttle.reset_max(window);
+    }
+    round_issued = 0;
+    read_wait = client_wait = ceph::timespan::zero();
+  }
   void set_cancelled(int r) {
     cancelled = true;
     err_code = r;
@@ -10514,6 +10764,7 @@ int RGWRados::flush_read_list(struct get_obj_data *d)
 
   int r = 0;
 
+  auto start = ceph::mono_clock::now();
   list<bufferlist>::iterator iter;
   for (iter = l.begin(); iter != l.end(); ++iter) {
     bufferlist& bl = *iter;
@@ -10523,6 +10774,7 @@ int RGWRados::flush_read_list(struct get_obj_data *d)
       break;
     }
   }
+  d->client_wait += ceph::mono_clock::now() - start;
 
   d->data_lock.Lock();
   d->put();
@@ -10578,7 +10830,7 @@ int RGWRados::get_obj_iterate_cb(RGWObjectCtx *ctx, RGWObjState *astate,
     }
   }
 
-  d->throttle.get(len);
+  d->throttle_get(len);
   if (d->is_cancelled()) {
     return d->get_err_code();
   }
@@ -12618,10 +12870,30 @@ int RGWRados::cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag,
   return bs.index_ctx.operate(bs.bucket_obj, &o);
 }
 
+int RGWRados::cls_obj_prepare_op_async(BucketShard& bs, RGWModifyOp op, string& tag,
+                                       rgw_obj& obj, uint16_t bilog_flags, rgw_zone_set *_zones_trace,
+                                       librados::AioCompletion *c)
+{
+  rgw_zone_set zones_trace;
+  if (_zones_trace) {
+    zones_trace = *_zones_trace;
+  }
+  else {
+    zones_trace.insert(get_zone().id);
+  }
+
+  ObjectWriteOperation o;
+  cls_rgw_obj_key key(obj.key.get_index_key_name(), obj.key.instance);
+  cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
+  cls_rgw_bucket_prepare_op(o, op, tag, key, obj.key.get_loc(), get_zone().log_data, bilog_flags, zones_trace);
+  return bs.index_ctx.aio_operate(bs.bucket_obj, c, &o);
+}
+
 int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModifyOp op, string& tag,
                                   int64_t pool, uint64_t epoch,
                                   rgw_bucket_dir_entry& ent, RGWObjCategory category,
-				  list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *_zones_trace)
+				  list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *_zones_trace,
+				  IndexCompleteBatch *batch)
 {
   ObjectWriteOperation o;
   rgw_bucket_dir_entry_meta dir_meta;
@@ -12632,6 +12904,21 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModify
   ver.pool = pool;
   ver.epoch = epoch;
   cls_rgw_obj_key key(ent.key.name, ent.key.instance);
+  if (batch) {
+    rgw_cls_obj_complete_op call;
+    call.op = op;
+    call.tag = tag;
+    call.key = key;
+    call.ver = ver;
+    call.meta = dir_meta;
+    call.log_op = get_zone().log_data;
+    call.bilog_flags = bilog_flags;
+    if (remove_objs)
+      call.remove_objs = *remove_objs;
+    if (_zones_trace)
+      call.zones_trace = *_zones_trace;
+    return batch->add(bs, obj, std::move(call));
+  }
   cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
   cls_rgw_bucket_complete_op(o, op, tag, ver, key, dir_meta, remove_objs,
                              get_zone().log_data, bilog_flags, _zones_trace);
@@ -12658,12 +12945,14 @@ int RGWRados::cls_obj_complete_del(BucketShard& bs, string& tag,
                                    real_time& removed_mtime,
                                    list<rgw_obj_index_key> *remove_objs,
                                    uint16_t bilog_flags,
-                                   rgw_zone_set *zones_trace)
+                                   rgw_zone_set *zones_trace,
+                                   IndexCompleteBatch *batch)
 {
   rgw_bucket_dir_entry ent;
   ent.meta.mtime = removed_mtime;
   obj.key.get_index_key(&ent.key);
-  return cls_obj_complete_op(bs, obj, CLS_RGW_OP_DEL, tag, pool, epoch, ent, RGW_OBJ_CATEGORY_NONE, remove_objs, bilog_flags, zones_trace);
+  return cls_obj_complete_op(bs, obj, CLS_RGW_OP_DEL, tag, pool, epoch, ent, RGW_OBJ_CATEGORY_NONE, remove_objs, bilog_flags, zones_trace,
+                             batch);
 }
 
 int RGWRados::cls_obj_complete_cancel(BucketShard& bs, string& tag, rgw_obj& obj, uint16_t bilog_flags, rgw_zone_set *zones_trace)
@@ -12673,6 +12962,126 @@ int RGWRados::cls_obj_complete_cancel(BucketShard& bs, string& tag, rgw_obj& obj
   return cls_obj_complete_op(bs, obj, CLS_RGW_OP_CANCEL, tag, -1 /* pool id */, 0, ent, RGW_OBJ_CATEGORY_NONE, NULL, bilog_flags, zones_trace);
 }
 
+RGWRados::IndexCompleteBatch::IndexCompleteBatch(RGWRados *_store,
+                                                 const RGWBucketInfo& bucket_info)
+  : store(_store), datasync(bucket_info.datasync_flag_enabled()),
+    lock("RGWRados::IndexCompleteBatch::lock"),
+    max_ops(_store->ctx()->_conf->rgw_index_complete_batch_size)
+{
+}
+
+int RGWRados::IndexCompleteBatch::add(BucketShard& bs, const rgw_obj& obj,
+                                      rgw_cls_obj_complete_op&& op)
+{
+  Mutex::Locker l(lock);
+  auto iter = shards.find(bs.bucket_obj);
+  if (iter == shards.end()) {
+    iter = shards.emplace(bs.bucket_obj, ShardOps(bs)).first;
+  }
+  ShardOps& shard = iter->second;
+  /* a failed send is reported through result(), not against this op */
+  if (shard.keys.count(op.key)) {
+    /* the index can't see an update to the same key within one call */
+    send(shard);
+  }
+  shard.keys.insert(op.key);
+  shard.objs.push_back(obj);
+  shard.ops.push_back(std::move(op));
+  if (shard.ops.size() >= max_ops) {
+    send(shard);
+  }
+  return 0;
+}
+
+int RGWRados::IndexCompleteBatch::flush()
+{
+  Mutex::Locker l(lock);
+  int ret = 0;
+  for (auto& i : shards) {
+    int r = send(i.second);
+    if (r < 0 && ret == 0) {
+      ret = r;
+    }
+  }
+  shards.clear();
+  return ret;
+}
+
+int RGWRados::IndexCompleteBatch::result(const rgw_obj& obj)
+{
+  Mutex::Locker l(lock);
+  auto iter = errors.find(obj);
+  return (iter == errors.end() ? 0 : iter->second);
+}
+
+int RGWRados::IndexCompleteBatch::send(ShardOps& shard)
+{
+  if (shard.ops.empty()) {
+    return 0;
+  }
+  list<rgw_obj> objs;
+  list<rgw_cls_obj_complete_op> ops;
+  objs.swap(shard.objs);
+  ops.swap(shard.ops);
+  shard.keys.clear();
+
+  CephContext *cct = store->ctx();
+  ldout(cct, 20) << __func__ << "(): completing " << ops.size()
+                 << " index ops on " << shard.bs.bucket_obj << dendl;
+
+  ObjectWriteOperation o;
+  cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
+  cls_rgw_bucket_complete_ops(o, ops);
+  int r = shard.bs.index_ctx.operate(shard.bs.bucket_obj, &o);
+  if (r != -ERR_BUSY_RESHARDING) {
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: " << __func__ << "(): bucket index completion failed, oid="
+                    << shard.bs.bucket_obj << " r=" << r << dendl;
+      for (auto& obj : objs) {
+        errors[obj] = r;
+      }
+    } else if (datasync) {
+      int ret = store->data_log->add_entry(shard.bs.bucket, shard.bs.shard_id);
+      if (ret < 0) {
+        lderr(cct) << "ERROR: failed writing data log" << dendl;
+      }
+    }
+    return r;
+  }
+
+  /* the keys may now map to other shards; complete them one at a time */
+  int ret = 0;
+  auto obj_iter = objs.begin();
+  for (auto& op : ops) {
+    const rgw_obj& obj = *obj_iter++;
+    BucketShard bs(store);
+    r = bs.init(obj.bucket, obj);
+    if (r >= 0) {
+      r = store->guard_reshard(&bs, obj, [&](BucketShard *bs) -> int {
+          librados::ObjectWriteOperation o;
+          cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
+          cls_rgw_bucket_complete_op(o, op.op, op.tag, op.ver, op.key, op.meta, &op.remove_objs,
+                                     op.log_op, op.bilog_flags, &op.zones_trace);
+          return bs->index_ctx.operate(bs->bucket_obj, &o);
+        });
+    }
+    if (r < 0) {
+      ldout(cct, 0) << "ERROR: " << __func__ << "(): bucket index completion failed, obj="
+                    << obj << " r=" << r << dendl;
+      errors[obj] = r;
+      if (ret == 0) {
+        ret = r;
+      }
+    } else if (datasync) {
+      r = store->data_log->add_entry(bs.bucket, bs.shard_id);
+      if (r < 0) {
+        lderr(cct) << "ERROR: failed writing data log" << dendl;
+      }
+    }
+  }
+  return ret;
+}
+
 int RGWRados::cls_obj_set_bucket_tag_timeout(RGWBucketInfo& bucket_info, uint64_t timeout)
 {
   librados::IoCtx index_ctx;
@@ -12687,7 +13096,8 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(RGWBucketInfo& bucket_info, uint64_
 int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_index_key& start, const string& prefix,
 		              uint32_t num_entries, bool list_versions, map<string, rgw_bucket_dir_entry>& m,
 			      bool *is_truncated, rgw_obj_index_key *last_entry,
-			      bool (*force_check_filter)(const string&  name))
+			      bool (*force_check_filter)(const string&  name),
+			      const string& delimiter)
 {
   ldout(cct, 10) << "cls_bucket_list " << bucket_info.bucket << " start " << start.name << "[" << start.instance << "] num_entries " << num_entries << dendl;
 
@@ -12700,23 +13110,69 @@ int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_
   if (r < 0)
     return r;
 
+  // Rather than asking every shard for num_entries, ask each one for a
+  // window of roughly its share and only go back to a shard once all of
+  // its entries have been merged
+  uint32_t shard_entries = num_entries;
+  if (oids.size() > 1) {
+    shard_entries = num_entries / oids.size() + 1;
+    shard_entries = std::max<uint32_t>(shard_entries, cct->_conf->rgw_bucket_list_min_shard_entries);
+    shard_entries = std::min(shard_entries, num_entries);
+  }
+
   cls_rgw_obj_key start_key(start.name, start.instance);
-  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries, list_versions,
-                            oids, list_results, cct->_conf->rgw_bucket_index_max_aio)();
+  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, shard_entries, list_versions,
+                            oids, list_results, cct->_conf->rgw_bucket_index_max_aio,
+                            delimiter)();
   if (r < 0)
     return r;
 
   // Create a list of iterators that are used to iterate each shard
-  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents(list_results.size());
-  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends(list_results.size());
-  vector<string> vnames(list_results.size());
-  map<int, struct rgw_cls_list_ret>::iterator iter = list_results.begin();
-  *is_truncated = false;
-  for (; iter != list_results.end(); ++iter) {
+  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents;
+  vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends;
+  vector<map<int, struct rgw_cls_list_ret>::iterator> vresults;
+  vector<cls_rgw_obj_key> vlast_keys;
+  vcurrents.reserve(list_results.size());
+  vends.reserve(list_results.size());
+  vresults.reserve(list_results.size());
+  vlast_keys.reserve(list_results.size());
+  for (auto iter = list_results.begin(); iter != list_results.end(); ++iter) {
     vcurrents.push_back(iter->second.dir.m.begin());
     vends.push_back(iter->second.dir.m.end());
-    vnames.push_back(oids[iter->first]);
-    *is_truncated = (*is_truncated || iter->second.is_truncated);
+    vresults.push_back(iter);
+    vlast_keys.push_back(start_key);
+  }
+
+  // Fetch the next window of a shard whose entries have all been consumed,
+  // continuing after the last entry we saw from it
+  auto refill = [&](size_t pos) -> int {
+    while (vcurrents[pos] == vends[pos] && vresults[pos]->second.is_truncated) {
+      int shard = vresults[pos]->first;
+      map<int, string> shard_oids;
+      shard_oids[shard] = oids[shard];
+      map<int, struct rgw_cls_list_ret> shard_results;
+      int ret = CLSRGWIssueBucketList(index_ctx, vlast_keys[pos], prefix, shard_entries,
+                                      list_versions, shard_oids, shard_results, 1,
+                                      delimiter)();
+      if (ret < 0)
+        return ret;
+
+      ldout(cct, 20) << "cls_bucket_list: refilled shard " << shard << " after "
+                     << vlast_keys[pos].name << "[" << vlast_keys[pos].instance << "] got "
+                     << shard_results[shard].dir.m.size() << " entries" << dendl;
+      vresults[pos]->second = std::move(shard_results[shard]);
+      vcurrents[pos] = vresults[pos]->second.dir.m.begin();
+      vends[pos] = vresults[pos]->second.dir.m.end();
+      if (vcurrents[pos] == vends[pos])
+        break;
+    }
+    return 0;
+  };
+
+  for (size_t i = 0; i < vcurrents.size(); ++i) {
+    r = refill(i);
+    if (r < 0)
+      return r;
   }
 
   // Create a map to track the next candidate entry from each shard, if the entry
@@ -12737,6 +13193,7 @@ int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_
     int pos = candidates.begin()->second;
     const string& name = vcurrents[pos]->first;
     struct rgw_bucket_dir_entry& dirent = vcurrents[pos]->second;
+    vlast_keys[pos] = dirent.key;
 
     bool force_check = force_check_filter && force_check_filter(dirent.key.name);
     if ((!dirent.exists && !dirent.is_delete_marker()) || !dirent.pending_map.empty() || force_check) {
@@ -12744,7 +13201,7 @@ int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_
        * and if the tags are old we need to do cleanup as well. */
       librados::IoCtx sub_ctx;
       sub_ctx.dup(index_ctx);
-      r = check_disk_state(sub_ctx, bucket_info, dirent, dirent, updates[vnames[pos]]);
+      r = check_disk_state(sub_ctx, bucket_info, dirent, dirent, updates[oids[vresults[pos]->first]]);
       if (r < 0 && r != -ENOENT) {
           return r;
       }
@@ -12758,6 +13215,11 @@ int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_
     // Refresh the candidates map
     candidates.erase(candidates.begin());
     ++vcurrents[pos];
+    if (vcurrents[pos] == vends[pos] && count < num_entries) {
+      r = refill(pos);
+      if (r < 0)
+        return r;
+    }
     if (vcurrents[pos] != vends[pos]) {
       candidates[vcurrents[pos]->first] = pos;
     }
@@ -12776,9 +13238,11 @@ int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_
     }
   }
 
-  // Check if all the returned entries are consumed or not
+  // Check if all the returned entries are consumed or not, and whether
+  // any shard has more to give
+  *is_truncated = false;
   for (size_t i = 0; i < vcurrents.size(); ++i) {
-    if (vcurrents[i] != vends[i])
+    if (vcurrents[i] != vends[i] || vresults[i]->second.is_truncated)
       *is_truncated = true;
   }
   if (!m.empty())
@@ -12787,6 +13251,96 @@ int RGWRados::cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_
   return 0;
 }
 
+int RGWRados::cls_bucket_list_unordered(RGWBucketInfo& bucket_info, int shard_id,
+                                        rgw_obj_index_key& start, const string& prefix,
+                                        uint32_t num_entries, bool list_versions,
+                                        vector<rgw_bucket_dir_entry>& ent_list,
+                                        bool *is_truncated, rgw_obj_index_key *last_entry,
+                                        bool (*force_check_filter)(const string&  name))
+{
+  ldout(cct, 10) << "cls_bucket_list_unordered " << bucket_info.bucket << " start " << start.name << "[" << start.instance << "] num_entries " << num_entries << dendl;
+
+  librados::IoCtx index_ctx;
+  map<int, string> oids;
+  int r = open_bucket_index(bucket_info, index_ctx, oids, shard_id);
+  if (r < 0)
+    return r;
+
+  // Walk the shards one after the other; an object's entries always live
+  // in the shard the write path hashed it to, so that is where the
+  // previous page stopped
+  map<int, string>::iterator iter = oids.begin();
+  if (oids.size() > 1 && !start.name.empty()) {
+    int marker_shard;
+    r = get_target_shard_id(bucket_info, get_index_hash_source(start),
+                            &marker_shard);
+    if (r < 0)
+      return r;
+    iter = oids.find(marker_shard);
+    if (iter == oids.end())
+      return -EINVAL;
+  }
+
+  cls_rgw_obj_key start_key(start.name, start.instance);
+  map<string, bufferlist> updates;
+  uint32_t count = 0;
+  bool shard_truncated = false;
+  while (iter != oids.end() && count < num_entries) {
+    map<int, string> shard_oids;
+    shard_oids[iter->first] = iter->second;
+    map<int, struct rgw_cls_list_ret> shard_results;
+    r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries - count,
+                              list_versions, shard_oids, shard_results, 1)();
+    if (r < 0)
+      return r;
+
+    struct rgw_cls_list_ret& result = shard_results[iter->first];
+    for (auto& entry : result.dir.m) {
+      r = 0;
+      struct rgw_bucket_dir_entry& dirent = entry.second;
+      start_key = dirent.key;
+
+      bool force_check = force_check_filter && force_check_filter(dirent.key.name);
+      if ((!dirent.exists && !dirent.is_delete_marker()) || !dirent.pending_map.empty() || force_check) {
+        librados::IoCtx sub_ctx;
+        sub_ctx.dup(index_ctx);
+        r = check_disk_state(sub_ctx, bucket_info, dirent, dirent, updates[iter->second]);
+        if (r < 0 && r != -ENOENT) {
+          return r;
+        }
+      }
+      if (r >= 0) {
+        ldout(cct, 10) << "RGWRados::cls_bucket_list_unordered: got " << dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
+        *last_entry = dirent.key;
+        ent_list.emplace_back(std::move(dirent));
+        ++count;
+      }
+    }
+
+    shard_truncated = result.is_truncated && !result.dir.m.empty();
+    if (!shard_truncated) {
+      // on to the next shard, from its beginning
+      ++iter;
+      start_key = cls_rgw_obj_key();
+    }
+  }
+
+  map<string, bufferlist>::iterator miter = updates.begin();
+  for (; miter != updates.end(); ++miter) {
+    if (miter->second.length()) {
+      ObjectWriteOperation o;
+      cls_rgw_suggest_changes(o, miter->second);
+      AioCompletion *c = librados::Rados::aio_create_completion(NULL, NULL, NULL);
+      index_ctx.aio_operate(miter->first, c, &o);
+      c->release();
+    }
+  }
+
+  *is_truncated = (iter != oids.end());
+
+  return 0;
+}
+
 int RGWRados::cls_obj_usage_log_add(const string& oid, rgw_usage_log_info& info)
 {
   rgw_raw_obj obj(get_zone_params().usage_log_pool, oid);
@@ -13350,6 +13904,20 @@ int RGWRados::get_target_shard_id(const RGWBucketInfo& bucket_info, const string
   return r;
 }
 
+string RGWRados::get_index_hash_source(const rgw_obj_index_key& index_key)
+{
+  rgw_obj_key key(index_key);  // strips the namespace from the index name
+  if (key.ns == RGW_OBJ_NS_MULTIPART) {
+    // upload meta and parts are hashed by the object being uploaded (they
+    // get its name as index_hash_source), so they sit next to its head
+    RGWMPObj mp;
+    if (mp.from_meta(key.name)) {
+      return mp.get_key();
+    }
+  }
+  return key.name;
+}
+
 void RGWRados::get_bucket_index_object(const string& bucket_oid_base, uint32_t num_shards,
                                       int shard_id, string *bucket_obj)
 {
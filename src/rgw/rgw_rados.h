@@ -14,6 +14,7 @@
 #include "common/lru_map.h"
 #include "rgw_common.h"
 #include "cls/rgw/cls_rgw_types.h"
+#include "cls/rgw/cls_rgw_ops.h"
 #include "cls/version/cls_version_types.h"
 #include "cls/log/cls_log_types.h"
 #include "cls/statelog/cls_statelog_types.h"
@@ -2683,6 +2684,44 @@ public:
     int init(const rgw_bucket& _bucket, int sid);
   };
 
+  /*
+   * Gathers the bucket index completions of many operations (bulk deletes,
+   * lifecycle expiration), so that those landing on the same index shard
+   * go out as a single osd op.  Pending completions are sent when a shard
+   * fills up, when a key would repeat within a shard, and on flush().  The
+   * data log entry for a shard is added once its completions have landed.
+   * A failed send is recorded against each of its objects, see result().
+   */
+  class IndexCompleteBatch {
+    struct ShardOps {
+      BucketShard bs;
+      list<rgw_obj> objs;
+      list<rgw_cls_obj_complete_op> ops;
+      set<cls_rgw_obj_key> keys;
+
+      explicit ShardOps(const BucketShard& _bs) : bs(_bs) {}
+    };
+
+    RGWRados *store;
+    bool datasync;
+    Mutex lock;
+    map<string, ShardOps> shards; /* by index shard object */
+    map<rgw_obj, int> errors;
+    uint64_t max_ops;
+
+    int send(ShardOps& shard);
+  public:
+    IndexCompleteBatch(RGWRados *_store, const RGWBucketInfo& bucket_info);
+    ~IndexCompleteBatch() {
+      flush();
+    }
+
+    int add(BucketShard& bs, const rgw_obj& obj, rgw_cls_obj_complete_op&& op);
+    int flush();
+    /* the error the completion for obj failed with once sent, or 0 */
+    int result(const rgw_obj& obj);
+  };
+
   class Object {
     RGWRados *store;
     RGWBucketInfo bucket_info;
@@ -2831,8 +2870,9 @@ public:
         ceph::real_time mtime; /* for setting delete marker mtime */
         bool high_precision_time;
         rgw_zone_set *zones_trace;
+        IndexCompleteBatch *index_batch; /* defer the index completion to this batch */
 
-        DeleteParams() : versioning_status(0), olh_epoch(0), bilog_flags(0), remove_objs(NULL), high_precision_time(false), zones_trace(nullptr) {}
+        DeleteParams() : versioning_status(0), olh_epoch(0), bilog_flags(0), remove_objs(NULL), high_precision_time(false), zones_trace(nullptr), index_batch(nullptr) {}
       } params;
 
       struct DeleteResult {
@@ -2910,6 +2950,9 @@ public:
       bool blind;
       bool prepared{false};
       rgw_zone_set *zones_trace{nullptr};
+      IndexCompleteBatch *complete_batch{nullptr};
+      librados::AioCompletion *prepare_completion{nullptr};
+      RGWModifyOp prepare_op{CLS_RGW_OP_UNKNOWN};
 
       int init_bs() {
         int r = bs.init(target->get_bucket(), obj);
@@ -2931,6 +2974,12 @@ public:
                                                               bs(target->get_store()) {
                                                                 blind = (target->get_bucket_info().index_type == RGWBIType_Indexless);
                                                               }
+      ~UpdateIndex() {
+        if (prepare_completion) {
+          prepare_completion->wait_for_safe();
+          prepare_completion->release();
+        }
+      }
 
       int get_bucket_shard(BucketShard **pbs) {
         if (!bs_initialized) {
@@ -2951,7 +3000,15 @@ public:
         zones_trace = _zones_trace;
       }
 
+      void set_complete_batch(IndexCompleteBatch *batch) {
+        complete_batch = batch;
+      }
+
       int prepare(RGWModifyOp, const string *write_tag);
+      /* like prepare(), but don't wait for the index shard; wait_prepare()
+       * must be called before the entry can be completed */
+      int prepare_async(RGWModifyOp, const string *write_tag);
+      int wait_prepare();
       int complete(int64_t poolid, uint64_t epoch, uint64_t size,
                    uint64_t accounted_size, ceph::real_time& ut,
                    const string& etag, const string& content_type,
@@ -2980,10 +3037,15 @@ public:
         bool enforce_ns;
         RGWAccessListFilter *filter;
         bool list_versions;
+        bool allow_unordered;
 
-        Params() : enforce_ns(true), filter(NULL), list_versions(false) {}
+        Params() : enforce_ns(true), filter(NULL), list_versions(false),
+                   allow_unordered(false) {}
       } params;
 
+    private:
+      int list_objects_unordered(int64_t max, vector<rgw_bucket_dir_entry> *result, bool *is_truncated);
+
     public:
       explicit List(RGWRados::Bucket *_target) : target(_target) {}
 
@@ -3195,7 +3257,8 @@ public:
                          int versioning_status,
                          uint16_t bilog_flags = 0,
                          const ceph::real_time& expiration_time = ceph::real_time(),
-                         rgw_zone_set *zones_trace = nullptr);
+                         rgw_zone_set *zones_trace = nullptr,
+                         IndexCompleteBatch *index_batch = nullptr);
 
   /** Delete a raw object.*/
   int delete_raw_obj(const rgw_raw_obj& obj);
@@ -3389,18 +3452,28 @@ public:
 
   int cls_rgw_init_index(librados::IoCtx& io_ctx, librados::ObjectWriteOperation& op, string& oid);
   int cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag, rgw_obj& obj, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr);
+  int cls_obj_prepare_op_async(BucketShard& bs, RGWModifyOp op, string& tag, rgw_obj& obj, uint16_t bilog_flags,
+                               rgw_zone_set *zones_trace, librados::AioCompletion *c);
   int cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModifyOp op, string& tag, int64_t pool, uint64_t epoch,
-                          rgw_bucket_dir_entry& ent, RGWObjCategory category, list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr);
+                          rgw_bucket_dir_entry& ent, RGWObjCategory category, list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr,
+                          IndexCompleteBatch *batch = nullptr);
   int cls_obj_complete_add(BucketShard& bs, const rgw_obj& obj, string& tag, int64_t pool, uint64_t epoch, rgw_bucket_dir_entry& ent,
                            RGWObjCategory category, list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr);
   int cls_obj_complete_del(BucketShard& bs, string& tag, int64_t pool, uint64_t epoch, rgw_obj& obj,
-                           ceph::real_time& removed_mtime, list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr);
+                           ceph::real_time& removed_mtime, list<rgw_obj_index_key> *remove_objs, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr,
+                           IndexCompleteBatch *batch = nullptr);
   int cls_obj_complete_cancel(BucketShard& bs, string& tag, rgw_obj& obj, uint16_t bilog_flags, rgw_zone_set *zones_trace = nullptr);
   int cls_obj_set_bucket_tag_timeout(RGWBucketInfo& bucket_info, uint64_t timeout);
   int cls_bucket_list(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_index_key& start, const string& prefix,
                       uint32_t num_entries, bool list_versions, map<string, rgw_bucket_dir_entry>& m,
                       bool *is_truncated, rgw_obj_index_key *last_entry,
-                      bool (*force_check_filter)(const string&  name) = NULL);
+                      bool (*force_check_filter)(const string&  name) = NULL,
+                      const string& delimiter = string());
+  int cls_bucket_list_unordered(RGWBucketInfo& bucket_info, int shard_id, rgw_obj_index_key& start,
+                                const string& prefix, uint32_t num_entries, bool list_versions,
+                                vector<rgw_bucket_dir_entry>& ent_list,
+                                bool *is_truncated, rgw_obj_index_key *last_entry,
+                                bool (*force_check_filter)(const string&  name) = NULL);
   int cls_bucket_head(const RGWBucketInfo& bucket_info, int shard_id, map<string, struct rgw_bucket_dir_header>& headers, map<int, string> *bucket_instance_ids = NULL);
   int cls_bucket_head_async(const RGWBucketInfo& bucket_info, int shard_id, RGWGetDirHeader_CB *ctx, int *num_aio);
   int list_bi_log_entries(RGWBucketInfo& bucket_info, int shard_id, string& marker, uint32_t max, std::list<rgw_bi_log_entry>& result, bool *truncated);
@@ -3429,7 +3502,10 @@ public:
   void shard_name(const string& prefix, unsigned max_shards, const string& key, string& name, int *shard_id);
   void shard_name(const string& prefix, unsigned max_shards, const string& section, const string& key, string& name);
   void shard_name(const string& prefix, unsigned shard_id, string& name);
-  int get_target_shard_id(const RGWBucketInfo& bucket_info, const string& obj_key, int *shard_id);
+  static int get_target_shard_id(const RGWBucketInfo& bucket_info, const string& obj_key, int *shard_id);
+  /// the name an index entry was sharded by, i.e. rgw_obj::get_hash_object()
+  /// of the object the write path built it for
+  static string get_index_hash_source(const rgw_obj_index_key& index_key);
   void time_log_prepare_entry(cls_log_entry& entry, const ceph::real_time& ut, const string& section, const string& key, bufferlist& bl);
   int time_log_add_init(librados::IoCtx& io_ctx);
   int time_log_add(const string& oid, list<cls_log_entry>& entries,
@@ -3748,6 +3824,10 @@ protected:
   RGWBucketInfo bucket_info;
   bool canceled;
 
+  /* writes that had to wait for the in-flight window to drain */
+  uint64_t stalls{0};
+  ceph::timespan stall_time{ceph::timespan::zero()};
+
   virtual int do_complete(size_t accounted_size, const string& etag,
                           ceph::real_time *mtime, ceph::real_time set_mtime,
                           map<string, bufferlist>& attrs, ceph::real_time delete_at,
@@ -3775,6 +3855,9 @@ public:
   CephContext *ctx();
 
   bool is_canceled() { return canceled; }
+
+  uint64_t get_stalls() const { return stalls; }
+  ceph::timespan get_stall_time() const { return stall_time; }
 }; /* RGWPutObjProcessor */
 
 struct put_obj_aio_info {
@@ -60,11 +60,12 @@ struct RGWLoadGenRequest : public RGWRequest {
 	string resource;
 	int content_length;
 	std::atomic<bool>* fail_flag = nullptr;
+	int op; /* RGWLoadGenStats op, or -1 if not measured */
 
 RGWLoadGenRequest(uint64_t req_id, const string& _m, const  string& _r, int _cl,
-		std::atomic<bool> *ff)
+		std::atomic<bool> *ff, int _op = -1)
 	: RGWRequest(req_id), method(_m), resource(_r), content_length(_cl),
-		fail_flag(ff) {}
+		fail_flag(ff), op(_op) {}
 };
 
 #endif /* RGW_REQUEST_H */
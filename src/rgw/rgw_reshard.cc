@@ -22,6 +22,7 @@ using namespace std;
 
 #define RESHARD_SHARD_WINDOW 64
 #define RESHARD_MAX_AIO 128
+#define RESHARD_MAX_CATCHUP_PASSES 5
 
 class BucketReshardShard {
   RGWRados *store;
@@ -293,6 +294,186 @@ int RGWBucketReshard::create_new_bucket_instance(int new_num_shards,
   return ::create_new_bucket_instance(store, new_num_shards, bucket_info, bucket_attrs, new_bucket_info);
 }
 
+int RGWBucketReshard::get_bilog_markers(map<int, string> *markers)
+{
+  librados::IoCtx index_ctx;
+  map<int, string> bucket_objs;
+  int ret = store->open_bucket_index(bucket_info, index_ctx, bucket_objs);
+  if (ret < 0) {
+    return ret;
+  }
+
+  map<int, struct rgw_cls_list_ret> headers;
+  ret = CLSRGWIssueGetDirHeader(index_ctx, bucket_objs, headers,
+                                store->ctx()->_conf->rgw_bucket_index_max_aio)();
+  if (ret < 0) {
+    return ret;
+  }
+
+  for (auto& h : headers) {
+    if (h.second.dir.header.syncstopped) {
+      /* changes to this shard are not being logged */
+      return -ENOTSUP;
+    }
+    (*markers)[h.first] = h.second.dir.header.max_marker;
+  }
+
+  return 0;
+}
+
+/*
+ * Bring the target index entry for object 'name' in line with the source
+ * shard.  Whatever we copied before is dropped through dir_suggest_changes
+ * (which takes its stats back out of the target header), then the current
+ * source entry, if any, is put and accounted the same way do_reshard()
+ * does.  These are separate operations as cls methods within one op don't
+ * see each other's omap updates.
+ */
+int RGWBucketReshard::copy_changed_entry(librados::IoCtx& index_ctx, const string& oid,
+                                         const RGWBucketInfo& new_bucket_info,
+                                         librados::IoCtx& new_index_ctx,
+                                         map<int, string>& new_bucket_objs,
+                                         const string& name)
+{
+  /* 'name' is the raw index key: hash the object it names, as the write path does */
+  cls_rgw_obj_key key(name);
+  int target_shard_id;
+  int ret = store->get_target_shard_id(new_bucket_info, RGWRados::get_index_hash_source(key),
+                                       &target_shard_id);
+  if (ret < 0) {
+    lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+    return ret;
+  }
+  const string& target_oid = new_bucket_objs[target_shard_id > 0 ? target_shard_id : 0];
+
+  rgw_cls_bi_entry old_entry;
+  ret = cls_rgw_bi_get(new_index_ctx, target_oid, PlainIdx, key, &old_entry);
+  if (ret < 0 && ret != -ENOENT) {
+    return ret;
+  }
+  if (ret == 0) {
+    rgw_bucket_dir_entry dirent;
+    try {
+      bufferlist::iterator iter = old_entry.data.begin();
+      ::decode(dirent, iter);
+    } catch (buffer::error& err) {
+      lderr(store->ctx()) << "ERROR: failed to decode index entry for " << name << dendl;
+      return -EIO;
+    }
+    /* make the removal take back exactly what the copy accounted */
+    dirent.pending_map.clear();
+    dirent.exists = true;
+    dirent.meta.size = 0;
+    old_entry.data.clear();
+    ::encode(dirent, old_entry.data);
+    ret = cls_rgw_bi_put(new_index_ctx, target_oid, old_entry);
+    if (ret < 0) {
+      return ret;
+    }
+
+    librados::ObjectWriteOperation op;
+    bufferlist update;
+    update.append(CEPH_RGW_REMOVE);
+    ::encode(dirent, update);
+    cls_rgw_suggest_changes(op, update);
+    ret = new_index_ctx.operate(target_oid, &op);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  rgw_cls_bi_entry entry;
+  ret = cls_rgw_bi_get(index_ctx, oid, PlainIdx, key, &entry);
+  if (ret == -ENOENT) {
+    return 0;
+  }
+  if (ret < 0) {
+    return ret;
+  }
+
+  cls_rgw_obj_key cls_key;
+  uint8_t category;
+  rgw_bucket_category_stats stats;
+  bool account = entry.get_info(&cls_key, &category, &stats);
+
+  librados::ObjectWriteOperation op;
+  cls_rgw_bi_put(op, target_oid, entry);
+  if (account) {
+    map<uint8_t, rgw_bucket_category_stats> update_stats;
+    update_stats[category] = stats;
+    cls_rgw_bucket_update_stats(op, false, update_stats);
+  }
+  return new_index_ctx.operate(target_oid, &op);
+}
+
+/*
+ * Replay the source bucket index log from 'markers' onto the new bucket
+ * instance, one entry per object that changed.  Only plain entries are
+ * handled, so anything that touches versioned objects aborts.
+ */
+int RGWBucketReshard::copy_logged_changes(const RGWBucketInfo& new_bucket_info,
+                                          const map<int, string>& markers,
+                                          int max_entries, uint64_t *num_changed)
+{
+  librados::IoCtx index_ctx;
+  map<int, string> bucket_objs;
+  int ret = store->open_bucket_index(bucket_info, index_ctx, bucket_objs);
+  if (ret < 0) {
+    return ret;
+  }
+
+  librados::IoCtx new_index_ctx;
+  map<int, string> new_bucket_objs;
+  ret = store->open_bucket_index(new_bucket_info, new_index_ctx, new_bucket_objs);
+  if (ret < 0) {
+    return ret;
+  }
+
+  *num_changed = 0;
+  for (auto& m : markers) {
+    map<int, string> shard_objs;
+    shard_objs[m.first] = bucket_objs[m.first];
+    BucketIndexShardsManager marker_mgr;
+    marker_mgr.add(m.first, m.second);
+
+    set<string> changed;
+    bool truncated = true;
+    while (truncated) {
+      map<int, struct cls_rgw_bi_log_list_ret> logs;
+      ret = CLSRGWIssueBILogList(index_ctx, marker_mgr, max_entries, shard_objs, logs, 1)();
+      if (ret < 0) {
+        return ret;
+      }
+      auto& log = logs[m.first];
+      truncated = log.truncated && !log.entries.empty();
+      for (auto& entry : log.entries) {
+        if (!entry.instance.empty() ||
+            (entry.op != CLS_RGW_OP_ADD && entry.op != CLS_RGW_OP_DEL &&
+             entry.op != CLS_RGW_OP_CANCEL)) {
+          ldout(store->ctx(), 0) << __func__ << ": can't replay bucket index log op " << (int)entry.op
+                                 << " on " << entry.object << "[" << entry.instance << "]" << dendl;
+          return -EAGAIN;
+        }
+        changed.insert(entry.object);
+        marker_mgr.add(m.first, entry.id);
+      }
+    }
+
+    for (auto& name : changed) {
+      ret = copy_changed_entry(index_ctx, shard_objs[m.first], new_bucket_info,
+                               new_index_ctx, new_bucket_objs, name);
+      if (ret < 0) {
+        lderr(store->ctx()) << "ERROR: failed to copy changed index entry " << name
+                            << ": " << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+    }
+    *num_changed += changed.size();
+  }
+
+  return 0;
+}
+
 class BucketInfoReshardUpdate
 {
   RGWRados *store;
@@ -381,6 +562,25 @@ int RGWBucketReshard::do_reshard(
     return ret;
   }
 
+  /* with rgw_reshard_online, copy the index while writes go on and only
+   * block them to replay what the bucket index log recorded meanwhile */
+  bool online = store->ctx()->_conf->rgw_reshard_online && !bucket_info.versioned();
+  map<int, string> bilog_markers;
+  if (online) {
+    ret = get_bilog_markers(&bilog_markers);
+    if (ret < 0) {
+      ldout(store->ctx(), 0) << __func__ << ": can't track index changes (ret=" << ret
+                             << "), resharding with writes blocked" << dendl;
+      online = false;
+    }
+  }
+  if (!online) {
+    ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
   int num_target_shards = (new_bucket_info.num_shards > 0 ? new_bucket_info.num_shards : 1);
 
   BucketReshardManager target_shards_mgr(store, new_bucket_info, num_target_shards);
@@ -429,9 +629,8 @@ int RGWBucketReshard::do_reshard(
 	uint8_t category;
 	rgw_bucket_category_stats stats;
 	bool account = entry.get_info(&cls_key, &category, &stats);
-	rgw_obj_key key(cls_key);
-	rgw_obj obj(new_bucket_info.bucket, key);
-	int ret = store->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
+	int ret = store->get_target_shard_id(new_bucket_info, RGWRados::get_index_hash_source(cls_key),
+					     &target_shard_id);
 	if (ret < 0) {
 	  lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
 	  return ret;
@@ -470,6 +669,44 @@ int RGWBucketReshard::do_reshard(
     return EIO;
   }
 
+  if (online) {
+    /* catch up while writes continue, as long as that keeps shrinking
+     * the set of changes */
+    uint64_t num_changed = 0;
+    for (int pass = 0; pass < RESHARD_MAX_CATCHUP_PASSES; ++pass) {
+      map<int, string> next_markers;
+      ret = get_bilog_markers(&next_markers);
+      if (ret >= 0) {
+        ret = copy_logged_changes(new_bucket_info, bilog_markers, max_entries, &num_changed);
+      }
+      if (ret < 0) {
+        lderr(store->ctx()) << "ERROR: failed to copy index changes: " << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+      bilog_markers.swap(next_markers);
+      ldout(store->ctx(), 10) << __func__ << ": catch up pass " << pass << " copied "
+                              << num_changed << " changed entries" << dendl;
+      if (num_changed < RESHARD_SHARD_WINDOW) {
+        break;
+      }
+    }
+
+    ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = copy_logged_changes(new_bucket_info, bilog_markers, max_entries, &num_changed);
+    if (ret < 0) {
+      lderr(store->ctx()) << "ERROR: failed to copy index changes: " << cpp_strerror(-ret) << dendl;
+      /* don't leave writes blocked on a reshard that isn't going anywhere */
+      clear_resharding();
+      return ret;
+    }
+    if (out) {
+      (*out) << "entries changed while copying: " << num_changed << std::endl;
+    }
+  }
+
   RGWBucketAdminOpState bucket_op;
 
   bucket_op.set_bucket_name(new_bucket_info.bucket.name);
@@ -539,12 +776,6 @@ int RGWBucketReshard::execute(int num_shards, int max_op_entries,
     }
   }
 
-  ret = set_resharding_status(new_bucket_info.bucket.bucket_id, num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
-  if (ret < 0) {
-    unlock_bucket();
-    return ret;
-  }
-
   ret = do_reshard(num_shards,
 		   new_bucket_info,
 		   max_op_entries,
@@ -30,6 +30,15 @@ class RGWBucketReshard {
   int clear_resharding();
 
   int create_new_bucket_instance(int new_num_shards, RGWBucketInfo& new_bucket_info);
+  int get_bilog_markers(std::map<int, string> *markers);
+  int copy_logged_changes(const RGWBucketInfo& new_bucket_info,
+                          const std::map<int, string>& markers,
+                          int max_entries, uint64_t *num_changed);
+  int copy_changed_entry(librados::IoCtx& index_ctx, const string& oid,
+                         const RGWBucketInfo& new_bucket_info,
+                         librados::IoCtx& new_index_ctx,
+                         std::map<int, string>& new_bucket_objs,
+                         const string& name);
   int do_reshard(int num_shards,
 		 const RGWBucketInfo& new_bucket_info,
 		 int max_entries,
@@ -355,6 +355,20 @@ void rgw_flush_formatter(struct req_state *s, Formatter *formatter)
   }
 }
 
+/* send the body in chunks as it is formatted rather than all at the end;
+ * only valid once the headers went out without a content length */
+void rgw_stream_formatter(struct req_state *s, Formatter *formatter)
+{
+  uint64_t chunk = s->cct->_conf->rgw_formatter_stream_chunk_size;
+  if (!chunk)
+    return;
+  formatter->set_stream_sink([s](bufferlist& bl) {
+      if (s->op != OP_HEAD) {
+	dump_body(s, bl);
+      }
+    }, chunk);
+}
+
 void dump_errno(int http_ret, string& out) {
   stringstream ss;
 
@@ -28,6 +28,9 @@ extern void rgw_flush_formatter_and_reset(struct req_state *s,
 extern void rgw_flush_formatter(struct req_state *s,
 				ceph::Formatter *formatter);
 
+extern void rgw_stream_formatter(struct req_state *s,
+				 ceph::Formatter *formatter);
+
 extern int rgw_rest_read_all_input(struct req_state *s, char **data, int *plen,
 				   uint64_t max_len, bool allow_chunked=true);
 
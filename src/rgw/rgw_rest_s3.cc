@@ -646,6 +646,12 @@ int RGWListBucket_ObjStore_S3::get_params()
   }
   delimiter = s->info.args.get("delimiter");
   encoding_type = s->info.args.get("encoding-type");
+  // not part of the S3 API: return keys in index order, which is much
+  // cheaper on heavily sharded buckets
+  s->info.args.get_bool("allow-unordered", &allow_unordered, false);
+  if (allow_unordered && !delimiter.empty()) {
+    return -EINVAL;
+  }
   if (s->system_request) {
     s->info.args.get_bool("objs-container", &objs_container, false);
     const char *shard_id_str = s->info.env->get("HTTP_RGWX_SHARD_ID");
@@ -762,6 +768,8 @@ void RGWListBucket_ObjStore_S3::send_response()
   if (op_ret < 0)
     return;
 
+  rgw_stream_formatter(s, s->formatter);
+
   if (list_versions) {
     send_versioned_response();
     return;
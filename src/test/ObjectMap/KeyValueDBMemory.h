@@ -22,10 +22,11 @@ public:
   int init(string _opt) override {
     return 0;
   }
-  int open(ostream &out) override {
+  int open(ostream &out, const vector<ColumnFamily>& = {}) override {
     return 0;
   }
-  int create_and_open(ostream &out) override {
+  int create_and_open(ostream &out,
+		      const vector<ColumnFamily>& = {}) override {
     return 0;
   }
 
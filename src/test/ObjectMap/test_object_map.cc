@@ -1129,3 +1129,71 @@ TEST_F(ObjectMapTest, TestIterateBug18533) {
   tester.verify_keys("foo2", std::cout);
 }
 
+
+TEST_F(ObjectMapTest, BatchReadBack) {
+  // batches are only used on v3 maps, which init() makes a new map
+  ASSERT_EQ(0, static_cast<DBObjectMap*>(db.get())->init());
+  ghobject_t hoid(hobject_t(sobject_t("foo", CEPH_NOSNAP)));
+  ghobject_t hoid2(hobject_t(sobject_t("foo2", CEPH_NOSNAP)));
+  string result;
+
+  db->begin_batch();
+  tester.set_keys(hoid, {{"a", "1"}, {"b", "2"}, {"c", "3"}});
+  tester.set_xattr(hoid, "x", "xval");
+  tester.set_header(hoid, "header");
+  tester.set_key(hoid2, "a", "other");
+  tester.remove_key(hoid, "b");
+
+  // a read inside the batch sees everything queued so far
+  ASSERT_EQ(1, tester.get_key(hoid, "a", &result));
+  ASSERT_EQ("1", result);
+  ASSERT_EQ(0, tester.get_key(hoid, "b", &result));
+  ASSERT_EQ(1, tester.get_key(hoid2, "a", &result));
+  ASSERT_EQ("other", result);
+
+  // and the batch keeps working afterwards
+  tester.set_key(hoid, "b", "4");
+  tester.remove_xattr(hoid, "x");
+  tester.set_xattr(hoid, "y", "yval");
+  ASSERT_EQ(0, db->end_batch());
+
+  ASSERT_EQ(1, tester.get_key(hoid, "a", &result));
+  ASSERT_EQ("1", result);
+  ASSERT_EQ(1, tester.get_key(hoid, "b", &result));
+  ASSERT_EQ("4", result);
+  ASSERT_EQ(1, tester.get_key(hoid, "c", &result));
+  ASSERT_EQ("3", result);
+  ASSERT_EQ(0, tester.get_xattr(hoid, "x", &result));
+  ASSERT_EQ(1, tester.get_xattr(hoid, "y", &result));
+  ASSERT_EQ("yval", result);
+  ASSERT_EQ(0, tester.get_header(hoid, &result));
+  ASSERT_EQ("header", result);
+  ASSERT_EQ(1, tester.get_key(hoid2, "a", &result));
+  ASSERT_EQ("other", result);
+}
+
+TEST_F(ObjectMapTest, BatchClone) {
+  ASSERT_EQ(0, static_cast<DBObjectMap*>(db.get())->init());
+  ghobject_t hoid(hobject_t(sobject_t("foo", CEPH_NOSNAP)));
+  ghobject_t hoid2(hobject_t(sobject_t("foo2", CEPH_NOSNAP)));
+  string result;
+
+  db->begin_batch();
+  tester.set_key(hoid, "foo", "bar");
+  tester.set_header(hoid, "header");
+  // the clone must see the queued updates of its source
+  ASSERT_EQ(0, db->clone(hoid, hoid2));
+  tester.set_key(hoid, "foo", "baz");
+  tester.set_key(hoid2, "foo2", "bar2");
+  tester.remove_key(hoid, "foo");
+  ASSERT_EQ(0, db->end_batch());
+
+  ASSERT_EQ(0, tester.get_key(hoid, "foo", &result));
+  ASSERT_EQ(0, tester.get_key(hoid, "foo2", &result));
+  ASSERT_EQ(1, tester.get_key(hoid2, "foo", &result));
+  ASSERT_EQ("bar", result);
+  ASSERT_EQ(1, tester.get_key(hoid2, "foo2", &result));
+  ASSERT_EQ("bar2", result);
+  ASSERT_EQ(0, tester.get_header(hoid2, &result));
+  ASSERT_EQ("header", result);
+}
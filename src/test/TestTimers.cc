@@ -249,6 +249,72 @@ static int safe_timer_cancellation_test(SafeTimer &safe_timer, Mutex& safe_timer
   return ret;
 }
 
+class CancelOtherContext : public Context
+{
+public:
+  CancelOtherContext(SafeTimer &timer_, Mutex &lock_, Context *other_,
+		     bool *cancelled_)
+    : timer(timer_), lock(lock_), other(other_), cancelled(cancelled_)
+  {
+  }
+
+  void finish(int r) override
+  {
+    lock.Lock();
+    *cancelled = timer.cancel_event(other);
+    lock.Unlock();
+    array_lock.Lock();
+    cout << "CancelOtherContext" << std::endl;
+    test_array[0] = 1;
+    array_lock.Unlock();
+  }
+
+private:
+  SafeTimer &timer;
+  Mutex &lock;
+  Context *other;
+  bool *cancelled;
+};
+
+static int unsafe_timer_cancel_from_callback_test(SafeTimer &timer, Mutex& timer_lock)
+{
+  cout << __PRETTY_FUNCTION__ << std::endl;
+
+  int ret = 0;
+  memset(&test_array, 0, sizeof(test_array));
+  array_idx = 0;
+
+  // both are due at once; the first one to run cancels the other
+  bool cancelled = false;
+  Context *other = new StrictOrderTestContext(1);
+  Context *canceller = new CancelOtherContext(timer, timer_lock, other,
+					      &cancelled);
+
+  timer_lock.Lock();
+  utime_t t = ceph_clock_now() + utime_t(1, 0);
+  timer.add_event_at(t, canceller);
+  timer.add_event_at(t, other);
+  timer_lock.Unlock();
+
+  sleep(4);
+
+  array_lock.Lock();
+  if (test_array[0] != 1) {
+    ret = 1;
+    cout << "error: cancelling callback did not run" << std::endl;
+  } else if (!cancelled) {
+    ret = 1;
+    cout << "error: cancel_event from a callback did not find the due event"
+	 << std::endl;
+  } else if (test_array[1] != 0) {
+    ret = 1;
+    cout << "error: cancelled event ran anyway" << std::endl;
+  }
+  array_lock.Unlock();
+
+  return ret;
+}
+
 int main(int argc, const char **argv)
 {
   vector<const char*> args;
@@ -279,6 +345,18 @@ int main(int argc, const char **argv)
   if (ret)
     goto done;
 
+  {
+    Mutex unsafe_timer_lock("unsafe_timer_lock");
+    SafeTimer unsafe_timer(g_ceph_context, unsafe_timer_lock, false);
+    unsafe_timer.init();
+    ret = unsafe_timer_cancel_from_callback_test(unsafe_timer, unsafe_timer_lock);
+    unsafe_timer_lock.Lock();
+    unsafe_timer.shutdown();
+    unsafe_timer_lock.Unlock();
+  }
+  if (ret)
+    goto done;
+
 done:
   print_status(argv[0], ret);
   return ret;
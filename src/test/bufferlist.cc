@@ -1462,6 +1462,28 @@ TEST(BufferList, BenchAlloc) {
   bench_bufferlist_alloc(4, 100000, 16);
 }
 
+void bench_bufferlist_small_append(int size, int num, int per)
+{
+  char src[64];
+  memset(src, 0, sizeof(src));
+  utime_t start = ceph_clock_now();
+  for (int i=0; i<num; ++i) {
+    bufferlist bl;
+    for (int j=0; j<per; ++j)
+      bl.append(src, size);
+    bufferlist copy(bl);
+  }
+  utime_t end = ceph_clock_now();
+  cout << num << " lists of " << per << " appends of size " << size
+       << " in " << (end - start) << std::endl;
+}
+
+TEST(BufferList, BenchSmallAppend) {
+  bench_bufferlist_small_append(64, 100000, 16);
+  bench_bufferlist_small_append(8, 100000, 64);
+  bench_bufferlist_small_append(1, 100000, 256);
+}
+
 TEST(BufferList, operator_equal) {
   //
   // list& operator= (const list& other)
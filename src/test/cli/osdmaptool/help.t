@@ -6,6 +6,8 @@
      --test-map-pgs [--pool <poolid>] [--pg_num <pg_num>] map all pgs
      --test-map-pgs-dump [--pool <poolid>] map all pgs
      --test-map-pgs-dump-all [--pool <poolid>] map all pgs to osds
+     --test-map-pgs-bench [--pool <poolid>] [--bench-iterations <n>] [--bench-threads <n>]
+                             time crush and full pg mappings [default: 5 iterations, 4 threads]
      --health                dump health checks
      --mark-up-in            mark osds up and in (but do not persist)
      --with-default-pool     include default pool when creating map
@@ -13,6 +15,8 @@
      --test-random           do random placements
      --test-map-pg <pgid>    map a pgid to osds
      --test-map-object <objectname> [--pool <poolid>] map an object to osds
+     --test-map-objects <file> [--pool <poolid>] map the objects named
+                             in <file>, one per line, to osds
      --upmap-cleanup <file>  clean up pg_upmap[_items] entries, writing
                              commands to <file> [default: - for stdout]
      --upmap <file>          calculate pg upmap entries to balance pg layout
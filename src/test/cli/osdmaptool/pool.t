@@ -28,6 +28,12 @@
   osdmaptool: assuming pool 1 (use --pool to override)
    object 'foo' \-\> 1\..* (re)
 
+  $ printf 'foo\nbar\n' > objects
+  $ osdmaptool myosdmap --test-map-objects objects --pool 1
+  osdmaptool: osdmap file 'myosdmap'
+   object 'foo' \-\> 1\..* (re)
+   object 'bar' \-\> 1\..* (re)
+
 #
 # --test-map-pgs / --pool
 #
@@ -41,6 +41,18 @@
 # if they are, it most probably means something went wrong somewhere
   $ test "$STATS_CRUSH" != "$STATS_RANDOM"
 #
+# --test-map-pgs-bench maps every pg through each path
+#
+  $ osdmaptool --mark-up-in --test-map-pgs-bench --bench-iterations 1 --bench-threads 2 "$OSD_MAP"
+  osdmaptool: osdmap file 'osdmap'
+  marking all OSDs up and in
+  benchmarking 1 iterations over 500 osds, 1 crush rules, 0 choose_args, 0 upmaps
+   pgs 8000
+   crush do_rule: 8000 mappings in .* mappings/s (re)
+   pg_to_up_acting_osds: 8000 mappings in .* mappings/s (re)
+   OSDMapMapping::update: 8000 mappings in .* mappings/s (re)
+   OSDMapMapping::start_update \(2 threads\): 8000 mappings in .* mappings/s (re)
+#
 # cleanup
 #
   $ rm -f "$CRUSH_MAP" "$OSD_MAP" "$OUT"
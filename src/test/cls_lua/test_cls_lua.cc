@@ -614,6 +614,23 @@ TEST_F(ClsLua, SyntaxError) {
   ASSERT_EQ(-EIO, clslua_exec("-"));
 }
 
+TEST_F(ClsLua, CachedScript) {
+  /* repeated calls reuse the compiled chunk but never each other's globals */
+  const string script =
+    "calls = (calls or 0) + 1 "
+    "function count(input, output) output:append(tostring(calls)) end "
+    "objclass.register(count)";
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(0, clslua_exec(script, NULL, "count"));
+    std::string out(reply_output.c_str(), reply_output.length());
+    ASSERT_EQ("1", out);
+  }
+
+  /* a script that fails to compile is never cached */
+  ASSERT_EQ(-EIO, clslua_exec("-"));
+  ASSERT_EQ(-EIO, clslua_exec("-"));
+}
+
 TEST_F(ClsLua, EmptyScript) {
   ASSERT_EQ(0, clslua_exec(""));
 }
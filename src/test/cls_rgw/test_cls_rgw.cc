@@ -177,6 +177,63 @@ TEST(cls_rgw, index_multiple_obj_writers)
   }
 }
 
+TEST(cls_rgw, index_complete_batch)
+{
+  string bucket_oid = str_int("bucket", 4);
+
+  OpMgr mgr;
+
+  ObjectWriteOperation *op = mgr.write_op();
+  cls_rgw_bucket_init(*op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  uint64_t obj_size = 1024;
+
+  /* add the objects one at a time */
+  for (int i = 0; i < NUM_OBJS; i++) {
+    string obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+
+    index_prepare(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = 0;
+    meta.size = obj_size;
+    index_complete(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj, meta);
+  }
+
+  test_stats(ioctx, bucket_oid, 0, NUM_OBJS, obj_size * NUM_OBJS);
+
+  /* remove them all in a single call, plus an op for a tag that was never
+   * prepared, which is skipped */
+  list<rgw_cls_obj_complete_op> ops;
+  for (int i = 0; i <= NUM_OBJS; i++) {
+    string obj = str_int("obj", i);
+    string tag = str_int("deltag", i);
+    string loc = str_int("loc", i);
+
+    if (i < NUM_OBJS) {
+      index_prepare(mgr, ioctx, bucket_oid, CLS_RGW_OP_DEL, tag, obj, loc);
+    }
+
+    rgw_cls_obj_complete_op complete;
+    complete.op = CLS_RGW_OP_DEL;
+    complete.key = cls_rgw_obj_key(obj, string());
+    complete.tag = tag;
+    complete.ver.pool = ioctx.get_id();
+    complete.ver.epoch = 2;
+    complete.log_op = true;
+    ops.push_back(complete);
+  }
+
+  op = mgr.write_op();
+  cls_rgw_bucket_complete_ops(*op, ops);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  test_stats(ioctx, bucket_oid, 0, 0, 0);
+}
+
 TEST(cls_rgw, index_remove_object)
 {
   string bucket_oid = str_int("bucket", 2);
@@ -375,6 +432,101 @@ TEST(cls_rgw, index_suggest)
   test_stats(ioctx, bucket_oid, 0, num_objs / 2, total_size);
 }
 
+static void index_add(OpMgr& mgr, librados::IoCtx& ioctx, string& oid, string obj, int epoch)
+{
+  string tag = "tag-" + obj;
+  string loc = "loc-" + obj;
+  index_prepare(mgr, ioctx, oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = 0;
+  meta.size = 1024;
+  index_complete(mgr, ioctx, oid, CLS_RGW_OP_ADD, tag, epoch, obj, meta);
+}
+
+static void list_delimited(librados::IoCtx& ioctx, string& oid,
+                           map<string, rgw_bucket_dir_entry> *entries)
+{
+  map<int, struct rgw_cls_list_ret> results;
+  map<int, string> oids;
+  oids[0] = oid;
+  cls_rgw_obj_key start;
+  ASSERT_EQ(0, CLSRGWIssueBucketList(ioctx, start, string(), 1000, false,
+                                     oids, results, 1, "/")());
+  ASSERT_FALSE(results[0].is_truncated);
+  for (auto& p : results[0].dir.m) {
+    (*entries)[p.second.key.name] = p.second;
+  }
+}
+
+TEST(cls_rgw, index_list_delimiter)
+{
+  string bucket_oid = str_int("bucket", 5);
+
+  OpMgr mgr;
+
+  ObjectWriteOperation *op = mgr.write_op();
+  cls_rgw_bucket_init(*op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  int epoch = 0;
+  for (int i = 0; i < 10; i++) {
+    index_add(mgr, ioctx, bucket_oid, str_int("dir/obj", i), ++epoch);
+  }
+  index_add(mgr, ioctx, bucket_oid, "top", ++epoch);
+
+  /* the whole of dir/ comes back as its first entry */
+  map<string, rgw_bucket_dir_entry> entries;
+  list_delimited(ioctx, bucket_oid, &entries);
+  ASSERT_EQ(2u, entries.size());
+  ASSERT_EQ(1u, entries.count("dir/obj-0"));
+  ASSERT_TRUE(entries["dir/obj-0"].exists);
+  ASSERT_EQ(0u, entries["dir/obj-0"].meta.size);
+  ASSERT_EQ(1u, entries.count("top"));
+  ASSERT_EQ(1024u, entries["top"].meta.size);
+}
+
+TEST(cls_rgw, index_list_delimiter_pending)
+{
+  string bucket_oid = str_int("bucket", 6);
+
+  OpMgr mgr;
+
+  ObjectWriteOperation *op = mgr.write_op();
+  cls_rgw_bucket_init(*op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  int epoch = 0;
+  for (int i = 0; i < 10; i++) {
+    index_add(mgr, ioctx, bucket_oid, str_int("dir/obj", i), ++epoch);
+  }
+
+  /* pending ops after the entry that stands for dir/: an overwrite of an
+   * existing object, and a new object that was never completed */
+  string obj = str_int("dir/obj", 5);
+  string tag = "tag-pending";
+  string loc = "loc-pending";
+  index_prepare(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+  string new_obj = "dir/obj-new";
+  index_prepare(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, new_obj, loc);
+
+  /* both are still listed in full, so the gateway can complete them */
+  map<string, rgw_bucket_dir_entry> entries;
+  list_delimited(ioctx, bucket_oid, &entries);
+  ASSERT_EQ(3u, entries.size());
+  ASSERT_EQ(1u, entries.count("dir/obj-0"));
+  ASSERT_TRUE(entries["dir/obj-0"].pending_map.empty());
+
+  ASSERT_EQ(1u, entries.count(obj));
+  ASSERT_EQ(1u, entries[obj].pending_map.size());
+  ASSERT_TRUE(entries[obj].exists);
+  ASSERT_EQ(1024u, entries[obj].meta.size);
+
+  ASSERT_EQ(1u, entries.count(new_obj));
+  ASSERT_EQ(1u, entries[new_obj].pending_map.size());
+  ASSERT_FALSE(entries[new_obj].exists);
+}
+
 /* test garbage collection */
 static void create_obj(cls_rgw_obj& obj, int i, int j)
 {
@@ -35,6 +35,7 @@
 #include <mutex>
 #include <list>
 #include <random>
+#include <vector>
 
 class ThrottleTest : public ::testing::Test {
 protected:
@@ -213,6 +214,38 @@ TEST_F(ThrottleTest, wait) {
   } while(!waited);
 }
 
+TEST_F(ThrottleTest, concurrent) {
+  // mix lockless and blocking gets; nobody may ever see more than max
+  // taken, and every waiter must be woken
+  const int64_t throttle_max = 8;
+  Throttle throttle(g_ceph_context, "throttle", throttle_max);
+  std::atomic<int64_t> held = { 0 };
+  std::atomic<bool> over = { false };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i]() {
+	for (int j = 0; j < 10000; ++j) {
+	  int64_t c = 1 + (i + j) % 3;
+	  if (j % 2) {
+	    throttle.get(c);
+	  } else if (!throttle.get_or_fail(c)) {
+	    continue;
+	  }
+	  if ((held += c) > throttle_max)
+	    over = true;
+	  held -= c;
+	  throttle.put(c);
+	}
+      });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  ASSERT_FALSE(over);
+  ASSERT_EQ(throttle.get_current(), 0);
+}
+
 TEST_F(ThrottleTest, destructor) {
   EXPECT_DEATH({
       int64_t throttle_max = 10;
@@ -359,3 +359,59 @@ TEST(Crc32c, zeros_performance) {
 
 }
 
+TEST(Crc32c, Multi) {
+  int len = 1024 * 1024;
+  unsigned char *a = (unsigned char *)malloc(len);
+  for (int i = 0; i < len; i++)
+    a[i] = rand();
+  uint32_t out[64];
+  for (unsigned length : {1, 7, 8, 13, 64, 512, 4095, 4096, 16384}) {
+    for (unsigned count = 1; count <= 64; count += 3) {
+      if (length * count > (unsigned)len)
+	continue;
+      for (uint32_t crc : {0u, 0xffffffffu, 1234u}) {
+	ceph_crc32c_multi(crc, a + 1, length, count, out);
+	for (unsigned i = 0; i < count; ++i) {
+	  ASSERT_EQ(ceph_crc32c(crc, a + 1 + i * length, length), out[i]);
+	}
+	ceph_crc32c_multi(crc, nullptr, length, count, out);
+	for (unsigned i = 0; i < count; ++i) {
+	  ASSERT_EQ(ceph_crc32c(crc, nullptr, length), out[i]);
+	}
+      }
+    }
+  }
+  free(a);
+}
+
+TEST(Crc32c, MultiPerformance) {
+  int len = 256 * 1024 * 1024;
+  unsigned char *a = (unsigned char *)malloc(len);
+  for (int i = 0; i < len; i++)
+    a[i] = i & 0xff;
+  uint32_t out[64];
+
+  for (unsigned block : {512, 4096, 65536}) {
+    unsigned per = 64;
+    unsigned nblocks = len / block;
+    utime_t start = ceph_clock_now();
+    for (unsigned b = 0; b < nblocks; ++b) {
+      out[b % per] = ceph_crc32c(-1, a + (size_t)b * block, block);
+    }
+    utime_t end = ceph_clock_now();
+    float rate = (float)len / (float)(1024*1024) / (float)(end - start);
+    std::cout << "block " << block << " one at a time = " << rate
+	      << " MB/sec" << std::endl;
+
+    start = ceph_clock_now();
+    for (unsigned b = 0; b < nblocks; b += per) {
+      ceph_crc32c_multi(-1, a + (size_t)b * block, block,
+			std::min(per, nblocks - b), out);
+    }
+    end = ceph_clock_now();
+    rate = (float)len / (float)(1024*1024) / (float)(end - start);
+    std::cout << "block " << block << " multi = " << rate
+	      << " MB/sec" << std::endl;
+  }
+  free(a);
+}
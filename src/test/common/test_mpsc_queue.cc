@@ -0,0 +1,72 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+#include "common/MPSCQueue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(MPSCQueue, empty) {
+  MPSCQueue<int> q;
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(0u, q.drain([](int&&) { ADD_FAILURE(); }));
+}
+
+TEST(MPSCQueue, fifo) {
+  MPSCQueue<int> q;
+  EXPECT_TRUE(q.push(0));
+  for (int i = 1; i < 100; ++i) {
+    EXPECT_FALSE(q.push(i));
+  }
+  EXPECT_FALSE(q.empty());
+  int next = 0;
+  EXPECT_EQ(100u, q.drain([&](int&& i) { EXPECT_EQ(next++, i); }));
+  EXPECT_TRUE(q.empty());
+  EXPECT_TRUE(q.push(100));
+  EXPECT_EQ(1u, q.drain([&](int&& i) { EXPECT_EQ(next++, i); }));
+}
+
+TEST(MPSCQueue, move_only) {
+  MPSCQueue<std::unique_ptr<int>> q;
+  q.push(std::unique_ptr<int>(new int(42)));
+  q.push(std::unique_ptr<int>(new int(43)));
+  std::vector<int> out;
+  q.drain([&](std::unique_ptr<int>&& p) { out.push_back(*p); });
+  ASSERT_EQ(2u, out.size());
+  EXPECT_EQ(42, out[0]);
+  EXPECT_EQ(43, out[1]);
+  // anything left over is freed by the destructor
+  q.push(std::unique_ptr<int>(new int(44)));
+}
+
+TEST(MPSCQueue, per_producer_order) {
+  const int num_producers = 4;
+  const int per_producer = 10000;
+  MPSCQueue<std::pair<int,int>> q;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&q, p]() {
+      for (int i = 0; i < per_producer; ++i) {
+	q.push(std::make_pair(p, i));
+      }
+    });
+  }
+  std::vector<int> last(num_producers, -1);
+  int total = 0;
+  auto check = [&](std::pair<int,int>&& e) {
+    EXPECT_EQ(last[e.first] + 1, e.second);
+    last[e.first] = e.second;
+    ++total;
+  };
+  while (total < num_producers * per_producer) {
+    q.drain(check);
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  q.drain(check);
+  EXPECT_EQ(num_producers * per_producer, total);
+  EXPECT_TRUE(q.empty());
+}
@@ -376,6 +376,38 @@ TEST(ZlibCompressor, zlib_isal_compatibility)
 }
 #endif
 
+TEST(ZstdCompressor, dictionary)
+{
+  CompressorRef zstd = Compressor::create(g_ceph_context, "zstd");
+  ASSERT_TRUE(zstd);
+  bufferlist dict;
+  for (int i = 0; i < 64; ++i) {
+    dict.append("{\"bucket\": \"logs\", \"level\": \"info\", "
+		"\"message\": \"request completed\", \"status\": 200}\n");
+  }
+  CompressorRef dz = zstd->with_dictionary(dict);
+  ASSERT_TRUE(dz);
+  EXPECT_EQ(Compressor::COMP_ALG_ZSTD, dz->get_type());
+
+  bufferlist orig;
+  orig.append("{\"bucket\": \"logs\", \"level\": \"warn\", "
+	      "\"message\": \"request throttled\", \"status\": 503}\n");
+  bufferlist plain, primed;
+  ASSERT_EQ(0, zstd->compress(orig, plain));
+  ASSERT_EQ(0, dz->compress(orig, primed));
+  EXPECT_LT(primed.length(), plain.length());
+
+  bufferlist out;
+  ASSERT_EQ(0, dz->decompress(primed, out));
+  EXPECT_TRUE(out.contents_equal(orig));
+
+  // algorithms without dictionary support say so
+  CompressorRef snappy = Compressor::create(g_ceph_context, "snappy");
+  if (snappy) {
+    EXPECT_FALSE(snappy->with_dictionary(dict));
+  }
+}
+
 TEST(CompressionPlugin, all)
 {
   const char* env = getenv("CEPH_LIB");
@@ -75,6 +75,38 @@ TEST(AES, Encrypt) {
   delete kh;
 }
 
+TEST(AES, EncryptFirstBlock) {
+  CryptoHandler *h = g_ceph_context->get_crypto_handler(CEPH_CRYPTO_AES);
+  char secret_s[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  };
+  bufferptr secret(secret_s, sizeof(secret_s));
+  std::string error;
+  CryptoKeyHandler *kh = h->get_key_handler(secret, error);
+
+  // longer than a block, like a message signature block
+  char plaintext_s[29];
+  for (unsigned i = 0; i < sizeof(plaintext_s); i++)
+    plaintext_s[i] = i * 7;
+  bufferlist plaintext;
+  plaintext.append(plaintext_s, sizeof(plaintext_s));
+
+  bufferlist cipher;
+  ASSERT_EQ(0, kh->encrypt(plaintext, cipher, &error));
+
+  char block[CryptoKeyHandler::BLOCK_LEN];
+  int r = kh->encrypt_first_block(plaintext_s, block);
+  if (r == -EOPNOTSUPP) {
+    delete kh;
+    return;
+  }
+  ASSERT_EQ(0, r);
+  ASSERT_EQ(0, memcmp(block, cipher.c_str(), sizeof(block)));
+
+  delete kh;
+}
+
 TEST(AES, Decrypt) {
   CryptoHandler *h = g_ceph_context->get_crypto_handler(CEPH_CRYPTO_AES);
   char secret_s[] = {
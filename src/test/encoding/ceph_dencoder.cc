@@ -21,6 +21,7 @@
 #include "common/ceph_argparse.h"
 #include "common/Formatter.h"
 #include "common/errno.h"
+#include "common/ceph_time.h"
 #include "msg/Message.h"
 #include "include/assert.h"
 
@@ -72,6 +73,9 @@ void usage(ostream &out)
   out << "  count_tests         print number of generated test objects (to stdout)\n";
   out << "  select_test <n>     select generated test object as in-memory object\n";
   out << "  is_deterministic    exit w/ success if type encodes deterministically\n";
+  out << "\n";
+  out << "  bench_encode <n>    encode in-memory object n times, print ns per encode\n";
+  out << "  bench_decode <n>    decode encoded data n times, print ns per decode\n";
 }
 struct Dencoder {
   virtual ~Dencoder() {}
@@ -461,6 +465,38 @@ int main(int argc, const char **argv)
       }
       int n = atoi(*i);
       err = den->select_generated(n);
+    } else if (*i == string("bench_encode") ||
+	       *i == string("bench_decode")) {
+      if (!den) {
+	cerr << "must first select type with 'type <name>'" << std::endl;
+	exit(1);
+      }
+      bool enc = (*i == string("bench_encode"));
+      ++i;
+      if (i == args.end()) {
+	cerr << "expecting iteration count" << std::endl;
+	exit(1);
+      }
+      int n = atoi(*i);
+      if (n <= 0) {
+	cerr << "iteration count must be positive" << std::endl;
+	exit(1);
+      }
+      auto start = ceph::mono_clock::now();
+      for (int j = 0; j < n && err.empty(); ++j) {
+	if (enc) {
+	  den->encode(encbl, features | CEPH_FEATURE_RESERVED);
+	} else {
+	  err = den->decode(encbl, skip);
+	}
+      }
+      auto elapsed = ceph::mono_clock::now() - start;
+      if (err.empty()) {
+	cout << (enc ? "encode" : "decode") << " " << n << " iterations, "
+	     << encbl.length() << " bytes, "
+	     << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / n
+	     << " ns/op" << std::endl;
+      }
     } else if (*i == string("is_deterministic")) {
       if (!den) {
 	cerr << "must first select type with 'type <name>'" << std::endl;
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 
 #include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodeRegion.h"
 #include "global/global_context.h"
 #include "common/config.h"
 #include "gtest/gtest.h"
@@ -150,6 +151,69 @@ TEST(ErasureCodeTest, encode_misaligned_non_contiguous)
   }
 }
 
+TEST(ErasureCodeRegion, gf8_mul)
+{
+  using namespace ceph::ec_region;
+  EXPECT_EQ(0, gf8_mul(0, 0x53));
+  EXPECT_EQ(0x53, gf8_mul(1, 0x53));
+  EXPECT_EQ(0x1d, gf8_mul(2, 0x80));
+  for (unsigned a = 1; a < 256; a++) {
+    unsigned inverses = 0;
+    for (unsigned b = 1; b < 256; b++)
+      if (gf8_mul(a, b) == 1)
+	inverses++;
+    EXPECT_EQ(1u, inverses);
+  }
+}
+
+TEST(ErasureCodeRegion, kernels)
+{
+  using namespace ceph::ec_region;
+  const unsigned max_size = 4096 + 100;
+  const unsigned n = 5;
+  vector<string> in(n);
+  for (auto &i : in) {
+    i.resize(max_size + 8);
+    for (auto &c : i)
+      c = rand();
+  }
+  impl_t saved = get_impl();
+  // vector tails and unaligned buffers
+  const unsigned sizes[] = { 0, 1, 15, 16, 17, 63, 64, 65, 100, 4096, max_size };
+  for (int impl = IMPL_GENERIC; impl < IMPL_MAX; impl++) {
+    if (!set_impl((impl_t)impl))
+      continue;
+    for (auto size : sizes) {
+      for (unsigned offset = 0; offset < 8; offset += 3) {
+	const char *src[n];
+	for (unsigned j = 0; j < n; j++)
+	  src[j] = in[j].c_str() + offset;
+	string out(max_size + 8, 0);
+	char *dst = &out[offset];
+	xor_regions(src, n, dst, size);
+	for (unsigned i = 0; i < size; i++) {
+	  char expected = 0;
+	  for (unsigned j = 0; j < n; j++)
+	    expected ^= src[j][i];
+	  ASSERT_EQ(expected, dst[i]) << get_impl_name((impl_t)impl)
+				      << " size " << size << " at " << i;
+	}
+	string before = out;
+	gf8_mul_xor(src[0], 0xa7, dst, size);
+	for (unsigned i = 0; i < size; i++) {
+	  uint8_t expected = (uint8_t)before[offset + i] ^
+	    gf8_mul(0xa7, (uint8_t)src[0][i]);
+	  ASSERT_EQ(expected, (uint8_t)dst[i]) << get_impl_name((impl_t)impl)
+					       << " size " << size << " at " << i;
+	}
+	ASSERT_EQ(before.substr(offset + size), out.substr(offset + size));
+      }
+    }
+  }
+  EXPECT_TRUE(set_impl(saved));
+  EXPECT_FALSE(set_impl(IMPL_MAX));
+}
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
@@ -874,6 +874,65 @@ TEST_F(IsaErasureCodeTest, isa_xor_codec)
   EXPECT_EQ(5, cnt_cf);
 }
 
+TEST_F(IsaErasureCodeTest, apply_delta)
+{
+  // compare parity updated from a data delta with a full re-encode, for
+  // both matrix types and for the single parity (xor) case
+  const char *techniques[] = { "reed_sol_van", "cauchy" };
+  const char *ms[] = { "1", "3" };
+  for (unsigned t = 0; t < 2; t++) {
+    for (unsigned mi = 0; mi < 2; mi++) {
+      ErasureCodeIsaDefault Isa(tcache,
+                                t ? ErasureCodeIsaDefault::kCauchy :
+                                ErasureCodeIsaDefault::kVandermonde);
+      ErasureCodeProfile profile;
+      profile["k"] = "4";
+      profile["m"] = ms[mi];
+      profile["technique"] = techniques[t];
+      EXPECT_EQ(0, Isa.init(profile, &cerr));
+      EXPECT_TRUE(Isa.supports_parity_delta());
+      int k = Isa.get_data_chunk_count();
+      int n = Isa.get_chunk_count();
+
+      unsigned object_size = Isa.get_alignment() * k * 2;
+      bufferlist in;
+      for (unsigned i = 0; i < object_size; i++)
+        in.append((char)(i * 13 + t));
+      set<int> want_to_encode;
+      for (int i = 0; i < n; i++)
+        want_to_encode.insert(i);
+      map<int, bufferlist> encoded;
+      EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+      unsigned chunk_size = encoded[0].length();
+
+      // overwrite the head of chunks 0 and 2
+      unsigned len = chunk_size / 2;
+      bufferlist in2;
+      in2.append(in.c_str(), object_size);
+      for (unsigned i = 0; i < len; i++) {
+        in2.c_str()[i] ^= (char)(i + 1);
+        in2.c_str()[2 * chunk_size + i] ^= (char)(i + 5);
+      }
+      map<int, bufferlist> expected;
+      EXPECT_EQ(0, Isa.encode(want_to_encode, in2, &expected));
+
+      map<int, bufferptr> deltas;
+      for (int i = 0; i < k; i += 2) {
+        bufferptr old_data(encoded[i].c_str(), len);
+        bufferptr new_data(expected[i].c_str(), len);
+        Isa.encode_delta(old_data, new_data, &deltas[i]);
+      }
+      map<int, bufferptr> parity;
+      for (int i = k; i < n; i++)
+        parity[i] = bufferptr(encoded[i].c_str(), len);
+      EXPECT_EQ(0, Isa.apply_delta(deltas, parity));
+      for (int i = k; i < n; i++) {
+        EXPECT_EQ(0, memcmp(parity[i].c_str(), expected[i].c_str(), len));
+      }
+    }
+  }
+}
+
 TEST_F(IsaErasureCodeTest, create_rule)
 {
   CrushWrapper *c = new CrushWrapper;
@@ -277,6 +277,132 @@ TEST(ErasureCodeTest, encode)
   }
 }
 
+template <typename T>
+class ErasureCodeDeltaTest : public ::testing::Test {
+ public:
+};
+
+typedef ::testing::Types<
+  ErasureCodeJerasureReedSolomonVandermonde,
+  ErasureCodeJerasureReedSolomonRAID6
+> JerasureDeltaTypes;
+TYPED_TEST_CASE(ErasureCodeDeltaTest, JerasureDeltaTypes);
+
+TYPED_TEST(ErasureCodeDeltaTest, apply_delta)
+{
+  const char *ws[] = { "8", "16", "32" };
+  for (unsigned wi = 0; wi < sizeof(ws) / sizeof(ws[0]); wi++) {
+    TypeParam jerasure;
+    ErasureCodeProfile profile;
+    profile["k"] = "3";
+    profile["m"] = "2";
+    profile["w"] = ws[wi];
+    EXPECT_EQ(0, jerasure.init(profile, &cerr));
+    EXPECT_TRUE(jerasure.supports_parity_delta());
+
+    unsigned object_size = jerasure.get_alignment() * 4;
+    bufferlist in;
+    for (unsigned i = 0; i < object_size; i++)
+      in.append((char)(i * 7 + wi));
+    set<int> want_to_encode;
+    for (unsigned i = 0; i < jerasure.get_chunk_count(); i++)
+      want_to_encode.insert(i);
+    map<int, bufferlist> encoded;
+    EXPECT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+    unsigned chunk_size = encoded[0].length();
+
+    // overwrite a range in the middle of chunk 1
+    unsigned off = chunk_size / 4;
+    unsigned len = chunk_size / 2;
+    bufferlist in2;
+    in2.append(in.c_str(), object_size);
+    for (unsigned i = 0; i < len; i++)
+      in2.c_str()[chunk_size + off + i] ^= (char)(i + 1);
+    map<int, bufferlist> expected;
+    EXPECT_EQ(0, jerasure.encode(want_to_encode, in2, &expected));
+
+    bufferptr old_data(encoded[1].c_str() + off, len);
+    bufferptr new_data(expected[1].c_str() + off, len);
+    map<int, bufferptr> deltas;
+    jerasure.encode_delta(old_data, new_data, &deltas[1]);
+    EXPECT_EQ(len, deltas[1].length());
+
+    map<int, bufferptr> parity;
+    for (unsigned i = 3; i < 5; i++)
+      parity[i] = bufferptr(encoded[i].c_str() + off, len);
+    EXPECT_EQ(0, jerasure.apply_delta(deltas, parity));
+    for (unsigned i = 3; i < 5; i++) {
+      EXPECT_EQ(0, memcmp(parity[i].c_str(), expected[i].c_str() + off, len));
+    }
+
+    // data chunks may not be updated, coding chunks may not be deltas
+    map<int, bufferptr> bad = deltas;
+    bad[0] = bufferptr(len);
+    EXPECT_EQ(-EINVAL, jerasure.apply_delta(deltas, bad));
+    EXPECT_EQ(-EINVAL, jerasure.apply_delta(parity, parity));
+  }
+}
+
+TYPED_TEST(ErasureCodeDeltaTest, decode_cache)
+{
+  ErasureCodeJerasureDecodeCache cache;
+  TypeParam uncached;
+  TypeParam cached;
+  cached.decode_cache = &cache;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["w"] = "8";
+  EXPECT_EQ(0, uncached.init(profile, &cerr));
+  EXPECT_EQ(0, cached.init(profile, &cerr));
+
+  unsigned object_size = cached.get_alignment() * 4;
+  bufferlist in;
+  for (unsigned i = 0; i < object_size; i++)
+    in.append((char)(i * 13 + 1));
+  set<int> want_to_read;
+  for (unsigned i = 0; i < cached.get_chunk_count(); i++)
+    want_to_read.insert(i);
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, cached.encode(want_to_read, in, &encoded));
+
+  // every single and double erasure, twice so the second pass hits
+  for (int pass = 0; pass < 2; pass++) {
+    for (int a = 0; a < 6; a++) {
+      for (int b = a; b < 6; b++) {
+	map<int, bufferlist> chunks = encoded;
+	chunks.erase(a);
+	chunks.erase(b);
+	map<int, bufferlist> expected, decoded;
+	EXPECT_EQ(0, uncached.decode(want_to_read, chunks, &expected));
+	EXPECT_EQ(0, cached.decode(want_to_read, chunks, &decoded));
+	for (int i = 0; i < 6; i++) {
+	  EXPECT_TRUE(decoded[i].contents_equal(encoded[i]));
+	  EXPECT_TRUE(decoded[i].contents_equal(expected[i]));
+	}
+      }
+    }
+  }
+  // only patterns that need an inverted matrix are cached: two lost
+  // data chunks, or a data chunk along with the first coding chunk
+  EXPECT_EQ(6u + 4u, cache.size());
+}
+
+TEST(ErasureCodeTest, apply_delta_unsupported)
+{
+  ErasureCodeJerasureCauchyGood jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+  EXPECT_FALSE(jerasure.supports_parity_delta());
+  map<int, bufferptr> in, out;
+  in[0] = bufferptr(32);
+  out[2] = bufferptr(32);
+  EXPECT_EQ(-EOPNOTSUPP, jerasure.apply_delta(in, out));
+}
+
 TEST(ErasureCodeTest, create_rule)
 {
   CrushWrapper *c = new CrushWrapper;
@@ -32,6 +32,7 @@
 #include "include/utime.h"
 #include "erasure-code/ErasureCodePlugin.h"
 #include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodeRegion.h"
 #include "ceph_erasure_code_benchmark.h"
 
 namespace po = boost::program_options;
@@ -49,7 +50,10 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run either encode, decode, region (region xor and multiply kernels), "
+     "stripes (encode and degraded reads of many stripes of mixed sizes) or "
+     "decode-matrix (decoding setup cost, first and repeated use of each "
+     "erasure pattern)")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("erased", po::value<vector<int> >(),
@@ -59,6 +63,11 @@ int ErasureCodeBench::setup(int argc, char** argv) {
      " --erasures) at random. If set to 'exhaustive' try all combinations of erasures "
      " (i.e. k=4,m=3 with one erasure will try to recover from the erasure of "
      " the first chunk, then the second etc.)")
+    ("stripes", po::value<int>()->default_value(128),
+     "number of stripes for the stripes workload")
+    ("stripe-size", po::value<vector<int> >(),
+     "stripe size picked at random for the stripes workload (repeat for "
+     "more than one size, defaults to --size)")
     ("parameter,P", po::value<vector<string> >(),
      "add a parameter to the erasure code profile")
     ;
@@ -120,6 +129,11 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     exhaustive_erasures = false;
   if (vm.count("erased") > 0)
     erased = vm["erased"].as<vector<int> >();
+  stripes = vm["stripes"].as<int>();
+  if (vm.count("stripe-size") > 0)
+    stripe_sizes = vm["stripe-size"].as<vector<int> >();
+  else
+    stripe_sizes.push_back(in_size);
 
   k = atoi(profile["k"].c_str());
   m = atoi(profile["m"].c_str());
@@ -143,6 +157,12 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "region")
+    return region();
+  else if (workload == "stripes")
+    return stripe_workload();
+  else if (workload == "decode-matrix")
+    return decode_matrix();
   else
     return decode();
 }
@@ -188,6 +208,200 @@ int ErasureCodeBench::encode()
   return 0;
 }
 
+int ErasureCodeBench::region()
+{
+  // the code in ErasureCodeRegion.cc chooses the kernel at runtime,
+  // time each one the CPU supports on k chunks of in_size / k bytes
+  using namespace ceph::ec_region;
+  unsigned chunk_size = in_size / k;
+  vector<bufferptr> chunks;
+  vector<const char*> src;
+  for (int i = 0; i < k; i++) {
+    chunks.push_back(buffer::create_aligned(chunk_size, ErasureCode::SIMD_ALIGN));
+    memset(chunks.back().c_str(), 'X' + i, chunk_size);
+    src.push_back(chunks.back().c_str());
+  }
+  bufferptr parity = buffer::create_aligned(chunk_size, ErasureCode::SIMD_ALIGN);
+  impl_t saved = get_impl();
+  for (int impl = IMPL_GENERIC; impl < IMPL_MAX; impl++) {
+    if (!set_impl((impl_t)impl))
+      continue;
+    utime_t begin_time = ceph_clock_now();
+    for (int i = 0; i < max_iterations; i++)
+      xor_regions(&src[0], k, parity.c_str(), chunk_size);
+    utime_t xor_time = ceph_clock_now() - begin_time;
+    begin_time = ceph_clock_now();
+    for (int i = 0; i < max_iterations; i++) {
+      for (int j = 0; j < k; j++)
+	gf8_mul_xor(src[j], j + 2, parity.c_str(), chunk_size);
+    }
+    utime_t mul_time = ceph_clock_now() - begin_time;
+    cout << get_impl_name((impl_t)impl) << "\txor\t" << xor_time << "\t"
+	 << (max_iterations * (in_size / 1024)) << endl;
+    cout << get_impl_name((impl_t)impl) << "\tmultiply\t" << mul_time << "\t"
+	 << (max_iterations * (in_size / 1024)) << endl;
+  }
+  set_impl(saved);
+  return 0;
+}
+
+int ErasureCodeBench::stripe_workload()
+{
+  // what ECBackend does: many stripes of whatever size the objects have,
+  // read back with random chunks missing.  Only the data chunks are
+  // wanted, and every read is checked against the encoded data.
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf->get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+  unsigned chunk_count = erasure_code->get_chunk_count();
+  if (erasures > (int)(chunk_count - erasure_code->get_data_chunk_count())) {
+    cerr << "cannot recover from " << erasures << " erasures" << endl;
+    return -EINVAL;
+  }
+
+  set<int> want_to_encode, want_to_read;
+  for (unsigned i = 0; i < chunk_count; i++) {
+    want_to_encode.insert(i);
+    if (i < erasure_code->get_data_chunk_count())
+      want_to_read.insert(i);
+  }
+
+  vector<bufferlist> in(stripes);
+  uint64_t total_kb = 0;
+  for (int s = 0; s < stripes; s++) {
+    int size = stripe_sizes[rand() % stripe_sizes.size()];
+    in[s].append(string(size, 'A' + s % 26));
+    in[s].rebuild_aligned(ErasureCode::SIMD_ALIGN);
+    total_kb += size / 1024;
+  }
+
+  vector<map<int,bufferlist> > encoded(stripes);
+  utime_t begin_time = ceph_clock_now();
+  for (int i = 0; i < max_iterations; i++) {
+    for (int s = 0; s < stripes; s++) {
+      encoded[s].clear();
+      code = erasure_code->encode(want_to_encode, in[s], &encoded[s]);
+      if (code)
+	return code;
+    }
+  }
+  utime_t encode_time = ceph_clock_now() - begin_time;
+
+  utime_t decode_time;
+  for (int i = 0; i < max_iterations; i++) {
+    for (int s = 0; s < stripes; s++) {
+      map<int,bufferlist> chunks = encoded[s];
+      for (int j = 0; j < erasures; j++) {
+	int erasure;
+	do {
+	  erasure = rand() % chunk_count;
+	} while (chunks.count(erasure) == 0);
+	chunks.erase(erasure);
+      }
+      map<int,bufferlist> decoded;
+      begin_time = ceph_clock_now();
+      code = erasure_code->decode(want_to_read, chunks, &decoded);
+      decode_time += ceph_clock_now() - begin_time;
+      if (code)
+	return code;
+      for (auto c : want_to_read) {
+	if (!decoded[c].contents_equal(encoded[s][c])) {
+	  cerr << "stripe " << s << " chunk " << c
+	       << " content and recovered content are different" << endl;
+	  return -1;
+	}
+      }
+    }
+  }
+  cout << "encode\t" << encode_time << "\t" << (max_iterations * total_kb) << endl;
+  cout << "decode\t" << decode_time << "\t" << (max_iterations * total_kb) << endl;
+  return 0;
+}
+
+int ErasureCodeBench::decode_matrix()
+{
+  // decode the smallest possible stripe so that the time goes to working
+  // out how to decode (matrix inversion, schedules) rather than to the
+  // region arithmetic.  The first pass over the erasure patterns pays for
+  // that setup, later passes show what a plugin side cache saves.
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf->get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+  unsigned chunk_count = erasure_code->get_chunk_count();
+  unsigned data_count = erasure_code->get_data_chunk_count();
+  if (erasures < 1 || erasures > (int)(chunk_count - data_count)) {
+    cerr << "cannot recover from " << erasures << " erasures" << endl;
+    return -EINVAL;
+  }
+
+  bufferlist in;
+  in.append(string(erasure_code->get_chunk_size(1) * data_count, 'X'));
+  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  set<int> want_to_read;
+  for (unsigned i = 0; i < chunk_count; i++)
+    want_to_read.insert(i);
+  map<int,bufferlist> encoded;
+  code = erasure_code->encode(want_to_read, in, &encoded);
+  if (code)
+    return code;
+
+  // every combination of erasures chunks out of chunk_count
+  vector<map<int,bufferlist> > patterns;
+  vector<int> pick(erasures);
+  for (int i = 0; i < erasures; i++)
+    pick[i] = i;
+  while (true) {
+    map<int,bufferlist> chunks = encoded;
+    for (auto c : pick)
+      chunks.erase(c);
+    patterns.push_back(chunks);
+    int i = erasures - 1;
+    while (i >= 0 && pick[i] == (int)chunk_count - erasures + i)
+      i--;
+    if (i < 0)
+      break;
+    pick[i]++;
+    for (int j = i + 1; j < erasures; j++)
+      pick[j] = pick[j - 1] + 1;
+  }
+
+  utime_t first_time, repeat_time;
+  for (int i = 0; i <= max_iterations; i++) {
+    utime_t begin_time = ceph_clock_now();
+    for (auto& chunks : patterns) {
+      map<int,bufferlist> decoded;
+      code = erasure_code->decode(want_to_read, chunks, &decoded);
+      if (code)
+	return code;
+    }
+    if (i == 0)
+      first_time = ceph_clock_now() - begin_time;
+    else
+      repeat_time += ceph_clock_now() - begin_time;
+  }
+  double first_us = (double)first_time * 1000000 / patterns.size();
+  double repeat_us = max_iterations ?
+    (double)repeat_time * 1000000 / (patterns.size() * max_iterations) : 0;
+  cout << "patterns\t" << patterns.size() << endl;
+  cout << "first\t" << first_us << " us/decode" << endl;
+  cout << "repeat\t" << repeat_us << " us/decode" << endl;
+  return 0;
+}
+
 static void display_chunks(const map<int,bufferlist> &chunks,
 			   unsigned int chunk_count) {
   cout << "chunks ";
@@ -34,6 +34,8 @@ class ErasureCodeBench {
   bool exhaustive_erasures;
   vector<int> erased;
   string workload;
+  int stripes;
+  vector<int> stripe_sizes;
 
   ErasureCodeProfile profile;
 
@@ -49,6 +51,9 @@ public:
 		      ErasureCodeInterfaceRef erasure_code);
   int decode();
   int encode();
+  int region();
+  int stripe_workload();
+  int decode_matrix();
 };
 
 #endif
@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include "common/Formatter.h"
 #include "common/HTMLFormatter.h"
+#include "include/buffer.h"
 
 #include <sstream>
 #include <string>
@@ -58,6 +59,27 @@ TEST(JsonFormatter, Empty) {
   ASSERT_EQ(oss.str(), "");
 }
 
+TEST(JsonFormatter, Stream) {
+  bufferlist streamed;
+  int chunks = 0;
+  JSONFormatter fmt(false);
+  fmt.set_stream_sink([&](bufferlist& bl) {
+      streamed.claim_append(bl);
+      ++chunks;
+    }, 8);
+  fmt.open_array_section("foo");
+  for (int i = 0; i < 4; i++) {
+    fmt.open_object_section("bar");
+    fmt.dump_int("a", i);
+    fmt.close_section();
+  }
+  ASSERT_LT(0, chunks);
+  ASSERT_GT(8, fmt.get_len());
+  fmt.close_section();
+  fmt.flush(streamed);
+  ASSERT_EQ(streamed.to_str(), "[{\"a\":0},{\"a\":1},{\"a\":2},{\"a\":3}]");
+}
+
 TEST(XmlFormatter, Simple1) {
   ostringstream oss;
   XMLFormatter fmt(false);
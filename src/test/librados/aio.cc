@@ -1534,6 +1534,58 @@ TEST(LibRadosAio, RoundTripWriteFull) {
   rados_aio_release(my_completion3);
 }
 
+TEST(LibRadosAio, OperateBatchPP) {
+  AioTestDataPP test_data;
+  ASSERT_EQ("", test_data.init());
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+
+  std::vector<ObjectWriteOperation> write_ops(32);
+  std::vector<std::pair<std::string, ObjectWriteOperation*> > ops;
+  for (size_t i = 0; i < write_ops.size(); ++i) {
+    write_ops[i].write_full(bl);
+    ops.push_back(std::make_pair("foo" + stringify(i), &write_ops[i]));
+  }
+  // a second op on the same object must be applied after the first
+  ObjectWriteOperation append_op;
+  append_op.append(bl);
+  ops.push_back(std::make_pair("foo0", &append_op));
+
+  AioCompletion *my_completion = test_data.m_cluster.aio_create_completion();
+  ASSERT_EQ(0, test_data.m_ioctx.aio_operate_batch(my_completion, ops));
+  {
+    TestAlarm alarm;
+    ASSERT_EQ(0, my_completion->wait_for_safe());
+  }
+  ASSERT_EQ(0, my_completion->get_return_value());
+  my_completion->release();
+
+  for (size_t i = 0; i < write_ops.size(); ++i) {
+    uint64_t size;
+    time_t mtime;
+    ASSERT_EQ(0, test_data.m_ioctx.stat("foo" + stringify(i), &size, &mtime));
+    ASSERT_EQ(i == 0 ? 2 * sizeof(buf) : sizeof(buf), size);
+  }
+
+  // the first error is reported once every op has completed
+  ObjectWriteOperation create_op;
+  create_op.create(true);
+  ops.clear();
+  ops.push_back(std::make_pair("foo1", &create_op));
+  ops.push_back(std::make_pair("bar", &write_ops[0]));
+  my_completion = test_data.m_cluster.aio_create_completion();
+  ASSERT_EQ(0, test_data.m_ioctx.aio_operate_batch(my_completion, ops));
+  {
+    TestAlarm alarm;
+    ASSERT_EQ(0, my_completion->wait_for_safe());
+  }
+  ASSERT_EQ(-EEXIST, my_completion->get_return_value());
+  my_completion->release();
+  ASSERT_EQ(0, test_data.m_ioctx.stat("bar", nullptr, nullptr));
+}
+
 TEST(LibRadosAio, RoundTripWriteFullPP) {
   AioTestDataPP test_data;
   ASSERT_EQ("", test_data.init());
@@ -7,6 +7,7 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <unistd.h>
 #include "gtest/gtest.h"
 
 using namespace librados;
@@ -404,3 +405,33 @@ TEST_F(StriperTestPP, XattrListPP) {
     }
   }
 }
+
+TEST_F(StriperTestPP, LeaseRenewPP) {
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_lock_lease", "2"));
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  ASSERT_EQ(0, striper.write("LeaseRenewPP", bl, sizeof(buf), 0));
+  std::string first_obj = "LeaseRenewPP.0000000000000000";
+  int exclusive;
+  std::string tag;
+  std::list<librados::locker_t> lockers;
+  ASSERT_EQ(1, ioctx.list_lockers(first_obj, "striper.lock", &exclusive,
+                                  &tag, &lockers));
+  std::string cookie = lockers.front().cookie;
+  // past half the lease, the lease is renewed rather than a second
+  // shared lock being taken
+  usleep(1200000);
+  ASSERT_EQ(0, striper.write("LeaseRenewPP", bl, sizeof(buf), 0));
+  lockers.clear();
+  ASSERT_EQ(1, ioctx.list_lockers(first_obj, "striper.lock", &exclusive,
+                                  &tag, &lockers));
+  ASSERT_EQ(cookie, lockers.front().cookie);
+  // once it has lapsed, the next operation takes it again and succeeds
+  sleep(3);
+  bufferlist bl2;
+  ASSERT_EQ((int)sizeof(buf), striper.read("LeaseRenewPP", &bl2, sizeof(buf), 0));
+  ASSERT_EQ(0, memcmp(buf, bl2.c_str(), sizeof(buf)));
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_lock_lease", "0"));
+}
@@ -0,0 +1,181 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_fixture.h"
+#include "test/librbd/test_support.h"
+#include "common/Cond.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/cache/WriteLogImageCache.h"
+#include "librbd/io/ImageRequestWQ.h"
+#include "librbd/io/ReadResult.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <list>
+#include <memory>
+
+namespace librbd {
+namespace cache {
+
+class TestWriteLogImageCache : public TestFixture {
+public:
+  typedef WriteLogImageCache<ImageCtx> WriteLog;
+
+  void SetUp() override {
+    TestFixture::SetUp();
+
+    char dir[] = "/tmp/test_write_log.XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    m_dir = std::string(dir) + "/";
+
+    ASSERT_EQ(0, open_image(m_image_name, &m_ictx));
+    m_cct = m_ictx->cct;
+    m_cct->_conf->set_val("rbd_write_log_path", m_dir);
+  }
+
+  void TearDown() override {
+    m_cct->_conf->set_val("rbd_write_log_path", "");
+    m_cct->_conf->set_val("rbd_write_log_size", "1073741824");
+    std::string cmd = "rm -rf " + m_dir;
+    EXPECT_EQ(0, system(cmd.c_str()));
+    TestFixture::TearDown();
+  }
+
+  int init(WriteLog *wlog) {
+    C_SaferCond ctx;
+    wlog->init(&ctx);
+    return ctx.wait();
+  }
+
+  int shut_down(WriteLog *wlog) {
+    C_SaferCond ctx;
+    wlog->shut_down(&ctx);
+    return ctx.wait();
+  }
+
+  int flush(WriteLog *wlog) {
+    C_SaferCond ctx;
+    wlog->aio_flush(&ctx);
+    return ctx.wait();
+  }
+
+  int read(WriteLog *wlog, uint64_t off, uint64_t len, bufferlist *bl) {
+    C_SaferCond ctx;
+    wlog->aio_read({{off, len}}, bl, 0, &ctx);
+    return ctx.wait();
+  }
+
+  int read_image(uint64_t off, uint64_t len, bufferlist *bl) {
+    bufferptr bp(len);
+    bl->push_back(bp);
+    return m_ictx->io_work_queue->read(off, len, io::ReadResult{bl}, 0);
+  }
+
+  /// every write of size len is filled with its own index
+  static bufferlist make_data(unsigned i, uint64_t len) {
+    bufferlist bl;
+    bl.append(std::string(len, 'a' + i % 26));
+    return bl;
+  }
+
+  /// issue count writes of len bytes back to back, then wait for them all
+  int write_all(WriteLog *wlog, unsigned count, uint64_t len) {
+    std::list<C_SaferCond> ctxs;
+    for (unsigned i = 0; i < count; ++i) {
+      ctxs.emplace_back();
+      wlog->aio_write({{i * len, len}}, make_data(i, len), 0, &ctxs.back());
+    }
+    int ret = 0;
+    for (auto &ctx : ctxs) {
+      int r = ctx.wait();
+      if (r < 0 && ret == 0) {
+        ret = r;
+      }
+    }
+    return ret;
+  }
+
+  void expect_data(WriteLog *wlog, unsigned count, uint64_t len) {
+    for (unsigned i = 0; i < count; ++i) {
+      bufferlist expected = make_data(i, len);
+      if (wlog != nullptr) {
+        bufferlist bl;
+        ASSERT_EQ(0, read(wlog, i * len, len, &bl));
+        ASSERT_TRUE(expected.contents_equal(bl)) << "write " << i;
+      } else {
+        bufferlist bl;
+        ASSERT_EQ((ssize_t)len, read_image(i * len, len, &bl));
+        ASSERT_TRUE(expected.contents_equal(bl)) << "write " << i;
+      }
+    }
+  }
+
+  ImageCtx *m_ictx = nullptr;
+  CephContext *m_cct = nullptr;
+  std::string m_dir;
+};
+
+TEST_F(TestWriteLogImageCache, ConcurrentWrites) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+  ASSERT_EQ(0, acquire_exclusive_lock(*m_ictx));
+
+  std::unique_ptr<WriteLog> wlog(new WriteLog(*m_ictx));
+  ASSERT_EQ(0, init(wlog.get()));
+
+  // writes overlap in flight, so records are synced without m_lock
+  // and acknowledged out of the order their syncs finish
+  ASSERT_EQ(0, write_all(wlog.get(), 64, 4096));
+  expect_data(wlog.get(), 64, 4096);
+
+  ASSERT_EQ(0, flush(wlog.get()));
+  expect_data(nullptr, 64, 4096);
+  ASSERT_EQ(0, shut_down(wlog.get()));
+}
+
+TEST_F(TestWriteLogImageCache, OverlappingWritesKeepLogOrder) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+  ASSERT_EQ(0, acquire_exclusive_lock(*m_ictx));
+
+  std::unique_ptr<WriteLog> wlog(new WriteLog(*m_ictx));
+  ASSERT_EQ(0, init(wlog.get()));
+
+  // every write hits the same extent: the last one issued must win
+  std::list<C_SaferCond> ctxs;
+  for (unsigned i = 0; i < 32; ++i) {
+    ctxs.emplace_back();
+    wlog->aio_write({{0, 4096}}, make_data(i, 4096), 0, &ctxs.back());
+  }
+  for (auto &ctx : ctxs) {
+    ASSERT_EQ(0, ctx.wait());
+  }
+
+  bufferlist expected = make_data(31, 4096);
+  bufferlist bl;
+  ASSERT_EQ(0, read(wlog.get(), 0, 4096, &bl));
+  ASSERT_TRUE(expected.contents_equal(bl));
+
+  ASSERT_EQ(0, flush(wlog.get()));
+  bl.clear();
+  ASSERT_EQ(4096, read_image(0, 4096, &bl));
+  ASSERT_TRUE(expected.contents_equal(bl));
+  ASSERT_EQ(0, shut_down(wlog.get()));
+}
+
+TEST_F(TestWriteLogImageCache, FullLogDefersWrites) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+  ASSERT_EQ(0, acquire_exclusive_lock(*m_ictx));
+
+  // 1M of log for 2M of writes: later writes wait for the log to drain
+  m_cct->_conf->set_val("rbd_write_log_size", "1048576");
+  std::unique_ptr<WriteLog> wlog(new WriteLog(*m_ictx));
+  ASSERT_EQ(0, init(wlog.get()));
+
+  ASSERT_EQ(0, write_all(wlog.get(), 32, 65536));
+  expect_data(wlog.get(), 32, 65536);
+
+  ASSERT_EQ(0, flush(wlog.get()));
+  expect_data(nullptr, 32, 65536);
+  ASSERT_EQ(0, shut_down(wlog.get()));
+}
+
+} // namespace cache
+} // namespace librbd
@@ -0,0 +1,237 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "common/Cond.h"
+#include "include/stringify.h"
+#include "librbd/cache/ImageWriteback.h"
+#include <stdlib.h>
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+} // anonymous namespace
+
+namespace cache {
+
+template <>
+struct ImageWriteback<MockTestImageCtx> {
+  typedef std::vector<std::pair<uint64_t,uint64_t> > Extents;
+
+  static ImageWriteback* s_instance;
+
+  ImageWriteback(MockTestImageCtx &image_ctx) {
+    s_instance = this;
+  }
+
+  MOCK_METHOD4(aio_read_mock, void(const Extents &, ceph::bufferlist*, int,
+                                   Context *));
+  void aio_read(Extents&& image_extents, ceph::bufferlist* bl,
+                int fadvise_flags, Context *on_finish) {
+    aio_read_mock(image_extents, bl, fadvise_flags, on_finish);
+  }
+
+  MOCK_METHOD4(aio_write_mock, void(const Extents &, const ceph::bufferlist &,
+                                    int, Context *));
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) {
+    aio_write_mock(image_extents, bl, fadvise_flags, on_finish);
+  }
+
+  MOCK_METHOD4(aio_discard, void(uint64_t, uint64_t, bool, Context *));
+  MOCK_METHOD1(aio_flush, void(Context *));
+  MOCK_METHOD5(aio_writesame_mock, void(uint64_t, uint64_t, ceph::bufferlist& bl,
+                                        int, Context *));
+  void aio_writesame(uint64_t off, uint64_t len, ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) {
+    aio_writesame_mock(off, len, bl, fadvise_flags, on_finish);
+  }
+
+  MOCK_METHOD6(aio_compare_and_write_mock, void(const Extents &,
+                                                const ceph::bufferlist &,
+                                                const ceph::bufferlist &,
+                                                uint64_t *, int, Context *));
+  void aio_compare_and_write(Extents&& image_extents, ceph::bufferlist&& cmp_bl,
+                             ceph::bufferlist&& bl, uint64_t *mismatch_offset,
+                             int fadvise_flags, Context *on_finish) {
+    aio_compare_and_write_mock(image_extents, cmp_bl, bl, mismatch_offset,
+                               fadvise_flags, on_finish);
+  }
+};
+
+ImageWriteback<MockTestImageCtx>* ImageWriteback<MockTestImageCtx>::s_instance = nullptr;
+
+} // namespace cache
+} // namespace librbd
+
+// template definitions
+#include "librbd/cache/FileImageCache.cc"
+template class librbd::cache::FileImageCache<librbd::MockTestImageCtx>;
+
+namespace librbd {
+namespace cache {
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Invoke;
+using ::testing::Return;
+
+static const uint64_t BLOCK_SIZE = 4096;
+
+class TestMockFileImageCache : public TestMockFixture {
+public:
+  typedef FileImageCache<MockTestImageCtx> MockFileImageCache;
+  typedef ImageWriteback<MockTestImageCtx> MockImageWriteback;
+  typedef MockImageWriteback::Extents Extents;
+
+  void SetUp() override {
+    TestMockFixture::SetUp();
+
+    char dir[] = "/tmp/test_file_image_cache.XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    m_dir = dir;
+
+    ASSERT_EQ(0, open_image(m_image_name, &m_ictx));
+    CephContext *cct = m_ictx->cct;
+    cct->_conf->set_val("rbd_persistent_cache_path", m_dir);
+    cct->_conf->set_val("rbd_persistent_cache_block_size",
+                        stringify(BLOCK_SIZE));
+  }
+
+  void TearDown() override {
+    CephContext *cct = m_ictx->cct;
+    cct->_conf->set_val("rbd_persistent_cache_path", "");
+    cct->_conf->set_val("rbd_persistent_cache_block_size", "65536");
+    cct->_conf->set_val("rbd_persistent_cache_size", "10737418240");
+    std::string cmd = "rm -rf " + m_dir;
+    EXPECT_EQ(0, system(cmd.c_str()));
+    TestMockFixture::TearDown();
+  }
+
+  void set_max_blocks(uint64_t blocks) {
+    m_ictx->cct->_conf->set_val("rbd_persistent_cache_size",
+                                stringify(blocks * BLOCK_SIZE));
+  }
+
+  void expect_get_image_size(MockTestImageCtx &mock_image_ctx) {
+    EXPECT_CALL(mock_image_ctx, get_image_size(mock_image_ctx.snap_id))
+      .WillRepeatedly(Return(4 * BLOCK_SIZE));
+  }
+
+  static bufferlist block_data(uint64_t block) {
+    bufferlist bl;
+    bl.append(std::string(BLOCK_SIZE, 'a' + block));
+    return bl;
+  }
+
+  /// the image below is read once for the block, which then gets cached
+  void expect_read_block(uint64_t block) {
+    EXPECT_CALL(*MockImageWriteback::s_instance,
+                aio_read_mock(Extents{{block * BLOCK_SIZE, BLOCK_SIZE}},
+                              _, _, _))
+      .WillOnce(Invoke([block](const Extents &, bufferlist *bl, int,
+                               Context *on_finish) {
+                         bl->append(block_data(block));
+                         on_finish->complete(0);
+                       }));
+  }
+
+  void read_block(MockFileImageCache &mock_cache, uint64_t block) {
+    bufferlist bl;
+    C_SaferCond ctx;
+    mock_cache.aio_read({{block * BLOCK_SIZE, BLOCK_SIZE}}, &bl, 0, &ctx);
+    ASSERT_EQ(0, ctx.wait());
+    ASSERT_TRUE(block_data(block).contents_equal(bl)) << "block " << block;
+  }
+
+  void shut_down(MockFileImageCache &mock_cache) {
+    C_SaferCond ctx;
+    mock_cache.shut_down(&ctx);
+    ASSERT_EQ(0, ctx.wait());
+  }
+
+  librbd::ImageCtx *m_ictx = nullptr;
+  std::string m_dir;
+};
+
+TEST_F(TestMockFileImageCache, MissThenHit) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  mock_image_ctx.snap_id = 2;
+  expect_get_image_size(mock_image_ctx);
+
+  MockFileImageCache mock_cache(mock_image_ctx);
+  expect_read_block(1);
+  read_block(mock_cache, 1);
+  read_block(mock_cache, 1);
+  shut_down(mock_cache);
+}
+
+TEST_F(TestMockFileImageCache, EvictLeastRecentlyUsed) {
+  set_max_blocks(2);
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  mock_image_ctx.snap_id = 2;
+  expect_get_image_size(mock_image_ctx);
+
+  MockFileImageCache mock_cache(mock_image_ctx);
+  InSequence seq;
+  expect_read_block(0);
+  expect_read_block(1);
+  expect_read_block(2);
+  expect_read_block(1);
+
+  read_block(mock_cache, 0);
+  read_block(mock_cache, 1);
+  read_block(mock_cache, 0);  // hit: block 1 is now the oldest
+  read_block(mock_cache, 2);  // evicts block 1
+  read_block(mock_cache, 0);
+  read_block(mock_cache, 2);
+  read_block(mock_cache, 1);  // miss again, evicts block 0
+  shut_down(mock_cache);
+}
+
+TEST_F(TestMockFileImageCache, LimitCoversExistingFile) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+  mock_image_ctx.snap_id = 2;
+  expect_get_image_size(mock_image_ctx);
+
+  {
+    MockFileImageCache mock_cache(mock_image_ctx);
+    expect_read_block(0);
+    expect_read_block(1);
+    expect_read_block(2);
+    read_block(mock_cache, 0);
+    read_block(mock_cache, 1);
+    read_block(mock_cache, 2);
+    shut_down(mock_cache);
+  }
+
+  // a later opener with a smaller limit trims what it finds
+  set_max_blocks(2);
+  MockFileImageCache mock_cache(mock_image_ctx);
+  expect_read_block(0);
+  read_block(mock_cache, 2);
+  read_block(mock_cache, 0);
+  shut_down(mock_cache);
+}
+
+TEST_F(TestMockFileImageCache, FlushDoesNotFlushWriteback) {
+  MockTestImageCtx mock_image_ctx(*m_ictx);
+
+  MockFileImageCache mock_cache(mock_image_ctx);
+  EXPECT_CALL(*MockImageWriteback::s_instance, aio_flush(_)).Times(0);
+
+  C_SaferCond ctx;
+  mock_cache.flush(&ctx);
+  ASSERT_EQ(0, ctx.wait());
+  shut_down(mock_cache);
+}
+
+} // namespace cache
+} // namespace librbd
@@ -419,6 +419,66 @@ TEST_F(TestMockJournalReplay, AioWrite) {
   ASSERT_EQ(0, on_safe.wait());
 }
 
+TEST_F(TestMockJournalReplay, AioWriteParallel) {
+  REQUIRE_FEATURE(RBD_FEATURE_JOURNALING);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockReplayImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.journal_replay_max_concurrent_ios = 3;
+
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_accept_ops(mock_exclusive_lock, true);
+
+  MockJournalReplay mock_journal_replay(mock_image_ctx);
+  MockIoImageRequest mock_io_image_request;
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  io::AioCompletion *aio_comp1;
+  C_SaferCond on_ready1;
+  C_SaferCond on_safe1;
+  expect_aio_write(mock_io_image_request, &aio_comp1, 0, 456, "test");
+  when_process(mock_journal_replay,
+               EventEntry{AioWriteEvent(0, 456, to_bl("test"))},
+               &on_ready1, &on_safe1);
+
+  // ready before the write completes since nothing else is in-flight
+  ASSERT_EQ(0, on_ready1.wait());
+
+  io::AioCompletion *aio_comp2;
+  C_SaferCond on_ready2;
+  C_SaferCond on_safe2;
+  expect_aio_write(mock_io_image_request, &aio_comp2, 1024, 456, "test");
+  when_process(mock_journal_replay,
+               EventEntry{AioWriteEvent(1024, 456, to_bl("test"))},
+               &on_ready2, &on_safe2);
+  ASSERT_EQ(0, on_ready2.wait());
+
+  // overlapping write waits for the first write
+  io::AioCompletion *aio_comp3;
+  C_SaferCond on_ready3;
+  C_SaferCond on_safe3;
+  when_process(mock_journal_replay,
+               EventEntry{AioWriteEvent(123, 456, to_bl("test"))},
+               &on_ready3, &on_safe3);
+
+  expect_aio_write(mock_io_image_request, &aio_comp3, 123, 456, "test");
+  when_complete(mock_image_ctx, aio_comp1, 0);
+  ASSERT_EQ(0, on_ready3.wait());
+
+  when_complete(mock_image_ctx, aio_comp2, 0);
+  when_complete(mock_image_ctx, aio_comp3, 0);
+
+  expect_aio_flush(mock_image_ctx, mock_io_image_request, 0);
+  ASSERT_EQ(0, when_shut_down(mock_journal_replay, false));
+  ASSERT_EQ(0, on_safe1.wait());
+  ASSERT_EQ(0, on_safe2.wait());
+  ASSERT_EQ(0, on_safe3.wait());
+}
+
 TEST_F(TestMockJournalReplay, AioFlush) {
   REQUIRE_FEATURE(RBD_FEATURE_JOURNALING);
 
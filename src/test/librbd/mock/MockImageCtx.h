@@ -98,15 +98,23 @@ struct MockImageCtx {
       journal_object_flush_interval(image_ctx.journal_object_flush_interval),
       journal_object_flush_bytes(image_ctx.journal_object_flush_bytes),
       journal_object_flush_age(image_ctx.journal_object_flush_age),
+      journal_object_max_in_flight_appends(
+          image_ctx.journal_object_max_in_flight_appends),
       journal_pool(image_ctx.journal_pool),
       journal_max_payload_bytes(image_ctx.journal_max_payload_bytes),
       journal_max_concurrent_object_sets(
           image_ctx.journal_max_concurrent_object_sets),
+      journal_replay_max_concurrent_ios(
+          image_ctx.journal_replay_max_concurrent_ios),
       mirroring_resync_after_disconnect(
           image_ctx.mirroring_resync_after_disconnect),
       mirroring_replay_delay(image_ctx.mirroring_replay_delay),
       non_blocking_aio(image_ctx.non_blocking_aio),
-      blkin_trace_all(image_ctx.blkin_trace_all)
+      non_blocking_aio_inline(image_ctx.non_blocking_aio_inline),
+      blkin_trace_all(image_ctx.blkin_trace_all),
+      blkin_trace_sample_rate(image_ctx.blkin_trace_sample_rate),
+      object_map_batch_updates(image_ctx.object_map_batch_updates),
+      object_map_premark_objects(image_ctx.object_map_premark_objects)
   {
     md_ctx.dup(image_ctx.md_ctx);
     data_ctx.dup(image_ctx.data_ctx);
@@ -197,6 +205,10 @@ struct MockImageCtx {
   MOCK_CONST_METHOD0(get_exclusive_lock_policy, exclusive_lock::Policy*());
 
   MOCK_CONST_METHOD0(get_journal_policy, journal::Policy*());
+
+  bool blkin_trace_sampled() const {
+    return blkin_trace_all || ztrace_sample(blkin_trace_sample_rate);
+  }
   MOCK_CONST_METHOD1(set_journal_policy, void(journal::Policy*));
 
   MOCK_METHOD8(aio_read_from_cache, void(object_t, uint64_t, bufferlist *,
@@ -292,13 +304,19 @@ struct MockImageCtx {
   int journal_object_flush_interval;
   uint64_t journal_object_flush_bytes;
   double journal_object_flush_age;
+  uint64_t journal_object_max_in_flight_appends;
   std::string journal_pool;
   uint32_t journal_max_payload_bytes;
   int journal_max_concurrent_object_sets;
+  uint64_t journal_replay_max_concurrent_ios;
   bool mirroring_resync_after_disconnect;
   int mirroring_replay_delay;
   bool non_blocking_aio;
+  bool non_blocking_aio_inline;
   bool blkin_trace_all;
+  uint64_t blkin_trace_sample_rate;
+  bool object_map_batch_updates;
+  uint64_t object_map_premark_objects;
 };
 
 } // namespace librbd
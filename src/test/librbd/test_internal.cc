@@ -646,6 +646,219 @@ TEST_F(TestInternal, SnapshotCopyup)
   }
 }
 
+TEST_F(TestInternal, ServerSideCopyup)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_LAYERING);
+
+  std::string server_side_copyup;
+  ASSERT_EQ(0, _rados.conf_get("rbd_server_side_copyup", server_side_copyup));
+  ASSERT_EQ(0, _rados.conf_set("rbd_server_side_copyup", "true"));
+  BOOST_SCOPE_EXIT( (server_side_copyup) ) {
+    ASSERT_EQ(0, _rados.conf_set("rbd_server_side_copyup",
+                                 server_side_copyup.c_str()));
+  } BOOST_SCOPE_EXIT_END;
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  // whole parent objects, so that copyups can be done server-side
+  uint64_t object_size = ictx->get_object_size();
+  librbd::NoOpProgressContext no_op;
+  ASSERT_EQ(0, ictx->operations->resize(4 * object_size, true, no_op));
+
+  bufferlist bl1;
+  bl1.append(std::string(256, '1'));
+  ASSERT_EQ(256, ictx->io_work_queue->write(0, bl1.length(), bufferlist{bl1},
+                                            0));
+
+  ASSERT_EQ(0, snap_create(*ictx, "snap1"));
+  ASSERT_EQ(0,
+	    ictx->operations->snap_protect(cls::rbd::UserSnapshotNamespace(),
+					   "snap1"));
+
+  uint64_t features;
+  ASSERT_EQ(0, librbd::get_features(ictx, &features));
+
+  std::string clone_name = get_temp_image_name();
+  int order = ictx->order;
+  ASSERT_EQ(0, librbd::clone(m_ioctx, m_image_name.c_str(), "snap1", m_ioctx,
+			     clone_name.c_str(), features, &order, 0, 0));
+
+  librbd::ImageCtx *ictx2;
+  ASSERT_EQ(0, open_image(clone_name, &ictx2));
+  ASSERT_TRUE(ictx2->server_side_copyup);
+
+  ASSERT_EQ(0, snap_create(*ictx2, "snap1"));
+
+  // the copyup copies the parent object OSD-side, then applies the write
+  bufferlist bl2;
+  bl2.append(std::string(256, '2'));
+  ASSERT_EQ(256, ictx2->io_work_queue->write(256, bl2.length(),
+                                             bufferlist{bl2}, 0));
+
+  uint64_t size;
+  ASSERT_EQ(0, ictx2->data_ctx.stat(ictx2->get_object_name(0), &size,
+                                    nullptr));
+  ASSERT_EQ(512U, size);
+
+  bufferlist expected_bl;
+  expected_bl.append(bl1);
+  expected_bl.append(bl2);
+
+  bufferptr read_ptr(512);
+  bufferlist read_bl;
+  read_bl.push_back(read_ptr);
+  librbd::io::ReadResult read_result{&read_bl};
+  ASSERT_EQ(512,
+            ictx2->io_work_queue->read(0, 512,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(expected_bl.contents_equal(read_bl));
+
+  // the clone's snapshot still sees the parent data only
+  ASSERT_EQ(0, librbd::snap_set(ictx2, cls::rbd::UserSnapshotNamespace(),
+                                "snap1"));
+  ASSERT_EQ(256,
+            ictx2->io_work_queue->read(0, 256,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(bl1.contents_equal(read_bl));
+  ASSERT_EQ(256,
+            ictx2->io_work_queue->read(256, 256,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(read_bl.is_zero());
+}
+
+TEST_F(TestInternal, ServerSideCopyupMissingParentObject)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_LAYERING);
+
+  std::string server_side_copyup;
+  ASSERT_EQ(0, _rados.conf_get("rbd_server_side_copyup", server_side_copyup));
+  ASSERT_EQ(0, _rados.conf_set("rbd_server_side_copyup", "true"));
+  BOOST_SCOPE_EXIT( (server_side_copyup) ) {
+    ASSERT_EQ(0, _rados.conf_set("rbd_server_side_copyup",
+                                 server_side_copyup.c_str()));
+  } BOOST_SCOPE_EXIT_END;
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  // whole parent objects, so that copyups can be done server-side
+  uint64_t object_size = ictx->get_object_size();
+  librbd::NoOpProgressContext no_op;
+  ASSERT_EQ(0, ictx->operations->resize(4 * object_size, true, no_op));
+
+  bufferlist bl1;
+  bl1.append(std::string(256, '1'));
+  ASSERT_EQ(256, ictx->io_work_queue->write(0, bl1.length(), bufferlist{bl1},
+                                            0));
+
+  ASSERT_EQ(0, snap_create(*ictx, "snap1"));
+  ASSERT_EQ(0,
+	    ictx->operations->snap_protect(cls::rbd::UserSnapshotNamespace(),
+					   "snap1"));
+
+  uint64_t features;
+  ASSERT_EQ(0, librbd::get_features(ictx, &features));
+
+  std::string clone_name = get_temp_image_name();
+  int order = ictx->order;
+  ASSERT_EQ(0, librbd::clone(m_ioctx, m_image_name.c_str(), "snap1", m_ioctx,
+			     clone_name.c_str(), features, &order, 0, 0));
+
+  librbd::ImageCtx *ictx2;
+  ASSERT_EQ(0, open_image(clone_name, &ictx2));
+  ASSERT_TRUE(ictx2->server_side_copyup);
+
+  // parent object 1 doesn't exist: the copyup falls back to reading the
+  // parent and the write still lands
+  bufferlist bl2;
+  bl2.append(std::string(256, '2'));
+  ASSERT_EQ(256, ictx2->io_work_queue->write(object_size, bl2.length(),
+                                             bufferlist{bl2}, 0));
+
+  bufferptr read_ptr(256);
+  bufferlist read_bl;
+  read_bl.push_back(read_ptr);
+  librbd::io::ReadResult read_result{&read_bl};
+  ASSERT_EQ(256,
+            ictx2->io_work_queue->read(object_size, 256,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(bl2.contents_equal(read_bl));
+  ASSERT_EQ(256,
+            ictx2->io_work_queue->read(0, 256,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(bl1.contents_equal(read_bl));
+}
+
+TEST_F(TestInternal, ServerSideCopyupFlatten)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_LAYERING);
+
+  std::string server_side_copyup;
+  ASSERT_EQ(0, _rados.conf_get("rbd_server_side_copyup", server_side_copyup));
+  ASSERT_EQ(0, _rados.conf_set("rbd_server_side_copyup", "true"));
+  BOOST_SCOPE_EXIT( (server_side_copyup) ) {
+    ASSERT_EQ(0, _rados.conf_set("rbd_server_side_copyup",
+                                 server_side_copyup.c_str()));
+  } BOOST_SCOPE_EXIT_END;
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  // whole parent objects, so that copyups can be done server-side
+  uint64_t object_size = ictx->get_object_size();
+  librbd::NoOpProgressContext no_op;
+  ASSERT_EQ(0, ictx->operations->resize(4 * object_size, true, no_op));
+
+  bufferlist bl;
+  bl.append(std::string(256, '1'));
+  ASSERT_EQ(256, ictx->io_work_queue->write(0, bl.length(), bufferlist{bl},
+                                            0));
+  ASSERT_EQ(256, ictx->io_work_queue->write(2 * object_size, bl.length(),
+                                            bufferlist{bl}, 0));
+
+  ASSERT_EQ(0, snap_create(*ictx, "snap1"));
+  ASSERT_EQ(0,
+	    ictx->operations->snap_protect(cls::rbd::UserSnapshotNamespace(),
+					   "snap1"));
+
+  uint64_t features;
+  ASSERT_EQ(0, librbd::get_features(ictx, &features));
+
+  std::string clone_name = get_temp_image_name();
+  int order = ictx->order;
+  ASSERT_EQ(0, librbd::clone(m_ioctx, m_image_name.c_str(), "snap1", m_ioctx,
+			     clone_name.c_str(), features, &order, 0, 0));
+
+  librbd::ImageCtx *ictx2;
+  ASSERT_EQ(0, open_image(clone_name, &ictx2));
+  ASSERT_TRUE(ictx2->server_side_copyup);
+
+  ASSERT_EQ(0, ictx2->operations->flatten(no_op));
+  ASSERT_EQ(nullptr, ictx2->parent);
+
+  uint64_t size;
+  ASSERT_EQ(0, ictx2->data_ctx.stat(ictx2->get_object_name(0), &size,
+                                    nullptr));
+  ASSERT_EQ(256U, size);
+  ASSERT_EQ(0, ictx2->data_ctx.stat(ictx2->get_object_name(2), &size,
+                                    nullptr));
+  ASSERT_EQ(256U, size);
+
+  bufferptr read_ptr(256);
+  bufferlist read_bl;
+  read_bl.push_back(read_ptr);
+  librbd::io::ReadResult read_result{&read_bl};
+  ASSERT_EQ(256,
+            ictx2->io_work_queue->read(0, 256,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(bl.contents_equal(read_bl));
+  ASSERT_EQ(256,
+            ictx2->io_work_queue->read(2 * object_size, 256,
+                                       librbd::io::ReadResult{read_result}, 0));
+  ASSERT_TRUE(bl.contents_equal(read_bl));
+}
+
 TEST_F(TestInternal, ResizeCopyup)
 {
   REQUIRE_FEATURE(RBD_FEATURE_LAYERING);
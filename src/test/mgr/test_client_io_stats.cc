@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+#include "mgr/ClientIOStats.h"
+
+TEST(ClientIOStats, Key)
+{
+  entity_name_t c = entity_name_t::CLIENT(4123);
+  EXPECT_EQ("", client_io_key_t(1, c, "foo").image);
+  EXPECT_EQ("", client_io_key_t(1, c, "rbd_header.abc").image);
+  EXPECT_EQ("", client_io_key_t(1, c, "rbd_data.").image);
+  EXPECT_EQ("abc123",
+	    client_io_key_t(1, c, "rbd_data.abc123.0000000000000001").image);
+  EXPECT_EQ("2.abc123",
+	    client_io_key_t(1, c, "rbd_data.2.abc123.0000000000000001").image);
+  // objects of one image from one client share a key
+  client_io_key_t a(1, c, "rbd_data.abc123.0000000000000001");
+  client_io_key_t b(1, c, "rbd_data.abc123.00000000000000ff");
+  EXPECT_FALSE(a < b || b < a);
+}
+
+TEST(ClientIOStats, SketchKeepsHeavyHitters)
+{
+  ClientIOSketch sketch(4);
+  client_io_key_t heavy(1, entity_name_t::CLIENT(1), "obj");
+  // half of all ops come from one client, the rest from 1000 others
+  for (int i = 0; i < 1000; i++) {
+    sketch.add(heavy, 0, 4096, 1000);
+    sketch.add(client_io_key_t(1, entity_name_t::CLIENT(100 + i), "obj"),
+	       4096, 0, 1000);
+  }
+  EXPECT_EQ(4u, sketch.size());
+
+  std::map<client_io_key_t, client_io_stat_t> out;
+  sketch.dump_stats(&out);
+  ASSERT_EQ(4u, out.size());
+  ASSERT_EQ(1u, out.count(heavy));
+  // tracked from its first op, so the counts are exact
+  EXPECT_EQ(1000u, out[heavy].ops);
+  EXPECT_EQ(0u, out[heavy].error);
+  EXPECT_EQ(1000u * 4096, out[heavy].wr_bytes);
+  EXPECT_EQ(1000000u, out[heavy].lat_sum_ns);
+  for (auto& p : out) {
+    if (p.first < heavy || heavy < p.first) {
+      EXPECT_EQ(1u, p.second.ops);
+      EXPECT_GT(p.second.error, 0u);
+    }
+  }
+}
+
+TEST(ClientIOStats, SketchWeighsBytes)
+{
+  ClientIOSketch sketch(2);
+  client_io_key_t small(1, entity_name_t::CLIENT(1), "obj");
+  client_io_key_t bulk(1, entity_name_t::CLIENT(2), "obj");
+  for (int i = 0; i < 20; i++)
+    sketch.add(small, 0, 512, 0);
+  // one 4MB write weighs as much as 65 small ops
+  sketch.add(bulk, 0, 4 << 20, 0);
+  // a newcomer evicts the lightest entry, which is now the small one
+  sketch.add(client_io_key_t(1, entity_name_t::CLIENT(3), "obj"), 0, 512, 0);
+
+  std::map<client_io_key_t, client_io_stat_t> out;
+  sketch.dump_stats(&out);
+  EXPECT_EQ(1u, out.count(bulk));
+  EXPECT_EQ(0u, out.count(small));
+}
+
+TEST(ClientIOStats, CollectorSwapOut)
+{
+  ClientIOCollector c(1024);
+  for (int i = 0; i < 32; i++)
+    for (int j = 0; j <= i; j++)
+      c.add(client_io_key_t(1, entity_name_t::CLIENT(i), "obj"), 10, 0, 5);
+
+  client_io_report_t r;
+  c.swap_out(&r, ceph_clock_now(), 1024);
+  ASSERT_EQ(32u, r.stats.size());
+  for (int i = 0; i < 32; i++) {
+    auto& s = r.stats[client_io_key_t(1, entity_name_t::CLIENT(i), "obj")];
+    EXPECT_EQ((uint64_t)i + 1, s.ops);
+    EXPECT_EQ(10u * (i + 1), s.rd_bytes);
+  }
+
+  bufferlist bl;
+  ::encode(r, bl);
+  client_io_report_t d;
+  bufferlist::iterator p = bl.begin();
+  ::decode(d, p);
+  EXPECT_EQ(r.period, d.period);
+  ASSERT_EQ(r.stats.size(), d.stats.size());
+  EXPECT_EQ(32u, d.stats.rbegin()->second.ops);
+
+  // the next period starts empty
+  client_io_report_t r2;
+  c.swap_out(&r2, ceph_clock_now(), 1024);
+  EXPECT_TRUE(r2.stats.empty());
+}
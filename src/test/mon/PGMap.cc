@@ -114,6 +114,42 @@ TEST(pgmap, calc_stats)
   }
 }
 
+TEST(pgmap, unhealthy_pgs)
+{
+  PGMap pg_map;
+  PGMap::Incremental inc;
+  pg_stat_t ps;
+
+  ps.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  inc.pg_stat_updates[pg_t(1,1)] = ps;
+  ps.state = PG_STATE_ACTIVE;
+  inc.pg_stat_updates[pg_t(2,1)] = ps;
+  ps.state = PG_STATE_ACTIVE | PG_STATE_CLEAN | PG_STATE_INCONSISTENT;
+  inc.pg_stat_updates[pg_t(3,1)] = ps;
+  inc.version = 1;
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(2u, pg_map.unhealthy_pgs.size());
+  ASSERT_EQ(0u, pg_map.unhealthy_pgs.count(pg_t(1,1)));
+
+  inc = PGMap::Incremental();
+  inc.version = 2;
+  ps.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  inc.pg_stat_updates[pg_t(2,1)] = ps;
+  ps.state = PG_STATE_PEERING;
+  inc.pg_stat_updates[pg_t(1,1)] = ps;
+  inc.pg_remove.insert(pg_t(3,1));
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(1u, pg_map.unhealthy_pgs.size());
+  ASSERT_EQ(1u, pg_map.unhealthy_pgs.count(pg_t(1,1)));
+
+  bufferlist bl;
+  pg_map.encode(bl);
+  PGMap decoded;
+  bufferlist::iterator p = bl.begin();
+  ::decode(decoded, p);
+  ASSERT_EQ(pg_map.unhealthy_pgs, decoded.unhealthy_pgs);
+}
+
 namespace {
   class CheckTextTable : public TextTable {
   public:
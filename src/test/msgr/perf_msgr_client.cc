@@ -19,18 +19,28 @@
 #include <string>
 #include <unistd.h>
 #include <iostream>
+#include <fstream>
+#include <random>
+#include <sys/resource.h>
 
 using namespace std;
 
 #include "common/ceph_argparse.h"
 #include "common/debug.h"
 #include "common/Cycles.h"
+#include "common/obj_bencher.h"
 #include "global/global_init.h"
 #include "msg/Messenger.h"
 #include "messages/MOSDOp.h"
 
 #include <atomic>
 
+// a message data size, and how often it's picked relative to the others
+struct msg_size_t {
+  int len;
+  unsigned weight;
+};
+
 class MessengerClient {
   class ClientThread;
   class ClientDispatcher : public Dispatcher {
@@ -65,50 +75,84 @@ class MessengerClient {
   };
 
   class ClientThread : public Thread {
-    Messenger *msgr;
+    vector<Messenger*> msgrs;
     int concurrent;
-    ConnectionRef conn;
+    vector<ConnectionRef> conns;
     std::atomic<unsigned> client_inc = { 0 };
     object_t oid;
     object_locator_t oloc;
     pg_t pgid;
-    int msg_len;
-    bufferlist data;
+    const vector<msg_size_t>& sizes;
+    vector<bufferlist> data;
+    unsigned total_weight = 0;
     int ops;
     ClientDispatcher dispatcher;
+    vector<uint64_t> send_cycles; // by tid - 1
 
    public:
     Mutex lock;
     Cond cond;
     uint64_t inflight;
+    uint64_t bytes = 0;
+    bench_latency_histogram latency; // usec
 
-    ClientThread(Messenger *m, int c, ConnectionRef con, int len, int ops, int think_time_us):
-        msgr(m), concurrent(c), conn(con), oid("object-name"), oloc(1, 1), msg_len(len), ops(ops),
-        dispatcher(think_time_us, this), lock("MessengerBenchmark::ClientThread::lock"), inflight(0) {
+    ClientThread(int c, const vector<msg_size_t>& sizes, int ops, int think_time_us):
+        concurrent(c), oid("object-name"), oloc(1, 1), sizes(sizes), ops(ops),
+        dispatcher(think_time_us, this), send_cycles(ops),
+        lock("MessengerBenchmark::ClientThread::lock"), inflight(0) {
+      for (auto& s : sizes) {
+        bufferptr ptr(s.len);
+        memset(ptr.c_str(), 0, s.len);
+        data.emplace_back();
+        data.back().append(ptr);
+        total_weight += s.weight;
+      }
+    }
+    void add_connection(Messenger *m, ConnectionRef con) {
       m->add_dispatcher_head(&dispatcher);
-      bufferptr ptr(msg_len);
-      memset(ptr.c_str(), 0, msg_len);
-      data.append(ptr);
+      msgrs.push_back(m);
+      conns.push_back(con);
     }
     void *entry() override {
+      std::minstd_rand rng(getpid() + (uintptr_t)this);
       lock.Lock();
       for (int i = 0; i < ops; ++i) {
-        if (inflight > uint64_t(concurrent)) {
+        while (inflight >= uint64_t(concurrent)) {
           cond.Wait(lock);
         }
+        unsigned pick = rng() % total_weight;
+        unsigned s = 0;
+        while (pick >= sizes[s].weight) {
+          pick -= sizes[s].weight;
+          ++s;
+        }
 	hobject_t hobj(oid, oloc.key, CEPH_NOSNAP, pgid.ps(), pgid.pool(),
 		       oloc.nspace);
 	spg_t spgid(pgid);
-        MOSDOp *m = new MOSDOp(client_inc, 0, hobj, spgid, 0, 0, 0);
-        m->write(0, msg_len, data);
+        MOSDOp *m = new MOSDOp(client_inc, i + 1, hobj, spgid, 0, 0, 0);
+        m->write(0, sizes[s].len, data[s]);
         inflight++;
-        conn->send_message(m);
+        bytes += sizes[s].len;
+        send_cycles[i] = Cycles::rdtsc();
+        conns[i % conns.size()]->send_message(m);
         //cerr << __func__ << " send m=" << m << std::endl;
       }
+      // wait for the replies before tearing the connections down
+      while (inflight)
+        cond.Wait(lock);
       lock.Unlock();
-      msgr->shutdown();
+      for (auto msgr : msgrs)
+        msgr->shutdown();
       return 0;
     }
+    void complete(ceph_tid_t tid) {
+      uint64_t now = Cycles::rdtsc();
+      Mutex::Locker l(lock);
+      if (tid >= 1 && tid <= send_cycles.size())
+        latency.add(Cycles::to_microseconds(now - send_cycles[tid - 1]));
+      inflight--;
+      cond.Signal();
+    }
   };
 
   string type;
@@ -129,19 +173,24 @@ class MessengerClient {
       msgrs[i]->wait();
     }
   }
-  void ready(int c, int jobs, int ops, int msg_len) {
+  void ready(int c, int jobs, int conns, int ops, const vector<msg_size_t>& sizes) {
     entity_addr_t addr;
     addr.parse(serveraddr.c_str());
     addr.set_nonce(0);
     for (int i = 0; i < jobs; ++i) {
-      Messenger *msgr = Messenger::create(g_ceph_context, type, entity_name_t::CLIENT(0), "client", getpid()+i, 0);
-      msgr->set_default_policy(Messenger::Policy::lossless_client(0));
-      entity_inst_t inst(entity_name_t::OSD(0), addr);
-      ConnectionRef conn = msgr->get_connection(inst);
-      ClientThread *t = new ClientThread(msgr, c, conn, msg_len, ops, think_time_us);
-      msgrs.push_back(msgr);
+      ClientThread *t = new ClientThread(c, sizes, ops, think_time_us);
+      // a messenger keeps one connection per peer, so each connection
+      // gets its own messenger
+      for (int j = 0; j < conns; ++j) {
+        Messenger *msgr = Messenger::create(g_ceph_context, type, entity_name_t::CLIENT(0), "client", getpid()+i*conns+j, 0);
+        msgr->set_default_policy(Messenger::Policy::lossless_client(0));
+        entity_inst_t inst(entity_name_t::OSD(0), addr);
+        ConnectionRef conn = msgr->get_connection(inst);
+        t->add_connection(msgr, conn);
+        msgrs.push_back(msgr);
+        msgr->start();
+      }
       clients.push_back(t);
-      msgr->start();
     }
     usleep(1000*1000);
   }
@@ -151,16 +200,61 @@ class MessengerClient {
     for (uint64_t i = 0; i < msgrs.size(); ++i)
       msgrs[i]->wait();
   }
+  void summarize(uint64_t *bytes, bench_latency_histogram *latency) {
+    *bytes = 0;
+    for (auto t : clients) {
+      *bytes += t->bytes;
+      latency->merge(t->latency);
+    }
+  }
 };
 
 void MessengerClient::ClientDispatcher::ms_fast_dispatch(Message *m) {
   usleep(think_time);
+  ceph_tid_t tid = m->get_tid();
   m->put();
-  Mutex::Locker l(thread->lock);
-  thread->inflight--;
-  thread->cond.Signal();
+  thread->complete(tid);
 }
 
+// read and write syscalls made so far, if the kernel tells us
+static void read_syscalls(uint64_t *syscr, uint64_t *syscw)
+{
+  *syscr = *syscw = 0;
+  ifstream io("/proc/self/io");
+  string key;
+  uint64_t v;
+  while (io >> key >> v) {
+    if (key == "syscr:")
+      *syscr = v;
+    else if (key == "syscw:")
+      *syscw = v;
+  }
+}
+
+static double tv_seconds(const struct timeval& tv)
+{
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// "4096,65536:2" -> 4096 bytes with weight 1, 65536 bytes with weight 2
+static bool parse_msg_sizes(const string& s, vector<msg_size_t> *sizes)
+{
+  vector<string> items;
+  get_str_vec(s, ",", items);
+  for (auto& item : items) {
+    msg_size_t ms;
+    string err;
+    size_t colon = item.find(':');
+    ms.len = strict_sistrtoll(item.substr(0, colon).c_str(), &err);
+    ms.weight = 1;
+    if (colon != string::npos)
+      ms.weight = strict_strtol(item.substr(colon + 1).c_str(), 10, &err);
+    if (!err.empty() || ms.len <= 0 || ms.weight == 0)
+      return false;
+    sizes->push_back(ms);
+  }
+  return !sizes->empty();
+}
 
 void usage(const string &name) {
   cerr << "Usage: " << name << " [server ip:port] [numjobs] [concurrency] [ios] [thinktime us] [msg length]" << std::endl;
@@ -170,6 +264,9 @@ void usage(const string &name) {
   cerr << "       [ios]: how much messages sent for each client" << std::endl;
   cerr << "       [thinktime]: sleep time when do fast dispatching(match client logic)" << std::endl;
   cerr << "       [msg length]: message data bytes" << std::endl;
+  cerr << "   --connections <n>: connections per client thread, used round robin (default 1)" << std::endl;
+  cerr << "   --msg-sizes <len[:weight],...>: mix of message data sizes, overriding [msg length]" << std::endl;
+  cerr << "   --format <json|json-pretty|xml>: also dump the results in this format" << std::endl;
 }
 
 int main(int argc, char **argv)
@@ -182,7 +279,25 @@ int main(int argc, char **argv)
   common_init_finish(g_ceph_context);
   g_ceph_context->_conf->apply_changes(NULL);
 
-  if (args.size() < 6) {
+  int conns = 1;
+  string msg_sizes;
+  string format;
+  string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--connections", (char*)NULL)) {
+      conns = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--msg-sizes", (char*)NULL)) {
+      msg_sizes = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--format", (char*)NULL)) {
+      format = val;
+    } else {
+      ++i;
+    }
+  }
+
+  if (args.size() < 6 || conns < 1) {
     usage(argv[0]);
     return 1;
   }
@@ -193,24 +308,100 @@ int main(int argc, char **argv)
   int think_time = atoi(args[4]);
   int len = atoi(args[5]);
 
+  vector<msg_size_t> sizes;
+  if (msg_sizes.empty()) {
+    sizes.push_back(msg_size_t{len, 1});
+  } else if (!parse_msg_sizes(msg_sizes, &sizes)) {
+    cerr << "invalid --msg-sizes " << msg_sizes << std::endl;
+    return 1;
+  }
+
   std::string public_msgr_type = g_ceph_context->_conf->ms_public_type.empty() ? g_ceph_context->_conf->get_val<std::string>("ms_type") : g_ceph_context->_conf->ms_public_type;
+  uint64_t op_threads = g_ceph_context->_conf->get_val<uint64_t>("ms_async_op_threads");
 
   cerr << " using ms-public-type " << public_msgr_type << std::endl;
+  cerr << "       ms_async_op_threads " << op_threads << std::endl;
   cerr << "       server ip:port " << args[0] << std::endl;
   cerr << "       numjobs " << numjobs << std::endl;
+  cerr << "       connections per job " << conns << std::endl;
   cerr << "       concurrency " << concurrent << std::endl;
   cerr << "       ios " << ios << std::endl;
   cerr << "       thinktime(us) " << think_time << std::endl;
-  cerr << "       message data bytes " << len << std::endl;
+  for (auto& s : sizes)
+    cerr << "       message data bytes " << s.len << " weight " << s.weight << std::endl;
 
   MessengerClient client(public_msgr_type, args[0], think_time);
 
-  client.ready(concurrent, numjobs, ios, len);
+  client.ready(concurrent, numjobs, conns, ios, sizes);
   Cycles::init();
+  struct rusage ru_start, ru_stop;
+  uint64_t syscr_start, syscw_start, syscr_stop, syscw_stop;
+  getrusage(RUSAGE_SELF, &ru_start);
+  read_syscalls(&syscr_start, &syscw_start);
   uint64_t start = Cycles::rdtsc();
   client.start();
   uint64_t stop = Cycles::rdtsc();
-  cerr << " Total op " << ios << " run time " << Cycles::to_microseconds(stop - start) << "us." << std::endl;
+  getrusage(RUSAGE_SELF, &ru_stop);
+  read_syscalls(&syscr_stop, &syscw_stop);
+
+  uint64_t us = Cycles::to_microseconds(stop - start);
+  uint64_t total_ops = (uint64_t)ios * numjobs;
+  uint64_t bytes;
+  bench_latency_histogram latency;
+  client.summarize(&bytes, &latency);
+  double secs = us / 1000000.0;
+  double user = tv_seconds(ru_stop.ru_utime) - tv_seconds(ru_start.ru_utime);
+  double sys = tv_seconds(ru_stop.ru_stime) - tv_seconds(ru_start.ru_stime);
+  long vcsw = ru_stop.ru_nvcsw - ru_start.ru_nvcsw;
+  long ivcsw = ru_stop.ru_nivcsw - ru_start.ru_nivcsw;
+
+  cerr << " Total op " << total_ops << " run time " << us << "us." << std::endl;
+  cerr << " Throughput " << total_ops / secs << " ops/s, "
+       << bytes / secs / (1024*1024) << " MB/s" << std::endl;
+  cerr << " Latency(us) p50 " << latency.percentile(50)
+       << " p99 " << latency.percentile(99)
+       << " p99.9 " << latency.percentile(99.9)
+       << " p99.99 " << latency.percentile(99.99)
+       << " max " << latency.percentile(100) << std::endl;
+  cerr << " CPU user " << user << "s sys " << sys << "s ("
+       << (user + sys) * 1000000 / total_ops << "us/op), context switches "
+       << vcsw << " voluntary " << ivcsw << " involuntary, syscalls "
+       << syscr_stop - syscr_start << " read " << syscw_stop - syscw_start
+       << " write" << std::endl;
+
+  if (!format.empty()) {
+    std::unique_ptr<Formatter> f(Formatter::create(format, "json-pretty", "json-pretty"));
+    f->open_object_section("perf_msgr_client");
+    f->dump_string("ms_type", public_msgr_type);
+    f->dump_unsigned("ms_async_op_threads", op_threads);
+    f->dump_int("numjobs", numjobs);
+    f->dump_int("connections_per_job", conns);
+    f->dump_int("concurrency", concurrent);
+    f->dump_unsigned("ops", total_ops);
+    f->dump_unsigned("bytes", bytes);
+    f->dump_float("seconds", secs);
+    f->dump_float("ops_per_sec", total_ops / secs);
+    f->dump_float("mb_per_sec", bytes / secs / (1024*1024));
+    f->open_object_section("latency_us");
+    f->dump_unsigned("p50", latency.percentile(50));
+    f->dump_unsigned("p99", latency.percentile(99));
+    f->dump_unsigned("p99.9", latency.percentile(99.9));
+    f->dump_unsigned("p99.99", latency.percentile(99.99));
+    f->dump_unsigned("max", latency.percentile(100));
+    f->close_section();
+    f->open_object_section("cpu");
+    f->dump_float("user_sec", user);
+    f->dump_float("sys_sec", sys);
+    f->dump_float("usec_per_op", (user + sys) * 1000000 / total_ops);
+    f->dump_int("voluntary_ctx_switches", vcsw);
+    f->dump_int("involuntary_ctx_switches", ivcsw);
+    f->dump_unsigned("read_syscalls", syscr_stop - syscr_start);
+    f->dump_unsigned("write_syscalls", syscw_stop - syscw_start);
+    f->close_section();
+    f->close_section();
+    f->flush(cout);
+    cout << std::endl;
+  }
 
   return 0;
 }
@@ -5,6 +5,8 @@
  * Author: Ramesh Chander, Ramesh.Chander@sandisk.com
  */
 #include <iostream>
+#include <random>
+#include <thread>
 #include <boost/scoped_ptr.hpp>
 #include <gtest/gtest.h>
 
@@ -290,11 +292,93 @@ TEST_P(AllocTest, test_alloc_non_aligned_len)
   EXPECT_EQ(want_size, alloc->allocate(want_size, alloc_unit, 0, &extents));
 }
 
+TEST_P(AllocTest, test_alloc_contention)
+{
+  int64_t block_size = 4096;
+  int64_t size = 10ull << 30;
+  int num_threads = 4;
+  int ops = 20000;
+  init_alloc(size, block_size);
+  alloc->init_add_free(0, size);
+
+  vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+	std::mt19937 rng(t);
+	vector<AllocExtentVector> held;
+	for (int i = 0; i < ops; ++i) {
+	  uint64_t want = (1 + rng() % 16) * block_size;
+	  ASSERT_EQ(0, alloc->reserve(want));
+	  AllocExtentVector extents;
+	  ASSERT_EQ((int64_t)want,
+		    alloc->allocate(want, block_size, 65536, 0, &extents));
+	  held.push_back(extents);
+	  if (held.size() > 64) {
+	    auto& victim = held[rng() % held.size()];
+	    for (auto& e : victim) {
+	      alloc->release(e.offset, e.length);
+	    }
+	    victim = held.back();
+	    held.pop_back();
+	  }
+	}
+	for (auto& v : held) {
+	  for (auto& e : v) {
+	    alloc->release(e.offset, e.length);
+	  }
+	}
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ((uint64_t)size, alloc->get_free());
+  alloc->shutdown();
+}
+
+TEST_P(AllocTest, test_alloc_enumerate_free)
+{
+  int64_t block_size = 1024;
+  int64_t blocks = BitMapZone::get_total_blocks() * block_size;
+
+  init_alloc(blocks, block_size);
+  alloc->init_add_free(0, block_size * 16);
+  alloc->init_add_free(block_size * 64, block_size * 8);
+  EXPECT_EQ(alloc->reserve(block_size * 4), 0);
+  AllocExtentVector extents;
+  EXPECT_EQ(4 * block_size,
+	    alloc->allocate(4 * (uint64_t)block_size, (uint64_t) block_size,
+			    (int64_t) 0, &extents));
+
+  interval_set<uint64_t> free;
+  bool supported = alloc->enumerate_free(
+    [&](uint64_t offset, uint64_t length) {
+      free.insert(offset, length);
+    });
+  if (!supported) {
+    alloc->shutdown();
+    return;
+  }
+  EXPECT_EQ(alloc->get_free(), free.size());
+
+  // loading the enumerated extents rebuilds the same free space
+  boost::scoped_ptr<Allocator> copy(
+    Allocator::create(g_ceph_context, string(GetParam()), blocks, block_size));
+  for (auto p = free.begin(); p != free.end(); ++p) {
+    copy->init_add_free(p.get_start(), p.get_len());
+  }
+  EXPECT_EQ(alloc->get_free(), copy->get_free());
+  for (auto& e : extents) {
+    EXPECT_FALSE(free.intersects(e.offset, e.length));
+  }
+  copy->shutdown();
+  alloc->shutdown();
+}
 
 INSTANTIATE_TEST_CASE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap"));
+  ::testing::Values("stupid", "bitmap", "hbitmap"));
 
 #else
 
@@ -0,0 +1,440 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Runs a set of transaction workloads against any ObjectStore and reports,
+ * for each one, commit latency percentiles, heap allocations per op, and
+ * the time spent in each state of the store's transaction pipeline (for
+ * BlueStore, the state_*_lat counters updated by _txc_state_proc).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "common/ceph_argparse.h"
+#include "common/debug.h"
+#include "common/obj_bencher.h"
+#include "common/perf_counters.h"
+#include "common/strtol.h"
+#include "global/global_init.h"
+#include "include/stringify.h"
+#include "os/ObjectStore.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_filestore
+
+// count heap allocations made through operator new, by any thread
+static std::atomic<uint64_t> num_allocs = { 0 };
+
+void *operator new(size_t size)
+{
+  ++num_allocs;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+static void usage()
+{
+  derr << "usage: ceph_perf_objectstore_workload [flags]\n"
+      "	 --workloads <list>\n"
+      "	       comma separated, out of seqwrite, randwrite, deferred,\n"
+      "	       direct, omap and clone (default: all of them)\n"
+      "	 --ops <n>\n"
+      "	       transactions per workload (default 10000)\n"
+      "	 --objects <n>\n"
+      "	       number of objects (default 16)\n"
+      "	 --object-size <bytes>\n"
+      "	       size of each object (default 4M)\n"
+      "	 --block-size <bytes>\n"
+      "	       size of each write (default 4K)\n"
+      "	 --queue-depth <n>\n"
+      "	       transactions in flight (default 16)\n"
+      "	 --omap-keys <n>\n"
+      "	       keys set by each omap transaction (default 16)\n"
+      "	 --omap-value-size <bytes>\n"
+      "	       size of each omap value (default 128)\n" << dendl;
+  generic_server_usage();
+}
+
+struct Config {
+  std::vector<std::string> workloads;
+  uint64_t ops = 10000;
+  unsigned objects = 16;
+  uint64_t object_size = 4 << 20;
+  uint64_t block_size = 4096;
+  unsigned queue_depth = 16;
+  unsigned omap_keys = 16;
+  uint64_t omap_value_size = 128;
+};
+
+// keeps queue_depth transactions in flight and records their latency
+class Submitter {
+  ObjectStore *os;
+  ObjectStore::Sequencer osr;
+  const unsigned queue_depth;
+  std::mutex lock;
+  std::condition_variable cond;
+  unsigned in_flight = 0;
+
+  struct C_Committed : public Context {
+    Submitter *s;
+    ceph::mono_time start;
+    C_Committed(Submitter *s, ceph::mono_time start) : s(s), start(start) {}
+    void finish(int r) override {
+      auto lat = ceph::mono_clock::now() - start;
+      std::lock_guard<std::mutex> l(s->lock);
+      s->latency.add(
+	std::chrono::duration_cast<std::chrono::microseconds>(lat).count());
+      --s->in_flight;
+      s->cond.notify_all();
+    }
+  };
+
+public:
+  bench_latency_histogram latency; ///< commit latency, usec
+
+  Submitter(ObjectStore *os, unsigned queue_depth)
+    : os(os), osr("workload"), queue_depth(queue_depth) {}
+
+  void submit(ObjectStore::Transaction&& t) {
+    {
+      std::unique_lock<std::mutex> l(lock);
+      cond.wait(l, [this] { return in_flight < queue_depth; });
+      ++in_flight;
+    }
+    int r = os->queue_transaction(&osr, std::move(t), nullptr,
+				  new C_Committed(this, ceph::mono_clock::now()));
+    assert(r == 0);
+  }
+  void drain() {
+    std::unique_lock<std::mutex> l(lock);
+    cond.wait(l, [this] { return in_flight == 0; });
+    l.unlock();
+    osr.flush();
+  }
+};
+
+// (sum, count) of the store's latency averages, by counter name
+typedef std::map<std::string, std::pair<uint64_t, uint64_t>> lat_snapshot_t;
+
+static lat_snapshot_t snapshot_latencies(ObjectStore *os)
+{
+  lat_snapshot_t snap;
+  const PerfCounters *logger = os->get_perf_counters();
+  if (!logger)
+    return snap;
+  const std::string prefix = logger->get_name() + ".";
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [&](const PerfCountersCollection::CounterMap &counters) {
+      for (auto& i : counters) {
+	auto d = i.second;
+	if (i.first.compare(0, prefix.size(), prefix) != 0 ||
+	    !(d->type & PERFCOUNTER_TIME) ||
+	    !(d->type & PERFCOUNTER_LONGRUNAVG))
+	  continue;
+	snap[i.first.substr(prefix.size())] = d->read_avg();
+      }
+    });
+  return snap;
+}
+
+class Workload {
+  ObjectStore *os;
+  const Config &cfg;
+  const coll_t cid;
+  std::vector<ghobject_t> oids;
+  bufferlist data;
+  std::mt19937_64 rng;
+  uint64_t clones = 0;
+
+  ghobject_t clone_oid(uint64_t n) {
+    return ghobject_t(hobject_t(sobject_t("clone-" + stringify(n), CEPH_NOSNAP)));
+  }
+  uint64_t random_offset() {
+    uint64_t blocks = cfg.object_size / cfg.block_size;
+    return (rng() % blocks) * cfg.block_size;
+  }
+  const ghobject_t& random_object() {
+    return oids[rng() % oids.size()];
+  }
+
+  void set_prefer_deferred_size(uint64_t v) {
+    g_conf->set_val("bluestore_prefer_deferred_size", stringify(v));
+    g_conf->apply_changes(nullptr);
+  }
+
+  void build(const std::string& name, uint64_t i, ObjectStore::Transaction *t) {
+    if (name == "seqwrite") {
+      uint64_t blocks = cfg.object_size / cfg.block_size;
+      uint64_t block = i % (blocks * oids.size());
+      t->write(cid, oids[block / blocks], (block % blocks) * cfg.block_size,
+	       cfg.block_size, data);
+    } else if (name == "randwrite" || name == "deferred" || name == "direct") {
+      t->write(cid, random_object(), random_offset(), cfg.block_size, data);
+    } else if (name == "omap") {
+      bufferlist value;
+      value.append(std::string(cfg.omap_value_size, 'v'));
+      map<string, bufferlist> keys;
+      for (unsigned k = 0; k < cfg.omap_keys; ++k)
+	keys["key-" + stringify(rng() % 4096)] = value;
+      t->omap_setkeys(cid, random_object(), keys);
+    } else if (name == "clone") {
+      // snapshot an object, then overwrite part of the head (copy on write),
+      // keeping at most one clone per object around
+      const ghobject_t& head = random_object();
+      t->clone(cid, head, clone_oid(clones));
+      t->write(cid, head, random_offset(), cfg.block_size, data);
+      if (clones >= oids.size())
+	t->remove(cid, clone_oid(clones - oids.size()));
+      ++clones;
+    } else {
+      assert(0 == "unknown workload");
+    }
+  }
+
+public:
+  Workload(ObjectStore *os, const Config &cfg, coll_t cid)
+    : os(os), cfg(cfg), cid(cid), rng(0x5eed) {
+    data.append(buffer::create(cfg.block_size));
+    data.zero();
+  }
+
+  // create the objects and fill them, so that writes are overwrites
+  void populate() {
+    ObjectStore::Sequencer osr("populate");
+    bufferlist fill;
+    fill.append(buffer::create(cfg.object_size));
+    fill.zero();
+    for (unsigned i = 0; i < cfg.objects; ++i) {
+      oids.emplace_back(hobject_t(sobject_t("object-" + stringify(i), CEPH_NOSNAP)));
+      ObjectStore::Transaction t;
+      t.write(cid, oids.back(), 0, cfg.object_size, fill);
+      int r = os->apply_transaction(&osr, std::move(t));
+      assert(r == 0);
+    }
+  }
+
+  void cleanup() {
+    ObjectStore::Sequencer osr("cleanup");
+    ObjectStore::Transaction t;
+    for (uint64_t n = clones > oids.size() ? clones - oids.size() : 0;
+	 n < clones; ++n)
+      t.remove(cid, clone_oid(n));
+    clones = 0;
+    os->apply_transaction(&osr, std::move(t));
+  }
+
+  void run(const std::string& name, Formatter *f) {
+    uint64_t saved_deferred = g_conf->bluestore_prefer_deferred_size;
+    if (name == "deferred") {
+      // every small write goes through the deferred (wal) path
+      set_prefer_deferred_size(cfg.block_size);
+    } else if (name == "direct") {
+      // nothing is small enough to be deferred
+      set_prefer_deferred_size(1);
+    }
+
+    Submitter submitter(os, cfg.queue_depth);
+    lat_snapshot_t before = snapshot_latencies(os);
+    uint64_t allocs_before = num_allocs;
+    auto start = ceph::mono_clock::now();
+    for (uint64_t i = 0; i < cfg.ops; ++i) {
+      ObjectStore::Transaction t;
+      build(name, i, &t);
+      submitter.submit(std::move(t));
+    }
+    submitter.drain();
+    auto elapsed = ceph::mono_clock::now() - start;
+    uint64_t allocs = num_allocs - allocs_before;
+    lat_snapshot_t after = snapshot_latencies(os);
+
+    if (name == "deferred" || name == "direct")
+      set_prefer_deferred_size(saved_deferred);
+    cleanup();
+
+    double secs = std::chrono::duration<double>(elapsed).count();
+    const bench_latency_histogram& lat = submitter.latency;
+    f->open_object_section("workload");
+    f->dump_string("name", name);
+    f->dump_unsigned("ops", cfg.ops);
+    f->dump_float("seconds", secs);
+    f->dump_float("ops_per_sec", cfg.ops / secs);
+    f->dump_float("allocs_per_op", (double)allocs / cfg.ops);
+    f->open_object_section("commit_latency_ms");
+    f->dump_float("p50", lat.percentile(50) / 1000.0);
+    f->dump_float("p99", lat.percentile(99) / 1000.0);
+    f->dump_float("p99.9", lat.percentile(99.9) / 1000.0);
+    f->dump_float("max", lat.percentile(100) / 1000.0);
+    f->close_section();
+    f->open_object_section("state_latency_ms");
+    for (auto& i : after) {
+      auto b = before.find(i.first);
+      uint64_t sum = i.second.first;
+      uint64_t count = i.second.second;
+      if (b != before.end()) {
+	sum -= b->second.first;
+	count -= b->second.second;
+      }
+      if (!count)
+	continue;
+      f->open_object_section(i.first.c_str());
+      f->dump_unsigned("count", count);
+      f->dump_float("avg", (double)sum / count / 1000000.0);
+      f->close_section();
+    }
+    f->close_section();
+    f->close_section();
+  }
+};
+
+int main(int argc, const char *argv[])
+{
+  Config cfg;
+
+  // command-line arguments
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  env_to_vec(args);
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_OSD,
+			 CODE_ENVIRONMENT_UTILITY, 0);
+
+  std::string val;
+  std::string err;
+  std::string format = "json-pretty";
+  vector<const char*>::iterator i = args.begin();
+  while (i != args.end()) {
+    if (ceph_argparse_double_dash(args, i))
+      break;
+
+    if (ceph_argparse_witharg(args, i, &val, "--workloads", (char*)nullptr)) {
+      get_str_vec(val, ",", cfg.workloads);
+    } else if (ceph_argparse_witharg(args, i, &val, "--ops", (char*)nullptr)) {
+      cfg.ops = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--objects", (char*)nullptr)) {
+      cfg.objects = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--object-size", (char*)nullptr)) {
+      cfg.object_size = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--block-size", (char*)nullptr)) {
+      cfg.block_size = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--queue-depth", (char*)nullptr)) {
+      cfg.queue_depth = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--omap-keys", (char*)nullptr)) {
+      cfg.omap_keys = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--omap-value-size", (char*)nullptr)) {
+      cfg.omap_value_size = strict_sistrtoll(val.c_str(), &err);
+    } else if (ceph_argparse_witharg(args, i, &val, "--format", (char*)nullptr)) {
+      format = val;
+    } else {
+      derr << "Error: can't understand argument: " << *i << "\n" << dendl;
+      usage();
+      return 1;
+    }
+    if (!err.empty()) {
+      derr << "error parsing " << val << ": " << err << dendl;
+      usage();
+      return 1;
+    }
+  }
+  if (cfg.workloads.empty())
+    cfg.workloads = { "seqwrite", "randwrite", "deferred", "direct", "omap", "clone" };
+  for (auto& w : cfg.workloads) {
+    if (w != "seqwrite" && w != "randwrite" && w != "deferred" &&
+	w != "direct" && w != "omap" && w != "clone") {
+      derr << "unknown workload " << w << dendl;
+      usage();
+      return 1;
+    }
+  }
+  if (!cfg.objects || !cfg.queue_depth || !cfg.block_size ||
+      cfg.object_size < cfg.block_size) {
+    derr << "objects, queue depth and block size must be positive, and the "
+	 << "object size at least the block size" << dendl;
+    return 1;
+  }
+
+  common_init_finish(g_ceph_context);
+
+  dout(0) << "objectstore " << g_conf->osd_objectstore << dendl;
+  dout(0) << "data " << g_conf->osd_data << dendl;
+  dout(0) << "journal " << g_conf->osd_journal << dendl;
+
+  auto os = std::unique_ptr<ObjectStore>(
+      ObjectStore::create(g_ceph_context,
+                          g_conf->osd_objectstore,
+                          g_conf->osd_data,
+                          g_conf->osd_journal));
+  if (!os) {
+    derr << "bad objectstore type " << g_conf->osd_objectstore << dendl;
+    return 1;
+  }
+  if (os->mkfs() < 0) {
+    derr << "mkfs failed" << dendl;
+    return 1;
+  }
+  if (os->mount() < 0) {
+    derr << "mount failed" << dendl;
+    return 1;
+  }
+
+  // create a collection
+  spg_t pg;
+  const coll_t cid(pg);
+  {
+    ObjectStore::Sequencer osr(__func__);
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    os->apply_transaction(&osr, std::move(t));
+  }
+
+  std::unique_ptr<Formatter> f(Formatter::create(format, "json-pretty", "json-pretty"));
+  {
+    Workload workload(os.get(), cfg, cid);
+    workload.populate();
+
+    f->open_object_section("objectstore_workloads");
+    f->dump_string("objectstore", g_conf->osd_objectstore);
+    f->dump_unsigned("objects", cfg.objects);
+    f->dump_unsigned("object_size", cfg.object_size);
+    f->dump_unsigned("block_size", cfg.block_size);
+    f->dump_unsigned("queue_depth", cfg.queue_depth);
+    f->open_array_section("workloads");
+    for (auto& w : cfg.workloads) {
+      dout(0) << "running " << w << dendl;
+      workload.run(w, f.get());
+      f->flush(std::cout);
+    }
+    f->close_section();
+    f->close_section();
+    f->flush(std::cout);
+    std::cout << std::endl;
+  }
+
+  os->umount();
+  return 0;
+}
@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <iostream>
+#include <atomic>
+#include <thread>
 #include <time.h>
 #include <sys/mount.h>
 #include <boost/scoped_ptr.hpp>
@@ -2284,6 +2286,141 @@ TEST_P(StoreTest, ZeroLengthWrite) {
   ASSERT_EQ(0, r);
 }
 
+TEST_P(StoreTest, SmallOverwritesInOneTransaction) {
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("small_overwrites", CEPH_NOSNAP)));
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  string expected(8192, 'a');
+  {
+    // repeated partial writes to the same block, a truncate and a
+    // rewrite past it, all in one transaction
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(expected);
+    t.write(cid, hoid, 0, bl.length(), bl);
+    for (unsigned i = 0; i < 16; ++i) {
+      bufferlist p;
+      p.append(string(100, 'b' + i));
+      t.write(cid, hoid, i * 37, p.length(), p);
+      expected.replace(i * 37, 100, string(100, 'b' + i));
+    }
+    t.truncate(cid, hoid, 4000);
+    expected.resize(4000);
+    bufferlist tail;
+    tail.append(string(200, 'z'));
+    t.write(cid, hoid, 4100, tail.length(), tail);
+    expected.append(100, '\0');
+    expected.append(200, 'z');
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    bufferlist in;
+    r = store->read(cid, hoid, 0, expected.size(), in);
+    ASSERT_EQ((int)expected.size(), r);
+    ASSERT_EQ(expected, in.to_str());
+  }
+  {
+    // again after a partial overwrite that reads back cached data
+    ObjectStore::Transaction t;
+    bufferlist p;
+    p.append("0123456789");
+    t.write(cid, hoid, 3995, p.length(), p);
+    expected.replace(3995, 10, "0123456789");
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+    bufferlist in;
+    r = store->read(cid, hoid, 0, expected.size(), in);
+    ASSERT_EQ((int)expected.size(), r);
+    ASSERT_EQ(expected, in.to_str());
+  }
+  {
+    // remove and recreate: no stale data may show through
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    bufferlist p;
+    p.append("fresh");
+    t.write(cid, hoid, 10, p.length(), p);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+    bufferlist in;
+    r = store->read(cid, hoid, 0, 15, in);
+    ASSERT_EQ(15, r);
+    ASSERT_EQ(string(10, '\0') + "fresh", in.to_str());
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTest, DataDigest) {
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("digest", CEPH_NOSNAP)));
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.touch(cid, hoid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ObjectStore::CollectionHandle ch = store->open_collection(cid);
+  // aligned and unaligned extents, holes and overwrites
+  const uint64_t writes[][2] = {
+    { 0, 65536 }, { 131072, 4096 }, { 135168, 100 }, { 200000, 7000 },
+    { 4096, 8192 }, { 300001, 65536 }, { 65536, 1 },
+  };
+  for (auto& w : writes) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    for (uint64_t i = 0; i < w[1]; i++)
+      bl.append((char)(rand() | 1));
+    t.write(cid, hoid, w[0], w[1], bl);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+
+    bufferlist in;
+    r = store->read(cid, hoid, 0, 0, in);
+    ASSERT_LE(0, r);
+    for (uint64_t stride : { 4096ull, 65536ull, 524288ull }) {
+      uint32_t digest = 0;
+      uint64_t size = 0;
+      r = store->data_digest(ch, hoid, stride, 0x1234, &digest, &size);
+      ASSERT_EQ(0, r);
+      ASSERT_EQ(in.crc32c(0x1234), digest) << " stride " << stride;
+      ASSERT_EQ(in.length(), size) << " stride " << stride;
+      r = store->data_digest(ch, hoid, stride, -1, &digest);
+      ASSERT_EQ(0, r);
+      ASSERT_EQ(in.crc32c(-1), digest) << " stride " << stride;
+    }
+  }
+  {
+    uint32_t digest;
+    ghobject_t nope(hobject_t(sobject_t("nope", CEPH_NOSNAP)));
+    r = store->data_digest(ch, nope, 65536, -1, &digest);
+    ASSERT_EQ(-ENOENT, r);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, SimpleAttrTest) {
   ObjectStore::Sequencer osr("test");
   int r;
@@ -2420,6 +2557,83 @@ TEST_P(StoreTest, SimpleListTest) {
   }
 }
 
+TEST_P(StoreTest, PrefetchObjects) {
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 1), shard_id_t(1)));
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  set<ghobject_t> all;
+  {
+    ObjectStore::Transaction t;
+    for (int i=0; i<100; ++i) {
+      ghobject_t hoid(hobject_t(sobject_t("object_" + stringify(i),
+					  CEPH_NOSNAP)),
+		      ghobject_t::NO_GEN, shard_id_t(1));
+      hoid.hobj.pool = 1;
+      all.insert(hoid);
+      bufferlist bl;
+      bl.append(stringify(i));
+      t.write(cid, hoid, 0, bl.length(), bl);
+      t.setattr(cid, hoid, "attr", bl);
+    }
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // start with a cold cache
+  EXPECT_EQ(store->umount(), 0);
+  EXPECT_EQ(store->mount(), 0);
+
+  ObjectStore::CollectionHandle ch = store->open_collection(cid);
+  vector<ghobject_t> objects;
+  ghobject_t next;
+  r = store->collection_list(ch, ghobject_t(), ghobject_t::get_max(),
+			     INT_MAX, &objects, &next);
+  ASSERT_EQ(r, 0);
+  ASSERT_EQ(objects.size(), all.size());
+
+  // a removed object in the batch is ignored
+  ghobject_t gone = objects[10];
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, gone);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  store->prefetch_objects(ch, objects);
+  if (string(GetParam()) == "bluestore") {
+    const PerfCounters* logger = store->get_perf_counters();
+    ASSERT_EQ(logger->get(l_bluestore_onode_prefetched), objects.size() - 1);
+  }
+  for (auto& hoid : objects) {
+    bufferptr bp;
+    r = store->getattr(ch, hoid, "attr", bp);
+    if (hoid == gone) {
+      ASSERT_EQ(r, -ENOENT);
+      continue;
+    }
+    ASSERT_EQ(r, 0);
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, 100, bl);
+    ASSERT_EQ(r, (int)bp.length());
+    ASSERT_EQ(string(bp.c_str(), bp.length()), bl.to_str());
+  }
+  {
+    ObjectStore::Transaction t;
+    for (auto& hoid : all) {
+      if (hoid != gone)
+	t.remove(cid, hoid);
+    }
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, ListEndTest) {
   ObjectStore::Sequencer osr("test");
   int r;
@@ -4231,6 +4445,47 @@ TEST_P(StoreTest, Synthetic) {
   doSyntheticTest(store, 10000, 400*1024, 40*1024, 0);
 }
 
+TEST_P(StoreTest, BluestoreFsckThreads) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  ObjectStore::Sequencer osr("test");
+  int r;
+  // objects spread over several collections, with a clone so that
+  // shared blobs are checked as well
+  for (unsigned p = 0; p < 8; ++p) {
+    coll_t cid(spg_t(pg_t(p, 7), shard_id_t::NO_SHARD));
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 3);
+    for (unsigned i = 0; i < 20; ++i) {
+      ghobject_t hoid(hobject_t(sobject_t("obj" + stringify(i), CEPH_NOSNAP),
+				"", p + (i << 3), 7, ""));
+      bufferlist bl;
+      bl.append(string(0x3000 + i * 0x100, 'a' + i));
+      t.write(cid, hoid, 0, bl.length(), bl);
+      map<string, bufferlist> omap;
+      omap["key"] = bl;
+      t.omap_setkeys(cid, hoid, omap);
+      if (i == 0) {
+	ghobject_t clone = hoid;
+	clone.hobj.snap = 1;
+	t.clone(cid, hoid, clone);
+      }
+    }
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  store->umount();
+  for (auto threads : {"1", "8"}) {
+    g_conf->set_val("bluestore_fsck_threads", threads);
+    g_ceph_context->_conf->apply_changes(NULL);
+    ASSERT_EQ(0, store->fsck(false));
+    ASSERT_EQ(0, store->fsck(true));
+  }
+  g_conf->set_val("bluestore_fsck_threads", "4");
+  g_ceph_context->_conf->apply_changes(NULL);
+  ASSERT_EQ(0, store->mount());
+}
+
 
 TEST_P(StoreTestSpecificAUSize, SyntheticMatrixSharding) {
   if (string(GetParam()) != "bluestore")
@@ -4387,6 +4642,250 @@ TEST_P(StoreTestSpecificAUSize, SyntheticMatrixNoCsum) {
   do_matrix(m, store, doSyntheticTest);
 }
 
+struct CommitOrder {
+  Mutex lock;
+  Cond cond;
+  vector<vector<unsigned>> order;
+  unsigned pending = 0;
+
+  explicit CommitOrder(unsigned n)
+    : lock("CommitOrder::lock"), order(n) {}
+
+  Context *on_commit(unsigned s, unsigned i) {
+    Mutex::Locker l(lock);
+    ++pending;
+    return new FunctionContext([this, s, i](int r) {
+	Mutex::Locker l(lock);
+	order[s].push_back(i);
+	if (--pending == 0)
+	  cond.Signal();
+      });
+  }
+
+  void wait() {
+    Mutex::Locker l(lock);
+    while (pending)
+      cond.Wait(lock);
+  }
+};
+
+TEST_P(StoreTestSpecificAUSize, KVSyncShardCommitOrder) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  // shards are set up at mount
+  g_conf->set_val("bluestore_kv_sync_shards", "4");
+  StartDeferred(0x10000);
+
+  const unsigned num_osr = 4;
+  const unsigned num_txc = 200;
+  int r;
+  vector<std::unique_ptr<ObjectStore::Sequencer>> osrs;
+  vector<coll_t> cids;
+  for (unsigned s = 0; s < num_osr; ++s) {
+    // ps() % 4 puts every sequencer on a shard of its own
+    spg_t pgid(pg_t(s, 452), shard_id_t::NO_SHARD);
+    osrs.emplace_back(new ObjectStore::Sequencer("test"));
+    osrs.back()->shard_hint = pgid;
+    cids.push_back(coll_t(pgid));
+    ObjectStore::Transaction t;
+    t.create_collection(cids.back(), 0);
+    r = apply_transaction(store, osrs.back().get(), std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto make_oid = [](unsigned s, unsigned i) {
+    return ghobject_t(hobject_t("shard_" + stringify(s) + "_" + stringify(i),
+				"", CEPH_NOSNAP, 0, 452, ""),
+		      ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  };
+  auto make_data = [](unsigned s, unsigned i) {
+    bufferlist bl;
+    bl.append(string(0x1000, 'a' + (s * 7 + i) % 26));
+    return bl;
+  };
+  auto verify = [&](unsigned count) {
+    for (unsigned s = 0; s < num_osr; ++s) {
+      for (unsigned i = 0; i < count; ++i) {
+	bufferlist bl;
+	ASSERT_EQ(store->read(cids[s], make_oid(s, i), 0, 0x1000, bl), 0x1000);
+	ASSERT_TRUE(bl_eq(make_data(s, i), bl)) << s << " " << i;
+      }
+    }
+  };
+
+  // every txc creates an object, so nid allocation races across shards;
+  // each sequencer must still see its commits in the order it queued them
+  auto queue_all = [&](unsigned from, unsigned to) {
+    CommitOrder c(num_osr);
+    for (unsigned i = from; i < to; ++i) {
+      for (unsigned s = 0; s < num_osr; ++s) {
+	ObjectStore::Transaction t;
+	bufferlist bl = make_data(s, i);
+	t.write(cids[s], make_oid(s, i), 0, bl.length(), bl);
+	ASSERT_EQ(store->queue_transaction(osrs[s].get(), std::move(t),
+					   nullptr, c.on_commit(s, i)), 0);
+      }
+    }
+    c.wait();
+    for (unsigned s = 0; s < num_osr; ++s) {
+      ASSERT_EQ(c.order[s].size(), to - from);
+      for (unsigned i = from; i < to; ++i) {
+	ASSERT_EQ(c.order[s][i - from], i) << "sequencer " << s;
+      }
+    }
+  };
+  queue_all(0, num_txc);
+  verify(num_txc);
+
+  // nid_max as persisted by the shards must cover every nid handed out
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify(num_txc);
+  queue_all(num_txc, 2 * num_txc);
+  verify(2 * num_txc);
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify(2 * num_txc);
+
+  for (unsigned s = 0; s < num_osr; ++s) {
+    ObjectStore::Transaction t;
+    for (unsigned i = 0; i < 2 * num_txc; ++i) {
+      t.remove(cids[s], make_oid(s, i));
+    }
+    t.remove_collection(cids[s]);
+    r = apply_transaction(store, osrs[s].get(), std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_kv_sync_shards", "1");
+}
+
+TEST_P(StoreTestSpecificAUSize, OnodeLocklessLookupRacesTrim) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  g_conf->set_val("bluestore_cache_onode_lockless_lookup", "true");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 453), shard_id_t::NO_SHARD));
+  const PerfCounters* logger = store->get_perf_counters();
+  const unsigned num_objects = 16;
+  const unsigned num_blocks = 16;
+  const unsigned rounds = 64;
+  vector<ghobject_t> oids;
+  for (unsigned i = 0; i < num_objects; ++i) {
+    oids.push_back(ghobject_t(hobject_t("lockless_" + stringify(i), "",
+					CEPH_NOSNAP, 0, 453, ""),
+			      ghobject_t::NO_GEN, shard_id_t::NO_SHARD));
+  }
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    bufferlist bl;
+    bl.append(string(0x1000, 'z'));
+    for (auto& oid : oids) {
+      t.write(cid, oid, 0, bl.length(), bl);
+    }
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  // readers only look at block 0, which never changes; the trimmer keeps
+  // evicting whatever they and the writer do not hold
+  std::atomic<bool> stop = { false };
+  std::atomic<unsigned> bad_reads = { 0 };
+  vector<std::thread> threads;
+  for (unsigned n = 0; n < 4; ++n) {
+    threads.push_back(std::thread([&, n]() {
+	  bufferlist expected;
+	  expected.append(string(0x1000, 'z'));
+	  for (unsigned i = n; !stop; ++i) {
+	    bufferlist bl;
+	    if (store->read(cid, oids[i % num_objects], 0, 0x1000, bl) != 0x1000 ||
+		!bl_eq(expected, bl)) {
+	      ++bad_reads;
+	    }
+	  }
+	}));
+  }
+  threads.push_back(std::thread([&]() {
+	while (!stop) {
+	  store->flush_cache();
+	}
+      }));
+
+  // the writer's txcs are still in flight (and pin their onodes) while the
+  // trimmer runs; an onode dropped from the map while pinned would be
+  // reloaded stale by the next txc and lose its predecessor's write
+  uint64_t hits = logger->get(l_bluestore_onode_hits);
+  vector<bufferlist> expected(num_objects);
+  for (auto& e : expected) {
+    e.append(string(0x1000, 'z'));
+    e.append_zero((num_blocks - 1) * 0x1000);
+  }
+  C_SaferCond c;
+  for (unsigned round = 0; round < rounds; ++round) {
+    for (unsigned i = 0; i < num_objects; ++i) {
+      ObjectStore::Transaction t;
+      unsigned block = 1 + (round + i) % (num_blocks - 1);
+      bufferlist bl;
+      bl.append(string(0x1000, 'a' + round % 26));
+      t.write(cid, oids[i], block * 0x1000, bl.length(), bl);
+      bufferlist n;
+      n.substr_of(expected[i], 0, block * 0x1000);
+      n.append(bl);
+      bufferlist tail;
+      tail.substr_of(expected[i], (block + 1) * 0x1000,
+		     (num_blocks - block - 1) * 0x1000);
+      n.append(tail);
+      expected[i].swap(n);
+      bool last = round == rounds - 1 && i == num_objects - 1;
+      r = store->queue_transaction(&osr, std::move(t), nullptr,
+				   last ? &c : nullptr);
+      ASSERT_EQ(r, 0);
+    }
+  }
+  ASSERT_EQ(c.wait(), 0);
+  osr.flush();
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(bad_reads, 0u);
+  ASSERT_GT(logger->get(l_bluestore_onode_hits), hits);
+
+  auto verify = [&]() {
+    for (unsigned i = 0; i < num_objects; ++i) {
+      bufferlist bl;
+      ASSERT_EQ(store->read(cid, oids[i], 0, num_blocks * 0x1000, bl),
+		(int)(num_blocks * 0x1000));
+      ASSERT_TRUE(bl_eq(expected[i], bl)) << oids[i];
+    }
+  };
+  verify();
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify();
+
+  {
+    ObjectStore::Transaction t;
+    for (auto& oid : oids) {
+      t.remove(cid, oid);
+    }
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_cache_onode_lockless_lookup", "false");
+  g_conf->apply_changes(NULL);
+}
+
 TEST_P(StoreTestSpecificAUSize, SyntheticMatrixPreferDeferred) {
   if (string(GetParam()) != "bluestore")
     return;
@@ -4404,6 +4903,624 @@ TEST_P(StoreTestSpecificAUSize, SyntheticMatrixPreferDeferred) {
   do_matrix(m, store, doSyntheticTest);
 }
 
+TEST_P(StoreTestSpecificAUSize, BackgroundRecompress) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  StartDeferred(block_size);
+  g_conf->set_val("bluestore_compression_mode", "none");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 448), shard_id_t::NO_SHARD));
+  ghobject_t hoid(hobject_t("recompress", "", CEPH_NOSNAP, 0, 448, ""),
+		  ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  const PerfCounters* logger = store->get_perf_counters();
+  const unsigned blocks = 64;
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // lay the object down one block at a time, out of order, so that it
+  // ends up in many small uncompressed blobs
+  bufferlist expected;
+  expected.append(string(blocks * block_size, 'a'));
+  for (unsigned i = 0; i < blocks; ++i) {
+    unsigned b = (i * 37) % blocks;
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.substr_of(expected, b * block_size, block_size);
+    t.write(cid, hoid, b * block_size, bl.length(), bl);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  g_conf->set_val("bluestore_compression_mode", "force");
+  g_conf->set_val("bluestore_recompress_cold_only", "false");
+  g_conf->set_val("bluestore_recompress_max_bytes_per_sec", "0");
+  g_conf->set_val("bluestore_recompress_interval", ".1");
+  g_conf->apply_changes(NULL);
+
+  for (int i = 0; i < 100 &&
+	 logger->get(l_bluestore_recompress_objects) == 0; ++i) {
+    usleep(100000);
+  }
+  g_conf->set_val("bluestore_recompress_interval", "0");
+  g_conf->apply_changes(NULL);
+  ASSERT_GT(logger->get(l_bluestore_recompress_objects), 0u);
+  ASSERT_GE(logger->get(l_bluestore_recompress_bytes), blocks * block_size);
+
+  {
+    bufferlist bl;
+    r = store->read(cid, hoid, 0, blocks * block_size, bl);
+    ASSERT_EQ(r, (int)(blocks * block_size));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    struct store_statfs_t statfs;
+    r = store->statfs(&statfs);
+    ASSERT_EQ(r, 0);
+    ASSERT_GT(statfs.compressed_original, 0);
+    ASSERT_LT(statfs.compressed_allocated, (int64_t)(blocks * block_size));
+  }
+  // survives a remount
+  EXPECT_EQ(store->umount(), 0);
+  EXPECT_EQ(store->mount(), 0);
+  {
+    bufferlist bl;
+    r = store->read(cid, hoid, 0, blocks * block_size, bl);
+    ASSERT_EQ(r, (int)(blocks * block_size));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_compression_mode", "none");
+  g_conf->set_val("bluestore_recompress_cold_only", "true");
+  g_conf->set_val("bluestore_recompress_max_bytes_per_sec",
+		  stringify(8*1024*1024));
+  g_conf->apply_changes(NULL);
+}
+
+#if defined(HAVE_LIBAIO)
+static void write_pattern(ObjectStore *store, ObjectStore::Sequencer *osr,
+			  const coll_t& cid, const ghobject_t& hoid,
+			  uint64_t offset, uint64_t length, char c,
+			  bufferlist *expected)
+{
+  bufferlist bl;
+  bl.append(string(length, c));
+  ObjectStore::Transaction t;
+  t.write(cid, hoid, offset, bl.length(), bl);
+  int r = apply_transaction(store, osr, std::move(t));
+  ASSERT_EQ(r, 0);
+  if (expected->length() < offset + length) {
+    expected->append_zero(offset + length - expected->length());
+  }
+  bufferlist n;
+  n.substr_of(*expected, 0, offset);
+  n.append(bl);
+  if (expected->length() > offset + length) {
+    bufferlist tail;
+    tail.substr_of(*expected, offset + length,
+		   expected->length() - offset - length);
+    n.append(tail);
+  }
+  expected->swap(n);
+}
+
+static void verify_pattern(ObjectStore *store, const coll_t& cid,
+			   const ghobject_t& hoid, const bufferlist& expected)
+{
+  bufferlist bl;
+  int r = store->read(cid, hoid, 0, expected.length(), bl);
+  ASSERT_EQ(r, (int)expected.length());
+  ASSERT_TRUE(bl_eq(expected, bl));
+}
+
+TEST_P(StoreTestSpecificAUSize, AllocSnapshotRoundTrip) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  // fsck opens (and so consumes) the snapshot itself
+  g_conf->set_val("bluestore_fsck_on_mount", "false");
+  g_conf->set_val("bluestore_fsck_on_umount", "false");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 449), shard_id_t::NO_SHARD));
+  ghobject_t a(hobject_t("snap_a", "", CEPH_NOSNAP, 0, 449, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  ghobject_t b(hobject_t("snap_b", "", CEPH_NOSNAP, 0, 449, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  const PerfCounters* logger = store->get_perf_counters();
+  bufferlist expected_a, expected_b;
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  write_pattern(store.get(), &osr, cid, a, 0, 0x40000, 'a', &expected_a);
+
+  uint64_t loaded = logger->get(l_bluestore_alloc_snapshot_loaded);
+  uint64_t rejected = logger->get(l_bluestore_alloc_snapshot_rejected);
+  EXPECT_EQ(store->umount(), 0);
+  EXPECT_EQ(store->mount(), 0);
+  ASSERT_EQ(loaded + 1, logger->get(l_bluestore_alloc_snapshot_loaded));
+  ASSERT_EQ(rejected, logger->get(l_bluestore_alloc_snapshot_rejected));
+
+  // space handed out from the loaded snapshot must not overlap live data
+  write_pattern(store.get(), &osr, cid, b, 0, 0x40000, 'b', &expected_b);
+  write_pattern(store.get(), &osr, cid, a, 0x10000, 0x10000, 'c',
+		&expected_a);
+  verify_pattern(store.get(), cid, a, expected_a);
+  verify_pattern(store.get(), cid, b, expected_b);
+
+  // the snapshot is single use: a crash now must not find it again
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify_pattern(store.get(), cid, a, expected_a);
+  verify_pattern(store.get(), cid, b, expected_b);
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, a);
+    t.remove(cid, b);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_fsck_on_mount", "true");
+  g_conf->set_val("bluestore_fsck_on_umount", "true");
+  g_conf->apply_changes(NULL);
+}
+
+TEST_P(StoreTestSpecificAUSize, AllocSnapshotStaleAfterKVCommit) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  g_conf->set_val("bluestore_fsck_on_mount", "false");
+  g_conf->set_val("bluestore_fsck_on_umount", "false");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 450), shard_id_t::NO_SHARD));
+  ghobject_t a(hobject_t("stale_a", "", CEPH_NOSNAP, 0, 450, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  ghobject_t b(hobject_t("stale_b", "", CEPH_NOSNAP, 0, 450, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  const PerfCounters* logger = store->get_perf_counters();
+  bufferlist expected_a, expected_b;
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  write_pattern(store.get(), &osr, cid, a, 0, 0x40000, 'a', &expected_a);
+  EXPECT_EQ(store->umount(), 0);
+
+  // commit behind the snapshot's back, as an offline tool would
+  BlueStore *bstore = static_cast<BlueStore*>(store.get());
+  KeyValueDB *db = nullptr;
+  ASSERT_EQ(bstore->start_kv_only(&db), 0);
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist bl;
+    bl.append("x");
+    t->set("S", "test_kv_only_write", bl);
+    ASSERT_EQ(db->submit_transaction_sync(t), 0);
+  }
+  bstore->stop_kv_only();
+
+  uint64_t loaded = logger->get(l_bluestore_alloc_snapshot_loaded);
+  uint64_t rejected = logger->get(l_bluestore_alloc_snapshot_rejected);
+  EXPECT_EQ(store->mount(), 0);
+  ASSERT_EQ(loaded, logger->get(l_bluestore_alloc_snapshot_loaded));
+  ASSERT_EQ(rejected + 1, logger->get(l_bluestore_alloc_snapshot_rejected));
+
+  write_pattern(store.get(), &osr, cid, b, 0, 0x40000, 'b', &expected_b);
+  verify_pattern(store.get(), cid, a, expected_a);
+  verify_pattern(store.get(), cid, b, expected_b);
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, a);
+    t.remove(cid, b);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_fsck_on_mount", "true");
+  g_conf->set_val("bluestore_fsck_on_umount", "true");
+  g_conf->apply_changes(NULL);
+}
+
+TEST_P(StoreTestSpecificAUSize, DeferredReplayAsync) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  // fsck would replay the deferred writes synchronously
+  g_conf->set_val("bluestore_fsck_on_mount", "false");
+  g_conf->set_val("bluestore_fsck_on_umount", "false");
+  g_conf->set_val("bluestore_deferred_replay_async", "true");
+  g_conf->set_val("bluestore_compression_mode", "none");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 451), shard_id_t::NO_SHARD));
+  ghobject_t hoid(hobject_t("replay", "", CEPH_NOSNAP, 0, 451, ""),
+		  ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  const PerfCounters* logger = store->get_perf_counters();
+  bufferlist expected;
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  write_pattern(store.get(), &osr, cid, hoid, 0, 0x20000, 'a', &expected);
+
+  // small overwrites go deferred; leave them in the kv store only, as a
+  // crash before they were applied would
+  g_conf->set_val("bluestore_debug_omit_deferred_apply", "true");
+  g_conf->apply_changes(NULL);
+  uint64_t deferred = logger->get(l_bluestore_write_small_deferred);
+  write_pattern(store.get(), &osr, cid, hoid, 0x2000, 0x1000, 'b', &expected);
+  write_pattern(store.get(), &osr, cid, hoid, 0x13000, 0x1000, 'c',
+		&expected);
+  ASSERT_GT(logger->get(l_bluestore_write_small_deferred), deferred);
+  EXPECT_EQ(store->umount(), 0);
+  g_conf->set_val("bluestore_debug_omit_deferred_apply", "false");
+  g_conf->apply_changes(NULL);
+
+  // mount returns before the replay is done; reads must wait for it
+  EXPECT_EQ(store->mount(), 0);
+  verify_pattern(store.get(), cid, hoid, expected);
+  write_pattern(store.get(), &osr, cid, hoid, 0x8000, 0x1000, 'd', &expected);
+  verify_pattern(store.get(), cid, hoid, expected);
+
+  // and the replayed records are gone once applied
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(true), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify_pattern(store.get(), cid, hoid, expected);
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_fsck_on_mount", "true");
+  g_conf->set_val("bluestore_fsck_on_umount", "true");
+  g_conf->apply_changes(NULL);
+}
+
+TEST_P(StoreTestSpecificAUSize, ExtentMapInlineRelease) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  g_conf->set_val("bluestore_extent_map_inline_cache", "false");
+  g_conf->set_val("bluestore_compression_mode", "none");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 454), shard_id_t::NO_SHARD));
+  ghobject_t a(hobject_t("inline_a", "", CEPH_NOSNAP, 0, 454, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  ghobject_t b(hobject_t("inline_b", "", CEPH_NOSNAP, 0, 454, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  const PerfCounters* logger = store->get_perf_counters();
+  bufferlist expected_a, expected_b;
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  // each persist releases exactly the encoding it wrote, less the 32-bit
+  // length denc puts in front of it
+  uint64_t written = logger->get(l_bluestore_extent_map_inline_bytes);
+  uint64_t released = logger->get(l_bluestore_extent_map_inline_released);
+  for (unsigned i = 0; i < 8; ++i) {
+    write_pattern(store.get(), &osr, cid, a, i * 0x4000, 0x1000, 'a' + i,
+		  &expected_a);
+    uint64_t w = logger->get(l_bluestore_extent_map_inline_bytes) - written;
+    uint64_t rel =
+      logger->get(l_bluestore_extent_map_inline_released) - released;
+    ASSERT_GT(w, sizeof(uint32_t));
+    ASSERT_EQ(rel, w - sizeof(uint32_t)) << "write " << i;
+    written += w;
+    released += rel;
+  }
+  verify_pattern(store.get(), cid, a, expected_a);
+
+  // a load from disk releases the decoded encoding too; the next write
+  // must rebuild it from the extents, not persist an empty map
+  store->flush_cache();
+  verify_pattern(store.get(), cid, a, expected_a);
+  ASSERT_EQ(written, logger->get(l_bluestore_extent_map_inline_bytes));
+  ASSERT_GT(logger->get(l_bluestore_extent_map_inline_released), released);
+  released = logger->get(l_bluestore_extent_map_inline_released);
+  write_pattern(store.get(), &osr, cid, a, 0x2000, 0x1000, 'x', &expected_a);
+  verify_pattern(store.get(), cid, a, expected_a);
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify_pattern(store.get(), cid, a, expected_a);
+
+  // with the cache on, nothing is released
+  g_conf->set_val("bluestore_extent_map_inline_cache", "true");
+  g_conf->apply_changes(NULL);
+  written = logger->get(l_bluestore_extent_map_inline_bytes);
+  released = logger->get(l_bluestore_extent_map_inline_released);
+  write_pattern(store.get(), &osr, cid, a, 0x6000, 0x1000, 'y', &expected_a);
+  ASSERT_GT(logger->get(l_bluestore_extent_map_inline_bytes), written);
+  ASSERT_EQ(released, logger->get(l_bluestore_extent_map_inline_released));
+
+  // a sharded map has no inline encoding to account for
+  g_conf->set_val("bluestore_extent_map_inline_cache", "false");
+  g_conf->apply_changes(NULL);
+  uint64_t reshards = logger->get(l_bluestore_onode_reshard);
+  {
+    ObjectStore::Transaction t;
+    for (unsigned i = 0; i < 512; ++i) {
+      bufferlist bl;
+      bl.append(string(0x1000, 'a' + i % 26));
+      t.write(cid, b, i * 0x2000, bl.length(), bl);
+      if (i) {
+	expected_b.append_zero(0x1000);
+      }
+      expected_b.append(bl);
+    }
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_GT(logger->get(l_bluestore_onode_reshard), reshards);
+  written = logger->get(l_bluestore_extent_map_inline_bytes);
+  released = logger->get(l_bluestore_extent_map_inline_released);
+  write_pattern(store.get(), &osr, cid, b, 0x1000, 0x1000, 'z', &expected_b);
+  ASSERT_EQ(written, logger->get(l_bluestore_extent_map_inline_bytes));
+  store->flush_cache();
+  verify_pattern(store.get(), cid, b, expected_b);
+  ASSERT_EQ(released, logger->get(l_bluestore_extent_map_inline_released));
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify_pattern(store.get(), cid, a, expected_a);
+  verify_pattern(store.get(), cid, b, expected_b);
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, a);
+    t.remove(cid, b);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_extent_map_inline_cache", "true");
+  g_conf->apply_changes(NULL);
+}
+
+TEST_P(StoreTestSpecificAUSize, DeferredAggregateAcrossSequencers) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  // keep every sequencer's batch pending until umount drains them together
+  g_conf->set_val("bluestore_deferred_batch_ops", "1024");
+  g_conf->set_val("bluestore_deferred_aggregate_max_bytes", "1048576");
+  g_conf->set_val("bluestore_compression_mode", "none");
+  g_conf->apply_changes(NULL);
+
+  const unsigned num_osr = 4;
+  int r;
+  const PerfCounters* logger = store->get_perf_counters();
+  vector<std::unique_ptr<ObjectStore::Sequencer>> osrs;
+  vector<coll_t> cids;
+  vector<ghobject_t> oids;
+  vector<bufferlist> expected(num_osr);
+  for (unsigned s = 0; s < num_osr; ++s) {
+    osrs.emplace_back(new ObjectStore::Sequencer("test"));
+    cids.push_back(coll_t(spg_t(pg_t(s, 455), shard_id_t::NO_SHARD)));
+    oids.push_back(ghobject_t(hobject_t("aggregate_" + stringify(s), "",
+					CEPH_NOSNAP, 0, 455, ""),
+			      ghobject_t::NO_GEN, shard_id_t::NO_SHARD));
+    ObjectStore::Transaction t;
+    t.create_collection(cids[s], 0);
+    r = apply_transaction(store, osrs[s].get(), std::move(t));
+    ASSERT_EQ(r, 0);
+    write_pattern(store.get(), osrs[s].get(), cids[s], oids[s], 0, 0x10000,
+		  'a', &expected[s]);
+  }
+
+  // small overwrites of allocated space are deferred; queue them from all
+  // sequencers before any of them is submitted
+  auto overwrite_all = [&](char c) {
+    uint64_t deferred = logger->get(l_bluestore_write_small_deferred);
+    for (unsigned i = 0; i < 4; ++i) {
+      for (unsigned s = 0; s < num_osr; ++s) {
+	write_pattern(store.get(), osrs[s].get(), cids[s], oids[s],
+		      (i * num_osr + s) * 0x1000, 0x1000, c + i, &expected[s]);
+      }
+    }
+    ASSERT_EQ(logger->get(l_bluestore_write_small_deferred),
+	      deferred + 4 * num_osr);
+  };
+  auto verify_all = [&]() {
+    for (unsigned s = 0; s < num_osr; ++s) {
+      verify_pattern(store.get(), cids[s], oids[s], expected[s]);
+    }
+  };
+
+  uint64_t merged = logger->get(l_bluestore_deferred_write_merged);
+  overwrite_all('b');
+  verify_all();
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_GT(logger->get(l_bluestore_deferred_write_merged), merged);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify_all();
+
+  // a group never grows past the limit, so batches bigger than it go
+  // out one by one
+  g_conf->set_val("bluestore_deferred_aggregate_max_bytes", "4096");
+  g_conf->apply_changes(NULL);
+  merged = logger->get(l_bluestore_deferred_write_merged);
+  overwrite_all('k');
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(logger->get(l_bluestore_deferred_write_merged), merged);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  verify_all();
+
+  for (unsigned s = 0; s < num_osr; ++s) {
+    ObjectStore::Transaction t;
+    t.remove(cids[s], oids[s]);
+    t.remove_collection(cids[s]);
+    r = apply_transaction(store, osrs[s].get(), std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_deferred_batch_ops", "0");
+  g_conf->set_val("bluestore_deferred_aggregate_max_bytes", "0");
+  g_conf->apply_changes(NULL);
+}
+
+TEST_P(StoreTestSpecificAUSize, ReadCoalesceAndReadahead) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(0x10000);
+  g_conf->set_val("bluestore_compression_mode", "none");
+  g_conf->set_val("bluestore_read_coalesce_gap", "65536");
+  g_conf->apply_changes(NULL);
+
+  ObjectStore::Sequencer osr("test");
+  int r;
+  coll_t cid(spg_t(pg_t(0, 456), shard_id_t::NO_SHARD));
+  ghobject_t a(hobject_t("coalesce_a", "", CEPH_NOSNAP, 0, 456, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  ghobject_t b(hobject_t("coalesce_b", "", CEPH_NOSNAP, 0, 456, ""),
+	       ghobject_t::NO_GEN, shard_id_t::NO_SHARD);
+  const PerfCounters* logger = store->get_perf_counters();
+  const unsigned chunks = 16;
+  const uint64_t chunk = 0x10000;
+  bufferlist expected_a, expected_b;
+
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // interleave the two objects on disk so a's extents have gaps between
+  // them that a coalesced read has to read through and throw away
+  for (unsigned i = 0; i < chunks; ++i) {
+    write_pattern(store.get(), &osr, cid, a, i * chunk, chunk, 'a' + i,
+		  &expected_a);
+    write_pattern(store.get(), &osr, cid, b, i * chunk, chunk, 'A' + i,
+		  &expected_b);
+  }
+
+  auto read_range = [&](uint64_t off, uint64_t len, uint32_t flags) {
+    bufferlist bl, e;
+    ASSERT_EQ(store->read(cid, a, off, len, bl, flags), (int)len);
+    e.substr_of(expected_a, off, len);
+    ASSERT_TRUE(bl_eq(e, bl)) << std::hex << off << "~" << len;
+  };
+
+  uint64_t coalesced = logger->get(l_bluestore_read_coalesced_ios);
+  store->flush_cache();
+  verify_pattern(store.get(), cid, a, expected_a);
+  ASSERT_GT(logger->get(l_bluestore_read_coalesced_ios), coalesced);
+  store->flush_cache();
+  read_range(0x3000, 0x51234, 0);
+  store->flush_cache();
+  verify_pattern(store.get(), cid, b, expected_b);
+
+  // no io may grow past bluestore_read_coalesce_max
+  g_conf->set_val("bluestore_read_coalesce_max", "4096");
+  g_conf->apply_changes(NULL);
+  coalesced = logger->get(l_bluestore_read_coalesced_ios);
+  store->flush_cache();
+  verify_pattern(store.get(), cid, a, expected_a);
+  ASSERT_EQ(coalesced, logger->get(l_bluestore_read_coalesced_ios));
+  g_conf->set_val("bluestore_read_coalesce_max", "1048576");
+  g_conf->apply_changes(NULL);
+
+  // a sequential reader gets up to bluestore_readahead_size more, but
+  // never past the end of the object
+  const uint64_t readahead = 2 * chunk;
+  g_conf->set_val("bluestore_readahead_size", stringify(readahead));
+  g_conf->apply_changes(NULL);
+  store->flush_cache();
+  for (unsigned i = 0; i < chunks; ++i) {
+    uint64_t before = logger->get(l_bluestore_readahead_bytes);
+    read_range(i * chunk, chunk, 0);
+    uint64_t left = (chunks - i - 1) * chunk;
+    ASSERT_EQ(logger->get(l_bluestore_readahead_bytes) - before,
+	      std::min(readahead, left)) << "chunk " << i;
+  }
+
+  // random and non-sequential reads do not read ahead
+  uint64_t before = logger->get(l_bluestore_readahead_bytes);
+  store->flush_cache();
+  read_range(0, chunk, CEPH_OSD_OP_FLAG_FADVISE_RANDOM);
+  read_range(5 * chunk + 0x800, 0x1000, 0);
+  read_range(2 * chunk, chunk, CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
+  ASSERT_EQ(before, logger->get(l_bluestore_readahead_bytes));
+
+  // what was read ahead into the cache is what is on disk
+  store->flush_cache();
+  read_range(0, chunk, CEPH_OSD_OP_FLAG_FADVISE_SEQUENTIAL);
+  ASSERT_GT(logger->get(l_bluestore_readahead_bytes), before);
+  read_range(chunk, 2 * chunk, 0);
+  verify_pattern(store.get(), cid, a, expected_a);
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, a);
+    t.remove(cid, b);
+    t.remove_collection(cid);
+    r = apply_transaction(store, &osr, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  g_conf->set_val("bluestore_readahead_size", "0");
+  g_conf->set_val("bluestore_read_coalesce_gap", "32768");
+  g_conf->apply_changes(NULL);
+}
+#endif
+
 TEST_P(StoreTest, AttrSynthetic) {
   ObjectStore::Sequencer osr("test");
   MixedGenerator gen(447);
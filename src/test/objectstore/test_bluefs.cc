@@ -246,6 +246,55 @@ void join_all(std::vector<std::thread>& v)
 #define NUM_SINGLE_FILE_WRITERS 1
 #define NUM_MULTIPLE_FILE_WRITERS 2
 
+TEST(BlueFS, cold_file_placement) {
+  uint64_t size = 1048576 * 128;
+  string fn = get_temp_bdev(size);
+  string slow_fn = get_temp_bdev(size);
+  g_ceph_context->_conf->set_val(
+    "bluefs_db_hot_reserve_ratio",
+    "1");
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, fn));
+  fs.add_block_extent(BlueFS::BDEV_DB, 1048576, size - 1048576);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_SLOW, slow_fn));
+  fs.add_block_extent(BlueFS::BDEV_SLOW, 1048576, size - 1048576);
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+  {
+    // hot files stay on the db device
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("dir", "hot", &h, false));
+    h->append("foo", 3);
+    fs.fsync(h);
+    for (auto& e : h->file->fnode.extents)
+      ASSERT_EQ((int)BlueFS::BDEV_DB, (int)e.bdev);
+    fs.close_writer(h);
+  }
+  {
+    // with the db below its hot reserve, cold files go to the slow device
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("dir", "cold", &h, false));
+    fs.set_cold(h);
+    h->append("bar", 3);
+    fs.fsync(h);
+    ASSERT_FALSE(h->file->fnode.extents.empty());
+    for (auto& e : h->file->fnode.extents)
+      ASSERT_EQ((int)BlueFS::BDEV_SLOW, (int)e.bdev);
+    fs.close_writer(h);
+  }
+  fs.umount();
+  g_ceph_context->_conf->set_val(
+    "bluefs_db_hot_reserve_ratio",
+    ".1");
+  g_ceph_context->_conf->apply_changes(NULL);
+  rm_temp_bdev(fn);
+  rm_temp_bdev(slow_fn);
+}
+
 TEST(BlueFS, test_flush_1) {
   uint64_t size = 1048576 * 128;
   string fn = get_temp_bdev(size);
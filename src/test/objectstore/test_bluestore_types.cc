@@ -306,6 +306,58 @@ TEST(bluestore_blob_t, calc_csum)
   }
 }
 
+TEST(bluestore_blob_t, verify_csum_fragmented)
+{
+  // 300 4k blocks spread over buffers that do not line up with the
+  // csum blocks, so verify has to mix batched and per-block paths.
+  const unsigned block = 4096;
+  const unsigned nblocks = 300;
+  bufferptr bp(block * nblocks);
+  for (unsigned i = 0; i < bp.length(); ++i)
+    bp.c_str()[i] = (i * 7 + (i >> 12)) & 0xff;
+  bufferlist whole;
+  whole.append(bp);
+  bufferlist frag;
+  unsigned pos = 0;
+  unsigned step = 1000;
+  while (pos < whole.length()) {
+    unsigned l = std::min(step, whole.length() - pos);
+    bufferlist t;
+    t.substr_of(whole, pos, l);
+    frag.claim_append(t);
+    pos += l;
+    step = step * 3 + 17;
+  }
+  ASSERT_EQ(whole.length(), frag.length());
+  ASSERT_GT(frag.get_num_buffers(), 1u);
+
+  for (unsigned csum_type = Checksummer::CSUM_NONE + 1;
+       csum_type < Checksummer::CSUM_MAX;
+       ++csum_type) {
+    cout << "csum_type " << Checksummer::get_csum_type_string(csum_type)
+	 << std::endl;
+    bluestore_blob_t b;
+    int bad_off;
+    uint64_t bad_csum;
+    b.init_csum(csum_type, 12, whole.length());
+    b.calc_csum(0, frag);
+    ASSERT_EQ(0, b.verify_csum(0, whole, &bad_off, &bad_csum));
+    ASSERT_EQ(-1, bad_off);
+    b.calc_csum(0, whole);
+    ASSERT_EQ(0, b.verify_csum(0, frag, &bad_off, &bad_csum));
+    ASSERT_EQ(-1, bad_off);
+
+    for (unsigned bad : {0u, 5u, 63u, 64u, 199u, nblocks - 1}) {
+      bufferptr c(bp.c_str(), bp.length());
+      c.c_str()[bad * block + 123] ^= 1;
+      bufferlist corrupt;
+      corrupt.append(c);
+      ASSERT_EQ(-1, b.verify_csum(0, corrupt, &bad_off, &bad_csum));
+      ASSERT_EQ((int)(bad * block), bad_off);
+    }
+  }
+}
+
 TEST(bluestore_blob_t, csum_bench)
 {
   bufferlist bl;
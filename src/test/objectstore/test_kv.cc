@@ -308,6 +308,174 @@ TEST_P(KVTest, RMRange) {
   fini();
 }
 
+TEST_P(KVTest, ColumnFamilies) {
+  // backends without column families keep every prefix together; the
+  // results must be the same either way
+  shared_ptr<KeyValueDB::MergeOperator> p(new AppendMOP);
+  bool have_merge = db->set_merge_operator("A", p) == 0;
+  vector<KeyValueDB::ColumnFamily> cfs;
+  ASSERT_EQ(0, KeyValueDB::parse_column_families(
+	      "cf1= A=write_buffer_size=1048576", &cfs));
+  ASSERT_EQ(2u, cfs.size());
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist v1, v2, v3;
+    v1.append(string("1"));
+    v2.append(string("2"));
+    v3.append(string("3"));
+    t->set("P", "K1", v1);
+    t->set("cf1", "K2", v2);
+    t->set("cf1", "K1", v1);
+    t->set("cf10", "K3", v3);
+    if (have_merge)
+      t->merge("A", "A1", v3);
+    db->submit_transaction_sync(t);
+  }
+  {
+    KeyValueDB::Iterator it = db->get_iterator("cf1");
+    it->seek_to_first();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("K1", it->key());
+    ASSERT_EQ("cf1", it->raw_key().first);
+    it->next();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("K2", it->key());
+    ASSERT_EQ("2", tostr(it->value()));
+    it->next();
+    ASSERT_FALSE(it->valid());
+
+    it->upper_bound("K1");
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("K2", it->key());
+    it->seek_to_last();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("K2", it->key());
+  }
+  fini();
+
+  // reopen; the column families come back with the data in them
+  init();
+  if (have_merge)
+    db->set_merge_operator("A", p);
+  ASSERT_EQ(0, db->open(cout, cfs));
+  {
+    bufferlist v1, v2, v3;
+    ASSERT_EQ(0, db->get("P", "K1", &v1));
+    ASSERT_EQ("1", tostr(v1));
+    ASSERT_EQ(0, db->get("cf1", "K2", &v2));
+    ASSERT_EQ("2", tostr(v2));
+    ASSERT_EQ(0, db->get("cf10", "K3", &v3));
+    ASSERT_EQ("3", tostr(v3));
+    if (have_merge) {
+      bufferlist v;
+      ASSERT_EQ(0, db->get("A", "A1", &v));
+      ASSERT_EQ("?3", tostr(v));
+    }
+  }
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rmkeys_by_prefix("cf1");
+    db->submit_transaction_sync(t);
+    bufferlist v1, v2;
+    ASSERT_EQ(-ENOENT, db->get("cf1", "K1", &v1));
+    ASSERT_EQ(0, db->get("P", "K1", &v2));
+    KeyValueDB::Iterator it = db->get_iterator("cf1");
+    it->seek_to_first();
+    ASSERT_FALSE(it->valid());
+  }
+  fini();
+}
+
+TEST_P(KVTest, BoundedIterator) {
+  // the extractor takes the prefix plus the 4 byte object name below
+  fini();
+  g_ceph_context->_conf->set_val("rocksdb_prefix_extractor_key_bytes", "4");
+  init();
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist v;
+    v.append("v");
+    t->set("P", "obj0.a", v);
+    t->set("P", "obj1-", v);
+    t->set("P", "obj1.a", v);
+    t->set("P", "obj1.b", v);
+    t->set("P", "obj2.a", v);
+    t->set("Q", "obj1.c", v);
+    db->submit_transaction_sync(t);
+  }
+  {
+    KeyValueDB::Iterator it = db->get_bounded_iterator("P", "obj1", "obj1~");
+    it->lower_bound("obj1");
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("obj1-", it->key());
+    it->upper_bound("obj1.");
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("obj1.a", it->key());
+    it->next();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("obj1.b", it->key());
+    it->next();
+    ASSERT_FALSE(it->valid());
+  }
+  {
+    KeyValueDB::Iterator it = db->get_bounded_iterator("P", string(), string());
+    int n = 0;
+    for (it->seek_to_first(); it->valid(); it->next())
+      ++n;
+    ASSERT_EQ(4, n);
+  }
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("P", "obj1", "obj1~");
+    db->submit_transaction_sync(t);
+    KeyValueDB::Iterator it = db->get_bounded_iterator("P", "obj1", "obj1~");
+    it->lower_bound("obj1");
+    ASSERT_FALSE(it->valid());
+    bufferlist v;
+    ASSERT_EQ(0, db->get("P", "obj2.a", &v));
+    ASSERT_EQ(0, db->get("Q", "obj1.c", &v));
+  }
+  fini();
+  g_ceph_context->_conf->set_val("rocksdb_prefix_extractor_key_bytes", "-1");
+}
+
+TEST_P(KVTest, ReadaheadIterator) {
+  // switch to the readahead iterator after a few keys
+  fini();
+  g_ceph_context->_conf->set_val("rocksdb_iterator_readahead_after", "4");
+  init();
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist v;
+    v.append("v");
+    for (int i = 0; i < 100; ++i) {
+      char k[16];
+      snprintf(k, sizeof(k), "k%04d", i);
+      t->set("P", k, v);
+    }
+    t->set("Q", "k0050", v);
+    db->submit_transaction_sync(t);
+  }
+  {
+    KeyValueDB::Iterator it = db->get_bounded_iterator("P", "k0010", "k0090");
+    int n = 10;
+    // only rocksdb enforces the bounds
+    for (it->lower_bound("k0010"); it->valid() && it->key() < "k0090";
+	 it->next(), ++n) {
+      char k[16];
+      snprintf(k, sizeof(k), "k%04d", n);
+      ASSERT_EQ(string(k), it->key());
+      ASSERT_EQ("P", it->raw_key().first);
+    }
+    ASSERT_EQ(90, n);
+  }
+  fini();
+  g_ceph_context->_conf->set_val("rocksdb_iterator_readahead_after", "64");
+}
+
 
 INSTANTIATE_TEST_CASE_P(
   KeyValueDB,
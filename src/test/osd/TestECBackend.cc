@@ -58,3 +58,36 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECUtil, read_latency_t)
+{
+  ECUtil::read_latency_t l(0.5, 1000);
+  ASSERT_EQ(0u, l.get_samples());
+  ASSERT_EQ(0.0, l.get(1));
+  ASSERT_EQ(0.0, l.get_quantile(0.99));
+
+  // ewma per osd
+  l.add(1, 0.001);
+  ASSERT_DOUBLE_EQ(0.001, l.get(1));
+  l.add(1, 0.003);
+  ASSERT_DOUBLE_EQ(0.002, l.get(1));
+  ASSERT_EQ(0.0, l.get(2));
+
+  // 98 fast samples and 2 slow ones: p50 is fast, p99 slow
+  l.clear();
+  for (unsigned i = 0; i < 98; ++i)
+    l.add(1, 0.0001);
+  l.add(2, 0.1);
+  l.add(2, 0.1);
+  ASSERT_EQ(100u, l.get_samples());
+  ASSERT_LE(l.get_quantile(0.5), 0.001);
+  ASSERT_GE(l.get_quantile(0.5), 0.0001);
+  ASSERT_GE(l.get_quantile(0.99), 0.1);
+  ASSERT_LE(l.get_quantile(0.99), 0.2);
+
+  // the histogram decays instead of growing without bound
+  for (unsigned i = 0; i < 5000; ++i)
+    l.add(3, 0.0001);
+  ASSERT_LT(l.get_samples(), 1000u);
+  ASSERT_LE(l.get_quantile(0.99), 0.001);
+}
@@ -224,6 +224,28 @@ TEST_F(OSDMapTest, MapFunctionsMatch) {
 
 /** This test must be removed or modified appropriately when we allow
  * other ways to specify a primary. */
+TEST_F(OSDMapTest, MapToPgsBatch) {
+  set_up_map();
+
+  vector<string> names;
+  for (int i = 0; i < 37; ++i) {
+    // lengths vary so some batches share blocks and some don't
+    names.push_back(string("rbd_data.") + string(i, 'x') + std::to_string(i));
+  }
+  for (const string ns : { "", "myns" }) {
+    vector<pg_t> pgs;
+    ASSERT_EQ(0, osdmap.map_to_pgs(my_rep_pool, names, ns, &pgs));
+    ASSERT_EQ(names.size(), pgs.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+      pg_t pg;
+      ASSERT_EQ(0, osdmap.map_to_pg(my_rep_pool, names[i], string(), ns, &pg));
+      ASSERT_EQ(pg, pgs[i]) << names[i] << " ns " << ns;
+    }
+  }
+  vector<pg_t> pgs;
+  ASSERT_EQ(-ENOENT, osdmap.map_to_pgs(12345, names, string(), &pgs));
+}
+
 TEST_F(OSDMapTest, PrimaryIsFirst) {
   set_up_map();
 
@@ -288,6 +310,60 @@ TEST_F(OSDMapTest, PrimaryTempRespected) {
   EXPECT_EQ(acting_primary, acting_osds[1]);
 }
 
+TEST_F(OSDMapTest, AffectedPools) {
+  set_up_map();
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+
+  // a pg_temp change only touches its own pool
+  OSDMap::Incremental pgtemp_map(osdmap.get_epoch() + 1);
+  pgtemp_map.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+    acting_osds.rbegin(), acting_osds.rend());
+  set<int64_t> pools;
+  ASSERT_TRUE(pgtemp_map.get_affected_pools(&pools));
+  ASSERT_EQ(set<int64_t>{(int64_t)my_rep_pool}, pools);
+
+  // an osd state change may touch anything
+  OSDMap::Incremental down_map(osdmap.get_epoch() + 1);
+  down_map.new_state[0] = CEPH_OSD_UP;
+  pools.clear();
+  ASSERT_FALSE(down_map.get_affected_pools(&pools));
+
+  // remapping only the affected pool matches a full remap
+  ThreadPool tp(g_ceph_context, "AffectedPools::tp", "tp_test", 2);
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  tp.start();
+  mapping.update(osdmap);
+  osdmap.apply_incremental(pgtemp_map);
+  pools.clear();
+  pgtemp_map.get_affected_pools(&pools);
+  auto job = mapping.start_update(osdmap, mapper, 16, pools);
+  job->wait();
+  ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+  for (int64_t pool : {my_ec_pool, my_rep_pool}) {
+    for (unsigned ps = 0; ps < osdmap.get_pg_num(pool); ++ps) {
+      vector<int> up, acting, up2, acting2;
+      int upp, actp, upp2, actp2;
+      pg_t pg(ps, pool);
+      osdmap.pg_to_up_acting_osds(pg, &up, &upp, &acting, &actp);
+      mapping.get(pg, &up2, &upp2, &acting2, &actp2);
+      ASSERT_EQ(up, up2);
+      ASSERT_EQ(upp, upp2);
+      ASSERT_EQ(acting, acting2);
+      ASSERT_EQ(actp, actp2);
+    }
+  }
+
+  // nothing to remap still completes the job
+  job = mapping.start_update(osdmap, mapper, 16, set<int64_t>());
+  ASSERT_TRUE(job->is_done());
+  tp.stop();
+}
+
 TEST_F(OSDMapTest, CleanTemps) {
   set_up_map();
 
@@ -484,6 +560,52 @@ TEST_F(OSDMapTest, parse_osd_id_list) {
   ASSERT_EQ(-EINVAL, osdmap.parse_osd_id_list({"-12"}, &out, &cout));
 }
 
+TEST_F(OSDMapTest, CalcPGUpmaps) {
+  set_up_map();
+
+  auto count_pgs = [&](vector<int> *by_osd) {
+    by_osd->assign(get_num_osds(), 0);
+    for (unsigned ps = 0; ps < 64; ++ps) {
+      vector<int> up;
+      osdmap.pg_to_up_acting_osds(pg_t(ps, my_rep_pool), &up, nullptr,
+				  nullptr, nullptr);
+      set<int> distinct(up.begin(), up.end());
+      ASSERT_EQ(up.size(), distinct.size());
+      for (auto osd : up)
+	(*by_osd)[osd]++;
+    }
+  };
+  auto spread = [](const vector<int> &by_osd) {
+    return *std::max_element(by_osd.begin(), by_osd.end()) -
+      *std::min_element(by_osd.begin(), by_osd.end());
+  };
+
+  vector<int> before;
+  count_pgs(&before);
+  cout << "before: " << before << std::endl;
+
+  OSDMap::Incremental pending_inc(osdmap.get_epoch() + 1);
+  pending_inc.fsid = osdmap.get_fsid();
+  int changed = osdmap.calc_pg_upmaps(g_ceph_context, .001, 100,
+				      {(int64_t)my_rep_pool}, &pending_inc);
+  osdmap.apply_incremental(pending_inc);
+
+  vector<int> after;
+  count_pgs(&after);
+  cout << "after: " << after << std::endl;
+  ASSERT_LE(spread(after), spread(before));
+
+  // the incremental bookkeeping must agree with a fresh mapping: running
+  // again on the balanced map finds nothing more to do at the same ratio
+  // once the first run converged
+  if (changed < 100) {
+    OSDMap::Incremental again(osdmap.get_epoch() + 1);
+    again.fsid = osdmap.get_fsid();
+    ASSERT_EQ(0, osdmap.calc_pg_upmaps(g_ceph_context, .001, 100,
+				       {(int64_t)my_rep_pool}, &again));
+  }
+}
+
 TEST(PGTempMap, basic)
 {
   PGTempMap m;
@@ -0,0 +1,143 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "messages/MOSDRepOp.h"
+#include "osd/ReplicatedBackend.h"
+
+static pg_shard_t shard(int osd)
+{
+  return pg_shard_t(osd, shard_id_t::NO_SHARD);
+}
+
+static void peers(const vector<int> &osds, set<pg_shard_t> *actingbackfill,
+		  map<pg_shard_t, pg_info_t> *infos)
+{
+  for (auto osd : osds) {
+    actingbackfill->insert(shard(osd));
+    (*infos)[shard(osd)] = pg_info_t();
+  }
+}
+
+TEST(ChainReplication, Chain)
+{
+  set<pg_shard_t> actingbackfill, backfill;
+  map<pg_shard_t, pg_info_t> infos;
+  peers({0, 1, 2, 3}, &actingbackfill, &infos);
+
+  vector<pg_shard_t> chain;
+  ASSERT_TRUE(ReplicatedBackend::build_replication_chain(
+		shard(1), actingbackfill, backfill, infos, &chain));
+  ASSERT_EQ(vector<pg_shard_t>({shard(0), shard(2), shard(3)}), chain);
+}
+
+TEST(ChainReplication, FanOutWhileBackfilling)
+{
+  set<pg_shard_t> actingbackfill, backfill;
+  map<pg_shard_t, pg_info_t> infos;
+  peers({0, 1, 2}, &actingbackfill, &infos);
+  backfill.insert(shard(2));
+  infos[shard(2)].set_last_backfill(hobject_t());
+
+  vector<pg_shard_t> chain;
+  ASSERT_FALSE(ReplicatedBackend::build_replication_chain(
+		 shard(0), actingbackfill, backfill, infos, &chain));
+  ASSERT_TRUE(chain.empty());
+}
+
+TEST(ChainReplication, FanOutWithIncompletePeer)
+{
+  set<pg_shard_t> actingbackfill, backfill;
+  map<pg_shard_t, pg_info_t> infos;
+  peers({0, 1, 2}, &actingbackfill, &infos);
+  infos[shard(1)].set_last_backfill(hobject_t());
+
+  vector<pg_shard_t> chain;
+  ASSERT_FALSE(ReplicatedBackend::build_replication_chain(
+		 shard(0), actingbackfill, backfill, infos, &chain));
+  ASSERT_TRUE(chain.empty());
+}
+
+TEST(ChainReplication, FanOutWithOneReplica)
+{
+  set<pg_shard_t> actingbackfill, backfill;
+  map<pg_shard_t, pg_info_t> infos;
+  peers({0, 1}, &actingbackfill, &infos);
+
+  vector<pg_shard_t> chain;
+  ASSERT_FALSE(ReplicatedBackend::build_replication_chain(
+		 shard(0), actingbackfill, backfill, infos, &chain));
+  ASSERT_TRUE(chain.empty());
+}
+
+TEST(ChainReplication, Forward)
+{
+  hobject_t oid(object_t("foo"), "", CEPH_NOSNAP, 0x1234, 1, "");
+  osd_reqid_t reqid(entity_name_t::CLIENT(4100), 0, 17);
+  MOSDRepOp *m = new MOSDRepOp(
+    reqid, shard(0), spg_t(pg_t(3, 1), shard_id_t::NO_SHARD), oid,
+    CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK, 20, 18, 99, eversion_t(20, 5));
+  bufferlist data;
+  data.append("transaction");
+  m->set_data(data);
+  m->logbl.append("log entries");
+  m->pg_trim_to = eversion_t(19, 1);
+  m->pg_roll_forward_to = eversion_t(20, 4);
+  m->forward_to = {shard(2), shard(3)};
+
+  // osd.1 passes it on to osd.2 ...
+  MOSDRepOp *f = ReplicatedBackend::make_forwarded_repop(m);
+  ASSERT_EQ(spg_t(pg_t(3, 1), shard_id_t::NO_SHARD), f->pgid);
+  ASSERT_EQ(shard(0), f->from);  // acks still go to the primary
+  ASSERT_EQ(reqid, f->reqid);
+  ASSERT_EQ(oid, f->poid);
+  ASSERT_EQ(m->get_tid(), f->get_tid());
+  ASSERT_EQ(eversion_t(20, 5), f->version);
+  ASSERT_EQ(20u, f->map_epoch);
+  ASSERT_EQ(18u, f->min_epoch);
+  ASSERT_TRUE(f->get_data().contents_equal(data));
+  ASSERT_TRUE(f->logbl.contents_equal(m->logbl));
+  ASSERT_EQ(m->pg_trim_to, f->pg_trim_to);
+  ASSERT_EQ(m->pg_roll_forward_to, f->pg_roll_forward_to);
+  ASSERT_EQ(vector<pg_shard_t>({shard(3)}), f->forward_to);
+
+  // ... which passes it on to osd.3, the tail
+  MOSDRepOp *g = ReplicatedBackend::make_forwarded_repop(f);
+  ASSERT_TRUE(g->forward_to.empty());
+  ASSERT_EQ(shard(0), g->from);
+  ASSERT_TRUE(g->get_data().contents_equal(data));
+
+  m->put();
+  f->put();
+  g->put();
+}
+
+TEST(ChainReplication, ForwardToEncoding)
+{
+  hobject_t oid(object_t("foo"), "", CEPH_NOSNAP, 0x1234, 1, "");
+  MOSDRepOp *m = new MOSDRepOp(
+    osd_reqid_t(), shard(0), spg_t(pg_t(3, 1), shard_id_t::NO_SHARD), oid,
+    CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK, 20, 18, 99, eversion_t(20, 5));
+  m->forward_to = {shard(2), shard(3)};
+  m->encode_payload(CEPH_FEATURES_ALL);
+
+  MOSDRepOp *d = new MOSDRepOp();
+  d->set_header(m->get_header());
+  d->set_payload(m->get_payload());
+  d->decode_payload();
+  d->finish_decode();
+  ASSERT_EQ(oid, d->poid);
+  ASSERT_EQ(m->forward_to, d->forward_to);
+
+  m->put();
+  d->put();
+}
@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 #include "osd/PGTransaction.h"
 #include "osd/ECTransaction.h"
+#include "erasure-code/ErasureCode.h"
 
 #include "test/unit.cc"
 
@@ -122,3 +123,230 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+// a single parity xor code; the plugins check their apply_delta()
+// against a full encode in their own tests
+class XorCode : public ceph::ErasureCode {
+public:
+  unsigned int get_chunk_count() const override {
+    return 4;
+  }
+  unsigned int get_data_chunk_count() const override {
+    return 3;
+  }
+  unsigned int get_chunk_size(unsigned int object_size) const override {
+    return object_size / get_data_chunk_count();
+  }
+  int encode_chunks(const set<int> &want_to_encode,
+		    map<int, bufferlist> *encoded) override {
+    char *parity = (*encoded)[3].c_str();
+    unsigned length = (*encoded)[3].length();
+    memset(parity, 0, length);
+    for (int i = 0; i < 3; ++i) {
+      const char *data = (*encoded)[i].c_str();
+      for (unsigned j = 0; j < length; ++j)
+	parity[j] ^= data[j];
+    }
+    return 0;
+  }
+  bool supports_parity_delta() const override {
+    return true;
+  }
+  int apply_delta(const map<int, bufferptr> &in,
+		  map<int, bufferptr> &out) override {
+    int r = check_delta(in, out);
+    if (r < 0)
+      return r;
+    for (auto &c : out) {
+      for (auto &d : in) {
+	for (unsigned j = 0; j < d.second.length(); ++j)
+	  c.second.c_str()[j] ^= d.second.c_str()[j];
+      }
+    }
+    return 0;
+  }
+};
+
+static const uint64_t delta_chunk_size = 4096;
+static const uint64_t delta_object_size = 4 * 3 * delta_chunk_size;
+
+static ECTransaction::WritePlan delta_plan(
+  const ECUtil::stripe_info_t &sinfo,
+  PGTransactionUPtr &&t)
+{
+  return ECTransaction::get_write_plan(
+    sinfo,
+    std::move(t),
+    [&](const hobject_t &i) {
+      ECUtil::HashInfoRef ref(new ECUtil::HashInfo(4));
+      ref->set_total_chunk_size_clear_hash(
+	sinfo.aligned_logical_offset_to_chunk_offset(delta_object_size));
+      ref->set_projected_total_logical_size(sinfo, delta_object_size);
+      return ref;
+    },
+    &dpp);
+}
+
+TEST(ectransaction, delta_write_plan)
+{
+  hobject_t h;
+  ECUtil::stripe_info_t sinfo(3, 3 * delta_chunk_size);
+  const uint64_t stripe = sinfo.get_stripe_width();
+  bufferlist bl;
+  bl.append_zero(1000);
+
+  {
+    // inside one data chunk
+    PGTransactionUPtr t(new PGTransaction);
+    t->write(h, stripe + delta_chunk_size + 100, bl.length(), bl, 0);
+    auto plan = delta_plan(sinfo, std::move(t));
+    ECTransaction::DeltaWrite delta;
+    ASSERT_TRUE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+    ASSERT_EQ(stripe, delta.stripe_off);
+    ASSERT_EQ(set<int>{1}, delta.data_chunks);
+  }
+  {
+    // across two adjacent data chunks
+    PGTransactionUPtr t(new PGTransaction);
+    t->write(h, stripe + delta_chunk_size - 500, bl.length(), bl, 0);
+    auto plan = delta_plan(sinfo, std::move(t));
+    ECTransaction::DeltaWrite delta;
+    ASSERT_TRUE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+    ASSERT_EQ((set<int>{0, 1}), delta.data_chunks);
+  }
+  {
+    // two data chunks with one untouched between them
+    PGTransactionUPtr t(new PGTransaction);
+    t->write(h, stripe, bl.length(), bl, 0);
+    t->write(h, stripe + 2 * delta_chunk_size, bl.length(), bl, 0);
+    auto plan = delta_plan(sinfo, std::move(t));
+    ECTransaction::DeltaWrite delta;
+    ASSERT_FALSE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+  }
+  {
+    // every data chunk
+    PGTransactionUPtr t(new PGTransaction);
+    bufferlist big;
+    big.append_zero(2 * delta_chunk_size + 2);
+    t->write(h, stripe + delta_chunk_size - 1, big.length(), big, 0);
+    auto plan = delta_plan(sinfo, std::move(t));
+    ECTransaction::DeltaWrite delta;
+    ASSERT_FALSE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+  }
+  {
+    // across two stripes
+    PGTransactionUPtr t(new PGTransaction);
+    t->write(h, 2 * stripe - 500, bl.length(), bl, 0);
+    auto plan = delta_plan(sinfo, std::move(t));
+    ECTransaction::DeltaWrite delta;
+    ASSERT_FALSE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+  }
+  {
+    // the write also truncates
+    PGTransactionUPtr t(new PGTransaction);
+    t->write(h, stripe + 100, bl.length(), bl, 0);
+    t->truncate(h, delta_object_size - stripe);
+    auto plan = delta_plan(sinfo, std::move(t));
+    ECTransaction::DeltaWrite delta;
+    ASSERT_FALSE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+  }
+}
+
+TEST(ectransaction, delta_write_transactions)
+{
+  hobject_t h;
+  ECUtil::stripe_info_t sinfo(3, 3 * delta_chunk_size);
+  const uint64_t stripe = sinfo.get_stripe_width();
+  ErasureCodeInterfaceRef ecimpl(new XorCode);
+  set<int> want = {0, 1, 2, 3};
+
+  bufferlist old_stripe;
+  for (unsigned i = 0; i < stripe; ++i)
+    old_stripe.append((char)(i * 7 + i / 13));
+  map<int, bufferlist> old_chunks;
+  ASSERT_EQ(0, ECUtil::encode(sinfo, ecimpl, old_stripe, want, &old_chunks));
+
+  const uint64_t off = delta_chunk_size + 100;
+  bufferlist bl;
+  bl.append(string(1000, 'x'));
+  bufferlist new_stripe;
+  new_stripe.substr_of(old_stripe, 0, off);
+  new_stripe.append(bl);
+  bufferlist tail;
+  tail.substr_of(old_stripe, off + bl.length(),
+		 stripe - off - bl.length());
+  new_stripe.append(tail);
+  map<int, bufferlist> new_chunks;
+  ASSERT_EQ(0, ECUtil::encode(sinfo, ecimpl, new_stripe, want, &new_chunks));
+
+  PGTransactionUPtr t(new PGTransaction);
+  ObjectContextRef obc(new ObjectContext);
+  obc->obs.oi.soid = h;
+  t->add_obc(obc);
+  t->write(h, stripe + off, bl.length(), bl, 0);
+  auto plan = delta_plan(sinfo, std::move(t));
+
+  ECTransaction::DeltaWrite &delta = plan.deltas[h];
+  ASSERT_TRUE(ECTransaction::get_delta_write(sinfo, plan, h, &delta));
+  delta.old_chunks[1] = old_chunks[1];
+  delta.old_chunks[3] = old_chunks[3];
+  map<hobject_t,extent_map> partial_extents;
+  partial_extents[h].insert(
+    stripe + delta_chunk_size, delta_chunk_size, old_chunks[1]);
+
+  vector<pg_log_entry_t> entries;
+  entries.push_back(
+    pg_log_entry_t(pg_log_entry_t::MODIFY, h, eversion_t(1, 2),
+		   eversion_t(1, 1), 0, osd_reqid_t(), utime_t(), 0));
+  map<hobject_t,extent_map> written;
+  map<shard_id_t, ObjectStore::Transaction> transactions;
+  for (int i = 0; i < 4; ++i)
+    transactions[shard_id_t(i)];
+  set<hobject_t> temp_added, temp_removed;
+  ECTransaction::generate_transactions(
+    plan, ecimpl, pg_t(0, 1), false, sinfo, partial_extents, entries,
+    &written, &transactions, &temp_added, &temp_removed, &dpp);
+
+  ASSERT_EQ(1u, written[h].ext_count());
+  ASSERT_EQ(stripe + delta_chunk_size, written[h].begin().get_off());
+  ASSERT_EQ(delta_chunk_size, written[h].begin().get_len());
+
+  // only the touched data chunk and the coding chunk are written, but
+  // every shard can roll the stripe back
+  const uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(
+    stripe);
+  for (auto &&st : transactions) {
+    map<uint64_t, bufferlist> writes;
+    set<uint64_t> saved;
+    auto i = st.second.begin();
+    while (i.have_op()) {
+      auto op = i.decode_op();
+      switch (op->op) {
+      case ObjectStore::Transaction::OP_WRITE:
+	i.decode_bl(writes[op->off]);
+	ASSERT_EQ(op->len, writes[op->off].length());
+	break;
+      case ObjectStore::Transaction::OP_SETATTR:
+	{
+	  bufferlist attr;
+	  i.decode_string();
+	  i.decode_bl(attr);
+	}
+	break;
+      case ObjectStore::Transaction::OP_CLONERANGE2:
+	ASSERT_EQ(delta_chunk_size, op->len);
+	saved.insert(op->off);
+	break;
+      }
+    }
+    ASSERT_EQ(set<uint64_t>{chunk_off}, saved);
+    if (st.first == shard_id_t(1) || st.first == shard_id_t(3)) {
+      ASSERT_EQ(1u, writes.size());
+      ASSERT_EQ(chunk_off, writes.begin()->first);
+      ASSERT_TRUE(writes.begin()->second.contents_equal(
+		    new_chunks[st.first]));
+    } else {
+      ASSERT_TRUE(writes.empty());
+    }
+  }
+}
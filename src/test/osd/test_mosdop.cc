@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "messages/MOSDOp.h"
+
+static MOSDOp *make_op(hobject_t *hobj)
+{
+  *hobj = hobject_t(object_t("foo"), "", CEPH_NOSNAP, 0x1234, 3, "ns");
+  spg_t pgid(pg_t(0x1234, 3), shard_id_t::NO_SHARD);
+  MOSDOp *m = new MOSDOp(7, 42, *hobj, pgid, 20, CEPH_OSD_FLAG_READ, 0);
+  m->add_simple_op(CEPH_OSD_OP_READ, 0, 4096);
+  m->set_qos_params(5, 3);
+  return m;
+}
+
+// a connection carries the features both ends have
+static const uint64_t luminous_peer =
+  CEPH_FEATURES_ALL & ~CEPH_FEATURE_SERVER_MIMIC;
+static const uint64_t mimic_peer = CEPH_FEATURES_ALL;
+
+static MOSDOp *reencode(MOSDOp *m, uint64_t peer_features)
+{
+  uint64_t features = CEPH_FEATURES_ALL & peer_features;
+  m->encode_payload(features);
+  MOSDOp *d = new MOSDOp();
+  d->set_header(m->get_header());
+  d->set_payload(m->get_payload());
+  d->decode_payload();
+  return d;
+}
+
+TEST(MOSDOp, QosParamsToMimic)
+{
+  // this tree is a mimic peer, so a fully upgraded cluster gets v9
+  ASSERT_TRUE(HAVE_FEATURE(CEPH_FEATURES_ALL, SERVER_MIMIC));
+  ASSERT_FALSE(HAVE_FEATURE(luminous_peer, SERVER_MIMIC));
+
+  hobject_t hobj;
+  MOSDOp *m = make_op(&hobj);
+  MOSDOp *d = reencode(m, mimic_peer);
+  ASSERT_EQ(9, d->get_header().version);
+  ASSERT_TRUE(d->has_qos_params());
+  ASSERT_EQ(5u, d->get_qos_delta());
+  ASSERT_EQ(3u, d->get_qos_rho());
+  ASSERT_EQ(20u, d->get_map_epoch());
+  d->finish_decode();
+  ASSERT_EQ(hobj.oid, d->get_oid());
+  ASSERT_EQ(1u, d->ops.size());
+  ASSERT_EQ(CEPH_OSD_OP_READ, d->ops[0].op.op);
+  m->put();
+  d->put();
+}
+
+TEST(MOSDOp, NoQosParamsToLuminous)
+{
+  hobject_t hobj;
+  MOSDOp *m = make_op(&hobj);
+  MOSDOp *d = reencode(m, luminous_peer);
+  ASSERT_EQ(8, d->get_header().version);
+  ASSERT_FALSE(d->has_qos_params());
+  ASSERT_EQ(20u, d->get_map_epoch());
+  d->finish_decode();
+  ASSERT_EQ(hobj.oid, d->get_oid());
+  ASSERT_EQ(1u, d->ops.size());
+  ASSERT_EQ(CEPH_OSD_OP_READ, d->ops[0].op.op);
+  m->put();
+  d->put();
+}
+
+TEST(MOSDOp, NoQosParamsUntracked)
+{
+  hobject_t hobj;
+  MOSDOp *m = make_op(&hobj);
+  m->set_qos_params(0, 0);
+  MOSDOp *d = reencode(m, mimic_peer);
+  ASSERT_EQ(8, d->get_header().version);
+  ASSERT_FALSE(d->has_qos_params());
+  d->finish_decode();
+  ASSERT_EQ(hobj.oid, d->get_oid());
+  m->put();
+  d->put();
+}
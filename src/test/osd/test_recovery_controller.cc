@@ -0,0 +1,137 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/RecoveryController.h"
+
+static void record(RecoveryController &c, unsigned n, double ms)
+{
+  utime_t lat;
+  lat.set_from_double(ms / 1000.0);
+  for (unsigned i = 0; i < n; ++i)
+    c.record_client_op(lat);
+}
+
+static RecoveryController::Params params()
+{
+  RecoveryController::Params p;
+  p.target_p99_ms = 50;
+  p.max_active = 16;
+  p.max_backfills = 4;
+  p.max_sleep = 0.1;
+  return p;
+}
+
+TEST(RecoveryController, BacksOffOverTarget)
+{
+  RecoveryController c;
+  auto p = params();
+  c.reset(p);
+  EXPECT_EQ(16u, c.get_max_active());
+  EXPECT_EQ(4u, c.get_max_backfills());
+
+  // 2% of ops are slow, so the p99 is over the target
+  record(c, 980, 2);
+  record(c, 20, 200);
+  EXPECT_TRUE(c.update(p));
+  EXPECT_EQ(8u, c.get_max_active());
+  EXPECT_EQ(2u, c.get_max_backfills());
+
+  for (int i = 0; i < 3; ++i) {
+    record(c, 100, 200);
+    c.update(p);
+  }
+  EXPECT_EQ(1u, c.get_max_active());
+  EXPECT_EQ(1u, c.get_max_backfills());
+  EXPECT_EQ(0.0, c.get_sleep());
+
+  // at one op, slow down with a growing sleep, up to the ceiling
+  record(c, 100, 200);
+  c.update(p);
+  EXPECT_DOUBLE_EQ(0.01, c.get_sleep());
+  for (int i = 0; i < 10; ++i) {
+    record(c, 100, 200);
+    c.update(p);
+  }
+  EXPECT_DOUBLE_EQ(0.1, c.get_sleep());
+  EXPECT_EQ(1u, c.get_max_active());
+}
+
+TEST(RecoveryController, SpeedsUpUnderTarget)
+{
+  RecoveryController c;
+  auto p = params();
+  c.reset(p);
+  for (int i = 0; i < 8; ++i) {
+    record(c, 100, 200);
+    c.update(p);
+  }
+  ASSERT_EQ(1u, c.get_max_active());
+  ASSERT_GT(c.get_sleep(), 0.0);
+
+  // fast clients: drop the sleep first, then add ops one at a time
+  unsigned ticks = 0;
+  while (c.get_sleep() > 0) {
+    record(c, 100, 1);
+    c.update(p);
+    ASSERT_EQ(1u, c.get_max_active());
+    ASSERT_LT(++ticks, 10u);
+  }
+  record(c, 100, 1);
+  c.update(p);
+  EXPECT_EQ(2u, c.get_max_active());
+
+  // no client load at all counts as headroom too
+  for (int i = 0; i < 20; ++i)
+    c.update(p);
+  EXPECT_EQ(16u, c.get_max_active());
+  EXPECT_EQ(4u, c.get_max_backfills());
+  EXPECT_FALSE(c.update(p));
+}
+
+TEST(RecoveryController, HoldsInBand)
+{
+  RecoveryController c;
+  auto p = params();
+  c.reset(p);
+  record(c, 100, 200);
+  c.update(p);
+  ASSERT_EQ(8u, c.get_max_active());
+  // between 80% and 100% of the target nothing changes
+  record(c, 100, 45);
+  EXPECT_FALSE(c.update(p));
+  EXPECT_EQ(8u, c.get_max_active());
+}
+
+TEST(RecoveryController, WaitsForSamples)
+{
+  RecoveryController c;
+  auto p = params();
+  c.reset(p);
+  // a few slow ops alone are not enough to act on...
+  record(c, 5, 200);
+  EXPECT_FALSE(c.update(p));
+  EXPECT_EQ(16u, c.get_max_active());
+  // ...until enough have accumulated
+  record(c, 20, 200);
+  EXPECT_TRUE(c.update(p));
+  EXPECT_EQ(8u, c.get_max_active());
+
+  // or the light load has lasted a while
+  for (unsigned i = 1; i < RecoveryController::min_samples_ticks; ++i) {
+    record(c, 1, 200);
+    EXPECT_FALSE(c.update(p));
+  }
+  record(c, 1, 200);
+  EXPECT_TRUE(c.update(p));
+  EXPECT_EQ(4u, c.get_max_active());
+}
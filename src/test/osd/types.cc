@@ -1425,6 +1425,30 @@ TEST(ghobject_t, cmp) {
   ASSERT_TRUE(o > sep);
 }
 
+TEST(hobject_t, cmp) {
+  // each entry sorts strictly after the one before it
+  vector<hobject_t> v = {
+    hobject_t(object_t("b"), "", 1, 0x10, -1, ""),
+    hobject_t(object_t("b"), "", 1, 0x80000000, 1, ""), // bit-reversed: 1
+    hobject_t(object_t("a"), "", 1, 0x40000000, 1, ""), // bit-reversed: 2
+    hobject_t(object_t("z"), "", 1, 0x40000000, 1, "a"),
+    hobject_t(object_t("z"), "b", 1, 0x40000000, 1, "b"),
+    hobject_t(object_t("a"), "c", 1, 0x40000000, 1, "b"),
+    hobject_t(object_t("c"), "", 1, 0x40000000, 1, "b"),
+    hobject_t(object_t("c"), "", 2, 0x40000000, 1, "b"),
+    hobject_t(object_t("c"), "", CEPH_NOSNAP, 0x40000000, 1, "b"),
+    hobject_t(hobject_t::get_max()),
+  };
+  for (unsigned i = 0; i < v.size(); ++i) {
+    ASSERT_EQ(0, cmp(v[i], v[i]));
+    for (unsigned j = i + 1; j < v.size(); ++j) {
+      ASSERT_EQ(-1, cmp(v[i], v[j])) << v[i] << " vs " << v[j];
+      ASSERT_EQ(1, cmp(v[j], v[i])) << v[j] << " vs " << v[i];
+      ASSERT_EQ(-1, cmp(ghobject_t(v[i]), ghobject_t(v[j])));
+    }
+  }
+}
+
 TEST(ghobject_t, parse) {
   const char *v[] = {
     "GHMIN",
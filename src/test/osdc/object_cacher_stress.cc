@@ -351,6 +351,218 @@ int correctness_test(uint64_t delay_ns)
   return EXIT_FAILURE;
 }
 
+static bufferlist fill_bl(uint64_t len, char c)
+{
+  ceph::buffer::ptr bp(len);
+  memset(bp.c_str(), c, len);
+  bufferlist bl;
+  bl.append(bp);
+  return bl;
+}
+
+static void write_extent(ObjectCacher &obc, Mutex &lock,
+			 ObjectCacher::ObjectSet *object_set,
+			 const std::string &oid, uint64_t off,
+			 const bufferlist &bl,
+			 const vector<pair<uint64_t, uint64_t> > &buffer_extents)
+{
+  SnapContext snapc;
+  ObjectCacher::OSDWrite *wr = obc.prepare_write(snapc, bl,
+						 ceph::real_time::min(), 0, 0);
+  ObjectExtent extent(oid, 0, off, bl.length(), 0);
+  extent.oloc.pool = 0;
+  extent.buffer_extents = buffer_extents;
+  wr->extents.push_back(extent);
+  C_SaferCond cond;
+  lock.Lock();
+  obc.writex(wr, object_set, &cond);
+  lock.Unlock();
+  cond.wait();
+}
+
+static void flush_and_wait(ObjectCacher &obc, Mutex &lock)
+{
+  C_SaferCond cond;
+  lock.Lock();
+  bool done = obc.flush_all(&cond);
+  lock.Unlock();
+  if (!done)
+    cond.wait();
+}
+
+static bool backing_matches(MemWriteback &writeback, Mutex &lock,
+			    const std::string &oid, const bufferlist &expected)
+{
+  bufferlist bl;
+  lock.Lock();
+  int r = writeback.read_object_data(oid, 0, expected.length(), &bl);
+  lock.Unlock();
+  return r == 0 && bl.contents_equal(expected);
+}
+
+/*
+ * a write into part of a clean bh may absorb the whole bh.  write into
+ * the head, middle and tail of one, through a write whose buffer extents
+ * are out of order, and check what is cached and what is written back.
+ */
+int partial_write_test(uint64_t delay_ns)
+{
+  std::cerr << "starting partial write test" << std::endl;
+  Mutex lock("object_cacher_stress::object_cacher");
+  MemWriteback writeback(g_ceph_context, &lock, delay_ns);
+
+  ObjectCacher obc(g_ceph_context, "test", writeback, lock, NULL, NULL,
+		   1<<21, // max cache size, 2MB
+		   10, // max objects
+		   1<<18, // max dirty, 256KB
+		   1<<17, // target dirty, 128KB
+		   g_conf->client_oc_max_dirty_age,
+		   true);
+  obc.start();
+
+  ObjectCacher::ObjectSet object_set(NULL, 0, 0);
+  const uint64_t bh_len = 1<<14;
+  const uint64_t piece = 1<<12;
+  const uint64_t offsets[] = {0, piece, bh_len - 2 * piece};
+  const char *where[] = {"head", "middle", "tail"};
+
+  for (int i = 0; i < 3; ++i) {
+    std::string oid = "partial_write_obj." + stringify(i);
+    std::cout << "writing into the " << where[i] << " of a clean bh"
+	      << std::endl;
+
+    bufferlist clean_bl = fill_bl(bh_len, 'a');
+    write_extent(obc, lock, &object_set, oid, 0, clean_bl,
+		 {make_pair(0, bh_len)});
+    flush_and_wait(obc, lock);
+
+    // the second piece of the object comes first in the buffer
+    bufferlist write_bl = fill_bl(piece, 'y');
+    write_bl.append(fill_bl(piece, 'x'));
+    write_extent(obc, lock, &object_set, oid, offsets[i], write_bl,
+		 {make_pair(piece, piece), make_pair(0, piece)});
+
+    bufferlist expected;
+    expected.substr_of(clean_bl, 0, offsets[i]);
+    expected.append(fill_bl(piece, 'x'));
+    expected.append(fill_bl(piece, 'y'));
+    bufferlist tail;
+    tail.substr_of(clean_bl, offsets[i] + 2 * piece,
+		   bh_len - offsets[i] - 2 * piece);
+    expected.append(tail);
+
+    bufferlist read_bl;
+    ObjectCacher::OSDRead *rd = obc.prepare_read(CEPH_NOSNAP, &read_bl, 0);
+    ObjectExtent extent(oid, 0, 0, bh_len, 0);
+    extent.oloc.pool = 0;
+    extent.buffer_extents.push_back(make_pair(0, bh_len));
+    rd->extents.push_back(extent);
+    C_SaferCond readcond;
+    lock.Lock();
+    int r = obc.readx(rd, &object_set, &readcond);
+    lock.Unlock();
+    // everything is cached
+    assert(r == (int)bh_len);
+    assert(read_bl.contents_equal(expected));
+
+    flush_and_wait(obc, lock);
+    assert(backing_matches(writeback, lock, oid, expected));
+  }
+  std::cout << "validated cached and written back data" << std::endl;
+
+  lock.Lock();
+  bool unclean = obc.release_set(&object_set);
+  lock.Unlock();
+  obc.stop();
+
+  if (unclean) {
+    std::cout << "unclean buffers left over!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Testing ObjectCacher partial writes complete" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/*
+ * with a writeback handler that can't scatter writes (librbd's), the
+ * flusher must still write back exactly the dirty bhs: leave dirty
+ * pieces spread over several objects and let the flusher alone write
+ * them out, past the target and by age.
+ */
+int flush_test(uint64_t delay_ns)
+{
+  std::cerr << "starting flush test" << std::endl;
+  Mutex lock("object_cacher_stress::object_cacher");
+  MemWriteback writeback(g_ceph_context, &lock, delay_ns);
+
+  ObjectCacher obc(g_ceph_context, "test", writeback, lock, NULL, NULL,
+		   1<<22, // max cache size, 4MB
+		   16, // max objects
+		   1<<20, // max dirty, 1MB
+		   1<<16, // target dirty, 64KB
+		   1.0, // max dirty age
+		   true);
+  obc.start();
+
+  ObjectCacher::ObjectSet object_set(NULL, 0, 0);
+  const int num_objs = 8;
+  const int num_pieces = 4;
+  const uint64_t piece = 1<<14;
+  const uint64_t stride = 1<<15;
+
+  // dirty pieces with clean gaps between them, in no particular order
+  std::map<std::string, bufferlist> expected;
+  for (int p = num_pieces - 1; p >= 0; --p) {
+    for (int o = 0; o < num_objs; ++o) {
+      std::string oid = "flush_obj." + stringify(o);
+      bufferlist bl = fill_bl(piece, 'a' + (o * num_pieces + p) % 26);
+      write_extent(obc, lock, &object_set, oid, p * stride, bl,
+		   {make_pair(0, piece)});
+    }
+  }
+  for (int o = 0; o < num_objs; ++o) {
+    bufferlist &bl = expected["flush_obj." + stringify(o)];
+    for (int p = 0; p < num_pieces; ++p) {
+      bl.append(fill_bl(piece, 'a' + (o * num_pieces + p) % 26));
+      if (p < num_pieces - 1)
+	bl.append_zero(stride - piece);
+    }
+  }
+
+  std::cout << "waiting for the flusher" << std::endl;
+  bool flushed = false;
+  for (int i = 0; i < 300 && !flushed; ++i) {
+    usleep(100000);
+    flushed = true;
+    for (auto &e : expected) {
+      if (!backing_matches(writeback, lock, e.first, e.second)) {
+	flushed = false;
+	break;
+      }
+    }
+  }
+  obc.stop();
+
+  if (!flushed) {
+    std::cout << "flusher didn't write back all dirty data!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "validated data written back by the flusher" << std::endl;
+
+  lock.Lock();
+  bool unclean = obc.release_set(&object_set);
+  lock.Unlock();
+
+  if (unclean) {
+    std::cout << "unclean buffers left over!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Testing ObjectCacher flush complete" << std::endl;
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, const char **argv)
 {
   std::vector<const char*> args;
@@ -368,6 +580,8 @@ int main(int argc, const char **argv)
   int seed = time(0) % 100000;
   bool stress = false;
   bool correctness = false;
+  bool partial_write = false;
+  bool flush = false;
   std::ostringstream err;
   std::vector<const char*>::iterator i;
   for (i = args.begin(); i != args.end();) {
@@ -410,6 +624,10 @@ int main(int argc, const char **argv)
       stress = true;
     } else if (ceph_argparse_flag(args, i, "--correctness-test", NULL)) {
       correctness = true;
+    } else if (ceph_argparse_flag(args, i, "--partial-write-test", NULL)) {
+      partial_write = true;
+    } else if (ceph_argparse_flag(args, i, "--flush-test", NULL)) {
+      flush = true;
     } else {
       cerr << "unknown option " << *i << std::endl;
       return EXIT_FAILURE;
@@ -423,4 +641,10 @@ int main(int argc, const char **argv)
   if (correctness) {
     return correctness_test(delay_ns);
   }
+  if (partial_write) {
+    return partial_write_test(delay_ns);
+  }
+  if (flush) {
+    return flush_test(delay_ns);
+  }
 }
@@ -0,0 +1,266 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Drive an Objecter from several submitter threads against an
+ * in-process OSD that acks every MOSDOp right away, to measure the
+ * client side op submission and completion path on its own.
+ */
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/debug.h"
+#include "global/global_init.h"
+#include "mon/MonClient.h"
+#include "msg/Messenger.h"
+#include "messages/MOSDOp.h"
+#include "messages/MOSDOpReply.h"
+#include "osd/OSDMap.h"
+#include "osdc/Objecter.h"
+
+using namespace std;
+
+class FakeOSD : public Dispatcher {
+  Messenger *msgr;
+
+public:
+  explicit FakeOSD(CephContext *cct) : Dispatcher(cct), msgr(nullptr) {}
+
+  int start(const string& type) {
+    msgr = Messenger::create(cct, type, entity_name_t::OSD(0), "osd",
+			     getpid(), 0);
+    msgr->set_default_policy(Messenger::Policy::stateless_server(0));
+    entity_addr_t addr;
+    addr.parse("127.0.0.1:0");
+    int r = msgr->bind(addr);
+    if (r < 0)
+      return r;
+    msgr->add_dispatcher_head(this);
+    return msgr->start();
+  }
+  void stop() {
+    msgr->shutdown();
+    msgr->wait();
+    delete msgr;
+  }
+  entity_addr_t get_addr() const {
+    return msgr->get_myaddr();
+  }
+
+  bool ms_can_fast_dispatch_any() const override { return true; }
+  bool ms_can_fast_dispatch(const Message *m) const override {
+    return m->get_type() == CEPH_MSG_OSD_OP;
+  }
+  void ms_fast_dispatch(Message *m) override {
+    MOSDOp *op = static_cast<MOSDOp*>(m);
+    op->finish_decode();
+    MOSDOpReply *reply = new MOSDOpReply(op, 0, op->get_map_epoch(),
+					 CEPH_OSD_FLAG_ACK|CEPH_OSD_FLAG_ONDISK,
+					 true);
+    m->get_connection()->send_message(reply);
+    m->put();
+  }
+  bool ms_dispatch(Message *m) override {
+    m->put();
+    return true;
+  }
+  bool ms_handle_reset(Connection *con) override { return true; }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override { return false; }
+  bool ms_verify_authorizer(Connection *con, int peer_type, int protocol,
+                            bufferlist& authorizer, bufferlist& authorizer_reply,
+                            bool& isvalid, CryptoKey& session_key) override {
+    isvalid = true;
+    return true;
+  }
+};
+
+struct Window {
+  std::mutex lock;
+  std::condition_variable cond;
+  unsigned inflight = 0;
+
+  void get(unsigned max) {
+    std::unique_lock<std::mutex> l(lock);
+    cond.wait(l, [&] { return inflight < max; });
+    ++inflight;
+  }
+  void put() {
+    std::lock_guard<std::mutex> l(lock);
+    --inflight;
+    cond.notify_all();
+  }
+  void drain() {
+    std::unique_lock<std::mutex> l(lock);
+    cond.wait(l, [&] { return inflight == 0; });
+  }
+};
+
+struct C_Done : public Context {
+  Window *w;
+  explicit C_Done(Window *w) : w(w) {}
+  void finish(int r) override {
+    assert(r == 0);
+    w->put();
+  }
+};
+
+static void submitter(Objecter *objecter, int64_t pool, int id,
+		      uint64_t ops, unsigned depth, const bufferlist& data)
+{
+  Window w;
+  object_locator_t oloc(pool);
+  SnapContext snapc;
+  for (uint64_t i = 0; i < ops; ++i) {
+    w.get(depth);
+    char name[64];
+    snprintf(name, sizeof(name), "bench.%d.%llu", id,
+	     (unsigned long long)(i % 1024));
+    objecter->write(object_t(name), oloc, 0, data.length(), snapc, data,
+		    ceph::real_clock::now(), 0, new C_Done(&w));
+  }
+  w.drain();
+}
+
+static void usage(const char *name)
+{
+  cout << "usage: " << name << " [options]\n"
+       << "  --threads N   submitter threads (default 4)\n"
+       << "  --ops N       ops per thread (default 100000)\n"
+       << "  --depth N     ops in flight per thread (default 32)\n"
+       << "  --size N      bytes per write (default 4096)\n"
+       << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  env_to_vec(args);
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  int threads = 4, depth = 32, size = 4096;
+  long long ops = 100000;
+  std::string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_flag(args, i, "-h", "--help", (char*)NULL)) {
+      usage(argv[0]);
+      return 0;
+    } else if (ceph_argparse_witharg(args, i, &val, "--threads", (char*)NULL)) {
+      threads = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--ops", (char*)NULL)) {
+      ops = atoll(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--depth", (char*)NULL)) {
+      depth = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--size", (char*)NULL)) {
+      size = atoi(val.c_str());
+    } else {
+      cerr << "unknown option " << *i << std::endl;
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (threads <= 0 || depth <= 0 || size < 0 || ops <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  cct->_conf->set_val_or_die("auth_cluster_required", "none");
+  cct->_conf->set_val_or_die("auth_service_required", "none");
+  cct->_conf->set_val_or_die("auth_client_required", "none");
+  cct->_conf->set_val_or_die("osd_pool_default_size", "1");
+  cct->_conf->set_val_or_die("osd_pool_default_min_size", "1");
+  cct->_conf->set_val_or_die("osd_crush_chooseleaf_type", "0");
+  cct->_conf->apply_changes(NULL);
+  common_init_finish(g_ceph_context);
+
+  string type = cct->_conf->get_val<std::string>("ms_type");
+
+  FakeOSD osd(g_ceph_context);
+  int r = osd.start(type);
+  if (r < 0) {
+    cerr << "failed to start fake osd: " << cpp_strerror(r) << std::endl;
+    return 1;
+  }
+
+  // a one-osd map pointing at the fake osd
+  uuid_d fsid;
+  fsid.generate_random();
+  OSDMap osdmap;
+  osdmap.build_simple_with_pool(g_ceph_context, 1, fsid, 1, 6, 6);
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = fsid;
+  uuid_d osd_uuid;
+  osd_uuid.generate_random();
+  inc.new_state[0] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+  inc.new_up_client[0] = osd.get_addr();
+  inc.new_up_cluster[0] = osd.get_addr();
+  inc.new_hb_back_up[0] = osd.get_addr();
+  inc.new_hb_front_up[0] = osd.get_addr();
+  inc.new_weight[0] = CEPH_OSD_IN;
+  inc.new_uuid[0] = osd_uuid;
+  osdmap.apply_incremental(inc);
+  int64_t pool = osdmap.lookup_pg_pool_name("rbd");
+  assert(pool >= 0);
+
+  Messenger *msgr = Messenger::create(g_ceph_context, type,
+				      entity_name_t::CLIENT(-1), "client",
+				      getpid() + 1, 0);
+  msgr->set_default_policy(Messenger::Policy::lossy_client(0));
+  MonClient monc(g_ceph_context);
+  Objecter *objecter = new Objecter(g_ceph_context, msgr, &monc, nullptr,
+				    0, 0);
+  objecter->set_client_incarnation(0);
+  objecter->init();
+  msgr->add_dispatcher_tail(objecter);
+  msgr->start();
+  objecter->start(&osdmap);
+
+  bufferlist data;
+  data.append_zero(size);
+
+  cout << "threads " << threads << " ops " << ops << " depth " << depth
+       << " size " << size << std::endl;
+  auto start = ceph::mono_clock::now();
+  vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.push_back(std::thread(submitter, objecter, pool, i, ops,
+				  depth, std::cref(data)));
+  }
+  for (auto& t : workers) {
+    t.join();
+  }
+  double secs = std::chrono::duration<double>(
+    ceph::mono_clock::now() - start).count();
+  uint64_t total = ops * threads;
+  cout << total << " ops in " << secs << " s, "
+       << (uint64_t)(total / secs) << " ops/s" << std::endl;
+
+  objecter->shutdown();
+  msgr->shutdown();
+  msgr->wait();
+  delete objecter;
+  delete msgr;
+  osd.stop();
+  return 0;
+}
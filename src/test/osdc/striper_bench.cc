@@ -0,0 +1,122 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Time Striper::file_to_extents for a range of I/O sizes, through both
+ * the flat list and the per-object map interfaces, to measure the client
+ * side cost of mapping an I/O onto objects.
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "global/global_init.h"
+#include "osdc/Striper.h"
+
+using namespace std;
+
+static void usage(const char *name)
+{
+  cout << "usage: " << name << " [options]\n"
+       << "  --ops N            mappings per size (default 1000000)\n"
+       << "  --object-size N    layout object size (default 4194304)\n"
+       << "  --stripe-unit N    layout stripe unit (default object size)\n"
+       << "  --stripe-count N   layout stripe count (default 1)\n"
+       << std::endl;
+}
+
+template <typename Func>
+static double run(long long ops, Func&& f)
+{
+  auto start = ceph::mono_clock::now();
+  for (long long i = 0; i < ops; ++i) {
+    f(i);
+  }
+  double secs = std::chrono::duration<double>(
+    ceph::mono_clock::now() - start).count();
+  return secs * 1000000000.0 / ops;
+}
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  env_to_vec(args);
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  long long ops = 1000000;
+  uint32_t object_size = 4194304, stripe_unit = 0, stripe_count = 1;
+  std::string val;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_flag(args, i, "-h", "--help", (char*)NULL)) {
+      usage(argv[0]);
+      return 0;
+    } else if (ceph_argparse_witharg(args, i, &val, "--ops", (char*)NULL)) {
+      ops = atoll(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--object-size", (char*)NULL)) {
+      object_size = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--stripe-unit", (char*)NULL)) {
+      stripe_unit = atoi(val.c_str());
+    } else if (ceph_argparse_witharg(args, i, &val, "--stripe-count", (char*)NULL)) {
+      stripe_count = atoi(val.c_str());
+    } else {
+      cerr << "unknown option " << *i << std::endl;
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (stripe_unit == 0) {
+    stripe_unit = object_size;
+  }
+  if (ops <= 0 || object_size == 0 || stripe_count == 0 ||
+      stripe_unit > object_size || object_size % stripe_unit) {
+    usage(argv[0]);
+    return 1;
+  }
+  common_init_finish(g_ceph_context);
+
+  file_layout_t layout;
+  layout.object_size = object_size;
+  layout.stripe_unit = stripe_unit;
+  layout.stripe_count = stripe_count;
+  layout.pool_id = 1;
+
+  const char *format = "rbd_data.1234567890ab.%016llx";
+  const uint64_t sizes[] = { 512, 4096, 16384, 65536, 1 << 20, 4 << 20 };
+
+  cout << "object_size " << object_size << " stripe_unit " << stripe_unit
+       << " stripe_count " << stripe_count << " ops " << ops << std::endl;
+  for (auto len : sizes) {
+    // walk the image in len-sized steps so offsets are aligned like
+    // typical block I/O
+    double list_ns = run(ops, [&](long long i) {
+	vector<ObjectExtent> extents;
+	Striper::file_to_extents(g_ceph_context, format, &layout,
+				 (uint64_t)i * len, len, 0, extents);
+      });
+    double map_ns = run(ops, [&](long long i) {
+	map<object_t, vector<ObjectExtent> > extents;
+	Striper::file_to_extents(g_ceph_context, format, &layout,
+				 (uint64_t)i * len, len, 0, extents);
+      });
+    cout << "len " << len << ": list " << list_ns << " ns/op, map "
+	 << map_ns << " ns/op" << std::endl;
+  }
+  return 0;
+}
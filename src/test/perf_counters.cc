@@ -38,6 +38,7 @@
 #include <string.h>
 #include <string>
 #include <sys/socket.h>
+#include <thread>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <time.h>
@@ -219,3 +220,39 @@ TEST(PerfCounters, ResetPerfCounters) {
   ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf reset\", \"var\": \"test_perfcounter_1\", \"format\": \"json\" }", &msg));
   ASSERT_EQ(sd("{\"error\":\"Not find: test_perfcounter_1\"}"), msg);
 }
+
+enum {
+  TEST_PERFCOUNTERS3_ELEMENT_FIRST = 600,
+  TEST_PERFCOUNTERS3_ELEMENT_COUNT,
+  TEST_PERFCOUNTERS3_ELEMENT_AVG,
+  TEST_PERFCOUNTERS3_ELEMENT_LAST,
+};
+
+TEST(PerfCounters, ShardedPerfCounters) {
+  PerfCountersBuilder bld(g_ceph_context, "test_perfcounter_3",
+	  TEST_PERFCOUNTERS3_ELEMENT_FIRST, TEST_PERFCOUNTERS3_ELEMENT_LAST);
+  bld.set_sharded(true);
+  bld.add_u64_counter(TEST_PERFCOUNTERS3_ELEMENT_COUNT, "count");
+  bld.add_time_avg(TEST_PERFCOUNTERS3_ELEMENT_AVG, "avg");
+  std::unique_ptr<PerfCounters> pf(bld.create_perf_counters());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 20; t++) {
+    threads.emplace_back([&] {
+	for (int i = 0; i < 1000; i++) {
+	  pf->inc(TEST_PERFCOUNTERS3_ELEMENT_COUNT);
+	  pf->tinc(TEST_PERFCOUNTERS3_ELEMENT_AVG, utime_t(0, 1000000));
+	}
+      });
+  }
+  for (auto& t : threads)
+    t.join();
+  ASSERT_EQ(20000u, pf->get(TEST_PERFCOUNTERS3_ELEMENT_COUNT));
+  auto avg = pf->get_tavg_ms(TEST_PERFCOUNTERS3_ELEMENT_AVG);
+  ASSERT_EQ(20000u, avg.first);
+  ASSERT_EQ(20000u, avg.second);
+
+  pf->reset();
+  ASSERT_EQ(0u, pf->get(TEST_PERFCOUNTERS3_ELEMENT_COUNT));
+  ASSERT_EQ(0u, pf->get_tavg_ms(TEST_PERFCOUNTERS3_ELEMENT_AVG).first);
+}
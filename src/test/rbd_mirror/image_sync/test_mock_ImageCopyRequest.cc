@@ -84,9 +84,11 @@ namespace mirror {
 namespace image_sync {
 
 using ::testing::_;
+using ::testing::DoAll;
 using ::testing::InSequence;
 using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::StrEq;
 using ::testing::WithArg;
 using ::testing::InvokeWithoutArgs;
 
@@ -126,6 +128,35 @@ public:
       .WillOnce(WithArg<1>(CompleteContext(r)));
   }
 
+  void expect_test_fast_diff(librbd::MockTestImageCtx &mock_image_ctx,
+                             bool enabled) {
+    EXPECT_CALL(mock_image_ctx, test_features(RBD_FEATURE_FAST_DIFF, _))
+      .WillOnce(Return(enabled));
+  }
+
+  void expect_object_map_load(librbd::MockTestImageCtx &mock_image_ctx,
+                              librados::snap_t snap_id,
+                              const std::vector<uint8_t> &states, int r) {
+    ceph::BitVector<2> object_map;
+    object_map.set_crc_enabled(false);
+    object_map.resize(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+      object_map[i] = states[i];
+    }
+
+    bufferlist bl;
+    ::encode(object_map, bl);
+
+    std::string oid(librbd::ObjectMap<>::object_map_name(mock_image_ctx.id,
+                                                         snap_id));
+    EXPECT_CALL(get_mock_io_ctx(mock_image_ctx.md_ctx),
+                exec(oid, _, StrEq("rbd"), StrEq("object_map_load"), _, _, _))
+      .WillOnce(DoAll(WithArg<5>(Invoke([bl](bufferlist *out_bl) {
+                                          *out_bl = bl;
+                                        })),
+                      Return(r)));
+  }
+
   void expect_object_copy_send(MockObjectCopyRequest &mock_object_copy_request) {
     EXPECT_CALL(mock_object_copy_request, send());
   }
@@ -353,6 +384,94 @@ TEST_F(TestMockImageSyncImageCopyRequest, SnapshotSubset) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockImageSyncImageCopyRequest, FastDiffSkipsUnchangedObjects) {
+  ASSERT_EQ(0, create_snap("snap1"));
+  ASSERT_EQ(0, create_snap("snap2"));
+  m_client_meta.sync_points = {{cls::rbd::UserSnapshotNamespace(),
+				"snap2", "snap1", boost::none}};
+
+  librbd::MockTestImageCtx mock_remote_image_ctx(*m_remote_image_ctx);
+  librbd::MockTestImageCtx mock_local_image_ctx(*m_local_image_ctx);
+  journal::MockJournaler mock_journaler;
+  MockObjectCopyRequest mock_object_copy_request;
+
+  expect_get_snap_id(mock_remote_image_ctx);
+
+  auto snap_it = m_snap_map.begin();
+  librados::snap_t snap_id1 = (snap_it++)->first;
+  librados::snap_t snap_id2 = snap_it->first;
+
+  InSequence seq;
+  expect_get_object_count(mock_remote_image_ctx, 4);
+  expect_get_object_count(mock_remote_image_ctx, 4);
+  expect_get_object_count(mock_remote_image_ctx, 4);
+  expect_update_client(mock_journaler, 0);
+  expect_test_fast_diff(mock_remote_image_ctx, true);
+  // snap1 is the baseline: object 0 stays clean, object 1 is written,
+  // object 2 never exists and object 3 is removed
+  expect_object_map_load(mock_remote_image_ctx, snap_id1,
+                         {OBJECT_EXISTS_CLEAN, OBJECT_EXISTS_CLEAN,
+                          OBJECT_NONEXISTENT, OBJECT_EXISTS_CLEAN}, 0);
+  expect_object_map_load(mock_remote_image_ctx, snap_id2,
+                         {OBJECT_EXISTS_CLEAN, OBJECT_EXISTS,
+                          OBJECT_NONEXISTENT, OBJECT_NONEXISTENT}, 0);
+  expect_object_copy_send(mock_object_copy_request);
+  expect_object_copy_send(mock_object_copy_request);
+  expect_update_client(mock_journaler, 0);
+
+  C_SaferCond ctx;
+  MockImageCopyRequest *request = create_request(mock_remote_image_ctx,
+                                                 mock_local_image_ctx,
+                                                 mock_journaler,
+                                                 m_client_meta.sync_points.front(),
+                                                 &ctx);
+  request->send();
+
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 1, 0));
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 3, 0));
+  ASSERT_EQ(0, ctx.wait());
+
+  ASSERT_EQ(0U, mock_object_copy_request.object_contexts.count(0));
+  ASSERT_EQ(0U, mock_object_copy_request.object_contexts.count(2));
+}
+
+TEST_F(TestMockImageSyncImageCopyRequest, FastDiffLoadErrorCopiesAll) {
+  ASSERT_EQ(0, create_snap("snap1"));
+  m_client_meta.sync_points = {{cls::rbd::UserSnapshotNamespace(),
+				"snap1",
+				boost::none}};
+
+  librbd::MockTestImageCtx mock_remote_image_ctx(*m_remote_image_ctx);
+  librbd::MockTestImageCtx mock_local_image_ctx(*m_local_image_ctx);
+  journal::MockJournaler mock_journaler;
+  MockObjectCopyRequest mock_object_copy_request;
+
+  expect_get_snap_id(mock_remote_image_ctx);
+
+  InSequence seq;
+  expect_get_object_count(mock_remote_image_ctx, 2);
+  expect_get_object_count(mock_remote_image_ctx, 2);
+  expect_update_client(mock_journaler, 0);
+  expect_test_fast_diff(mock_remote_image_ctx, true);
+  expect_object_map_load(mock_remote_image_ctx, m_snap_map.begin()->first,
+                         {}, -EINVAL);
+  expect_object_copy_send(mock_object_copy_request);
+  expect_object_copy_send(mock_object_copy_request);
+  expect_update_client(mock_journaler, 0);
+
+  C_SaferCond ctx;
+  MockImageCopyRequest *request = create_request(mock_remote_image_ctx,
+                                                 mock_local_image_ctx,
+                                                 mock_journaler,
+                                                 m_client_meta.sync_points.front(),
+                                                 &ctx);
+  request->send();
+
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 0, 0));
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 1, 0));
+  ASSERT_EQ(0, ctx.wait());
+}
+
 TEST_F(TestMockImageSyncImageCopyRequest, RestartCatchup) {
   ASSERT_EQ(0, create_snap("snap1"));
   ASSERT_EQ(0, create_snap("snap2"));
@@ -125,6 +125,7 @@ TEST(Compress, LimitedChunkSize)
   for (size_t s = 100 ; s < 10000000 ; s = s*5/4)
   {
     bufferptr bp(s);
+    bp.zero();
     bufferlist bl;
     bl.append(bp);
 
@@ -199,3 +200,88 @@ TEST(Compress, BillionZeros)
 
   ASSERT_EQ(d_sink.get_sink().length() , size*1000);
 }
+
+TEST(Compress, Pipelined)
+{
+  CompressorRef plugin;
+  ut_put_sink c_sink;
+  plugin = Compressor::create(g_ceph_context, Compressor::COMP_ALG_ZLIB);
+  ASSERT_NE(plugin.get(), nullptr);
+  RGWPutObj_Compress compressor(g_ceph_context, plugin, &c_sink, true);
+
+  constexpr size_t size = 1000000;
+  constexpr int parts = 10;
+  bufferlist orig;
+
+  void* handle;
+  rgw_raw_obj obj;
+  bool again = false;
+
+  for (int i = 0; i < parts; i++) {
+    bufferptr bp(size);
+    memset(bp.c_str(), 'a' + i, size);
+    bufferlist bl;
+    bl.append(bp);
+    orig.append(bl);
+    ASSERT_EQ(0, compressor.handle_data(bl, size*i, &handle, &obj, &again));
+    ASSERT_FALSE(again);
+  }
+
+  bufferlist empty;
+  ASSERT_EQ(0, compressor.handle_data(empty, size*parts, &handle, &obj, &again));
+  ASSERT_FALSE(again);
+  ASSERT_TRUE(compressor.is_compressed());
+
+  RGWCompressionInfo cs_info;
+  cs_info.compression_type = plugin->get_type_name();
+  cs_info.orig_size = size*parts;
+  cs_info.blocks = move(compressor.get_compression_blocks());
+  ASSERT_EQ((size_t)parts, cs_info.blocks.size());
+
+  ut_get_sink d_sink;
+  RGWGetObj_Decompress decompress(g_ceph_context, &cs_info, false, &d_sink);
+
+  off_t f_begin = 0;
+  off_t f_end = size*parts - 1;
+  decompress.fixup_range(f_begin, f_end);
+
+  decompress.handle_data(c_sink.get_sink(), 0, c_sink.get_sink().length());
+  decompress.handle_data(empty, 0, 0);
+
+  ASSERT_TRUE(d_sink.get_sink().contents_equal(orig));
+}
+
+TEST(Compress, Incompressible)
+{
+  CompressorRef plugin;
+  ut_put_sink c_sink;
+  plugin = Compressor::create(g_ceph_context, Compressor::COMP_ALG_ZLIB);
+  ASSERT_NE(plugin.get(), nullptr);
+  RGWPutObj_Compress compressor(g_ceph_context, plugin, &c_sink);
+
+  constexpr size_t size = 100000;
+  bufferlist orig;
+
+  void* handle;
+  rgw_raw_obj obj;
+  bool again = false;
+
+  unsigned int seed = 42;
+  for (int i = 0; i < 3; i++) {
+    bufferptr bp(size);
+    for (size_t j = 0; j < size; j++) {
+      bp.c_str()[j] = rand_r(&seed);
+    }
+    bufferlist bl;
+    bl.append(bp);
+    orig.append(bl);
+    compressor.handle_data(bl, size*i, &handle, &obj, &again);
+  }
+
+  bufferlist empty;
+  compressor.handle_data(empty, size*3, &handle, &obj, &again);
+
+  ASSERT_FALSE(compressor.is_compressed());
+  ASSERT_TRUE(compressor.get_compression_blocks().empty());
+  ASSERT_TRUE(c_sink.get_sink().contents_equal(orig));
+}
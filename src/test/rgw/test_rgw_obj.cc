@@ -280,3 +280,78 @@ TEST(TestRGWObj, old_to_raw) {
     }
   }
 }
+
+/*
+ * Lay out index entries the way the write path shards them, then page
+ * through them the way an unordered bucket listing does: one shard after
+ * the other, resuming in the shard the previous page's last key hashes to.
+ */
+TEST(TestRGWObj, unordered_list_resume) {
+  RGWBucketInfo info;
+  test_rgw_init_bucket(&info.bucket, "test");
+  info.num_shards = 7;
+
+  vector<rgw_obj> objs;
+  for (int i = 0; i < 40; ++i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "obj%d", i);
+    objs.emplace_back(info.bucket, string(buf));
+    snprintf(buf, sizeof(buf), "_obj%d", i);
+    objs.emplace_back(info.bucket, string(buf));
+    snprintf(buf, sizeof(buf), "dir.%d/obj", i);
+    objs.emplace_back(info.bucket, rgw_obj_key(buf, "v1"));
+  }
+  for (int i = 0; i < 10; ++i) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "upload%d", i);
+    RGWMPObj mp(buf, "2~abcdef");
+    rgw_obj meta(info.bucket, rgw_obj_key(mp.get_meta(), "",
+                                          RGW_OBJ_NS_MULTIPART));
+    meta.index_hash_source = mp.get_key();
+    objs.push_back(meta);
+    for (int part = 1; part <= 3; ++part) {
+      rgw_obj p(info.bucket, rgw_obj_key(mp.get_part(part), "",
+                                         RGW_OBJ_NS_MULTIPART));
+      p.index_hash_source = mp.get_key();
+      objs.push_back(p);
+    }
+  }
+
+  map<int, map<string, rgw_obj_index_key>> shards;
+  for (auto& o : objs) {
+    int shard;
+    ASSERT_EQ(0, RGWRados::get_target_shard_id(info, o.get_hash_object(),
+                                               &shard));
+    rgw_obj_index_key k;
+    o.key.get_index_key(&k);
+    ASSERT_EQ(o.get_hash_object(), RGWRados::get_index_hash_source(k));
+    shards[shard][k.name + '\0' + k.instance] = k;
+  }
+  ASSERT_GT(shards.size(), 1u);
+
+  set<string> seen;
+  rgw_obj_index_key marker;
+  bool truncated = true;
+  while (truncated) {
+    int shard = 0;
+    if (!marker.name.empty()) {
+      ASSERT_EQ(0, RGWRados::get_target_shard_id(
+                  info, RGWRados::get_index_hash_source(marker), &shard));
+    }
+    string after = marker.name.empty() ? string() :
+      marker.name + '\0' + marker.instance;
+    unsigned count = 0;
+    for (; shard < (int)info.num_shards && count < 3; ++shard, after.clear()) {
+      auto& entries = shards[shard];
+      for (auto i = entries.upper_bound(after);
+           i != entries.end() && count < 3; ++i, ++count) {
+        ASSERT_TRUE(seen.insert(i->first).second);
+        marker = i->second;
+      }
+      if (count == 3)
+        break;
+    }
+    truncated = shard < (int)info.num_shards;
+  }
+  ASSERT_EQ(objs.size(), seen.size());
+}
@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <thread>
 
 #include "global/global_init.h"
 #include "common/ceph_argparse.h"
@@ -322,6 +323,52 @@ TEST(mempool, bufferlist_reassign)
   ASSERT_EQ(bytes_before, mempool::osd::allocated_bytes());
 }
 
+TEST(mempool, shard_per_thread)
+{
+  // threads that start one after the other get distinct shards
+  mempool::pool_t& pool = mempool::get_pool(mempool::mempool_osd);
+  std::set<mempool::shard_t*> shards;
+  for (int i = 0; i < mempool::num_shards; ++i) {
+    mempool::shard_t *shard = nullptr;
+    std::thread t([&] { shard = pool.pick_a_shard(); });
+    t.join();
+    shards.insert(shard);
+  }
+  ASSERT_EQ((size_t)mempool::num_shards, shards.size());
+}
+
+TEST(mempool, slab)
+{
+  mempool::pool_t& pool = mempool::get_pool(mempool::mempool_unittest_2);
+  size_t items_before = pool.allocated_items();
+  size_t bytes_before = pool.allocated_bytes();
+  {
+    // allocated without the slab, freed through it
+    mempool::unittest_2::map<int,int> m;
+    for (int i = 0; i < 1000; ++i) {
+      m[i] = i;
+    }
+    pool.set_use_slab(true);
+    m.clear();
+    // freed items are handed out again
+    mempool::unittest_2::list<int> l;
+    l.push_back(1);
+    int *first = &l.front();
+    l.pop_front();
+    l.push_back(2);
+    ASSERT_EQ(first, &l.front());
+    for (int i = 0; i < 1000; ++i) {
+      m[i] = i;
+    }
+    ASSERT_EQ(items_before + 1001, pool.allocated_items());
+    // allocated through the slab, freed without it
+    pool.set_use_slab(false);
+  }
+  ASSERT_EQ(items_before, pool.allocated_items());
+  ASSERT_EQ(bytes_before, pool.allocated_bytes());
+  mempool::slab_trim();
+}
+
 int main(int argc, char **argv)
 {
   vector<const char*> args;
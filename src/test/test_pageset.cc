@@ -1,5 +1,6 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab
+#include <thread>
 #include "gtest/gtest.h"
 
 #include "os/memstore/PageSet.h"
@@ -281,3 +282,60 @@ TEST(PageSet, FreeHoles)
   pages.get_range(0, 8, range);
   ASSERT_EQ(0u, range.size());
 }
+
+TEST(PageSet, Sparse)
+{
+  // pages far apart grow the radix tree without filling the gap
+  PageSet pages(4096);
+  PageSet::page_vector range;
+  pages.alloc_range(0, 1, range);
+  pages.alloc_range(1ull << 40, 1, range);
+  pages.alloc_range((1ull << 52) - 4096, 4096, range);
+  range.clear();
+  ASSERT_EQ(3u, pages.size());
+
+  pages.get_range(0, UINT64_MAX, range);
+  ASSERT_EQ(3u, range.size());
+  ASSERT_EQ(0u, range[0]->offset);
+  ASSERT_EQ(1ull << 40, range[1]->offset);
+  ASSERT_EQ((1ull << 52) - 4096, range[2]->offset);
+  range.clear();
+
+  pages.free_pages_after(1);
+  ASSERT_EQ(1u, pages.size());
+  pages.get_range(0, UINT64_MAX, range);
+  ASSERT_EQ(1u, range.size());
+  ASSERT_EQ(0u, range[0]->offset);
+}
+
+TEST(PageSet, ConcurrentTruncate)
+{
+  // readers keep their page refs valid while a writer frees the pages
+  PageSet pages(1);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+	PageSet::page_vector range;
+	volatile char sink;
+	while (!stop) {
+	  pages.get_range(0, 64, range);
+	  for (auto &page : range) {
+	    ASSERT_GT(64u, page->offset);
+	    sink = page->data[0]; // must not be freed under us
+	  }
+	  range.clear();
+	}
+      });
+  }
+  PageSet::page_vector range;
+  for (int i = 0; i < 1000; i++) {
+    pages.alloc_range(0, 64, range);
+    ASSERT_EQ(64u, range.size());
+    range.clear();
+    pages.free_pages_after(i % 64);
+  }
+  stop = true;
+  for (auto &t : readers)
+    t.join();
+}
@@ -0,0 +1,110 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+#include <algorithm>
+#include <string>
+#include <thread>
+#include "gtest/gtest.h"
+
+#include "os/memstore/SkipMap.h"
+
+typedef SkipMap<std::string,int> smap;
+
+static std::vector<std::string> keys(const smap &m)
+{
+  std::vector<std::string> out;
+  m.for_each([&out](const std::string &k, const int&) { out.push_back(k); });
+  return out;
+}
+
+TEST(SkipMap, SetGet)
+{
+  smap m;
+  ASSERT_TRUE(m.empty());
+  for (int i = 0; i < 100; i++)
+    m.set(std::to_string(99 - i), 99 - i);
+  ASSERT_EQ(100u, m.size());
+
+  int v;
+  ASSERT_TRUE(m.get("42", &v));
+  ASSERT_EQ(42, v);
+  ASSERT_FALSE(m.get("100", &v));
+
+  // overwrite keeps a single entry
+  m.set("42", -1);
+  m.reclaim();
+  ASSERT_EQ(100u, m.size());
+  ASSERT_TRUE(m.get("42", &v));
+  ASSERT_EQ(-1, v);
+
+  auto k = keys(m);
+  ASSERT_TRUE(std::is_sorted(k.begin(), k.end()));
+}
+
+TEST(SkipMap, Bounds)
+{
+  smap m;
+  for (auto k : {"b", "d", "f"})
+    m.set(k, 0);
+
+  std::string k;
+  ASSERT_TRUE(m.first(&k, nullptr));
+  ASSERT_EQ("b", k);
+  ASSERT_TRUE(m.lower_bound("d", &k, nullptr));
+  ASSERT_EQ("d", k);
+  ASSERT_TRUE(m.upper_bound("d", &k, nullptr));
+  ASSERT_EQ("f", k);
+  ASSERT_TRUE(m.lower_bound("c", &k, nullptr));
+  ASSERT_EQ("d", k);
+  ASSERT_FALSE(m.upper_bound("f", &k, nullptr));
+}
+
+TEST(SkipMap, Erase)
+{
+  smap m;
+  for (auto k : {"a", "b", "c", "d", "e"})
+    m.set(k, 0);
+
+  m.erase("c");
+  m.erase("x");
+  ASSERT_EQ((std::vector<std::string>{"a", "b", "d", "e"}), keys(m));
+
+  // [first, last)
+  m.erase_range("b", "e");
+  ASSERT_EQ((std::vector<std::string>{"a", "e"}), keys(m));
+
+  m.clear();
+  m.reclaim();
+  ASSERT_TRUE(m.empty());
+  ASSERT_TRUE(keys(m).empty());
+}
+
+TEST(SkipMap, ConcurrentReaders)
+{
+  // readers see sorted keys and valid values while a writer churns
+  smap m;
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+	while (!stop) {
+	  std::string prev;
+	  m.for_each([&prev](const std::string &k, const int &v) {
+	      ASSERT_LT(prev, k);
+	      ASSERT_EQ(std::stoi(k) % 1000, v % 1000);
+	      prev = k;
+	    });
+	}
+      });
+  }
+  for (int i = 0; i < 5000; i++) {
+    const int k = 1000 + (i * 7919) % 1000;
+    if (i % 3)
+      m.set(std::to_string(k), k + i * 1000);
+    else
+      m.erase(std::to_string(k));
+    m.reclaim();
+  }
+  stop = true;
+  for (auto &t : readers)
+    t.join();
+}
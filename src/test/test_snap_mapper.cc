@@ -568,6 +568,36 @@ public:
     hobject_to_snap.erase(obj);
   }
 
+  void remove_oids() {
+    Mutex::Locker l(lock);
+    if (hobject_to_snap.empty())
+      return;
+    set<hobject_t> picked;
+    for (int n = rand() % 4 + 1; n > 0; --n)
+      picked.insert(rand_choose(hobject_to_snap)->first);
+    for (auto &obj : picked) {
+      for (auto &snap : hobject_to_snap[obj]) {
+	map<snapid_t, set<hobject_t> >::iterator j =
+	  snap_to_hobject.find(snap);
+	assert(j->second.count(obj));
+	j->second.erase(obj);
+      }
+      hobject_to_snap.erase(obj);
+    }
+    {
+      PausyAsyncMap::Transaction t;
+      int r = mapper->remove_oids(
+	vector<hobject_t>(picked.begin(), picked.end()),
+	&t);
+      assert(r == 0);
+      driver->submit(&t);
+    }
+    for (auto &obj : picked) {
+      set<snapid_t> snaps;
+      ASSERT_EQ(-ENOENT, mapper->get_snaps(obj, &snaps));
+    }
+  }
+
   void check_oid() {
     Mutex::Locker l(lock);
     if (hobject_to_snap.empty())
@@ -621,7 +651,7 @@ protected:
     for (int i = 0; i < 5000; ++i) {
       if (!(i % 50))
 	std::cout << i << std::endl;
-      switch (rand() % 5) {
+      switch (rand() % 6) {
       case 0:
 	get_tester().create_snap();
 	break;
@@ -637,6 +667,9 @@ protected:
       case 4:
 	get_tester().remove_oid();
 	break;
+      case 5:
+	get_tester().remove_oids();
+	break;
       }
     }
   }
@@ -70,3 +70,46 @@ TEST(Striper, GetNumObj)
   numobjs = Striper::get_num_objects(l, size);
   ASSERT_EQ(6u, numobjs);
 }
+
+TEST(Striper, SingleExtentMatchesMap)
+{
+  file_layout_t layouts[3];
+  layouts[0].object_size = 4194304;
+  layouts[0].stripe_unit = 4194304;
+  layouts[0].stripe_count = 1;
+  layouts[1].object_size = 262144;
+  layouts[1].stripe_unit = 4096;
+  layouts[1].stripe_count = 3;
+  layouts[2].object_size = 300000;   // not a power of two
+  layouts[2].stripe_unit = 60000;
+  layouts[2].stripe_count = 5;
+
+  const uint64_t offs[] = { 0, 4095, 65536, 4194300, 725549056, 5006035 };
+  const uint64_t lens[] = { 1, 512, 4096, 65536 };
+  for (auto& l : layouts) {
+    for (auto off : offs) {
+      for (auto len : lens) {
+	vector<ObjectExtent> ex;
+	Striper::file_to_extents(g_ceph_context, "obj.%016llx", &l, off, len,
+				 off + len, ex, 7);
+
+	map<object_t, vector<ObjectExtent> > object_extents;
+	Striper::file_to_extents(g_ceph_context, "obj.%016llx", &l, off, len,
+				 off + len, object_extents, 7);
+	vector<ObjectExtent> expected;
+	Striper::assimilate_extents(object_extents, expected);
+
+	ASSERT_EQ(expected.size(), ex.size());
+	for (size_t i = 0; i < ex.size(); i++) {
+	  ASSERT_EQ(expected[i].oid, ex[i].oid);
+	  ASSERT_EQ(expected[i].objectno, ex[i].objectno);
+	  ASSERT_EQ(expected[i].offset, ex[i].offset);
+	  ASSERT_EQ(expected[i].length, ex[i].length);
+	  ASSERT_EQ(expected[i].truncate_size, ex[i].truncate_size);
+	  ASSERT_EQ(expected[i].oloc, ex[i].oloc);
+	  ASSERT_EQ(expected[i].buffer_extents, ex[i].buffer_extents);
+	}
+      }
+    }
+  }
+}
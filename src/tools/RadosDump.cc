@@ -14,18 +14,76 @@
 
 #include "RadosDump.h"
 
-int RadosDump::read_super()
+#include "common/ceph_context.h"
+#include "global/global_context.h"
+
+// Sections smaller than this are not worth a compressed_section wrapper
+static const unsigned min_compress_len = 4096;
+
+// Read len bytes, taking them from the expanded compressed input first
+int RadosDump::read_bytes(bufferlist &bl, size_t len)
 {
-  bufferlist ebl;
-  bufferlist::iterator ebliter = ebl.begin();
-  ssize_t bytes;
+  size_t have = MIN(len, (size_t)pending.length());
+  if (have) {
+    pending.splice(0, have, &bl);
+  }
+  if (have < len) {
+    ssize_t bytes = bl.read_fd(file_fd, len - have);
+    if (bytes < 0 || (size_t)bytes != len - have) {
+      cerr << "Unexpected EOF" << std::endl;
+      return -EFAULT;
+    }
+  }
+  return 0;
+}
 
-  bytes = ebl.read_fd(file_fd, super_header::FIXED_LENGTH);
-  if ((size_t)bytes != super_header::FIXED_LENGTH) {
-    cerr << "Unexpected EOF" << std::endl;
+int RadosDump::expand_compressed(bufferlist &bl)
+{
+  compressed_section cs;
+  try {
+    bufferlist::iterator p = bl.begin();
+    cs.decode(p);
+  } catch (buffer::error &e) {
+    cerr << "Corrupt compressed section" << std::endl;
     return -EFAULT;
   }
+  CompressorRef c = Compressor::create(g_ceph_context, cs.alg);
+  if (!c) {
+    cerr << "Export compressed with unsupported algorithm " << cs.alg
+	 << std::endl;
+    return -EINVAL;
+  }
+  bufferlist raw;
+  int r = c->decompress(cs.data, raw);
+  if (r < 0 || raw.length() != cs.raw_len) {
+    cerr << "Failed to decompress " << cs.alg << " section" << std::endl;
+    return -EFAULT;
+  }
+  raw.claim_append(pending);
+  pending.swap(raw);
+  return 0;
+}
+
+int RadosDump::set_compression(const string &alg)
+{
+  compressor = Compressor::create(g_ceph_context, alg);
+  if (!compressor) {
+    cerr << "Unsupported compression algorithm " << alg << std::endl;
+    return -EINVAL;
+  }
+  return 0;
+}
+
+int RadosDump::read_super()
+{
+  bufferlist ebl;
+  bufferlist::iterator ebliter;
 
+  int ret = read_bytes(ebl, super_header::FIXED_LENGTH);
+  if (ret)
+    return ret;
+
+  ebliter = ebl.begin();
   sh.decode(ebliter);
 
   return 0;
@@ -37,15 +95,13 @@ int RadosDump::get_header(header *h)
   assert (h != NULL);
 
   bufferlist ebl;
-  bufferlist::iterator ebliter = ebl.begin();
-  ssize_t bytes;
+  bufferlist::iterator ebliter;
 
-  bytes = ebl.read_fd(file_fd, sh.header_size);
-  if ((size_t)bytes != sh.header_size) {
-    cerr << "Unexpected EOF" << std::endl;
-    return -EFAULT;
-  }
+  int ret = read_bytes(ebl, sh.header_size);
+  if (ret)
+    return ret;
 
+  ebliter = ebl.begin();
   h->decode(ebliter);
 
   return 0;
@@ -56,15 +112,13 @@ int RadosDump::get_footer(footer *f)
   assert(f != NULL);
 
   bufferlist ebl;
-  bufferlist::iterator ebliter = ebl.begin();
-  ssize_t bytes;
+  bufferlist::iterator ebliter;
 
-  bytes = ebl.read_fd(file_fd, sh.footer_size);
-  if ((size_t)bytes != sh.footer_size) {
-    cerr << "Unexpected EOF" << std::endl;
-    return -EFAULT;
-  }
+  int ret = read_bytes(ebl, sh.footer_size);
+  if (ret)
+    return ret;
 
+  ebliter = ebl.begin();
   f->decode(ebliter);
 
   if (f->magic != endmagic) {
@@ -77,30 +131,35 @@ int RadosDump::get_footer(footer *f)
 
 int RadosDump::read_section(sectiontype_t *type, bufferlist *bl)
 {
-  header hdr;
-  ssize_t bytes;
+  while (true) {
+    header hdr;
 
-  int ret = get_header(&hdr);
-  if (ret)
-    return ret;
+    int ret = get_header(&hdr);
+    if (ret)
+      return ret;
 
-  *type = hdr.type;
+    *type = hdr.type;
 
-  bl->clear();
-  bytes = bl->read_fd(file_fd, hdr.size);
-  if (bytes != hdr.size) {
-    cerr << "Unexpected EOF" << std::endl;
-    return -EFAULT;
-  }
+    bl->clear();
+    if (hdr.size < 0)
+      return -EFAULT;
+    ret = read_bytes(*bl, hdr.size);
+    if (ret)
+      return ret;
+
+    if (hdr.size > 0) {
+      footer ft;
+      ret = get_footer(&ft);
+      if (ret)
+        return ret;
+    }
 
-  if (hdr.size > 0) {
-    footer ft;
-    ret = get_footer(&ft);
+    if (*type != TYPE_COMPRESSED)
+      return 0;
+    ret = expand_compressed(*bl);
     if (ret)
       return ret;
   }
-
-  return 0;
 }
 
 
@@ -155,7 +214,9 @@ void RadosDump::write_super()
   hdr.encode(superbl);
 
   sh.magic = super_header::super_magic;
-  sh.version = super_header::super_ver;
+  // Only compressed exports need a reader that knows TYPE_COMPRESSED
+  sh.version = compressor ? super_header::super_ver :
+    super_header::super_ver_uncompressed;
   sh.header_size = superbl.length();
   superbl.clear();
   ft.encode(superbl);
@@ -166,3 +227,34 @@ void RadosDump::write_super()
   assert(super_header::FIXED_LENGTH == superbl.length());
   superbl.write_fd(file_fd);
 }
+
+// Append the encoded sections in 'in' to 'out', compressed if enabled.
+// Safe to call from several threads at once.
+int RadosDump::compress_sections(bufferlist &in, bufferlist *out) const
+{
+  if (!compressor || in.length() < min_compress_len) {
+    out->claim_append(in);
+    return 0;
+  }
+  bufferlist cbl;
+  int r = compressor->compress(in, cbl);
+  if (r < 0 || cbl.length() >= in.length()) {
+    out->claim_append(in);
+    return 0;
+  }
+  compressed_section cs(compressor->get_type_name(), in.length(), cbl);
+  encode_section(TYPE_COMPRESSED, cs, *out);
+  in.clear();
+  return 0;
+}
+
+int RadosDump::write_sections(bufferlist &bl, int fd)
+{
+  if (dry_run)
+    return 0;
+  bufferlist out;
+  int r = compress_sections(bl, &out);
+  if (r)
+    return r;
+  return out.write_fd(fd);
+}
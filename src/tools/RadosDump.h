@@ -19,6 +19,7 @@
 
 #include "include/buffer.h"
 #include "include/encoding.h"
+#include "compressor/Compressor.h"
 
 #include "osd/osd_types.h"
 #include "osd/OSDMap.h"
@@ -40,6 +41,7 @@ enum {
     TYPE_PG_METADATA,
     TYPE_POOL_BEGIN,
     TYPE_POOL_END,
+    TYPE_COMPRESSED,
     END_OF_TYPES,	//Keep at the end
 };
 
@@ -57,7 +59,9 @@ struct super_header {
   static const uint32_t super_magic = (shortmagic << 16) | shortmagic;
   // ver = 1, Initial version
   // ver = 2, Add OSDSuperblock to pg_begin
-  static const uint32_t super_ver = 2;
+  // ver = 3, Add TYPE_COMPRESSED (only written for compressed exports)
+  static const uint32_t super_ver = 3;
+  static const uint32_t super_ver_uncompressed = 2;
   static const uint32_t FIXED_LENGTH = 16;
   uint32_t magic;
   uint32_t version;
@@ -278,6 +282,32 @@ struct omap_section {
   }
 };
 
+// A run of whole sections, compressed together.  The reader expands it
+// in place, so everything above read_section() never sees it.
+struct compressed_section {
+  string alg;
+  uint32_t raw_len;
+  bufferlist data;
+  compressed_section(const string &alg, uint32_t raw_len, bufferlist bl)
+    : alg(alg), raw_len(raw_len), data(bl) { }
+  compressed_section() : raw_len(0) { }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    ::encode(alg, bl);
+    ::encode(raw_len, bl);
+    ::encode(data, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::iterator& bl) {
+    DECODE_START(1, bl);
+    ::decode(alg, bl);
+    ::decode(raw_len, bl);
+    ::decode(data, bl);
+    DECODE_FINISH(bl);
+  }
+};
+
 struct metadata_section {
   // struct_ver is the on-disk version of original pg
   __u8 struct_ver;  // for reference
@@ -359,37 +389,54 @@ class RadosDump
     int file_fd;
     super_header sh;
     bool dry_run;
+    CompressorRef compressor;  ///< for writing; null if uncompressed
+    bufferlist pending;        ///< expanded input not yet consumed
+
+    int read_bytes(bufferlist &bl, size_t len);
+    int expand_compressed(bufferlist &bl);
 
   public:
     RadosDump(int file_fd_, bool dry_run_)
       : file_fd(file_fd_), dry_run(dry_run_)
     {}
 
+    int set_compression(const string &alg);
+
     int read_super();
     int get_header(header *h);
     int get_footer(footer *f);
     int read_section(sectiontype_t *type, bufferlist *bl);
     int skip_object(bufferlist &bl);
     void write_super();
+    int compress_sections(bufferlist &in, bufferlist *out) const;
+    int write_sections(bufferlist &bl, int fd);
 
     // Define this in .h because it's templated
     template <typename T>
-      int write_section(sectiontype_t type, const T& obj, int fd) {
-        if (dry_run)
-          return 0;
-        bufferlist blhdr, bl, blftr;
+      static void encode_section(sectiontype_t type, const T& obj,
+				 bufferlist &out) {
+        bufferlist bl;
         obj.encode(bl);
         header hdr(type, bl.length());
-        hdr.encode(blhdr);
+        hdr.encode(out);
+        out.claim_append(bl);
         footer ft;
-        ft.encode(blftr);
-
-        int ret = blhdr.write_fd(fd);
-        if (ret) return ret;
-        ret = bl.write_fd(fd);
-        if (ret) return ret;
-        ret = blftr.write_fd(fd);
-        return ret;
+        ft.encode(out);
+      }
+
+    static void encode_simple(sectiontype_t type, bufferlist &out)
+    {
+      header hdr(type, 0);
+      hdr.encode(out);
+    }
+
+    template <typename T>
+      int write_section(sectiontype_t type, const T& obj, int fd) {
+        if (dry_run)
+          return 0;
+        bufferlist bl;
+        encode_section(type, obj, bl);
+        return write_sections(bl, fd);
       }
 
     int write_simple(sectiontype_t type, int fd)
@@ -397,10 +444,8 @@ class RadosDump
       if (dry_run)
         return 0;
       bufferlist hbl;
-
-      header hdr(type, 0);
-      hdr.encode(hbl);
-      return hbl.write_fd(fd);
+      encode_simple(type, hbl);
+      return write_sections(hbl, fd);
     }
 };
 
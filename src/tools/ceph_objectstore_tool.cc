@@ -18,10 +18,13 @@
 #include <boost/optional.hpp>
 
 #include <stdlib.h>
+#include <atomic>
+#include <thread>
 
 #include "common/Formatter.h"
 #include "common/errno.h"
 #include "common/ceph_argparse.h"
+#include "common/Cond.h"
 
 #include "global/global_init.h"
 
@@ -500,7 +503,8 @@ void get_omap_batch(ObjectMap::ObjectMapIterator &iter, map<string, bufferlist>
   }
 }
 
-int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj)
+int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj,
+				 bufferlist *out)
 {
   struct stat st;
   mysize_t total;
@@ -510,8 +514,6 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   if (ret < 0)
     return ret;
 
-  cerr << "Read " << obj << std::endl;
-
   total = st.st_size;
   if (debug)
     cerr << "size=" << total << std::endl;
@@ -534,7 +536,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
   // NOTE: we include whiteouts, lost, etc.
 
-  ret = write_section(TYPE_OBJECT_BEGIN, objb, file_fd);
+  ret = put_section(TYPE_OBJECT_BEGIN, objb, out);
   if (ret < 0)
     return ret;
 
@@ -559,7 +561,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
     total -= ret;
     offset += ret;
 
-    ret = write_section(TYPE_DATA, dblock, file_fd);
+    ret = put_section(TYPE_DATA, dblock, out);
     if (ret) return ret;
   }
 
@@ -568,7 +570,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   ret = store->getattrs(cid, obj, aset);
   if (ret) return ret;
   attr_section as(aset);
-  ret = write_section(TYPE_ATTRS, as, file_fd);
+  ret = put_section(TYPE_ATTRS, as, out);
   if (ret)
     return ret;
 
@@ -585,7 +587,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
 
   omap_hdr_section ohs(hdrbuf);
-  ret = write_section(TYPE_OMAP_HDR, ohs, file_fd);
+  ret = put_section(TYPE_OMAP_HDR, ohs, out);
   if (ret)
     return ret;
 
@@ -597,28 +599,32 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
   iter->seek_to_first();
   int mapcount = 0;
-  map<string, bufferlist> out;
+  map<string, bufferlist> oset;
   while(iter->valid()) {
-    get_omap_batch(iter, out);
+    get_omap_batch(iter, oset);
 
-    if (out.empty()) break;
+    if (oset.empty()) break;
 
-    mapcount += out.size();
-    omap_section oms(out);
-    ret = write_section(TYPE_OMAP, oms, file_fd);
+    mapcount += oset.size();
+    omap_section oms(oset);
+    ret = put_section(TYPE_OMAP, oms, out);
     if (ret)
       return ret;
   }
   if (debug)
     cerr << "omap map size " << mapcount << std::endl;
 
-  ret = write_simple(TYPE_OBJECT_END, file_fd);
+  ret = put_simple(TYPE_OBJECT_END, out);
   if (ret)
     return ret;
 
   return 0;
 }
 
+// Objects larger than this are streamed to the file by the main thread
+// rather than buffered by an export worker.
+const uint64_t max_buffered_object = 16 << 20;
+
 int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
 {
   ghobject_t next;
@@ -629,6 +635,7 @@ int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
       &objects, &next);
     if (r < 0)
       return r;
+    vector<ghobject_t> todo;
     for (vector<ghobject_t>::iterator i = objects.begin();
 	 i != objects.end();
 	 ++i) {
@@ -636,9 +643,57 @@ int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
       if (i->is_pgmeta() || i->hobj.is_temp()) {
 	continue;
       }
-      r = export_file(store, coll, *i);
-      if (r < 0)
-        return r;
+      todo.push_back(*i);
+    }
+
+    // Read, encode and compress a window of objects in parallel, then write
+    // them in listing order so the export does not depend on n_threads.
+    const size_t window = n_threads * 2;
+    for (size_t base = 0; base < todo.size(); base += window) {
+      size_t n = std::min(window, todo.size() - base);
+      vector<bufferlist> bls(n);
+      vector<int> rets(n, 0);  // 1 means too large to buffer
+      std::atomic<size_t> next_obj = { 0 };
+      auto worker = [&]() {
+	size_t i;
+	while ((i = next_obj++) < n) {
+	  ghobject_t &obj = todo[base + i];
+	  struct stat st;
+	  int r = store->stat(coll, obj, &st);
+	  if (r < 0) {
+	    rets[i] = r;
+	  } else if ((uint64_t)st.st_size > max_buffered_object) {
+	    rets[i] = 1;
+	  } else {
+	    bufferlist raw;
+	    r = export_file(store, coll, obj, &raw);
+	    if (r == 0)
+	      r = compress_sections(raw, &bls[i]);
+	    rets[i] = r;
+	  }
+	}
+      };
+      vector<std::thread> threads;
+      for (size_t t = 1; t < std::min<size_t>(n_threads, n); t++)
+	threads.emplace_back(worker);
+      worker();
+      for (auto &t : threads)
+	t.join();
+
+      for (size_t i = 0; i < n; i++) {
+	ghobject_t &obj = todo[base + i];
+	cerr << "Read " << obj << std::endl;
+	if (rets[i] == 1) {
+	  r = export_file(store, coll, obj, nullptr);
+	} else {
+	  r = rets[i];
+	  if (r == 0 && !dry_run)
+	    r = bls[i].write_fd(file_fd);
+	}
+	if (r < 0)
+	  return r;
+	bls[i].clear();
+      }
     }
   }
   return 0;
@@ -923,10 +978,8 @@ int get_omap(ObjectStore *store, coll_t coll, ghobject_t hoid,
 int ObjectStoreTool::get_object(ObjectStore *store, coll_t coll,
 				bufferlist &bl, OSDMap &curmap,
 				bool *skipped_objects,
-				ObjectStore::Sequencer &osr)
+				ObjectStore::Transaction *t)
 {
-  ObjectStore::Transaction tran;
-  ObjectStore::Transaction *t = &tran;
   bufferlist::iterator ebliter = bl.begin();
   object_begin ob;
   ob.decode(ebliter);
@@ -1016,11 +1069,68 @@ int ObjectStoreTool::get_object(ObjectStore *store, coll_t coll,
       return -EFAULT;
     }
   }
-  if (!dry_run)
-    store->apply_transaction(&osr, std::move(*t));
   return 0;
 }
 
+// Objects are imported in large transactions.  One batch is queued to the
+// store while the next is decoded from the export.
+const uint64_t import_batch_bytes = 32 << 20;
+const unsigned import_batch_objects = 128;
+
+class ImportBatch {
+  ObjectStore *store;
+  ObjectStore::Sequencer &osr;
+  ObjectStore::Transaction t;
+  unsigned objects = 0;
+  std::unique_ptr<C_SaferCond> in_flight;
+
+public:
+  ImportBatch(ObjectStore *store, ObjectStore::Sequencer &osr)
+    : store(store), osr(osr) {}
+  ~ImportBatch() {
+    wait();
+  }
+
+  ObjectStore::Transaction *get_transaction() {
+    return &t;
+  }
+
+  int wait() {
+    if (!in_flight)
+      return 0;
+    int r = in_flight->wait();
+    in_flight.reset();
+    return r;
+  }
+
+  int submit() {
+    int r = wait();
+    if (r < 0 || t.empty())
+      return r;
+    in_flight.reset(new C_SaferCond);
+    store->queue_transaction(&osr, std::move(t), in_flight.get());
+    t = ObjectStore::Transaction();
+    objects = 0;
+    return 0;
+  }
+
+  // call after each object has been added
+  int object_done() {
+    ++objects;
+    if (objects < import_batch_objects &&
+	t.get_num_bytes() < import_batch_bytes)
+      return 0;
+    return submit();
+  }
+
+  int flush() {
+    int r = submit();
+    if (r < 0)
+      return r;
+    return wait();
+  }
+};
+
 int get_pg_metadata(ObjectStore *store, bufferlist &bl, metadata_section &ms,
     const OSDSuperblock& sb, OSDMap& curmap, spg_t pgid)
 {
@@ -1324,6 +1434,7 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
   bool done = false;
   bool found_metadata = false;
   metadata_section ms;
+  ImportBatch batch(store, osr);
   while(!done) {
     ret = read_section(&type, &ebl);
     if (ret)
@@ -1336,8 +1447,13 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
     }
     switch(type) {
     case TYPE_OBJECT_BEGIN:
-      ret = get_object(store, coll, ebl, curmap, &skipped_objects, osr);
+      ret = get_object(store, coll, ebl, curmap, &skipped_objects,
+		       batch.get_transaction());
       if (ret) return ret;
+      if (!dry_run) {
+	ret = batch.object_done();
+	if (ret) return ret;
+      }
       break;
     case TYPE_PG_METADATA:
       ret = get_pg_metadata(store, ebl, ms, sb, curmap, pgid);
@@ -1358,6 +1474,12 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
     return -EFAULT;
   }
 
+  ret = batch.flush();
+  if (ret) {
+    cerr << "Error writing objects: " << cpp_strerror(ret) << std::endl;
+    return ret;
+  }
+
   ObjectStore::Transaction t;
   if (!dry_run) {
     pg_log_t newlog, reject;
@@ -2508,10 +2630,11 @@ int main(int argc, char **argv)
 {
   string dpath, jpath, pgidstr, op, file, mountpoint, mon_store_path, object;
   string target_data_path, fsid;
-  string objcmd, arg1, arg2, type, format, argnspace, pool;
+  string objcmd, arg1, arg2, type, format, argnspace, pool, compression;
   boost::optional<std::string> nspace;
   spg_t pgid;
   unsigned epoch = 0;
+  unsigned threads = 1;
   ghobject_t ghobj;
   bool human_readable;
   bool force;
@@ -2555,6 +2678,10 @@ int main(int argc, char **argv)
     ("head", "Find head/snapdir when searching for objects by name")
     ("dry-run", "Don't modify the objectstore")
     ("namespace", po::value<string>(&argnspace), "Specify namespace when searching for objects")
+    ("threads", po::value<unsigned>(&threads)->default_value(1),
+     "Number of objects read in parallel by export")
+    ("compression", po::value<string>(&compression),
+     "Compress the export stream with this algorithm (e.g. snappy, zstd)")
     ;
 
   po::options_description positional("Positional options");
@@ -2732,6 +2859,16 @@ int main(int argc, char **argv)
   }
   g_conf->apply_changes(NULL);
 
+  tool.set_threads(threads);
+  if (compression.length()) {
+    if (op != "export") {
+      cerr << "--compression only applies to export" << std::endl;
+      return 1;
+    }
+    if (tool.set_compression(compression) < 0)
+      return 1;
+  }
+
   // Special list handling.  Treating pretty_format as human readable,
   // with one object per line and not an enclosing array.
   human_readable = ends_with(format, "-pretty");
@@ -19,11 +19,32 @@
 
 class ObjectStoreTool : public RadosDump
 {
+    unsigned n_threads;  ///< objects read concurrently during export
+
+    // Encode into *out if given, otherwise write to the export file
+    template <typename T>
+      int put_section(sectiontype_t type, const T& obj, bufferlist *out) {
+        if (!out)
+          return write_section(type, obj, file_fd);
+        encode_section(type, obj, *out);
+        return 0;
+      }
+    int put_simple(sectiontype_t type, bufferlist *out) {
+      if (!out)
+        return write_simple(type, file_fd);
+      encode_simple(type, *out);
+      return 0;
+    }
+
   public:
     ObjectStoreTool(int file_fd, bool dry_run)
-      : RadosDump(file_fd, dry_run)
+      : RadosDump(file_fd, dry_run), n_threads(1)
     {}
 
+    void set_threads(unsigned n) {
+      n_threads = std::max(1u, n);
+    }
+
     int do_import(ObjectStore *store, OSDSuperblock& sb, bool force,
 		  std::string pgidstr,
 		  ObjectStore::Sequencer &osr);
@@ -34,9 +55,9 @@ class ObjectStoreTool : public RadosDump
     int get_object(
       ObjectStore *store, coll_t coll,
       bufferlist &bl, OSDMap &curmap, bool *skipped_objects,
-      ObjectStore::Sequencer &osr);
+      ObjectStore::Transaction *t);
     int export_file(
-        ObjectStore *store, coll_t cid, ghobject_t &obj);
+        ObjectStore *store, coll_t cid, ghobject_t &obj, bufferlist *out);
     int export_files(ObjectStore *store, coll_t coll);
 };
 
@@ -15,7 +15,10 @@
 #include "include/compat.h"
 #include "common/errno.h"
 #include "common/ceph_argparse.h"
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include "include/util.h"
 
 #include "mds/CInode.h"
@@ -34,8 +37,8 @@ void DataScan::usage()
 {
   std::cout << "Usage: \n"
     << "  cephfs-data-scan init [--force-init]\n"
-    << "  cephfs-data-scan scan_extents [--force-pool] [--worker_n N --worker_m M] <data pool name>\n"
-    << "  cephfs-data-scan scan_inodes [--force-pool] [--force-corrupt] [--worker_n N --worker_m M] <data pool name>\n"
+    << "  cephfs-data-scan scan_extents [--force-pool] [--worker_n N --worker_m M] [--threads T] <data pool name>\n"
+    << "  cephfs-data-scan scan_inodes [--force-pool] [--force-corrupt] [--worker_n N --worker_m M] [--threads T] <data pool name>\n"
     << "  cephfs-data-scan pg_files <path> <pg id> [<pg id>...]\n"
     << "  cephfs-data-scan scan_links\n"
     << "\n"
@@ -44,6 +47,7 @@ void DataScan::usage()
     << "    --force-pool: use data pool even if it is not in FSMap\n"
     << "    --worker_m: Maximum number of workers\n"
     << "    --worker_n: Worker number, range 0-(worker_m-1)\n"
+    << "    --threads: Threads per worker (default 8)\n"
     << "\n"
     << "  cephfs-data-scan scan_frags [--force-corrupt]\n"
     << "  cephfs-data-scan cleanup <data pool name>\n"
@@ -91,6 +95,15 @@ bool DataScan::parse_kwarg(
       return false;
     }
     return true;
+  } else if (arg == std::string("--threads")) {
+    std::string err;
+    n_threads = strict_strtoll(val.c_str(), 10, &err);
+    if (!err.empty() || n_threads == 0) {
+      std::cerr << "Invalid thread count '" << val << "'" << std::endl;
+      *r = -EINVAL;
+      return false;
+    }
+    return true;
   } else if (arg == std::string("--filter-tag")) {
     filter_tag = val;
     dout(10) << "Applying tag filter: '" << filter_tag << "'" << dendl;
@@ -573,45 +586,141 @@ int DataScan::forall_objects(
     }
   }
 
+  // Our share of the pool's objects, for the ETA.  Unknown when the
+  // OSDs filter the listing for us.
+  uint64_t expected = 0;
+  if (filter_bl.length() == 0) {
+    librados::Rados rados(ioctx);
+    std::list<std::string> pools = {ioctx.get_pool_name()};
+    std::map<std::string, librados::pool_stat_t> stats;
+    if (rados.get_pool_stats(pools, stats) == 0 && stats.count(pools.front())) {
+      expected = stats[pools.front()].num_objects / m;
+    }
+  }
+
+  // Split our slice again between our threads
+  std::atomic<uint64_t> handled = {0};
+  std::mutex lock;
+  std::condition_variable cond;
+  uint32_t running = n_threads;
+  int r = 0;
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < n_threads; ++t) {
+    librados::ObjectCursor begin, end;
+    ioctx.object_list_slice(range_i, range_end, t, n_threads, &begin, &end);
+    threads.emplace_back([&, begin, end]() {
+      int tr = forall_objects_in_range(ioctx, begin, end, filter_bl,
+                                       untagged_only, legacy_filtering,
+                                       handler, &handled);
+      std::lock_guard<std::mutex> l(lock);
+      if (r == 0 && tr < 0) {
+        r = tr;
+      }
+      --running;
+      cond.notify_all();
+    });
+  }
+
+  const utime_t start = ceph_clock_now();
+  {
+    std::unique_lock<std::mutex> l(lock);
+    while (running) {
+      if (cond.wait_for(l, std::chrono::seconds(30)) ==
+          std::cv_status::no_timeout) {
+        continue;
+      }
+      const uint64_t done = handled;
+      const double rate = done / (double)(ceph_clock_now() - start);
+      std::cerr << "handled " << done << " objects";
+      if (expected) {
+        std::cerr << " of ~" << expected << " ("
+                  << std::min<uint64_t>(100, done * 100 / expected) << "%)";
+      }
+      std::cerr << ", " << (uint64_t)rate << "/s";
+      if (expected > done && rate > 0) {
+        uint64_t eta = (expected - done) / rate;
+        std::cerr << ", ETA " << eta / 3600 << "h" << (eta / 60) % 60 << "m";
+      }
+      std::cerr << std::endl;
+    }
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  dout(4) << "handled " << handled << " objects in "
+          << (ceph_clock_now() - start) << "s" << dendl;
+
+  return r;
+}
+
+int DataScan::forall_objects_in_range(
+    librados::IoCtx &ioctx,
+    const librados::ObjectCursor &begin,
+    const librados::ObjectCursor &end,
+    const bufferlist &filter_bl,
+    bool untagged_only,
+    bool legacy_filtering,
+    const std::function<int(std::string, uint64_t, uint64_t)> &handler,
+    std::atomic<uint64_t> *handled)
+{
+  struct Item {
+    std::string oid;
+    uint64_t ino = 0;
+    uint64_t offset = 0;
+    librados::AioCompletion *tag_read = nullptr;
+    bufferlist tag_bl;
+  };
+
   int r = 0;
-  while(range_i < range_end) {
+  librados::ObjectCursor range_i = begin;
+  while(range_i < end) {
     std::vector<librados::ObjectItem> result;
-    int r = ioctx.object_list(range_i, range_end, 1,
-                                filter_bl, &result, &range_i);
-    if (r < 0) {
-      derr << "Unexpected error listing objects: " << cpp_strerror(r) << dendl;
-      return r;
+    int lr = ioctx.object_list(range_i, end, 100,
+                               filter_bl, &result, &range_i);
+    if (lr < 0) {
+      derr << "Unexpected error listing objects: " << cpp_strerror(lr) << dendl;
+      return lr;
     }
 
+    std::vector<Item> items;
+    items.reserve(result.size());
     for (const auto &i : result) {
-      const std::string &oid = i.oid;
-      uint64_t obj_name_ino = 0;
-      uint64_t obj_name_offset = 0;
-      r = parse_oid(oid, &obj_name_ino, &obj_name_offset);
-      if (r != 0) {
-        dout(4) << "Bad object name '" << oid << "', skipping" << dendl;
+      Item item;
+      item.oid = i.oid;
+      if (parse_oid(item.oid, &item.ino, &item.offset) != 0) {
+        dout(4) << "Bad object name '" << item.oid << "', skipping" << dendl;
         continue;
       }
+      // We are only interested in 0th objects during this phase: we touched
+      // the other objects during scan_extents
+      if (untagged_only && legacy_filtering && item.offset != 0) {
+        dout(20) << "Non-zeroth object " << item.oid << dendl;
+        continue;
+      }
+      items.push_back(std::move(item));
+    }
 
-      if (untagged_only && legacy_filtering) {
-        dout(20) << "Applying filter to " << oid << dendl;
-
-        // We are only interested in 0th objects during this phase: we touched
-        // the other objects during scan_extents
-        if (obj_name_offset != 0) {
-          dout(20) << "Non-zeroth object" << dendl;
-          continue;
-        }
+    // Read the whole batch's tags at once, rather than one by one
+    if (untagged_only && legacy_filtering) {
+      for (auto &item : items) {
+        item.tag_read = librados::Rados::aio_create_completion();
+        ioctx.aio_getxattr(item.oid, item.tag_read, "scrub_tag", item.tag_bl);
+      }
+    }
 
-        bufferlist scrub_tag_bl;
-        int r = ioctx.getxattr(oid, "scrub_tag", scrub_tag_bl);
-        if (r >= 0) {
+    for (auto &item : items) {
+      if (item.tag_read) {
+        dout(20) << "Applying filter to " << item.oid << dendl;
+        item.tag_read->wait_for_complete();
+        int tr = item.tag_read->get_return_value();
+        item.tag_read->release();
+        if (tr >= 0) {
           std::string read_tag;
-          bufferlist::iterator q = scrub_tag_bl.begin();
+          bufferlist::iterator q = item.tag_bl.begin();
           try {
             ::decode(read_tag, q);
             if (read_tag == filter_tag) {
-              dout(20) << "skipping " << oid << " because it has the filter_tag"
+              dout(20) << "skipping " << item.oid << " because it has the filter_tag"
                        << dendl;
               continue;
             }
@@ -619,18 +728,18 @@ int DataScan::forall_objects(
           }
           dout(20) << "read non-matching tag '" << read_tag << "'" << dendl;
         } else {
-          dout(20) << "no tag read (" << r << ")" << dendl;
+          dout(20) << "no tag read (" << tr << ")" << dendl;
         }
-
       } else if (untagged_only) {
-        assert(obj_name_offset == 0);
-        dout(20) << "OSD matched oid " << oid << dendl;
+        assert(item.offset == 0);
+        dout(20) << "OSD matched oid " << item.oid << dendl;
       }
 
-      int this_oid_r = handler(oid, obj_name_ino, obj_name_offset);
+      int this_oid_r = handler(item.oid, item.ino, item.offset);
       if (r == 0 && this_oid_r < 0) {
         r = this_oid_r;
       }
+      ++(*handled);
     }
   }
 
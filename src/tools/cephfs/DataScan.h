@@ -13,6 +13,8 @@
  */
 
 
+#include <atomic>
+
 #include "MDSUtility.h"
 #include "include/rados/librados.hpp"
 
@@ -248,6 +250,8 @@ class DataScan : public MDSUtility, public MetadataTool
 
     uint32_t n;
     uint32_t m;
+    // threads scanning this worker's share of the pool
+    uint32_t n_threads;
 
     /**
      * Scan data pool for backtraces, and inject inodes to metadata pool
@@ -315,13 +319,27 @@ class DataScan : public MDSUtility, public MetadataTool
         bool untagged_only,
         std::function<int(std::string, uint64_t, uint64_t)> handler);
 
+    /**
+     * One thread's part of forall_objects: list [begin, end) in
+     * batches and apply the handler to each object.
+     */
+    int forall_objects_in_range(
+        librados::IoCtx &ioctx,
+        const librados::ObjectCursor &begin,
+        const librados::ObjectCursor &end,
+        const bufferlist &filter_bl,
+        bool untagged_only,
+        bool legacy_filtering,
+        const std::function<int(std::string, uint64_t, uint64_t)> &handler,
+        std::atomic<uint64_t> *handled);
+
   public:
     void usage();
     int main(const std::vector<const char *> &args);
 
     DataScan()
       : driver(NULL), fscid(FS_CLUSTER_ID_NONE),
-	data_pool_id(-1), metadata_pool_name(""), n(0), m(1),
+	data_pool_id(-1), metadata_pool_name(""), n(0), m(1), n_threads(8),
         force_pool(false), force_corrupt(false),
         force_init(false)
     {
@@ -12,16 +12,19 @@
  * 
  */
 
+#include <fstream>
 #include <string>
 #include <sys/stat.h>
 
 #include "common/ceph_argparse.h"
 #include "common/errno.h"
 #include "common/safe_io.h"
+#include "include/stringify.h"
 #include "mon/health_check.h"
 
 #include "global/global_init.h"
 #include "osd/OSDMap.h"
+#include "osd/OSDMapMapping.h"
 
 using namespace std;
 
@@ -33,6 +36,8 @@ void usage()
   cout << "   --test-map-pgs [--pool <poolid>] [--pg_num <pg_num>] map all pgs" << std::endl;
   cout << "   --test-map-pgs-dump [--pool <poolid>] map all pgs" << std::endl;
   cout << "   --test-map-pgs-dump-all [--pool <poolid>] map all pgs to osds" << std::endl;
+  cout << "   --test-map-pgs-bench [--pool <poolid>] [--bench-iterations <n>] [--bench-threads <n>]" << std::endl;
+  cout << "                           time crush and full pg mappings [default: 5 iterations, 4 threads]" << std::endl;
   cout << "   --health                dump health checks" << std::endl;
   cout << "   --mark-up-in            mark osds up and in (but do not persist)" << std::endl;
   cout << "   --with-default-pool     include default pool when creating map" << std::endl;
@@ -41,6 +46,8 @@ void usage()
   cout << "   --test-map-pg <pgid>    map a pgid to osds" << std::endl;
   cout << "   --test-map-object <objectname> [--pool <poolid>] map an object to osds"
        << std::endl;
+  cout << "   --test-map-objects <file> [--pool <poolid>] map the objects named" << std::endl;
+  cout << "                           in <file>, one per line, to osds" << std::endl;
   cout << "   --upmap-cleanup <file>  clean up pg_upmap[_items] entries, writing" << std::endl;
   cout << "                           commands to <file> [default: - for stdout]" << std::endl;
   cout << "   --upmap <file>          calculate pg upmap entries to balance pg layout" << std::endl;
@@ -84,6 +91,109 @@ void print_inc_upmaps(const OSDMap::Incremental& pending_inc, int fd)
   }
 }
 
+static void print_bench_rate(const char *what, uint64_t mappings,
+			     ceph::timespan elapsed)
+{
+  double secs = std::chrono::duration<double>(elapsed).count();
+  cout << " " << what << ": " << mappings << " mappings in " << secs << "s, "
+       << (secs > 0 ? mappings / secs : 0) << " mappings/s" << std::endl;
+}
+
+// time the mapping paths the mon, mgr and osds run over the whole map:
+// bare crush rule evaluation (with each pool's choose_args), the full
+// pg -> up/acting calculation (upmaps, primary affinity, temps), and
+// OSDMapMapping::update, serially and through the ParallelPGMapper.
+static void test_map_pgs_benchmark(const OSDMap& osdmap, int64_t only_pool,
+				   int iterations, int threads)
+{
+  int num_rules = 0;
+  for (int r = 0; r < osdmap.crush->get_max_rules(); ++r) {
+    if (osdmap.crush->rule_exists(r))
+      num_rules++;
+  }
+  cout << "benchmarking " << iterations << " iterations over "
+       << osdmap.get_num_osds() << " osds, "
+       << num_rules << " crush rules, "
+       << osdmap.crush->choose_args.size() << " choose_args, "
+       << osdmap.get_num_pg_upmaps()
+       << " upmaps" << std::endl;
+
+  vector<__u32> weights(osdmap.get_max_osd());
+  for (int i = 0; i < osdmap.get_max_osd(); ++i) {
+    weights[i] = osdmap.exists(i) ? osdmap.get_weight(i) : 0;
+  }
+
+  uint64_t num_pgs = 0;
+  ceph::timespan crush_time = ceph::timespan::zero();
+  ceph::timespan up_acting_time = ceph::timespan::zero();
+  vector<int> raw, up, acting;
+  for (auto& p : osdmap.get_pools()) {
+    if (only_pool != -1 && p.first != only_pool)
+      continue;
+    const pg_pool_t& pi = p.second;
+    int ruleno = osdmap.crush->find_rule(pi.get_crush_rule(), pi.get_type(),
+					 pi.get_size());
+    if (ruleno < 0) {
+      cout << "pool " << p.first << " has no usable crush rule, skipping"
+	   << std::endl;
+      continue;
+    }
+    num_pgs += pi.get_pg_num();
+
+    auto start = ceph::mono_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (unsigned ps = 0; ps < pi.get_pg_num(); ++ps) {
+	osdmap.crush->do_rule(ruleno, pi.raw_pg_to_pps(pg_t(ps, p.first)), raw,
+			      pi.get_size(), weights, p.first);
+      }
+    }
+    crush_time += ceph::mono_clock::now() - start;
+
+    start = ceph::mono_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (unsigned ps = 0; ps < pi.get_pg_num(); ++ps) {
+	int up_primary, acting_primary;
+	osdmap.pg_to_up_acting_osds(pg_t(ps, p.first), &up, &up_primary,
+				    &acting, &acting_primary);
+      }
+    }
+    up_acting_time += ceph::mono_clock::now() - start;
+  }
+  cout << " pgs " << num_pgs << std::endl;
+  print_bench_rate("crush do_rule", num_pgs * iterations, crush_time);
+  print_bench_rate("pg_to_up_acting_osds", num_pgs * iterations,
+		   up_acting_time);
+
+  // OSDMapMapping always covers every pool
+  uint64_t all_pgs = 0;
+  for (auto& p : osdmap.get_pools())
+    all_pgs += p.second.get_pg_num();
+
+  OSDMapMapping mapping;
+  auto start = ceph::mono_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    mapping.update(osdmap);
+  }
+  print_bench_rate("OSDMapMapping::update", all_pgs * iterations,
+		   ceph::mono_clock::now() - start);
+
+  if (threads > 0) {
+    ThreadPool tp(g_ceph_context, "osdmaptool::bench", "tp_bench", threads);
+    tp.start();
+    ParallelPGMapper mapper(g_ceph_context, &tp);
+    start = ceph::mono_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      auto job = mapping.start_update(osdmap, mapper, 1024);
+      job->wait();
+    }
+    string what = "OSDMapMapping::start_update (" + stringify(threads) +
+      " threads)";
+    print_bench_rate(what.c_str(), all_pgs * iterations,
+		     ceph::mono_clock::now() - start);
+    tp.stop();
+  }
+}
+
 int main(int argc, const char **argv)
 {
   vector<const char*> args;
@@ -111,6 +221,7 @@ int main(int argc, const char **argv)
   bool clobber = false;
   bool modified = false;
   std::string export_crush, import_crush, test_map_pg, test_map_object;
+  std::string test_map_objects;
   bool test_crush = false;
   int range_first = -1;
   int range_last = -1;
@@ -130,6 +241,9 @@ int main(int argc, const char **argv)
   std::set<std::string> upmap_pools;
   int64_t pg_num = -1;
   bool test_map_pgs_dump_all = false;
+  bool test_map_pgs_bench = false;
+  int bench_iterations = 5;
+  int bench_threads = 4;
 
   std::string val;
   std::ostringstream err;
@@ -183,6 +297,18 @@ int main(int argc, const char **argv)
       test_map_pgs_dump = true;
     } else if (ceph_argparse_flag(args, i, "--test-map-pgs-dump-all", (char*)NULL)) {
       test_map_pgs_dump_all = true;
+    } else if (ceph_argparse_flag(args, i, "--test-map-pgs-bench", (char*)NULL)) {
+      test_map_pgs_bench = true;
+    } else if (ceph_argparse_witharg(args, i, &bench_iterations, err, "--bench-iterations", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
+    } else if (ceph_argparse_witharg(args, i, &bench_threads, err, "--bench-threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	exit(EXIT_FAILURE);
+      }
     } else if (ceph_argparse_flag(args, i, "--test-random", (char*)NULL)) {
       test_random = true;
     } else if (ceph_argparse_flag(args, i, "--clobber", (char*)NULL)) {
@@ -205,6 +331,8 @@ int main(int argc, const char **argv)
       test_map_pg = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--test_map_object", (char*)NULL)) {
       test_map_object = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--test_map_objects", (char*)NULL)) {
+      test_map_objects = val;
     } else if (ceph_argparse_flag(args, i, "--test_crush", (char*)NULL)) {
       test_crush = true;
     } else if (ceph_argparse_witharg(args, i, &val, err, "--pg_num", (char*)NULL)) {
@@ -444,6 +572,40 @@ int main(int argc, const char **argv)
 	 << " -> " << acting
 	 << std::endl;
   }  
+  if (!test_map_objects.empty()) {
+    if (pool == -1) {
+      cout << me << ": assuming pool 1 (use --pool to override)" << std::endl;
+      pool = 1;
+    }
+    if (!osdmap.have_pg_pool(pool)) {
+      cerr << "There is no pool " << pool << std::endl;
+      exit(1);
+    }
+    ifstream in(test_map_objects);
+    if (!in) {
+      cerr << me << ": unable to open " << test_map_objects << std::endl;
+      exit(1);
+    }
+    vector<string> names;
+    string name;
+    while (getline(in, name)) {
+      if (!name.empty())
+	names.push_back(name);
+    }
+    // hash the names in one batch, then place each pg
+    vector<pg_t> raw_pgids;
+    int r = osdmap.map_to_pgs(pool, names, string(), &raw_pgids);
+    assert(r == 0);
+    for (size_t i = 0; i < names.size(); ++i) {
+      pg_t pgid = osdmap.raw_pg_to_pg(raw_pgids[i]);
+      vector<int> acting;
+      osdmap.pg_to_acting_osds(pgid, acting);
+      cout << " object '" << names[i]
+	   << "' -> " << pgid
+	   << " -> " << acting
+	   << std::endl;
+    }
+  }
   if (!test_map_pg.empty()) {
     pg_t pgid;
     if (!pgid.parse(test_map_pg.c_str())) {
@@ -582,6 +744,17 @@ int main(int argc, const char **argv)
       cout << "size " << i << "\t" << size[i] << std::endl;
     }
   }
+  if (test_map_pgs_bench) {
+    if (pool != -1 && !osdmap.have_pg_pool(pool)) {
+      cerr << "There is no pool " << pool << std::endl;
+      exit(1);
+    }
+    if (bench_iterations < 1 || bench_threads < 0) {
+      cerr << me << ": bad --bench-iterations or --bench-threads" << std::endl;
+      exit(1);
+    }
+    test_map_pgs_benchmark(osdmap, pool, bench_iterations, bench_threads);
+  }
   if (test_crush) {
     int pass = 0;
     while (1) {
@@ -616,7 +789,9 @@ int main(int argc, const char **argv)
   if (!print && !health && !tree && !modified &&
       export_crush.empty() && import_crush.empty() && 
       test_map_pg.empty() && test_map_object.empty() &&
+      test_map_objects.empty() &&
       !test_map_pgs && !test_map_pgs_dump && !test_map_pgs_dump_all &&
+      !test_map_pgs_bench &&
       !upmap && !upmap_cleanup) {
     cerr << me << ": no action specified?" << std::endl;
     usage();
@@ -98,10 +98,11 @@ void usage(ostream& out)
 "   rollback <obj-name> <snap-name>  roll back object to snap <snap-name>\n"
 "\n"
 "   listsnaps <obj-name>             list the snapshots of this object\n"
-"   bench <seconds> write|seq|rand [-t concurrent_operations] [--no-cleanup] [--run-name run_name] [--no-hints]\n"
+"   bench <seconds> write|seq|rand|mix [-t concurrent_operations] [--no-cleanup] [--run-name run_name] [--no-hints]\n"
 "                                    default is 16 concurrent IOs and 4 MB ops\n"
 "                                    default is to clean up after write benchmark\n"
 "                                    default run-name is 'benchmark_last_metadata'\n"
+"                                    mix reads back its own writes and needs --rate\n"
 "   cleanup [--run-name run_name] [--prefix prefix]\n"
 "                                    clean up a previous benchmark operation\n"
 "                                    default run-name is 'benchmark_last_metadata'\n"
@@ -208,6 +209,15 @@ void usage(ostream& out)
 "        write contents to the omap\n"
 "   --write-xattr\n"
 "        write contents to the extended attributes\n"
+"   --rate N\n"
+"        issue N ops/sec as a Poisson process (open loop), whether or\n"
+"        not earlier ops have completed, instead of keeping -t ops in\n"
+"        flight; -t then caps the ops in flight, and latency percentiles\n"
+"        are measured from each op's arrival\n"
+"   --read-percent N\n"
+"        percent of reads in the mix benchmark (default 50)\n"
+"   --min-object-size N, --max-object-size N\n"
+"        size range of the objects written by an open loop benchmark\n"
 "\n"
 "LOAD GEN OPTIONS:\n"
 "   --num-objects                    total number of objects\n"
@@ -1627,6 +1637,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   uint64_t max_ops = 0;
   uint64_t max_backlog = 0;
   uint64_t target_throughput = 0;
+  uint64_t bench_rate = 0;
   int64_t read_percent = -1;
   uint64_t num_objs = 0;
   int run_length = 0;
@@ -1769,6 +1780,12 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       return -EINVAL;
     }
   }
+  i = opts.find("rate");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &bench_rate)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("read-percent");
   if (i != opts.end()) {
     if (rados_sistrtoll(i, &read_percent)) {
@@ -2956,9 +2973,26 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
       operation = OP_SEQ_READ;
     else if (strcmp(nargs[2], "rand") == 0)
       operation = OP_RAND_READ;
+    else if (strcmp(nargs[2], "mix") == 0)
+      operation = OP_MIX;
     else
       usage_exit();
-    if (operation != OP_WRITE) {
+    if (operation == OP_MIX && !bench_rate) {
+      cerr << "the mix bench test needs --rate" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
+    if (operation == OP_SEQ_READ && bench_rate) {
+      cerr << "--rate can't be used with the 'seq' bench test" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
+    if (read_percent > 100) {
+      cerr << "--read-percent must be at most 100" << std::endl;
+      ret = -EINVAL;
+      goto out;
+    }
+    if (operation != OP_WRITE && operation != OP_MIX) {
       if (block_size_specified) {
         cerr << "-b|--block_size option can be used only with 'write' bench test"
              << std::endl;
@@ -2986,6 +3020,15 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     RadosBencher bencher(g_ceph_context, rados, io_ctx);
     bencher.set_show_time(show_time);
     bencher.set_write_destination(static_cast<OpWriteDest>(bench_write_dest));
+    if (bench_rate) {
+      bench_open_loop ol;
+      ol.rate = bench_rate;
+      if (read_percent >= 0)
+        ol.read_percent = read_percent;
+      ol.min_object_size = min_obj_len;
+      ol.max_object_size = max_obj_len;
+      bencher.set_open_loop(ol);
+    }
 
     ostream *outstream = NULL;
     if (formatter) {
@@ -3662,6 +3705,8 @@ int main(int argc, const char **argv)
       opts["max-backlog"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--target-throughput", (char*)NULL)) {
       opts["target-throughput"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--rate", (char*)NULL)) {
+      opts["rate"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--read-percent", (char*)NULL)) {
       opts["read-percent"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--num-objects", (char*)NULL)) {
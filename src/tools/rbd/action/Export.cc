@@ -7,6 +7,7 @@
 #include "tools/rbd/Utils.h"
 #include "include/Context.h"
 #include "common/errno.h"
+#include "common/Clock.h"
 #include "common/Throttle.h"
 #include "include/encoding.h"
 #include <iostream>
@@ -344,16 +345,11 @@ public:
         return;
       }
 
-      uint64_t chkret = lseek64(m_fd, m_dest_offset, SEEK_SET);
-      if (chkret != m_dest_offset) {
-        cerr << "rbd: error seeking destination image to offset "
-             << m_dest_offset << std::endl;
-        r = -errno;
-        return;
-      }
+      // positional writes, completions may run concurrently
+      r = m_bufferlist.write_fd(m_fd, m_dest_offset);
+    } else {
+      r = m_bufferlist.write_fd(m_fd);
     }
-
-    r = m_bufferlist.write_fd(m_fd);
     if (r < 0) {
       cerr << "rbd: error writing to destination image at offset "
            << m_dest_offset << std::endl;
@@ -461,22 +457,99 @@ static int do_export_v2(librbd::Image& image, librbd::image_info_t &info, int fd
   return r;
 }
 
+struct ExportExtentsContext {
+  librbd::Image &image;
+  SimpleThrottle &throttle;
+  int fd;
+  uint64_t period;
+  uint64_t size;
+  utils::ProgressContext &pc;
+
+  ExportExtentsContext(librbd::Image &image, SimpleThrottle &throttle, int fd,
+                       uint64_t period, uint64_t size,
+                       utils::ProgressContext &pc)
+    : image(image), throttle(throttle), fd(fd), period(period), size(size),
+      pc(pc) {
+  }
+};
+
+static int export_extent_cb(uint64_t offset, size_t length, int exists,
+                            void *arg)
+{
+  ExportExtentsContext *eec = static_cast<ExportExtentsContext *>(arg);
+  if (!exists) {
+    return 0;
+  }
+
+  uint64_t end = offset + length;
+  while (offset < end) {
+    if (eec->throttle.pending_error()) {
+      return eec->throttle.wait_for_ret();
+    }
+
+    // keep the reads aligned to the stripe period
+    uint64_t read_len = min(eec->period - offset % eec->period, end - offset);
+    C_Export *ctx = new C_Export(eec->throttle, eec->image, offset, offset,
+                                 read_len, eec->fd);
+    ctx->send();
+    offset += read_len;
+
+    eec->pc.update_progress(offset, eec->size);
+  }
+  return 0;
+}
+
+static bool use_object_map_extents(librbd::Image& image, int fd)
+{
+  if (fd == STDOUT_FILENO) {
+    return false;
+  }
+
+  // unallocated objects of a clone are backed by the parent, which the
+  // object map doesn't cover
+  std::string parent_pool, parent_name, parent_snap;
+  if (image.parent_info(&parent_pool, &parent_name, &parent_snap) != -ENOENT) {
+    return false;
+  }
+
+  uint64_t features, flags;
+  if (image.features(&features) < 0 ||
+      (features & RBD_FEATURE_FAST_DIFF) == 0 ||
+      image.get_flags(&flags) < 0 ||
+      (flags & RBD_FLAG_FAST_DIFF_INVALID) != 0) {
+    return false;
+  }
+  return true;
+}
+
 static int do_export_v1(librbd::Image& image, librbd::image_info_t &info, int fd,
 		        uint64_t period, int max_concurrent_ops, utils::ProgressContext &pc)
 {
   int r = 0;
   size_t file_size = 0;
   SimpleThrottle throttle(max_concurrent_ops, false);
-  for (uint64_t offset = 0; offset < info.size; offset += period) {
-    if (throttle.pending_error()) {
-      break;
+  if (use_object_map_extents(image, fd)) {
+    // only read objects the object map says exist, the rest of the file
+    // stays a hole
+    ExportExtentsContext eec(image, throttle, fd, period, info.size, pc);
+    r = image.diff_iterate2(NULL, 0, info.size, true, true,
+                            &export_extent_cb, &eec);
+    if (r < 0) {
+      throttle.wait_for_ret();
+      return r;
     }
+  } else {
+    for (uint64_t offset = 0; offset < info.size; offset += period) {
+      if (throttle.pending_error()) {
+        break;
+      }
 
-    uint64_t length = min(period, info.size - offset);
-    C_Export *ctx = new C_Export(throttle, image, file_size + offset, offset, length, fd);
-    ctx->send();
+      uint64_t length = min(period, info.size - offset);
+      C_Export *ctx = new C_Export(throttle, image, file_size + offset, offset, length, fd);
+      ctx->send();
 
-    pc.update_progress(offset, info.size);
+      pc.update_progress(offset, info.size);
+    }
   }
 
   file_size += info.size;
@@ -522,6 +595,7 @@ static int do_export(librbd::Image& image, const char *path, bool no_progress, i
   utils::ProgressContext pc("Exporting image", no_progress);
   uint64_t period = image.get_stripe_count() * (1ull << info.order);
 
+  utime_t start = ceph_clock_now();
   if (export_format == 1)
     r = do_export_v1(image, info, fd, period, max_concurrent_ops, pc);
   else
@@ -531,6 +605,16 @@ static int do_export(librbd::Image& image, const char *path, bool no_progress, i
     pc.fail();
   else
     pc.finish();
+
+  if (r >= 0 && !no_progress) {
+    double elapsed = (double)(ceph_clock_now() - start);
+    std::cerr << "Exported " << prettybyte_t(info.size) << " in " << elapsed
+              << " s";
+    if (elapsed > 0) {
+      std::cerr << " (" << prettybyte_t(info.size / elapsed) << "/s)";
+    }
+    std::cerr << std::endl;
+  }
   if (!to_stdout)
     close(fd);
   return r;
@@ -7,6 +7,8 @@
 #include "common/errno.h"
 #include "common/Timer.h"
 #include "journal/Journaler.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
 #include "tools/rbd_mirror/ProgressContext.h"
 
@@ -21,6 +23,7 @@ namespace mirror {
 namespace image_sync {
 
 using librbd::util::create_context_callback;
+using librbd::util::create_rados_callback;
 using librbd::util::unique_lock_name;
 
 template <typename I>
@@ -78,7 +81,7 @@ void ImageCopyRequest<I>::send_update_max_object_count() {
   }
 
   if (max_objects <= m_client_meta->sync_object_count) {
-    send_object_copies();
+    send_load_object_maps();
     return;
   }
 
@@ -122,6 +125,107 @@ void ImageCopyRequest<I>::handle_update_max_object_count(int r) {
   // update provided meta structure to reflect reality
   m_client_meta->sync_object_count = m_client_meta_copy.sync_object_count;
 
+  send_load_object_maps();
+}
+
+template <typename I>
+void ImageCopyRequest<I>::send_load_object_maps() {
+  {
+    RWLock::RLocker snap_locker(m_remote_image_ctx->snap_lock);
+    if (!m_remote_image_ctx->test_features(RBD_FEATURE_FAST_DIFF,
+                                           m_remote_image_ctx->snap_lock)) {
+      send_object_copies();
+      return;
+    }
+
+    for (auto &snap_pair : m_snap_map) {
+      auto snap_info_it = m_remote_image_ctx->snap_info.find(snap_pair.first);
+      if (snap_info_it == m_remote_image_ctx->snap_info.end() ||
+          (snap_info_it->second.flags & RBD_FLAG_FAST_DIFF_INVALID) != 0) {
+        dout(10) << ": fast-diff invalid for snap_id=" << snap_pair.first
+                 << ": copying all objects" << dendl;
+        send_object_copies();
+        return;
+      }
+      m_object_map_snap_ids.push_back(snap_pair.first);
+    }
+  }
+
+  update_progress("LOAD_OBJECT_MAP");
+
+  m_copy_objects.assign(m_client_meta->sync_object_count, false);
+  m_prev_object_map.clear();
+  send_load_object_map();
+}
+
+template <typename I>
+void ImageCopyRequest<I>::send_load_object_map() {
+  assert(!m_object_map_snap_ids.empty());
+  m_object_map_snap_id = m_object_map_snap_ids.front();
+  m_object_map_snap_ids.erase(m_object_map_snap_ids.begin());
+
+  std::string oid(librbd::ObjectMap<>::object_map_name(
+    m_remote_image_ctx->id, m_object_map_snap_id));
+  dout(20) << ": snap_id=" << m_object_map_snap_id << ", oid=" << oid
+           << dendl;
+
+  librados::ObjectReadOperation op;
+  librbd::cls_client::object_map_load_start(&op);
+
+  m_object_map_bl.clear();
+  librados::AioCompletion *comp = create_rados_callback<
+    ImageCopyRequest<I>, &ImageCopyRequest<I>::handle_load_object_map>(this);
+  int r = m_remote_image_ctx->md_ctx.aio_operate(oid, comp, &op,
+                                                 &m_object_map_bl);
+  assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+void ImageCopyRequest<I>::handle_load_object_map(int r) {
+  dout(20) << ": r=" << r << dendl;
+
+  ceph::BitVector<2> object_map;
+  if (r == 0) {
+    bufferlist::iterator it = m_object_map_bl.begin();
+    r = librbd::cls_client::object_map_load_finish(&it, &object_map);
+  }
+  if (r < 0) {
+    dout(5) << ": failed to load object map for snap_id="
+            << m_object_map_snap_id << ": " << cpp_strerror(r)
+            << ": copying all objects" << dendl;
+    m_object_map_snap_ids.clear();
+    m_copy_objects.clear();
+    send_object_copies();
+    return;
+  }
+
+  // the start snapshot of an incremental sync only provides the baseline
+  bool baseline = (!m_sync_point->from_snap_name.empty() &&
+                   m_object_map_snap_id == m_snap_map.begin()->first);
+  if (!baseline) {
+    for (uint64_t ono = 0; ono < m_copy_objects.size(); ++ono) {
+      uint8_t state = (ono < object_map.size() ?
+        static_cast<uint8_t>(object_map[ono]) : OBJECT_NONEXISTENT);
+      uint8_t prev_state = (ono < m_prev_object_map.size() ?
+        static_cast<uint8_t>(m_prev_object_map[ono]) : OBJECT_NONEXISTENT);
+
+      // written since the previous snapshot, created or removed
+      if (state == OBJECT_EXISTS || state == OBJECT_PENDING ||
+          ((state == OBJECT_NONEXISTENT) !=
+             (prev_state == OBJECT_NONEXISTENT))) {
+        m_copy_objects[ono] = true;
+      }
+    }
+  }
+  m_prev_object_map = std::move(object_map);
+
+  if (!m_object_map_snap_ids.empty()) {
+    send_load_object_map();
+    return;
+  }
+
+  m_prev_object_map.clear();
   send_object_copies();
 }
 
@@ -180,6 +284,15 @@ void ImageCopyRequest<I>::send_next_object_copy() {
     m_ret_val = -ECANCELED;
   }
 
+  // skip objects that fast-diff shows to be unchanged within the sync
+  // range: copying them would not issue any writes
+  while (!m_copy_objects.empty() && m_object_no < m_end_object_no &&
+         m_object_no < m_copy_objects.size() &&
+         !m_copy_objects[m_object_no]) {
+    ++m_object_no;
+    ++m_skipped_objects;
+  }
+
   if (m_ret_val < 0 || m_object_no >= m_end_object_no) {
     return;
   }
@@ -321,6 +434,11 @@ void ImageCopyRequest<I>::send_flush_sync_point() {
     return;
   }
 
+  if (m_skipped_objects > 0) {
+    dout(10) << ": skipped " << m_skipped_objects << " unchanged objects"
+             << dendl;
+  }
+
   update_progress("FLUSH_SYNC_POINT");
 
   m_client_meta_copy = *m_client_meta;
@@ -7,6 +7,7 @@
 #include "include/int_types.h"
 #include "include/rados/librados.hpp"
 #include "common/Mutex.h"
+#include "common/bit_vector.hpp"
 #include "librbd/journal/Types.h"
 #include "librbd/journal/TypeTraits.h"
 #include "tools/rbd_mirror/BaseRequest.h"
@@ -67,6 +68,11 @@ private:
    *    v
    * UPDATE_MAX_OBJECT_COUNT
    *    |
+   *    |     /---------\
+   *    |     |         | (for each remote snapshot when
+   *    v     v         |  fast-diff is enabled)
+   * LOAD_OBJECT_MAP  --/
+   *    |
    *    |   . . . . .
    *    |   .       .  (parallel execution of
    *    v   v       .   multiple objects at once)
@@ -100,6 +106,16 @@ private:
   uint64_t m_current_ops = 0;
   int m_ret_val = 0;
 
+  /// remote snapshots whose object map still needs to be loaded
+  std::vector<librados::snap_t> m_object_map_snap_ids;
+  librados::snap_t m_object_map_snap_id = CEPH_NOSNAP;
+  bufferlist m_object_map_bl;
+  ceph::BitVector<2> m_prev_object_map;
+  /// objects that might have changed within the sync range (empty if
+  /// every object must be copied)
+  std::vector<bool> m_copy_objects;
+  uint64_t m_skipped_objects = 0;
+
   bool m_updating_sync_point;
   Context *m_update_sync_ctx;
   double m_update_sync_point_interval;
@@ -109,6 +125,10 @@ private:
   void send_update_max_object_count();
   void handle_update_max_object_count(int r);
 
+  void send_load_object_maps();
+  void send_load_object_map();
+  void handle_load_object_map(int r);
+
   void send_object_copies();
   void send_next_object_copy();
   void handle_object_copy(int r);
@@ -34,6 +34,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <vector>
 #include <boost/regex.hpp>
 
 #include "mon/MonClient.h"
@@ -63,6 +65,7 @@
 struct Config {
   int nbds_max = 0;
   int max_part = 255;
+  int num_connections = 1;
 
   bool exclusive = false;
   bool readonly = false;
@@ -85,6 +88,8 @@ static void usage()
             << "  --nbds_max <limit>      Override for module param nbds_max\n"
             << "  --max_part <limit>      Override for module param max_part\n"
             << "  --exclusive             Forbid writes by other clients\n"
+            << "  --num-connections <n>   Number of connections (and reply\n"
+            << "                          threads) to use for the device\n"
             << std::endl;
   generic_server_usage();
 }
@@ -100,6 +105,10 @@ static enum {
 
 #define RBD_NBD_BLKSIZE 512UL
 
+#ifndef NBD_FLAG_CAN_MULTI_CONN
+#define NBD_FLAG_CAN_MULTI_CONN (1 << 8)
+#endif
+
 #define HELP_INFO 1
 #define VERSION_INFO 2
 
@@ -342,20 +351,20 @@ private:
 
       dout(20) << __func__ << ": got: " << *ctx << dendl;
 
-      int r = safe_write(fd, &ctx->reply, sizeof(struct nbd_reply));
+      // send the reply header and the read data (without copying it) in
+      // a single writev
+      bufferlist reply;
+      reply.append(reinterpret_cast<const char *>(&ctx->reply),
+                   sizeof(struct nbd_reply));
+      if (ctx->command == NBD_CMD_READ && ctx->reply.error == htonl(0)) {
+        reply.claim_append(ctx->data);
+      }
+      int r = reply.write_fd(fd);
       if (r < 0) {
-	derr << *ctx << ": failed to write reply header: " << cpp_strerror(r)
+	derr << *ctx << ": failed to write reply: " << cpp_strerror(r)
 	     << dendl;
         return;
       }
-      if (ctx->command == NBD_CMD_READ && ctx->reply.error == htonl(0)) {
-	r = ctx->data.write_fd(fd);
-        if (r < 0) {
-	  derr << *ctx << ": failed to write replay data: " << cpp_strerror(r)
-	       << dendl;
-          return;
-	}
-      }
       dout(20) << *ctx << ": finish" << dendl;
     }
     dout(20) << __func__ << ": terminated" << dendl;
@@ -567,7 +576,8 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   unsigned long size;
 
   int index = 0;
-  int fd[2];
+  std::vector<int> nbd_socks;     // kernel side of each connection
+  std::vector<int> server_socks;  // our side of each connection
 
   librbd::image_info_t info;
 
@@ -602,9 +612,14 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   common_init_finish(g_ceph_context);
   global_init_chdir(g_ceph_context);
 
-  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
-    r = -errno;
-    goto close_ret;
+  for (int i = 0; i < cfg->num_connections; ++i) {
+    int fd[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
+      r = -errno;
+      goto close_fd;
+    }
+    nbd_socks.push_back(fd[0]);
+    server_socks.push_back(fd[1]);
   }
 
   if (cfg->devpath.empty()) {
@@ -621,7 +636,7 @@ static int do_map(int argc, const char *argv[], Config *cfg)
         goto close_fd;
       }
 
-      r = ioctl(nbd, NBD_SET_SOCK, fd[0]);
+      r = ioctl(nbd, NBD_SET_SOCK, nbd_socks[0]);
       if (r < 0) {
         close(nbd);
         ++index;
@@ -645,7 +660,7 @@ static int do_map(int argc, const char *argv[], Config *cfg)
       goto close_fd;
     }
 
-    r = ioctl(nbd, NBD_SET_SOCK, fd[0]);
+    r = ioctl(nbd, NBD_SET_SOCK, nbd_socks[0]);
     if (r < 0) {
       r = -errno;
       cerr << "rbd-nbd: the device " << cfg->devpath << " is busy" << std::endl;
@@ -654,7 +669,23 @@ static int do_map(int argc, const char *argv[], Config *cfg)
     }
   }
 
+  for (size_t i = 1; i < nbd_socks.size(); ++i) {
+    r = ioctl(nbd, NBD_SET_SOCK, nbd_socks[i]);
+    if (r < 0) {
+      r = -errno;
+      cerr << "rbd-nbd: failed to add connection " << i << " to "
+           << cfg->devpath << ": " << cpp_strerror(r)
+           << " (kernel may not support multiple connections)" << std::endl;
+      goto close_nbd;
+    }
+  }
+
   flags = NBD_FLAG_SEND_FLUSH | NBD_FLAG_SEND_TRIM | NBD_FLAG_HAS_FLAGS;
+  if (nbd_socks.size() > 1) {
+    // all connections are served by the same image, so a flush sent on
+    // any of them covers writes completed on the others
+    flags |= NBD_FLAG_CAN_MULTI_CONN;
+  }
   if (!cfg->snapname.empty() || cfg->readonly) {
     flags |= NBD_FLAG_READ_ONLY;
     read_only = 1;
@@ -746,10 +777,12 @@ static int do_map(int argc, const char *argv[], Config *cfg)
     }
 
     {
-      NBDServer server(fd[1], image);
+      std::vector<std::unique_ptr<NBDServer>> servers;
+      for (auto fd : server_socks) {
+        servers.emplace_back(new NBDServer(fd, image));
+        servers.back()->start();
+      }
 
-      server.start();
-      
       init_async_signal_handler();
       register_async_signal_handler(SIGHUP, sighup_handler);
       register_async_signal_handler_oneshot(SIGINT, handle_signal);
@@ -761,8 +794,10 @@ static int do_map(int argc, const char *argv[], Config *cfg)
       unregister_async_signal_handler(SIGINT, handle_signal);
       unregister_async_signal_handler(SIGTERM, handle_signal);
       shutdown_async_signal_handler();
-      
-      server.stop();
+
+      for (auto &server : servers) {
+        server->stop();
+      }
     }
 
     r = image.update_unwatch(handle);
@@ -776,9 +811,12 @@ close_nbd:
   }
   close(nbd);
 close_fd:
-  close(fd[0]);
-  close(fd[1]);
-close_ret:
+  for (auto fd : nbd_socks) {
+    close(fd);
+  }
+  for (auto fd : server_socks) {
+    close(fd);
+  }
   image.close();
   io_ctx.close();
   rados.shutdown();
@@ -958,6 +996,16 @@ static int parse_args(vector<const char*>& args, std::ostream *err_msg, Config *
         return -EINVAL;
       }
       cfg->set_max_part = true;
+    } else if (ceph_argparse_witharg(args, i, &cfg->num_connections, err,
+                                     "--num-connections", (char *)NULL)) {
+      if (!err.str().empty()) {
+        *err_msg << "rbd-nbd: " << err.str();
+        return -EINVAL;
+      }
+      if (cfg->num_connections < 1) {
+        *err_msg << "rbd-nbd: Invalid argument for num-connections!";
+        return -EINVAL;
+      }
     } else if (ceph_argparse_flag(args, i, "--read-only", (char *)NULL)) {
       cfg->readonly = true;
     } else if (ceph_argparse_flag(args, i, "--exclusive", (char *)NULL)) {